@@ -270,6 +270,8 @@ void CPUInfo::Detect()
 	bIDIVt = isVFP4;
 	bFP = false;
 	bASIMD = false;
+	bAES = false;
+	bSHA = false;
 #else // PPSSPP_PLATFORM(LINUX)
 	truncate_cpy(cpu_string, GetCPUString().c_str());
 	truncate_cpy(brand_string, GetCPUBrandString().c_str());
@@ -294,6 +296,8 @@ void CPUInfo::Detect()
 	// These two require ARMv8 or higher
 	bFP = CheckCPUFeature("fp");
 	bASIMD = CheckCPUFeature("asimd");
+	bAES = CheckCPUFeature("aes");
+	bSHA = CheckCPUFeature("sha1");
 	num_cores = GetCoreCount();
 #endif
 #if PPSSPP_ARCH(ARM64)
@@ -324,6 +328,8 @@ std::string CPUInfo::Summarize()
 	if (bNEON) sum += ", NEON";
 	if (bIDIVa) sum += ", IDIVa";
 	if (bIDIVt) sum += ", IDIVt";
+	if (bAES) sum += ", AES";
+	if (bSHA) sum += ", SHA1";
 	if (CPU64bit) sum += ", 64-bit";
 
 	return sum;
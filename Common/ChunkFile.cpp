@@ -15,12 +15,15 @@
 // Official SVN repository and contact information can be found at
 // http://code.google.com/p/dolphin-emu/
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <snappy-c.h>
 
 #include "ChunkFile.h"
 #include "StringUtils.h"
+#include "ThreadPools.h"
 
 PointerWrapSection PointerWrap::Section(const char *title, int ver) {
 	return Section(title, ver, ver);
@@ -62,7 +65,15 @@ void PointerWrap::SetError(Error error_) {
 	}
 }
 
+void PointerWrap::GrowBuffer(size_t size) {
+	size_t offset = *ptr - growBuffer_->data();
+	// Grow generously, states only change size a little from save to save.
+	growBuffer_->resize(std::max(offset + size, growBuffer_->size() + growBuffer_->size() / 8 + 65536));
+	*ptr = growBuffer_->data() + offset;
+}
+
 bool PointerWrap::ExpectVoid(void *data, int size) {
+	ReserveWrite(size);
 	switch (mode) {
 	case MODE_READ:	if (memcmp(data, *ptr, size) != 0) return false; break;
 	case MODE_WRITE: memcpy(*ptr, data, size); break;
@@ -78,6 +89,7 @@ bool PointerWrap::ExpectVoid(void *data, int size) {
 }
 
 void PointerWrap::DoVoid(void *data, int size) {
+	ReserveWrite(size);
 	switch (mode) {
 	case MODE_READ:	memcpy(data, *ptr, size); break;
 	case MODE_WRITE: memcpy(*ptr, data, size); break;
@@ -95,6 +107,7 @@ void PointerWrap::Do(std::string &x) {
 	int stringLen = (int)x.length() + 1;
 	Do(stringLen);
 
+	ReserveWrite(stringLen);
 	switch (mode) {
 	case MODE_READ:		x = (char*)*ptr; break;
 	case MODE_WRITE:	memcpy(*ptr, x.c_str(), stringLen); break;
@@ -108,6 +121,7 @@ void PointerWrap::Do(std::wstring &x) {
 	int stringLen = sizeof(wchar_t)*((int)x.length() + 1);
 	Do(stringLen);
 
+	ReserveWrite(stringLen);
 	switch (mode) {
 	case MODE_READ:		x = (wchar_t*)*ptr; break;
 	case MODE_WRITE:	memcpy(*ptr, x.c_str(), stringLen); break;
@@ -249,7 +263,18 @@ CChunkFileReader::Error CChunkFileReader::LoadFile(const std::string &filename,
 		return ERROR_BAD_FILE;
 	}
 
-	if (header.Compress) {
+	if (header.Compress == COMPRESS_SNAPPY_CHUNKED) {
+		u8 *uncomp_buffer = new u8[header.UncompressedSize];
+		if (!DecompressChunked(buffer, sz, uncomp_buffer, header.UncompressedSize)) {
+			ERROR_LOG(SAVESTATE, "ChunkReader: Failed to decompress file");
+			delete [] uncomp_buffer;
+			delete [] buffer;
+			return ERROR_BAD_FILE;
+		}
+		_buffer = uncomp_buffer;
+		sz = header.UncompressedSize;
+		delete [] buffer;
+	} else if (header.Compress) {
 		u8 *uncomp_buffer = new u8[header.UncompressedSize];
 		size_t uncomp_size = header.UncompressedSize;
 		auto status = snappy_uncompress((const char *)buffer, sz, (char *)uncomp_buffer, &uncomp_size);
@@ -281,6 +306,40 @@ CChunkFileReader::Error CChunkFileReader::LoadFile(const std::string &filename,
 	return ERROR_NONE;
 }
 
+bool CChunkFileReader::DecompressChunked(const u8 *data, size_t sz, u8 *out, size_t outSize) {
+	if (sz < 2 * sizeof(u32))
+		return false;
+	u32 count, chunkSize;
+	memcpy(&count, data, sizeof(u32));
+	memcpy(&chunkSize, data + sizeof(u32), sizeof(u32));
+	if (chunkSize == 0 || (u64)count * chunkSize < outSize || (u64)(count - 1) * chunkSize >= outSize || sz < (2 + (u64)count) * sizeof(u32))
+		return false;
+
+	// Work out where each chunk starts, so they can be decompressed independently.
+	std::vector<size_t> offsets(count + 1);
+	offsets[0] = (2 + count) * sizeof(u32);
+	for (u32 i = 0; i < count; ++i) {
+		u32 compressedSize;
+		memcpy(&compressedSize, data + (2 + i) * sizeof(u32), sizeof(u32));
+		offsets[i + 1] = offsets[i] + compressedSize;
+	}
+	if (offsets[count] != sz)
+		return false;
+
+	std::atomic<bool> failed(false);
+	GlobalThreadPool::Loop([&](int lower, int upper) {
+		for (int i = lower; i < upper; ++i) {
+			size_t expected = std::min((size_t)chunkSize, outSize - (size_t)i * chunkSize);
+			size_t uncompSize = expected;
+			const char *src = (const char *)data + offsets[i];
+			auto status = snappy_uncompress(src, offsets[i + 1] - offsets[i], (char *)out + (size_t)i * chunkSize, &uncompSize);
+			if (status != SNAPPY_OK || uncompSize != expected)
+				failed = true;
+		}
+	}, 0, (int)count);
+	return !failed;
+}
+
 // Takes ownership of buffer.
 CChunkFileReader::Error CChunkFileReader::SaveFile(const std::string &filename, const std::string &title, const char *gitVersion, u8 *buffer, size_t sz) {
 	INFO_LOG(SAVESTATE, "ChunkReader: Writing %s", filename.c_str());
@@ -292,24 +351,47 @@ CChunkFileReader::Error CChunkFileReader::SaveFile(const std::string &filename,
 		return ERROR_BAD_FILE;
 	}
 
+	// Compress independent chunks in parallel, each into its own slot of compressed_buffer.
+	const u32 chunkCount = (u32)((sz + COMPRESS_CHUNK_SIZE - 1) / COMPRESS_CHUNK_SIZE);
+	const size_t slotSize = snappy_max_compressed_length(COMPRESS_CHUNK_SIZE);
+	const size_t indexSize = (2 + chunkCount) * sizeof(u32);
+
 	// Make sure we can allocate a buffer to compress before compressing.
-	size_t write_len = snappy_max_compressed_length(sz);
-	u8 *compressed_buffer = (u8 *)malloc(write_len);
+	u8 *compressed_buffer = (u8 *)malloc(indexSize + chunkCount * slotSize);
 	u8 *write_buffer = buffer;
+	size_t write_len = sz;
+	std::vector<size_t> chunkSizes(chunkCount);
 	if (!compressed_buffer) {
 		ERROR_LOG(SAVESTATE, "ChunkReader: Unable to allocate compressed buffer");
 		// We'll save uncompressed.  Better than not saving...
-		write_len = sz;
 	} else {
-		snappy_compress((const char *)buffer, sz, (char *)compressed_buffer, &write_len);
+		GlobalThreadPool::Loop([&](int lower, int upper) {
+			for (int i = lower; i < upper; ++i) {
+				size_t offset = (size_t)i * COMPRESS_CHUNK_SIZE;
+				size_t len = std::min((size_t)COMPRESS_CHUNK_SIZE, sz - offset);
+				chunkSizes[i] = slotSize;
+				snappy_compress((const char *)buffer + offset, len, (char *)compressed_buffer + indexSize + i * slotSize, &chunkSizes[i]);
+			}
+		}, 0, (int)chunkCount);
 		free(buffer);
 
+		// Write the index, and pack the chunks together behind it.
+		u32 *index = (u32 *)compressed_buffer;
+		index[0] = chunkCount;
+		index[1] = COMPRESS_CHUNK_SIZE;
+		write_len = indexSize;
+		for (u32 i = 0; i < chunkCount; ++i) {
+			index[2 + i] = (u32)chunkSizes[i];
+			memmove(compressed_buffer + write_len, compressed_buffer + indexSize + i * slotSize, chunkSizes[i]);
+			write_len += chunkSizes[i];
+		}
+
 		write_buffer = compressed_buffer;
 	}
 
 	// Create header
 	SChunkHeader header{};
-	header.Compress = compressed_buffer ? 1 : 0;
+	header.Compress = compressed_buffer ? COMPRESS_SNAPPY_CHUNKED : COMPRESS_NONE;
 	header.Revision = REVISION_CURRENT;
 	header.ExpectedSize = (u32)write_len;
 	header.UncompressedSize = (u32)sz;
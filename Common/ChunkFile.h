@@ -36,6 +36,7 @@
 #include <list>
 #include <set>
 #include <type_traits>
+#include <vector>
 
 #include "Common.h"
 #include "Swap.h"
@@ -133,6 +134,9 @@ class PointerWrap
 	PointerWrap(u8 **ptr_, Mode mode_) : ptr(ptr_), mode(mode_), error(ERROR_NONE) {}
 	PointerWrap(unsigned char **ptr_, int mode_) : ptr((u8**)ptr_), mode((Mode)mode_), error(ERROR_NONE) {}
 
+	// In MODE_WRITE, grow this buffer (which *ptr must point into) instead of relying on a measure pass.
+	void SetGrowableBuffer(std::vector<u8> *buffer) { growBuffer_ = buffer; }
+
 	PointerWrapSection Section(const char *title, int ver);
 
 	// The returned object can be compared against the version that was loaded.
@@ -571,6 +575,15 @@ class PointerWrap
 	}
 
 	void DoMarker(const char *prevName, u32 arbitraryNumber = 0x42);
+
+private:
+	inline void ReserveWrite(size_t size) {
+		if (growBuffer_ && mode == MODE_WRITE && (size_t)(*ptr - growBuffer_->data()) + size > growBuffer_->size())
+			GrowBuffer(size);
+	}
+	void GrowBuffer(size_t size);
+
+	std::vector<u8> *growBuffer_ = nullptr;
 };
 
 class CChunkFileReader
@@ -620,6 +633,26 @@ class CChunkFileReader
 		}
 	}
 
+	// Saves in a single pass, growing data as needed. Only measures if data is empty.
+	// data is left at least as large as the state (it's never shrunk, so it can be reused.)
+	template<class T>
+	static Error SavePtr(std::vector<u8> &data, T &_class)
+	{
+		if (data.empty())
+			data.resize(MeasurePtr(_class));
+
+		u8 *ptr = &data[0];
+		PointerWrap p(&ptr, PointerWrap::MODE_WRITE);
+		p.SetGrowableBuffer(&data);
+		_class.DoState(p);
+
+		if (p.error != p.ERROR_FAILURE) {
+			return ERROR_NONE;
+		} else {
+			return ERROR_BROKEN_STATE;
+		}
+	}
+
 	// Load file template
 	template<class T>
 	static Error Load(const std::string &filename, std::string *gitVersion, T& _class, std::string *failureReason)
@@ -641,16 +674,29 @@ class CChunkFileReader
 		return error;
 	}
 
-	// Save file template
+	// Saves the state into a new malloc'd buffer, which can later be passed to SaveFile.
 	template<class T>
-	static Error Save(const std::string &filename, const std::string &title, const char *gitVersion, T& _class)
+	static Error Snapshot(T &_class, u8 *&buffer, size_t &sz)
 	{
-		// Get data
-		size_t const sz = MeasurePtr(_class);
-		u8 *buffer = (u8 *)malloc(sz);
+		sz = MeasurePtr(_class);
+		buffer = (u8 *)malloc(sz);
 		if (!buffer)
 			return ERROR_BAD_ALLOC;
 		Error error = SavePtr(buffer, _class);
+		if (error != ERROR_NONE) {
+			free(buffer);
+			buffer = nullptr;
+		}
+		return error;
+	}
+
+	// Save file template
+	template<class T>
+	static Error Save(const std::string &filename, const std::string &title, const char *gitVersion, T& _class)
+	{
+		u8 *buffer;
+		size_t sz;
+		Error error = Snapshot(_class, buffer, sz);
 
 		// SaveFile takes ownership of buffer
 		if (error == ERROR_NONE)
@@ -683,6 +729,8 @@ class CChunkFileReader
 	}
 
 	static Error GetFileTitle(const std::string &filename, std::string *title);
+	// Compresses and writes a buffer from Snapshot. Takes ownership of buffer, and is safe to call on any thread.
+	static Error SaveFile(const std::string &filename, const std::string &title, const char *gitVersion, u8 *buffer, size_t sz);
 
 private:
 	struct SChunkHeader
@@ -697,10 +745,22 @@ class CChunkFileReader
 	enum {
 		REVISION_MIN = 4,
 		REVISION_TITLE = 5,
-		REVISION_CURRENT = REVISION_TITLE,
+		REVISION_CHUNKED = 6,
+		REVISION_CURRENT = REVISION_CHUNKED,
 	};
 
+	enum {
+		COMPRESS_NONE = 0,
+		COMPRESS_SNAPPY = 1,
+		// Independent snappy chunks, preceded by a chunk count, chunk size, and compressed size per chunk.
+		COMPRESS_SNAPPY_CHUNKED = 2,
+	};
+
+	// Big enough to compress well, small enough to spread over the thread pool.
+	static const u32 COMPRESS_CHUNK_SIZE = 1024 * 1024;
+
+	static bool DecompressChunked(const u8 *data, size_t sz, u8 *out, size_t outSize);
+
 	static Error LoadFile(const std::string &filename, std::string *gitVersion, u8 *&buffer, size_t &sz, std::string *failureReason);
-	static Error SaveFile(const std::string &filename, const std::string &title, const char *gitVersion, u8 *buffer, size_t sz);
 	static Error LoadFileHeader(File::IOFile &pFile, SChunkHeader &header, std::string *title);
 };
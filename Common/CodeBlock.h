@@ -6,6 +6,7 @@
 
 #include "Common.h"
 #include "MemoryUtil.h"
+#include "MemoryUsage.h"
 
 // Everything that needs to generate code should inherit from this.
 // You get memory management for free, plus, you can use all emitter functions without
@@ -57,6 +58,7 @@ template<class T> class CodeBlock : public CodeBlockCommon, public T {
 		// The protection will be set to RW if PlatformIsWXExclusive.
 		region = (u8*)AllocateExecutableMemory(region_size);
 		T::SetCodePointer(region);
+		MemoryUsage::Add(MemoryUsage::Category::JIT_CODE, region_size);
 	}
 
 	// Always clear code space with breakpoints, so that if someone accidentally executes
@@ -103,6 +105,7 @@ template<class T> class CodeBlock : public CodeBlockCommon, public T {
 	void FreeCodeSpace() {
 		ProtectMemoryPages(region, region_size, MEM_PROT_READ | MEM_PROT_WRITE);
 		FreeMemoryPages(region, region_size);
+		MemoryUsage::Sub(MemoryUsage::Category::JIT_CODE, region_size);
 		region = nullptr;
 		region_size = 0;
 	}
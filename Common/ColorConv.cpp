@@ -18,6 +18,7 @@
 #include "ColorConv.h"
 // NEON is in a separate file so that it can be compiled with a runtime check.
 #include "ColorConvNEON.h"
+#include "ColorConvAVX2.h"
 #include "Common.h"
 #include "CPUDetect.h"
 
@@ -29,6 +30,38 @@
 #include <smmintrin.h>
 #endif
 
+// Does the bulk of a conversion with an AVX2 kernel when the CPU has it, leaving the rest to the code after.
+#if PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
+#define CONVERT_AVX2(func, dst, src, numPixels) \
+	if (cpu_info.bAVX2) { \
+		const u32 done = func(dst, src, numPixels); \
+		dst += done; \
+		src += done; \
+		numPixels -= done; \
+	}
+#else
+#define CONVERT_AVX2(func, dst, src, numPixels)
+#endif
+
+#if PPSSPP_ARCH(ARM64)
+#define CONVERT_NEON(func, dst, src, numPixels) { \
+		const u32 done = func(dst, src, numPixels); \
+		dst += done; \
+		src += done; \
+		numPixels -= done; \
+	}
+#elif PPSSPP_ARCH(ARM_NEON)
+#define CONVERT_NEON(func, dst, src, numPixels) \
+	if (cpu_info.bNEON) { \
+		const u32 done = func(dst, src, numPixels); \
+		dst += done; \
+		src += done; \
+		numPixels -= done; \
+	}
+#else
+#define CONVERT_NEON(func, dst, src, numPixels)
+#endif
+
 inline u16 RGBA8888toRGB565(u32 px) {
 	return ((px >> 3) & 0x001F) | ((px >> 5) & 0x07E0) | ((px >> 8) & 0xF800);
 }
@@ -138,6 +171,8 @@ void convert5551_dx9(u16* data, u32* out, int width, int l, int u) {
 
 
 void ConvertBGRA8888ToRGBA8888(u32 *dst, const u32 *src, u32 numPixels) {
+	CONVERT_AVX2(ConvertBGRA8888ToRGBA8888AVX2, dst, src, numPixels);
+	CONVERT_NEON(ConvertBGRA8888ToRGBA8888NEON, dst, src, numPixels);
 #ifdef _M_SSE
 	const __m128i maskGA = _mm_set1_epi32(0xFF00FF00);
 
@@ -171,6 +206,8 @@ void ConvertBGRA8888ToRGBA8888(u32 *dst, const u32 *src, u32 numPixels) {
 }
 
 void ConvertRGBA8888ToRGBA5551(u16 *dst, const u32 *src, u32 numPixels) {
+	CONVERT_AVX2(ConvertRGBA8888ToRGBA5551AVX2, dst, src, numPixels);
+	CONVERT_NEON(ConvertRGBA8888ToRGBA5551NEON, dst, src, numPixels);
 #if _M_SSE >= 0x401
 	const __m128i maskAG = _mm_set1_epi32(0x8000F800);
 	const __m128i maskRB = _mm_set1_epi32(0x00F800F8);
@@ -213,6 +250,8 @@ void ConvertRGBA8888ToRGBA5551(u16 *dst, const u32 *src, u32 numPixels) {
 }
 
 void ConvertBGRA8888ToRGBA5551(u16 *dst, const u32 *src, u32 numPixels) {
+	CONVERT_AVX2(ConvertBGRA8888ToRGBA5551AVX2, dst, src, numPixels);
+	CONVERT_NEON(ConvertBGRA8888ToRGBA5551NEON, dst, src, numPixels);
 #if _M_SSE >= 0x401
 	const __m128i maskAG = _mm_set1_epi32(0x8000F800);
 	const __m128i maskRB = _mm_set1_epi32(0x00F800F8);
@@ -255,30 +294,40 @@ void ConvertBGRA8888ToRGBA5551(u16 *dst, const u32 *src, u32 numPixels) {
 }
 
 void ConvertBGRA8888ToRGB565(u16 *dst, const u32 *src, u32 numPixels) {
+	CONVERT_AVX2(ConvertBGRA8888ToRGB565AVX2, dst, src, numPixels);
+	CONVERT_NEON(ConvertBGRA8888ToRGB565NEON, dst, src, numPixels);
 	for (u32 i = 0; i < numPixels; i++) {
 		dst[i] = BGRA8888toRGB565(src[i]);
 	}
 }
 
 void ConvertBGRA8888ToRGBA4444(u16 *dst, const u32 *src, u32 numPixels) {
+	CONVERT_AVX2(ConvertBGRA8888ToRGBA4444AVX2, dst, src, numPixels);
+	CONVERT_NEON(ConvertBGRA8888ToRGBA4444NEON, dst, src, numPixels);
 	for (u32 i = 0; i < numPixels; i++) {
 		dst[i] = BGRA8888toRGBA4444(src[i]);
 	}
 }
 
 void ConvertRGBA8888ToRGB565(u16 *dst, const u32 *src, u32 numPixels) {
+	CONVERT_AVX2(ConvertRGBA8888ToRGB565AVX2, dst, src, numPixels);
+	CONVERT_NEON(ConvertRGBA8888ToRGB565NEON, dst, src, numPixels);
 	for (u32 x = 0; x < numPixels; ++x) {
 		dst[x] = RGBA8888toRGB565(src[x]);
 	}
 }
 
 void ConvertRGBA8888ToRGBA4444(u16 *dst, const u32 *src, u32 numPixels) {
+	CONVERT_AVX2(ConvertRGBA8888ToRGBA4444AVX2, dst, src, numPixels);
+	CONVERT_NEON(ConvertRGBA8888ToRGBA4444NEON, dst, src, numPixels);
 	for (u32 x = 0; x < numPixels; ++x) {
 		dst[x] = RGBA8888toRGBA4444(src[x]);
 	}
 }
 
 void ConvertRGBA565ToRGBA8888(u32 *dst32, const u16 *src, u32 numPixels) {
+	CONVERT_AVX2(ConvertRGBA565ToRGBA8888AVX2, dst32, src, numPixels);
+	CONVERT_NEON(ConvertRGBA565ToRGBA8888NEON, dst32, src, numPixels);
 #ifdef _M_SSE
 	const __m128i mask5 = _mm_set1_epi16(0x001f);
 	const __m128i mask6 = _mm_set1_epi16(0x003f);
@@ -333,6 +382,8 @@ void ConvertRGBA565ToRGBA8888(u32 *dst32, const u16 *src, u32 numPixels) {
 }
 
 void ConvertRGBA5551ToRGBA8888(u32 *dst32, const u16 *src, u32 numPixels) {
+	CONVERT_AVX2(ConvertRGBA5551ToRGBA8888AVX2, dst32, src, numPixels);
+	CONVERT_NEON(ConvertRGBA5551ToRGBA8888NEON, dst32, src, numPixels);
 #ifdef _M_SSE
 	const __m128i mask5 = _mm_set1_epi16(0x001f);
 	const __m128i mask8 = _mm_set1_epi16(0x00ff);
@@ -387,6 +438,8 @@ void ConvertRGBA5551ToRGBA8888(u32 *dst32, const u16 *src, u32 numPixels) {
 }
 
 void ConvertRGBA4444ToRGBA8888(u32 *dst32, const u16 *src, u32 numPixels) {
+	CONVERT_AVX2(ConvertRGBA4444ToRGBA8888AVX2, dst32, src, numPixels);
+	CONVERT_NEON(ConvertRGBA4444ToRGBA8888NEON, dst32, src, numPixels);
 #ifdef _M_SSE
 	const __m128i mask4 = _mm_set1_epi16(0x000f);
 
@@ -468,8 +521,8 @@ void ConvertABGR4444ToRGBA8888(u32 *dst32, const u16 *src, u32 numPixels) {
 	}
 }
 
-void ConvertRGBA4444ToBGRA8888(u32 *dst32, const u16 *src, u32 numPixels) {
-	u8 *dst = (u8 *)dst32;
+void ConvertRGBA4444ToBGRA8888(u32 *dst, const u16 *src, u32 numPixels) {
+	CONVERT_AVX2(ConvertRGBA4444ToBGRA8888AVX2, dst, src, numPixels);
 	for (u32 x = 0; x < numPixels; x++) {
 		u16 c = src[x];
 		u32 r = c & 0x000f;
@@ -482,6 +535,7 @@ void ConvertRGBA4444ToBGRA8888(u32 *dst32, const u16 *src, u32 numPixels) {
 }
 
 void ConvertRGBA5551ToBGRA8888(u32 *dst, const u16 *src, u32 numPixels) {
+	CONVERT_AVX2(ConvertRGBA5551ToBGRA8888AVX2, dst, src, numPixels);
 	for (u32 x = 0; x < numPixels; x++) {
 		u16 c = src[x];
 		u32 r = c & 0x001f;
@@ -495,6 +549,7 @@ void ConvertRGBA5551ToBGRA8888(u32 *dst, const u16 *src, u32 numPixels) {
 }
 
 void ConvertRGB565ToBGRA8888(u32 *dst, const u16 *src, u32 numPixels) {
+	CONVERT_AVX2(ConvertRGB565ToBGRA8888AVX2, dst, src, numPixels);
 	for (u32 x = 0; x < numPixels; x++) {
 		u16 c = src[x];
 		u32 r = c & 0x001f;
@@ -0,0 +1,215 @@
+// Copyright (c) 2015- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include "ppsspp_config.h"
+#if PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
+
+#include <immintrin.h>
+#include "ColorConvAVX2.h"
+
+// This file is built without -mavx2, so the rest of the binary still runs on older CPUs.
+// GCC and Clang need each function marked instead, MSVC allows the intrinsics anywhere.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define AVX2_FUNC
+#else
+#define AVX2_FUNC __attribute__((target("avx2")))
+#endif
+
+AVX2_FUNC static inline __m256i SwapRB(__m256i c) {
+	const __m256i shuffle = _mm256_setr_epi8(
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+	return _mm256_shuffle_epi8(c, shuffle);
+}
+
+// Each of these leaves the 16-bit color in the low half of each 32-bit lane.
+AVX2_FUNC static inline __m256i RGBA8888ToRGBA5551(__m256i c) {
+	__m256i ag = _mm256_and_si256(c, _mm256_set1_epi32(0x8000F800));
+	ag = _mm256_or_si256(_mm256_srli_epi32(ag, 16), _mm256_srli_epi32(ag, 6));
+	__m256i rb = _mm256_and_si256(c, _mm256_set1_epi32(0x00F800F8));
+	rb = _mm256_or_si256(_mm256_srli_epi32(rb, 3), _mm256_srli_epi32(rb, 9));
+	return _mm256_and_si256(_mm256_or_si256(ag, rb), _mm256_set1_epi32(0x0000FFFF));
+}
+
+AVX2_FUNC static inline __m256i RGBA8888ToRGB565(__m256i c) {
+	const __m256i r = _mm256_and_si256(_mm256_srli_epi32(c, 3), _mm256_set1_epi32(0x001F));
+	const __m256i g = _mm256_and_si256(_mm256_srli_epi32(c, 5), _mm256_set1_epi32(0x07E0));
+	const __m256i b = _mm256_and_si256(_mm256_srli_epi32(c, 8), _mm256_set1_epi32(0xF800));
+	return _mm256_or_si256(_mm256_or_si256(r, g), b);
+}
+
+AVX2_FUNC static inline __m256i RGBA8888ToRGBA4444(__m256i c) {
+	const __m256i r = _mm256_and_si256(_mm256_srli_epi32(c, 4), _mm256_set1_epi32(0x000F));
+	const __m256i g = _mm256_and_si256(_mm256_srli_epi32(c, 8), _mm256_set1_epi32(0x00F0));
+	const __m256i b = _mm256_and_si256(_mm256_srli_epi32(c, 12), _mm256_set1_epi32(0x0F00));
+	const __m256i a = _mm256_and_si256(_mm256_srli_epi32(c, 16), _mm256_set1_epi32(0xF000));
+	return _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, a));
+}
+
+// Packs two vectors of 16-bit colors (in 32-bit lanes) into 16 pixels, in order.
+AVX2_FUNC static inline __m256i Pack16(__m256i lo, __m256i hi) {
+	// packus works within each 128-bit half, so the middle quarters come out swapped.
+	return _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+template <bool swapRB, __m256i (*convert)(__m256i)>
+AVX2_FUNC static inline u32 Convert8888To16(u16 *dst, const u32 *src, u32 numPixels) {
+	const u32 count = numPixels & ~15;
+	for (u32 i = 0; i < count; i += 16) {
+		__m256i c0 = _mm256_loadu_si256((const __m256i *)(src + i));
+		__m256i c1 = _mm256_loadu_si256((const __m256i *)(src + i + 8));
+		if (swapRB) {
+			c0 = SwapRB(c0);
+			c1 = SwapRB(c1);
+		}
+		_mm256_storeu_si256((__m256i *)(dst + i), Pack16(convert(c0), convert(c1)));
+	}
+	return count;
+}
+
+AVX2_FUNC u32 ConvertBGRA8888ToRGBA8888AVX2(u32 *dst, const u32 *src, u32 numPixels) {
+	const u32 count = numPixels & ~7;
+	for (u32 i = 0; i < count; i += 8) {
+		const __m256i c = _mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_si256((__m256i *)(dst + i), SwapRB(c));
+	}
+	return count;
+}
+
+AVX2_FUNC u32 ConvertRGBA8888ToRGBA5551AVX2(u16 *dst, const u32 *src, u32 numPixels) {
+	return Convert8888To16<false, &RGBA8888ToRGBA5551>(dst, src, numPixels);
+}
+
+AVX2_FUNC u32 ConvertBGRA8888ToRGBA5551AVX2(u16 *dst, const u32 *src, u32 numPixels) {
+	return Convert8888To16<true, &RGBA8888ToRGBA5551>(dst, src, numPixels);
+}
+
+AVX2_FUNC u32 ConvertRGBA8888ToRGB565AVX2(u16 *dst, const u32 *src, u32 numPixels) {
+	return Convert8888To16<false, &RGBA8888ToRGB565>(dst, src, numPixels);
+}
+
+AVX2_FUNC u32 ConvertBGRA8888ToRGB565AVX2(u16 *dst, const u32 *src, u32 numPixels) {
+	return Convert8888To16<true, &RGBA8888ToRGB565>(dst, src, numPixels);
+}
+
+AVX2_FUNC u32 ConvertRGBA8888ToRGBA4444AVX2(u16 *dst, const u32 *src, u32 numPixels) {
+	return Convert8888To16<false, &RGBA8888ToRGBA4444>(dst, src, numPixels);
+}
+
+AVX2_FUNC u32 ConvertBGRA8888ToRGBA4444AVX2(u16 *dst, const u32 *src, u32 numPixels) {
+	return Convert8888To16<true, &RGBA8888ToRGBA4444>(dst, src, numPixels);
+}
+
+// These take one 16-bit color per 32-bit lane and produce RGBA8888, expanding bits like Convert5To8() etc.
+AVX2_FUNC static inline __m256i Expand5To8(__m256i v) {
+	return _mm256_or_si256(_mm256_slli_epi32(v, 3), _mm256_srli_epi32(v, 2));
+}
+
+AVX2_FUNC static inline __m256i Expand6To8(__m256i v) {
+	return _mm256_or_si256(_mm256_slli_epi32(v, 2), _mm256_srli_epi32(v, 4));
+}
+
+AVX2_FUNC static inline __m256i RGB565ToRGBA8888(__m256i c) {
+	const __m256i mask5 = _mm256_set1_epi32(0x1F);
+	const __m256i r = Expand5To8(_mm256_and_si256(c, mask5));
+	const __m256i g = Expand6To8(_mm256_and_si256(_mm256_srli_epi32(c, 5), _mm256_set1_epi32(0x3F)));
+	const __m256i b = Expand5To8(_mm256_and_si256(_mm256_srli_epi32(c, 11), mask5));
+	const __m256i rg = _mm256_or_si256(r, _mm256_slli_epi32(g, 8));
+	const __m256i ba = _mm256_or_si256(_mm256_slli_epi32(b, 16), _mm256_set1_epi32(0xFF000000));
+	return _mm256_or_si256(rg, ba);
+}
+
+AVX2_FUNC static inline __m256i RGBA5551ToRGBA8888(__m256i c) {
+	const __m256i mask5 = _mm256_set1_epi32(0x1F);
+	const __m256i r = Expand5To8(_mm256_and_si256(c, mask5));
+	const __m256i g = Expand5To8(_mm256_and_si256(_mm256_srli_epi32(c, 5), mask5));
+	const __m256i b = Expand5To8(_mm256_and_si256(_mm256_srli_epi32(c, 10), mask5));
+	// Move the alpha bit to the top and smear it down over the alpha byte.
+	const __m256i a = _mm256_slli_epi32(_mm256_srai_epi32(_mm256_slli_epi32(c, 16), 31), 24);
+	const __m256i rg = _mm256_or_si256(r, _mm256_slli_epi32(g, 8));
+	const __m256i ba = _mm256_or_si256(_mm256_slli_epi32(b, 16), a);
+	return _mm256_or_si256(rg, ba);
+}
+
+AVX2_FUNC static inline __m256i RGBA4444ToRGBA8888(__m256i c) {
+	const __m256i r = _mm256_and_si256(c, _mm256_set1_epi32(0x000F));
+	const __m256i g = _mm256_slli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x00F0)), 4);
+	const __m256i b = _mm256_slli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x0F00)), 8);
+	const __m256i a = _mm256_slli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0xF000)), 12);
+	const __m256i rgba = _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, a));
+	return _mm256_or_si256(rgba, _mm256_slli_epi32(rgba, 4));
+}
+
+// The BGRA outputs match the C versions, which just shift the bits up without expanding them.
+AVX2_FUNC static inline __m256i RGB565ToBGRA8888(__m256i c) {
+	const __m256i r = _mm256_slli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x001F)), 16 + 3);
+	const __m256i g = _mm256_slli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x07E0)), 8 + 2 - 5);
+	const __m256i b = _mm256_srli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0xF800)), 11 - 3);
+	return _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, _mm256_set1_epi32(0xFF000000)));
+}
+
+AVX2_FUNC static inline __m256i RGBA5551ToBGRA8888(__m256i c) {
+	const __m256i r = _mm256_slli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x001F)), 16 + 3);
+	const __m256i g = _mm256_slli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x03E0)), 8 + 3 - 5);
+	const __m256i b = _mm256_srli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x7C00)), 10 - 3);
+	const __m256i a = _mm256_slli_epi32(_mm256_srai_epi32(_mm256_slli_epi32(c, 16), 31), 24);
+	return _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, a));
+}
+
+AVX2_FUNC static inline __m256i RGBA4444ToBGRA8888(__m256i c) {
+	const __m256i r = _mm256_slli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x000F)), 16 + 4);
+	const __m256i g = _mm256_slli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x00F0)), 8 + 4 - 4);
+	const __m256i b = _mm256_srli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x0F00)), 8 - 4);
+	const __m256i a = _mm256_slli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0xF000)), 24 + 4 - 12);
+	return _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, a));
+}
+
+template <__m256i (*convert)(__m256i)>
+AVX2_FUNC static inline u32 Convert16To8888(u32 *dst, const u16 *src, u32 numPixels) {
+	const u32 count = numPixels & ~7;
+	for (u32 i = 0; i < count; i += 8) {
+		const __m256i c = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+		_mm256_storeu_si256((__m256i *)(dst + i), convert(c));
+	}
+	return count;
+}
+
+AVX2_FUNC u32 ConvertRGBA565ToRGBA8888AVX2(u32 *dst, const u16 *src, u32 numPixels) {
+	return Convert16To8888<&RGB565ToRGBA8888>(dst, src, numPixels);
+}
+
+AVX2_FUNC u32 ConvertRGBA5551ToRGBA8888AVX2(u32 *dst, const u16 *src, u32 numPixels) {
+	return Convert16To8888<&RGBA5551ToRGBA8888>(dst, src, numPixels);
+}
+
+AVX2_FUNC u32 ConvertRGBA4444ToRGBA8888AVX2(u32 *dst, const u16 *src, u32 numPixels) {
+	return Convert16To8888<&RGBA4444ToRGBA8888>(dst, src, numPixels);
+}
+
+AVX2_FUNC u32 ConvertRGB565ToBGRA8888AVX2(u32 *dst, const u16 *src, u32 numPixels) {
+	return Convert16To8888<&RGB565ToBGRA8888>(dst, src, numPixels);
+}
+
+AVX2_FUNC u32 ConvertRGBA5551ToBGRA8888AVX2(u32 *dst, const u16 *src, u32 numPixels) {
+	return Convert16To8888<&RGBA5551ToBGRA8888>(dst, src, numPixels);
+}
+
+AVX2_FUNC u32 ConvertRGBA4444ToBGRA8888AVX2(u32 *dst, const u16 *src, u32 numPixels) {
+	return Convert16To8888<&RGBA4444ToBGRA8888>(dst, src, numPixels);
+}
+
+#endif
@@ -0,0 +1,38 @@
+// Copyright (c) 2015- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include "CommonTypes.h"
+
+// These only convert a leading multiple of 8 or 16 pixels, and return how many they did.
+// The caller does the rest.  Only call these when cpu_info.bAVX2 is set.
+u32 ConvertBGRA8888ToRGBA8888AVX2(u32 *dst, const u32 *src, u32 numPixels);
+
+u32 ConvertRGBA8888ToRGBA5551AVX2(u16 *dst, const u32 *src, u32 numPixels);
+u32 ConvertBGRA8888ToRGBA5551AVX2(u16 *dst, const u32 *src, u32 numPixels);
+u32 ConvertRGBA8888ToRGB565AVX2(u16 *dst, const u32 *src, u32 numPixels);
+u32 ConvertBGRA8888ToRGB565AVX2(u16 *dst, const u32 *src, u32 numPixels);
+u32 ConvertRGBA8888ToRGBA4444AVX2(u16 *dst, const u32 *src, u32 numPixels);
+u32 ConvertBGRA8888ToRGBA4444AVX2(u16 *dst, const u32 *src, u32 numPixels);
+
+u32 ConvertRGBA565ToRGBA8888AVX2(u32 *dst, const u16 *src, u32 numPixels);
+u32 ConvertRGBA5551ToRGBA8888AVX2(u32 *dst, const u16 *src, u32 numPixels);
+u32 ConvertRGBA4444ToRGBA8888AVX2(u32 *dst, const u16 *src, u32 numPixels);
+u32 ConvertRGB565ToBGRA8888AVX2(u32 *dst, const u16 *src, u32 numPixels);
+u32 ConvertRGBA5551ToBGRA8888AVX2(u32 *dst, const u16 *src, u32 numPixels);
+u32 ConvertRGBA4444ToBGRA8888AVX2(u32 *dst, const u16 *src, u32 numPixels);
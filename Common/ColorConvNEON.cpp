@@ -27,7 +27,138 @@
 #include "Common.h"
 #include "CPUDetect.h"
 
-// TODO: More NEON color conversion funcs.
+u32 ConvertBGRA8888ToRGBA8888NEON(u32 *dst, const u32 *src, u32 numPixels) {
+	const u32 count = numPixels & ~15;
+	for (u32 i = 0; i < count; i += 16) {
+		uint8x16x4_t c = vld4q_u8((const u8 *)(src + i));
+		const uint8x16_t b = c.val[0];
+		c.val[0] = c.val[2];
+		c.val[2] = b;
+		vst4q_u8((u8 *)(dst + i), c);
+	}
+	return count;
+}
+
+// The deinterleaving loads make BGRA the same as RGBA, but with the channels swapped.
+template <bool swapRB>
+static inline u32 Convert8888To565(u16 *dst, const u32 *src, u32 numPixels) {
+	const u32 count = numPixels & ~7;
+	for (u32 i = 0; i < count; i += 8) {
+		const uint8x8x4_t c = vld4_u8((const u8 *)(src + i));
+		const uint16x8_t r = vshrq_n_u16(vmovl_u8(c.val[swapRB ? 2 : 0]), 3);
+		const uint16x8_t g = vshlq_n_u16(vshrq_n_u16(vmovl_u8(c.val[1]), 2), 5);
+		const uint16x8_t b = vshlq_n_u16(vshrq_n_u16(vmovl_u8(c.val[swapRB ? 0 : 2]), 3), 11);
+		vst1q_u16(dst + i, vorrq_u16(vorrq_u16(r, g), b));
+	}
+	return count;
+}
+
+template <bool swapRB>
+static inline u32 Convert8888To5551(u16 *dst, const u32 *src, u32 numPixels) {
+	const u32 count = numPixels & ~7;
+	for (u32 i = 0; i < count; i += 8) {
+		const uint8x8x4_t c = vld4_u8((const u8 *)(src + i));
+		const uint16x8_t r = vshrq_n_u16(vmovl_u8(c.val[swapRB ? 2 : 0]), 3);
+		const uint16x8_t g = vshlq_n_u16(vshrq_n_u16(vmovl_u8(c.val[1]), 3), 5);
+		const uint16x8_t b = vshlq_n_u16(vshrq_n_u16(vmovl_u8(c.val[swapRB ? 0 : 2]), 3), 10);
+		const uint16x8_t a = vshlq_n_u16(vshrq_n_u16(vmovl_u8(c.val[3]), 7), 15);
+		vst1q_u16(dst + i, vorrq_u16(vorrq_u16(r, g), vorrq_u16(b, a)));
+	}
+	return count;
+}
+
+template <bool swapRB>
+static inline u32 Convert8888To4444(u16 *dst, const u32 *src, u32 numPixels) {
+	const u32 count = numPixels & ~7;
+	for (u32 i = 0; i < count; i += 8) {
+		const uint8x8x4_t c = vld4_u8((const u8 *)(src + i));
+		const uint16x8_t r = vshrq_n_u16(vmovl_u8(c.val[swapRB ? 2 : 0]), 4);
+		const uint16x8_t g = vshlq_n_u16(vshrq_n_u16(vmovl_u8(c.val[1]), 4), 4);
+		const uint16x8_t b = vshlq_n_u16(vshrq_n_u16(vmovl_u8(c.val[swapRB ? 0 : 2]), 4), 8);
+		const uint16x8_t a = vshlq_n_u16(vshrq_n_u16(vmovl_u8(c.val[3]), 4), 12);
+		vst1q_u16(dst + i, vorrq_u16(vorrq_u16(r, g), vorrq_u16(b, a)));
+	}
+	return count;
+}
+
+u32 ConvertRGBA8888ToRGB565NEON(u16 *dst, const u32 *src, u32 numPixels) {
+	return Convert8888To565<false>(dst, src, numPixels);
+}
+
+u32 ConvertBGRA8888ToRGB565NEON(u16 *dst, const u32 *src, u32 numPixels) {
+	return Convert8888To565<true>(dst, src, numPixels);
+}
+
+u32 ConvertRGBA8888ToRGBA5551NEON(u16 *dst, const u32 *src, u32 numPixels) {
+	return Convert8888To5551<false>(dst, src, numPixels);
+}
+
+u32 ConvertBGRA8888ToRGBA5551NEON(u16 *dst, const u32 *src, u32 numPixels) {
+	return Convert8888To5551<true>(dst, src, numPixels);
+}
+
+u32 ConvertRGBA8888ToRGBA4444NEON(u16 *dst, const u32 *src, u32 numPixels) {
+	return Convert8888To4444<false>(dst, src, numPixels);
+}
+
+u32 ConvertBGRA8888ToRGBA4444NEON(u16 *dst, const u32 *src, u32 numPixels) {
+	return Convert8888To4444<true>(dst, src, numPixels);
+}
+
+u32 ConvertRGBA565ToRGBA8888NEON(u32 *dst, const u16 *src, u32 numPixels) {
+	const u32 count = numPixels & ~7;
+	for (u32 i = 0; i < count; i += 8) {
+		const uint16x8_t c = vld1q_u16(src + i);
+		const uint8x8_t r = vmovn_u16(vandq_u16(c, vdupq_n_u16(0x1F)));
+		const uint8x8_t g = vmovn_u16(vandq_u16(vshrq_n_u16(c, 5), vdupq_n_u16(0x3F)));
+		const uint8x8_t b = vmovn_u16(vshrq_n_u16(c, 11));
+		uint8x8x4_t res;
+		res.val[0] = vorr_u8(vshl_n_u8(r, 3), vshr_n_u8(r, 2));
+		res.val[1] = vorr_u8(vshl_n_u8(g, 2), vshr_n_u8(g, 4));
+		res.val[2] = vorr_u8(vshl_n_u8(b, 3), vshr_n_u8(b, 2));
+		res.val[3] = vdup_n_u8(0xFF);
+		vst4_u8((u8 *)(dst + i), res);
+	}
+	return count;
+}
+
+u32 ConvertRGBA5551ToRGBA8888NEON(u32 *dst, const u16 *src, u32 numPixels) {
+	const uint16x8_t mask5 = vdupq_n_u16(0x1F);
+	const u32 count = numPixels & ~7;
+	for (u32 i = 0; i < count; i += 8) {
+		const uint16x8_t c = vld1q_u16(src + i);
+		const uint8x8_t r = vmovn_u16(vandq_u16(c, mask5));
+		const uint8x8_t g = vmovn_u16(vandq_u16(vshrq_n_u16(c, 5), mask5));
+		const uint8x8_t b = vmovn_u16(vandq_u16(vshrq_n_u16(c, 10), mask5));
+		uint8x8x4_t res;
+		res.val[0] = vorr_u8(vshl_n_u8(r, 3), vshr_n_u8(r, 2));
+		res.val[1] = vorr_u8(vshl_n_u8(g, 3), vshr_n_u8(g, 2));
+		res.val[2] = vorr_u8(vshl_n_u8(b, 3), vshr_n_u8(b, 2));
+		// An arithmetic shift spreads the alpha bit over the whole value.
+		res.val[3] = vmovn_u16(vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(c), 15)));
+		vst4_u8((u8 *)(dst + i), res);
+	}
+	return count;
+}
+
+u32 ConvertRGBA4444ToRGBA8888NEON(u32 *dst, const u16 *src, u32 numPixels) {
+	const uint16x8_t mask4 = vdupq_n_u16(0x0F);
+	const u32 count = numPixels & ~7;
+	for (u32 i = 0; i < count; i += 8) {
+		const uint16x8_t c = vld1q_u16(src + i);
+		const uint8x8_t r = vmovn_u16(vandq_u16(c, mask4));
+		const uint8x8_t g = vmovn_u16(vandq_u16(vshrq_n_u16(c, 4), mask4));
+		const uint8x8_t b = vmovn_u16(vandq_u16(vshrq_n_u16(c, 8), mask4));
+		const uint8x8_t a = vmovn_u16(vshrq_n_u16(c, 12));
+		uint8x8x4_t res;
+		res.val[0] = vorr_u8(vshl_n_u8(r, 4), r);
+		res.val[1] = vorr_u8(vshl_n_u8(g, 4), g);
+		res.val[2] = vorr_u8(vshl_n_u8(b, 4), b);
+		res.val[3] = vorr_u8(vshl_n_u8(a, 4), a);
+		vst4_u8((u8 *)(dst + i), res);
+	}
+	return count;
+}
 
 void ConvertRGBA4444ToABGR4444NEON(u16 *dst, const u16 *src, u32 numPixels) {
 	const uint16x8_t mask0040 = vdupq_n_u16(0x00F0);
@@ -22,3 +22,15 @@
 void ConvertRGBA4444ToABGR4444NEON(u16 *dst, const u16 *src, u32 numPixels);
 void ConvertRGBA5551ToABGR1555NEON(u16 *dst, const u16 *src, u32 numPixels);
 void ConvertRGB565ToBGR565NEON(u16 *dst, const u16 *src, u32 numPixels);
+
+// Like the AVX2 ones, these only do a leading multiple of 8 or 16 pixels, and return how many they did.
+u32 ConvertBGRA8888ToRGBA8888NEON(u32 *dst, const u32 *src, u32 numPixels);
+u32 ConvertRGBA8888ToRGB565NEON(u16 *dst, const u32 *src, u32 numPixels);
+u32 ConvertBGRA8888ToRGB565NEON(u16 *dst, const u32 *src, u32 numPixels);
+u32 ConvertRGBA8888ToRGBA5551NEON(u16 *dst, const u32 *src, u32 numPixels);
+u32 ConvertBGRA8888ToRGBA5551NEON(u16 *dst, const u32 *src, u32 numPixels);
+u32 ConvertRGBA8888ToRGBA4444NEON(u16 *dst, const u32 *src, u32 numPixels);
+u32 ConvertBGRA8888ToRGBA4444NEON(u16 *dst, const u32 *src, u32 numPixels);
+u32 ConvertRGBA565ToRGBA8888NEON(u32 *dst, const u16 *src, u32 numPixels);
+u32 ConvertRGBA5551ToRGBA8888NEON(u32 *dst, const u16 *src, u32 numPixels);
+u32 ConvertRGBA4444ToRGBA8888NEON(u32 *dst, const u16 *src, u32 numPixels);
@@ -3,10 +3,22 @@
 #include <cstring>
 #include <vector>
 
+#include "ppsspp_config.h"
 #include "ext/xxhash.h"
+#include "Common/BitScan.h"
 #include "Common/CommonFuncs.h"
 #include "Common/Log.h"
 
+#if PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
+#include <emmintrin.h>
+#elif PPSSPP_ARCH(ARM64)
+#if defined(_MSC_VER)
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+#endif
+
 // Whatever random value.
 const uint32_t hashmapSeed = 0x23B58532;
 
@@ -21,74 +33,121 @@ inline bool KeyEquals(const K &a, const K &b) {
 	return !memcmp(&a, &b, sizeof(K));
 }
 
-enum class BucketState : uint8_t {
-	FREE,
-	TAKEN,
-	REMOVED,  // for linear probing to work (and removal during deletion) we need tombstones
+// Keys of PrehashMap are already hashes.
+inline uint32_t HashKeyIdentity(const uint32_t &k) {
+	return k;
+}
+
+// One control byte per bucket. Taken buckets store 7 bits of the hash, so most mismatches
+// are rejected without touching the key at all.
+enum HashMapControl : uint8_t {
+	HASHMAP_FREE = 0x80,
+	HASHMAP_REMOVED = 0xFE,  // for probing to work (and removal during deletion) we need tombstones
 };
 
-// Uses linear probing for cache-friendliness. Not segregating values from keys because
-// we always use very small values, so it's probably better to have them in the same
-// cache-line as the corresponding key.
+// Probing looks at 16 control bytes at once, a bit like Abseil's SwissTable.
+struct HashMapGroup {
+	enum {
+		SIZE = 16,
+	};
+
+#if PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
+	explicit HashMapGroup(const uint8_t *ctrl) : ctrl_(_mm_loadu_si128((const __m128i *)ctrl)) {}
+
+	// Bit i is set if control byte i equals c.
+	uint32_t Match(uint8_t c) const {
+		return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl_, _mm_set1_epi8((char)c)));
+	}
+	// Only FREE and REMOVED have the top bit set.
+	uint32_t MatchFreeOrRemoved() const {
+		return (uint32_t)_mm_movemask_epi8(ctrl_);
+	}
+
+	__m128i ctrl_;
+#elif PPSSPP_ARCH(ARM64)
+	explicit HashMapGroup(const uint8_t *ctrl) : ctrl_(vld1q_u8(ctrl)) {}
+
+	uint32_t Match(uint8_t c) const {
+		return ToMask(vceqq_u8(ctrl_, vdupq_n_u8(c)));
+	}
+	uint32_t MatchFreeOrRemoved() const {
+		return ToMask(vcltq_s8(vreinterpretq_s8_u8(ctrl_), vdupq_n_s8(0)));
+	}
+
+	// No movemask, so weigh each byte by its bit and add up the halves.
+	static uint32_t ToMask(uint8x16_t m) {
+		static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+		const uint8x16_t bits = vandq_u8(m, vld1q_u8(weights));
+		return (uint32_t)vaddv_u8(vget_low_u8(bits)) | ((uint32_t)vaddv_u8(vget_high_u8(bits)) << 8);
+	}
+
+	uint8x16_t ctrl_;
+#else
+	explicit HashMapGroup(const uint8_t *ctrl) : ctrl_(ctrl) {}
+
+	uint32_t Match(uint8_t c) const {
+		uint32_t mask = 0;
+		for (int i = 0; i < SIZE; i++)
+			mask |= (ctrl_[i] == c ? 1 : 0) << i;
+		return mask;
+	}
+	uint32_t MatchFreeOrRemoved() const {
+		uint32_t mask = 0;
+		for (int i = 0; i < SIZE; i++)
+			mask |= (ctrl_[i] >> 7) << i;
+		return mask;
+	}
+
+	const uint8_t *ctrl_;
+#endif
+
+	uint32_t MatchFree() const {
+		return Match(HASHMAP_FREE);
+	}
+};
+
+// Open addressing with control bytes probed a group at a time, for cache-friendliness. Not
+// segregating values from keys because we always use very small values, so it's probably
+// better to have them in the same cache-line as the corresponding key.
 // Enforces that value are pointers to make sure that combined storage makes sense.
-template <class Key, class Value, Value NullValue>
-class DenseHashMap {
+template <class Key, class Value, Value NullValue, uint32_t (*Hash)(const Key &)>
+class ProbingHashMap {
 public:
-	DenseHashMap(int initialCapacity) : capacity_(initialCapacity) {
-		map.resize(initialCapacity);
-		state.resize(initialCapacity);
+	ProbingHashMap(int initialCapacity) {
+		// Must be a power of two, and at least a whole group.
+		capacity_ = HashMapGroup::SIZE;
+		while (capacity_ < initialCapacity)
+			capacity_ *= 2;
+		map.resize(capacity_);
+		ctrl.resize(capacity_ + HashMapGroup::SIZE - 1, HASHMAP_FREE);
 	}
 
 	// Returns nullptr if no entry was found.
 	Value Get(const Key &key) {
-		uint32_t mask = capacity_ - 1;
-		uint32_t pos = HashKey(key) & mask;
-		// No? Let's go into search mode. Linear probing.
-		uint32_t p = pos;
-		while (true) {
-			if (state[p] == BucketState::TAKEN && KeyEquals(key, map[p].key))
-				return map[p].value;
-			else if (state[p] == BucketState::FREE)
-				return NullValue;
-			p = (p + 1) & mask;  // If the state is REMOVED, we just keep on walking. 
-			if (p == pos) {
-				_assert_msg_(SYSTEM, false, "DenseHashMap: Hit full on Get()");
-			}
-		}
-		return NullValue;
+		const uint32_t hash = Hash(key);
+		int p = Find(key, hash);
+		return p >= 0 ? map[p].value : NullValue;
 	}
 
 	// Returns false if we already had the key! Which is a bit different.
 	bool Insert(const Key &key, Value value) {
-		// Check load factor, resize if necessary. We never shrink.
-		if (count_ > capacity_ / 2) {
-			Grow(2);
+		// Check load factor (including tombstones, since they make probes longer), resize if necessary.
+		// We never shrink. Below 7/8 full, a probe almost always ends in the first group.
+		if (count_ + removedCount_ >= capacity_ - capacity_ / 8) {
+			Grow(count_ >= capacity_ / 2 ? 2 : 1);
 		}
-		uint32_t mask = capacity_ - 1;
-		uint32_t pos = HashKey(key) & mask;
-		uint32_t p = pos;
-		while (true) {
-			if (state[p] == BucketState::TAKEN) {
-				if (KeyEquals(key, map[p].key)) {
-					// Bad! We already got this one. Let's avoid this case.
-					_assert_msg_(SYSTEM, false, "DenseHashMap: Duplicate key inserted");
-					return false;
-				}
-				// continue looking....
-			} else {
-				// Got a place, either removed or FREE.
-				break;
-			}
-			p = (p + 1) & mask;
-			if (p == pos) {
-				// FULL! Error. Should not happen thanks to Grow().
-				_assert_msg_(SYSTEM, false, "DenseHashMap: Hit full on Insert()");
-			}
+		const uint32_t hash = Hash(key);
+		if (Find(key, hash) >= 0) {
+			// Bad! We already got this one. Let's avoid this case.
+			return false;
 		}
-		if (state[p] == BucketState::REMOVED) {
+
+		// Got a place, either removed or FREE.
+		const uint32_t p = FindSlot(hash);
+		if (ctrl[p] == HASHMAP_REMOVED) {
 			removedCount_--;
 		}
-		state[p] = BucketState::TAKEN;
+		SetCtrl(p, H2(hash));
 		map[p].key = key;
 		map[p].value = value;
 		count_++;
@@ -96,24 +155,14 @@ class DenseHashMap {
 	}
 
 	bool Remove(const Key &key) {
-		uint32_t mask = capacity_ - 1;
-		uint32_t pos = HashKey(key) & mask;
-		uint32_t p = pos;
-		while (state[p] != BucketState::FREE) {
-			if (state[p] == BucketState::TAKEN && KeyEquals(key, map[p].key)) {
-				// Got it! Mark it as removed.
-				state[p] = BucketState::REMOVED;
-				removedCount_++;
-				count_--;
-				return true;
-			}
-			p = (p + 1) & mask;
-			if (p == pos) {
-				// FULL! Error. Should not happen.
-				_assert_msg_(SYSTEM, false, "DenseHashMap: Hit full on Remove()");
-			}
-		}
-		return false;
+		int p = Find(key, Hash(key));
+		if (p < 0)
+			return false;
+		// Got it! Mark it as removed.
+		SetCtrl(p, HASHMAP_REMOVED);
+		removedCount_++;
+		count_--;
+		return true;
 	}
 
 	size_t size() const {
@@ -123,18 +172,19 @@ class DenseHashMap {
 	template<class T>
 	inline void Iterate(T func) const {
 		for (size_t i = 0; i < map.size(); i++) {
-			if (state[i] == BucketState::TAKEN) {
+			if (IsTaken(ctrl[i])) {
 				func(map[i].key, map[i].value);
 			}
 		}
 	}
 
 	void Clear() {
-		memset(state.data(), (int)BucketState::FREE, state.size());
+		memset(ctrl.data(), HASHMAP_FREE, ctrl.size());
 		count_ = 0;
 		removedCount_ = 0;
 	}
 
+	// Gets rid of REMOVED tombstones, making lookups somewhat more efficient.
 	void Rebuild() {
 		Grow(1);
 	}
@@ -147,184 +197,106 @@ class DenseHashMap {
 	}
 
 private:
-	void Grow(int factor) {
-		// We simply move out the existing data, then we re-insert the old.
-		// This is extremely non-atomic and will need synchronization.
-		std::vector<Pair> old = std::move(map);
-		std::vector<BucketState> oldState = std::move(state);
-		// Can't assume move will clear, it just may clear.
-		map.clear();
-		state.clear();
-
-		int oldCount = count_;
-		capacity_ *= factor;
-		map.resize(capacity_);
-		state.resize(capacity_);
-		count_ = 0;  // Insert will update it.
-		removedCount_ = 0;
-		for (size_t i = 0; i < old.size(); i++) {
-			if (oldState[i] == BucketState::TAKEN) {
-				Insert(old[i].key, old[i].value);
-			}
-		}
-		_assert_msg_(SYSTEM, oldCount == count_, "DenseHashMap: count should not change in Grow()");
+	// The top 7 bits go in the control byte, the probe position comes from the low bits.
+	static uint8_t H2(uint32_t hash) {
+		return (uint8_t)(hash >> 25);
 	}
-	struct Pair {
-		Key key;
-		Value value;
-	};
-	std::vector<Pair> map;
-	std::vector<BucketState> state;
-	int capacity_;
-	int count_ = 0;
-	int removedCount_ = 0;
-};
-
-// Like the above, uses linear probing for cache-friendliness.
-// Does not perform hashing at all so expects well-distributed keys.
-template <class Value, Value NullValue>
-class PrehashMap {
-public:
-	PrehashMap(int initialCapacity) : capacity_(initialCapacity) {
-		map.resize(initialCapacity);
-		state.resize(initialCapacity);
+	static bool IsTaken(uint8_t c) {
+		return (c & 0x80) == 0;
 	}
 
-	// Returns nullptr if no entry was found.
-	Value Get(uint32_t hash) {
-		uint32_t mask = capacity_ - 1;
-		uint32_t pos = hash & mask;
-		// No? Let's go into search mode. Linear probing.
-		uint32_t p = pos;
-		while (true) {
-			if (state[p] == BucketState::TAKEN && hash == map[p].hash)
-				return map[p].value;
-			else if (state[p] == BucketState::FREE)
-				return NullValue;
-			p = (p + 1) & mask;  // If the state is REMOVED, we just keep on walking. 
-			if (p == pos) {
-				_assert_msg_(SYSTEM, false, "PrehashMap: Hit full on Get()");
-			}
-		}
-		return NullValue;
+	// The first SIZE - 1 control bytes are mirrored after the end, so a group can be loaded from any position.
+	void SetCtrl(uint32_t p, uint8_t c) {
+		ctrl[p] = c;
+		if (p < HashMapGroup::SIZE - 1)
+			ctrl[capacity_ + p] = c;
 	}
 
-	// Returns false if we already had the key! Which is a bit different.
-	bool Insert(uint32_t hash, Value value) {
-		// Check load factor, resize if necessary. We never shrink.
-		if (count_ > capacity_ / 2) {
-			Grow(2);
-		}
-		uint32_t mask = capacity_ - 1;
+	// Returns the bucket index, or -1 if the key isn't in the map.
+	int Find(const Key &key, uint32_t hash) const {
+		const uint32_t mask = capacity_ - 1;
+		const uint8_t h2 = H2(hash);
 		uint32_t pos = hash & mask;
-		uint32_t p = pos;
-		while (state[p] != BucketState::FREE) {
-			if (state[p] == BucketState::TAKEN) {
-				if (hash == map[p].hash)
-					return false;  // Bad!
-			} else {
-				// Got a place, either removed or FREE.
-				break;
+		// Stepping a group further each time visits every group once, since capacity is a power of two.
+		for (uint32_t step = HashMapGroup::SIZE; ; step += HashMapGroup::SIZE) {
+			const HashMapGroup group(&ctrl[pos]);
+			for (uint32_t matches = group.Match(h2); matches != 0; matches &= matches - 1) {
+				uint32_t p = (pos + ctz32_nonzero(matches)) & mask;
+				if (KeyEquals(key, map[p].key))
+					return (int)p;
 			}
-			p = (p + 1) & mask;
-			if (p == pos) {
-				// FULL! Error. Should not happen thanks to Grow().
-				_assert_msg_(SYSTEM, false, "PrehashMap: Hit full on Insert()");
+			// Insert would've used any free bucket in this group, so the key can't be further on.
+			if (group.MatchFree() != 0)
+				return -1;
+			// If the state is REMOVED, we just keep on walking.
+			if (step > (uint32_t)capacity_) {
+				_assert_msg_(SYSTEM, false, "HashMap: Hit full on Get()");
+				return -1;
 			}
+			pos = (pos + step) & mask;
 		}
-		if (state[p] == BucketState::REMOVED) {
-			removedCount_--;
-		}
-		state[p] = BucketState::TAKEN;
-		map[p].hash = hash;
-		map[p].value = value;
-		count_++;
-		return true;
 	}
 
-	bool Remove(uint32_t hash) {
-		uint32_t mask = capacity_ - 1;
+	uint32_t FindSlot(uint32_t hash) const {
+		const uint32_t mask = capacity_ - 1;
 		uint32_t pos = hash & mask;
-		uint32_t p = pos;
-		while (state[p] != BucketState::FREE) {
-			if (state[p] == BucketState::TAKEN && hash == map[p].hash) {
-				// Got it!
-				state[p] = BucketState::REMOVED;
-				removedCount_++;
-				count_--;
-				return true;
-			}
-			p = (p + 1) & mask;
-			if (p == pos) {
-				_assert_msg_(SYSTEM, false, "PrehashMap: Hit full on Remove()");
-			}
-		}
-		return false;
-	}
-
-	size_t size() {
-		return count_;
-	}
-
-	template<class T>
-	void Iterate(T func) const {
-		for (size_t i = 0; i < map.size(); i++) {
-			if (state[i] == BucketState::TAKEN) {
-				func(map[i].hash, map[i].value);
-			}
+		for (uint32_t step = HashMapGroup::SIZE; ; step += HashMapGroup::SIZE) {
+			uint32_t avail = HashMapGroup(&ctrl[pos]).MatchFreeOrRemoved();
+			if (avail != 0)
+				return (pos + ctz32_nonzero(avail)) & mask;
+			// FULL! Error. Should not happen thanks to Grow().
+			_assert_msg_(SYSTEM, step <= (uint32_t)capacity_, "HashMap: Hit full on Insert()");
+			pos = (pos + step) & mask;
 		}
 	}
 
-	void Clear() {
-		memset(state.data(), (int)BucketState::FREE, state.size());
-		count_ = 0;
-		removedCount_ = 0;
-	}
-
-	// Gets rid of REMOVED tombstones, making lookups somewhat more efficient.
-	void Rebuild() {
-		Grow(1);
-	}
-
-	void Maintain() {
-		// Heuristic
-		if (removedCount_ >= capacity_ / 4) {
-			Rebuild();
-		}
-	}
-
-private:
 	void Grow(int factor) {
 		// We simply move out the existing data, then we re-insert the old.
 		// This is extremely non-atomic and will need synchronization.
 		std::vector<Pair> old = std::move(map);
-		std::vector<BucketState> oldState = std::move(state);
+		std::vector<uint8_t> oldCtrl = std::move(ctrl);
 		// Can't assume move will clear, it just may clear.
 		map.clear();
-		state.clear();
+		ctrl.clear();
 
 		int oldCount = count_;
 		int oldCapacity = capacity_;
 		capacity_ *= factor;
 		map.resize(capacity_);
-		state.resize(capacity_);
+		ctrl.resize(capacity_ + HashMapGroup::SIZE - 1, HASHMAP_FREE);
 		count_ = 0;  // Insert will update it.
 		removedCount_ = 0;
 		for (size_t i = 0; i < old.size(); i++) {
-			if (oldState[i] == BucketState::TAKEN) {
-				Insert(old[i].hash, old[i].value);
+			if (IsTaken(oldCtrl[i])) {
+				Insert(old[i].key, old[i].value);
 			}
 		}
-		INFO_LOG(G3D, "Grew hashmap capacity from %d to %d", oldCapacity, capacity_);
-		_assert_msg_(SYSTEM, oldCount == count_, "PrehashMap: count should not change in Grow()");
+		if (factor != 1) {
+			INFO_LOG(G3D, "Grew hashmap capacity from %d to %d", oldCapacity, capacity_);
+		}
+		_assert_msg_(SYSTEM, oldCount == count_, "HashMap: count should not change in Grow()");
 	}
+
 	struct Pair {
-		uint32_t hash;
+		Key key;
 		Value value;
 	};
 	std::vector<Pair> map;
-	std::vector<BucketState> state;
+	std::vector<uint8_t> ctrl;
 	int capacity_;
 	int count_ = 0;
 	int removedCount_ = 0;
 };
+
+template <class Key, class Value, Value NullValue>
+class DenseHashMap : public ProbingHashMap<Key, Value, NullValue, &HashKey<Key>> {
+public:
+	DenseHashMap(int initialCapacity) : ProbingHashMap<Key, Value, NullValue, &HashKey<Key>>(initialCapacity) {}
+};
+
+// Like the above, but does not perform hashing at all so expects well-distributed keys.
+template <class Value, Value NullValue>
+class PrehashMap : public ProbingHashMap<uint32_t, Value, NullValue, &HashKeyIdentity> {
+public:
+	PrehashMap(int initialCapacity) : ProbingHashMap<uint32_t, Value, NullValue, &HashKeyIdentity>(initialCapacity) {}
+};
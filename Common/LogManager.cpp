@@ -20,6 +20,7 @@
 #include <algorithm>
 
 #include "base/logging.h"
+#include "thread/threadutil.h"
 #include "util/text/utf8.h"
 #include "LogManager.h"
 #include "ConsoleListener.h"
@@ -111,7 +112,8 @@ static const LogNameTableEntry logTable[] = {
 	{LogTypes::SCEMISC,    "SCEMISC"},
 };
 
-LogManager::LogManager() {
+LogManager::LogManager(bool async)
+	: async_(async), enqueuePos_(0), dropped_(0), drainSleeping_(false), drainRunning_(false) {
 	for (size_t i = 0; i < ARRAY_SIZE(logTable); i++) {
 		if (i != logTable[i].logType) {
 			FLOG("Bad logtable at %i", (int)i);
@@ -150,9 +152,28 @@ LogManager::LogManager() {
 #endif
 	AddListener(ringLog_);
 #endif
+
+	if (async_) {
+		queue_ = new LogSlot[LOG_QUEUE_SIZE];
+		for (size_t i = 0; i < LOG_QUEUE_SIZE; ++i) {
+			queue_[i].sequence.store(i, std::memory_order_relaxed);
+			queue_[i].record.longMsg = nullptr;
+		}
+		drainRunning_ = true;
+		drainThread_ = std::thread(&LogManager::DrainThread, this);
+	}
 }
 
 LogManager::~LogManager() {
+	if (async_) {
+		// Let the drain thread deliver whatever is left before the listeners go away.
+		drainRunning_ = false;
+		drainCond_.notify_one();
+		drainThread_.join();
+		delete [] queue_;
+		queue_ = nullptr;
+	}
+
 	for (int i = 0; i < LogTypes::NUMBER_OF_LOGS; ++i) {
 #if !defined(MOBILE_DEVICE) || defined(_DEBUG)
 		RemoveListener(fileLog_);
@@ -208,10 +229,6 @@ void LogManager::Log(LogTypes::LOG_LEVELS level, LogTypes::LOG_TYPE type, const
 	if (level > log.level || !log.enabled)
 		return;
 
-	LogMessage message;
-	message.level = level;
-	message.log = log.m_shortName;
-
 #ifdef _WIN32
 	static const char sep = '\\';
 #else
@@ -226,19 +243,77 @@ void LogManager::Log(LogTypes::LOG_LEVELS level, LogTypes::LOG_TYPE type, const
 			file = fileshort + 1;
 	}
 
-	std::lock_guard<std::mutex> lk(log_lock_);
-	Common::Timer::GetTimeFormatted(message.timestamp);
+	if (!async_) {
+		LogSync(level, log, file, line, format, args);
+		return;
+	}
+
+	// Claim a slot.  Only when the slot's sequence matches our position is it free to write.
+	size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+	LogSlot *slot;
+	while (true) {
+		slot = &queue_[pos & (LOG_QUEUE_SIZE - 1)];
+		size_t seq = slot->sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+		if (diff == 0) {
+			if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			// Full, the drain thread is behind.  Count it so the gap shows up in the log.
+			dropped_++;
+			return;
+		} else {
+			pos = enqueuePos_.load(std::memory_order_relaxed);
+		}
+	}
+
+	LogRecord &record = slot->record;
+	Common::Timer::GetTimeRaw(&record.timeSec, &record.timeMs);
+	record.level = level;
+	record.log = log.m_shortName;
+	FormatHeader(record.header, sizeof(record.header), level, log, file, line);
+
+	va_list args_copy;
+	va_copy(args_copy, args);
+	int neededBytes = vsnprintf(record.msg, sizeof(record.msg), format, args);
+	if (neededBytes < 0)
+		neededBytes = 0;
+	if (neededBytes >= (int)sizeof(record.msg)) {
+		record.longMsg = new std::string();
+		record.longMsg->resize(neededBytes + 1);
+		vsnprintf(&(*record.longMsg)[0], neededBytes + 1, format, args_copy);
+		record.longMsg->resize(neededBytes);
+	}
+	record.msgLen = std::min(neededBytes, (int)sizeof(record.msg) - 1);
+	va_end(args_copy);
+
+	// Publish.
+	slot->sequence.store(pos + 1, std::memory_order_release);
+	if (drainSleeping_.load(std::memory_order_relaxed))
+		drainCond_.notify_one();
+}
 
+void LogManager::FormatHeader(char *header, size_t size, LogTypes::LOG_LEVELS level, const LogChannel &log, const char *file, int line) {
 	if (hleCurrentThreadName) {
-		snprintf(message.header, sizeof(message.header), "%-12.12s %c[%s]: %s:%d",
+		snprintf(header, size, "%-12.12s %c[%s]: %s:%d",
 			hleCurrentThreadName, level_to_char[(int)level],
 			log.m_shortName,
 			file, line);
 	} else {
-		snprintf(message.header, sizeof(message.header), "%s:%d %c[%s]:",
+		snprintf(header, size, "%s:%d %c[%s]:",
 			file, line, level_to_char[(int)level],
 			log.m_shortName);
 	}
+}
+
+void LogManager::LogSync(LogTypes::LOG_LEVELS level, const LogChannel &log, const char *file, int line, const char *format, va_list args) {
+	LogMessage message;
+	message.level = level;
+	message.log = log.m_shortName;
+
+	std::lock_guard<ProfiledMutex> lk(log_lock_);
+	Common::Timer::GetTimeFormatted(message.timestamp);
+	FormatHeader(message.header, sizeof(message.header), level, log, file, line);
 
 	char msgBuf[1024];
 	va_list args_copy;
@@ -255,12 +330,74 @@ void LogManager::Log(LogTypes::LOG_LEVELS level, LogTypes::LOG_TYPE type, const
 	message.msg[neededBytes] = '\n';
 	va_end(args_copy);
 
-	std::lock_guard<std::mutex> listeners_lock(listeners_lock_);
+	DeliverMessage(message);
+}
+
+void LogManager::DeliverMessage(const LogMessage &message) {
+	std::lock_guard<ProfiledMutex> listeners_lock(listeners_lock_);
 	for (auto &iter : listeners_) {
 		iter->Log(message);
 	}
 }
 
+bool LogManager::DrainQueue(LogMessage &message) {
+	bool any = false;
+	while (true) {
+		LogSlot &slot = queue_[dequeuePos_ & (LOG_QUEUE_SIZE - 1)];
+		if (slot.sequence.load(std::memory_order_acquire) != dequeuePos_ + 1)
+			break;
+
+		LogRecord &record = slot.record;
+		Common::Timer::GetTimeFormatted(message.timestamp, record.timeSec, record.timeMs);
+		memcpy(message.header, record.header, sizeof(message.header));
+		message.level = record.level;
+		message.log = record.log;
+		if (record.longMsg) {
+			message.msg = std::move(*record.longMsg);
+			delete record.longMsg;
+			record.longMsg = nullptr;
+		} else {
+			message.msg.assign(record.msg, record.msgLen);
+		}
+		message.msg.push_back('\n');
+
+		// The slot is free for producers again once it's a full lap ahead.
+		slot.sequence.store(dequeuePos_ + LOG_QUEUE_SIZE, std::memory_order_release);
+		dequeuePos_++;
+
+		DeliverMessage(message);
+		any = true;
+	}
+
+	int dropped = dropped_.exchange(0);
+	if (dropped != 0) {
+		Common::Timer::GetTimeFormatted(message.timestamp);
+		truncate_cpy(message.header, "LogManager:");
+		message.level = LogTypes::LWARNING;
+		message.log = log_[LogTypes::COMMON].m_shortName;
+		message.msg = StringFromFormat("Dropped %d log messages, logging faster than they could be written\n", dropped);
+		DeliverMessage(message);
+	}
+	return any;
+}
+
+void LogManager::DrainThread() {
+	setCurrentThreadName("LogDrain");
+
+	LogMessage message;
+	while (drainRunning_) {
+		if (DrainQueue(message))
+			continue;
+
+		std::unique_lock<std::mutex> guard(drainLock_);
+		drainSleeping_ = true;
+		// Producers only notify while we're asleep, so the timeout covers a racing wakeup.
+		drainCond_.wait_for(guard, std::chrono::milliseconds(10));
+		drainSleeping_ = false;
+	}
+	DrainQueue(message);
+}
+
 bool LogManager::IsEnabled(LogTypes::LOG_LEVELS level, LogTypes::LOG_TYPE type) {
 	LogChannel &log = log_[type];
 	if (level > log.level || !log.enabled)
@@ -268,8 +405,8 @@ bool LogManager::IsEnabled(LogTypes::LOG_LEVELS level, LogTypes::LOG_TYPE type)
 	return true;
 }
 
-void LogManager::Init() {
-	logManager_ = new LogManager();
+void LogManager::Init(bool async) {
+	logManager_ = new LogManager(async);
 }
 
 void LogManager::Shutdown() {
@@ -280,14 +417,14 @@ void LogManager::Shutdown() {
 void LogManager::AddListener(LogListener *listener) {
 	if (!listener)
 		return;
-	std::lock_guard<std::mutex> lk(listeners_lock_);
+	std::lock_guard<ProfiledMutex> lk(listeners_lock_);
 	listeners_.push_back(listener);
 }
 
 void LogManager::RemoveListener(LogListener *listener) {
 	if (!listener)
 		return;
-	std::lock_guard<std::mutex> lk(listeners_lock_);
+	std::lock_guard<ProfiledMutex> lk(listeners_lock_);
 	auto iter = std::find(listeners_.begin(), listeners_.end(), listener);
 	if (iter != listeners_.end())
 		listeners_.erase(iter);
@@ -306,7 +443,7 @@ void FileLogListener::Log(const LogMessage &message) {
 	if (!IsEnabled() || !IsValid())
 		return;
 
-	std::lock_guard<std::mutex> lk(m_log_lock);
+	std::lock_guard<ProfiledMutex> lk(m_log_lock);
 	m_logfile << message.timestamp << " " << message.header << " " << message.msg << std::flush;
 }
 
@@ -19,10 +19,14 @@
 
 #include "ppsspp_config.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <vector>
 #include <mutex>
+#include <thread>
 
 #include "file/ini_file.h"
+#include "thread/profiledmutex.h"
 #include "Log.h"
 #include "StringUtils.h"
 #include "FileUtil.h"
@@ -62,7 +66,7 @@ class FileLogListener : public LogListener {
 	const char* GetName() const { return "file"; }
 
 private:
-	std::mutex m_log_lock;
+	ProfiledMutex m_log_lock{ "LogFile" };
 	std::ofstream m_logfile;
 	bool m_enable;
 };
@@ -106,7 +110,7 @@ class ConsoleListener;
 
 class LogManager {
 private:
-	LogManager();
+	LogManager(bool async);
 	~LogManager();
 
 	// Prevent copies.
@@ -120,9 +124,44 @@ class LogManager {
 	RingbufferLogListener *ringLog_ = nullptr;
 	static LogManager *logManager_;  // Singleton. Ugh.
 
-	std::mutex log_lock_;
-	std::mutex listeners_lock_;
+	ProfiledMutex log_lock_{ "LogManager" };
+	ProfiledMutex listeners_lock_{ "LogListeners" };
 	std::vector<LogListener*> listeners_;
+
+	// Asynchronous logging: producers format into a bounded lock-free queue (a Vyukov-style MPSC ring),
+	// and a background thread hands the records to the listeners.
+	struct LogRecord {
+		s64 timeSec;
+		int timeMs;
+		LogTypes::LOG_LEVELS level;
+		const char *log;
+		char header[64];
+		int msgLen;
+		char msg[448];
+		std::string *longMsg;  // Only allocated if msg is too small.
+	};
+	struct LogSlot {
+		std::atomic<size_t> sequence;
+		LogRecord record;
+	};
+	enum { LOG_QUEUE_SIZE = 1024 };  // Power of two.
+
+	void FormatHeader(char *header, size_t size, LogTypes::LOG_LEVELS level, const LogChannel &log, const char *file, int line);
+	void LogSync(LogTypes::LOG_LEVELS level, const LogChannel &log, const char *file, int line, const char *format, va_list args);
+	void DrainThread();
+	bool DrainQueue(LogMessage &message);
+	void DeliverMessage(const LogMessage &message);
+
+	bool async_;
+	LogSlot *queue_ = nullptr;
+	std::atomic<size_t> enqueuePos_;
+	size_t dequeuePos_ = 0;
+	std::atomic<int> dropped_;
+	std::atomic<bool> drainSleeping_;
+	std::atomic<bool> drainRunning_;
+	std::mutex drainLock_;
+	std::condition_variable drainCond_;
+	std::thread drainThread_;
 public:
 	void AddListener(LogListener *listener);
 	void RemoveListener(LogListener *listener);
@@ -176,7 +215,8 @@ class LogManager {
 		logManager_ = logManager;
 	}
 
-	static void Init();
+	// Pass async = false to deliver each message to the listeners before Log() returns.
+	static void Init(bool async = true);
 	static void Shutdown();
 
 	void ChangeFileLog(const char *filename);
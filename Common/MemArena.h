@@ -45,7 +45,13 @@ class MemArena {
 	u8 *Find4GBBase();
 	bool NeedsProbing();
 
+	// Call before GrabLowMemSpace. Only used where huge pages still allow the mirrors to be mapped.
+	void UseHugePages(bool enable) {
+		useHugePages_ = enable;
+	}
+
 private:
+	bool useHugePages_ = false;
 #ifdef _WIN32
 	HANDLE hMemoryMapping;
 	SYSTEM_INFO sysInfo;
@@ -37,7 +37,16 @@ static const std::string tmpfs_ram_temp_file = "/dev/shm/gc_mem.tmp";
 // do not make this "static"
 std::string ram_temp_file = "/tmp/gc_mem.tmp";
 
+#ifdef MADV_HUGEPAGE
+// Transparent huge pages only kick in if the file offset and address are both aligned.
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+#endif
+
 size_t MemArena::roundup(size_t x) {
+#ifdef MADV_HUGEPAGE
+	if (useHugePages_)
+		return (x + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+#endif
 	return x;
 }
 
@@ -93,6 +102,13 @@ void *MemArena::CreateView(s64 offset, size_t size, void *base)
 		NOTICE_LOG(MEMMAP, "mmap on %s (fd: %d) failed", ram_temp_file.c_str(), (int)fd);
 		return 0;
 	}
+#ifdef MADV_HUGEPAGE
+	// MAP_HUGETLB would need every mirror on a 2MB boundary, so ask for transparent huge pages instead.
+	// Where that's unsupported (e.g. shmem_enabled is never), this fails and we keep normal pages.
+	if (useHugePages_ && size >= HUGE_PAGE_SIZE && madvise(retval, size, MADV_HUGEPAGE) != 0) {
+		INFO_LOG(MEMMAP, "madvise(MADV_HUGEPAGE) failed, errno: %d", (int)errno);
+	}
+#endif
 	return retval;
 }
 
@@ -0,0 +1,96 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <atomic>
+
+#include "Common/MemoryUsage.h"
+
+namespace MemoryUsage {
+
+static const int NUM_CATEGORIES = (int)Category::COUNT;
+
+static std::atomic<s64> current[NUM_CATEGORIES];
+static std::atomic<s64> peak[NUM_CATEGORIES];
+
+static std::atomic<int> lowMemoryCount;
+
+static const char *const names[NUM_CATEGORIES] = {
+	"JIT code",
+	"Textures",
+	"Scaled textures",
+	"Framebuffers",
+	"Vulkan device memory",
+	"Push buffers",
+	"Replacement textures",
+	"Rewind states",
+};
+
+static void UpdatePeak(int i, s64 value) {
+	s64 prev = peak[i].load(std::memory_order_relaxed);
+	while (value > prev && !peak[i].compare_exchange_weak(prev, value, std::memory_order_relaxed)) {
+		continue;
+	}
+}
+
+void Add(Category cat, s64 delta) {
+	int i = (int)cat;
+	s64 value = current[i].fetch_add(delta, std::memory_order_relaxed) + delta;
+	UpdatePeak(i, value);
+}
+
+void Set(Category cat, s64 bytes) {
+	int i = (int)cat;
+	current[i].store(bytes, std::memory_order_relaxed);
+	UpdatePeak(i, bytes);
+}
+
+s64 Current(Category cat) {
+	return current[(int)cat].load(std::memory_order_relaxed);
+}
+
+s64 Peak(Category cat) {
+	return peak[(int)cat].load(std::memory_order_relaxed);
+}
+
+s64 TotalCurrent() {
+	s64 total = 0;
+	for (int i = 0; i < NUM_CATEGORIES; ++i)
+		total += current[i].load(std::memory_order_relaxed);
+	return total;
+}
+
+void ResetPeaks() {
+	for (int i = 0; i < NUM_CATEGORIES; ++i)
+		peak[i].store(current[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+const char *Name(Category cat) {
+	int i = (int)cat;
+	if (i < 0 || i >= NUM_CATEGORIES)
+		return "?";
+	return names[i];
+}
+
+void NotifyLowMemory() {
+	lowMemoryCount++;
+}
+
+int LowMemoryCount() {
+	return lowMemoryCount.load();
+}
+
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include "Common/CommonTypes.h"
+
+// Central accounting of host (and device) memory, per subsystem.
+// Owners report their allocations here, so we can see what to trim on low memory devices.
+// All functions are thread safe.
+namespace MemoryUsage {
+
+enum class Category {
+	JIT_CODE,
+	TEXTURES,
+	SCALED_TEXTURES,
+	FRAMEBUFFERS,
+	VULKAN_DEVICE_MEMORY,
+	PUSH_BUFFERS,
+	REPLACEMENT_TEXTURES,
+	REWIND_STATES,
+
+	COUNT,
+};
+
+// Adjusts the current byte count of a category by delta (which may be negative.)
+void Add(Category cat, s64 delta);
+inline void Sub(Category cat, s64 delta) {
+	Add(cat, -delta);
+}
+// For owners that can cheaply recompute their total instead.
+void Set(Category cat, s64 bytes);
+
+s64 Current(Category cat);
+s64 Peak(Category cat);
+s64 TotalCurrent();
+// Forgets the peaks, setting them to the current values.
+void ResetPeaks();
+
+const char *Name(Category cat);
+
+// Called (from any thread) when the OS tells us memory is running low.
+void NotifyLowMemory();
+// Increases with every notification. Subsystems compare it to the count they last handled,
+// and trim their caches when it has changed.
+int LowMemoryCount();
+
+}
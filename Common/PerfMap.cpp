@@ -0,0 +1,65 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include "ppsspp_config.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+
+#if PPSSPP_PLATFORM(LINUX)
+#include <unistd.h>
+#endif
+
+#include "Common/PerfMap.h"
+#include "Core/Config.h"
+
+#if PPSSPP_PLATFORM(LINUX)
+static std::mutex perfMapLock;
+static FILE *perfMapFile = nullptr;
+static bool perfMapFailed = false;
+#endif
+
+bool PerfMapEnabled() {
+#if PPSSPP_PLATFORM(LINUX)
+	return g_Config.bJitPerfMap;
+#else
+	return false;
+#endif
+}
+
+void PerfMapAddCode(const void *start, size_t size, const std::string &name) {
+#if PPSSPP_PLATFORM(LINUX)
+	if (size == 0 || !PerfMapEnabled())
+		return;
+
+	// The jits may compile on more than one thread (e.g. vertex decoders vs the cpu.)
+	std::lock_guard<std::mutex> guard(perfMapLock);
+	if (!perfMapFile && !perfMapFailed) {
+		char filename[64];
+		snprintf(filename, sizeof(filename), "/tmp/perf-%d.map", (int)getpid());
+		perfMapFile = fopen(filename, "a");
+		perfMapFailed = perfMapFile == nullptr;
+	}
+	if (!perfMapFile)
+		return;
+
+	// perf reads this while we run, so flush each line.  Later entries win for reused addresses.
+	fprintf(perfMapFile, "%llx %llx %s\n", (unsigned long long)(uintptr_t)start, (unsigned long long)size, name.c_str());
+	fflush(perfMapFile);
+#endif
+}
@@ -0,0 +1,26 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Names generated code for Linux perf, using /tmp/perf-<pid>.map (see perf's jit-interface.txt.)
+// Only active on Linux when the JitPerfMap setting is enabled, check first to avoid building names.
+bool PerfMapEnabled();
+void PerfMapAddCode(const void *start, size_t size, const std::string &name);
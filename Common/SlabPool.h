@@ -0,0 +1,70 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <cstdlib>
+#include <new>
+
+#include "Common/CommonTypes.h"
+#include "Common/Log.h"
+
+// Hands out fixed size blocks from larger slabs, and recycles freed blocks through a free list.
+// Meant for objects that are created and destroyed a lot, from a single thread.
+// Slabs are never returned, so objects may safely be freed even during static destruction.
+template <size_t BlockSize, size_t BlocksPerSlab>
+class SlabPool {
+public:
+	void *Allocate(size_t size) {
+		_dbg_assert_msg_(G3D, size <= BlockSize, "SlabPool: Block too small");
+		if (!freeList_)
+			AddSlab();
+		FreeBlock *block = freeList_;
+		freeList_ = block->next;
+		return block;
+	}
+
+	void Free(void *ptr) {
+		if (!ptr)
+			return;
+		FreeBlock *block = (FreeBlock *)ptr;
+		block->next = freeList_;
+		freeList_ = block;
+	}
+
+private:
+	struct FreeBlock {
+		FreeBlock *next;
+	};
+
+	// Keep blocks aligned like malloc would.
+	enum : size_t {
+		ALIGN = sizeof(void *) * 2,
+		STRIDE = ((BlockSize < sizeof(FreeBlock) ? sizeof(FreeBlock) : BlockSize) + ALIGN - 1) & ~(ALIGN - 1),
+	};
+
+	void AddSlab() {
+		u8 *slab = (u8 *)malloc(STRIDE * BlocksPerSlab);
+		if (!slab)
+			throw std::bad_alloc();
+		// Push in reverse so allocations walk forward through the slab.
+		for (size_t i = BlocksPerSlab; i > 0; --i)
+			Free(slab + (i - 1) * STRIDE);
+	}
+
+	FreeBlock *freeList_ = nullptr;
+};
@@ -0,0 +1,191 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstring>
+
+#include "Common/BitScan.h"
+#include "Common/BitSet.h"
+#include "Common/Log.h"
+#include "Common/TLSFAllocator.h"
+
+TLSFAllocator::TLSFAllocator(uint32_t units) {
+	_assert_msg_(COMMON, units != 0 && units < FREE_BIT, "TLSFAllocator: Bad size %08x", units);
+	memset(slBitmap_, 0, sizeof(slBitmap_));
+	for (uint32_t fl = 0; fl < FL_COUNT; ++fl) {
+		for (uint32_t sl = 0; sl < SL_COUNT; ++sl) {
+			heads_[fl][sl] = INVALID;
+		}
+	}
+
+	nodes_.resize(units);
+	nodes_[0].prevPhys = INVALID;
+	InsertFree(0, units);
+	freeUnits_ = units;
+}
+
+void TLSFAllocator::MapSize(uint32_t size, uint32_t &fl, uint32_t &sl) {
+	if (size < SL_COUNT) {
+		// Small sizes each get their own bin.
+		fl = 0;
+		sl = size;
+	} else {
+		uint32_t log2 = 31 - clz32_nonzero(size);
+		fl = log2 - SL_BITS + 1;
+		sl = (size >> (log2 - SL_BITS)) - SL_COUNT;
+	}
+}
+
+uint32_t TLSFAllocator::FindFree(uint32_t size) const {
+	// Round up to the next bin, so any range in it (or a later bin) is big enough.
+	uint32_t rounded = size;
+	if (size >= SL_COUNT) {
+		uint32_t log2 = 31 - clz32_nonzero(size);
+		rounded += (1 << (log2 - SL_BITS)) - 1;
+	}
+
+	uint32_t fl, sl;
+	MapSize(rounded, fl, sl);
+	if (fl < FL_COUNT) {
+		uint32_t slMap = slBitmap_[fl] & (~0U << sl);
+		if (!slMap) {
+			uint32_t flMap = fl + 1 < FL_COUNT ? flBitmap_ & (~0U << (fl + 1)) : 0;
+			if (flMap) {
+				fl = LeastSignificantSetBit(flMap);
+				slMap = slBitmap_[fl];
+			}
+		}
+		if (slMap) {
+			return heads_[fl][LeastSignificantSetBit(slMap)];
+		}
+	}
+
+	// The only candidates left share the exact bin of size, so check them one by one.
+	MapSize(size, fl, sl);
+	for (uint32_t start = heads_[fl][sl]; start != INVALID; start = nodes_[start].nextFree) {
+		if (RangeSize(start) >= size)
+			return start;
+	}
+	return INVALID;
+}
+
+void TLSFAllocator::InsertFree(uint32_t start, uint32_t size) {
+	uint32_t fl, sl;
+	MapSize(size, fl, sl);
+
+	Node &node = nodes_[start];
+	node.size = size | FREE_BIT;
+	node.prevFree = INVALID;
+	node.nextFree = heads_[fl][sl];
+	if (node.nextFree != INVALID)
+		nodes_[node.nextFree].prevFree = start;
+	heads_[fl][sl] = start;
+	slBitmap_[fl] |= 1 << sl;
+	flBitmap_ |= 1 << fl;
+}
+
+void TLSFAllocator::RemoveFree(uint32_t start) {
+	uint32_t fl, sl;
+	MapSize(RangeSize(start), fl, sl);
+
+	Node &node = nodes_[start];
+	if (node.prevFree != INVALID)
+		nodes_[node.prevFree].nextFree = node.nextFree;
+	else
+		heads_[fl][sl] = node.nextFree;
+	if (node.nextFree != INVALID)
+		nodes_[node.nextFree].prevFree = node.prevFree;
+
+	if (heads_[fl][sl] == INVALID) {
+		slBitmap_[fl] &= ~(1 << sl);
+		if (!slBitmap_[fl])
+			flBitmap_ &= ~(1 << fl);
+	}
+	node.size &= ~FREE_BIT;
+}
+
+void TLSFAllocator::LinkNext(uint32_t start, uint32_t size) {
+	if (start + size < nodes_.size())
+		nodes_[start + size].prevPhys = start;
+}
+
+uint32_t TLSFAllocator::Allocate(uint32_t count, uint32_t align) {
+	_dbg_assert_msg_(COMMON, align != 0 && (align & (align - 1)) == 0, "TLSFAllocator: Alignment must be a power of 2");
+	if (count == 0 || count > freeUnits_)
+		return INVALID;
+
+	// Worst case, we need to skip align - 1 units to get to an aligned start.
+	uint32_t needed = count + align - 1;
+	if (needed < count)
+		return INVALID;
+	uint32_t block = FindFree(needed);
+	if (block == INVALID)
+		return INVALID;
+
+	RemoveFree(block);
+	uint32_t size = RangeSize(block);
+	uint32_t start = (block + align - 1) & ~(align - 1);
+	if (start != block) {
+		// Give the padding back.  The range before a free range is always allocated, so no merging.
+		uint32_t pad = start - block;
+		InsertFree(block, pad);
+		nodes_[start].prevPhys = block;
+		size -= pad;
+	}
+
+	if (size > count) {
+		uint32_t rest = start + count;
+		nodes_[rest].prevPhys = start;
+		InsertFree(rest, size - count);
+		LinkNext(rest, size - count);
+		size = count;
+	} else {
+		LinkNext(start, size);
+	}
+
+	nodes_[start].size = size;
+	freeUnits_ -= size;
+	return start;
+}
+
+void TLSFAllocator::Free(uint32_t start) {
+	_assert_msg_(COMMON, start < nodes_.size() && !IsFree(start), "TLSFAllocator: Double free or bad start %d", (int)start);
+
+	uint32_t size = RangeSize(start);
+	freeUnits_ += size;
+
+	uint32_t next = start + size;
+	if (next < nodes_.size() && IsFree(next)) {
+		RemoveFree(next);
+		size += RangeSize(next);
+	}
+
+	uint32_t prev = nodes_[start].prevPhys;
+	if (prev != INVALID && IsFree(prev)) {
+		RemoveFree(prev);
+		size += RangeSize(prev);
+		start = prev;
+	}
+
+	InsertFree(start, size);
+	LinkNext(start, size);
+}
+
+uint32_t TLSFAllocator::SizeOf(uint32_t start) const {
+	if (start >= nodes_.size() || IsFree(start))
+		return 0;
+	return RangeSize(start);
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Two level segregated fit (TLSF) allocator over an abstract range of units.
+// It never touches the memory it manages, so it can hand out offsets into GPU memory.
+// Free ranges are binned by size class with bitmaps over the bins, so allocating and freeing are O(1),
+// and neighbouring free ranges are merged right away, which keeps fragmentation low.
+// Not thread safe.
+class TLSFAllocator {
+public:
+	explicit TLSFAllocator(uint32_t units);
+
+	// Returns INVALID if there's no free range of count units starting at a multiple of align (a power of 2.)
+	uint32_t Allocate(uint32_t count, uint32_t align = 1);
+	// Crashes on a double or misfree.
+	void Free(uint32_t start);
+
+	// Size of the allocation at start, in units.
+	uint32_t SizeOf(uint32_t start) const;
+	uint32_t TotalUnits() const { return (uint32_t)nodes_.size(); }
+	uint32_t FreeUnits() const { return freeUnits_; }
+
+	static const uint32_t INVALID = 0xFFFFFFFF;
+
+private:
+	enum : uint32_t {
+		SL_BITS = 4,
+		SL_COUNT = 1 << SL_BITS,
+		FL_COUNT = 32,
+		FREE_BIT = 0x80000000,
+	};
+
+	// Only valid at the first unit of each range, free or allocated.
+	struct Node {
+		uint32_t size;
+		uint32_t prevPhys;
+		uint32_t nextFree;
+		uint32_t prevFree;
+	};
+
+	static void MapSize(uint32_t size, uint32_t &fl, uint32_t &sl);
+	uint32_t FindFree(uint32_t size) const;
+	void InsertFree(uint32_t start, uint32_t size);
+	void RemoveFree(uint32_t start);
+	void LinkNext(uint32_t start, uint32_t size);
+
+	bool IsFree(uint32_t start) const {
+		return (nodes_[start].size & FREE_BIT) != 0;
+	}
+	uint32_t RangeSize(uint32_t start) const {
+		return nodes_[start].size & ~FREE_BIT;
+	}
+
+	std::vector<Node> nodes_;
+	uint32_t heads_[FL_COUNT][SL_COUNT];
+	uint32_t slBitmap_[FL_COUNT];
+	uint32_t flBitmap_ = 0;
+	uint32_t freeUnits_ = 0;
+};
@@ -6,9 +6,29 @@
 std::unique_ptr<ThreadPool> GlobalThreadPool::pool;
 std::once_flag GlobalThreadPool::init_flag;
 
-void GlobalThreadPool::Loop(const std::function<void(int,int)>& loop, int lower, int upper) {
+void GlobalThreadPool::Loop(const std::function<void(int,int)>& loop, int lower, int upper, TaskPriority priority) {
 	std::call_once(init_flag, Inititialize);
-	pool->ParallelLoop(loop, lower, upper);
+	pool->ParallelLoop(loop, lower, upper, priority);
+}
+
+void GlobalThreadPool::Submit(std::function<void()> task, TaskGroup *group, TaskPriority priority, TaskGroup *after) {
+	std::call_once(init_flag, Inititialize);
+	pool->Submit(std::move(task), group, priority, after);
+}
+
+void GlobalThreadPool::Wait(TaskGroup &group) {
+	std::call_once(init_flag, Inititialize);
+	pool->Wait(group);
+}
+
+int GlobalThreadPool::GetNumThreads() {
+	std::call_once(init_flag, Inititialize);
+	return pool->GetNumThreads();
+}
+
+void GlobalThreadPool::SetMaxThreads(int maxThreads) {
+	std::call_once(init_flag, Inititialize);
+	pool->SetMaxThreads(maxThreads);
 }
 
 void GlobalThreadPool::Inititialize() {
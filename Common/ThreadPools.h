@@ -6,7 +6,15 @@ class GlobalThreadPool {
 public:
 	// will execute slices of "loop" from "lower" to "upper"
 	// in parallel on the global thread pool
-	static void Loop(const std::function<void(int,int)>& loop, int lower, int upper);
+	static void Loop(const std::function<void(int,int)>& loop, int lower, int upper, TaskPriority priority = TaskPriority::NORMAL);
+	// Runs task on the global thread pool, after everything in after if specified.
+	static void Submit(std::function<void()> task, TaskGroup *group, TaskPriority priority = TaskPriority::NORMAL, TaskGroup *after = nullptr);
+	// Helps run queued tasks until everything in group is done.
+	static void Wait(TaskGroup &group);
+
+	static int GetNumThreads();
+	// Caps the threads used by later loops, 0 to use them all again.
+	static void SetMaxThreads(int maxThreads);
 
 private:
 	static std::unique_ptr<ThreadPool> pool;
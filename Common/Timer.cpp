@@ -196,27 +196,41 @@ u64 Timer::GetLocalTimeSinceJan1970()
 // in the form 00:00:000.
 void Timer::GetTimeFormatted(char formattedTime[13])
 {
-	time_t sysTime;
-	struct tm * gmTime;
-	char tmp[13];
-
-	time(&sysTime);
-	gmTime = localtime(&sysTime);
-
-	strftime(tmp, 6, "%M:%S", gmTime);
+	s64 sec;
+	int ms;
+	GetTimeRaw(&sec, &ms);
+	GetTimeFormatted(formattedTime, sec, ms);
+}
 
-	// Now tack on the milliseconds
+void Timer::GetTimeRaw(s64 *sec, int *ms)
+{
 #ifdef _WIN32
 	struct timeb tp;
 	(void)::ftime(&tp);
-	snprintf(formattedTime, 13, "%s:%03i", tmp, tp.millitm);
+	*sec = (s64)tp.time;
+	*ms = tp.millitm;
 #else
 	struct timeval t;
 	(void)gettimeofday(&t, NULL);
-	snprintf(formattedTime, 13, "%s:%03d", tmp, (int)(t.tv_usec / 1000));
+	*sec = (s64)t.tv_sec;
+	*ms = (int)(t.tv_usec / 1000);
 #endif
 }
 
+void Timer::GetTimeFormatted(char formattedTime[13], s64 sec, int ms)
+{
+	time_t sysTime = (time_t)sec;
+	struct tm * gmTime;
+	char tmp[13];
+
+	gmTime = localtime(&sysTime);
+
+	strftime(tmp, 6, "%M:%S", gmTime);
+
+	// Now tack on the milliseconds
+	snprintf(formattedTime, 13, "%s:%03d", tmp, ms);
+}
+
 // Returns a timestamp with decimals for precise time comparisons
 // ----------------
 double Timer::GetDoubleTime()
@@ -43,6 +43,9 @@ class Timer
 	static double GetDoubleTime();
 
   static void GetTimeFormatted(char formattedTime[13]);
+	// Same as above, but split so the time can be taken on one thread and formatted on another.
+	static void GetTimeRaw(s64 *sec, int *ms);
+	static void GetTimeFormatted(char formattedTime[13], s64 sec, int ms);
 	std::string GetTimeElapsedFormatted() const;
 	u64 GetTimeElapsed() const;
 
@@ -269,6 +269,8 @@ void VulkanContext::DestroyInstance() {
 void VulkanContext::BeginFrame() {
 	FrameData *frame = &frame_[curFrame_];
 	// Process pending deletes.
+	if (frame->deleteList.DeletesDescriptorResources())
+		descriptorResourceGeneration_++;
 	frame->deleteList.PerformDeletes(device_);
 }
 
@@ -280,6 +282,26 @@ void VulkanContext::EndFrame() {
 	}
 }
 
+void VulkanContext::SetInflightFrames(int count) {
+	if (count < 1)
+		count = 1;
+	if (count > MAX_INFLIGHT_FRAMES)
+		count = MAX_INFLIGHT_FRAMES;
+	if (count == inflightFrames_)
+		return;
+
+	// Nothing may still be using the frames we're about to stop cycling through.
+	WaitUntilQueueIdle();
+	for (int i = 0; i < MAX_INFLIGHT_FRAMES; i++) {
+		if (frame_[i].deleteList.DeletesDescriptorResources())
+			descriptorResourceGeneration_++;
+		frame_[i].deleteList.PerformDeletes(device_);
+	}
+	inflightFrames_ = count;
+	curFrame_ = 0;
+	ILOG("Vulkan: Using %d frames in flight", inflightFrames_);
+}
+
 void VulkanContext::WaitUntilQueueIdle() {
 	// Should almost never be used
 	vkQueueWaitIdle(gfx_queue_);
@@ -580,6 +602,16 @@ void VulkanContext::ChooseDevice(int physical_device) {
 	if (deviceFeatures_.available.samplerAnisotropy) {
 		deviceFeatures_.enabled.samplerAnisotropy = true;
 	}
+	// Used for pre-compressed texture replacements.
+	if (deviceFeatures_.available.textureCompressionBC) {
+		deviceFeatures_.enabled.textureCompressionBC = true;
+	}
+	if (deviceFeatures_.available.textureCompressionETC2) {
+		deviceFeatures_.enabled.textureCompressionETC2 = true;
+	}
+	if (deviceFeatures_.available.textureCompressionASTC_LDR) {
+		deviceFeatures_.enabled.textureCompressionASTC_LDR = true;
+	}
 	// For easy wireframe mode, someday.
 	if (deviceFeatures_.available.fillModeNonSolid) {
 		deviceFeatures_.enabled.fillModeNonSolid = true;
@@ -1099,9 +1131,8 @@ bool VulkanContext::CreateShaderModule(const std::vector<uint32_t> &spirv, VkSha
 	}
 }
 
-void TransitionImageLayout2(VkCommandBuffer cmd, VkImage image, int baseMip, int numMipLevels, VkImageAspectFlags aspectMask,
+static VkImageMemoryBarrier MakeImageBarrier(VkImage image, int baseMip, int numMipLevels, VkImageAspectFlags aspectMask,
 	VkImageLayout oldImageLayout, VkImageLayout newImageLayout,
-	VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
 	VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask) {
 #ifdef VULKAN_USE_GENERAL_LAYOUT_FOR_COLOR
 	if (aspectMask == VK_IMAGE_ASPECT_COLOR_BIT) {
@@ -1133,9 +1164,39 @@ void TransitionImageLayout2(VkCommandBuffer cmd, VkImage image, int baseMip, int
 	image_memory_barrier.subresourceRange.layerCount = 1;  // We never use more than one layer, and old Mali drivers have problems with VK_REMAINING_ARRAY_LAYERS/VK_REMAINING_MIP_LEVELS.
 	image_memory_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 	image_memory_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	return image_memory_barrier;
+}
+
+void TransitionImageLayout2(VkCommandBuffer cmd, VkImage image, int baseMip, int numMipLevels, VkImageAspectFlags aspectMask,
+	VkImageLayout oldImageLayout, VkImageLayout newImageLayout,
+	VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
+	VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask) {
+	VkImageMemoryBarrier image_memory_barrier = MakeImageBarrier(image, baseMip, numMipLevels, aspectMask, oldImageLayout, newImageLayout, srcAccessMask, dstAccessMask);
 	vkCmdPipelineBarrier(cmd, srcStageMask, dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &image_memory_barrier);
 }
 
+void VulkanBarrier::TransitionImage(VkImage image, int baseMip, int numMipLevels, VkImageAspectFlags aspectMask,
+	VkImageLayout oldImageLayout, VkImageLayout newImageLayout,
+	VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
+	VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask) {
+	srcStageMask_ |= srcStageMask;
+	dstStageMask_ |= dstStageMask;
+	imageBarriers_.push_back(MakeImageBarrier(image, baseMip, numMipLevels, aspectMask, oldImageLayout, newImageLayout, srcAccessMask, dstAccessMask));
+}
+
+void VulkanBarrier::Flush(VkCommandBuffer cmd) {
+	if (!imageBarriers_.empty()) {
+		vkCmdPipelineBarrier(cmd, srcStageMask_, dstStageMask_, 0, 0, nullptr, 0, nullptr, (uint32_t)imageBarriers_.size(), imageBarriers_.data());
+	}
+	Clear();
+}
+
+void VulkanBarrier::Clear() {
+	imageBarriers_.clear();
+	srcStageMask_ = 0;
+	dstStageMask_ = 0;
+}
+
 EShLanguage FindLanguage(const VkShaderStageFlagBits shader_type) {
 	switch (shader_type) {
 	case VK_SHADER_STAGE_VERTEX_BIT:
@@ -81,6 +81,10 @@ class VulkanDeleteList {
 
 	void Take(VulkanDeleteList &del);
 	void PerformDeletes(VkDevice device);
+	// True if this will destroy objects that descriptor sets can refer to.
+	bool DeletesDescriptorResources() const {
+		return !imageViews_.empty() || !samplers_.empty() || !buffers_.empty();
+	}
 
 private:
 	std::vector<VkCommandPool> cmdPools_;
@@ -246,11 +250,19 @@ class VulkanContext {
 	int GetInflightFrames() const {
 		return inflightFrames_;
 	}
+	// Only call between frames, before the render manager is created.  Drains the queue.
+	void SetInflightFrames(int count);
 
 	int GetCurFrame() const {
 		return curFrame_;
 	}
 
+	// Bumped whenever image views, samplers or buffers are actually destroyed. Their handles can be
+	// reused after that, so descriptor sets cached by handle must be dropped when this changes.
+	uint32_t GetDescriptorResourceGeneration() const {
+		return descriptorResourceGeneration_;
+	}
+
 	VkSwapchainKHR GetSwapchain() const {
 		return swapchain_;
 	}
@@ -327,6 +339,7 @@ class VulkanContext {
 	};
 	FrameData frame_[MAX_INFLIGHT_FRAMES];
 	int curFrame_ = 0;
+	uint32_t descriptorResourceGeneration_ = 0;
 
 	// At the end of the frame, this is copied into the frame's delete list, so it can be processed
 	// the next time the frame comes around again.
@@ -353,6 +366,27 @@ void TransitionImageLayout2(VkCommandBuffer cmd, VkImage image, int baseMip, int
 	VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
 	VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask);
 
+// Collects image layout transitions so that many of them can go out in a single vkCmdPipelineBarrier.
+// The stage masks are merged, so only batch transitions that can wait for the same things.
+class VulkanBarrier {
+public:
+	void TransitionImage(VkImage image, int baseMip, int numMipLevels, VkImageAspectFlags aspectMask,
+		VkImageLayout oldImageLayout, VkImageLayout newImageLayout,
+		VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
+		VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask);
+
+	// Records all the collected transitions into cmd, if there are any.
+	void Flush(VkCommandBuffer cmd);
+	void Clear();
+
+	bool Empty() const { return imageBarriers_.empty(); }
+
+private:
+	VkPipelineStageFlags srcStageMask_ = 0;
+	VkPipelineStageFlags dstStageMask_ = 0;
+	std::vector<VkImageMemoryBarrier> imageBarriers_;
+};
+
 // GLSL compiler
 void init_glslang();
 void finalize_glslang();
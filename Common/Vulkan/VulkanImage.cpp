@@ -217,6 +217,14 @@ void VulkanTexture::EndCreate(VkCommandBuffer cmd, bool vertexTexture, VkImageLa
 		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
 }
 
+void VulkanTexture::EndCreate(VulkanBarrier &barrier, bool vertexTexture, VkImageLayout layout) {
+	barrier.TransitionImage(image_, 0, numMips_,
+		VK_IMAGE_ASPECT_COLOR_BIT,
+		layout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, vertexTexture ? VK_PIPELINE_STAGE_VERTEX_SHADER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
+
 void VulkanTexture::Touch() {
 	if (allocator_ && mem_ != VK_NULL_HANDLE) {
 		allocator_->Touch(mem_, offset_);
@@ -19,6 +19,7 @@
 // under the public domain.
 
 #include "Common/Log.h"
+#include "Common/MemoryUsage.h"
 #include "Common/Vulkan/VulkanMemory.h"
 #include "base/timeutil.h"
 #include "math/math_util.h"
@@ -74,20 +75,33 @@ bool VulkanPushBuffer::AddBuffer() {
 		return false;
 	}
 
+	info.allocSize = reqs.size;
+	MemoryUsage::Add(MemoryUsage::Category::PUSH_BUFFERS, info.allocSize);
+
 	buffers_.push_back(info);
 	buf_ = buffers_.size() - 1;
+	limit_ = size_;
 	return true;
 }
 
 void VulkanPushBuffer::Destroy(VulkanContext *vulkan) {
+	if (ring_ && writePtr_) {
+		Unmap();
+	}
 	for (BufInfo &info : buffers_) {
 		vulkan->Delete().QueueDeleteBuffer(info.buffer);
 		vulkan->Delete().QueueDeleteDeviceMemory(info.deviceMemory);
+		MemoryUsage::Sub(MemoryUsage::Category::PUSH_BUFFERS, info.allocSize);
 	}
 	buffers_.clear();
 }
 
 void VulkanPushBuffer::NextBuffer(size_t minSize) {
+	if (ring_) {
+		NextRingSpace(minSize);
+		return;
+	}
+
 	// First, unmap the current memory.
 	if (memoryPropertyMask_ & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
 		Unmap();
@@ -109,10 +123,82 @@ void VulkanPushBuffer::NextBuffer(size_t minSize) {
 
 	// Now, move to the next buffer and map it.
 	offset_ = 0;
+	limit_ = size_;
 	if (memoryPropertyMask_ & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
 		Map();
 }
 
+void VulkanPushBuffer::NextRingSpace(size_t minSize) {
+	size_t alignedSize = (minSize + 3) & ~3;
+	if (limit_ == size_ && alignedSize < ringTail_) {
+		// The start of the ring has been reclaimed, wrap around.
+		offset_ = 0;
+		limit_ = ringTail_;
+		return;
+	}
+
+	// Everything else is still in use by in-flight frames, so we have to grow. Those frames keep
+	// reading from the old buffer, which gets deleted once they're done with it.
+	ringGrowCount_++;
+	FlushRing();
+	Destroy(vulkan_);
+	size_ <<= 1;
+	while (size_ < alignedSize) {
+		size_ <<= 1;
+	}
+	bool res = AddBuffer();
+	assert(res);
+	INFO_LOG(G3D, "Push buffer ring full, grew to %d bytes", (int)size_);
+
+	offset_ = 0;
+	ringTail_ = 0;
+	ringFrameStart_ = 0;
+	for (size_t &end : ringFrameEnd_) {
+		end = 0;
+	}
+	Map();
+}
+
+void VulkanPushBuffer::BeginRingFrame(int frame) {
+	if (!ring_) {
+		_dbg_assert_(G3D, buffers_.size() == 1 && !writePtr_);
+		ring_ = true;
+		Map();
+	}
+
+	// This frame slot's fence has been waited on, so everything after what it used last time is done.
+	ringFrame_ = frame;
+	ringTail_ = ringFrameEnd_[frame];
+	if (ringTail_ == offset_) {
+		// No other frame has used anything since, so start over from the beginning.
+		for (size_t &end : ringFrameEnd_) {
+			if (end == offset_)
+				end = 0;
+		}
+		offset_ = 0;
+		ringTail_ = 0;
+	}
+	limit_ = offset_ >= ringTail_ ? size_ : ringTail_;
+	ringFrameStart_ = offset_;
+}
+
+void VulkanPushBuffer::EndRingFrame() {
+	_dbg_assert_(G3D, ring_);
+	ringFrameEnd_[ringFrame_] = offset_;
+	ringFrameUsage_ = offset_ >= ringFrameStart_ ? offset_ - ringFrameStart_ : size_ - ringFrameStart_ + offset_;
+	FlushRing();
+}
+
+void VulkanPushBuffer::FlushRing() {
+	if ((memoryPropertyMask_ & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0) {
+		VkMappedMemoryRange range{ VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE };
+		range.offset = 0;
+		range.size = VK_WHOLE_SIZE;
+		range.memory = buffers_[buf_].deviceMemory;
+		vkFlushMappedMemoryRanges(vulkan_->GetDevice(), 1, &range);
+	}
+}
+
 void VulkanPushBuffer::Defragment(VulkanContext *vulkan) {
 	if (buffers_.size() <= 1) {
 		return;
@@ -145,7 +231,7 @@ void VulkanPushBuffer::Map() {
 void VulkanPushBuffer::Unmap() {
 	_dbg_assert_(G3D, writePtr_ != 0);
 
-	if ((memoryPropertyMask_ & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0) {
+	if ((memoryPropertyMask_ & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0 && !ring_) {
 		VkMappedMemoryRange range{ VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE };
 		range.offset = 0;
 		range.size = offset_;
@@ -158,10 +244,16 @@ void VulkanPushBuffer::Unmap() {
 }
 
 VulkanDeviceAllocator::VulkanDeviceAllocator(VulkanContext *vulkan, size_t minSlabSize, size_t maxSlabSize)
-	: vulkan_(vulkan), minSlabSize_(minSlabSize), maxSlabSize_(maxSlabSize) {
+	: vulkan_(vulkan), minSlabSize_(minSlabSize), initialSlabSize_(minSlabSize), maxSlabSize_(maxSlabSize) {
 	assert((minSlabSize_ & (SLAB_GRAIN_SIZE - 1)) == 0);
 }
 
+void VulkanDeviceAllocator::SetLowMemory() {
+	lowMemory_ = true;
+	// Smaller slabs are more likely to become empty, and then they can be freed.
+	minSlabSize_ = initialSlabSize_;
+}
+
 VulkanDeviceAllocator::~VulkanDeviceAllocator() {
 	assert(destroyed_);
 	assert(slabs_.empty());
@@ -183,6 +275,7 @@ void VulkanDeviceAllocator::Destroy() {
 
 		assert(slab.deviceMemory);
 		vulkan_->Delete().QueueDeleteDeviceMemory(slab.deviceMemory);
+		MemoryUsage::Sub(MemoryUsage::Category::VULKAN_DEVICE_MEMORY, (s64)slab.usage.size() << SLAB_GRAIN_SHIFT);
 	}
 	slabs_.clear();
 	destroyed_ = true;
@@ -203,24 +296,24 @@ size_t VulkanDeviceAllocator::Allocate(const VkMemoryRequirements &reqs, VkDevic
 	size_t blocks = (size_t)((size + SLAB_GRAIN_SIZE - 1) >> SLAB_GRAIN_SHIFT);
 
 	const size_t numSlabs = slabs_.size();
-	for (size_t i = 0; i < numSlabs; ++i) {
-		// We loop starting at the last successful allocation.
-		// This helps us "creep forward", and also spend less time allocating.
-		const size_t actualSlab = (lastSlab_ + i) % numSlabs;
-		Slab &slab = slabs_[actualSlab];
-		if (slab.memoryTypeIndex != memoryTypeIndex)
-			continue;
-		size_t start = slab.nextFree;
-
-		while (start < slab.usage.size()) {
-			start = (start + align - 1) & ~(align - 1);
-			if (AllocateFromSlab(slab, start, blocks, tag)) {
+	// Draining slabs are only used as a last resort before allocating a new slab.
+	for (int pass = 0; pass < 2; ++pass) {
+		for (size_t i = 0; i < numSlabs; ++i) {
+			// We loop starting at the last successful allocation.
+			// This spreads allocations out a bit, and usually hits a slab with room first.
+			const size_t actualSlab = (lastSlab_ + i) % numSlabs;
+			Slab &slab = slabs_[actualSlab];
+			if (slab.memoryTypeIndex != memoryTypeIndex || slab.draining != (pass == 1))
+				continue;
+
+			size_t start;
+			if (AllocateFromSlab(slab, start, blocks, align, tag)) {
 				// Allocated?  Great, let's return right away.
 				*deviceMemory = slab.deviceMemory;
 				lastSlab_ = actualSlab;
 				return start << SLAB_GRAIN_SHIFT;
 			}
-		} 
+		}
 	}
 
 	// Okay, we couldn't fit it into any existing slabs.  We need a new one.
@@ -230,8 +323,8 @@ size_t VulkanDeviceAllocator::Allocate(const VkMemoryRequirements &reqs, VkDevic
 
 	// Guaranteed to be the last one, unless it failed to allocate.
 	Slab &slab = slabs_[slabs_.size() - 1];
-	size_t start = 0;
-	if (AllocateFromSlab(slab, start, blocks, tag)) {
+	size_t start;
+	if (AllocateFromSlab(slab, start, blocks, align, tag)) {
 		*deviceMemory = slab.deviceMemory;
 		lastSlab_ = slabs_.size() - 1;
 		return start << SLAB_GRAIN_SHIFT;
@@ -241,37 +334,23 @@ size_t VulkanDeviceAllocator::Allocate(const VkMemoryRequirements &reqs, VkDevic
 	return ALLOCATE_FAILED;
 }
 
-bool VulkanDeviceAllocator::AllocateFromSlab(Slab &slab, size_t &start, size_t blocks, const std::string &tag) {
+bool VulkanDeviceAllocator::AllocateFromSlab(Slab &slab, size_t &start, size_t blocks, size_t align, const std::string &tag) {
 	assert(!destroyed_);
-	bool matched = true;
 
-	if (start + blocks > slab.usage.size()) {
-		start = slab.usage.size();
+	if (blocks > slab.usage.size()) {
 		return false;
 	}
 
-	for (size_t i = 0; i < blocks; ++i) {
-		if (slab.usage[start + i]) {
-			// If we just ran into one, there's probably an allocation size.
-			auto it = slab.allocSizes.find(start + i);
-			if (it != slab.allocSizes.end()) {
-				start += i + it->second;
-			} else {
-				// We don't know how big it is, so just skip to the next one.
-				start += i + 1;
-			}
-			return false;
-		}
+	uint32_t found = slab.allocator->Allocate((uint32_t)blocks, (uint32_t)align);
+	if (found == TLSFAllocator::INVALID) {
+		return false;
 	}
+	start = found;
 
-	// Okay, this run is good.  Actually mark it.
+	// The usage map is only kept for the debug visualizer and validation.
 	for (size_t i = 0; i < blocks; ++i) {
 		slab.usage[start + i] = 1;
 	}
-	slab.nextFree = start + blocks;
-	if (slab.nextFree >= slab.usage.size()) {
-		slab.nextFree = 0;
-	}
 
 	// Remember the size so we can free.
 	slab.allocSizes[start] = blocks;
@@ -374,13 +453,9 @@ void VulkanDeviceAllocator::ExecuteFree(FreeInfo *userdata) {
 			for (size_t i = 0; i < size; ++i) {
 				slab.usage[start + i] = 0;
 			}
+			slab.allocator->Free((uint32_t)start);
 			slab.allocSizes.erase(it);
 			slab.totalUsage -= size;
-
-			// Allow reusing.
-			if (slab.nextFree > start) {
-				slab.nextFree = start;
-			}
 		} else {
 			// Ack, a double free?
 			_assert_msg_(G3D, false, "Double free? Block missing at offset %d", (int)userdata->offset);
@@ -400,7 +475,7 @@ void VulkanDeviceAllocator::ExecuteFree(FreeInfo *userdata) {
 
 bool VulkanDeviceAllocator::AllocateSlab(VkDeviceSize minBytes, int memoryTypeIndex) {
 	assert(!destroyed_);
-	if (!slabs_.empty() && minSlabSize_ < maxSlabSize_) {
+	if (!slabs_.empty() && minSlabSize_ < maxSlabSize_ && !lowMemory_) {
 		// We're allocating an additional slab, so rachet up its size.
 		// TODO: Maybe should not do this when we are allocating a new slab due to memoryTypeIndex not matching?
 		minSlabSize_ <<= 1;
@@ -428,6 +503,9 @@ bool VulkanDeviceAllocator::AllocateSlab(VkDeviceSize minBytes, int memoryTypeIn
 	slab.memoryTypeIndex = memoryTypeIndex;
 	slab.deviceMemory = deviceMemory;
 	slab.usage.resize((size_t)(alloc.allocationSize >> SLAB_GRAIN_SHIFT));
+	slab.allocator.reset(new TLSFAllocator((uint32_t)slab.usage.size()));
+	slab.totalUsage = 0;
+	MemoryUsage::Add(MemoryUsage::Category::VULKAN_DEVICE_MEMORY, alloc.allocationSize);
 
 	return true;
 }
@@ -469,6 +547,8 @@ void VulkanDeviceAllocator::Decimate() {
 		ReportOldUsage();
 	}
 
+	MarkDrainingSlabs();
+
 	for (size_t i = 0; i < slabs_.size(); ++i) {
 		// Go backwards.  This way, we keep the largest free slab.
 		// We do this here (instead of the for) since size_t is unsigned.
@@ -476,27 +556,10 @@ void VulkanDeviceAllocator::Decimate() {
 		auto &slab = slabs_[index];
 
 		if (!slab.allocSizes.empty()) {
-			size_t usagePercent = 100 * slab.totalUsage / slab.usage.size();
-			size_t freeNextPercent = 100 * slab.nextFree / slab.usage.size();
-
-			// This may mean we're going to leave an allocation hanging.  Reset nextFree instead.
-			if (freeNextPercent >= 100 - usagePercent) {
-				size_t newFree = 0;
-				while (newFree < slab.usage.size()) {
-					auto it = slab.allocSizes.find(newFree);
-					if (it == slab.allocSizes.end()) {
-						break;
-					}
-
-					newFree += it->second;
-				}
-
-				slab.nextFree = newFree;
-			}
 			continue;
 		}
 
-		if (!foundFree) {
+		if (!foundFree && !lowMemory_ && !slab.draining) {
 			// Let's allow one free slab, so we have room.
 			foundFree = true;
 			continue;
@@ -504,9 +567,38 @@ void VulkanDeviceAllocator::Decimate() {
 
 		// Okay, let's free this one up.
 		vulkan_->Delete().QueueDeleteDeviceMemory(slab.deviceMemory);
+		MemoryUsage::Sub(MemoryUsage::Category::VULKAN_DEVICE_MEMORY, (s64)slab.usage.size() << SLAB_GRAIN_SHIFT);
 		slabs_.erase(slabs_.begin() + index);
 
 		// Let's check the next one, which is now in this same slot.
 		--i;
 	}
 }
+
+void VulkanDeviceAllocator::MarkDrainingSlabs() {
+	// We can't move allocations around, since they're bound to images.  Instead, to compact,
+	// we stop allocating from slabs that are mostly empty when the rest can hold what's in them.
+	// As their contents get freed, they empty out and Decimate() can release them.
+	static const size_t DRAIN_USAGE_PERCENT = 25;
+
+	for (Slab &slab : slabs_) {
+		if (slab.allocSizes.empty()) {
+			// Nothing left to wait on, this one is either kept or freed.
+			continue;
+		}
+		size_t usagePercent = 100 * slab.totalUsage / slab.usage.size();
+		if (!slab.draining && usagePercent >= DRAIN_USAGE_PERCENT) {
+			continue;
+		}
+
+		size_t freeElsewhere = 0;
+		for (const Slab &other : slabs_) {
+			if (&other != &slab && !other.draining && other.memoryTypeIndex == slab.memoryTypeIndex) {
+				freeElsewhere += other.allocator->FreeUnits();
+			}
+		}
+		// Leave some slack, since free space in the other slabs is likely fragmented.
+		// This also stops draining if the other slabs have filled up in the meantime.
+		slab.draining = freeElsewhere >= slab.totalUsage * 2;
+	}
+}
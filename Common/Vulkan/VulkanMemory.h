@@ -1,7 +1,9 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 #include <unordered_map>
+#include "Common/TLSFAllocator.h"
 #include "Common/Vulkan/VulkanContext.h"
 
 // VulkanMemory
@@ -14,11 +16,14 @@
 // and alternate on each frame. Make sure not to reset until the fence from the last time you used it
 // has completed.
 //
+// Alternatively, a single one can be used as a ring buffer by all in-flight frames, see BeginRingFrame.
+//
 // TODO: Make it possible to suballocate pushbuffers from a large DeviceMemory block.
 class VulkanPushBuffer {
 	struct BufInfo {
 		VkBuffer buffer;
 		VkDeviceMemory deviceMemory;
+		VkDeviceSize allocSize;
 	};
 
 public:
@@ -34,6 +39,7 @@ class VulkanPushBuffer {
 
 	// Needs context in case of defragment.
 	void Begin(VulkanContext *vulkan) {
+		_dbg_assert_(G3D, !ring_);
 		buf_ = 0;
 		offset_ = 0;
 		// Note: we must defrag because some buffers may be smaller than size_.
@@ -56,13 +62,23 @@ class VulkanPushBuffer {
 
 	void Unmap();
 
+	// Ring mode: the buffer stays mapped, and space is reclaimed from a frame slot once its fence has
+	// been waited on, so no Map/Unmap or new buffers are needed unless the ring runs full mid-frame.
+	// Call these instead of Begin/End, from the start of the frame slot to the end.
+	void BeginRingFrame(int frame);
+	void EndRingFrame();
+
+	// Bytes used by the last ring frame, and how many times the ring had to grow.
+	size_t GetRingFrameUsage() const { return ringFrameUsage_; }
+	int GetRingGrowCount() const { return ringGrowCount_; }
+
 	// When using the returned memory, make sure to bind the returned vkbuf.
 	// This will later allow for handling overflow correctly.
 	size_t Allocate(size_t numBytes, VkBuffer *vkbuf) {
 		size_t out = offset_;
 		offset_ += (numBytes + 3) & ~3;  // Round up to 4 bytes.
 
-		if (offset_ >= size_) {
+		if (offset_ >= limit_) {
 			NextBuffer(numBytes);
 			out = offset_;
 			offset_ += (numBytes + 3) & ~3;
@@ -112,7 +128,9 @@ class VulkanPushBuffer {
 private:
 	bool AddBuffer();
 	void NextBuffer(size_t minSize);
+	void NextRingSpace(size_t minSize);
 	void Defragment(VulkanContext *vulkan);
+	void FlushRing();
 
 	VulkanContext *vulkan_;
 	VkMemoryPropertyFlags memoryPropertyMask_;
@@ -121,8 +139,19 @@ class VulkanPushBuffer {
 	size_t buf_ = 0;
 	size_t offset_ = 0;
 	size_t size_ = 0;
+	// Where the current buffer (or free part of the ring) ends.
+	size_t limit_ = 0;
 	uint8_t *writePtr_ = nullptr;
 	VkBufferUsageFlags usage_;
+
+	bool ring_ = false;
+	int ringFrame_ = 0;
+	// Oldest byte still in use by an in-flight frame.
+	size_t ringTail_ = 0;
+	size_t ringFrameStart_ = 0;
+	size_t ringFrameEnd_[VulkanContext::MAX_INFLIGHT_FRAMES]{};
+	size_t ringFrameUsage_ = 0;
+	int ringGrowCount_ = 0;
 };
 
 // VulkanDeviceAllocator
@@ -146,6 +175,9 @@ class VulkanDeviceAllocator {
 	void End() {
 	}
 
+	// From now on, release every empty slab (normally one is kept around), and keep new slabs small.
+	void SetLowMemory();
+
 	// May return ALLOCATE_FAILED if the allocation fails.
 	size_t Allocate(const VkMemoryRequirements &reqs, VkDeviceMemory *deviceMemory, const std::string &tag);
 
@@ -186,8 +218,10 @@ class VulkanDeviceAllocator {
 		std::vector<uint8_t> usage;
 		std::unordered_map<size_t, size_t> allocSizes;
 		std::unordered_map<size_t, UsageInfo> tags;
-		size_t nextFree;
+		std::unique_ptr<TLSFAllocator> allocator;
 		size_t totalUsage;
+		// Mostly empty, so we stop allocating from it until it's empty and can be freed.
+		bool draining = false;
 
 		size_t Size() {
 			return usage.size() * SLAB_GRAIN_SIZE;
@@ -210,8 +244,9 @@ class VulkanDeviceAllocator {
 	}
 
 	bool AllocateSlab(VkDeviceSize minBytes, int memoryTypeIndex);
-	bool AllocateFromSlab(Slab &slab, size_t &start, size_t blocks, const std::string &tag);
+	bool AllocateFromSlab(Slab &slab, size_t &start, size_t blocks, size_t align, const std::string &tag);
 	void Decimate();
+	void MarkDrainingSlabs();
 	void DoTouch(VkDeviceMemory deviceMemory, size_t offset);
 	void ExecuteFree(FreeInfo *userdata);
 	void ReportOldUsage();
@@ -220,6 +255,8 @@ class VulkanDeviceAllocator {
 	std::vector<Slab> slabs_;
 	size_t lastSlab_ = 0;
 	size_t minSlabSize_;
+	const size_t initialSlabSize_;
 	const size_t maxSlabSize_;
+	bool lowMemory_ = false;
 	bool destroyed_ = false;
 };
@@ -1849,6 +1849,23 @@ void XEmitter::PSHUFLW(X64Reg regOp, OpArg arg, u8 shuffle)   {WriteSSEOp(0xF2,
 void XEmitter::PSHUFHW(X64Reg regOp, OpArg arg, u8 shuffle)   {WriteSSEOp(0xF3, 0x70, regOp, arg, 1); Write8(shuffle);}
 
 // VEX
+void XEmitter::VADDSS(X64Reg regOp1, X64Reg regOp2, OpArg arg)   {WriteAVXOp(0xF3, sseADD, regOp1, regOp2, arg);}
+void XEmitter::VSUBSS(X64Reg regOp1, X64Reg regOp2, OpArg arg)   {WriteAVXOp(0xF3, sseSUB, regOp1, regOp2, arg);}
+void XEmitter::VMULSS(X64Reg regOp1, X64Reg regOp2, OpArg arg)   {WriteAVXOp(0xF3, sseMUL, regOp1, regOp2, arg);}
+void XEmitter::VDIVSS(X64Reg regOp1, X64Reg regOp2, OpArg arg)   {WriteAVXOp(0xF3, sseDIV, regOp1, regOp2, arg);}
+void XEmitter::VADDPS(X64Reg regOp1, X64Reg regOp2, OpArg arg)   {WriteAVXOp(0x00, sseADD, regOp1, regOp2, arg);}
+void XEmitter::VSUBPS(X64Reg regOp1, X64Reg regOp2, OpArg arg)   {WriteAVXOp(0x00, sseSUB, regOp1, regOp2, arg);}
+void XEmitter::VMULPS(X64Reg regOp1, X64Reg regOp2, OpArg arg)   {WriteAVXOp(0x00, sseMUL, regOp1, regOp2, arg);}
+void XEmitter::VDIVPS(X64Reg regOp1, X64Reg regOp2, OpArg arg)   {WriteAVXOp(0x00, sseDIV, regOp1, regOp2, arg);}
+void XEmitter::VSHUFPS(X64Reg regOp1, X64Reg regOp2, OpArg arg, u8 shuffle) {WriteAVXOp(0x00, sseSHUF, regOp1, regOp2, arg, 1); Write8(shuffle);}
+void XEmitter::VUNPCKLPS(X64Reg regOp1, X64Reg regOp2, OpArg arg){WriteAVXOp(0x00, 0x14, regOp1, regOp2, arg);}
+void XEmitter::VUNPCKHPS(X64Reg regOp1, X64Reg regOp2, OpArg arg){WriteAVXOp(0x00, 0x15, regOp1, regOp2, arg);}
+void XEmitter::VDPPS(X64Reg regOp1, X64Reg regOp2, OpArg arg, u8 mask) {WriteAVXOp(0x66, 0x3A40, regOp1, regOp2, arg, 1); Write8(mask);}
+void XEmitter::VBROADCASTSS(X64Reg regOp, OpArg arg) {
+	_assert_msg_(DYNA_REC, !arg.IsSimpleReg() || cpu_info.bAVX2, "VBROADCASTSS from a register requires AVX2");
+	WriteAVXOp(0x66, 0x3818, regOp, arg);
+}
+
 void XEmitter::VADDSD(X64Reg regOp1, X64Reg regOp2, OpArg arg)   {WriteAVXOp(0xF2, sseADD, regOp1, regOp2, arg);}
 void XEmitter::VSUBSD(X64Reg regOp1, X64Reg regOp2, OpArg arg)   {WriteAVXOp(0xF2, sseSUB, regOp1, regOp2, arg);}
 void XEmitter::VMULSD(X64Reg regOp1, X64Reg regOp2, OpArg arg)   {WriteAVXOp(0xF2, sseMUL, regOp1, regOp2, arg);}
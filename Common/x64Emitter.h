@@ -888,6 +888,21 @@ class XEmitter
 	inline void ROUNDZEROPD(X64Reg dest, OpArg arg) { ROUNDPD(dest, arg, FROUND_ZERO); }
 
 	// AVX
+	void VADDSS(X64Reg regOp1, X64Reg regOp2, OpArg arg);
+	void VSUBSS(X64Reg regOp1, X64Reg regOp2, OpArg arg);
+	void VMULSS(X64Reg regOp1, X64Reg regOp2, OpArg arg);
+	void VDIVSS(X64Reg regOp1, X64Reg regOp2, OpArg arg);
+	void VADDPS(X64Reg regOp1, X64Reg regOp2, OpArg arg);
+	void VSUBPS(X64Reg regOp1, X64Reg regOp2, OpArg arg);
+	void VMULPS(X64Reg regOp1, X64Reg regOp2, OpArg arg);
+	void VDIVPS(X64Reg regOp1, X64Reg regOp2, OpArg arg);
+	void VSHUFPS(X64Reg regOp1, X64Reg regOp2, OpArg arg, u8 shuffle);
+	void VUNPCKLPS(X64Reg regOp1, X64Reg regOp2, OpArg arg);
+	void VUNPCKHPS(X64Reg regOp1, X64Reg regOp2, OpArg arg);
+	void VDPPS(X64Reg regOp1, X64Reg regOp2, OpArg arg, u8 mask);
+	// Only memory sources are allowed without AVX2.
+	void VBROADCASTSS(X64Reg regOp, OpArg arg);
+
 	void VADDSD(X64Reg regOp1, X64Reg regOp2, OpArg arg);
 	void VSUBSD(X64Reg regOp1, X64Reg regOp2, OpArg arg);
 	void VMULSD(X64Reg regOp1, X64Reg regOp2, OpArg arg);
@@ -8,9 +8,14 @@
 #define __STDC_CONSTANT_MACROS 1
 #endif
 
-#include <string>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <mutex>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 #ifdef USE_FFMPEG
 
@@ -23,6 +28,8 @@ extern "C" {
 
 #endif
 
+#include "thread/threadutil.h"
+
 #include "Common/FileUtil.h"
 #include "Common/MsgHandler.h"
 #include "Common/ColorConv.h"
@@ -60,7 +67,23 @@ static bool s_start_dumping = false;
 static int s_current_width;
 static int s_current_height;
 static int s_file_index = 0;
-static GPUDebugBuffer buf;
+
+// Enough to ride out a slow frame or two from the encoder.  Past that, AddFrame() waits, so no frames are lost.
+static const size_t MAX_QUEUED_FRAMES = 4;
+
+struct QueuedFrame {
+	GPUDebugBuffer buf;
+	u32 w;
+	u32 h;
+};
+
+static std::thread s_encode_thread;
+static std::mutex s_queue_lock;
+static std::condition_variable s_queue_cond;
+static std::deque<QueuedFrame> s_queue;
+// Buffers the encoder is done with, kept to avoid reallocating every frame.
+static std::vector<GPUDebugBuffer> s_free_buffers;
+static bool s_encode_active = false;
 
 static void InitAVCodec() {
 	static bool first_run = true;
@@ -73,6 +96,16 @@ static void InitAVCodec() {
 }
 
 bool AVIDump::Start(int w, int h)
+{
+	bool success = StartFile(w, h);
+	if (success) {
+		s_encode_active = true;
+		s_encode_thread = std::thread(&AVIDump::EncodeThread);
+	}
+	return success;
+}
+
+bool AVIDump::StartFile(int w, int h)
 {
 	s_width = w;
 	s_height = h;
@@ -169,17 +202,62 @@ static void PreparePacket(AVPacket* pkt) {
 
 void AVIDump::AddFrame()
 {
-	u32 w = 0;
-	u32 h = 0;
+	if (!s_encode_active)
+		return;
+
+	QueuedFrame frame{};
+	{
+		std::unique_lock<std::mutex> guard(s_queue_lock);
+		s_queue_cond.wait(guard, [] { return s_queue.size() < MAX_QUEUED_FRAMES; });
+		if (!s_free_buffers.empty()) {
+			frame.buf = std::move(s_free_buffers.back());
+			s_free_buffers.pop_back();
+		}
+	}
+
 	if (g_Config.bDumpVideoOutput) {
-		gpuDebug->GetOutputFramebuffer(buf);
-		w = buf.GetStride();
-		h = buf.GetHeight();
+		gpuDebug->GetOutputFramebuffer(frame.buf);
+		frame.w = frame.buf.GetStride();
+		frame.h = frame.buf.GetHeight();
 	} else {
-		gpuDebug->GetCurrentFramebuffer(buf, GPU_DBG_FRAMEBUF_RENDER);
-		w = PSP_CoreParameter().renderWidth;
-		h = PSP_CoreParameter().renderHeight;
+		gpuDebug->GetCurrentFramebuffer(frame.buf, GPU_DBG_FRAMEBUF_RENDER);
+		frame.w = PSP_CoreParameter().renderWidth;
+		frame.h = PSP_CoreParameter().renderHeight;
 	}
+
+	{
+		std::lock_guard<std::mutex> guard(s_queue_lock);
+		s_queue.push_back(std::move(frame));
+	}
+	s_queue_cond.notify_all();
+}
+
+void AVIDump::EncodeThread()
+{
+	setCurrentThreadName("AVIDump");
+	setCurrentThreadRole(ThreadRole::BACKGROUND);
+
+	std::unique_lock<std::mutex> guard(s_queue_lock);
+	while (true) {
+		s_queue_cond.wait(guard, [] { return !s_queue.empty() || !s_encode_active; });
+		// Finish everything queued before stopping.
+		if (s_queue.empty())
+			break;
+
+		QueuedFrame frame = std::move(s_queue.front());
+		s_queue.pop_front();
+		guard.unlock();
+		s_queue_cond.notify_all();
+
+		EncodeFrame(frame.buf, frame.w, frame.h);
+
+		guard.lock();
+		s_free_buffers.push_back(std::move(frame.buf));
+	}
+}
+
+void AVIDump::EncodeFrame(const GPUDebugBuffer &buf, u32 w, u32 h)
+{
 	CheckResolution(w, h);
 	u8 *flipbuffer = nullptr;
 	const u8 *buffer = ConvertBufferToScreenshot(buf, false, flipbuffer, w, h);
@@ -236,6 +314,19 @@ void AVIDump::AddFrame()
 }
 
 void AVIDump::Stop() {
+	{
+		std::lock_guard<std::mutex> guard(s_queue_lock);
+		s_encode_active = false;
+	}
+	s_queue_cond.notify_all();
+	if (s_encode_thread.joinable())
+		s_encode_thread.join();
+	s_free_buffers.clear();
+
+	StopFile();
+}
+
+void AVIDump::StopFile() {
 #ifdef USE_FFMPEG
 
 	av_write_trailer(s_format_context);
@@ -287,9 +378,9 @@ void AVIDump::CheckResolution(int width, int height) {
 	if ((width != s_current_width || height != s_current_height) && (width > 0 && height > 0))
 	{
 		int temp_file_index = s_file_index;
-		Stop();
+		StopFile();
 		s_file_index = temp_file_index + 1;
-		Start(width, height);
+		StartFile(width, height);
 		s_current_width = width;
 		s_current_height = height;
 	}
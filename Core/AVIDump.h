@@ -7,12 +7,19 @@
 
 #include "Common/CommonTypes.h"
 
+struct GPUDebugBuffer;
+
+// Frames are read back by AddFrame(), but converted and encoded on a thread of their own.
 class AVIDump
 {
 private:
+	static bool StartFile(int w, int h);
+	static void StopFile();
 	static bool CreateAVI();
 	static void CloseFile();
 	static void CheckResolution(int width, int height);
+	static void EncodeFrame(const GPUDebugBuffer &buf, u32 w, u32 h);
+	static void EncodeThread();
 
 public:
 	static bool Start(int w, int h);
@@ -68,6 +68,9 @@ void Compatibility::CheckSettings(IniFile &iniFile, const std::string &gameID) {
 	CheckSetting(iniFile, gameID, "MoreAccurateVMMUL", &flags_.MoreAccurateVMMUL);
 	CheckSetting(iniFile, gameID, "ForceSoftwareRenderer", &flags_.ForceSoftwareRenderer);
 	CheckSetting(iniFile, gameID, "DarkStalkersPresentHack", &flags_.DarkStalkersPresentHack);
+	CheckSetting(iniFile, gameID, "SyncTextureScaling", &flags_.SyncTextureScaling);
+	CheckSetting(iniFile, gameID, "AsyncPipelineCreation", &flags_.AsyncPipelineCreation);
+	CheckSetting(iniFile, gameID, "AsyncFramebufferReadback", &flags_.AsyncFramebufferReadback);
 }
 
 void Compatibility::CheckSetting(IniFile &iniFile, const std::string &gameID, const char *option, bool *flag) {
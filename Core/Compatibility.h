@@ -68,6 +68,9 @@ struct CompatFlags {
 	bool MoreAccurateVMMUL;
 	bool ForceSoftwareRenderer;
 	bool DarkStalkersPresentHack;
+	bool SyncTextureScaling;
+	bool AsyncPipelineCreation;
+	bool AsyncFramebufferReadback;
 };
 
 class IniFile;
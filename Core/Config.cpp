@@ -30,6 +30,7 @@
 #include "net/http_client.h"
 #include "util/text/parsers.h"
 #include "net/url.h"
+#include "thread/threadutil.h"
 
 #include "Common/CPUDetect.h"
 #include "Common/FileUtil.h"
@@ -491,15 +492,33 @@ static bool DefaultSasThread() {
 	return cpu_info.num_cores > 1;
 }
 
+static int DefaultThreadPlacement() {
+#if PPSSPP_PLATFORM(ANDROID)
+	// Nearly all of these are big.LITTLE, and the scheduler is often slow to move the emu thread up.
+	return (int)ThreadPlacement::AUTO;
+#else
+	return (int)ThreadPlacement::OFF;
+#endif
+}
+
 static ConfigSetting cpuSettings[] = {
 	ReportedConfigSetting("CPUCore", &g_Config.iCpuCore, &DefaultCpuCore, true, true),
 	ReportedConfigSetting("SeparateSASThread", &g_Config.bSeparateSASThread, &DefaultSasThread, true, true),
+	ReportedConfigSetting("SeparateGEThread", &g_Config.bSeparateGEThread, false, true, true),
 	ReportedConfigSetting("IOTimingMethod", &g_Config.iIOTimingMethod, IOTIMING_FAST, true, true),
+	ConfigSetting("UMDReadAheadKB", &g_Config.iUMDReadAheadKB, 256, true, true),
 	ConfigSetting("FastMemoryAccess", &g_Config.bFastMemory, true, true, true),
+	ConfigSetting("HugePages", &g_Config.bHugePages, false, true, true),
+	ConfigSetting("ThreadPlacement", &g_Config.iThreadPlacement, &DefaultThreadPlacement, true, false),
 	ReportedConfigSetting("FuncReplacements", &g_Config.bFuncReplacements, true, true, true),
 	ConfigSetting("HideSlowWarnings", &g_Config.bHideSlowWarnings, false, true, false),
 	ConfigSetting("HideStateWarnings", &g_Config.bHideStateWarnings, false, true, false),
 	ConfigSetting("PreloadFunctions", &g_Config.bPreloadFunctions, false, true, true),
+	ConfigSetting("PersistentJitProfile", &g_Config.bPersistentJitProfile, false, true, true),
+	ConfigSetting("BackgroundJit", &g_Config.bBackgroundJit, false, true, true),
+	ConfigSetting("JitProfiling", &g_Config.bJitProfiling, false, true, true),
+	ConfigSetting("JitPerfMap", &g_Config.bJitPerfMap, false, true, true),
+	ConfigSetting("JitWriteWatch", &g_Config.bJitWriteWatch, false, true, true),
 	ConfigSetting("JitDisableFlags", &g_Config.uJitDisableFlags, (uint32_t)0, true, true),
 	ReportedConfigSetting("CPUSpeed", &g_Config.iLockedCPUSpeed, 0, true, true),
 
@@ -710,11 +729,13 @@ static ConfigSetting graphicsSettings[] = {
 	ConfigSetting("VendorBugChecksEnabled", &g_Config.bVendorBugChecksEnabled, true, false, false),
 	ReportedConfigSetting("RenderingMode", &g_Config.iRenderingMode, 1, true, true),
 	ConfigSetting("SoftwareRenderer", &g_Config.bSoftwareRendering, false, true, true),
+	ConfigSetting("SoftwareTexelCache", &g_Config.bSoftwareTexelCache, false, true, true),
 	ReportedConfigSetting("HardwareTransform", &g_Config.bHardwareTransform, true, true, true),
 	ReportedConfigSetting("SoftwareSkinning", &g_Config.bSoftwareSkinning, true, true, true),
 	ReportedConfigSetting("TextureFiltering", &g_Config.iTexFiltering, 1, true, true),
 	ReportedConfigSetting("BufferFiltering", &g_Config.iBufFilter, SCALE_LINEAR, true, true),
 	ReportedConfigSetting("InternalResolution", &g_Config.iInternalResolution, &DefaultInternalResolution, true, true),
+	ReportedConfigSetting("DynamicResolution", &g_Config.bDynamicResolution, false, true, true),
 	ReportedConfigSetting("AndroidHwScale", &g_Config.iAndroidHwScale, &DefaultAndroidHwScale),
 	ReportedConfigSetting("HighQualityDepth", &g_Config.bHighQualityDepth, true, true, true),
 	ReportedConfigSetting("FrameSkip", &g_Config.iFrameSkip, 0, true, true),
@@ -723,6 +744,7 @@ static ConfigSetting graphicsSettings[] = {
 	ConfigSetting("FrameRate", &g_Config.iFpsLimit1, 0, true, true),
 	ConfigSetting("FrameRate2", &g_Config.iFpsLimit2, -1, true, true),
 	ConfigSetting("FrameSkipUnthrottle", &g_Config.bFrameSkipUnthrottle, &DefaultFrameskipUnthrottle, true, false),
+	ConfigSetting("RunAheadFrames", &g_Config.iRunAheadFrames, 0, true, true),
 #if defined(USING_WIN_UI)
 	ConfigSetting("RestartRequired", &g_Config.bRestartRequired, false, false),
 #endif
@@ -733,7 +755,10 @@ static ConfigSetting graphicsSettings[] = {
 	ReportedConfigSetting("VertexDecCache", &g_Config.bVertexCache, &DefaultVertexCache, true, true),
 	ReportedConfigSetting("TextureBackoffCache", &g_Config.bTextureBackoffCache, false, true, true),
 	ReportedConfigSetting("TextureSecondaryCache", &g_Config.bTextureSecondaryCache, false, true, true),
+	ReportedConfigSetting("TexCacheBudgetMB", &g_Config.iTexCacheBudgetMB, 0, true, true),
 	ReportedConfigSetting("VertexDecJit", &g_Config.bVertexDecoderJit, &DefaultCodeGen, false),
+	ReportedConfigSetting("VertexDecCompute", &g_Config.bVertexDecoderCompute, false, true, true),
+	ReportedConfigSetting("VulkanParallelRecording", &g_Config.bVulkanParallelRecording, false, true, true),
 
 #ifndef MOBILE_DEVICE
 	ConfigSetting("FullScreen", &g_Config.bFullScreen, false),
@@ -748,14 +773,19 @@ static ConfigSetting graphicsSettings[] = {
 	ConfigSetting("SustainedPerformanceMode", &g_Config.bSustainedPerformanceMode, false, true, true),
 
 	ReportedConfigSetting("ReplaceTextures", &g_Config.bReplaceTextures, true, true, true),
+	ConfigSetting("ReplaceTexturesAsync", &g_Config.bReplaceTexturesAsync, true, true, true),
 	ReportedConfigSetting("SaveNewTextures", &g_Config.bSaveNewTextures, false, true, true),
 	ConfigSetting("IgnoreTextureFilenames", &g_Config.bIgnoreTextureFilenames, false, true, true),
 
 	ReportedConfigSetting("TexScalingLevel", &g_Config.iTexScalingLevel, 1, true, true),
 	ReportedConfigSetting("TexScalingType", &g_Config.iTexScalingType, 0, true, true),
 	ReportedConfigSetting("TexDeposterize", &g_Config.bTexDeposterize, false, true, true),
+	ReportedConfigSetting("TexScalingAsync", &g_Config.bTexScalingAsync, true, true, true),
+	ReportedConfigSetting("TexScalingDiskCache", &g_Config.bTexScalingDiskCache, true, true, true),
 	ReportedConfigSetting("TexHardwareScaling", &g_Config.bTexHardwareScaling, false, true, true),
+	ReportedConfigSetting("TexGPUMipmaps", &g_Config.bTexGPUMipmaps, false, true, true),
 	ConfigSetting("VSyncInterval", &g_Config.bVSync, false, true, true),
+	ConfigSetting("InflightFrames", &g_Config.iInflightFrames, 3, true, true),
 	ReportedConfigSetting("BloomHack", &g_Config.iBloomHack, 0, true, true),
 
 	// Not really a graphics setting...
@@ -777,6 +807,7 @@ static ConfigSetting graphicsSettings[] = {
 static ConfigSetting soundSettings[] = {
 	ConfigSetting("Enable", &g_Config.bEnableSound, true, true, true),
 	ConfigSetting("AudioBackend", &g_Config.iAudioBackend, 0, true, true),
+	ConfigSetting("WASAPIMode", &g_Config.iWASAPIMode, 0, true, true),
 	ConfigSetting("AudioLatency", &g_Config.iAudioLatency, 1, true, true),
 	ConfigSetting("ExtraAudioBuffering", &g_Config.bExtraAudioBuffering, false, true, false),
 	ConfigSetting("AudioResampler", &g_Config.bAudioResampler, true, true, true),
@@ -1164,6 +1195,9 @@ void Config::Load(const char *iniFileName, const char *controllerIniFilename) {
 	if (iRenderingMode != FB_NON_BUFFERED_MODE && iRenderingMode != FB_BUFFERED_MODE) {
 		g_Config.iRenderingMode = FB_BUFFERED_MODE;
 	}
+	if (iInflightFrames < 1 || iInflightFrames > 3) {
+		iInflightFrames = 3;
+	}
 
 	// Check for an old dpad setting
 	IniFile::Section *control = iniFile.GetOrCreateSection("Control");
@@ -1222,6 +1256,8 @@ void Config::Load(const char *iniFileName, const char *controllerIniFilename) {
 		jitForcedOff = true;
 		g_Config.iCpuCore = (int)CPUCore::INTERPRETER;
 	}
+
+	SetThreadPlacement((ThreadPlacement)iThreadPlacement);
 }
 
 void Config::Save(const char *saveReason) {
@@ -87,6 +87,10 @@ struct Config {
 	// Core
 	bool bIgnoreBadMemAccess;
 	bool bFastMemory;
+	// Back guest memory with huge pages where the host supports it, to cut TLB misses with fastmem.
+	bool bHugePages;
+	// Whether threads are placed on fast or slow cores by role, see ThreadPlacement.
+	int iThreadPlacement;
 	int iCpuCore;
 	bool bCheckForNewVersion;
 	bool bForceLagSync;
@@ -94,10 +98,17 @@ struct Config {
 	bool bHideSlowWarnings;
 	bool bHideStateWarnings;
 	bool bPreloadFunctions;
+	bool bPersistentJitProfile;
+	bool bBackgroundJit;
+	bool bJitProfiling;
+	bool bJitPerfMap;
+	bool bJitWriteWatch;
 	uint32_t uJitDisableFlags;
 
 	bool bSeparateSASThread;
+	bool bSeparateGEThread;
 	int iIOTimingMethod;
+	int iUMDReadAheadKB;
 	int iLockedCPUSpeed;
 	bool bAutoSaveSymbolMap;
 	bool bCacheFullIsoInRam;
@@ -130,6 +141,7 @@ struct Config {
 	std::string sD3D11Device;  // Windows only
 
 	bool bSoftwareRendering;
+	bool bSoftwareTexelCache;  // Software renderer keeps decoded copies of CLUT, swizzled and DXT textures.
 	bool bHardwareTransform; // only used in the GLES backend
 	bool bSoftwareSkinning;  // may speed up some games
 	bool bVendorBugChecksEnabled;
@@ -148,6 +160,8 @@ struct Config {
 	int iFrameSkipType;
 	bool bAutoFrameSkip;
 	bool bFrameSkipUnthrottle;
+	int iRunAheadFrames;  // Frames emulated ahead of the shown one and rolled back, to hide input lag.
+	int iInflightFrames;  // 1-3, frames the CPU may queue ahead of the GPU. Fewer means less lag.
 
 	bool bEnableCardboardVR; // Cardboard Master Switch
 	int iCardboardScreenSize; // Screen Size (in %)
@@ -162,19 +176,27 @@ struct Config {
 	bool bVertexCache;
 	bool bTextureBackoffCache;
 	bool bTextureSecondaryCache;
+	int iTexCacheBudgetMB;  // 0 = auto.  Least recently used textures are evicted above this.
 	bool bVertexDecoderJit;
+	bool bVertexDecoderCompute;  // Vulkan only, decodes large batches in a compute shader.
+	bool bVulkanParallelRecording;  // Vulkan only, records large render passes on worker threads.
 	bool bFullScreen;
 	bool bFullScreenMulti;
 	int iInternalResolution;  // 0 = Auto (native), 1 = 1x (480x272), 2 = 2x, 3 = 3x, 4 = 4x and so on.
+	bool bDynamicResolution;  // Lowers the render resolution (down to 1x) while the GPU can't keep up.
 	int iAnisotropyLevel;  // 0 - 5, powers of 2: 0 = 1x = no aniso
 	int bHighQualityDepth;
 	bool bReplaceTextures;
+	bool bReplaceTexturesAsync;  // Load replacements on a thread, showing the original meanwhile.
 	bool bSaveNewTextures;
 	bool bIgnoreTextureFilenames;
 	int iTexScalingLevel; // 0 = auto, 1 = off, 2 = 2x, ..., 5 = 5x
 	int iTexScalingType; // 0 = xBRZ, 1 = Hybrid
 	bool bTexDeposterize;
+	bool bTexScalingAsync;  // Scale on a worker thread, showing the unscaled texture meanwhile.
+	bool bTexScalingDiskCache;  // Keep scaled textures on disk between runs.
 	bool bTexHardwareScaling;
+	bool bTexGPUMipmaps;  // Generate mips on the GPU for upscaled textures and replacements without them.
 	int iFpsLimit1;
 	int iFpsLimit2;
 	int iMaxRecent;
@@ -199,6 +221,7 @@ struct Config {
 	bool bEnableSound;
 	int iAudioLatency; // 0 = low , 1 = medium(default) , 2 = high
 	int iAudioBackend;
+	int iWASAPIMode;
 	int iGlobalVolume;
 	int iAltSpeedVolume;
 	bool bExtraAudioBuffering;  // For bluetooth
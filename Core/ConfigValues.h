@@ -91,6 +91,20 @@ enum AudioBackendType {
 	AUDIO_BACKEND_WASAPI,
 };
 
+// For iWASAPIMode. The low latency modes fall back to regular shared if the device can't do them.
+enum WASAPIMode {
+	WASAPI_SHARED = 0,
+	WASAPI_LOW_LATENCY_SHARED = 1,
+	WASAPI_EXCLUSIVE = 2,
+};
+
+// For iAudioLatency.
+enum AudioLatency {
+	LOW_LATENCY = 0,
+	MEDIUM_LATENCY = 1,
+	HIGH_LATENCY = 2,
+};
+
 // For iIOTimingMethod.
 enum IOTimingMethods {
 	IOTIMING_FAST = 0,
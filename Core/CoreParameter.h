@@ -84,6 +84,9 @@ struct CoreParameter {
 	bool freezeNext = false;
 	bool frozen = false;
 
+	// Set while emulating (or rolling back) run-ahead frames. These don't output audio or throttle.
+	bool runAheadFrame = false;
+
 	FileLoader *mountIsoLoader = nullptr;
 
 	Compatibility compat;
@@ -16,22 +16,27 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
 #include <vector>
 #include <cstdio>
-#include <mutex>
 
 #include "base/logging.h"
+#include "base/timeutil.h"
 #include "profiler/profiler.h"
 
 #include "Common/MsgHandler.h"
-#include "Common/Atomics.h"
 #include "Core/CoreTiming.h"
 #include "Core/Core.h"
 #include "Core/Config.h"
 #include "Core/HLE/sceKernelThread.h"
 #include "Core/HLE/sceDisplay.h"
 #include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/JitCommon/JitWriteWatch.h"
 #include "Core/Reporting.h"
+#include "Core/System.h"
 #include "Common/ChunkFile.h"
 
 static const int initialHz = 222000000;
@@ -67,16 +72,25 @@ struct BaseEvent
 
 typedef LinkedListItem<BaseEvent> Event;
 
-Event *first;
+struct QueuedEvent
+{
+	BaseEvent ev;
+	// Events at the same time run in the order they were scheduled.
+	u64 order;
+};
+
+// Binary min-heap on (time, order), so scheduling is O(log n) and the next event is always eventQueue[0].
+static std::vector<QueuedEvent> eventQueue;
+static u64 nextEventOrder;
+
+// Other threads push onto this lock-free stack, and the CPU thread takes it all at once.
+static std::atomic<Event *> tsPushed;
+// Threadsafe events taken by the CPU thread but not yet moved, in scheduling order.
 Event *tsFirst;
 Event *tsLast;
 
-// event pools
+// event pools (only for savestates on the main queue now.)
 Event *eventPool = 0;
-Event *eventTsPool = 0;
-int allocatedTsEvents = 0;
-// Optimization to skip MoveEvents when possible.
-volatile u32 hasTsEvents = 0;
 
 // Downcount has been moved to currentMIPS, to save a couple of clocks in every ARM JIT block
 // as we can already reach that structure through a register.
@@ -87,8 +101,6 @@ s64 idledCycles;
 s64 lastGlobalTimeTicks;
 s64 lastGlobalTimeUs;
 
-static std::mutex externalEventLock;
-
 std::vector<MHzChangeCallback> mhzChangeCallbacks;
 
 void FireMhzChange() {
@@ -140,16 +152,10 @@ Event* GetNewEvent()
 	return ev;
 }
 
+// Any thread may allocate these, so no pool.
 Event* GetNewTsEvent()
 {
-	allocatedTsEvents++;
-
-	if(!eventTsPool)
-		return new Event;
-
-	Event* ev = eventTsPool;
-	eventTsPool = ev->next;
-	return ev;
+	return new Event;
 }
 
 void FreeEvent(Event* ev)
@@ -160,9 +166,32 @@ void FreeEvent(Event* ev)
 
 void FreeTsEvent(Event* ev)
 {
-	ev->next = eventTsPool;
-	eventTsPool = ev;
-	allocatedTsEvents--;
+	delete ev;
+}
+
+// Only on the CPU thread.  Appends everything pushed so far to tsFirst, oldest first.
+static void TakeThreadsafeEvents()
+{
+	Event *pushed = tsPushed.exchange(nullptr, std::memory_order_acquire);
+	if (!pushed)
+		return;
+
+	// The stack is newest first.
+	Event *reversed = nullptr;
+	Event *last = pushed;
+	while (pushed)
+	{
+		Event *next = pushed->next;
+		pushed->next = reversed;
+		reversed = pushed;
+		pushed = next;
+	}
+
+	if (tsLast)
+		tsLast->next = reversed;
+	else
+		tsFirst = reversed;
+	tsLast = last;
 }
 
 int RegisterEvent(const char *name, TimedCallback callback)
@@ -186,9 +215,61 @@ void RestoreRegisterEvent(int event_type, const char *name, TimedCallback callba
 	event_types[event_type] = EventType(callback, name);
 }
 
+static bool EventAfter(const QueuedEvent &a, const QueuedEvent &b)
+{
+	if (a.ev.time != b.ev.time)
+		return a.ev.time > b.ev.time;
+	return a.order > b.order;
+}
+
+static void AddEventToQueue(const BaseEvent &ev)
+{
+	eventQueue.push_back(QueuedEvent{ ev, nextEventOrder++ });
+	std::push_heap(eventQueue.begin(), eventQueue.end(), EventAfter);
+}
+
+static BaseEvent PopFirstEvent()
+{
+	std::pop_heap(eventQueue.begin(), eventQueue.end(), EventAfter);
+	BaseEvent ev = eventQueue.back().ev;
+	eventQueue.pop_back();
+	return ev;
+}
+
+// Removes all matching events, returning cycles left in the last one as the old list did.
+template <typename F>
+static s64 RemoveQueuedEvents(F match)
+{
+	s64 result = 0;
+	const QueuedEvent *last = nullptr;
+	for (const QueuedEvent &e : eventQueue)
+	{
+		if (match(e.ev) && (!last || EventAfter(e, *last)))
+			last = &e;
+	}
+	if (!last)
+		return result;
+
+	result = last->ev.time - GetTicks();
+	eventQueue.erase(std::remove_if(eventQueue.begin(), eventQueue.end(), [&](const QueuedEvent &e) {
+		return match(e.ev);
+	}), eventQueue.end());
+	std::make_heap(eventQueue.begin(), eventQueue.end(), EventAfter);
+	return result;
+}
+
+static std::vector<QueuedEvent> SortedEvents()
+{
+	std::vector<QueuedEvent> sorted = eventQueue;
+	std::sort(sorted.begin(), sorted.end(), [](const QueuedEvent &a, const QueuedEvent &b) {
+		return EventAfter(b, a);
+	});
+	return sorted;
+}
+
 void UnregisterAllEvents()
 {
-	if (first)
+	if (!eventQueue.empty())
 		PanicAlert("Cannot unregister events with events pending");
 	event_types.clear();
 }
@@ -201,9 +282,9 @@ void Init()
 	idledCycles = 0;
 	lastGlobalTimeTicks = 0;
 	lastGlobalTimeUs = 0;
-	hasTsEvents = 0;
 	mhzChangeCallbacks.clear();
 	CPU_HZ = initialHz;
+	ResetEventProfile();
 }
 
 void Shutdown()
@@ -218,14 +299,6 @@ void Shutdown()
 		eventPool = ev->next;
 		delete ev;
 	}
-
-	std::lock_guard<std::mutex> lk(externalEventLock);
-	while(eventTsPool)
-	{
-		Event *ev = eventTsPool;
-		eventTsPool = ev->next;
-		delete ev;
-	}
 }
 
 u64 GetTicks()
@@ -243,19 +316,15 @@ u64 GetIdleTicks()
 // schedule things to be executed on the main thread.
 void ScheduleEvent_Threadsafe(s64 cyclesIntoFuture, int event_type, u64 userdata)
 {
-	std::lock_guard<std::mutex> lk(externalEventLock);
 	Event *ne = GetNewTsEvent();
 	ne->time = GetTicks() + cyclesIntoFuture;
 	ne->type = event_type;
-	ne->next = 0;
 	ne->userdata = userdata;
-	if(!tsFirst)
-		tsFirst = ne;
-	if(tsLast)
-		tsLast->next = ne;
-	tsLast = ne;
 
-	Common::AtomicStoreRelease(hasTsEvents, 1);
+	Event *head = tsPushed.load(std::memory_order_relaxed);
+	do {
+		ne->next = head;
+	} while (!tsPushed.compare_exchange_weak(head, ne, std::memory_order_release, std::memory_order_relaxed));
 }
 
 // Same as ScheduleEvent_Threadsafe(0, ...) EXCEPT if we are already on the CPU thread
@@ -264,7 +333,6 @@ void ScheduleEvent_Threadsafe_Immediate(int event_type, u64 userdata)
 {
 	if(false) //Core::IsCPUThread())
 	{
-		std::lock_guard<std::mutex> lk(externalEventLock);
 		event_types[event_type].callback(userdata, 0);
 	}
 	else
@@ -273,30 +341,8 @@ void ScheduleEvent_Threadsafe_Immediate(int event_type, u64 userdata)
 
 void ClearPendingEvents()
 {
-	while (first)
-	{
-		Event *e = first->next;
-		FreeEvent(first);
-		first = e;
-	}
-}
-
-void AddEventToQueue(Event* ne)
-{
-	Event* prev = NULL;
-	Event** pNext = &first;
-	for(;;)
-	{
-		Event*& next = *pNext;
-		if(!next || ne->time < next->time)
-		{
-			ne->next = next;
-			next = ne;
-			break;
-		}
-		prev = next;
-		pNext = &prev->next;
-	}
+	eventQueue.clear();
+	nextEventOrder = 0;
 }
 
 // This must be run ONLY from within the cpu thread
@@ -304,62 +350,25 @@ void AddEventToQueue(Event* ne)
 // than Advance
 void ScheduleEvent(s64 cyclesIntoFuture, int event_type, u64 userdata)
 {
-	Event *ne = GetNewEvent();
-	ne->userdata = userdata;
-	ne->type = event_type;
-	ne->time = GetTicks() + cyclesIntoFuture;
+	BaseEvent ne;
+	ne.userdata = userdata;
+	ne.type = event_type;
+	ne.time = GetTicks() + cyclesIntoFuture;
 	AddEventToQueue(ne);
 }
 
 // Returns cycles left in timer.
 s64 UnscheduleEvent(int event_type, u64 userdata)
 {
-	s64 result = 0;
-	if (!first)
-		return result;
-	while(first)
-	{
-		if (first->type == event_type && first->userdata == userdata)
-		{
-			result = first->time - GetTicks();
-
-			Event *next = first->next;
-			FreeEvent(first);
-			first = next;
-		}
-		else
-		{
-			break;
-		}
-	}
-	if (!first)
-		return result;
-	Event *prev = first;
-	Event *ptr = prev->next;
-	while (ptr)
-	{
-		if (ptr->type == event_type && ptr->userdata == userdata)
-		{
-			result = ptr->time - GetTicks();
-
-			prev->next = ptr->next;
-			FreeEvent(ptr);
-			ptr = prev->next;
-		}
-		else
-		{
-			prev = ptr;
-			ptr = ptr->next;
-		}
-	}
-
-	return result;
+	return RemoveQueuedEvents([&](const BaseEvent &ev) {
+		return ev.type == event_type && ev.userdata == userdata;
+	});
 }
 
 s64 UnscheduleThreadsafeEvent(int event_type, u64 userdata)
 {
 	s64 result = 0;
-	std::lock_guard<std::mutex> lk(externalEventLock);
+	TakeThreadsafeEvents();
 	if (!tsFirst)
 		return result;
 	while(tsFirst)
@@ -413,57 +422,23 @@ void RegisterMHzChangeCallback(MHzChangeCallback callback) {
 
 bool IsScheduled(int event_type)
 {
-	if (!first)
-		return false;
-	Event *e = first;
-	while (e) {
-		if (e->type == event_type)
+	for (const QueuedEvent &e : eventQueue) {
+		if (e.ev.type == event_type)
 			return true;
-		e = e->next;
 	}
 	return false;
 }
 
 void RemoveEvent(int event_type)
 {
-	if (!first)
-		return;
-	while(first)
-	{
-		if (first->type == event_type)
-		{
-			Event *next = first->next;
-			FreeEvent(first);
-			first = next;
-		}
-		else
-		{
-			break;
-		}
-	}
-	if (!first)
-		return;
-	Event *prev = first;
-	Event *ptr = prev->next;
-	while (ptr)
-	{
-		if (ptr->type == event_type)
-		{
-			prev->next = ptr->next;
-			FreeEvent(ptr);
-			ptr = prev->next;
-		}
-		else
-		{
-			prev = ptr;
-			ptr = ptr->next;
-		}
-	}
+	RemoveQueuedEvents([&](const BaseEvent &ev) {
+		return ev.type == event_type;
+	});
 }
 
 void RemoveThreadsafeEvent(int event_type)
 {
-	std::lock_guard<std::mutex> lk(externalEventLock);
+	TakeThreadsafeEvents();
 	if (!tsFirst)
 	{
 		return;
@@ -512,19 +487,144 @@ void RemoveAllEvents(int event_type)
 	RemoveEvent(event_type);
 }
 
+struct EventCounter {
+	const char *name = nullptr;
+	// So far in the current frame.
+	u32 fires = 0;
+	double seconds = 0.0;
+	u32 frameFires = 0;
+	double frameSeconds = 0.0;
+	u64 totalFires = 0;
+	double totalSeconds = 0.0;
+};
+
+// Only taken while collecting stats, and then by the emu thread almost every time.
+static std::mutex eventProfileLock;
+static std::vector<EventCounter> eventProfile;
+
+// Emu thread only, so not under the lock.  -1 is outside emulation, which isn't counted.
+static const int TIME_CATEGORY_NOT_MEASURED = -2;
+static int currentTimeCategory = -1;
+static double timeCategoryStart = 0.0;
+static TimeBreakdown frameBreakdown;
+static TimeBreakdown lastFrameBreakdown;
+static TimeBreakdown totalBreakdown;
+
+static void AccountTimeCategory(double now) {
+	if (currentTimeCategory >= 0)
+		frameBreakdown.seconds[currentTimeCategory] += now - timeCategoryStart;
+	timeCategoryStart = now;
+}
+
+int EnterTimeCategory(TimeCategory category) {
+	if (!coreCollectDebugStats)
+		return TIME_CATEGORY_NOT_MEASURED;
+	AccountTimeCategory(real_time_now());
+	int previous = currentTimeCategory;
+	currentTimeCategory = (int)category;
+	return previous;
+}
+
+void LeaveTimeCategory(int previous) {
+	if (previous == TIME_CATEGORY_NOT_MEASURED)
+		return;
+	AccountTimeCategory(real_time_now());
+	currentTimeCategory = previous;
+}
+
+static void RunEventProfiled(const BaseEvent &evt) {
+	PROFILE_THIS_SCOPE("event");
+	TimeCategoryScope timeScope(TimeCategory::EVENTS);
+	const double start = real_time_now();
+	event_types[evt.type].callback(evt.userdata, (int)(GetTicks() - evt.time));
+	const double seconds = real_time_now() - start;
+
+	std::lock_guard<std::mutex> guard(eventProfileLock);
+	if (evt.type >= (int)eventProfile.size())
+		eventProfile.resize(evt.type + 1);
+	EventCounter &counter = eventProfile[evt.type];
+	// The types may be registered again (e.g. on load), so keep the name current.
+	if (evt.type < (int)event_types.size())
+		counter.name = event_types[evt.type].name;
+	counter.fires++;
+	counter.seconds += seconds;
+}
+
+std::vector<EventProfile> GetEventProfile() {
+	std::vector<EventProfile> result;
+	{
+		std::lock_guard<std::mutex> guard(eventProfileLock);
+		for (const EventCounter &c : eventProfile) {
+			if (c.name && (c.totalFires != 0 || c.fires != 0))
+				result.push_back(EventProfile{ c.name, c.frameFires, c.frameSeconds, c.totalFires + c.fires, c.totalSeconds + c.seconds });
+		}
+	}
+	std::sort(result.begin(), result.end(), [](const EventProfile &a, const EventProfile &b) {
+		return a.totalSeconds > b.totalSeconds;
+	});
+	return result;
+}
+
+void GetTimeBreakdown(TimeBreakdown *lastFrame, TimeBreakdown *total) {
+	std::lock_guard<std::mutex> guard(eventProfileLock);
+	if (lastFrame)
+		*lastFrame = lastFrameBreakdown;
+	if (total)
+		*total = totalBreakdown;
+}
+
+const char *TimeCategoryName(TimeCategory category) {
+	switch (category) {
+	case TimeCategory::CPU: return "cpu";
+	case TimeCategory::HLE: return "hle";
+	case TimeCategory::EVENTS: return "events";
+	case TimeCategory::GPU: return "gpu";
+	case TimeCategory::IDLE: return "idle";
+	default: return "N/A";
+	}
+}
+
+void ResetEventProfile() {
+	std::lock_guard<std::mutex> guard(eventProfileLock);
+	eventProfile.clear();
+	memset(&frameBreakdown, 0, sizeof(frameBreakdown));
+	memset(&lastFrameBreakdown, 0, sizeof(lastFrameBreakdown));
+	memset(&totalBreakdown, 0, sizeof(totalBreakdown));
+}
+
+void EndEventProfileFrame() {
+	if (currentTimeCategory >= 0)
+		AccountTimeCategory(real_time_now());
+
+	std::lock_guard<std::mutex> guard(eventProfileLock);
+	for (EventCounter &c : eventProfile) {
+		c.frameFires = c.fires;
+		c.frameSeconds = c.seconds;
+		c.totalFires += c.fires;
+		c.totalSeconds += c.seconds;
+		c.fires = 0;
+		c.seconds = 0.0;
+	}
+
+	lastFrameBreakdown = frameBreakdown;
+	for (int i = 0; i < (int)TimeCategory::COUNT; ++i)
+		totalBreakdown.seconds[i] += frameBreakdown.seconds[i];
+	memset(&frameBreakdown, 0, sizeof(frameBreakdown));
+}
+
 //This raise only the events required while the fifo is processing data
 void ProcessFifoWaitEvents()
 {
-	while (first)
+	while (!eventQueue.empty())
 	{
-		if (first->time <= (s64)GetTicks())
+		if (eventQueue[0].ev.time <= (s64)GetTicks())
 		{
-//			LOG(CPU, "[Scheduler] %s		 (%lld, %lld) ",
-//				first->name ? first->name : "?", (u64)GetTicks(), (u64)first->time);
-			Event* evt = first;
-			first = first->next;
-			event_types[evt->type].callback(evt->userdata, (int)(GetTicks() - evt->time));
-			FreeEvent(evt);
+			// Pop first, the callback may schedule more events.
+			BaseEvent evt = PopFirstEvent();
+			if (coreCollectDebugStats)
+				RunEventProfiled(evt);
+			else
+				event_types[evt.type].callback(evt.userdata, (int)(GetTicks() - evt.time));
 		}
 		else
 		{
@@ -535,27 +635,16 @@ void ProcessFifoWaitEvents()
 
 void MoveEvents()
 {
-	Common::AtomicStoreRelease(hasTsEvents, 0);
-
-	std::lock_guard<std::mutex> lk(externalEventLock);
+	TakeThreadsafeEvents();
 	// Move events from async queue into main queue
 	while (tsFirst)
 	{
 		Event *next = tsFirst->next;
-		AddEventToQueue(tsFirst);
+		AddEventToQueue(*tsFirst);
+		FreeTsEvent(tsFirst);
 		tsFirst = next;
 	}
 	tsLast = NULL;
-
-	// Move free events to threadsafe pool
-	while(allocatedTsEvents > 0 && eventPool)
-	{
-		Event *ev = eventPool;
-		eventPool = ev->next;
-		ev->next = eventTsPool;
-		eventTsPool = ev;
-		allocatedTsEvents--;
-	}
 }
 
 void ForceCheck()
@@ -579,11 +668,13 @@ void Advance()
 	globalTimer += cyclesExecuted;
 	currentMIPS->downcount = slicelength;
 
-	if (Common::AtomicLoadAcquire(hasTsEvents))
+	// Optimization to skip MoveEvents when possible.
+	if (tsPushed.load(std::memory_order_relaxed) || tsFirst)
 		MoveEvents();
 	ProcessFifoWaitEvents();
+	MIPSComp::WriteWatchFlush();
 
-	if (!first)
+	if (eventQueue.empty())
 	{
 		// This should never happen in PPSSPP.
 		// WARN_LOG_REPORT(TIME, "WARNING - no events in queue. Setting currentMIPS->downcount to 10000");
@@ -595,7 +686,7 @@ void Advance()
 	else
 	{
 		// Note that events can eat cycles as well.
-		int target = (int)(first->time - globalTimer);
+		int target = (int)(eventQueue[0].ev.time - globalTimer);
 		if (target > MAX_SLICE_LENGTH)
 			target = MAX_SLICE_LENGTH;
 
@@ -607,11 +698,9 @@ void Advance()
 
 void LogPendingEvents()
 {
-	Event *ptr = first;
-	while (ptr)
+	for (const QueuedEvent &e : SortedEvents())
 	{
-		//INFO_LOG(CPU, "PENDING: Now: %lld Pending: %lld Type: %d", globalTimer, ptr->time, ptr->type);
-		ptr = ptr->next;
+		//INFO_LOG(CPU, "PENDING: Now: %lld Pending: %lld Type: %d", globalTimer, e.ev.time, e.ev.type);
 	}
 }
 
@@ -621,10 +710,10 @@ void Idle(int maxIdle)
 	if (maxIdle != 0 && cyclesDown > maxIdle)
 		cyclesDown = maxIdle;
 
-	if (first && cyclesDown > 0)
+	if (!eventQueue.empty() && cyclesDown > 0)
 	{
 		int cyclesExecuted = slicelength - currentMIPS->downcount;
-		int cyclesNextEvent = (int) (first->time - globalTimer);
+		int cyclesNextEvent = (int) (eventQueue[0].ev.time - globalTimer);
 
 		if (cyclesNextEvent < cyclesExecuted + cyclesDown)
 		{
@@ -645,11 +734,11 @@ void Idle(int maxIdle)
 
 std::string GetScheduledEventsSummary()
 {
-	Event *ptr = first;
 	std::string text = "Scheduled events\n";
 	text.reserve(1000);
-	while (ptr)
+	for (const QueuedEvent &e : SortedEvents())
 	{
+		const BaseEvent *ptr = &e.ev;
 		unsigned int t = ptr->type;
 		if (t >= event_types.size())
 			PanicAlert("Invalid event type"); // %i", t);
@@ -659,7 +748,6 @@ std::string GetScheduledEventsSummary()
 		char temp[512];
 		sprintf(temp, "%s : %i %08x%08x\n", name, (int)ptr->time, (u32)(ptr->userdata >> 32), (u32)(ptr->userdata));
 		text += temp;
-		ptr = ptr->next;
 	}
 	return text;
 }
@@ -679,7 +767,7 @@ void Event_DoStateOld(PointerWrap &p, BaseEvent *ev)
 
 void DoState(PointerWrap &p)
 {
-	std::lock_guard<std::mutex> lk(externalEventLock);
+	TakeThreadsafeEvents();
 
 	auto s = p.Section("CoreTiming", 1, 3);
 	if (!s)
@@ -690,6 +778,19 @@ void DoState(PointerWrap &p)
 	// These (should) be filled in later by the modules.
 	event_types.resize(n, EventType(AntiCrashCallback, "INVALID EVENT"));
 
+	// The savestate format is still a sorted linked list.
+	Event *first = nullptr;
+	if (p.mode != PointerWrap::MODE_READ) {
+		Event **pNext = &first;
+		for (const QueuedEvent &e : SortedEvents()) {
+			Event *ev = GetNewEvent();
+			*(BaseEvent *)ev = e.ev;
+			ev->next = nullptr;
+			*pNext = ev;
+			pNext = &ev->next;
+		}
+	}
+
 	if (s >= 3) {
 		p.DoLinkedList<BaseEvent, GetNewEvent, FreeEvent, Event_DoState>(first, (Event **) NULL);
 		p.DoLinkedList<BaseEvent, GetNewTsEvent, FreeTsEvent, Event_DoState>(tsFirst, &tsLast);
@@ -698,6 +799,16 @@ void DoState(PointerWrap &p)
 		p.DoLinkedList<BaseEvent, GetNewTsEvent, FreeTsEvent, Event_DoStateOld>(tsFirst, &tsLast);
 	}
 
+	if (p.mode == PointerWrap::MODE_READ)
+		ClearPendingEvents();
+	while (first) {
+		Event *next = first->next;
+		if (p.mode == PointerWrap::MODE_READ)
+			AddEventToQueue(*first);
+		FreeEvent(first);
+		first = next;
+	}
+
 	p.Do(CPU_HZ);
 	p.Do(slicelength);
 	p.Do(globalTimer);
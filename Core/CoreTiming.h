@@ -18,6 +18,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "Common/CommonTypes.h"
 
 // This is a system to schedule events into the emulated machine's future. Time is measured
@@ -95,6 +96,7 @@ namespace CoreTiming
 	void ScheduleEvent_Threadsafe(s64 cyclesIntoFuture, int event_type, u64 userdata=0);
 	void ScheduleEvent_Threadsafe_Immediate(int event_type, u64 userdata=0);
 	s64 UnscheduleEvent(int event_type, u64 userdata);
+	// Like the other unschedule/remove functions, CPU thread only.
 	s64 UnscheduleThreadsafeEvent(int event_type, u64 userdata);
 
 	void RemoveEvent(int event_type);
@@ -119,6 +121,54 @@ namespace CoreTiming
 
 	std::string GetScheduledEventsSummary();
 
+	// Where the emu thread's time goes while emulating.  Time is only counted for the innermost
+	// category, so a display list run from a syscall counts as GPU, not HLE.
+	enum class TimeCategory {
+		CPU,  // Running game code, in the jit or interpreter.
+		HLE,
+		EVENTS,
+		GPU,
+		IDLE,  // Throttling to the target speed.
+		COUNT,
+	};
+
+	struct TimeBreakdown {
+		double seconds[(int)TimeCategory::COUNT];
+	};
+
+	struct EventProfile {
+		const char *name;
+		// For the last finished frame.
+		u32 frameFires;
+		double frameSeconds;
+		// Since the game started (or the last reset.)  Includes time in HLE and GPU work the callback did.
+		u64 totalFires;
+		double totalSeconds;
+	};
+
+	// Emu thread only.  Categories nest, and have to be left in reverse order, see TimeCategoryScope.
+	// Only measured while collecting debug stats, see Core_ForceDebugStats().
+	int EnterTimeCategory(TimeCategory category);
+	void LeaveTimeCategory(int previous);
+
+	class TimeCategoryScope {
+	public:
+		TimeCategoryScope(TimeCategory category) : previous_(EnterTimeCategory(category)) {}
+		~TimeCategoryScope() {
+			LeaveTimeCategory(previous_);
+		}
+	private:
+		int previous_;
+	};
+
+	// Returns every event type fired so far, most total time first.  Safe from any thread.
+	std::vector<EventProfile> GetEventProfile();
+	void GetTimeBreakdown(TimeBreakdown *lastFrame, TimeBreakdown *total);
+	const char *TimeCategoryName(TimeCategory category);
+	void ResetEventProfile();
+	// Closes the current frame's counts, called along with the other per frame stats.
+	void EndEventProfileFrame();
+
 	void DoState(PointerWrap &p);
 
 	void SetClockFrequencyHz(int cpuHz);
@@ -329,6 +329,9 @@ void hleCheat(u64 userdata, int cyclesLate) {
 CWCheatEngine::CWCheatEngine() {
 }
 
+CWCheatEngine::~CWCheatEngine() {
+}
+
 void CWCheatEngine::CreateCheatFile() {
 	activeCheatFile = GetSysDirectory(DIRECTORY_CHEATS) + gameTitle + ".ini";
 	File::CreateFullPath(GetSysDirectory(DIRECTORY_CHEATS));
@@ -353,6 +356,7 @@ void CWCheatEngine::ParseCheats() {
 	// TODO: Report errors.
 
 	cheats_ = parser.GetCheats();
+	CompileCheats();
 }
 
 u32 CWCheatEngine::GetAddress(u32 value) {
@@ -461,6 +465,16 @@ struct CheatOperation {
 			int type;
 		} pointerCommands;
 	};
+
+	// Line after this op's own lines, filled in by CompileCheats.
+	uint32_t nextLine;
+};
+
+// Skips count lines, not ops, and may land inside a multi-line op (which then runs as its own op.)
+// So there's one decoded op per line, and each knows where the next one starts.
+struct CompiledCheat {
+	const CheatCode *code;
+	std::vector<CheatOperation> ops;
 };
 
 CheatOperation CWCheatEngine::InterpretNextCwCheat(const CheatCode &cheat, size_t &i) {
@@ -727,21 +741,80 @@ CheatOperation CWCheatEngine::InterpretNextOp(const CheatCode &cheat, size_t &i)
 	return { CheatOp::Invalid };
 }
 
-void CWCheatEngine::ApplyMemoryOperator(const CheatOperation &op, uint32_t(*oper)(uint32_t, uint32_t)) {
-	if (Memory::IsValidAddress(op.addr)) {
-		InvalidateICache(op.addr, 4);
-		if (op.sz == 1)
-			Memory::Write_U8((u8)oper(Memory::Read_U8(op.addr), op.val), op.addr);
-		else if (op.sz == 2)
-			Memory::Write_U16((u16)oper(Memory::Read_U16(op.addr), op.val),op. addr);
-		else if (op.sz == 4)
-			Memory::Write_U32((u32)oper(Memory::Read_U32(op.addr), op.val), op.addr);
+void CWCheatEngine::CompileCheats() {
+	compiled_.clear();
+	compiled_.reserve(cheats_.size());
+	for (const CheatCode &cheat : cheats_) {
+		CompiledCheat compiled;
+		compiled.code = &cheat;
+		compiled.ops.reserve(cheat.lines.size());
+		for (size_t line = 0; line < cheat.lines.size(); ++line) {
+			size_t i = line;
+			CheatOperation op = InterpretNextOp(cheat, i);
+			op.nextLine = (uint32_t)i;
+
+			// Memory doesn't move, so drop plain writes and asserts at bad addresses now.
+			switch (op.op) {
+			case CheatOp::Write:
+			case CheatOp::Add:
+			case CheatOp::Subtract:
+			case CheatOp::Or:
+			case CheatOp::And:
+			case CheatOp::Xor:
+			case CheatOp::Assert:
+				if (!Memory::IsValidAddress(op.addr))
+					op.op = CheatOp::Noop;
+				break;
+			default:
+				break;
+			}
+			compiled.ops.push_back(op);
+		}
+		compiled_.push_back(std::move(compiled));
+	}
+}
+
+// The jit replaces the first op of each block with an emuhack, which must be put back before we look at it.
+void CWCheatEngine::RestoreEmuhack(u32 addr) {
+	if (MIPS_IS_EMUHACK(Memory::ReadUnchecked_U32(addr & ~3)))
+		InvalidateICache(addr & ~3, 4);
+}
+
+// Most cheats write the same value over and over, so only invalidate jit code when it actually changes.
+void CWCheatEngine::WriteIfChanged(u32 addr, int sz, u32 val) {
+	RestoreEmuhack(addr);
+	if (sz == 1) {
+		if (Memory::ReadUnchecked_U8(addr) == (u8)val)
+			return;
+		Memory::WriteUnchecked_U8((u8)val, addr);
+	} else if (sz == 2) {
+		if (Memory::ReadUnchecked_U16(addr) == (u16)val)
+			return;
+		Memory::WriteUnchecked_U16((u16)val, addr);
+	} else if (sz == 4) {
+		if (Memory::ReadUnchecked_U32(addr) == val)
+			return;
+		Memory::WriteUnchecked_U32(val, addr);
+	} else {
+		return;
 	}
+	InvalidateICache(addr, 4);
+}
+
+void CWCheatEngine::ApplyMemoryOperator(const CheatOperation &op, uint32_t(*oper)(uint32_t, uint32_t)) {
+	// Address validated in CompileCheats.
+	RestoreEmuhack(op.addr);
+	if (op.sz == 1)
+		WriteIfChanged(op.addr, 1, oper(Memory::ReadUnchecked_U8(op.addr), op.val));
+	else if (op.sz == 2)
+		WriteIfChanged(op.addr, 2, oper(Memory::ReadUnchecked_U16(op.addr), op.val));
+	else if (op.sz == 4)
+		WriteIfChanged(op.addr, 4, oper(Memory::ReadUnchecked_U32(op.addr), op.val));
 }
 
 bool CWCheatEngine::TestIf(const CheatOperation &op, bool(*oper)(int, int)) {
 	if (Memory::IsValidAddress(op.addr)) {
-		InvalidateICache(op.addr, 4);
+		RestoreEmuhack(op.addr);
 
 		int memoryValue = 0;
 		if (op.sz == 1)
@@ -758,7 +831,7 @@ bool CWCheatEngine::TestIf(const CheatOperation &op, bool(*oper)(int, int)) {
 
 bool CWCheatEngine::TestIfAddr(const CheatOperation &op, bool(*oper)(int, int)) {
 	if (Memory::IsValidAddress(op.addr)) {
-		InvalidateICache(op.addr, 4);
+		RestoreEmuhack(op.addr);
 
 		int memoryValue1 = 0;
 		int memoryValue2 = 0;
@@ -788,15 +861,8 @@ void CWCheatEngine::ExecuteOp(const CheatOperation &op, const CheatCode &cheat,
 		break;
 
 	case CheatOp::Write:
-		if (Memory::IsValidAddress(op.addr)) {
-			InvalidateICache(op.addr, 4);
-			if (op.sz == 1)
-				Memory::Write_U8((u8)op.val, op.addr);
-			else if (op.sz == 2)
-				Memory::Write_U16((u16)op.val, op.addr);
-			else if (op.sz == 4)
-				Memory::Write_U32((u32)op.val, op.addr);
-		}
+		// Address validated in CompileCheats.
+		WriteIfChanged(op.addr, op.sz, op.val);
 		break;
 
 	case CheatOp::Add:
@@ -831,19 +897,11 @@ void CWCheatEngine::ExecuteOp(const CheatOperation &op, const CheatCode &cheat,
 
 	case CheatOp::MultiWrite:
 		if (Memory::IsValidAddress(op.addr)) {
-			InvalidateICache(op.addr, op.multiWrite.count * op.multiWrite.step + op.sz);
-
 			uint32_t data = op.val;
 			uint32_t addr = op.addr;
 			for (uint32_t a = 0; a < op.multiWrite.count; a++) {
-				if (Memory::IsValidAddress(addr)) {
-					if (op.sz == 1)
-						Memory::Write_U8((u8)data, addr);
-					else if (op.sz == 2)
-						Memory::Write_U16((u16)data, addr);
-					else if (op.sz == 4)
-						Memory::Write_U32((u32)data, addr);
-				}
+				if (Memory::IsValidAddress(addr))
+					WriteIfChanged(addr, op.sz, data);
 				addr += op.multiWrite.step;
 				data += op.multiWrite.add;
 			}
@@ -864,11 +922,10 @@ void CWCheatEngine::ExecuteOp(const CheatOperation &op, const CheatCode &cheat,
 		break;
 
 	case CheatOp::Assert:
-		if (Memory::IsValidAddress(op.addr)) {
-			InvalidateICache(op.addr, 4);
-			if (Memory::Read_U32(op.addr) != op.val) {
-				i = cheat.lines.size();
-			}
+		// Address validated in CompileCheats.
+		RestoreEmuhack(op.addr);
+		if (Memory::ReadUnchecked_U32(op.addr) != op.val) {
+			i = cheat.lines.size();
 		}
 		break;
 
@@ -1052,11 +1109,13 @@ void CWCheatEngine::ExecuteOp(const CheatOperation &op, const CheatCode &cheat,
 }
 
 void CWCheatEngine::Run() {
-	for (CheatCode cheat : cheats_) {
-		// InterpretNextOp and ExecuteOp move i.
-		for (size_t i = 0; i < cheat.lines.size(); ) {
-			CheatOperation op = InterpretNextOp(cheat, i);
-			ExecuteOp(op, cheat, i);
+	for (const CompiledCheat &cheat : compiled_) {
+		// ExecuteOp moves i for skips and the lines pointer commands consume.
+		const size_t count = cheat.ops.size();
+		for (size_t i = 0; i < count; ) {
+			const CheatOperation &op = cheat.ops[i];
+			i = op.nextLine;
+			ExecuteOp(op, *cheat.code, i);
 		}
 	}
 }
@@ -35,10 +35,12 @@ struct CheatCode {
 };
 
 struct CheatOperation;
+struct CompiledCheat;
 
 class CWCheatEngine {
 public:
 	CWCheatEngine();
+	~CWCheatEngine();
 	std::vector<std::string> GetCodesList();
 	void ParseCheats();
 	void CreateCheatFile();
@@ -48,6 +50,7 @@ class CWCheatEngine {
 	void InvalidateICache(u32 addr, int size);
 private:
 	u32 GetAddress(u32 value);
+	void CompileCheats();
 
 	CheatOperation InterpretNextOp(const CheatCode &cheat, size_t &i);
 	CheatOperation InterpretNextCwCheat(const CheatCode &cheat, size_t &i);
@@ -57,6 +60,10 @@ class CWCheatEngine {
 	void ApplyMemoryOperator(const CheatOperation &op, uint32_t(*oper)(uint32_t, uint32_t));
 	bool TestIf(const CheatOperation &op, bool(*oper)(int a, int b));
 	bool TestIfAddr(const CheatOperation &op, bool(*oper)(int a, int b));
+	void WriteIfChanged(u32 addr, int sz, u32 val);
+	void RestoreEmuhack(u32 addr);
 
 	std::vector<CheatCode> cheats_;
+	// Decoded once from cheats_ in ParseCheats, so Run doesn't interpret lines every time.
+	std::vector<CompiledCheat> compiled_;
 };
@@ -43,6 +43,9 @@
 // At start, please send a "version" event.  See WebSocket/GameSubscriber.cpp for more details.
 //
 // For other events, look inside Core/Debugger/WebSocket/ for details on each event.
+//
+// For high rate data, like watching memory or registers every frame, see "stream.subscribe" in
+// WebSocket/StreamSubscriber.cpp.  That sends compact binary messages instead of JSON events.
 
 #include "Core/Debugger/WebSocket/GameBroadcaster.h"
 #include "Core/Debugger/WebSocket/LogBroadcaster.h"
@@ -53,9 +56,13 @@
 #include "Core/Debugger/WebSocket/DisasmSubscriber.h"
 #include "Core/Debugger/WebSocket/GameSubscriber.h"
 #include "Core/Debugger/WebSocket/GPUBufferSubscriber.h"
+#include "Core/Debugger/WebSocket/GPUProfileSubscriber.h"
 #include "Core/Debugger/WebSocket/GPURecordSubscriber.h"
 #include "Core/Debugger/WebSocket/HLESubscriber.h"
+#include "Core/Debugger/WebSocket/JitSubscriber.h"
+#include "Core/Debugger/WebSocket/MemoryUsageSubscriber.h"
 #include "Core/Debugger/WebSocket/SteppingSubscriber.h"
+#include "Core/Debugger/WebSocket/StreamSubscriber.h"
 
 typedef DebuggerSubscriber *(*SubscriberInit)(DebuggerEventHandlerMap &map);
 static const std::vector<SubscriberInit> subscribers({
@@ -64,9 +71,13 @@ static const std::vector<SubscriberInit> subscribers({
 	&WebSocketDisasmInit,
 	&WebSocketGameInit,
 	&WebSocketGPUBufferInit,
+	&WebSocketGPUProfileInit,
 	&WebSocketGPURecordInit,
 	&WebSocketHLEInit,
+	&WebSocketJitInit,
+	&WebSocketMemoryUsageInit,
 	&WebSocketSteppingInit,
+	&WebSocketStreamInit,
 });
 
 // To handle webserver restart, keep track of how many running.
@@ -0,0 +1,141 @@
+// Copyright (c) 2020- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+#include "thin3d/thin3d.h"
+#include "Core/Config.h"
+#include "Core/Debugger/WebSocket/GPUProfileSubscriber.h"
+#include "Core/Debugger/WebSocket/WebSocketUtils.h"
+#include "GPU/GPUInterface.h"
+#include "GPU/Common/TextureCacheStats.h"
+
+DebuggerSubscriber *WebSocketGPUProfileInit(DebuggerEventHandlerMap &map) {
+	map["gpu.profile"] = &WebSocketGPUProfile;
+	map["gpu.texcache.stats"] = &WebSocketGPUTexCacheStats;
+
+	return nullptr;
+}
+
+// Report GPU timestamps from a recent frame (gpu.profile)
+//
+// Parameters:
+//  - enable: optional boolean, turns GPU profiling on or off (same as the GPU Profile developer setting.)
+//
+// Response (same event name):
+//  - gpuMilliseconds: GPU time spent on the whole frame.
+//  - cpuMilliseconds: time spent issuing the frame's work on the render thread, or 0 if not measured.
+//  - steps: array of objects in submission order, with properties:
+//     - name: string describing the render pass, copy, etc.
+//     - milliseconds: GPU time spent on this step.
+//
+// Results lag a few frames behind, and need timestamp query support (not available on Direct3D 9.)
+// If enable is set to false, the response is empty.
+void WebSocketGPUProfile(DebuggerRequest &req) {
+	if (!gpu)
+		return req.Fail("CPU not started");
+
+	if (req.HasParam("enable")) {
+		bool enable = false;
+		if (!req.ParamBool("enable", &enable))
+			return;
+		g_Config.bShowGpuProfile = enable;
+		if (!enable) {
+			req.Respond();
+			return;
+		}
+	} else if (!g_Config.bShowGpuProfile) {
+		return req.Fail("GPU profiling not enabled");
+	}
+
+	Draw::GPUProfile profile;
+	Draw::DrawContext *draw = gpu->GetDrawContext();
+	if (!draw || !draw->GetGPUProfile(&profile))
+		return req.Fail("No GPU profile data yet");
+
+	JsonWriter &json = req.Respond();
+	json.writeFloat("gpuMilliseconds", profile.gpuMilliseconds);
+	json.writeFloat("cpuMilliseconds", profile.cpuMilliseconds);
+	json.pushArray("steps");
+	for (const Draw::GPUProfileStep &step : profile.steps) {
+		json.pushDict();
+		json.writeString("name", step.name);
+		json.writeFloat("milliseconds", step.milliseconds);
+		json.pop();
+	}
+	json.pop();
+}
+
+// Report texture cache activity over recent frames (gpu.texcache.stats)
+//
+// Parameters:
+//  - reset: optional boolean, clears the history after responding.
+//
+// Response (same event name):
+//  - frames: how many recent frames the sums and histogram cover (up to 120.)
+//  - lookups, hits, newEntries: texture lookups, how many found a usable entry, and how many created one.
+//  - hashes, bytesHashed, hashMilliseconds: texture hash checks and their cost.
+//  - scales, texelsScaled, scaleMilliseconds: texture scaling, including from the scaled texture cache.
+//  - rebuilds: object with a count per reason an existing entry was rebuilt (e.g. "hash fail".)
+//  - decodes: array of objects with properties format (e.g. "CLUT8"), count, and milliseconds.
+//  - lastFrameMilliseconds: hash, decode, and scale time in the most recent frame.
+//  - histogram: array of frame counts by that time, in buckets of < 0.25ms doubling up to >= 16ms.
+void WebSocketGPUTexCacheStats(DebuggerRequest &req) {
+	if (!gpu)
+		return req.Fail("CPU not started");
+
+	bool reset = false;
+	if (!req.ParamBool("reset", &reset, DebuggerParamType::OPTIONAL))
+		return;
+
+	TextureCacheStats stats = TexCacheStats_Get();
+	if (reset)
+		TexCacheStats_Reset();
+
+	const TexCacheFrameStats &sum = stats.sum;
+	JsonWriter &json = req.Respond();
+	json.writeInt("frames", stats.frames);
+	json.writeInt("lookups", sum.lookups);
+	json.writeInt("hits", sum.hits);
+	json.writeInt("newEntries", sum.newEntries);
+	json.writeInt("hashes", sum.hashes);
+	json.writeFloat("bytesHashed", (double)sum.bytesHashed);
+	json.writeFloat("hashMilliseconds", sum.hashMs);
+	json.writeInt("scales", sum.scales);
+	json.writeFloat("texelsScaled", (double)sum.texelsScaled);
+	json.writeFloat("scaleMilliseconds", sum.scaleMs);
+
+	json.pushDict("rebuilds");
+	for (int i = 0; i < (int)TexChangeReason::COUNT; ++i)
+		json.writeInt(TexChangeReasonName((TexChangeReason)i), sum.changes[i]);
+	json.pop();
+
+	json.pushArray("decodes");
+	for (int i = 0; i < TEXCACHE_STATS_FORMATS; ++i) {
+		if (sum.decodes[i] == 0)
+			continue;
+		json.pushDict();
+		json.writeString("format", TexCacheFormatName(i));
+		json.writeInt("count", sum.decodes[i]);
+		json.writeFloat("milliseconds", sum.decodeMs[i]);
+		json.pop();
+	}
+	json.pop();
+
+	json.writeFloat("lastFrameMilliseconds", TexCacheStats_FrameMs(stats.last));
+	json.pushArray("histogram");
+	for (int i = 0; i < TEXCACHE_STATS_BUCKETS; ++i)
+		json.writeInt(stats.msHistogram[i]);
+	json.pop();
+}
@@ -15,6 +15,7 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <mutex>
 #include "data/base64.h"
 #include "Common/FileUtil.h"
 #include "Core/Debugger/WebSocket/GPURecordSubscriber.h"
@@ -31,6 +32,8 @@ struct WebSocketGPURecordState : public DebuggerSubscriber {
 protected:
 	bool pending_ = false;
 	std::string lastTicket_;
+	// Set from the recording's writer thread.
+	std::mutex lastFilenameLock_;
 	std::string lastFilename_;
 };
 
@@ -49,7 +52,8 @@ WebSocketGPURecordState::~WebSocketGPURecordState() {
 
 // Begin recording (gpu.record.dump)
 //
-// No parameters.
+// Parameters:
+//  - frames: optional number of frames to record, default 1.
 //
 // Response (same event name):
 //  - uri: data: URI containing debug dump data.
@@ -59,11 +63,18 @@ void WebSocketGPURecordState::Dump(DebuggerRequest &req) {
 	if (!PSP_IsInited())
 		return req.Fail("CPU not started");
 
-	if (!GPURecord::Activate())
+	uint32_t frames = 1;
+	if (!req.ParamU32("frames", &frames, false, DebuggerParamType::OPTIONAL))
+		return;
+	if (frames == 0)
+		return req.Fail("Must record at least one frame");
+
+	if (!GPURecord::Activate((int)frames))
 		return req.Fail("Recording already in progress");
 
 	pending_ = true;
 	GPURecord::SetCallback([=](const std::string &filename) {
+		std::lock_guard<std::mutex> guard(lastFilenameLock_);
 		lastFilename_ = filename;
 		pending_ = false;
 	});
@@ -74,10 +85,15 @@ void WebSocketGPURecordState::Dump(DebuggerRequest &req) {
 
 // This handles the asynchronous gpu.record.dump response.
 void WebSocketGPURecordState::Broadcast(net::WebSocketServer *ws) {
-	if (!lastFilename_.empty()) {
-		FILE *fp = File::OpenCFile(lastFilename_, "rb");
+	std::string filename;
+	{
+		std::lock_guard<std::mutex> guard(lastFilenameLock_);
+		filename.swap(lastFilename_);
+	}
+
+	if (!filename.empty()) {
+		FILE *fp = File::OpenCFile(filename, "rb");
 		if (!fp) {
-			lastFilename_.clear();
 			return;
 		}
 
@@ -101,7 +117,6 @@ void WebSocketGPURecordState::Broadcast(net::WebSocketServer *ws) {
 
 		ws->AddFragment(true, R"("})");
 
-		lastFilename_.clear();
 		lastTicket_.clear();
 	}
 }
@@ -25,9 +25,25 @@
 #include "Core/MIPS/MIPSAnalyst.h"
 #include "Core/MIPS/MIPSDebugInterface.h"
 #include "Core/MIPS/MIPSStackWalk.h"
+#include "Core/HLE/HLE.h"
 #include "Core/HLE/sceKernelThread.h"
+#include "Core/System.h"
+
+struct WebSocketHLEProfileState : public DebuggerSubscriber {
+	~WebSocketHLEProfileState() override {
+		if (enabled_)
+			Core_ForceDebugStats(false);
+	}
+
+	void Profile(DebuggerRequest &req);
+
+protected:
+	bool enabled_ = false;
+};
 
 DebuggerSubscriber *WebSocketHLEInit(DebuggerEventHandlerMap &map) {
+	auto p = new WebSocketHLEProfileState();
+
 	map["hle.thread.list"] = &WebSocketHLEThreadList;
 	map["hle.thread.wake"] = &WebSocketHLEThreadWake;
 	map["hle.thread.stop"] = &WebSocketHLEThreadStop;
@@ -37,8 +53,9 @@ DebuggerSubscriber *WebSocketHLEInit(DebuggerEventHandlerMap &map) {
 	map["hle.func.rename"] = &WebSocketHLEFuncRename;
 	map["hle.module.list"] = &WebSocketHLEModuleList;
 	map["hle.backtrace"] = &WebSocketHLEBacktrace;
+	map["hle.profile"] = std::bind(&WebSocketHLEProfileState::Profile, p, std::placeholders::_1);
 
-	return nullptr;
+	return p;
 }
 
 // List all current HLE threads (hle.thread.list)
@@ -489,3 +506,52 @@ void WebSocketHLEBacktrace(DebuggerRequest &req) {
 	}
 	json.pop();
 }
+
+// Report time spent in each HLE function (hle.profile)
+//
+// Parameters:
+//  - enable: optional boolean, starts or stops timing syscalls for this connection.
+//  - reset: optional boolean, clears the totals before responding.
+//
+// Response (same event name):
+//  - enabled: boolean, whether syscalls are being timed (possibly for another reason, like debug stats.)
+//  - functions: array of objects, most total time first, each with properties:
+//     - module: string module name, like "IoFileMgrForUser".
+//     - name: string function name.
+//     - frameCalls: unsigned integer, calls during the last frame.
+//     - frameMilliseconds: host time spent in those calls.
+//     - totalCalls: unsigned integer, calls since the game started or the last reset.
+//     - totalMilliseconds: host time spent in those calls.
+//
+// Note: timing syscalls makes the jit call them the slower way, which adds a little overhead.
+void WebSocketHLEProfileState::Profile(DebuggerRequest &req) {
+	if (req.HasParam("enable")) {
+		bool enable = false;
+		if (!req.ParamBool("enable", &enable))
+			return;
+		if (enable != enabled_) {
+			Core_ForceDebugStats(enable);
+			enabled_ = enable;
+		}
+	}
+	bool reset = false;
+	if (!req.ParamBool("reset", &reset, DebuggerParamType::OPTIONAL))
+		return;
+	if (reset)
+		hleResetSyscallProfile();
+
+	JsonWriter &json = req.Respond();
+	json.writeBool("enabled", coreCollectDebugStats || enabled_);
+	json.pushArray("functions");
+	for (const HLESyscallProfile &func : hleGetSyscallProfile()) {
+		json.pushDict();
+		json.writeString("module", func.module);
+		json.writeString("name", func.name);
+		json.writeUint("frameCalls", func.frameCalls);
+		json.writeFloat("frameMilliseconds", func.frameSeconds * 1000.0);
+		json.writeRaw("totalCalls", std::to_string(func.totalCalls));
+		json.writeFloat("totalMilliseconds", func.totalSeconds * 1000.0);
+		json.pop();
+	}
+	json.pop();
+}
@@ -0,0 +1,145 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "Core/Core.h"
+#include "Core/Debugger/SymbolMap.h"
+#include "Core/Debugger/WebSocket/JitSubscriber.h"
+#include "Core/Debugger/WebSocket/WebSocketUtils.h"
+#include "Core/MIPS/JitCommon/JitBlockCache.h"
+#include "Core/MIPS/JitCommon/JitCommon.h"
+#include "Core/System.h"
+
+DebuggerSubscriber *WebSocketJitInit(DebuggerEventHandlerMap &map) {
+	map["jit.profile.list"] = &WebSocketJitProfileList;
+	map["jit.profile.reset"] = &WebSocketJitProfileReset;
+
+	return nullptr;
+}
+
+static JitBlockCacheDebugInterface *BlockCacheForRequest(DebuggerRequest &req) {
+	if (!PSP_IsInited()) {
+		req.Fail("CPU not active");
+		return nullptr;
+	}
+	if (!Core_IsStepping()) {
+		req.Fail("CPU currently running (cpu.stepping first)");
+		return nullptr;
+	}
+	if (!MIPSComp::jit) {
+		req.Fail("Jit not active");
+		return nullptr;
+	}
+	return MIPSComp::jit->GetBlockCacheDebugInterface();
+}
+
+struct JitFunctionProfile {
+	u32 address;
+	int blocks;
+	int64_t executions;
+	int64_t cycles;
+};
+
+// List the hottest guest functions, by estimated cycles (jit.profile.list)
+//
+// Requires the JitProfiling setting, which is applied when the jit is created.
+//
+// Parameters:
+//  - count: optional number of functions to return, default 20.
+//
+// Response (same event name):
+//  - functions: array of objects, hottest first, each with properties:
+//     - address: unsigned integer start address, or of the block if not in a known function.
+//     - name: function name from the symbol map, or empty.
+//     - blocks: number of jit blocks counted in this function.
+//     - executions: number of block entries.
+//     - cycles: estimated cycles spent, based on the downcount of each block.
+void WebSocketJitProfileList(DebuggerRequest &req) {
+	JitBlockCacheDebugInterface *blockCache = BlockCacheForRequest(req);
+	if (!blockCache)
+		return;
+
+	uint32_t count = 20;
+	if (!req.ParamU32("count", &count, false, DebuggerParamType::OPTIONAL))
+		return;
+
+	std::unordered_map<u32, JitFunctionProfile> functions;
+	bool anyStats = false;
+	for (int i = 0; i < blockCache->GetNumBlocks(); ++i) {
+		JitBlockProfileStats stats;
+		u32 start, size;
+		if (!blockCache->GetBlockProfileStats(i, stats) || !blockCache->GetBlockRange(i, start, size))
+			continue;
+		anyStats = true;
+		if (stats.executions == 0)
+			continue;
+
+		u32 funcStart = g_symbolMap->GetFunctionStart(start);
+		if (funcStart == SymbolMap::INVALID_ADDRESS)
+			funcStart = start;
+
+		auto it = functions.find(funcStart);
+		if (it == functions.end())
+			it = functions.insert(std::make_pair(funcStart, JitFunctionProfile{ funcStart, 0, 0, 0 })).first;
+		it->second.blocks++;
+		it->second.executions += stats.executions;
+		it->second.cycles += stats.cycles;
+	}
+
+	if (!anyStats && blockCache->GetNumBlocks() != 0)
+		return req.Fail("Jit profiling not enabled");
+
+	std::vector<JitFunctionProfile> sorted;
+	sorted.reserve(functions.size());
+	for (const auto &it : functions)
+		sorted.push_back(it.second);
+	std::sort(sorted.begin(), sorted.end(), [](const JitFunctionProfile &a, const JitFunctionProfile &b) {
+		return a.cycles > b.cycles;
+	});
+	if (sorted.size() > count)
+		sorted.resize(count);
+
+	JsonWriter &json = req.Respond();
+	json.pushArray("functions");
+	for (const auto &func : sorted) {
+		json.pushDict();
+		json.writeUint("address", func.address);
+		json.writeString("name", g_symbolMap->GetLabelString(func.address));
+		json.writeInt("blocks", func.blocks);
+		json.writeFloat("executions", (double)func.executions);
+		json.writeFloat("cycles", (double)func.cycles);
+		json.pop();
+	}
+	json.pop();
+}
+
+// Reset the jit profile counters (jit.profile.reset)
+//
+// No parameters.
+//
+// Response (same event name) with no extra data.
+void WebSocketJitProfileReset(DebuggerRequest &req) {
+	JitBlockCacheDebugInterface *blockCache = BlockCacheForRequest(req);
+	if (!blockCache)
+		return;
+
+	blockCache->ResetBlockProfileStats();
+	req.Respond();
+}
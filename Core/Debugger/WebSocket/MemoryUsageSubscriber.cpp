@@ -0,0 +1,64 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include "Common/MemoryUsage.h"
+#include "Core/Debugger/WebSocket/MemoryUsageSubscriber.h"
+#include "Core/Debugger/WebSocket/WebSocketUtils.h"
+
+DebuggerSubscriber *WebSocketMemoryUsageInit(DebuggerEventHandlerMap &map) {
+	map["memory.usage"] = &WebSocketMemoryUsage;
+	map["memory.usage.resetPeaks"] = &WebSocketMemoryUsageResetPeaks;
+
+	return nullptr;
+}
+
+// Report host memory used by each subsystem (memory.usage)
+//
+// No parameters.
+//
+// Response (same event name):
+//  - categories: array of objects with properties:
+//     - name: string describing the subsystem.
+//     - current: number of bytes currently used.
+//     - peak: highest number of bytes used since startup or the last reset.
+//  - total: number of bytes currently used by all categories together.
+//
+// Note that texture and framebuffer sizes are estimates, drivers may use more or less.
+void WebSocketMemoryUsage(DebuggerRequest &req) {
+	JsonWriter &json = req.Respond();
+	json.pushArray("categories");
+	for (int i = 0; i < (int)MemoryUsage::Category::COUNT; ++i) {
+		MemoryUsage::Category cat = (MemoryUsage::Category)i;
+		json.pushDict();
+		json.writeString("name", MemoryUsage::Name(cat));
+		json.writeFloat("current", (double)MemoryUsage::Current(cat));
+		json.writeFloat("peak", (double)MemoryUsage::Peak(cat));
+		json.pop();
+	}
+	json.pop();
+	json.writeFloat("total", (double)MemoryUsage::TotalCurrent());
+}
+
+// Reset peak memory usage to the current values (memory.usage.resetPeaks)
+//
+// No parameters.
+//
+// Response (same event name) with no extra data.
+void WebSocketMemoryUsageResetPeaks(DebuggerRequest &req) {
+	MemoryUsage::ResetPeaks();
+	req.Respond();
+}
@@ -0,0 +1,269 @@
+// Copyright (c) 2020- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "Core/Debugger/WebSocket/StreamSubscriber.h"
+#include "Core/Debugger/WebSocket/WebSocketUtils.h"
+#include "Core/MemMap.h"
+#include "Core/MIPS/MIPS.h"
+#include "Core/System.h"
+#include "GPU/GPU.h"
+
+// Snapshots are sent as binary messages, which are much cheaper to produce and parse than JSON at high rates.
+// Each message batches everything subscribed to for a single frame:
+//  - u32 magic "PPST", u16 version (currently 1), u16 record count, u32 frame number.
+//  - Then each record: u16 type, u16 reserved (zero), u32 payload size, then the payload.
+// All values are little endian.  Clients should skip record types they don't know, using the size.
+//
+// Record types:
+//  - 1 (CPU): u32 pc, hi, lo, fcr31, then the 32 GPRs, then the raw bits of the 32 FPRs.
+//  - 2 (memory): u32 address, then the bytes.
+//  - 3 (GPU stats, of the previous frame): u32 draw calls, cached draw calls, flushes, vertices submitted,
+//    texture switches, shader switches, textures decoded, readbacks, uploads, clears, shaders compiled,
+//    then a float of milliseconds spent processing display lists.
+//
+// Values are sampled while the game runs, unless stepping.  The JIT may hold CPU registers elsewhere,
+// so they're only exact in the interpreter or while stepping.
+
+static const uint32_t STREAM_VERSION = 1;
+// Keeps a single snapshot from getting too big to keep up with.
+static const uint32_t STREAM_MAX_MEMORY = 64 * 1024;
+
+enum class StreamRecord : uint16_t {
+	CPU = 1,
+	MEMORY = 2,
+	GPU_STATS = 3,
+};
+
+struct WebSocketStreamState : public DebuggerSubscriber {
+	~WebSocketStreamState() override;
+	void Subscribe(DebuggerRequest &req);
+	void Unsubscribe(DebuggerRequest &req);
+
+	void Broadcast(net::WebSocketServer *ws) override;
+
+protected:
+	void Reset();
+	void BeginRecord(StreamRecord type);
+	void EndRecord();
+	void PushU32(uint32_t v);
+	void AddCPU();
+	void AddMemory();
+	bool AddGPUStats();
+
+	bool active_ = false;
+	bool cpu_ = false;
+	bool gpuStats_ = false;
+	uint32_t memoryAddress_ = 0;
+	uint32_t memorySize_ = 0;
+	uint32_t interval_ = 1;
+	int lastFrame_ = -1;
+
+	std::vector<uint8_t> buf_;
+	size_t recordStart_ = 0;
+	uint16_t recordCount_ = 0;
+};
+
+DebuggerSubscriber *WebSocketStreamInit(DebuggerEventHandlerMap &map) {
+	auto p = new WebSocketStreamState();
+	map["stream.subscribe"] = std::bind(&WebSocketStreamState::Subscribe, p, std::placeholders::_1);
+	map["stream.unsubscribe"] = std::bind(&WebSocketStreamState::Unsubscribe, p, std::placeholders::_1);
+
+	return p;
+}
+
+WebSocketStreamState::~WebSocketStreamState() {
+	Reset();
+}
+
+void WebSocketStreamState::Reset() {
+	if (active_ && gpuStats_)
+		Core_ForceDebugStats(false);
+	active_ = false;
+	cpu_ = false;
+	gpuStats_ = false;
+	memorySize_ = 0;
+}
+
+// Start streaming binary snapshots (stream.subscribe)
+//
+// Parameters:
+//  - cpu: optional boolean, whether to include CPU registers.
+//  - gpuStats: optional boolean, whether to include GPU stats.  Collects them even if not shown.
+//  - memoryAddress: optional number, start of a memory range to include.
+//  - memorySize: optional number of bytes at memoryAddress to include, at most 65536.
+//  - interval: optional number of frames between snapshots, default 1 (every frame.)
+//
+// Response (same event name):
+//  - version: number indicating the binary format version.
+//
+// Binary messages follow, one per snapshot, as described at the top of StreamSubscriber.cpp.
+// Subscribing again replaces the previous subscription.
+void WebSocketStreamState::Subscribe(DebuggerRequest &req) {
+	bool cpu = false;
+	bool gpuStats = false;
+	uint32_t memoryAddress = 0;
+	uint32_t memorySize = 0;
+	uint32_t interval = 1;
+	if (!req.ParamBool("cpu", &cpu, DebuggerParamType::OPTIONAL))
+		return;
+	if (!req.ParamBool("gpuStats", &gpuStats, DebuggerParamType::OPTIONAL))
+		return;
+	if (!req.ParamU32("memoryAddress", &memoryAddress, false, DebuggerParamType::OPTIONAL))
+		return;
+	if (!req.ParamU32("memorySize", &memorySize, false, DebuggerParamType::OPTIONAL))
+		return;
+	if (!req.ParamU32("interval", &interval, false, DebuggerParamType::OPTIONAL))
+		return;
+
+	if (memorySize > STREAM_MAX_MEMORY)
+		return req.Fail("Memory range too large");
+	if (memorySize != 0 && !Memory::IsValidRange(memoryAddress, memorySize))
+		return req.Fail("Invalid memory range");
+	if (!cpu && !gpuStats && memorySize == 0)
+		return req.Fail("Nothing to stream");
+
+	Reset();
+	active_ = true;
+	cpu_ = cpu;
+	gpuStats_ = gpuStats;
+	memoryAddress_ = memoryAddress;
+	memorySize_ = memorySize;
+	interval_ = std::max(interval, 1U);
+	lastFrame_ = -1;
+	if (gpuStats_)
+		Core_ForceDebugStats(true);
+
+	JsonWriter &json = req.Respond();
+	json.writeUint("version", STREAM_VERSION);
+}
+
+// Stop streaming binary snapshots (stream.unsubscribe)
+//
+// No parameters.
+//
+// Response (same event name) with no extra data.
+void WebSocketStreamState::Unsubscribe(DebuggerRequest &req) {
+	Reset();
+	req.Respond();
+}
+
+void WebSocketStreamState::PushU32(uint32_t v) {
+	buf_.push_back((uint8_t)(v >> 0));
+	buf_.push_back((uint8_t)(v >> 8));
+	buf_.push_back((uint8_t)(v >> 16));
+	buf_.push_back((uint8_t)(v >> 24));
+}
+
+void WebSocketStreamState::BeginRecord(StreamRecord type) {
+	recordStart_ = buf_.size();
+	PushU32((uint32_t)type);
+	// Size, filled in by EndRecord().
+	PushU32(0);
+}
+
+void WebSocketStreamState::EndRecord() {
+	uint32_t size = (uint32_t)(buf_.size() - recordStart_ - 8);
+	for (int i = 0; i < 4; ++i)
+		buf_[recordStart_ + 4 + i] = (uint8_t)(size >> (i * 8));
+	recordCount_++;
+}
+
+void WebSocketStreamState::AddCPU() {
+	BeginRecord(StreamRecord::CPU);
+	PushU32(currentMIPS->pc);
+	PushU32(currentMIPS->hi);
+	PushU32(currentMIPS->lo);
+	PushU32(currentMIPS->fcr31);
+	for (int i = 0; i < 32; ++i)
+		PushU32(currentMIPS->r[i]);
+	for (int i = 0; i < 32; ++i)
+		PushU32(currentMIPS->fi[i]);
+	EndRecord();
+}
+
+void WebSocketStreamState::AddMemory() {
+	// Memory may have been reinited with a different size since subscribing.
+	if (!Memory::IsValidRange(memoryAddress_, memorySize_))
+		return;
+	BeginRecord(StreamRecord::MEMORY);
+	PushU32(memoryAddress_);
+	const u8 *src = Memory::GetPointer(memoryAddress_);
+	buf_.insert(buf_.end(), src, src + memorySize_);
+	EndRecord();
+}
+
+bool WebSocketStreamState::AddGPUStats() {
+	GPUStatistics stats;
+	if (!Core_GetLastFrameGPUStats(&stats))
+		return false;
+
+	BeginRecord(StreamRecord::GPU_STATS);
+	PushU32(stats.numDrawCalls);
+	PushU32(stats.numCachedDrawCalls);
+	PushU32(stats.numFlushes);
+	PushU32(stats.numVertsSubmitted);
+	PushU32(stats.numTextureSwitches);
+	PushU32(stats.numShaderSwitches);
+	PushU32(stats.numTexturesDecoded);
+	PushU32(stats.numReadbacks);
+	PushU32(stats.numUploads);
+	PushU32(stats.numClears);
+	PushU32(stats.numShadersCompiled);
+	float ms = (float)stats.msProcessingDisplayLists;
+	uint32_t msBits;
+	memcpy(&msBits, &ms, sizeof(msBits));
+	PushU32(msBits);
+	EndRecord();
+	return true;
+}
+
+void WebSocketStreamState::Broadcast(net::WebSocketServer *ws) {
+	if (!active_ || !PSP_IsInited())
+		return;
+
+	// Only once per frame, or less often, however often we're polled.
+	int frame = gpuStats.numFlips;
+	if (lastFrame_ != -1 && (uint32_t)(frame - lastFrame_) < interval_)
+		return;
+	lastFrame_ = frame;
+
+	buf_.clear();
+	recordCount_ = 0;
+	buf_.push_back('P');
+	buf_.push_back('P');
+	buf_.push_back('S');
+	buf_.push_back('T');
+	// Version and record count, the count filled in below.
+	PushU32(STREAM_VERSION);
+	PushU32((uint32_t)frame);
+
+	if (cpu_)
+		AddCPU();
+	if (memorySize_ != 0)
+		AddMemory();
+	if (gpuStats_)
+		AddGPUStats();
+
+	if (recordCount_ == 0)
+		return;
+	buf_[6] = (uint8_t)(recordCount_ >> 0);
+	buf_[7] = (uint8_t)(recordCount_ >> 8);
+	ws->Send(buf_);
+}
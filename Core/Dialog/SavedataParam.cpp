@@ -59,6 +59,11 @@ namespace
 		truncate_cpy(str, strLength, value.c_str());
 	}
 
+	bool SameTime(const tm &a, const tm &b)
+	{
+		return a.tm_sec == b.tm_sec && a.tm_min == b.tm_min && a.tm_hour == b.tm_hour && a.tm_mday == b.tm_mday && a.tm_mon == b.tm_mon && a.tm_year == b.tm_year;
+	}
+
 	bool ReadPSPFile(std::string filename, u8 **data, s64 dataSize, s64 *readSize)
 	{
 		u32 handle = pspFileSystem.OpenFile(filename, FILEACCESS_READ);
@@ -333,6 +338,7 @@ bool SavedataParam::Delete(SceUtilitySavedataParam* param, int saveId) {
 	}
 
 	pspFileSystem.RmDir(dirPath);
+	InvalidateSaveDirCache(dirPath);
 	return true;
 }
 
@@ -354,6 +360,7 @@ int  SavedataParam::DeleteData(SceUtilitySavedataParam* param) {
 	PSPFileInfo info = pspFileSystem.GetFileInfo(filename);
 	if (info.exists) {
 		pspFileSystem.RemoveFile(filename);
+		InvalidateSaveDirCache(savePath + subFolder);
 	}
 	return 0;
 }
@@ -389,6 +396,7 @@ int SavedataParam::Save(SceUtilitySavedataParam* param, const std::string &saveD
 	}
 
 	std::string dirPath = GetSaveFilePath(param, GetSaveDir(param, saveDirName));
+	InvalidateSaveDirCache(dirPath);
 
 	if (!pspFileSystem.GetFileInfo(dirPath).exists) {
 		if (!pspFileSystem.MkDir(dirPath)) {
@@ -1114,7 +1122,7 @@ bool SavedataParam::GetList(SceUtilitySavedataParam *param)
 
 		std::vector<PSPFileInfo> validDir;
 		std::vector<PSPFileInfo> sfoFiles;
-		std::vector<PSPFileInfo> allDir = pspFileSystem.GetDirListing(savePath);
+		const std::vector<PSPFileInfo> &allDir = GetSaveDirListing();
 
 		if (param->idList.IsValid())
 		{
@@ -1404,7 +1412,7 @@ int SavedataParam::SetPspParam(SceUtilitySavedataParam *param)
 				if (strncmp(saveNameListData[i], "<>", ARRAY_SIZE(saveNameListData[i])) == 0) {
 					std::string fileDataPath = "";				
 					// TODO:Maybe we need a way to reorder the files?
-					auto allSaves = pspFileSystem.GetDirListing(savePath);
+					const auto &allSaves = GetSaveDirListing();
 					std::string gameName = GetGameName(param);
 					std::string saveName = "";
 					for(auto it = allSaves.begin(); it != allSaves.end(); ++it) {
@@ -1517,20 +1525,51 @@ void SavedataParam::SetFileInfo(SaveFileInfo &saveInfo, PSPFileInfo &info, std::
 		saveInfo.texture = new PPGeImage(fileDataPath2);
 
 	// Load info in PARAM.SFO
-	fileDataPath2 = savePath + GetGameName(pspParam) + saveName + "/" + SFO_FILENAME;
+	const std::string dirPath = savePath + GetGameName(pspParam) + saveName;
+	fileDataPath2 = dirPath + "/" + SFO_FILENAME;
 	info2 = pspFileSystem.GetFileInfo(fileDataPath2);
 	if (info2.exists)
 	{
-		std::vector<u8> sfoData;
-		pspFileSystem.ReadEntireFile(fileDataPath2, sfoData);
-		ParamSFOData sfoFile;
-		if (sfoFile.ReadSFO(sfoData))
+		auto cached = sfoInfoCache.find(dirPath);
+		if (cached == sfoInfoCache.end() || cached->second.size != info2.size || !SameTime(cached->second.mtime, info2.mtime))
 		{
-			SetStringFromSFO(sfoFile, "TITLE", saveInfo.title, sizeof(saveInfo.title));
-			SetStringFromSFO(sfoFile, "SAVEDATA_TITLE", saveInfo.saveTitle, sizeof(saveInfo.saveTitle));
-			SetStringFromSFO(sfoFile, "SAVEDATA_DETAIL", saveInfo.saveDetail, sizeof(saveInfo.saveDetail));
+			CachedSFOInfo sfoInfo{ info2.size, info2.mtime };
+			std::vector<u8> sfoData;
+			pspFileSystem.ReadEntireFile(fileDataPath2, sfoData);
+			ParamSFOData sfoFile;
+			if (sfoFile.ReadSFO(sfoData))
+			{
+				sfoInfo.title = sfoFile.GetValueString("TITLE");
+				sfoInfo.saveTitle = sfoFile.GetValueString("SAVEDATA_TITLE");
+				sfoInfo.saveDetail = sfoFile.GetValueString("SAVEDATA_DETAIL");
+			}
+			sfoInfoCache[dirPath] = sfoInfo;
+			cached = sfoInfoCache.find(dirPath);
 		}
+		truncate_cpy(saveInfo.title, sizeof(saveInfo.title), cached->second.title.c_str());
+		truncate_cpy(saveInfo.saveTitle, sizeof(saveInfo.saveTitle), cached->second.saveTitle.c_str());
+		truncate_cpy(saveInfo.saveDetail, sizeof(saveInfo.saveDetail), cached->second.saveDetail.c_str());
+	}
+}
+
+const std::vector<PSPFileInfo> &SavedataParam::GetSaveDirListing()
+{
+	// Adding or removing a folder touches the folder's own time, which is much cheaper to check.
+	PSPFileInfo info = pspFileSystem.GetFileInfo(savePath);
+	if (!saveDirListingValid || !SameTime(info.mtime, saveDirListingTime))
+	{
+		saveDirListing = pspFileSystem.GetDirListing(savePath);
+		saveDirListingTime = info.mtime;
+		saveDirListingValid = true;
 	}
+	return saveDirListing;
+}
+
+void SavedataParam::InvalidateSaveDirCache(const std::string &dirPath)
+{
+	// The time only has seconds, so a quick rewrite wouldn't show up.
+	saveDirListingValid = false;
+	sfoInfoCache.erase(dirPath);
 }
 
 void SavedataParam::SetFileInfo(int idx, PSPFileInfo &info, std::string saveName)
@@ -1725,6 +1764,8 @@ void SavedataParam::DoState(PointerWrap &p)
 		return;
 
 	// pspParam is handled in PSPSaveDialog.
+	saveDirListingValid = false;
+	sfoInfoCache.clear();
 	p.Do(selectedSave);
 	p.Do(saveDataListCount);
 	p.Do(saveNameListDataCount);
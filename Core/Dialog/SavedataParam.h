@@ -17,17 +17,19 @@
 
 #pragma once
 
+#include <map>
+
 #include "Common/CommonTypes.h"
 #include "Core/MemMap.h"
 #include "Core/HLE/sceRtc.h"
 #include "Core/Dialog/PSPDialog.h"
+#include "Core/FileSystems/FileSystem.h"
 
 #undef st_ctime
 #undef st_atime
 #undef st_mtime
 
 class PPGeImage;
-struct PSPFileInfo;
 typedef u32_le SceSize_le;
 
 enum SceUtilitySavedataType
@@ -359,6 +361,8 @@ class SavedataParam
 	void SetFileInfo(int idx, PSPFileInfo &info, std::string saveName);
 	void SetFileInfo(SaveFileInfo &saveInfo, PSPFileInfo &info, std::string saveName);
 	void ClearFileInfo(SaveFileInfo &saveInfo, const std::string &saveName);
+	const std::vector<PSPFileInfo> &GetSaveDirListing();
+	void InvalidateSaveDirCache(const std::string &dirPath);
 
 	int LoadSaveData(SceUtilitySavedataParam *param, const std::string &saveDirName, const std::string& dirPath, bool secureMode);
 	void LoadCryptedSave(SceUtilitySavedataParam *param, u8 *data, const u8 *saveData, int &saveSize, int prevCryptMode, const u8 *expectedHash, bool &saveDone);
@@ -382,4 +386,19 @@ class SavedataParam
 	SaveFileInfo *noSaveIcon;
 	int saveDataListCount;
 	int saveNameListDataCount;
+
+	// Games with many slots list every folder on each request, so keep the listing until it changes.
+	std::vector<PSPFileInfo> saveDirListing;
+	tm saveDirListingTime;
+	bool saveDirListingValid = false;
+
+	// Titles from each save folder's PARAM.SFO, by folder path.
+	struct CachedSFOInfo {
+		s64 size;
+		tm mtime;
+		std::string title;
+		std::string saveTitle;
+		std::string saveDetail;
+	};
+	std::map<std::string, CachedSFOInfo> sfoInfoCache;
 };
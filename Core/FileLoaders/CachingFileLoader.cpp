@@ -268,6 +268,7 @@ void CachingFileLoader::StartReadAhead(s64 pos) {
 		aheadThread_.join();
 	aheadThread_ = std::thread([this, pos] {
 		setCurrentThreadName("FileLoaderReadAhead");
+		setCurrentThreadRole(ThreadRole::BACKGROUND);
 
 		std::unique_lock<std::recursive_mutex> guard(blocksMutex_);
 		s64 cacheStartPos = pos >> BLOCK_SHIFT;
@@ -23,12 +23,17 @@
 
 #include "file/file_util.h"
 #include "file/free.h"
+#include "thread/threadutil.h"
 #include "util/text/utf8.h"
 #include "Common/FileUtil.h"
 #include "Common/CommonWindows.h"
 #include "Core/FileLoaders/DiskCachingFileLoader.h"
 #include "Core/System.h"
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 static const char *CACHEFILE_MAGIC = "ppssppDC";
 static const s64 SAFETY_FREE_DISK_SPACE = 768 * 1024 * 1024; // 768 MB
 // Aim to allow this many files cached at once.
@@ -41,7 +46,7 @@ std::mutex DiskCachingFileLoader::cachesMutex_;
 
 // Takes ownership of backend.
 DiskCachingFileLoader::DiskCachingFileLoader(FileLoader *backend)
-	: ProxiedFileLoader(backend) {
+	: ProxiedFileLoader(backend), prewarmStarted_(false), prewarmCancel_(false) {
 }
 
 void DiskCachingFileLoader::Prepare() {
@@ -49,16 +54,26 @@ void DiskCachingFileLoader::Prepare() {
 		filesize_ = ProxiedFileLoader::FileSize();
 		if (filesize_ > 0) {
 			InitCache();
+			StartPrewarm();
 		}
 	});
 }
 
 DiskCachingFileLoader::~DiskCachingFileLoader() {
+	prewarmCancel_ = true;
+	if (prewarmThread_.joinable())
+		prewarmThread_.join();
+
 	if (filesize_ > 0) {
 		ShutdownCache();
 	}
 }
 
+void DiskCachingFileLoader::Cancel() {
+	prewarmCancel_ = true;
+	ProxiedFileLoader::Cancel();
+}
+
 bool DiskCachingFileLoader::Exists() {
 	Prepare();
 	return ProxiedFileLoader::Exists();
@@ -86,15 +101,21 @@ size_t DiskCachingFileLoader::ReadAt(s64 absolutePos, size_t bytes, void *data,
 	}
 
 	if (cache_ && cache_->IsValid() && (flags & Flags::HINT_UNCACHED) == 0) {
+		// In case another loader was prewarming and gave up.
+		StartPrewarm();
+
 		readSize = cache_->ReadFromCache(absolutePos, bytes, data);
 		// While in case the cache size is too small for the entire read.
 		while (readSize < bytes) {
-			readSize += cache_->SaveIntoCache(backend_, absolutePos + readSize, bytes - readSize, (u8 *)data + readSize, flags);
+			size_t bytesSaved = cache_->SaveIntoCache(backend_, absolutePos + readSize, bytes - readSize, (u8 *)data + readSize, flags);
+			readSize += bytesSaved;
 			// If there are already-cached blocks afterward, we have to read them.
+			// Making space may have evicted them, or another thread may have, then we loop to save them again.
 			size_t bytesFromCache = cache_->ReadFromCache(absolutePos + readSize, bytes - readSize, (u8 *)data + readSize);
 			readSize += bytesFromCache;
-			if (bytesFromCache == 0) {
-				// We can't read any more.
+			if (bytesSaved == 0 && bytesFromCache == 0 && readSize < bytes) {
+				// The cache can't help with the rest (maybe it broke), so go straight to the backend.
+				readSize += backend_->ReadAt(absolutePos + readSize, bytes - readSize, (u8 *)data + readSize, flags);
 				break;
 			}
 		}
@@ -131,6 +152,21 @@ void DiskCachingFileLoader::InitCache() {
 	cache_->AddRef();
 }
 
+void DiskCachingFileLoader::StartPrewarm() {
+	// Another loader for the same file may be prewarming, but it might go away before it's done.
+	if (prewarmStarted_ || prewarmCancel_ || !cache_->ClaimPrewarm()) {
+		return;
+	}
+	// Only one thread can win the claim, so this can't race.
+	prewarmStarted_ = true;
+
+	prewarmThread_ = std::thread([this] {
+		setCurrentThreadName("DiskCachePrewarm");
+		setCurrentThreadRole(ThreadRole::BACKGROUND);
+		cache_->Prewarm(backend_, prewarmCancel_);
+	});
+}
+
 void DiskCachingFileLoader::ShutdownCache() {
 	std::lock_guard<std::mutex> guard(cachesMutex_);
 
@@ -184,11 +220,18 @@ void DiskCachingFileLoaderCache::InitCache(const std::string &path) {
 
 void DiskCachingFileLoaderCache::ShutdownCache() {
 	if (f_) {
+		// Keep the longer trace, a short session shouldn't throw away a full boot.
+		std::vector<u32> trace(BOOT_TRACE_BLOCKS, INVALID_INDEX);
+		const std::vector<u32> &recorded = newBootTrace_.size() >= bootTrace_.size() ? newBootTrace_ : bootTrace_;
+		std::copy(recorded.begin(), recorded.end(), trace.begin());
+
 		bool failed = false;
 		if (fseek(f_, sizeof(FileHeader), SEEK_SET) != 0) {
 			failed = true;
 		} else if (fwrite(&index_[0], sizeof(BlockInfo), indexCount_, f_) != indexCount_) {
 			failed = true;
+		} else if (fwrite(&trace[0], sizeof(u32), BOOT_TRACE_BLOCKS, f_) != BOOT_TRACE_BLOCKS) {
+			failed = true;
 		} else if (fflush(f_) != 0) {
 			failed = true;
 		}
@@ -203,11 +246,15 @@ void DiskCachingFileLoaderCache::ShutdownCache() {
 
 	index_.clear();
 	blockIndexLookup_.clear();
+	blockSeq_.clear();
+	bootTrace_.clear();
+	newBootTrace_.clear();
+	traced_.clear();
 	cacheSize_ = 0;
 }
 
 size_t DiskCachingFileLoaderCache::ReadFromCache(s64 pos, size_t bytes, void *data) {
-	std::lock_guard<std::mutex> guard(lock_);
+	std::unique_lock<std::mutex> guard(lock_);
 
 	if (!f_) {
 		return 0;
@@ -220,6 +267,9 @@ size_t DiskCachingFileLoaderCache::ReadFromCache(s64 pos, size_t bytes, void *da
 	u8 *p = (u8 *)data;
 
 	for (s64 i = cacheStartPos; i <= cacheEndPos; ++i) {
+		if (!f_) {
+			return readSize;
+		}
 		auto &info = index_[i];
 		if (info.block == INVALID_BLOCK) {
 			return readSize;
@@ -228,9 +278,34 @@ size_t DiskCachingFileLoaderCache::ReadFromCache(s64 pos, size_t bytes, void *da
 		if (info.hits < std::numeric_limits<u16>::max()) {
 			++info.hits;
 		}
+		TraceBlock((u32)i);
 
+		const u32 block = info.block;
+		const u32 seq = blockSeq_[block];
 		size_t toRead = std::min(bytes - readSize, (size_t)blockSize_ - offset);
-		if (!ReadBlockData(p + readSize, info, offset, toRead)) {
+
+#ifndef _WIN32
+		// Positional reads don't move the stream, so other threads can use the cache meanwhile.
+		++activeReads_;
+		guard.unlock();
+#endif
+		bool success = ReadBlockData(p + readSize, block, offset, toRead);
+#ifndef _WIN32
+		guard.lock();
+		if (--activeReads_ == 0 && closingFile_) {
+			fclose(closingFile_);
+			closingFile_ = nullptr;
+			fd_ = 0;
+		}
+#endif
+
+		if (!success) {
+			ERROR_LOG(LOADER, "Unable to read disk cache data entry.");
+			CloseFileHandle();
+			return readSize;
+		}
+		if (blockSeq_[block] != seq) {
+			// Evicted and reused while we were reading, so this might be another block's data.
 			return readSize;
 		}
 		readSize += toRead;
@@ -242,9 +317,14 @@ size_t DiskCachingFileLoaderCache::ReadFromCache(s64 pos, size_t bytes, void *da
 }
 
 size_t DiskCachingFileLoaderCache::SaveIntoCache(FileLoader *backend, s64 pos, size_t bytes, void *data, FileLoader::Flags flags) {
-	std::lock_guard<std::mutex> guard(lock_);
+	return SaveBlocks(backend, pos, bytes, data, flags, true);
+}
+
+size_t DiskCachingFileLoaderCache::SaveBlocks(FileLoader *backend, s64 pos, size_t bytes, void *data, FileLoader::Flags flags, bool trace) {
+	std::unique_lock<std::mutex> guard(lock_);
 
 	if (!f_) {
+		guard.unlock();
 		// Just to keep things working.
 		return backend->ReadAt(pos, bytes, data, flags);
 	}
@@ -261,56 +341,59 @@ size_t DiskCachingFileLoaderCache::SaveIntoCache(FileLoader *backend, s64 pos, s
 		if (info.block != INVALID_BLOCK) {
 			break;
 		}
+		if (trace) {
+			TraceBlock((u32)i);
+		}
 		++blocksToRead;
 		if (blocksToRead >= MAX_BLOCKS_PER_READ) {
 			break;
 		}
 	}
 
-	if (!MakeCacheSpaceFor(blocksToRead) || blocksToRead == 0) {
+	if (blocksToRead == 0) {
 		return 0;
 	}
 
-	if (blocksToRead == 1) {
-		auto &info = index_[cacheStartPos];
+	// The backend may be slow (it's usually http), so let others hit the cache meanwhile.
+	guard.unlock();
+	u8 *wholeRead = new u8[blocksToRead * blockSize_];
+	size_t readBytes = backend->ReadAt(cacheStartPos * (u64)blockSize_, blocksToRead * blockSize_, wholeRead, flags);
+	guard.lock();
 
-		u8 *buf = new u8[blockSize_];
-		size_t readBytes = backend->ReadAt(cacheStartPos * (u64)blockSize_, blockSize_, buf, flags);
+	// Check if any were written while we were busy.  Decide before making space, which might evict those.
+	bool save[MAX_BLOCKS_PER_READ];
+	size_t blocksToSave = 0;
+	for (size_t i = 0; i < blocksToRead; ++i) {
+		save[i] = readBytes != 0 && index_[cacheStartPos + i].block == INVALID_BLOCK;
+		if (save[i]) {
+			++blocksToSave;
+		}
+	}
+	if (f_ && blocksToSave != 0) {
+		MakeCacheSpaceFor(blocksToSave);
+	}
 
-		// Check if it was written while we were busy.  Might happen if we thread.
-		if (info.block == INVALID_BLOCK && readBytes != 0) {
-			info.block = AllocateBlock((u32)cacheStartPos);
-			WriteBlockData(info, buf);
-			WriteIndexData((u32)cacheStartPos, info);
+	for (size_t i = 0; i < blocksToRead; ++i) {
+		auto &info = index_[cacheStartPos + i];
+		if (f_ && save[i]) {
+			info.block = AllocateBlock((u32)cacheStartPos + (u32)i);
+			if (!trace) {
+				// Prewarmed, so no one has read it yet, but it shouldn't be the first to go either.
+				info.generation = generation_;
+			}
+			WriteBlockData(info, wholeRead + (i * blockSize_));
+			// TODO: Doing each index together would probably be better.
+			WriteIndexData((u32)cacheStartPos + (u32)i, info);
+			++cacheSize_;
 		}
 
 		size_t toRead = std::min(bytes - readSize, (size_t)blockSize_ - offset);
-		memcpy(p + readSize, buf + offset, toRead);
+		memcpy(p + readSize, wholeRead + (i * blockSize_) + offset, toRead);
 		readSize += toRead;
-
-		delete [] buf;
-	} else {
-		u8 *wholeRead = new u8[blocksToRead * blockSize_];
-		size_t readBytes = backend->ReadAt(cacheStartPos * (u64)blockSize_, blocksToRead * blockSize_, wholeRead, flags);
-
-		for (size_t i = 0; i < blocksToRead; ++i) {
-			auto &info = index_[cacheStartPos + i];
-			// Check if it was written while we were busy.  Might happen if we thread.
-			if (info.block == INVALID_BLOCK && readBytes != 0) {
-				info.block = AllocateBlock((u32)cacheStartPos + (u32)i);
-				WriteBlockData(info, wholeRead + (i * blockSize_));
-				// TODO: Doing each index together would probably be better.
-				WriteIndexData((u32)cacheStartPos + (u32)i, info);
-			}
-
-			size_t toRead = std::min(bytes - readSize, (size_t)blockSize_ - offset);
-			memcpy(p + readSize, wholeRead + (i * blockSize_) + offset, toRead);
-			readSize += toRead;
-		}
-		delete[] wholeRead;
+		offset = 0;
 	}
+	delete[] wholeRead;
 
-	cacheSize_ += blocksToRead;
 	++generation_;
 
 	if (generation_ == std::numeric_limits<u16>::max()) {
@@ -320,6 +403,13 @@ size_t DiskCachingFileLoaderCache::SaveIntoCache(FileLoader *backend, s64 pos, s
 	return readSize;
 }
 
+void DiskCachingFileLoaderCache::TraceBlock(u32 indexPos) {
+	if (newBootTrace_.size() < BOOT_TRACE_BLOCKS && !traced_[indexPos]) {
+		traced_[indexPos] = true;
+		newBootTrace_.push_back(indexPos);
+	}
+}
+
 bool DiskCachingFileLoaderCache::MakeCacheSpaceFor(size_t blocks) {
 	size_t goal = (size_t)maxBlocks_ - blocks;
 
@@ -388,6 +478,8 @@ u32 DiskCachingFileLoaderCache::AllocateBlock(u32 indexPos) {
 	for (size_t i = 0; i < blockIndexLookup_.size(); ++i) {
 		if (blockIndexLookup_[i] == INVALID_INDEX) {
 			blockIndexLookup_[i] = indexPos;
+			// Any read of its old contents still in progress must not use what it got.
+			++blockSeq_[i];
 			return (u32)i;
 		}
 	}
@@ -424,40 +516,35 @@ std::string DiskCachingFileLoaderCache::MakeCacheFilePath(const std::string &pat
 
 s64 DiskCachingFileLoaderCache::GetBlockOffset(u32 block) {
 	// This is where the blocks start.
-	s64 blockOffset = (s64)sizeof(FileHeader) + (s64)indexCount_ * (s64)sizeof(BlockInfo);
+	s64 blockOffset = (s64)sizeof(FileHeader) + (s64)indexCount_ * (s64)sizeof(BlockInfo) + (s64)BOOT_TRACE_BLOCKS * (s64)sizeof(u32);
 	// Now to the actual block.
 	return blockOffset + (s64)block * (s64)blockSize_;
 }
 
-bool DiskCachingFileLoaderCache::ReadBlockData(u8 *dest, BlockInfo &info, size_t offset, size_t size) {
-	if (!f_) {
-		return false;
-	}
-	s64 blockOffset = GetBlockOffset(info.block);
+bool DiskCachingFileLoaderCache::ReadBlockData(u8 *dest, u32 block, size_t offset, size_t size) {
+	s64 blockOffset = GetBlockOffset(block) + (s64)offset;
 
+	bool failed = false;
+#ifdef _WIN32
 	// Before we read, make sure the buffers are flushed.
 	// We might be trying to read an area we've recently written.
 	fflush(f_);
 
-	bool failed = false;
-#ifdef __ANDROID__
-	if (lseek64(fd_, blockOffset, SEEK_SET) != blockOffset) {
+	if (fseeko(f_, blockOffset, SEEK_SET) != 0) {
 		failed = true;
-	} else if (read(fd_, dest + offset, size) != (ssize_t)size) {
+	} else if (fread(dest, size, 1, f_) != 1) {
 		failed = true;
 	}
-#else
-	if (fseeko(f_, blockOffset, SEEK_SET) != 0) {
+#elif defined(__ANDROID__)
+	if (pread64(fd_, dest, size, blockOffset) != (ssize_t)size) {
 		failed = true;
-	} else if (fread(dest + offset, size, 1, f_) != 1) {
+	}
+#else
+	if (pread(fd_, dest, size, blockOffset) != (ssize_t)size) {
 		failed = true;
 	}
 #endif
 
-	if (failed) {
-		ERROR_LOG(LOADER, "Unable to read disk cache data entry.");
-		CloseFileHandle();
-	}
 	return !failed;
 }
 
@@ -468,16 +555,19 @@ void DiskCachingFileLoaderCache::WriteBlockData(BlockInfo &info, u8 *src) {
 	s64 blockOffset = GetBlockOffset(info.block);
 
 	bool failed = false;
-#ifdef __ANDROID__
-	if (lseek64(fd_, blockOffset, SEEK_SET) != blockOffset) {
+#ifdef _WIN32
+	if (fseeko(f_, blockOffset, SEEK_SET) != 0) {
 		failed = true;
-	} else if (write(fd_, src, blockSize_) != (ssize_t)blockSize_) {
+	} else if (fwrite(src, blockSize_, 1, f_) != 1) {
 		failed = true;
 	}
-#else
-	if (fseeko(f_, blockOffset, SEEK_SET) != 0) {
+#elif defined(__ANDROID__)
+	if (pwrite64(fd_, src, blockSize_, blockOffset) != (ssize_t)blockSize_) {
 		failed = true;
-	} else if (fwrite(src, blockSize_, 1, f_) != 1) {
+	}
+#else
+	// Unbuffered, so reads outside the lock see it right away.
+	if (pwrite(fd_, src, blockSize_, blockOffset) != (ssize_t)blockSize_) {
 		failed = true;
 	}
 #endif
@@ -533,8 +623,8 @@ bool DiskCachingFileLoaderCache::LoadCacheFile(const std::string &path) {
 	if (valid) {
 		f_ = fp;
 
-#ifdef __ANDROID__
-		// Android NDK does not support 64-bit file I/O using C streams
+#ifndef _WIN32
+		// Block data uses positional I/O, also since Android NDK does not support 64-bit file I/O using C streams.
 		fd_ = fileno(f_);
 #endif
 
@@ -567,13 +657,29 @@ void DiskCachingFileLoaderCache::LoadCacheIndex() {
 		return;
 	}
 
+	std::vector<u32> trace(BOOT_TRACE_BLOCKS);
+	if (fread(&trace[0], sizeof(u32), BOOT_TRACE_BLOCKS, f_) != BOOT_TRACE_BLOCKS) {
+		CloseFileHandle();
+		return;
+	}
+	bootTrace_.clear();
+	for (u32 indexPos : trace) {
+		if (indexPos >= indexCount_) {
+			break;
+		}
+		bootTrace_.push_back(indexPos);
+	}
+	newBootTrace_.clear();
+	traced_.assign(indexCount_, false);
+	blockSeq_.assign(maxBlocks_, 0);
+
 	// Now let's set some values we need.
 	oldestGeneration_ = std::numeric_limits<u16>::max();
 	generation_ = 0;
 	cacheSize_ = 0;
 
 	for (size_t i = 0; i < index_.size(); ++i) {
-		if (index_[i].block > maxBlocks_) {
+		if (index_[i].block >= maxBlocks_) {
 			index_[i].block = INVALID_BLOCK;
 		}
 		if (index_[i].block == INVALID_BLOCK) {
@@ -611,8 +717,8 @@ void DiskCachingFileLoaderCache::CreateCacheFile(const std::string &path) {
 		ERROR_LOG(LOADER, "Could not create disk cache file");
 		return;
 	}
-#ifdef __ANDROID__
-	// Android NDK does not support 64-bit file I/O using C streams
+#ifndef _WIN32
+	// Block data uses positional I/O, also since Android NDK does not support 64-bit file I/O using C streams.
 	fd_ = fileno(f_);
 #endif
 
@@ -641,6 +747,17 @@ void DiskCachingFileLoaderCache::CreateCacheFile(const std::string &path) {
 		CloseFileHandle();
 		return;
 	}
+
+	std::vector<u32> trace(BOOT_TRACE_BLOCKS, INVALID_INDEX);
+	if (fwrite(&trace[0], sizeof(u32), BOOT_TRACE_BLOCKS, f_) != BOOT_TRACE_BLOCKS) {
+		CloseFileHandle();
+		return;
+	}
+	bootTrace_.clear();
+	newBootTrace_.clear();
+	traced_.assign(indexCount_, false);
+	blockSeq_.assign(maxBlocks_, 0);
+
 	if (fflush(f_) != 0) {
 		CloseFileHandle();
 		return;
@@ -714,13 +831,19 @@ bool DiskCachingFileLoaderCache::RemoveCacheFile(const std::string &path) {
 
 void DiskCachingFileLoaderCache::CloseFileHandle() {
 	if (f_) {
-		fclose(f_);
+		if (activeReads_ != 0) {
+			// Someone's still reading from it, the last one out will close it.
+			closingFile_ = f_;
+		} else {
+			fclose(f_);
+			fd_ = 0;
+		}
 	}
 	f_ = nullptr;
-	fd_ = 0;
 }
 
 bool DiskCachingFileLoaderCache::HasData() const {
+	std::lock_guard<std::mutex> guard(lock_);
 	if (!f_) {
 		return false;
 	}
@@ -733,6 +856,54 @@ bool DiskCachingFileLoaderCache::HasData() const {
 	return false;
 }
 
+bool DiskCachingFileLoaderCache::ClaimPrewarm() {
+	std::lock_guard<std::mutex> guard(lock_);
+	if (!f_ || bootTrace_.empty() || prewarmRunning_ || prewarmDone_) {
+		return false;
+	}
+	prewarmRunning_ = true;
+	return true;
+}
+
+void DiskCachingFileLoaderCache::Prewarm(FileLoader *backend, const std::atomic<bool> &cancel) {
+	std::vector<u32> trace;
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		trace = bootTrace_;
+		// Leave room for what the game reads after the recorded part.
+		if (trace.size() > maxBlocks_ / 2) {
+			trace.resize(maxBlocks_ / 2);
+		}
+	}
+
+	INFO_LOG(LOADER, "Prewarming disk cache with %d blocks for %s", (int)trace.size(), origPath_.c_str());
+
+	std::vector<u8> buf(blockSize_);
+	for (u32 indexPos : trace) {
+		if (cancel) {
+			break;
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(lock_);
+			if (!f_) {
+				break;
+			}
+			if (index_[indexPos].block != INVALID_BLOCK) {
+				continue;
+			}
+		}
+
+		s64 pos = (s64)indexPos * (s64)blockSize_;
+		size_t bytes = (size_t)std::min((s64)blockSize_, filesize_ - pos);
+		SaveBlocks(backend, pos, bytes, &buf[0], FileLoader::Flags::NONE, false);
+	}
+
+	std::lock_guard<std::mutex> guard(lock_);
+	prewarmRunning_ = false;
+	prewarmDone_ = !cancel;
+}
+
 u64 DiskCachingFileLoaderCache::FreeDiskSpace() {
 	std::string dir = cacheDir_;
 	if (dir.empty()) {
@@ -17,9 +17,11 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
 #include <map>
 #include <mutex>
+#include <thread>
 
 #include "Common/Common.h"
 #include "Common/Swap.h"
@@ -43,16 +45,24 @@ class DiskCachingFileLoader : public ProxiedFileLoader {
 
 	static std::vector<std::string> GetCachedPathsInUse();
 
+	void Cancel() override;
+
 private:
 	void Prepare();
 	void InitCache();
 	void ShutdownCache();
+	void StartPrewarm();
 
 	std::once_flag preparedFlag_;
 	s64 filesize_ = 0;
 	DiskCachingFileLoaderCache *cache_ = nullptr;
 
-	// We don't support concurrent disk cache access (we use memory cached indexes.)
+	// Fetches the blocks the last boot read, ahead of the game asking for them.
+	std::thread prewarmThread_;
+	std::atomic<bool> prewarmStarted_;
+	std::atomic<bool> prewarmCancel_;
+
+	// Several loaders can share a cache, but two caches can't share a file (we use memory cached indexes.)
 	// So we have to ensure there's only one of these per.
 	static std::map<std::string, DiskCachingFileLoaderCache *> caches_;
 	static std::mutex cachesMutex_;
@@ -79,12 +89,18 @@ class DiskCachingFileLoaderCache {
 		cacheDir_ = path;
 	}
 
+	// These may be called from several threads at once.
 	size_t ReadFromCache(s64 pos, size_t bytes, void *data);
 	// Guaranteed to read at least one block into the cache.
 	size_t SaveIntoCache(FileLoader *backend, s64 pos, size_t bytes, void *data, FileLoader::Flags flags);
 
 	bool HasData() const;
 
+	// Returns true if there's a recorded boot to prewarm from, and no one else is (or was) on it.
+	bool ClaimPrewarm();
+	// Reads the blocks recorded during the last boot into the cache.  If cancelled, it can be claimed again.
+	void Prewarm(FileLoader *backend, const std::atomic<bool> &cancel);
+
 private:
 	void InitCache(const std::string &path);
 	void ShutdownCache();
@@ -93,7 +109,9 @@ class DiskCachingFileLoaderCache {
 	u32 AllocateBlock(u32 indexPos);
 
 	struct BlockInfo;
-	bool ReadBlockData(u8 *dest, BlockInfo &info, size_t offset, size_t size);
+	size_t SaveBlocks(FileLoader *backend, s64 pos, size_t bytes, void *data, FileLoader::Flags flags, bool trace);
+	void TraceBlock(u32 indexPos);
+	bool ReadBlockData(u8 *dest, u32 block, size_t offset, size_t size);
 	void WriteBlockData(BlockInfo &info, u8 *src);
 	void WriteIndexData(u32 indexPos, BlockInfo &info);
 	s64 GetBlockOffset(u32 block);
@@ -123,13 +141,16 @@ class DiskCachingFileLoaderCache {
 	//   32 (fileoffset - headersize) / blockSize -> -1=not present
 	//   16 generation?
 	//   16 hits?
+	// bootTrace[BOOT_TRACE_BLOCKS]
+	//   32 index position, in order of first read -> -1=end
 	// blocks[up to maxBlocks]
 	//   8 * blockSize
 
 	enum {
-		CACHE_VERSION = 3,
+		CACHE_VERSION = 4,
 		DEFAULT_BLOCK_SIZE = 65536,
 		MAX_BLOCKS_PER_READ = 16,
+		BOOT_TRACE_BLOCKS = 1024, // 64 MB
 		MAX_BLOCKS_LOWER_BOUND = 256, // 16 MB
 		MAX_BLOCKS_UPPER_BOUND = 8192, // 512 MB
 		INVALID_BLOCK = 0xFFFFFFFF,
@@ -145,7 +166,8 @@ class DiskCachingFileLoaderCache {
 	u32 flags_;
 	size_t cacheSize_;
 	size_t indexCount_;
-	std::mutex lock_;
+	// Guards everything but the block data reads themselves, which happen outside it where possible.
+	mutable std::mutex lock_;
 	std::string origPath_;
 
 	struct FileHeader {
@@ -172,9 +194,21 @@ class DiskCachingFileLoaderCache {
 
 	std::vector<BlockInfo> index_;
 	std::vector<u32> blockIndexLookup_;
+	// Bumped when a block is given to another index position, so reads racing an eviction are caught.
+	std::vector<u32> blockSeq_;
+
+	// The trace from the last boot, and the one recorded this time.
+	std::vector<u32> bootTrace_;
+	std::vector<u32> newBootTrace_;
+	std::vector<bool> traced_;
+	bool prewarmRunning_ = false;
+	bool prewarmDone_ = false;
 
 	FILE *f_ = nullptr;
 	int fd_ = 0;
+	// Reads in progress outside the lock.  The file is only closed once they're done.
+	int activeReads_ = 0;
+	FILE *closingFile_ = nullptr;
 
 	static std::string cacheDir_;
 };
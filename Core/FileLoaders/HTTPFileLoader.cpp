@@ -16,13 +16,18 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <algorithm>
+#include <cstring>
 
 #include "base/stringutil.h"
+#include "base/timeutil.h"
 #include "Common/Common.h"
 #include "Core/FileLoaders/HTTPFileLoader.h"
 
+// Servers commonly drop idle keep-alive connections after 5-15 seconds, so don't bother reusing older ones.
+static const double CONNECTION_IDLE_TIMEOUT = 4.0;
+
 HTTPFileLoader::HTTPFileLoader(const std::string &filename)
-	: url_(filename), filename_(filename) {
+	: url_(filename), filename_(filename), serverKeepsAlive_(true) {
 }
 
 void HTTPFileLoader::Prepare() {
@@ -147,6 +152,13 @@ int HTTPFileLoader::SendHEAD(const Url &url, std::vector<std::string> &responseH
 
 HTTPFileLoader::~HTTPFileLoader() {
 	Disconnect();
+
+	std::lock_guard<std::mutex> guard(poolMutex_);
+	for (Connection *conn : idleConnections_) {
+		Disconnect(conn);
+		delete conn;
+	}
+	idleConnections_.clear();
 }
 
 bool HTTPFileLoader::Exists() {
@@ -173,40 +185,193 @@ std::string HTTPFileLoader::Path() const {
 }
 
 size_t HTTPFileLoader::ReadAt(s64 absolutePos, size_t bytes, void *data, Flags flags) {
+	ReadRequest request{ absolutePos, bytes, data, 0 };
+	ReadMany(&request, 1, flags);
+	return request.result;
+}
+
+void HTTPFileLoader::ReadMany(ReadRequest *requests, size_t count, Flags flags) {
 	Prepare();
-	std::lock_guard<std::mutex> guard(readAtMutex_);
 
-	s64 absoluteEnd = std::min(absolutePos + (s64)bytes, filesize_);
-	if (absolutePos >= filesize_ || bytes == 0) {
-		// Read outside of the file or no read at all, just fail immediately.
-		return 0;
+	std::vector<ReadRequest *> sorted;
+	sorted.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		requests[i].result = 0;
+		// Reads outside of the file or no read at all just fail immediately.
+		if (requests[i].absolutePos < filesize_ && requests[i].bytes != 0) {
+			sorted.push_back(&requests[i]);
+		}
 	}
+	if (sorted.empty()) {
+		return;
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const ReadRequest *a, const ReadRequest *b) {
+		return a->absolutePos < b->absolutePos;
+	});
 
-	Connect();
-	if (!connected_) {
-		return 0;
+	std::vector<Range> ranges;
+	for (size_t i = 0; i < sorted.size(); ++i) {
+		s64 start = sorted[i]->absolutePos;
+		s64 end = std::min(start + (s64)sorted[i]->bytes, filesize_);
+		if (!ranges.empty()) {
+			Range &last = ranges.back();
+			s64 mergedEnd = std::max(last.end, end);
+			if (start <= last.end + MAX_COALESCE_GAP && mergedEnd - last.start <= MAX_RANGE_SIZE) {
+				last.end = mergedEnd;
+				last.last = i;
+				continue;
+			}
+		}
+		ranges.push_back(Range{ start, end, i, i });
+	}
+
+	Connection *conn = AcquireConnection();
+	if (!conn) {
+		return;
+	}
+
+	bool retried = false;
+	size_t sent = 0;
+	size_t received = 0;
+	std::string output;
+	while (received < ranges.size()) {
+		bool failed = false;
+		const size_t maxPipelined = serverKeepsAlive_ ? MAX_PIPELINED : 1;
+		while (sent < ranges.size() && sent - received < maxPipelined) {
+			if (!SendRangeRequest(conn, ranges[sent])) {
+				failed = true;
+				break;
+			}
+			++sent;
+		}
+
+		const Range &range = ranges[received];
+		bool closing = false;
+		if (!failed && !ReadRangeResponse(conn, range, &output, &closing)) {
+			failed = true;
+		}
+
+		if (failed) {
+			Disconnect(conn);
+			// The server may have dropped a connection we reused, so try once more on a new one.
+			if (retried || !Connect(conn)) {
+				break;
+			}
+			retried = true;
+			sent = received;
+			continue;
+		}
+
+		for (size_t i = range.first; i <= range.last; ++i) {
+			ReadRequest &request = *sorted[i];
+			size_t offset = (size_t)(request.absolutePos - range.start);
+			if (offset < output.size()) {
+				request.result = std::min(request.bytes, output.size() - offset);
+				memcpy(request.data, &output[offset], request.result);
+			}
+		}
+		++received;
+
+		if (closing) {
+			// Anything else we sent won't get an answer.
+			serverKeepsAlive_ = false;
+			Disconnect(conn);
+			if (received < ranges.size() && !Connect(conn)) {
+				break;
+			}
+			sent = received;
+		}
 	}
 
+	ReleaseConnection(conn);
+}
+
+HTTPFileLoader::Connection *HTTPFileLoader::AcquireConnection() {
+	Connection *conn = nullptr;
+	{
+		std::unique_lock<std::mutex> guard(poolMutex_);
+		while (idleConnections_.empty() && connectionCount_ >= MAX_CONNECTIONS) {
+			poolCond_.wait(guard);
+		}
+		if (!idleConnections_.empty()) {
+			// The most recently used is the most likely to still be open.
+			conn = idleConnections_.back();
+			idleConnections_.pop_back();
+		} else {
+			conn = new Connection();
+			++connectionCount_;
+		}
+	}
+
+	if (conn->connected && time_now_d() - conn->lastUsed > CONNECTION_IDLE_TIMEOUT) {
+		Disconnect(conn);
+	}
+	if (!Connect(conn)) {
+		ReleaseConnection(conn);
+		return nullptr;
+	}
+	return conn;
+}
+
+void HTTPFileLoader::ReleaseConnection(Connection *conn) {
+	conn->lastUsed = time_now_d();
+
+	std::lock_guard<std::mutex> guard(poolMutex_);
+	idleConnections_.push_back(conn);
+	poolCond_.notify_one();
+}
+
+bool HTTPFileLoader::Connect(Connection *conn) {
+	if (conn->connected) {
+		return true;
+	}
+
+	if (!conn->client.Resolve(url_.Host().c_str(), url_.Port())) {
+		ERROR_LOG(LOADER, "HTTP request failed, unable to resolve: |%s| port %d", url_.Host().c_str(), url_.Port());
+		latestError_ = "Could not connect (name not resolved)";
+		return false;
+	}
+
+	conn->client.SetDataTimeout(20.0);
+	conn->client.SetKeepAlive(true);
+	conn->readbuf.clear();
+	cancelConnect_ = false;
+	// Latency is important here, so reduce the timeout.
+	conn->connected = conn->client.Connect(3, 10.0, &cancelConnect_);
+	return conn->connected;
+}
+
+void HTTPFileLoader::Disconnect(Connection *conn) {
+	if (conn->connected) {
+		conn->client.Disconnect();
+	}
+	conn->connected = false;
+	conn->readbuf.clear();
+}
+
+bool HTTPFileLoader::SendRangeRequest(Connection *conn, const Range &range) {
 	char requestHeaders[4096];
 	// Note that the Range header is *inclusive*.
 	snprintf(requestHeaders, sizeof(requestHeaders),
-		"Range: bytes=%lld-%lld\r\n", absolutePos, absoluteEnd - 1);
+		"Range: bytes=%lld-%lld\r\n", range.start, range.end - 1);
 
-	int err = client_.SendRequest("GET", url_.Resource().c_str(), requestHeaders, nullptr);
+	int err = conn->client.SendRequest("GET", url_.Resource().c_str(), requestHeaders, nullptr);
 	if (err < 0) {
 		latestError_ = "Invalid response reading data";
-		Disconnect();
-		return 0;
+		return false;
 	}
+	return true;
+}
+
+bool HTTPFileLoader::ReadRangeResponse(Connection *conn, const Range &range, std::string *output, bool *closing) {
+	output->clear();
 
-	Buffer readbuf;
 	std::vector<std::string> responseHeaders;
-	int code = client_.ReadResponseHeaders(&readbuf, responseHeaders);
+	int code = conn->client.ReadResponseHeaders(&conn->readbuf, responseHeaders);
 	if (code != 206) {
 		ERROR_LOG(LOADER, "HTTP server did not respond with range, received code=%03d", code);
 		latestError_ = "Invalid response reading data";
-		Disconnect();
-		return 0;
+		return false;
 	}
 
 	// TODO: Expire cache via ETag, etc.
@@ -219,10 +384,10 @@ size_t HTTPFileLoader::ReadAt(s64 absolutePos, size_t bytes, void *data, Flags f
 			std::string lowerHeader = header;
 			std::transform(lowerHeader.begin(), lowerHeader.end(), lowerHeader.begin(), tolower);
 			if (sscanf(lowerHeader.c_str(), "content-range: bytes %lld-%lld/%lld", &first, &last, &total) >= 2) {
-				if (first == absolutePos && last == absoluteEnd - 1) {
+				if (first == range.start && last == range.end - 1) {
 					supportedResponse = true;
 				} else {
-					ERROR_LOG(LOADER, "Unexpected HTTP range: got %lld-%lld, wanted %lld-%lld.", first, last, absolutePos, absoluteEnd - 1);
+					ERROR_LOG(LOADER, "Unexpected HTTP range: got %lld-%lld, wanted %lld-%lld.", first, last, range.start, range.end - 1);
 				}
 			} else {
 				ERROR_LOG(LOADER, "Unexpected HTTP range response: %s", header.c_str());
@@ -230,27 +395,26 @@ size_t HTTPFileLoader::ReadAt(s64 absolutePos, size_t bytes, void *data, Flags f
 		}
 	}
 
+	*closing = conn->client.ServerClosing();
+
 	// TODO: Would be nice to read directly.
-	Buffer output;
-	int res = client_.ReadResponseEntity(&readbuf, responseHeaders, &output);
+	Buffer entity;
+	int res = conn->client.ReadResponseEntity(&conn->readbuf, responseHeaders, &entity);
 	if (res != 0) {
 		ERROR_LOG(LOADER, "Unable to read HTTP response entity: %d", res);
+		// We don't know where the next response starts now.
+		*closing = true;
 		// Let's take anything we got anyway.  Not worse than returning nothing?
 	}
 
-	// TODO: Keepalive instead.
-	Disconnect();
-
 	if (!supportedResponse) {
 		ERROR_LOG(LOADER, "HTTP server did not respond with the range we wanted.");
 		latestError_ = "Invalid response reading data";
-		return 0;
+		return false;
 	}
 
-	size_t readBytes = output.size();
-	output.Take(readBytes, (char *)data);
-	filepos_ = absolutePos + readBytes;
-	return readBytes;
+	entity.TakeAll(output);
+	return true;
 }
 
 void HTTPFileLoader::Connect() {
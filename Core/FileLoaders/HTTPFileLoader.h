@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
 #include <vector>
 
@@ -44,6 +46,8 @@ class HTTPFileLoader : public FileLoader {
 		return ReadAt(absolutePos, bytes * count, data, flags) / bytes;
 	}
 	virtual size_t ReadAt(s64 absolutePos, size_t bytes, void *data, Flags flags = Flags::NONE) override;
+	// Coalesces nearby reads, and pipelines the range requests on one connection.
+	void ReadMany(ReadRequest *requests, size_t count, Flags flags = Flags::NONE) override;
 
 	void Cancel() override {
 		cancelConnect_ = true;
@@ -54,6 +58,23 @@ class HTTPFileLoader : public FileLoader {
 	}
 
 private:
+	// A keep-alive connection used for reads.  Several can be open, so threads don't wait on each other.
+	struct Connection {
+		http::Client client;
+		// May already hold the start of the next pipelined response.
+		Buffer readbuf;
+		bool connected = false;
+		double lastUsed = 0.0;
+	};
+
+	struct Range {
+		s64 start;
+		s64 end;
+		// Into the sorted requests.
+		size_t first;
+		size_t last;
+	};
+
 	void Prepare();
 	int SendHEAD(const Url &url, std::vector<std::string> &responseHeaders);
 
@@ -66,9 +87,26 @@ class HTTPFileLoader : public FileLoader {
 		connected_ = false;
 	}
 
+	Connection *AcquireConnection();
+	void ReleaseConnection(Connection *conn);
+	bool Connect(Connection *conn);
+	void Disconnect(Connection *conn);
+	bool SendRangeRequest(Connection *conn, const Range &range);
+	// Returns false if the connection can't be used anymore.  closing is set if the server is closing it after this.
+	bool ReadRangeResponse(Connection *conn, const Range &range, std::string *output, bool *closing);
+
+	enum {
+		MAX_CONNECTIONS = 4,
+		// Requests sent ahead on a connection before reading their responses.
+		MAX_PIPELINED = 8,
+		// Reads closer than this are fetched together.
+		MAX_COALESCE_GAP = 16 * 1024,
+		MAX_RANGE_SIZE = 4 * 1024 * 1024,
+	};
+
 	s64 filesize_ = 0;
-	s64 filepos_ = 0;
 	Url url_;
+	// Only used for the initial HEAD.
 	http::Client client_;
 	std::string filename_;
 	bool connected_ = false;
@@ -76,5 +114,11 @@ class HTTPFileLoader : public FileLoader {
 	const char *latestError_ = "";
 
 	std::once_flag preparedFlag_;
-	std::mutex readAtMutex_;
+
+	std::mutex poolMutex_;
+	std::condition_variable poolCond_;
+	std::vector<Connection *> idleConnections_;
+	int connectionCount_ = 0;
+	// Cleared if the server answers with Connection: close, then there's no point sending requests ahead.
+	std::atomic<bool> serverKeepsAlive_;
 };
@@ -15,7 +15,9 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 
 #include "ppsspp_config.h"
 #include "util/text/utf8.h"
@@ -27,6 +29,146 @@
 #include "Common/CommonWindows.h"
 #else
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if PPSSPP_PLATFORM(LINUX) && !PPSSPP_PLATFORM(ANDROID) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <cerrno>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+#ifdef HAVE_IO_URING
+// Just enough of io_uring to submit a batch of reads and wait for them, without liburing.
+struct IORing {
+	enum {
+		ENTRIES = 64,
+	};
+
+	~IORing();
+	bool Init();
+	// Returns how many were queued, the ring may fill up.
+	size_t Queue(int fd, FileLoader::ReadRequest *requests, size_t count, size_t first);
+	bool Wait(FileLoader::ReadRequest *requests, size_t count);
+
+	int fd = -1;
+	void *sqRing = MAP_FAILED;
+	void *cqRing = MAP_FAILED;
+	size_t sqRingSize = 0;
+	size_t cqRingSize = 0;
+	io_uring_sqe *sqes = (io_uring_sqe *)MAP_FAILED;
+	size_t sqesSize = 0;
+
+	u32 *sqHead;
+	u32 *sqTail;
+	u32 sqMask;
+	u32 *sqArray;
+	u32 *cqHead;
+	u32 *cqTail;
+	u32 cqMask;
+	io_uring_cqe *cqes;
+	size_t inFlight = 0;
+};
+
+bool IORing::Init() {
+	io_uring_params params{};
+	fd = (int)syscall(__NR_io_uring_setup, ENTRIES, &params);
+	if (fd < 0)
+		return false;
+
+	sqRingSize = params.sq_off.array + params.sq_entries * sizeof(u32);
+	cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (singleMap)
+		sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+	sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (sqRing == MAP_FAILED)
+		return false;
+	if (singleMap) {
+		cqRing = sqRing;
+	} else {
+		cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if (cqRing == MAP_FAILED)
+			return false;
+	}
+	sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+	sqes = (io_uring_sqe *)mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED)
+		return false;
+
+	u8 *sq = (u8 *)sqRing;
+	sqHead = (u32 *)(sq + params.sq_off.head);
+	sqTail = (u32 *)(sq + params.sq_off.tail);
+	sqMask = *(u32 *)(sq + params.sq_off.ring_mask);
+	sqArray = (u32 *)(sq + params.sq_off.array);
+	u8 *cq = (u8 *)cqRing;
+	cqHead = (u32 *)(cq + params.cq_off.head);
+	cqTail = (u32 *)(cq + params.cq_off.tail);
+	cqMask = *(u32 *)(cq + params.cq_off.ring_mask);
+	cqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+	return true;
+}
+
+IORing::~IORing() {
+	if (sqes != MAP_FAILED)
+		munmap(sqes, sqesSize);
+	if (cqRing != MAP_FAILED && cqRing != sqRing)
+		munmap(cqRing, cqRingSize);
+	if (sqRing != MAP_FAILED)
+		munmap(sqRing, sqRingSize);
+	if (fd >= 0)
+		close(fd);
+}
+
+size_t IORing::Queue(int fileFd, FileLoader::ReadRequest *requests, size_t count, size_t first) {
+	size_t queued = 0;
+	u32 tail = *sqTail;
+	while (first + queued < count && inFlight + queued < ENTRIES) {
+		const size_t i = first + queued;
+		const u32 index = tail & sqMask;
+		io_uring_sqe *sqe = &sqes[index];
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = IORING_OP_READ;
+		sqe->fd = fileFd;
+		sqe->off = requests[i].absolutePos;
+		sqe->addr = (u64)(uintptr_t)requests[i].data;
+		sqe->len = (u32)requests[i].bytes;
+		sqe->user_data = i;
+		sqArray[index] = index;
+		++tail;
+		++queued;
+	}
+	__atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+
+	if (queued != 0 && syscall(__NR_io_uring_enter, fd, (unsigned)queued, 0, 0, nullptr, 0) < 0)
+		return 0;
+	inFlight += queued;
+	return queued;
+}
+
+bool IORing::Wait(FileLoader::ReadRequest *requests, size_t count) {
+	if (syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR)
+		return false;
+
+	u32 head = *cqHead;
+	while (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+		const io_uring_cqe &cqe = cqes[head & cqMask];
+		if (cqe.user_data < count) {
+			FileLoader::ReadRequest &request = requests[cqe.user_data];
+			// Short reads and errors (like an old kernel without IORING_OP_READ) are redone with pread.
+			request.result = cqe.res == (int)request.bytes ? request.bytes : (size_t)-1;
+		}
+		++head;
+		--inFlight;
+	}
+	__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+	return true;
+}
 #endif
 
 LocalFileLoader::LocalFileLoader(const std::string &filename)
@@ -73,14 +215,55 @@ LocalFileLoader::LocalFileLoader(const std::string &filename)
 	filesize_ = end_offset.QuadPart;
 	SetFilePointerEx(handle_, zero, nullptr, FILE_BEGIN);
 #endif // _WIN32
+
+	MapFile();
+}
+
+void LocalFileLoader::MapFile() {
+	// 32-bit hosts can't spare the address space for a whole ISO.
+#if PPSSPP_ARCH(64BIT) && !PPSSPP_PLATFORM(UWP)
+	if (filesize_ == 0 || IsDirectory())
+		return;
+#ifndef _WIN32
+	void *base = mmap(nullptr, filesize_, PROT_READ, MAP_SHARED, fd_, 0);
+	if (base == MAP_FAILED) {
+		WARN_LOG(FILESYS, "Unable to map %s, reading normally", filename_.c_str());
+		return;
+	}
+#else
+	mapping_ = CreateFileMappingW(handle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	void *base = mapping_ ? MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!base) {
+		WARN_LOG(FILESYS, "Unable to map %s, reading normally", filename_.c_str());
+		if (mapping_)
+			CloseHandle(mapping_);
+		mapping_ = nullptr;
+		return;
+	}
+#endif
+	mapped_ = (const u8 *)base;
+#endif
 }
 
 LocalFileLoader::~LocalFileLoader() {
 #ifndef _WIN32
+	if (mapped_) {
+		munmap((void *)mapped_, filesize_);
+	}
 	if (fd_ != -1) {
 		close(fd_);
 	}
+#ifdef HAVE_IO_URING
+	delete ring_;
+#endif
 #else
+	if (mapped_) {
+		UnmapViewOfFile(mapped_);
+		CloseHandle(mapping_);
+	}
+	if (overlappedHandle_ && overlappedHandle_ != INVALID_HANDLE_VALUE) {
+		CloseHandle(overlappedHandle_);
+	}
 	if (handle_ != INVALID_HANDLE_VALUE) {
 		CloseHandle(handle_);
 	}
@@ -117,6 +300,14 @@ std::string LocalFileLoader::Path() const {
 }
 
 size_t LocalFileLoader::ReadAt(s64 absolutePos, size_t bytes, size_t count, void *data, Flags flags) {
+	if (mapped_) {
+		if (absolutePos < 0 || (u64)absolutePos >= filesize_ || bytes == 0)
+			return 0;
+		count = std::min(count, (size_t)((filesize_ - absolutePos) / bytes));
+		memcpy(data, mapped_ + absolutePos, bytes * count);
+		return count;
+	}
+
 #if PPSSPP_PLATFORM(ANDROID)
 	// pread64 doesn't appear to actually be 64-bit safe, though such ISOs are uncommon.  See #10862.
 	if (absolutePos <= 0x7FFFFFFF) {
@@ -146,3 +337,92 @@ size_t LocalFileLoader::ReadAt(s64 absolutePos, size_t bytes, size_t count, void
 	return result == TRUE ? (size_t)read / bytes : -1;
 #endif
 }
+
+void LocalFileLoader::ReadMany(ReadRequest *requests, size_t count, Flags flags) {
+	// A mapped file is already as fast as it gets, and a single read gains nothing from a queue.
+	if (mapped_ || count <= 1 || !ReadManyAsync(requests, count)) {
+		FileLoader::ReadMany(requests, count, flags);
+	}
+}
+
+bool LocalFileLoader::ReadManyAsync(ReadRequest *requests, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		requests[i].result = (size_t)-1;
+	}
+
+#if defined(HAVE_IO_URING)
+	std::lock_guard<std::mutex> guard(asyncLock_);
+	if (asyncFailed_ || fd_ == -1)
+		return false;
+	if (!ring_) {
+		ring_ = new IORing();
+		if (!ring_->Init()) {
+			WARN_LOG(FILESYS, "io_uring unavailable, reading files synchronously");
+			delete ring_;
+			ring_ = nullptr;
+			asyncFailed_ = true;
+			return false;
+		}
+	}
+
+	size_t queued = 0;
+	while (queued < count || ring_->inFlight != 0) {
+		if (queued < count)
+			queued += ring_->Queue(fd_, requests, count, queued);
+		if (ring_->inFlight == 0 || !ring_->Wait(requests, count)) {
+			// Give up on the ring, whatever didn't complete is read normally below.
+			ERROR_LOG(FILESYS, "io_uring failed, reading files synchronously");
+			asyncFailed_ = true;
+			delete ring_;
+			ring_ = nullptr;
+			break;
+		}
+	}
+#elif defined(_WIN32) && !PPSSPP_PLATFORM(UWP)
+	std::lock_guard<std::mutex> guard(asyncLock_);
+	if (asyncFailed_ || handle_ == INVALID_HANDLE_VALUE)
+		return false;
+	if (!overlappedHandle_) {
+		overlappedHandle_ = CreateFile(ConvertUTF8ToWString(filename_).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+		if (overlappedHandle_ == INVALID_HANDLE_VALUE) {
+			asyncFailed_ = true;
+			return false;
+		}
+	}
+
+	// Windows can wait on at most 64 events at once, which is also plenty in flight.
+	enum { BATCH_SIZE = 64 };
+	OVERLAPPED overlapped[BATCH_SIZE];
+	for (size_t start = 0; start < count; start += BATCH_SIZE) {
+		const size_t batch = std::min(count - start, (size_t)BATCH_SIZE);
+		bool pending[BATCH_SIZE]{};
+		for (size_t i = 0; i < batch; ++i) {
+			const ReadRequest &request = requests[start + i];
+			memset(&overlapped[i], 0, sizeof(OVERLAPPED));
+			overlapped[i].Offset = (DWORD)(request.absolutePos & 0xffffffff);
+			overlapped[i].OffsetHigh = (DWORD)((request.absolutePos & 0xffffffff00000000) >> 32);
+			overlapped[i].hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+			if (!overlapped[i].hEvent)
+				continue;
+			if (ReadFile(overlappedHandle_, request.data, (DWORD)request.bytes, nullptr, &overlapped[i]) || GetLastError() == ERROR_IO_PENDING)
+				pending[i] = true;
+		}
+		for (size_t i = 0; i < batch; ++i) {
+			DWORD read = 0;
+			if (pending[i] && GetOverlappedResult(overlappedHandle_, &overlapped[i], &read, TRUE) && read == requests[start + i].bytes)
+				requests[start + i].result = read;
+			if (overlapped[i].hEvent)
+				CloseHandle(overlapped[i].hEvent);
+		}
+	}
+#else
+	return false;
+#endif
+
+	// Anything that failed or came back short gets the regular path.
+	for (size_t i = 0; i < count; ++i) {
+		if (requests[i].result == (size_t)-1)
+			requests[i].result = ReadAt(requests[i].absolutePos, 1, requests[i].bytes, requests[i].data);
+	}
+	return true;
+}
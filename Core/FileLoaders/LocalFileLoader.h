@@ -24,6 +24,8 @@
 typedef void *HANDLE;
 #endif
 
+struct IORing;
+
 class LocalFileLoader : public FileLoader {
 public:
 	LocalFileLoader(const std::string &filename);
@@ -34,13 +36,26 @@ class LocalFileLoader : public FileLoader {
 	virtual s64 FileSize() override;
 	virtual std::string Path() const override;
 	virtual size_t ReadAt(s64 absolutePos, size_t bytes, size_t count, void *data, Flags flags = Flags::NONE) override;
+	void ReadMany(ReadRequest *requests, size_t count, Flags flags = Flags::NONE) override;
 
 private:
+	void MapFile();
+	bool ReadManyAsync(ReadRequest *requests, size_t count);
+
 #ifndef _WIN32
 	int fd_;
+	// Set up on first use of ReadMany, where io_uring is available.
+	IORing *ring_ = nullptr;
 #else
 	HANDLE handle_;
+	HANDLE mapping_ = nullptr;
+	// Opened on first use of ReadMany, for overlapped reads.
+	HANDLE overlappedHandle_ = nullptr;
 #endif
+	bool asyncFailed_ = false;
+	std::mutex asyncLock_;
+	// On 64-bit, the whole file is mapped if possible, so reads are just a copy instead of a syscall.
+	const u8 *mapped_ = nullptr;
 	u64 filesize_;
 	std::string filename_;
 	std::mutex readLock_;
@@ -21,17 +21,37 @@
 #include <cstdlib>
 
 #include "base/timeutil.h"
+#include "file/file_util.h"
 #include "thread/threadutil.h"
+#include "Common/FileUtil.h"
 #include "Core/FileLoaders/RamCachingFileLoader.h"
+#include "Core/System.h"
 
 #include "Common/Log.h"
 
+static const char *TRACEFILE_MAGIC = "ppssppRT";
+static const u32 TRACE_VERSION = 1;
+
+struct TraceFileHeader {
+	char magic[8];
+	u32 version;
+	u32 blockSize;
+	s64 filesize;
+	u32 count;
+	u32 pad;
+};
+
 // Takes ownership of backend.
 RamCachingFileLoader::RamCachingFileLoader(FileLoader *backend)
 	: ProxiedFileLoader(backend) {
 	filesize_ = backend->FileSize();
 	if (filesize_ > 0) {
 		InitCache();
+		LoadBootTrace();
+		if (!bootTrace_.empty()) {
+			// No need to wait for the first read, we already know what it'll want.
+			StartReadAhead(0);
+		}
 	}
 }
 
@@ -71,6 +91,7 @@ size_t RamCachingFileLoader::ReadAt(s64 absolutePos, size_t bytes, void *data, F
 	if (cache_ == nullptr || (flags & Flags::HINT_UNCACHED) != 0) {
 		readSize = backend_->ReadAt(absolutePos, bytes, data, flags);
 	} else {
+		RecordAccess(absolutePos, bytes);
 		readSize = ReadFromCache(absolutePos, bytes, data);
 		// While in case the cache size is too small for the entire read.
 		while (readSize < bytes) {
@@ -98,6 +119,7 @@ void RamCachingFileLoader::InitCache() {
 	}
 	aheadRemaining_ = blockCount;
 	blocks_.resize(blockCount);
+	traced_.resize(blockCount);
 }
 
 void RamCachingFileLoader::ShutdownCache() {
@@ -111,8 +133,11 @@ void RamCachingFileLoader::ShutdownCache() {
 	if (aheadThread_.joinable())
 		aheadThread_.join();
 
+	SaveBootTrace();
+
 	std::lock_guard<std::mutex> guard(blocksMutex_);
 	blocks_.clear();
+	traced_.clear();
 	if (cache_ != nullptr) {
 		free(cache_);
 		cache_ = nullptr;
@@ -172,12 +197,13 @@ void RamCachingFileLoader::SaveIntoCache(s64 pos, size_t bytes, Flags flags) {
 		cacheEndPos = blocks_.size() - 1;
 	}
 
+	u32 blocks[MAX_BLOCKS_PER_READ];
 	size_t blocksToRead = 0;
 	{
 		std::lock_guard<std::mutex> guard(blocksMutex_);
 		for (s64 i = cacheStartPos; i <= cacheEndPos; ++i) {
 			if (blocks_[(size_t)i] == 0) {
-				++blocksToRead;
+				blocks[blocksToRead++] = (u32)i;
 				if (blocksToRead >= MAX_BLOCKS_PER_READ) {
 					break;
 				}
@@ -185,19 +211,32 @@ void RamCachingFileLoader::SaveIntoCache(s64 pos, size_t bytes, Flags flags) {
 		}
 	}
 
-	s64 cacheFilePos = cacheStartPos << BLOCK_SHIFT;
-	size_t bytesRead = backend_->ReadAt(cacheFilePos, blocksToRead << BLOCK_SHIFT, &cache_[cacheFilePos], flags);
+	SaveBlocksIntoCache(blocks, blocksToRead, flags);
+}
+
+void RamCachingFileLoader::SaveBlocksIntoCache(const u32 *blocks, size_t count, Flags flags) {
+	// Each block is a separate request, so the backend can keep them all in flight.
+	ReadRequest requests[MAX_BLOCKS_PER_READ];
+	size_t blocksToRead = std::min(count, (size_t)MAX_BLOCKS_PER_READ);
+	for (size_t i = 0; i < blocksToRead; ++i) {
+		s64 cacheFilePos = (s64)blocks[i] << BLOCK_SHIFT;
+		requests[i].absolutePos = cacheFilePos;
+		requests[i].bytes = (size_t)std::min((s64)BLOCK_SIZE, filesize_ - cacheFilePos);
+		requests[i].data = &cache_[cacheFilePos];
+	}
+
+	backend_->ReadMany(requests, blocksToRead, flags);
 
-	// In case there was an error, let's not mark blocks that failed to read as read.
-	u32 blocksActuallyRead = (u32)((bytesRead + BLOCK_SIZE - 1) >> BLOCK_SHIFT);
 	{
 		std::lock_guard<std::mutex> guard(blocksMutex_);
 
-		// In case they were simultaneously read.
+		// In case there was an error, let's not mark blocks that failed to read as read.
+		// They might also have been read simultaneously.
 		u32 blocksRead = 0;
-		for (size_t i = 0; i < blocksActuallyRead; ++i) {
-			if (blocks_[(size_t)cacheStartPos + i] == 0) {
-				blocks_[(size_t)cacheStartPos + i] = 1;
+		for (size_t i = 0; i < blocksToRead; ++i) {
+			size_t block = (size_t)(requests[i].absolutePos >> BLOCK_SHIFT);
+			if (requests[i].result == requests[i].bytes && blocks_[block] == 0) {
+				blocks_[block] = 1;
 				++blocksRead;
 			}
 		}
@@ -226,8 +265,17 @@ void RamCachingFileLoader::StartReadAhead(s64 pos) {
 		aheadThread_.join();
 	aheadThread_ = std::thread([this] {
 		setCurrentThreadName("FileLoaderReadAhead");
+		setCurrentThreadRole(ThreadRole::BACKGROUND);
 
 		while (aheadRemaining_ != 0 && !aheadCancel_) {
+			// What the last boot read comes first, in the same order.
+			u32 traced[MAX_BLOCKS_PER_READ];
+			size_t tracedCount = NextTracedBlocks(traced, MAX_BLOCKS_PER_READ);
+			if (tracedCount != 0) {
+				SaveBlocksIntoCache(traced, tracedCount, Flags::NONE);
+				continue;
+			}
+
 			// Where should we look?
 			const u32 cacheStartPos = NextAheadBlock();
 			if (cacheStartPos == 0xFFFFFFFF) {
@@ -267,3 +315,116 @@ u32 RamCachingFileLoader::NextAheadBlock() {
 
 	return 0xFFFFFFFF;
 }
+
+size_t RamCachingFileLoader::NextTracedBlocks(u32 *blocks, size_t maxCount) {
+	std::lock_guard<std::mutex> guard(blocksMutex_);
+
+	size_t count = 0;
+	while (bootTracePos_ < bootTrace_.size() && count < maxCount) {
+		u32 block = bootTrace_[bootTracePos_++];
+		if (block < blocks_.size() && blocks_[block] == 0) {
+			blocks[count++] = block;
+		}
+	}
+	return count;
+}
+
+void RamCachingFileLoader::RecordAccess(s64 pos, size_t bytes) {
+	if (pos >= filesize_ || bytes == 0) {
+		return;
+	}
+
+	u32 cacheStartPos = (u32)(pos >> BLOCK_SHIFT);
+	u32 cacheEndPos = (u32)((pos + bytes - 1) >> BLOCK_SHIFT);
+
+	std::lock_guard<std::mutex> guard(blocksMutex_);
+	if (cacheEndPos >= traced_.size()) {
+		cacheEndPos = (u32)traced_.size() - 1;
+	}
+	for (u32 i = cacheStartPos; i <= cacheEndPos && newBootTrace_.size() < BOOT_TRACE_BLOCKS; ++i) {
+		if (!traced_[i]) {
+			traced_[i] = true;
+			newBootTrace_.push_back(i);
+		}
+	}
+}
+
+std::string RamCachingFileLoader::MakeTraceFilePath() const {
+	static const char *const invalidChars = "?*:/\\^|<>\"'";
+	std::string filename = Path();
+	for (size_t i = 0; i < filename.size(); ++i) {
+		if (strchr(invalidChars, filename[i]) != nullptr) {
+			filename[i] = '_';
+		}
+	}
+
+	return GetSysDirectory(DIRECTORY_CACHE) + "/" + filename + ".pprt";
+}
+
+void RamCachingFileLoader::LoadBootTrace() {
+	FILE *f = File::OpenCFile(MakeTraceFilePath(), "rb");
+	if (!f) {
+		return;
+	}
+
+	TraceFileHeader header;
+	bool valid = fread(&header, sizeof(header), 1, f) == 1;
+	if (!valid || memcmp(header.magic, TRACEFILE_MAGIC, sizeof(header.magic)) != 0 || header.version != TRACE_VERSION) {
+		valid = false;
+	} else if (header.blockSize != BLOCK_SIZE || header.filesize != filesize_ || header.count > BOOT_TRACE_BLOCKS) {
+		// Probably a different version of the file, the trace is no use.
+		valid = false;
+	}
+
+	std::vector<u32> trace;
+	if (valid) {
+		trace.resize(header.count);
+		if (header.count != 0 && fread(&trace[0], sizeof(u32), header.count, f) != header.count) {
+			valid = false;
+		}
+	}
+	fclose(f);
+
+	if (!valid) {
+		WARN_LOG(LOADER, "Ignoring invalid boot trace for %s", Path().c_str());
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard(blocksMutex_);
+	bootTrace_ = trace;
+	bootTracePos_ = 0;
+}
+
+void RamCachingFileLoader::SaveBootTrace() {
+	std::vector<u32> trace;
+	{
+		std::lock_guard<std::mutex> guard(blocksMutex_);
+		// A short session (e.g. just checking the title screen) shouldn't replace a fuller trace.
+		if (newBootTrace_.size() <= bootTrace_.size()) {
+			return;
+		}
+		trace = newBootTrace_;
+	}
+
+	const std::string dir = GetSysDirectory(DIRECTORY_CACHE);
+	if (!File::Exists(dir)) {
+		File::CreateFullPath(dir);
+	}
+
+	FILE *f = File::OpenCFile(MakeTraceFilePath(), "wb");
+	if (!f) {
+		WARN_LOG(LOADER, "Unable to save boot trace for %s", Path().c_str());
+		return;
+	}
+
+	TraceFileHeader header{};
+	memcpy(header.magic, TRACEFILE_MAGIC, sizeof(header.magic));
+	header.version = TRACE_VERSION;
+	header.blockSize = BLOCK_SIZE;
+	header.filesize = filesize_;
+	header.count = (u32)trace.size();
+	if (fwrite(&header, sizeof(header), 1, f) != 1 || fwrite(&trace[0], sizeof(u32), trace.size(), f) != trace.size()) {
+		WARN_LOG(LOADER, "Unable to save boot trace for %s", Path().c_str());
+	}
+	fclose(f);
+}
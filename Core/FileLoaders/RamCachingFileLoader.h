@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <string>
 #include <vector>
 #include <mutex>
 #include <thread>
@@ -47,14 +48,25 @@ class RamCachingFileLoader : public ProxiedFileLoader {
 	size_t ReadFromCache(s64 pos, size_t bytes, void *data);
 	// Guaranteed to read at least one block into the cache.
 	void SaveIntoCache(s64 pos, size_t bytes, Flags flags);
+	// Reads the specified blocks, which need not be contiguous.
+	void SaveBlocksIntoCache(const u32 *blocks, size_t count, Flags flags);
 	void StartReadAhead(s64 pos);
 	u32 NextAheadBlock();
+	// Fills blocks with the next few uncached blocks in the order the last boot read them.
+	size_t NextTracedBlocks(u32 *blocks, size_t maxCount);
+	void RecordAccess(s64 pos, size_t bytes);
+
+	// The boot trace lists blocks in the order the game first read them, so next time they can be prefetched first.
+	std::string MakeTraceFilePath() const;
+	void LoadBootTrace();
+	void SaveBootTrace();
 
 	enum {
 		BLOCK_SIZE = 65536,
 		BLOCK_SHIFT = 16,
 		MAX_BLOCKS_PER_READ = 16,
-		BLOCK_READAHEAD = 4,
+		BLOCK_READAHEAD = 16,
+		BOOT_TRACE_BLOCKS = 1024, // 64 MB
 	};
 
 	s64 filesize_ = 0;
@@ -69,4 +81,10 @@ class RamCachingFileLoader : public ProxiedFileLoader {
 	std::thread aheadThread_;
 	bool aheadThreadRunning_ = false;
 	bool aheadCancel_ = false;
+
+	// From the previous boot, and how far into it the read ahead has gotten.
+	std::vector<u32> bootTrace_;
+	size_t bootTracePos_ = 0;
+	std::vector<u32> newBootTrace_;
+	std::vector<bool> traced_;
 };
@@ -63,3 +63,18 @@ size_t RetryingFileLoader::ReadAt(s64 absolutePos, size_t bytes, void *data, Fla
 
 	return readSize;
 }
+
+void RetryingFileLoader::ReadMany(ReadRequest *requests, size_t count, Flags flags) {
+	// Let the backend batch them, and only retry the ones that came up short.
+	backend_->ReadMany(requests, count, flags);
+
+	for (size_t i = 0; i < count; ++i) {
+		ReadRequest &req = requests[i];
+		int retries = 0;
+		while (req.result < req.bytes && retries < MAX_RETRIES) {
+			u8 *p = (u8 *)req.data;
+			req.result += backend_->ReadAt(req.absolutePos + req.result, req.bytes - req.result, p + req.result, flags);
+			++retries;
+		}
+	}
+}
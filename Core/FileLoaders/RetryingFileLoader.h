@@ -33,6 +33,7 @@ class RetryingFileLoader : public ProxiedFileLoader {
 		return ReadAt(absolutePos, bytes * count, data, flags) / bytes;
 	}
 	size_t ReadAt(s64 absolutePos, size_t bytes, void *data, Flags flags = Flags::NONE) override;
+	void ReadMany(ReadRequest *requests, size_t count, Flags flags = Flags::NONE) override;
 
 private:
 	enum {
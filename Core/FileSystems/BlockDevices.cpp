@@ -18,9 +18,11 @@
 #include <cstdio>
 #include <cstring>
 #include <algorithm>
+#include "data/compression.h"
 #include "i18n/i18n.h"
 #include "Common/FileUtil.h"
 #include "Common/Swap.h"
+#include "Common/ThreadPools.h"
 #include "Core/Loaders.h"
 #include "Core/Host.h"
 #include "Core/FileSystems/BlockDevices.h"
@@ -40,7 +42,7 @@ BlockDevice *constructBlockDevice(FileLoader *fileLoader) {
 		return nullptr;
 	char buffer[4]{};
 	size_t size = fileLoader->ReadAt(0, 1, 4, buffer);
-	if (size == 4 && !memcmp(buffer, "CISO", 4))
+	if (size == 4 && (!memcmp(buffer, "CISO", 4) || !memcmp(buffer, "ZISO", 4)))
 		return new CISOFileBlockDevice(fileLoader);
 	else if (size == 4 && !memcmp(buffer, "\x00PBP", 4))
 		return new NPDRMDemoBlockDevice(fileLoader);
@@ -97,16 +99,16 @@ bool FileBlockDevice::ReadBlocks(u32 minBlock, int count, u8 *outPtr) {
 	return true;
 }
 
-// .CSO format
+// .CSO format (and .ZSO, which is the same with LZ4 instead of deflate)
 
 // compressed ISO(9660) header format
 typedef struct ciso_header
 {
-	unsigned char magic[4];         // +00 : 'C','I','S','O'
+	unsigned char magic[4];         // +00 : 'C','I','S','O' or 'Z','I','S','O'
 	u32_le header_size;             // +04 : header size (==0x18)
 	u64_le total_bytes;             // +08 : number of original data size
 	u32_le block_size;              // +10 : number of compressed block size
-	unsigned char ver;              // +14 : version 01
+	unsigned char ver;              // +14 : version 01, or 02 for CSOv2
 	unsigned char align;            // +15 : align of index value
 	unsigned char rsv_06[2];        // +16 : reserved
 #if 0
@@ -126,6 +128,9 @@ typedef struct ciso_header
 // TODO: Need much better error handling.
 
 static const u32 CSO_READ_BUFFER_SIZE = 256 * 1024;
+// Decompressed ahead when reads look sequential.
+static const u32 CSO_READ_AHEAD_SIZE = 64 * 1024;
+static const u32 CSO_FRAME_CACHE_SIZE = 1024 * 1024;
 
 CISOFileBlockDevice::CISOFileBlockDevice(FileLoader *fileLoader)
 	: fileLoader_(fileLoader)
@@ -134,19 +139,21 @@ CISOFileBlockDevice::CISOFileBlockDevice(FileLoader *fileLoader)
 
 	CISO_H hdr;
 	size_t readSize = fileLoader->ReadAt(0, sizeof(CISO_H), 1, &hdr);
-	if (readSize != 1 || memcmp(hdr.magic, "CISO", 4) != 0)
+	isZSO = readSize == 1 && memcmp(hdr.magic, "ZISO", 4) == 0;
+	if (readSize != 1 || (memcmp(hdr.magic, "CISO", 4) != 0 && !isZSO))
 	{
 		WARN_LOG(LOADER, "Invalid CSO!");
 	}
 	else
 	{
-		VERBOSE_LOG(LOADER, "Valid CSO!");
+		VERBOSE_LOG(LOADER, "Valid %s!", isZSO ? "ZSO" : "CSO");
 	}
-	if (hdr.ver > 1)
+	if (hdr.ver > (isZSO ? 1 : 2))
 	{
 		ERROR_LOG(LOADER, "CSO version too high!");
 		//ARGH!
 	}
+	version = hdr.ver;
 
 	frameSize = hdr.block_size;
 	if ((frameSize & (frameSize - 1)) != 0)
@@ -167,11 +174,17 @@ CISOFileBlockDevice::CISOFileBlockDevice(FileLoader *fileLoader)
 
 	// We might read a bit of alignment too, so be prepared.
 	if (frameSize + (1 << indexShift) < CSO_READ_BUFFER_SIZE)
-		readBuffer = new u8[CSO_READ_BUFFER_SIZE];
+		readBufferSize = CSO_READ_BUFFER_SIZE;
 	else
-		readBuffer = new u8[frameSize + (1 << indexShift)];
-	zlibBuffer = new u8[frameSize + (1 << indexShift)];
-	zlibBufferFrame = numFrames;
+		readBufferSize = frameSize + (1 << indexShift);
+	readBuffer = new u8[readBufferSize];
+
+	// Enough slots for the read ahead and both ends of a read, with room to spare.
+	readAheadFrames_ = std::max(1U, CSO_READ_AHEAD_SIZE / frameSize);
+	const u32 cacheFrames = std::max(readAheadFrames_ * 2 + 2, CSO_FRAME_CACHE_SIZE / frameSize);
+	frameCache_.resize((size_t)cacheFrames * frameSize);
+	frameCacheFrames_.resize(cacheFrames, numFrames);
+	frameCacheLastUsed_.resize(cacheFrames, 0);
 
 	const u32 indexSize = numFrames + 1;
 
@@ -210,7 +223,155 @@ CISOFileBlockDevice::~CISOFileBlockDevice()
 {
 	delete [] index;
 	delete [] readBuffer;
-	delete [] zlibBuffer;
+}
+
+CISOFileBlockDevice::FrameCodec CISOFileBlockDevice::GetFrameCodec(u32 frame) const {
+	const u32 idx = index[frame];
+	if (version < 2) {
+		if (idx & 0x80000000)
+			return FrameCodec::PLAIN;
+		return isZSO ? FrameCodec::LZ4 : FrameCodec::DEFLATE;
+	}
+
+	// CSOv2 marks uncompressed frames by size, and uses the top bit to choose LZ4.
+	const u64 frameReadPos = (u64)(idx & 0x7FFFFFFF) << indexShift;
+	const u64 frameReadEnd = (u64)(index[frame + 1] & 0x7FFFFFFF) << indexShift;
+	if (frameReadEnd - frameReadPos >= frameSize)
+		return FrameCodec::PLAIN;
+	return (idx & 0x80000000) ? FrameCodec::LZ4 : FrameCodec::DEFLATE;
+}
+
+u8 *CISOFileBlockDevice::FindCachedFrame(u32 frame) {
+	auto it = frameCacheSlots_.find(frame);
+	if (it == frameCacheSlots_.end())
+		return nullptr;
+	if (frameCacheLastUsed_[it->second] < frameCacheStamp_)
+		frameCacheLastUsed_[it->second] = frameCacheStamp_;
+	return &frameCache_[(size_t)it->second * frameSize];
+}
+
+u8 *CISOFileBlockDevice::AllocateCachedFrame(u32 frame) {
+	// Frames allocated by this read are stamped one higher than hits, and there are always more slots
+	// than a single read allocates, so this never evicts a frame the current read still needs.
+	int slot = 0;
+	for (int i = 1; i < (int)frameCacheFrames_.size(); ++i) {
+		if (frameCacheLastUsed_[i] < frameCacheLastUsed_[slot])
+			slot = i;
+	}
+	if (frameCacheFrames_[slot] != numFrames)
+		frameCacheSlots_.erase(frameCacheFrames_[slot]);
+
+	frameCacheFrames_[slot] = frame;
+	frameCacheLastUsed_[slot] = frameCacheStamp_ + 1;
+	frameCacheSlots_[frame] = slot;
+	return &frameCache_[(size_t)slot * frameSize];
+}
+
+void CISOFileBlockDevice::AddReadAhead(u32 afterFrame, std::vector<FrameJob> &jobs) {
+	const u32 endFrame = std::min(afterFrame + 1 + readAheadFrames_, numFrames);
+	for (u32 frame = afterFrame + 1; frame < endFrame; ++frame) {
+		// Plain frames are just a read, no point caching them.
+		if (GetFrameCodec(frame) != FrameCodec::PLAIN && !FindCachedFrame(frame)) {
+			jobs.push_back({ frame, AllocateCachedFrame(frame) });
+		}
+	}
+}
+
+bool CISOFileBlockDevice::DecompressFrames(const std::vector<FrameJob> &jobs, bool uncached) {
+	FileLoader::Flags flags = uncached ? FileLoader::Flags::HINT_UNCACHED : FileLoader::Flags::NONE;
+	std::vector<u8> failed(jobs.size());
+
+	size_t batchStart = 0;
+	while (batchStart < jobs.size()) {
+		// Read as many frames at once as fit in the buffer, there's always room for at least one.
+		const u64 batchReadPos = (u64)(index[jobs[batchStart].frame] & 0x7FFFFFFF) << indexShift;
+		size_t batchEnd = batchStart + 1;
+		while (batchEnd < jobs.size()) {
+			const u64 frameReadEnd = (u64)(index[jobs[batchEnd].frame + 1] & 0x7FFFFFFF) << indexShift;
+			if (frameReadEnd - batchReadPos > readBufferSize)
+				break;
+			++batchEnd;
+		}
+		const u64 batchReadEnd = (u64)(index[jobs[batchEnd - 1].frame + 1] & 0x7FFFFFFF) << indexShift;
+		const size_t batchReadSize = (size_t)std::min(batchReadEnd - batchReadPos, (u64)readBufferSize);
+		const size_t readSize = fileLoader_->ReadAt(batchReadPos, 1, batchReadSize, readBuffer, flags);
+		if (readSize < batchReadSize)
+			memset(readBuffer + readSize, 0, batchReadSize - readSize);
+
+		auto decompressRange = [&](int lower, int upper) {
+			z_stream z;
+			z.zalloc = Z_NULL;
+			z.zfree = Z_NULL;
+			z.opaque = Z_NULL;
+			if (inflateInit2(&z, -15) != Z_OK) {
+				for (int i = lower; i < upper; ++i)
+					failed[i] = 1;
+				return;
+			}
+
+			for (int i = lower; i < upper; ++i) {
+				const FrameJob &job = jobs[i];
+				const u32 idx = index[job.frame];
+				const u64 frameReadPos = (u64)(idx & 0x7FFFFFFF) << indexShift;
+				const u64 frameReadEnd = (u64)(index[job.frame + 1] & 0x7FFFFFFF) << indexShift;
+				const u32 frameReadSize = (u32)std::min(frameReadEnd - frameReadPos, (u64)batchReadSize - (frameReadPos - batchReadPos));
+				u8 *rawBuffer = readBuffer + (frameReadPos - batchReadPos);
+
+				const FrameCodec codec = GetFrameCodec(job.frame);
+				if (codec == FrameCodec::PLAIN) {
+					const u32 plainSize = std::min(frameReadSize, frameSize);
+					memcpy(job.dest, rawBuffer, plainSize);
+					if (plainSize < frameSize)
+						memset(job.dest + plainSize, 0, frameSize - plainSize);
+					continue;
+				}
+				if (codec == FrameCodec::LZ4) {
+					if (lz4_decompress_block(rawBuffer, frameReadSize, job.dest, frameSize) != (int)frameSize) {
+						failed[i] = 1;
+						memset(job.dest, 0, frameSize);
+					}
+					continue;
+				}
+
+				z.avail_in = frameReadSize;
+				z.next_in = rawBuffer;
+				z.avail_out = frameSize;
+				z.next_out = job.dest;
+				int status = inflate(&z, Z_FINISH);
+				if (status != Z_STREAM_END || z.total_out != frameSize) {
+					failed[i] = 1;
+					memset(job.dest, 0, frameSize);
+				}
+				inflateReset(&z);
+			}
+			inflateEnd(&z);
+		};
+
+		if (batchEnd - batchStart > 1) {
+			GlobalThreadPool::Loop(decompressRange, (int)batchStart, (int)batchEnd);
+		} else {
+			decompressRange((int)batchStart, (int)batchEnd);
+		}
+		batchStart = batchEnd;
+	}
+
+	bool success = true;
+	for (size_t i = 0; i < jobs.size(); ++i) {
+		if (failed[i]) {
+			ERROR_LOG(LOADER, "Decompress frame %d: failed\n", jobs[i].frame);
+			success = false;
+			// Don't keep the zeroed data around.
+			auto it = frameCacheSlots_.find(jobs[i].frame);
+			if (it != frameCacheSlots_.end() && &frameCache_[(size_t)it->second * frameSize] == jobs[i].dest) {
+				frameCacheFrames_[it->second] = numFrames;
+				frameCacheLastUsed_[it->second] = 0;
+				frameCacheSlots_.erase(it);
+			}
+		}
+	}
+	if (!success)
+		NotifyReadError();
+	return success;
 }
 
 bool CISOFileBlockDevice::ReadBlock(int blockNumber, u8 *outPtr, bool uncached)
@@ -222,68 +383,46 @@ bool CISOFileBlockDevice::ReadBlock(int blockNumber, u8 *outPtr, bool uncached)
 		return false;
 	}
 
+	std::lock_guard<std::mutex> guard(lock_);
+	frameCacheStamp_ += 2;
+	const bool sequential = (u32)blockNumber == nextSequentialBlock_;
+	nextSequentialBlock_ = blockNumber + 1;
+
 	const u32 frameNumber = blockNumber >> blockShift;
 	const u32 idx = index[frameNumber];
 	const u32 indexPos = idx & 0x7FFFFFFF;
-	const u32 nextIndexPos = index[frameNumber + 1] & 0x7FFFFFFF;
-	z_stream z;
-
 	const u64 compressedReadPos = (u64)indexPos << indexShift;
-	const u64 compressedReadEnd = (u64)nextIndexPos << indexShift;
-	const size_t compressedReadSize = (size_t)(compressedReadEnd - compressedReadPos);
 	const u32 compressedOffset = (blockNumber & ((1 << blockShift) - 1)) * GetBlockSize();
 
-	const int plain = idx & 0x80000000;
-	if (plain)
+	if (GetFrameCodec(frameNumber) == FrameCodec::PLAIN)
 	{
 		int readSize = (u32)fileLoader_->ReadAt(compressedReadPos + compressedOffset, 1, GetBlockSize(), outPtr, flags);
 		if (readSize < GetBlockSize())
 			memset(outPtr + readSize, 0, GetBlockSize() - readSize);
+		return true;
 	}
-	else if (zlibBufferFrame == frameNumber)
+
+	const u8 *cached = FindCachedFrame(frameNumber);
+	if (cached)
 	{
 		// We already have it.  Just apply the offset and copy.
-		memcpy(outPtr, zlibBuffer + compressedOffset, GetBlockSize());
+		memcpy(outPtr, cached + compressedOffset, GetBlockSize());
+		return true;
 	}
-	else
-	{
-		const u32 readSize = (u32)fileLoader_->ReadAt(compressedReadPos, 1, compressedReadSize, readBuffer, flags);
 
-		z.zalloc = Z_NULL;
-		z.zfree = Z_NULL;
-		z.opaque = Z_NULL;
-		if (inflateInit2(&z, -15) != Z_OK) {
-			ERROR_LOG(LOADER, "GetBlockSize() ERROR: %s\n", (z.msg) ? z.msg : "?");
-			NotifyReadError();
-			return false;
-		}
-		z.avail_in = readSize;
-		z.next_out = frameSize == (u32)GetBlockSize() ? outPtr : zlibBuffer;
-		z.avail_out = frameSize;
-		z.next_in = readBuffer;
-
-		int status = inflate(&z, Z_FINISH);
-		if (status != Z_STREAM_END) {
-			ERROR_LOG(LOADER, "block %d: inflate : %s[%d]\n", blockNumber, (z.msg) ? z.msg : "error", status);
-			NotifyReadError();
-			inflateEnd(&z);
-			memset(outPtr, 0, GetBlockSize());
-			return false;
-		}
-		if (z.total_out != frameSize) {
-			ERROR_LOG(LOADER, "block %d: block size error %d != %d\n", blockNumber, (u32)z.total_out, frameSize);
-			NotifyReadError();
-			inflateEnd(&z);
-			memset(outPtr, 0, GetBlockSize());
-			return false;
-		}
-		inflateEnd(&z);
+	std::vector<FrameJob> jobs;
+	u8 *frameBuffer = frameSize == (u32)GetBlockSize() ? outPtr : AllocateCachedFrame(frameNumber);
+	jobs.push_back({ frameNumber, frameBuffer });
+	// When streaming, inflate the next few frames now, in parallel.
+	if (sequential)
+		AddReadAhead(frameNumber, jobs);
 
-		if (frameSize != (u32)GetBlockSize()) {
-			zlibBufferFrame = frameNumber;
-			memcpy(outPtr, zlibBuffer + compressedOffset, GetBlockSize());
-		}
+	if (!DecompressFrames(jobs, uncached)) {
+		memset(outPtr, 0, GetBlockSize());
+		return false;
 	}
+	if (frameBuffer != outPtr)
+		memcpy(outPtr, frameBuffer + compressedOffset, GetBlockSize());
 	return true;
 }
 
@@ -302,82 +441,54 @@ bool CISOFileBlockDevice::ReadBlocks(u32 minBlock, int count, u8 *outPtr) {
 		memset(outPtr + GetBlockSize() * (count - missingBlocks), 0, GetBlockSize() * missingBlocks);
 	}
 
+	std::lock_guard<std::mutex> guard(lock_);
+	frameCacheStamp_ += 2;
+	const bool sequential = minBlock == nextSequentialBlock_;
+	nextSequentialBlock_ = lastBlock + 1;
+
 	const u32 minFrameNumber = minBlock >> blockShift;
 	const u32 lastFrameNumber = lastBlock >> blockShift;
-	const u32 afterLastIndexPos = index[lastFrameNumber + 1] & 0x7FFFFFFF;
-	const u64 totalReadEnd = (u64)afterLastIndexPos << indexShift;
-
-	z_stream z;
-	z.zalloc = Z_NULL;
-	z.zfree = Z_NULL;
-	z.opaque = Z_NULL;
-	if (inflateInit2(&z, -15) != Z_OK) {
-		ERROR_LOG(LOADER, "Unable to initialize inflate: %s\n", (z.msg) ? z.msg : "?");
-		return false;
-	}
+	const u32 blocksPerFrame = 1 << blockShift;
 
-	u64 readBufferStart = 0;
-	u64 readBufferEnd = 0;
+	// Whole frames inflate straight into outPtr, partial ones go through the cache.
+	struct PartialFrame {
+		u8 *out;
+		const u8 *frame;
+		u32 offset;
+		u32 size;
+	};
+	std::vector<FrameJob> jobs;
+	std::vector<PartialFrame> partials;
 	u32 block = minBlock;
-	const u32 blocksPerFrame = 1 << blockShift;
 	for (u32 frame = minFrameNumber; frame <= lastFrameNumber; ++frame) {
-		const u32 idx = index[frame];
-		const u32 indexPos = idx & 0x7FFFFFFF;
-		const u32 nextIndexPos = index[frame + 1] & 0x7FFFFFFF;
-
-		const u64 frameReadPos = (u64)indexPos << indexShift;
-		const u64 frameReadEnd = (u64)nextIndexPos << indexShift;
-		const u32 frameReadSize = (u32)(frameReadEnd - frameReadPos);
-		const u32 frameBlockOffset = block & ((1 << blockShift) - 1);
+		const u32 frameBlockOffset = block & (blocksPerFrame - 1);
 		const u32 frameBlocks = std::min(lastBlock - block + 1, blocksPerFrame - frameBlockOffset);
-
-		if (frameReadEnd > readBufferEnd) {
-			const s64 maxNeeded = totalReadEnd - frameReadPos;
-			const size_t chunkSize = (size_t)std::min(maxNeeded, (s64)std::max(frameReadSize, CSO_READ_BUFFER_SIZE));
-
-			const u32 readSize = (u32)fileLoader_->ReadAt(frameReadPos, 1, chunkSize, readBuffer);
-			if (readSize < chunkSize) {
-				memset(readBuffer + readSize, 0, chunkSize - readSize);
-			}
-
-			readBufferStart = frameReadPos;
-			readBufferEnd = frameReadPos + readSize;
-		}
-
-		u8 *rawBuffer = &readBuffer[frameReadPos - readBufferStart];
-		const int plain = idx & 0x80000000;
-		if (plain) {
-			memcpy(outPtr, rawBuffer + frameBlockOffset * GetBlockSize(), frameBlocks * GetBlockSize());
+		const u32 offset = frameBlockOffset * GetBlockSize();
+		const u32 size = frameBlocks * GetBlockSize();
+
+		const u8 *cached = FindCachedFrame(frame);
+		if (cached) {
+			memcpy(outPtr, cached + offset, size);
+		} else if (frameBlocks == blocksPerFrame) {
+			jobs.push_back({ frame, outPtr });
 		} else {
-			z.avail_in = frameReadSize;
-			z.next_out = frameBlocks == blocksPerFrame ? outPtr : zlibBuffer;
-			z.avail_out = frameSize;
-			z.next_in = rawBuffer;
-
-			int status = inflate(&z, Z_FINISH);
-			if (status != Z_STREAM_END) {
-				ERROR_LOG(LOADER, "Inflate frame %d: failed - %s[%d]\n", frame, (z.msg) ? z.msg : "error", status);
-				NotifyReadError();
-				memset(outPtr, 0, frameBlocks * GetBlockSize());
-			} else if (z.total_out != frameSize) {
-				ERROR_LOG(LOADER, "Inflate frame %d: block size error %d != %d\n", frame, (u32)z.total_out, frameSize);
-				NotifyReadError();
-				memset(outPtr, 0, frameBlocks * GetBlockSize());
-			} else if (frameBlocks != blocksPerFrame) {
-				memcpy(outPtr, zlibBuffer + frameBlockOffset * GetBlockSize(), frameBlocks * GetBlockSize());
-				// In case we end up reusing it in a single read later.
-				zlibBufferFrame = frame;
-			}
-
-			inflateReset(&z);
+			u8 *frameBuffer = AllocateCachedFrame(frame);
+			jobs.push_back({ frame, frameBuffer });
+			partials.push_back({ outPtr, frameBuffer, offset, size });
 		}
 
 		block += frameBlocks;
 		outPtr += frameBlocks * GetBlockSize();
 	}
 
-	inflateEnd(&z);
-	return true;
+	if (sequential)
+		AddReadAhead(lastFrameNumber, jobs);
+
+	bool success = jobs.empty() || DecompressFrames(jobs, false);
+	for (const PartialFrame &partial : partials) {
+		memcpy(partial.out, partial.frame + partial.offset, partial.size);
+	}
+	return success;
 }
 
 NPDRMDemoBlockDevice::NPDRMDemoBlockDevice(FileLoader *fileLoader)
@@ -18,12 +18,14 @@
 #pragma once
 
 // Abstractions around read-only blockdevices, such as PSP UMD discs.
-// CISOFileBlockDevice implements compressed iso images, CISO format.
+// CISOFileBlockDevice implements compressed iso images, CISO format (also CSOv2 and ZSO.)
 //
 // The ISOFileSystemReader reads from a BlockDevice, so it automatically works
 // with CISO images.
 
 #include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #include "Common/CommonTypes.h"
 #include "Core/ELF/PBPReader.h"
@@ -62,16 +64,46 @@ class CISOFileBlockDevice : public BlockDevice {
 	u32 GetNumBlocks() override { return numBlocks; }
 
 private:
+	struct FrameJob {
+		u32 frame;
+		u8 *dest;
+	};
+
+	enum class FrameCodec {
+		PLAIN,
+		DEFLATE,
+		LZ4,
+	};
+
+	FrameCodec GetFrameCodec(u32 frame) const;
+	// Decompresses (or copies) the frames, in ascending order, in parallel where there are several.
+	bool DecompressFrames(const std::vector<FrameJob> &jobs, bool uncached);
+	u8 *FindCachedFrame(u32 frame);
+	u8 *AllocateCachedFrame(u32 frame);
+	void AddReadAhead(u32 afterFrame, std::vector<FrameJob> &jobs);
+
 	FileLoader *fileLoader_;
 	u32 *index;
 	u8 *readBuffer;
-	u8 *zlibBuffer;
-	u32 zlibBufferFrame;
+	u32 readBufferSize;
 	u8 indexShift;
 	u8 blockShift;
 	u32 frameSize;
 	u32 numBlocks;
 	u32 numFrames;
+	u8 version;
+	bool isZSO;
+
+	std::mutex lock_;
+	// Recently decompressed frames, so partial and sequential reads don't inflate the same frame again.
+	std::vector<u8> frameCache_;
+	std::vector<u32> frameCacheFrames_;
+	std::vector<u32> frameCacheLastUsed_;
+	std::unordered_map<u32, int> frameCacheSlots_;
+	u32 frameCacheStamp_ = 0;
+	u32 readAheadFrames_;
+	// Where the last read ended, to detect streaming.
+	u32 nextSequentialBlock_ = 0xFFFFFFFF;
 };
 
 
@@ -19,6 +19,8 @@
 
 #include <algorithm>
 #include <limits>
+#include <mutex>
+#include <unordered_map>
 #include "file/free.h"
 #include "file/zip_read.h"
 #include "i18n/i18n.h"
@@ -54,6 +56,18 @@
 #endif
 
 #if HOST_IS_CASE_SENSITIVE
+// Directory listings used to fix case, lowercased name -> name on disk.
+// A listing is used until the directory's mtime changes, or a change through a filesystem invalidates it.
+struct CaseFoldedDirectory {
+	time_t mtime;
+	std::unordered_map<std::string, std::string> names;
+};
+
+static std::mutex caseFoldLock;
+static std::unordered_map<std::string, CaseFoldedDirectory> caseFoldCache;
+// Keeps a large memstick from growing the cache forever.
+static const size_t MAX_CASE_FOLDED_DIRECTORIES = 1024;
+
 static bool FixFilenameCase(const std::string &path, std::string &filename)
 {
 	// Are we lucky?
@@ -66,37 +80,71 @@ static bool FixFilenameCase(const std::string &path, std::string &filename)
 		filename[i] = tolower(filename[i]);
 	}
 
-	//TODO: lookup filename in cache for "path"
-	struct dirent *result = NULL;
-
-	DIR *dirp = opendir(path.c_str());
-	if (!dirp)
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0)
 		return false;
 
-	bool retValue = false;
-
-	while ((result = readdir(dirp)))
+	std::lock_guard<std::mutex> guard(caseFoldLock);
+	auto dir = caseFoldCache.find(path);
+	if (dir == caseFoldCache.end() || dir->second.mtime != st.st_mtime)
 	{
-		if (strlen(result->d_name) != filenameSize)
-			continue;
-
-		size_t i;
-		for (i = 0; i < filenameSize; i++)
+		DIR *dirp = opendir(path.c_str());
+		if (!dirp)
 		{
-			if (filename[i] != tolower(result->d_name[i]))
-				break;
+			if (dir != caseFoldCache.end())
+				caseFoldCache.erase(dir);
+			return false;
 		}
 
-		if (i < filenameSize)
-			continue;
+		if (dir == caseFoldCache.end() && caseFoldCache.size() >= MAX_CASE_FOLDED_DIRECTORIES)
+			caseFoldCache.clear();
+
+		CaseFoldedDirectory &listing = caseFoldCache[path];
+		listing.mtime = st.st_mtime;
+		listing.names.clear();
+
+		struct dirent *result = NULL;
+		while ((result = readdir(dirp)))
+		{
+			std::string lower = result->d_name;
+			for (char &c : lower)
+				c = tolower(c);
+			// If several names only differ in case, the last one listed wins.
+			listing.names[lower] = result->d_name;
+		}
 
-		filename = result->d_name;
-		retValue = true;
+		closedir(dirp);
+		dir = caseFoldCache.find(path);
 	}
 
-	closedir(dirp);
+	auto name = dir->second.names.find(filename);
+	if (name == dir->second.names.end())
+		return false;
 
-	return retValue;
+	filename = name->second;
+	return true;
+}
+
+void InvalidatePathCase(const std::string &fullPath)
+{
+	std::string path = fullPath;
+	while (!path.empty() && path.back() == '/')
+		path.pop_back();
+
+	size_t slash = path.find_last_of('/');
+	std::string parent = slash == path.npos ? "" : path.substr(0, slash + 1);
+	std::string prefix = path + "/";
+
+	std::lock_guard<std::mutex> guard(caseFoldLock);
+	caseFoldCache.erase(parent);
+	// If a directory was removed or renamed, everything cached under it is gone too.
+	for (auto it = caseFoldCache.begin(); it != caseFoldCache.end(); )
+	{
+		if (it->first.compare(0, prefix.size(), prefix) == 0)
+			it = caseFoldCache.erase(it);
+		else
+			++it;
+	}
 }
 
 bool FixPathCase(const std::string &basePath, std::string &path, FixPathCaseBehavior behavior)
@@ -323,6 +371,11 @@ bool DirectoryFileHandle::Open(const std::string &basePath, std::string &fileNam
 	}
 #endif
 
+#if HOST_IS_CASE_SENSITIVE
+	if (success && (access & FILEACCESS_CREATE))
+		InvalidatePathCase(fullName);
+#endif
+
 	// Try to detect reads/writes to PSP/GAME to avoid them in replays.
 	if (fullName.find("/PSP/GAME/") != fullName.npos || fullName.find("\\PSP\\GAME\\") != fullName.npos) {
 		inGameDir_ = true;
@@ -381,12 +434,17 @@ size_t DirectoryFileHandle::Write(const u8* pointer, s64 size)
 		bytesWritten = ReplayApplyDiskWrite(pointer, (uint64_t)bytesWritten, (uint64_t)size, &diskFull, inGameDir_, CoreTiming::GetGlobalTimeUs());
 	}
 
+	if (!diskFull && bytesWritten != (size_t)-1) {
+		MemoryStick_NotifyWrite(bytesWritten);
+	}
+
 	if (diskFull) {
 		ERROR_LOG(FILESYS, "Disk full");
 		I18NCategory *err = GetI18NCategory("Error");
 		host->NotifyUserMessage(err->T("Disk full while writing data"));
 		// We only return an error when the disk is actually full.
 		// When writing this would cause the disk to be full, so it wasn't written, we return 0.
+		MemoryStick_InvalidateFreeSpace();
 		if (MemoryStick_FreeSpace() == 0) {
 			// Sign extend on 64-bit.
 			return (size_t)(s64)(s32)SCE_KERNEL_ERROR_ERRNO_DEVICE_NO_FREE_SPACE;
@@ -492,6 +550,12 @@ bool DirectoryFileSystem::MkDir(const std::string &dirname) {
 		result = false;
 	else
 		result = File::CreateFullPath(GetLocalPath(fixedCase));
+
+	// Any of the components may have been created.
+	for (size_t i = fixedCase.find('/', 1); result && i != fixedCase.npos; i = fixedCase.find('/', i + 1))
+		InvalidatePathCase(GetLocalPath(fixedCase.substr(0, i)));
+	if (result)
+		InvalidatePathCase(GetLocalPath(fixedCase));
 #else
 	result = File::CreateFullPath(GetLocalPath(dirname));
 #endif
@@ -500,11 +564,14 @@ bool DirectoryFileSystem::MkDir(const std::string &dirname) {
 
 bool DirectoryFileSystem::RmDir(const std::string &dirname) {
 	std::string fullName = GetLocalPath(dirname);
+	MemoryStick_InvalidateFreeSpace();
 
 #if HOST_IS_CASE_SENSITIVE
 	// Maybe we're lucky?
-	if (File::DeleteDirRecursively(fullName))
+	if (File::DeleteDirRecursively(fullName)) {
+		InvalidatePathCase(fullName);
 		return (bool)ReplayApplyDisk(ReplayAction::RMDIR, true, CoreTiming::GetGlobalTimeUs());
+	}
 
 	// Nope, fix case and try again.  Should we try again?
 	fullName = dirname;
@@ -520,6 +587,10 @@ bool DirectoryFileSystem::RmDir(const std::string &dirname) {
 	return 0 == rmdir(fullName.c_str());
 #endif*/
 	bool result = File::DeleteDirRecursively(fullName);
+#if HOST_IS_CASE_SENSITIVE
+	if (result)
+		InvalidatePathCase(fullName);
+#endif
 	return ReplayApplyDisk(ReplayAction::RMDIR, result, CoreTiming::GetGlobalTimeUs()) != 0;
 }
 
@@ -574,6 +645,13 @@ int DirectoryFileSystem::RenameFile(const std::string &from, const std::string &
 	}
 #endif
 
+#if HOST_IS_CASE_SENSITIVE
+	if (retValue) {
+		InvalidatePathCase(fullFrom);
+		InvalidatePathCase(fullTo);
+	}
+#endif
+
 	// TODO: Better error codes.
 	int result = retValue ? 0 : (int)SCE_KERNEL_ERROR_ERRNO_FILE_ALREADY_EXISTS;
 	return ReplayApplyDisk(ReplayAction::FILE_RENAME, result, CoreTiming::GetGlobalTimeUs());
@@ -581,6 +659,7 @@ int DirectoryFileSystem::RenameFile(const std::string &from, const std::string &
 
 bool DirectoryFileSystem::RemoveFile(const std::string &filename) {
 	std::string fullName = GetLocalPath(filename);
+	MemoryStick_InvalidateFreeSpace();
 #ifdef _WIN32
 	bool retValue = (::DeleteFileA(fullName.c_str()) == TRUE);
 #else
@@ -602,6 +681,9 @@ bool DirectoryFileSystem::RemoveFile(const std::string &filename) {
 		retValue = (0 == unlink(fullName.c_str()));
 #endif
 	}
+
+	if (retValue)
+		InvalidatePathCase(fullName);
 #endif
 
 	return ReplayApplyDisk(ReplayAction::FILE_REMOVE, retValue, CoreTiming::GetGlobalTimeUs()) != 0;
@@ -868,7 +950,7 @@ std::vector<PSPFileInfo> DirectoryFileSystem::GetDirListing(std::string path) {
 		entry.name = SimulateVFATBug(ConvertWStringToUTF8(findData.cFileName));
 
 		bool hideFile = false;
-		if (hideISOFiles && (endsWithNoCase(entry.name, ".cso") || endsWithNoCase(entry.name, ".iso"))) {
+		if (hideISOFiles && (endsWithNoCase(entry.name, ".cso") || endsWithNoCase(entry.name, ".zso") || endsWithNoCase(entry.name, ".iso"))) {
 			// Workaround for DJ Max Portable, see compat.ini.
 			hideFile = true;
 		}
@@ -916,7 +998,7 @@ std::vector<PSPFileInfo> DirectoryFileSystem::GetDirListing(std::string path) {
 		entry.size = s.st_size;
 
 		bool hideFile = false;
-		if (hideISOFiles && (endsWithNoCase(entry.name, ".cso") || endsWithNoCase(entry.name, ".iso"))) {
+		if (hideISOFiles && (endsWithNoCase(entry.name, ".cso") || endsWithNoCase(entry.name, ".zso") || endsWithNoCase(entry.name, ".iso"))) {
 			// Workaround for DJ Max Portable, see compat.ini.
 			hideFile = true;
 		}
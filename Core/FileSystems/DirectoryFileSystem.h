@@ -55,6 +55,8 @@ enum FixPathCaseBehavior {
 };
 
 bool FixPathCase(const std::string &basePath, std::string &path, FixPathCaseBehavior behavior);
+// Call after creating, removing or renaming fullPath, so FixPathCase doesn't use stale listings.
+void InvalidatePathCase(const std::string &fullPath);
 #endif
 
 struct DirectoryFileHandle {
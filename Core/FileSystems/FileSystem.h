@@ -128,6 +128,8 @@ class IFileSystem {
 	virtual int      DevType(u32 handle) = 0;
 	virtual int      Flags() = 0;
 	virtual u64      FreeSpace(const std::string &path) = 0;
+	// File systems that share state must return the same owner, so their I/O is serialized together.
+	virtual IFileSystem *IOLockOwner() { return this; }
 };
 
 
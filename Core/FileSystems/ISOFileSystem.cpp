@@ -23,6 +23,8 @@
 #include "Common/Common.h"
 #include "Common/CommonTypes.h"
 #include "Common/ChunkFile.h"
+#include "thread/threadutil.h"
+#include "Core/Config.h"
 #include "Core/FileSystems/ISOFileSystem.h"
 #include "Core/HLE/sceKernel.h"
 #include "Core/MemMap.h"
@@ -196,14 +198,16 @@ ISOFileSystem::ISOFileSystem(IHandleAllocator *_hAlloc, BlockDevice *_blockDevic
 }
 
 ISOFileSystem::~ISOFileSystem() {
+	ShutdownReadAhead();
 	delete blockDevice;
 	delete treeroot;
 }
 
 void ISOFileSystem::ReadDirectory(TreeEntry *root) {
+	const std::string prefix = root == treeroot ? "" : EntryFullPath(root).substr(1) + "/";
 	for (u32 secnum = root->startsector, endsector = root->startsector + (root->dirsize + 2047) / 2048; secnum < endsector; ++secnum) {
 		u8 theSector[2048];
-		if (!blockDevice->ReadBlock(secnum, theSector)) {
+		if (!ReadDeviceBlock(secnum, theSector)) {
 			blockDevice->NotifyReadError();
 			ERROR_LOG(FILESYS, "Error reading block for directory %s - skipping", root->name.c_str());
 			root->valid = true;  // Prevents re-reading
@@ -261,11 +265,26 @@ void ISOFileSystem::ReadDirectory(TreeEntry *root) {
 				}
 			}
 			root->children.push_back(entry);
+			// Like walking the children, the first entry with a name wins.
+			if (!relative)
+				pathIndex_.emplace(prefix + entry->name, entry);
 		}
 	}
 	root->valid = true;
 }
 
+static bool HasRelativeComponent(const std::string &path, size_t start) {
+	while (start < path.size()) {
+		size_t end = path.find('/', start);
+		if (end == std::string::npos)
+			end = path.size();
+		if ((end - start == 1 && path[start] == '.') || (end - start == 2 && path[start] == '.' && path[start + 1] == '.'))
+			return true;
+		start = end + 1;
+	}
+	return false;
+}
+
 ISOFileSystem::TreeEntry *ISOFileSystem::GetFromPath(const std::string &path, bool catchError) {
 	const size_t pathLength = path.length();
 
@@ -287,6 +306,33 @@ ISOFileSystem::TreeEntry *ISOFileSystem::GetFromPath(const std::string &path, bo
 	if (pathLength <= pathIndex)
 		return treeroot;
 
+	// Once a directory has been read, lookups inside it are a hash lookup, including misses.
+	// "." and ".." aren't indexed, so those paths walk the tree.
+	if (!HasRelativeComponent(path, pathIndex)) {
+		size_t keyLength = pathLength - pathIndex;
+		if (path[pathLength - 1] == '/')
+			--keyLength;
+		const std::string key = path.substr(pathIndex, keyLength);
+		auto it = pathIndex_.find(key);
+		if (it != pathIndex_.end()) {
+			if (!it->second->valid)
+				ReadDirectory(it->second);
+			return it->second;
+		}
+
+		size_t parentLength = key.rfind('/');
+		TreeEntry *parent = treeroot;
+		if (parentLength != std::string::npos) {
+			auto parentIt = pathIndex_.find(key.substr(0, parentLength));
+			parent = parentIt != pathIndex_.end() ? parentIt->second : nullptr;
+		}
+		if (parent && parent->valid) {
+			if (catchError)
+				ERROR_LOG(FILESYS, "File %s not found", path.c_str());
+			return 0;
+		}
+	}
+
 	TreeEntry *entry = treeroot;
 	while (true) {
 		if (!entry->valid) {
@@ -334,6 +380,7 @@ int ISOFileSystem::OpenFile(std::string filename, FileAccess access, const char
 	OpenFileEntry entry;
 	entry.isRawSector = false;
 	entry.isBlockSectorMode = false;
+	entry.nextReadPos = 0;
 
 	if (access & FILEACCESS_WRITE) {
 		ERROR_LOG(FILESYS, "Can't open file %s with write access on an ISO partition", filename.c_str());
@@ -391,6 +438,9 @@ void ISOFileSystem::CloseFile(u32 handle) {
 		//CloseHandle((*iter).second.hFile);
 		hAlloc->FreeHandle(handle);
 		entries.erase(iter);
+
+		std::lock_guard<std::mutex> guard(readAheadLock_);
+		readAhead_.erase(handle);
 	} else {
 		//This shouldn't happen...
 		ERROR_LOG(FILESYS, "Hey, what are you doing? Closing non-open files?");
@@ -425,7 +475,7 @@ int ISOFileSystem::Ioctl(u32 handle, u32 cmd, u32 indataPtr, u32 inlen, u32 outd
 		}
 
 		INFO_LOG(SCEIO, "sceIoIoctl: reading ISO9660 volume descriptor read");
-		blockDevice->ReadBlock(16, Memory::GetPointer(outdataPtr));
+		ReadDeviceBlock(16, Memory::GetPointer(outdataPtr));
 		return 0;
 
 	// Get ISO9660 path table (from open ISO9660 file.)
@@ -436,7 +486,7 @@ int ISOFileSystem::Ioctl(u32 handle, u32 cmd, u32 indataPtr, u32 inlen, u32 outd
 		}
 
 		VolDescriptor desc;
-		blockDevice->ReadBlock(16, (u8 *)&desc);
+		ReadDeviceBlock(16, (u8 *)&desc);
 		if (outlen < (u32)desc.pathTableLengthLE) {
 			return SCE_KERNEL_ERROR_ERRNO_INVALID_ARGUMENT;
 		} else {
@@ -445,14 +495,14 @@ int ISOFileSystem::Ioctl(u32 handle, u32 cmd, u32 indataPtr, u32 inlen, u32 outd
 			u8 *out = Memory::GetPointer(outdataPtr);
 
 			int blocks = size / blockDevice->GetBlockSize();
-			blockDevice->ReadBlocks(block, blocks, out);
+			ReadDeviceBlocks(block, blocks, out);
 			size -= blocks * blockDevice->GetBlockSize();
 			out += blocks * blockDevice->GetBlockSize();
 
 			// The remaining (or, usually, only) partial sector.
 			if (size > 0) {
 				u8 temp[2048];
-				blockDevice->ReadBlock(block, temp);
+				ReadDeviceBlock(block, temp);
 				memcpy(out, temp, size);
 			}
 			return 0;
@@ -485,28 +535,34 @@ size_t ISOFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &usec) {
 		
 		if (e.isBlockSectorMode) {
 			// Whole sectors! Shortcut to this simple code.
-			blockDevice->ReadBlocks(e.seekPos, (int)size, pointer);
+			const bool sequential = (u64)e.seekPos * 2048 == e.nextReadPos;
+			ReadFileSectors(handle, e.seekPos, (u32)size, pointer);
 			if (abs((int)lastReadBlock_ - (int)e.seekPos) > 100) {
 				// This is an estimate, sometimes it takes 1+ seconds, but it definitely takes time.
 				usec = 100000;
 			}
 			e.seekPos += (int)size;
+			e.nextReadPos = (u64)e.seekPos * 2048;
 			lastReadBlock_ = e.seekPos;
+			if (sequential)
+				StartReadAhead(handle, e.seekPos, blockDevice->GetNumBlocks());
 			return (int)size;
 		}
 
 		u64 positionOnIso;
+		u64 fileStart;
 		s64 fileSize;
 		if (e.isRawSector) {
-			positionOnIso = e.sectorStart * 2048ULL + e.seekPos;
+			fileStart = e.sectorStart * 2048ULL;
 			fileSize = (s64)e.openSize;
 		} else if (e.file == nullptr) {
 			ERROR_LOG(FILESYS, "File no longer exists (loaded savestate with different ISO?)");
 			return 0;
 		} else {
-			positionOnIso = e.file->startingPosition + e.seekPos;
+			fileStart = e.file->startingPosition;
 			fileSize = e.file->size;
 		}
+		positionOnIso = fileStart + e.seekPos;
 
 		if ((s64)e.seekPos > fileSize) {
 			WARN_LOG(FILESYS, "Read starting outside of file, at %lld / %lld", (s64)e.seekPos, fileSize);
@@ -530,24 +586,30 @@ size_t ISOFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &usec) {
 		_dbg_assert_msg_(FILESYS, (middleSize & 2047) == 0, "Remaining size should be aligned");
 
 		const u8 *const start = pointer;
+		const bool sequential = positionOnIso == e.nextReadPos;
 		if (firstBlockSize > 0) {
-			blockDevice->ReadBlock(secNum++, theSector);
+			ReadFileSectors(handle, secNum++, 1, theSector);
 			memcpy(pointer, theSector + firstBlockOffset, firstBlockSize);
 			pointer += firstBlockSize;
 		}
 		if (middleSize > 0) {
 			const u32 sectors = (u32)(middleSize / 2048);
-			blockDevice->ReadBlocks(secNum, sectors, pointer);
+			ReadFileSectors(handle, secNum, sectors, pointer);
 			secNum += sectors;
 			pointer += middleSize;
 		}
 		if (lastBlockSize > 0) {
-			blockDevice->ReadBlock(secNum++, theSector);
+			ReadFileSectors(handle, secNum++, 1, theSector);
 			memcpy(pointer, theSector, lastBlockSize);
 			pointer += lastBlockSize;
 		}
 
 		size_t totalBytes = pointer - start;
+		e.nextReadPos = positionOnIso + totalBytes;
+		if (sequential) {
+			const u32 endSector = (u32)((fileStart + fileSize + 2047) / 2048);
+			StartReadAhead(handle, (u32)(e.nextReadPos / 2048), std::min(endSector, blockDevice->GetNumBlocks()));
+		}
 		if (abs((int)lastReadBlock_ - (int)secNum) > 100) {
 			// This is an estimate, sometimes it takes 1+ seconds, but it definitely takes time.
 			usec = 100000;
@@ -562,6 +624,98 @@ size_t ISOFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &usec) {
 	}
 }
 
+bool ISOFileSystem::ReadDeviceBlock(u32 sector, u8 *dest) {
+	std::lock_guard<std::mutex> guard(blockDeviceLock_);
+	return blockDevice->ReadBlock(sector, dest);
+}
+
+bool ISOFileSystem::ReadDeviceBlocks(u32 sector, u32 count, u8 *dest) {
+	std::lock_guard<std::mutex> guard(blockDeviceLock_);
+	return blockDevice->ReadBlocks(sector, count, dest);
+}
+
+bool ISOFileSystem::ReadFileSectors(u32 handle, u32 sector, u32 count, u8 *dest) {
+	std::unique_lock<std::mutex> guard(readAheadLock_);
+	auto it = readAhead_.find(handle);
+	if (it != readAhead_.end()) {
+		ReadAheadBuffer &buf = it->second;
+		auto inWindow = [&] {
+			return sector >= buf.startSector && sector < buf.startSector + buf.sectors;
+		};
+		while (buf.pending && inWindow()) {
+			readAheadDone_.wait(guard);
+		}
+		if (inWindow()) {
+			const u32 avail = std::min(count, buf.startSector + buf.sectors - sector);
+			memcpy(dest, &buf.data[(size_t)(sector - buf.startSector) * 2048], (size_t)avail * 2048);
+			sector += avail;
+			count -= avail;
+			dest += (size_t)avail * 2048;
+		}
+	}
+	guard.unlock();
+
+	if (count == 0)
+		return true;
+	if (count == 1)
+		return ReadDeviceBlock(sector, dest);
+	return ReadDeviceBlocks(sector, count, dest);
+}
+
+void ISOFileSystem::StartReadAhead(u32 handle, u32 sector, u32 endSector) {
+	const u32 window = (u32)std::max(g_Config.iUMDReadAheadKB, 0) / 2;
+	if (window == 0 || sector >= endSector)
+		return;
+
+	std::lock_guard<std::mutex> guard(readAheadLock_);
+	ReadAheadBuffer &buf = readAhead_[handle];
+	if (sector >= buf.startSector && sector + window / 2 <= buf.startSector + buf.sectors) {
+		// Still plenty buffered (or on the way.)
+		return;
+	}
+	if (aheadThreadRunning_) {
+		// Already busy with another handle.
+		return;
+	}
+
+	const u32 count = std::min(window, endSector - sector);
+	buf.startSector = sector;
+	buf.sectors = count;
+	buf.pending = true;
+
+	aheadThreadRunning_ = true;
+	if (aheadThread_.joinable())
+		aheadThread_.join();
+	aheadThread_ = std::thread([this, handle, sector, count] {
+		setCurrentThreadName("UMDReadAhead");
+		setCurrentThreadRole(ThreadRole::BACKGROUND);
+
+		std::vector<u8> data((size_t)count * 2048);
+		bool success = ReadDeviceBlocks(sector, count, &data[0]);
+
+		std::lock_guard<std::mutex> guard(readAheadLock_);
+		auto it = readAhead_.find(handle);
+		// The handle may have been closed (or even reused) meanwhile.
+		if (it != readAhead_.end() && it->second.pending && it->second.startSector == sector && it->second.sectors == count) {
+			if (success)
+				it->second.data.swap(data);
+			else
+				it->second.sectors = 0;
+			it->second.pending = false;
+		}
+		aheadThreadRunning_ = false;
+		readAheadDone_.notify_all();
+	});
+}
+
+void ISOFileSystem::ShutdownReadAhead() {
+	if (aheadThread_.joinable())
+		aheadThread_.join();
+
+	std::lock_guard<std::mutex> guard(readAheadLock_);
+	readAhead_.clear();
+}
+
 size_t ISOFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size) {
 	ERROR_LOG(FILESYS, "Hey, what are you doing? You can't write to an ISO!");
 	return 0;
@@ -705,6 +859,7 @@ void ISOFileSystem::DoState(PointerWrap &p) {
 	p.Do(n);
 
 	if (p.mode == p.MODE_READ) {
+		ShutdownReadAhead();
 		entries.clear();
 		for (int i = 0; i < n; ++i) {
 			u32 fd = 0;
@@ -716,6 +871,7 @@ void ISOFileSystem::DoState(PointerWrap &p) {
 			p.Do(of.isBlockSectorMode);
 			p.Do(of.sectorStart);
 			p.Do(of.openSize);
+			of.nextReadPos = 0;
 
 			bool hasFile = false;
 			p.Do(hasFile);
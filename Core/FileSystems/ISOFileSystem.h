@@ -17,8 +17,13 @@
 
 #pragma once
 
+#include <condition_variable>
 #include <map>
 #include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "FileSystem.h"
 
@@ -81,6 +86,15 @@ class ISOFileSystem : public IFileSystem {
 		bool isBlockSectorMode;  // "umd:" mode: all sizes and offsets are in 2048 byte chunks
 		u32 sectorStart;
 		u32 openSize;
+		u64 nextReadPos;  // Position on the ISO just past the last read, to detect sequential reads.
+	};
+
+	// Sectors prefetched for a handle after sequential reads.
+	struct ReadAheadBuffer {
+		u32 startSector = 0;
+		u32 sectors = 0;
+		bool pending = false;
+		std::vector<u8> data;
 	};
 
 	typedef std::map<u32,OpenFileEntry> EntryMap;
@@ -92,9 +106,26 @@ class ISOFileSystem : public IFileSystem {
 
 	TreeEntry entireISO;
 
+	// Full paths (no leading slash) of everything in the directories read so far.
+	std::unordered_map<std::string, TreeEntry *> pathIndex_;
+
+	// Guards blockDevice, which the readahead thread also reads from.
+	std::mutex blockDeviceLock_;
+	std::map<u32, ReadAheadBuffer> readAhead_;
+	std::mutex readAheadLock_;
+	std::condition_variable readAheadDone_;
+	std::thread aheadThread_;
+	bool aheadThreadRunning_ = false;
+
 	void ReadDirectory(TreeEntry *root);
 	TreeEntry *GetFromPath(const std::string &path, bool catchError = true);
 	std::string EntryFullPath(TreeEntry *e);
+
+	bool ReadDeviceBlock(u32 sector, u8 *dest);
+	bool ReadDeviceBlocks(u32 sector, u32 count, u8 *dest);
+	bool ReadFileSectors(u32 handle, u32 sector, u32 count, u8 *dest);
+	void StartReadAhead(u32 handle, u32 sector, u32 endSector);
+	void ShutdownReadAhead();
 };
 
 // On the "umd0:" device, any file you open is the entire ISO.
@@ -139,6 +170,7 @@ class ISOBlockSystem : public IFileSystem {
 	}
 	int      Flags() override { return isoFileSystem_->Flags(); }
 	u64      FreeSpace(const std::string &path) override { return isoFileSystem_->FreeSpace(path); }
+	IFileSystem *IOLockOwner() override { return isoFileSystem_; }
 
 	size_t WriteFile(u32 handle, const u8 *pointer, s64 size) override {
 		return isoFileSystem_->WriteFile(handle, pointer, size);
@@ -164,9 +164,36 @@ static bool RealPath(const std::string &currentDirectory, const std::string &inP
 	return true;
 }
 
+MetaFileSystem::SystemLock MetaFileSystem::LockSystem(IFileSystem *system, std::unique_lock<ProfiledRecursiveMutex> &guard)
+{
+	SystemLock systemLock;
+	std::shared_ptr<ProfiledRecursiveMutex> &mutex = systemLocks_[system->IOLockOwner()];
+	if (!mutex)
+		mutex.reset(new ProfiledRecursiveMutex("FileSystemIO"));
+	systemLock.mutex = mutex;
+
+	systemLock.guard = std::unique_lock<ProfiledRecursiveMutex>(*systemLock.mutex, std::try_to_lock);
+	if (systemLock.guard.owns_lock())
+		return systemLock;
+
+	// Someone's busy with it (probably a long read.)  Don't hold up the other systems meanwhile.
+	guard.unlock();
+	systemLock.guard.lock();
+	guard.lock();
+
+	// It might've been unmounted (and deleted) while we waited.
+	for (size_t i = 0; i < fileSystems.size(); i++)
+	{
+		if (fileSystems[i].system == system)
+			return systemLock;
+	}
+	systemLock.guard.unlock();
+	return systemLock;
+}
+
 IFileSystem *MetaFileSystem::GetHandleOwner(u32 handle)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::lock_guard<ProfiledRecursiveMutex> guard(lock);
 	for (size_t i = 0; i < fileSystems.size(); i++)
 	{
 		if (fileSystems[i].system->OwnsHandle(handle))
@@ -179,7 +206,7 @@ IFileSystem *MetaFileSystem::GetHandleOwner(u32 handle)
 int MetaFileSystem::MapFilePath(const std::string &_inpath, std::string &outpath, MountPoint **system)
 {
 	int error = -1;
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::lock_guard<ProfiledRecursiveMutex> guard(lock);
 	std::string realpath;
 
 	std::string inpath = _inpath;
@@ -272,7 +299,7 @@ std::string MetaFileSystem::NormalizePrefix(std::string prefix) const {
 
 void MetaFileSystem::Mount(std::string prefix, IFileSystem *system)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::lock_guard<ProfiledRecursiveMutex> guard(lock);
 	MountPoint x;
 	x.prefix = prefix;
 	x.system = system;
@@ -281,14 +308,18 @@ void MetaFileSystem::Mount(std::string prefix, IFileSystem *system)
 
 void MetaFileSystem::Unmount(std::string prefix, IFileSystem *system)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	MountPoint x;
 	x.prefix = prefix;
 	x.system = system;
+	// Wait for any I/O still running on it, the caller may delete it next.
+	auto systemGuard = LockSystem(system, guard);
 	fileSystems.erase(std::remove(fileSystems.begin(), fileSystems.end(), x), fileSystems.end());
 }
 
 void MetaFileSystem::Remount(IFileSystem *oldSystem, IFileSystem *newSystem) {
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
+	auto systemGuard = LockSystem(oldSystem, guard);
 	for (auto it = fileSystems.begin(); it != fileSystems.end(); ++it) {
 		if (it->system == oldSystem) {
 			it->system = newSystem;
@@ -313,7 +344,7 @@ IFileSystem *MetaFileSystem::GetSystem(const std::string &prefix) {
 
 void MetaFileSystem::Shutdown()
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	current = 6;
 
 	// Ownership is a bit convoluted. Let's just delete everything once.
@@ -325,8 +356,11 @@ void MetaFileSystem::Shutdown()
 
 	for (auto iter = toDelete.begin(); iter != toDelete.end(); ++iter)
 	{
-		delete *iter;
+		auto systemGuard = LockSystem(*iter, guard);
+		if (systemGuard)
+			delete *iter;
 	}
+	systemLocks_.clear();
 
 	fileSystems.clear();
 	currentDir.clear();
@@ -335,72 +369,88 @@ void MetaFileSystem::Shutdown()
 
 int MetaFileSystem::OpenFile(std::string filename, FileAccess access, const char *devicename)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	std::string of;
 	MountPoint *mount;
 	int error = MapFilePath(filename, of, &mount);
-	if (error == 0)
-		return mount->system->OpenFile(of, access, mount->prefix.c_str());
-	else
+	if (error == 0) {
+		// The mount list may change while waiting for the lock.
+		IFileSystem *system = mount->system;
+		const std::string prefix = mount->prefix;
+		auto systemGuard = LockSystem(system, guard);
+		if (!systemGuard)
+			return SCE_KERNEL_ERROR_ERRNO_FILE_NOT_FOUND;
+		return system->OpenFile(of, access, prefix.c_str());
+	} else
 		return error == -1 ? SCE_KERNEL_ERROR_ERRNO_FILE_NOT_FOUND : error;
 }
 
 PSPFileInfo MetaFileSystem::GetFileInfo(std::string filename)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	std::string of;
 	IFileSystem *system;
 	int error = MapFilePath(filename, of, &system);
 	if (error == 0)
 	{
-		return system->GetFileInfo(of);
-	}
-	else
-	{
-		PSPFileInfo bogus; // TODO
-		return bogus; 
+		auto systemGuard = LockSystem(system, guard);
+		if (systemGuard)
+		{
+			// Doesn't open or close handles, so other systems can go ahead.
+			guard.unlock();
+			return system->GetFileInfo(of);
+		}
 	}
+
+	PSPFileInfo bogus; // TODO
+	return bogus;
 }
 
 bool MetaFileSystem::GetHostPath(const std::string &inpath, std::string &outpath)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	std::string of;
 	IFileSystem *system;
 	int error = MapFilePath(inpath, of, &system);
 	if (error == 0) {
-		return system->GetHostPath(of, outpath);
-	} else {
-		return false;
+		auto systemGuard = LockSystem(system, guard);
+		if (systemGuard) {
+			guard.unlock();
+			return system->GetHostPath(of, outpath);
+		}
 	}
+	return false;
 }
 
 std::vector<PSPFileInfo> MetaFileSystem::GetDirListing(std::string path)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	std::string of;
 	IFileSystem *system;
 	int error = MapFilePath(path, of, &system);
 	if (error == 0)
 	{
-		return system->GetDirListing(of);
-	}
-	else
-	{
-		std::vector<PSPFileInfo> empty;
-		return empty;
+		auto systemGuard = LockSystem(system, guard);
+		if (systemGuard)
+		{
+			guard.unlock();
+			return system->GetDirListing(of);
+		}
 	}
+
+	std::vector<PSPFileInfo> empty;
+	return empty;
 }
 
 void MetaFileSystem::ThreadEnded(int threadID)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::lock_guard<ProfiledRecursiveMutex> guard(lock);
 	currentDir.erase(threadID);
 }
 
 int MetaFileSystem::ChDir(const std::string &dir)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::lock_guard<ProfiledRecursiveMutex> guard(lock);
 	// Retain the old path and fail if the arg is 1023 bytes or longer.
 	if (dir.size() >= 1023)
 		return SCE_KERNEL_ERROR_NAMETOOLONG;
@@ -436,13 +486,14 @@ int MetaFileSystem::ChDir(const std::string &dir)
 
 bool MetaFileSystem::MkDir(const std::string &dirname)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	std::string of;
 	IFileSystem *system;
 	int error = MapFilePath(dirname, of, &system);
 	if (error == 0)
 	{
-		return system->MkDir(of);
+		auto systemGuard = LockSystem(system, guard);
+		return systemGuard && system->MkDir(of);
 	}
 	else
 	{
@@ -452,13 +503,14 @@ bool MetaFileSystem::MkDir(const std::string &dirname)
 
 bool MetaFileSystem::RmDir(const std::string &dirname)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	std::string of;
 	IFileSystem *system;
 	int error = MapFilePath(dirname, of, &system);
 	if (error == 0)
 	{
-		return system->RmDir(of);
+		auto systemGuard = LockSystem(system, guard);
+		return systemGuard && system->RmDir(of);
 	}
 	else
 	{
@@ -468,7 +520,7 @@ bool MetaFileSystem::RmDir(const std::string &dirname)
 
 int MetaFileSystem::RenameFile(const std::string &from, const std::string &to)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	std::string of;
 	std::string rf;
 	IFileSystem *osystem;
@@ -492,6 +544,9 @@ int MetaFileSystem::RenameFile(const std::string &from, const std::string &to)
 		if (osystem != rsystem)
 			return SCE_KERNEL_ERROR_XDEV;
 
+		auto systemGuard = LockSystem(osystem, guard);
+		if (!systemGuard)
+			return -1;
 		return osystem->RenameFile(of, rf);
 	}
 	else
@@ -502,13 +557,14 @@ int MetaFileSystem::RenameFile(const std::string &from, const std::string &to)
 
 bool MetaFileSystem::RemoveFile(const std::string &filename)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	std::string of;
 	IFileSystem *system;
 	int error = MapFilePath(filename, of, &system);
 	if (error == 0)
 	{
-		return system->RemoveFile(of);
+		auto systemGuard = LockSystem(system, guard);
+		return systemGuard && system->RemoveFile(of);
 	}
 	else
 	{
@@ -518,78 +574,119 @@ bool MetaFileSystem::RemoveFile(const std::string &filename)
 
 int MetaFileSystem::Ioctl(u32 handle, u32 cmd, u32 indataPtr, u32 inlen, u32 outdataPtr, u32 outlen, int &usec)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->Ioctl(handle, cmd, indataPtr, inlen, outdataPtr, outlen, usec);
+	if (sys) {
+		auto systemGuard = LockSystem(sys, guard);
+		if (systemGuard) {
+			guard.unlock();
+			return sys->Ioctl(handle, cmd, indataPtr, inlen, outdataPtr, outlen, usec);
+		}
+	}
 	return SCE_KERNEL_ERROR_ERROR;
 }
 
 int MetaFileSystem::DevType(u32 handle)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->DevType(handle);
+	if (sys) {
+		auto systemGuard = LockSystem(sys, guard);
+		if (systemGuard) {
+			guard.unlock();
+			return sys->DevType(handle);
+		}
+	}
 	return SCE_KERNEL_ERROR_ERROR;
 }
 
 void MetaFileSystem::CloseFile(u32 handle)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		sys->CloseFile(handle);
+	if (sys) {
+		auto systemGuard = LockSystem(sys, guard);
+		if (systemGuard)
+			sys->CloseFile(handle);
+	}
 }
 
 size_t MetaFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
+	if (sys) {
+		auto systemGuard = LockSystem(sys, guard);
+		if (!systemGuard)
+			return 0;
+		// Don't block other file systems during the transfer.
+		guard.unlock();
 		return sys->ReadFile(handle, pointer, size);
-	else
+	} else {
 		return 0;
+	}
 }
 
 size_t MetaFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
+	if (sys) {
+		auto systemGuard = LockSystem(sys, guard);
+		if (!systemGuard)
+			return 0;
+		// Don't block other file systems during the transfer.
+		guard.unlock();
 		return sys->WriteFile(handle, pointer, size);
-	else
+	} else {
 		return 0;
+	}
 }
 
 size_t MetaFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &usec)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
+	if (sys) {
+		auto systemGuard = LockSystem(sys, guard);
+		if (!systemGuard)
+			return 0;
+		// Don't block other file systems during the transfer.
+		guard.unlock();
 		return sys->ReadFile(handle, pointer, size, usec);
-	else
+	} else {
 		return 0;
+	}
 }
 
 size_t MetaFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size, int &usec)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
+	if (sys) {
+		auto systemGuard = LockSystem(sys, guard);
+		if (!systemGuard)
+			return 0;
+		// Don't block other file systems during the transfer.
+		guard.unlock();
 		return sys->WriteFile(handle, pointer, size, usec);
-	else
+	} else {
 		return 0;
+	}
 }
 
 size_t MetaFileSystem::SeekFile(u32 handle, s32 position, FileMove type)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->SeekFile(handle,position,type);
-	else
-		return 0;
+	if (sys) {
+		auto systemGuard = LockSystem(sys, guard);
+		if (systemGuard) {
+			guard.unlock();
+			return sys->SeekFile(handle, position, type);
+		}
+	}
+	return 0;
 }
 
 int MetaFileSystem::ReadEntireFile(const std::string &filename, std::vector<u8> &data) {
@@ -610,19 +707,23 @@ int MetaFileSystem::ReadEntireFile(const std::string &filename, std::vector<u8>
 
 u64 MetaFileSystem::FreeSpace(const std::string &path)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 	std::string of;
 	IFileSystem *system;
 	int error = MapFilePath(path, of, &system);
-	if (error == 0)
-		return system->FreeSpace(of);
-	else
-		return 0;
+	if (error == 0) {
+		auto systemGuard = LockSystem(system, guard);
+		if (systemGuard) {
+			guard.unlock();
+			return system->FreeSpace(of);
+		}
+	}
+	return 0;
 }
 
 void MetaFileSystem::DoState(PointerWrap &p)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
+	std::unique_lock<ProfiledRecursiveMutex> guard(lock);
 
 	auto s = p.Section("MetaFileSystem", 1);
 	if (!s)
@@ -649,7 +750,10 @@ void MetaFileSystem::DoState(PointerWrap &p)
 
 	for (u32 i = 0; i < n; ++i) {
 		if (!skipPfat0 || fileSystems[i].prefix != "pfat0:") {
-			fileSystems[i].system->DoState(p);
+			IFileSystem *system = fileSystems[i].system;
+			auto systemGuard = LockSystem(system, guard);
+			if (systemGuard)
+				system->DoState(p);
 		}
 	}
 }
@@ -17,10 +17,13 @@
 
 #pragma once
 
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include <mutex>
 
+#include "thread/profiledmutex.h"
 #include "Core/FileSystems/FileSystem.h"
 
 class MetaFileSystem : public IHandleAllocator, public IFileSystem {
@@ -41,7 +44,23 @@ class MetaFileSystem : public IHandleAllocator, public IFileSystem {
 	currentDir_t currentDir;
 
 	std::string startingDirectory;
-	std::recursive_mutex lock;  // must be recursive
+	ProfiledRecursiveMutex lock{ "MetaFileSystem" };  // must be recursive
+	// Taken around calls into each file system, after lock.  Lets calls on different systems overlap.
+	std::map<IFileSystem *, std::shared_ptr<ProfiledRecursiveMutex>> systemLocks_;
+
+	struct SystemLock {
+		// Keeps the mutex alive even if the system goes away meanwhile.
+		std::shared_ptr<ProfiledRecursiveMutex> mutex;
+		std::unique_lock<ProfiledRecursiveMutex> guard;
+
+		explicit operator bool() const {
+			return guard.owns_lock();
+		}
+	};
+
+	// Lets go of lock while waiting for a busy system.  Not locked if it was unmounted meanwhile.
+	// Calls that don't open or close handles can then unlock, since each system only runs one call at a time.
+	SystemLock LockSystem(IFileSystem *system, std::unique_lock<ProfiledRecursiveMutex> &guard);
 
 public:
 	MetaFileSystem() {
@@ -122,7 +141,7 @@ class MetaFileSystem : public IHandleAllocator, public IFileSystem {
 	int ReadEntireFile(const std::string &filename, std::vector<u8> &data);
 
 	void SetStartingDirectory(const std::string &dir) {
-		std::lock_guard<std::recursive_mutex> guard(lock);
+		std::lock_guard<ProfiledRecursiveMutex> guard(lock);
 		startingDirectory = dir;
 	}
 };
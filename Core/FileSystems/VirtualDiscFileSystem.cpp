@@ -17,6 +17,8 @@
 
 #include "ppsspp_config.h"
 
+#include <algorithm>
+
 #include "Common/FileUtil.h"
 #include "Common/StringUtils.h"
 #include "Common/ChunkFile.h"
@@ -63,6 +65,7 @@ VirtualDiscFileSystem::~VirtualDiscFileSystem() {
 			iter->second.Close();
 		}
 	}
+	ClearFilePool();
 	for (auto iter = handlers.begin(), end = handlers.end(); iter != end; ++iter) {
 		delete iter->second;
 	}
@@ -172,6 +175,9 @@ void VirtualDiscFileSystem::DoState(PointerWrap &p)
 	p.Do(currentBlockIndex);
 
 	FileListEntry dummy = {""};
+	// The indexes may point at different files now.
+	if (p.mode == p.MODE_READ)
+		ClearFilePool();
 	fileList.resize(fileListSize, dummy);
 
 	for (int i = 0; i < fileListSize; i++)
@@ -462,8 +468,7 @@ size_t VirtualDiscFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &u
 		}
 
 		// it's the whole iso... it could reference any of the files on the disc.
-		// For now let's just open and close the files on demand. Can certainly be done
-		// better though
+		// Opening the files is slow, so recently used ones are kept open in a pool.
 		if (iter->second.type == VFILETYPE_ISO)
 		{
 			int fileIndex = getFileListIndex(iter->second.curOffset,size*2048,true);
@@ -473,13 +478,8 @@ size_t VirtualDiscFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &u
 				return 0;
 			}
 
-			OpenFileEntry temp;
-			if (fileList[fileIndex].handler != NULL) {
-				temp.handler = fileList[fileIndex].handler;
-			}
-			bool success = temp.Open(basePath, fileList[fileIndex].fileName, FILEACCESS_READ);
-
-			if (!success)
+			OpenFileEntry *temp = GetPooledFile(fileIndex);
+			if (!temp)
 			{
 				ERROR_LOG(FILESYS,"VirtualDiscFileSystem: Error opening file %s", fileList[fileIndex].fileName.c_str());
 				return 0;
@@ -488,21 +488,19 @@ size_t VirtualDiscFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &u
 			u32 startOffset = (iter->second.curOffset-fileList[fileIndex].firstBlock)*2048;
 			size_t bytesRead;
 
-			temp.Seek(startOffset, FILEMOVE_BEGIN);
+			temp->Seek(startOffset, FILEMOVE_BEGIN);
 
 			u32 remainingSize = fileList[fileIndex].totalSize-startOffset;
 			if (remainingSize < size * 2048)
 			{
 				// the file doesn't fill the whole last sector
 				// read what's there and zero fill the rest like on a real disc
-				bytesRead = temp.Read(pointer, remainingSize);
+				bytesRead = temp->Read(pointer, remainingSize);
 				memset(&pointer[bytesRead], 0, size * 2048 - bytesRead);
 			} else {
-				bytesRead = temp.Read(pointer, size * 2048);
+				bytesRead = temp->Read(pointer, size * 2048);
 			}
 
-			temp.Close();
-
 			iter->second.curOffset += size;
 			// TODO: This probably isn't enough...
 			if (abs((int)lastReadBlock_ - (int)iter->second.curOffset) > 100) {
@@ -542,6 +540,46 @@ void VirtualDiscFileSystem::CloseFile(u32 handle) {
 	}
 }
 
+VirtualDiscFileSystem::OpenFileEntry *VirtualDiscFileSystem::GetPooledFile(int fileIndex) {
+	++filePoolStamp_;
+	for (PooledFile &pooled : filePool_) {
+		if (pooled.fileIndex == fileIndex) {
+			pooled.lastUsed = filePoolStamp_;
+			return &pooled.file;
+		}
+	}
+
+	OpenFileEntry entry;
+	if (fileList[fileIndex].handler != NULL) {
+		entry.handler = fileList[fileIndex].handler;
+	}
+	if (!entry.Open(basePath, fileList[fileIndex].fileName, FILEACCESS_READ)) {
+		return nullptr;
+	}
+
+	if (filePool_.size() >= MAX_POOLED_FILES) {
+		auto oldest = std::min_element(filePool_.begin(), filePool_.end(), [](const PooledFile &a, const PooledFile &b) {
+			return a.lastUsed < b.lastUsed;
+		});
+		oldest->file.Close();
+		filePool_.erase(oldest);
+	}
+
+	PooledFile pooled;
+	pooled.file = entry;
+	pooled.fileIndex = fileIndex;
+	pooled.lastUsed = filePoolStamp_;
+	filePool_.push_back(pooled);
+	return &filePool_.back().file;
+}
+
+void VirtualDiscFileSystem::ClearFilePool() {
+	for (PooledFile &pooled : filePool_) {
+		pooled.file.Close();
+	}
+	filePool_.clear();
+}
+
 bool VirtualDiscFileSystem::OwnsHandle(u32 handle) {
 	EntryMap::iterator iter = entries.find(handle);
 	return (iter != entries.end());
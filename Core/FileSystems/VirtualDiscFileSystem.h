@@ -183,5 +183,20 @@ class VirtualDiscFileSystem: public IFileSystem {
 	u32 currentBlockIndex;
 	u32 lastReadBlock_;
 
+	// Reads of the whole disc can hit any file, so keep the most recently used ones open.
+	struct PooledFile {
+		OpenFileEntry file;
+		int fileIndex;
+		u64 lastUsed;
+	};
+	enum {
+		MAX_POOLED_FILES = 16,
+	};
+	OpenFileEntry *GetPooledFile(int fileIndex);
+	void ClearFilePool();
+
+	std::vector<PooledFile> filePool_;
+	u64 filePoolStamp_ = 0;
+
 	std::map<std::string, Handler *> handlers;
 };
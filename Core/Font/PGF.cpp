@@ -21,6 +21,7 @@
 // Some parts, especially in this file, were simply copied, so I guess this really makes this file GPL3.
 
 #include <algorithm>
+#include <cstring>
 #include "Common/ChunkFile.h"
 #include "Core/MemMap.h"
 #include "Core/Reporting.h"
@@ -30,6 +31,9 @@
 #include "GPU/GPUInterface.h"
 #include "GPU/GPUState.h"
 
+// Most decoded glyph bytes to keep around per font.  CJK fonts are around 24x24 per glyph.
+static const size_t GLYPH_CACHE_MAX_BYTES = 512 * 1024;
+
 // These fonts, created by ttf2pgf, don't have complete glyph info and need to be identified.
 static bool isJPCSPFont(const char *fontName) {
 	return !strcmp(fontName, "Liberation Sans") || !strcmp(fontName, "Liberation Serif") || !strcmp(fontName, "Sazanami") || !strcmp(fontName, "UnDotum") || !strcmp(fontName, "Microsoft YaHei");
@@ -174,6 +178,9 @@ void PGF::DoState(PointerWrap &p) {
 		p.Do(shadowGlyphs);
 	}
 	p.Do(firstGlyph);
+
+	if (p.mode == p.MODE_READ)
+		ClearGlyphCache();
 }
 
 bool PGF::ReadPtr(const u8 *ptr, size_t dataSize) {
@@ -183,6 +190,8 @@ bool PGF::ReadPtr(const u8 *ptr, size_t dataSize) {
 		return false;
 	}
 
+	ClearGlyphCache();
+
 	DEBUG_LOG(SCEFONT, "Reading %d bytes of PGF header", (int)sizeof(header));
 	memcpy(&header, ptr, sizeof(header));
 	ptr += sizeof(header);
@@ -577,10 +586,6 @@ void PGF::DrawCharacter(const GlyphImage *image, int clipX, int clipY, int clipW
 		return;
 	}
 
-	size_t bitPtr = glyph.ptr * 8;
-	int numberPixels = glyph.w * glyph.h;
-	int pixelIndex = 0;
-
 	int x = image->xPos64 >> 6;
 	int y = image->yPos64 >> 6;
 	u8 xFrac = image->xPos64 & 0x3F;
@@ -597,45 +602,13 @@ void PGF::DrawCharacter(const GlyphImage *image, int clipX, int clipY, int clipW
 		clipHeight = 8192;
 
 	// Use a buffer so we can apply subpixel rendering.
-	// TODO: Cache this buffer per glyph?  Maybe even transpose it first?
-	std::vector<u8> decodedPixels;
-	decodedPixels.resize(numberPixels);
-
-	while (pixelIndex < numberPixels && bitPtr + 8 < fontDataSize * 8) {
-		// This is some kind of nibble based RLE compression.
-		int nibble = consumeBits(4, fontData, bitPtr);
-
-		int count;
-		int value = 0;
-		if (nibble < 8) {
-			value = consumeBits(4, fontData, bitPtr);
-			count = nibble + 1;
-		} else {
-			count = 16 - nibble;
-		}
-
-		for (int i = 0; i < count && pixelIndex < numberPixels; i++) {
-			if (nibble >= 8) {
-				value = consumeBits(4, fontData, bitPtr);
-			}
-
-			decodedPixels[pixelIndex++] = value | (value << 4);
-		}
-	}
+	const std::vector<u8> &decodedPixels = GetDecodedGlyph(glyph);
 
 	auto samplePixel = [&](int xx, int yy) -> u8 {
 		if (xx < 0 || yy < 0 || xx >= glyph.w || yy >= glyph.h) {
 			return 0;
 		}
-
-		int index;
-		if ((glyph.flags & FONT_PGF_BMP_OVERLAY) == FONT_PGF_BMP_H_ROWS) {
-			index = yy * glyph.w + xx;
-		} else {
-			index = xx * glyph.h + yy;
-		}
-
-		return decodedPixels[index];
+		return decodedPixels[yy * glyph.w + xx];
 	};
 
 	int renderX1 = std::max(clipX, x) - x;
@@ -645,7 +618,22 @@ void PGF::DrawCharacter(const GlyphImage *image, int clipX, int clipY, int clipW
 	int renderY2 = std::min(clipY + clipHeight - y, glyph.h + (yFrac > 0 ? 1 : 0));
 
 	if (xFrac == 0 && yFrac == 0) {
+		const FontPixelFormat pixelFormat = (FontPixelFormat)(u32)image->pixelFormat;
 		for (int yy = renderY1; yy < renderY2; ++yy) {
+			if (pixelFormat == PSP_FONT_PIXELFORMAT_8) {
+				// The pixels are already in the right format, so just copy the visible part of the row.
+				int destX1 = std::max(x + renderX1, 0);
+				int destX2 = std::min(x + renderX2, std::min((int)image->bufWidth, (int)image->bytesPerLine));
+				int destY = y + yy;
+				u32 destAddr = image->bufferPtr + destY * image->bytesPerLine + destX1;
+				if (destY < 0 || destY >= image->bufHeight || destX1 >= destX2) {
+					continue;
+				}
+				if (Memory::IsValidRange(destAddr, destX2 - destX1)) {
+					memcpy(Memory::GetPointerUnchecked(destAddr), &decodedPixels[yy * glyph.w + destX1 - x], destX2 - destX1);
+					continue;
+				}
+			}
 			for (int xx = renderX1; xx < renderX2; ++xx) {
 				u8 pixelColor = samplePixel(xx, yy);
 				SetFontPixel(image->bufferPtr, image->bytesPerLine, image->bufWidth, image->bufHeight, x + xx, y + yy, pixelColor, (FontPixelFormat)(u32)image->pixelFormat);
@@ -670,6 +658,78 @@ void PGF::DrawCharacter(const GlyphImage *image, int clipX, int clipY, int clipW
 	gpu->InvalidateCache(image->bufferPtr, image->bytesPerLine * image->bufHeight, GPU_INVALIDATE_SAFE);
 }
 
+const std::vector<u8> &PGF::GetDecodedGlyph(const Glyph &glyph) const {
+	int numberPixels = glyph.w * glyph.h;
+	auto it = glyphCacheIndex_.find(glyph.ptr);
+	if (it != glyphCacheIndex_.end()) {
+		if ((int)it->second->pixels.size() == numberPixels) {
+			glyphCache_.splice(glyphCache_.begin(), glyphCache_, it->second);
+			return it->second->pixels;
+		}
+		// Same data with different dimensions, just decode it again.
+		glyphCacheBytes_ -= it->second->pixels.size();
+		glyphCache_.erase(it->second);
+		glyphCacheIndex_.erase(it);
+	}
+
+	size_t bitPtr = glyph.ptr * 8;
+	int pixelIndex = 0;
+
+	std::vector<u8> decodedPixels;
+	decodedPixels.resize(numberPixels);
+
+	while (pixelIndex < numberPixels && bitPtr + 8 < fontDataSize * 8) {
+		// This is some kind of nibble based RLE compression.
+		int nibble = consumeBits(4, fontData, bitPtr);
+
+		int count;
+		int value = 0;
+		if (nibble < 8) {
+			value = consumeBits(4, fontData, bitPtr);
+			count = nibble + 1;
+		} else {
+			count = 16 - nibble;
+		}
+
+		for (int i = 0; i < count && pixelIndex < numberPixels; i++) {
+			if (nibble >= 8) {
+				value = consumeBits(4, fontData, bitPtr);
+			}
+
+			decodedPixels[pixelIndex++] = value | (value << 4);
+		}
+	}
+
+	// Store everything in rows, so drawing doesn't care about the direction.
+	if ((glyph.flags & FONT_PGF_BMP_OVERLAY) == FONT_PGF_BMP_V_ROWS) {
+		std::vector<u8> columns;
+		columns.swap(decodedPixels);
+		decodedPixels.resize(numberPixels);
+		for (int xx = 0; xx < glyph.w; ++xx) {
+			for (int yy = 0; yy < glyph.h; ++yy) {
+				decodedPixels[yy * glyph.w + xx] = columns[xx * glyph.h + yy];
+			}
+		}
+	}
+
+	while (!glyphCache_.empty() && glyphCacheBytes_ + numberPixels > GLYPH_CACHE_MAX_BYTES) {
+		glyphCacheBytes_ -= glyphCache_.back().pixels.size();
+		glyphCacheIndex_.erase(glyphCache_.back().ptr);
+		glyphCache_.pop_back();
+	}
+
+	glyphCache_.push_front(DecodedGlyph{ glyph.ptr, std::move(decodedPixels) });
+	glyphCacheIndex_[glyph.ptr] = glyphCache_.begin();
+	glyphCacheBytes_ += numberPixels;
+	return glyphCache_.front().pixels;
+}
+
+void PGF::ClearGlyphCache() {
+	glyphCache_.clear();
+	glyphCacheIndex_.clear();
+	glyphCacheBytes_ = 0;
+}
+
 void PGF::SetFontPixel(u32 base, int bpl, int bufWidth, int bufHeight, int x, int y, u8 pixelColor, FontPixelFormat pixelformat) const {
 	if (x < 0 || x >= bufWidth || y < 0 || y >= bufHeight) {
 		return;
@@ -19,7 +19,9 @@
 
 #pragma once
 
+#include <list>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "Common/Log.h"
@@ -283,6 +285,10 @@ class PGF {
 
 	void SetFontPixel(u32 base, int bpl, int bufWidth, int bufHeight, int x, int y, u8 pixelColor, FontPixelFormat pixelformat) const;
 
+	// Returns the glyph's pixels, 8 bits each in rows of glyph.w, decoding them if they aren't cached.
+	const std::vector<u8> &GetDecodedGlyph(const Glyph &glyph) const;
+	void ClearGlyphCache();
+
 	PGFHeaderRev3Extra rev3extra;
 
 	// Font character image data
@@ -306,4 +312,13 @@ class PGF {
 	std::vector<Glyph> glyphs;
 	std::vector<Glyph> shadowGlyphs;
 	int firstGlyph;
+
+	// Decoded glyphs keyed by data offset, most recently used first.  Not saved, rebuilt as needed.
+	struct DecodedGlyph {
+		u32 ptr;
+		std::vector<u8> pixels;
+	};
+	mutable std::list<DecodedGlyph> glyphCache_;
+	mutable std::unordered_map<u32, std::list<DecodedGlyph>::iterator> glyphCacheIndex_;
+	mutable size_t glyphCacheBytes_ = 0;
 };
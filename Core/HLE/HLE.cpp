@@ -15,8 +15,10 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
 #include <cstdarg>
 #include <map>
+#include <mutex>
 #include <vector>
 #include <string>
 
@@ -110,6 +112,7 @@ void HLEShutdown()
 	hleAfterSyscall = HLE_AFTER_NOTHING;
 	latestSyscall = nullptr;
 	moduleDB.clear();
+	hleResetSyscallProfile();
 }
 
 void RegisterModule(const char *name, int numFunctions, const HLEFunction *funcTable)
@@ -401,6 +404,57 @@ inline void hleFinishSyscall(const HLEFunction &info)
 	hleAfterSyscallReschedReason = 0;
 }
 
+struct SyscallCounter {
+	// Both point into the static module tables, so they stay valid after HLEShutdown.
+	const char *module = nullptr;
+	const char *name = nullptr;
+	// So far in the current frame.
+	u32 calls = 0;
+	double seconds = 0.0;
+	u32 frameCalls = 0;
+	double frameSeconds = 0.0;
+	u64 totalCalls = 0;
+	double totalSeconds = 0.0;
+};
+
+// Only taken while collecting stats, and then by the emu thread almost every time.
+static std::mutex syscallProfileLock;
+static std::map<KernelStatsSyscall, SyscallCounter> syscallProfile;
+
+std::vector<HLESyscallProfile> hleGetSyscallProfile() {
+	std::vector<HLESyscallProfile> result;
+	{
+		std::lock_guard<std::mutex> guard(syscallProfileLock);
+		result.reserve(syscallProfile.size());
+		for (const auto &it : syscallProfile) {
+			const SyscallCounter &c = it.second;
+			result.push_back(HLESyscallProfile{ c.module, c.name, c.frameCalls, c.frameSeconds, c.totalCalls, c.totalSeconds });
+		}
+	}
+	std::sort(result.begin(), result.end(), [](const HLESyscallProfile &a, const HLESyscallProfile &b) {
+		return a.totalSeconds > b.totalSeconds;
+	});
+	return result;
+}
+
+void hleResetSyscallProfile() {
+	std::lock_guard<std::mutex> guard(syscallProfileLock);
+	syscallProfile.clear();
+}
+
+void hleEndSyscallProfileFrame() {
+	std::lock_guard<std::mutex> guard(syscallProfileLock);
+	for (auto &it : syscallProfile) {
+		SyscallCounter &c = it.second;
+		c.frameCalls = c.calls;
+		c.frameSeconds = c.seconds;
+		c.totalCalls += c.calls;
+		c.totalSeconds += c.seconds;
+		c.calls = 0;
+		c.seconds = 0.0;
+	}
+}
+
 static void updateSyscallStats(int modulenum, int funcnum, double total)
 {
 	const char *name = moduleDB[modulenum].funcTable[funcnum].name;
@@ -408,6 +462,15 @@ static void updateSyscallStats(int modulenum, int funcnum, double total)
 	if (0 == strcmp(name, "_sceKernelIdle"))
 		return;
 
+	{
+		std::lock_guard<std::mutex> guard(syscallProfileLock);
+		SyscallCounter &counter = syscallProfile[KernelStatsSyscall(modulenum, funcnum)];
+		counter.module = moduleDB[modulenum].name;
+		counter.name = name;
+		counter.calls++;
+		counter.seconds += total;
+	}
+
 	if (total > kernelStats.slowestSyscallTime)
 	{
 		kernelStats.slowestSyscallTime = total;
@@ -520,6 +583,7 @@ void hleSetSteppingTime(double t)
 void CallSyscall(MIPSOpcode op)
 {
 	PROFILE_THIS_SCOPE("syscall");
+	CoreTiming::TimeCategoryScope timeScope(CoreTiming::TimeCategory::HLE);
 	double start = 0.0;  // need to initialize to fix the race condition where coreCollectDebugStats is enabled in the middle of this func.
 	if (coreCollectDebugStats) {
 		time_update();
@@ -19,6 +19,7 @@
 
 #include <cstdarg>
 #include <type_traits>
+#include <vector>
 #include "Common/CommonTypes.h"
 #include "Common/Log.h"
 #include "Core/MIPS/MIPS.h"
@@ -148,6 +149,24 @@ const HLEFunction *GetSyscallFuncPointer(MIPSOpcode op);
 // For jit, takes arg: const HLEFunction *
 void *GetQuickSyscallFunc(MIPSOpcode op);
 
+struct HLESyscallProfile {
+	const char *module;
+	const char *name;
+	// For the last finished frame.
+	u32 frameCalls;
+	double frameSeconds;
+	// Since the game started (or the last reset.)
+	u64 totalCalls;
+	double totalSeconds;
+};
+
+// Syscalls are only timed while collecting debug stats, see Core_ForceDebugStats().
+// Returns every function called so far, most total time first.  Safe from any thread.
+std::vector<HLESyscallProfile> hleGetSyscallProfile();
+void hleResetSyscallProfile();
+// Closes the current frame's counts, called along with the other per frame stats.
+void hleEndSyscallProfileFrame();
+
 void hleDoLogInternal(LogTypes::LOG_TYPE t, LogTypes::LOG_LEVELS level, u64 res, const char *file, int line, const char *reportTag, char retmask, const char *reason, const char *formatted_reason);
 
 template <typename T>
@@ -16,6 +16,7 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <algorithm>
+#include <deque>
 #include <map>
 #include <unordered_map>
 
@@ -49,6 +50,31 @@ enum class GPUReplacementSkip {
 
 static int skipGPUReplacements = 0;
 
+struct ReplacementCounter {
+	ReplaceFunc func;
+	u64 calls;
+	u64 cycles;
+};
+
+// A deque so references stay valid as funcs register themselves on first call.
+static std::deque<ReplacementCounter> replacementCounters;
+
+static ReplacementCounter &AddReplacementCounter(ReplaceFunc func) {
+	replacementCounters.push_back({ func, 0, 0 });
+	return replacementCounters.back();
+}
+
+// Wraps a replacement to count calls and the guest cycles it stood in for.
+template <ReplaceFunc func>
+static int CountReplacement() {
+	static ReplacementCounter &counter = AddReplacementCounter(&CountReplacement<func>);
+	int cycles = func();
+	counter.calls++;
+	if (cycles > 0)
+		counter.cycles += cycles;
+	return cycles;
+}
+
 // I think these have to be pretty accurate as these are libc replacements,
 // but we can probably get away with approximating the VFPU vsin/vcos and vrot
 // pretty roughly.
@@ -357,48 +383,66 @@ static int Replace_strlen() {
 
 static int Replace_strcpy() {
 	u32 destPtr = PARAM(0);
+	u32 srcPtr = PARAM(1);
 	char *dst = (char *)Memory::GetPointer(destPtr);
-	const char *src = (const char *)Memory::GetPointer(PARAM(1));
+	const char *src = (const char *)Memory::GetPointer(srcPtr);
+	u32 len = 0;
 	if (dst && src) {
-		strcpy(dst, src);
+		len = (u32)strlen(src) + 1;
+		memmove(dst, src, len);
 	}
 	RETURN(destPtr);
-	return 10;  // approximation
+
+	CBreakPoints::ExecMemCheck(srcPtr, false, len, currentMIPS->pc);
+	CBreakPoints::ExecMemCheck(destPtr, true, len, currentMIPS->pc);
+
+	return 10 + len * 4;  // approximation
 }
 
 static int Replace_strncpy() {
 	u32 destPtr = PARAM(0);
+	u32 srcPtr = PARAM(1);
 	char *dst = (char *)Memory::GetPointer(destPtr);
-	const char *src = (const char *)Memory::GetPointer(PARAM(1));
+	const char *src = (const char *)Memory::GetPointer(srcPtr);
 	u32 bytes = PARAM(2);
 	if (dst && src && bytes != 0) {
 		strncpy(dst, src, bytes);
 	}
 	RETURN(destPtr);
-	return 10;  // approximation
+
+	CBreakPoints::ExecMemCheck(srcPtr, false, bytes, currentMIPS->pc);
+	CBreakPoints::ExecMemCheck(destPtr, true, bytes, currentMIPS->pc);
+
+	return 10 + bytes * 4;  // approximation
 }
 
 static int Replace_strcmp() {
 	const char *a = (const char *)Memory::GetPointer(PARAM(0));
 	const char *b = (const char *)Memory::GetPointer(PARAM(1));
+	u32 len = 0;
 	if (a && b) {
-		RETURN(strcmp(a, b));
+		while (a[len] == b[len] && a[len] != 0)
+			len++;
+		RETURN((u8)a[len] - (u8)b[len]);
 	} else {
 		RETURN(0);
 	}
-	return 10;  // approximation
+	return 10 + len * 4;  // approximation
 }
 
 static int Replace_strncmp() {
 	const char *a = (const char *)Memory::GetPointer(PARAM(0));
 	const char *b = (const char *)Memory::GetPointer(PARAM(1));
 	u32 bytes = PARAM(2);
+	u32 len = 0;
 	if (a && b && bytes != 0) {
-		RETURN(strncmp(a, b, bytes));
+		while (len + 1 < bytes && a[len] == b[len] && a[len] != 0)
+			len++;
+		RETURN((u8)a[len] - (u8)b[len]);
 	} else {
 		RETURN(0);
 	}
-	return 10 + bytes / 4;  // approximation
+	return 10 + len * 4;  // approximation
 }
 
 static int Replace_fabsf() {
@@ -1252,18 +1296,18 @@ static const ReplacementTableEntry entries[] = {
 	{ "floorf", &Replace_floorf, 0, REPFLAG_DISABLED },
 	{ "ceilf", &Replace_ceilf, 0, REPFLAG_DISABLED },
 
-	{ "memcpy", &Replace_memcpy, 0, 0 },
-	{ "memcpy_jak", &Replace_memcpy_jak, 0, 0 },
-	{ "memcpy16", &Replace_memcpy16, 0, 0 },
-	{ "memcpy_swizzled", &Replace_memcpy_swizzled, 0, 0 },
-	{ "memmove", &Replace_memmove, 0, 0 },
-	{ "memset", &Replace_memset, 0, 0 },
-	{ "memset_jak", &Replace_memset_jak, 0, 0 },
-	{ "strlen", &Replace_strlen, 0, REPFLAG_DISABLED },
-	{ "strcpy", &Replace_strcpy, 0, REPFLAG_DISABLED },
-	{ "strncpy", &Replace_strncpy, 0, REPFLAG_DISABLED },
-	{ "strcmp", &Replace_strcmp, 0, REPFLAG_DISABLED },
-	{ "strncmp", &Replace_strncmp, 0, REPFLAG_DISABLED },
+	{ "memcpy", &CountReplacement<&Replace_memcpy>, 0, 0 },
+	{ "memcpy_jak", &CountReplacement<&Replace_memcpy_jak>, 0, 0 },
+	{ "memcpy16", &CountReplacement<&Replace_memcpy16>, 0, 0 },
+	{ "memcpy_swizzled", &CountReplacement<&Replace_memcpy_swizzled>, 0, 0 },
+	{ "memmove", &CountReplacement<&Replace_memmove>, 0, 0 },
+	{ "memset", &CountReplacement<&Replace_memset>, 0, 0 },
+	{ "memset_jak", &CountReplacement<&Replace_memset_jak>, 0, 0 },
+	{ "strlen", &CountReplacement<&Replace_strlen>, 0, REPFLAG_DISABLED },
+	{ "strcpy", &CountReplacement<&Replace_strcpy>, 0, REPFLAG_DISABLED },
+	{ "strncpy", &CountReplacement<&Replace_strncpy>, 0, REPFLAG_DISABLED },
+	{ "strcmp", &CountReplacement<&Replace_strcmp>, 0, REPFLAG_DISABLED },
+	{ "strncmp", &CountReplacement<&Replace_strncmp>, 0, REPFLAG_DISABLED },
 	{ "fabsf", &Replace_fabsf, JITFUNC(Replace_fabsf), REPFLAG_ALLOWINLINE | REPFLAG_DISABLED },
 	{ "dl_write_matrix", &Replace_dl_write_matrix, 0, REPFLAG_DISABLED }, // &MIPSComp::Jit::Replace_dl_write_matrix, REPFLAG_DISABLED },
 	{ "dl_write_matrix_2", &Replace_dl_write_matrix, 0, REPFLAG_DISABLED },
@@ -1357,13 +1401,36 @@ void Replacement_Init() {
 	}
 
 	skipGPUReplacements = 0;
+	for (ReplacementCounter &counter : replacementCounters) {
+		counter.calls = 0;
+		counter.cycles = 0;
+	}
 }
 
 void Replacement_Shutdown() {
+	for (const ReplacementStats &stats : GetReplacementStats()) {
+		INFO_LOG(HLE, "Replacement %s: %lld calls, %lld guest cycles", stats.name, (long long)stats.calls, (long long)stats.cycles);
+	}
+
 	replacedInstructions.clear();
 	replacementNameLookup.clear();
 }
 
+std::vector<ReplacementStats> GetReplacementStats() {
+	std::vector<ReplacementStats> result;
+	for (const ReplacementCounter &counter : replacementCounters) {
+		if (counter.calls == 0)
+			continue;
+		for (const ReplacementTableEntry &entry : entries) {
+			if (entry.replaceFunc == counter.func) {
+				result.push_back({ entry.name, counter.calls, counter.cycles });
+				break;
+			}
+		}
+	}
+	return result;
+}
+
 int GetNumReplacementFuncs() {
 	return ARRAY_SIZE(entries);
 }
@@ -34,6 +34,7 @@
 #pragma once
 
 #include <map>
+#include <vector>
 
 #include "Common/CommonTypes.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
@@ -59,8 +60,17 @@ struct ReplacementTableEntry {
 	s32 hookOffset;
 };
 
+struct ReplacementStats {
+	const char *name;
+	u64 calls;
+	// Guest cycles the replacement accounted for, i.e. emulated instructions we didn't run.
+	u64 cycles;
+};
+
 void Replacement_Init();
 void Replacement_Shutdown();
+// Only the counted libc style replacements with at least one call since Replacement_Init().
+std::vector<ReplacementStats> GetReplacementStats();
 
 int GetNumReplacementFuncs();
 std::vector<int> GetReplacementFuncIndexes(u64 hash, int funcSize);
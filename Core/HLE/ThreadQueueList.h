@@ -18,6 +18,7 @@
 #pragma once
 
 #include "Core/HLE/sceKernel.h"
+#include "Common/BitSet.h"
 #include "Common/ChunkFile.h"
 
 struct ThreadQueueList {
@@ -27,8 +28,6 @@ struct ThreadQueueList {
 	static const int INITIAL_CAPACITY = 32;
 
 	struct Queue {
-		// Next ever-been-used queue (worse priority.)
-		Queue *next;
 		// First valid item in data.
 		int first;
 		// One after last valid item in data.
@@ -51,7 +50,7 @@ struct ThreadQueueList {
 
 	ThreadQueueList() {
 		memset(queues, 0, sizeof(queues));
-		first = invalid();
+		memset(nonEmpty, 0, sizeof(nonEmpty));
 	}
 
 	~ThreadQueueList() {
@@ -75,44 +74,33 @@ struct ThreadQueueList {
 	}
 
 	inline SceUID pop_first() {
-		Queue *cur = first;
-		while (cur != invalid()) {
-			if (cur->size() > 0)
-				return cur->data[cur->first++];
-			cur = cur->next;
-		}
+		int priority = first_nonempty(NUM_QUEUES);
+		if (priority >= 0)
+			return pop(priority);
 
 		_dbg_assert_msg_(SCEKERNEL, false, "ThreadQueueList should not be empty.");
 		return 0;
 	}
 
 	inline SceUID pop_first_better(u32 priority) {
-		Queue *cur = first;
 		// Don't bother looking past (worse than) this priority.
-		Queue *stop = &queues[priority];
-		while (cur < stop) {
-			if (cur->size() > 0)
-				return cur->data[cur->first++];
-			cur = cur->next;
-		}
-
+		int better = first_nonempty(priority);
+		if (better >= 0)
+			return pop(better);
 		return 0;
 	}
 
 	inline SceUID peek_first() {
-		Queue *cur = first;
-		while (cur != invalid()) {
-			if (cur->size() > 0)
-				return cur->data[cur->first];
-			cur = cur->next;
-		}
-
+		int priority = first_nonempty(NUM_QUEUES);
+		if (priority >= 0)
+			return queues[priority].data[queues[priority].first];
 		return 0;
 	}
 
 	inline void push_front(u32 priority, const SceUID threadID) {
 		Queue *cur = &queues[priority];
 		cur->data[--cur->first] = threadID;
+		mark_nonempty(priority);
 		// If we ran out of room toward the front, add more room for next time.
 		if (cur->first == 0)
 			rebalance(priority);
@@ -121,13 +109,14 @@ struct ThreadQueueList {
 	inline void push_back(u32 priority, const SceUID threadID) {
 		Queue *cur = &queues[priority];
 		cur->data[cur->end++] = threadID;
+		mark_nonempty(priority);
 		if (cur->full())
 			rebalance(priority);
 	}
 
 	inline void remove(u32 priority, const SceUID threadID) {
 		Queue *cur = &queues[priority];
-		_dbg_assert_msg_(SCEKERNEL, cur->next != nullptr, "ThreadQueueList::Queue should already be linked up.");
+		_dbg_assert_msg_(SCEKERNEL, cur->data != nullptr, "ThreadQueueList::Queue should already be linked up.");
 
 		for (int i = cur->first; i < cur->end; ++i) {
 			if (cur->data[i] == threadID) {
@@ -139,6 +128,8 @@ struct ThreadQueueList {
 
 				// Now we're one shorter.
 				--cur->end;
+				if (cur->empty())
+					mark_empty(priority);
 				return;
 			}
 		}
@@ -148,7 +139,7 @@ struct ThreadQueueList {
 
 	inline void rotate(u32 priority) {
 		Queue *cur = &queues[priority];
-		_dbg_assert_msg_(SCEKERNEL, cur->next != nullptr, "ThreadQueueList::Queue should already be linked up.");
+		_dbg_assert_msg_(SCEKERNEL, cur->data != nullptr, "ThreadQueueList::Queue should already be linked up.");
 
 		if (cur->size() > 1) {
 			// Grab the front and push it on the end.
@@ -164,7 +155,7 @@ struct ThreadQueueList {
 				free(queues[i].data);
 		}
 		memset(queues, 0, sizeof(queues));
-		first = invalid();
+		memset(nonEmpty, 0, sizeof(nonEmpty));
 	}
 
 	inline bool empty(u32 priority) const {
@@ -174,7 +165,7 @@ struct ThreadQueueList {
 
 	inline void prepare(u32 priority) {
 		Queue *cur = &queues[priority];
-		if (cur->next == nullptr)
+		if (cur->data == nullptr)
 			link(priority, INITIAL_CAPACITY);
 	}
 
@@ -212,15 +203,42 @@ struct ThreadQueueList {
 
 			if (size != 0)
 				p.DoArray(&cur->data[cur->first], size);
+			if (p.mode == p.MODE_READ && size != 0)
+				mark_nonempty(i);
 		}
 	}
 
 private:
-	Queue *invalid() const {
-		return (Queue *)-1;
+	static const int BITS_PER_WORD = 32;
+
+	// Returns the best priority with any threads better than (less than) stop, or -1.
+	inline int first_nonempty(u32 stop) const {
+		for (int w = 0; w < NUM_QUEUES / BITS_PER_WORD && (u32)(w * BITS_PER_WORD) < stop; ++w) {
+			if (nonEmpty[w] != 0) {
+				int priority = w * BITS_PER_WORD + LeastSignificantSetBit(nonEmpty[w]);
+				return (u32)priority < stop ? priority : -1;
+			}
+		}
+		return -1;
+	}
+
+	inline SceUID pop(u32 priority) {
+		Queue *cur = &queues[priority];
+		SceUID id = cur->data[cur->first++];
+		if (cur->empty())
+			mark_empty(priority);
+		return id;
+	}
+
+	inline void mark_nonempty(u32 priority) {
+		nonEmpty[priority / BITS_PER_WORD] |= 1U << (priority % BITS_PER_WORD);
+	}
+
+	inline void mark_empty(u32 priority) {
+		nonEmpty[priority / BITS_PER_WORD] &= ~(1U << (priority % BITS_PER_WORD));
 	}
 
-	// Initialize a priority level and link to other queues.
+	// Initialize a priority level.
 	void link(u32 priority, int size) {
 		_dbg_assert_msg_(SCEKERNEL, queues[priority].data == nullptr, "ThreadQueueList::Queue should only be initialized once.");
 
@@ -241,21 +259,6 @@ struct ThreadQueueList {
 		// Start smack in the middle so it can move both directions.
 		cur->first = size / 2;
 		cur->end = size / 2;
-
-		for (int i = (int)priority - 1; i >= 0; --i) {
-			// This queue is before ours, and points past us.
-			// We'll have it point to our new queue, inserting into the chain.
-			if (queues[i].next != nullptr) {
-				cur->next = queues[i].next;
-				queues[i].next = cur;
-				return;
-			}
-		}
-
-		// Never found above - that means there's no better queue yet.
-		// The new one is now first, and whoever was first is after it.
-		cur->next = first;
-		first = cur;
 	}
 
 	// Move or allocate as necessary to maintain free space on both sides.
@@ -282,8 +285,8 @@ struct ThreadQueueList {
 		}
 	}
 
-	// The first queue that's ever been used.
-	Queue *first;
+	// One bit per priority level with any threads, so finding the best is a bit scan.
+	u32 nonEmpty[NUM_QUEUES / BITS_PER_WORD];
 	// The priority level queues of thread ids.
 	Queue queues[NUM_QUEUES];
 };
@@ -183,6 +183,89 @@ void changeBlockingMode(int fd, int nonblocking) {
 #endif
 }
 
+#if defined(__linux__) && !defined(__ANDROID__)
+#define ADHOC_HAVE_SENDMMSG
+#endif
+
+static int beginSocketCall(int fd, int nonblocking) {
+#ifdef MSG_DONTWAIT
+	return nonblocking ? MSG_DONTWAIT : 0;
+#else
+	changeBlockingMode(fd, nonblocking);
+	return 0;
+#endif
+}
+
+static int endSocketCall(int fd, int result) {
+#ifndef MSG_DONTWAIT
+	int error = errno;
+	changeBlockingMode(fd, 0);
+#ifdef _WIN32
+	WSASetLastError(error);
+#endif
+#endif
+	return result;
+}
+
+int adhocSend(int fd, const void *data, int len, int nonblocking) {
+	int flags = beginSocketCall(fd, nonblocking);
+	return endSocketCall(fd, send(fd, (const char *)data, len, flags));
+}
+
+int adhocRecv(int fd, void *buf, int len, int nonblocking) {
+	int flags = beginSocketCall(fd, nonblocking);
+	return endSocketCall(fd, recv(fd, (char *)buf, len, flags));
+}
+
+int adhocSendTo(int fd, const void *data, int len, const sockaddr_in *target, int nonblocking) {
+	int flags = beginSocketCall(fd, nonblocking);
+	return endSocketCall(fd, sendto(fd, (const char *)data, len, flags, (const sockaddr *)target, sizeof(*target)));
+}
+
+int adhocRecvFrom(int fd, void *buf, int len, sockaddr_in *sin, socklen_t *sinlen, int nonblocking) {
+	int flags = beginSocketCall(fd, nonblocking);
+	return endSocketCall(fd, recvfrom(fd, (char *)buf, len, flags, (sockaddr *)sin, sinlen));
+}
+
+int adhocSendToMany(int fd, const void *data, int len, const sockaddr_in *targets, int count, int nonblocking) {
+	int flags = beginSocketCall(fd, nonblocking);
+	int delivered = 0;
+#ifdef ADHOC_HAVE_SENDMMSG
+	std::vector<mmsghdr> msgs(count);
+	iovec iov;
+	iov.iov_base = (void *)data;
+	iov.iov_len = len;
+	for (int i = 0; i < count; i++) {
+		memset(&msgs[i], 0, sizeof(msgs[i]));
+		msgs[i].msg_hdr.msg_name = (void *)&targets[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(targets[i]);
+		msgs[i].msg_hdr.msg_iov = &iov;
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	int i = 0;
+	while (i < count) {
+		int sent = sendmmsg(fd, &msgs[i], count - i, flags);
+		if (sent <= 0) {
+			// The datagram at i failed, skip it like a plain sendto loop would.
+			DEBUG_LOG(SCENET, "Socket Error (%i) on adhocSendToMany", errno);
+			i++;
+			continue;
+		}
+		delivered += sent;
+		i += sent;
+	}
+#else
+	for (int i = 0; i < count; i++) {
+		int sent = sendto(fd, (const char *)data, len, flags, (const sockaddr *)&targets[i], sizeof(targets[i]));
+		if (sent >= 0)
+			delivered++;
+		else
+			DEBUG_LOG(SCENET, "Socket Error (%i) on adhocSendToMany", errno);
+	}
+#endif
+	return endSocketCall(fd, delivered);
+}
+
 int countAvailableNetworks(void) {
 	// Network Count
 	int count = 0;
@@ -859,6 +859,22 @@ SceNetAdhocctlPeerInfo * findFriend(SceNetEtherAddr * MAC);
  */
 void changeBlockingMode(int fd, int nonblocking);
 
+/**
+ * Socket calls that honor a per-call nonblocking flag.
+ * Where the OS supports MSG_DONTWAIT this avoids switching the socket's blocking mode around every call.
+ * @return Same as the underlying socket call, errno is preserved
+ */
+int adhocSend(int fd, const void *data, int len, int nonblocking);
+int adhocRecv(int fd, void *buf, int len, int nonblocking);
+int adhocSendTo(int fd, const void *data, int len, const sockaddr_in *target, int nonblocking);
+int adhocRecvFrom(int fd, void *buf, int len, sockaddr_in *sin, socklen_t *sinlen, int nonblocking);
+
+/**
+ * Sends the same datagram to several targets, batched into as few syscalls as possible (sendmmsg on Linux)
+ * @return Number of targets the datagram was sent to
+ */
+int adhocSendToMany(int fd, const void *data, int len, const sockaddr_in *targets, int count, int nonblocking);
+
 /**
  * Count Virtual Networks by analyzing the Friend List
  * @return Number of Virtual Networks
@@ -41,6 +41,15 @@
 
 #include <fcntl.h>
 #include <errno.h>
+
+// Readiness Notification
+#if defined(__linux__)
+#include <sys/epoll.h>
+#define SERVER_USE_EPOLL
+#elif !defined(_WIN32)
+#include <poll.h>
+#endif
+
 //#include <sqlite3.h>
 #include "Common/FileUtil.h"
 #include "Core/Core.h"
@@ -61,6 +70,14 @@ SceNetAdhocctlGameNode * _db_game = NULL;
 bool adhocServerRunning = false;
 std::thread adhocServerThread;
 
+#ifdef SERVER_USE_EPOLL
+// Readiness Notification Descriptor
+static int _poll_fd = -1;
+#endif
+
+// User whose RX Buffer is being processed (cleared if it gets logged out meanwhile)
+static SceNetAdhocctlUserNode * _rx_user = NULL;
+
 // Crosslink database for cross region Adhoc play
 std::vector<db_crosslink> crosslinks;
 static const db_crosslink default_crosslinks[] = {
@@ -475,6 +492,9 @@ void enable_address_reuse(int fd);
 void change_blocking_mode(int fd, int nonblocking);
 int create_listen_socket(uint16_t port);
 int server_loop(int server);
+static void server_poll_add(int fd, SceNetAdhocctlUserNode * user);
+static void server_poll_remove(SceNetAdhocctlUserNode * user);
+static void server_poll_want_write(SceNetAdhocctlUserNode * user, int enable);
 
 void __AdhocServerInit() {
 	// Database Product name will update if new game region played on my server to list possible crosslinks
@@ -527,6 +547,9 @@ void login_user_stream(int fd, uint32_t ip)
 				// Initialize Death Clock
 				user->last_recv = time(NULL);
 
+				// Watch Socket for Incoming Data
+				server_poll_add(fd, user);
+
 				// Notify User
 				uint8_t * ipa = (uint8_t *)&user->resolver.ip;
 				INFO_LOG(SCENET, "AdhocServer: New Connection from %u.%u.%u.%u", ipa[0], ipa[1], ipa[2], ipa[3]);
@@ -656,9 +679,18 @@ void logout_user(SceNetAdhocctlUserNode * user)
 	// Unlink Rightside
 	if(user->next != NULL) user->next->prev = user->prev;
 
+	// Send pending Data (best effort)
+	if(user->txpos > 0) flush_user_send(user);
+
+	// Stop Watching Socket
+	server_poll_remove(user);
+
 	// Close Stream
 	closesocket(user->stream);
 
+	// Stop processing this User's RX Buffer
+	if(_rx_user == user) _rx_user = NULL;
+
 	// Playing User
 	if(user->game != NULL)
 	{
@@ -698,6 +730,7 @@ void logout_user(SceNetAdhocctlUserNode * user)
 	}
 
 	// Free Memory
+	free(user->tx);
 	free(user);
 
 	// Fix User Counter
@@ -837,8 +870,7 @@ void connect_user(SceNetAdhocctlUserNode * user, SceNetAdhocctlGroupName * group
 					packet.ip = user->resolver.ip;
 
 					// Send Data
-					int iResult = send(peer->stream, (const char*)&packet, sizeof(packet), 0);
-					if (iResult < 0) ERROR_LOG(SCENET, "AdhocServer: connect_user[send peer] (Socket error %d)", errno);
+					if (queue_user_send(peer, &packet, sizeof(packet)) < 0) ERROR_LOG(SCENET, "AdhocServer: connect_user[send peer] (TX queue full)");
 
 					// Set Player Name
 					packet.name = peer->resolver.name;
@@ -850,8 +882,7 @@ void connect_user(SceNetAdhocctlUserNode * user, SceNetAdhocctlGroupName * group
 					packet.ip = peer->resolver.ip;
 
 					// Send Data
-					iResult = send(user->stream, (const char*)&packet, sizeof(packet), 0);
-					if (iResult < 0) ERROR_LOG(SCENET, "AdhocServer: connect_user[send user] (Socket error %d)", errno);
+					if (queue_user_send(user, &packet, sizeof(packet)) < 0) ERROR_LOG(SCENET, "AdhocServer: connect_user[send user] (TX queue full)");
 
 					// Set BSSID
 					if(peer->group_next == NULL) bssid.mac = peer->resolver.mac;
@@ -872,8 +903,7 @@ void connect_user(SceNetAdhocctlUserNode * user, SceNetAdhocctlGroupName * group
 				g->playercount++;
 
 				// Send Network BSSID to User
-				int iResult = send(user->stream, (const char*)&bssid, sizeof(bssid), 0);
-				if (iResult < 0) ERROR_LOG(SCENET, "AdhocServer: connect_user[send user bssid] (Socket error %d)", errno);
+				if (queue_user_send(user, &bssid, sizeof(bssid)) < 0) ERROR_LOG(SCENET, "AdhocServer: connect_user[send user bssid] (TX queue full)");
 
 				// Notify User
 				uint8_t * ip = (uint8_t *)&user->resolver.ip;
@@ -967,8 +997,7 @@ void disconnect_user(SceNetAdhocctlUserNode * user)
 			packet.ip = user->resolver.ip;
 
 			// Send Data
-			int iResult = send(peer->stream, (const char*)&packet, sizeof(packet), 0);
-			if (iResult < 0) ERROR_LOG(SCENET, "AdhocServer: disconnect_user[send peer] (Socket error %d)", errno);
+			if (queue_user_send(peer, &packet, sizeof(packet)) < 0) ERROR_LOG(SCENET, "AdhocServer: disconnect_user[send peer] (TX queue full)");
 
 			// Move Pointer
 			peer = peer->group_next;
@@ -1068,14 +1097,12 @@ void send_scan_results(SceNetAdhocctlUserNode * user)
 			}
 
 			// Send Group Packet
-			int iResult = send(user->stream, (const char*)&packet, sizeof(packet), 0);
-			if (iResult < 0) ERROR_LOG(SCENET, "AdhocServer: send_scan_result[send user] (Socket error %d)", errno);
+			if (queue_user_send(user, &packet, sizeof(packet)) < 0) ERROR_LOG(SCENET, "AdhocServer: send_scan_result[send user] (TX queue full)");
 		}
 
 		// Notify Player of End of Scan
 		uint8_t opcode = OPCODE_SCAN_COMPLETE;
-		int iResult = send(user->stream, (const char*)&opcode, 1, 0);
-		if (iResult < 0) ERROR_LOG(SCENET, "AdhocServer: send_scan_result[send peer complete] (Socket error %d)", errno);
+		if (queue_user_send(user, &opcode, 1) < 0) ERROR_LOG(SCENET, "AdhocServer: send_scan_result[send peer complete] (TX queue full)");
 
 		// Notify User
 		uint8_t * ip = (uint8_t *)&user->resolver.ip;
@@ -1135,8 +1162,7 @@ void spread_message(SceNetAdhocctlUserNode *user, const char *message)
 				strcpy(packet.base.message, message);
 
 				// Send Data
-				int iResult = send(user->stream, (const char*)&packet, sizeof(packet), 0);
-				if (iResult < 0) ERROR_LOG(SCENET, "AdhocServer: spread_message[send user chat] (Socket error %d)", errno);
+				if (queue_user_send(user, &packet, sizeof(packet)) < 0) ERROR_LOG(SCENET, "AdhocServer: spread_message[send user chat] (TX queue full)");
 			}
 		}
 
@@ -1177,8 +1203,7 @@ void spread_message(SceNetAdhocctlUserNode *user, const char *message)
 			packet.name = user->resolver.name;
 
 			// Send Data
-			int iResult = send(peer->stream, (const char*)&packet, sizeof(packet), 0);
-			if (iResult < 0) ERROR_LOG(SCENET, "AdhocServer: spread_message[send peer chat] (Socket error %d)", errno);
+			if (queue_user_send(peer, &packet, sizeof(packet)) < 0) ERROR_LOG(SCENET, "AdhocServer: spread_message[send peer chat] (TX queue full)");
 
 			// Move Pointer
 			peer = peer->group_next;
@@ -1253,6 +1278,86 @@ void clear_user_rxbuf(SceNetAdhocctlUserNode * user, int clear)
 	user->rxpos -= clear;
 }
 
+/**
+ * Queue Data for Sending to User
+ * @param user User Node
+ * @param data Packet Data
+ * @param size Packet Size
+ * @return 0 on success or -1 if the TX Queue overflowed
+ */
+int queue_user_send(SceNetAdhocctlUserNode * user, const void * data, uint32_t size)
+{
+	// User already failed
+	if(user->txerror) return -1;
+
+	// Client fell behind, try to make room first
+	if(user->txpos + size > SERVER_USER_TX_MAXIMUM) flush_user_send(user);
+
+	// Still no room - drop User on the next Flush
+	if(user->txerror || user->txpos + size > SERVER_USER_TX_MAXIMUM)
+	{
+		user->txerror = 1;
+		return -1;
+	}
+
+	// Grow TX Queue
+	if(user->txpos + size > user->txsize)
+	{
+		uint32_t newsize = user->txsize == 0 ? 1024 : user->txsize;
+		while(newsize < user->txpos + size) newsize *= 2;
+		uint8_t * tx = (uint8_t *)realloc(user->tx, newsize);
+		if(tx == NULL)
+		{
+			user->txerror = 1;
+			return -1;
+		}
+		user->tx = tx;
+		user->txsize = newsize;
+	}
+
+	// Append Packet
+	memcpy(user->tx + user->txpos, data, size);
+	user->txpos += size;
+
+	return 0;
+}
+
+/**
+ * Send as much of the TX Queue as the Socket accepts
+ * @param user User Node
+ * @return 0 on success or -1 on Socket error
+ */
+int flush_user_send(SceNetAdhocctlUserNode * user)
+{
+	// Sent Bytes
+	uint32_t sent = 0;
+
+	// Batch all queued Packets into as few Sends as possible
+	while(sent < user->txpos && !user->txerror)
+	{
+		int iResult = send(user->stream, (const char*)user->tx + sent, user->txpos - sent, 0);
+		if(iResult > 0) sent += iResult;
+		else if(iResult < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+		else
+		{
+			ERROR_LOG(SCENET, "AdhocServer: flush_user_send (Socket error %d)", errno);
+			user->txerror = 1;
+		}
+	}
+
+	// Remove sent Data from TX Queue
+	if(sent > 0)
+	{
+		memmove(user->tx, user->tx + sent, user->txpos - sent);
+		user->txpos -= sent;
+	}
+
+	// Wait for Write Readiness while Data is left
+	server_poll_want_write(user, user->txpos > 0 && !user->txerror);
+
+	return user->txerror ? -1 : 0;
+}
+
 /**
  * Patch Game Product Code
  * @param product To-be-patched Product Code
@@ -1813,216 +1918,412 @@ int create_listen_socket(uint16_t port)
 	return -1;
 }
 
+#ifdef _WIN32
+typedef WSAPOLLFD server_pollfd;
+#define server_poll(fds, count, timeout) WSAPoll(fds, (ULONG)(count), timeout)
+#elif !defined(SERVER_USE_EPOLL)
+typedef struct pollfd server_pollfd;
+#define server_poll(fds, count, timeout) poll(fds, (nfds_t)(count), timeout)
+#endif
+
+// Ready Socket (user is NULL for the Listener)
+struct ServerEvent {
+	SceNetAdhocctlUserNode * user;
+	bool readable;
+	bool writable;
+};
+
 /**
- * Server Main Loop
+ * Register Socket for Readiness Notification
+ * @param fd Socket
+ * @param user User Node (NULL for the Listener)
+ */
+static void server_poll_add(int fd, SceNetAdhocctlUserNode * user)
+{
+#ifdef SERVER_USE_EPOLL
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = user;
+	if(epoll_ctl(_poll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) ERROR_LOG(SCENET, "AdhocServer: epoll_ctl add (Socket error %d)", errno);
+#endif
+}
+
+/**
+ * Unregister User Socket from Readiness Notification
+ * @param user User Node
+ */
+static void server_poll_remove(SceNetAdhocctlUserNode * user)
+{
+#ifdef SERVER_USE_EPOLL
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	epoll_ctl(_poll_fd, EPOLL_CTL_DEL, user->stream, &ev);
+#endif
+}
+
+/**
+ * Toggle Write Readiness Notification for User Socket
+ * @param user User Node
+ * @param enable 1 while the TX Queue has Data left
+ */
+static void server_poll_want_write(SceNetAdhocctlUserNode * user, int enable)
+{
+	// Nothing changed
+	if(user->txwait == enable) return;
+
+#ifdef SERVER_USE_EPOLL
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN | (enable ? EPOLLOUT : 0);
+	ev.data.ptr = user;
+	epoll_ctl(_poll_fd, EPOLL_CTL_MOD, user->stream, &ev);
+#endif
+
+	user->txwait = enable;
+}
+
+/**
+ * Wait for Socket Readiness
  * @param server Server Listening Socket
- * @return OS Error Code
+ * @param timeout Timeout in milliseconds
+ * @param events Ready Sockets
  */
-int server_loop(int server)
+static void server_poll_wait(int server, int timeout, std::vector<ServerEvent> &events)
 {
-	// Set Running Status
-	//_status = 1;
-	adhocServerRunning = true;
+	events.clear();
 
-	// Create Empty Status Logfile
-	update_status();
+#ifdef SERVER_USE_EPOLL
+	struct epoll_event ready[256];
+	int count = epoll_wait(_poll_fd, ready, ARRAY_SIZE(ready), timeout);
+	for(int i = 0; i < count; i++)
+	{
+		ServerEvent ev;
+		ev.user = (SceNetAdhocctlUserNode *)ready[i].data.ptr;
+		ev.readable = (ready[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0;
+		ev.writable = (ready[i].events & EPOLLOUT) != 0;
+		events.push_back(ev);
+	}
+#else
+	// Rebuilt every Wait, since Users come and go between Waits
+	static std::vector<server_pollfd> fds;
+	static std::vector<SceNetAdhocctlUserNode *> fdusers;
+	fds.clear();
+	fdusers.clear();
+
+	server_pollfd pfd;
+	memset(&pfd, 0, sizeof(pfd));
+	pfd.fd = server;
+	pfd.events = POLLIN;
+	fds.push_back(pfd);
+	fdusers.push_back(NULL);
+
+	for(SceNetAdhocctlUserNode * user = _db_user; user != NULL; user = user->next)
+	{
+		pfd.fd = user->stream;
+		pfd.events = POLLIN | (user->txwait ? POLLOUT : 0);
+		fds.push_back(pfd);
+		fdusers.push_back(user);
+	}
 
-	// Handling Loop
-	while (adhocServerRunning) //(_status == 1)
+	int count = server_poll(&fds[0], fds.size(), timeout);
+	for(size_t i = 0; count > 0 && i < fds.size(); i++)
 	{
-		// Login Block
+		if(fds[i].revents == 0) continue;
+
+		ServerEvent ev;
+		ev.user = fdusers[i];
+		ev.readable = (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+		ev.writable = (fds[i].revents & POLLOUT) != 0;
+		events.push_back(ev);
+		count--;
+	}
+#endif
+}
+
+/**
+ * Accept all pending Logins
+ * @param server Server Listening Socket
+ */
+static void accept_users(int server)
+{
+	// Login Result
+	int loginresult = 0;
+
+	// Login Processing Loop
+	do
+	{
+		// Prepare Address Structure
+		struct sockaddr_in addr;
+		socklen_t addrlen = sizeof(addr);
+		memset(&addr, 0, sizeof(addr));
+
+		// Accept Login Requests
+		// loginresult = accept4(server, (struct sockaddr *)&addr, &addrlen, SOCK_NONBLOCK);
+
+		// Alternative Accept Approach (some Linux Kernel don't support the accept4 Syscall... wtf?)
+		loginresult = accept(server, (struct sockaddr *)&addr, &addrlen);
+		if(loginresult != -1)
 		{
-			// Login Result
-			int loginresult = 0;
+			// Switch Socket into Non-Blocking Mode
+			change_blocking_mode(loginresult, 1);
+		}
 
-			// Login Processing Loop
-			do
-			{
-				// Prepare Address Structure
-				struct sockaddr_in addr;
-				socklen_t addrlen = sizeof(addr);
-				memset(&addr, 0, sizeof(addr));
+		// Login User (Stream)
+		if (loginresult != -1) {
+			u32_le sip = addr.sin_addr.s_addr;
+			if (sip == 0x0100007f) { //127.0.0.1 should be replaced with LAN/WAN IP whenever available
+				char str[100];
+				gethostname(str, 100);
+				u8 *pip = (u8*)&sip;
+				if (gethostbyname(str)->h_addrtype == AF_INET && gethostbyname(str)->h_addr_list[0] != NULL) pip = (u8*)gethostbyname(str)->h_addr_list[0];
+				sip = *(u32_le*)pip;
+				WARN_LOG(SCENET, "AdhocServer: Replacing IP %s with %u.%u.%u.%u", inet_ntoa(addr.sin_addr), pip[0], pip[1], pip[2], pip[3]);
+			}
+			login_user_stream(loginresult, sip);
+		}
+	} while(loginresult != -1);
+}
 
-				// Accept Login Requests
-				// loginresult = accept4(server, (struct sockaddr *)&addr, &addrlen, SOCK_NONBLOCK);
+/**
+ * Handle one Packet from the User's RX Buffer
+ * @param user User Node
+ * @return 1 if a Packet was consumed, 0 if more Data is needed or the User is gone
+ */
+static int process_user_packet(SceNetAdhocctlUserNode * user)
+{
+	// Buffered Data before Processing
+	uint32_t rxpos = user->rxpos;
 
-				// Alternative Accept Approach (some Linux Kernel don't support the accept4 Syscall... wtf?)
-				loginresult = accept(server, (struct sockaddr *)&addr, &addrlen);
-				if(loginresult != -1)
-				{
-					// Switch Socket into Non-Blocking Mode
-					change_blocking_mode(loginresult, 1);
-				}
+	// Waiting for Login Packet
+	if(get_user_state(user) == USER_STATE_WAITING)
+	{
+		// Valid Opcode
+		if(user->rx[0] == OPCODE_LOGIN)
+		{
+			// Enough Data available
+			if(user->rxpos >= sizeof(SceNetAdhocctlLoginPacketC2S))
+			{
+				// Clone Packet
+				SceNetAdhocctlLoginPacketC2S packet = *(SceNetAdhocctlLoginPacketC2S *)user->rx;
 
-				// Login User (Stream)
-				if (loginresult != -1) {
-					u32_le sip = addr.sin_addr.s_addr;
-					if (sip == 0x0100007f) { //127.0.0.1 should be replaced with LAN/WAN IP whenever available
-						char str[100];
-						gethostname(str, 100);
-						u8 *pip = (u8*)&sip;
-						if (gethostbyname(str)->h_addrtype == AF_INET && gethostbyname(str)->h_addr_list[0] != NULL) pip = (u8*)gethostbyname(str)->h_addr_list[0];
-						sip = *(u32_le*)pip;
-						WARN_LOG(SCENET, "AdhocServer: Replacing IP %s with %u.%u.%u.%u", inet_ntoa(addr.sin_addr), pip[0], pip[1], pip[2], pip[3]);
-					}
-					login_user_stream(loginresult, sip);
-				}
-			} while(loginresult != -1);
+				// Remove Packet from RX Buffer
+				clear_user_rxbuf(user, sizeof(SceNetAdhocctlLoginPacketC2S));
+
+				// Login User (Data)
+				login_user_data(user, &packet);
+			}
 		}
 
-		// Receive Data from Users
-		SceNetAdhocctlUserNode * user = _db_user;
-		while(user != NULL)
+		// Invalid Opcode
+		else
 		{
-			// Next User (for safe delete)
-			SceNetAdhocctlUserNode * next = user->next;
+			// Notify User
+			uint8_t * ip = (uint8_t *)&user->resolver.ip;
+			INFO_LOG(SCENET, "AdhocServer: Invalid Opcode 0x%02X in Waiting State from %u.%u.%u.%u", user->rx[0], ip[0], ip[1], ip[2], ip[3]);
+
+			// Logout User
+			logout_user(user);
+		}
+	}
 
-			// Receive Data from User
-			int recvresult = recv(user->stream, (char*)user->rx + user->rxpos, sizeof(user->rx) - user->rxpos, 0);
+	// Logged-In User
+	else if(get_user_state(user) == USER_STATE_LOGGED_IN)
+	{
+		// Ping Packet
+		if(user->rx[0] == OPCODE_PING)
+		{
+			// Delete Packet from RX Buffer
+			clear_user_rxbuf(user, 1);
+		}
 
-			// Connection Closed or Timed Out
-			if(recvresult == 0 || (recvresult == -1 && errno != EAGAIN && errno != EWOULDBLOCK) || get_user_state(user) == USER_STATE_TIMED_OUT)
+		// Group Connect Packet
+		else if(user->rx[0] == OPCODE_CONNECT)
+		{
+			// Enough Data available
+			if(user->rxpos >= sizeof(SceNetAdhocctlConnectPacketC2S))
 			{
-				// Logout User
-				logout_user(user);
+				// Cast Packet
+				SceNetAdhocctlConnectPacketC2S * packet = (SceNetAdhocctlConnectPacketC2S *)user->rx;
+
+				// Clone Group Name
+				SceNetAdhocctlGroupName group = packet->group;
+
+				// Remove Packet from RX Buffer
+				clear_user_rxbuf(user, sizeof(SceNetAdhocctlConnectPacketC2S));
+
+				// Change Game Group
+				connect_user(user, &group);
 			}
+		}
+
+		// Group Disconnect Packet
+		else if(user->rx[0] == OPCODE_DISCONNECT)
+		{
+			// Remove Packet from RX Buffer
+			clear_user_rxbuf(user, 1);
+
+			// Leave Game Group
+			disconnect_user(user);
+		}
+
+		// Network Scan Packet
+		else if(user->rx[0] == OPCODE_SCAN)
+		{
+			// Remove Packet from RX Buffer
+			clear_user_rxbuf(user, 1);
+
+			// Send Network List
+			send_scan_results(user);
+		}
 
-			// Received Data (or leftovers in RX-Buffer)
-			else if(recvresult > 0 || user->rxpos > 0)
+		// Chat Text Packet
+		else if(user->rx[0] == OPCODE_CHAT)
+		{
+			// Enough Data available
+			if(user->rxpos >= sizeof(SceNetAdhocctlChatPacketC2S))
 			{
-				// New Incoming Data
-				if(recvresult > 0)
-				{
-					// Move RX Pointer
-					user->rxpos += recvresult;
+				// Cast Packet
+				SceNetAdhocctlChatPacketC2S * packet = (SceNetAdhocctlChatPacketC2S *)user->rx;
 
-					// Update Death Clock
-					user->last_recv = time(NULL);
-				}
+				// Clone Buffer for Message
+				char message[64];
+				memset(message, 0, sizeof(message));
+				strncpy(message, packet->message, sizeof(message) - 1);
 
-				// Waiting for Login Packet
-				if(get_user_state(user) == USER_STATE_WAITING)
-				{
-					// Valid Opcode
-					if(user->rx[0] == OPCODE_LOGIN)
-					{
-						// Enough Data available
-						if(user->rxpos >= sizeof(SceNetAdhocctlLoginPacketC2S))
-						{
-							// Clone Packet
-							SceNetAdhocctlLoginPacketC2S packet = *(SceNetAdhocctlLoginPacketC2S *)user->rx;
+				// Remove Packet from RX Buffer
+				clear_user_rxbuf(user, sizeof(SceNetAdhocctlChatPacketC2S));
 
-							// Remove Packet from RX Buffer
-							clear_user_rxbuf(user, sizeof(SceNetAdhocctlLoginPacketC2S));
+				// Spread Chat Message
+				spread_message(user, message);
+			}
+		}
 
-							// Login User (Data)
-							login_user_data(user, &packet);
-						}
-					}
+		// Invalid Opcode
+		else
+		{
+			// Notify User
+			uint8_t * ip = (uint8_t *)&user->resolver.ip;
+			INFO_LOG(SCENET, "AdhocServer: Invalid Opcode 0x%02X in Logged-In State from %s (MAC: %02X:%02X:%02X:%02X:%02X:%02X - IP: %u.%u.%u.%u)", user->rx[0], (char *)user->resolver.name.data, user->resolver.mac.data[0], user->resolver.mac.data[1], user->resolver.mac.data[2], user->resolver.mac.data[3], user->resolver.mac.data[4], user->resolver.mac.data[5], ip[0], ip[1], ip[2], ip[3]);
 
-					// Invalid Opcode
-					else
-					{
-						// Notify User
-						uint8_t * ip = (uint8_t *)&user->resolver.ip;
-						INFO_LOG(SCENET, "AdhocServer: Invalid Opcode 0x%02X in Waiting State from %u.%u.%u.%u", user->rx[0], ip[0], ip[1], ip[2], ip[3]);
+			// Logout User
+			logout_user(user);
+		}
+	}
 
-						// Logout User
-						logout_user(user);
-					}
-				}
+	// User got logged out
+	if(_rx_user != user) return 0;
 
-				// Logged-In User
-				else if(get_user_state(user) == USER_STATE_LOGGED_IN)
-				{
-					// Ping Packet
-					if(user->rx[0] == OPCODE_PING)
-					{
-						// Delete Packet from RX Buffer
-						clear_user_rxbuf(user, 1);
-					}
+	// Packet consumed
+	return user->rxpos < rxpos ? 1 : 0;
+}
 
-					// Group Connect Packet
-					else if(user->rx[0] == OPCODE_CONNECT)
-					{
-						// Enough Data available
-						if(user->rxpos >= sizeof(SceNetAdhocctlConnectPacketC2S))
-						{
-							// Cast Packet
-							SceNetAdhocctlConnectPacketC2S * packet = (SceNetAdhocctlConnectPacketC2S *)user->rx;
+/**
+ * Receive and Handle Data from User
+ * @param user User Node
+ */
+static void receive_user(SceNetAdhocctlUserNode * user)
+{
+	// Receive Data from User
+	int recvresult = recv(user->stream, (char*)user->rx + user->rxpos, sizeof(user->rx) - user->rxpos, 0);
 
-							// Clone Group Name
-							SceNetAdhocctlGroupName group = packet->group;
+	// Connection Closed
+	if(recvresult == 0 || (recvresult == -1 && errno != EAGAIN && errno != EWOULDBLOCK))
+	{
+		// Logout User
+		logout_user(user);
+		return;
+	}
 
-							// Remove Packet from RX Buffer
-							clear_user_rxbuf(user, sizeof(SceNetAdhocctlConnectPacketC2S));
+	// Nothing new
+	if(recvresult <= 0) return;
 
-							// Change Game Group
-							connect_user(user, &group);
-						}
-					}
+	// Move RX Pointer
+	user->rxpos += recvresult;
 
-					// Group Disconnect Packet
-					else if(user->rx[0] == OPCODE_DISCONNECT)
-					{
-						// Remove Packet from RX Buffer
-						clear_user_rxbuf(user, 1);
+	// Update Death Clock
+	user->last_recv = time(NULL);
 
-						// Leave Game Group
-						disconnect_user(user);
-					}
+	// Handle every complete Packet, the Socket won't signal again for Data already read
+	_rx_user = user;
+	while(user->rxpos > 0 && process_user_packet(user) == 1)
+	{
+	}
+	_rx_user = NULL;
+}
 
-					// Network Scan Packet
-					else if(user->rx[0] == OPCODE_SCAN)
-					{
-						// Remove Packet from RX Buffer
-						clear_user_rxbuf(user, 1);
+/**
+ * Server Main Loop
+ * @param server Server Listening Socket
+ * @return OS Error Code
+ */
+int server_loop(int server)
+{
+#ifdef SERVER_USE_EPOLL
+	// Create Readiness Notification Descriptor
+	_poll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if(_poll_fd == -1)
+	{
+		ERROR_LOG(SCENET, "AdhocServer: epoll_create1 failed (Socket error %d)", errno);
+		closesocket(server);
+		return -1;
+	}
+#endif
 
-						// Send Network List
-						send_scan_results(user);
-					}
+	// Watch Listener for Logins
+	server_poll_add(server, NULL);
 
-					// Chat Text Packet
-					else if(user->rx[0] == OPCODE_CHAT)
-					{
-						// Enough Data available
-						if(user->rxpos >= sizeof(SceNetAdhocctlChatPacketC2S))
-						{
-							// Cast Packet
-							SceNetAdhocctlChatPacketC2S * packet = (SceNetAdhocctlChatPacketC2S *)user->rx;
+	// Set Running Status
+	//_status = 1;
+	adhocServerRunning = true;
 
-							// Clone Buffer for Message
-							char message[64];
-							memset(message, 0, sizeof(message));
-							strncpy(message, packet->message, sizeof(message) - 1);
+	// Create Empty Status Logfile
+	update_status();
 
-							// Remove Packet from RX Buffer
-							clear_user_rxbuf(user, sizeof(SceNetAdhocctlChatPacketC2S));
+	// Ready Sockets
+	std::vector<ServerEvent> events;
 
-							// Spread Chat Message
-							spread_message(user, message);
-						}
-					}
+	// Last Timeout Check
+	time_t last_sweep = time(NULL);
 
-					// Invalid Opcode
-					else
-					{
-						// Notify User
-						uint8_t * ip = (uint8_t *)&user->resolver.ip;
-						INFO_LOG(SCENET, "AdhocServer: Invalid Opcode 0x%02X in Logged-In State from %s (MAC: %02X:%02X:%02X:%02X:%02X:%02X - IP: %u.%u.%u.%u)", user->rx[0], (char *)user->resolver.name.data, user->resolver.mac.data[0], user->resolver.mac.data[1], user->resolver.mac.data[2], user->resolver.mac.data[3], user->resolver.mac.data[4], user->resolver.mac.data[5], ip[0], ip[1], ip[2], ip[3]);
+	// Handling Loop
+	while (adhocServerRunning) //(_status == 1)
+	{
+		// Sleep until a Socket is ready
+		server_poll_wait(server, SERVER_POLL_TIMEOUT, events);
 
-						// Logout User
-						logout_user(user);
-					}
-				}
+		// Handle ready Sockets (only the current User can be logged out while handling it)
+		for(size_t i = 0; i < events.size(); i++)
+		{
+			SceNetAdhocctlUserNode * user = events[i].user;
+
+			// Login Requests
+			if(user == NULL) accept_users(server);
+
+			// Incoming Data (write readiness only wakes us up, queued Data is sent below)
+			else if(events[i].readable) receive_user(user);
+		}
+
+		// Send queued Data, batched per User
+		time_t now = time(NULL);
+		int sweep = now != last_sweep;
+		SceNetAdhocctlUserNode * user = _db_user;
+		while(user != NULL)
+		{
+			// Next User (for safe delete)
+			SceNetAdhocctlUserNode * next = user->next;
+
+			// Send Error, Queue Overflow or Timed Out
+			if((user->txpos > 0 && flush_user_send(user) < 0) || user->txerror || (sweep && get_user_state(user) == USER_STATE_TIMED_OUT))
+			{
+				// Logout User
+				logout_user(user);
 			}
 
 			// Move Pointer
 			user = next;
 		}
-
-		// Prevent needless CPU Overload (1ms Sleep)
-		sleep_ms(1);
+		last_sweep = now;
 
 		// Don't do anything if it's paused, otherwise the log will be flooded
 		while (adhocServerRunning && Core_IsStepping()) sleep_ms(1);
@@ -2034,6 +2335,12 @@ int server_loop(int server)
 	// Close Server Socket
 	closesocket(server);
 
+#ifdef SERVER_USE_EPOLL
+	// Close Readiness Notification Descriptor
+	close(_poll_fd);
+	_poll_fd = -1;
+#endif
+
 	// Return Success
 	return 0;
 }
@@ -34,7 +34,13 @@
 #define SERVER_LISTEN_BACKLOG 128
 
 // Server User Maximum
-#define SERVER_USER_MAXIMUM 1024
+#define SERVER_USER_MAXIMUM 4096
+
+// Server User TX Queue Limit (in bytes, a client that falls this far behind gets dropped)
+#define SERVER_USER_TX_MAXIMUM 65536
+
+// Server Readiness Wait Timeout (in milliseconds)
+#define SERVER_POLL_TIMEOUT 100
 
 // Server User Timeout (in seconds)
 #define SERVER_USER_TIMEOUT 15
@@ -220,6 +226,17 @@ typedef struct SceNetAdhocctlUserNode {
 	// RX Buffer
 	uint8_t rx[1024];
 	uint32_t rxpos;
+
+	// TX Queue (flushed once per Server Loop iteration)
+	uint8_t * tx;
+	uint32_t txpos;
+	uint32_t txsize;
+
+	// TX Queue Overflow or Send Error
+	int txerror;
+
+	// Waiting for Write Readiness
+	int txwait;
 } SceNetAdhocctlUserNode;
 
 // Double-Linked Game List
@@ -332,6 +349,22 @@ void spread_message(SceNetAdhocctlUserNode *user, const char *message);
  */
 int get_user_state(SceNetAdhocctlUserNode * user);
 
+/**
+ * Queue Data for Sending to User
+ * @param user User Node
+ * @param data Packet Data
+ * @param size Packet Size
+ * @return 0 on success or -1 if the TX Queue overflowed
+ */
+int queue_user_send(SceNetAdhocctlUserNode * user, const void * data, uint32_t size);
+
+/**
+ * Send as much of the TX Queue as the Socket accepts
+ * @param user User Node
+ * @return 0 on success or -1 on Socket error
+ */
+int flush_user_send(SceNetAdhocctlUserNode * user);
+
 /**
  * Clear RX Buffer
  * @param user User Node
@@ -26,6 +26,7 @@
 #include "Core/Replay.h"
 #include "Common/ChunkFile.h"
 #include "Core/Util/AudioFormat.h"  // for clamp_u8
+#include "Core/Util/InputLatency.h"
 #include "Core/HLE/sceCtrl.h"
 #include "Core/HLE/sceDisplay.h"
 #include "Core/HLE/sceKernel.h"
@@ -172,12 +173,16 @@ u32 __CtrlReadLatch()
 void __CtrlButtonDown(u32 buttonBit)
 {
 	std::lock_guard<std::mutex> guard(ctrlMutex);
+	if ((ctrlCurrent.buttons & buttonBit) != buttonBit)
+		InputLatency_Input();
 	ctrlCurrent.buttons |= buttonBit;
 }
 
 void __CtrlButtonUp(u32 buttonBit)
 {
 	std::lock_guard<std::mutex> guard(ctrlMutex);
+	if ((ctrlCurrent.buttons & buttonBit) != 0)
+		InputLatency_Input();
 	ctrlCurrent.buttons &= ~buttonBit;
 }
 
@@ -185,6 +190,8 @@ void __CtrlSetAnalogX(float x, int stick)
 {
 	u8 scaled = clamp_u8((int)ceilf(x * 127.5f + 127.5f));
 	std::lock_guard<std::mutex> guard(ctrlMutex);
+	if (ctrlCurrent.analog[stick][CTRL_ANALOG_X] != scaled)
+		InputLatency_Input();
 	ctrlCurrent.analog[stick][CTRL_ANALOG_X] = scaled;
 }
 
@@ -192,6 +199,8 @@ void __CtrlSetAnalogY(float y, int stick)
 {
 	u8 scaled = clamp_u8((int)ceilf(-y * 127.5f + 127.5f));
 	std::lock_guard<std::mutex> guard(ctrlMutex);
+	if (ctrlCurrent.analog[stick][CTRL_ANALOG_Y] != scaled)
+		InputLatency_Input();
 	ctrlCurrent.analog[stick][CTRL_ANALOG_Y] = scaled;
 }
 
@@ -257,6 +266,7 @@ static void __CtrlDoSample()
 {
 	// This samples the ctrl data into the buffers and updates the latch.
 	__CtrlUpdateLatch();
+	InputLatency_Sample();
 
 	// Wake up a single thread that was waiting for the buffer.
 retry:
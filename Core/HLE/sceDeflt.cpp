@@ -15,150 +15,150 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <map>
+#include <vector>
+
 #include "zlib.h"
 
+#include "ext/xxhash.h"
 #include "Common/CommonTypes.h"
 #include "Core/HLE/HLE.h"
 #include "Core/HLE/FunctionWrappers.h"
 #include "Core/HLE/sceDeflt.h"
 #include "Core/MemMap.h"
 
-// All the decompress functions are identical with only differing window bits. Possibly should be one function
+// Games often decompress the same assets again and again (e.g. on every area load), so we remember
+// what each input address decompressed to.  The input is hashed to make sure it's still the same.
+struct InflateCacheEntry {
+	int windowBits;
+	int outLength;
+	u32 inLength;
+	u64 inHash;
+	bool hasCrc;
+	u32 crc;
+	std::vector<u8> out;
+};
 
-static int sceDeflateDecompress(u32 OutBuffer, int OutBufferLength, u32 InBuffer, u32 Crc32Addr) {
-	DEBUG_LOG(HLE, "sceGzipDecompress(%08x, %x, %08x, %08x)", OutBuffer, OutBufferLength, InBuffer, Crc32Addr);
-	int err;
-	uLong crc;
-	z_stream stream;
-	u8 *outBufferPtr;
-	u32 *crc32AddrPtr = 0;
+static std::map<u32, InflateCacheEntry> inflateCache;
+static size_t inflateCacheBytes = 0;
+static const size_t INFLATE_CACHE_MAX_BYTES = 16 * 1024 * 1024;
 
-	if (!Memory::IsValidAddress(OutBuffer) || !Memory::IsValidAddress(InBuffer)) {
-		ERROR_LOG(HLE, "sceZlibDecompress: Bad address %08x %08x", OutBuffer, InBuffer);
-		return 0;
-	}
-	if (Crc32Addr) {
-		if (!Memory::IsValidAddress(Crc32Addr)) {
-			ERROR_LOG(HLE, "sceZlibDecompress: Bad address %08x", Crc32Addr);
-			return 0;
-		}
-		crc32AddrPtr = (u32 *)Memory::GetPointer(Crc32Addr);
-	}
-	outBufferPtr = Memory::GetPointer(OutBuffer);
-	stream.next_in = (Bytef*)Memory::GetPointer(InBuffer);
-	stream.avail_in = (uInt)OutBufferLength;
-	stream.next_out = outBufferPtr;
-	stream.avail_out = (uInt)OutBufferLength;
-	stream.zalloc = (alloc_func)0;
-	stream.zfree = (free_func)0;
-	err = inflateInit2(&stream, -MAX_WBITS);
-	if (err != Z_OK) {
-		ERROR_LOG(HLE, "sceZlibDecompress: inflateInit2 failed %08x", err);
-		return 0;
-	}
-	err = inflate(&stream, Z_FINISH);
-	if (err != Z_STREAM_END) {
-		inflateEnd(&stream);
-		ERROR_LOG(HLE, "sceZlibDecompress: inflate failed %08x", err);
-		return 0;
-	}
-	inflateEnd(&stream);
+void __DefltShutdown() {
+	inflateCache.clear();
+	inflateCacheBytes = 0;
+}
+
+static bool LookupInflateCache(u32 InBuffer, int windowBits, int OutBufferLength, u8 *outBufferPtr, u32 *total, u32 *crc32AddrPtr) {
+	auto it = inflateCache.find(InBuffer);
+	if (it == inflateCache.end())
+		return false;
+	InflateCacheEntry &entry = it->second;
+	if (entry.windowBits != windowBits || entry.outLength != OutBufferLength || !Memory::IsValidRange(InBuffer, entry.inLength))
+		return false;
+	if (XXH64(Memory::GetPointerUnchecked(InBuffer), entry.inLength, 0) != entry.inHash)
+		return false;
+
+	memcpy(outBufferPtr, entry.out.data(), entry.out.size());
+	*total = (u32)entry.out.size();
 	if (crc32AddrPtr) {
-		crc = crc32(0L, Z_NULL, 0);
-		*crc32AddrPtr = crc32(crc, outBufferPtr, stream.total_out);
+		if (!entry.hasCrc) {
+			entry.crc = crc32(crc32(0L, Z_NULL, 0), entry.out.data(), (uInt)entry.out.size());
+			entry.hasCrc = true;
+		}
+		*crc32AddrPtr = entry.crc;
 	}
-	return stream.total_out;
+	return true;
 }
 
+static void StoreInflateCache(u32 InBuffer, int windowBits, int OutBufferLength, const u8 *outBufferPtr, u32 totalIn, u32 totalOut, const u32 *crc) {
+	auto old = inflateCache.find(InBuffer);
+	if (old != inflateCache.end()) {
+		inflateCacheBytes -= old->second.out.size();
+		inflateCache.erase(old);
+	}
+	if (totalOut > INFLATE_CACHE_MAX_BYTES / 4)
+		return;
+	if (inflateCacheBytes + totalOut > INFLATE_CACHE_MAX_BYTES)
+		__DefltShutdown();
+
+	InflateCacheEntry &entry = inflateCache[InBuffer];
+	entry.windowBits = windowBits;
+	entry.outLength = OutBufferLength;
+	entry.inLength = totalIn;
+	entry.inHash = XXH64(Memory::GetPointerUnchecked(InBuffer), totalIn, 0);
+	entry.hasCrc = crc != nullptr;
+	entry.crc = crc ? *crc : 0;
+	entry.out.assign(outBufferPtr, outBufferPtr + totalOut);
+	inflateCacheBytes += totalOut;
+}
 
-static int sceGzipDecompress(u32 OutBuffer, int OutBufferLength, u32 InBuffer, u32 Crc32Addr) {
-	DEBUG_LOG(HLE, "sceGzipDecompress(%08x, %x, %08x, %08x)", OutBuffer, OutBufferLength, InBuffer, Crc32Addr);
+// All the decompress functions are identical with only differing window bits.
+static int DecompressWithWindowBits(const char *funcName, u32 OutBuffer, int OutBufferLength, u32 InBuffer, u32 Crc32Addr, int windowBits) {
+	DEBUG_LOG(HLE, "%s(%08x, %x, %08x, %08x)", funcName, OutBuffer, OutBufferLength, InBuffer, Crc32Addr);
 	int err;
-	uLong crc;
 	z_stream stream;
 	u8 *outBufferPtr;
 	u32 *crc32AddrPtr = 0;
 
 	if (!Memory::IsValidAddress(OutBuffer) || !Memory::IsValidAddress(InBuffer)) {
-		ERROR_LOG(HLE, "sceZlibDecompress: Bad address %08x %08x", OutBuffer, InBuffer);
+		ERROR_LOG(HLE, "%s: Bad address %08x %08x", funcName, OutBuffer, InBuffer);
 		return 0;
 	}
 	if (Crc32Addr) {
 		if (!Memory::IsValidAddress(Crc32Addr)) {
-			ERROR_LOG(HLE, "sceZlibDecompress: Bad address %08x", Crc32Addr);
+			ERROR_LOG(HLE, "%s: Bad address %08x", funcName, Crc32Addr);
 			return 0;
 		}
 		crc32AddrPtr = (u32 *)Memory::GetPointer(Crc32Addr);
 	}
 	outBufferPtr = Memory::GetPointer(OutBuffer);
+
+	u32 totalOut;
+	if (Memory::IsValidRange(OutBuffer, OutBufferLength) && LookupInflateCache(InBuffer, windowBits, OutBufferLength, outBufferPtr, &totalOut, crc32AddrPtr)) {
+		return totalOut;
+	}
+
 	stream.next_in = (Bytef*)Memory::GetPointer(InBuffer);
 	stream.avail_in = (uInt)OutBufferLength;
 	stream.next_out = outBufferPtr;
 	stream.avail_out = (uInt)OutBufferLength;
 	stream.zalloc = (alloc_func)0;
 	stream.zfree = (free_func)0;
-	err = inflateInit2(&stream, 16+MAX_WBITS);
+	err = inflateInit2(&stream, windowBits);
 	if (err != Z_OK) {
-		ERROR_LOG(HLE, "sceZlibDecompress: inflateInit2 failed %08x", err);
+		ERROR_LOG(HLE, "%s: inflateInit2 failed %08x", funcName, err);
 		return 0;
 	}
 	err = inflate(&stream, Z_FINISH);
 	if (err != Z_STREAM_END) {
 		inflateEnd(&stream);
-		ERROR_LOG(HLE, "sceZlibDecompress: inflate failed %08x", err);
+		ERROR_LOG(HLE, "%s: inflate failed %08x", funcName, err);
 		return 0;
 	}
 	inflateEnd(&stream);
+
+	totalOut = (u32)stream.total_out;
+	u32 crc = 0;
 	if (crc32AddrPtr) {
-		crc = crc32(0L, Z_NULL, 0);
-		*crc32AddrPtr = crc32(crc, outBufferPtr, stream.total_out);
+		crc = crc32(crc32(0L, Z_NULL, 0), outBufferPtr, totalOut);
+		*crc32AddrPtr = crc;
+	}
+	if (Memory::IsValidRange(InBuffer, (u32)stream.total_in)) {
+		StoreInflateCache(InBuffer, windowBits, OutBufferLength, outBufferPtr, (u32)stream.total_in, totalOut, crc32AddrPtr ? &crc : nullptr);
 	}
-	return stream.total_out;
+	return totalOut;
 }
 
-static int sceZlibDecompress(u32 OutBuffer, int OutBufferLength, u32 InBuffer, u32 Crc32Addr) {
-	DEBUG_LOG(HLE, "sceZlibDecompress(%08x, %x, %08x, %08x)", OutBuffer, OutBufferLength, InBuffer, Crc32Addr);
-	int err;
-	uLong crc;
-	z_stream stream;
-	u8 *outBufferPtr;
-	u32 *crc32AddrPtr = 0;
+static int sceDeflateDecompress(u32 OutBuffer, int OutBufferLength, u32 InBuffer, u32 Crc32Addr) {
+	return DecompressWithWindowBits("sceDeflateDecompress", OutBuffer, OutBufferLength, InBuffer, Crc32Addr, -MAX_WBITS);
+}
 
-	if (!Memory::IsValidAddress(OutBuffer) || !Memory::IsValidAddress(InBuffer)) {
-		ERROR_LOG(HLE, "sceZlibDecompress: Bad address %08x %08x", OutBuffer, InBuffer);
-		return 0;
-	}
-	if (Crc32Addr) {
-		if (!Memory::IsValidAddress(Crc32Addr)) {
-			ERROR_LOG(HLE, "sceZlibDecompress: Bad address %08x", Crc32Addr);
-			return 0;
-		}
-		crc32AddrPtr = (u32 *)Memory::GetPointer(Crc32Addr);
-	}
-	outBufferPtr = Memory::GetPointer(OutBuffer);
-	stream.next_in = (Bytef*)Memory::GetPointer(InBuffer);
-	stream.avail_in = (uInt)OutBufferLength;
-	stream.next_out = outBufferPtr;
-	stream.avail_out = (uInt)OutBufferLength;
-	stream.zalloc = (alloc_func)0;
-	stream.zfree = (free_func)0;
-	err = inflateInit2(&stream, MAX_WBITS);
-	if (err != Z_OK) {
-		ERROR_LOG(HLE, "sceZlibDecompress: inflateInit failed %08x", err);
-		return 0;
-	}
-	err = inflate(&stream, Z_FINISH);
-	if (err != Z_STREAM_END) {
-		inflateEnd(&stream);
-		ERROR_LOG(HLE, "sceZlibDecompress: inflate failed %08x", err);
-		return 0;
-	}
-	inflateEnd(&stream);
-	if (crc32AddrPtr) {
-		crc = crc32(0L, Z_NULL, 0);
-		*crc32AddrPtr = crc32(crc, outBufferPtr, stream.total_out);
-	}
-	return stream.total_out;
+static int sceGzipDecompress(u32 OutBuffer, int OutBufferLength, u32 InBuffer, u32 Crc32Addr) {
+	return DecompressWithWindowBits("sceGzipDecompress", OutBuffer, OutBufferLength, InBuffer, Crc32Addr, 16 + MAX_WBITS);
+}
+
+static int sceZlibDecompress(u32 OutBuffer, int OutBufferLength, u32 InBuffer, u32 Crc32Addr) {
+	return DecompressWithWindowBits("sceZlibDecompress", OutBuffer, OutBufferLength, InBuffer, Crc32Addr, MAX_WBITS);
 }
 
 const HLEFunction sceDeflt[] = {
@@ -18,3 +18,4 @@
 #pragma once
 
 void Register_sceDeflt();
+void __DefltShutdown();
@@ -119,6 +119,24 @@ static double nextFrameTime;
 static int numVBlanks;
 static int numVBlanksSinceFlip;
 
+// Host frame cost history, used to spread auto frameskip evenly ahead of time.
+struct FramePacing {
+	// When emulation of the current frame started (after throttling), 0 if unknown.
+	double frameStart;
+	// Smoothed host time of drawn frames, and its mean deviation.
+	double renderCost;
+	double renderDev;
+	// Smoothed host time of skipped frames.
+	double skipCost;
+	// Predicted time we're behind, paid back by skipping.
+	double debt;
+
+	int missedDeadlines;
+	int predictedSkips;
+	int lateSkips;
+};
+static FramePacing framePacing;
+
 static u64 frameStartTicks;
 const int hCountPerVblank = 286;
 
@@ -227,6 +245,7 @@ void __DisplayInit() {
 	curFrameTime = 0.0;
 	nextFrameTime = 0.0;
 	lastFrameTime = 0.0;
+	framePacing = FramePacing();
 
 	flips = 0;
 	fps = 0.0;
@@ -470,15 +489,42 @@ void __DisplayGetDebugStats(char *stats, size_t bufsize) {
 	char statbuf[4096];
 	gpu->GetStats(statbuf, sizeof(statbuf));
 
+	CoreTiming::TimeBreakdown breakdown;
+	CoreTiming::GetTimeBreakdown(&breakdown, nullptr);
+	// Just the few events that took the most time last frame.
+	std::vector<CoreTiming::EventProfile> events = CoreTiming::GetEventProfile();
+	std::sort(events.begin(), events.end(), [](const CoreTiming::EventProfile &a, const CoreTiming::EventProfile &b) {
+		return a.frameSeconds > b.frameSeconds;
+	});
+	char eventbuf[256] = "(none)";
+	size_t eventlen = 0;
+	for (size_t i = 0; i < events.size() && i < 3 && events[i].frameFires != 0; ++i) {
+		eventlen += snprintf(eventbuf + eventlen, sizeof(eventbuf) - eventlen, "%s%s %0.2f ms (%d)", i == 0 ? "" : ", ", events[i].name, events[i].frameSeconds * 1000.0, (int)events[i].frameFires);
+		if (eventlen >= sizeof(eventbuf))
+			break;
+	}
+
 	snprintf(stats, bufsize,
 		"Kernel processing time: %0.2f ms\n"
 		"Slowest syscall: %s : %0.2f ms\n"
-		"Most active syscall: %s : %0.2f ms\n%s",
+		"Most active syscall: %s : %0.2f ms\n"
+		"Emulation: cpu %0.2f, hle %0.2f, events %0.2f, gpu %0.2f, idle %0.2f ms\n"
+		"Slowest events: %s\n"
+		"Frame cost: drawn %0.2f ms (+-%0.2f), skipped %0.2f ms\n"
+		"Missed deadlines: %d, predicted skips: %d, late skips: %d\n%s",
 		kernelStats.msInSyscalls * 1000.0f,
 		kernelStats.slowestSyscallName ? kernelStats.slowestSyscallName : "(none)",
 		kernelStats.slowestSyscallTime * 1000.0f,
 		kernelStats.summedSlowestSyscallName ? kernelStats.summedSlowestSyscallName : "(none)",
 		kernelStats.summedSlowestSyscallTime * 1000.0f,
+		breakdown.seconds[(int)CoreTiming::TimeCategory::CPU] * 1000.0,
+		breakdown.seconds[(int)CoreTiming::TimeCategory::HLE] * 1000.0,
+		breakdown.seconds[(int)CoreTiming::TimeCategory::EVENTS] * 1000.0,
+		breakdown.seconds[(int)CoreTiming::TimeCategory::GPU] * 1000.0,
+		breakdown.seconds[(int)CoreTiming::TimeCategory::IDLE] * 1000.0,
+		eventbuf,
+		framePacing.renderCost * 1000.0, framePacing.renderDev * 1000.0, framePacing.skipCost * 1000.0,
+		framePacing.missedDeadlines, framePacing.predictedSkips, framePacing.lateSkips,
 		statbuf);
 }
 
@@ -520,9 +566,53 @@ static int CalculateFrameSkip() {
 	return frameSkipNum;
 }
 
+static void UpdateFramePacing(double now, bool skipped) {
+	double cost = now - framePacing.frameStart;
+	// Pauses and loading hitches would only poison the averages.
+	if (framePacing.frameStart == 0.0 || wasPaused || cost <= 0.0 || cost > 0.25) {
+		return;
+	}
+
+	const double alpha = 0.125;
+	if (skipped) {
+		framePacing.skipCost = framePacing.skipCost == 0.0 ? cost : framePacing.skipCost + (cost - framePacing.skipCost) * alpha;
+	} else if (framePacing.renderCost == 0.0) {
+		framePacing.renderCost = cost;
+	} else {
+		framePacing.renderDev += (fabs(cost - framePacing.renderCost) - framePacing.renderDev) * alpha;
+		framePacing.renderCost += (cost - framePacing.renderCost) * alpha;
+	}
+}
+
+// Decides ahead of time whether to draw the next frame, rather than only skipping once already late.
+// This spreads skips evenly (like error diffusion) so the pacing doesn't oscillate.
+static bool PredictFrameSkip(double scaledTimestep) {
+	// Way behind (hitch, shader compile...), just catch up.
+	if (curFrameTime > nextFrameTime + scaledTimestep) {
+		framePacing.lateSkips++;
+		framePacing.debt = 0.0;
+		return true;
+	}
+	// No history yet, fall back to skipping when late.
+	if (framePacing.renderCost == 0.0 || framePacing.skipCost == 0.0) {
+		return curFrameTime > nextFrameTime;
+	}
+
+	// Each drawn frame puts us predicted - timestep behind, each skip wins back predicted - skipCost.
+	const double predicted = framePacing.renderCost + framePacing.renderDev * 0.5;
+	framePacing.debt = std::min(std::max(framePacing.debt + predicted - scaledTimestep, -scaledTimestep), 4.0 * scaledTimestep);
+	if (framePacing.debt > 0.0) {
+		framePacing.debt -= std::max(predicted - framePacing.skipCost, 0.0);
+		framePacing.predictedSkips++;
+		return true;
+	}
+	return false;
+}
+
 // Let's collect all the throttling and frameskipping logic here.
 static void DoFrameTiming(bool &throttle, bool &skipFrame, float timestep) {
 	PROFILE_THIS_SCOPE("timing");
+	CoreTiming::TimeCategoryScope timeScope(CoreTiming::TimeCategory::IDLE);
 	FPSLimit fpsLimiter = PSP_CoreParameter().fpsLimit;
 	throttle = FrameTimingThrottled();
 	skipFrame = false;
@@ -537,11 +627,14 @@ static void DoFrameTiming(bool &throttle, bool &skipFrame, float timestep) {
 		if (numSkippedFrames >= 7) {
 			skipFrame = false;
 		}
+		framePacing.frameStart = 0.0;
 		return;
 	}
 
-	if (!throttle && !doFrameSkip)
+	if (!throttle && !doFrameSkip) {
+		framePacing.frameStart = 0.0;
 		return;
+	}
 
 	time_update();
 
@@ -562,6 +655,10 @@ static void DoFrameTiming(bool &throttle, bool &skipFrame, float timestep) {
 		nextFrameTime = std::max(lastFrameTime + scaledTimestep, time_now_d() - maxFallBehindFrames * scaledTimestep);
 	}
 	curFrameTime = time_now_d();
+	UpdateFramePacing(curFrameTime, (gstate_c.skipDrawReason & SKIPDRAW_SKIPFRAME) != 0);
+	if (throttle && lastFrameTime != 0.0 && !wasPaused && curFrameTime > nextFrameTime) {
+		framePacing.missedDeadlines++;
+	}
 
 	if (g_Config.bLogFrameDrops) {
 		DoFrameDropLogging(scaledTimestep);
@@ -573,9 +670,8 @@ static void DoFrameTiming(bool &throttle, bool &skipFrame, float timestep) {
 	int frameSkipNum = CalculateFrameSkip();
 	if (g_Config.bAutoFrameSkip || forceFrameskip) {
 		// autoframeskip
-		// Argh, we are falling behind! Let's skip a frame and see if we catch up.
-		if (curFrameTime > nextFrameTime && doFrameSkip) {
-			skipFrame = true;
+		if (doFrameSkip) {
+			skipFrame = PredictFrameSkip(scaledTimestep);
 		}
 	} else if (frameSkipNum >= 1) {
 		// fixed frameskip
@@ -605,11 +701,13 @@ static void DoFrameTiming(bool &throttle, bool &skipFrame, float timestep) {
 	}
 
 	lastFrameTime = nextFrameTime;
+	framePacing.frameStart = curFrameTime;
 	wasPaused = false;
 }
 
 static void DoFrameIdleTiming() {
 	PROFILE_THIS_SCOPE("timing");
+	CoreTiming::TimeCategoryScope timeScope(CoreTiming::TimeCategory::IDLE);
 	if (!FrameTimingThrottled() || !g_Config.bEnableSound || wasPaused) {
 		return;
 	}
@@ -684,7 +782,9 @@ void hleEnterVblank(u64 userdata, int cyclesLate) {
 		__KernelReSchedule("entered vblank");
 	}
 
-	numVBlanks++;
+	// Run-ahead frames are rolled back, don't count them towards the FPS.
+	if (!PSP_CoreParameter().runAheadFrame)
+		numVBlanks++;
 	numVBlanksSinceFlip++;
 
 	// TODO: Should this be done here or in hleLeaveVblank?
@@ -692,6 +792,7 @@ void hleEnterVblank(u64 userdata, int cyclesLate) {
 		DEBUG_LOG(SCEDISPLAY, "Setting latched framebuffer %08x (prev: %08x)", latchedFramebuf.topaddr, framebuf.topaddr);
 		framebuf = latchedFramebuf;
 		framebufIsLatched = false;
+		gpu->SyncThread();
 		gpu->SetDisplayFramebuffer(framebuf.topaddr, framebuf.stride, framebuf.fmt);
 		__DisplayFlip(cyclesLate);
 	} else if (!flippedThisFrame) {
@@ -702,6 +803,8 @@ void hleEnterVblank(u64 userdata, int cyclesLate) {
 
 void __DisplayFlip(int cyclesLate) {
 	flippedThisFrame = true;
+	// Anything drawn so far needs to be done before we present it.
+	gpu->SyncThread();
 	// We flip only if the framebuffer was dirty. This eliminates flicker when using
 	// non-buffered rendering. The interaction with frame skipping seems to need
 	// some work.
@@ -714,7 +817,9 @@ void __DisplayFlip(int cyclesLate) {
 		postEffectRequiresFlip = shaderInfo->requires60fps;
 	const bool fbDirty = gpu->FramebufferDirty();
 	if (fbDirty || noRecentFlip || postEffectRequiresFlip) {
-		CalculateFPS();
+		const bool runAheadFrame = PSP_CoreParameter().runAheadFrame;
+		if (!runAheadFrame)
+			CalculateFPS();
 
 		// Let the user know if we're running slow, so they know to adjust settings.
 		// Sometimes users just think the sound emulation is broken.
@@ -732,24 +837,27 @@ void __DisplayFlip(int cyclesLate) {
 		}
 
 		// Setting CORE_NEXTFRAME causes a swap.
+		// Run-ahead frames always end the host frame, even when skipped, so each one can be controlled.
 		const bool fbReallyDirty = gpu->FramebufferReallyDirty();
-		if (fbReallyDirty || noRecentFlip || postEffectRequiresFlip) {
+		if (fbReallyDirty || noRecentFlip || postEffectRequiresFlip || runAheadFrame) {
 			// Check first though, might've just quit / been paused.
 			if (coreState == CORE_RUNNING) {
 				coreState = CORE_NEXTFRAME;
 				gpu->CopyDisplayToOutput();
-				if (fbReallyDirty) {
+				if (fbReallyDirty && !runAheadFrame) {
 					actualFlips++;
 				}
 			}
 		}
 
-		if (fbDirty) {
+		if (fbDirty && !runAheadFrame) {
 			gpuStats.numFlips++;
 		}
 
-		bool throttle, skipFrame;
-		DoFrameTiming(throttle, skipFrame, (float)numVBlanksSinceFlip * timePerVblank);
+		// Run-ahead frames are emulated as fast as possible, the real frame does the timing.
+		bool throttle = false, skipFrame = false;
+		if (!runAheadFrame)
+			DoFrameTiming(throttle, skipFrame, (float)numVBlanksSinceFlip * timePerVblank);
 
 		int maxFrameskip = 8;
 		int frameSkipNum = CalculateFrameSkip();
@@ -805,6 +913,7 @@ void hleLagSync(u64 userdata, int cyclesLate) {
 	// Our normal timing is very "stop and go".  This is efficient, but causes real world lag.
 	// This event (optionally) runs every 1ms to sync with the real world.
 	PROFILE_THIS_SCOPE("timing");
+	CoreTiming::TimeCategoryScope timeScope(CoreTiming::TimeCategory::IDLE);
 
 	if (!FrameTimingThrottled()) {
 		lagSyncScheduled = false;
@@ -867,6 +976,7 @@ static u32 sceDisplaySetMode(int displayMode, int displayWidth, int displayHeigh
 	}
 
 	if (!hasSetMode) {
+		gpu->SyncThread();
 		gpu->InitClear();
 		hasSetMode = true;
 	}
@@ -888,6 +998,7 @@ void __DisplaySetFramebuf(u32 topaddr, int linesize, int pixelFormat, int sync)
 	if (sync == PSP_DISPLAY_SETBUF_IMMEDIATE) {
 		// Write immediately to the current framebuffer parameters.
 		framebuf = fbstate;
+		gpu->SyncThread();
 		gpu->SetDisplayFramebuffer(framebuf.topaddr, framebuf.stride, framebuf.fmt);
 		// IMMEDIATE means that the buffer is fine. We can just flip immediately.
 		// Doing it in non-buffered though creates problems (black screen) on occasion though
@@ -39,6 +39,7 @@
 #include "Core/HLE/sceKernel.h"
 #include "Core/HLE/sceUmd.h"
 #include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/JitCommon/JitWriteWatch.h"
 #include "Core/HW/MemoryStick.h"
 #include "Core/HW/AsyncIOManager.h"
 #include "Core/CoreTiming.h"
@@ -1008,6 +1009,8 @@ static bool __IoRead(int &result, int id, u32 data_addr, int size, int &us) {
 			return true;
 		} else if (Memory::IsValidAddress(data_addr)) {
 			CBreakPoints::ExecMemCheck(data_addr, true, size, currentMIPS->pc);
+			// Host reads fail rather than fault on protected pages.
+			MIPSComp::WriteWatchRelease(data_addr, size);
 			u8 *data = (u8*) Memory::GetPointer(data_addr);
 			if (f->npdrm) {
 				result = npdrmRead(f, data, size);
@@ -35,6 +35,10 @@
 
 #include <algorithm>
 
+#ifdef _M_SSE
+#include <emmintrin.h>
+#endif
+
 static int mjpegWidth, mjpegHeight;
 
 void __JpegInit() {
@@ -120,46 +124,69 @@ static int sceJpegMJpegCsc(u32 imageAddr, u32 yCbCrAddr, int widthHeight, int bu
 	return 0;
 }
 
-static u32 convertARGBtoABGR(u32 argb) {
-	return ((argb & 0xFF00FF00)) | ((argb & 0x000000FF) << 16) | ((argb & 0x00FF0000) >> 16);
+// Decodes straight from guest memory, handing each scanline to func(y, line) as it's done, so the
+// whole image never needs to be buffered. Color images come out as RGBA, grayscale as 8-bit luma.
+template <typename F>
+static bool DecodeJpegScanlines(const u8 *buf, int jpegSize, int &width, int &height, int &components, F func) {
+	jpgd::jpeg_decoder_mem_stream stream(buf, jpegSize);
+	jpgd::jpeg_decoder decoder(&stream);
+	if (decoder.get_error_code() != jpgd::JPGD_SUCCESS)
+		return false;
+	width = decoder.get_width();
+	height = decoder.get_height();
+	components = decoder.get_num_components();
+	// We only output color images.
+	if (components != 3)
+		return true;
+
+	if (decoder.begin_decoding() != jpgd::JPGD_SUCCESS)
+		return false;
+	for (int y = 0; y < height; ++y) {
+		const void *line = nullptr;
+		jpgd::uint lineLen;
+		if (decoder.decode(&line, &lineLen) != jpgd::JPGD_SUCCESS)
+			return false;
+		func(y, (const u32 *)line);
+	}
+	return true;
 }
 
-static int __DecodeJpeg(u32 jpegAddr, int jpegSize, u32 imageAddr) {
-	u8 *buf = Memory::GetPointer(jpegAddr);
-	int width, height, actual_components;
-	unsigned char *jpegBuf = jpgd::decompress_jpeg_image_from_memory(buf, jpegSize, &width, &height, &actual_components, 3);
-
-	if (actual_components != 3) {
-		// The assumption that the image was RGB was wrong...
-		// Try again.
-		int components = actual_components;
-		jpegBuf = jpgd::decompress_jpeg_image_from_memory(buf, jpegSize, &width, &height, &actual_components, components);
+// The RGBA scanlines already have the byte order of ABGR8888, but the alpha is left as zero.
+static void ConvertJpegLineToABGR(u32 *dst, const u32 *src, int width) {
+	int x = 0;
+#ifdef _M_SSE
+	const __m128i mask = _mm_set1_epi32(0x00FFFFFF);
+	for (; x + 4 <= width; x += 4) {
+		__m128i c = _mm_loadu_si128((const __m128i *)(src + x));
+		_mm_storeu_si128((__m128i *)(dst + x), _mm_and_si128(c, mask));
 	}
-
-	if (jpegBuf == NULL) {
-		return getWidthHeight(0, 0);
+#endif
+	for (; x < width; ++x) {
+		dst[x] = src[x] & 0x00FFFFFF;
 	}
+}
 
-	if (actual_components == 3) {
-			u24_be *imageBuffer = (u24_be*)jpegBuf;
-			u32 *abgr = (u32*)Memory::GetPointer(imageAddr);
-			int pspWidth = 0;
+static int __DecodeJpeg(u32 jpegAddr, int jpegSize, u32 imageAddr) {
+	u8 *buf = Memory::GetPointer(jpegAddr);
+	u32 *abgr = (u32 *)Memory::GetPointer(imageAddr);
+	int width = 0, height = 0, components = 0;
+	int pspWidth = 0;
+	bool success = DecodeJpegScanlines(buf, jpegSize, width, height, components, [&](int y, const u32 *line) {
+		if (y == 0) {
 			for (int w = 2; w <= 4096; w *= 2) {
 				if (w >= width && w >= height) {
 					pspWidth = w;
 					break;
 				}
 			}
-			for (int y = 0; y < height; ++y) {
-				for (int x = 0; x < width; x++)	{
-					abgr[x] = convertARGBtoABGR(imageBuffer[x]);
-				}
-				imageBuffer += width;
-				abgr += pspWidth; // Smallest value power of 2 fitting width and height(needs to be square!)
-			}
-	}
+		}
+		// Smallest value power of 2 fitting width and height(needs to be square!)
+		ConvertJpegLineToABGR(abgr + y * pspWidth, line, width);
+	});
 
-	free(jpegBuf);
+	if (!success) {
+		return getWidthHeight(0, 0);
+	}
 	return getWidthHeight(width, height);
 }
 
@@ -212,22 +239,15 @@ static int getYCbCrBufferSize(int w, int h) {
 
 static int __JpegGetOutputInfo(u32 jpegAddr, int jpegSize, u32 colourInfoAddr) {
 	u8 *buf = Memory::GetPointer(jpegAddr);
-	int width, height, actual_components;
-	unsigned char *jpegBuf = jpgd::decompress_jpeg_image_from_memory(buf, jpegSize, &width, &height, &actual_components, 3);
-
-	if (actual_components != 3) {
-	// The assumption that the image was RGB was wrong...
-	// Try again.
-		int components = actual_components;
-		jpegBuf = jpgd::decompress_jpeg_image_from_memory(buf, jpegSize, &width, &height, &actual_components, components);
-	}
-
-	if (jpegBuf == NULL) {
+	// Only the headers are needed for the size, no need to decode anything.
+	jpgd::jpeg_decoder_mem_stream stream(buf, jpegSize);
+	jpgd::jpeg_decoder decoder(&stream);
+	if (decoder.get_error_code() != jpgd::JPGD_SUCCESS) {
 		ERROR_LOG(ME, "sceJpegGetOutputInfo: Bad JPEG data");
 		return getYCbCrBufferSize(0, 0);
 	}
-
-	free(jpegBuf);
+	int width = decoder.get_width();
+	int height = decoder.get_height();
 	
 	// Buffer to store info about the color space in use.
 	// - Bits 24 to 32 (Always empty): 0x00
@@ -282,62 +302,42 @@ static u32 convertRGBToYCbCr(u32 rgb) {
 	return (y << 16) | (cb << 8) | cr;
 }
 
-static int __JpegConvertRGBToYCbCr (const void *data, u32 bufferOutputAddr, int width, int height) {
-	u24_be *imageBuffer = (u24_be*)data;
-	int sizeY = width * height;
-	int sizeCb = sizeY >> 2;
-	u8 *Y = (u8*)Memory::GetPointer(bufferOutputAddr);
-	u8 *Cb = Y + sizeY;
-	u8 *Cr = Cb + sizeCb;
-
-	for (int y = 0; y < height; ++y) {
-		for (int x = 0; x < width; x += 4) {
-			u32 abgr0 = imageBuffer[x + 0];
-			u32 abgr1 = imageBuffer[x + 1];
-			u32 abgr2 = imageBuffer[x + 2];
-			u32 abgr3 = imageBuffer[x + 3];
-
-			u32 yCbCr0 = convertRGBToYCbCr(abgr0);
-			u32 yCbCr1 = convertRGBToYCbCr(abgr1);
-			u32 yCbCr2 = convertRGBToYCbCr(abgr2);
-			u32 yCbCr3 = convertRGBToYCbCr(abgr3);
-			
-			Y[x + 0] = (yCbCr0 >> 16) & 0xFF;
-			Y[x + 1] = (yCbCr1 >> 16) & 0xFF;
-			Y[x + 2] = (yCbCr2 >> 16) & 0xFF;
-			Y[x + 3] = (yCbCr3 >> 16) & 0xFF;
-
-			*Cb++ = (yCbCr0 >> 8) & 0xFF;
-			*Cr++ = yCbCr0 & 0xFF;
+// Y for every pixel, Cb and Cr for every fourth one.
+static void __JpegConvertRGBToYCbCr(const u32 *line, u8 *Y, u8 *Cb, u8 *Cr, int width) {
+	for (int x = 0; x < width; ++x) {
+		u32 rgba = line[x];
+		u32 rgb = ((rgba & 0xFF) << 16) | (rgba & 0xFF00) | ((rgba >> 16) & 0xFF);
+		u32 yCbCr = convertRGBToYCbCr(rgb);
+		Y[x] = (yCbCr >> 16) & 0xFF;
+		if ((x & 3) == 0) {
+			Cb[x >> 2] = (yCbCr >> 8) & 0xFF;
+			Cr[x >> 2] = yCbCr & 0xFF;
 		}
-		imageBuffer += width;
-		Y += width ;
 	}
-	return getWidthHeight(width, height);
 }
 
 static int __JpegDecodeMJpegYCbCr(u32 jpegAddr, int jpegSize, u32 yCbCrAddr) {
 	u8 *buf = Memory::GetPointer(jpegAddr);
-	int width, height, actual_components;
-	unsigned char *jpegBuf = jpgd::decompress_jpeg_image_from_memory(buf, jpegSize, &width, &height, &actual_components, 3);
-
-	if (actual_components != 3) {
-		// The assumption that the image was RGB was wrong...
-		// Try again.
-		int components = actual_components;
-		jpegBuf = jpgd::decompress_jpeg_image_from_memory(buf, jpegSize, &width, &height, &actual_components, components);
-	}
+	u8 *Y = (u8 *)Memory::GetPointer(yCbCrAddr);
+	u8 *Cb = nullptr;
+	u8 *Cr = nullptr;
+	int width = 0, height = 0, components = 0;
+	bool success = DecodeJpegScanlines(buf, jpegSize, width, height, components, [&](int y, const u32 *line) {
+		if (y == 0) {
+			int sizeY = width * height;
+			Cb = Y + sizeY;
+			Cr = Cb + (sizeY >> 2);
+		}
+		__JpegConvertRGBToYCbCr(line, Y, Cb, Cr, width);
+		Y += width;
+		Cb += (width + 3) >> 2;
+		Cr += (width + 3) >> 2;
+	});
 
-	if (jpegBuf == NULL) {
+	if (!success) {
 		return getWidthHeight(0, 0);
 	}
 
-	if (actual_components == 3) {
-		__JpegConvertRGBToYCbCr(jpegBuf, yCbCrAddr, width, height);
-	}
-
-	free(jpegBuf);
-
 	// TODO: There's more...
 
 	return getWidthHeight(width, height);
@@ -25,6 +25,7 @@
 #include "Core/MIPS/MIPSCodeUtils.h"
 #include "Core/MIPS/MIPSInt.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
+#include "Core/MIPS/JitCommon/JitWriteWatch.h"
 
 #include "Common/LogManager.h"
 #include "Core/FileSystems/FileSystem.h"
@@ -43,6 +44,7 @@
 #include "sceAudiocodec.h"
 #include "sceCcc.h"
 #include "sceCtrl.h"
+#include "sceDeflt.h"
 #include "sceDisplay.h"
 #include "sceFont.h"
 #include "sceGe.h"
@@ -176,6 +178,7 @@ void __KernelShutdown()
 	__NetAdhocShutdown();
 	__NetShutdown();
 	__FontShutdown();
+	__DefltShutdown();
 
 	__Mp3Shutdown();
 	__MpegShutdown();
@@ -437,6 +440,11 @@ u32 sceKernelIcacheInvalidateAll()
 #ifdef LOG_CACHE
 	NOTICE_LOG(CPU, "Icache invalidated - should clear JIT someday");
 #endif
+	// With the write watch, only pages written since they were compiled can be stale.
+	if (MIPSComp::WriteWatchEnabled()) {
+		MIPSComp::WriteWatchFlush();
+		return 0;
+	}
 	// Note that this doesn't actually fully invalidate all with such a large range.
 	currentMIPS->InvalidateICache(0, 0x3FFFFFFF);
 	return 0;
@@ -448,6 +456,11 @@ u32 sceKernelIcacheClearAll()
 	NOTICE_LOG(CPU, "Icache cleared - should clear JIT someday");
 #endif
 	DEBUG_LOG(CPU, "Icache cleared - should clear JIT someday");
+	// With the write watch, only pages written since they were compiled can be stale.
+	if (MIPSComp::WriteWatchEnabled()) {
+		MIPSComp::WriteWatchFlush();
+		return 0;
+	}
 	// Note that this doesn't actually fully invalidate all with such a large range.
 	currentMIPS->InvalidateICache(0, 0x3FFFFFFF);
 	return 0;
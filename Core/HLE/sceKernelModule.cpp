@@ -802,6 +802,7 @@ void UnexportFuncSymbol(const FuncSymbolExport &func) {
 }
 
 void Module::Cleanup() {
+	MIPSAnalyst::StoreBlockProfile(textStart, textEnd);
 	MIPSAnalyst::ForgetFunctions(textStart, textEnd);
 
 	loadedModules.erase(GetUID());
@@ -1467,6 +1468,7 @@ static Module *__KernelLoadELFFromPtr(const u8 *ptr, size_t elfSize, u32 loadAdd
 			module->nm.entry_addr = module->nm.module_start_func;
 
 		MIPSAnalyst::PrecompileFunctions();
+		MIPSAnalyst::LoadBlockProfile(module->textStart, module->textEnd);
 
 	} else {
 		module->nm.entry_addr = -1;
@@ -1110,6 +1110,7 @@ static u32 sceMpegAvcDecode(u32 mpeg, u32 auAddr, u32 frameWidth, u32 bufferAddr
 
 	if (ispmp){
 #ifdef USE_FFMPEG
+		ctx->mediaengine->finishConvertFrame();
 		while (pmp_queue.size() != 0){
 			// playing all pmp_queue frames
 			ctx->mediaengine->m_pFrameRGB = pmp_queue.front();
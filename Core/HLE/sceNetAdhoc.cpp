@@ -413,12 +413,8 @@ static int sceNetAdhocPdpSend(int id, const char *mac, u32 port, void *data, int
 					if (data != NULL) {
 						// Valid Destination Address
 						if (daddr != NULL) {
-							// Log Destination
-							// Schedule Timeout Removal
-							if (flag) timeout = 0;
-
-							// Apply Send Timeout Settings to Socket
-							setsockopt(socket->id, SOL_SOCKET, SO_SNDTIMEO, (const char *)&timeout, sizeof(timeout));
+							// Apply Send Timeout Settings to Socket (not needed for nonblocking sends)
+							if (!flag) setsockopt(socket->id, SOL_SOCKET, SO_SNDTIMEO, (const char *)&timeout, sizeof(timeout));
 
 							// Single Target
 							if (!isBroadcastMAC(daddr)) {
@@ -433,13 +429,11 @@ static int sceNetAdhocPdpSend(int id, const char *mac, u32 port, void *data, int
 									//_acquireNetworkLock();
 
 									// Send Data
-									changeBlockingMode(socket->id, flag);
-									int sent = sendto(socket->id, (const char *)data, len, 0, (sockaddr *)&target, sizeof(target));
+									int sent = adhocSendTo(socket->id, data, len, &target, flag);
 									int error = errno;
 									if (sent == SOCKET_ERROR) {
 										DEBUG_LOG(SCENET, "Socket Error (%i) on sceNetAdhocPdpSend[%i:%u->%u] (size=%i)", error, id, getLocalPort(socket->id), ntohs(target.sin_port), len);
 									}
-									changeBlockingMode(socket->id, 0);
 
 									// Free Network Lock
 									//_freeNetworkLock();
@@ -480,6 +474,10 @@ static int sceNetAdhocPdpSend(int id, const char *mac, u32 port, void *data, int
 								//}
 #endif
 
+								// Broadcast Targets
+								static std::vector<sockaddr_in> targets;
+								targets.clear();
+
 								// Acquire Peer Lock
 								peerlock.lock();
 
@@ -491,27 +489,22 @@ static int sceNetAdhocPdpSend(int id, const char *mac, u32 port, void *data, int
 
 									// Fill in Target Structure
 									sockaddr_in target;
+									memset(&target, 0, sizeof(target));
 									target.sin_family = AF_INET;
 									target.sin_addr.s_addr = peer->ip_addr;
 									target.sin_port = htons(dport + portOffset);
-
-									// Send Data
-									changeBlockingMode(socket->id, flag);
-									int sent = sendto(socket->id, (const char *)data, len, 0, (sockaddr *)&target, sizeof(target));
-									int error = errno;
-									if (sent == SOCKET_ERROR) {
-										DEBUG_LOG(SCENET, "Socket Error (%i) on sceNetAdhocPdpSend[%i:%u->%u](BC) [size=%i]", error, id, getLocalPort(socket->id), ntohs(target.sin_port), len);
-									}
-									changeBlockingMode(socket->id, 0);
-									if (sent >= 0) {
-										uint8_t * sip = (uint8_t *)&target.sin_addr.s_addr;
-										DEBUG_LOG(SCENET, "sceNetAdhocPdpSend[%i:%u](BC): Sent %u bytes to %u.%u.%u.%u:%u\n", id, getLocalPort(socket->id), sent, sip[0], sip[1], sip[2], sip[3], ntohs(target.sin_port));
-									}
+									targets.push_back(target);
 								}
 
 								// Free Peer Lock
 								peerlock.unlock();
 
+								// Send Data to all Peers at once
+								if (!targets.empty()) {
+									int delivered = adhocSendToMany(socket->id, data, len, &targets[0], (int)targets.size(), flag);
+									DEBUG_LOG(SCENET, "sceNetAdhocPdpSend[%i:%u](BC): Sent %u bytes to %d of %d peers", id, getLocalPort(socket->id), len, delivered, (int)targets.size());
+								}
+
 								// Free Network Lock
 								//_freeNetworkLock();
 
@@ -597,8 +590,8 @@ static int sceNetAdhocPdpRecv(int id, void *addr, void * port, void *buf, void *
 				}
 #endif
 
-				// Apply Receive Timeout Settings to Socket
-				setsockopt(socket->id, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+				// Apply Receive Timeout Settings to Socket (not needed for nonblocking receives)
+				if (!flag) setsockopt(socket->id, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
 
 				// Sender Address
 				sockaddr_in sin;
@@ -611,13 +604,11 @@ static int sceNetAdhocPdpRecv(int id, void *addr, void * port, void *buf, void *
 				//_acquireNetworkLock();
 
 				// Receive Data
-				changeBlockingMode(socket->id, flag);
-				int received = recvfrom(socket->id, (char *)buf, *len,0,(sockaddr *)&sin, &sinlen);
+				int received = adhocRecvFrom(socket->id, buf, *len, &sin, &sinlen, flag);
 				int error = errno;
 				if (received == SOCKET_ERROR) {
 					VERBOSE_LOG(SCENET, "Socket Error (%i) on sceNetAdhocPdpRecv [size=%i]", error, *len);
 				}
-				changeBlockingMode(socket->id, 0); 
 
 				// Received Data
 				if (received >= 0) {
@@ -2240,20 +2231,15 @@ static int sceNetAdhocPtpSend(int id, u32 dataAddr, u32 dataSizeAddr, int timeou
 			if (socket->state == ADHOC_PTP_STATE_ESTABLISHED) {
 				// Valid Arguments
 				if (data != NULL && len != NULL && *len > 0) {
-					// Schedule Timeout Removal
-					if (flag) timeout = 0;
-					
-					// Apply Send Timeout Settings to Socket
-					setsockopt(socket->id, SOL_SOCKET, SO_SNDTIMEO, (const char *)&timeout, sizeof(timeout));
+					// Apply Send Timeout Settings to Socket (not needed for nonblocking sends)
+					if (!flag) setsockopt(socket->id, SOL_SOCKET, SO_SNDTIMEO, (const char *)&timeout, sizeof(timeout));
 					
 					// Acquire Network Lock
 					// _acquireNetworkLock();
 					
 					// Send Data
-					changeBlockingMode(socket->id, flag);
-					int sent = send(socket->id, data, *len, 0);
+					int sent = adhocSend(socket->id, data, *len, flag);
 					int error = errno;
-					changeBlockingMode(socket->id, 0);
 					
 					// Free Network Lock
 					// _freeNetworkLock();
@@ -2328,20 +2314,15 @@ static int sceNetAdhocPtpRecv(int id, u32 dataAddr, u32 dataSizeAddr, int timeou
 			
 			// Valid Arguments
 			if (buf != NULL && len != NULL && *len > 0) {
-				// Schedule Timeout Removal
-				if (flag) timeout = 0;
-				
-				// Apply Send Timeout Settings to Socket
-				setsockopt(socket->id, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+				// Apply Receive Timeout Settings to Socket (not needed for nonblocking receives)
+				if (!flag) setsockopt(socket->id, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
 				
 				// Acquire Network Lock
 				// _acquireNetworkLock();
 				
 				// Receive Data
-				changeBlockingMode(socket->id, flag);
-				int received = recv(socket->id, (char *)buf, *len, 0);
+				int received = adhocRecv(socket->id, buf, *len, flag);
 				int error = errno;
-				changeBlockingMode(socket->id, 0);
 				
 				// Free Network Lock
 				// _freeNetworkLock();
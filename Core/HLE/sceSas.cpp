@@ -102,6 +102,7 @@ static int sasMixEvent = -1;
 
 int __SasThread() {
 	setCurrentThreadName("SAS");
+	setCurrentThreadRole(ThreadRole::AUDIO);
 
 	std::unique_lock<std::mutex> guard(sasWakeMutex);
 	while (sasThreadState != SasThreadState::DISABLED) {
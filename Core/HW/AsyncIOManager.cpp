@@ -19,6 +19,7 @@
 #include <mutex>
 
 #include "Common/ChunkFile.h"
+#include "thread/threadutil.h"
 #include "Core/MIPS/MIPS.h"
 #include "Core/Reporting.h"
 #include "Core/System.h"
@@ -42,13 +43,27 @@ void AsyncIOManager::ScheduleOperation(AsyncIOEvent ev) {
 			ERROR_LOG_REPORT(SCEIO, "Scheduling operation for file %d while one is pending (type %d)", ev.handle, ev.type);
 		}
 	}
+	ev.startTicks = CoreTiming::GetTicks();
 	ScheduleEvent(ev);
 }
 
 void AsyncIOManager::Shutdown() {
+	StopWorkers();
+
 	std::lock_guard<std::mutex> guard(resultsLock_);
 	resultsPending_.clear();
 	results_.clear();
+	inFlight_.clear();
+}
+
+void AsyncIOManager::SyncThread(bool force) {
+	IOThreadEventQueue::SyncThread(force);
+
+	// The queue is drained, but workers may still be busy with the last few operations.
+	std::unique_lock<std::mutex> guard(resultsLock_);
+	while (ThreadEnabled() && !inFlight_.empty()) {
+		resultsWait_.wait_for(guard, std::chrono::milliseconds(16));
+	}
 }
 
 bool AsyncIOManager::HasResult(u32 handle) {
@@ -83,7 +98,7 @@ bool AsyncIOManager::ReadResult(u32 handle, AsyncIOResult &result) {
 bool AsyncIOManager::WaitResult(u32 handle, AsyncIOResult &result) {
 	std::unique_lock<std::mutex> guard(resultsLock_);
 	ScheduleEvent(IO_EVENT_SYNC);
-	while (HasEvents() && ThreadEnabled() && resultsPending_.find(handle) != resultsPending_.end()) {
+	while (ThreadEnabled() && resultsPending_.find(handle) != resultsPending_.end() && (HasEvents() || inFlight_.count(handle) != 0)) {
 		if (PopResult(handle, result)) {
 			return true;
 		}
@@ -97,7 +112,7 @@ u64 AsyncIOManager::ResultFinishTicks(u32 handle) {
 
 	std::unique_lock<std::mutex> guard(resultsLock_);
 	ScheduleEvent(IO_EVENT_SYNC);
-	while (HasEvents() && ThreadEnabled() && resultsPending_.find(handle) != resultsPending_.end()) {
+	while (ThreadEnabled() && resultsPending_.find(handle) != resultsPending_.end() && (HasEvents() || inFlight_.count(handle) != 0)) {
 		if (ReadResult(handle, result)) {
 			return result.finishTicks;
 		}
@@ -113,11 +128,13 @@ u64 AsyncIOManager::ResultFinishTicks(u32 handle) {
 void AsyncIOManager::ProcessEvent(AsyncIOEvent ev) {
 	switch (ev.type) {
 	case IO_EVENT_READ:
-		Read(ev.handle, ev.buf, ev.bytes, ev.invalidateAddr);
-		break;
-
 	case IO_EVENT_WRITE:
-		Write(ev.handle, ev.buf, ev.bytes);
+		if (ThreadEnabled()) {
+			// Let a worker do the transfer, so a slow read doesn't hold up other files.
+			QueueWork(ev);
+		} else {
+			RunOperation(ev);
+		}
 		break;
 
 	default:
@@ -125,16 +142,76 @@ void AsyncIOManager::ProcessEvent(AsyncIOEvent ev) {
 	}
 }
 
-void AsyncIOManager::Read(u32 handle, u8 *buf, size_t bytes, u32 invalidateAddr) {
+void AsyncIOManager::RunOperation(const AsyncIOEvent &ev) {
+	if (ev.type == IO_EVENT_READ) {
+		Read(ev.handle, ev.buf, ev.bytes, ev.invalidateAddr, ev.startTicks);
+	} else {
+		Write(ev.handle, ev.buf, ev.bytes, ev.startTicks);
+	}
+}
+
+void AsyncIOManager::QueueWork(const AsyncIOEvent &ev) {
+	{
+		std::lock_guard<std::mutex> guard(resultsLock_);
+		inFlight_.insert(ev.handle);
+	}
+
+	std::lock_guard<std::mutex> guard(workLock_);
+	if (workers_.empty()) {
+		workersExit_ = false;
+		for (int i = 0; i < WORKER_COUNT; ++i) {
+			workers_.push_back(std::thread(&AsyncIOManager::WorkerLoop, this));
+		}
+	}
+	work_.push_back(ev);
+	workWait_.notify_one();
+}
+
+void AsyncIOManager::WorkerLoop() {
+	setCurrentThreadName("IOWorker");
+	setCurrentThreadRole(ThreadRole::WORKER);
+
+	std::unique_lock<std::mutex> guard(workLock_);
+	while (true) {
+		while (work_.empty() && !workersExit_) {
+			workWait_.wait(guard);
+		}
+		if (work_.empty()) {
+			break;
+		}
+
+		AsyncIOEvent ev = work_.front();
+		work_.pop_front();
+		guard.unlock();
+		RunOperation(ev);
+		guard.lock();
+	}
+}
+
+void AsyncIOManager::StopWorkers() {
+	{
+		std::lock_guard<std::mutex> guard(workLock_);
+		workersExit_ = true;
+		workWait_.notify_all();
+	}
+
+	// Workers finish any queued operations before exiting.
+	for (std::thread &worker : workers_) {
+		worker.join();
+	}
+	workers_.clear();
+}
+
+void AsyncIOManager::Read(u32 handle, u8 *buf, size_t bytes, u32 invalidateAddr, u64 startTicks) {
 	int usec = 0;
 	s64 result = pspFileSystem.ReadFile(handle, buf, bytes, usec);
-	EventResult(handle, AsyncIOResult(result, usec, invalidateAddr));
+	EventResult(handle, AsyncIOResult(result, startTicks, usec, invalidateAddr));
 }
 
-void AsyncIOManager::Write(u32 handle, u8 *buf, size_t bytes) {
+void AsyncIOManager::Write(u32 handle, u8 *buf, size_t bytes, u64 startTicks) {
 	int usec = 0;
 	s64 result = pspFileSystem.WriteFile(handle, buf, bytes, usec);
-	EventResult(handle, AsyncIOResult(result, usec));
+	EventResult(handle, AsyncIOResult(result, startTicks, usec, 0));
 }
 
 void AsyncIOManager::EventResult(u32 handle, AsyncIOResult result) {
@@ -143,7 +220,8 @@ void AsyncIOManager::EventResult(u32 handle, AsyncIOResult result) {
 		ERROR_LOG_REPORT(SCEIO, "Overwriting previous result for file action on handle %d", handle);
 	}
 	results_[handle] = result;
-	resultsWait_.notify_one();
+	inFlight_.erase(handle);
+	resultsWait_.notify_all();
 }
 
 void AsyncIOManager::DoState(PointerWrap &p) {
@@ -15,9 +15,13 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <condition_variable>
+#include <deque>
 #include <map>
 #include <set>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 #include "Core/ThreadEventQueue.h"
 
@@ -33,12 +37,14 @@ enum AsyncIOEventType {
 };
 
 struct AsyncIOEvent {
-	AsyncIOEvent(AsyncIOEventType t) : type(t) {}
+	AsyncIOEvent(AsyncIOEventType t) : type(t), startTicks(0) {}
 	AsyncIOEventType type;
 	u32 handle;
 	u8 *buf;
 	size_t bytes;
 	u32 invalidateAddr;
+	// Emulated time the operation was scheduled at, so the result doesn't depend on host timing.
+	u64 startTicks;
 
 	operator AsyncIOEventType() const {
 		return type;
@@ -56,6 +62,10 @@ struct AsyncIOResult {
 		finishTicks = CoreTiming::GetTicks() + usToCycles(usec);
 	}
 
+	AsyncIOResult(s64 r, u64 startTicks, int usec, u32 addr) : result(r), invalidateAddr(addr) {
+		finishTicks = startTicks + usToCycles(usec);
+	}
+
 	void DoState(PointerWrap &p) {
 		auto s = p.Section("AsyncIOResult", 1, 2);
 		if (!s)
@@ -88,6 +98,9 @@ class AsyncIOManager : public IOThreadEventQueue {
 	bool WaitResult(u32 handle, AsyncIOResult &result);
 	u64 ResultFinishTicks(u32 handle);
 
+	// Also waits for reads and writes handed off to the workers.
+	void SyncThread(bool force = false);
+
 protected:
 	void ProcessEvent(AsyncIOEvent ref) override;
 	bool ShouldExitEventLoop() override {
@@ -97,8 +110,13 @@ class AsyncIOManager : public IOThreadEventQueue {
 private:
 	bool PopResult(u32 handle, AsyncIOResult &result);
 	bool ReadResult(u32 handle, AsyncIOResult &result);
-	void Read(u32 handle, u8 *buf, size_t bytes, u32 invalidateAddr);
-	void Write(u32 handle, u8 *buf, size_t bytes);
+	void Read(u32 handle, u8 *buf, size_t bytes, u32 invalidateAddr, u64 startTicks);
+	void Write(u32 handle, u8 *buf, size_t bytes, u64 startTicks);
+	void RunOperation(const AsyncIOEvent &ev);
+
+	void QueueWork(const AsyncIOEvent &ev);
+	void WorkerLoop();
+	void StopWorkers();
 
 	void EventResult(u32 handle, AsyncIOResult result);
 
@@ -106,4 +124,14 @@ class AsyncIOManager : public IOThreadEventQueue {
 	std::condition_variable resultsWait_;
 	std::set<u32> resultsPending_;
 	std::map<u32, AsyncIOResult> results_;
+	// Handles currently being read or written by a worker, guarded by resultsLock_.
+	std::set<u32> inFlight_;
+
+	// Operations on different handles run in parallel on these, started on first use.
+	enum { WORKER_COUNT = 3 };
+	std::vector<std::thread> workers_;
+	std::mutex workLock_;
+	std::condition_variable workWait_;
+	std::deque<AsyncIOEvent> work_;
+	bool workersExit_ = false;
 };
\ No newline at end of file
@@ -15,6 +15,7 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include "thread/threadutil.h"
 #include "Core/Config.h"
 #include "Core/Debugger/Breakpoints.h"
 #include "Core/HW/MediaEngine.h"
@@ -27,6 +28,7 @@
 #include "Core/HW/SimpleAudioDec.h"
 
 #include <algorithm>
+#include <climits>
 
 #ifdef USE_FFMPEG
 
@@ -35,6 +37,7 @@ extern "C" {
 #include "libavcodec/avcodec.h"
 #include "libavformat/avformat.h"
 #include "libavutil/imgutils.h"
+#include "libavutil/pixdesc.h"
 #include "libswscale/swscale.h"
 
 }
@@ -153,6 +156,7 @@ MediaEngine::MediaEngine(): m_pdata(0) {
 
 MediaEngine::~MediaEngine() {
 	closeMedia();
+	stopConvertThread();
 }
 
 void MediaEngine::closeMedia() {
@@ -341,6 +345,7 @@ bool MediaEngine::openContext(bool keepReadPos) {
 void MediaEngine::closeContext()
 {
 #ifdef USE_FFMPEG
+	finishConvertFrame();
 	if (m_buffer)
 		av_free(m_buffer);
 	if (m_pFrameRGB)
@@ -473,6 +478,8 @@ bool MediaEngine::setVideoStream(int streamNum, bool force) {
 		AVDictionary *opt = nullptr;
 		// Allow ffmpeg to use any number of threads it wants.  Without this, it doesn't use threads.
 		av_dict_set(&opt, "threads", "0", 0);
+		// Frame threading gives the most parallelism for H.264, slices help with streams that use many.
+		av_dict_set(&opt, "thread_type", "frame+slice", 0);
 		int openResult = avcodec_open2(m_pCodecCtx, pCodec, &opt);
 		av_dict_free(&opt);
 		if (openResult < 0) {
@@ -495,6 +502,7 @@ bool MediaEngine::setVideoDim(int width, int height)
 		return false;
 	AVCodecContext *m_pCodecCtx = codecIter->second;
 
+	finishConvertFrame();
 	if (width == 0 && height == 0)
 	{
 		// use the orignal video size
@@ -591,6 +599,9 @@ bool MediaEngine::stepVideo(int videoPixelMode, bool skipFrame) {
 	if (!m_pFrame)
 		return false;
 
+	// The previous frame may still be converting from m_pFrame.
+	finishConvertFrame();
+
 	AVPacket packet;
 	av_init_packet(&packet);
 	int frameFinished;
@@ -620,8 +631,7 @@ bool MediaEngine::stepVideo(int videoPixelMode, bool skipFrame) {
 					// Update the linesize for the new format too.  We started with the largest size, so it should fit.
 					m_pFrameRGB->linesize[0] = getPixelFormatBytes(videoPixelMode) * m_desWidth;
 
-					sws_scale(m_sws_ctx, m_pFrame->data, m_pFrame->linesize, 0,
-						m_pCodecCtx->height, m_pFrameRGB->data, m_pFrameRGB->linesize);
+					startConvertFrame(m_pCodecCtx->height);
 				}
 
 				if (av_frame_get_best_effort_timestamp(m_pFrame) != AV_NOPTS_VALUE)
@@ -653,6 +663,81 @@ bool MediaEngine::stepVideo(int videoPixelMode, bool skipFrame) {
 #endif // USE_FFMPEG
 }
 
+void MediaEngine::startConvertFrame(int srcHeight) {
+	std::lock_guard<std::mutex> guard(m_convertLock);
+	if (!m_convertThread.joinable()) {
+		m_convertStop = false;
+		m_convertThread = std::thread([this] { convertLoop(); });
+	}
+	m_convertSrcHeight = srcHeight;
+	m_convertedRows = 0;
+	m_convertPending = true;
+	m_convertCond.notify_all();
+}
+
+void MediaEngine::finishConvertFrame() {
+	waitConvertedRows(INT_MAX);
+}
+
+int MediaEngine::waitConvertedRows(int rows) {
+	std::unique_lock<std::mutex> guard(m_convertLock);
+	while (m_convertPending && m_convertedRows < rows)
+		m_convertCond.wait(guard);
+	return m_convertPending ? m_convertedRows : INT_MAX;
+}
+
+void MediaEngine::stopConvertThread() {
+	if (m_convertThread.joinable()) {
+		{
+			std::lock_guard<std::mutex> guard(m_convertLock);
+			m_convertStop = true;
+			m_convertCond.notify_all();
+		}
+		m_convertThread.join();
+	}
+}
+
+void MediaEngine::convertLoop() {
+	setCurrentThreadName("MediaConvert");
+
+	std::unique_lock<std::mutex> guard(m_convertLock);
+	while (!m_convertStop) {
+		if (!m_convertPending) {
+			m_convertCond.wait(guard);
+			continue;
+		}
+
+#ifdef USE_FFMPEG
+		int srcHeight = m_convertSrcHeight;
+		guard.unlock();
+
+		// Feed swscale in slices (top to bottom, as it requires) and publish rows as they come out.
+		// The result is the same as converting the whole frame at once.
+		const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat)m_pFrame->format);
+		bool sliced = desc && (desc->flags & AV_PIX_FMT_FLAG_PLANAR) != 0 && (desc->flags & AV_PIX_FMT_FLAG_PAL) == 0;
+		const int sliceHeight = sliced ? 16 : srcHeight;
+		for (int y = 0; y < srcHeight; y += sliceHeight) {
+			const uint8_t *src[4]{};
+			for (int i = 0; i < 4 && m_pFrame->data[i]; ++i) {
+				int shift = (i == 1 || i == 2) && desc ? desc->log2_chroma_h : 0;
+				src[i] = m_pFrame->data[i] + (y >> shift) * m_pFrame->linesize[i];
+			}
+			int h = std::min(sliceHeight, srcHeight - y);
+			int rows = sws_scale(m_sws_ctx, src, m_pFrame->linesize, y, h, m_pFrameRGB->data, m_pFrameRGB->linesize);
+
+			guard.lock();
+			m_convertedRows += std::max(rows, 0);
+			m_convertCond.notify_all();
+			guard.unlock();
+		}
+
+		guard.lock();
+#endif
+		m_convertPending = false;
+		m_convertCond.notify_all();
+	}
+}
+
 // Helpers that null out alpha (which seems to be the case on the PSP.)
 // Some games depend on this, for example Sword Art Online (doesn't clear A's from buffer.)
 inline void writeVideoLineRGBA(void *destp, const void *srcp, int width) {
@@ -730,9 +815,13 @@ int MediaEngine::writeVideoImage(u32 bufferPtr, int frameWidth, int videoPixelMo
 		imgbuf = new u8[videoImageSize];
 	}
 
+	// Rows become ready as the conversion thread produces them.
+	int readyRows = 0;
 	switch (videoPixelMode) {
 	case GE_CMODE_32BIT_ABGR8888:
 		for (int y = 0; y < height; y++) {
+			if (y >= readyRows)
+				readyRows = waitConvertedRows(y + 1);
 			writeVideoLineRGBA(imgbuf + videoLineSize * y, data, width);
 			data += width * sizeof(u32);
 		}
@@ -740,6 +829,8 @@ int MediaEngine::writeVideoImage(u32 bufferPtr, int frameWidth, int videoPixelMo
 
 	case GE_CMODE_16BIT_BGR5650:
 		for (int y = 0; y < height; y++) {
+			if (y >= readyRows)
+				readyRows = waitConvertedRows(y + 1);
 			writeVideoLineABGR5650(imgbuf + videoLineSize * y, data, width);
 			data += width * sizeof(u16);
 		}
@@ -747,6 +838,8 @@ int MediaEngine::writeVideoImage(u32 bufferPtr, int frameWidth, int videoPixelMo
 
 	case GE_CMODE_16BIT_ABGR5551:
 		for (int y = 0; y < height; y++) {
+			if (y >= readyRows)
+				readyRows = waitConvertedRows(y + 1);
 			writeVideoLineABGR5551(imgbuf + videoLineSize * y, data, width);
 			data += width * sizeof(u16);
 		}
@@ -754,6 +847,8 @@ int MediaEngine::writeVideoImage(u32 bufferPtr, int frameWidth, int videoPixelMo
 
 	case GE_CMODE_16BIT_ABGR4444:
 		for (int y = 0; y < height; y++) {
+			if (y >= readyRows)
+				readyRows = waitConvertedRows(y + 1);
 			writeVideoLineABGR4444(imgbuf + videoLineSize * y, data, width);
 			data += width * sizeof(u16);
 		}
@@ -822,10 +917,13 @@ int MediaEngine::writeVideoImageWithRange(u32 bufferPtr, int frameWidth, int vid
 	if (height > m_desHeight - ypos)
 		height = m_desHeight - ypos;
 
+	int readyRows = 0;
 	switch (videoPixelMode) {
 	case GE_CMODE_32BIT_ABGR8888:
 		data += (ypos * m_desWidth + xpos) * sizeof(u32);
 		for (int y = 0; y < height; y++) {
+			if (ypos + y >= readyRows)
+				readyRows = waitConvertedRows(ypos + y + 1);
 			writeVideoLineRGBA(imgbuf, data, width);
 			data += m_desWidth * sizeof(u32);
 			imgbuf += videoLineSize;
@@ -836,6 +934,8 @@ int MediaEngine::writeVideoImageWithRange(u32 bufferPtr, int frameWidth, int vid
 	case GE_CMODE_16BIT_BGR5650:
 		data += (ypos * m_desWidth + xpos) * sizeof(u16);
 		for (int y = 0; y < height; y++) {
+			if (ypos + y >= readyRows)
+				readyRows = waitConvertedRows(ypos + y + 1);
 			writeVideoLineABGR5650(imgbuf, data, width);
 			data += m_desWidth * sizeof(u16);
 			imgbuf += videoLineSize;
@@ -846,6 +946,8 @@ int MediaEngine::writeVideoImageWithRange(u32 bufferPtr, int frameWidth, int vid
 	case GE_CMODE_16BIT_ABGR5551:
 		data += (ypos * m_desWidth + xpos) * sizeof(u16);
 		for (int y = 0; y < height; y++) {
+			if (ypos + y >= readyRows)
+				readyRows = waitConvertedRows(ypos + y + 1);
 			writeVideoLineABGR5551(imgbuf, data, width);
 			data += m_desWidth * sizeof(u16);
 			imgbuf += videoLineSize;
@@ -856,6 +958,8 @@ int MediaEngine::writeVideoImageWithRange(u32 bufferPtr, int frameWidth, int vid
 	case GE_CMODE_16BIT_ABGR4444:
 		data += (ypos * m_desWidth + xpos) * sizeof(u16);
 		for (int y = 0; y < height; y++) {
+			if (ypos + y >= readyRows)
+				readyRows = waitConvertedRows(ypos + y + 1);
 			writeVideoLineABGR4444(imgbuf, data, width);
 			data += m_desWidth * sizeof(u16);
 			imgbuf += videoLineSize;
@@ -888,6 +992,7 @@ int MediaEngine::writeVideoImageWithRange(u32 bufferPtr, int frameWidth, int vid
 
 u8 *MediaEngine::getFrameImage() {
 #ifdef USE_FFMPEG
+	finishConvertFrame();
 	return m_pFrameRGB->data[0];
 #else
 	return NULL;
@@ -24,7 +24,11 @@
 
 // An approximation of what the interface will look like. Similar to JPCSP's.
 
+#include <condition_variable>
 #include <map>
+#include <mutex>
+#include <thread>
+
 #include "Common/CommonTypes.h"
 #include "Core/HLE/sceMpeg.h"
 #include "Core/HW/MpegDemux.h"
@@ -80,6 +84,8 @@ class MediaEngine
 	int writeVideoImageWithRange(u32 bufferPtr, int frameWidth, int videoPixelMode,
 	                             int xpos, int ypos, int width, int height);
 	int getAudioSamples(u32 bufferPtr);
+	// Waits for the color conversion started by stepVideo(), if any.
+	void finishConvertFrame();
 
 	s64 getVideoTimeStamp();
 	s64 getAudioTimeStamp();
@@ -98,6 +104,12 @@ class MediaEngine
 	void updateSwsFormat(int videoPixelMode);
 	int getNextAudioFrame(u8 **buf, int *headerCode1, int *headerCode2);
 
+	void startConvertFrame(int srcHeight);
+	// Returns how many rows of m_pFrameRGB are ready, waiting until there are at least rows.
+	int waitConvertedRows(int rows);
+	void convertLoop();
+	void stopConvertThread();
+
 public:  // TODO: Very little of this below should be public.
 
 	// Video ffmpeg context - not used for audio
@@ -140,4 +152,14 @@ class MediaEngine
 
 	// used for audio type 
 	int m_audioType;
+
+private:
+	// Color conversion runs on this thread, so it overlaps copying rows out to the game.
+	std::thread m_convertThread;
+	std::mutex m_convertLock;
+	std::condition_variable m_convertCond;
+	bool m_convertPending = false;
+	bool m_convertStop = false;
+	int m_convertSrcHeight = 0;
+	int m_convertedRows = 0;
 };
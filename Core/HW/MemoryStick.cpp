@@ -1,3 +1,5 @@
+#include <mutex>
+
 #include "Common/ChunkFile.h"
 #include "Core/CoreTiming.h"
 #include "Core/FileSystems/MetaFileSystem.h"
@@ -11,6 +13,14 @@ static u64 memStickSize;
 static bool memStickNeedsAssign = false;
 static u64 memStickInsertedAt = 0;
 
+// Asking the host is slow on some platforms, and games check before every save.
+// Writes are subtracted as they happen, and we ask again now and then to pick up anything else.
+static const u64 FREE_SPACE_RECHECK_US = 2000000;
+static std::mutex freeSpaceLock;
+static u64 freeSpaceCached;
+static u64 freeSpaceCheckedAt;
+static bool freeSpaceValid = false;
+
 void MemoryStick_DoState(PointerWrap &p) {
 	auto s = p.Section("MemoryStick", 1, 3);
 	if (!s)
@@ -27,6 +37,7 @@ void MemoryStick_DoState(PointerWrap &p) {
 		p.Do(memStickInsertedAt);
 	}
 
+	MemoryStick_InvalidateFreeSpace();
 }
 
 MemStickState MemoryStick_State() {
@@ -47,12 +58,31 @@ u64 MemoryStick_SectorSize() {
 }
 
 u64 MemoryStick_FreeSpace() {
-	u64 freeSpace = pspFileSystem.FreeSpace("ms0:/");
+	std::lock_guard<std::mutex> guard(freeSpaceLock);
+	u64 now = CoreTiming::GetGlobalTimeUs();
+	if (!freeSpaceValid || now - freeSpaceCheckedAt >= FREE_SPACE_RECHECK_US) {
+		freeSpaceCached = pspFileSystem.FreeSpace("ms0:/");
+		freeSpaceCheckedAt = now;
+		freeSpaceValid = true;
+	}
+
+	u64 freeSpace = freeSpaceCached;
 	if (freeSpace < memStickSize)
 		return freeSpace;
 	return memStickSize;
 }
 
+void MemoryStick_NotifyWrite(u64 bytes) {
+	std::lock_guard<std::mutex> guard(freeSpaceLock);
+	// Overwrites don't really use more space, but erring low is safer until the next check.
+	freeSpaceCached = bytes < freeSpaceCached ? freeSpaceCached - bytes : 0;
+}
+
+void MemoryStick_InvalidateFreeSpace() {
+	std::lock_guard<std::mutex> guard(freeSpaceLock);
+	freeSpaceValid = false;
+}
+
 void MemoryStick_SetFatState(MemStickFatState state) {
 	memStickFatState = state;
 	memStickNeedsAssign = false;
@@ -88,4 +118,5 @@ void MemoryStick_Init() {
 	// We use 9GB here, which does not trigger the bug, as a cap for the max free space.
 	memStickSize = 9ULL * 1024 * 1024 * 1024; // 9GB
 	memStickNeedsAssign = false;
+	MemoryStick_InvalidateFreeSpace();
 }
@@ -33,3 +33,6 @@ void MemoryStick_SetFatState(MemStickFatState state);
 
 u64 MemoryStick_SectorSize();
 u64 MemoryStick_FreeSpace();
+// Keeps the cached free space roughly right between real checks.
+void MemoryStick_NotifyWrite(u64 bytes);
+void MemoryStick_InvalidateFreeSpace();
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "MpegDemux.h"
 #include "Core/Reporting.h"
 
@@ -23,6 +25,7 @@ MpegDemux::MpegDemux(int size, int offset) : m_audioStream(size) {
 	m_buf = new u8[size];
 
 	m_len = size;
+	m_start = 0;
 	m_index = offset;
 	m_audioChannel = -1;
 	m_readSize = 0;
@@ -33,7 +36,7 @@ MpegDemux::~MpegDemux() {
 }
 
 void MpegDemux::DoState(PointerWrap &p) {
-	auto s = p.Section("MpegDemux", 1);
+	auto s = p.Section("MpegDemux", 1, 2);
 	if (!s)
 		return;
 
@@ -41,6 +44,10 @@ void MpegDemux::DoState(PointerWrap &p) {
 	p.Do(m_len);
 	p.Do(m_audioChannel);
 	p.Do(m_readSize);
+	if (s >= 2)
+		p.Do(m_start);
+	else
+		m_start = 0;
 	if (m_buf)
 		p.DoArray(m_buf, m_len);
 	p.DoClass(m_audioStream);
@@ -49,7 +56,10 @@ void MpegDemux::DoState(PointerWrap &p) {
 bool MpegDemux::addStreamData(const u8 *buf, int addSize) {
 	if (m_readSize + addSize > m_len)
 		return false;
-	memcpy(m_buf + m_readSize, buf, addSize);
+	const int p = pos(m_readSize);
+	const int firstSize = std::min(addSize, m_len - p);
+	memcpy(m_buf + p, buf, firstSize);
+	memcpy(m_buf, buf + firstSize, addSize - firstSize);
 	m_readSize += addSize;
 	return true;
 }
@@ -145,7 +155,13 @@ int MpegDemux::demuxStream(bool bdemux, int startCode, int length, int channel)
 		length = readPesHeader(pesHeader, length, startCode);
 		if (pesHeader.channel == channel || channel < 0) {
 			channel = pesHeader.channel;
-			m_audioStream.push(m_buf + m_index, length, pesHeader.pts);
+			// The packet may wrap around the end of the ring, then it goes in as two pieces.
+			if (length >= 0 && length <= m_audioStream.getRemainSize()) {
+				const int p = pos(m_index);
+				const int firstSize = std::min(length, m_len - p);
+				m_audioStream.push(m_buf + p, firstSize, pesHeader.pts);
+				m_audioStream.push(m_buf, length - firstSize);
+			}
 		}
 		skip(length);
 	} else {
@@ -238,7 +254,7 @@ bool MpegDemux::demux(int audioChannel)
 			// Audio stream
 			int length = read16();
 			// Check for PES header marker.
-			looksValid = (m_buf[m_index] & 0xC0) == 0x80;
+			looksValid = (m_buf[pos(m_index)] & 0xC0) == 0x80;
 			if (m_readSize - m_index < length) {
 				m_index -= 4 + 2;
 				needMore = true;
@@ -255,7 +271,7 @@ bool MpegDemux::demux(int audioChannel)
 			// Video Stream
 			int length = read16();
 			// Check for PES header marker.
-			looksValid = (m_buf[m_index] & 0xC0) == 0x80;
+			looksValid = (m_buf[pos(m_index)] & 0xC0) == 0x80;
 			if (m_readSize - m_index < length) {
 				m_index -= 4 + 2;
 				needMore = true;
@@ -273,12 +289,13 @@ bool MpegDemux::demux(int audioChannel)
 			break;
 		}
 	}
+	// Just move the start of the ring past what we've consumed.
 	if (m_index < m_readSize) {
-		int size = m_readSize - m_index;
-		memmove(m_buf, m_buf + m_index, size);
+		m_start = pos(m_index);
+		m_readSize -= m_index;
 		m_index = 0;
-		m_readSize = size;
 	} else {
+		m_start = 0;
 		m_index = 0;
 		m_readSize = 0;
 	}
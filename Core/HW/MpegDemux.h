@@ -40,8 +40,17 @@ class MpegDemux
 		}
 	};
 
+	// m_buf is a ring, so consumed data never has to be moved out of the way.
+	int pos(int index) const {
+		int p = m_start + index;
+		if (p >= m_len)
+			p -= m_len;
+		else if (p < 0)
+			p += m_len;
+		return p;
+	}
 	int read8() {
-		return m_buf[m_index++];
+		return m_buf[pos(m_index++)];
 	}
 	int read16() {
 		return (read8() << 8) | read8();
@@ -67,8 +76,10 @@ class MpegDemux
 	int demuxStream(bool bdemux, int startCode, int length, int channel);
 	bool skipPackHeader();
 
+	// Relative to m_start, like m_readSize.
 	int m_index;
 	int m_len;
+	int m_start;
 	u8 *m_buf;
 	BufferQueue m_audioStream;
 	u8  m_audioFrame[0x2000];
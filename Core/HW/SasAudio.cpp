@@ -17,9 +17,23 @@
 
 #include <algorithm>
 
+#include "ppsspp_config.h"
+#include "Common/Common.h"
+#ifdef _M_SSE
+#include <emmintrin.h>
+#endif
+#if PPSSPP_ARCH(ARM_NEON)
+#if defined(_MSC_VER) && PPSSPP_ARCH(ARM64)
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+#endif
+
 #include "base/basictypes.h"
 #include "profiler/profiler.h"
 
+#include "Common/ThreadPools.h"
 #include "Core/MemMapHelpers.h"
 #include "Core/HLE/sceAtrac.h"
 #include "Core/Config.h"
@@ -476,7 +490,49 @@ bool SasVoice::HaveSamplesEnded() const {
 	}
 }
 
-void SasInstance::MixVoice(SasVoice &voice) {
+// Below this many samples per grain across VAG voices, waking up workers costs more than it saves.
+static const int SAS_PARALLEL_MIN_SAMPLES = 16 * 256;
+
+// Adds samples * volume >> 12 into an interleaved stereo buffer.
+static void AccumulateVoiceSamples(int *out, const int *samples, int count, int leftVol, int rightVol) {
+	int i = 0;
+#if defined(_M_SSE)
+	const __m128i vol = _mm_setr_epi32(leftVol, rightVol, leftVol, rightVol);
+	const __m128i volOdd = _mm_srli_epi64(vol, 32);
+	auto mulLo = [&](__m128i s) {
+		// SSE2 has no 32-bit multiply, but the low halves from unsigned products are the same.
+		__m128i even = _mm_mul_epu32(s, vol);
+		__m128i odd = _mm_mul_epu32(_mm_srli_epi64(s, 32), volOdd);
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+	};
+	for (; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(samples + i));
+		__m128i lo = _mm_srai_epi32(mulLo(_mm_unpacklo_epi32(s, s)), 12);
+		__m128i hi = _mm_srai_epi32(mulLo(_mm_unpackhi_epi32(s, s)), 12);
+		__m128i *dst = (__m128i *)(out + i * 2);
+		_mm_storeu_si128(dst, _mm_add_epi32(_mm_loadu_si128(dst), lo));
+		_mm_storeu_si128(dst + 1, _mm_add_epi32(_mm_loadu_si128(dst + 1), hi));
+	}
+#elif PPSSPP_ARCH(ARM_NEON)
+	const int32_t volArray[4] = { leftVol, rightVol, leftVol, rightVol };
+	const int32x4_t vol = vld1q_s32(volArray);
+	for (; i + 4 <= count; i += 4) {
+		int32x4_t s = vld1q_s32(samples + i);
+		int32x4x2_t dup = vzipq_s32(s, s);
+		int32x4_t lo = vshrq_n_s32(vmulq_s32(dup.val[0], vol), 12);
+		int32x4_t hi = vshrq_n_s32(vmulq_s32(dup.val[1], vol), 12);
+		int32_t *dst = out + i * 2;
+		vst1q_s32(dst, vaddq_s32(vld1q_s32(dst), lo));
+		vst1q_s32(dst + 4, vaddq_s32(vld1q_s32(dst + 4), hi));
+	}
+#endif
+	for (; i < count; i++) {
+		out[i * 2] += (samples[i] * leftVol) >> 12;
+		out[i * 2 + 1] += (samples[i] * rightVol) >> 12;
+	}
+}
+
+void SasInstance::MixVoice(SasVoice &voice, int *mixBuf, int *sendBuf, SasMixScratch &scratch) {
 	switch (voice.type) {
 	case VOICETYPE_VAG:
 		if (voice.type == VOICETYPE_VAG && !voice.vagAddr)
@@ -502,22 +558,22 @@ void SasInstance::MixVoice(SasVoice &voice) {
 		// TODO: Special case no-resample case (and 2x and 0.5x) for speed, it's not uncommon
 
 		// Two passes: First read, then resample.
-		mixTemp_[0] = voice.resampleHist[0];
-		mixTemp_[1] = voice.resampleHist[1];
+		scratch.resample[0] = voice.resampleHist[0];
+		scratch.resample[1] = voice.resampleHist[1];
 
 		int voicePitch = voice.pitch;
 		u32 sampleFrac = voice.sampleFrac;
 		int samplesToRead = (sampleFrac + voicePitch * std::max(0, grainSize - delay)) >> PSP_SAS_PITCH_BASE_SHIFT;
-		if (samplesToRead > ARRAY_SIZE(mixTemp_) - 2) {
+		if (samplesToRead > ARRAY_SIZE(scratch.resample) - 2) {
 			ERROR_LOG(SCESAS, "Too many samples to read (%d)! This shouldn't happen.", samplesToRead);
-			samplesToRead = ARRAY_SIZE(mixTemp_) - 2;
+			samplesToRead = ARRAY_SIZE(scratch.resample) - 2;
 		}
 		int readPos = 2;
 		if (voice.envelope.NeedsKeyOn()) {
 			readPos = 0;
 			samplesToRead += 2;
 		}
-		voice.ReadSamples(&mixTemp_[readPos], samplesToRead);
+		voice.ReadSamples(&scratch.resample[readPos], samplesToRead);
 		int tempPos = readPos + samplesToRead;
 
 		for (int i = 0; i < delay; ++i) {
@@ -528,7 +584,7 @@ void SasInstance::MixVoice(SasVoice &voice) {
 
 		const bool needsInterp = voicePitch != PSP_SAS_PITCH_BASE || (sampleFrac & PSP_SAS_PITCH_MASK) != 0;
 		for (int i = delay; i < grainSize; i++) {
-			const int16_t *s = mixTemp_ + (sampleFrac >> PSP_SAS_PITCH_BASE_SHIFT);
+			const int16_t *s = scratch.resample + (sampleFrac >> PSP_SAS_PITCH_BASE_SHIFT);
 
 			// Linear interpolation. Good enough. Need to make resampleHist bigger if we want more.
 			int sample = s[0];
@@ -548,17 +604,17 @@ void SasInstance::MixVoice(SasVoice &voice) {
 			// Again, we round up by adding (1 << 14) first (*after* multiplying.)
 			sample = ((sample * envelopeValue) + (1 << 14)) >> 15;
 
-			// We mix into this 32-bit temp buffer and clip in a second loop
-			// Ideally, the shift right should be there too but for now I'm concerned about
-			// not overflowing.
-			mixBuffer[i * 2] += (sample * voice.volumeLeft) >> 12;
-			mixBuffer[i * 2 + 1] += (sample * voice.volumeRight) >> 12;
-			sendBuffer[i * 2] += sample * voice.effectLeft >> 12;
-			sendBuffer[i * 2 + 1] += sample * voice.effectRight >> 12;
+			scratch.samples[i] = sample;
 		}
 
-		voice.resampleHist[0] = mixTemp_[tempPos - 2];
-		voice.resampleHist[1] = mixTemp_[tempPos - 1];
+		// We mix into this 32-bit temp buffer and clip in a second loop
+		// Ideally, the shift right should be there too but for now I'm concerned about
+		// not overflowing.
+		AccumulateVoiceSamples(mixBuf + delay * 2, scratch.samples + delay, grainSize - delay, voice.volumeLeft, voice.volumeRight);
+		AccumulateVoiceSamples(sendBuf + delay * 2, scratch.samples + delay, grainSize - delay, voice.effectLeft, voice.effectRight);
+
+		voice.resampleHist[0] = scratch.resample[tempPos - 2];
+		voice.resampleHist[1] = scratch.resample[tempPos - 1];
 
 		voice.sampleFrac = sampleFrac - (tempPos - 2) * PSP_SAS_PITCH_BASE;
 
@@ -572,15 +628,61 @@ void SasInstance::MixVoice(SasVoice &voice) {
 	}
 }
 
+void SasInstance::MixVoice(SasVoice &voice) {
+	MixVoice(voice, mixBuffer, sendBuffer, mixScratch_);
+}
+
+void SasInstance::MixVoicesParallel(const int *voiceIndices, int count) {
+	// Each slice mixes into the slot named by its first voice.  Integer sums don't depend on order,
+	// but we still add the slots up in a fixed order afterward.
+	bool used[PSP_SAS_VOICES_MAX] = {};
+	GlobalThreadPool::Loop([&](int lower, int upper) {
+		MixSlot *slot;
+		{
+			std::lock_guard<ProfiledMutex> guard(mixSlotsLock_);
+			if (!mixSlots_[lower])
+				mixSlots_[lower].reset(new MixSlot());
+			slot = mixSlots_[lower].get();
+		}
+		used[lower] = true;
+
+		memset(slot->mix, 0, grainSize * sizeof(int) * 2);
+		memset(slot->send, 0, grainSize * sizeof(int) * 2);
+		for (int i = lower; i < upper; i++)
+			MixVoice(voices[voiceIndices[i]], slot->mix, slot->send, slot->scratch);
+	}, 0, count);
+
+	for (int s = 0; s < count; s++) {
+		if (!used[s])
+			continue;
+		const MixSlot *slot = mixSlots_[s].get();
+		for (int i = 0; i < grainSize * 2; i++) {
+			mixBuffer[i] += slot->mix[i];
+			sendBuffer[i] += slot->send[i];
+		}
+	}
+}
+
 void SasInstance::Mix(u32 outAddr, u32 inAddr, int leftVol, int rightVol) {
-	int voicesPlayingCount = 0;
+	int parallelVoices[PSP_SAS_VOICES_MAX];
+	int parallelCount = 0;
 
 	for (int v = 0; v < PSP_SAS_VOICES_MAX; v++) {
 		SasVoice &voice = voices[v];
 		if (!voice.playing || voice.paused)
 			continue;
-		voicesPlayingCount++;
-		MixVoice(voice);
+		// VAG decoding only touches the voice itself, the others call into memchecks or sceAtrac.
+		if (voice.type == VOICETYPE_VAG)
+			parallelVoices[parallelCount++] = v;
+		else
+			MixVoice(voice);
+	}
+
+	if (parallelCount * grainSize >= SAS_PARALLEL_MIN_SAMPLES) {
+		MixVoicesParallel(parallelVoices, parallelCount);
+	} else {
+		for (int i = 0; i < parallelCount; i++)
+			MixVoice(voices[parallelVoices[i]]);
 	}
 
 	// Then mix the send buffer in with the rest.
@@ -22,6 +22,10 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
+
+#include "thread/profiledmutex.h"
 #include "Common/CommonTypes.h"
 #include "Core/HW/BufferQueue.h"
 #include "Core/HW/SasReverb.h"
@@ -272,6 +276,12 @@ struct SasVoice {
 	SasAtrac3 atrac3;
 };
 
+// Per-voice temporaries used while mixing, one set for each thread mixing voices.
+struct SasMixScratch {
+	int16_t resample[PSP_SAS_MAX_GRAIN * 4 + 2 + 8];  // some extra margin for very high pitches.
+	int samples[PSP_SAS_MAX_GRAIN];
+};
+
 class SasInstance {
 public:
 	SasInstance();
@@ -309,7 +319,19 @@ class SasInstance {
 	WaveformEffect waveformEffect;
 
 private:
+	// A group of voices mixed on a worker thread, into its own buffers.
+	struct MixSlot {
+		SasMixScratch scratch;
+		int mix[PSP_SAS_MAX_GRAIN * 2];
+		int send[PSP_SAS_MAX_GRAIN * 2];
+	};
+
+	void MixVoice(SasVoice &voice, int *mixBuf, int *sendBuf, SasMixScratch &scratch);
+	void MixVoicesParallel(const int *voiceIndices, int count);
+
 	SasReverb reverb_;
 	int grainSize;
-	int16_t mixTemp_[PSP_SAS_MAX_GRAIN * 4 + 2 + 8];  // some extra margin for very high pitches.
+	SasMixScratch mixScratch_;
+	std::unique_ptr<MixSlot> mixSlots_[PSP_SAS_VOICES_MAX];
+	ProfiledMutex mixSlotsLock_{ "SasMixSlots" };
 };
@@ -15,9 +15,23 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 
+#include "ppsspp_config.h"
+#include "Common/Common.h"
+#ifdef _M_SSE
+#include <emmintrin.h>
+#endif
+#if PPSSPP_ARCH(ARM_NEON)
+#if defined(_MSC_VER) && PPSSPP_ARCH(ARM64)
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+#endif
+
 #include "base/basictypes.h"
 #include "Core/HW/SasReverb.h"
 #include "Core/Util/AudioFormat.h"
@@ -197,6 +211,12 @@ class BufferWrapper {
 			pos_ -= size_;
 		}
 	}
+	void Advance(int count) {
+		pos_ += count;
+		if (pos_ >= end_) {
+			pos_ -= size_;
+		}
+	}
 
 private:
 	int16_t *buf_;
@@ -206,6 +226,94 @@ class BufferWrapper {
 	int size_;
 };
 
+// Used while no tap can wrap, so we can skip the checks.
+class DirectBuffer {
+public:
+	DirectBuffer(int16_t *buffer) : buf_(buffer) {}
+	int16_t &operator [](int index) {
+		return buf_[index];
+	}
+	void Next() {
+		buf_++;
+	}
+
+private:
+	int16_t *buf_;
+};
+
+static void GetTapRange(const SasReverbData &d, int *minTap, int *maxTap) {
+	const int taps[] = {
+		d.mLSAME, d.mLSAME - 1, d.dLSAME, d.mRSAME, d.mRSAME - 1, d.dRSAME,
+		d.mLDIFF, d.mLDIFF - 1, d.dLDIFF, d.mRDIFF, d.mRDIFF - 1, d.dRDIFF,
+		d.mLCOMB1, d.mLCOMB2, d.mLCOMB3, d.mLCOMB4, d.mRCOMB1, d.mRCOMB2, d.mRCOMB3, d.mRCOMB4,
+		d.mLAPF1, d.mLAPF1 - d.dAPF1, d.mRAPF1, d.mRAPF1 - d.dAPF1,
+		d.mLAPF2, d.mLAPF2 - d.dAPF2, d.mRAPF2, d.mRAPF2 - d.dAPF2,
+	};
+	*minTap = *std::min_element(taps, taps + ARRAY_SIZE(taps));
+	*maxTap = *std::max_element(taps, taps + ARRAY_SIZE(taps));
+}
+
+template <typename B>
+inline void CombFilter(B &b, const SasReverbData &d, int32_t &Lout, int32_t &Rout) {
+#if defined(_M_SSE)
+	const __m128i taps = _mm_setr_epi16(b[d.mLCOMB1], b[d.mLCOMB2], b[d.mLCOMB3], b[d.mLCOMB4], b[d.mRCOMB1], b[d.mRCOMB2], b[d.mRCOMB3], b[d.mRCOMB4]);
+	const __m128i coefs = _mm_setr_epi16(d.vCOMB1, d.vCOMB2, d.vCOMB3, d.vCOMB4, d.vCOMB1, d.vCOMB2, d.vCOMB3, d.vCOMB4);
+	// Pairwise products are L12 L34 R12 R34, add neighbors to get both sums.
+	__m128i sums = _mm_madd_epi16(taps, coefs);
+	sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, _MM_SHUFFLE(2, 3, 0, 1)));
+	Lout = _mm_cvtsi128_si32(sums) >> 15;
+	Rout = _mm_cvtsi128_si32(_mm_srli_si128(sums, 8)) >> 15;
+#elif PPSSPP_ARCH(ARM_NEON)
+	const int16_t tapsL[4] = { b[d.mLCOMB1], b[d.mLCOMB2], b[d.mLCOMB3], b[d.mLCOMB4] };
+	const int16_t tapsR[4] = { b[d.mRCOMB1], b[d.mRCOMB2], b[d.mRCOMB3], b[d.mRCOMB4] };
+	const int16_t coefArray[4] = { d.vCOMB1, d.vCOMB2, d.vCOMB3, d.vCOMB4 };
+	const int16x4_t coefs = vld1_s16(coefArray);
+	const int32x4_t prodL = vmull_s16(vld1_s16(tapsL), coefs);
+	const int32x4_t prodR = vmull_s16(vld1_s16(tapsR), coefs);
+	const int32x2_t sums = vpadd_s32(vadd_s32(vget_low_s32(prodL), vget_high_s32(prodL)), vadd_s32(vget_low_s32(prodR), vget_high_s32(prodR)));
+	Lout = vget_lane_s32(sums, 0) >> 15;
+	Rout = vget_lane_s32(sums, 1) >> 15;
+#else
+	Lout = ((d.vCOMB1*b[d.mLCOMB1] + d.vCOMB2*b[d.mLCOMB2] + d.vCOMB3*b[d.mLCOMB3] + d.vCOMB4*b[d.mLCOMB4]) >> 15);
+	Rout = ((d.vCOMB1*b[d.mRCOMB1] + d.vCOMB2*b[d.mRCOMB2] + d.vCOMB3*b[d.mRCOMB3] + d.vCOMB4*b[d.mRCOMB4]) >> 15);
+#endif
+}
+
+template <typename B>
+inline void ProcessReverbSample(B &b, const SasReverbData &d, int16_t *output, const int16_t *input, uint16_t volLeft, uint16_t volRight) {
+	// Dividing by two here is an incorrect hack. Some multiplication factor is needed to prevent the reverb from getting too loud, though.
+	int16_t LeftInput = input[0] >> 1;
+	int16_t RightInput = input[1] >> 1;
+
+	int16_t Lin = LeftInput; //  (d.vLIN * LeftInput) >> 15;
+	int16_t Rin = RightInput; // (d.vRIN * RightInput) >> 15;
+
+	// ____Same Side Reflection(left - to - left and right - to - right)___________________
+	b[d.mLSAME] = clamp_s16(Lin + (b[d.dLSAME] * d.vWALL >> 15) - (b[d.mLSAME - 1]*d.vIIR >> 15) + b[d.mLSAME - 1]); // L - to - L
+	b[d.mRSAME] = clamp_s16(Rin + (b[d.dRSAME] * d.vWALL >> 15) - (b[d.mRSAME - 1]*d.vIIR >> 15) + b[d.mRSAME - 1]); // R - to - R
+	// ___Different Side Reflection(left - to - right and right - to - left)_______________
+	b[d.mLDIFF] = clamp_s16(Lin + (b[d.dRDIFF] * d.vWALL >> 15) - (b[d.mLDIFF - 1]*d.vIIR >> 15) + b[d.mLDIFF - 1]); // R - to - L
+	b[d.mRDIFF] = clamp_s16(Rin + (b[d.dLDIFF] * d.vWALL >> 15) - (b[d.mRDIFF - 1]*d.vIIR >> 15) + b[d.mRDIFF - 1]); // L - to - R
+	// ___Early Echo(Comb Filter, with input from buffer)__________________________
+	int32_t Lout, Rout;
+	CombFilter(b, d, Lout, Rout);
+	// ___Late Reverb APF1(All Pass Filter 1, with input from COMB)________________
+	b[d.mLAPF1] = clamp_s16(Lout - (d.vAPF1*b[(d.mLAPF1 - d.dAPF1)] >> 15));
+	Lout = b[(d.mLAPF1 - d.dAPF1)] + (b[d.mLAPF1] * d.vAPF1 >> 15);
+	b[d.mRAPF1] = clamp_s16(Rout - (d.vAPF1*b[(d.mRAPF1 - d.dAPF1)] >> 15));
+	Rout = b[(d.mRAPF1 - d.dAPF1)] + (b[d.mRAPF1] * d.vAPF1 >> 15);
+	// ___Late Reverb APF2(All Pass Filter 2, with input from APF1)________________
+	b[d.mLAPF2] = clamp_s16(Lout - (d.vAPF2*b[(d.mLAPF2 - d.dAPF2)] >> 15));
+	Lout = b[(d.mLAPF2 - d.dAPF2)] + (b[d.mLAPF2] * d.vAPF2 >> 15);
+	b[d.mRAPF2] = clamp_s16(Rout - (d.vAPF2*b[(d.mRAPF2 - d.dAPF2)] >> 15));
+	Rout = b[(d.mRAPF2 - d.dAPF2)] + (b[d.mRAPF2] * d.vAPF2 >> 15);
+	// ___Output to Mixer(Output volume multiplied with input from APF2)___________
+	output[0] = clamp_s16(Lout * volLeft >> 15);
+	output[1] = clamp_s16(Rout * volRight >> 15);
+	output[2] = 0;
+	output[3] = 0;
+}
+
 void SasReverb::ProcessReverb(int16_t *output, const int16_t *input, size_t inputSize, uint16_t volLeft, uint16_t volRight) {
 	// This means replicate the input signal in the processed buffer.
 	// Can also be used to verify that the error is in here...
@@ -224,47 +332,30 @@ void SasReverb::ProcessReverb(int16_t *output, const int16_t *input, size_t inpu
 
 	// We put this on the stack instead of in the object to let the compiler optimize better (avoid mem r/w).
 	BufferWrapper<BUFSIZE> b(workspace_, pos_, d.size);
-
-	// This runs at 22khz.
-	// Very unoptimized, straight from the description. Can probably be reformulated into something way more efficient.
-	// Or we could actually template the whole thing with the parameters as template arguments, as the presets are fixed.
-	for (size_t i = 0; i < inputSize; i++) {
-		// Dividing by two here is an incorrect hack. Some multiplication factor is needed to prevent the reverb from getting too loud, though.
-		int16_t LeftInput = input[i * 2] >> 1;
-		int16_t RightInput = input[i * 2 + 1] >> 1;
-
-		int16_t Lin = LeftInput; //  (d.vLIN * LeftInput) >> 15;
-		int16_t Rin = RightInput; // (d.vRIN * RightInput) >> 15;
-
-		// ____Same Side Reflection(left - to - left and right - to - right)___________________
-		b[d.mLSAME] = clamp_s16(Lin + (b[d.dLSAME] * d.vWALL >> 15) - (b[d.mLSAME - 1]*d.vIIR >> 15) + b[d.mLSAME - 1]); // L - to - L
-		b[d.mRSAME] = clamp_s16(Rin + (b[d.dRSAME] * d.vWALL >> 15) - (b[d.mRSAME - 1]*d.vIIR >> 15) + b[d.mRSAME - 1]); // R - to - R
-		// ___Different Side Reflection(left - to - right and right - to - left)_______________
-		b[d.mLDIFF] = clamp_s16(Lin + (b[d.dRDIFF] * d.vWALL >> 15) - (b[d.mLDIFF - 1]*d.vIIR >> 15) + b[d.mLDIFF - 1]); // R - to - L
-		b[d.mRDIFF] = clamp_s16(Rin + (b[d.dLDIFF] * d.vWALL >> 15) - (b[d.mRDIFF - 1]*d.vIIR >> 15) + b[d.mRDIFF - 1]); // L - to - R
-		// ___Early Echo(Comb Filter, with input from buffer)__________________________
-		int32_t Lout = ((d.vCOMB1*b[d.mLCOMB1] + d.vCOMB2*b[d.mLCOMB2] + d.vCOMB3*b[d.mLCOMB3] + d.vCOMB4*b[d.mLCOMB4]) >> 15);
-		int32_t Rout = ((d.vCOMB1*b[d.mRCOMB1] + d.vCOMB2*b[d.mRCOMB2] + d.vCOMB3*b[d.mRCOMB3] + d.vCOMB4*b[d.mRCOMB4]) >> 15);
-		// ___Late Reverb APF1(All Pass Filter 1, with input from COMB)________________
-		b[d.mLAPF1] = clamp_s16(Lout - (d.vAPF1*b[(d.mLAPF1 - d.dAPF1)] >> 15));
-		Lout = b[(d.mLAPF1 - d.dAPF1)] + (b[d.mLAPF1] * d.vAPF1 >> 15);
-		b[d.mRAPF1] = clamp_s16(Rout - (d.vAPF1*b[(d.mRAPF1 - d.dAPF1)] >> 15));
-		Rout = b[(d.mRAPF1 - d.dAPF1)] + (b[d.mRAPF1] * d.vAPF1 >> 15);
-		// ___Late Reverb APF2(All Pass Filter 2, with input from APF1)________________
-		b[d.mLAPF2] = clamp_s16(Lout - (d.vAPF2*b[(d.mLAPF2 - d.dAPF2)] >> 15));
-		Lout = b[(d.mLAPF2 - d.dAPF2)] + (b[d.mLAPF2] * d.vAPF2 >> 15);
-		b[d.mRAPF2] = clamp_s16(Rout - (d.vAPF2*b[(d.mRAPF2 - d.dAPF2)] >> 15));
-		Rout = b[(d.mRAPF2 - d.dAPF2)] + (b[d.mRAPF2] * d.vAPF2 >> 15);
-		// ___Output to Mixer(Output volume multiplied with input from APF2)___________
-		output[i * 4 + 0] = clamp_s16(Lout * volLeft >> 15);
-		output[i * 4 + 1] = clamp_s16(Rout * volRight >> 15);
-		output[i * 4 + 2] = 0;
-		output[i * 4 + 3] = 0;
-
-		b.Next();
+	int minTap, maxTap;
+	GetTapRange(d, &minTap, &maxTap);
+
+	// This runs at 22khz, the input was already downsampled.
+	// Most of the time no tap is near the ends of the buffer, so we run those stretches without wrapping.
+	size_t i = 0;
+	while (i < inputSize) {
+		const int pos = b.GetPosition();
+		const int directCount = pos + minTap >= BUFSIZE - d.size ? BUFSIZE - maxTap - pos : 0;
+		if (directCount > 0) {
+			const size_t count = std::min((size_t)directCount, inputSize - i);
+			DirectBuffer direct(workspace_ + pos);
+			for (size_t end = i + count; i < end; i++) {
+				ProcessReverbSample(direct, d, output + i * 4, input + i * 2, volLeft, volRight);
+				direct.Next();
+			}
+			b.Advance((int)count);
+		} else {
+			ProcessReverbSample(b, d, output + i * 4, input + i * 2, volLeft, volRight);
+			b.Next();
+			i++;
+		}
 	}
 
 	// Save the state in the object.
 	pos_ = b.GetPosition();
 }
-
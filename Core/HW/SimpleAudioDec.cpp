@@ -16,6 +16,9 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <algorithm>
+#include <cstring>
+
+#include "thread/threadutil.h"
 
 #include "Core/Config.h"
 #include "Core/HLE/FunctionWrappers.h"
@@ -288,6 +291,11 @@ bool IsValidCodec(int codec){
 
 // sceAu module starts from here
 
+// How many MP3 frames the worker decodes before the game asks for them.
+static const size_t AU_DECODE_AHEAD_FRAMES = 2;
+// 1152 stereo samples, the most a single MP3 frame produces.
+static const int AU_MAX_FRAME_BYTES = 1152 * 2 * 2;
+
 AuCtx::AuCtx() {
 	decoder = NULL;
 	startPos = 0;
@@ -305,25 +313,105 @@ AuCtx::AuCtx() {
 };
 
 AuCtx::~AuCtx(){
+	StopDecodeAhead();
 	if (decoder){
 		AudioClose(&decoder);
 		decoder = NULL;
 	}
 };
 
-size_t AuCtx::FindNextMp3Sync() {
+// Returns the offset of the next sync relative to start, or 0 if there isn't one.
+size_t AuCtx::FindNextMp3Sync(size_t start) {
 	if (audioType != PSP_CODEC_MP3) {
 		return 0;
 	}
 
-	for (size_t i = 0; i < sourcebuff.size() - 2; ++i) {
+	for (size_t i = start; i + 2 < sourcebuff.size(); ++i) {
 		if ((sourcebuff[i] & 0xFF) == 0xFF && (sourcebuff[i + 1] & 0xC0) == 0xC0) {
-			return i;
+			return i - start;
 		}
 	}
 	return 0;
 }
 
+void AuCtx::ConsumeSource(int srcPos) {
+	// remove the consumed source
+	if (srcPos > 0)
+		sourcebuff.erase(sourcebuff.begin(), sourcebuff.begin() + srcPos);
+	// reduce the available Aubuff size
+	// (the available buff size is now used to know if we can read again from file and how many to read)
+	AuBufAvailable -= srcPos;
+	aheadPos_ -= srcPos;
+}
+
+void AuCtx::StartDecodeAhead() {
+	if (!aheadThread_.joinable()) {
+		aheadStop_ = false;
+		aheadThread_ = std::thread([this] { DecodeAheadLoop(); });
+	}
+}
+
+void AuCtx::StopDecodeAhead() {
+	if (aheadThread_.joinable()) {
+		{
+			std::lock_guard<std::mutex> guard(aheadLock_);
+			aheadStop_ = true;
+		}
+		aheadCond_.notify_one();
+		aheadThread_.join();
+	}
+}
+
+// Must be called with aheadLock_ held, whenever sourcebuff or the decoder is replaced.
+void AuCtx::ClearDecodeAhead() {
+	aheadFrames_.clear();
+	aheadPos_ = 0;
+	aheadBlocked_ = false;
+}
+
+bool AuCtx::CanDecodeAhead() const {
+	return decoder && !aheadBlocked_ && aheadFrames_.size() < AU_DECODE_AHEAD_FRAMES && aheadPos_ < sourcebuff.size();
+}
+
+void AuCtx::DecodeAheadFrame() {
+	size_t start = aheadPos_ + FindNextMp3Sync(aheadPos_);
+	// Only decode whole frames, so that more data arriving can't change the result.
+	// The workarea is a bit more than the largest frame.
+	if (sourcebuff.size() - start < (size_t)AuStreamWorkareaSize()) {
+		aheadBlocked_ = true;
+		return;
+	}
+
+	AheadFrame frame;
+	frame.pcm.resize(AU_MAX_FRAME_BYTES);
+	int outbytes = 0;
+	decoder->Decode(&sourcebuff[start], (int)(sourcebuff.size() - start), &frame.pcm[0], &outbytes);
+	if (outbytes == 0) {
+		// Leave the end of the stream (or bad data) to AuDecode.
+		aheadBlocked_ = true;
+		return;
+	}
+
+	frame.pcm.resize(outbytes);
+	frame.outSamples = decoder->GetOutSamples();
+	frame.srcPos = decoder->GetSourcePos() + (int)(start - aheadPos_);
+	aheadPos_ += frame.srcPos;
+	aheadFrames_.push_back(std::move(frame));
+}
+
+void AuCtx::DecodeAheadLoop() {
+	setCurrentThreadName("AuDecodeAhead");
+
+	std::unique_lock<std::mutex> guard(aheadLock_);
+	while (!aheadStop_) {
+		if (CanDecodeAhead()) {
+			DecodeAheadFrame();
+		} else {
+			aheadCond_.wait(guard);
+		}
+	}
+}
+
 // return output pcm size, <0 error
 u32 AuCtx::AuDecode(u32 pcmAddr) {
 	if (!Memory::IsValidAddress(pcmAddr)){
@@ -334,8 +422,17 @@ u32 AuCtx::AuDecode(u32 pcmAddr) {
 	auto outbuf = Memory::GetPointer(PCMBuf);
 	int outpcmbufsize = 0;
 
-	// Decode a single frame in sourcebuff and output into PCMBuf.
-	if (!sourcebuff.empty()) {
+	std::unique_lock<std::mutex> guard(aheadLock_);
+	if (!aheadFrames_.empty()) {
+		// Already decoded by the worker, from the same data and decoder state.
+		const AheadFrame &frame = aheadFrames_.front();
+		outpcmbufsize = (int)frame.pcm.size();
+		memcpy(outbuf, &frame.pcm[0], outpcmbufsize);
+		SumDecodedSamples += frame.outSamples / 2;
+		ConsumeSource(frame.srcPos);
+		aheadFrames_.pop_front();
+	} else if (!sourcebuff.empty()) {
+		// Decode a single frame in sourcebuff and output into PCMBuf.
 		// FFmpeg doesn't seem to search for a sync for us, so let's do that.
 		int nextSync = (int)FindNextMp3Sync();
 		decoder->Decode(&sourcebuff[nextSync], (int)sourcebuff.size() - nextSync, outbuf, &outpcmbufsize);
@@ -349,15 +446,17 @@ u32 AuCtx::AuDecode(u32 pcmAddr) {
 			SumDecodedSamples += decoder->GetOutSamples() / 2;
 			// get consumed source length
 			int srcPos = decoder->GetSourcePos() + nextSync;
-			// remove the consumed source
-			if (srcPos > 0)
-				sourcebuff.erase(sourcebuff.begin(), sourcebuff.begin() + srcPos);
-			// reduce the available Aubuff size
-			// (the available buff size is now used to know if we can read again from file and how many to read)
-			AuBufAvailable -= srcPos;
+			ConsumeSource(srcPos);
 		}
 	}
 
+	// Decode the following frames while the game is busy with this one.
+	if (audioType == PSP_CODEC_MP3) {
+		StartDecodeAhead();
+		aheadCond_.notify_one();
+	}
+	guard.unlock();
+
 	bool end = readPos - AuBufAvailable >= (int64_t)endPos;
 	if (end && LoopNum != 0) {
 		// When looping, start the sum back off at zero and reset readPos to the start.
@@ -439,9 +538,12 @@ u32 AuCtx::AuNotifyAddStreamData(int size) {
 	}
 
 	if (Memory::IsValidRange(AuBuf, size)) {
+		std::lock_guard<std::mutex> guard(aheadLock_);
 		sourcebuff.resize(sourcebuff.size() + size);
 		Memory::MemcpyUnchecked(&sourcebuff[sourcebuff.size() - size], AuBuf + offset, size);
+		aheadBlocked_ = false;
 	}
+	aheadCond_.notify_one();
 
 	return 0;
 }
@@ -483,7 +585,9 @@ u32 AuCtx::AuResetPlayPositionByFrame(int frame) {
 		readPos -= 1;
 	SumDecodedSamples = frame * MaxOutputSample;
 	AuBufAvailable = 0;
+	std::lock_guard<std::mutex> guard(aheadLock_);
 	sourcebuff.clear();
+	ClearDecodeAhead();
 	return 0;
 }
 
@@ -491,7 +595,9 @@ u32 AuCtx::AuResetPlayPosition() {
 	readPos = startPos;
 	SumDecodedSamples = 0;
 	AuBufAvailable = 0;
+	std::lock_guard<std::mutex> guard(aheadLock_);
 	sourcebuff.clear();
+	ClearDecodeAhead();
 	return 0;
 }
 
@@ -521,7 +627,9 @@ void AuCtx::DoState(PointerWrap &p) {
 	p.Do(FrameNum);
 
 	if (p.mode == p.MODE_READ) {
+		std::lock_guard<std::mutex> guard(aheadLock_);
 		decoder = new SimpleAudio(audioType);
 		AuBufAvailable = 0; // reset to read from file at position readPos
+		ClearDecodeAhead();
 	}
 }
@@ -18,6 +18,11 @@
 #pragma once
 
 #include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "base/basictypes.h"
 #include "Core/HW/MediaEngine.h"
@@ -157,9 +162,34 @@ class AuCtx {
 	int askedReadSize; // the size of data requied to be read from file by the game
 
 private:
-	size_t FindNextMp3Sync();
+	// A frame decoded ahead of the game asking for it, by the decode-ahead worker.
+	struct AheadFrame {
+		std::vector<u8> pcm;
+		int outSamples;
+		int srcPos;
+	};
+
+	size_t FindNextMp3Sync(size_t start = 0);
+	void ConsumeSource(int srcPos);
+
+	void StartDecodeAhead();
+	void StopDecodeAhead();
+	void ClearDecodeAhead();
+	bool CanDecodeAhead() const;
+	void DecodeAheadFrame();
+	void DecodeAheadLoop();
 
 	std::vector<u8> sourcebuff; // source buffer
+
+	// Decoded frames, in order, starting at the front of sourcebuff.
+	// The decoder state is shared with AuDecode, so everything here and sourcebuff is guarded by aheadLock_.
+	std::deque<AheadFrame> aheadFrames_;
+	size_t aheadPos_ = 0; // offset in sourcebuff after the last frame in aheadFrames_
+	bool aheadBlocked_ = false;
+	bool aheadStop_ = false;
+	std::thread aheadThread_;
+	std::mutex aheadLock_;
+	std::condition_variable aheadCond_;
 };
 
 
@@ -25,10 +25,23 @@
 #define LOW_WATERMARK_DEFAULT   1680 // 40 ms
 #define LOW_WATERMARK_EXTRA 3360 // 80 ms
 
+#define LOW_WATERMARK_LOW_LATENCY 882 // 20 ms
+
 #define MAX_FREQ_SHIFT  200  // per 32000 Hz
 #define CONTROL_FACTOR  0.2f // in freq_shift per fifo size offset
 #define CONTROL_AVG     32
 
+// Low latency mode reacts faster, and integrates the error so the fill level settles on the watermark.
+#define CONTROL_AVG_LOW_LATENCY 8
+#define CONTROL_INTEGRAL_FACTOR 0.002f
+
+// Polyphase windowed sinc.  Taps are centered so that tap SINC_TAPS / 2 - 1 is the current frame.
+#define SINC_TAPS        16
+#define SINC_PHASE_BITS  7
+#define SINC_PHASES      (1 << SINC_PHASE_BITS)
+#define SINC_COEF_SHIFT  14
+
+#include <cmath>
 #include <cstring>
 
 #include "base/logging.h"
@@ -54,6 +67,13 @@
 #endif
 #endif
 
+// In SSE builds, each group of four taps is stored as c0 c1 c0 c1 c2 c3 c2 c3 to match the frames after shuffling.
+#ifdef _M_SSE
+#define SINC_PHASE_STRIDE (SINC_TAPS * 2)
+#else
+#define SINC_PHASE_STRIDE SINC_TAPS
+#endif
+
 StereoResampler::StereoResampler()
 		: m_bufsize(MAX_SAMPLES_DEFAULT)
 	  , m_lowwatermark(LOW_WATERMARK_DEFAULT)
@@ -65,9 +85,13 @@ StereoResampler::StereoResampler()
 		, underrunCount_(0)
 		, overrunCount_(0)
 		, sample_rate_(0.0f)
-		, lastBufSize_(0) {
+		, lastBufSize_(0)
+		, lowLatency_(false)
+		, controlIntegral_(0.0f)
+		, sincTableRate_(0) {
 	// Need to have space for the worst case in case it changes.
 	m_buffer = new int16_t[MAX_SAMPLES_EXTRA * 2]();
+	sincTable_ = new int16_t[SINC_PHASES * SINC_PHASE_STRIDE]();
 
 	// Some Android devices are v-synced to non-60Hz framerates. We simply timestretch audio to fit.
 	// TODO: should only do this if auto frameskip is off?
@@ -84,18 +108,109 @@ StereoResampler::StereoResampler()
 StereoResampler::~StereoResampler() {
 	delete[] m_buffer;
 	m_buffer = nullptr;
+	delete[] sincTable_;
+	sincTable_ = nullptr;
 }
 
 void StereoResampler::UpdateBufferSize() {
+	lowLatency_ = false;
 	if (g_Config.bExtraAudioBuffering) {
 		m_bufsize = MAX_SAMPLES_EXTRA;
 		m_lowwatermark = LOW_WATERMARK_EXTRA;
+	} else if (g_Config.iAudioLatency == LOW_LATENCY) {
+		m_bufsize = MAX_SAMPLES_DEFAULT;
+		m_lowwatermark = LOW_WATERMARK_LOW_LATENCY;
+		lowLatency_ = true;
 	} else {
 		m_bufsize = MAX_SAMPLES_DEFAULT;
 		m_lowwatermark = LOW_WATERMARK_DEFAULT;
 	}
 }
 
+static inline void StoreSincCoef(int16_t *phaseCoefs, int tap, int16_t value) {
+#ifdef _M_SSE
+	int16_t *group = phaseCoefs + (tap & ~3) * 2;
+	const int j = tap & 3;
+	const int pos = j < 2 ? j : j + 2;
+	group[pos] = value;
+	group[pos + 2] = value;
+#else
+	phaseCoefs[tap] = value;
+#endif
+}
+
+void StereoResampler::UpdateSincTable(int outputRate) {
+	if (outputRate == sincTableRate_)
+		return;
+	sincTableRate_ = outputRate;
+
+	// Leave some room below Nyquist, and lower the cutoff when downsampling to avoid aliasing.
+	double cutoff = 0.9;
+	if (outputRate < (int)m_input_sample_rate)
+		cutoff *= (double)outputRate / (double)m_input_sample_rate;
+
+	const double pi = 3.14159265358979323846;
+	const int center = SINC_TAPS / 2 - 1;
+	for (int phase = 0; phase < SINC_PHASES; ++phase) {
+		const double frac = (double)phase / SINC_PHASES;
+		double coefs[SINC_TAPS];
+		double sum = 0.0;
+		for (int tap = 0; tap < SINC_TAPS; ++tap) {
+			const double x = tap - center - frac;
+			const double sinc = x == 0.0 ? 1.0 : sin(pi * cutoff * x) / (pi * cutoff * x);
+			// Blackman window over the span of the taps.
+			const double w = (x + SINC_TAPS / 2) / SINC_TAPS;
+			const double window = 0.42 - 0.5 * cos(2.0 * pi * w) + 0.08 * cos(4.0 * pi * w);
+			coefs[tap] = sinc * window;
+			sum += coefs[tap];
+		}
+
+		// Normalize so that DC passes through unchanged.
+		int16_t *out = sincTable_ + phase * SINC_PHASE_STRIDE;
+		for (int tap = 0; tap < SINC_TAPS; ++tap) {
+			StoreSincCoef(out, tap, (int16_t)floor(coefs[tap] / sum * (1 << SINC_COEF_SHIFT) + 0.5));
+		}
+	}
+}
+
+// Filters SINC_TAPS consecutive stereo frames.
+static inline void SincFilterFrame(const int16_t *frames, const int16_t *coefs, int *left, int *right) {
+#if defined(_M_SSE)
+	__m128i acc = _mm_setzero_si128();
+	for (int i = 0; i < SINC_TAPS / 4; ++i) {
+		// L0 R0 L1 R1 L2 R2 L3 R3 -> L0 L1 R0 R1 L2 L3 R2 R3, so pmaddwd sums pairs from one channel.
+		__m128i f = _mm_loadu_si128((const __m128i *)(frames + i * 8));
+		f = _mm_shufflehi_epi16(_mm_shufflelo_epi16(f, _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0));
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(f, _mm_loadu_si128((const __m128i *)(coefs + i * 8))));
+	}
+	acc = _mm_add_epi32(acc, _mm_srli_si128(acc, 8));
+	*left = _mm_cvtsi128_si32(acc);
+	*right = _mm_cvtsi128_si32(_mm_srli_si128(acc, 4));
+#elif PPSSPP_ARCH(ARM_NEON)
+	int32x4_t accL = vdupq_n_s32(0);
+	int32x4_t accR = vdupq_n_s32(0);
+	for (int i = 0; i < SINC_TAPS / 8; ++i) {
+		int16x8x2_t f = vld2q_s16(frames + i * 16);
+		int16x8_t c = vld1q_s16(coefs + i * 8);
+		accL = vmlal_s16(accL, vget_low_s16(f.val[0]), vget_low_s16(c));
+		accL = vmlal_s16(accL, vget_high_s16(f.val[0]), vget_high_s16(c));
+		accR = vmlal_s16(accR, vget_low_s16(f.val[1]), vget_low_s16(c));
+		accR = vmlal_s16(accR, vget_high_s16(f.val[1]), vget_high_s16(c));
+	}
+	int32x2_t sums = vpadd_s32(vadd_s32(vget_low_s32(accL), vget_high_s32(accL)), vadd_s32(vget_low_s32(accR), vget_high_s32(accR)));
+	*left = vget_lane_s32(sums, 0);
+	*right = vget_lane_s32(sums, 1);
+#else
+	int l = 0, r = 0;
+	for (int tap = 0; tap < SINC_TAPS; ++tap) {
+		l += frames[tap * 2] * coefs[tap];
+		r += frames[tap * 2 + 1] * coefs[tap];
+	}
+	*left = l;
+	*right = r;
+#endif
+}
+
 template<bool useShift>
 inline void ClampBufferToS16(s16 *out, const s32 *in, size_t size, s8 volShift) {
 #ifdef _M_SSE
@@ -189,26 +304,41 @@ unsigned int StereoResampler::Mix(short* samples, unsigned int numSamples, bool
 	} else {
 		// Drift prevention mechanism
 		float numLeft = (float)(((indexW - indexR) & INDEX_MASK) / 2);
-		m_numLeftI = (numLeft + m_numLeftI*(CONTROL_AVG - 1)) / CONTROL_AVG;
+		const int controlAvg = lowLatency_ ? CONTROL_AVG_LOW_LATENCY : CONTROL_AVG;
+		m_numLeftI = (numLeft + m_numLeftI*(controlAvg - 1)) / controlAvg;
 		float offset = (m_numLeftI - m_lowwatermark) * CONTROL_FACTOR;
+		if (lowLatency_) {
+			controlIntegral_ += (m_numLeftI - m_lowwatermark) * CONTROL_INTEGRAL_FACTOR;
+			controlIntegral_ = std::max(-(float)MAX_FREQ_SHIFT, std::min((float)MAX_FREQ_SHIFT, controlIntegral_));
+			offset += controlIntegral_;
+		} else {
+			controlIntegral_ = 0.0f;
+		}
 		if (offset > MAX_FREQ_SHIFT) offset = MAX_FREQ_SHIFT;
 		if (offset < -MAX_FREQ_SHIFT) offset = -MAX_FREQ_SHIFT;
 
 		sample_rate_ = (float)(m_input_sample_rate + offset);
 		const u32 ratio = (u32)(65536.0 * sample_rate_ / (double)sample_rate);
-
-		// TODO: consider a higher-quality resampling algorithm.
-		// TODO: Add a fast path for 1:1.
-		for (; currentSample < numSamples * 2 && ((indexW - indexR) & INDEX_MASK) > 2; currentSample += 2) {
-			u32 indexR2 = indexR + 2; //next sample
-			s16 l1 = m_buffer[indexR & INDEX_MASK]; //current
-			s16 r1 = m_buffer[(indexR + 1) & INDEX_MASK]; //current
-			s16 l2 = m_buffer[indexR2 & INDEX_MASK]; //next
-			s16 r2 = m_buffer[(indexR2 + 1) & INDEX_MASK]; //next
-			int sampleL = ((l1 << 16) + (l2 - l1) * (u16)m_frac) >> 16;
-			int sampleR = ((r1 << 16) + (r2 - r1) * (u16)m_frac) >> 16;
-			samples[currentSample] = sampleL;
-			samples[currentSample + 1] = sampleR;
+		UpdateSincTable(sample_rate);
+
+		// The filter reads SINC_TAPS / 2 - 1 frames behind the current one, and SINC_TAPS / 2 ahead.
+		const u32 history = (SINC_TAPS / 2 - 1) * 2;
+		const u32 lookahead = (SINC_TAPS / 2) * 2;
+		int16_t wrapped[SINC_TAPS * 2];
+		for (; currentSample < numSamples * 2 && ((indexW - indexR) & INDEX_MASK) > lookahead; currentSample += 2) {
+			const u32 start = (indexR - history) & INDEX_MASK;
+			const int16_t *frames = &m_buffer[start];
+			if (start + SINC_TAPS * 2 > (u32)m_bufsize * 2) {
+				for (int i = 0; i < SINC_TAPS * 2; ++i)
+					wrapped[i] = m_buffer[(start + i) & INDEX_MASK];
+				frames = wrapped;
+			}
+
+			const int16_t *coefs = sincTable_ + ((u16)m_frac >> (16 - SINC_PHASE_BITS)) * SINC_PHASE_STRIDE;
+			int sampleL, sampleR;
+			SincFilterFrame(frames, coefs, &sampleL, &sampleR);
+			samples[currentSample] = clamp_s16(sampleL >> SINC_COEF_SHIFT);
+			samples[currentSample + 1] = clamp_s16(sampleR >> SINC_COEF_SHIFT);
 			m_frac += ratio;
 			indexR += 2 * (u16)(m_frac >> 16);
 			m_frac &= 0xffff;
@@ -247,7 +377,8 @@ void StereoResampler::PushSamples(const s32 *samples, unsigned int num_samples)
 	// needs to get updates to not deadlock.
 	u32 indexW = Common::AtomicLoad(m_indexW);
 
-	u32 cap = m_bufsize * 2;
+	// Keep the frames behind the read position that the resampling filter still reads.
+	u32 cap = m_bufsize * 2 - SINC_TAPS * 2;
 	// If unthottling, no need to fill up the entire buffer, just screws up timing after releasing unthrottle.
 	if (PSP_CoreParameter().unthrottle)
 		cap = m_lowwatermark * 2;
@@ -287,6 +418,8 @@ void StereoResampler::GetAudioDebugStats(AudioDebugStats *stats) {
 
 void StereoResampler::SetInputSampleRate(unsigned int rate) {
 	m_input_sample_rate = rate;
+	// The cutoff depends on the input rate, rebuild on next use.
+	sincTableRate_ = 0;
 }
 
 void StereoResampler::DoState(PointerWrap &p) {
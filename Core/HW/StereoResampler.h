@@ -47,6 +47,7 @@ class StereoResampler {
 protected:
 	void UpdateBufferSize();
 	void SetInputSampleRate(unsigned int rate);
+	void UpdateSincTable(int outputRate);
 
 	int m_bufsize;
 	int m_lowwatermark;
@@ -61,4 +62,10 @@ class StereoResampler {
 	float sample_rate_;
 	int lastBufSize_;
 	int lastPushSize_;
+
+	bool lowLatency_;
+	float controlIntegral_;
+	// Windowed sinc coefficients, SINC_TAPS for each of SINC_PHASES fractional positions.
+	int16_t *sincTable_;
+	int sincTableRate_;
 };
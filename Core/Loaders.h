@@ -63,6 +63,14 @@ class FileLoader {
 		HINT_UNCACHED,
 	};
 
+	struct ReadRequest {
+		s64 absolutePos;
+		size_t bytes;
+		void *data;
+		// Bytes actually read.
+		size_t result;
+	};
+
 	virtual ~FileLoader() {}
 
 	virtual bool IsRemote() {
@@ -88,6 +96,12 @@ class FileLoader {
 	virtual size_t ReadAt(s64 absolutePos, size_t bytes, void *data, Flags flags = Flags::NONE) {
 		return ReadAt(absolutePos, 1, bytes, data, flags);
 	}
+	// Loaders that can keep several reads in flight at once should override this.
+	virtual void ReadMany(ReadRequest *requests, size_t count, Flags flags = Flags::NONE) {
+		for (size_t i = 0; i < count; ++i) {
+			requests[i].result = ReadAt(requests[i].absolutePos, requests[i].bytes, requests[i].data, flags);
+		}
+	}
 
 	// Cancel any operations that might block, if possible.
 	virtual void Cancel() {
@@ -33,6 +33,7 @@
 #include "Core/MemMap.h"
 
 #include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/MIPSAnalyst.h"
 #include "Core/MIPS/MIPSCodeUtils.h"
 #include "Core/MIPS/MIPSInt.h"
 #include "Core/MIPS/MIPSTables.h"
@@ -102,6 +103,8 @@ Arm64Jit::Arm64Jit(MIPSState *mips) : blocks(mips, this), gpr(mips, &js, &jo), f
 	logBlocks = 0;
 	dontLogBlocks = 0;
 	blocks.Init();
+	if (jo.profileBlocks)
+		blocks.EnableProfiling();
 	gpr.SetEmitter(this);
 	fpr.SetEmitter(this, &fp);
 	AllocCodeSpace(1024 * 1024 * 16);  // 32MB is the absolute max because that's what an ARM branch instruction can reach, backwards and forwards.
@@ -172,6 +175,10 @@ void Arm64Jit::ClearCache() {
 	blocks.Clear();
 	ClearCodeSpace(jitStartOffset);
 	FlushIcacheSection(region + jitStartOffset, region + region_size - jitStartOffset);
+	// We may be called from inside jit code, so the dispatcher can't change until we're back out.
+	if (jo.useStaticAlloc && gpr.UpdateStaticAllocations()) {
+		regenerateFixedCode_ = true;
+	}
 }
 
 void Arm64Jit::InvalidateCacheAt(u32 em_address, int length) {
@@ -263,6 +270,16 @@ void Arm64Jit::Compile(u32 em_address) {
 
 void Arm64Jit::RunLoopUntil(u64 globalticks) {
 	PROFILE_THIS_SCOPE("jit");
+	if (regenerateFixedCode_) {
+		// Blocks and the dispatcher both bake in the static registers, so start over.
+		// Their values are in MIPSState while we're out of the jit.
+		INFO_LOG(JIT, "ARM64Jit: Static registers changed, regenerating");
+		regenerateFixedCode_ = false;
+		blocks.Clear();
+		ClearCodeSpace(0);
+		GenerateFixedCode(jo);
+		FlushIcacheSection(region, region + region_size);
+	}
 	((void (*)())enterDispatcher)();
 }
 
@@ -278,6 +295,7 @@ const u8 *Arm64Jit::DoJit(u32 em_address, JitBlock *b) {
 	js.cancel = false;
 	js.blockStart = mips_->pc;
 	js.compilerPC = mips_->pc;
+	js.pollingLoop = MIPSAnalyst::IsPollingLoop(js.blockStart);
 	js.lastContinuedPC = 0;
 	js.initialBlockSize = 0;
 	js.nextExit = 0;
@@ -316,6 +334,13 @@ const u8 *Arm64Jit::DoJit(u32 em_address, JitBlock *b) {
 	}
 
 	b->normalEntry = GetCodePtr();
+	if (jo.profileBlocks) {
+		// Nothing is mapped yet, and this doesn't touch flags.
+		MOVP2R(SCRATCH1_64, blocks.GetProfileCounter(b->blockNum));
+		LDR(INDEX_UNSIGNED, SCRATCH2_64, SCRATCH1_64, 0);
+		ADD(SCRATCH2_64, SCRATCH2_64, 1);
+		STR(INDEX_UNSIGNED, SCRATCH2_64, SCRATCH1_64, 0);
+	}
 	// TODO: this needs work
 	MIPSAnalyst::AnalysisResults analysis; // = MIPSAnalyst::Analyze(em_address);
 
@@ -384,6 +409,7 @@ const u8 *Arm64Jit::DoJit(u32 em_address, JitBlock *b) {
 		blocks.ProxyBlock(js.blockStart, js.lastContinuedPC, (GetCompilerPC() - js.lastContinuedPC) / sizeof(u32), GetCodePtr());
 		b->originalSize = js.initialBlockSize;
 	}
+	blocks.SetProfileCycleEstimate(b->blockNum, js.downcountAmount);
 
 	return b->normalEntry;
 }
@@ -677,9 +703,24 @@ void Arm64Jit::UpdateRoundingMode(u32 fcr31) {
 // though, as we need to have the SUBS flag set in the end. So with block linking in the mix,
 // I don't think this gives us that much benefit.
 void Arm64Jit::WriteExit(u32 destination, int exit_num) {
+	if (destination == js.blockStart && js.pollingLoop) {
+		// Nothing can change what we're polling until the next event, so skip ahead to it.
+		// Registers are already flushed for the exit.
+		SaveStaticRegisters();
+		RestoreRoundingMode();
+		MOVI2R(W0, 0);
+		QuickCallFunction(SCRATCH1_64, &CoreTiming::Idle);
+		ApplyRoundingMode();
+		LoadStaticRegisters();
+	}
+
 	WriteDownCount(); 
 	//If nobody has taken care of this yet (this can be removed when all branches are done)
 	JitBlock *b = js.curBlock;
+	if (destination == js.blockStart && jo.enableBlocklink) {
+		// Tight loop back into this block, skip the checked entry while we still have cycles.
+		B(CC_GE, b->normalEntry);
+	}
 	b->exitAddress[exit_num] = destination;
 	b->exitPtrs[exit_num] = GetWritableCodePtr();
 
@@ -282,6 +282,8 @@ class Arm64Jit : public Arm64Gen::ARM64CodeBlock, public JitInterface, public MI
 	const u8 *updateRoundingMode;
 
 	int jitStartOffset;
+	// The static registers changed, so the fixed code must be regenerated once we're out of the jit.
+	bool regenerateFixedCode_ = false;
 
 	// Indexed by FPCR FZ:RN bits for convenience.  Uses SCRATCH2.
 	const u8 *convertS0ToSCRATCH1[8];
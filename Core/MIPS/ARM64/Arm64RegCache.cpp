@@ -18,6 +18,9 @@
 #include "ppsspp_config.h"
 #if PPSSPP_ARCH(ARM64)
 
+#include <algorithm>
+#include <cstring>
+
 #include "base/logging.h"
 #include "Core/MemMap.h"
 #include "Core/MIPS/ARM64/Arm64RegCache.h"
@@ -34,6 +37,15 @@ using namespace Arm64Gen;
 using namespace Arm64JitConstants;
 
 Arm64RegCache::Arm64RegCache(MIPSState *mips, MIPSComp::JitState *js, MIPSComp::JitOptions *jo) : mips_(mips), js_(js), jo_(jo) {
+	// Until we know better.  SP always stays in W19, it's the one worth pointerifying.
+	static const StaticAllocation defaultAllocs[NUM_STATIC_ALLOCS] = {
+		{MIPS_REG_SP, W19, true},
+		{MIPS_REG_V0, W20},
+		{MIPS_REG_A0, W21},
+		{MIPS_REG_V1, W22},
+		{MIPS_REG_RA, W23},
+	};
+	memcpy(staticAllocs_, defaultAllocs, sizeof(staticAllocs_));
 }
 
 void Arm64RegCache::Init(ARM64XEmitter *emitter) {
@@ -88,23 +100,60 @@ const ARM64Reg *Arm64RegCache::GetMIPSAllocationOrder(int &count) {
 }
 
 const Arm64RegCache::StaticAllocation *Arm64RegCache::GetStaticAllocations(int &count) {
-	static const StaticAllocation allocs[] = {
-		{MIPS_REG_SP, W19, true},
-		{MIPS_REG_V0, W20},
-		{MIPS_REG_V1, W22},
-		{MIPS_REG_A0, W21},
-		{MIPS_REG_RA, W23},
-	};
-
 	if (jo_->useStaticAlloc) {
-		count = ARRAY_SIZE(allocs);
-		return allocs;
+		count = NUM_STATIC_ALLOCS;
+		return staticAllocs_;
 	} else {
 		count = 0;
 		return nullptr;
 	}
 }
 
+bool Arm64RegCache::UpdateStaticAllocations() {
+	u32 total = 0;
+	for (int i = 0; i < 32; i++)
+		total += mapCounts_[i];
+	// Not enough to go on yet, and not worth recompiling everything for.
+	if (total < 10000)
+		return false;
+
+	// Pick the most mapped, leaving out SP which is always static.
+	MIPSGPReg best[NUM_STATIC_ALLOCS - 1];
+	for (int i = 0; i < NUM_STATIC_ALLOCS - 1; i++) {
+		best[i] = MIPS_REG_ZERO;
+		for (int r = 1; r < 32; r++) {
+			if (r == MIPS_REG_SP || std::find(best, best + i, (MIPSGPReg)r) != best + i)
+				continue;
+			if (best[i] == MIPS_REG_ZERO || mapCounts_[r] > mapCounts_[best[i]])
+				best[i] = (MIPSGPReg)r;
+		}
+	}
+
+	// Keep the ones still chosen where they are, and put the new ones in the freed up slots.
+	bool changed = false;
+	for (int i = 1; i < NUM_STATIC_ALLOCS; i++) {
+		MIPSGPReg cur = staticAllocs_[i].mr;
+		if (std::find(best, best + NUM_STATIC_ALLOCS - 1, cur) != best + NUM_STATIC_ALLOCS - 1)
+			continue;
+		for (MIPSGPReg r : best) {
+			bool taken = false;
+			for (int j = 1; j < NUM_STATIC_ALLOCS; j++)
+				taken = taken || staticAllocs_[j].mr == r;
+			// Only worth it if it's clearly hotter.
+			if (!taken && mapCounts_[r] > mapCounts_[cur] + mapCounts_[cur] / 4) {
+				staticAllocs_[i].mr = r;
+				changed = true;
+				break;
+			}
+		}
+	}
+
+	// Decay, so we follow the game as it moves between scenes.
+	for (int i = 0; i < 32; i++)
+		mapCounts_[i] /= 2;
+	return changed;
+}
+
 void Arm64RegCache::EmitLoadStaticRegisters() {
 	int count;
 	const StaticAllocation *allocs = GetStaticAllocations(count);
@@ -348,6 +397,8 @@ ARM64Reg Arm64RegCache::MapReg(MIPSGPReg mipsReg, int mapFlags) {
 		ERROR_LOG(JIT, "Cannot map invalid register");
 		return INVALID_REG;
 	}
+	if (mipsReg < 32)
+		mapCounts_[mipsReg]++;
 
 	ARM64Reg armReg = mr[mipsReg].reg;
 
@@ -140,6 +140,9 @@ class Arm64RegCache {
 	// These are called once on startup to generate functions, that you should then call.
 	void EmitLoadStaticRegisters();
 	void EmitSaveStaticRegisters();
+	// Picks the static registers again from how often each was mapped since the last call.
+	// Returns true if they changed, in which case all code (including the above) must be regenerated.
+	bool UpdateStaticAllocations();
 
 private:
 	struct StaticAllocation {
@@ -167,4 +170,11 @@ class Arm64RegCache {
 
 	RegARM64 ar[NUM_ARMREG];
 	RegMIPS mr[NUM_MIPSREG];
+
+	enum {
+		NUM_STATIC_ALLOCS = 5,
+	};
+	StaticAllocation staticAllocs_[NUM_STATIC_ALLOCS];
+	// How often each GPR was mapped while compiling, as a cheap profile of which are hot.
+	u32 mapCounts_[32]{};
 };
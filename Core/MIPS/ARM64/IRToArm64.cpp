@@ -0,0 +1,648 @@
+#include "ppsspp_config.h"
+#if PPSSPP_ARCH(ARM64)
+
+#include <cstddef>
+
+#include "Core/CoreTiming.h"
+#include "Core/MemMap.h"
+#include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/IR/IRInterpreter.h"
+#include "Core/MIPS/ARM64/IRToArm64.h"
+#include "Core/MIPS/ARM64/Arm64RegCache.h"
+
+namespace MIPSComp {
+
+using namespace Arm64Gen;
+using namespace Arm64JitConstants;
+
+// Same approach as IRToX86: every IR instruction loads its operands from MIPSState and
+// writes its result back, using W0-W2 and Q0/Q1 as scratch.  Ops that are rare or have
+// tricky semantics call back into the IR interpreter for that single instruction.
+
+alignas(16) static const float vec4InitValues[8][4] = {
+	{ 0.0f, 0.0f, 0.0f, 0.0f },
+	{ 1.0f, 1.0f, 1.0f, 1.0f },
+	{ -1.0f, -1.0f, -1.0f, -1.0f },
+	{ 1.0f, 0.0f, 0.0f, 0.0f },
+	{ 0.0f, 1.0f, 0.0f, 0.0f },
+	{ 0.0f, 0.0f, 1.0f, 0.0f },
+	{ 0.0f, 0.0f, 0.0f, 1.0f },
+};
+
+// CTXREG points at the MIPSState, so everything is at a small positive offset.
+// IR GPRs are indexed from r[0] and FPRs from f[0].
+static int IRGPROffset(int reg) {
+	return (int)offsetof(MIPSState, r[0]) + reg * 4;
+}
+
+static int IRFPROffset(int reg) {
+	return (int)offsetof(MIPSState, f[0]) + reg * 4;
+}
+
+#define MIPSSTATE_OFFSET(x) ((int)offsetof(MIPSState, x))
+
+IRToArm64::IRToArm64(MIPSState *mips) : mips_(mips), fp_(this) {
+	AllocCodeSpace(1024 * 1024 * 16);
+	GenerateFixedCode();
+}
+
+void IRToArm64::GenerateFixedCode() {
+	BeginWrite();
+	const u8 *start = AlignCode16();
+
+	enterBlock_ = (EnterBlockFunc)start;
+	// We only use caller saved FP registers, so no need to save those.
+	fp_.ABI_PushRegisters(ALL_CALLEE_SAVED, 0);
+	MOVP2R(MEMBASEREG, Memory::base);
+	MOVP2R(CTXREG, mips_);
+	BR(X0);
+
+	// Blocks jump here with the new PC in W0.
+	exitBlock_ = AlignCode16();
+	fp_.ABI_PopRegisters(ALL_CALLEE_SAVED, 0);
+	RET();
+
+	FlushIcache();
+	EndWrite();
+	fixedCodeSize_ = (int)GetOffset(GetCodePtr());
+}
+
+void IRToArm64::Clear() {
+	ClearCodeSpace(fixedCodeSize_);
+}
+
+bool IRToArm64::IsFull() const {
+	return GetSpaceLeft() < 0x10000;
+}
+
+const u8 *IRToArm64::ConvertIRToNative(const IRInst *instructions, int count) {
+	// Each IR instruction turns into at most a few dozen instructions.
+	if (GetSpaceLeft() < (size_t)count * 128 + 0x100)
+		return nullptr;
+
+	BeginWrite(count * 128);
+	const u8 *start = AlignCode16();
+
+	// Loop through all the instructions, emitting code as we go.
+	for (int i = 0; i < count; i++) {
+		if (!ConvertInst(instructions[i])) {
+			EmitFallback(instructions[i]);
+		}
+	}
+
+	// If we got here, the block was badly constructed (same as the interpreter.)
+	BRK(0);
+
+	FlushIcache();
+	EndWrite();
+	return start;
+}
+
+void IRToArm64::LoadGPR(ARM64Reg r, int reg) {
+	LDR(INDEX_UNSIGNED, r, CTXREG, IRGPROffset(reg));
+}
+
+void IRToArm64::StoreGPR(ARM64Reg r, int reg) {
+	STR(INDEX_UNSIGNED, r, CTXREG, IRGPROffset(reg));
+}
+
+void IRToArm64::LoadFPRBits(ARM64Reg r, int reg) {
+	LDR(INDEX_UNSIGNED, r, CTXREG, IRFPROffset(reg));
+}
+
+void IRToArm64::StoreFPRBits(ARM64Reg r, int reg) {
+	STR(INDEX_UNSIGNED, r, CTXREG, IRFPROffset(reg));
+}
+
+void IRToArm64::EmitAddress(const IRInst &inst) {
+	LoadGPR(W0, inst.src1);
+	if (inst.constant != 0)
+		ADDI2R(W0, W0, inst.constant, SCRATCH1);
+#ifdef MASKED_PSP_MEMORY
+	ANDI2R(W0, W0, Memory::MEMVIEW32_MASK, SCRATCH1);
+#endif
+}
+
+void IRToArm64::EmitExit() {
+	B(exitBlock_);
+}
+
+void IRToArm64::EmitConditionalExit(CCFlags skipCond, u32 target) {
+	FixupBranch skip = B(skipCond);
+	MOVI2R(W0, target);
+	EmitExit();
+	SetJumpTarget(skip);
+}
+
+void IRToArm64::EmitFallback(const IRInst &inst) {
+	MOVI2R(X0, IRPackInst(inst));
+	QuickCallFunction(SCRATCH1_64, &IRInterpretSingleInst);
+}
+
+void IRToArm64::EmitExitFallback(const IRInst &inst) {
+	MOVI2R(X0, IRPackInst(inst));
+	QuickCallFunction(SCRATCH1_64, &IRInterpretSingleExit);
+	EmitExit();
+}
+
+// Returns false if the op should be interpreted instead.
+bool IRToArm64::ConvertInst(const IRInst &inst) {
+	switch (inst.op) {
+	case IROp::Nop:
+		_assert_(false);
+		break;
+
+	case IROp::SetConst:
+		if (inst.constant == 0) {
+			StoreGPR(WZR, inst.dest);
+		} else {
+			MOVI2R(W0, inst.constant);
+			StoreGPR(W0, inst.dest);
+		}
+		break;
+	case IROp::SetConstF:
+		if (inst.constant == 0) {
+			StoreFPRBits(WZR, inst.dest);
+		} else {
+			MOVI2R(W0, inst.constant);
+			StoreFPRBits(W0, inst.dest);
+		}
+		break;
+
+	case IROp::Mov:
+		if (inst.dest != inst.src1) {
+			LoadGPR(W0, inst.src1);
+			StoreGPR(W0, inst.dest);
+		}
+		break;
+
+		// 3-op arithmetic that directly corresponds to ARM64.
+	case IROp::Add:
+	case IROp::Sub:
+	case IROp::And:
+	case IROp::Or:
+	case IROp::Xor:
+		LoadGPR(W0, inst.src1);
+		LoadGPR(W1, inst.src2);
+		switch (inst.op) {
+		case IROp::Add: ADD(W0, W0, W1); break;
+		case IROp::Sub: SUB(W0, W0, W1); break;
+		case IROp::And: AND(W0, W0, W1); break;
+		case IROp::Or: ORR(W0, W0, W1); break;
+		case IROp::Xor: EOR(W0, W0, W1); break;
+		default: break;
+		}
+		StoreGPR(W0, inst.dest);
+		break;
+
+	case IROp::AddConst:
+	case IROp::SubConst:
+	case IROp::AndConst:
+	case IROp::OrConst:
+	case IROp::XorConst:
+		LoadGPR(W0, inst.src1);
+		switch (inst.op) {
+		case IROp::AddConst: ADDI2R(W0, W0, inst.constant, SCRATCH1); break;
+		case IROp::SubConst: SUBI2R(W0, W0, inst.constant, SCRATCH1); break;
+		case IROp::AndConst: ANDI2R(W0, W0, inst.constant, SCRATCH1); break;
+		case IROp::OrConst: ORRI2R(W0, W0, inst.constant, SCRATCH1); break;
+		case IROp::XorConst: EORI2R(W0, W0, inst.constant, SCRATCH1); break;
+		default: break;
+		}
+		StoreGPR(W0, inst.dest);
+		break;
+
+	case IROp::Neg:
+	case IROp::Not:
+		LoadGPR(W0, inst.src1);
+		if (inst.op == IROp::Neg)
+			NEG(W0, W0);
+		else
+			MVN(W0, W0);
+		StoreGPR(W0, inst.dest);
+		break;
+
+		// Variable shifts.  ARM64 masks the count to 5 bits for 32-bit regs, same as MIPS.
+	case IROp::Shl:
+	case IROp::Shr:
+	case IROp::Sar:
+	case IROp::Ror:
+		LoadGPR(W0, inst.src1);
+		LoadGPR(W1, inst.src2);
+		switch (inst.op) {
+		case IROp::Shl: LSLV(W0, W0, W1); break;
+		case IROp::Shr: LSRV(W0, W0, W1); break;
+		case IROp::Sar: ASRV(W0, W0, W1); break;
+		case IROp::Ror: RORV(W0, W0, W1); break;
+		default: break;
+		}
+		StoreGPR(W0, inst.dest);
+		break;
+
+	case IROp::ShlImm:
+	case IROp::ShrImm:
+	case IROp::SarImm:
+	case IROp::RorImm:
+		LoadGPR(W0, inst.src1);
+		if (inst.src2 != 0) {
+			switch (inst.op) {
+			case IROp::ShlImm: LSL(W0, W0, inst.src2); break;
+			case IROp::ShrImm: LSR(W0, W0, inst.src2); break;
+			case IROp::SarImm: ASR(W0, W0, inst.src2); break;
+			case IROp::RorImm: ROR(W0, W0, inst.src2); break;
+			default: break;
+			}
+		}
+		StoreGPR(W0, inst.dest);
+		break;
+
+	case IROp::Slt:
+	case IROp::SltU:
+	case IROp::SltConst:
+	case IROp::SltUConst:
+		LoadGPR(W0, inst.src1);
+		if (inst.op == IROp::Slt || inst.op == IROp::SltU)
+			LoadGPR(W1, inst.src2);
+		else
+			MOVI2R(W1, inst.constant);
+		CMP(W0, W1);
+		CSET(W0, inst.op == IROp::Slt || inst.op == IROp::SltConst ? CC_LT : CC_LO);
+		StoreGPR(W0, inst.dest);
+		break;
+
+	case IROp::Clz:
+		// Unlike x86, this gives 32 for 0 already.
+		LoadGPR(W0, inst.src1);
+		CLZ(W0, W0);
+		StoreGPR(W0, inst.dest);
+		break;
+
+	case IROp::MovZ:
+	case IROp::MovNZ:
+		LoadGPR(W0, inst.dest);
+		LoadGPR(W1, inst.src1);
+		LoadGPR(W2, inst.src2);
+		CMP(W1, 0);
+		CSEL(W0, W2, W0, inst.op == IROp::MovZ ? CC_EQ : CC_NEQ);
+		StoreGPR(W0, inst.dest);
+		break;
+
+	case IROp::Max:
+	case IROp::Min:
+		LoadGPR(W0, inst.src1);
+		LoadGPR(W1, inst.src2);
+		CMP(W0, W1);
+		CSEL(W0, W0, W1, inst.op == IROp::Max ? CC_GT : CC_LT);
+		StoreGPR(W0, inst.dest);
+		break;
+
+	case IROp::BSwap16:
+	case IROp::BSwap32:
+		LoadGPR(W0, inst.src1);
+		if (inst.op == IROp::BSwap16)
+			REV16(W0, W0);
+		else
+			REV32(W0, W0);
+		StoreGPR(W0, inst.dest);
+		break;
+
+	case IROp::Ext8to32:
+	case IROp::Ext16to32:
+		LoadGPR(W0, inst.src1);
+		if (inst.op == IROp::Ext8to32)
+			SXTB(W0, W0);
+		else
+			SXTH(W0, W0);
+		StoreGPR(W0, inst.dest);
+		break;
+
+		// Multiplier control
+	case IROp::MtLo:
+		LoadGPR(W0, inst.src1);
+		STR(INDEX_UNSIGNED, W0, CTXREG, MIPSSTATE_OFFSET(lo));
+		break;
+	case IROp::MtHi:
+		LoadGPR(W0, inst.src1);
+		STR(INDEX_UNSIGNED, W0, CTXREG, MIPSSTATE_OFFSET(hi));
+		break;
+	case IROp::MfLo:
+		LDR(INDEX_UNSIGNED, W0, CTXREG, MIPSSTATE_OFFSET(lo));
+		StoreGPR(W0, inst.dest);
+		break;
+	case IROp::MfHi:
+		LDR(INDEX_UNSIGNED, W0, CTXREG, MIPSSTATE_OFFSET(hi));
+		StoreGPR(W0, inst.dest);
+		break;
+
+		// lo and hi are adjacent and 64-bit aligned, so we can treat them as a single 64-bit value.
+	case IROp::Mult:
+	case IROp::Madd:
+	case IROp::Msub:
+		LoadGPR(W0, inst.src1);
+		LoadGPR(W1, inst.src2);
+		if (inst.op == IROp::Mult) {
+			SMULL(X0, W0, W1);
+		} else {
+			LDR(INDEX_UNSIGNED, X2, CTXREG, MIPSSTATE_OFFSET(lo));
+			if (inst.op == IROp::Madd)
+				SMADDL(X0, W0, W1, X2);
+			else
+				SMSUBL(X0, W0, W1, X2);
+		}
+		STR(INDEX_UNSIGNED, X0, CTXREG, MIPSSTATE_OFFSET(lo));
+		break;
+	case IROp::MultU:
+	case IROp::MaddU:
+	case IROp::MsubU:
+		LoadGPR(W0, inst.src1);
+		LoadGPR(W1, inst.src2);
+		UMULL(X0, W0, W1);
+		if (inst.op != IROp::MultU) {
+			LDR(INDEX_UNSIGNED, X2, CTXREG, MIPSSTATE_OFFSET(lo));
+			if (inst.op == IROp::MaddU)
+				ADD(X0, X2, X0);
+			else
+				SUB(X0, X2, X0);
+		}
+		STR(INDEX_UNSIGNED, X0, CTXREG, MIPSSTATE_OFFSET(lo));
+		break;
+
+		// Memory access.  Writing W0 clears the top of X0, so it can be used as the offset.
+	case IROp::Load8:
+	case IROp::Load8Ext:
+	case IROp::Load16:
+	case IROp::Load16Ext:
+	case IROp::Load32:
+	case IROp::LoadFloat:
+		EmitAddress(inst);
+		switch (inst.op) {
+		case IROp::Load8: LDRB(W1, MEMBASEREG, ArithOption(X0)); break;
+		case IROp::Load8Ext: LDRSB(W1, MEMBASEREG, ArithOption(X0)); break;
+		case IROp::Load16: LDRH(W1, MEMBASEREG, ArithOption(X0)); break;
+		case IROp::Load16Ext: LDRSH(W1, MEMBASEREG, ArithOption(X0)); break;
+		default: LDR(W1, MEMBASEREG, ArithOption(X0)); break;
+		}
+		if (inst.op == IROp::LoadFloat)
+			StoreFPRBits(W1, inst.dest);
+		else
+			StoreGPR(W1, inst.dest);
+		break;
+
+	case IROp::Store8:
+	case IROp::Store16:
+	case IROp::Store32:
+	case IROp::StoreFloat:
+		EmitAddress(inst);
+		if (inst.op == IROp::StoreFloat)
+			LoadFPRBits(W1, inst.src3);
+		else
+			LoadGPR(W1, inst.src3);
+		switch (inst.op) {
+		case IROp::Store8: STRB(W1, MEMBASEREG, ArithOption(X0)); break;
+		case IROp::Store16: STRH(W1, MEMBASEREG, ArithOption(X0)); break;
+		default: STR(W1, MEMBASEREG, ArithOption(X0)); break;
+		}
+		break;
+
+	case IROp::LoadVec4:
+		EmitAddress(inst);
+		fp_.LDR(128, Q0, MEMBASEREG, ArithOption(X0));
+		fp_.STR(128, INDEX_UNSIGNED, Q0, CTXREG, IRFPROffset(inst.dest));
+		break;
+	case IROp::StoreVec4:
+		EmitAddress(inst);
+		fp_.LDR(128, INDEX_UNSIGNED, Q0, CTXREG, IRFPROffset(inst.dest));
+		fp_.STR(128, Q0, MEMBASEREG, ArithOption(X0));
+		break;
+
+		// Output-only SIMD functions
+	case IROp::Vec4Init:
+		MOVP2R(X1, vec4InitValues[inst.src1]);
+		fp_.LDR(128, INDEX_UNSIGNED, Q0, X1, 0);
+		fp_.STR(128, INDEX_UNSIGNED, Q0, CTXREG, IRFPROffset(inst.dest));
+		break;
+
+		// 2-op SIMD functions
+	case IROp::Vec4Mov:
+	case IROp::Vec4Neg:
+	case IROp::Vec4Abs:
+	case IROp::Vec4ClampToZero:
+		fp_.LDR(128, INDEX_UNSIGNED, Q0, CTXREG, IRFPROffset(inst.src1));
+		switch (inst.op) {
+		case IROp::Vec4Neg: fp_.FNEG(32, Q0, Q0); break;
+		case IROp::Vec4Abs: fp_.FABS(32, Q0, Q0); break;
+		case IROp::Vec4ClampToZero:
+			// Expand the sign bit, and use it to zero negative values.
+			fp_.SSHR(32, Q1, Q0, 31);
+			fp_.NOT(Q1, Q1);
+			fp_.AND(Q0, Q0, Q1);
+			break;
+		default: break;
+		}
+		fp_.STR(128, INDEX_UNSIGNED, Q0, CTXREG, IRFPROffset(inst.dest));
+		break;
+
+		// 3-op SIMD functions
+	case IROp::Vec4Add:
+	case IROp::Vec4Sub:
+	case IROp::Vec4Mul:
+	case IROp::Vec4Div:
+		fp_.LDR(128, INDEX_UNSIGNED, Q0, CTXREG, IRFPROffset(inst.src1));
+		fp_.LDR(128, INDEX_UNSIGNED, Q1, CTXREG, IRFPROffset(inst.src2));
+		switch (inst.op) {
+		case IROp::Vec4Add: fp_.FADD(32, Q0, Q0, Q1); break;
+		case IROp::Vec4Sub: fp_.FSUB(32, Q0, Q0, Q1); break;
+		case IROp::Vec4Mul: fp_.FMUL(32, Q0, Q0, Q1); break;
+		case IROp::Vec4Div: fp_.FDIV(32, Q0, Q0, Q1); break;
+		default: break;
+		}
+		fp_.STR(128, INDEX_UNSIGNED, Q0, CTXREG, IRFPROffset(inst.dest));
+		break;
+
+	case IROp::Vec4Scale:
+		fp_.LDR(128, INDEX_UNSIGNED, Q0, CTXREG, IRFPROffset(inst.src1));
+		fp_.LDR(32, INDEX_UNSIGNED, S1, CTXREG, IRFPROffset(inst.src2));
+		fp_.FMUL(32, Q0, Q0, Q1, 0);
+		fp_.STR(128, INDEX_UNSIGNED, Q0, CTXREG, IRFPROffset(inst.dest));
+		break;
+
+	case IROp::Vec4Dot:
+		// Sum in the same order as the interpreter, so results are identical.
+		fp_.LDR(128, INDEX_UNSIGNED, Q0, CTXREG, IRFPROffset(inst.src1));
+		fp_.LDR(128, INDEX_UNSIGNED, Q1, CTXREG, IRFPROffset(inst.src2));
+		fp_.FMUL(32, Q0, Q0, Q1);
+		for (int lane = 1; lane < 4; ++lane) {
+			fp_.DUP(32, Q1, Q0, lane);
+			fp_.FADD(S0, S0, S1);
+		}
+		fp_.STR(32, INDEX_UNSIGNED, S0, CTXREG, IRFPROffset(inst.dest));
+		break;
+
+		// 3-Op FP
+	case IROp::FAdd:
+	case IROp::FSub:
+	case IROp::FMul:
+	case IROp::FDiv:
+		fp_.LDR(32, INDEX_UNSIGNED, S0, CTXREG, IRFPROffset(inst.src1));
+		fp_.LDR(32, INDEX_UNSIGNED, S1, CTXREG, IRFPROffset(inst.src2));
+		switch (inst.op) {
+		case IROp::FAdd: fp_.FADD(S0, S0, S1); break;
+		case IROp::FSub: fp_.FSUB(S0, S0, S1); break;
+		case IROp::FMul: fp_.FMUL(S0, S0, S1); break;
+		case IROp::FDiv: fp_.FDIV(S0, S0, S1); break;
+		default: break;
+		}
+		fp_.STR(32, INDEX_UNSIGNED, S0, CTXREG, IRFPROffset(inst.dest));
+		break;
+
+		// 2-Op FP, done on the bits to match the interpreter exactly.
+	case IROp::FMov:
+	case IROp::FAbs:
+	case IROp::FNeg:
+		LoadFPRBits(W0, inst.src1);
+		if (inst.op == IROp::FAbs)
+			ANDI2R(W0, W0, 0x7FFFFFFF, SCRATCH1);
+		else if (inst.op == IROp::FNeg)
+			EORI2R(W0, W0, 0x80000000, SCRATCH1);
+		StoreFPRBits(W0, inst.dest);
+		break;
+	case IROp::FSqrt:
+	case IROp::FCvtSW:
+		fp_.LDR(32, INDEX_UNSIGNED, S0, CTXREG, IRFPROffset(inst.src1));
+		if (inst.op == IROp::FSqrt)
+			fp_.FSQRT(S0, S0);
+		else
+			fp_.SCVTF(S0, S0);
+		fp_.STR(32, INDEX_UNSIGNED, S0, CTXREG, IRFPROffset(inst.dest));
+		break;
+
+		// Cross moves
+	case IROp::FMovFromGPR:
+		LoadGPR(W0, inst.src1);
+		StoreFPRBits(W0, inst.dest);
+		break;
+	case IROp::FMovToGPR:
+		LoadFPRBits(W0, inst.src1);
+		StoreGPR(W0, inst.dest);
+		break;
+	case IROp::FpCondToReg:
+		LDR(INDEX_UNSIGNED, W0, CTXREG, MIPSSTATE_OFFSET(fpcond));
+		StoreGPR(W0, inst.dest);
+		break;
+	case IROp::VfpuCtrlToReg:
+		LDR(INDEX_UNSIGNED, W0, CTXREG, MIPSSTATE_OFFSET(vfpuCtrl[0]) + inst.src1 * 4);
+		StoreGPR(W0, inst.dest);
+		break;
+
+		// VFPU flag/control
+	case IROp::SetCtrlVFPU:
+		MOVI2R(W0, inst.constant);
+		STR(INDEX_UNSIGNED, W0, CTXREG, MIPSSTATE_OFFSET(vfpuCtrl[0]) + inst.dest * 4);
+		break;
+	case IROp::SetCtrlVFPUReg:
+		LoadGPR(W0, inst.src1);
+		STR(INDEX_UNSIGNED, W0, CTXREG, MIPSSTATE_OFFSET(vfpuCtrl[0]) + inst.dest * 4);
+		break;
+	case IROp::SetCtrlVFPUFReg:
+		LoadFPRBits(W0, inst.src1);
+		STR(INDEX_UNSIGNED, W0, CTXREG, MIPSSTATE_OFFSET(vfpuCtrl[0]) + inst.dest * 4);
+		break;
+	case IROp::ZeroFpCond:
+		STR(INDEX_UNSIGNED, WZR, CTXREG, MIPSSTATE_OFFSET(fpcond));
+		break;
+
+		// Block Exits
+	case IROp::ExitToConst:
+		MOVI2R(W0, inst.constant);
+		EmitExit();
+		break;
+	case IROp::ExitToReg:
+		LoadGPR(W0, inst.src1);
+		EmitExit();
+		break;
+	case IROp::ExitToPC:
+		LDR(INDEX_UNSIGNED, W0, CTXREG, MIPSSTATE_OFFSET(pc));
+		EmitExit();
+		break;
+	case IROp::ExitToConstIfEq:
+	case IROp::ExitToConstIfNeq:
+		LoadGPR(W0, inst.src1);
+		LoadGPR(W1, inst.src2);
+		CMP(W0, W1);
+		EmitConditionalExit(inst.op == IROp::ExitToConstIfEq ? CC_NEQ : CC_EQ, inst.constant);
+		break;
+	case IROp::ExitToConstIfGtZ:
+	case IROp::ExitToConstIfGeZ:
+	case IROp::ExitToConstIfLtZ:
+	case IROp::ExitToConstIfLeZ:
+	{
+		CCFlags skipCond = CC_GT;
+		switch (inst.op) {
+		case IROp::ExitToConstIfGtZ: skipCond = CC_LE; break;
+		case IROp::ExitToConstIfGeZ: skipCond = CC_LT; break;
+		case IROp::ExitToConstIfLtZ: skipCond = CC_GE; break;
+		default: break;
+		}
+		LoadGPR(W0, inst.src1);
+		CMP(W0, 0);
+		EmitConditionalExit(skipCond, inst.constant);
+		break;
+	}
+	case IROp::Break:
+		EmitExitFallback(inst);
+		break;
+
+		// Utilities
+	case IROp::Downcount:
+		LDR(INDEX_UNSIGNED, W0, CTXREG, MIPSSTATE_OFFSET(downcount));
+		SUBI2R(W0, W0, inst.constant, SCRATCH1);
+		STR(INDEX_UNSIGNED, W0, CTXREG, MIPSSTATE_OFFSET(downcount));
+		break;
+	case IROp::SetPC:
+		LoadGPR(W0, inst.src1);
+		STR(INDEX_UNSIGNED, W0, CTXREG, MIPSSTATE_OFFSET(pc));
+		break;
+	case IROp::SetPCConst:
+		MOVI2R(W0, inst.constant);
+		STR(INDEX_UNSIGNED, W0, CTXREG, MIPSSTATE_OFFSET(pc));
+		break;
+
+	case IROp::Breakpoint:
+	case IROp::MemoryCheck:
+	{
+		if (inst.op == IROp::Breakpoint) {
+			LDR(INDEX_UNSIGNED, W0, CTXREG, MIPSSTATE_OFFSET(pc));
+			QuickCallFunction(SCRATCH1_64, &RunBreakpoint);
+		} else {
+			LoadGPR(W1, inst.src1);
+			if (inst.constant != 0)
+				ADDI2R(W1, W1, inst.constant, SCRATCH1);
+			LDR(INDEX_UNSIGNED, W0, CTXREG, MIPSSTATE_OFFSET(pc));
+			QuickCallFunction(SCRATCH1_64, &RunMemCheck);
+		}
+		FixupBranch skip = CBZ(W0);
+		QuickCallFunction(SCRATCH1_64, &CoreTiming::ForceCheck);
+		LDR(INDEX_UNSIGNED, W0, CTXREG, MIPSSTATE_OFFSET(pc));
+		EmitExit();
+		SetJumpTarget(skip);
+		break;
+	}
+
+		// Rounding mode changes are not implemented by the interpreter either.
+	case IROp::ApplyRoundingMode:
+	case IROp::RestoreRoundingMode:
+	case IROp::UpdateRoundingMode:
+		break;
+
+	default:
+		// Div, unaligned memory ops, FP rounding and compares, VFPU packing, shuffles and
+		// transcendentals, and system ops like Syscall and Interpret go through the interpreter.
+		return false;
+	}
+
+	return true;
+}
+
+}  // namespace
+
+#endif // PPSSPP_ARCH(ARM64)
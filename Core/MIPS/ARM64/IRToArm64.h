@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Core/MIPS/IR/IRInst.h"
+#include "Core/MIPS/IR/IRNative.h"
+#include "Common/Arm64Emitter.h"
+
+class MIPSState;
+
+namespace MIPSComp {
+
+// Converts optimized IR blocks (after IRApplyPasses) to ARM64 code, same as IRToX86 does for x64.
+// MIPS state stays in MIPSState between IR instructions, so no register allocation yet.
+class IRToArm64 : public IRToNativeInterface, public Arm64Gen::ARM64CodeBlock {
+public:
+	IRToArm64(MIPSState *mips);
+
+	const u8 *ConvertIRToNative(const IRInst *instructions, int count) override;
+	u32 RunBlock(const u8 *entry) override {
+		return enterBlock_(entry);
+	}
+	void Clear() override;
+	bool IsFull() const override;
+
+private:
+	void GenerateFixedCode();
+	bool ConvertInst(const IRInst &inst);
+
+	void LoadGPR(Arm64Gen::ARM64Reg r, int reg);
+	void StoreGPR(Arm64Gen::ARM64Reg r, int reg);
+	void LoadFPRBits(Arm64Gen::ARM64Reg r, int reg);
+	void StoreFPRBits(Arm64Gen::ARM64Reg r, int reg);
+
+	void EmitAddress(const IRInst &inst);
+	void EmitExit();
+	void EmitConditionalExit(CCFlags skipCond, u32 target);
+	void EmitFallback(const IRInst &inst);
+	void EmitExitFallback(const IRInst &inst);
+
+	typedef u32 (*EnterBlockFunc)(const u8 *entry);
+
+	MIPSState *mips_;
+	Arm64Gen::ARM64FloatEmitter fp_;
+	EnterBlockFunc enterBlock_ = nullptr;
+	const u8 *exitBlock_ = nullptr;
+	int fixedCodeSize_ = 0;
+};
+
+}  // namespace
@@ -52,6 +52,38 @@ using namespace MIPSAnalyst;
 namespace MIPSComp
 {
 
+bool IRFrontend::PredictTakeBranch(u32 targetAddr, bool likely) {
+	// If it's likely, it's... probably likely, right?
+	if (likely)
+		return true;
+	// Same as the other jits, which found this better than predicting backward branches taken.
+	return targetAddr > GetCompilerPC();
+}
+
+bool IRFrontend::CanContinueBranch(u32 targetAddr) {
+	if (!opts.continueBranches || js.numInstructions >= opts.continueMaxInstructions)
+		return false;
+	// Only go forward past the delay slot, so the block still covers one contiguous range.
+	// That keeps invalidation and hashing working, at the cost of covering some skipped code.
+	if (targetAddr <= GetCompilerPC() + 4)
+		return false;
+	return (targetAddr - js.blockStart) / 4 < (u32)opts.continueMaxInstructions;
+}
+
+bool IRFrontend::CanContinueJump(u32 targetAddr) {
+	if (!opts.continueJumps || js.numInstructions >= opts.continueMaxInstructions)
+		return false;
+	if (targetAddr <= GetCompilerPC() + 4)
+		return false;
+	return (targetAddr - js.blockStart) / 4 < (u32)opts.continueMaxInstructions;
+}
+
+void IRFrontend::ContinueAt(u32 targetAddr) {
+	// Account for the increment in the loop.
+	js.compilerPC = targetAddr - 4;
+	js.compiling = true;
+}
+
 void IRFrontend::BranchRSRTComp(MIPSOpcode op, IRComparison cc, bool likely) {
 	if (js.inDelaySlot) {
 		ERROR_LOG_REPORT(JIT, "Branch in RSRTComp delay slot at %08x in block starting at %08x", GetCompilerPC(), js.blockStart);
@@ -96,12 +128,25 @@ void IRFrontend::BranchRSRTComp(MIPSOpcode op, IRComparison cc, bool likely) {
 	js.downcountAmount = 0;
 
 	FlushAll();
+	bool predictTaken = PredictTakeBranch(targetAddr, likely);
+	if (!predictTaken && CanContinueBranch(GetCompilerPC() + 8)) {
+		// Leave through a side exit when taken, and keep going.
+		ir.Write(ComparisonToExit(Invert(cc)), ir.AddConstant(targetAddr), lhs, rhs);
+		// Account for the delay slot.
+		js.compilerPC += 4;
+		return;
+	}
+
 	ir.Write(ComparisonToExit(cc), ir.AddConstant(GetCompilerPC() + 8), lhs, rhs);
 	// This makes the block "impure" :(
 	if (likely)
 		CompileDelaySlot();
 
 	FlushAll();
+	if (predictTaken && CanContinueBranch(targetAddr)) {
+		ContinueAt(targetAddr);
+		return;
+	}
 	ir.Write(IROp::ExitToConst, ir.AddConstant(targetAddr));
 
 	// Account for the delay slot.
@@ -137,11 +182,24 @@ void IRFrontend::BranchRSZeroComp(MIPSOpcode op, IRComparison cc, bool andLink,
 	js.downcountAmount = 0;
 
 	FlushAll();
+	bool predictTaken = PredictTakeBranch(targetAddr, likely);
+	if (!predictTaken && CanContinueBranch(GetCompilerPC() + 8)) {
+		ir.Write(ComparisonToExit(Invert(cc)), ir.AddConstant(targetAddr), lhs);
+		// Account for the delay slot.
+		js.compilerPC += 4;
+		return;
+	}
+
 	ir.Write(ComparisonToExit(cc), ir.AddConstant(GetCompilerPC() + 8), lhs);
 	if (likely)
 		CompileDelaySlot();
 	// Taken
 	FlushAll();
+	// Don't follow calls, the return would end up outside the block.
+	if (!andLink && predictTaken && CanContinueBranch(targetAddr)) {
+		ContinueAt(targetAddr);
+		return;
+	}
 	ir.Write(IROp::ExitToConst, ir.AddConstant(targetAddr));
 
 	// Account for the delay slot.
@@ -204,12 +262,24 @@ void IRFrontend::BranchFPFlag(MIPSOpcode op, IRComparison cc, bool likely) {
 	js.downcountAmount = 0;
 
 	FlushAll();
+	bool predictTaken = PredictTakeBranch(targetAddr, likely);
+	if (!predictTaken && CanContinueBranch(GetCompilerPC() + 8)) {
+		ir.Write(ComparisonToExit(Invert(cc)), ir.AddConstant(targetAddr), IRTEMP_LHS, 0);
+		// Account for the delay slot.
+		js.compilerPC += 4;
+		return;
+	}
+
 	// Not taken
 	ir.Write(ComparisonToExit(cc), ir.AddConstant(GetCompilerPC() + 8), IRTEMP_LHS, 0);
 	// Taken
 	if (likely)
 		CompileDelaySlot();
 	FlushAll();
+	if (predictTaken && CanContinueBranch(targetAddr)) {
+		ContinueAt(targetAddr);
+		return;
+	}
 	ir.Write(IROp::ExitToConst, ir.AddConstant(targetAddr));
 
 	// Account for the delay slot.
@@ -261,6 +331,15 @@ void IRFrontend::BranchVFPUFlag(MIPSOpcode op, IRComparison cc, bool likely) {
 
 	ir.Write(IROp::AndConst, IRTEMP_LHS, IRTEMP_LHS, ir.AddConstant(1 << imm3));
 	FlushAll();
+	// With a branch in the delay slot, let the usual path sort it out.
+	bool predictTaken = PredictTakeBranch(targetAddr, likely);
+	if (!delaySlotIsBranch && !predictTaken && CanContinueBranch(notTakenTarget)) {
+		ir.Write(ComparisonToExit(Invert(cc)), ir.AddConstant(targetAddr), IRTEMP_LHS, 0);
+		// Account for the delay slot.
+		js.compilerPC += 4;
+		return;
+	}
+
 	ir.Write(ComparisonToExit(cc), ir.AddConstant(notTakenTarget), IRTEMP_LHS, 0);
 
 	if (likely)
@@ -268,6 +347,10 @@ void IRFrontend::BranchVFPUFlag(MIPSOpcode op, IRComparison cc, bool likely) {
 
 	// Taken
 	FlushAll();
+	if (!delaySlotIsBranch && predictTaken && CanContinueBranch(targetAddr)) {
+		ContinueAt(targetAddr);
+		return;
+	}
 	ir.Write(IROp::ExitToConst, ir.AddConstant(targetAddr));
 
 	// Account for the delay slot.
@@ -325,6 +408,10 @@ void IRFrontend::Comp_Jump(MIPSOpcode op) {
 	js.downcountAmount = 0;
 
 	FlushAll();
+	if ((op >> 26) == 2 && CanContinueJump(targetAddr)) {
+		ContinueAt(targetAddr);
+		return;
+	}
 	ir.Write(IROp::ExitToConst, ir.AddConstant(targetAddr));
 
 	// Account for the delay slot.
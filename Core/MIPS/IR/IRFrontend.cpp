@@ -23,6 +23,7 @@
 #include "Core/Reporting.h"
 #include "Core/HLE/ReplaceTables.h"
 #include "Core/MemMap.h"
+#include "Core/MIPS/MIPSAnalyst.h"
 #include "Core/MIPS/MIPSTables.h"
 #include "Core/MIPS/IR/IRFrontend.h"
 #include "Core/MIPS/IR/IRRegCache.h"
@@ -259,6 +260,15 @@ void IRFrontend::DoJit(u32 em_address, std::vector<IRInst> &instructions, u32 &m
 	IRWriter simplified;
 	IRWriter *code = &ir;
 	if (!js.hadBreakpoints) {
+		IROptions blockOpts = opts;
+		blockOpts.numEntryConstants = 0;
+		if ((opts.disableFlags & (uint32_t)JitDisable::FUNCTION_CONSTANTS) == 0) {
+			MIPSGPReg regs[ARRAY_SIZE(blockOpts.entryConstantRegs)];
+			blockOpts.numEntryConstants = MIPSAnalyst::GetFunctionEntryConstants(em_address, regs, blockOpts.entryConstantValues, ARRAY_SIZE(regs));
+			for (int i = 0; i < blockOpts.numEntryConstants; ++i)
+				blockOpts.entryConstantRegs[i] = (u8)regs[i];
+		}
+
 		static const IRPassFunc passes[] = {
 			&RemoveLoadStoreLeftRight,
 			&OptimizeFPMoves,
@@ -268,7 +278,7 @@ void IRFrontend::DoJit(u32 em_address, std::vector<IRInst> &instructions, u32 &m
 			// &MergeLoadStore,
 			// &ThreeOpToTwoOp,
 		};
-		if (IRApplyPasses(passes, ARRAY_SIZE(passes), ir, simplified, opts))
+		if (IRApplyPasses(passes, ARRAY_SIZE(passes), ir, simplified, blockOpts))
 			logBlocks = 1;
 		code = &simplified;
 		//if (ir.GetInstructions().size() >= 24)
@@ -111,6 +111,11 @@ class IRFrontend : public MIPSFrontendInterface {
 	void EatInstruction(MIPSOpcode op);
 	MIPSOpcode GetOffsetInstruction(int offset);
 
+	bool PredictTakeBranch(u32 targetAddr, bool likely);
+	bool CanContinueBranch(u32 targetAddr);
+	bool CanContinueJump(u32 targetAddr);
+	void ContinueAt(u32 targetAddr);
+
 	void CheckBreakpoint(u32 addr);
 	void CheckMemoryBreakpoint(int rs, int offset);
 
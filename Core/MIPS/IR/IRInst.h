@@ -238,7 +238,6 @@ enum class Vec4Init {
 	Set_0001,
 };
 
-// Hm, unused
 inline IRComparison Invert(IRComparison comp) {
 	switch (comp) {
 	case IRComparison::Equal: return IRComparison::NotEqual;
@@ -371,6 +370,14 @@ class IRWriter {
 struct IROptions {
 	uint32_t disableFlags;
 	bool unalignedLoadStore;
+	// Keep compiling along predicted branches and jumps, leaving side exits for the other path.
+	bool continueBranches;
+	bool continueJumps;
+	int continueMaxInstructions;
+	// Set per block: GPRs that already hold these values on entry, no need to write them.
+	int numEntryConstants;
+	u8 entryConstantRegs[8];
+	u32 entryConstantValues[8];
 };
 
 const IRMeta *GetIRMeta(IROp op);
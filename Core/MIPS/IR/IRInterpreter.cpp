@@ -30,6 +30,7 @@
 #include "Core/MIPS/MIPSVFPUUtils.h"
 #include "Core/MIPS/IR/IRInst.h"
 #include "Core/MIPS/IR/IRInterpreter.h"
+#include "Core/MIPS/IR/IRNative.h"
 #include "Core/System.h"
 
 alignas(16) static const float vec4InitValues[8][4] = {
@@ -72,85 +73,254 @@ u32 RunMemCheck(u32 pc, u32 addr) {
 	return coreState != CORE_RUNNING ? 1 : 0;
 }
 
+// With GCC and clang, each op jumps straight to the next op's handler (computed goto) instead of
+// going back through the switch.  That gives every op its own indirect branch to predict.
+#if defined(__GNUC__) || defined(__clang__)
+#define IR_THREADED_DISPATCH
+#endif
+
+#ifdef IR_THREADED_DISPATCH
+#define IR_CASE(name) case IROp::name: op_##name
+#define IR_DEFAULT default: op_default
+#define IR_TABLE_ENTRY(name) dispatchTable[(int)IROp::name] = &&op_##name
+#else
+#define IR_CASE(name) case IROp::name
+#define IR_DEFAULT default
+#endif
+
 // We cannot use NEON on ARM32 here until we make it a hard dependency. We can, however, on ARM64.
 u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 	const IRInst *end = inst + count;
+#ifdef IR_THREADED_DISPATCH
+	static const void *dispatchTable[256];
+	static bool dispatchTableReady = false;
+	if (!dispatchTableReady) {
+		for (int i = 0; i < 256; ++i)
+			dispatchTable[i] = &&op_default;
+		IR_TABLE_ENTRY(Nop);
+		IR_TABLE_ENTRY(SetConst);
+		IR_TABLE_ENTRY(SetConstF);
+		IR_TABLE_ENTRY(Add);
+		IR_TABLE_ENTRY(Sub);
+		IR_TABLE_ENTRY(And);
+		IR_TABLE_ENTRY(Or);
+		IR_TABLE_ENTRY(Xor);
+		IR_TABLE_ENTRY(Mov);
+		IR_TABLE_ENTRY(AddConst);
+		IR_TABLE_ENTRY(SubConst);
+		IR_TABLE_ENTRY(AndConst);
+		IR_TABLE_ENTRY(OrConst);
+		IR_TABLE_ENTRY(XorConst);
+		IR_TABLE_ENTRY(Neg);
+		IR_TABLE_ENTRY(Not);
+		IR_TABLE_ENTRY(Ext8to32);
+		IR_TABLE_ENTRY(Ext16to32);
+		IR_TABLE_ENTRY(ReverseBits);
+		IR_TABLE_ENTRY(Load8);
+		IR_TABLE_ENTRY(Load8Ext);
+		IR_TABLE_ENTRY(Load16);
+		IR_TABLE_ENTRY(Load16Ext);
+		IR_TABLE_ENTRY(Load32);
+		IR_TABLE_ENTRY(Load32Left);
+		IR_TABLE_ENTRY(Load32Right);
+		IR_TABLE_ENTRY(LoadFloat);
+		IR_TABLE_ENTRY(Store8);
+		IR_TABLE_ENTRY(Store16);
+		IR_TABLE_ENTRY(Store32);
+		IR_TABLE_ENTRY(Store32Left);
+		IR_TABLE_ENTRY(Store32Right);
+		IR_TABLE_ENTRY(StoreFloat);
+		IR_TABLE_ENTRY(LoadVec4);
+		IR_TABLE_ENTRY(StoreVec4);
+		IR_TABLE_ENTRY(Vec4Init);
+		IR_TABLE_ENTRY(Vec4Shuffle);
+		IR_TABLE_ENTRY(Vec4Mov);
+		IR_TABLE_ENTRY(Vec4Add);
+		IR_TABLE_ENTRY(Vec4Sub);
+		IR_TABLE_ENTRY(Vec4Mul);
+		IR_TABLE_ENTRY(Vec4Div);
+		IR_TABLE_ENTRY(Vec4Scale);
+		IR_TABLE_ENTRY(Vec4Neg);
+		IR_TABLE_ENTRY(Vec4Abs);
+		IR_TABLE_ENTRY(Vec2Unpack16To31);
+		IR_TABLE_ENTRY(Vec2Unpack16To32);
+		IR_TABLE_ENTRY(Vec4Unpack8To32);
+		IR_TABLE_ENTRY(Vec2Pack32To16);
+		IR_TABLE_ENTRY(Vec2Pack31To16);
+		IR_TABLE_ENTRY(Vec4Pack32To8);
+		IR_TABLE_ENTRY(Vec4Pack31To8);
+		IR_TABLE_ENTRY(Vec2ClampToZero);
+		IR_TABLE_ENTRY(Vec4ClampToZero);
+		IR_TABLE_ENTRY(Vec4DuplicateUpperBitsAndShift1);
+		IR_TABLE_ENTRY(FCmpVfpuBit);
+		IR_TABLE_ENTRY(FCmpVfpuAggregate);
+		IR_TABLE_ENTRY(FCmovVfpuCC);
+		IR_TABLE_ENTRY(Vec4Dot);
+		IR_TABLE_ENTRY(FSin);
+		IR_TABLE_ENTRY(FCos);
+		IR_TABLE_ENTRY(FRSqrt);
+		IR_TABLE_ENTRY(FRecip);
+		IR_TABLE_ENTRY(FAsin);
+		IR_TABLE_ENTRY(ShlImm);
+		IR_TABLE_ENTRY(ShrImm);
+		IR_TABLE_ENTRY(SarImm);
+		IR_TABLE_ENTRY(RorImm);
+		IR_TABLE_ENTRY(Shl);
+		IR_TABLE_ENTRY(Shr);
+		IR_TABLE_ENTRY(Sar);
+		IR_TABLE_ENTRY(Ror);
+		IR_TABLE_ENTRY(Clz);
+		IR_TABLE_ENTRY(Slt);
+		IR_TABLE_ENTRY(SltU);
+		IR_TABLE_ENTRY(SltConst);
+		IR_TABLE_ENTRY(SltUConst);
+		IR_TABLE_ENTRY(MovZ);
+		IR_TABLE_ENTRY(MovNZ);
+		IR_TABLE_ENTRY(Max);
+		IR_TABLE_ENTRY(Min);
+		IR_TABLE_ENTRY(MtLo);
+		IR_TABLE_ENTRY(MtHi);
+		IR_TABLE_ENTRY(MfLo);
+		IR_TABLE_ENTRY(MfHi);
+		IR_TABLE_ENTRY(Mult);
+		IR_TABLE_ENTRY(MultU);
+		IR_TABLE_ENTRY(Madd);
+		IR_TABLE_ENTRY(MaddU);
+		IR_TABLE_ENTRY(Msub);
+		IR_TABLE_ENTRY(MsubU);
+		IR_TABLE_ENTRY(Div);
+		IR_TABLE_ENTRY(DivU);
+		IR_TABLE_ENTRY(BSwap16);
+		IR_TABLE_ENTRY(BSwap32);
+		IR_TABLE_ENTRY(FAdd);
+		IR_TABLE_ENTRY(FSub);
+		IR_TABLE_ENTRY(FMul);
+		IR_TABLE_ENTRY(FDiv);
+		IR_TABLE_ENTRY(FMin);
+		IR_TABLE_ENTRY(FMax);
+		IR_TABLE_ENTRY(FMov);
+		IR_TABLE_ENTRY(FAbs);
+		IR_TABLE_ENTRY(FSqrt);
+		IR_TABLE_ENTRY(FNeg);
+		IR_TABLE_ENTRY(FSat0_1);
+		IR_TABLE_ENTRY(FSatMinus1_1);
+		IR_TABLE_ENTRY(FSign);
+		IR_TABLE_ENTRY(FpCondToReg);
+		IR_TABLE_ENTRY(VfpuCtrlToReg);
+		IR_TABLE_ENTRY(FRound);
+		IR_TABLE_ENTRY(FTrunc);
+		IR_TABLE_ENTRY(FCeil);
+		IR_TABLE_ENTRY(FFloor);
+		IR_TABLE_ENTRY(FCmp);
+		IR_TABLE_ENTRY(FCvtSW);
+		IR_TABLE_ENTRY(FCvtWS);
+		IR_TABLE_ENTRY(ZeroFpCond);
+		IR_TABLE_ENTRY(FMovFromGPR);
+		IR_TABLE_ENTRY(FMovToGPR);
+		IR_TABLE_ENTRY(ExitToConst);
+		IR_TABLE_ENTRY(ExitToReg);
+		IR_TABLE_ENTRY(ExitToConstIfEq);
+		IR_TABLE_ENTRY(ExitToConstIfNeq);
+		IR_TABLE_ENTRY(ExitToConstIfGtZ);
+		IR_TABLE_ENTRY(ExitToConstIfGeZ);
+		IR_TABLE_ENTRY(ExitToConstIfLtZ);
+		IR_TABLE_ENTRY(ExitToConstIfLeZ);
+		IR_TABLE_ENTRY(Downcount);
+		IR_TABLE_ENTRY(SetPC);
+		IR_TABLE_ENTRY(SetPCConst);
+		IR_TABLE_ENTRY(Syscall);
+		IR_TABLE_ENTRY(ExitToPC);
+		IR_TABLE_ENTRY(Interpret);
+		IR_TABLE_ENTRY(CallReplacement);
+		IR_TABLE_ENTRY(Break);
+		IR_TABLE_ENTRY(SetCtrlVFPU);
+		IR_TABLE_ENTRY(SetCtrlVFPUReg);
+		IR_TABLE_ENTRY(SetCtrlVFPUFReg);
+		IR_TABLE_ENTRY(Breakpoint);
+		IR_TABLE_ENTRY(MemoryCheck);
+		IR_TABLE_ENTRY(ApplyRoundingMode);
+		IR_TABLE_ENTRY(RestoreRoundingMode);
+		IR_TABLE_ENTRY(UpdateRoundingMode);
+		dispatchTableReady = true;
+	}
+#endif
+
 	while (inst != end) {
 		switch (inst->op) {
-		case IROp::Nop:
+		IR_CASE(Nop):
 			_assert_(false);
 			break;
-		case IROp::SetConst:
+		IR_CASE(SetConst):
 			mips->r[inst->dest] = inst->constant;
 			break;
-		case IROp::SetConstF:
+		IR_CASE(SetConstF):
 			memcpy(&mips->f[inst->dest], &inst->constant, 4);
 			break;
-		case IROp::Add:
+		IR_CASE(Add):
 			mips->r[inst->dest] = mips->r[inst->src1] + mips->r[inst->src2];
 			break;
-		case IROp::Sub:
+		IR_CASE(Sub):
 			mips->r[inst->dest] = mips->r[inst->src1] - mips->r[inst->src2];
 			break;
-		case IROp::And:
+		IR_CASE(And):
 			mips->r[inst->dest] = mips->r[inst->src1] & mips->r[inst->src2];
 			break;
-		case IROp::Or:
+		IR_CASE(Or):
 			mips->r[inst->dest] = mips->r[inst->src1] | mips->r[inst->src2];
 			break;
-		case IROp::Xor:
+		IR_CASE(Xor):
 			mips->r[inst->dest] = mips->r[inst->src1] ^ mips->r[inst->src2];
 			break;
-		case IROp::Mov:
+		IR_CASE(Mov):
 			mips->r[inst->dest] = mips->r[inst->src1];
 			break;
-		case IROp::AddConst:
+		IR_CASE(AddConst):
 			mips->r[inst->dest] = mips->r[inst->src1] + inst->constant;
 			break;
-		case IROp::SubConst:
+		IR_CASE(SubConst):
 			mips->r[inst->dest] = mips->r[inst->src1] - inst->constant;
 			break;
-		case IROp::AndConst:
+		IR_CASE(AndConst):
 			mips->r[inst->dest] = mips->r[inst->src1] & inst->constant;
 			break;
-		case IROp::OrConst:
+		IR_CASE(OrConst):
 			mips->r[inst->dest] = mips->r[inst->src1] | inst->constant;
 			break;
-		case IROp::XorConst:
+		IR_CASE(XorConst):
 			mips->r[inst->dest] = mips->r[inst->src1] ^ inst->constant;
 			break;
-		case IROp::Neg:
+		IR_CASE(Neg):
 			mips->r[inst->dest] = -(s32)mips->r[inst->src1];
 			break;
-		case IROp::Not:
+		IR_CASE(Not):
 			mips->r[inst->dest] = ~mips->r[inst->src1];
 			break;
-		case IROp::Ext8to32:
+		IR_CASE(Ext8to32):
 			mips->r[inst->dest] = (s32)(s8)mips->r[inst->src1];
 			break;
-		case IROp::Ext16to32:
+		IR_CASE(Ext16to32):
 			mips->r[inst->dest] = (s32)(s16)mips->r[inst->src1];
 			break;
-		case IROp::ReverseBits:
+		IR_CASE(ReverseBits):
 			mips->r[inst->dest] = ReverseBits32(mips->r[inst->src1]);
 			break;
 
-		case IROp::Load8:
+		IR_CASE(Load8):
 			mips->r[inst->dest] = Memory::ReadUnchecked_U8(mips->r[inst->src1] + inst->constant);
 			break;
-		case IROp::Load8Ext:
+		IR_CASE(Load8Ext):
 			mips->r[inst->dest] = (s32)(s8)Memory::ReadUnchecked_U8(mips->r[inst->src1] + inst->constant);
 			break;
-		case IROp::Load16:
+		IR_CASE(Load16):
 			mips->r[inst->dest] = Memory::ReadUnchecked_U16(mips->r[inst->src1] + inst->constant);
 			break;
-		case IROp::Load16Ext:
+		IR_CASE(Load16Ext):
 			mips->r[inst->dest] = (s32)(s16)Memory::ReadUnchecked_U16(mips->r[inst->src1] + inst->constant);
 			break;
-		case IROp::Load32:
+		IR_CASE(Load32):
 			mips->r[inst->dest] = Memory::ReadUnchecked_U32(mips->r[inst->src1] + inst->constant);
 			break;
-		case IROp::Load32Left:
+		IR_CASE(Load32Left):
 		{
 			u32 addr = mips->r[inst->src1] + inst->constant;
 			u32 shift = (addr & 3) * 8;
@@ -159,7 +329,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			mips->r[inst->dest] = (mips->r[inst->dest] & destMask) | (mem << (24 - shift));
 			break;
 		}
-		case IROp::Load32Right:
+		IR_CASE(Load32Right):
 		{
 			u32 addr = mips->r[inst->src1] + inst->constant;
 			u32 shift = (addr & 3) * 8;
@@ -168,20 +338,20 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			mips->r[inst->dest] = (mips->r[inst->dest] & destMask) | (mem >> shift);
 			break;
 		}
-		case IROp::LoadFloat:
+		IR_CASE(LoadFloat):
 			mips->f[inst->dest] = Memory::ReadUnchecked_Float(mips->r[inst->src1] + inst->constant);
 			break;
 
-		case IROp::Store8:
+		IR_CASE(Store8):
 			Memory::WriteUnchecked_U8(mips->r[inst->src3], mips->r[inst->src1] + inst->constant);
 			break;
-		case IROp::Store16:
+		IR_CASE(Store16):
 			Memory::WriteUnchecked_U16(mips->r[inst->src3], mips->r[inst->src1] + inst->constant);
 			break;
-		case IROp::Store32:
+		IR_CASE(Store32):
 			Memory::WriteUnchecked_U32(mips->r[inst->src3], mips->r[inst->src1] + inst->constant);
 			break;
-		case IROp::Store32Left:
+		IR_CASE(Store32Left):
 		{
 			u32 addr = mips->r[inst->src1] + inst->constant;
 			u32 shift = (addr & 3) * 8;
@@ -191,7 +361,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			Memory::WriteUnchecked_U32(result, addr & 0xfffffffc);
 			break;
 		}
-		case IROp::Store32Right:
+		IR_CASE(Store32Right):
 		{
 			u32 addr = mips->r[inst->src1] + inst->constant;
 			u32 shift = (addr & 3) * 8;
@@ -201,11 +371,11 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			Memory::WriteUnchecked_U32(result, addr & 0xfffffffc);
 			break;
 		}
-		case IROp::StoreFloat:
+		IR_CASE(StoreFloat):
 			Memory::WriteUnchecked_Float(mips->f[inst->src3], mips->r[inst->src1] + inst->constant);
 			break;
 
-		case IROp::LoadVec4:
+		IR_CASE(LoadVec4):
 		{
 			u32 base = mips->r[inst->src1] + inst->constant;
 #if defined(_M_SSE)
@@ -216,7 +386,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 #endif
 			break;
 		}
-		case IROp::StoreVec4:
+		IR_CASE(StoreVec4):
 		{
 			u32 base = mips->r[inst->src1] + inst->constant;
 #if defined(_M_SSE)
@@ -228,7 +398,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Vec4Init:
+		IR_CASE(Vec4Init):
 		{
 #if defined(_M_SSE)
 			_mm_store_ps(&mips->f[inst->dest], _mm_load_ps(vec4InitValues[inst->src1]));
@@ -238,7 +408,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Vec4Shuffle:
+		IR_CASE(Vec4Shuffle):
 		{
 			// Can't use the SSE shuffle here because it takes an immediate. pshufb with a table would work though,
 			// or a big switch - there are only 256 shuffles possible (4^4)
@@ -247,7 +417,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Vec4Mov:
+		IR_CASE(Vec4Mov):
 		{
 #if defined(_M_SSE)
 			_mm_store_ps(&mips->f[inst->dest], _mm_load_ps(&mips->f[inst->src1]));
@@ -259,7 +429,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Vec4Add:
+		IR_CASE(Vec4Add):
 		{
 #if defined(_M_SSE)
 			_mm_store_ps(&mips->f[inst->dest], _mm_add_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps(&mips->f[inst->src2])));
@@ -272,7 +442,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Vec4Sub:
+		IR_CASE(Vec4Sub):
 		{
 #if defined(_M_SSE)
 			_mm_store_ps(&mips->f[inst->dest], _mm_sub_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps(&mips->f[inst->src2])));
@@ -285,7 +455,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Vec4Mul:
+		IR_CASE(Vec4Mul):
 		{
 #if defined(_M_SSE)
 			_mm_store_ps(&mips->f[inst->dest], _mm_mul_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps(&mips->f[inst->src2])));
@@ -298,7 +468,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Vec4Div:
+		IR_CASE(Vec4Div):
 		{
 #if defined(_M_SSE)
 			_mm_store_ps(&mips->f[inst->dest], _mm_div_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps(&mips->f[inst->src2])));
@@ -309,7 +479,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Vec4Scale:
+		IR_CASE(Vec4Scale):
 		{
 #if defined(_M_SSE)
 			_mm_store_ps(&mips->f[inst->dest], _mm_mul_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_set1_ps(mips->f[inst->src2])));
@@ -320,7 +490,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Vec4Neg:
+		IR_CASE(Vec4Neg):
 		{
 #if defined(_M_SSE)
 			_mm_store_ps(&mips->f[inst->dest], _mm_xor_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps((const float *)signBits)));
@@ -333,7 +503,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Vec4Abs:
+		IR_CASE(Vec4Abs):
 		{
 #if defined(_M_SSE)
 			_mm_store_ps(&mips->f[inst->dest], _mm_and_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps((const float *)noSignMask)));
@@ -346,21 +516,21 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Vec2Unpack16To31:
+		IR_CASE(Vec2Unpack16To31):
 		{
 			mips->fi[inst->dest] = (mips->fi[inst->src1] << 16) >> 1;
 			mips->fi[inst->dest + 1] = (mips->fi[inst->src1] & 0xFFFF0000) >> 1;
 			break;
 		}
 
-		case IROp::Vec2Unpack16To32:
+		IR_CASE(Vec2Unpack16To32):
 		{
 			mips->fi[inst->dest] = (mips->fi[inst->src1] << 16);
 			mips->fi[inst->dest + 1] = (mips->fi[inst->src1] & 0xFFFF0000);
 			break;
 		}
 
-		case IROp::Vec4Unpack8To32:
+		IR_CASE(Vec4Unpack8To32):
 		{
 #if defined(_M_SSE)
 			__m128i src = _mm_cvtsi32_si128(mips->fi[inst->src1]);
@@ -376,14 +546,14 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Vec2Pack32To16:
+		IR_CASE(Vec2Pack32To16):
 		{
 			u32 val = mips->fi[inst->src1] >> 16;
 			mips->fi[inst->dest] = (mips->fi[inst->src1 + 1] & 0xFFFF0000) | val;
 			break;
 		}
 
-		case IROp::Vec2Pack31To16:
+		IR_CASE(Vec2Pack31To16):
 		{
 			u32 val = (mips->fi[inst->src1] >> 15) & 0xFFFF;
 			val |= (mips->fi[inst->src1 + 1] << 1) & 0xFFFF0000;
@@ -391,7 +561,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Vec4Pack32To8:
+		IR_CASE(Vec4Pack32To8):
 		{
 			// Removed previous SSE code due to the need for unsigned 16-bit pack, which I'm too lazy to work around the lack of in SSE2.
 			// pshufb or SSE4 instructions can be used instead.
@@ -403,7 +573,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Vec4Pack31To8:
+		IR_CASE(Vec4Pack31To8):
 		{
 			// Removed previous SSE code due to the need for unsigned 16-bit pack, which I'm too lazy to work around the lack of in SSE2.
 			// pshufb or SSE4 instructions can be used instead.
@@ -415,7 +585,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Vec2ClampToZero:
+		IR_CASE(Vec2ClampToZero):
 		{
 			for (int i = 0; i < 2; i++) {
 				u32 val = mips->fi[inst->src1 + i];
@@ -424,7 +594,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Vec4ClampToZero:
+		IR_CASE(Vec4ClampToZero):
 		{
 #if defined(_M_SSE)
 			// Trickery: Expand the sign bit, and use andnot to zero negative values.
@@ -441,7 +611,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Vec4DuplicateUpperBitsAndShift1:  // For vuc2i, the weird one.
+		IR_CASE(Vec4DuplicateUpperBitsAndShift1):  // For vuc2i, the weird one.
 		{
 			for (int i = 0; i < 4; i++) {
 				u32 val = mips->fi[inst->src1 + i];
@@ -453,7 +623,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::FCmpVfpuBit:
+		IR_CASE(FCmpVfpuBit):
 		{
 			int op = inst->dest & 0xF;
 			int bit = inst->dest >> 4;
@@ -486,7 +656,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::FCmpVfpuAggregate:
+		IR_CASE(FCmpVfpuAggregate):
 		{
 			u32 mask = inst->dest;
 			u32 cc = mips->vfpuCtrl[VFPU_CTRL_CC];
@@ -496,14 +666,14 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::FCmovVfpuCC:
+		IR_CASE(FCmovVfpuCC):
 			if (((mips->vfpuCtrl[VFPU_CTRL_CC] >> (inst->src2 & 0xf)) & 1) == ((u32)inst->src2 >> 7)) {
 				mips->f[inst->dest] = mips->f[inst->src1];
 			}
 			break;
 
 		// Not quickly implementable on all platforms, unfortunately.
-		case IROp::Vec4Dot:
+		IR_CASE(Vec4Dot):
 		{
 			float dot = mips->f[inst->src1] * mips->f[inst->src2];
 			for (int i = 1; i < 4; i++)
@@ -512,32 +682,32 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::FSin:
+		IR_CASE(FSin):
 			mips->f[inst->dest] = vfpu_sin(mips->f[inst->src1]);
 			break;
-		case IROp::FCos:
+		IR_CASE(FCos):
 			mips->f[inst->dest] = vfpu_cos(mips->f[inst->src1]);
 			break;
-		case IROp::FRSqrt:
+		IR_CASE(FRSqrt):
 			mips->f[inst->dest] = 1.0f / sqrtf(mips->f[inst->src1]);
 			break;
-		case IROp::FRecip:
+		IR_CASE(FRecip):
 			mips->f[inst->dest] = 1.0f / mips->f[inst->src1];
 			break;
-		case IROp::FAsin:
+		IR_CASE(FAsin):
 			mips->f[inst->dest] = vfpu_asin(mips->f[inst->src1]);
 			break;
 
-		case IROp::ShlImm:
+		IR_CASE(ShlImm):
 			mips->r[inst->dest] = mips->r[inst->src1] << (int)inst->src2;
 			break;
-		case IROp::ShrImm:
+		IR_CASE(ShrImm):
 			mips->r[inst->dest] = mips->r[inst->src1] >> (int)inst->src2;
 			break;
-		case IROp::SarImm:
+		IR_CASE(SarImm):
 			mips->r[inst->dest] = (s32)mips->r[inst->src1] >> (int)inst->src2;
 			break;
-		case IROp::RorImm:
+		IR_CASE(RorImm):
 		{
 			u32 x = mips->r[inst->src1];
 			int sa = inst->src2;
@@ -545,16 +715,16 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 		}
 		break;
 
-		case IROp::Shl:
+		IR_CASE(Shl):
 			mips->r[inst->dest] = mips->r[inst->src1] << (mips->r[inst->src2] & 31);
 			break;
-		case IROp::Shr:
+		IR_CASE(Shr):
 			mips->r[inst->dest] = mips->r[inst->src1] >> (mips->r[inst->src2] & 31);
 			break;
-		case IROp::Sar:
+		IR_CASE(Sar):
 			mips->r[inst->dest] = (s32)mips->r[inst->src1] >> (mips->r[inst->src2] & 31);
 			break;
-		case IROp::Ror:
+		IR_CASE(Ror):
 		{
 			u32 x = mips->r[inst->src1];
 			int sa = mips->r[inst->src2] & 31;
@@ -562,70 +732,70 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Clz:
+		IR_CASE(Clz):
 		{
 			mips->r[inst->dest] = clz32(mips->r[inst->src1]);
 			break;
 		}
 
-		case IROp::Slt:
+		IR_CASE(Slt):
 			mips->r[inst->dest] = (s32)mips->r[inst->src1] < (s32)mips->r[inst->src2];
 			break;
 
-		case IROp::SltU:
+		IR_CASE(SltU):
 			mips->r[inst->dest] = mips->r[inst->src1] < mips->r[inst->src2];
 			break;
 
-		case IROp::SltConst:
+		IR_CASE(SltConst):
 			mips->r[inst->dest] = (s32)mips->r[inst->src1] < (s32)inst->constant;
 			break;
 
-		case IROp::SltUConst:
+		IR_CASE(SltUConst):
 			mips->r[inst->dest] = mips->r[inst->src1] < inst->constant;
 			break;
 
-		case IROp::MovZ:
+		IR_CASE(MovZ):
 			if (mips->r[inst->src1] == 0)
 				mips->r[inst->dest] = mips->r[inst->src2];
 			break;
-		case IROp::MovNZ:
+		IR_CASE(MovNZ):
 			if (mips->r[inst->src1] != 0)
 				mips->r[inst->dest] = mips->r[inst->src2];
 			break;
 
-		case IROp::Max:
+		IR_CASE(Max):
 			mips->r[inst->dest] = (s32)mips->r[inst->src1] > (s32)mips->r[inst->src2] ? mips->r[inst->src1] : mips->r[inst->src2];
 			break;
-		case IROp::Min:
+		IR_CASE(Min):
 			mips->r[inst->dest] = (s32)mips->r[inst->src1] < (s32)mips->r[inst->src2] ? mips->r[inst->src1] : mips->r[inst->src2];
 			break;
 
-		case IROp::MtLo:
+		IR_CASE(MtLo):
 			mips->lo = mips->r[inst->src1];
 			break;
-		case IROp::MtHi:
+		IR_CASE(MtHi):
 			mips->hi = mips->r[inst->src1];
 			break;
-		case IROp::MfLo:
+		IR_CASE(MfLo):
 			mips->r[inst->dest] = mips->lo;
 			break;
-		case IROp::MfHi:
+		IR_CASE(MfHi):
 			mips->r[inst->dest] = mips->hi;
 			break;
 
-		case IROp::Mult:
+		IR_CASE(Mult):
 		{
 			s64 result = (s64)(s32)mips->r[inst->src1] * (s64)(s32)mips->r[inst->src2];
 			memcpy(&mips->lo, &result, 8);
 			break;
 		}
-		case IROp::MultU:
+		IR_CASE(MultU):
 		{
 			u64 result = (u64)mips->r[inst->src1] * (u64)mips->r[inst->src2];
 			memcpy(&mips->lo, &result, 8);
 			break;
 		}
-		case IROp::Madd:
+		IR_CASE(Madd):
 		{
 			s64 result;
 			memcpy(&result, &mips->lo, 8);
@@ -633,7 +803,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			memcpy(&mips->lo, &result, 8);
 			break;
 		}
-		case IROp::MaddU:
+		IR_CASE(MaddU):
 		{
 			s64 result;
 			memcpy(&result, &mips->lo, 8);
@@ -641,7 +811,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			memcpy(&mips->lo, &result, 8);
 			break;
 		}
-		case IROp::Msub:
+		IR_CASE(Msub):
 		{
 			s64 result;
 			memcpy(&result, &mips->lo, 8);
@@ -649,7 +819,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			memcpy(&mips->lo, &result, 8);
 			break;
 		}
-		case IROp::MsubU:
+		IR_CASE(MsubU):
 		{
 			s64 result;
 			memcpy(&result, &mips->lo, 8);
@@ -658,7 +828,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Div:
+		IR_CASE(Div):
 		{
 			s32 numerator = (s32)mips->r[inst->src1];
 			s32 denominator = (s32)mips->r[inst->src2];
@@ -674,7 +844,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			}
 			break;
 		}
-		case IROp::DivU:
+		IR_CASE(DivU):
 		{
 			u32 numerator = mips->r[inst->src1];
 			u32 denominator = mips->r[inst->src2];
@@ -688,60 +858,60 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::BSwap16:
+		IR_CASE(BSwap16):
 		{
 			u32 x = mips->r[inst->src1];
 			mips->r[inst->dest] = ((x & 0xFF00FF00) >> 8) | ((x & 0x00FF00FF) << 8);
 			break;
 		}
-		case IROp::BSwap32:
+		IR_CASE(BSwap32):
 		{
 			u32 x = mips->r[inst->src1];
 			mips->r[inst->dest] = ((x & 0xFF000000) >> 24) | ((x & 0x00FF0000) >> 8) | ((x & 0x0000FF00) << 8) | ((x & 0x000000FF) << 24);
 			break;
 		}
 
-		case IROp::FAdd:
+		IR_CASE(FAdd):
 			mips->f[inst->dest] = mips->f[inst->src1] + mips->f[inst->src2];
 			break;
-		case IROp::FSub:
+		IR_CASE(FSub):
 			mips->f[inst->dest] = mips->f[inst->src1] - mips->f[inst->src2];
 			break;
-		case IROp::FMul:
+		IR_CASE(FMul):
 			mips->f[inst->dest] = mips->f[inst->src1] * mips->f[inst->src2];
 			break;
-		case IROp::FDiv:
+		IR_CASE(FDiv):
 			mips->f[inst->dest] = mips->f[inst->src1] / mips->f[inst->src2];
 			break;
-		case IROp::FMin:
+		IR_CASE(FMin):
 			mips->f[inst->dest] = std::min(mips->f[inst->src1], mips->f[inst->src2]);
 			break;
-		case IROp::FMax:
+		IR_CASE(FMax):
 			mips->f[inst->dest] = std::max(mips->f[inst->src1], mips->f[inst->src2]);
 			break;
 
-		case IROp::FMov:
+		IR_CASE(FMov):
 			mips->f[inst->dest] = mips->f[inst->src1];
 			break;
-		case IROp::FAbs:
+		IR_CASE(FAbs):
 			mips->f[inst->dest] = fabsf(mips->f[inst->src1]);
 			break;
-		case IROp::FSqrt:
+		IR_CASE(FSqrt):
 			mips->f[inst->dest] = sqrtf(mips->f[inst->src1]);
 			break;
-		case IROp::FNeg:
+		IR_CASE(FNeg):
 			mips->f[inst->dest] = -mips->f[inst->src1];
 			break;
-		case IROp::FSat0_1:
+		IR_CASE(FSat0_1):
 			// We have to do this carefully to handle NAN and -0.0f.
 			mips->f[inst->dest] = vfpu_clamp(mips->f[inst->src1], 0.0f, 1.0f);
 			break;
-		case IROp::FSatMinus1_1:
+		IR_CASE(FSatMinus1_1):
 			mips->f[inst->dest] = vfpu_clamp(mips->f[inst->src1], -1.0f, 1.0f);
 			break;
 
 		// Bitwise trickery
-		case IROp::FSign:
+		IR_CASE(FSign):
 		{
 			u32 val;
 			memcpy(&val, &mips->f[inst->src1], sizeof(u32));
@@ -754,13 +924,13 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::FpCondToReg:
+		IR_CASE(FpCondToReg):
 			mips->r[inst->dest] = mips->fpcond;
 			break;
-		case IROp::VfpuCtrlToReg:
+		IR_CASE(VfpuCtrlToReg):
 			mips->r[inst->dest] = mips->vfpuCtrl[inst->src1];
 			break;
-		case IROp::FRound:
+		IR_CASE(FRound):
 		{
 			float value = mips->f[inst->src1];
 			if (my_isnanorinf(value)) {
@@ -771,7 +941,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			}
 			break;
 		}
-		case IROp::FTrunc:
+		IR_CASE(FTrunc):
 		{
 			float value = mips->f[inst->src1];
 			if (my_isnanorinf(value)) {
@@ -791,7 +961,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 				break;
 			}
 		}
-		case IROp::FCeil:
+		IR_CASE(FCeil):
 		{
 			float value = mips->f[inst->src1];
 			if (my_isnanorinf(value)) {
@@ -802,7 +972,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			}
 			break;
 		}
-		case IROp::FFloor:
+		IR_CASE(FFloor):
 		{
 			float value = mips->f[inst->src1];
 			if (my_isnanorinf(value)) {
@@ -813,7 +983,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			}
 			break;
 		}
-		case IROp::FCmp:
+		IR_CASE(FCmp):
 			switch (inst->dest) {
 			case IRFpCompareMode::False:
 				mips->fpcond = 0;
@@ -840,10 +1010,10 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			}
 			break;
 
-		case IROp::FCvtSW:
+		IR_CASE(FCvtSW):
 			mips->f[inst->dest] = (float)mips->fs[inst->src1];
 			break;
-		case IROp::FCvtWS:
+		IR_CASE(FCvtWS):
 		{
 			float src = mips->f[inst->src1];
 			if (my_isnanorinf(src)) {
@@ -859,61 +1029,61 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break; //cvt.w.s
 		}
 
-		case IROp::ZeroFpCond:
+		IR_CASE(ZeroFpCond):
 			mips->fpcond = 0;
 			break;
 
-		case IROp::FMovFromGPR:
+		IR_CASE(FMovFromGPR):
 			memcpy(&mips->f[inst->dest], &mips->r[inst->src1], 4);
 			break;
-		case IROp::FMovToGPR:
+		IR_CASE(FMovToGPR):
 			memcpy(&mips->r[inst->dest], &mips->f[inst->src1], 4);
 			break;
 
-		case IROp::ExitToConst:
+		IR_CASE(ExitToConst):
 			return inst->constant;
 
-		case IROp::ExitToReg:
+		IR_CASE(ExitToReg):
 			return mips->r[inst->src1];
 
-		case IROp::ExitToConstIfEq:
+		IR_CASE(ExitToConstIfEq):
 			if (mips->r[inst->src1] == mips->r[inst->src2])
 				return inst->constant;
 			break;
-		case IROp::ExitToConstIfNeq:
+		IR_CASE(ExitToConstIfNeq):
 			if (mips->r[inst->src1] != mips->r[inst->src2])
 				return inst->constant;
 			break;
-		case IROp::ExitToConstIfGtZ:
+		IR_CASE(ExitToConstIfGtZ):
 			if ((s32)mips->r[inst->src1] > 0)
 				return inst->constant;
 			break;
-		case IROp::ExitToConstIfGeZ:
+		IR_CASE(ExitToConstIfGeZ):
 			if ((s32)mips->r[inst->src1] >= 0)
 				return inst->constant;
 			break;
-		case IROp::ExitToConstIfLtZ:
+		IR_CASE(ExitToConstIfLtZ):
 			if ((s32)mips->r[inst->src1] < 0)
 				return inst->constant;
 			break;
-		case IROp::ExitToConstIfLeZ:
+		IR_CASE(ExitToConstIfLeZ):
 			if ((s32)mips->r[inst->src1] <= 0)
 				return inst->constant;
 			break;
 
-		case IROp::Downcount:
+		IR_CASE(Downcount):
 			mips->downcount -= inst->constant;
 			break;
 
-		case IROp::SetPC:
+		IR_CASE(SetPC):
 			mips->pc = mips->r[inst->src1];
 			break;
 
-		case IROp::SetPCConst:
+		IR_CASE(SetPCConst):
 			mips->pc = inst->constant;
 			break;
 
-		case IROp::Syscall:
+		IR_CASE(Syscall):
 			// IROp::SetPC was (hopefully) executed before.
 		{
 			MIPSOpcode op(inst->constant);
@@ -923,17 +1093,17 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::ExitToPC:
+		IR_CASE(ExitToPC):
 			return mips->pc;
 
-		case IROp::Interpret:  // SLOW fallback. Can be made faster. Ideally should be removed but may be useful for debugging.
+		IR_CASE(Interpret):  // SLOW fallback. Can be made faster. Ideally should be removed but may be useful for debugging.
 		{
 			MIPSOpcode op(inst->constant);
 			MIPSInterpret(op);
 			break;
 		}
 
-		case IROp::CallReplacement:
+		IR_CASE(CallReplacement):
 		{
 			int funcIndex = inst->constant;
 			const ReplacementTableEntry *f = GetReplacementFunc(funcIndex);
@@ -942,50 +1112,50 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 		}
 
-		case IROp::Break:
+		IR_CASE(Break):
 			if (!g_Config.bIgnoreBadMemAccess) {
 				Core_EnableStepping(true);
 				host->SetDebugMode(true);
 			}
 			return mips->pc + 4;
 
-		case IROp::SetCtrlVFPU:
+		IR_CASE(SetCtrlVFPU):
 			mips->vfpuCtrl[inst->dest] = inst->constant;
 			break;
 
-		case IROp::SetCtrlVFPUReg:
+		IR_CASE(SetCtrlVFPUReg):
 			mips->vfpuCtrl[inst->dest] = mips->r[inst->src1];
 			break;
 
-		case IROp::SetCtrlVFPUFReg:
+		IR_CASE(SetCtrlVFPUFReg):
 			memcpy(&mips->vfpuCtrl[inst->dest], &mips->f[inst->src1], 4);
 			break;
 
-		case IROp::Breakpoint:
+		IR_CASE(Breakpoint):
 			if (RunBreakpoint(mips->pc)) {
 				CoreTiming::ForceCheck();
 				return mips->pc;
 			}
 			break;
 
-		case IROp::MemoryCheck:
+		IR_CASE(MemoryCheck):
 			if (RunMemCheck(mips->pc, mips->r[inst->src1] + inst->constant)) {
 				CoreTiming::ForceCheck();
 				return mips->pc;
 			}
 			break;
 
-		case IROp::ApplyRoundingMode:
+		IR_CASE(ApplyRoundingMode):
 			// TODO: Implement
 			break;
-		case IROp::RestoreRoundingMode:
+		IR_CASE(RestoreRoundingMode):
 			// TODO: Implement
 			break;
-		case IROp::UpdateRoundingMode:
+		IR_CASE(UpdateRoundingMode):
 			// TODO: Implement
 			break;
 
-		default:
+		IR_DEFAULT:
 			// Unimplemented IR op. Bad.
 			Crash();
 		}
@@ -994,9 +1164,31 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			Crash();
 #endif
 		inst++;
+#ifdef IR_THREADED_DISPATCH
+		if (inst != end)
+			goto *dispatchTable[(int)inst->op];
+#endif
 	}
 
 	// If we got here, the block was badly constructed.
 	Crash();
 	return 0;
 }
+
+namespace MIPSComp {
+
+void IRInterpretSingleInst(u64 raw) {
+	IRInst insts[2]{};
+	memcpy(&insts[0], &raw, sizeof(IRInst));
+	// Terminate it so the interpreter returns after the one instruction.
+	insts[1].op = IROp::ExitToConst;
+	IRInterpret(currentMIPS, insts, 2);
+}
+
+u32 IRInterpretSingleExit(u64 raw) {
+	IRInst inst;
+	memcpy(&inst, &raw, sizeof(IRInst));
+	return IRInterpret(currentMIPS, &inst, 1);
+}
+
+}  // namespace
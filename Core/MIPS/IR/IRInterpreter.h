@@ -21,3 +21,7 @@ inline static u32 ReverseBits32(u32 v) {
 }
 
 u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count);
+
+// Return 1 if the core should stop and exit the block.
+u32 RunBreakpoint(u32 pc);
+u32 RunMemCheck(u32 pc, u32 addr);
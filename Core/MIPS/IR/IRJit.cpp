@@ -15,7 +15,11 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
+
+#include "ppsspp_config.h"
 #include "base/logging.h"
+#include "thread/threadutil.h"
 #include "ext/xxhash.h"
 #include "profiler/profiler.h"
 #include "Common/ChunkFile.h"
@@ -34,10 +38,82 @@
 #include "Core/MIPS/IR/IRPassSimplify.h"
 #include "Core/MIPS/IR/IRInterpreter.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
+#if PPSSPP_ARCH(AMD64)
+#include "Core/MIPS/x86/IRToX86.h"
+#elif PPSSPP_ARCH(ARM64)
+#include "Core/MIPS/ARM64/IRToArm64.h"
+#endif
 #include "Core/Reporting.h"
 
 namespace MIPSComp {
 
+// Compiles each block of a function, following exits that stay inside it.
+// compileBlock(em_address, instructions, mipsBytes) fills in the block, and returns false to stop.
+template <typename F>
+static void WalkFunctionBlocks(u32 start_address, u32 length, F compileBlock) {
+	// We may go up and down from branches, so track all block starts done here.
+	std::set<u32> doneAddresses;
+	std::vector<u32> pendingAddresses;
+	pendingAddresses.push_back(start_address);
+	while (!pendingAddresses.empty()) {
+		u32 em_address = pendingAddresses.back();
+		pendingAddresses.pop_back();
+
+		// To be safe, also check if a real block is there.  This can be a runtime module load.
+		u32 inst = Memory::ReadUnchecked_U32(em_address);
+		if (MIPS_IS_RUNBLOCK(inst) || doneAddresses.find(em_address) != doneAddresses.end()) {
+			// Already compiled this address.
+			continue;
+		}
+
+		std::vector<IRInst> instructions;
+		u32 mipsBytes = 0;
+		if (!compileBlock(em_address, instructions, mipsBytes))
+			return;
+
+		doneAddresses.insert(em_address);
+
+		for (const IRInst &inst : instructions) {
+			u32 exit = 0;
+
+			switch (inst.op) {
+			case IROp::ExitToConst:
+			case IROp::ExitToConstIfEq:
+			case IROp::ExitToConstIfNeq:
+			case IROp::ExitToConstIfGtZ:
+			case IROp::ExitToConstIfGeZ:
+			case IROp::ExitToConstIfLtZ:
+			case IROp::ExitToConstIfLeZ:
+			case IROp::ExitToConstIfFpTrue:
+			case IROp::ExitToConstIfFpFalse:
+				exit = inst.constant;
+				break;
+
+			case IROp::ExitToPC:
+			case IROp::Break:
+				// Don't add any, we'll do block end anyway (for jal, etc.)
+				exit = 0;
+				break;
+
+			default:
+				exit = 0;
+				break;
+			}
+
+			// Only follow jumps internal to the function.
+			if (exit != 0 && exit >= start_address && exit < start_address + length) {
+				// Even if it's a duplicate, we check at loop start.
+				pendingAddresses.push_back(exit);
+			}
+		}
+
+		// Also include after the block for jal returns.
+		if (em_address + mipsBytes < start_address + length) {
+			pendingAddresses.push_back(em_address + mipsBytes);
+		}
+	}
+}
+
 IRJit::IRJit(MIPSState *mips) : frontend_(mips->HasDefaultPrefix()), mips_(mips) {
 	u32 size = 128 * 1024;
 	// blTrampolines_ = kernelMemory.Alloc(size, true, "trampoline");
@@ -46,10 +122,184 @@ IRJit::IRJit(MIPSState *mips) : frontend_(mips->HasDefaultPrefix()), mips_(mips)
 	IROptions opts{};
 	opts.disableFlags = g_Config.uJitDisableFlags;
 	opts.unalignedLoadStore = opts.disableFlags & (uint32_t)JitDisable::LSU_UNALIGNED;
+	opts.continueBranches = true;
+	opts.continueJumps = true;
+	opts.continueMaxInstructions = jo.continueMaxInstructions;
 	frontend_.SetOptions(opts);
+	irOptions_ = opts;
+	blocks_.SetProfiling(jo.profileBlocks);
+
+#if PPSSPP_ARCH(AMD64)
+	native_ = new IRToX86(mips);
+#elif PPSSPP_ARCH(ARM64)
+	native_ = new IRToArm64(mips);
+#endif
+	if (native_ && g_Config.bBackgroundJit) {
+		nativeThread_ = std::thread([this] { NativeWorkerLoop(); });
+	}
+	if (g_Config.bBackgroundJit) {
+		// Leave some cores for the emu and GPU threads.
+		int numPreloadThreads = std::max(1, std::min(4, (int)std::thread::hardware_concurrency() / 2));
+		for (int i = 0; i < numPreloadThreads; ++i)
+			preloadThreads_.push_back(std::thread([this] { PreloadWorkerLoop(); }));
+	}
 }
 
 IRJit::~IRJit() {
+	if (nativeThread_.joinable()) {
+		{
+			std::lock_guard<std::mutex> guard(nativeLock_);
+			nativeWorkerQuit_ = true;
+		}
+		nativeWakeCond_.notify_one();
+		nativeThread_.join();
+	}
+	if (!preloadThreads_.empty()) {
+		{
+			std::lock_guard<std::mutex> guard(preloadLock_);
+			preloadWorkerQuit_ = true;
+		}
+		preloadWakeCond_.notify_all();
+		for (std::thread &th : preloadThreads_)
+			th.join();
+	}
+	delete native_;
+}
+
+void IRJit::NativeWorkerLoop() {
+	setCurrentThreadName("IRJitNative");
+
+	std::unique_lock<std::mutex> guard(nativeLock_);
+	while (true) {
+		nativeWakeCond_.wait(guard, [this] { return nativeWorkerQuit_ || !nativeQueue_.empty(); });
+		if (nativeWorkerQuit_)
+			break;
+
+		NativeCompileRequest req = std::move(nativeQueue_.front());
+		nativeQueue_.pop_front();
+		nativeWorkerBusy_ = true;
+		guard.unlock();
+
+		const u8 *entry = native_->ConvertIRToNative(&req.instructions[0], (int)req.instructions.size());
+
+		guard.lock();
+		nativeWorkerBusy_ = false;
+		if (entry) {
+			nativeResults_.push_back(NativeCompileResult{ req.blockNum, req.generation, entry });
+			nativeResultsReady_ = true;
+		} else {
+			// Keep interpreting until the emu thread clears the cache.
+			nativeFull_ = true;
+			nativeQueue_.clear();
+		}
+		if (nativeQueue_.empty())
+			nativeIdleCond_.notify_all();
+	}
+}
+
+void IRJit::QueueNativeCompile(int block_num, const std::vector<IRInst> &instructions) {
+	{
+		std::lock_guard<std::mutex> guard(nativeLock_);
+		nativeQueue_.push_back(NativeCompileRequest{ block_num, nativeGeneration_, instructions });
+	}
+	nativeWakeCond_.notify_one();
+}
+
+void IRJit::ApplyNativeResults() {
+	std::lock_guard<std::mutex> guard(nativeLock_);
+	for (const NativeCompileResult &result : nativeResults_) {
+		if (result.generation != nativeGeneration_)
+			continue;
+		IRBlock *b = blocks_.GetBlock(result.blockNum);
+		// The block may have been invalidated while it was compiling.
+		if (b && b->IsValid())
+			b->SetNativeEntry(result.entry);
+	}
+	nativeResults_.clear();
+	nativeResultsReady_ = false;
+}
+
+void IRJit::FlushNativeWorker() {
+	std::unique_lock<std::mutex> guard(nativeLock_);
+	nativeQueue_.clear();
+	nativeIdleCond_.wait(guard, [this] { return !nativeWorkerBusy_; });
+	nativeResults_.clear();
+	nativeResultsReady_ = false;
+	nativeGeneration_++;
+}
+
+void IRJit::QueuePreloadFunction(u32 start_address, u32 length) {
+	{
+		std::lock_guard<std::mutex> guard(preloadLock_);
+		preloadQueue_.push_back(PreloadRequest{ start_address, length });
+	}
+	preloadWakeCond_.notify_one();
+}
+
+void IRJit::PreloadWorkerLoop() {
+	setCurrentThreadName("IRJitPreload");
+	setCurrentThreadRole(ThreadRole::BACKGROUND);
+
+	IRFrontend frontend(mips_->HasDefaultPrefix());
+	frontend.SetOptions(irOptions_);
+
+	std::unique_lock<std::mutex> guard(preloadLock_);
+	while (true) {
+		preloadWakeCond_.wait(guard, [this] { return preloadWorkerQuit_ || !preloadQueue_.empty(); });
+		if (preloadWorkerQuit_)
+			break;
+
+		PreloadRequest req = preloadQueue_.front();
+		preloadQueue_.pop_front();
+		guard.unlock();
+
+		std::vector<IRBlock> results;
+		WalkFunctionBlocks(req.start, req.length, [&](u32 em_address, std::vector<IRInst> &instructions, u32 &mipsBytes) {
+			std::lock_guard<std::recursive_mutex> blocksGuard(blocksLock_);
+			frontend.DoJit(em_address, instructions, mipsBytes, true);
+			if (!instructions.empty()) {
+				IRBlock block(em_address);
+				block.SetInstructions(instructions);
+				block.SetOriginalSize(mipsBytes);
+				block.UpdateHash();
+				results.push_back(std::move(block));
+			}
+			return true;
+		});
+
+		guard.lock();
+		for (IRBlock &block : results)
+			preloadResults_.push_back(std::move(block));
+		if (!preloadResults_.empty())
+			preloadResultsReady_ = true;
+	}
+}
+
+void IRJit::ApplyPreloadResults() {
+	std::vector<IRBlock> results;
+	{
+		std::lock_guard<std::mutex> guard(preloadLock_);
+		results.swap(preloadResults_);
+		preloadResultsReady_ = false;
+	}
+
+	for (IRBlock &block : results) {
+		u32 start, size;
+		block.GetRange(start, size);
+		// Already compiled for real (or preloaded twice) while the worker was busy.
+		if (MIPS_IS_RUNBLOCK(Memory::ReadUnchecked_U32(start)) || blocks_.FindPreloadBlock(start) != -1)
+			continue;
+
+		int block_num = blocks_.AllocateBlock(start);
+		if ((block_num & ~MIPS_EMUHACK_VALUE_MASK) != 0) {
+			// Out of block numbers, the next real compile will clear the cache.
+			WARN_LOG(JIT, "Ran out of block numbers while applying preloaded functions");
+			break;
+		}
+		// Only update page stats, blocks are linked by Compile() when first used.
+		*blocks_.GetBlock(block_num) = std::move(block);
+		blocks_.FinalizeBlock(block_num, true);
+	}
 }
 
 void IRJit::DoState(PointerWrap &p) {
@@ -61,17 +311,37 @@ void IRJit::UpdateFCR31() {
 
 void IRJit::ClearCache() {
 	ILOG("IRJit: Clearing the cache!");
+	std::lock_guard<std::recursive_mutex> blocksGuard(blocksLock_);
 	blocks_.Clear();
+	if (nativeThread_.joinable())
+		FlushNativeWorker();
+	if (native_)
+		native_->Clear();
+	nativeFull_ = false;
 }
 
 void IRJit::InvalidateCacheAt(u32 em_address, int length) {
+	std::lock_guard<std::recursive_mutex> blocksGuard(blocksLock_);
 	blocks_.InvalidateICache(em_address, length);
 }
 
 void IRJit::Compile(u32 em_address) {
 	PROFILE_THIS_SCOPE("jitc");
+	std::lock_guard<std::recursive_mutex> blocksGuard(blocksLock_);
+
+	if (nativeThread_.joinable()) {
+		if (nativeFull_)
+			RecycleNativeCode();
+		else if (nativeResultsReady_)
+			ApplyNativeResults();
+	} else if (native_ && native_->IsFull()) {
+		RecycleNativeCode();
+	}
 
 	if (g_Config.bPreloadFunctions) {
+		if (preloadResultsReady_)
+			ApplyPreloadResults();
+
 		// Look to see if we've preloaded this block.
 		int block_num = blocks_.FindPreloadBlock(em_address);
 		if (block_num != -1) {
@@ -79,6 +349,12 @@ void IRJit::Compile(u32 em_address) {
 			// Okay, let's link and finalize the block now.
 			b->Finalize(block_num);
 			if (b->IsValid()) {
+				// Background preloads leave native code until the block is actually used.
+				if (!b->GetNativeEntry() && nativeThread_.joinable()) {
+					QueueNativeCompile(block_num, std::vector<IRInst>(b->GetInstructions(), b->GetInstructions() + b->GetNumInstructions()));
+				} else if (!b->GetNativeEntry() && native_) {
+					b->SetNativeEntry(native_->ConvertIRToNative(b->GetInstructions(), b->GetNumInstructions()));
+				}
 				// Success, we're done.
 				return;
 			}
@@ -101,6 +377,39 @@ void IRJit::Compile(u32 em_address) {
 	}
 }
 
+void IRJit::RecycleNativeCode() {
+	// Native code space is linear, so it all goes.  Cold blocks are evicted entirely,
+	// while blocks that ran recently keep their IR and are converted again.
+	int evicted = blocks_.EvictColdBlocks();
+	if (evicted == 0) {
+		// Everything is hot, nothing to gain from keeping it.
+		ClearCache();
+		return;
+	}
+
+	if (nativeThread_.joinable())
+		FlushNativeWorker();
+	native_->Clear();
+	nativeFull_ = false;
+
+	int kept = 0;
+	for (int i = 0; i < blocks_.GetNumBlocks(); ++i) {
+		IRBlock *b = blocks_.GetBlock(i);
+		b->SetNativeEntry(nullptr);
+		if (!b->IsValid())
+			continue;
+
+		std::vector<IRInst> instructions(b->GetInstructions(), b->GetInstructions() + b->GetNumInstructions());
+		if (nativeThread_.joinable())
+			QueueNativeCompile(i, instructions);
+		else
+			b->SetNativeEntry(native_->ConvertIRToNative(b->GetInstructions(), b->GetNumInstructions()));
+		kept++;
+	}
+
+	INFO_LOG(JIT, "IRJit: Evicted %d cold blocks, kept %d", evicted, kept);
+}
+
 bool IRJit::CompileBlock(u32 em_address, std::vector<IRInst> &instructions, u32 &mipsBytes, bool preload) {
 	frontend_.DoJit(em_address, instructions, mipsBytes, preload);
 	if (instructions.empty()) {
@@ -118,6 +427,13 @@ bool IRJit::CompileBlock(u32 em_address, std::vector<IRInst> &instructions, u32
 	IRBlock *b = blocks_.GetBlock(block_num);
 	b->SetInstructions(instructions);
 	b->SetOriginalSize(mipsBytes);
+	if (nativeThread_.joinable()) {
+		// Interpreted until the worker is done, then ApplyNativeResults() switches it over.
+		QueueNativeCompile(block_num, instructions);
+	} else if (native_) {
+		// If we run out of space, this returns nullptr and we just interpret the block.
+		b->SetNativeEntry(native_->ConvertIRToNative(b->GetInstructions(), b->GetNumInstructions()));
+	}
 	if (preload) {
 		// Hash, then only update page stats, don't link yet.
 		b->UpdateHash();
@@ -134,74 +450,23 @@ bool IRJit::CompileBlock(u32 em_address, std::vector<IRInst> &instructions, u32
 void IRJit::CompileFunction(u32 start_address, u32 length) {
 	PROFILE_THIS_SCOPE("jitc");
 
+	if (!preloadThreads_.empty()) {
+		QueuePreloadFunction(start_address, length);
+		return;
+	}
+
 	// Note: we don't actually write emuhacks yet, so we can validate hashes.
 	// This way, if the game changes the code afterward, we'll catch even without icache invalidation.
-
-	// We may go up and down from branches, so track all block starts done here.
-	std::set<u32> doneAddresses;
-	std::vector<u32> pendingAddresses;
-	pendingAddresses.push_back(start_address);
-	while (!pendingAddresses.empty()) {
-		u32 em_address = pendingAddresses.back();
-		pendingAddresses.pop_back();
-
-		// To be safe, also check if a real block is there.  This can be a runtime module load.
-		u32 inst = Memory::ReadUnchecked_U32(em_address);
-		if (MIPS_IS_RUNBLOCK(inst) || doneAddresses.find(em_address) != doneAddresses.end()) {
-			// Already compiled this address.
-			continue;
-		}
-
-		std::vector<IRInst> instructions;
-		u32 mipsBytes;
+	std::lock_guard<std::recursive_mutex> blocksGuard(blocksLock_);
+	WalkFunctionBlocks(start_address, length, [&](u32 em_address, std::vector<IRInst> &instructions, u32 &mipsBytes) {
 		if (!CompileBlock(em_address, instructions, mipsBytes, true)) {
 			// Ran out of block numbers - let's hope there's no more code it needs to run.
 			// Will flush when actually compiling.
 			ERROR_LOG(JIT, "Ran out of block numbers while compiling function");
-			return;
-		}
-
-		doneAddresses.insert(em_address);
-
-		for (const IRInst &inst : instructions) {
-			u32 exit = 0;
-
-			switch (inst.op) {
-			case IROp::ExitToConst:
-			case IROp::ExitToConstIfEq:
-			case IROp::ExitToConstIfNeq:
-			case IROp::ExitToConstIfGtZ:
-			case IROp::ExitToConstIfGeZ:
-			case IROp::ExitToConstIfLtZ:
-			case IROp::ExitToConstIfLeZ:
-			case IROp::ExitToConstIfFpTrue:
-			case IROp::ExitToConstIfFpFalse:
-				exit = inst.constant;
-				break;
-
-			case IROp::ExitToPC:
-			case IROp::Break:
-				// Don't add any, we'll do block end anyway (for jal, etc.)
-				exit = 0;
-				break;
-
-			default:
-				exit = 0;
-				break;
-			}
-
-			// Only follow jumps internal to the function.
-			if (exit != 0 && exit >= start_address && exit < start_address + length) {
-				// Even if it's a duplicate, we check at loop start.
-				pendingAddresses.push_back(exit);
-			}
+			return false;
 		}
-
-		// Also include after the block for jal returns.
-		if (em_address + mipsBytes < start_address + length) {
-			pendingAddresses.push_back(em_address + mipsBytes);
-		}
-	}
+		return true;
+	});
 }
 
 void IRJit::RunLoopUntil(u64 globalticks) {
@@ -217,16 +482,27 @@ void IRJit::RunLoopUntil(u64 globalticks) {
 		if (coreState != 0) {
 			break;
 		}
+		if (nativeResultsReady_) {
+			ApplyNativeResults();
+		}
 		while (mips_->downcount >= 0) {
 			u32 inst = Memory::ReadUnchecked_U32(mips_->pc);
 			u32 opcode = inst & 0xFF000000;
 			if (opcode == MIPS_EMUHACK_OPCODE) {
 				u32 data = inst & 0xFFFFFF;
 				IRBlock *block = blocks_.GetBlock(data);
-				mips_->pc = IRInterpret(mips_, block->GetInstructions(), block->GetNumInstructions());
+				block->MarkReferenced();
+				if (jo.profileBlocks)
+					block->CountExecution();
+				const u8 *nativeEntry = block->GetNativeEntry();
+				if (nativeEntry)
+					mips_->pc = native_->RunBlock(nativeEntry);
+				else
+					mips_->pc = IRInterpret(mips_, block->GetInstructions(), block->GetNumInstructions());
 			} else {
 				// RestoreRoundingMode(true);
-				Compile(mips_->pc);
+				// Goes through JitAt() so compile time is counted the same as the native jits.
+				JitAt();
 				// ApplyRoundingMode(true);
 			}
 		}
@@ -259,6 +535,45 @@ void IRBlockCache::Clear() {
 	}
 	blocks_.clear();
 	byPage_.clear();
+	freeBlocks_.clear();
+}
+
+int IRBlockCache::EvictColdBlocks() {
+	int evicted = 0;
+	for (int i = 0; i < (int)blocks_.size(); ++i) {
+		IRBlock &b = blocks_[i];
+		u32 start, size;
+		b.GetRange(start, size);
+		if (b.TestAndClearReferenced()) {
+			continue;
+		}
+		// Keep preloaded blocks that haven't been linked yet, they haven't had a chance to run.
+		if (start != 0 && !b.IsValid()) {
+			continue;
+		}
+		if (start == 0 && b.GetInstructions() == nullptr) {
+			// Already free.
+			continue;
+		}
+
+		if (start != 0) {
+			u32 startPage = AddressToPage(start);
+			u32 endPage = AddressToPage(start + size);
+			for (u32 page = startPage; page <= endPage; ++page) {
+				auto iter = byPage_.find(page);
+				if (iter == byPage_.end())
+					continue;
+				std::vector<int> &blocksInPage = iter->second;
+				blocksInPage.erase(std::remove(blocksInPage.begin(), blocksInPage.end(), i), blocksInPage.end());
+			}
+		}
+
+		b.Destroy(i);
+		b = IRBlock();
+		freeBlocks_.push_back(i);
+		evicted++;
+	}
+	return evicted;
 }
 
 void IRBlockCache::InvalidateICache(u32 address, u32 length) {
@@ -406,6 +721,36 @@ void IRBlockCache::ComputeStats(BlockCacheStats &bcStats) const {
 	bcStats.avgBloat = totalBloat / (double)blocks_.size();
 }
 
+bool IRBlockCache::GetBlockRange(int blockNum, u32 &start, u32 &size) const {
+	if (blockNum < 0 || blockNum >= (int)blocks_.size() || !blocks_[blockNum].IsValid())
+		return false;
+	blocks_[blockNum].GetRange(start, size);
+	return true;
+}
+
+bool IRBlockCache::GetBlockProfileStats(int blockNum, JitBlockProfileStats &stats) const {
+	if (!profiling_ || blockNum < 0 || blockNum >= (int)blocks_.size() || !blocks_[blockNum].IsValid())
+		return false;
+
+	// Each exit subtracts the cycles up to it, so the largest is the whole block.
+	const IRBlock &block = blocks_[blockNum];
+	const IRInst *instructions = block.GetInstructions();
+	u32 cycles = 0;
+	for (int i = 0; i < block.GetNumInstructions(); i++) {
+		if (instructions[i].op == IROp::Downcount)
+			cycles = std::max(cycles, instructions[i].constant);
+	}
+
+	stats.executions = block.GetExecutions();
+	stats.cycles = stats.executions * cycles;
+	return true;
+}
+
+void IRBlockCache::ResetBlockProfileStats() {
+	for (IRBlock &block : blocks_)
+		block.ResetExecutions();
+}
+
 int IRBlockCache::GetBlockNumberFromStartAddress(u32 em_address, bool realBlocksOnly) const {
 	u32 page = AddressToPage(em_address);
 
@@ -17,7 +17,12 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 
 #include "Common/Common.h"
@@ -35,6 +40,8 @@
 
 namespace MIPSComp {
 
+class IRToNativeInterface;
+
 // TODO : Use arena allocators. For now let's just malloc.
 class IRBlock {
 public:
@@ -47,8 +54,27 @@ class IRBlock {
 		origSize_ = b.origSize_;
 		origFirstOpcode_ = b.origFirstOpcode_;
 		hash_ = b.hash_;
+		nativeEntry_ = b.nativeEntry_;
+		referenced_ = b.referenced_;
+		executions_ = b.executions_;
 		b.instr_ = nullptr;
 	}
+	IRBlock &operator =(IRBlock &&b) {
+		if (this != &b) {
+			delete[] instr_;
+			instr_ = b.instr_;
+			numInstructions_ = b.numInstructions_;
+			origAddr_ = b.origAddr_;
+			origSize_ = b.origSize_;
+			origFirstOpcode_ = b.origFirstOpcode_;
+			hash_ = b.hash_;
+			nativeEntry_ = b.nativeEntry_;
+			referenced_ = b.referenced_;
+			executions_ = b.executions_;
+			b.instr_ = nullptr;
+		}
+		return *this;
+	}
 
 	~IRBlock() {
 		delete[] instr_;
@@ -63,7 +89,21 @@ class IRBlock {
 	}
 
 	const IRInst *GetInstructions() const { return instr_; }
+	// Set when a native backend compiled this block, otherwise it's interpreted.
+	const u8 *GetNativeEntry() const { return nativeEntry_; }
+	void SetNativeEntry(const u8 *entry) { nativeEntry_ = entry; }
 	int GetNumInstructions() const { return numInstructions_; }
+	// Set by the dispatcher, and cleared by each eviction sweep.
+	void MarkReferenced() { referenced_ = true; }
+	bool TestAndClearReferenced() {
+		bool referenced = referenced_;
+		referenced_ = false;
+		return referenced;
+	}
+	// Only counted when jo.profileBlocks is set.
+	void CountExecution() { executions_++; }
+	int64_t GetExecutions() const { return executions_; }
+	void ResetExecutions() { executions_ = 0; }
 	MIPSOpcode GetOriginalFirstOp() const { return origFirstOpcode_; }
 	bool HasOriginalFirstOp() const;
 	bool RestoreOriginalFirstOp(int number);
@@ -95,20 +135,33 @@ class IRBlock {
 	u32 origAddr_;
 	u32 origSize_;
 	u64 hash_ = 0;
+	const u8 *nativeEntry_ = nullptr;
+	bool referenced_ = false;
+	int64_t executions_ = 0;
 	MIPSOpcode origFirstOpcode_ = MIPSOpcode(0x68FFFFFF);
 };
 
 class IRBlockCache : public JitBlockCacheDebugInterface {
 public:
 	IRBlockCache() {}
+	void SetProfiling(bool enabled) { profiling_ = enabled; }
 	void Clear();
 	void InvalidateICache(u32 address, u32 length);
 	void FinalizeBlock(int i, bool preload = false);
 	int GetNumBlocks() const override { return (int)blocks_.size(); }
 	int AllocateBlock(int emAddr) {
+		if (!freeBlocks_.empty()) {
+			int i = freeBlocks_.back();
+			freeBlocks_.pop_back();
+			blocks_[i] = IRBlock(emAddr);
+			return i;
+		}
 		blocks_.push_back(IRBlock(emAddr));
 		return (int)blocks_.size() - 1;
 	}
+	// Clock sweep: frees blocks not run since the last sweep, so their numbers can be reused.
+	// Returns the number of blocks evicted.
+	int EvictColdBlocks();
 	IRBlock *GetBlock(int i) {
 		if (i >= 0 && i < (int)blocks_.size()) {
 			return &blocks_[i];
@@ -124,6 +177,9 @@ class IRBlockCache : public JitBlockCacheDebugInterface {
 
 	JitBlockDebugInfo GetBlockDebugInfo(int blockNum) const override;
 	void ComputeStats(BlockCacheStats &bcStats) const override;
+	bool GetBlockRange(int blockNum, u32 &start, u32 &size) const override;
+	bool GetBlockProfileStats(int blockNum, JitBlockProfileStats &stats) const override;
+	void ResetBlockProfileStats() override;
 	int GetBlockNumberFromStartAddress(u32 em_address, bool realBlocksOnly = true) const override;
 
 private:
@@ -131,6 +187,8 @@ class IRBlockCache : public JitBlockCacheDebugInterface {
 
 	std::vector<IRBlock> blocks_;
 	std::unordered_map<u32, std::vector<int>> byPage_;
+	std::vector<int> freeBlocks_;
+	bool profiling_ = false;
 };
 
 class IRJit : public JitInterface {
@@ -169,10 +227,66 @@ class IRJit : public JitInterface {
 	bool CompileBlock(u32 em_address, std::vector<IRInst> &instructions, u32 &mipsBytes, bool preload);
 	bool ReplaceJalTo(u32 dest);
 
+	void RecycleNativeCode();
+	void QueueNativeCompile(int block_num, const std::vector<IRInst> &instructions);
+	void ApplyNativeResults();
+	void FlushNativeWorker();
+	void NativeWorkerLoop();
+	void QueuePreloadFunction(u32 start_address, u32 length);
+	void ApplyPreloadResults();
+	void PreloadWorkerLoop();
+
+	struct NativeCompileRequest {
+		int blockNum;
+		u32 generation;
+		std::vector<IRInst> instructions;
+	};
+	struct NativeCompileResult {
+		int blockNum;
+		u32 generation;
+		const u8 *entry;
+	};
+
 	JitOptions jo;
 
 	IRFrontend frontend_;
 	IRBlockCache blocks_;
+	// Only available on some architectures, otherwise blocks are always interpreted.
+	IRToNativeInterface *native_ = nullptr;
+
+	// With bBackgroundJit, native code is generated on this thread while blocks are interpreted.
+	// Only the worker touches native_ while it's running, except from FlushNativeWorker().
+	std::thread nativeThread_;
+	std::mutex nativeLock_;
+	std::condition_variable nativeWakeCond_;
+	std::condition_variable nativeIdleCond_;
+	std::deque<NativeCompileRequest> nativeQueue_;
+	std::vector<NativeCompileResult> nativeResults_;
+	std::atomic<bool> nativeResultsReady_{ false };
+	std::atomic<bool> nativeFull_{ false };
+	bool nativeWorkerBusy_ = false;
+	bool nativeWorkerQuit_ = false;
+	// Bumped when the cache is cleared, so that stale results are ignored.
+	u32 nativeGeneration_ = 0;
+
+	struct PreloadRequest {
+		u32 start;
+		u32 length;
+	};
+
+	// With bBackgroundJit, CompileFunction() hands functions to these threads, which run their
+	// own frontends.  Results are hashed, so they're validated by FindPreloadBlock() when used.
+	IROptions irOptions_{};
+	std::vector<std::thread> preloadThreads_;
+	std::mutex preloadLock_;
+	std::condition_variable preloadWakeCond_;
+	std::deque<PreloadRequest> preloadQueue_;
+	std::vector<IRBlock> preloadResults_;
+	std::atomic<bool> preloadResultsReady_{ false };
+	bool preloadWorkerQuit_ = false;
+	// Held by preload workers while compiling, since frontends read blocks_ through GetOriginalOp().
+	// The emu thread holds it while changing blocks_.
+	std::recursive_mutex blocksLock_;
 
 	MIPSState *mips_;
 
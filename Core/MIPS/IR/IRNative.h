@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstring>
+
+#include "Common/CommonTypes.h"
+#include "Core/MIPS/IR/IRInst.h"
+
+namespace MIPSComp {
+
+// Turns optimized IR blocks (after IRApplyPasses) into host code, so every backend shares the IR passes.
+class IRToNativeInterface {
+public:
+	virtual ~IRToNativeInterface() {}
+
+	// Returns the entry point of the generated code, or nullptr if out of space.
+	virtual const u8 *ConvertIRToNative(const IRInst *instructions, int count) = 0;
+	// Runs a block previously generated by ConvertIRToNative, returning the new PC.
+	virtual u32 RunBlock(const u8 *entry) = 0;
+	virtual void Clear() = 0;
+	virtual bool IsFull() const = 0;
+};
+
+// An IRInst fits in a register, so generated code can pass one to the helpers below.
+inline u64 IRPackInst(const IRInst &inst) {
+	static_assert(sizeof(IRInst) == sizeof(u64), "IRInst must pack into 64 bits");
+	u64 raw;
+	memcpy(&raw, &inst, sizeof(raw));
+	return raw;
+}
+
+// For ops a backend doesn't handle itself.  The first returns to the block, the second exits it.
+void IRInterpretSingleInst(u64 raw);
+u32 IRInterpretSingleExit(u64 raw);
+
+}  // namespace
@@ -366,6 +366,9 @@ bool RemoveLoadStoreLeftRight(const IRWriter &in, IRWriter &out, const IROptions
 
 bool PropagateConstants(const IRWriter &in, IRWriter &out, const IROptions &opts) {
 	IRRegCache gpr(&out);
+	for (int i = 0; i < opts.numEntryConstants; i++) {
+		gpr.SetKnownImm(opts.entryConstantRegs[i], opts.entryConstantValues[i]);
+	}
 
 	bool logBlocks = false;
 	for (int i = 0; i < (int)in.GetInstructions().size(); i++) {
@@ -697,9 +700,14 @@ bool PropagateConstants(const IRWriter &in, IRWriter &out, const IROptions &opts
 			goto doDefault;
 
 		case IROp::CallReplacement:
-		case IROp::Break:
 		case IROp::Syscall:
 		case IROp::Interpret:
+			gpr.FlushAll();
+			gpr.DiscardKnown();
+			out.Write(inst);
+			break;
+
+		case IROp::Break:
 		case IROp::ExitToConst:
 		case IROp::ExitToReg:
 		case IROp::ExitToConstIfEq:
@@ -712,13 +720,20 @@ bool PropagateConstants(const IRWriter &in, IRWriter &out, const IROptions &opts
 		case IROp::ExitToConstIfLtZ:
 		case IROp::Breakpoint:
 		case IROp::MemoryCheck:
-		default:
 		{
 			gpr.FlushAll();
 		doDefault:
 			out.Write(inst);
 			break;
 		}
+
+		default:
+		{
+			gpr.FlushAll();
+			gpr.DiscardKnown();
+			out.Write(inst);
+			break;
+		}
 		}
 	}
 	return logBlocks;
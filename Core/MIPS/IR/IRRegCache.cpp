@@ -6,7 +6,7 @@ void IRRegCache::Flush(int rd) {
 	if (rd == 0) {
 		return;
 	}
-	if (reg_[rd].isImm) {
+	if (reg_[rd].isImm && !reg_[rd].isKnown) {
 		ir_->WriteSetConstant(rd, reg_[rd].immVal);
 		reg_[rd].isImm = false;
 	}
@@ -17,6 +17,7 @@ void IRRegCache::Discard(int rd) {
 		return;
 	}
 	reg_[rd].isImm = false;
+	reg_[rd].isKnown = false;
 }
 
 IRRegCache::IRRegCache(IRWriter *ir) : ir_(ir) {
@@ -32,6 +33,13 @@ void IRRegCache::FlushAll() {
 	}
 }
 
+void IRRegCache::DiscardKnown() {
+	for (int i = 1; i < TOTAL_MAPPABLE_MIPSREGS; i++) {
+		if (reg_[i].isKnown)
+			Discard(i);
+	}
+}
+
 void IRRegCache::MapIn(int rd) {
 	Flush(rd);
 }
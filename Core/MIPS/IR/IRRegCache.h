@@ -12,6 +12,8 @@ enum {
 
 struct RegIR {
 	bool isImm;
+	// The value is already in the register, so flushing doesn't need to write it.
+	bool isKnown;
 	u32 immVal;
 };
 
@@ -24,6 +26,12 @@ class IRRegCache {
 
 	void SetImm(int r, u32 immVal) {
 		reg_[r].isImm = true;
+		reg_[r].isKnown = false;
+		reg_[r].immVal = immVal;
+	}
+	void SetKnownImm(int r, u32 immVal) {
+		reg_[r].isImm = true;
+		reg_[r].isKnown = true;
 		reg_[r].immVal = immVal;
 	}
 
@@ -31,6 +39,8 @@ class IRRegCache {
 	u32 GetImm(int r) const { return reg_[r].immVal; }
 
 	void FlushAll();
+	// For ops that may write any register behind our back.
+	void DiscardKnown();
 
 	void MapDirty(int rd);
 	void MapIn(int rd);
@@ -23,6 +23,7 @@
 // locating performance issues.
 
 #include <cstddef>
+#include <cstring>
 #include <algorithm>
 
 #include "Common.h"
@@ -31,10 +32,15 @@
 #include "Common/CommonWindows.h"
 #endif
 
+#include "Common/PerfMap.h"
+#include "Common/StringUtils.h"
+
+#include "Core/Config.h"
 #include "Core/Core.h"
 #include "Core/MemMap.h"
 #include "Core/CoreTiming.h"
 #include "Core/Reporting.h"
+#include "Core/Debugger/SymbolMap.h"
 
 #include "Core/MIPS/MIPS.h"
 #include "Core/MIPS/MIPSTables.h"
@@ -42,6 +48,7 @@
 
 #include "Core/MIPS/JitCommon/JitBlockCache.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
+#include "Core/MIPS/JitCommon/JitWriteWatch.h"
 
 // #include "JitBase.h"
 
@@ -90,6 +97,10 @@ void JitBlockCache::Shutdown() {
 	delete [] blocks_;
 	blocks_ = 0;
 	num_blocks_ = 0;
+	delete [] profileCounters_;
+	profileCounters_ = nullptr;
+	delete [] profileCycles_;
+	profileCycles_ = nullptr;
 #if defined USE_OPROFILE && USE_OPROFILE
 	op_close_agent(agent);
 #endif
@@ -108,6 +119,7 @@ void JitBlockCache::Clear() {
 		DestroyBlock(i, DestroyType::CLEAR);
 	links_to_.clear();
 	num_blocks_ = 0;
+	MIPSComp::WriteWatchReset(g_Config.bJitWriteWatch);
 
 	blockMemRanges_[JITBLOCK_RANGE_SCRATCH] = std::make_pair(0xFFFFFFFF, 0x00000000);
 	blockMemRanges_[JITBLOCK_RANGE_RAMBOTTOM] = std::make_pair(0xFFFFFFFF, 0x00000000);
@@ -154,10 +166,21 @@ int JitBlockCache::AllocateBlock(u32 startAddress) {
 		b.linkStatus[i] = false;
 	}
 	b.blockNum = num_blocks_;
+	if (profileCounters_) {
+		profileCounters_[num_blocks_] = 0;
+		profileCycles_[num_blocks_] = 0;
+	}
 	num_blocks_++; //commit the current block
 	return num_blocks_ - 1;
 }
 
+void JitBlockCache::EnableProfiling() {
+	if (profileCounters_)
+		return;
+	profileCounters_ = new int64_t[MAX_NUM_BLOCKS]();
+	profileCycles_ = new u32[MAX_NUM_BLOCKS]();
+}
+
 void JitBlockCache::ProxyBlock(u32 rootAddress, u32 startAddress, u32 size, const u8 *codePtr) {
 	// If there's an existing block at the startAddress, add rootAddress as a proxy root of that block
 	// instead of creating a new block.
@@ -222,6 +245,21 @@ void JitBlockCache::RemoveBlockMap(int block_num) {
 	}
 }
 
+template <typename F>
+void JitBlockCache::ForEachBlockInRange(u32 pAddr, u32 pEnd, F func) const {
+	// The map is sorted by end address, and no block is longer than MAX_BLOCK_INSTRUCTIONS.
+	// So only blocks ending in [pAddr, pEnd + max size] can overlap - O(log n + k).
+	auto next = block_map_.upper_bound(std::make_pair(pAddr, 0xFFFFFFFF));
+	auto last = block_map_.upper_bound(std::make_pair(pEnd + 4 * MAX_BLOCK_INSTRUCTIONS, 0xFFFFFFFF));
+	for (; next != last; ++next) {
+		const u32 blockStart = next->first.second;
+		const u32 blockEnd = next->first.first;
+		if (blockStart < pEnd && blockEnd > pAddr) {
+			func((int)next->second);
+		}
+	}
+}
+
 static void ExpandRange(std::pair<u32, u32> &range, u32 newStart, u32 newEnd) {
 	range.first = std::min(range.first, newStart);
 	range.second = std::max(range.second, newEnd);
@@ -235,6 +273,7 @@ void JitBlockCache::FinalizeBlock(int block_num, bool block_link) {
 	Memory::Write_Opcode_JIT(b.originalAddress, opcode);
 
 	AddBlockMap(block_num);
+	MIPSComp::WriteWatchAddBlock(b.originalAddress, b.originalSize * 4);
 
 	if (block_link) {
 		for (int i = 0; i < MAX_JIT_BLOCK_EXITS; i++) {
@@ -259,6 +298,14 @@ void JitBlockCache::FinalizeBlock(int block_num, bool block_link) {
 		ExpandRange(blockMemRanges_[JITBLOCK_RANGE_RAMTOP], b.originalAddress, blockEnd);
 	}
 
+	if (PerfMapEnabled()) {
+		std::string name = StringFromFormat("EmuCode_0x%08x", b.originalAddress);
+		u32 funcStart = g_symbolMap ? g_symbolMap->GetFunctionStart(b.originalAddress) : SymbolMap::INVALID_ADDRESS;
+		if (funcStart != SymbolMap::INVALID_ADDRESS)
+			name += " " + g_symbolMap->GetLabelString(funcStart);
+		PerfMapAddCode(b.checkedEntry, b.normalEntry + b.codeSize - b.checkedEntry, name);
+	}
+
 #if defined USE_OPROFILE && USE_OPROFILE
 	char buf[100];
 	sprintf(buf, "EmuCode%x", b.originalAddress);
@@ -356,9 +403,13 @@ int JitBlockCache::GetBlockNumberFromStartAddress(u32 addr, bool realBlocksOnly)
 }
 
 void JitBlockCache::GetBlockNumbersFromAddress(u32 em_address, std::vector<int> *block_numbers) {
-	for (int i = 0; i < num_blocks_; i++)
-		if (blocks_[i].ContainsAddress(em_address))
-			block_numbers->push_back(i);
+	const u32 pAddr = em_address & 0x1FFFFFFF;
+	size_t firstNew = block_numbers->size();
+	ForEachBlockInRange(pAddr, pAddr + 4, [&](int block_num) {
+		block_numbers->push_back(block_num);
+	});
+	// Keep them in block number order, like they were allocated.
+	std::sort(block_numbers->begin() + firstNew, block_numbers->end());
 }
 
 u32 JitBlockCache::GetAddressFromBlockPtr(const u8 *ptr) const {
@@ -563,25 +614,17 @@ void JitBlockCache::InvalidateICache(u32 address, const u32 length) {
 		return;
 	}
 
-	// Blocks may start and end in overlapping ways, and destroying one invalidates iterators.
-	// So after destroying one, we start over.
-	do {
-	restart:
-		auto next = block_map_.lower_bound(std::make_pair(pAddr, 0));
-		auto last = block_map_.upper_bound(std::make_pair(pEnd + MAX_BLOCK_INSTRUCTIONS, 0));
-		// Note that if next is end(), last will be end() too (equal.)
-		for (; next != last; ++next) {
-			const u32 blockStart = next->first.second;
-			const u32 blockEnd = next->first.first;
-			if (blockStart < pEnd && blockEnd > pAddr) {
-				DestroyBlock(next->second, DestroyType::INVALIDATE);
-				// Our iterator is now invalid.  Break and search again.
-				// Most of the time there shouldn't be a bunch of matching blocks.
-				goto restart;
-			}
-		}
-		// We got here - it wasn't in the map at all (or anymore.)
-	} while (false);
+	// Destroying a block modifies the map (and may destroy others through proxies), so collect first.
+	std::vector<int> overlapping;
+	ForEachBlockInRange(pAddr, pEnd, [&](int block_num) {
+		overlapping.push_back(block_num);
+	});
+
+	for (int block_num : overlapping) {
+		// Might have been destroyed already as a proxy root.
+		if (!blocks_[block_num].invalid)
+			DestroyBlock(block_num, DestroyType::INVALIDATE);
+	}
 }
 
 void JitBlockCache::InvalidateChangedBlocks() {
@@ -642,6 +685,33 @@ void JitBlockCache::ComputeStats(BlockCacheStats &bcStats) const {
 	bcStats.avgBloat = totalBloat / (double)num_blocks_;
 }
 
+bool JitBlockCache::GetBlockRange(int blockNum, u32 &start, u32 &size) const {
+	if (blockNum < 0 || blockNum >= num_blocks_)
+		return false;
+	const JitBlock &block = blocks_[blockNum];
+	if (block.invalid || block.IsPureProxy())
+		return false;
+	start = block.originalAddress;
+	size = block.originalSize * 4;
+	return true;
+}
+
+bool JitBlockCache::GetBlockProfileStats(int blockNum, JitBlockProfileStats &stats) const {
+	if (!profileCounters_ || blockNum < 0 || blockNum >= num_blocks_)
+		return false;
+	const JitBlock &block = blocks_[blockNum];
+	if (block.invalid || block.IsPureProxy())
+		return false;
+	stats.executions = profileCounters_[blockNum];
+	stats.cycles = stats.executions * profileCycles_[blockNum];
+	return true;
+}
+
+void JitBlockCache::ResetBlockProfileStats() {
+	if (profileCounters_)
+		memset(profileCounters_, 0, sizeof(int64_t) * num_blocks_);
+}
+
 JitBlockDebugInfo JitBlockCache::GetBlockDebugInfo(int blockNum) const {
 	JitBlockDebugInfo debugInfo{};
 	const JitBlock *block = GetBlock(blockNum);
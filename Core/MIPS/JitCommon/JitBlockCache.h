@@ -93,6 +93,13 @@ struct JitBlock {
 
 typedef void (*CompiledCode)();
 
+// Runtime hotness data, only collected when jo.profileBlocks is set.
+struct JitBlockProfileStats {
+	int64_t executions;
+	// Estimated from the block's downcount, so this assumes the whole block runs each time.
+	int64_t cycles;
+};
+
 struct JitBlockDebugInfo {
 	uint32_t originalAddress;
 	std::vector<std::string> origDisasm;
@@ -106,6 +113,11 @@ class JitBlockCacheDebugInterface {
 	virtual int GetBlockNumberFromStartAddress(u32 em_address, bool realBlocksOnly = true) const = 0;
 	virtual JitBlockDebugInfo GetBlockDebugInfo(int blockNum) const = 0;
 	virtual void ComputeStats(BlockCacheStats &bcStats) const = 0;
+	// Gets the MIPS address and size in bytes.  Returns false for invalid or proxy-only blocks.
+	virtual bool GetBlockRange(int blockNum, u32 &start, u32 &size) const = 0;
+	// Returns false if profiling is off or the block is invalid.
+	virtual bool GetBlockProfileStats(int blockNum, JitBlockProfileStats &stats) const = 0;
+	virtual void ResetBlockProfileStats() = 0;
 
 	virtual ~JitBlockCacheDebugInterface() {}
 };
@@ -127,6 +139,19 @@ class JitBlockCache : public JitBlockCacheDebugInterface {
 
 	bool IsFull() const;
 	void ComputeStats(BlockCacheStats &bcStats) const override;
+	bool GetBlockRange(int blockNum, u32 &start, u32 &size) const override;
+	bool GetBlockProfileStats(int blockNum, JitBlockProfileStats &stats) const override;
+	void ResetBlockProfileStats() override;
+
+	// Allocates the profile counters.  The jit increments GetProfileCounter() on each block entry.
+	void EnableProfiling();
+	int64_t *GetProfileCounter(int block_num) const {
+		return profileCounters_ ? &profileCounters_[block_num] : nullptr;
+	}
+	void SetProfileCycleEstimate(int block_num, int cycles) {
+		if (profileCycles_)
+			profileCycles_[block_num] = cycles;
+	}
 
 	// Code Cache
 	JitBlock *GetBlock(int block_num);
@@ -138,7 +163,7 @@ class JitBlockCache : public JitBlockCacheDebugInterface {
 	// slower, but can get numbers from within blocks, not just the first instruction.
 	// WARNING! WILL NOT WORK WITH JIT INLINING ENABLED (not yet a feature but will be soon)
 	// Returns a list of block numbers - only one block can start at a particular address, but they CAN overlap.
-	// This one is slow so should only be used for one-shots from the debugger UI, not for anything during runtime.
+	// Only finds valid blocks, using the same index as InvalidateICache.
 	void GetBlockNumbersFromAddress(u32 em_address, std::vector<int> *block_numbers);
 	int GetBlockNumberFromEmuHackOp(MIPSOpcode inst, bool ignoreBad = false) const;
 
@@ -175,6 +200,9 @@ class JitBlockCache : public JitBlockCacheDebugInterface {
 
 	void AddBlockMap(int block_num);
 	void RemoveBlockMap(int block_num);
+	// Calls func for each block in block_map_ overlapping the physical range [pAddr, pEnd).
+	template <typename F>
+	void ForEachBlockInRange(u32 pAddr, u32 pEnd, F func) const;
 
 	MIPSOpcode GetEmuHackOpForBlock(int block_num) const;
 
@@ -194,6 +222,9 @@ class JitBlockCache : public JitBlockCacheDebugInterface {
 	};
 	std::pair<u32, u32> blockMemRanges_[3];
 
+	int64_t *profileCounters_ = nullptr;
+	u32 *profileCycles_ = nullptr;
+
 	enum {
 		MAX_NUM_BLOCKS = 65536*2
 	};
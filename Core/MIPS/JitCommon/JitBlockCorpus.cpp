@@ -0,0 +1,96 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstdio>
+
+#include "Common/FileUtil.h"
+#include "Common/Log.h"
+#include "Core/MemMap.h"
+#include "Core/MIPS/JitCommon/JitBlockCache.h"
+#include "Core/MIPS/JitCommon/JitBlockCorpus.h"
+
+namespace MIPSComp {
+
+// File layout: header, then per block the address, op count, and ops.  All little endian u32s.
+static const u32 CORPUS_MAGIC = 0x4342504A;  // JPBC
+static const u32 CORPUS_VERSION = 1;
+// Sanity limit so a corrupt file doesn't allocate the world.
+static const u32 CORPUS_MAX_BLOCK_OPS = 0x10000;
+
+bool SaveJitBlockCorpus(const std::string &filename, const JitBlockCacheDebugInterface *blockCache) {
+	std::vector<JitCorpusBlock> blocks;
+	for (int i = 0; i < blockCache->GetNumBlocks(); ++i) {
+		u32 start, size;
+		if (!blockCache->GetBlockRange(i, start, size) || !Memory::IsValidRange(start, size))
+			continue;
+
+		JitCorpusBlock block;
+		block.address = start;
+		for (u32 addr = start; addr < start + size; addr += 4) {
+			// Skip the emuhack so we get the original instruction.
+			block.ops.push_back(Memory::Read_Instruction(addr, true).encoding);
+		}
+		blocks.push_back(block);
+	}
+
+	FILE *f = File::OpenCFile(filename, "wb");
+	if (!f) {
+		ERROR_LOG(JIT, "Unable to write jit block corpus to %s", filename.c_str());
+		return false;
+	}
+
+	const u32 header[3] = { CORPUS_MAGIC, CORPUS_VERSION, (u32)blocks.size() };
+	bool success = fwrite(header, sizeof(header), 1, f) == 1;
+	for (const JitCorpusBlock &block : blocks) {
+		const u32 blockHeader[2] = { block.address, (u32)block.ops.size() };
+		success = success && fwrite(blockHeader, sizeof(blockHeader), 1, f) == 1;
+		success = success && fwrite(&block.ops[0], sizeof(u32), block.ops.size(), f) == block.ops.size();
+	}
+	fclose(f);
+
+	if (success)
+		INFO_LOG(JIT, "Wrote %d jit blocks to %s", (int)blocks.size(), filename.c_str());
+	return success;
+}
+
+bool LoadJitBlockCorpus(const std::string &filename, std::vector<JitCorpusBlock> &blocks) {
+	FILE *f = File::OpenCFile(filename, "rb");
+	if (!f)
+		return false;
+
+	u32 header[3];
+	bool success = fread(header, sizeof(header), 1, f) == 1 && header[0] == CORPUS_MAGIC && header[1] == CORPUS_VERSION;
+	for (u32 i = 0; success && i < header[2]; ++i) {
+		u32 blockHeader[2];
+		if (fread(blockHeader, sizeof(blockHeader), 1, f) != 1 || blockHeader[1] == 0 || blockHeader[1] > CORPUS_MAX_BLOCK_OPS) {
+			success = false;
+			break;
+		}
+
+		JitCorpusBlock block;
+		block.address = blockHeader[0];
+		block.ops.resize(blockHeader[1]);
+		success = fread(&block.ops[0], sizeof(u32), block.ops.size(), f) == block.ops.size();
+		if (success)
+			blocks.push_back(block);
+	}
+	fclose(f);
+
+	return success;
+}
+
+}  // namespace MIPSComp
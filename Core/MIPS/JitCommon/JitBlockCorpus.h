@@ -0,0 +1,39 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+class JitBlockCacheDebugInterface;
+
+namespace MIPSComp {
+
+// Original MIPS code of a compiled block, as captured from a running game.
+struct JitCorpusBlock {
+	u32 address;
+	std::vector<u32> ops;
+};
+
+// Saves every valid block in the cache, to replay later in unittest's JitCorpus benchmark.
+bool SaveJitBlockCorpus(const std::string &filename, const JitBlockCacheDebugInterface *blockCache);
+bool LoadJitBlockCorpus(const std::string &filename, std::vector<JitCorpusBlock> &blocks);
+
+}  // namespace MIPSComp
@@ -20,6 +20,7 @@
 #include "ext/disarm.h"
 #include "ext/udis86/udis86.h"
 
+#include "base/timeutil.h"
 #include "Common/StringUtils.h"
 #include "Common/ChunkFile.h"
 
@@ -44,8 +45,32 @@
 
 namespace MIPSComp {
 	JitInterface *jit;
+	static bool compileStatsEnabled = false;
+	static JitCompileStats compileStats;
+
 	void JitAt() {
+		if (!compileStatsEnabled) {
+			jit->Compile(currentMIPS->pc);
+			return;
+		}
+
+		double start = real_time_now();
 		jit->Compile(currentMIPS->pc);
+		compileStats.seconds += real_time_now() - start;
+		compileStats.compiles++;
+	}
+
+	void SetJitCompileStatsEnabled(bool enabled) {
+		compileStatsEnabled = enabled;
+	}
+
+	JitCompileStats GetJitCompileStats() {
+		return compileStats;
+	}
+
+	void ResetJitCompileStats() {
+		compileStats.compiles = 0;
+		compileStats.seconds = 0.0;
 	}
 
 	void DoDummyJitState(PointerWrap &p) {
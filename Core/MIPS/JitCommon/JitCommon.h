@@ -43,6 +43,16 @@ class MIPSState;
 namespace MIPSComp {
 	void JitAt();
 
+	// Time spent compiling blocks, only counted while enabled (mainly for benchmarks.)
+	struct JitCompileStats {
+		int64_t compiles;
+		double seconds;
+	};
+
+	void SetJitCompileStatsEnabled(bool enabled);
+	JitCompileStats GetJitCompileStats();
+	void ResetJitCompileStats();
+
 	class MIPSFrontendInterface {
 	public:
 		virtual ~MIPSFrontendInterface() {}
@@ -52,6 +52,7 @@ namespace MIPSComp {
 		continueBranches = false;
 		continueJumps = false;
 		continueMaxInstructions = 300;
+		profileBlocks = g_Config.bJitProfiling;
 
 		useStaticAlloc = false;
 		enablePointerify = false;
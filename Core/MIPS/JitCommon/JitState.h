@@ -70,6 +70,8 @@ namespace MIPSComp {
 		bool compiling;	// TODO: get rid of this in favor of using analysis results to determine end of block
 		bool hadBreakpoints;
 		bool preloading = false;
+		// The block only polls memory and loops on itself, see MIPSAnalyst::IsPollingLoop.
+		bool pollingLoop = false;
 		JitBlock *curBlock;
 
 		u8 hasSetRounding = 0;
@@ -200,6 +202,9 @@ namespace MIPSComp {
 		LSU_FPU = 0x4000,
 		LSU_VFPU = 0x8000,
 
+		FUNCTION_CONSTANTS = 0x00010000,
+		SYSCALL_CONTINUE = 0x00020000,
+
 		SIMD = 0x00100000,
 		BLOCKLINK = 0x00200000,
 		POINTERIFY = 0x00400000,
@@ -243,6 +248,8 @@ namespace MIPSComp {
 		bool continueBranches;
 		bool continueJumps;
 		int continueMaxInstructions;
+		// Count block executions, see JitBlockCacheDebugInterface::GetBlockProfileStats().
+		bool profileBlocks;
 	};
 
 }
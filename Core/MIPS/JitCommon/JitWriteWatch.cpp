@@ -0,0 +1,249 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+#include "ppsspp_config.h"
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+
+#ifdef _WIN32
+#include "Common/CommonWindows.h"
+#endif
+
+#include "Common/MemoryUtil.h"
+#include "Core/MemMap.h"
+#include "Core/MIPS/JitCommon/JitCommon.h"
+#include "Core/MIPS/JitCommon/JitWriteWatch.h"
+
+// Relies on all RAM views living at base + address, so only 64-bit.  UWP can't install handlers.
+#if PPSSPP_ARCH(64BIT) && !PPSSPP_PLATFORM(UWP)
+#define WRITE_WATCH_SUPPORTED
+#endif
+
+namespace MIPSComp {
+
+#ifdef WRITE_WATCH_SUPPORTED
+
+static const u32 RAM_START = 0x08000000;
+// Enough for the extended memory of HD remasters.
+static const u32 MAX_RAM_SIZE = 0x04000000;
+static const u32 MIN_PAGE_SIZE = 0x1000;
+static const int PAGE_WORDS = MAX_RAM_SIZE / MIN_PAGE_SIZE / 32;
+
+// Both bitmaps are touched from the fault handler, possibly on other threads, so only atomics.
+static std::atomic<u32> watchedPages[PAGE_WORDS];
+static std::atomic<u32> dirtyPages[PAGE_WORDS];
+static std::atomic<bool> dirtyPending;
+static bool enabled;
+static bool handlerInstalled;
+static u32 pageShift;
+
+static void ProtectPage(u32 page, bool writable) {
+	const u32 offset = RAM_START + (page << pageShift);
+	const u32 protFlags = writable ? MEM_PROT_READ | MEM_PROT_WRITE : MEM_PROT_READ;
+	// Cached, uncached, and kernel mirrors of the same memory.
+	ProtectMemoryPages(Memory::base + offset, 1 << pageShift, protFlags);
+	ProtectMemoryPages(Memory::base + (offset | 0x40000000), 1 << pageShift, protFlags);
+#ifndef IOS
+	ProtectMemoryPages(Memory::base + (offset | 0x80000000), 1 << pageShift, protFlags);
+#endif
+}
+
+static bool PageForAddress(u32 addr, u32 &page) {
+	addr &= 0x3FFFFFFF;
+	if (addr < RAM_START || addr >= RAM_START + std::min(Memory::g_MemorySize, MAX_RAM_SIZE))
+		return false;
+	page = (addr - RAM_START) >> pageShift;
+	return true;
+}
+
+static bool IsWatched(u32 page) {
+	return (watchedPages[page >> 5].load(std::memory_order_relaxed) & (1U << (page & 31))) != 0;
+}
+
+static bool HandleWriteFault(const void *hostAddr) {
+	if (!enabled || !Memory::base)
+		return false;
+	uintptr_t offset = (uintptr_t)hostAddr - (uintptr_t)Memory::base;
+	u32 page;
+	if (offset > 0xFFFFFFFF || !PageForAddress((u32)offset, page))
+		return false;
+
+	const u32 bit = 1U << (page & 31);
+	u32 wasWatched = watchedPages[page >> 5].fetch_and(~bit) & bit;
+	if (!wasWatched) {
+		// Another thread may be unprotecting it right now, in which case the retry will succeed.
+		return (dirtyPages[page >> 5].load() & bit) != 0;
+	}
+	dirtyPages[page >> 5].fetch_or(bit);
+	ProtectPage(page, true);
+	dirtyPending = true;
+	return true;
+}
+
+#ifdef _WIN32
+static LONG NTAPI WriteWatchExceptionHandler(PEXCEPTION_POINTERS info) {
+	const EXCEPTION_RECORD *record = info->ExceptionRecord;
+	if (record->ExceptionCode != EXCEPTION_ACCESS_VIOLATION || record->NumberParameters < 2)
+		return EXCEPTION_CONTINUE_SEARCH;
+	// Parameter 0 is 1 for writes.
+	if (record->ExceptionInformation[0] != 1)
+		return EXCEPTION_CONTINUE_SEARCH;
+	if (HandleWriteFault((const void *)record->ExceptionInformation[1]))
+		return EXCEPTION_CONTINUE_EXECUTION;
+	return EXCEPTION_CONTINUE_SEARCH;
+}
+
+static void InstallHandler() {
+	AddVectoredExceptionHandler(1, WriteWatchExceptionHandler);
+}
+#else
+static struct sigaction oldSegvAction;
+static struct sigaction oldBusAction;
+
+static void WriteWatchSignalHandler(int sig, siginfo_t *info, void *context) {
+	if (HandleWriteFault(info->si_addr))
+		return;
+
+	struct sigaction *old = sig == SIGBUS ? &oldBusAction : &oldSegvAction;
+	if (old->sa_flags & SA_SIGINFO) {
+		old->sa_sigaction(sig, info, context);
+	} else if (old->sa_handler == SIG_DFL) {
+		// Returning will fault again, this time with the default action.
+		sigaction(sig, old, nullptr);
+	} else if (old->sa_handler != SIG_IGN) {
+		old->sa_handler(sig);
+	}
+}
+
+static void InstallHandler() {
+	struct sigaction action{};
+	action.sa_sigaction = &WriteWatchSignalHandler;
+	action.sa_flags = SA_SIGINFO;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGSEGV, &action, &oldSegvAction);
+	// Some platforms (like macOS) report protection faults as SIGBUS.
+	sigaction(SIGBUS, &action, &oldBusAction);
+}
+#endif
+
+void WriteWatchReset(bool enable) {
+	if (enabled) {
+		for (u32 page = 0; page < (u32)PAGE_WORDS * 32; ++page) {
+			if (IsWatched(page))
+				ProtectPage(page, true);
+		}
+	}
+	for (int i = 0; i < PAGE_WORDS; ++i) {
+		watchedPages[i] = 0;
+		dirtyPages[i] = 0;
+	}
+	dirtyPending = false;
+
+	if (enable && !handlerInstalled) {
+		int pageSize = GetMemoryProtectPageSize();
+		pageShift = 0;
+		while ((1 << pageShift) < pageSize)
+			pageShift++;
+		if (pageShift < 12) {
+			pageShift = 12;
+		}
+		InstallHandler();
+		handlerInstalled = true;
+	}
+	enabled = enable && Memory::base != nullptr;
+}
+
+bool WriteWatchEnabled() {
+	return enabled;
+}
+
+void WriteWatchAddBlock(u32 addr, u32 size) {
+	u32 first, last;
+	if (!enabled || !PageForAddress(addr, first) || !PageForAddress(addr + size - 1, last))
+		return;
+	for (u32 page = first; page <= last; ++page) {
+		if (IsWatched(page))
+			continue;
+		watchedPages[page >> 5].fetch_or(1U << (page & 31));
+		ProtectPage(page, false);
+	}
+}
+
+void WriteWatchRelease(u32 addr, u32 size) {
+	u32 first, last;
+	if (!enabled || size == 0 || !PageForAddress(addr, first) || !PageForAddress(addr + size - 1, last))
+		return;
+	for (u32 page = first; page <= last; ++page) {
+		const u32 bit = 1U << (page & 31);
+		if ((watchedPages[page >> 5].fetch_and(~bit) & bit) != 0) {
+			dirtyPages[page >> 5].fetch_or(bit);
+			ProtectPage(page, true);
+			dirtyPending = true;
+		}
+	}
+}
+
+bool WriteWatchBeginJitWrite(u32 addr) {
+	u32 page;
+	if (!enabled || !PageForAddress(addr, page) || !IsWatched(page))
+		return false;
+	ProtectPage(page, true);
+	return true;
+}
+
+void WriteWatchEndJitWrite(u32 addr) {
+	u32 page;
+	// If something else wrote in between, the fault already unwatched it.
+	if (PageForAddress(addr, page) && IsWatched(page))
+		ProtectPage(page, false);
+}
+
+bool WriteWatchFlush() {
+	if (!dirtyPending.load(std::memory_order_relaxed))
+		return false;
+	dirtyPending = false;
+
+	for (int i = 0; i < PAGE_WORDS; ++i) {
+		u32 bits = dirtyPages[i].exchange(0);
+		while (bits != 0) {
+			int bit = 0;
+			while ((bits & (1U << bit)) == 0)
+				bit++;
+			bits &= ~(1U << bit);
+
+			const u32 page = i * 32 + bit;
+			if (MIPSComp::jit)
+				MIPSComp::jit->InvalidateCacheAt(RAM_START + (page << pageShift), 1 << pageShift);
+		}
+	}
+	return true;
+}
+
+#else
+
+void WriteWatchReset(bool enable) {}
+bool WriteWatchEnabled() { return false; }
+void WriteWatchAddBlock(u32 addr, u32 size) {}
+void WriteWatchRelease(u32 addr, u32 size) {}
+bool WriteWatchBeginJitWrite(u32 addr) { return false; }
+void WriteWatchEndJitWrite(u32 addr) {}
+bool WriteWatchFlush() { return false; }
+
+#endif
+
+}  // namespace MIPSComp
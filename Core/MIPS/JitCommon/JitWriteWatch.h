@@ -0,0 +1,38 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+#pragma once
+
+#include "Common/CommonTypes.h"
+
+namespace MIPSComp {
+
+// Optional page protection on RAM containing compiled blocks.
+// The first write to a watched page unprotects it, and its blocks are invalidated on the next Advance.
+
+// Called on every block cache clear.  Unprotects everything, and decides whether new blocks are watched.
+void WriteWatchReset(bool enable);
+bool WriteWatchEnabled();
+void WriteWatchAddBlock(u32 addr, u32 size);
+// Unprotects a range before the host writes to it outside our control (like file reads.)
+void WriteWatchRelease(u32 addr, u32 size);
+// The jit's own emuhack writes shouldn't count as modifications.
+bool WriteWatchBeginJitWrite(u32 addr);
+void WriteWatchEndJitWrite(u32 addr);
+// Invalidates blocks on written pages.  Must be called outside of jit code, on the CPU thread.
+bool WriteWatchFlush();
+
+}  // namespace MIPSComp
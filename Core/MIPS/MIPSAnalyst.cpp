@@ -15,6 +15,7 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
 #include <map>
 #include <set>
 #include <unordered_map>
@@ -24,6 +25,8 @@
 #include "base/timeutil.h"
 #include "ext/cityhash/city.h"
 #include "Common/FileUtil.h"
+#include "Common/StringUtils.h"
+#include "Common/ThreadPools.h"
 #include "Core/Config.h"
 #include "Core/MemMap.h"
 #include "Core/System.h"
@@ -32,6 +35,8 @@
 #include "Core/MIPS/MIPSTables.h"
 #include "Core/MIPS/MIPSAnalyst.h"
 #include "Core/MIPS/MIPSCodeUtils.h"
+#include "Core/MIPS/JitCommon/JitCommon.h"
+#include "Core/MIPS/JitCommon/JitBlockCache.h"
 #include "Core/Debugger/SymbolMap.h"
 #include "Core/Debugger/DebugInterface.h"
 #include "Core/HLE/ReplaceTables.h"
@@ -872,12 +877,152 @@ namespace MIPSAnalyst {
 		return DetermineRegisterUsage(reg, addr, instrs) == USAGE_CLOBBERED;
 	}
 
-	void HashFunctions() {
-		std::lock_guard<std::recursive_mutex> guard(functions_lock);
+	bool IsPollingLoop(u32 addr) {
+		const int MAX_POLLING_LOOP_INSTRS = 8;
+		// Anything that touches state we don't track, or has side effects.
+		const u64 unsafeFlags = BAD_INSTRUCTION | IS_CONDMOVE | IS_JUMP | IS_FPU | IS_VFPU | IN_OTHER | IN_FPUFLAG | IN_VFPU_CC
+			| IN_FS | IN_FT | IN_LO | IN_HI | IN_VS | IN_VT | OUT_RA | OUT_MEM | OUT_OTHER | OUT_FPUFLAG | OUT_VFPU_CC
+			| OUT_EAT_PREFIX | OUT_FD | OUT_FS | OUT_FT | OUT_LO | OUT_HI | OUT_VD;
+
+		if (!Memory::IsValidRange(addr, (MAX_POLLING_LOOP_INSTRS + 1) * 4)) {
+			return false;
+		}
+
+		// Order of execution: the body, the branch, then the delay slot.
+		MIPSOpcode ops[MAX_POLLING_LOOP_INSTRS + 1];
+		int count = 0;
+		for (u32 pc = addr; count < MAX_POLLING_LOOP_INSTRS; pc += 4) {
+			MIPSOpcode op = Memory::Read_Instruction(pc, true);
+			ops[count++] = op;
+			if (MIPSGetInfo(op) & IS_CONDBRANCH) {
+				if (GetBranchTargetNoRA(pc, op) != addr) {
+					return false;
+				}
+				ops[count++] = Memory::Read_Instruction(pc + 4, true);
+				break;
+			}
+		}
+		if (!(MIPSGetInfo(ops[count - 2]) & IS_CONDBRANCH)) {
+			return false;
+		}
+
+		u32 writtenInLoop = 0;
+		for (int i = 0; i < count; ++i) {
+			MIPSGPReg out = GetOutGPReg(ops[i]);
+			if (out != MIPS_REG_INVALID)
+				writtenInLoop |= 1 << out;
+		}
+
+		// Every value must come from memory or be loop invariant, so each iteration computes the same thing.
+		bool hasLoad = false;
+		u32 writtenSoFar = 0;
+		for (int i = 0; i < count; ++i) {
+			MIPSInfo info = MIPSGetInfo(ops[i]);
+			bool isBranch = i == count - 2;
+			if ((info & unsafeFlags) || (!isBranch && (info & IS_CONDBRANCH))) {
+				return false;
+			}
+			if (info & IN_MEM) {
+				if ((info & MEMTYPE_MASK) == 0)
+					return false;
+				hasLoad = true;
+			}
+
+			u32 carried = writtenInLoop & ~writtenSoFar;
+			if ((info & IN_RS) && (carried & (1 << MIPS_GET_RS(ops[i]))) != 0)
+				return false;
+			if ((info & IN_RT) && (carried & (1 << MIPS_GET_RT(ops[i]))) != 0)
+				return false;
+
+			MIPSGPReg out = GetOutGPReg(ops[i]);
+			if (out != MIPS_REG_INVALID)
+				writtenSoFar |= 1 << out;
+		}
+
+		return hasLoad;
+	}
+
+	static bool IsCalleeSavedReg(MIPSGPReg reg) {
+		return (reg >= MIPS_REG_S0 && reg <= MIPS_REG_S7) || reg == MIPS_REG_FP;
+	}
+
+	int GetFunctionEntryConstants(u32 addr, MIPSGPReg *regs, u32 *values, int maxCount) {
+		if (!g_symbolMap) {
+			return 0;
+		}
+		const u32 funcStart = g_symbolMap->GetFunctionStart(addr);
+		if (funcStart == SymbolMap::INVALID_ADDRESS) {
+			return 0;
+		}
+		const u32 funcEnd = funcStart + g_symbolMap->GetFunctionSize(funcStart);
+		if (addr >= funcEnd || !Memory::IsValidRange(funcStart, funcEnd - funcStart)) {
+			return 0;
+		}
+
+		struct Definition {
+			u32 value;
+			u32 start;
+			u32 end;
+		};
+		Definition defs[32]{};
+
+		// Only the entry, up to the first branch, surely runs before any other block in the function.
+		for (u32 pc = funcStart; pc < addr; pc += 4) {
+			MIPSOpcode op = Memory::Read_Instruction(pc, true);
+			if (MIPSGetInfo(op) & (IS_CONDBRANCH | IS_JUMP)) {
+				break;
+			}
+			MIPSGPReg rt = MIPS_GET_RT(op);
+			if (MIPS_GET_OP(op) != 0x0F || !IsCalleeSavedReg(rt)) {
+				continue;
+			}
+
+			Definition &def = defs[rt];
+			def.value = (op & 0xFFFF) << 16;
+			def.start = pc;
+			def.end = pc + 4;
+
+			MIPSOpcode next = Memory::Read_Instruction(pc + 4, true);
+			if (pc + 4 < addr && MIPS_GET_RT(next) == rt && MIPS_GET_RS(next) == rt) {
+				if (MIPS_GET_OP(next) == 0x0D) {
+					def.value |= next & 0xFFFF;
+					def.end = pc + 8;
+				} else if (MIPS_GET_OP(next) == 0x09) {
+					def.value += (s32)(s16)(next & 0xFFFF);
+					def.end = pc + 8;
+				}
+			}
+		}
+
+		// Any other write (including a second lui) invalidates the value.  Calls preserve these by ABI.
+		// A jr ra before addr may mean two functions were merged, so the caller's values could be live.
+		for (u32 pc = funcStart; pc < funcEnd; pc += 4) {
+			MIPSOpcode op = Memory::Read_Instruction(pc, true);
+			if (pc < addr && op == MIPS_MAKE_JR_RA()) {
+				return 0;
+			}
+			MIPSGPReg out = GetOutGPReg(op);
+			if (out != MIPS_REG_INVALID && defs[out].end != 0 && (pc < defs[out].start || pc >= defs[out].end)) {
+				defs[out].end = 0;
+			}
+		}
+
+		int count = 0;
+		for (int r = 0; r < 32 && count < maxCount; ++r) {
+			if (defs[r].end != 0 && defs[r].end <= addr) {
+				regs[count] = (MIPSGPReg)r;
+				values[count] = defs[r].value;
+				count++;
+			}
+		}
+		return count;
+	}
+
+	static void HashFunctionRange(int lower, int upper) {
 		std::vector<u32> buffer;
 
-		for (auto iter = functions.begin(), end = functions.end(); iter != end; iter++) {
-			AnalyzedFunction &f = *iter;
+		for (int i = lower; i < upper; ++i) {
+			AnalyzedFunction &f = functions[i];
 			if (!Memory::IsValidRange(f.start, f.end - f.start + 4)) {
 				continue;
 			}
@@ -908,6 +1053,12 @@ namespace MIPSAnalyst {
 		}
 	}
 
+	void HashFunctions() {
+		std::lock_guard<std::recursive_mutex> guard(functions_lock);
+		// Functions hash independently, and there can be tens of thousands once a few PRXs are loaded.
+		GlobalThreadPool::Loop(&HashFunctionRange, 0, (int)functions.size());
+	}
+
 	void PrecompileFunction(u32 startAddr, u32 length) {
 		// Direct calls to this ignore the bPreloadFunctions flag, since it's just for stubs.
 		if (MIPSComp::jit) {
@@ -934,6 +1085,187 @@ namespace MIPSAnalyst {
 		NOTICE_LOG(JIT, "Precompiled %d MIPS functions in %0.2f milliseconds", (int)functions.size(), (et - st) * 1000.0);
 	}
 
+	struct BlockProfileEntry {
+		u32 start;
+		u32 size;
+	};
+
+	struct BlockProfileHeader {
+		char magic[4];
+		u32 version;
+		u32 startAddr;
+		u32 endAddr;
+		u32 count;
+	};
+
+	struct ProfiledModule {
+		u32 startAddr;
+		u32 endAddr;
+		u64 hash;
+		std::vector<BlockProfileEntry> blocks;
+		bool pending;
+	};
+
+	static const char *BLOCK_PROFILE_MAGIC = "PJBP";
+	static const u32 BLOCK_PROFILE_VERSION = 1;
+	// Don't let a profile grow beyond what the jit could reasonably hold.
+	static const size_t BLOCK_PROFILE_MAX_BLOCKS = 32768;
+
+	static std::vector<ProfiledModule> profiledModules;
+	static std::mutex profiledModulesLock;
+
+	static std::string BlockProfileFilename(u64 hash) {
+		return GetSysDirectory(DIRECTORY_APP_CACHE) + StringFromFormat("%016llx.jitprofile", (unsigned long long)hash);
+	}
+
+	u64 HashCodeRange(u32 startAddr, u32 endAddr) {
+		// Note: endAddr is inclusive.
+		if (endAddr < startAddr || !Memory::IsValidRange(startAddr, endAddr - startAddr + 4))
+			return 0;
+
+		// Hash the original ops, so already compiled blocks don't change the result.
+		std::vector<u32> buffer;
+		buffer.reserve((endAddr - startAddr) / 4 + 1);
+		for (u32 addr = startAddr; addr <= endAddr; addr += 4) {
+			buffer.push_back(Memory::ReadUnchecked_Instruction(addr, false).encoding);
+		}
+		return XXH64(&buffer[0], buffer.size() * sizeof(u32), 0x4A495450);
+	}
+
+	void LoadBlockProfile(u32 startAddr, u32 endAddr) {
+		if (!g_Config.bPersistentJitProfile || !MIPSComp::jit) {
+			return;
+		}
+
+		ProfiledModule module{ startAddr, endAddr, HashCodeRange(startAddr, endAddr) };
+		if (module.hash == 0)
+			return;
+
+		FILE *file = File::OpenCFile(BlockProfileFilename(module.hash), "rb");
+		if (file) {
+			BlockProfileHeader header{};
+			bool valid = fread(&header, sizeof(header), 1, file) == 1;
+			valid = valid && memcmp(header.magic, BLOCK_PROFILE_MAGIC, 4) == 0 && header.version == BLOCK_PROFILE_VERSION;
+			// The hash covers the code, but the module must also be at the same place.
+			valid = valid && header.startAddr == startAddr && header.endAddr == endAddr;
+			if (valid && header.count <= BLOCK_PROFILE_MAX_BLOCKS) {
+				module.blocks.resize(header.count);
+				if (header.count != 0 && fread(&module.blocks[0], sizeof(BlockProfileEntry), header.count, file) != header.count) {
+					WARN_LOG(JIT, "Truncated jit block profile for %08x-%08x", startAddr, endAddr);
+					module.blocks.clear();
+				}
+			}
+			fclose(file);
+		}
+
+		// Throw away anything that doesn't fit the module, in case the file was damaged.
+		module.blocks.erase(std::remove_if(module.blocks.begin(), module.blocks.end(), [&](const BlockProfileEntry &b) {
+			return b.start < startAddr || b.start > endAddr || (b.start & 3) != 0;
+		}), module.blocks.end());
+		module.pending = !module.blocks.empty();
+
+		std::lock_guard<std::mutex> guard(profiledModulesLock);
+		profiledModules.push_back(module);
+	}
+
+	// Called between jit runs, since compiling may require clearing the cache.
+	void PrecompileProfiledBlocks() {
+		std::lock_guard<std::mutex> guard(profiledModulesLock);
+		if (!MIPSComp::jit) {
+			return;
+		}
+
+		for (ProfiledModule &module : profiledModules) {
+			if (!module.pending)
+				continue;
+			module.pending = false;
+
+			// The game may have changed its code since loading, so verify again.
+			if (HashCodeRange(module.startAddr, module.endAddr) != module.hash) {
+				WARN_LOG(JIT, "Module at %08x changed since load, skipping jit block profile", module.startAddr);
+				continue;
+			}
+
+			double st = real_time_now();
+			int count = 0;
+			for (const BlockProfileEntry &b : module.blocks) {
+				if (MIPS_IS_RUNBLOCK(Memory::ReadUnchecked_U32(b.start)))
+					continue;
+				MIPSComp::jit->Compile(b.start);
+				count++;
+			}
+			double et = real_time_now();
+
+			NOTICE_LOG(JIT, "Precompiled %d profiled jit blocks in %0.2f milliseconds", count, (et - st) * 1000.0);
+		}
+	}
+
+	static void StoreProfiledModule(const ProfiledModule &module) {
+		JitBlockCacheDebugInterface *blockCache = MIPSComp::jit->GetBlockCacheDebugInterface();
+		std::set<u32> seen;
+		std::vector<BlockProfileEntry> blocks;
+
+		for (int i = 0; i < blockCache->GetNumBlocks() && blocks.size() < BLOCK_PROFILE_MAX_BLOCKS; ++i) {
+			u32 start, size;
+			if (!blockCache->GetBlockRange(i, start, size))
+				continue;
+			if (start < module.startAddr || start > module.endAddr)
+				continue;
+			if (seen.insert(start).second)
+				blocks.push_back(BlockProfileEntry{ start, size });
+		}
+		// Keep what we had, so a cache clear during the session doesn't lose blocks.
+		for (const BlockProfileEntry &b : module.blocks) {
+			if (blocks.size() >= BLOCK_PROFILE_MAX_BLOCKS)
+				break;
+			if (seen.insert(b.start).second)
+				blocks.push_back(b);
+		}
+
+		if (blocks.empty())
+			return;
+
+		std::string filename = BlockProfileFilename(module.hash);
+		FILE *file = File::OpenCFile(filename, "wb");
+		if (!file) {
+			WARN_LOG(JIT, "Could not store jit block profile: %s", filename.c_str());
+			return;
+		}
+
+		BlockProfileHeader header{};
+		memcpy(header.magic, BLOCK_PROFILE_MAGIC, 4);
+		header.version = BLOCK_PROFILE_VERSION;
+		header.startAddr = module.startAddr;
+		header.endAddr = module.endAddr;
+		header.count = (u32)blocks.size();
+		if (fwrite(&header, sizeof(header), 1, file) != 1 || fwrite(&blocks[0], sizeof(BlockProfileEntry), blocks.size(), file) != blocks.size()) {
+			WARN_LOG(JIT, "Could not store jit block profile: %s", filename.c_str());
+		}
+		fclose(file);
+	}
+
+	void StoreBlockProfile(u32 startAddr, u32 endAddr) {
+		std::lock_guard<std::mutex> guard(profiledModulesLock);
+		for (auto it = profiledModules.begin(); it != profiledModules.end(); ++it) {
+			if (it->startAddr == startAddr && it->endAddr == endAddr) {
+				if (MIPSComp::jit)
+					StoreProfiledModule(*it);
+				profiledModules.erase(it);
+				break;
+			}
+		}
+	}
+
+	void StoreBlockProfiles() {
+		std::lock_guard<std::mutex> guard(profiledModulesLock);
+		if (MIPSComp::jit) {
+			for (const ProfiledModule &module : profiledModules) {
+				StoreProfiledModule(module);
+			}
+		}
+		profiledModules.clear();
+	}
+
 	static const char *DefaultFunctionName(char buffer[256], u32 startAddr) {
 		sprintf(buffer, "z_un_%08x", startAddr);
 		return buffer;
@@ -81,6 +81,12 @@ namespace MIPSAnalyst
 	bool IsRegisterUsed(MIPSGPReg reg, u32 addr, int instrs);
 	// This tells us if the reg is clobbered within intrs of addr (e.g. it is surely not used.)
 	bool IsRegisterClobbered(MIPSGPReg reg, u32 addr, int instrs);
+	// Finds callee-saved regs set by a lui (+ ori/addiu) in the straight-line entry of the function
+	// containing addr and never written elsewhere in it, so they're known at addr.  Returns the count.
+	int GetFunctionEntryConstants(u32 addr, MIPSGPReg *regs, u32 *values, int maxCount);
+	// True if addr starts a short loop that only loads memory and branches back to addr, so it can't
+	// exit until something else (a thread, interrupt, or event) changes memory.
+	bool IsPollingLoop(u32 addr);
 
 	struct AnalyzedFunction {
 		u32 start;
@@ -112,6 +118,14 @@ namespace MIPSAnalyst
 	void PrecompileFunctions();
 	void PrecompileFunction(u32 startAddr, u32 length);
 
+	// Per-module profiles of compiled jit blocks, keyed by a hash of the module's code.
+	// On load, blocks from a matching profile are queued and compiled before the core runs again.
+	u64 HashCodeRange(u32 startAddr, u32 endAddr);
+	void LoadBlockProfile(u32 startAddr, u32 endAddr);
+	void PrecompileProfiledBlocks();
+	void StoreBlockProfile(u32 startAddr, u32 endAddr);
+	void StoreBlockProfiles();
+
 	void SetHashMapFilename(const std::string& filename = "");
 	void LoadBuiltinHashMap();
 	void LoadHashMap(const std::string& filename);
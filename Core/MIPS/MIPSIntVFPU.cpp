@@ -101,39 +101,69 @@ inline float nanclamp(float f, float lower, float upper)
 }
 
 
-void ApplyPrefixST(float *r, u32 data, VectorSize size, float invalid = 0.0f) {
-	// Possible optimization shortcut:
-	if (data == 0xe4)
-		return;
+// Each lane becomes (source lane & andMask) ^ xorMask.  Constants use an andMask of 0.
+struct DecodedPrefixST {
+	u32 data;
+	int n;
+	u8 src[4];
+	u32 andMask[4];
+	u32 xorMask[4];
+};
 
-	int n = GetNumVectorElements(size);
-	float origV[4]{ invalid, invalid, invalid, invalid };
-	static const float constantArray[8] = {0.f, 1.f, 2.f, 0.5f, 3.f, 1.f/3.f, 0.25f, 1.f/6.f};
+// Decoding is most of the cost, and games tend to reuse a handful of prefixes.
+static DecodedPrefixST decodedPrefixST[16];
 
-	for (int i = 0; i < n; i++) {
-		origV[i] = r[i];
-	}
+static const DecodedPrefixST &DecodePrefixST(u32 data, int n) {
+	DecodedPrefixST &decoded = decodedPrefixST[(data ^ (data >> 8) ^ (data >> 16) ^ n) & 15];
+	if (decoded.data == data && decoded.n == n)
+		return decoded;
 
+	static const float constantArray[8] = {0.f, 1.f, 2.f, 0.5f, 3.f, 1.f/3.f, 0.25f, 1.f/6.f};
+	decoded.data = data;
+	decoded.n = n;
 	for (int i = 0; i < n; i++) {
 		int regnum = (data >> (i*2)) & 3;
 		int abs    = (data >> (8+i)) & 1;
 		int negate = (data >> (16+i)) & 1;
 		int constants = (data >> (12+i)) & 1;
 
+		decoded.src[i] = regnum;
 		if (!constants) {
 			if (regnum >= n) {
 				// We mostly handle this now, but still worth reporting.
 				ERROR_LOG_REPORT(CPU, "Invalid VFPU swizzle: %08x: %i / %d at PC = %08x (%s)", data, regnum, n, currentMIPS->pc, MIPSDisasmAt(currentMIPS->pc));
 			}
-			r[i] = origV[regnum];
-			if (abs)
-				((u32 *)r)[i] = ((u32 *)r)[i] & 0x7FFFFFFF;
+			decoded.andMask[i] = abs ? 0x7FFFFFFF : 0xFFFFFFFF;
+			decoded.xorMask[i] = 0;
 		} else {
-			r[i] = constantArray[regnum + (abs<<2)];
+			float c = constantArray[regnum + (abs << 2)];
+			decoded.andMask[i] = 0;
+			memcpy(&decoded.xorMask[i], &c, sizeof(c));
 		}
 
 		if (negate)
-			((u32 *)r)[i] = ((u32 *)r)[i] ^ 0x80000000;
+			decoded.xorMask[i] ^= 0x80000000;
+	}
+	return decoded;
+}
+
+void ApplyPrefixST(float *r, u32 data, VectorSize size, float invalid = 0.0f) {
+	// Possible optimization shortcut:
+	if (data == 0xe4)
+		return;
+
+	int n = GetNumVectorElements(size);
+	const DecodedPrefixST &decoded = DecodePrefixST(data, n);
+	u32 origV[4];
+	memcpy(&origV[0], &invalid, sizeof(float));
+	for (int i = 1; i < 4; i++) {
+		origV[i] = origV[0];
+	}
+	memcpy(origV, r, n * sizeof(float));
+
+	u32 *ru = (u32 *)r;
+	for (int i = 0; i < n; i++) {
+		ru[i] = (origV[decoded.src[i]] & decoded.andMask[i]) ^ decoded.xorMask[i];
 	}
 }
 
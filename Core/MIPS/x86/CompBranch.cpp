@@ -26,6 +26,7 @@
 #include "Core/HLE/HLETables.h"
 #include "Core/Host.h"
 #include "Core/MemMap.h"
+#include "Core/System.h"
 
 #include "Core/MIPS/MIPS.h"
 #include "Core/MIPS/MIPSCodeUtils.h"
@@ -794,6 +795,33 @@ void Jit::Comp_Syscall(MIPSOpcode op)
 		ABI_CallFunctionP(quickFunc, (void *)GetSyscallFuncPointer(op));
 	else
 		ABI_CallFunctionC(&CallSyscall, op.encoding);
+
+	// Most syscalls don't reschedule, stop the core, or invalidate this block, so just keep going.
+	if (quickFunc && !js.inDelaySlot && !jo.Disabled(JitDisable::SYSCALL_CONTINUE)) {
+		ApplyRoundingMode();
+		CMP(32, MIPSSTATE_VAR(pc), Imm32(GetCompilerPC() + 4));
+		FixupBranch changedPC = J_CC(CC_NE, true);
+		if (RipAccessible((const void *)&coreState)) {
+			CMP(32, M(&coreState), Imm32(0));  // rip accessible
+		} else {
+			MOV(PTRBITS, R(RAX), ImmPtr((const void *)&coreState));
+			CMP(32, MatR(RAX), Imm32(0));
+		}
+		FixupBranch badCoreState = J_CC(CC_NZ, true);
+		if (RipAccessible(&js.curBlock->invalid)) {
+			CMP(8, M(&js.curBlock->invalid), Imm8(0));  // rip accessible
+		} else {
+			MOV(PTRBITS, R(RAX), ImmPtr(&js.curBlock->invalid));
+			CMP(8, MatR(RAX), Imm8(0));
+		}
+		FixupBranch stillValid = J_CC(CC_Z, true);
+
+		SetJumpTarget(changedPC);
+		SetJumpTarget(badCoreState);
+		WriteSyscallExit();
+		SetJumpTarget(stillValid);
+		return;
+	}
 #endif
 
 	ApplyRoundingMode();
@@ -73,6 +73,17 @@ alignas(16) const u32 signBitLower[4] = {0x80000000, 0, 0, 0};
 alignas(16) const float oneOneOneOne[4] = {1.0f, 1.0f, 1.0f, 1.0f};
 alignas(16) const u32 fourinfnan[4] = {0x7F800000, 0x7F800000, 0x7F800000, 0x7F800000};
 alignas(16) const float identityMatrix[4][4] = { { 1.0f, 0, 0, 0 }, { 0, 1.0f, 0, 0 }, { 0, 0, 1.0f, 0 }, { 0, 0, 0, 1.0f} };
+alignas(16) const float minusOneMinusOne[4] = {-1.0f, -1.0f, -1.0f, -1.0f};
+
+// Indexed by the 4 abs or negate bits of an S/T prefix.
+#define PREFIX_LANE_MASKS(on, off) \
+	{ off, off, off, off }, { on, off, off, off }, { off, on, off, off }, { on, on, off, off }, \
+	{ off, off, on, off }, { on, off, on, off }, { off, on, on, off }, { on, on, on, off }, \
+	{ off, off, off, on }, { on, off, off, on }, { off, on, off, on }, { on, on, off, on }, \
+	{ off, off, on, on }, { on, off, on, on }, { off, on, on, on }, { on, on, on, on }
+alignas(16) const u32 prefixAbsMasks[16][4] = { PREFIX_LANE_MASKS(0x7FFFFFFF, 0xFFFFFFFF) };
+alignas(16) const u32 prefixNegateMasks[16][4] = { PREFIX_LANE_MASKS(0x80000000, 0) };
+#undef PREFIX_LANE_MASKS
 
 void Jit::Comp_VPFX(MIPSOpcode op)
 {
@@ -95,8 +106,63 @@ void Jit::Comp_VPFX(MIPSOpcode op)
 	}
 }
 
+// Swizzle, abs, and negate prefixes on a vector already in a SIMD reg become a SHUFPS and masks.
+bool Jit::TryApplyPrefixSTSIMD(u8 *vregs, u32 prefix, VectorSize sz) {
+	int n = GetNumVectorElements(sz);
+	if (!jo.enableVFPUSIMD || n < 2 || (prefix & 0x0000F000) != 0)
+		return false;
+	if (!fpr.IsMappedVS(vregs, sz))
+		return false;
+
+	u8 shuffle = 0;
+	for (int i = 0; i < 4; i++) {
+		int regnum = i < n ? (prefix >> (i * 2)) & 3 : i;
+		if (regnum >= n)
+			return false;
+		shuffle |= regnum << (i * 2);
+	}
+	const int laneMask = (1 << n) - 1;
+	const int abs = (prefix >> 8) & laneMask;
+	const int negate = (prefix >> 16) & laneMask;
+
+	u8 origV[4];
+	memcpy(origV, vregs, n);
+	fpr.SpillLockV(origV, sz);
+
+	// This puts the value into a temp reg, so we won't write the modified value back.
+	fpr.GetTempVS(vregs, sz);
+	fpr.MapRegsVS(vregs, sz, MAP_NOINIT | MAP_DIRTY);
+	X64Reg dest = fpr.VSX(vregs);
+
+	MOVAPS(dest, fpr.VS(origV));
+	if (shuffle != 0xE4)
+		SHUFPS(dest, R(dest), shuffle);
+	if (abs) {
+		if (RipAccessible(prefixAbsMasks)) {
+			ANDPS(dest, M(prefixAbsMasks[abs]));  // rip accessible
+		} else {
+			MOV(PTRBITS, R(TEMPREG), ImmPtr(prefixAbsMasks[abs]));
+			ANDPS(dest, MatR(TEMPREG));
+		}
+	}
+	if (negate) {
+		if (RipAccessible(prefixNegateMasks)) {
+			XORPS(dest, M(prefixNegateMasks[negate]));  // rip accessible
+		} else {
+			MOV(PTRBITS, R(TEMPREG), ImmPtr(prefixNegateMasks[negate]));
+			XORPS(dest, MatR(TEMPREG));
+		}
+	}
+
+	fpr.ReleaseSpillLockV(origV, sz);
+	fpr.ReleaseSpillLockV(vregs, sz);
+	return true;
+}
+
 void Jit::ApplyPrefixST(u8 *vregs, u32 prefix, VectorSize sz) {
 	if (prefix == 0xE4) return;
+	if (TryApplyPrefixSTSIMD(vregs, prefix, sz))
+		return;
 
 	int n = GetNumVectorElements(sz);
 	u8 origV[4];
@@ -178,6 +244,9 @@ void Jit::ApplyPrefixD(const u8 *vregs, VectorSize sz) {
 	if (!js.prefixD) return;
 
 	int n = GetNumVectorElements(sz);
+	if (TryApplyPrefixDSIMD(vregs, sz))
+		return;
+
 	for (int i = 0; i < n; i++) {
 		if (js.VfpuWriteMask(i))
 			continue;
@@ -218,6 +287,55 @@ void Jit::ApplyPrefixD(const u8 *vregs, VectorSize sz) {
 	}
 }
 
+// Saturates all lanes at once, when they share the same mode and the result is already in a SIMD reg.
+bool Jit::TryApplyPrefixDSIMD(const u8 *vregs, VectorSize sz) {
+	int n = GetNumVectorElements(sz);
+	if (!jo.enableVFPUSIMD || n < 2 || !fpr.IsMappedVS(vregs, sz))
+		return false;
+	int sat = js.prefixD & 3;
+	if (sat != 1 && sat != 3)
+		return false;
+	for (int i = 0; i < n; i++) {
+		if (js.VfpuWriteMask(i) || ((js.prefixD >> (i * 2)) & 3) != sat)
+			return false;
+	}
+
+	fpr.MapRegsVS(vregs, sz, MAP_DIRTY);
+	X64Reg dest = fpr.VSX(vregs);
+	if (sat == 1) {
+		// Zero out XMM0 if it was <= +0.0f (but skip NAN.)
+		MOVAPS(XMM0, R(dest));
+		XORPS(XMM1, R(XMM1));
+		CMPPS(XMM0, R(XMM1), CMP_LE);
+		ANDNPS(XMM0, R(dest));
+	} else {
+		// Check for < -1.0f, but careful of NANs.
+		if (RipAccessible(minusOneMinusOne)) {
+			MOVAPS(XMM1, M(minusOneMinusOne));  // rip accessible
+		} else {
+			MOV(PTRBITS, R(TEMPREG), ImmPtr(minusOneMinusOne));
+			MOVAPS(XMM1, MatR(TEMPREG));
+		}
+		MOVAPS(XMM0, R(dest));
+		CMPPS(XMM0, R(XMM1), CMP_LE);
+		// If it was NOT less, the three ops below do nothing.
+		// Otherwise, they replace the value with -1.0f.
+		ANDPS(XMM1, R(XMM0));
+		ANDNPS(XMM0, R(dest));
+		ORPS(XMM0, R(XMM1));
+	}
+
+	// Retain a NAN in XMM0 (must be second operand.)
+	if (RipAccessible(oneOneOneOne)) {
+		MOVAPS(dest, M(oneOneOneOne));  // rip accessible
+	} else {
+		MOV(PTRBITS, R(TEMPREG), ImmPtr(oneOneOneOne));
+		MOVAPS(dest, MatR(TEMPREG));
+	}
+	MINPS(dest, R(XMM0));
+	return true;
+}
+
 // Vector regs can overlap in all sorts of swizzled ways.
 // This does allow a single overlap in sregs[i].
 bool IsOverlapSafeAllowS(int dreg, int di, int sn, u8 sregs[], int tn = 0, u8 tregs[] = NULL) {
@@ -609,6 +727,19 @@ void Jit::Comp_VIdt(MIPSOpcode op) {
 	fpr.ReleaseSpillLocks();
 }
 
+// Fills all four lanes of dest with the float in src.  With AVX this is a single instruction.
+void Jit::CompSplatV(X64Reg dest, OpArg src) {
+	if (cpu_info.bAVX && !src.IsSimpleReg()) {
+		VBROADCASTSS(dest, src);
+	} else if (cpu_info.bAVX) {
+		VSHUFPS(dest, src.GetSimpleReg(), src, _MM_SHUFFLE(0, 0, 0, 0));
+	} else {
+		if (!src.IsSimpleReg(dest))
+			MOVSS(dest, src);
+		SHUFPS(dest, R(dest), _MM_SHUFFLE(0, 0, 0, 0));
+	}
+}
+
 void Jit::Comp_VDot(MIPSOpcode op) {
 	CONDITIONAL_DISABLE(VFPU_VEC);
 
@@ -629,6 +760,15 @@ void Jit::Comp_VDot(MIPSOpcode op) {
 	// Benchmarking will have to decide whether to enable this on < SSE4.1. Also a HADDPS version
 	// for SSE3 could be written.
 	if (fpr.TryMapDirtyInInVS(dregs, V_Single, sregs, sz, tregs, sz)) {
+		if (cpu_info.bAVX && sz != V_Single) {
+			// VDPPS doesn't destroy its sources, so no copies are needed even if D overlaps S or T.
+			const u8 mask = sz == V_Pair ? 0x31 : (sz == V_Triple ? 0x71 : 0xF1);
+			VDPPS(fpr.VSX(dregs), fpr.VSX(sregs), fpr.VS(tregs), mask);
+			ApplyPrefixD(dregs, V_Single);
+			fpr.ReleaseSpillLocks();
+			return;
+		}
+
 		switch (sz) {
 		case V_Pair:
 			if (cpu_info.bSSE4_1) {
@@ -724,8 +864,12 @@ void Jit::Comp_VDot(MIPSOpcode op) {
 	for (int i = 1; i < n; i++)
 	{
 		// sum += s[i]*t[i];
-		MOVSS(XMM1, fpr.V(sregs[i]));
-		MULSS(XMM1, fpr.V(tregs[i]));
+		if (cpu_info.bAVX && fpr.V(sregs[i]).IsSimpleReg()) {
+			VMULSS(XMM1, fpr.VX(sregs[i]), fpr.V(tregs[i]));
+		} else {
+			MOVSS(XMM1, fpr.V(sregs[i]));
+			MULSS(XMM1, fpr.V(tregs[i]));
+		}
 		ADDSS(tempxreg, R(XMM1));
 	}
 
@@ -772,6 +916,9 @@ void Jit::Comp_VHdp(MIPSOpcode op) {
 		// sum += (i == n-1) ? t[i] : s[i]*t[i];
 		if (i == n - 1) {
 			ADDSS(tempxreg, fpr.V(tregs[i]));
+		} else if (cpu_info.bAVX && fpr.V(sregs[i]).IsSimpleReg()) {
+			VMULSS(XMM1, fpr.VX(sregs[i]), fpr.V(tregs[i]));
+			ADDSS(tempxreg, R(XMM1));
 		} else {
 			MOVSS(XMM1, fpr.V(sregs[i]));
 			MULSS(XMM1, fpr.V(tregs[i]));
@@ -2756,13 +2903,18 @@ void Jit::Comp_VScl(MIPSOpcode op) {
 	GetVectorRegsPrefixD(dregs, sz, _VD);
 
 	if (fpr.TryMapDirtyInInVS(dregs, sz, sregs, sz, &scale, V_Single, true)) {
-		MOVSS(XMM0, fpr.VS(&scale));
-		if (sz != V_Single)
-			SHUFPS(XMM0, R(XMM0), _MM_SHUFFLE(0, 0, 0, 0));
-		if (dregs[0] != sregs[0]) {
-			MOVAPS(fpr.VSX(dregs), fpr.VS(sregs));
+		if (cpu_info.bAVX) {
+			CompSplatV(XMM0, fpr.VS(&scale));
+			VMULPS(fpr.VSX(dregs), fpr.VSX(sregs), R(XMM0));
+		} else {
+			MOVSS(XMM0, fpr.VS(&scale));
+			if (sz != V_Single)
+				SHUFPS(XMM0, R(XMM0), _MM_SHUFFLE(0, 0, 0, 0));
+			if (dregs[0] != sregs[0]) {
+				MOVAPS(fpr.VSX(dregs), fpr.VS(sregs));
+			}
+			MULPS(fpr.VSX(dregs), R(XMM0));
 		}
-		MULPS(fpr.VSX(dregs), R(XMM0));
 		ApplyPrefixD(dregs, sz);
 		fpr.ReleaseSpillLocks();
 		return;
@@ -2869,6 +3021,19 @@ void Jit::Comp_Vmmul(MIPSOpcode op) {
 
 		// Shorter than manually stuffing the registers. But it feels like ther'es room for optimization here...
 		auto transposeInPlace = [=](u8 col[4][4]) {
+			if (cpu_info.bAVX) {
+				// Three-operand unpacks let us do this with only the two temps and no moves.
+				VUNPCKLPS(XMM0, fpr.VSX(col[0]), fpr.VS(col[2]));
+				VUNPCKHPS(XMM1, fpr.VSX(col[0]), fpr.VS(col[2]));
+				VUNPCKLPS(fpr.VSX(col[2]), fpr.VSX(col[1]), fpr.VS(col[3]));
+				VUNPCKHPS(fpr.VSX(col[3]), fpr.VSX(col[1]), fpr.VS(col[3]));
+				VUNPCKLPS(fpr.VSX(col[0]), XMM0, fpr.VS(col[2]));
+				VUNPCKHPS(fpr.VSX(col[1]), XMM0, fpr.VS(col[2]));
+				VUNPCKLPS(fpr.VSX(col[2]), XMM1, fpr.VS(col[3]));
+				VUNPCKHPS(fpr.VSX(col[3]), XMM1, fpr.VS(col[3]));
+				return;
+			}
+
 			MOVAPS(XMM0, fpr.VS(col[0]));
 			UNPCKLPS(fpr.VSX(col[0]), fpr.VS(col[2]));
 			UNPCKHPS(XMM0, fpr.VS(col[2]));
@@ -2899,16 +3064,13 @@ void Jit::Comp_Vmmul(MIPSOpcode op) {
 		// Now, work our way through the matrix, loading things as we go.
 		// TODO: With more temp registers, can generate much more efficient code.
 		for (int i = 0; i < n; i++) {
-			MOVSS(XMM1, fpr.V(tregs[4 * i]));  // TODO: AVX broadcastss to replace this and the SHUFPS
-			MOVSS(XMM0, fpr.V(tregs[4 * i + 1]));
-			SHUFPS(XMM1, R(XMM1), _MM_SHUFFLE(0, 0, 0, 0));
-			SHUFPS(XMM0, R(XMM0), _MM_SHUFFLE(0, 0, 0, 0));
+			CompSplatV(XMM1, fpr.V(tregs[4 * i]));
+			CompSplatV(XMM0, fpr.V(tregs[4 * i + 1]));
 			MULPS(XMM1, fpr.VS(scol[0]));
 			MULPS(XMM0, fpr.VS(scol[1]));
 			ADDPS(XMM1, R(XMM0));
 			for (int j = 2; j < n; j++) {
-				MOVSS(XMM0, fpr.V(tregs[4 * i + j]));
-				SHUFPS(XMM0, R(XMM0), _MM_SHUFFLE(0, 0, 0, 0));
+				CompSplatV(XMM0, fpr.V(tregs[4 * i + j]));
 				MULPS(XMM0, fpr.VS(scol[j]));
 				ADDPS(XMM1, R(XMM0));
 			}
@@ -3116,13 +3278,12 @@ void Jit::Comp_Vtfm(MIPSOpcode op) {
 
 		// Now, work our way through the matrix, loading things as we go.
 		// TODO: With more temp registers, can generate much more efficient code.
-		MOVSS(XMM1, fpr.V(tregs[0]));  // TODO: AVX broadcastss to replace this and the SHUFPS (but take care of temps, unless we force store them.)
-		SHUFPS(XMM1, R(XMM1), _MM_SHUFFLE(0, 0, 0, 0));
+		// Temps may be in registers, CompSplatV handles both.
+		CompSplatV(XMM1, fpr.V(tregs[0]));
 		MULPS(XMM1, fpr.VS(scol[0]));
 		for (int j = 1; j < n; j++) {
 			if (!homogenous || j != n - 1) {
-				MOVSS(XMM0, fpr.V(tregs[j]));
-				SHUFPS(XMM0, R(XMM0), _MM_SHUFFLE(0, 0, 0, 0));
+				CompSplatV(XMM0, fpr.V(tregs[j]));
 				MULPS(XMM0, fpr.VS(scol[j]));
 				ADDPS(XMM1, R(XMM0));
 			} else {
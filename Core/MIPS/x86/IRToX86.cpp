@@ -1,299 +1,624 @@
 #include "ppsspp_config.h"
-#if PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
+#if PPSSPP_ARCH(AMD64)
 
+#include <cstring>
+
+#include "Common/ABI.h"
+#include "Core/CoreTiming.h"
+#include "Core/MemMap.h"
+#include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/IR/IRInterpreter.h"
 #include "Core/MIPS/x86/IRToX86.h"
+#include "Core/MIPS/x86/RegCache.h"
 
 namespace MIPSComp {
 
+using namespace Gen;
+using namespace X64JitConstants;
+
 // Initial attempt at converting IR directly to x86.
 // This is intended to be an easy way to benefit from the IR with the current infrastructure.
 // Later tries may go across multiple blocks and a different representation.
+//
+// For now, every IR instruction loads its operands from MIPSState and writes its result back,
+// using EAX/ECX/EDX and XMM0/XMM1 as scratch. Ops that are rare or have tricky semantics
+// call back into the IR interpreter for that single instruction.
+
+alignas(16) static const float vec4InitValues[8][4] = {
+	{ 0.0f, 0.0f, 0.0f, 0.0f },
+	{ 1.0f, 1.0f, 1.0f, 1.0f },
+	{ -1.0f, -1.0f, -1.0f, -1.0f },
+	{ 1.0f, 0.0f, 0.0f, 0.0f },
+	{ 0.0f, 1.0f, 0.0f, 0.0f },
+	{ 0.0f, 0.0f, 1.0f, 0.0f },
+	{ 0.0f, 0.0f, 0.0f, 1.0f },
+};
 
-struct GPRMapping {
-	Gen::OpArg dest;
-	Gen::OpArg src1;
-	Gen::OpArg src2;
+alignas(16) static const u32 signBits[4] = {
+	0x80000000, 0x80000000, 0x80000000, 0x80000000,
 };
 
-struct FPRMapping {
-	Gen::OpArg dest;
-	Gen::OpArg src1;
-	Gen::OpArg src2;
+alignas(16) static const u32 noSignMask[4] = {
+	0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF,
 };
 
+// CTXREG points at f[0], so IR GPRs (indexed from r[0]) are at a negative offset.
+static OpArg IRGPR(int reg) {
+	return MDisp(CTXREG, reg * 4 - (int)offsetof(MIPSState, f[0]));
+}
 
-class GreedyRegallocGPR {
-public:
-	GPRMapping Map(IRInst inst, const IRMeta &meta);
+static OpArg IRFPR(int reg) {
+	return MDisp(CTXREG, reg * 4);
+}
 
-private:
-	
-};
+IRToX86::IRToX86(MIPSState *mips) : mips_(mips) {
+	AllocCodeSpace(1024 * 1024 * 16);
+	GenerateFixedCode();
+}
+
+void IRToX86::GenerateFixedCode() {
+	BeginWrite();
+
+	enterBlock_ = (EnterBlockFunc)AlignCode16();
+	ABI_PushAllCalleeSavedRegsAndAdjustStack();
+	MOV(64, R(MEMBASEREG), ImmPtr(Memory::base));
+	// From the start of the FP reg, a single byte offset can reach all GPR + all FPR (but no VFPUR)
+	MOV(PTRBITS, R(CTXREG), ImmPtr(&mips_->f[0]));
+	JMPptr(R(ABI_PARAM1));
+
+	// Blocks jump here with the new PC in EAX.
+	exitBlock_ = AlignCode16();
+	ABI_PopAllCalleeSavedRegsAndAdjustStack();
+	RET();
+
+	EndWrite();
+	fixedCodeSize_ = (int)GetOffset(GetCodePtr());
+}
 
+void IRToX86::Clear() {
+	ClearCodeSpace(fixedCodeSize_);
+}
+
+bool IRToX86::IsFull() const {
+	return GetSpaceLeft() < 0x10000;
+}
 
-GPRMapping GreedyRegallocGPR::Map(IRInst inst, const IRMeta &meta) {
-	GPRMapping mapping;
-	if (meta.types[0] == 'G') {
+const u8 *IRToX86::ConvertIRToNative(const IRInst *instructions, int count) {
+	// Each IR instruction turns into at most a few dozen bytes.
+	if (GetSpaceLeft() < (size_t)count * 64 + 0x100)
+		return nullptr;
 
+	BeginWrite(count * 64);
+	const u8 *start = AlignCode16();
+
+	// Loop through all the instructions, emitting code as we go.
+	for (int i = 0; i < count; i++) {
+		if (!ConvertInst(instructions[i])) {
+			EmitFallback(instructions[i]);
+		}
 	}
-	// etc..
-	return mapping;
+
+	// If we got here, the block was badly constructed (same as the interpreter.)
+	INT3();
+
+	EndWrite();
+	return start;
 }
 
-// Every 4 registers can also be mapped into an SSE register.
-// When changing from single to vec4 mapping, we'll just flush, for now.
-class GreedyRegallocFPR {
-public:
-	FPRMapping Map(IRInst inst, const IRMeta &meta);
-};
+void IRToX86::EmitAddress(const IRInst &inst) {
+	MOV(32, R(EAX), IRGPR(inst.src1));
+	if (inst.constant != 0)
+		ADD(32, R(EAX), Imm32(inst.constant));
+#ifdef MASKED_PSP_MEMORY
+	AND(32, R(EAX), Imm32(Memory::MEMVIEW32_MASK));
+#endif
+}
 
-FPRMapping GreedyRegallocFPR::Map(IRInst inst, const IRMeta &meta) {
-	FPRMapping mapping;
+void IRToX86::EmitExit(OpArg pc) {
+	if (!pc.IsSimpleReg(EAX))
+		MOV(32, R(EAX), pc);
+	JMP(exitBlock_, true);
+}
 
-	return mapping;
+void IRToX86::EmitConditionalExit(CCFlags skipCond, u32 target) {
+	FixupBranch skip = J_CC(skipCond);
+	EmitExit(Imm32(target));
+	SetJumpTarget(skip);
 }
 
+void IRToX86::EmitFallback(const IRInst &inst) {
+	MOV(64, R(ABI_PARAM1), Imm64(IRPackInst(inst)));
+	ABI_CallFunction((const void *)&IRInterpretSingleInst);
+}
 
-// This requires that ThreeOpToTwoOp has been run as the last pass.
-void IRToX86::ConvertIRToNative(const IRInst *instructions, int count, const u32 *constants) {
-	// Set up regcaches
-	using namespace Gen;
+void IRToX86::EmitExitFallback(const IRInst &inst) {
+	MOV(64, R(ABI_PARAM1), Imm64(IRPackInst(inst)));
+	ABI_CallFunction((const void *)&IRInterpretSingleExit);
+	EmitExit(R(EAX));
+}
 
-	GreedyRegallocGPR gprAlloc;
-	GreedyRegallocFPR fprAlloc;
+// Returns false if the op should be interpreted instead.
+bool IRToX86::ConvertInst(const IRInst &inst) {
+	const OpArg memArg = MComplex(MEMBASEREG, RAX, SCALE_1, 0);
+
+	switch (inst.op) {
+	case IROp::Nop:
+		_assert_(false);
+		break;
+
+	case IROp::SetConst:
+		MOV(32, IRGPR(inst.dest), Imm32(inst.constant));
+		break;
+	case IROp::SetConstF:
+		MOV(32, IRFPR(inst.dest), Imm32(inst.constant));
+		break;
+
+	case IROp::Mov:
+		if (inst.dest != inst.src1) {
+			MOV(32, R(EAX), IRGPR(inst.src1));
+			MOV(32, IRGPR(inst.dest), R(EAX));
+		}
+		break;
+
+		// 3-op arithmetic that directly corresponds to x86.
+	case IROp::Add:
+	case IROp::Sub:
+	case IROp::And:
+	case IROp::Or:
+	case IROp::Xor:
+		MOV(32, R(EAX), IRGPR(inst.src1));
+		switch (inst.op) {
+		case IROp::Add: ADD(32, R(EAX), IRGPR(inst.src2)); break;
+		case IROp::Sub: SUB(32, R(EAX), IRGPR(inst.src2)); break;
+		case IROp::And: AND(32, R(EAX), IRGPR(inst.src2)); break;
+		case IROp::Or: OR(32, R(EAX), IRGPR(inst.src2)); break;
+		case IROp::Xor: XOR(32, R(EAX), IRGPR(inst.src2)); break;
+		default: break;
+		}
+		MOV(32, IRGPR(inst.dest), R(EAX));
+		break;
+
+		// 2-op arithmetic with constant.  When dest == src1, operate on memory directly.
+	case IROp::AddConst:
+	case IROp::SubConst:
+	case IROp::AndConst:
+	case IROp::OrConst:
+	case IROp::XorConst:
+	{
+		bool inPlace = inst.dest == inst.src1;
+		OpArg dst = inPlace ? IRGPR(inst.dest) : R(EAX);
+		if (!inPlace)
+			MOV(32, R(EAX), IRGPR(inst.src1));
+		switch (inst.op) {
+		case IROp::AddConst: ADD(32, dst, Imm32(inst.constant)); break;
+		case IROp::SubConst: SUB(32, dst, Imm32(inst.constant)); break;
+		case IROp::AndConst: AND(32, dst, Imm32(inst.constant)); break;
+		case IROp::OrConst: OR(32, dst, Imm32(inst.constant)); break;
+		case IROp::XorConst: XOR(32, dst, Imm32(inst.constant)); break;
+		default: break;
+		}
+		if (!inPlace)
+			MOV(32, IRGPR(inst.dest), R(EAX));
+		break;
+	}
 
-	// Loop through all the instructions, emitting code as we go.
-	// Note that we do need to implement them all - fallbacks are not permitted.
-	for (int i = 0; i < count; i++) {
-		const IRInst *inst = &instructions[i];
-		const IRMeta &meta = *GetIRMeta(inst->op);
-		GPRMapping gpr = gprAlloc.Map(*inst, meta);
-		FPRMapping fpr = fprAlloc.Map(*inst, meta);
-
-		bool symmetric = false;
-		switch (inst->op) {
-		case IROp::Nop:
-			_assert_(false);
-			break;
-
-			// Output-only
-		case IROp::SetConst:
-			code_->MOV(32, gpr.dest, Imm32(constants[inst->src1]));
-			break;
-		case IROp::SetConstF:
-			code_->MOV(32, gpr.dest, Imm32(constants[inst->src1]));
-			break;
-
-			// Add gets to be special cased because we have LEA.
-		case IROp::Add:
-			if (gpr.dest.IsSimpleReg() && gpr.src1.IsSimpleReg() && gpr.src2.IsSimpleReg()) {
-				code_->LEA(32, gpr.dest.GetSimpleReg(), MRegSum(gpr.src1.GetSimpleReg(), gpr.src2.GetSimpleReg()));
-				break;
-			}
-			// Else fall through.
-			// 3-op arithmetic that directly corresponds to x86
-			// (often 2-op in practice if src1 == dst). x86 only does 2-op though so some of these will need splitting.
-		case IROp::Sub:
-		case IROp::And:
-		case IROp::Or:
-		case IROp::Xor:
-			if (inst->src1 != inst->dest) {
-				code_->MOV(32, gpr.dest, gpr.src1);
-			}
-			// Emit directly
-			switch (inst->op) {
-			case IROp::Add: code_->ADD(32, gpr.dest, gpr.src2); break;
-			case IROp::Sub: code_->SUB(32, gpr.dest, gpr.src2); break;
-			case IROp::And: code_->AND(32, gpr.dest, gpr.src2); break;
-			case IROp::Or: code_->OR(32, gpr.dest, gpr.src2); break;
-			case IROp::Xor: code_->XOR(32, gpr.dest, gpr.src2); break;
-			}
-			break;
-
-			// Variable shifts.
-		case IROp::Shl:
-		case IROp::Shr:
-		case IROp::Sar:
-		case IROp::Ror:
-
-		case IROp::Slt:
-		case IROp::SltU:
-		case IROp::MovZ:
-		case IROp::MovNZ:
-		case IROp::Max:
-		case IROp::Min:
-			break;
-
-			// 2-op arithmetic with constant
-		case IROp::AddConst:
-		case IROp::SubConst:
-		case IROp::AndConst:
-		case IROp::OrConst:
-		case IROp::XorConst:
-		case IROp::SltConst:
-		case IROp::SltUConst:
-
-			// 2-op arithmetic with immediate
-		case IROp::ShlImm:
-		case IROp::ShrImm:
-		case IROp::SarImm:
-		case IROp::RorImm:
-
-			// 2-op arithmetic
-		case IROp::Mov:
-			code_->MOV(32, gpr.dest, gpr.src1);
-			break;
-
-		case IROp::Neg:
-		case IROp::Not:
-		case IROp::Ext8to32:
-		case IROp::Ext16to32:
-		case IROp::ReverseBits:
-		case IROp::BSwap16:
-		case IROp::BSwap32:
-		case IROp::Clz:
-			if (inst->dest != inst->src1) {
-				code_->NEG(32, gpr.dest); break;
-			}
-			break;
-				// Multiplier control
-		case IROp::MtLo:
-		case IROp::MtHi:
-		case IROp::MfLo:
-		case IROp::MfHi:
-		case IROp::Mult:
-		case IROp::MultU:
-		case IROp::Madd:
-		case IROp::MaddU:
-		case IROp::Msub:
-		case IROp::MsubU:
-		case IROp::Div:
-		case IROp::DivU:
-
-			// Memory access
-		case IROp::Load8:
-		case IROp::Load8Ext:
-		case IROp::Load16:
-		case IROp::Load16Ext:
-		case IROp::Load32:
-		case IROp::LoadFloat:
-		case IROp::Store8:
-		case IROp::Store16:
-		case IROp::Store32:
-		case IROp::StoreFloat:
-		case IROp::LoadVec4:
-		case IROp::StoreVec4:
-
-			// Output-only SIMD functions
-		case IROp::Vec4Init:
-		case IROp::Vec4Shuffle:
-
-			// 2-op SIMD functions
-		case IROp::Vec4Mov:
-			code_->MOVAPS(fpr.dest.GetSimpleReg(), fpr.src1);
-			break;
-		case IROp::Vec4Neg:
-		case IROp::Vec4Abs:
-			break;
-		case IROp::Vec4ClampToZero:
-			code_->PXOR(XMM0, R(XMM0));
-			code_->PMAXSW(XMM0, fpr.src1);
-			code_->MOVAPD(fpr.dest, XMM0);
-			break;
-		case IROp::Vec4DuplicateUpperBitsAndShift1:
-		case IROp::Vec2ClampToZero:
-
-			// 3-op SIMD functions
-		case IROp::Vec4Add:
-		case IROp::Vec4Sub:
-		case IROp::Vec4Mul:
-		case IROp::Vec4Div:
-
-		case IROp::Vec4Scale:
-		case IROp::Vec4Dot:
-
-			// Pack-unpack
-		case IROp::Vec2Unpack16To31:
-		case IROp::Vec2Unpack16To32:
-		case IROp::Vec4Unpack8To32:
-		case IROp::Vec2Pack32To16:
-		case IROp::Vec2Pack31To16:
-		case IROp::Vec4Pack32To8:
-		case IROp::Vec4Pack31To8:
-
-		case IROp::FCmpVfpuBit:
-		case IROp::FCmpVfpuAggregate:
-		case IROp::FCmovVfpuCC:
-
-			// Trancendental functions (non-simd)
-		case IROp::FSin:
-		case IROp::FCos:
-		case IROp::FRSqrt:
-		case IROp::FRecip:
-		case IROp::FAsin:
-
-			// 3-Op FP
-		case IROp::FAdd:
-		case IROp::FSub:
-		case IROp::FMul:
-		case IROp::FDiv:
-		case IROp::FMin:
-		case IROp::FMax:
-
-			// 2-Op FP
-		case IROp::FMov:
-		case IROp::FAbs:
-		case IROp::FSqrt:
-		case IROp::FNeg:
-		case IROp::FSat0_1:
-		case IROp::FSatMinus1_1:
-		case IROp::FSign:
-		case IROp::FCeil:
-		case IROp::FFloor:
-		case IROp::FCmp:
-		case IROp::FCvtSW:
-		case IROp::FCvtWS:
-		case IROp::FRound:
-		case IROp::FTrunc:
-
-			// Cross moves
-		case IROp::FMovFromGPR:
-		case IROp::FMovToGPR:
-		case IROp::FpCondToReg:
-		case IROp::VfpuCtrlToReg:
-
-			// VFPU flag/control
-		case IROp::SetCtrlVFPU:
-		case IROp::SetCtrlVFPUReg:
-		case IROp::SetCtrlVFPUFReg:
-		case IROp::ZeroFpCond:
-
-			// Block Exits
-		case IROp::ExitToConst:
-		case IROp::ExitToReg:
-		case IROp::ExitToConstIfEq:
-		case IROp::ExitToConstIfNeq:
-		case IROp::ExitToConstIfGtZ:
-		case IROp::ExitToConstIfGeZ:
-		case IROp::ExitToConstIfLtZ:
-		case IROp::ExitToConstIfLeZ:
-		case IROp::ExitToPC:
-
-			// Utilities
-		case IROp::Downcount:
-		case IROp::SetPC:
-		case IROp::SetPCConst:
-		case IROp::Syscall:
-		case IROp::Interpret:  // SLOW fallback. Can be made faster.
-		case IROp::CallReplacement:
-		case IROp::Break:
-		default:
-			break;
+	case IROp::Neg:
+	case IROp::Not:
+		MOV(32, R(EAX), IRGPR(inst.src1));
+		if (inst.op == IROp::Neg)
+			NEG(32, R(EAX));
+		else
+			NOT(32, R(EAX));
+		MOV(32, IRGPR(inst.dest), R(EAX));
+		break;
+
+		// Variable shifts.  x86 masks the count to 5 bits, same as MIPS.
+	case IROp::Shl:
+	case IROp::Shr:
+	case IROp::Sar:
+	case IROp::Ror:
+		MOV(32, R(ECX), IRGPR(inst.src2));
+		MOV(32, R(EAX), IRGPR(inst.src1));
+		switch (inst.op) {
+		case IROp::Shl: SHL(32, R(EAX), R(ECX)); break;
+		case IROp::Shr: SHR(32, R(EAX), R(ECX)); break;
+		case IROp::Sar: SAR(32, R(EAX), R(ECX)); break;
+		case IROp::Ror: ROR(32, R(EAX), R(ECX)); break;
+		default: break;
+		}
+		MOV(32, IRGPR(inst.dest), R(EAX));
+		break;
+
+	case IROp::ShlImm:
+	case IROp::ShrImm:
+	case IROp::SarImm:
+	case IROp::RorImm:
+		MOV(32, R(EAX), IRGPR(inst.src1));
+		if (inst.src2 != 0) {
+			switch (inst.op) {
+			case IROp::ShlImm: SHL(32, R(EAX), Imm8(inst.src2)); break;
+			case IROp::ShrImm: SHR(32, R(EAX), Imm8(inst.src2)); break;
+			case IROp::SarImm: SAR(32, R(EAX), Imm8(inst.src2)); break;
+			case IROp::RorImm: ROR(32, R(EAX), Imm8(inst.src2)); break;
+			default: break;
 			}
 		}
+		MOV(32, IRGPR(inst.dest), R(EAX));
+		break;
+
+	case IROp::Slt:
+	case IROp::SltU:
+	case IROp::SltConst:
+	case IROp::SltUConst:
+		XOR(32, R(ECX), R(ECX));
+		MOV(32, R(EAX), IRGPR(inst.src1));
+		if (inst.op == IROp::Slt || inst.op == IROp::SltU)
+			CMP(32, R(EAX), IRGPR(inst.src2));
+		else
+			CMP(32, R(EAX), Imm32(inst.constant));
+		SETcc(inst.op == IROp::Slt || inst.op == IROp::SltConst ? CC_L : CC_B, R(ECX));
+		MOV(32, IRGPR(inst.dest), R(ECX));
+		break;
+
+	case IROp::Clz:
+		// BSR leaves dest undefined (and sets Z) for 0, so we use 63 to get 32 after the XOR.
+		MOV(32, R(ECX), Imm32(63));
+		BSR(32, EAX, IRGPR(inst.src1));
+		CMOVcc(32, EAX, R(ECX), CC_Z);
+		XOR(32, R(EAX), Imm8(31));
+		MOV(32, IRGPR(inst.dest), R(EAX));
+		break;
+
+	case IROp::MovZ:
+	case IROp::MovNZ:
+		MOV(32, R(EAX), IRGPR(inst.dest));
+		CMP(32, IRGPR(inst.src1), Imm8(0));
+		CMOVcc(32, EAX, IRGPR(inst.src2), inst.op == IROp::MovZ ? CC_Z : CC_NZ);
+		MOV(32, IRGPR(inst.dest), R(EAX));
+		break;
+
+	case IROp::Max:
+	case IROp::Min:
+		MOV(32, R(EAX), IRGPR(inst.src1));
+		CMP(32, R(EAX), IRGPR(inst.src2));
+		CMOVcc(32, EAX, IRGPR(inst.src2), inst.op == IROp::Max ? CC_L : CC_G);
+		MOV(32, IRGPR(inst.dest), R(EAX));
+		break;
+
+	case IROp::BSwap16:
+	case IROp::BSwap32:
+		MOV(32, R(EAX), IRGPR(inst.src1));
+		BSWAP(32, EAX);
+		if (inst.op == IROp::BSwap16)
+			ROR(32, R(EAX), Imm8(16));
+		MOV(32, IRGPR(inst.dest), R(EAX));
+		break;
+
+	case IROp::Ext8to32:
+		MOVSX(32, 8, EAX, IRGPR(inst.src1));
+		MOV(32, IRGPR(inst.dest), R(EAX));
+		break;
+	case IROp::Ext16to32:
+		MOVSX(32, 16, EAX, IRGPR(inst.src1));
+		MOV(32, IRGPR(inst.dest), R(EAX));
+		break;
+
+		// Multiplier control
+	case IROp::MtLo:
+		MOV(32, R(EAX), IRGPR(inst.src1));
+		MOV(32, MIPSSTATE_VAR(lo), R(EAX));
+		break;
+	case IROp::MtHi:
+		MOV(32, R(EAX), IRGPR(inst.src1));
+		MOV(32, MIPSSTATE_VAR(hi), R(EAX));
+		break;
+	case IROp::MfLo:
+		MOV(32, R(EAX), MIPSSTATE_VAR(lo));
+		MOV(32, IRGPR(inst.dest), R(EAX));
+		break;
+	case IROp::MfHi:
+		MOV(32, R(EAX), MIPSSTATE_VAR(hi));
+		MOV(32, IRGPR(inst.dest), R(EAX));
+		break;
+
+		// lo and hi are adjacent, so we can treat them as a single 64-bit value.
+	case IROp::Mult:
+	case IROp::Madd:
+	case IROp::Msub:
+		MOVSX(64, 32, RAX, IRGPR(inst.src1));
+		MOVSX(64, 32, RDX, IRGPR(inst.src2));
+		IMUL(64, RAX, R(RDX));
+		if (inst.op == IROp::Mult)
+			MOV(64, MIPSSTATE_VAR(lo), R(RAX));
+		else if (inst.op == IROp::Madd)
+			ADD(64, MIPSSTATE_VAR(lo), R(RAX));
+		else
+			SUB(64, MIPSSTATE_VAR(lo), R(RAX));
+		break;
+	case IROp::MultU:
+	case IROp::MaddU:
+	case IROp::MsubU:
+		// 32-bit moves zero extend, and the low 64 bits of the product don't depend on signedness.
+		MOV(32, R(EAX), IRGPR(inst.src1));
+		MOV(32, R(EDX), IRGPR(inst.src2));
+		IMUL(64, RAX, R(RDX));
+		if (inst.op == IROp::MultU)
+			MOV(64, MIPSSTATE_VAR(lo), R(RAX));
+		else if (inst.op == IROp::MaddU)
+			ADD(64, MIPSSTATE_VAR(lo), R(RAX));
+		else
+			SUB(64, MIPSSTATE_VAR(lo), R(RAX));
+		break;
+
+		// Memory access
+	case IROp::Load8:
+	case IROp::Load8Ext:
+	case IROp::Load16:
+	case IROp::Load16Ext:
+	case IROp::Load32:
+	case IROp::LoadFloat:
+		EmitAddress(inst);
+		switch (inst.op) {
+		case IROp::Load8: MOVZX(32, 8, ECX, memArg); break;
+		case IROp::Load8Ext: MOVSX(32, 8, ECX, memArg); break;
+		case IROp::Load16: MOVZX(32, 16, ECX, memArg); break;
+		case IROp::Load16Ext: MOVSX(32, 16, ECX, memArg); break;
+		default: MOV(32, R(ECX), memArg); break;
+		}
+		MOV(32, inst.op == IROp::LoadFloat ? IRFPR(inst.dest) : IRGPR(inst.dest), R(ECX));
+		break;
+
+	case IROp::Store8:
+	case IROp::Store16:
+	case IROp::Store32:
+	case IROp::StoreFloat:
+	{
+		int bits = inst.op == IROp::Store8 ? 8 : (inst.op == IROp::Store16 ? 16 : 32);
+		EmitAddress(inst);
+		MOV(32, R(ECX), inst.op == IROp::StoreFloat ? IRFPR(inst.src3) : IRGPR(inst.src3));
+		MOV(bits, memArg, R(ECX));
+		break;
+	}
+
+	case IROp::LoadVec4:
+		EmitAddress(inst);
+		MOVUPS(XMM0, memArg);
+		MOVAPS(IRFPR(inst.dest), XMM0);
+		break;
+	case IROp::StoreVec4:
+		EmitAddress(inst);
+		MOVAPS(XMM0, IRFPR(inst.dest));
+		MOVUPS(memArg, XMM0);
+		break;
+
+		// Output-only SIMD functions
+	case IROp::Vec4Init:
+		MOV(PTRBITS, R(RAX), ImmPtr(vec4InitValues[inst.src1]));
+		MOVAPS(XMM0, MatR(RAX));
+		MOVAPS(IRFPR(inst.dest), XMM0);
+		break;
+	case IROp::Vec4Shuffle:
+		MOVAPS(XMM0, IRFPR(inst.src1));
+		SHUFPS(XMM0, R(XMM0), inst.src2);
+		MOVAPS(IRFPR(inst.dest), XMM0);
+		break;
+
+		// 2-op SIMD functions
+	case IROp::Vec4Mov:
+		MOVAPS(XMM0, IRFPR(inst.src1));
+		MOVAPS(IRFPR(inst.dest), XMM0);
+		break;
+	case IROp::Vec4Neg:
+	case IROp::Vec4Abs:
+		MOV(PTRBITS, R(RAX), ImmPtr(inst.op == IROp::Vec4Neg ? signBits : noSignMask));
+		MOVAPS(XMM0, IRFPR(inst.src1));
+		if (inst.op == IROp::Vec4Neg)
+			XORPS(XMM0, MatR(RAX));
+		else
+			ANDPS(XMM0, MatR(RAX));
+		MOVAPS(IRFPR(inst.dest), XMM0);
+		break;
+	case IROp::Vec4ClampToZero:
+		// Expand the sign bit, and use andnot to zero negative values.
+		MOVAPS(XMM0, IRFPR(inst.src1));
+		MOVAPS(XMM1, R(XMM0));
+		PSRAD(XMM1, 31);
+		PANDN(XMM1, R(XMM0));
+		MOVAPS(IRFPR(inst.dest), XMM1);
+		break;
+
+		// 3-op SIMD functions
+	case IROp::Vec4Add:
+	case IROp::Vec4Sub:
+	case IROp::Vec4Mul:
+	case IROp::Vec4Div:
+		MOVAPS(XMM0, IRFPR(inst.src1));
+		switch (inst.op) {
+		case IROp::Vec4Add: ADDPS(XMM0, IRFPR(inst.src2)); break;
+		case IROp::Vec4Sub: SUBPS(XMM0, IRFPR(inst.src2)); break;
+		case IROp::Vec4Mul: MULPS(XMM0, IRFPR(inst.src2)); break;
+		case IROp::Vec4Div: DIVPS(XMM0, IRFPR(inst.src2)); break;
+		default: break;
+		}
+		MOVAPS(IRFPR(inst.dest), XMM0);
+		break;
+
+	case IROp::Vec4Scale:
+		MOVSS(XMM1, IRFPR(inst.src2));
+		SHUFPS(XMM1, R(XMM1), 0);
+		MOVAPS(XMM0, IRFPR(inst.src1));
+		MULPS(XMM0, R(XMM1));
+		MOVAPS(IRFPR(inst.dest), XMM0);
+		break;
+
+	case IROp::Vec4Dot:
+		// Sum in the same order as the interpreter, so results are identical.
+		MOVAPS(XMM0, IRFPR(inst.src1));
+		MULPS(XMM0, IRFPR(inst.src2));
+		for (int lane = 1; lane < 4; ++lane) {
+			MOVAPS(XMM1, R(XMM0));
+			SHUFPS(XMM1, R(XMM1), lane);
+			ADDSS(XMM0, R(XMM1));
+		}
+		MOVSS(IRFPR(inst.dest), XMM0);
+		break;
+
+		// 3-Op FP
+	case IROp::FAdd:
+	case IROp::FSub:
+	case IROp::FMul:
+	case IROp::FDiv:
+		MOVSS(XMM0, IRFPR(inst.src1));
+		switch (inst.op) {
+		case IROp::FAdd: ADDSS(XMM0, IRFPR(inst.src2)); break;
+		case IROp::FSub: SUBSS(XMM0, IRFPR(inst.src2)); break;
+		case IROp::FMul: MULSS(XMM0, IRFPR(inst.src2)); break;
+		case IROp::FDiv: DIVSS(XMM0, IRFPR(inst.src2)); break;
+		default: break;
+		}
+		MOVSS(IRFPR(inst.dest), XMM0);
+		break;
+
+		// 2-Op FP
+	case IROp::FMov:
+		MOV(32, R(EAX), IRFPR(inst.src1));
+		MOV(32, IRFPR(inst.dest), R(EAX));
+		break;
+	case IROp::FAbs:
+		MOV(32, R(EAX), IRFPR(inst.src1));
+		AND(32, R(EAX), Imm32(0x7FFFFFFF));
+		MOV(32, IRFPR(inst.dest), R(EAX));
+		break;
+	case IROp::FNeg:
+		MOV(32, R(EAX), IRFPR(inst.src1));
+		XOR(32, R(EAX), Imm32(0x80000000));
+		MOV(32, IRFPR(inst.dest), R(EAX));
+		break;
+	case IROp::FSqrt:
+		SQRTSS(XMM0, IRFPR(inst.src1));
+		MOVSS(IRFPR(inst.dest), XMM0);
+		break;
+	case IROp::FCvtSW:
+		CVTSI2SS(XMM0, IRFPR(inst.src1));
+		MOVSS(IRFPR(inst.dest), XMM0);
+		break;
+
+		// Cross moves
+	case IROp::FMovFromGPR:
+		MOV(32, R(EAX), IRGPR(inst.src1));
+		MOV(32, IRFPR(inst.dest), R(EAX));
+		break;
+	case IROp::FMovToGPR:
+		MOV(32, R(EAX), IRFPR(inst.src1));
+		MOV(32, IRGPR(inst.dest), R(EAX));
+		break;
+	case IROp::FpCondToReg:
+		MOV(32, R(EAX), MIPSSTATE_VAR(fpcond));
+		MOV(32, IRGPR(inst.dest), R(EAX));
+		break;
+	case IROp::VfpuCtrlToReg:
+		MOV(32, R(EAX), MIPSSTATE_VAR_ELEM32(vfpuCtrl[0], inst.src1));
+		MOV(32, IRGPR(inst.dest), R(EAX));
+		break;
+
+		// VFPU flag/control
+	case IROp::SetCtrlVFPU:
+		MOV(32, MIPSSTATE_VAR_ELEM32(vfpuCtrl[0], inst.dest), Imm32(inst.constant));
+		break;
+	case IROp::SetCtrlVFPUReg:
+		MOV(32, R(EAX), IRGPR(inst.src1));
+		MOV(32, MIPSSTATE_VAR_ELEM32(vfpuCtrl[0], inst.dest), R(EAX));
+		break;
+	case IROp::SetCtrlVFPUFReg:
+		MOV(32, R(EAX), IRFPR(inst.src1));
+		MOV(32, MIPSSTATE_VAR_ELEM32(vfpuCtrl[0], inst.dest), R(EAX));
+		break;
+	case IROp::ZeroFpCond:
+		MOV(32, MIPSSTATE_VAR(fpcond), Imm32(0));
+		break;
+
+		// Block Exits
+	case IROp::ExitToConst:
+		EmitExit(Imm32(inst.constant));
+		break;
+	case IROp::ExitToReg:
+		EmitExit(IRGPR(inst.src1));
+		break;
+	case IROp::ExitToPC:
+		EmitExit(MIPSSTATE_VAR(pc));
+		break;
+	case IROp::ExitToConstIfEq:
+	case IROp::ExitToConstIfNeq:
+		MOV(32, R(EAX), IRGPR(inst.src1));
+		CMP(32, R(EAX), IRGPR(inst.src2));
+		EmitConditionalExit(inst.op == IROp::ExitToConstIfEq ? CC_NE : CC_E, inst.constant);
+		break;
+	case IROp::ExitToConstIfGtZ:
+		CMP(32, IRGPR(inst.src1), Imm8(0));
+		EmitConditionalExit(CC_LE, inst.constant);
+		break;
+	case IROp::ExitToConstIfGeZ:
+		CMP(32, IRGPR(inst.src1), Imm8(0));
+		EmitConditionalExit(CC_L, inst.constant);
+		break;
+	case IROp::ExitToConstIfLtZ:
+		CMP(32, IRGPR(inst.src1), Imm8(0));
+		EmitConditionalExit(CC_GE, inst.constant);
+		break;
+	case IROp::ExitToConstIfLeZ:
+		CMP(32, IRGPR(inst.src1), Imm8(0));
+		EmitConditionalExit(CC_G, inst.constant);
+		break;
+	case IROp::Break:
+		EmitExitFallback(inst);
+		break;
+
+		// Utilities
+	case IROp::Downcount:
+		SUB(32, MIPSSTATE_VAR(downcount), Imm32(inst.constant));
+		break;
+	case IROp::SetPC:
+		MOV(32, R(EAX), IRGPR(inst.src1));
+		MOV(32, MIPSSTATE_VAR(pc), R(EAX));
+		break;
+	case IROp::SetPCConst:
+		MOV(32, MIPSSTATE_VAR(pc), Imm32(inst.constant));
+		break;
+
+	case IROp::Breakpoint:
+	case IROp::MemoryCheck:
+	{
+		if (inst.op == IROp::Breakpoint) {
+			ABI_CallFunctionA((const void *)&RunBreakpoint, MIPSSTATE_VAR(pc));
+		} else {
+			MOV(32, R(EAX), IRGPR(inst.src1));
+			if (inst.constant != 0)
+				ADD(32, R(EAX), Imm32(inst.constant));
+			ABI_CallFunctionAA((const void *)&RunMemCheck, MIPSSTATE_VAR(pc), R(EAX));
+		}
+		TEST(32, R(EAX), R(EAX));
+		FixupBranch skip = J_CC(CC_Z);
+		ABI_CallFunction((const void *)&CoreTiming::ForceCheck);
+		EmitExit(MIPSSTATE_VAR(pc));
+		SetJumpTarget(skip);
+		break;
+	}
+
+		// Rounding mode changes are not implemented by the interpreter either.
+	case IROp::ApplyRoundingMode:
+	case IROp::RestoreRoundingMode:
+	case IROp::UpdateRoundingMode:
+		break;
+
+	default:
+		// Div, unaligned memory ops, FP rounding and compares, VFPU packing and transcendentals,
+		// and system ops like Syscall and Interpret go through the interpreter.
+		return false;
 	}
 
+	return true;
+}
 
 }  // namespace
 
-#endif // PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
+#endif // PPSSPP_ARCH(AMD64)
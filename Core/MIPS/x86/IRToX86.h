@@ -1,23 +1,40 @@
+#pragma once
+
 #include "Core/MIPS/IR/IRInst.h"
+#include "Core/MIPS/IR/IRNative.h"
 #include "Common/x64Emitter.h"
 
 namespace MIPSComp {
 
-class IRToNativeInterface {
+// Converts optimized IR blocks (after IRApplyPasses) to x64 code.
+// MIPS state stays in MIPSState between IR instructions, so no register allocation yet.
+class IRToX86 : public IRToNativeInterface, public Gen::XCodeBlock {
 public:
-	virtual ~IRToNativeInterface() {}
+	IRToX86(MIPSState *mips);
 
-	virtual void ConvertIRToNative(const IRInst *instructions, int count, const u32 *constants) = 0;
-};
+	const u8 *ConvertIRToNative(const IRInst *instructions, int count) override;
+	u32 RunBlock(const u8 *entry) override {
+		return enterBlock_(entry);
+	}
+	void Clear() override;
+	bool IsFull() const override;
+
+private:
+	void GenerateFixedCode();
+	bool ConvertInst(const IRInst &inst);
 
+	void EmitAddress(const IRInst &inst);
+	void EmitExit(Gen::OpArg pc);
+	void EmitConditionalExit(Gen::CCFlags skipCond, u32 target);
+	void EmitFallback(const IRInst &inst);
+	void EmitExitFallback(const IRInst &inst);
 
-class IRToX86 : public IRToNativeInterface {
-public:
-	void SetCodeBlock(Gen::XCodeBlock *code) { code_ = code; }
-	virtual void ConvertIRToNative(const IRInst *instructions, int count, const u32 *constants) override;
+	typedef u32 (*EnterBlockFunc)(const u8 *entry);
 
-private:
-	Gen::XCodeBlock *code_;
+	MIPSState *mips_;
+	EnterBlockFunc enterBlock_ = nullptr;
+	const u8 *exitBlock_ = nullptr;
+	int fixedCodeSize_ = 0;
 };
 
 }  // namespace
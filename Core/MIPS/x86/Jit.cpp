@@ -33,6 +33,7 @@
 #include "Core/Reporting.h"
 #include "Core/Debugger/SymbolMap.h"
 #include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/MIPSAnalyst.h"
 #include "Core/MIPS/MIPSCodeUtils.h"
 #include "Core/MIPS/MIPSInt.h"
 #include "Core/MIPS/MIPSTables.h"
@@ -100,6 +101,9 @@ static void JitLogMiss(MIPSOpcode op)
 	func(op);
 }
 
+// Reserved at the end of the code space for cold paths.
+static const int FAR_CODE_SIZE = 1024 * 1024 * 2;
+
 #ifdef _MSC_VER
 // JitBlockCache doesn't use this, just stores it.
 #pragma warning(disable:4355)
@@ -107,9 +111,13 @@ static void JitLogMiss(MIPSOpcode op)
 Jit::Jit(MIPSState *mips)
 		: blocks(mips, this), mips_(mips) {
 	blocks.Init();
+	if (jo.profileBlocks)
+		blocks.EnableProfiling();
 	gpr.SetEmitter(this);
 	fpr.SetEmitter(this);
 	AllocCodeSpace(1024 * 1024 * 16);
+	farCodeStart_ = region + region_size - FAR_CODE_SIZE;
+	farCodePtr_ = farCodeStart_;
 	GenerateFixedCode(jo);
 
 	safeMemFuncs.Init(&thunks);
@@ -210,9 +218,39 @@ void Jit::ClearCache()
 {
 	blocks.Clear();
 	ClearCodeSpace(0);
+	farCodePtr_ = farCodeStart_;
 	GenerateFixedCode(jo);
 }
 
+void Jit::SwitchToFarCode() {
+	_dbg_assert_msg_(JIT, !InFarCode(), "Already in far code");
+	nearCodePtr_ = GetWritableCodePtr();
+	SetCodePtr(farCodePtr_);
+	// Like BeginWrite(), the rest of the far area is still writable after a clear.
+	if (PlatformIsWXExclusive()) {
+		ProtectMemoryPages(farCodePtr_, 1, MEM_PROT_READ | MEM_PROT_WRITE);
+	}
+}
+
+void Jit::SwitchToNearCode() {
+	_dbg_assert_msg_(JIT, InFarCode(), "Not in far code");
+	u8 *farStart = farCodePtr_;
+	farCodePtr_ = GetWritableCodePtr();
+	if (PlatformIsWXExclusive()) {
+		ProtectMemoryPages(farStart, farCodePtr_ - farStart, MEM_PROT_READ | MEM_PROT_EXEC);
+	}
+	SetCodePtr(nearCodePtr_);
+	nearCodePtr_ = nullptr;
+}
+
+size_t Jit::GetNearSpaceLeft() const {
+	return farCodeStart_ - GetCodePtr();
+}
+
+size_t Jit::GetFarSpaceLeft() const {
+	return region + region_size - farCodePtr_;
+}
+
 void Jit::SaveFlags() {
 	PUSHF();
 #if defined(_M_X64)
@@ -269,7 +307,7 @@ void Jit::EatInstruction(MIPSOpcode op) {
 
 void Jit::Compile(u32 em_address) {
 	PROFILE_THIS_SCOPE("jitc");
-	if (GetSpaceLeft() < 0x10000 || blocks.IsFull()) {
+	if (GetNearSpaceLeft() < 0x10000 || GetFarSpaceLeft() < 0x10000 || blocks.IsFull()) {
 		ClearCache();
 	}
 
@@ -324,6 +362,7 @@ MIPSOpcode Jit::GetOffsetInstruction(int offset) {
 const u8 *Jit::DoJit(u32 em_address, JitBlock *b) {
 	js.cancel = false;
 	js.blockStart = js.compilerPC = mips_->pc;
+	js.pollingLoop = MIPSAnalyst::IsPollingLoop(js.blockStart);
 	js.lastContinuedPC = 0;
 	js.initialBlockSize = 0;
 	js.nextExit = 0;
@@ -344,6 +383,18 @@ const u8 *Jit::DoJit(u32 em_address, JitBlock *b) {
 
 	b->normalEntry = GetCodePtr();
 
+	if (jo.profileBlocks) {
+		// Nothing is mapped yet, so RAX and flags are free.
+		int64_t *counter = blocks.GetProfileCounter(b->blockNum);
+#if defined(_M_X64)
+		MOV(PTRBITS, R(RAX), ImmPtr(counter));
+		ADD(64, MatR(RAX), Imm8(1));
+#else
+		ADD(32, M(counter), Imm8(1));
+		ADC(32, M((u32 *)counter + 1), Imm8(0));
+#endif
+	}
+
 	MIPSAnalyst::AnalysisResults analysis = MIPSAnalyst::Analyze(em_address);
 
 	gpr.Start(mips_, &js, &jo, analysis);
@@ -398,7 +449,7 @@ const u8 *Jit::DoJit(u32 em_address, JitBlock *b) {
 		}
 
 		// Safety check, in case we get a bunch of really large jit ops without a lot of branching.
-		if (GetSpaceLeft() < 0x800 || js.numInstructions >= JitBlockCache::MAX_BLOCK_INSTRUCTIONS) {
+		if (GetNearSpaceLeft() < 0x800 || GetFarSpaceLeft() < 0x800 || js.numInstructions >= JitBlockCache::MAX_BLOCK_INSTRUCTIONS) {
 			FlushAll();
 			WriteExit(GetCompilerPC(), js.nextExit++);
 			js.compiling = false;
@@ -415,6 +466,7 @@ const u8 *Jit::DoJit(u32 em_address, JitBlock *b) {
 		blocks.ProxyBlock(js.blockStart, js.lastContinuedPC, (GetCompilerPC() - js.lastContinuedPC) / sizeof(u32), GetCodePtr());
 		b->originalSize = js.initialBlockSize;
 	}
+	blocks.SetProfileCycleEstimate(b->blockNum, js.downcountAmount);
 	return b->normalEntry;
 }
 
@@ -671,16 +723,31 @@ void Jit::WriteExit(u32 destination, int exit_num) {
 			MOV(PTRBITS, R(RAX), ImmPtr((const void *)&coreState));
 			CMP(32, MatR(RAX), Imm32(CORE_NEXTFRAME));
 		}
-		FixupBranch skipCheck = J_CC(CC_LE);
+		FixupBranch badState = J_CC(CC_G, true);
+		SwitchToFarCode();
+		SetJumpTarget(badState);
 		MOV(32, MIPSSTATE_VAR(pc), Imm32(GetCompilerPC()));
 		WriteSyscallExit();
-		SetJumpTarget(skipCheck);
+		SwitchToNearCode();
+	}
+
+	if (destination == js.blockStart && js.pollingLoop) {
+		// Nothing can change what we're polling until the next event, so skip ahead to it.
+		// Registers are already flushed for the exit.
+		RestoreRoundingMode();
+		ABI_CallFunctionC(&CoreTiming::Idle, 0);
+		ApplyRoundingMode();
 	}
 
 	WriteDowncount();
 
 	//If nobody has taken care of this yet (this can be removed when all branches are done)
 	JitBlock *b = js.curBlock;
+	if (destination == js.blockStart && jo.enableBlocklink) {
+		// Tight loop back into this block.  The SUB above set the flags, so skip the checked entry.
+		// When out of cycles, we fall through to the regular exit below.
+		J_CC(CC_NS, b->normalEntry, true);
+	}
 	b->exitAddress[exit_num] = destination;
 	b->exitPtrs[exit_num] = GetWritableCodePtr();
 
@@ -716,10 +783,12 @@ void Jit::WriteExitDestInReg(X64Reg reg) {
 			MOV(PTRBITS, R(temp), ImmPtr((const void *)&coreState));
 			CMP(32, MatR(temp), Imm32(CORE_NEXTFRAME));
 		}
-		FixupBranch skipCheck = J_CC(CC_LE);
+		FixupBranch badState = J_CC(CC_G, true);
+		SwitchToFarCode();
+		SetJumpTarget(badState);
 		MOV(32, MIPSSTATE_VAR(pc), Imm32(GetCompilerPC()));
 		WriteSyscallExit();
-		SetJumpTarget(skipCheck);
+		SwitchToNearCode();
 	}
 
 	MOV(32, MIPSSTATE_VAR(pc), R(reg));
@@ -728,9 +797,9 @@ void Jit::WriteExitDestInReg(X64Reg reg) {
 	// Validate the jump to avoid a crash?
 	if (!g_Config.bFastMemory) {
 		CMP(32, R(reg), Imm32(PSP_GetKernelMemoryBase()));
-		FixupBranch tooLow = J_CC(CC_B);
+		FixupBranch tooLow = J_CC(CC_B, true);
 		CMP(32, R(reg), Imm32(PSP_GetUserMemoryEnd()));
-		FixupBranch tooHigh = J_CC(CC_AE);
+		FixupBranch tooHigh = J_CC(CC_AE, true);
 
 		// Need to set neg flag again.
 		SUB(32, MIPSSTATE_VAR(downcount), Imm8(0));
@@ -738,6 +807,8 @@ void Jit::WriteExitDestInReg(X64Reg reg) {
 			J_CC(CC_NS, dispatcherInEAXNoCheck, true);
 		JMP(dispatcher, true);
 
+		// The bad jump handling never comes back, so keep it out of line.
+		SwitchToFarCode();
 		SetJumpTarget(tooLow);
 		SetJumpTarget(tooHigh);
 
@@ -753,6 +824,7 @@ void Jit::WriteExitDestInReg(X64Reg reg) {
 
 		SUB(32, MIPSSTATE_VAR(downcount), Imm8(0));
 		JMP(dispatcherCheckCoreState, true);
+		SwitchToNearCode();
 	} else if (reg == EAX) {
 		J_CC(CC_NS, dispatcherInEAXNoCheck, true);
 		JMP(dispatcher, true);
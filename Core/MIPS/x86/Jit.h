@@ -140,6 +140,8 @@ class Jit : public Gen::XCodeBlock, public JitInterface, public MIPSFrontendInte
 
 	void ApplyPrefixST(u8 *vregs, u32 prefix, VectorSize sz);
 	void ApplyPrefixD(const u8 *vregs, VectorSize sz);
+	bool TryApplyPrefixSTSIMD(u8 *vregs, u32 prefix, VectorSize sz);
+	bool TryApplyPrefixDSIMD(const u8 *vregs, VectorSize sz);
 	void GetVectorRegsPrefixS(u8 *regs, VectorSize sz, int vectorReg) {
 		_assert_(js.prefixSFlag & JitState::PREFIX_KNOWN);
 		GetVectorRegs(regs, sz, vectorReg);
@@ -240,6 +242,7 @@ class Jit : public Gen::XCodeBlock, public JitInterface, public MIPSFrontendInte
 	void CompFPTriArith(MIPSOpcode op, void (XEmitter::*arith)(Gen::X64Reg reg, Gen::OpArg), bool orderMatters);
 	void CompFPComp(int lhs, int rhs, u8 compare, bool allowNaN = false);
 	void CompVrotShuffle(u8 *dregs, int imm, int n, bool negSin);
+	void CompSplatV(Gen::X64Reg dest, Gen::OpArg src);
 
 	void CallProtectedFunction(const void *func, const Gen::OpArg &arg1);
 	void CallProtectedFunction(const void *func, const Gen::OpArg &arg1, const Gen::OpArg &arg2);
@@ -299,6 +302,16 @@ class Jit : public Gen::XCodeBlock, public JitInterface, public MIPSFrontendInte
 	void SaveFlags();
 	void LoadFlags();
 
+	// Rarely taken paths (slow memory access, bad core state exits) are emitted into a separate
+	// area at the end of the code space, so block bodies stay dense.  Far code must end with a jump.
+	void SwitchToFarCode();
+	void SwitchToNearCode();
+	bool InFarCode() const {
+		return nearCodePtr_ != nullptr;
+	}
+	size_t GetNearSpaceLeft() const;
+	size_t GetFarSpaceLeft() const;
+
 	JitBlockCache blocks;
 	JitOptions jo;
 	JitState js;
@@ -325,6 +338,11 @@ class Jit : public Gen::XCodeBlock, public JitInterface, public MIPSFrontendInte
 
 	const u8 *endOfPregeneratedCode;
 
+	u8 *farCodeStart_ = nullptr;
+	u8 *farCodePtr_ = nullptr;
+	// Where to continue near code, while in far code.
+	u8 *nearCodePtr_ = nullptr;
+
 	friend class JitSafeMem;
 	friend class JitSafeMemFuncs;
 };
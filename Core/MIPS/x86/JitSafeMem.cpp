@@ -51,7 +51,7 @@ void JitMemCheckCleanup()
 }
 
 JitSafeMem::JitSafeMem(Jit *jit, MIPSGPReg raddr, s32 offset, u32 alignMask)
-	: jit_(jit), raddr_(raddr), offset_(offset), needsCheck_(false), needsSkip_(false), alignMask_(alignMask)
+	: jit_(jit), raddr_(raddr), offset_(offset), needsCheck_(false), inFarCode_(false), alignMask_(alignMask)
 {
 	// Mask out the kernel RAM bit, because we'll end up with a negative offset to MEMBASEREG.
 	if (jit_->gpr.IsImm(raddr_))
@@ -178,10 +178,11 @@ OpArg JitSafeMem::PrepareMemoryOpArg(MemoryOpType type)
 	if (!fast_)
 	{
 		// Is it in physical ram?
+		// These go to the slow path in far code, so need the long form.
 		jit_->CMP(32, R(xaddr_), Imm32(PSP_GetKernelMemoryBase() - offset_));
-		tooLow_ = jit_->J_CC(CC_B);
+		tooLow_ = jit_->J_CC(CC_B, true);
 		jit_->CMP(32, R(xaddr_), Imm32(PSP_GetUserMemoryEnd() - offset_ - (size_ - 1)));
-		tooHigh_ = jit_->J_CC(CC_AE);
+		tooHigh_ = jit_->J_CC(CC_AE, true);
 
 		// We may need to jump back up here.
 		safe_ = jit_->GetCodePtr();
@@ -213,9 +214,10 @@ OpArg JitSafeMem::PrepareMemoryOpArg(MemoryOpType type)
 
 void JitSafeMem::PrepareSlowAccess()
 {
-	// Skip the fast path (which the caller wrote just now.)
-	skip_ = jit_->J(true);
-	needsSkip_ = true;
+	// The fast path (which the caller wrote just now) falls through, the slow path is out of line.
+	// Finish() jumps back.
+	jit_->SwitchToFarCode();
+	inFarCode_ = true;
 	jit_->SetJumpTarget(tooLow_);
 	jit_->SetJumpTarget(tooHigh_);
 
@@ -340,8 +342,11 @@ void JitSafeMem::Finish()
 	// Memory::Read_U32/etc. may have tripped coreState.
 	if (needsCheck_ && !g_Config.bIgnoreBadMemAccess)
 		jit_->js.afterOp |= JitState::AFTER_CORE_STATE;
-	if (needsSkip_)
-		jit_->SetJumpTarget(skip_);
+	if (inFarCode_) {
+		jit_->JMP(jit_->nearCodePtr_, true);
+		jit_->SwitchToNearCode();
+		inFarCode_ = false;
+	}
 	for (auto it = skipChecks_.begin(), end = skipChecks_.end(); it != end; ++it)
 		jit_->SetJumpTarget(*it);
 }
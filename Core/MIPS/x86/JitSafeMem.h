@@ -78,12 +78,13 @@ class JitSafeMem {
 	s32 offset_;
 	int size_;
 	bool needsCheck_;
-	bool needsSkip_;
+	// The slow path is being emitted as far code.
+	bool inFarCode_;
 	bool fast_;
 	u32 alignMask_;
 	u32 iaddr_;
 	Gen::X64Reg xaddr_;
-	Gen::FixupBranch tooLow_, tooHigh_, skip_;
+	Gen::FixupBranch tooLow_, tooHigh_;
 	std::vector<Gen::FixupBranch> skipChecks_;
 	const u8 *safe_;
 };
@@ -41,6 +41,7 @@
 #include "Core/ConfigValues.h"
 #include "Core/HLE/ReplaceTables.h"
 #include "Core/MIPS/JitCommon/JitBlockCache.h"
+#include "Core/MIPS/JitCommon/JitWriteWatch.h"
 
 namespace Memory {
 
@@ -204,6 +205,8 @@ bool MemoryMap_Setup(u32 flags) {
 	base = (u8*)VirtualAllocFromApp(0, 0x10000000, MEM_RESERVE, PAGE_READWRITE);
 #else
 
+	g_arena.UseHugePages(g_Config.bHugePages);
+
 	// Figure out how much memory we need to allocate in total.
 	size_t total_mem = 0;
 	for (int i = 0; i < num_views; i++) {
@@ -442,7 +445,11 @@ Opcode Read_Opcode_JIT(u32 address)
 // We assume that _Address is cached
 void Write_Opcode_JIT(const u32 _Address, const Opcode& _Value)
 {
+	// The jit's own emuhacks shouldn't trip the write watch.
+	const bool watched = MIPSComp::WriteWatchBeginJitWrite(_Address);
 	Memory::WriteUnchecked_U32(_Value.encoding, _Address);
+	if (watched)
+		MIPSComp::WriteWatchEndJitWrite(_Address);
 }
 
 void Memset(const u32 _Address, const u8 _iValue, const u32 _iLength) {
@@ -105,6 +105,7 @@ namespace Reporting
 
 	static int CalculateCRCThread() {
 		setCurrentThreadName("ReportCRC");
+		setCurrentThreadRole(ThreadRole::BACKGROUND);
 
 		// TODO: Use the blockDevice from pspFileSystem?
 		FileLoader *fileLoader = ConstructFileLoader(crcFilename);
@@ -16,10 +16,13 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <algorithm>
+#include <functional>
 #include <vector>
 #include <thread>
 #include <mutex>
 
+#include <snappy-c.h>
+
 #include "base/timeutil.h"
 #include "i18n/i18n.h"
 #include "thread/threadutil.h"
@@ -27,6 +30,7 @@
 
 #include "Common/FileUtil.h"
 #include "Common/ChunkFile.h"
+#include "Common/MemoryUsage.h"
 
 #include "Core/SaveState.h"
 #include "Core/Config.h"
@@ -45,6 +49,7 @@
 #include "Core/MIPS/MIPS.h"
 #include "Core/MIPS/JitCommon/JitBlockCache.h"
 #include "HW/MemoryStick.h"
+#include "GPU/GPUInterface.h"
 #include "GPU/GPUState.h"
 
 #ifndef MOBILE_DEVICE
@@ -83,10 +88,7 @@ namespace SaveState
 
 	CChunkFileReader::Error SaveToRam(std::vector<u8> &data) {
 		SaveStart state;
-		size_t sz = CChunkFileReader::MeasurePtr(state);
-		if (data.size() < sz)
-			data.resize(sz);
-		return CChunkFileReader::SavePtr(&data[0], state);
+		return CChunkFileReader::SavePtr(data, state);
 	}
 
 	CChunkFileReader::Error LoadFromRam(std::vector<u8> &data) {
@@ -104,11 +106,20 @@ namespace SaveState
 
 		CChunkFileReader::Error Save()
 		{
+			// The previous compress may still be reading the buffer we're about to overwrite (and maybe grow.)
+			if (compressThread_.joinable())
+				compressThread_.join();
+
 			std::lock_guard<std::mutex> guard(lock_);
 
+			// first_ and next_ only count up, and wrap through % size_.
+			if (next_ - first_ >= size_)
+				DropOldest();
 			int n = next_++ % size_;
-			if ((next_ % size_) == first_)
-				++first_;
+
+			// Keep as much history as fits, dropping the oldest states first.
+			while (usedBytes_ > MAX_USED_BYTES && next_ - first_ > 1)
+				DropOldest();
 
 			static std::vector<u8> buffer;
 			std::vector<u8> *compressBuffer = &buffer;
@@ -118,6 +129,9 @@ namespace SaveState
 			{
 				base_ = (base_ + 1) % ARRAY_SIZE(bases_);
 				baseUsage_ = 0;
+				// Anything still diffed against the base we're replacing can't be restored anymore.
+				while (next_ - first_ > 1 && baseMapping_[first_ % size_] == base_)
+					DropOldest();
 				err = SaveToRam(bases_[base_]);
 				// Let's not bother savestating twice.
 				compressBuffer = &bases_[base_];
@@ -135,27 +149,44 @@ namespace SaveState
 
 		CChunkFileReader::Error Restore()
 		{
+			// Make sure the newest state is done compressing.
+			if (compressThread_.joinable())
+				compressThread_.join();
+
 			std::lock_guard<std::mutex> guard(lock_);
 
 			// No valid states left.
 			if (Empty())
 				return CChunkFileReader::ERROR_BAD_FILE;
 
-			int n = (--next_ + size_) % size_;
+			int n = --next_ % size_;
 			if (states_[n].empty())
 				return CChunkFileReader::ERROR_BAD_FILE;
 
 			static std::vector<u8> buffer;
-			LockedDecompress(buffer, states_[n], bases_[baseMapping_[n]]);
+			usedBytes_ -= states_[n].size();
+			bool valid = LockedDecompress(buffer, states_[n], bases_[baseMapping_[n]]);
+			states_[n].clear();
+			ReportMemoryUsage();
+			if (!valid)
+				return CChunkFileReader::ERROR_BROKEN_STATE;
 			return LoadFromRam(buffer);
 		}
 
+		void DropOldest()
+		{
+			int n = first_++ % size_;
+			usedBytes_ -= states_[n].size();
+			states_[n].clear();
+		}
+
 		void ScheduleCompress(std::vector<u8> *result, const std::vector<u8> *state, const std::vector<u8> *base)
 		{
 			if (compressThread_.joinable())
 				compressThread_.join();
 			compressThread_ = std::thread([=]{
 				setCurrentThreadName("SaveStateCompress");
+				setCurrentThreadRole(ThreadRole::BACKGROUND);
 				Compress(*result, *state, *base);
 			});
 		}
@@ -167,43 +198,98 @@ namespace SaveState
 			if (first_ == 0 && next_ == 0)
 				return;
 
-			result.clear();
+			// Only the blocks that changed since the base are kept, and those are snappy compressed.
+			// Most of RAM is untouched between rewind states, so this is usually a small fraction of the state.
+			std::vector<u8> &out = result;
+			out.clear();
+			u32 stateSize = (u32)state.size();
+			out.insert(out.end(), (const u8 *)&stateSize, (const u8 *)&stateSize + sizeof(stateSize));
+
+			const size_t maxCompressed = snappy_max_compressed_length(BLOCK_SIZE);
 			for (size_t i = 0; i < state.size(); i += BLOCK_SIZE)
 			{
 				int blockSize = std::min(BLOCK_SIZE, (int)(state.size() - i));
-				if (i + blockSize > base.size() || memcmp(&state[i], &base[i], blockSize) != 0)
+				if (i + blockSize <= base.size() && memcmp(&state[i], &base[i], blockSize) == 0)
+				{
+					out.push_back(BLOCK_BASE);
+					continue;
+				}
+
+				size_t pos = out.size();
+				out.resize(pos + 1 + sizeof(u16) + maxCompressed);
+				size_t compressedSize = maxCompressed;
+				snappy_status status = snappy_compress((const char *)&state[i], blockSize, (char *)&out[pos + 1 + sizeof(u16)], &compressedSize);
+				if (status == SNAPPY_OK && compressedSize < (size_t)blockSize)
 				{
-					result.push_back(1);
-					result.insert(result.end(), state.begin() + i, state.begin() +i + blockSize);
+					u16 size16 = (u16)compressedSize;
+					out[pos] = BLOCK_SNAPPY;
+					memcpy(&out[pos + 1], &size16, sizeof(size16));
+					out.resize(pos + 1 + sizeof(u16) + compressedSize);
 				}
 				else
-					result.push_back(0);
+				{
+					out.resize(pos);
+					out.push_back(BLOCK_RAW);
+					out.insert(out.end(), state.begin() + i, state.begin() + i + blockSize);
+				}
 			}
+			out.shrink_to_fit();
+			usedBytes_ += out.size();
+			ReportMemoryUsage();
 		}
 
-		void LockedDecompress(std::vector<u8> &result, const std::vector<u8> &compressed, const std::vector<u8> &base)
+		void ReportMemoryUsage()
 		{
-			result.clear();
-			result.reserve(base.size());
-			auto basePos = base.begin();
-			for (size_t i = 0; i < compressed.size(); )
+			s64 bytes = usedBytes_;
+			for (const auto &base : bases_)
+				bytes += base.capacity();
+			MemoryUsage::Set(MemoryUsage::Category::REWIND_STATES, bytes);
+		}
+
+		bool LockedDecompress(std::vector<u8> &result, const std::vector<u8> &compressed, const std::vector<u8> &base)
+		{
+			u32 stateSize;
+			if (compressed.size() < sizeof(stateSize))
+				return false;
+			memcpy(&stateSize, &compressed[0], sizeof(stateSize));
+
+			result.resize(stateSize);
+			size_t i = sizeof(stateSize);
+			for (size_t pos = 0; pos < stateSize; pos += BLOCK_SIZE)
 			{
-				if (compressed[i] == 0)
+				if (i >= compressed.size())
+					return false;
+				size_t blockSize = std::min((size_t)BLOCK_SIZE, stateSize - pos);
+				u8 type = compressed[i++];
+				if (type == BLOCK_BASE)
 				{
-					++i;
-					int blockSize = std::min(BLOCK_SIZE, (int)(base.size() - result.size()));
-					result.insert(result.end(), basePos, basePos + blockSize);
-					basePos += blockSize;
+					if (pos + blockSize > base.size())
+						return false;
+					memcpy(&result[pos], &base[pos], blockSize);
 				}
-				else
+				else if (type == BLOCK_RAW)
 				{
-					++i;
-					int blockSize = std::min(BLOCK_SIZE, (int)(compressed.size() - i));
-					result.insert(result.end(), compressed.begin() + i, compressed.begin() + i + blockSize);
+					if (i + blockSize > compressed.size())
+						return false;
+					memcpy(&result[pos], &compressed[i], blockSize);
 					i += blockSize;
-					basePos += blockSize;
+				}
+				else
+				{
+					u16 compressedSize;
+					if (i + sizeof(compressedSize) > compressed.size())
+						return false;
+					memcpy(&compressedSize, &compressed[i], sizeof(compressedSize));
+					i += sizeof(compressedSize);
+					size_t outSize = blockSize;
+					if (i + compressedSize > compressed.size())
+						return false;
+					if (snappy_uncompress((const char *)&compressed[i], compressedSize, (char *)&result[pos], &outSize) != SNAPPY_OK || outSize != blockSize)
+						return false;
+					i += compressedSize;
 				}
 			}
+			return true;
 		}
 
 		void Clear()
@@ -215,6 +301,23 @@ namespace SaveState
 			std::lock_guard<std::mutex> guard(lock_);
 			first_ = 0;
 			next_ = 0;
+			for (auto &state : states_)
+				state.clear();
+			usedBytes_ = 0;
+			ReportMemoryUsage();
+		}
+
+		// Like Clear(), but also frees the bases.  Used when the OS is low on memory.
+		void Release()
+		{
+			Clear();
+
+			std::lock_guard<std::mutex> guard(lock_);
+			for (auto &base : bases_)
+				StateBuffer().swap(base);
+			base_ = -1;
+			baseUsage_ = 0;
+			ReportMemoryUsage();
 		}
 
 		bool Empty() const
@@ -225,6 +328,14 @@ namespace SaveState
 		static const int BLOCK_SIZE;
 		// TODO: Instead, based on size of compressed state?
 		static const int BASE_USAGE_INTERVAL;
+		// Memory allowed for the diffed states, not counting the two bases.
+		static const size_t MAX_USED_BYTES;
+
+		enum : u8 {
+			BLOCK_BASE = 0,
+			BLOCK_RAW = 1,
+			BLOCK_SNAPPY = 2,
+		};
 
 		typedef std::vector<u8> StateBuffer;
 
@@ -240,11 +351,23 @@ namespace SaveState
 
 		int base_;
 		int baseUsage_;
+		size_t usedBytes_ = 0;
+	};
+
+	// Result of a background write, delivered from Process() on the emulation thread.
+	struct FinishedWrite {
+		Callback callback;
+		Status status;
+		std::string message;
+		void *cbUserData;
 	};
 
 	static bool needsProcess = false;
 	static std::vector<Operation> pending;
+	static std::vector<FinishedWrite> finishedWrites;
 	static std::mutex mutex;
+	// Compresses and writes states and screenshots, in the order they were taken.
+	static std::thread writeThread;
 	static int screenshotFailures = 0;
 	static bool hasLoadedState = false;
 	static const int STALE_STATE_USES = 2;
@@ -254,14 +377,16 @@ namespace SaveState
 	static std::string saveStateInitialGitVersion = "";
 
 	// TODO: Should this be configurable?
-	static const int REWIND_NUM_STATES = 20;
+	// Upper bound only - usually StateRingbuffer::MAX_USED_BYTES limits it first.
+	static const int REWIND_NUM_STATES = 60;
 	static const int SCREENSHOT_FAILURE_RETRIES = 15;
 	static StateRingbuffer rewindStates(REWIND_NUM_STATES);
 	// TODO: Any reason for this to be configurable?
 	const static float rewindMaxWallFrequency = 1.0f;
 	static float rewindLastTime = 0.0f;
 	const int StateRingbuffer::BLOCK_SIZE = 8192;
-	const int StateRingbuffer::BASE_USAGE_INTERVAL = 15;
+	const int StateRingbuffer::BASE_USAGE_INTERVAL = 30;
+	const size_t StateRingbuffer::MAX_USED_BYTES = 128 * 1024 * 1024;
 
 	void SaveStart::DoState(PointerWrap &p)
 	{
@@ -269,6 +394,10 @@ namespace SaveState
 		if (!s)
 			return;
 
+		// Display lists may still be running on the GE thread.
+		if (gpu)
+			gpu->SyncThread();
+
 		if (s >= 2) {
 			// This only increments on save, of course.
 			++saveStateGeneration;
@@ -305,6 +434,48 @@ namespace SaveState
 		pspFileSystem.DoState(p);
 	}
 
+	static void WaitForWrites()
+	{
+		if (writeThread.joinable())
+			writeThread.join();
+	}
+
+	static void FinishWrite(const Callback &callback, Status status, const std::string &message, void *cbUserData)
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		finishedWrites.push_back(FinishedWrite{ callback, status, message, cbUserData });
+		needsProcess = true;
+		Core_UpdateSingleStep();
+	}
+
+	static void StartWrites(std::vector<std::function<void()>> &&writes)
+	{
+		if (writes.empty())
+			return;
+
+		// Only one writer at a time, so a slot's screenshot and state stay in order.
+		WaitForWrites();
+		writeThread = std::thread([](std::vector<std::function<void()>> writes) {
+			setCurrentThreadName("SaveStateWriter");
+			setCurrentThreadRole(ThreadRole::BACKGROUND);
+			for (auto &write : writes)
+				write();
+		}, std::move(writes));
+	}
+
+	static void DeliverFinishedWrites()
+	{
+		std::vector<FinishedWrite> finished;
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			finished.swap(finishedWrites);
+		}
+		for (const FinishedWrite &write : finished) {
+			if (write.callback)
+				write.callback(write.status, write.message, write.cbUserData);
+		}
+	}
+
 	void Enqueue(SaveState::Operation op)
 	{
 		std::lock_guard<std::mutex> guard(mutex);
@@ -701,6 +872,15 @@ namespace SaveState
 
 	void Process()
 	{
+		static int lastLowMemoryCount = 0;
+		int lowMemoryCount = MemoryUsage::LowMemoryCount();
+		if (lowMemoryCount != lastLowMemoryCount) {
+			lastLowMemoryCount = lowMemoryCount;
+			if (!rewindStates.Empty())
+				NOTICE_LOG(SAVESTATE, "Low on memory, dropping rewind states");
+			rewindStates.Release();
+		}
+
 #ifndef MOBILE_DEVICE
 		if (g_Config.iRewindFlipFrequency != 0 && gpuStats.numFlips != 0)
 			CheckRewindState();
@@ -710,6 +890,8 @@ namespace SaveState
 			return;
 		needsProcess = false;
 
+		DeliverFinishedWrites();
+
 		if (!__KernelIsRunning())
 		{
 			ERROR_LOG(SAVESTATE, "Savestate failure: Unable to load without kernel, this should never happen.");
@@ -718,6 +900,7 @@ namespace SaveState
 
 		std::vector<Operation> operations = Flush();
 		SaveStart state;
+		std::vector<std::function<void()>> writes;
 
 		for (size_t i = 0, n = operations.size(); i < n; ++i)
 		{
@@ -741,6 +924,10 @@ namespace SaveState
 			{
 			case SAVESTATE_LOAD:
 				INFO_LOG(SAVESTATE, "Loading state from %s", op.filename.c_str());
+				// The file might still be on its way to disk.
+				StartWrites(std::move(writes));
+				writes.clear();
+				WaitForWrites();
 				// Use the state's latest version as a guess for saveStateInitialGitVersion.
 				result = CChunkFileReader::Load(op.filename, &saveStateInitialGitVersion, state, &reason);
 				if (result == CChunkFileReader::ERROR_NONE) {
@@ -792,9 +979,29 @@ namespace SaveState
 					std::size_t lslash = title.find_last_of("/");
 					title = title.substr(lslash + 1);
 				}
-				result = CChunkFileReader::Save(op.filename, title, PPSSPP_GIT_VERSION, state);
+				{
+					// Snapshot now, but compress and write in the background.
+					u8 *buffer;
+					size_t sz;
+					result = CChunkFileReader::Snapshot(state, buffer, sz);
+					if (result == CChunkFileReader::ERROR_NONE) {
+						const std::string filename = op.filename;
+						const Callback callback = op.callback;
+						void *cbUserData = op.cbUserData;
+						const std::string savedMessage = sc->T("Saved State");
+						const std::string failedMessage = i18nSaveFailure;
+						writes.push_back([=] {
+							CChunkFileReader::Error writeResult = CChunkFileReader::SaveFile(filename, title, PPSSPP_GIT_VERSION, buffer, sz);
+							if (writeResult == CChunkFileReader::ERROR_NONE)
+								FinishWrite(callback, Status::SUCCESS, savedMessage, cbUserData);
+							else
+								FinishWrite(callback, Status::FAILURE, failedMessage, cbUserData);
+						});
+						// The callback is delivered once the write finishes.
+						op.callback = Callback();
+					}
+				}
 				if (result == CChunkFileReader::ERROR_NONE) {
-					callbackMessage = sc->T("Saved State");
 					callbackResult = Status::SUCCESS;
 #ifndef MOBILE_DEVICE
 					if (g_Config.bSaveLoadResetsAVdumping) {
@@ -855,7 +1062,9 @@ namespace SaveState
 			case SAVESTATE_SAVE_SCREENSHOT:
 			{
 				int maxRes = g_Config.iInternalResolution > 2 ? 2 : -1;
-				tempResult = TakeGameScreenshot(op.filename.c_str(), ScreenshotFormat::JPG, SCREENSHOT_DISPLAY, nullptr, nullptr, maxRes);
+				// Read back now, while the frame is still there, but encode in the background.
+				std::function<bool()> writeScreenshot = PrepareGameScreenshot(op.filename.c_str(), ScreenshotFormat::JPG, SCREENSHOT_DISPLAY, maxRes);
+				tempResult = (bool)writeScreenshot;
 				callbackResult = tempResult ? Status::SUCCESS : Status::FAILURE;
 				if (!tempResult) {
 					ERROR_LOG(SAVESTATE, "Failed to take a screenshot for the savestate! %s", op.filename.c_str());
@@ -865,6 +1074,12 @@ namespace SaveState
 					}
 				} else {
 					screenshotFailures = 0;
+					const Callback callback = op.callback;
+					void *cbUserData = op.cbUserData;
+					writes.push_back([=] {
+						FinishWrite(callback, writeScreenshot() ? Status::SUCCESS : Status::FAILURE, "", cbUserData);
+					});
+					op.callback = Callback();
 				}
 				break;
 			}
@@ -877,6 +1092,7 @@ namespace SaveState
 			if (op.callback)
 				op.callback(callbackResult, callbackMessage, op.cbUserData);
 		}
+		StartWrites(std::move(writes));
 		if (operations.size()) {
 			// Avoid triggering frame skipping due to slowdown
 			__DisplaySetWasPaused();
@@ -888,6 +1104,7 @@ namespace SaveState
 		// Make sure there's a directory for save slots
 		File::CreateFullPath(GetSysDirectory(DIRECTORY_SAVESTATE));
 
+		WaitForWrites();
 		std::lock_guard<std::mutex> guard(mutex);
 		rewindStates.Clear();
 
@@ -898,7 +1115,10 @@ namespace SaveState
 
 	void Shutdown()
 	{
+		// Let pending writes finish, but their callbacks may refer to screens that are gone.
+		WaitForWrites();
 		std::lock_guard<std::mutex> guard(mutex);
+		finishedWrites.clear();
 		rewindStates.Clear();
 	}
 }
@@ -0,0 +1,182 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <snappy-c.h>
+
+#include "Common/FileUtil.h"
+#include "Common/Log.h"
+#include "Core/ScaledTextureCache.h"
+#include "Core/System.h"
+
+// Bump when the scalers change their output.
+static const u32 CACHE_MAGIC = 0x43545350;  // PSTC
+static const u32 CACHE_VERSION = 1;
+// Stop adding once the file is this large, it only needs to cover one game.
+static const u32 CACHE_MAX_SIZE = 256 * 1024 * 1024;
+
+struct ScaledCacheHeader {
+	u32 magic;
+	u32 version;
+};
+
+struct ScaledCacheRecord {
+	ScaledTextureKey key;
+	u32 fmt;
+	u32 size;
+	u32 compressedSize;
+	u32 pad;
+};
+
+ScaledTextureCache::~ScaledTextureCache() {
+	Shutdown();
+}
+
+void ScaledTextureCache::Init(const std::string &gameID) {
+	if (gameID.empty() || (gameID == gameID_ && (file_ || loadThread_.joinable())))
+		return;
+	Shutdown();
+
+	gameID_ = gameID;
+	File::CreateFullPath(GetSysDirectory(DIRECTORY_APP_CACHE));
+	std::string filename = GetSysDirectory(DIRECTORY_APP_CACHE) + "/" + gameID + ".scaledtexcache";
+	cancelLoad_ = false;
+	loadThread_ = std::thread([=] {
+		LoadIndex(filename);
+	});
+}
+
+void ScaledTextureCache::Shutdown() {
+	if (loadThread_.joinable()) {
+		cancelLoad_ = true;
+		loadThread_.join();
+	}
+
+	std::lock_guard<std::mutex> guard(lock_);
+	if (file_) {
+		fclose(file_);
+		file_ = nullptr;
+	}
+	index_.clear();
+	loaded_ = false;
+	gameID_.clear();
+}
+
+void ScaledTextureCache::LoadIndex(std::string filename) {
+	std::map<ScaledTextureKey, Location> index;
+	u32 end = 0;
+
+	FILE *f = File::OpenCFile(filename, "r+b");
+	if (f) {
+		u64 fileSize = File::GetFileSize(f);
+		ScaledCacheHeader header;
+		if (fread(&header, sizeof(header), 1, f) == 1 && header.magic == CACHE_MAGIC && header.version == CACHE_VERSION) {
+			end = sizeof(header);
+			ScaledCacheRecord record;
+			while (!cancelLoad_ && fread(&record, sizeof(record), 1, f) == 1) {
+				u64 dataEnd = (u64)end + sizeof(record) + record.compressedSize;
+				// A truncated last record means we crashed while writing it, just overwrite it.
+				if (dataEnd > fileSize || fseek(f, record.compressedSize, SEEK_CUR) != 0)
+					break;
+				index[record.key] = Location{ end + (u32)sizeof(record), record.size, record.compressedSize, record.fmt };
+				end = (u32)dataEnd;
+			}
+		} else {
+			WARN_LOG(G3D, "Discarding outdated scaled texture cache %s", filename.c_str());
+		}
+	}
+
+	if (end == 0) {
+		if (f)
+			fclose(f);
+		f = File::OpenCFile(filename, "w+b");
+		ScaledCacheHeader header{ CACHE_MAGIC, CACHE_VERSION };
+		if (f && fwrite(&header, sizeof(header), 1, f) == 1) {
+			end = sizeof(header);
+		} else if (f) {
+			fclose(f);
+			f = nullptr;
+		}
+	}
+
+	if (!f) {
+		ERROR_LOG(G3D, "Unable to open scaled texture cache %s", filename.c_str());
+		return;
+	}
+
+	INFO_LOG(G3D, "Loaded scaled texture cache with %d levels", (int)index.size());
+	std::lock_guard<std::mutex> guard(lock_);
+	file_ = f;
+	fileEnd_ = end;
+	index_.swap(index);
+	loaded_ = true;
+}
+
+bool ScaledTextureCache::Lookup(const ScaledTextureKey &key, u32 *out, size_t bytes, u32 *outFmt) {
+	if (!loaded_)
+		return false;
+
+	std::lock_guard<std::mutex> guard(lock_);
+	auto it = index_.find(key);
+	if (it == index_.end() || it->second.size != bytes || !file_)
+		return false;
+
+	const Location &loc = it->second;
+	buffer_.resize(loc.compressedSize);
+	if (fseek(file_, loc.offset, SEEK_SET) != 0 || fread(buffer_.data(), 1, loc.compressedSize, file_) != loc.compressedSize) {
+		index_.erase(it);
+		return false;
+	}
+
+	size_t outSize = bytes;
+	if (snappy_uncompress(buffer_.data(), loc.compressedSize, (char *)out, &outSize) != SNAPPY_OK || outSize != bytes) {
+		ERROR_LOG(G3D, "Corrupt scaled texture in cache, ignoring it");
+		index_.erase(it);
+		return false;
+	}
+
+	*outFmt = loc.fmt;
+	return true;
+}
+
+void ScaledTextureCache::Store(const ScaledTextureKey &key, const u32 *data, size_t bytes, u32 fmt) {
+	if (!loaded_)
+		return;
+
+	std::lock_guard<std::mutex> guard(lock_);
+	if (!file_ || fileEnd_ >= CACHE_MAX_SIZE || index_.find(key) != index_.end())
+		return;
+
+	size_t compressedSize = snappy_max_compressed_length(bytes);
+	buffer_.resize(sizeof(ScaledCacheRecord) + compressedSize);
+	if (snappy_compress((const char *)data, bytes, buffer_.data() + sizeof(ScaledCacheRecord), &compressedSize) != SNAPPY_OK)
+		return;
+
+	ScaledCacheRecord record{ key, fmt, (u32)bytes, (u32)compressedSize, 0 };
+	memcpy(buffer_.data(), &record, sizeof(record));
+	size_t total = sizeof(record) + compressedSize;
+	if (fseek(file_, fileEnd_, SEEK_SET) != 0 || fwrite(buffer_.data(), 1, total, file_) != total) {
+		// Probably out of disk space, don't keep trying.
+		WARN_LOG(G3D, "Failed to write to the scaled texture cache, disabling it");
+		fclose(file_);
+		file_ = nullptr;
+		return;
+	}
+	fflush(file_);
+
+	index_[key] = Location{ fileEnd_ + (u32)sizeof(record), (u32)bytes, (u32)compressedSize, fmt };
+	fileEnd_ += (u32)total;
+}
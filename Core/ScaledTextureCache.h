@@ -0,0 +1,83 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+// Identifies one scaled texture level.  The cachekey includes the address, format and CLUT hash.
+struct ScaledTextureKey {
+	u64 cachekey;
+	u32 fullhash;
+	u32 fmt;  // Backend specific format of the unscaled pixels.
+	u16 w;
+	u16 h;
+	u8 level;
+	u8 scaleFactor;
+	u8 scalingType;
+	u8 deposterize;
+
+	bool operator <(const ScaledTextureKey &k) const {
+		// No padding, so this is safe.
+		return memcmp(this, &k, sizeof(ScaledTextureKey)) < 0;
+	}
+};
+
+// Keeps upscaled textures on disk so they don't need to be scaled again the next time the game runs.
+// Everything for a game is appended to a single file, each level snappy compressed.  Thread safe.
+class ScaledTextureCache {
+public:
+	~ScaledTextureCache();
+
+	// Opens (or creates) the cache for the game, reading its index on a thread.
+	// Lookups miss and stores are dropped until that has finished.
+	void Init(const std::string &gameID);
+	void Shutdown();
+
+	// On a hit, out receives the scaled pixels, which must be exactly bytes long.
+	bool Lookup(const ScaledTextureKey &key, u32 *out, size_t bytes, u32 *outFmt);
+	void Store(const ScaledTextureKey &key, const u32 *data, size_t bytes, u32 fmt);
+
+private:
+	struct Location {
+		u32 offset;
+		u32 size;
+		u32 compressedSize;
+		u32 fmt;
+	};
+
+	void LoadIndex(std::string filename);
+
+	std::mutex lock_;
+	std::thread loadThread_;
+	std::atomic<bool> loaded_{ false };
+	std::atomic<bool> cancelLoad_{ false };
+	std::string gameID_;
+	FILE *file_ = nullptr;
+	u32 fileEnd_ = 0;
+	std::map<ScaledTextureKey, Location> index_;
+	std::vector<char> buffer_;
+};
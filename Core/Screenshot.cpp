@@ -18,6 +18,8 @@
 #include "ppsspp_config.h"
 
 #include <algorithm>
+#include <atomic>
+#include <memory>
 #ifdef USING_QT_UI
 #include <QtGui/QImage>
 #else
@@ -25,6 +27,8 @@
 #include "ext/jpge/jpge.h"
 #endif
 
+#include "thread/executor.h"
+
 #include "Common/ColorConv.h"
 #include "Common/FileUtil.h"
 #include "Core/Config.h"
@@ -306,15 +310,14 @@ const u8 *ConvertBufferToScreenshot(const GPUDebugBuffer &buf, bool alpha, u8 *&
 	return temp ? temp : buffer;
 }
 
-bool TakeGameScreenshot(const char *filename, ScreenshotFormat fmt, ScreenshotType type, int *width, int *height, int maxRes) {
+static bool ReadGameScreenshot(GPUDebugBuffer &buf, ScreenshotType type, u32 &w, u32 &h, int maxRes) {
 	if (!gpuDebug) {
 		ERROR_LOG(SYSTEM, "Can't take screenshots when GPU not running");
 		return false;
 	}
-	GPUDebugBuffer buf;
 	bool success = false;
-	u32 w = (u32)-1;
-	u32 h = (u32)-1;
+	w = (u32)-1;
+	h = (u32)-1;
 
 	if (type == SCREENSHOT_DISPLAY || type == SCREENSHOT_RENDER) {
 		success = gpuDebug->GetCurrentFramebuffer(buf, type == SCREENSHOT_RENDER ? GPU_DBG_FRAMEBUF_RENDER : GPU_DBG_FRAMEBUF_DISPLAY, maxRes);
@@ -330,19 +333,20 @@ bool TakeGameScreenshot(const char *filename, ScreenshotFormat fmt, ScreenshotTy
 		ERROR_LOG(G3D, "Failed to obtain screenshot data.");
 		return false;
 	}
+	return true;
+}
 
+static bool WriteGameScreenshot(const GPUDebugBuffer &buf, const char *filename, ScreenshotFormat fmt, u32 w, u32 h, int *width, int *height) {
 	u8 *flipbuffer = nullptr;
+	const u8 *buffer = ConvertBufferToScreenshot(buf, false, flipbuffer, w, h);
+	bool success = buffer != nullptr;
 	if (success) {
-		const u8 *buffer = ConvertBufferToScreenshot(buf, false, flipbuffer, w, h);
-		success = buffer != nullptr;
-		if (success) {
-			if (width)
-				*width = w;
-			if (height)
-				*height = h;
-
-			success = Save888RGBScreenshot(filename, fmt, buffer, w, h);
-		}
+		if (width)
+			*width = w;
+		if (height)
+			*height = h;
+
+		success = Save888RGBScreenshot(filename, fmt, buffer, w, h);
 	}
 	delete [] flipbuffer;
 
@@ -352,6 +356,54 @@ bool TakeGameScreenshot(const char *filename, ScreenshotFormat fmt, ScreenshotTy
 	return success;
 }
 
+bool TakeGameScreenshot(const char *filename, ScreenshotFormat fmt, ScreenshotType type, int *width, int *height, int maxRes) {
+	GPUDebugBuffer buf;
+	u32 w, h;
+	if (!ReadGameScreenshot(buf, type, w, h, maxRes))
+		return false;
+	return WriteGameScreenshot(buf, filename, fmt, w, h, width, height);
+}
+
+std::function<bool()> PrepareGameScreenshot(const char *filename, ScreenshotFormat fmt, ScreenshotType type, int maxRes) {
+	std::shared_ptr<GPUDebugBuffer> buf = std::make_shared<GPUDebugBuffer>();
+	u32 w, h;
+	if (!ReadGameScreenshot(*buf, type, w, h, maxRes))
+		return std::function<bool()>();
+
+	std::string path = filename;
+	return [=] {
+		return WriteGameScreenshot(*buf, path.c_str(), fmt, w, h, nullptr, nullptr);
+	};
+}
+
+// More than this waiting to be written, and we just write on the caller's thread, to bound memory use.
+static const int MAX_PENDING_SCREENSHOTS = 4;
+static std::atomic<int> pendingScreenshots{ 0 };
+
+bool TakeGameScreenshotAsync(const char *filename, ScreenshotFormat fmt, ScreenshotType type, std::function<void(bool)> callback, int maxRes) {
+	std::function<bool()> write = PrepareGameScreenshot(filename, fmt, type, maxRes);
+	if (!write)
+		return false;
+
+	if (pendingScreenshots >= MAX_PENDING_SCREENSHOTS) {
+		bool success = write();
+		if (callback)
+			callback(success);
+		return true;
+	}
+
+	// One thread keeps them in order, and PNG compression doesn't need more.
+	static threading::BoundedThreadExecutor writer(1, "Screenshot");
+	pendingScreenshots++;
+	writer.Run([=] {
+		bool success = write();
+		pendingScreenshots--;
+		if (callback)
+			callback(success);
+	});
+	return true;
+}
+
 bool Save888RGBScreenshot(const char *filename, ScreenshotFormat fmt, const u8 *bufferRGB888, int w, int h) {
 #ifdef USING_QT_UI
 	QImage image(bufferRGB888, w, h, QImage::Format_RGB888);
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <functional>
+
 struct GPUDebugBuffer;
 
 enum class ScreenshotFormat {
@@ -37,5 +39,11 @@ const u8 *ConvertBufferToScreenshot(const GPUDebugBuffer &buf, bool alpha, u8 *&
 
 // Can only be used while in game.
 bool TakeGameScreenshot(const char *filename, ScreenshotFormat fmt, ScreenshotType type, int *width = nullptr, int *height = nullptr, int maxRes = -1);
+// Reads back the screenshot now, but leaves converting and writing it to the returned function,
+// which can run on another thread. Returns an empty function if the readback failed.
+std::function<bool()> PrepareGameScreenshot(const char *filename, ScreenshotFormat fmt, ScreenshotType type, int maxRes = -1);
+// Reads back now, then writes on a background thread, calling callback there with the result.
+// Returns false right away if the readback failed, in which case callback isn't called.
+bool TakeGameScreenshotAsync(const char *filename, ScreenshotFormat fmt, ScreenshotType type, std::function<void(bool)> callback, int maxRes = -1);
 bool Save888RGBScreenshot(const char *filename, ScreenshotFormat fmt, const u8 *bufferRGB888, int w, int h);
 bool Save8888RGBAScreenshot(const char *filename, const u8 *bufferRGBA8888, int w, int h);
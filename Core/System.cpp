@@ -25,6 +25,7 @@
 #include <codecvt>
 #endif
 
+#include <atomic>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -35,6 +36,8 @@
 #include "thread/threadutil.h"
 #include "util/text/utf8.h"
 
+#include "Common/CPUDetect.h"
+#include "Common/ThreadPools.h"
 #include "Common/GraphicsContext.h"
 #include "Core/MemMap.h"
 #include "Core/HDRemaster.h"
@@ -58,12 +61,18 @@
 #include "Core/PSPLoaders.h"
 #include "Core/ELF/ParamSFO.h"
 #include "Core/SaveState.h"
+#include "Core/Util/StartupTrace.h"
 #include "Common/LogManager.h"
 #include "Core/HLE/sceAudiocodec.h"
 
 #include "GPU/GPUState.h"
 #include "GPU/GPUInterface.h"
 
+extern "C" {
+#include "ext/libkirk/AES.h"
+#include "ext/libkirk/SHA1.h"
+}
+
 enum CPUThreadState {
 	CPU_THREAD_NOT_RUNNING,
 	CPU_THREAD_PENDING,
@@ -90,7 +99,10 @@ static std::string loadingReason;
 bool audioInitialized;
 
 bool coreCollectDebugStats = false;
-bool coreCollectDebugStatsForced = false;
+static std::atomic<int> coreCollectDebugStatsForced{ 0 };
+static std::mutex lastFrameStatsLock;
+static GPUStatistics lastFrameGPUStats;
+static bool lastFrameStatsValid = false;
 
 // This can be read and written from ANYWHERE.
 volatile CoreState coreState = CORE_STEPPING;
@@ -188,6 +200,10 @@ void CPU_Init() {
 	g_DoubleTextureCoordinates = false;
 	Memory::g_PSPModel = g_Config.iPSPModel;
 
+	// Savedata, PGD and EBOOT decryption all go through libkirk.
+	AES_set_hw_accel(cpu_info.bAES);
+	SHASetHWAccel(cpu_info.bSHA);
+
 	std::string filename = coreParameter.fileToStart;
 	loadedFile = ResolveFileLoaderTarget(ConstructFileLoader(filename));
 #ifdef _M_X64
@@ -196,6 +212,7 @@ void CPU_Init() {
 	}
 #endif
 	IdentifiedFileType type = Identify_File(loadedFile);
+	g_gameStartup.Mark("identify");
 
 	// TODO: Put this somewhere better?
 	if (coreParameter.mountIso != "") {
@@ -227,10 +244,19 @@ void CPU_Init() {
 	std::string discID = g_paramSFO.GetDiscID();
 	coreParameter.compat.Load(discID);
 
+	g_gameStartup.Mark("sfo");
+
+	// Reading and parsing symbol files can be slow, and nothing needs them until the game is loaded.
+	TaskGroup symbolMapLoad;
+	GlobalThreadPool::Submit([] {
+		double start = real_time_now();
+		host->AttemptLoadSymbolMap();
+		g_gameStartup.MarkTask("symbols", start);
+	}, &symbolMapLoad);
+
 	Memory::Init();
 	mipsr4k.Reset();
-
-	host->AttemptLoadSymbolMap();
+	g_gameStartup.Mark("memory");
 
 	if (coreParameter.enableSound) {
 		Audio_Init();
@@ -240,6 +266,10 @@ void CPU_Init() {
 
 	// Init all the HLE modules
 	HLEInit();
+	g_gameStartup.Mark("hle");
+
+	// Loading adds the module's own symbols, so the map file must be in first.
+	GlobalThreadPool::Wait(symbolMapLoad);
 
 	// TODO: Check Game INI here for settings, patches and cheats, and modify coreParameter accordingly
 
@@ -310,19 +340,42 @@ void Core_UpdateState(CoreState newState) {
 }
 
 void Core_UpdateDebugStats(bool collectStats) {
+	{
+		std::lock_guard<std::mutex> guard(lastFrameStatsLock);
+		lastFrameGPUStats = gpuStats;
+		lastFrameStatsValid = coreCollectDebugStats;
+	}
+
+	collectStats = collectStats || coreCollectDebugStatsForced > 0;
 	if (coreCollectDebugStats != collectStats) {
 		coreCollectDebugStats = collectStats;
 		mipsr4k.ClearJitCache();
 	}
 
+	hleEndSyscallProfileFrame();
+	CoreTiming::EndEventProfileFrame();
 	kernelStats.ResetFrame();
 	gpuStats.ResetFrame();
 }
 
+void Core_ForceDebugStats(bool enable) {
+	coreCollectDebugStatsForced += enable ? 1 : -1;
+}
+
+bool Core_GetLastFrameGPUStats(GPUStatistics *stats) {
+	std::lock_guard<std::mutex> guard(lastFrameStatsLock);
+	if (!lastFrameStatsValid)
+		return false;
+	*stats = lastFrameGPUStats;
+	return true;
+}
+
 // Ugly!
 static bool pspIsInited = false;
 static bool pspIsIniting = false;
 static bool pspIsQuitting = false;
+// Which backend the current gpu was created for, it can outlive a PSP_Reboot().
+static GPUCore gpuCoreInited = GPUCORE_NULL;
 
 bool PSP_InitStart(const CoreParameter &coreParam, std::string *error_string) {
 	if (pspIsIniting || pspIsQuitting) {
@@ -345,6 +398,7 @@ bool PSP_InitStart(const CoreParameter &coreParam, std::string *error_string) {
 	}
 	coreParameter.errorString = "";
 	pspIsIniting = true;
+	g_gameStartup.Begin();
 	PSP_SetLoading("Loading game...");
 
 	CPU_Init();
@@ -359,6 +413,7 @@ bool PSP_InitStart(const CoreParameter &coreParam, std::string *error_string) {
 	if (!success) {
 		Core_NotifyLifecycle(CoreLifecycle::START_COMPLETE);
 		pspIsIniting = false;
+		g_gameStartup.End();
 	}
 	return success;
 }
@@ -374,15 +429,23 @@ bool PSP_InitUpdate(std::string *error_string) {
 
 	bool success = coreParameter.fileToStart != "";
 	*error_string = coreParameter.errorString;
+	if (success && gpu != nullptr && gpuCoreInited != coreParameter.gpuCore) {
+		// Kept by PSP_Reboot(), but the settings now want another backend.
+		GPU_Shutdown();
+	}
 	if (success && gpu == nullptr) {
+		g_gameStartup.Mark("load");
 		PSP_SetLoading("Starting graphics...");
 		Draw::DrawContext *draw = coreParameter.graphicsContext ? coreParameter.graphicsContext->GetDrawContext() : nullptr;
 		success = GPU_Init(coreParameter.graphicsContext, draw);
+		gpuCoreInited = coreParameter.gpuCore;
 		if (!success) {
 			*error_string = "Unable to initialize rendering engine.";
 		}
+		g_gameStartup.Mark("gpu");
 	}
 	if (!success) {
+		g_gameStartup.End();
 		PSP_Shutdown();
 		return true;
 	}
@@ -390,6 +453,7 @@ bool PSP_InitUpdate(std::string *error_string) {
 	pspIsInited = GPU_IsReady();
 	pspIsIniting = !pspIsInited;
 	if (pspIsInited) {
+		g_gameStartup.End("gpu ready");
 		Core_NotifyLifecycle(CoreLifecycle::START_COMPLETE);
 	}
 	return pspIsInited;
@@ -415,12 +479,7 @@ bool PSP_IsQuitting() {
 	return pspIsQuitting;
 }
 
-void PSP_Shutdown() {
-	// Do nothing if we never inited.
-	if (!pspIsInited && !pspIsIniting && !pspIsQuitting) {
-		return;
-	}
-
+static void PSP_ShutdownEmulation(bool keepGPU) {
 	// Make sure things know right away that PSP memory, etc. is going away.
 	pspIsQuitting = true;
 	if (coreState == CORE_RUNNING)
@@ -431,12 +490,18 @@ void PSP_Shutdown() {
 		MIPSAnalyst::StoreHashMap();
 	}
 #endif
+	MIPSAnalyst::StoreBlockProfiles();
 
 	if (pspIsIniting)
 		Core_NotifyLifecycle(CoreLifecycle::START_COMPLETE);
 	Core_NotifyLifecycle(CoreLifecycle::STOPPING);
+	if (keepGPU) {
+		// Before the memory it knows about goes away.
+		gpu->Reboot();
+	}
 	CPU_Shutdown();
-	GPU_Shutdown();
+	if (!keepGPU)
+		GPU_Shutdown();
 	g_paramSFO.Clear();
 	host->SetWindowTitle(0);
 	currentMIPS = 0;
@@ -447,6 +512,26 @@ void PSP_Shutdown() {
 	Core_NotifyLifecycle(CoreLifecycle::STOPPED);
 }
 
+void PSP_Shutdown() {
+	// Do nothing if we never inited.
+	if (!pspIsInited && !pspIsIniting && !pspIsQuitting) {
+		return;
+	}
+
+	PSP_ShutdownEmulation(false);
+}
+
+bool PSP_Reboot(std::string *error_string) {
+	// While still loading, or after the gpu failed, there's nothing worth keeping.
+	if (pspIsInited && gpu != nullptr) {
+		INFO_LOG(BOOT, "Rebooting %s, keeping the gpu", coreParameter.fileToStart.c_str());
+		PSP_ShutdownEmulation(true);
+	} else {
+		PSP_Shutdown();
+	}
+	return PSP_InitStart(coreParameter, error_string);
+}
+
 void PSP_BeginHostFrame() {
 	// Reapply the graphics state of the PSP
 	if (gpu) {
@@ -475,8 +560,51 @@ void PSP_RunLoopWhileState() {
 	}
 }
 
+void PSP_RunAheadLoopWhileState(int frames) {
+	static std::vector<u8> runAheadState;
+	CoreParameter &param = PSP_CoreParameter();
+
+	// The real frame advances the timeline with the latest input and plays audio.
+	PSP_RunLoopWhileState();
+	if (coreState != CORE_NEXTFRAME) {
+		// Stepping, quitting, or out of ticks. Nothing to predict from.
+		return;
+	}
+
+	// Uncompressed, into a reused buffer, so this is cheap enough for every frame.
+	if (SaveState::SaveToRam(runAheadState) != CChunkFileReader::ERROR_NONE) {
+		ERROR_LOG(SAVESTATE, "Run-ahead: failed to save state");
+		return;
+	}
+
+	// Emulate ahead with the same input, and only draw the last frame, which is what gets shown.
+	const int realSkipDraw = gstate_c.skipDrawReason & SKIPDRAW_SKIPFRAME;
+	param.runAheadFrame = true;
+	for (int i = 0; i < frames; ++i) {
+		coreState = CORE_RUNNING;
+		if (i == frames - 1)
+			gstate_c.skipDrawReason &= ~SKIPDRAW_SKIPFRAME;
+		else
+			gstate_c.skipDrawReason |= SKIPDRAW_SKIPFRAME;
+		PSP_RunLoopWhileState();
+		if (coreState != CORE_NEXTFRAME)
+			break;
+	}
+
+	// Roll back, keeping the GPU's caches and framebuffers like freeze-frame does.
+	if (SaveState::LoadFromRam(runAheadState) != CChunkFileReader::ERROR_NONE) {
+		ERROR_LOG(SAVESTATE, "Run-ahead: failed to restore state");
+	}
+	param.runAheadFrame = false;
+	gstate_c.skipDrawReason = (gstate_c.skipDrawReason & ~SKIPDRAW_SKIPFRAME) | realSkipDraw;
+	if (coreState == CORE_RUNNING)
+		coreState = CORE_NEXTFRAME;
+}
+
 void PSP_RunLoopUntil(u64 globalticks) {
-	SaveState::Process();
+	// Savestate operations would see the predicted future, so hold them until the real frame.
+	if (!PSP_CoreParameter().runAheadFrame)
+		SaveState::Process();
 	if (coreState == CORE_POWERDOWN || coreState == CORE_ERROR) {
 		return;
 	} else if (coreState == CORE_STEPPING) {
@@ -484,7 +612,15 @@ void PSP_RunLoopUntil(u64 globalticks) {
 		return;
 	}
 
-	mipsr4k.RunLoopUntil(globalticks);
+	{
+		CoreTiming::TimeCategoryScope timeScope(CoreTiming::TimeCategory::CPU);
+		mipsr4k.RunLoopUntil(globalticks);
+	}
+	// The UI may look at GPU state, so let display lists finish.
+	{
+		CoreTiming::TimeCategoryScope timeScope(CoreTiming::TimeCategory::GPU);
+		gpu->SyncThread();
+	}
 	gpu->CleanupBeforeUI();
 }
 
@@ -52,6 +52,7 @@ enum PSPDirectories {
 };
 
 class GraphicsContext;
+struct GPUStatistics;
 enum class GPUBackend;
 
 void ResetUIState();
@@ -69,10 +70,15 @@ bool PSP_IsIniting();
 bool PSP_IsInited();
 bool PSP_IsQuitting();
 void PSP_Shutdown();
+// Restarts the current game like PSP_Shutdown() and PSP_InitStart() would, but keeps the gpu with its shader,
+// pipeline and vertex decoder caches and texture replacements.  Finish with PSP_InitUpdate() as usual.
+bool PSP_Reboot(std::string *error_string);
 
 void PSP_BeginHostFrame();
 void PSP_EndHostFrame();
 void PSP_RunLoopWhileState();
+// Like PSP_RunLoopWhileState, but shows a frame emulated `frames` ahead and then rolls back.
+void PSP_RunAheadLoopWhileState(int frames);
 void PSP_RunLoopUntil(u64 globalticks);
 void PSP_RunLoopFor(int cycles);
 
@@ -87,6 +93,10 @@ struct PSP_LoadingLock {
 
 // Call before PSP_BeginHostFrame() in order to not miss any GPU stats.
 void Core_UpdateDebugStats(bool collectStats);
+// Keeps stats collected even when nothing shows them, like for the debugger.  Calls must be paired.
+void Core_ForceDebugStats(bool enable);
+// Copies the GPU stats for the last frame, or returns false if they weren't being collected.
+bool Core_GetLastFrameGPUStats(GPUStatistics *stats);
 
 void Audio_Init();
 void Audio_Shutdown();
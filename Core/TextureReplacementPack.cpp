@@ -0,0 +1,247 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include "ppsspp_config.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+#ifdef _WIN32
+#include "Common/CommonWindows.h"
+#include "util/text/utf8.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Common/FileUtil.h"
+#include "Common/Log.h"
+#include "Core/TextureReplacementPack.h"
+
+static const u32 PACK_MAGIC = 0x4B415052;  // RPAK
+static const u32 PACK_VERSION = 1;
+
+struct ReplacementPackHeader {
+	u32 magic;
+	u32 version;
+	u32 count;
+	u32 iniSize;
+	u64 indexOffset;
+	u64 iniOffset;
+};
+
+ReplacementPack::~ReplacementPack() {
+	Close();
+}
+
+bool ReplacementPack::Open(const std::string &filename) {
+	Close();
+
+#if PPSSPP_PLATFORM(UWP)
+	return false;
+#elif defined(_WIN32)
+	HANDLE file = CreateFileW(ConvertUTF8ToWString(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	HANDLE mapping = nullptr;
+	if (GetFileSizeEx(file, &size) && size.QuadPart >= (LONGLONG)sizeof(ReplacementPackHeader))
+		mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	void *base = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!base) {
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		ERROR_LOG(G3D, "Unable to map texture pack: %s", filename.c_str());
+		return false;
+	}
+	file_ = file;
+	mapping_ = mapping;
+	size_ = size.QuadPart;
+#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	void *base = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(ReplacementPackHeader) && (u64)st.st_size <= (size_t)-1)
+		base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	// The mapping stays valid without the descriptor.
+	close(fd);
+	if (base == MAP_FAILED) {
+		ERROR_LOG(G3D, "Unable to map texture pack: %s", filename.c_str());
+		return false;
+	}
+	size_ = st.st_size;
+#endif
+	base_ = (const u8 *)base;
+
+	const ReplacementPackHeader *header = (const ReplacementPackHeader *)base_;
+	bool valid = header->magic == PACK_MAGIC && header->version == PACK_VERSION;
+	valid = valid && header->indexOffset + (u64)header->count * sizeof(ReplacementPackEntry) <= size_;
+	valid = valid && header->iniOffset + header->iniSize <= size_ && (header->indexOffset & 7) == 0;
+	if (!valid) {
+		ERROR_LOG(G3D, "Invalid or outdated texture pack: %s", filename.c_str());
+		Close();
+		return false;
+	}
+
+	index_ = (const ReplacementPackEntry *)(base_ + header->indexOffset);
+	count_ = header->count;
+	for (u32 i = 0; i < count_; ++i) {
+		if (index_[i].offset + index_[i].size > size_) {
+			ERROR_LOG(G3D, "Truncated texture pack: %s", filename.c_str());
+			Close();
+			return false;
+		}
+	}
+	INFO_LOG(G3D, "Opened texture pack with %d files: %s", count_, filename.c_str());
+	return true;
+}
+
+void ReplacementPack::Close() {
+	if (!base_)
+		return;
+#if PPSSPP_PLATFORM(UWP)
+#elif defined(_WIN32)
+	UnmapViewOfFile(base_);
+	CloseHandle(mapping_);
+	CloseHandle(file_);
+	mapping_ = nullptr;
+	file_ = nullptr;
+#else
+	munmap((void *)base_, size_);
+#endif
+	base_ = nullptr;
+	size_ = 0;
+	index_ = nullptr;
+	count_ = 0;
+}
+
+const ReplacementPackEntry *ReplacementPack::LowerBound(u64 cachekey, u32 hash, u32 level, ReplacementPackType type) const {
+	ReplacementPackEntry key{ cachekey, hash, level, 0, 0, type };
+	return std::lower_bound(index_, index_ + count_, key);
+}
+
+const ReplacementPackEntry *ReplacementPack::Find(u64 cachekey, u32 hash, u32 level, ReplacementPackType type) const {
+	const ReplacementPackEntry *entry = LowerBound(cachekey, hash, level, type);
+	if (entry == index_ + count_ || entry->cachekey != cachekey || entry->hash != hash || entry->level != level || entry->type != type)
+		return nullptr;
+	return entry;
+}
+
+bool ReplacementPack::Has(u64 cachekey, u32 hash, u32 level) const {
+	const ReplacementPackEntry *entry = LowerBound(cachekey, hash, level, ReplacementPackType::KTX2);
+	return entry != index_ + count_ && entry->cachekey == cachekey && entry->hash == hash && entry->level == level;
+}
+
+std::string ReplacementPack::Ini() const {
+	const ReplacementPackHeader *header = (const ReplacementPackHeader *)base_;
+	return std::string((const char *)base_ + header->iniOffset, header->iniSize);
+}
+
+bool ReplacementPack::Build(const std::string &filename, const std::string &ini, std::vector<std::pair<ReplacementPackEntry, std::string>> &files, std::string *error) {
+	std::sort(files.begin(), files.end(), [](const std::pair<ReplacementPackEntry, std::string> &a, const std::pair<ReplacementPackEntry, std::string> &b) {
+		return a.first < b.first;
+	});
+
+	ReplacementPackHeader header{ PACK_MAGIC, PACK_VERSION, (u32)files.size(), (u32)ini.size() };
+	header.indexOffset = sizeof(header);
+	header.iniOffset = header.indexOffset + files.size() * sizeof(ReplacementPackEntry);
+
+	// Lay out the data first, the same file may be used by several aliases.
+	std::vector<std::pair<std::string, u64>> sources;
+	// Keyed by path, to find the offset and size of files already placed.
+	std::map<std::string, ReplacementPackEntry> placed;
+	u64 offset = (header.iniOffset + ini.size() + 15) & ~15ULL;
+	for (auto &file : files) {
+		file.first.offset = 0;
+		file.first.size = 0;
+		if (file.second.empty())
+			continue;
+		auto prev = placed.find(file.second);
+		if (prev != placed.end()) {
+			file.first.offset = prev->second.offset;
+			file.first.size = prev->second.size;
+			continue;
+		}
+		u64 size = File::GetFileSize(file.second);
+		if (size == 0 || size > 0xFFFFFFFF) {
+			*error = "Unable to read " + file.second;
+			return false;
+		}
+		file.first.offset = offset;
+		file.first.size = (u32)size;
+		placed[file.second] = file.first;
+		sources.push_back(std::make_pair(file.second, offset));
+		offset = (offset + size + 15) & ~15ULL;
+	}
+
+	// Write to a temp file, so a running game never sees a partial pack.
+	std::string tempFilename = filename + ".tmp";
+	FILE *f = File::OpenCFile(tempFilename, "wb");
+	if (!f) {
+		*error = "Unable to create " + tempFilename;
+		return false;
+	}
+
+	bool good = fwrite(&header, sizeof(header), 1, f) == 1;
+	for (const auto &file : files) {
+		good = good && fwrite(&file.first, sizeof(file.first), 1, f) == 1;
+	}
+	good = good && (ini.empty() || fwrite(ini.data(), ini.size(), 1, f) == 1);
+	u64 pos = header.iniOffset + ini.size();
+
+	std::vector<u8> buffer;
+	for (const auto &source : sources) {
+		if (!good)
+			break;
+		// Pad up to the aligned offset.
+		static const u8 zeros[16]{};
+		good = pos == source.second || fwrite(zeros, (size_t)(source.second - pos), 1, f) == 1;
+
+		FILE *in = File::OpenCFile(source.first, "rb");
+		size_t size = in ? (size_t)File::GetFileSize(in) : 0;
+		buffer.resize(size);
+		// If it changed since the layout was decided, the offsets are wrong.
+		good = good && in && size == placed[source.first].size && fread(&buffer[0], size, 1, in) == 1;
+		good = good && fwrite(&buffer[0], size, 1, f) == 1;
+		pos = source.second + size;
+		if (in)
+			fclose(in);
+		if (!good)
+			*error = "Unable to copy " + source.first;
+	}
+	if (fclose(f) != 0 && good) {
+		*error = "Unable to write " + tempFilename;
+		good = false;
+	}
+
+	if (good) {
+		if (File::Exists(filename))
+			File::Delete(filename);
+		good = File::Rename(tempFilename, filename);
+		if (!good)
+			*error = "Unable to write " + filename;
+	}
+	if (!good)
+		File::Delete(tempFilename);
+	return good;
+}
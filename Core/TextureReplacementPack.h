@@ -0,0 +1,90 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+// Higher types are tried last, so the compressed containers win over PNGs.
+enum class ReplacementPackType : u32 {
+	KTX2 = 0,
+	DDS = 1,
+	PNG = 2,
+};
+
+struct ReplacementPackEntry {
+	u64 cachekey;
+	u32 hash;
+	u32 level;
+	u64 offset;
+	// A size of 0 means the texture was explicitly ignored in textures.ini.
+	u32 size;
+	ReplacementPackType type;
+
+	bool operator <(const ReplacementPackEntry &e) const {
+		if (cachekey != e.cachekey)
+			return cachekey < e.cachekey;
+		if (hash != e.hash)
+			return hash < e.hash;
+		if (level != e.level)
+			return level < e.level;
+		return type < e.type;
+	}
+};
+
+// A whole texture replacement folder in one file: a sorted index, the resolved ini settings,
+// and the files themselves.  The file is memory mapped, so opening it costs nothing up front.
+class ReplacementPack {
+public:
+	~ReplacementPack();
+
+	bool Open(const std::string &filename);
+	void Close();
+	bool IsOpen() const {
+		return base_ != nullptr;
+	}
+
+	// Exact matches only, aliases with zeroed portions are handled by the caller.
+	const ReplacementPackEntry *Find(u64 cachekey, u32 hash, u32 level, ReplacementPackType type) const;
+	bool Has(u64 cachekey, u32 hash, u32 level) const;
+
+	const u8 *Data(u64 offset) const {
+		return base_ + offset;
+	}
+	u64 Size() const {
+		return size_;
+	}
+	std::string Ini() const;
+
+	// Files are paths to copy in, or empty for ignored entries.  The entries are sorted in place.
+	static bool Build(const std::string &filename, const std::string &ini, std::vector<std::pair<ReplacementPackEntry, std::string>> &files, std::string *error);
+
+private:
+	const ReplacementPackEntry *LowerBound(u64 cachekey, u32 hash, u32 level, ReplacementPackType type) const;
+
+	const u8 *base_ = nullptr;
+	u64 size_ = 0;
+	const ReplacementPackEntry *index_ = nullptr;
+	u32 count_ = 0;
+#ifdef _WIN32
+	void *file_ = nullptr;
+	void *mapping_ = nullptr;
+#endif
+};
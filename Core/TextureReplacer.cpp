@@ -22,8 +22,13 @@
 #endif
 
 #include <algorithm>
+#include <cstring>
+#include <set>
+#include <sstream>
 #include "i18n/i18n.h"
 #include "ext/xxhash.h"
+#include "thread/threadutil.h"
+#include "file/file_util.h"
 #include "file/ini_file.h"
 #include "Common/ColorConv.h"
 #include "Common/FileUtil.h"
@@ -35,15 +40,22 @@
 #include "GPU/Common/TextureDecoder.h"
 
 static const std::string INI_FILENAME = "textures.ini";
+static const std::string PACK_FILENAME = "textures.pack";
 static const std::string NEW_TEXTURE_DIR = "new/";
 static const int VERSION = 1;
 static const int MAX_MIP_LEVELS = 12;  // 12 should be plenty, 8 is the max mip levels supported by the PSP.
+static const std::string PREFETCH_FILENAME = "prefetch.dat";
+static const u32 PREFETCH_MAGIC = 0x58465052;  // RPFX
+static const u32 PREFETCH_VERSION = 1;
+static const size_t MAX_PREFETCH = 32;
 
 TextureReplacer::TextureReplacer() {
 	none_.alphaStatus_ = ReplacedTextureAlpha::UNKNOWN;
 }
 
 TextureReplacer::~TextureReplacer() {
+	StopLoading();
+	SavePrefetchIndex();
 }
 
 void TextureReplacer::Init() {
@@ -51,6 +63,11 @@ void TextureReplacer::Init() {
 }
 
 void TextureReplacer::NotifyConfigChanged() {
+	// The loader reads the ini settings, so it can't run while they change.
+	StopLoading();
+	SavePrefetchIndex();
+	prefetch_.clear();
+
 	gameID_ = g_paramSFO.GetDiscID();
 
 	enabled_ = g_Config.bReplaceTextures || g_Config.bSaveNewTextures;
@@ -66,9 +83,20 @@ void TextureReplacer::NotifyConfigChanged() {
 		enabled_ = File::Exists(basePath_) && File::IsDirectory(basePath_);
 	}
 
+	// Textures already loaded from the old pack keep it mapped until they're gone.
+	pack_.reset();
+	if (enabled_ && File::Exists(basePath_ + PACK_FILENAME)) {
+		std::shared_ptr<ReplacementPack> pack = std::make_shared<ReplacementPack>();
+		if (pack->Open(basePath_ + PACK_FILENAME))
+			pack_ = pack;
+	}
+
 	if (enabled_) {
 		enabled_ = LoadIni();
 	}
+	if (enabled_) {
+		LoadPrefetchIndex();
+	}
 }
 
 bool TextureReplacer::LoadIni() {
@@ -81,6 +109,14 @@ bool TextureReplacer::LoadIni() {
 	ignoreAddress_ = false;
 	reduceHash_ = false;
 
+	if (pack_) {
+		// Overrides were already applied, and [hashes] is in the pack index.
+		std::istringstream stream(pack_->Ini());
+		IniFile ini;
+		ini.Load(stream);
+		return LoadIniValues(ini);
+	}
+
 	if (File::Exists(basePath_ + INI_FILENAME)) {
 		IniFile ini;
 		ini.LoadFromVFS(basePath_ + INI_FILENAME);
@@ -293,18 +329,197 @@ ReplacedTexture &TextureReplacer::FindReplacement(u64 cachekey, u32 hash, int w,
 	}
 
 	ReplacementCacheKey replacementKey(cachekey, hash);
+	if (g_Config.bReplaceTexturesAsync) {
+		std::lock_guard<std::mutex> guard(loadLock_);
+		ReplacedTexture &result = cache_[replacementKey];
+		if (result.state_ == ReplacedTexture::State::READY) {
+			return result;
+		}
+		if (result.state_ == ReplacedTexture::State::UNLOADED) {
+			QueueLoad(replacementKey, w, h);
+			auto prefetch = prefetch_.find(replacementKey);
+			if (prefetch != prefetch_.end()) {
+				for (const LoadRequest &req : prefetch->second) {
+					QueueLoad(req.key, req.w, req.h);
+				}
+			}
+		}
+		// The original texture is used until it's ready.
+		return none_;
+	}
+
 	auto it = cache_.find(replacementKey);
 	if (it != cache_.end()) {
-		return it->second;
+		std::lock_guard<std::mutex> guard(loadLock_);
+		// Still owned by the load thread, from before async loading was turned off.
+		if (it->second.state_ == ReplacedTexture::State::QUEUED)
+			return none_;
+		if (it->second.populated_)
+			return it->second;
 	}
 
 	// Okay, let's construct the result.
 	ReplacedTexture &result = cache_[replacementKey];
 	result.alphaStatus_ = ReplacedTextureAlpha::UNKNOWN;
 	PopulateReplacement(&result, cachekey, hash, w, h);
+	result.populated_ = true;
 	return result;
 }
 
+// Call with loadLock_ held.
+void TextureReplacer::QueueLoad(const ReplacementCacheKey &key, int w, int h) {
+	ReplacedTexture &tex = cache_[key];
+	if (tex.state_ != ReplacedTexture::State::UNLOADED)
+		return;
+	if (!tex.populated_)
+		tex.alphaStatus_ = ReplacedTextureAlpha::UNKNOWN;
+	tex.state_ = ReplacedTexture::State::QUEUED;
+
+	LoadRequest req{ key, (u16)w, (u16)h };
+	loadQueue_.push_back(std::make_pair(&tex, req));
+	if (!loadThread_.joinable()) {
+		loadExit_ = false;
+		loadThread_ = std::thread([this] { LoadLoop(); });
+	}
+	loadCond_.notify_one();
+}
+
+void TextureReplacer::LoadLoop() {
+	setCurrentThreadName("TexReplace");
+	setCurrentThreadRole(ThreadRole::BACKGROUND);
+
+	std::unique_lock<std::mutex> guard(loadLock_);
+	while (!loadExit_) {
+		if (loadQueue_.empty()) {
+			loadCond_.wait(guard);
+			continue;
+		}
+
+		ReplacedTexture *tex = loadQueue_.front().first;
+		LoadRequest req = loadQueue_.front().second;
+		loadQueue_.pop_front();
+		guard.unlock();
+
+		// Both the lookup (which reads the PNG headers) and the decode happen here.
+		if (!tex->populated_) {
+			PopulateReplacement(tex, req.key.cachekey, req.key.hash, req.w, req.h);
+			tex->populated_ = true;
+		}
+		std::vector<std::vector<u8>> data(tex->levels_.size());
+		for (size_t i = 0; i < data.size(); ++i) {
+			const ReplacedTextureLevel &level = tex->levels_[i];
+			int pitch = ReplacedRowPitch(level.fmt, level.w);
+			data[i].resize(pitch * ReplacedRowCount(level.fmt, level.h));
+			tex->Decode((int)i, data[i].data(), pitch);
+		}
+
+		guard.lock();
+		tex->levelData_.swap(data);
+		tex->state_ = ReplacedTexture::State::READY;
+		// No need to rebuild textures that don't have a replacement.
+		if (tex->Valid()) {
+			loadDone_.push_back(req);
+		}
+	}
+}
+
+void TextureReplacer::StopLoading() {
+	if (!loadThread_.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> guard(loadLock_);
+		loadExit_ = true;
+		loadCond_.notify_one();
+	}
+	loadThread_.join();
+
+	for (auto &item : loadQueue_) {
+		item.first->state_ = ReplacedTexture::State::UNLOADED;
+	}
+	loadQueue_.clear();
+	loadDone_.clear();
+	loadExit_ = false;
+}
+
+void TextureReplacer::GetLoadedReplacements(std::vector<ReplacementCacheKey> &loaded) {
+	std::vector<LoadRequest> done;
+	{
+		std::lock_guard<std::mutex> guard(loadLock_);
+		done.swap(loadDone_);
+	}
+	for (const LoadRequest &req : done) {
+		loaded.push_back(req.key);
+	}
+
+	// These finished in the same frame, so next time the first one is needed, fetch the rest too.
+	if (done.size() <= 1)
+		return;
+	std::vector<LoadRequest> &followers = prefetch_[done[0].key];
+	for (size_t i = 1; i < done.size() && followers.size() < MAX_PREFETCH; ++i) {
+		auto same = [&](const LoadRequest &req) { return req.key == done[i].key; };
+		if (std::find_if(followers.begin(), followers.end(), same) == followers.end()) {
+			followers.push_back(done[i]);
+			prefetchDirty_ = true;
+		}
+	}
+}
+
+void TextureReplacer::LoadPrefetchIndex() {
+	FILE *f = File::OpenCFile(basePath_ + PREFETCH_FILENAME, "rb");
+	if (!f)
+		return;
+
+	u32 header[3];
+	if (fread(header, sizeof(header), 1, f) == 1 && header[0] == PREFETCH_MAGIC && header[1] == PREFETCH_VERSION) {
+		for (u32 i = 0; i < header[2]; ++i) {
+			u64 cachekey;
+			u32 hash;
+			u32 count;
+			if (fread(&cachekey, sizeof(cachekey), 1, f) != 1 || fread(&hash, sizeof(hash), 1, f) != 1 || fread(&count, sizeof(count), 1, f) != 1 || count > MAX_PREFETCH)
+				break;
+			std::vector<LoadRequest> followers(count, LoadRequest{ ReplacementCacheKey(0, 0), 0, 0 });
+			bool good = true;
+			for (LoadRequest &req : followers) {
+				good = good && fread(&req.key.cachekey, sizeof(u64), 1, f) == 1 && fread(&req.key.hash, sizeof(u32), 1, f) == 1;
+				good = good && fread(&req.w, sizeof(u16), 1, f) == 1 && fread(&req.h, sizeof(u16), 1, f) == 1;
+			}
+			if (!good)
+				break;
+			prefetch_[ReplacementCacheKey(cachekey, hash)] = followers;
+		}
+	}
+	fclose(f);
+	prefetchDirty_ = false;
+}
+
+void TextureReplacer::SavePrefetchIndex() {
+	if (!prefetchDirty_ || !enabled_)
+		return;
+	prefetchDirty_ = false;
+
+	FILE *f = File::OpenCFile(basePath_ + PREFETCH_FILENAME, "wb");
+	if (!f) {
+		WARN_LOG(G3D, "Unable to save texture prefetch index");
+		return;
+	}
+
+	u32 header[3] = { PREFETCH_MAGIC, PREFETCH_VERSION, (u32)prefetch_.size() };
+	fwrite(header, sizeof(header), 1, f);
+	for (const auto &item : prefetch_) {
+		u32 count = (u32)item.second.size();
+		fwrite(&item.first.cachekey, sizeof(u64), 1, f);
+		fwrite(&item.first.hash, sizeof(u32), 1, f);
+		fwrite(&count, sizeof(count), 1, f);
+		for (const LoadRequest &req : item.second) {
+			fwrite(&req.key.cachekey, sizeof(u64), 1, f);
+			fwrite(&req.key.hash, sizeof(u32), 1, f);
+			fwrite(&req.w, sizeof(u16), 1, f);
+			fwrite(&req.h, sizeof(u16), 1, f);
+		}
+	}
+	fclose(f);
+}
+
 void TextureReplacer::PopulateReplacement(ReplacedTexture *result, u64 cachekey, u32 hash, int w, int h) {
 	int newW = w;
 	int newH = h;
@@ -314,9 +529,22 @@ void TextureReplacer::PopulateReplacement(ReplacedTexture *result, u64 cachekey,
 		cachekey = cachekey & 0xFFFFFFFFULL;
 	}
 
+	if (pack_) {
+		PopulateFromPack(result, cachekey, hash, w, h, newW, newH);
+		return;
+	}
+
 	for (int i = 0; i < MAX_MIP_LEVELS; ++i) {
 		const std::string hashfile = LookupHashFile(cachekey, hash, i);
 		const std::string filename = basePath_ + hashfile;
+		if (i == 0 && compressedFormats_ != 0 && !hashfile.empty() && newW == w && newH == h) {
+			// These hold the whole mip chain, and skip decoding entirely.
+			size_t dot = hashfile.find_last_of("./");
+			std::string base = basePath_ + (dot != hashfile.npos && hashfile[dot] == '.' ? hashfile.substr(0, dot) : hashfile);
+			if (PopulateCompressed(result, base + ".ktx2", w, h) || PopulateCompressed(result, base + ".dds", w, h)) {
+				return;
+			}
+		}
 		if (hashfile.empty() || !File::Exists(filename)) {
 			// Out of valid mip levels.  Bail out.
 			break;
@@ -371,6 +599,228 @@ void TextureReplacer::PopulateReplacement(ReplacedTexture *result, u64 cachekey,
 	result->alphaStatus_ = ReplacedTextureAlpha::UNKNOWN;
 }
 
+void TextureReplacer::PopulateFromPack(ReplacedTexture *result, u64 cachekey, u32 hash, int w, int h, int newW, int newH) {
+	for (int i = 0; i < MAX_MIP_LEVELS; ++i) {
+		u64 levelKey = cachekey;
+		u32 levelHash = hash;
+		if (!LookupPackKey(levelKey, levelHash, i))
+			break;
+		const std::string name = PACK_FILENAME + ":" + HashName(levelKey, levelHash, i);
+
+		if (i == 0 && compressedFormats_ != 0 && newW == w && newH == h) {
+			for (ReplacementPackType type : { ReplacementPackType::KTX2, ReplacementPackType::DDS }) {
+				const ReplacementPackEntry *entry = pack_->Find(levelKey, levelHash, 0, type);
+				if (entry && entry->size != 0 && PopulateCompressed(result, name, pack_->Data(entry->offset), entry->size, entry->size, type == ReplacementPackType::KTX2, pack_, entry->offset)) {
+					return;
+				}
+			}
+		}
+
+		// An empty entry means it was ignored.
+		const ReplacementPackEntry *entry = pack_->Find(levelKey, levelHash, i, ReplacementPackType::PNG);
+		if (!entry || entry->size == 0)
+			break;
+
+		bool good = false;
+		ReplacedTextureLevel level;
+		level.fmt = ReplacedTextureFormat::F_8888;
+		level.file = name;
+		level.pack = pack_;
+		level.offset = entry->offset;
+		level.size = entry->size;
+
+#ifdef USING_QT_UI
+		QImage image;
+		if (!image.loadFromData(pack_->Data(entry->offset), entry->size, "PNG")) {
+			ERROR_LOG(G3D, "Could not load texture replacement info: %s", name.c_str());
+		} else {
+			level.w = (image.width() * w) / newW;
+			level.h = (image.height() * h) / newH;
+			good = true;
+		}
+#else
+		png_image png = {};
+		png.version = PNG_IMAGE_VERSION;
+		if (png_image_begin_read_from_memory(&png, pack_->Data(entry->offset), entry->size)) {
+			level.w = (png.width * w) / newW;
+			level.h = (png.height * h) / newH;
+			good = true;
+		} else {
+			ERROR_LOG(G3D, "Could not load texture replacement info: %s - %s", name.c_str(), png.message);
+		}
+		png_image_free(&png);
+#endif
+
+		if (good && i != 0) {
+			if (level.w != (result->levels_[0].w >> i) || level.h != (result->levels_[0].h >> i)) {
+				WARN_LOG(G3D, "Replacement mipmap invalid: size=%dx%d, expected=%dx%d (level %d, '%s')", level.w, level.h, result->levels_[0].w >> i, result->levels_[0].h >> i, i, name.c_str());
+				good = false;
+			}
+		}
+
+		if (good)
+			result->levels_.push_back(level);
+		else
+			break;
+	}
+
+	result->alphaStatus_ = ReplacedTextureAlpha::UNKNOWN;
+}
+
+struct CompressedLevel {
+	u32 offset;
+	u32 size;
+};
+
+// Enough for the header and level index of either container.
+static const size_t COMPRESSED_HEADER_SIZE = 1024;
+
+static bool ReadDDS(const u8 *data, size_t avail, u64 fileSize, ReplacedTextureFormat &fmt, u32 &w, u32 &h, std::vector<CompressedLevel> &levels) {
+	u32 header[32];
+	if (avail < sizeof(header))
+		return false;
+	memcpy(header, data, sizeof(header));
+	if (header[0] != 0x20534444 || header[1] != 124)
+		return false;
+	// No cubemaps or volumes.
+	if ((header[28] & 0x200) != 0 || (header[28] & 0x200000) != 0)
+		return false;
+
+	u32 offset = sizeof(header);
+	switch (header[21]) {
+	case 0x31545844: fmt = ReplacedTextureFormat::F_BC1; break;  // DXT1
+	case 0x33545844: fmt = ReplacedTextureFormat::F_BC2; break;  // DXT3
+	case 0x35545844: fmt = ReplacedTextureFormat::F_BC3; break;  // DXT5
+	case 0x30315844:  // DX10
+	{
+		u32 dx10[5];
+		if (avail < offset + sizeof(dx10))
+			return false;
+		memcpy(dx10, data + offset, sizeof(dx10));
+		if (dx10[3] != 1)
+			return false;
+		offset += sizeof(dx10);
+		switch (dx10[0]) {
+		case 71: fmt = ReplacedTextureFormat::F_BC1; break;
+		case 74: fmt = ReplacedTextureFormat::F_BC2; break;
+		case 77: fmt = ReplacedTextureFormat::F_BC3; break;
+		case 98: fmt = ReplacedTextureFormat::F_BC7; break;
+		default: return false;
+		}
+		break;
+	}
+	default:
+		return false;
+	}
+
+	w = header[4];
+	h = header[3];
+	u32 mipCount = (header[2] & 0x20000) != 0 ? std::max(header[7], 1U) : 1;
+	for (u32 i = 0; i < mipCount; ++i) {
+		int mipW = std::max(1, (int)w >> i);
+		int mipH = std::max(1, (int)h >> i);
+		u32 size = ReplacedRowPitch(fmt, mipW) * ReplacedRowCount(fmt, mipH);
+		if (offset + (u64)size > fileSize)
+			return false;
+		levels.push_back(CompressedLevel{ offset, size });
+		offset += size;
+	}
+	return true;
+}
+
+static bool ReadKTX2(const u8 *data, size_t avail, u64 fileSize, ReplacedTextureFormat &fmt, u32 &w, u32 &h, std::vector<CompressedLevel> &levels) {
+	static const u8 identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+	// vkFormat, typeSize, width, height, depth, layers, faces, levels, supercompression, then the DFD/KVD index.
+	u32 header[13];
+	// Followed by the supercompression global data index, then the levels.
+	const size_t levelIndexOffset = sizeof(identifier) + sizeof(header) + 2 * sizeof(u64);
+	if (avail < levelIndexOffset || memcmp(data, identifier, sizeof(identifier)) != 0)
+		return false;
+	memcpy(header, data + sizeof(identifier), sizeof(header));
+	// Only plain 2D textures, and no supercompression.
+	if (header[4] != 0 || header[5] > 1 || header[6] != 1 || header[8] != 0)
+		return false;
+
+	switch (header[0]) {
+	case 131: case 133: fmt = ReplacedTextureFormat::F_BC1; break;
+	case 135: fmt = ReplacedTextureFormat::F_BC2; break;
+	case 137: fmt = ReplacedTextureFormat::F_BC3; break;
+	case 145: fmt = ReplacedTextureFormat::F_BC7; break;
+	case 147: fmt = ReplacedTextureFormat::F_ETC2_RGB; break;
+	case 151: fmt = ReplacedTextureFormat::F_ETC2_RGBA; break;
+	case 157: fmt = ReplacedTextureFormat::F_ASTC_4x4; break;
+	default: return false;
+	}
+
+	w = header[2];
+	h = header[3];
+	u32 mipCount = std::max(header[7], 1U);
+	for (u32 i = 0; i < mipCount; ++i) {
+		// byteOffset, byteLength, uncompressedByteLength.
+		u64 index[3];
+		if (avail < levelIndexOffset + (i + 1) * sizeof(index))
+			return false;
+		memcpy(index, data + levelIndexOffset + i * sizeof(index), sizeof(index));
+		int mipW = std::max(1, (int)w >> i);
+		int mipH = std::max(1, (int)h >> i);
+		u64 size = ReplacedRowPitch(fmt, mipW) * ReplacedRowCount(fmt, mipH);
+		if (index[1] != size || index[0] + size > fileSize)
+			return false;
+		levels.push_back(CompressedLevel{ (u32)index[0], (u32)size });
+	}
+	return true;
+}
+
+bool TextureReplacer::PopulateCompressed(ReplacedTexture *result, const std::string &filename, int w, int h) {
+	FILE *fp = File::OpenCFile(filename, "rb");
+	if (!fp)
+		return false;
+
+	u8 header[COMPRESSED_HEADER_SIZE];
+	u64 fileSize = File::GetFileSize(fp);
+	size_t avail = fread(header, 1, sizeof(header), fp);
+	fclose(fp);
+
+	bool isKTX2 = filename.size() > 5 && filename.compare(filename.size() - 5, 5, ".ktx2") == 0;
+	return PopulateCompressed(result, filename, header, avail, fileSize, isKTX2, nullptr, 0);
+}
+
+bool TextureReplacer::PopulateCompressed(ReplacedTexture *result, const std::string &filename, const u8 *data, size_t avail, u64 fileSize, bool isKTX2, const std::shared_ptr<ReplacementPack> &pack, u64 packOffset) {
+	ReplacedTextureFormat fmt;
+	u32 width = 0;
+	u32 height = 0;
+	std::vector<CompressedLevel> levels;
+	bool good = isKTX2 ? ReadKTX2(data, avail, fileSize, fmt, width, height, levels) : ReadDDS(data, avail, fileSize, fmt, width, height, levels);
+
+	if (!good) {
+		ERROR_LOG(G3D, "Unsupported or invalid compressed texture replacement: %s", filename.c_str());
+		return false;
+	}
+	if ((compressedFormats_ & (1 << (int)fmt)) == 0) {
+		// Probably meant for another type of device, there may be another file for us.
+		return false;
+	}
+	if ((width & 3) != 0 || (height & 3) != 0) {
+		WARN_LOG(G3D, "Compressed texture replacement must be a multiple of 4 in size: %s", filename.c_str());
+		return false;
+	}
+
+	for (size_t i = 0; i < levels.size() && i < MAX_MIP_LEVELS; ++i) {
+		ReplacedTextureLevel level;
+		level.w = std::max(1, (int)width >> i);
+		level.h = std::max(1, (int)height >> i);
+		level.fmt = fmt;
+		level.file = filename;
+		level.pack = pack;
+		level.offset = packOffset + levels[i].offset;
+		level.size = levels[i].size;
+		result->levels_.push_back(level);
+	}
+	// We can't cheaply check the alpha of compressed blocks.
+	result->alphaStatus_ = fmt == ReplacedTextureFormat::F_ETC2_RGB ? ReplacedTextureAlpha::FULL : ReplacedTextureAlpha::UNKNOWN;
+	return true;
+}
+
 #ifndef USING_QT_UI
 static bool WriteTextureToPNG(png_imagep image, const std::string &filename, int convert_to_8bit, const void *buffer, png_int_32 row_stride, const void *colormap) {
 	FILE *fp = File::OpenCFile(filename, "wb");
@@ -412,6 +862,13 @@ void TextureReplacer::NotifyTextureDecoded(const ReplacedTextureDecodeInfo &repl
 		cachekey = cachekey & 0xFFFFFFFFULL;
 	}
 
+	u64 packKey = cachekey;
+	u32 packHash = replacedInfo.hash;
+	if (pack_ && LookupPackKey(packKey, packHash, level)) {
+		// Already in the pack (or ignored there.)
+		return;
+	}
+
 	std::string hashfile = LookupHashFile(cachekey, replacedInfo.hash, level);
 	const std::string filename = basePath_ + hashfile;
 	const std::string saveFilename = basePath_ + NEW_TEXTURE_DIR + hashfile;
@@ -517,45 +974,54 @@ void TextureReplacer::NotifyTextureDecoded(const ReplacedTextureDecodeInfo &repl
 	savedCache_[replacementKey] = saved;
 }
 
-std::string TextureReplacer::LookupHashFile(u64 cachekey, u32 hash, int level) {
+// Tries the exact key first, then the aliases with zeroed portions, in order of preference.
+template <typename F>
+static bool FindAliasKey(u64 cachekey, u32 hash, int level, bool ignoreAddress, F exists) {
 	ReplacementAliasKey key(cachekey, hash, level);
-	auto alias = aliases_.find(key);
-	if (alias == aliases_.end()) {
-		// Also check for a few more aliases with zeroed portions:
-		// Only clut hash (very dangerous in theory, in practice not more than missing "just" data hash)
-		key.cachekey = cachekey & 0xFFFFFFFFULL;
-		key.hash = 0;
-		alias = aliases_.find(key);
+	if (exists(key))
+		return true;
 
-		if (!ignoreAddress_ && alias == aliases_.end()) {
-			// No data hash.
-			key.cachekey = cachekey;
-			key.hash = 0;
-			alias = aliases_.find(key);
-		}
+	// Only clut hash (very dangerous in theory, in practice not more than missing "just" data hash)
+	key.cachekey = cachekey & 0xFFFFFFFFULL;
+	key.hash = 0;
+	if (exists(key))
+		return true;
 
-		if (alias == aliases_.end()) {
-			// No address.
-			key.cachekey = cachekey & 0xFFFFFFFFULL;
-			key.hash = hash;
-			alias = aliases_.find(key);
-		}
+	if (!ignoreAddress) {
+		// No data hash.
+		key.cachekey = cachekey;
+		key.hash = 0;
+		if (exists(key))
+			return true;
+	}
 
-		if (!ignoreAddress_ && alias == aliases_.end()) {
-			// Address, but not clut hash (in case of garbage clut data.)
-			key.cachekey = cachekey & ~0xFFFFFFFFULL;
-			key.hash = hash;
-			alias = aliases_.find(key);
-		}
+	// No address.
+	key.cachekey = cachekey & 0xFFFFFFFFULL;
+	key.hash = hash;
+	if (exists(key))
+		return true;
 
-		if (alias == aliases_.end()) {
-			// Anything with this data hash (a little dangerous.)
-			key.cachekey = 0;
-			key.hash = hash;
-			alias = aliases_.find(key);
-		}
+	if (!ignoreAddress) {
+		// Address, but not clut hash (in case of garbage clut data.)
+		key.cachekey = cachekey & ~0xFFFFFFFFULL;
+		key.hash = hash;
+		if (exists(key))
+			return true;
 	}
 
+	// Anything with this data hash (a little dangerous.)
+	key.cachekey = 0;
+	key.hash = hash;
+	return exists(key);
+}
+
+std::string TextureReplacer::LookupHashFile(u64 cachekey, u32 hash, int level) {
+	auto alias = aliases_.end();
+	FindAliasKey(cachekey, hash, level, ignoreAddress_, [&](const ReplacementAliasKey &key) {
+		alias = aliases_.find(key);
+		return alias != aliases_.end();
+	});
+
 	if (alias != aliases_.end()) {
 		// Note: this will be blank if explicitly ignored.
 		return alias->second;
@@ -564,6 +1030,17 @@ std::string TextureReplacer::LookupHashFile(u64 cachekey, u32 hash, int level) {
 	return HashName(cachekey, hash, level) + ".png";
 }
 
+// Updates cachekey and hash to the alias stored in the pack.
+bool TextureReplacer::LookupPackKey(u64 &cachekey, u32 &hash, int level) {
+	return FindAliasKey(cachekey, hash, level, ignoreAddress_, [&](const ReplacementAliasKey &key) {
+		if (!pack_->Has(key.cachekey, key.hash, level))
+			return false;
+		cachekey = key.cachekey;
+		hash = key.hash;
+		return true;
+	});
+}
+
 std::string TextureReplacer::HashName(u64 cachekey, u32 hash, int level) {
 	char hashname[16 + 8 + 1 + 11 + 1] = {};
 	if (level > 0) {
@@ -588,14 +1065,73 @@ bool TextureReplacer::LookupHashRange(u32 addr, int &w, int &h) {
 	return false;
 }
 
+size_t ReplacedTexture::MemorySize() const {
+	size_t bytes = 0;
+	for (const ReplacedTextureLevel &level : levels_) {
+		bytes += (size_t)ReplacedRowPitch(level.fmt, level.w) * ReplacedRowCount(level.fmt, level.h);
+	}
+	return bytes;
+}
+
 void ReplacedTexture::Load(int level, void *out, int rowPitch) {
 	_assert_msg_(G3D, (size_t)level < levels_.size(), "Invalid miplevel");
 	_assert_msg_(G3D, out != nullptr && rowPitch > 0, "Invalid out/pitch");
 
+	if ((size_t)level >= levelData_.size() || levelData_[level].empty()) {
+		Decode(level, out, rowPitch);
+		return;
+	}
+
+	// Already decoded in the background.
 	const ReplacedTextureLevel &info = levels_[level];
+	const u8 *src = levelData_[level].data();
+	int pitch = ReplacedRowPitch(info.fmt, info.w);
+	for (int y = 0; y < ReplacedRowCount(info.fmt, info.h); ++y) {
+		memcpy((u8 *)out + y * rowPitch, src + y * pitch, pitch);
+	}
+	levelData_[level].clear();
+	levelData_[level].shrink_to_fit();
+	if (level == MaxLevel()) {
+		// Uploaded, no need to keep it around.  A rebuild will queue it again.
+		levelData_.clear();
+		state_ = State::UNLOADED;
+	}
+}
+
+void ReplacedTexture::Decode(int level, void *out, int rowPitch) {
+	const ReplacedTextureLevel &info = levels_[level];
+
+	if (IsCompressedFormat(info.fmt) && info.pack) {
+		int pitch = ReplacedRowPitch(info.fmt, info.w);
+		const u8 *src = info.pack->Data(info.offset);
+		for (int y = 0; y < ReplacedRowCount(info.fmt, info.h); ++y) {
+			memcpy((u8 *)out + y * rowPitch, src + y * pitch, pitch);
+		}
+		return;
+	}
+
+	if (IsCompressedFormat(info.fmt)) {
+		// Uploaded as is, just copy the blocks.
+		FILE *fp = File::OpenCFile(info.file, "rb");
+		int pitch = ReplacedRowPitch(info.fmt, info.w);
+		bool good = fp && fseek(fp, info.offset, SEEK_SET) == 0;
+		for (int y = 0; good && y < ReplacedRowCount(info.fmt, info.h); ++y) {
+			good = fread((u8 *)out + y * rowPitch, pitch, 1, fp) == 1;
+		}
+		if (!good) {
+			ERROR_LOG(G3D, "Could not load compressed texture replacement: %s", info.file.c_str());
+		}
+		if (fp)
+			fclose(fp);
+		return;
+	}
 
 #ifdef USING_QT_UI
-	QImage image(info.file.c_str(), "PNG");
+	QImage image;
+	if (info.pack)
+		image.loadFromData(info.pack->Data(info.offset), info.size, "PNG");
+	else
+		image.load(info.file.c_str(), "PNG");
 	if (image.isNull()) {
 		ERROR_LOG(G3D, "Could not load texture replacement info: %s", info.file.c_str());
 		return;
@@ -625,8 +1161,15 @@ void ReplacedTexture::Load(int level, void *out, int rowPitch) {
 	png_image png = {};
 	png.version = PNG_IMAGE_VERSION;
 
-	FILE *fp = File::OpenCFile(info.file, "rb");
-	if (!png_image_begin_read_from_stdio(&png, fp)) {
+	FILE *fp = nullptr;
+	bool opened;
+	if (info.pack) {
+		opened = png_image_begin_read_from_memory(&png, info.pack->Data(info.offset), info.size) != 0;
+	} else {
+		fp = File::OpenCFile(info.file, "rb");
+		opened = png_image_begin_read_from_stdio(&png, fp) != 0;
+	}
+	if (!opened) {
 		ERROR_LOG(G3D, "Could not load texture replacement info: %s - %s", info.file.c_str(), png.message);
 		return;
 	}
@@ -654,7 +1197,8 @@ void ReplacedTexture::Load(int level, void *out, int rowPitch) {
 		}
 	}
 
-	fclose(fp);
+	if (fp)
+		fclose(fp);
 	png_image_free(&png);
 #endif
 }
@@ -701,3 +1245,91 @@ bool TextureReplacer::GenerateIni(const std::string &gameID, std::string *genera
 	}
 	return File::Exists(texturesDirectory + INI_FILENAME);
 }
+
+bool TextureReplacer::BuildPack(const std::string &gameID, std::string *error) {
+	if (gameID.empty()) {
+		*error = "No game running";
+		return false;
+	}
+
+	// Always read the loose files, even if there's already a pack.
+	TextureReplacer replacer;
+	replacer.gameID_ = gameID;
+	replacer.basePath_ = GetSysDirectory(DIRECTORY_TEXTURES) + gameID + "/";
+	if (!File::Exists(replacer.basePath_) || !File::IsDirectory(replacer.basePath_)) {
+		*error = "No textures folder for " + gameID;
+		return false;
+	}
+	if (!replacer.LoadIni()) {
+		*error = "Invalid " + INI_FILENAME;
+		return false;
+	}
+
+	std::vector<std::pair<ReplacementPackEntry, std::string>> files;
+	auto addFiles = [&](const ReplacementAliasKey &key, const std::string &hashfile) {
+		ReplacementPackEntry entry{ key.cachekey, key.hash, key.level, 0, 0, ReplacementPackType::PNG };
+		if (hashfile.empty()) {
+			files.push_back(std::make_pair(entry, std::string()));
+			return;
+		}
+		const std::string filename = replacer.basePath_ + hashfile;
+		if (File::Exists(filename))
+			files.push_back(std::make_pair(entry, filename));
+		if (key.level == 0) {
+			// Include the compressed versions, they're picked at load time based on the device.
+			size_t dot = hashfile.find_last_of("./");
+			std::string base = replacer.basePath_ + (dot != hashfile.npos && hashfile[dot] == '.' ? hashfile.substr(0, dot) : hashfile);
+			entry.type = ReplacementPackType::KTX2;
+			if (File::Exists(base + ".ktx2"))
+				files.push_back(std::make_pair(entry, base + ".ktx2"));
+			entry.type = ReplacementPackType::DDS;
+			if (File::Exists(base + ".dds"))
+				files.push_back(std::make_pair(entry, base + ".dds"));
+		}
+	};
+
+	for (const auto &alias : replacer.aliases_) {
+		addFiles(alias.first, alias.second);
+	}
+
+	// Files named after their hash don't need to be listed in the ini.
+	std::vector<FileInfo> found;
+	getFilesInDir(replacer.basePath_.c_str(), &found, "png:ktx2:dds");
+	std::set<std::pair<std::pair<u64, u32>, int>> hashNamed;
+	for (const FileInfo &info : found) {
+		ReplacementAliasKey key(0, 0, 0);
+		std::string base = info.name.substr(0, info.name.find_last_of('.'));
+		if (sscanf(base.c_str(), "%16llx%8x_%d", &key.cachekey, &key.hash, &key.level) < 2 || replacer.HashName(key.cachekey, key.hash, key.level) != base)
+			continue;
+		// An alias would take priority, so these would never be used.
+		const std::string hashfile = replacer.HashName(key.cachekey, key.hash, key.level) + ".png";
+		if (replacer.LookupHashFile(key.cachekey, key.hash, key.level) != hashfile)
+			continue;
+		if (hashNamed.insert(std::make_pair(std::make_pair(key.cachekey, key.hash), (int)key.level)).second)
+			addFiles(key, hashfile);
+	}
+
+	if (files.empty()) {
+		*error = "No textures found for " + gameID;
+		return false;
+	}
+
+	// The settings, with the per game override already applied.
+	static const char *const hashNames[] = { "quick", "xxh32", "xxh64" };
+	std::ostringstream ini;
+	ini << "[options]\n";
+	ini << "version = " << VERSION << "\n";
+	ini << "hash = " << hashNames[(int)replacer.hash_] << "\n";
+	ini << "video = " << (replacer.allowVideo_ ? "True" : "False") << "\n";
+	ini << "ignoreAddress = " << (replacer.ignoreAddress_ ? "True" : "False") << "\n";
+	ini << "reduceHash = " << (replacer.reduceHash_ ? "True" : "False") << "\n";
+	ini << "[hashranges]\n";
+	for (const auto &range : replacer.hashranges_) {
+		char line[64];
+		snprintf(line, sizeof(line), "0x%08x,%d,%d = %d,%d\n", (u32)(range.first >> 32), (int)((range.first >> 16) & 0xFFFF), (int)(range.first & 0xFFFF), range.second.first, range.second.second);
+		ini << line;
+	}
+
+	INFO_LOG(G3D, "Building texture pack for %s with %d files", gameID.c_str(), (int)files.size());
+	return ReplacementPack::Build(replacer.basePath_ + PACK_FILENAME, ini.str(), files, error);
+}
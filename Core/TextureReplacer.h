@@ -17,12 +17,18 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <deque>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 #include "Common/Common.h"
 #include "Common/MemoryUtil.h"
+#include "Core/TextureReplacementPack.h"
 #include "GPU/ge_constants.h"
 
 class IniFile;
@@ -38,8 +44,36 @@ enum class ReplacedTextureFormat {
 	F_1555_ABGR,
 	F_4444_ABGR,
 	F_8888_BGRA,
+	// Block compressed, from .dds or .ktx2 files.  Only used if the backend supports them.
+	F_BC1,
+	F_BC2,
+	F_BC3,
+	F_BC7,
+	F_ETC2_RGB,
+	F_ETC2_RGBA,
+	F_ASTC_4x4,
 };
 
+inline bool IsCompressedFormat(ReplacedTextureFormat fmt) {
+	return fmt >= ReplacedTextureFormat::F_BC1;
+}
+
+// All the compressed formats use 4x4 blocks.
+inline int CompressedBlockBytes(ReplacedTextureFormat fmt) {
+	return fmt == ReplacedTextureFormat::F_BC1 || fmt == ReplacedTextureFormat::F_ETC2_RGB ? 8 : 16;
+}
+
+// Bytes per row (of blocks, for compressed formats) when tightly packed.
+inline int ReplacedRowPitch(ReplacedTextureFormat fmt, int w) {
+	if (IsCompressedFormat(fmt))
+		return ((w + 3) / 4) * CompressedBlockBytes(fmt);
+	return w * (fmt == ReplacedTextureFormat::F_8888 || fmt == ReplacedTextureFormat::F_8888_BGRA ? 4 : 2);
+}
+
+inline int ReplacedRowCount(ReplacedTextureFormat fmt, int h) {
+	return IsCompressedFormat(fmt) ? (h + 3) / 4 : h;
+}
+
 // These must match the constants in TextureCacheCommon.
 enum class ReplacedTextureAlpha {
 	UNKNOWN = 0x04,
@@ -59,6 +93,10 @@ struct ReplacedTextureLevel {
 	int h;
 	ReplacedTextureFormat fmt;
 	std::string file;
+	// Where the level is inside a .dds or .ktx2 file, or inside the pack if set.
+	std::shared_ptr<ReplacementPack> pack;
+	u64 offset = 0;
+	u32 size = 0;
 };
 
 struct ReplacementCacheKey {
@@ -150,11 +188,26 @@ struct ReplacedTexture {
 		return (u8)alphaStatus_;
 	}
 
+	// For compressed formats, rowPitch is per row of blocks.
 	void Load(int level, void *out, int rowPitch);
+	// Bytes all levels take once loaded.
+	size_t MemorySize() const;
 
 protected:
+	enum class State {
+		UNLOADED,
+		QUEUED,
+		READY,
+	};
+
+	void Decode(int level, void *out, int rowPitch);
+
 	std::vector<ReplacedTextureLevel> levels_;
 	ReplacedTextureAlpha alphaStatus_;
+	// Only used when loading in the background.  The pixels are dropped once uploaded.
+	State state_ = State::UNLOADED;
+	bool populated_ = false;
+	std::vector<std::vector<u8>> levelData_;
 
 	friend TextureReplacer;
 };
@@ -176,6 +229,10 @@ class TextureReplacer {
 
 	void Init();
 	void NotifyConfigChanged();
+	// Mask of (1 << ReplacedTextureFormat) for compressed formats the backend can upload.
+	void SetCompressedFormats(u32 mask) {
+		compressedFormats_ = mask;
+	}
 
 	inline bool Enabled() {
 		return enabled_;
@@ -183,34 +240,72 @@ class TextureReplacer {
 
 	u32 ComputeHash(u32 addr, int bufw, int w, int h, GETextureFormat fmt, u16 maxSeenV);
 
+	// When loading in the background, this returns an invalid replacement until the files are decoded.
 	ReplacedTexture &FindReplacement(u64 cachekey, u32 hash, int w, int h);
+	// Collects replacements that finished loading since the last call, which need a rebuild to show.
+	// Call once per frame, this also learns which replacements show up together for prefetching.
+	void GetLoadedReplacements(std::vector<ReplacementCacheKey> &loaded);
 
 	void NotifyTextureDecoded(const ReplacedTextureDecodeInfo &replacedInfo, const void *data, int pitch, int level, int w, int h);
 
 	static bool GenerateIni(const std::string &gameID, std::string *generatedFilename);
+	// Converts the game's texture folder into a single pack, which is used instead when present.
+	static bool BuildPack(const std::string &gameID, std::string *error);
 
 protected:
 	bool LoadIni();
+	bool LoadPackIni();
 	bool LoadIniValues(IniFile &ini, bool isOverride = false);
 	void ParseHashRange(const std::string &key, const std::string &value);
 	bool LookupHashRange(u32 addr, int &w, int &h);
 	std::string LookupHashFile(u64 cachekey, u32 hash, int level);
+	bool LookupPackKey(u64 &cachekey, u32 &hash, int level);
 	std::string HashName(u64 cachekey, u32 hash, int level);
 	void PopulateReplacement(ReplacedTexture *result, u64 cachekey, u32 hash, int w, int h);
+	void PopulateFromPack(ReplacedTexture *result, u64 cachekey, u32 hash, int w, int h, int newW, int newH);
+	bool PopulateCompressed(ReplacedTexture *result, const std::string &filename, int w, int h);
+	bool PopulateCompressed(ReplacedTexture *result, const std::string &filename, const u8 *data, size_t avail, u64 fileSize, bool isKTX2, const std::shared_ptr<ReplacementPack> &pack, u64 packOffset);
+
+	struct LoadRequest {
+		ReplacementCacheKey key;
+		u16 w;
+		u16 h;
+	};
+	void QueueLoad(const ReplacementCacheKey &key, int w, int h);
+	void LoadLoop();
+	void StopLoading();
+	void LoadPrefetchIndex();
+	void SavePrefetchIndex();
 
 	SimpleBuf<u32> saveBuf;
 	bool enabled_ = false;
 	bool allowVideo_ = false;
 	bool ignoreAddress_ = false;
 	bool reduceHash_ = false;
+	u32 compressedFormats_ = 0;
 	std::string gameID_;
 	std::string basePath_;
 	ReplacedTextureHash hash_ = ReplacedTextureHash::QUICK;
 	typedef std::pair<int, int> WidthHeightPair;
 	std::unordered_map<u64, WidthHeightPair> hashranges_;
 	std::unordered_map<ReplacementAliasKey, std::string> aliases_;
+	// When open, this replaces both the loose files and the [hashes] section.
+	std::shared_ptr<ReplacementPack> pack_;
 
 	ReplacedTexture none_;
 	std::unordered_map<ReplacementCacheKey, ReplacedTexture> cache_;
 	std::unordered_map<ReplacementCacheKey, ReplacedTextureLevel> savedCache_;
+
+	// Background loading.  cache_ itself is only touched on the GPU thread, but queued
+	// ReplacedTextures are owned by the load thread until marked READY under loadLock_.
+	std::thread loadThread_;
+	std::mutex loadLock_;
+	std::condition_variable loadCond_;
+	std::deque<std::pair<ReplacedTexture *, LoadRequest>> loadQueue_;
+	std::vector<LoadRequest> loadDone_;
+	bool loadExit_ = false;
+
+	// Replacements that finished loading in the same frame as the key, so likely to be needed together.
+	std::unordered_map<ReplacementCacheKey, std::vector<LoadRequest>> prefetch_;
+	bool prefetchDirty_ = false;
 };
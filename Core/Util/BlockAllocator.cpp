@@ -16,6 +16,7 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <cstring>
+#include <algorithm>
 
 #include "Common/Log.h"
 #include "Common/ChunkFile.h"
@@ -23,7 +24,8 @@
 #include "Core/Util/BlockAllocator.h"
 #include "Core/Reporting.h"
 
-// Slow freaking thing but works (eventually) :)
+// Placement follows the block list (first fit from the bottom or top), but lookups go through
+// the address map and the free bins, so they don't need to walk every block.
 
 BlockAllocator::BlockAllocator(int grain) : bottom_(NULL), top_(NULL), grain_(grain)
 {
@@ -42,6 +44,7 @@ void BlockAllocator::Init(u32 rangeStart, u32 rangeSize)
 	//Initial block, covering everything
 	top_ = new Block(rangeStart_, rangeSize_, false, NULL, NULL);
 	bottom_ = top_;
+	IndexBlock(top_);
 }
 
 void BlockAllocator::Shutdown()
@@ -53,6 +56,108 @@ void BlockAllocator::Shutdown()
 		bottom_ = next;
 	}
 	top_ = NULL;
+	blocksByStart_.clear();
+	for (int i = 0; i < NUM_FREE_BINS; ++i)
+		freeBins_[i].clear();
+}
+
+static int FreeBinForSize(u32 size)
+{
+	int bin = 0;
+	while (bin < 31 && (size >> (bin + 1)) != 0)
+		++bin;
+	return bin;
+}
+
+void BlockAllocator::IndexBlock(Block *b)
+{
+	blocksByStart_[b->start] = b;
+	if (!b->taken && b->size != 0)
+		freeBins_[FreeBinForSize(b->size)][b->start] = b;
+}
+
+void BlockAllocator::UnindexBlock(Block *b)
+{
+	auto it = blocksByStart_.find(b->start);
+	if (it != blocksByStart_.end() && it->second == b)
+		blocksByStart_.erase(it);
+	if (!b->taken && b->size != 0)
+		freeBins_[FreeBinForSize(b->size)].erase(b->start);
+}
+
+void BlockAllocator::RebuildIndex()
+{
+	blocksByStart_.clear();
+	for (int i = 0; i < NUM_FREE_BINS; ++i)
+		freeBins_[i].clear();
+	for (Block *bp = bottom_; bp != NULL; bp = bp->next)
+		IndexBlock(bp);
+}
+
+void BlockAllocator::SetTaken(Block *b, bool taken, const char *tag)
+{
+	UnindexBlock(b);
+	b->taken = taken;
+	if (taken)
+		b->SetTag(tag);
+	IndexBlock(b);
+}
+
+static bool FreeBlockFits(u32 start, u32 blockSize, u32 size, u32 grain, bool fromTop)
+{
+	u32 offset;
+	if (!fromTop)
+	{
+		offset = start % grain;
+		if (offset != 0)
+			offset = grain - offset;
+	}
+	else
+	{
+		offset = (start + blockSize - size) % grain;
+	}
+	return blockSize >= offset + size;
+}
+
+// Same result as walking the list: the lowest (or highest, fromTop) free block that fits.
+BlockAllocator::Block *BlockAllocator::FindFreeBlock(u32 size, u32 grain, bool fromTop)
+{
+	// Any block at least this big fits, wherever alignment puts it.
+	const u64 alwaysFits = (u64)size + grain - 1;
+
+	Block *best = NULL;
+	for (int bin = FreeBinForSize(size); bin < NUM_FREE_BINS; ++bin)
+	{
+		const BlockMap &blocks = freeBins_[bin];
+		if (blocks.empty())
+			continue;
+
+		Block *found = NULL;
+		if (((u64)1 << bin) >= alwaysFits)
+		{
+			found = fromTop ? blocks.rbegin()->second : blocks.begin()->second;
+		}
+		else if (!fromTop)
+		{
+			for (auto it = blocks.begin(); it != blocks.end() && !found; ++it)
+			{
+				if (FreeBlockFits(it->second->start, it->second->size, size, grain, false))
+					found = it->second;
+			}
+		}
+		else
+		{
+			for (auto it = blocks.rbegin(); it != blocks.rend() && !found; ++it)
+			{
+				if (FreeBlockFits(it->second->start, it->second->size, size, grain, true))
+					found = it->second;
+			}
+		}
+
+		if (found && (!best || (fromTop ? found->start > best->start : found->start < best->start)))
+			best = found;
+	}
+	return best;
 }
 
 u32 BlockAllocator::AllocAligned(u32 &size, u32 sizeGrain, u32 grain, bool fromTop, const char *tag)
@@ -72,67 +177,34 @@ u32 BlockAllocator::AllocAligned(u32 &size, u32 sizeGrain, u32 grain, bool fromT
 	// upalign size to grain
 	size = (size + sizeGrain - 1) & ~(sizeGrain - 1);
 
-	if (!fromTop)
+	Block *bp = FindFreeBlock(size, grain, fromTop);
+	if (bp != NULL && !fromTop)
 	{
 		//Allocate from bottom of mem
-		for (Block *bp = bottom_; bp != NULL; bp = bp->next)
-		{
-			Block &b = *bp;
-			u32 offset = b.start % grain;
-			if (offset != 0)
-				offset = grain - offset;
-			u32 needed = offset + size;
-			if (b.taken == false && b.size >= needed)
-			{
-				if (b.size == needed)
-				{
-					if (offset >= grain_)
-						InsertFreeBefore(&b, offset);
-					b.taken = true;
-					b.SetTag(tag);
-					return b.start;
-				}
-				else
-				{
-					InsertFreeAfter(&b, b.size - needed);
-					if (offset >= grain_)
-						InsertFreeBefore(&b, offset);
-					b.taken = true;
-					b.SetTag(tag);
-					return b.start;
-				}
-			}
-		}
+		Block &b = *bp;
+		u32 offset = b.start % grain;
+		if (offset != 0)
+			offset = grain - offset;
+		u32 needed = offset + size;
+		if (b.size != needed)
+			InsertFreeAfter(&b, b.size - needed);
+		if (offset >= grain_)
+			InsertFreeBefore(&b, offset);
+		SetTaken(&b, true, tag);
+		return b.start;
 	}
-	else
+	else if (bp != NULL)
 	{
 		// Allocate from top of mem.
-		for (Block *bp = top_; bp != NULL; bp = bp->prev)
-		{
-			Block &b = *bp;
-			u32 offset = (b.start + b.size - size) % grain;
-			u32 needed = offset + size;
-			if (b.taken == false && b.size >= needed)
-			{
-				if (b.size == needed)
-				{
-					if (offset >= grain_)
-						InsertFreeAfter(&b, offset);
-					b.taken = true;
-					b.SetTag(tag);
-					return b.start;
-				}
-				else
-				{
-					InsertFreeBefore(&b, b.size - needed);
-					if (offset >= grain_)
-						InsertFreeAfter(&b, offset);
-					b.taken = true;
-					b.SetTag(tag);
-					return b.start;
-				}
-			}
-		}
+		Block &b = *bp;
+		u32 offset = (b.start + b.size - size) % grain;
+		u32 needed = offset + size;
+		if (b.size != needed)
+			InsertFreeBefore(&b, b.size - needed);
+		if (offset >= grain_)
+			InsertFreeAfter(&b, offset);
+		SetTaken(&b, true, tag);
+		return b.start;
 	}
 
 	//Out of memory :(
@@ -193,8 +265,7 @@ u32 BlockAllocator::AllocAt(u32 position, u32 size, const char *tag)
 			{
 				if (b.size != alignedSize)
 					InsertFreeAfter(&b, b.size - alignedSize);
-				b.taken = true;
-				b.SetTag(tag);
+				SetTaken(&b, true, tag);
 				CheckBlocks();
 				return position;
 			}
@@ -203,8 +274,7 @@ u32 BlockAllocator::AllocAt(u32 position, u32 size, const char *tag)
 				InsertFreeBefore(&b, alignedPosition - b.start);
 				if (b.size > alignedSize)
 					InsertFreeAfter(&b, b.size - alignedSize);
-				b.taken = true;
-				b.SetTag(tag);
+				SetTaken(&b, true, tag);
 
 				return position;
 			}
@@ -226,10 +296,12 @@ void BlockAllocator::MergeFreeBlocks(Block *fromBlock)
 {
 	DEBUG_LOG(SCEKERNEL, "Merging Blocks");
 
+	UnindexBlock(fromBlock);
 	Block *prev = fromBlock->prev;
 	while (prev != NULL && prev->taken == false)
 	{
 		DEBUG_LOG(SCEKERNEL, "Block Alloc found adjacent free blocks - merging");
+		UnindexBlock(prev);
 		prev->size += fromBlock->size;
 		if (fromBlock->next == NULL)
 			top_ = prev;
@@ -250,6 +322,7 @@ void BlockAllocator::MergeFreeBlocks(Block *fromBlock)
 	while (next != NULL && next->taken == false)
 	{
 		DEBUG_LOG(SCEKERNEL, "Block Alloc found adjacent free blocks - merging");
+		UnindexBlock(next);
 		fromBlock->size += next->size;
 		fromBlock->next = next->next;
 		delete next;
@@ -260,6 +333,7 @@ void BlockAllocator::MergeFreeBlocks(Block *fromBlock)
 		top_ = fromBlock;
 	else
 		next->prev = fromBlock;
+	IndexBlock(fromBlock);
 }
 
 bool BlockAllocator::Free(u32 position)
@@ -267,7 +341,7 @@ bool BlockAllocator::Free(u32 position)
 	Block *b = GetBlockFromAddress(position);
 	if (b && b->taken)
 	{
-		b->taken = false;
+		SetTaken(b, false);
 		MergeFreeBlocks(b);
 		return true;
 	}
@@ -283,7 +357,7 @@ bool BlockAllocator::FreeExact(u32 position)
 	Block *b = GetBlockFromAddress(position);
 	if (b && b->taken && b->start == position)
 	{
-		b->taken = false;
+		SetTaken(b, false);
 		MergeFreeBlocks(b);
 		return true;
 	}
@@ -296,6 +370,7 @@ bool BlockAllocator::FreeExact(u32 position)
 
 BlockAllocator::Block *BlockAllocator::InsertFreeBefore(Block *b, u32 size)
 {
+	UnindexBlock(b);
 	Block *inserted = new Block(b->start, size, false, b->prev, b);
 	b->prev = inserted;
 	if (inserted->prev == NULL)
@@ -305,11 +380,14 @@ BlockAllocator::Block *BlockAllocator::InsertFreeBefore(Block *b, u32 size)
 
 	b->start += size;
 	b->size -= size;
+	IndexBlock(inserted);
+	IndexBlock(b);
 	return inserted;
 }
 
 BlockAllocator::Block *BlockAllocator::InsertFreeAfter(Block *b, u32 size)
 {
+	UnindexBlock(b);
 	Block *inserted = new Block(b->start + b->size - size, size, false, b, b->next);
 	b->next = inserted;
 	if (inserted->next == NULL)
@@ -318,11 +396,14 @@ BlockAllocator::Block *BlockAllocator::InsertFreeAfter(Block *b, u32 size)
 		inserted->next->prev = inserted;
 
 	b->size -= size;
+	IndexBlock(b);
+	IndexBlock(inserted);
 	return inserted;
 }
 
 void BlockAllocator::CheckBlocks() const
 {
+#ifdef _DEBUG
 	for (const Block *bp = bottom_; bp != NULL; bp = bp->next)
 	{
 		const Block &b = *bp;
@@ -334,6 +415,7 @@ void BlockAllocator::CheckBlocks() const
 			ERROR_LOG_REPORT(HLE, "Bogus block in allocator");
 		}
 	}
+#endif
 }
 
 const char *BlockAllocator::GetBlockTag(u32 addr) const {
@@ -343,28 +425,22 @@ const char *BlockAllocator::GetBlockTag(u32 addr) const {
 
 inline BlockAllocator::Block *BlockAllocator::GetBlockFromAddress(u32 addr)
 {
-	for (Block *bp = bottom_; bp != NULL; bp = bp->next)
-	{
-		Block &b = *bp;
-		if (b.start <= addr && b.start + b.size > addr)
-		{
-			// Got one!
-			return bp;
-		}
-	}
-	return NULL;
+	const BlockAllocator *self = this;
+	return const_cast<Block *>(self->GetBlockFromAddress(addr));
 }
 
 const BlockAllocator::Block *BlockAllocator::GetBlockFromAddress(u32 addr) const
 {
-	for (const Block *bp = bottom_; bp != NULL; bp = bp->next)
+	// The last block starting at or before addr is the only one that could contain it.
+	auto it = blocksByStart_.upper_bound(addr);
+	if (it == blocksByStart_.begin())
+		return NULL;
+	--it;
+	const Block &b = *it->second;
+	if (b.start <= addr && b.start + b.size > addr)
 	{
-		const Block &b = *bp;
-		if (b.start <= addr && b.start + b.size > addr)
-		{
-			// Got one!
-			return bp;
-		}
+		// Got one!
+		return it->second;
 	}
 	return NULL;
 }
@@ -401,14 +477,11 @@ void BlockAllocator::ListBlocks() const
 u32 BlockAllocator::GetLargestFreeBlockSize() const
 {
 	u32 maxFreeBlock = 0;
-	for (const Block *bp = bottom_; bp != NULL; bp = bp->next)
+	// Only the largest non-empty bin matters.
+	for (int bin = NUM_FREE_BINS - 1; bin >= 0 && maxFreeBlock == 0; --bin)
 	{
-		const Block &b = *bp;
-		if (!b.taken)
-		{
-			if (b.size > maxFreeBlock)
-				maxFreeBlock = b.size;
-		}
+		for (const auto &it : freeBins_[bin])
+			maxFreeBlock = std::max(maxFreeBlock, it.second->size);
 	}
 	if (maxFreeBlock & (grain_ - 1))
 		WARN_LOG_REPORT(HLE, "GetLargestFreeBlockSize: free size %08x does not align to grain %08x.", maxFreeBlock, grain_);
@@ -418,13 +491,10 @@ u32 BlockAllocator::GetLargestFreeBlockSize() const
 u32 BlockAllocator::GetTotalFreeBytes() const
 {
 	u32 sum = 0;
-	for (const Block *bp = bottom_; bp != NULL; bp = bp->next)
+	for (int bin = 0; bin < NUM_FREE_BINS; ++bin)
 	{
-		const Block &b = *bp;
-		if (!b.taken)
-		{
-			sum += b.size;
-		}
+		for (const auto &it : freeBins_[bin])
+			sum += it.second->size;
 	}
 	if (sum & (grain_ - 1))
 		WARN_LOG_REPORT(HLE, "GetTotalFreeBytes: free size %08x does not align to grain %08x.", sum, grain_);
@@ -476,6 +546,9 @@ void BlockAllocator::DoState(PointerWrap &p)
 	p.Do(rangeStart_);
 	p.Do(rangeSize_);
 	p.Do(grain_);
+
+	if (p.mode == p.MODE_READ)
+		RebuildIndex();
 }
 
 BlockAllocator::Block::Block(u32 _start, u32 _size, bool _taken, Block *_prev, Block *_next)
@@ -19,6 +19,8 @@
 
 class PointerWrap;
 
+#include <map>
+
 #include "Common/CommonTypes.h"
 
 class BlockAllocator
@@ -72,6 +74,10 @@ class BlockAllocator
 		Block *next;
 	};
 
+	// Free blocks are binned by floor(log2(size)), each bin ordered by address.
+	static const int NUM_FREE_BINS = 32;
+	typedef std::map<u32, Block *> BlockMap;
+
 	Block *bottom_;
 	Block *top_;
 	u32 rangeStart_;
@@ -79,6 +85,15 @@ class BlockAllocator
 
 	u32 grain_;
 
+	// All blocks by start address, for quick lookups.  The list above still defines the order.
+	BlockMap blocksByStart_;
+	BlockMap freeBins_[NUM_FREE_BINS];
+
+	void IndexBlock(Block *b);
+	void UnindexBlock(Block *b);
+	void RebuildIndex();
+	void SetTaken(Block *b, bool taken, const char *tag = 0);
+	Block *FindFreeBlock(u32 size, u32 grain, bool fromTop);
 	void MergeFreeBlocks(Block *fromBlock);
 	Block *GetBlockFromAddress(u32 addr);
 	const Block *GetBlockFromAddress(u32 addr) const;
@@ -28,11 +28,13 @@
 #else
 #include "ext/libzip/zip.h"
 #endif
+#include "data/compression.h"
 #include "util/text/utf8.h"
 
 #include "Common/Log.h"
 #include "Common/FileUtil.h"
 #include "Common/StringUtils.h"
+#include "Common/Swap.h"
 #include "Core/Config.h"
 #include "Core/Loaders.h"
 #include "Core/ELF/ParamSFO.h"
@@ -204,7 +206,7 @@ ZipFileContents DetectZipFileContents(struct zip *z, ZipFileInfo *info) {
 			} else {
 				INFO_LOG(HLE, "Wrong number of slashes (%i) in '%s'", slashCount, fn);
 			}
-		} else if (endsWith(zippedName, ".iso") || endsWith(zippedName, ".cso")) {
+		} else if (endsWith(zippedName, ".iso") || endsWith(zippedName, ".cso") || endsWith(zippedName, ".zso")) {
 			int slashCount = 0;
 			int slashLocation = -1;
 			countSlashes(zippedName, &slashLocation, &slashCount);
@@ -255,8 +257,8 @@ bool GameManager::InstallGame(const std::string &url, const std::string &fileNam
 	}
 
 	// Examine the URL to guess out what we're installing.
-	if (endsWithNoCase(url, ".cso") || endsWithNoCase(url, ".iso")) {
-		// It's a raw ISO or CSO file. We just copy it to the destination.
+	if (endsWithNoCase(url, ".cso") || endsWithNoCase(url, ".zso") || endsWithNoCase(url, ".iso")) {
+		// It's a raw ISO, CSO or ZSO file. We just copy it to the destination.
 		std::string shortFilename = GetFilenameFromPath(url);
 		return InstallRawISO(fileName, shortFilename, deleteAfter);
 	}
@@ -637,6 +639,114 @@ bool GameManager::InstallRawISO(const std::string &file, const std::string &orig
 	return true;
 }
 
+bool GameManager::CompressISOOnThread(std::string isoFile, std::string zsoFile) {
+	if (installInProgress_) {
+		return false;
+	}
+	// Set here already, so the caller doesn't see it as done before the thread starts.
+	installInProgress_ = true;
+	installProgress_ = 0.0f;
+	installError_ = "";
+	installThread_.reset(new std::thread(std::bind(&GameManager::CompressISO, this, isoFile, zsoFile)));
+	return true;
+}
+
+bool GameManager::CompressISO(const std::string &isoFile, const std::string &zsoFile) {
+	I18NCategory *ga = GetI18NCategory("Game");
+
+	FileLoader *loader = ConstructFileLoader(isoFile);
+	BlockDevice *bd = constructBlockDevice(loader);
+	FILE *out = bd ? File::OpenCFile(zsoFile, "wb") : nullptr;
+	if (!out) {
+		ERROR_LOG(HLE, "Unable to compress '%s' to '%s'", isoFile.c_str(), zsoFile.c_str());
+		delete bd;
+		delete loader;
+		SetInstallError(ga->T("Compression failed"));
+		return false;
+	}
+
+	// Same header layout as CSO.  2048 byte frames compress a bit worse, but never need a partial read.
+	const u32 frameSize = 2048;
+	const u32 numFrames = bd->GetNumBlocks();
+	const u64 totalBytes = (u64)numFrames * frameSize;
+	const u32 headerSize = 0x18;
+	const u64 dataStart = headerSize + (u64)(numFrames + 1) * sizeof(u32_le);
+	// Index positions only have 31 bits, so very large images need aligned frames.
+	u8 align = 0;
+	while (((dataStart + totalBytes) >> align) > 0x7FFFFFFF)
+		++align;
+
+	u8 header[headerSize]{};
+	memcpy(header, "ZISO", 4);
+	*(u32_le *)&header[0x04] = headerSize;
+	*(u64_le *)&header[0x08] = totalBytes;
+	*(u32_le *)&header[0x10] = frameSize;
+	header[0x14] = 1;
+	header[0x15] = align;
+
+	std::vector<u32_le> index(numFrames + 1);
+	bool success = fwrite(header, sizeof(header), 1, out) == 1;
+	success = success && fwrite(&index[0], sizeof(u32_le), index.size(), out) == index.size();
+
+	u8 frame[frameSize];
+	u8 compressed[frameSize];
+	const u8 padding[16]{};
+	u64 pos = dataStart;
+	for (u32 i = 0; i < numFrames && success; ++i) {
+		if ((pos & ((1 << align) - 1)) != 0) {
+			size_t padSize = (size_t)((1 << align) - (pos & ((1 << align) - 1)));
+			success = fwrite(padding, 1, padSize, out) == padSize;
+			pos += padSize;
+		}
+
+		if (!bd->ReadBlock(i, frame, true)) {
+			ERROR_LOG(HLE, "Failed to read block %d of '%s'", i, isoFile.c_str());
+			success = false;
+			break;
+		}
+
+		// Anything that doesn't get smaller is stored as is, which is also faster to read.
+		int compressedSize = lz4_compress_block(frame, frameSize, compressed, frameSize - 1);
+		if (compressedSize > 0) {
+			index[i] = (u32)(pos >> align);
+			success = success && fwrite(compressed, 1, compressedSize, out) == (size_t)compressedSize;
+			pos += compressedSize;
+		} else {
+			index[i] = (u32)(pos >> align) | 0x80000000;
+			success = success && fwrite(frame, 1, frameSize, out) == frameSize;
+			pos += frameSize;
+		}
+
+		if ((i & 1023) == 0)
+			installProgress_ = (float)i / (float)numFrames;
+	}
+	index[numFrames] = (u32)((pos + (1 << align) - 1) >> align);
+	if (success && (pos & ((1 << align) - 1)) != 0) {
+		size_t padSize = (size_t)((1 << align) - (pos & ((1 << align) - 1)));
+		success = fwrite(padding, 1, padSize, out) == padSize;
+	}
+
+	success = success && fseek(out, headerSize, SEEK_SET) == 0;
+	success = success && fwrite(&index[0], sizeof(u32_le), index.size(), out) == index.size();
+	success = fclose(out) == 0 && success;
+	delete bd;
+	delete loader;
+
+	if (!success) {
+		ERROR_LOG(HLE, "Failed to write '%s'", zsoFile.c_str());
+		File::Delete(zsoFile);
+		SetInstallError(ga->T("Compression failed"));
+		return false;
+	}
+
+	INFO_LOG(HLE, "Compressed '%s' to '%s'", isoFile.c_str(), zsoFile.c_str());
+	installProgress_ = 1.0f;
+	installInProgress_ = false;
+	installError_ = "";
+	InstallDone();
+	return true;
+}
+
 void GameManager::InstallDone() {
 	installDonePending_ = true;
 }
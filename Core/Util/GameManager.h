@@ -69,12 +69,16 @@ class GameManager {
 
 	// Only returns false if there's already an installation in progress.
 	bool InstallGameOnThread(std::string url, std::string tempFileName, bool deleteAfter);
+	// Converts an ISO or CSO to an LZ4 compressed ZSO, which is much faster to decompress.
+	// Progress and errors are reported like an install.
+	bool CompressISOOnThread(std::string isoFile, std::string zsoFile);
 
 private:
 	bool InstallGame(const std::string &url, const std::string &tempFileName, bool deleteAfter);
 	bool InstallMemstickGame(struct zip *z, const std::string &zipFile, const std::string &pspGame, const ZipFileInfo &info, bool allowRoot, bool deleteAfter);
 	bool InstallZippedISO(struct zip *z, int isoFileIndex, std::string zipfile, bool deleteAfter);
 	bool InstallRawISO(const std::string &zipFile, const std::string &originalName, bool deleteAfter);
+	bool CompressISO(const std::string &isoFile, const std::string &zsoFile);
 	void InstallDone();
 	bool ExtractFile(struct zip *z, int file_index, std::string outFilename, size_t *bytesCopied, size_t allBytes);
 	bool DetectTexturePackDest(struct zip *z, int iniIndex, std::string *dest);
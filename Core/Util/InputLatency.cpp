@@ -0,0 +1,143 @@
+// Copyright (c) 2020- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "base/timeutil.h"
+#include "Core/Util/InputLatency.h"
+
+struct InFlightInput {
+	double inputTime;
+	double sampleTime;
+	// Host frame it was sampled during, or -1 if that frame hasn't ended yet.
+	int64_t frameSerial;
+};
+
+struct InputLatencyResult {
+	double toSample;
+	double toPresent;
+};
+
+// If nothing presents (e.g. D3D, headless), don't let these pile up.
+static const size_t MAX_IN_FLIGHT = 32;
+static const size_t MAX_RESULTS = 512;
+
+static std::mutex latencyLock;
+static std::atomic<bool> inputPending{ false };
+static double pendingInputTime = 0.0;
+static std::deque<InFlightInput> inFlight;
+static std::vector<InputLatencyResult> results;
+static size_t nextResult = 0;
+
+void InputLatency_Input() {
+	if (inputPending)
+		return;
+
+	std::lock_guard<std::mutex> guard(latencyLock);
+	if (!inputPending) {
+		pendingInputTime = real_time_now();
+		inputPending = true;
+	}
+}
+
+void InputLatency_Sample() {
+	// Happens every vblank, so keep it quick when there's nothing to do.
+	if (!inputPending)
+		return;
+
+	std::lock_guard<std::mutex> guard(latencyLock);
+	if (inFlight.size() >= MAX_IN_FLIGHT)
+		inFlight.pop_front();
+	inFlight.push_back(InFlightInput{ pendingInputTime, real_time_now(), -1 });
+	inputPending = false;
+}
+
+void InputLatency_EndFrame(uint64_t frameSerial) {
+	std::lock_guard<std::mutex> guard(latencyLock);
+	for (auto &input : inFlight) {
+		if (input.frameSerial < 0)
+			input.frameSerial = (int64_t)frameSerial;
+	}
+}
+
+void InputLatency_Present(uint64_t frameSerial, bool presented) {
+	// A skipped swap shows up in the next present, which has a later serial.
+	if (!presented)
+		return;
+
+	double now = real_time_now();
+	std::lock_guard<std::mutex> guard(latencyLock);
+	while (!inFlight.empty() && inFlight.front().frameSerial >= 0 && (uint64_t)inFlight.front().frameSerial <= frameSerial) {
+		const InFlightInput &input = inFlight.front();
+		InputLatencyResult result{ input.sampleTime - input.inputTime, now - input.inputTime };
+		if (results.size() < MAX_RESULTS) {
+			results.push_back(result);
+		} else {
+			results[nextResult] = result;
+		}
+		nextResult = (nextResult + 1) % MAX_RESULTS;
+		inFlight.pop_front();
+	}
+}
+
+static InputLatencyDistribution ComputeDistribution(std::vector<double> &values) {
+	InputLatencyDistribution dist{};
+	if (values.empty())
+		return dist;
+
+	std::sort(values.begin(), values.end());
+	double sum = 0.0;
+	for (double v : values)
+		sum += v;
+	dist.minMs = values.front() * 1000.0;
+	dist.avgMs = sum / values.size() * 1000.0;
+	dist.p50Ms = values[values.size() / 2] * 1000.0;
+	dist.p95Ms = values[std::min(values.size() - 1, values.size() * 95 / 100)] * 1000.0;
+	dist.maxMs = values.back() * 1000.0;
+	return dist;
+}
+
+InputLatencyStats InputLatency_GetStats() {
+	std::vector<double> toSample;
+	std::vector<double> toPresent;
+	{
+		std::lock_guard<std::mutex> guard(latencyLock);
+		toSample.reserve(results.size());
+		toPresent.reserve(results.size());
+		for (const auto &result : results) {
+			toSample.push_back(result.toSample);
+			toPresent.push_back(result.toPresent);
+		}
+	}
+
+	InputLatencyStats stats;
+	stats.count = (int)toSample.size();
+	stats.toSample = ComputeDistribution(toSample);
+	stats.toPresent = ComputeDistribution(toPresent);
+	return stats;
+}
+
+void InputLatency_Reset() {
+	std::lock_guard<std::mutex> guard(latencyLock);
+	inputPending = false;
+	inFlight.clear();
+	results.clear();
+	nextResult = 0;
+}
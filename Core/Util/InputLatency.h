@@ -0,0 +1,52 @@
+// Copyright (c) 2020- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+#pragma once
+
+#include <cstdint>
+
+// Measures input to photon latency, as far as we can see it:
+//  - input: the host changed what sceCtrl would report to the game.
+//  - sample: sceCtrl sampled it into its buffers, during some emulated frame.
+//  - present: the host frame that emulated frame was drawn in was presented (GL swap or Vulkan present.)
+// Only the oldest input not yet sampled is tracked, so holding a stick doesn't flood it.
+
+// Any thread.
+void InputLatency_Input();
+// Emu thread, whenever sceCtrl samples.
+void InputLatency_Sample();
+// Emu thread, right before ending the host frame the emulator rendered into.
+void InputLatency_EndFrame(uint64_t frameSerial);
+// Called by the draw context, maybe on the render thread.  See DrawContext::SetPresentCallback().
+void InputLatency_Present(uint64_t frameSerial, bool presented);
+
+struct InputLatencyDistribution {
+	double minMs;
+	double avgMs;
+	double p50Ms;
+	double p95Ms;
+	double maxMs;
+};
+
+struct InputLatencyStats {
+	// Over the most recent inputs, up to a few hundred.
+	int count;
+	InputLatencyDistribution toSample;
+	InputLatencyDistribution toPresent;
+};
+
+InputLatencyStats InputLatency_GetStats();
+void InputLatency_Reset();
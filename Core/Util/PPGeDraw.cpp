@@ -73,6 +73,14 @@ static u32 paletteSize = sizeof(u16) * 16;
 static u32 vertexStart;
 static u32 vertexCount;
 
+// The last PRIM written, so a following draw with the same state can extend it instead.
+static u32 lastPrimPtr;
+static u32 lastPrimVertexEnd;
+static u32 lastPrimCount;
+static int lastPrimType;
+// The last PRIM was drawn by PPGeDrawRect with texturing off.
+static bool lastPrimUntextured;
+
 // Used for formating text
 struct AtlasCharVertex
 {
@@ -145,7 +153,21 @@ static void Vertex(float x, float y, float u, float v, int tw, int th, u32 color
 }
 
 static void EndVertexDataAndDraw(int prim) {
+	// Nothing written since the last draw and the vertices follow straight on, so just grow it.
+	// Text and dialogs are made of lots of small rectangles, this keeps the GE from seeing each one.
+	if (lastPrimPtr != 0 && lastPrimPtr + 4 == dlWritePtr && prim == lastPrimType && vertexStart == lastPrimVertexEnd && lastPrimCount + vertexCount <= 0xFFFF) {
+		lastPrimCount += vertexCount;
+		lastPrimVertexEnd = dataWritePtr;
+		Memory::Write_U32((GE_CMD_PRIM << 24) | (prim << 16) | lastPrimCount, lastPrimPtr);
+		return;
+	}
+
 	WriteCmdAddrWithBase(GE_CMD_VADDR, vertexStart);
+	lastPrimPtr = dlWritePtr;
+	lastPrimVertexEnd = dataWritePtr;
+	lastPrimCount = vertexCount;
+	lastPrimType = prim;
+	lastPrimUntextured = false;
 	WriteCmd(GE_CMD_PRIM, (prim << 16) | vertexCount);
 }
 
@@ -255,6 +277,7 @@ void __PPGeDoState(PointerWrap &p)
 
 	p.Do(vertexStart);
 	p.Do(vertexCount);
+	lastPrimPtr = 0;
 
 	p.Do(char_lines);
 	p.Do(char_lines_metrics);
@@ -290,6 +313,7 @@ void PPGeBegin()
 	// Reset write pointers to start of command and data buffers.
 	dlWritePtr = dlPtr;
 	dataWritePtr = dataPtr;
+	lastPrimPtr = 0;
 
 	// Set up the correct states for UI drawing
 	WriteCmd(GE_CMD_OFFSETADDR, 0);
@@ -776,12 +800,18 @@ void PPGeDrawRect(float x1, float y1, float x2, float y2, u32 color)
 	if (!dlPtr)
 		return;
 
-	WriteCmd(GE_CMD_TEXTUREMAPENABLE, 0);
+	// Right after another rect, texturing was only turned back on for us to turn it off again.
+	if (lastPrimUntextured && lastPrimPtr + 8 == dlWritePtr && Memory::Read_U32(lastPrimPtr + 4) == (GE_CMD_TEXTUREMAPENABLE << 24 | 1)) {
+		dlWritePtr -= 4;
+	} else {
+		WriteCmd(GE_CMD_TEXTUREMAPENABLE, 0);
+	}
 
 	BeginVertexData();
 	Vertex(x1, y1, 0, 0, 0, 0, color);
 	Vertex(x2, y2, 0, 0, 0, 0, color);
 	EndVertexDataAndDraw(GE_PRIM_RECTANGLES);
+	lastPrimUntextured = true;
 
 	WriteCmd(GE_CMD_TEXTUREMAPENABLE, 1);
 }
@@ -0,0 +1,67 @@
+// Copyright (c) 2020- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+#include <cstdio>
+
+#include "base/timeutil.h"
+#include "Common/Log.h"
+#include "Core/Util/StartupTrace.h"
+
+StartupTimeline g_menuStartup("menu");
+StartupTimeline g_gameStartup("game");
+
+void StartupTimeline::Begin() {
+	std::lock_guard<std::mutex> guard(lock_);
+	steps_.clear();
+	start_ = real_time_now();
+	last_ = start_;
+	active_ = true;
+}
+
+void StartupTimeline::Mark(const char *step) {
+	std::lock_guard<std::mutex> guard(lock_);
+	if (!active_)
+		return;
+	double now = real_time_now();
+	steps_.push_back(Step{ step, now - last_, false });
+	last_ = now;
+}
+
+void StartupTimeline::MarkTask(const char *step, double startTime) {
+	std::lock_guard<std::mutex> guard(lock_);
+	if (!active_)
+		return;
+	steps_.push_back(Step{ step, real_time_now() - startTime, true });
+}
+
+void StartupTimeline::End(const char *step) {
+	std::lock_guard<std::mutex> guard(lock_);
+	if (!active_)
+		return;
+	double now = real_time_now();
+	if (step)
+		steps_.push_back(Step{ step, now - last_, false });
+	active_ = false;
+
+	std::string line;
+	for (const Step &s : steps_) {
+		char temp[128];
+		// Parallel steps are bracketed, since they don't add up with the rest.
+		snprintf(temp, sizeof(temp), s.parallel ? " [%s %0.1f]" : " %s %0.1f", s.name.c_str(), s.seconds * 1000.0);
+		line += temp;
+	}
+	INFO_LOG(SYSTEM, "Startup to %s took %0.1f ms:%s", name_, (now - start_) * 1000.0, line.c_str());
+}
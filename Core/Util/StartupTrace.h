@@ -0,0 +1,58 @@
+// Copyright (c) 2020- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Records how long each step of a startup sequence took, and logs them all as one line at the end.
+// Used to see where the time goes on the way to the menu and into a game.
+// Steps may be marked from any thread, for steps that run in parallel.
+class StartupTimeline {
+public:
+	explicit StartupTimeline(const char *name) : name_(name) {}
+
+	// Starts over, dropping anything marked so far.
+	void Begin();
+	// Notes that a step is done, timed from the previous mark (or Begin.)
+	void Mark(const char *step);
+	// Like Mark, but for steps that ran alongside others, so are timed on their own.
+	void MarkTask(const char *step, double startTime);
+	// Logs the timeline, if it was begun.  Later calls do nothing until the next Begin.
+	void End(const char *step = nullptr);
+
+	bool Active() const { return active_; }
+
+private:
+	struct Step {
+		std::string name;
+		double seconds;
+		bool parallel;
+	};
+
+	const char *name_;
+	std::mutex lock_;
+	std::atomic<bool> active_{ false };
+	double start_ = 0.0;
+	double last_ = 0.0;
+	std::vector<Step> steps_;
+};
+
+extern StartupTimeline g_menuStartup;
+extern StartupTimeline g_gameStartup;
@@ -42,6 +42,9 @@ enum class ServerStatus {
 static const char *REPORT_HOSTNAME = "report.ppsspp.org";
 static const int REPORT_PORT = 80;
 
+// Enough for plenty of devices streaming at once, plus debugger connections, which stay open.
+static const int MAX_REQUEST_THREADS = 16;
+
 static std::thread serverThread;
 static ServerStatus serverStatus;
 static std::mutex serverStatusLock;
@@ -98,7 +101,7 @@ static void RegisterServer(int port) {
 
 bool RemoteISOFileSupported(const std::string &filename) {
 	// Disc-like files.
-	if (endsWithNoCase(filename, ".cso") || endsWithNoCase(filename, ".iso")) {
+	if (endsWithNoCase(filename, ".cso") || endsWithNoCase(filename, ".zso") || endsWithNoCase(filename, ".iso")) {
 		return true;
 	}
 	// May work - but won't have supporting files.
@@ -180,7 +183,13 @@ static void DiscHandler(const http::Request &request, const std::string &filenam
 		sprintf(contentRange, "Content-Range: bytes %lld-%lld/%lld\r\n", begin, last, sz);
 		request.WriteHttpResponseHeader("1.0", 206, len, "application/octet-stream", contentRange);
 
-		const size_t CHUNK_SIZE = 16 * 1024;
+		// Where possible, the kernel sends it right out of the page cache.
+		if (request.SendFileRange(fp, begin, len) >= 0) {
+			fclose(fp);
+			return;
+		}
+
+		const size_t CHUNK_SIZE = 64 * 1024;
 		char *buf = new char[CHUNK_SIZE];
 		for (s64 pos = 0; pos < len; pos += CHUNK_SIZE) {
 			s64 chunklen = std::min(len - pos, (s64)CHUNK_SIZE);
@@ -239,7 +248,8 @@ static void ForwardDebuggerRequest(const http::Request &request) {
 static void ExecuteWebServer() {
 	setCurrentThreadName("HTTPServer");
 
-	auto http = new http::Server(new threading::NewThreadExecutor());
+	threading::BoundedThreadExecutor *executor = new threading::BoundedThreadExecutor(MAX_REQUEST_THREADS, "HTTPRequest");
+	auto http = new http::Server(executor);
 	http->RegisterHandler("/", &HandleListing);
 	// This lists all the (current) recent ISOs.
 	http->SetFallbackHandler(&HandleFallback);
@@ -248,6 +258,8 @@ static void ExecuteWebServer() {
 	if (!http->Listen(g_Config.iRemoteISOPort)) {
 		if (!http->Listen(0)) {
 			ERROR_LOG(FILESYS, "Unable to listen on any port");
+			delete http;
+			delete executor;
 			UpdateStatus(ServerStatus::STOPPED);
 			return;
 		}
@@ -269,6 +281,8 @@ static void ExecuteWebServer() {
 
 	http->Stop();
 	StopAllDebuggers();
+	// Waits for any requests still being served.
+	delete executor;
 	delete http;
 
 	UpdateStatus(ServerStatus::STOPPED);
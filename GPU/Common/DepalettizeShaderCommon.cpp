@@ -31,7 +31,7 @@
 // TODO: Add a compute shader path. Complete waste of time to set up a graphics state.
 
 // Uses integer instructions available since OpenGL 3.0. Suitable for ES 3.0 as well.
-void GenerateDepalShader300(char *buffer, GEBufferFormat pixelFormat, ShaderLanguage language) {
+void GenerateDepalShader300(char *buffer, uint32_t clutMode, GEBufferFormat pixelFormat, ShaderLanguage language) {
 	char *p = buffer;
 	if (language == HLSL_D3D11) {
 		WRITE(p, "SamplerState texSamp : register(s0);\n");
@@ -68,10 +68,11 @@ void GenerateDepalShader300(char *buffer, GEBufferFormat pixelFormat, ShaderLang
 		WRITE(p, "  vec4 color = texture(tex, v_texcoord0);\n");
 	}
 
-	int mask = gstate.getClutIndexMask();
-	int shift = gstate.getClutIndexShift();
-	int offset = gstate.getClutIndexStartPos();
-	GEPaletteFormat clutFormat = gstate.getClutPaletteFormat();
+	// Same layout as gstate.clutformat, see getClutIndexMask() etc.
+	int mask = (clutMode >> 8) & 0xFF;
+	int shift = (clutMode >> 2) & 0x1F;
+	int offset = ((clutMode >> 16) & 0x1F) << 4;
+	GEPaletteFormat clutFormat = (GEPaletteFormat)(clutMode & 3);
 	// Unfortunately sampling turned our texture into floating point. To avoid this, might be able
 	// to declare them as isampler2D objects, but these require integer textures, which needs more work.
 	// Anyhow, we simply work around this by converting back to integer. Hopefully there will be no loss of precision.
@@ -133,7 +134,7 @@ void GenerateDepalShader300(char *buffer, GEBufferFormat pixelFormat, ShaderLang
 }
 
 // FP only, to suit GL(ES) 2.0
-void GenerateDepalShaderFloat(char *buffer, GEBufferFormat pixelFormat, ShaderLanguage lang) {
+void GenerateDepalShaderFloat(char *buffer, uint32_t clutMode, GEBufferFormat pixelFormat, ShaderLanguage lang) {
 	char *p = buffer;
 
 	const char *modFunc = lang == HLSL_DX9 ? "fmod" : "mod";
@@ -141,11 +142,11 @@ void GenerateDepalShaderFloat(char *buffer, GEBufferFormat pixelFormat, ShaderLa
 	char lookupMethod[128] = "index.r";
 	char offset[128] = "";
 
-	const GEPaletteFormat clutFormat = gstate.getClutPaletteFormat();
-	const u32 clutBase = gstate.getClutIndexStartPos();
+	const GEPaletteFormat clutFormat = (GEPaletteFormat)(clutMode & 3);
+	const u32 clutBase = ((clutMode >> 16) & 0x1F) << 4;
 
-	const int shift = gstate.getClutIndexShift();
-	const int mask = gstate.getClutIndexMask();
+	const int shift = (clutMode >> 2) & 0x1F;
+	const int mask = (clutMode >> 8) & 0xFF;
 
 	float index_multiplier = 1.0f;
 	// pixelformat is the format of the texture we are sampling.
@@ -277,18 +278,18 @@ void GenerateDepalShaderFloat(char *buffer, GEBufferFormat pixelFormat, ShaderLa
 	}
 }
 
-void GenerateDepalShader(char *buffer, GEBufferFormat pixelFormat, ShaderLanguage language) {
+void GenerateDepalShader(char *buffer, uint32_t clutMode, GEBufferFormat pixelFormat, ShaderLanguage language) {
 	switch (language) {
 	case GLSL_140:
-		GenerateDepalShaderFloat(buffer, pixelFormat, language);
+		GenerateDepalShaderFloat(buffer, clutMode, pixelFormat, language);
 		break;
 	case GLSL_300:
 	case GLSL_VULKAN:
 	case HLSL_D3D11:
-		GenerateDepalShader300(buffer, pixelFormat, language);
+		GenerateDepalShader300(buffer, clutMode, pixelFormat, language);
 		break;
 	case HLSL_DX9:
-		GenerateDepalShaderFloat(buffer, pixelFormat, language);
+		GenerateDepalShaderFloat(buffer, clutMode, pixelFormat, language);
 		break;
 	case HLSL_D3D11_LEVEL9:
 	default:
@@ -300,6 +301,17 @@ uint32_t DepalShaderCacheCommon::GenerateShaderID(uint32_t clutMode, GEBufferFor
 	return (clutMode & 0xFFFFFF) | (pixelFormat << 24);
 }
 
+void DepalShaderCacheCommon::GetCommonVariants(std::vector<std::pair<uint32_t, GEBufferFormat>> &variants) {
+	// The plain mode: no shift, full mask, no offset.  Nearly every game that depalettizes uses this.
+	static const GEBufferFormat pixelFormats[] = { GE_FORMAT_565, GE_FORMAT_5551, GE_FORMAT_4444, GE_FORMAT_8888 };
+	static const GEPaletteFormat clutFormats[] = { GE_CMODE_16BIT_BGR5650, GE_CMODE_16BIT_ABGR5551, GE_CMODE_16BIT_ABGR4444, GE_CMODE_32BIT_ABGR8888 };
+	for (GEBufferFormat pixelFormat : pixelFormats) {
+		for (GEPaletteFormat clutFormat : clutFormats) {
+			variants.push_back(std::make_pair((uint32_t)clutFormat | (0xFF << 8), pixelFormat));
+		}
+	}
+}
+
 uint32_t DepalShaderCacheCommon::GetClutID(GEPaletteFormat clutFormat, uint32_t clutHash) const {
 	// Simplistic.
 	return clutHash ^ (uint32_t)clutFormat;
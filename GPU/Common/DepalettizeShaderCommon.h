@@ -18,18 +18,23 @@
 #pragma once
 
 #include <cstdint>
+#include <utility>
+#include <vector>
 #include "GPU/ge_constants.h"
 #include "GPU/Common/ShaderCommon.h"
 
 static const int DEPAL_TEXTURE_OLD_AGE = 120;
 
-void GenerateDepalShader(char *buffer, GEBufferFormat pixelFormat, ShaderLanguage language);
+void GenerateDepalShader(char *buffer, uint32_t clutMode, GEBufferFormat pixelFormat, ShaderLanguage language);
 
 class DepalShaderCacheCommon {
 public:
 	virtual ~DepalShaderCacheCommon() {}
 
 protected:
+	// The clutMode / pixel format pairs worth compiling before they're first needed.
+	static void GetCommonVariants(std::vector<std::pair<uint32_t, GEBufferFormat>> &variants);
+
 	uint32_t GenerateShaderID(uint32_t clutMode, GEBufferFormat pixelFormat) const;
 	uint32_t GetClutID(GEPaletteFormat clutFormat, uint32_t clutHash) const;
 };
\ No newline at end of file
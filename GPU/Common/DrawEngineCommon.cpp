@@ -19,7 +19,9 @@
 
 #include "profiler/profiler.h"
 #include "Common/ColorConv.h"
+#include "Common/FileUtil.h"
 #include "Core/Config.h"
+#include "Core/MemMap.h"
 #include "GPU/Common/DrawEngineCommon.h"
 #include "GPU/Common/SplineCommon.h"
 #include "GPU/Common/VertexDecoderCommon.h"
@@ -37,11 +39,14 @@ DrawEngineCommon::DrawEngineCommon() : decoderMap_(16) {
 	decJitCache_ = new VertexDecoderJitCache();
 	transformed = (TransformedVertex *)AllocateMemoryPages(TRANSFORMED_VERTEX_BUFFER_SIZE, MEM_PROT_READ | MEM_PROT_WRITE);
 	transformedExpanded = (TransformedVertex *)AllocateMemoryPages(3 * TRANSFORMED_VERTEX_BUFFER_SIZE, MEM_PROT_READ | MEM_PROT_WRITE);
+	frameArenaBuf_ = (u8 *)AllocateMemoryPages(FRAME_ARENA_SIZE, MEM_PROT_READ | MEM_PROT_WRITE);
+	frameArena_.Init(frameArenaBuf_, FRAME_ARENA_SIZE);
 }
 
 DrawEngineCommon::~DrawEngineCommon() {
 	FreeMemoryPages(transformed, TRANSFORMED_VERTEX_BUFFER_SIZE);
 	FreeMemoryPages(transformedExpanded, 3 * TRANSFORMED_VERTEX_BUFFER_SIZE);
+	FreeMemoryPages(frameArenaBuf_, FRAME_ARENA_SIZE);
 	delete decJitCache_;
 	decoderMap_.Iterate([&](const uint32_t vtype, VertexDecoder *decoder) {
 		delete decoder;
@@ -49,6 +54,10 @@ DrawEngineCommon::~DrawEngineCommon() {
 	ClearSplineBezierWeights();
 }
 
+void DrawEngineCommon::ResetFrameArena() {
+	gpuStats.frameArenaHighWater = (int)frameArena_.Reset();
+}
+
 VertexDecoder *DrawEngineCommon::GetVertexDecoder(u32 vtype) {
 	VertexDecoder *dec = decoderMap_.Get(vtype);
 	if (dec)
@@ -59,6 +68,59 @@ VertexDecoder *DrawEngineCommon::GetVertexDecoder(u32 vtype) {
 	return dec;
 }
 
+// Like the shader caches, we just store the IDs of the vertex types seen during gameplay,
+// and compile decoders for them all at startup instead of on first use.
+#define VERTEX_CACHE_HEADER_MAGIC 0x43545856
+#define VERTEX_CACHE_VERSION 1
+struct VertexDecoderCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t count;
+};
+
+bool DrawEngineCommon::LoadVertexDecoderCache(const std::string &filename) {
+	FILE *f = File::OpenCFile(filename, "rb");
+	if (!f)
+		return false;
+
+	VertexDecoderCacheHeader header{};
+	bool success = fread(&header, sizeof(header), 1, f) == 1;
+	if (!success || header.magic != VERTEX_CACHE_HEADER_MAGIC || header.version != VERTEX_CACHE_VERSION || header.count > 65536) {
+		fclose(f);
+		return false;
+	}
+	std::vector<u32> vtypes(header.count);
+	success = header.count == 0 || fread(&vtypes[0], sizeof(u32), header.count, f) == header.count;
+	fclose(f);
+	if (!success)
+		return false;
+
+	for (u32 vtype : vtypes) {
+		GetVertexDecoder(vtype);
+	}
+	INFO_LOG(G3D, "Precompiled %d vertex decoders", (int)header.count);
+	return true;
+}
+
+void DrawEngineCommon::SaveVertexDecoderCache(const std::string &filename) {
+	std::vector<u32> vtypes;
+	vtypes.reserve(decoderMap_.size());
+	decoderMap_.Iterate([&](const uint32_t vtype, VertexDecoder *decoder) {
+		vtypes.push_back(vtype);
+	});
+	if (vtypes.empty())
+		return;
+
+	FILE *f = File::OpenCFile(filename, "wb");
+	if (!f)
+		return;
+	VertexDecoderCacheHeader header{ VERTEX_CACHE_HEADER_MAGIC, VERTEX_CACHE_VERSION, (uint32_t)vtypes.size() };
+	fwrite(&header, sizeof(header), 1, f);
+	fwrite(&vtypes[0], sizeof(u32), vtypes.size(), f);
+	fclose(f);
+	INFO_LOG(G3D, "Saved %d vertex decoder IDs", (int)vtypes.size());
+}
+
 int DrawEngineCommon::ComputeNumVertsToDecode() const {
 	int vertsToDecode = 0;
 	if (drawCalls[0].indexType == GE_VTYPE_IDX_NONE >> GE_VTYPE_IDX_SHIFT) {
@@ -166,11 +228,18 @@ void DrawEngineCommon::Resized() {
 	decJitCache_->Clear();
 	lastVType_ = -1;
 	dec_ = nullptr;
+	std::vector<u32> vtypes;
 	decoderMap_.Iterate([&](const uint32_t vtype, VertexDecoder *decoder) {
+		vtypes.push_back(vtype);
 		delete decoder;
 	});
 	decoderMap_.Clear();
 	ClearTrackedVertexArrays();
+
+	// The options may have changed, so recompile them all now, rather than hitching later as they're used.
+	for (u32 vtype : vtypes) {
+		GetVertexDecoder(vtype);
+	}
 }
 
 u32 DrawEngineCommon::NormalizeVertices(u8 *outPtr, u8 *bufPtr, const u8 *inPtr, int lowerBound, int upperBound, u32 vertType, int *vertexSize) {
@@ -504,6 +573,16 @@ bool DrawEngineCommon::ApplyShaderBlending() {
 	return true;
 }
 
+void DrawEngineCommon::DecodeVertRange(u8 *dest, const void *verts, int indexLowerBound, int indexUpperBound) {
+	// Below this, waking up the workers costs more than it saves.
+	const int PARALLEL_DECODE_MIN_VERTS = 8192;
+	if (indexUpperBound - indexLowerBound + 1 >= PARALLEL_DECODE_MIN_VERTS && dec_->CanDecodeInParallel()) {
+		dec_->DecodeVertsParallel(dest, verts, indexLowerBound, indexUpperBound);
+	} else {
+		dec_->DecodeVerts(dest, verts, indexLowerBound, indexUpperBound);
+	}
+}
+
 void DrawEngineCommon::DecodeVertsStep(u8 *dest, int &i, int &decodedVerts) {
 	PROFILE_THIS_SCOPE("vertdec");
 
@@ -516,7 +595,7 @@ void DrawEngineCommon::DecodeVertsStep(u8 *dest, int &i, int &decodedVerts) {
 	void *inds = dc.inds;
 	if (dc.indexType == GE_VTYPE_IDX_NONE >> GE_VTYPE_IDX_SHIFT) {
 		// Decode the verts and apply morphing. Simple.
-		dec_->DecodeVerts(dest + decodedVerts * (int)dec_->GetDecVtxFmt().stride,
+		DecodeVertRange(dest + decodedVerts * (int)dec_->GetDecVtxFmt().stride,
 			dc.verts, indexLowerBound, indexUpperBound);
 		decodedVerts += indexUpperBound - indexLowerBound + 1;
 		
@@ -583,7 +662,7 @@ void DrawEngineCommon::DecodeVertsStep(u8 *dest, int &i, int &decodedVerts) {
 		}
 
 		// 3. Decode that range of vertex data.
-		dec_->DecodeVerts(dest + decodedVerts * (int)dec_->GetDecVtxFmt().stride,
+		DecodeVertRange(dest + decodedVerts * (int)dec_->GetDecVtxFmt().stride,
 			dc.verts, indexLowerBound, indexUpperBound);
 		decodedVerts += vertexCount;
 
@@ -674,6 +753,136 @@ ReliableHashType DrawEngineCommon::ComputeHash() {
 	return fullhash;
 }
 
+static bool GuestRange(const void *ptr, size_t size, u32 *start, u32 *end) {
+	const u8 *p = (const u8 *)ptr;
+	if (p < Memory::base)
+		return false;
+	const u32 addr = (u32)(p - Memory::base) & 0x0FFFFFFF;
+	if (!Memory::IsValidAddress(addr))
+		return false;
+	*start = std::min(*start, addr);
+	*end = std::max(*end, addr + (u32)size);
+	return true;
+}
+
+void DrawEngineCommon::BeginVertexArray(VertexArrayInfoCommon *vai) {
+	vai->hash = ComputeHash();
+	vai->minihash = ComputeMiniHash();
+	vai->status = VertexArrayInfoCommon::VAI_HASHING;
+	vai->drawsUntilNextFullHash = 0;
+	vai->verifiedWriteGen = writeGen_;
+
+	// The id covers the pointers and counts, so this range stays valid for the entry's lifetime.
+	const int vertexSize = dec_->VertexSize();
+	const int indexSize = IndexSize(dec_->VertexType());
+	u32 start = 0xFFFFFFFF;
+	u32 end = 0;
+	for (int i = 0; i < numDrawCalls; i++) {
+		const DeferredDrawCall &dc = drawCalls[i];
+		bool valid;
+		if (!dc.inds) {
+			valid = GuestRange(dc.verts, vertexSize * dc.vertexCount, &start, &end);
+		} else {
+			valid = GuestRange((const u8 *)dc.verts + vertexSize * dc.indexLowerBound, vertexSize * (dc.indexUpperBound - dc.indexLowerBound + 1), &start, &end);
+			valid = valid && GuestRange(dc.inds, indexSize * dc.vertexCount, &start, &end);
+		}
+		if (!valid) {
+			// Not guest memory (like tessellated curves), so only hashing can tell.
+			start = 0;
+			end = 0;
+			break;
+		}
+	}
+	vai->memStart = start < end ? start : 0;
+	vai->memEnd = start < end ? end : 0;
+}
+
+bool DrawEngineCommon::CheckVertexArray(VertexArrayInfoCommon *vai) {
+	// A reported write gets a full check right away, instead of waiting for the backoff.
+	const bool written = vai->memEnd != 0 && WrittenSince(vai->memStart, vai->memEnd, vai->verifiedWriteGen);
+	if (vai->drawsUntilNextFullHash == 0 || written) {
+		// Let's try to skip a full hash if mini would fail.
+		const u32 newMiniHash = ComputeMiniHash();
+		ReliableHashType newHash = vai->hash;
+		if (newMiniHash == vai->minihash) {
+			newHash = ComputeHash();
+		}
+		if (newMiniHash != vai->minihash || newHash != vai->hash) {
+			return false;
+		}
+		vai->verifiedWriteGen = writeGen_;
+		if (vai->numVerts > 64) {
+			// exponential backoff up to 16 draws, then every 24
+			vai->drawsUntilNextFullHash = std::min(24, vai->numFrames);
+		} else {
+			// Lower numbers seem much more likely to change.
+			vai->drawsUntilNextFullHash = 0;
+		}
+	} else {
+		vai->drawsUntilNextFullHash--;
+		u32 newMiniHash = ComputeMiniHash();
+		if (newMiniHash != vai->minihash) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool DrawEngineCommon::ReseedVertexArray(VertexArrayInfoCommon *vai) {
+	// Data that was replaced through a write we were told about (like a DMA of new level
+	// geometry) is likely static again afterward. Anything else is written by the CPU as it goes.
+	if (vai->memEnd == 0 || vai->reseeds >= MAX_VERTEX_ARRAY_RESEEDS)
+		return false;
+	if (!WrittenSince(vai->memStart, vai->memEnd, vai->verifiedWriteGen))
+		return false;
+
+	vai->reseeds++;
+	vai->hash = ComputeHash();
+	vai->minihash = ComputeMiniHash();
+	vai->drawsUntilNextFullHash = 0;
+	vai->verifiedWriteGen = writeGen_;
+	return true;
+}
+
+void DrawEngineCommon::NotifyMemoryWrite(u32 addr, int size) {
+	if (size <= 0)
+		return;
+	writeGen_++;
+	addr &= 0x0FFFFFFF;
+	const u32 endBlock = std::min((addr + size - 1) >> WRITE_BLOCK_SHIFT, (u32)WRITE_BLOCKS - 1);
+	for (u32 block = addr >> WRITE_BLOCK_SHIFT; block <= endBlock; ++block) {
+		blockWriteGen_[block] = writeGen_;
+	}
+}
+
+bool DrawEngineCommon::WrittenSince(u32 start, u32 end, u32 gen) const {
+	const u32 endBlock = std::min((end - 1) >> WRITE_BLOCK_SHIFT, (u32)WRITE_BLOCKS - 1);
+	for (u32 block = start >> WRITE_BLOCK_SHIFT; block <= endBlock; ++block) {
+		if (blockWriteGen_[block] > gen)
+			return true;
+	}
+	return false;
+}
+
+bool DrawEngineCommon::CanSkipFlush(bool unaffected) {
+	if (numDrawCalls == 0 || !unaffected)
+		return false;
+	if (skippedFlushAt_ != numDrawCalls) {
+		skippedFlushAt_ = numDrawCalls;
+		gpuStats.numFlushesSkipped++;
+	}
+	return true;
+}
+
+bool DrawEngineCommon::CanSkipFlushForTransform() {
+	// All pending draws share lastVType_, since a change of through mode always flushes.
+	return CanSkipFlush((lastVType_ & GE_VTYPE_THROUGH_MASK) != 0);
+}
+
+bool DrawEngineCommon::CanSkipFlushForBones() {
+	return CanSkipFlush((lastVType_ & GE_VTYPE_WEIGHT_MASK) == GE_VTYPE_WEIGHT_NONE);
+}
+
 // vertTypeID is the vertex type but with the UVGen mode smashed into the top bits.
 void DrawEngineCommon::SubmitPrim(void *verts, void *inds, GEPrimitiveType prim, int vertexCount, u32 vertTypeID, int cullMode, int *bytesRead) {
 	if (!indexGen.PrimCompatible(prevPrim_, prim) || numDrawCalls >= MAX_DEFERRED_DRAW_CALLS || vertexCountInDrawCalls_ + vertexCount > VERTEX_BUFFER_MAX) {
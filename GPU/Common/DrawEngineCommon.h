@@ -34,6 +34,7 @@ enum {
 	VERTEX_BUFFER_MAX = 65536,
 	DECODED_VERTEX_BUFFER_SIZE = VERTEX_BUFFER_MAX * 64,
 	DECODED_INDEX_BUFFER_SIZE = VERTEX_BUFFER_MAX * 16,
+	FRAME_ARENA_SIZE = DECODED_VERTEX_BUFFER_SIZE / 2,
 };
 
 // Avoiding the full include of TextureDecoder.h.
@@ -50,7 +51,7 @@ inline uint32_t GetVertTypeID(uint32_t vertType, int uvGenMode) {
 }
 
 struct SimpleVertex;
-namespace Spline { struct Weight2D; }
+namespace Spline { struct Weight; struct Weight2D; }
 
 class TessellationDataTransfer {
 public:
@@ -59,6 +60,87 @@ class TessellationDataTransfer {
 	virtual void SendDataToShader(const SimpleVertex *const *points, int size_u, int size_v, u32 vertType, const Spline::Weight2D &weights) = 0;
 };
 
+// Bump allocator for draw temporaries, like spline control points. Nothing is freed individually:
+// callers can Rewind() to a Mark() when done, and everything is reset at the start of each frame.
+class FrameArena {
+public:
+	void Init(u8 *buf, size_t size) {
+		buf_ = buf;
+		size_ = size;
+		used_ = 0;
+	}
+
+	u8 *Allocate(size_t size) {
+		size = (size + 15) & ~15;  // Align for 16 bytes
+		if (used_ + size > size_)
+			return nullptr;
+		u8 *ptr = buf_ + used_;
+		used_ += size;
+		if (used_ > highWater_)
+			highWater_ = used_;
+		return ptr;
+	}
+
+	size_t Mark() const {
+		return used_;
+	}
+	void Rewind(size_t mark) {
+		used_ = mark;
+	}
+
+	// Returns the most that was in use since the last reset.
+	size_t Reset() {
+		size_t highWater = highWater_;
+		used_ = 0;
+		highWater_ = 0;
+		return highWater;
+	}
+
+private:
+	u8 *buf_ = nullptr;
+	size_t size_ = 0;
+	size_t used_ = 0;
+	size_t highWater_ = 0;
+};
+
+// The backend independent part of a vertex cache entry. The backends add their buffer handles.
+class VertexArrayInfoCommon {
+public:
+	VertexArrayInfoCommon() {
+		lastFrame = gpuStats.numFlips;
+	}
+
+	enum Status : uint8_t {
+		VAI_NEW,
+		VAI_HASHING,
+		VAI_RELIABLE,  // cache, don't hash
+		VAI_UNRELIABLE,  // never cache
+	};
+
+	ReliableHashType hash = 0;
+	u32 minihash = 0;
+
+	// Precalculated draw parameters
+	u16 numVerts = 0;
+	u16 maxIndex = 0;
+	s8 prim = GE_PRIM_INVALID;
+	Status status = VAI_NEW;
+
+	// ID information
+	int numDraws = 0;
+	int numFrames = 0;
+	int lastFrame;  // So that we can forget.
+	u16 drawsUntilNextFullHash = 0;
+	u8 flags = 0;
+	// How many times a reported write replaced the data, see ReseedVertexArray().
+	u8 reseeds = 0;
+
+	// Guest memory read by the draws, and the write generation it was last verified against.
+	u32 memStart = 0;
+	u32 memEnd = 0;
+	u32 verifiedWriteGen = 0;
+};
+
 class DrawEngineCommon {
 public:
 	DrawEngineCommon();
@@ -91,6 +173,9 @@ class DrawEngineCommon {
 
 	virtual void Resized();
 
+	// Called from GPUCommon::BeginFrame, for all backends.
+	void ResetFrameArena();
+
 	bool IsCodePtrVertexDecoder(const u8 *ptr) const {
 		return decJitCache_->IsInSpace(ptr);
 	}
@@ -98,7 +183,18 @@ class DrawEngineCommon {
 		return numDrawCalls;
 	}
 
+	// Through mode draws don't read the world, view or projection matrices, and unweighted draws
+	// don't read the bones, so pending draws like that can be merged across those changes.
+	bool CanSkipFlushForTransform();
+	bool CanSkipFlushForBones();
+
 	VertexDecoder *GetVertexDecoder(u32 vtype);
+	// Precompiles decoders for the vertex types seen the last time this game was run.
+	bool LoadVertexDecoderCache(const std::string &filename);
+	void SaveVertexDecoderCache(const std::string &filename);
+
+	// Called by the GPU for guest writes it hears about (cache writebacks, DMA, memcpy/memset.)
+	void NotifyMemoryWrite(u32 addr, int size);
 
 protected:
 	virtual void ClearTrackedVertexArrays() {}
@@ -113,10 +209,21 @@ class DrawEngineCommon {
 	u32 ComputeMiniHash();
 	ReliableHashType ComputeHash();
 
+	// Shared vertex cache heuristics, for the current draw calls.
+	void BeginVertexArray(VertexArrayInfoCommon *vai);
+	// Returns false if the data no longer matches the cached copy.
+	bool CheckVertexArray(VertexArrayInfoCommon *vai);
+	// After a mismatch, returns true if the entry should be refilled rather than given up on.
+	bool ReseedVertexArray(VertexArrayInfoCommon *vai);
+	bool WrittenSince(u32 start, u32 end, u32 gen) const;
+
 	// Vertex decoding
 	void DecodeVertsStep(u8 *dest, int &i, int &decodedVerts);
+	// Backends can override this to decode on the GPU instead, dest is then only used for its position.
+	virtual void DecodeVertRange(u8 *dest, const void *verts, int indexLowerBound, int indexUpperBound);
 
 	bool ApplyShaderBlending();
+	bool CanSkipFlush(bool unaffected);
 
 	inline int IndexSize(u32 vtype) const {
 		const u32 indexType = (vtype & GE_VTYPE_IDX_MASK);
@@ -142,6 +249,10 @@ class DrawEngineCommon {
 	TransformedVertex *transformed = nullptr;
 	TransformedVertex *transformedExpanded = nullptr;
 
+	// Per-frame draw temporaries, so they don't need to carve out (or allocate) buffers.
+	FrameArena frameArena_;
+	u8 *frameArenaBuf_ = nullptr;
+
 	// Defer all vertex decoding to a "Flush" (except when software skinning)
 	struct DeferredDrawCall {
 		void *verts;
@@ -155,12 +266,23 @@ class DrawEngineCommon {
 		int cullMode;
 	};
 
-	enum { MAX_DEFERRED_DRAW_CALLS = 128 };
+	enum { MAX_DEFERRED_DRAW_CALLS = 256 };
 	DeferredDrawCall drawCalls[MAX_DEFERRED_DRAW_CALLS];
 	int numDrawCalls = 0;
 	int vertexCountInDrawCalls_ = 0;
+	// Draw count when we last skipped a flush, so each batch only counts once.
+	int skippedFlushAt_ = 0;
 
 	int decimationCounter_ = 0;
+
+	// Guest write tracking for the vertex cache, in 64KB blocks.
+	enum {
+		WRITE_BLOCK_SHIFT = 16,
+		WRITE_BLOCKS = 0x10000000 >> WRITE_BLOCK_SHIFT,
+		MAX_VERTEX_ARRAY_RESEEDS = 8,
+	};
+	u32 writeGen_ = 1;
+	u32 blockWriteGen_[WRITE_BLOCKS]{};
 	int decodeCounter_ = 0;
 	u32 dcid_ = 0;
 
@@ -27,6 +27,8 @@
 #include "i18n/i18n.h"
 #include "Common/ColorConv.h"
 #include "Common/Common.h"
+#include "Common/MemoryUsage.h"
+#include "Common/SlabPool.h"
 #include "Core/Config.h"
 #include "Core/ConfigValues.h"
 #include "Core/CoreParameter.h"
@@ -114,6 +116,16 @@ void CenterDisplayOutputRect(float *x, float *y, float *w, float *h, float origW
 	*h = floorf(outH);
 }
 
+// Only touched from the GPU thread.
+static SlabPool<sizeof(VirtualFramebuffer), 32> virtualFramebufferPool;
+
+void *VirtualFramebuffer::operator new(size_t size) {
+	return virtualFramebufferPool.Allocate(size);
+}
+
+void VirtualFramebuffer::operator delete(void *ptr) {
+	virtualFramebufferPool.Free(ptr);
+}
 
 FramebufferManagerCommon::FramebufferManagerCommon(Draw::DrawContext *draw)
 	: draw_(draw),
@@ -122,6 +134,8 @@ FramebufferManagerCommon::FramebufferManagerCommon(Draw::DrawContext *draw)
 }
 
 FramebufferManagerCommon::~FramebufferManagerCommon() {
+	if (dynamicResProfiling_)
+		draw_->RequestGPUProfiling(false);
 	DecimateFBOs();
 	for (auto vfb : vfbs_) {
 		DestroyFramebuf(vfb);
@@ -133,13 +147,16 @@ FramebufferManagerCommon::~FramebufferManagerCommon() {
 	}
 	tempFBOs_.clear();
 
+	// Any readbacks still in flight would land in memory that's going away.
+	if (draw_)
+		draw_->DiscardAsyncCopies();
+
 	// Do the same for ReadFramebuffersToMemory's VFBs
 	for (auto vfb : bvfbs_) {
 		DestroyFramebuf(vfb);
 	}
+	MemoryUsage::Set(MemoryUsage::Category::FRAMEBUFFERS, 0);
 	bvfbs_.clear();
-
-	SetNumExtraFBOs(0);
 }
 
 void FramebufferManagerCommon::Init() {
@@ -147,11 +164,11 @@ void FramebufferManagerCommon::Init() {
 }
 
 bool FramebufferManagerCommon::UpdateSize() {
-	const bool newRender = renderWidth_ != (float)PSP_CoreParameter().renderWidth || renderHeight_ != (float)PSP_CoreParameter().renderHeight;
+	const bool newRender = renderWidth_ != (float)PSP_CoreParameter().renderWidth * dynamicResScale_ || renderHeight_ != (float)PSP_CoreParameter().renderHeight * dynamicResScale_;
 	const bool newSettings = bloomHack_ != g_Config.iBloomHack || useBufferedRendering_ != (g_Config.iRenderingMode != FB_NON_BUFFERED_MODE);
 
-	renderWidth_ = (float)PSP_CoreParameter().renderWidth;
-	renderHeight_ = (float)PSP_CoreParameter().renderHeight;
+	renderWidth_ = (float)PSP_CoreParameter().renderWidth * dynamicResScale_;
+	renderHeight_ = (float)PSP_CoreParameter().renderHeight * dynamicResScale_;
 	pixelWidth_ = PSP_CoreParameter().pixelWidth;
 	pixelHeight_ = PSP_CoreParameter().pixelHeight;
 	bloomHack_ = g_Config.iBloomHack;
@@ -162,9 +179,81 @@ bool FramebufferManagerCommon::UpdateSize() {
 
 void FramebufferManagerCommon::BeginFrame() {
 	DecimateFBOs();
+	UpdateDynamicResolution();
 	currentRenderVfb_ = nullptr;
 }
 
+void FramebufferManagerCommon::UpdateDynamicResolution() {
+	const bool enabled = g_Config.bDynamicResolution && useBufferedRendering_ && draw_;
+	if (enabled != dynamicResProfiling_) {
+		draw_->RequestGPUProfiling(enabled);
+		dynamicResProfiling_ = enabled;
+		dynamicResOverBudget_ = 0;
+		dynamicResUnderBudget_ = 0;
+	}
+	if (!enabled) {
+		if (dynamicResScale_ != 1.0f)
+			SetDynamicResolutionScale(1.0f);
+		return;
+	}
+
+	if (dynamicResCooldown_ > 0) {
+		// Let the GPU profile catch up with the last change first.
+		dynamicResCooldown_--;
+		return;
+	}
+
+	Draw::GPUProfile profile;
+	if (!draw_->GetGPUProfile(&profile) || profile.gpuMilliseconds <= 0.0)
+		return;
+
+	// Steps are half the PSP resolution, from 1x up to the configured size.
+	const float fullWidth = (float)PSP_CoreParameter().renderWidth;
+	const int fullSteps = std::max(2, (int)(fullWidth / 240.0f + 0.5f));
+	const int steps = std::min(fullSteps, std::max(2, (int)(renderWidth_ / 240.0f + 0.5f)));
+
+	const double budget = 1000.0 / 60.0;
+	const double ms = profile.gpuMilliseconds;
+	// GPU time is mostly fill, so estimate the next step up by pixel count.
+	const double upRatio = (double)(steps + 1) / (double)steps;
+	if (ms > budget * 0.9 && steps > 2) {
+		dynamicResOverBudget_++;
+		dynamicResUnderBudget_ = 0;
+	} else if (steps < fullSteps && ms * upRatio * upRatio < budget * 0.7) {
+		dynamicResUnderBudget_++;
+		dynamicResOverBudget_ = 0;
+	} else {
+		dynamicResOverBudget_ = 0;
+		dynamicResUnderBudget_ = 0;
+	}
+
+	int newSteps = steps;
+	if (dynamicResOverBudget_ >= DYNRES_DOWN_FRAMES)
+		newSteps = steps - 1;
+	else if (dynamicResUnderBudget_ >= DYNRES_UP_FRAMES)
+		newSteps = steps + 1;
+	if (newSteps != steps)
+		SetDynamicResolutionScale(newSteps >= fullSteps ? 1.0f : (float)(newSteps * 240) / fullWidth);
+}
+
+void FramebufferManagerCommon::SetDynamicResolutionScale(float scale) {
+	dynamicResScale_ = scale;
+	dynamicResOverBudget_ = 0;
+	dynamicResUnderBudget_ = 0;
+	dynamicResCooldown_ = DYNRES_COOLDOWN_FRAMES;
+
+	renderWidth_ = (float)PSP_CoreParameter().renderWidth * scale;
+	renderHeight_ = (float)PSP_CoreParameter().renderHeight * scale;
+	INFO_LOG(FRAMEBUF, "Dynamic resolution: rendering at %dx%d", (int)renderWidth_, (int)renderHeight_);
+
+	// Rescale the existing framebuffers in place, copying their contents, rather than dropping them all.
+	for (VirtualFramebuffer *vfb : vfbs_) {
+		if (vfb->fbo)
+			ResizeFramebufFBO(vfb, vfb->bufferWidth, vfb->bufferHeight, true);
+	}
+	gstate_c.Dirty(DIRTY_PROJTHROUGHMATRIX | DIRTY_VIEWPORTSCISSOR_STATE | DIRTY_CULLRANGE | DIRTY_BLEND_STATE);
+}
+
 void FramebufferManagerCommon::SetDisplayFramebuffer(u32 framebuf, u32 stride, GEBufferFormat format) {
 	displayFramebufPtr_ = framebuf;
 	displayStride_ = stride;
@@ -195,17 +284,17 @@ bool FramebufferManagerCommon::ShouldDownloadFramebuffer(const VirtualFramebuffe
 	return PSP_CoreParameter().compat.flags().Force04154000Download && vfb->fb_address == 0x04154000;
 }
 
-void FramebufferManagerCommon::SetNumExtraFBOs(int num) {
-	for (size_t i = 0; i < extraFBOs_.size(); i++) {
-		extraFBOs_[i]->ReleaseAssertLast();
-	}
-	extraFBOs_.clear();
-	for (int i = 0; i < num; i++) {
-		// No depth/stencil for post processing
-		Draw::Framebuffer *fbo = draw_->CreateFramebuffer({ (int)renderWidth_, (int)renderHeight_, 1, 1, false, Draw::FBO_8888 });
-		extraFBOs_.push_back(fbo);
+void FramebufferManagerCommon::LoadPostShaderChain() {
+	postShaderChain_.clear();
+	if (g_Config.sPostShaderName == "Off")
+		return;
+
+	ReloadAllPostShaderInfo();
+	for (const ShaderInfo *info : GetPostShaderChain(g_Config.sPostShaderName)) {
+		postShaderChain_.push_back(*info);
 	}
-	currentRenderVfb_ = 0;
+	// Only the last pass can draw straight to the screen.
+	postShaderAtOutputResolution_ = !postShaderChain_.empty() && postShaderChain_.back().outputResolution;
 }
 
 // Heuristics to figure out the size of FBO to create.
@@ -454,6 +543,7 @@ VirtualFramebuffer *FramebufferManagerCommon::DoSetRenderFrameBuffer(const Frame
 		vfb->last_frame_render = gpuStats.numFlips;
 		frameLastFramebufUsed_ = gpuStats.numFlips;
 		vfbs_.push_back(vfb);
+		vfb->generation++;
 		currentRenderVfb_ = vfb;
 
 		if (useBufferedRendering_ && !g_Config.bDisableSlowFramebufEffects) {
@@ -500,6 +590,7 @@ VirtualFramebuffer *FramebufferManagerCommon::DoSetRenderFrameBuffer(const Frame
 			vfb->reallyDirtyAfterDisplay = true;
 
 		VirtualFramebuffer *prev = currentRenderVfb_;
+		vfb->generation++;
 		currentRenderVfb_ = vfb;
 		NotifyRenderFramebufferSwitched(prev, vfb, params.isClearingDepth);
 	} else {
@@ -703,8 +794,14 @@ void FramebufferManagerCommon::UpdateFromMemory(u32 addr, int size, bool safe) {
 						// If we're not rendering to it, format may be wrong.  Use displayFormat_ instead.
 						fmt = displayFormat_;
 					}
-					DrawPixels(vfb, 0, 0, Memory::GetPointer(addr), fmt, vfb->fb_stride, vfb->width, vfb->height);
-					SetColorUpdated(vfb, gstate_c.skipDrawReason);
+					// Only upload the lines that were written, not the whole buffer.
+					const int byteStride = vfb->fb_stride * (fmt == GE_FORMAT_8888 ? 4 : 2);
+					int h = vfb->height;
+					if (byteStride > 0 && size > 0)
+						h = std::min(h, (size + byteStride - 1) / byteStride);
+					DrawPixels(vfb, 0, 0, Memory::GetPointer(addr), fmt, vfb->fb_stride, vfb->width, h);
+					// RAM already has these pixels.
+					SetColorUpdated(vfb, gstate_c.skipDrawReason, 0, 0, 0, 0);
 				} else {
 					INFO_LOG(FRAMEBUF, "Invalidating FBO for %08x (%i x %i x %i)", vfb->fb_address, vfb->width, vfb->height, vfb->format);
 					DestroyFramebuf(vfb);
@@ -720,6 +817,8 @@ void FramebufferManagerCommon::UpdateFromMemory(u32 addr, int size, bool safe) {
 }
 
 void FramebufferManagerCommon::DrawPixels(VirtualFramebuffer *vfb, int dstX, int dstY, const u8 *srcPixels, GEBufferFormat srcPixelFormat, int srcStride, int width, int height) {
+	if (vfb)
+		vfb->generation++;
 	textureCache_->ForgetLastTexture();
 	shaderManager_->DirtyLastShader();  // On GL, important that this is BEFORE drawing
 	float u0 = 0.0f, u1 = 1.0f;
@@ -796,7 +895,7 @@ void FramebufferManagerCommon::DrawFramebufferToOutput(const u8 *srcPixels, GEBu
 		if (usePostShader_) {
 			PostShaderUniforms uniforms{};
 			CalculatePostShaderUniforms(480, 272, renderWidth_, renderHeight_, &uniforms);
-			BindPostShader(uniforms);
+			BindPostShader(uniforms, (int)postShaderChain_.size() - 1);
 		} else {
 			Bind2DShader();
 		}
@@ -997,38 +1096,56 @@ void FramebufferManagerCommon::CopyDisplayToOutput() {
 				SetViewport2D(0, 0, pixelWidth_, pixelHeight_);
 				DrawActiveTexture(x, y, w, h, (float)pixelWidth_, (float)pixelHeight_, u0, v0, u1, v1, uvRotation, flags);
 			}
-		} else if (usePostShader_ && extraFBOs_.size() == 1 && !postShaderAtOutputResolution_) {
-			// An additional pass, post-processing shader to the extra FBO.
+		} else if (usePostShader_ && (postShaderChain_.size() > 1 || !postShaderAtOutputResolution_)) {
+			// Run the passes into pooled targets, each at its own scale and color depth.
+			// A last pass at output resolution draws straight to the backbuffer instead.
 			shaderManager_->DirtyLastShader();  // dirty lastShader_
-			draw_->BindFramebufferAsRenderTarget(extraFBOs_[0], { Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE });
-			draw_->BindFramebufferAsTexture(vfb->fbo, 0, Draw::FB_COLOR_BIT, 0);
-			int fbo_w, fbo_h;
-			draw_->GetFramebufferDimensions(extraFBOs_[0], &fbo_w, &fbo_h);
-			SetViewport2D(0, 0, fbo_w, fbo_h);
-			draw_->SetScissorRect(0, 0, fbo_w, fbo_h);
-			PostShaderUniforms uniforms{};
-			CalculatePostShaderUniforms(vfb->bufferWidth, vfb->bufferHeight, renderWidth_, renderHeight_, &uniforms);
-			BindPostShader(uniforms);
-			DrawTextureFlags flags = g_Config.iBufFilter == SCALE_LINEAR ? DRAWTEX_LINEAR : DRAWTEX_NEAREST;
-			DrawActiveTexture(0, 0, fbo_w, fbo_h, fbo_w, fbo_h, 0.0f, 0.0f, 1.0f, 1.0f, ROTATION_LOCKED_HORIZONTAL, flags);
+			const int lastPass = (int)postShaderChain_.size() - 1;
+			const int offscreenPasses = postShaderAtOutputResolution_ ? lastPass : lastPass + 1;
+			Draw::Framebuffer *srcFBO = vfb->fbo;
+			int srcWidth = (int)renderWidth_;
+			int srcHeight = (int)renderHeight_;
+			for (int pass = 0; pass < offscreenPasses; ++pass) {
+				const ShaderInfo &info = postShaderChain_[pass];
+				int fbo_w = std::max(1, (int)(renderWidth_ * info.scale));
+				int fbo_h = std::max(1, (int)(renderHeight_ * info.scale));
+				Draw::Framebuffer *target = GetTempFBO((pass & 1) ? TempFBO::POSTSHADER_ODD : TempFBO::POSTSHADER_EVEN, fbo_w, fbo_h, info.colorDepth);
+				if (!target) {
+					ERROR_LOG_REPORT_ONCE(postshaderfbo, FRAMEBUF, "Unable to create %dx%d target for post shader pass %d", fbo_w, fbo_h, pass);
+					break;
+				}
+				draw_->BindFramebufferAsRenderTarget(target, { Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE });
+				draw_->BindFramebufferAsTexture(srcFBO, 0, Draw::FB_COLOR_BIT, 0);
+				SetViewport2D(0, 0, fbo_w, fbo_h);
+				draw_->SetScissorRect(0, 0, fbo_w, fbo_h);
+				PostShaderUniforms uniforms{};
+				CalculatePostShaderUniforms(vfb->bufferWidth, vfb->bufferHeight, srcWidth, srcHeight, &uniforms);
+				BindPostShader(uniforms, pass);
+				DrawTextureFlags flags = g_Config.iBufFilter == SCALE_LINEAR || pass > 0 ? DRAWTEX_LINEAR : DRAWTEX_NEAREST;
+				DrawActiveTexture(0, 0, fbo_w, fbo_h, fbo_w, fbo_h, 0.0f, 0.0f, 1.0f, 1.0f, ROTATION_LOCKED_HORIZONTAL, flags);
+				srcFBO = target;
+				srcWidth = fbo_w;
+				srcHeight = fbo_h;
+			}
 
 			draw_->BindFramebufferAsRenderTarget(nullptr, { Draw::RPAction::CLEAR, Draw::RPAction::CLEAR, Draw::RPAction::CLEAR });
 			draw_->SetScissorRect(0, 0, pixelWidth_, pixelHeight_);
 
-			// Use the extra FBO, with applied post-processing shader, as a texture.
-			// fbo_bind_as_texture(extraFBOs_[0], FB_COLOR_BIT, 0);
-			if (extraFBOs_.size() == 0) {
-				ERROR_LOG(FRAMEBUF, "Unexpected: No extra FBOs?");
-				return;
-			}
-			draw_->BindFramebufferAsTexture(extraFBOs_[0], 0, Draw::FB_COLOR_BIT, 0);
+			// Use the last target, with the offscreen passes applied, as a texture.
+			draw_->BindFramebufferAsTexture(srcFBO, 0, Draw::FB_COLOR_BIT, 0);
 
 			// We are doing the DrawActiveTexture call directly to the backbuffer after here. Hence, we must
 			// flip V.
 			if (needBackBufferYSwap_)
 				std::swap(v0, v1);
-			Bind2DShader();
-			flags = (!postShaderIsUpscalingFilter_ && g_Config.iBufFilter == SCALE_LINEAR) ? DRAWTEX_LINEAR : DRAWTEX_NEAREST;
+			if (postShaderAtOutputResolution_ && srcFBO != vfb->fbo) {
+				PostShaderUniforms uniforms{};
+				CalculatePostShaderUniforms(vfb->bufferWidth, vfb->bufferHeight, srcWidth, srcHeight, &uniforms);
+				BindPostShader(uniforms, lastPass);
+			} else {
+				Bind2DShader();
+			}
+			DrawTextureFlags flags = (!postShaderIsUpscalingFilter_ && g_Config.iBufFilter == SCALE_LINEAR) ? DRAWTEX_LINEAR : DRAWTEX_NEAREST;
 			flags = flags | DRAWTEX_TO_BACKBUFFER;
 			if (g_Config.bEnableCardboardVR) {
 				// Left Eye Image
@@ -1057,7 +1174,7 @@ void FramebufferManagerCommon::CopyDisplayToOutput() {
 
 			PostShaderUniforms uniforms{};
 			CalculatePostShaderUniforms(vfb->bufferWidth, vfb->bufferHeight, vfb->renderWidth, vfb->renderHeight, &uniforms);
-			BindPostShader(uniforms);
+			BindPostShader(uniforms, 0);
 			if (g_Config.bEnableCardboardVR) {
 				// Left Eye Image
 				SetViewport2D(cardboardSettings.leftEyeXPosition, cardboardSettings.screenYPosition, cardboardSettings.screenWidth, cardboardSettings.screenHeight);
@@ -1081,6 +1198,33 @@ void FramebufferManagerCommon::CopyDisplayToOutput() {
 	gstate_c.Dirty(DIRTY_VIEWPORTSCISSOR_STATE | DIRTY_BLEND_STATE);
 }
 
+// Rough guess, drivers may pad or compress.
+static s64 EstimateFramebufferBytes(int w, int h, Draw::FBColorDepth colorDepth, bool zStencil) {
+	s64 bytes = (s64)w * h * (colorDepth == Draw::FBO_8888 ? 4 : 2);
+	if (zStencil)
+		bytes += (s64)w * h * 4;
+	return bytes;
+}
+
+void FramebufferManagerCommon::ReportMemoryUsage() {
+	s64 bytes = 0;
+	for (auto vfb : vfbs_) {
+		if (vfb->fbo)
+			bytes += EstimateFramebufferBytes(vfb->renderWidth, vfb->renderHeight, (Draw::FBColorDepth)vfb->colorDepth, true);
+	}
+	for (auto vfb : bvfbs_) {
+		if (vfb->fbo)
+			bytes += EstimateFramebufferBytes(vfb->renderWidth, vfb->renderHeight, (Draw::FBColorDepth)vfb->colorDepth, true);
+	}
+	for (const auto &it : tempFBOs_) {
+		// See GetTempFBO() for the key layout.
+		u64 key = it.first;
+		bool zStencil = (TempFBO)(key >> 48) == TempFBO::STENCIL;
+		bytes += EstimateFramebufferBytes((key >> 16) & 0xFFFF, key & 0xFFFF, (Draw::FBColorDepth)((key >> 32) & 0xFFFF), zStencil);
+	}
+	MemoryUsage::Set(MemoryUsage::Category::FRAMEBUFFERS, bytes);
+}
+
 void FramebufferManagerCommon::DecimateFBOs() {
 	currentRenderVfb_ = 0;
 
@@ -1132,12 +1276,17 @@ void FramebufferManagerCommon::DecimateFBOs() {
 			bvfbs_.erase(bvfbs_.begin() + i--);
 		}
 	}
+
+	ReportMemoryUsage();
 }
 
 void FramebufferManagerCommon::ResizeFramebufFBO(VirtualFramebuffer *vfb, int w, int h, bool force, bool skipCopy) {
 	assert(w > 0);
 	assert(h > 0);
 	VirtualFramebuffer old = *vfb;
+	vfb->generation++;
+	// New areas, and everything if the copy is skipped, won't match RAM.
+	AddDirtyRect(vfb, 0, 0, std::max(w, (int)vfb->bufferWidth), std::max(h, (int)vfb->bufferHeight));
 
 	int oldWidth = vfb->bufferWidth;
 	int oldHeight = vfb->bufferHeight;
@@ -1406,6 +1555,13 @@ void FramebufferManagerCommon::FindTransferFramebuffers(VirtualFramebuffer *&dst
 		// TODO: We don't really know the 16-bit format here.. at all. Can only guess when it gets used later!
 		// But actually, the format of the source buffer is probably not a bad guess..
 		dstBuffer = CreateRAMFramebuffer(dstBasePtr, dstWidth, dstHeight, dstStride, ramFormat);
+	} else if (!dstBuffer && srcBuffer && g_Config.bBlockTransferGPU && dstHeight > 1 && textureCache_->HasTextureAt(dstBasePtr)) {
+		// Copying a framebuffer to somewhere we already sample a texture from.  Keep it on the GPU:
+		// the texture cache will pick up the new framebuffer instead of us downloading to RAM.
+		const int srcBpp = srcBuffer->format == GE_FORMAT_8888 ? 4 : 2;
+		GEBufferFormat ramFormat = srcBpp == bpp ? srcBuffer->format : (bpp == 4 ? GE_FORMAT_8888 : GE_FORMAT_5551);
+		WARN_LOG_ONCE(btdtex, G3D, "Block transfer to texture %08x, creating framebuffer", dstBasePtr);
+		dstBuffer = CreateRAMFramebuffer(dstBasePtr, dstX + dstWidth, dstY + dstHeight, dstStride, ramFormat);
 	}
 
 	if (dstBuffer)
@@ -1519,21 +1675,13 @@ VirtualFramebuffer *FramebufferManagerCommon::FindDownloadTempBuffer(VirtualFram
 	return nvfb;
 }
 
-void FramebufferManagerCommon::ApplyClearToMemory(int x1, int y1, int x2, int y2, u32 clearColor) {
-	if (currentRenderVfb_) {
-		if ((currentRenderVfb_->usageFlags & FB_USAGE_DOWNLOAD_CLEAR) != 0) {
-			// Already zeroed in memory.
-			return;
-		}
-	}
-
-	u8 *addr = Memory::GetPointer(gstate.getFrameBufAddress());
-	const int bpp = gstate.FrameBufFormat() == GE_FORMAT_8888 ? 4 : 2;
+static void ClearFramebufferMemory(u8 *addr, int stride, GEBufferFormat format, int x1, int y1, int x2, int y2, u32 clearColor) {
+	const int bpp = format == GE_FORMAT_8888 ? 4 : 2;
 
 	u32 clearBits = clearColor;
 	if (bpp == 2) {
 		u16 clear16 = 0;
-		switch (gstate.FrameBufFormat()) {
+		switch (format) {
 		case GE_FORMAT_565: ConvertRGBA8888ToRGB565(&clear16, &clearColor, 1); break;
 		case GE_FORMAT_5551: ConvertRGBA8888ToRGBA5551(&clear16, &clearColor, 1); break;
 		case GE_FORMAT_4444: ConvertRGBA8888ToRGBA4444(&clear16, &clearColor, 1); break;
@@ -1543,7 +1691,6 @@ void FramebufferManagerCommon::ApplyClearToMemory(int x1, int y1, int x2, int y2
 	}
 
 	const bool singleByteClear = (clearBits >> 16) == (clearBits & 0xFFFF) && (clearBits >> 24) == (clearBits & 0xFF);
-	const int stride = gstate.FrameBufStride();
 	const int width = x2 - x1;
 
 	// Can use memset for simple cases. Often alpha is different and gums up the works.
@@ -1587,6 +1734,18 @@ void FramebufferManagerCommon::ApplyClearToMemory(int x1, int y1, int x2, int y2
 			}
 		}
 	}
+}
+
+void FramebufferManagerCommon::ApplyClearToMemory(int x1, int y1, int x2, int y2, u32 clearColor) {
+	if (currentRenderVfb_) {
+		if ((currentRenderVfb_->usageFlags & FB_USAGE_DOWNLOAD_CLEAR) != 0) {
+			// Already zeroed in memory.
+			return;
+		}
+	}
+
+	u8 *addr = Memory::GetPointer(gstate.getFrameBufAddress());
+	ClearFramebufferMemory(addr, gstate.FrameBufStride(), gstate.FrameBufFormat(), x1, y1, x2, y2, clearColor);
 
 	if (currentRenderVfb_) {
 		// The current content is in memory now, so update the flag.
@@ -1597,6 +1756,67 @@ void FramebufferManagerCommon::ApplyClearToMemory(int x1, int y1, int x2, int y2
 	}
 }
 
+void FramebufferManagerCommon::DeferClearToMemory(int x1, int y1, int x2, int y2, u32 clearColor) {
+	// Only whole buffer clears, so the constant is all a later download could find.
+	if (!currentRenderVfb_ || x1 > 0 || y1 > 0 || x2 < currentRenderVfb_->width || y2 < currentRenderVfb_->height)
+		return;
+	flushClearPending_ = true;
+	flushClearColor_ = clearColor;
+}
+
+void FramebufferManagerCommon::AddDirtyRect(VirtualFramebuffer *vfb, int x1, int y1, int x2, int y2) {
+	if (x2 <= x1 || y2 <= y1)
+		return;
+	if (vfb->dirtyX2 <= vfb->dirtyX1) {
+		vfb->dirtyX1 = x1;
+		vfb->dirtyY1 = y1;
+		vfb->dirtyX2 = x2;
+		vfb->dirtyY2 = y2;
+	} else {
+		vfb->dirtyX1 = std::min((int)vfb->dirtyX1, x1);
+		vfb->dirtyY1 = std::min((int)vfb->dirtyY1, y1);
+		vfb->dirtyX2 = std::max((int)vfb->dirtyX2, x2);
+		vfb->dirtyY2 = std::max((int)vfb->dirtyY2, y2);
+	}
+}
+
+void FramebufferManagerCommon::SetColorUpdatedInScissor(int skipDrawReason) {
+	if (currentRenderVfb_) {
+		int x2 = gstate.getScissorX2() + 1;
+		int y2 = gstate.getScissorY2() + 1;
+		SetColorUpdated(currentRenderVfb_, skipDrawReason, gstate.getScissorX1(), gstate.getScissorY1(), x2, y2);
+		if (flushClearPending_) {
+			// This flush was just the clear, so the whole buffer is still that constant.
+			currentRenderVfb_->clearPending = true;
+			currentRenderVfb_->clearColor = flushClearColor_;
+		}
+	}
+	flushClearPending_ = false;
+}
+
+bool FramebufferManagerCommon::ClipDownloadToDirty(VirtualFramebuffer *vfb, int &x, int &y, int &w, int &h) {
+	bool coversDirty = x <= vfb->dirtyX1 && y <= vfb->dirtyY1 && x + w >= vfb->dirtyX2 && y + h >= vfb->dirtyY2;
+	int x1 = std::max(x, (int)vfb->dirtyX1);
+	int y1 = std::max(y, (int)vfb->dirtyY1);
+	int x2 = std::min(x + w, (int)vfb->dirtyX2);
+	int y2 = std::min(y + h, (int)vfb->dirtyY2);
+	if (coversDirty) {
+		// Once this lands, RAM is all caught up.
+		vfb->dirtyX1 = 0;
+		vfb->dirtyY1 = 0;
+		vfb->dirtyX2 = 0;
+		vfb->dirtyY2 = 0;
+	}
+	if (x2 <= x1 || y2 <= y1)
+		return false;
+
+	x = x1;
+	y = y1;
+	w = x2 - x1;
+	h = y2 - y1;
+	return true;
+}
+
 void FramebufferManagerCommon::OptimizeDownloadRange(VirtualFramebuffer * vfb, int & x, int & y, int & w, int & h) {
 	if (gameUsesSequentialCopies_) {
 		// Ignore the x/y/etc., read the entire thing.
@@ -1650,7 +1870,20 @@ bool FramebufferManagerCommon::NotifyBlockTransferBefore(u32 dstBasePtr, int dst
 			if (srcX != dstX || srcY != dstY) {
 				WARN_LOG_ONCE(dstsrc, G3D, "Intra-buffer block transfer %08x -> %08x", srcBasePtr, dstBasePtr);
 				FlushBeforeCopy();
-				BlitFramebuffer(dstBuffer, dstX, dstY, srcBuffer, srcX, srcY, dstWidth, dstHeight, bpp);
+				const bool overlaps = srcX < dstX + dstWidth && dstX < srcX + dstWidth && srcY < dstY + dstHeight && dstY < srcY + dstHeight;
+				Draw::Framebuffer *tempFBO = nullptr;
+				if (overlaps) {
+					// Copies and blits within one image are undefined when the rects overlap, so bounce through a copy.
+					tempFBO = GetTempFBO(TempFBO::BLIT, srcBuffer->renderWidth, srcBuffer->renderHeight, (Draw::FBColorDepth)srcBuffer->colorDepth);
+				}
+				if (tempFBO) {
+					VirtualFramebuffer copyInfo = *srcBuffer;
+					copyInfo.fbo = tempFBO;
+					BlitFramebuffer(&copyInfo, srcX, srcY, srcBuffer, srcX, srcY, dstWidth, dstHeight, bpp);
+					BlitFramebuffer(dstBuffer, dstX, dstY, &copyInfo, srcX, srcY, dstWidth, dstHeight, bpp);
+				} else {
+					BlitFramebuffer(dstBuffer, dstX, dstY, srcBuffer, srcX, srcY, dstWidth, dstHeight, bpp);
+				}
 				RebindFramebuffer();
 				SetColorUpdated(dstBuffer, skipDrawReason);
 				return true;
@@ -1739,7 +1972,8 @@ void FramebufferManagerCommon::NotifyBlockTransferAfter(u32 dstBasePtr, int dstS
 				gstate_c.Dirty(DIRTY_VIEWPORTSCISSOR_STATE | DIRTY_CULLRANGE);
 			}
 			DrawPixels(dstBuffer, static_cast<int>(dstX * dstXFactor), dstY, srcBase, dstBuffer->format, static_cast<int>(srcStride * dstXFactor), static_cast<int>(dstWidth * dstXFactor), dstHeight);
-			SetColorUpdated(dstBuffer, skipDrawReason);
+			// The pixels came from RAM, so it's still in sync there.
+			SetColorUpdated(dstBuffer, skipDrawReason, 0, 0, 0, 0);
 			RebindFramebuffer();
 		}
 	}
@@ -2112,6 +2346,32 @@ void FramebufferManagerCommon::PackFramebufferSync_(VirtualFramebuffer *vfb, int
 	gpuStats.numReadbacks++;
 }
 
+void FramebufferManagerCommon::PackFramebufferAsync_(VirtualFramebuffer *vfb, int x, int y, int w, int h) {
+	if (!vfb->fbo || w <= 0 || h <= 0) {
+		PackFramebufferSync_(vfb, x, y, w, h);
+		return;
+	}
+
+	const u32 fb_address = vfb->fb_address & 0x3FFFFFFF;
+	Draw::DataFormat destFormat = GEFormatToThin3D(vfb->format);
+	const int dstBpp = (int)DataFormatSizeInBytes(destFormat);
+	const int dstByteOffset = (y * vfb->fb_stride + x) * dstBpp;
+	if (!Memory::IsValidRange(fb_address + dstByteOffset, ((h - 1) * vfb->fb_stride + w) * dstBpp)) {
+		ERROR_LOG(G3D, "PackFramebufferAsync_ would write outside of memory, ignoring");
+		return;
+	}
+
+	u8 *destPtr = Memory::GetPointer(fb_address + dstByteOffset);
+	if (!draw_->CopyFramebufferToMemoryAsync(vfb->fbo, Draw::FB_COLOR_BIT, x, y, w, h, destFormat, destPtr, vfb->fb_stride)) {
+		PackFramebufferSync_(vfb, x, y, w, h);
+		return;
+	}
+
+	// The readback ends the current render pass.
+	gstate_c.Dirty(DIRTY_VIEWPORTSCISSOR_STATE | DIRTY_BLEND_STATE | DIRTY_DEPTHSTENCIL_STATE | DIRTY_RASTER_STATE);
+	gpuStats.numReadbacks++;
+}
+
 void FramebufferManagerCommon::ReadFramebufferToMemory(VirtualFramebuffer *vfb, bool sync, int x, int y, int w, int h) {
 	// Clamp to bufferWidth. Sometimes block transfers can cause this to hit.
 	if (x + w >= vfb->bufferWidth) {
@@ -2120,12 +2380,28 @@ void FramebufferManagerCommon::ReadFramebufferToMemory(VirtualFramebuffer *vfb,
 	if (vfb && vfb->fbo) {
 		// We'll pseudo-blit framebuffers here to get a resized version of vfb.
 		OptimizeDownloadRange(vfb, x, y, w, h);
-		if (vfb->renderWidth == vfb->width && vfb->renderHeight == vfb->height) {
-			// No need to blit
-			PackFramebufferSync_(vfb, x, y, w, h);
-		} else {
-			VirtualFramebuffer *nvfb = FindDownloadTempBuffer(vfb);
+		// RAM is still up to date outside of what's been drawn since the last download.
+		if (!ClipDownloadToDirty(vfb, x, y, w, h))
+			return;
+		if (vfb->clearPending) {
+			// Nothing was drawn since the clear, so just fill in the clear color instead of reading back.
+			const u32 fb_address = vfb->fb_address & 0x3FFFFFFF;
+			const int bpp = vfb->format == GE_FORMAT_8888 ? 4 : 2;
+			if (Memory::IsValidRange(fb_address, ((y + h - 1) * vfb->fb_stride + x + w) * bpp)) {
+				ClearFramebufferMemory(Memory::GetPointerUnchecked(fb_address), vfb->fb_stride, vfb->format, x, y, x + w, y + h, vfb->clearColor);
+				return;
+			}
+		}
+		// Some games are fine with seeing results a frame late, which saves a GPU stall.
+		bool async = PSP_CoreParameter().compat.flags().AsyncFramebufferReadback;
+		VirtualFramebuffer *nvfb = vfb;
+		if (vfb->renderWidth != vfb->width || vfb->renderHeight != vfb->height) {
+			nvfb = FindDownloadTempBuffer(vfb);
 			BlitFramebuffer(nvfb, x, y, vfb, x, y, w, h, 0);
+		}
+		if (async) {
+			PackFramebufferAsync_(nvfb, x, y, w, h);
+		} else {
 			PackFramebufferSync_(nvfb, x, y, w, h);
 		}
 
@@ -2172,7 +2448,12 @@ void FramebufferManagerCommon::DownloadFramebufferForClut(u32 fb_address, u32 lo
 			VirtualFramebuffer *nvfb = FindDownloadTempBuffer(vfb);
 			BlitFramebuffer(nvfb, x, y, vfb, x, y, w, h, 0);
 
-			PackFramebufferSync_(nvfb, x, y, w, h);
+			if (PSP_CoreParameter().compat.flags().AsyncFramebufferReadback) {
+				// The CLUT will come from the previous readback this time around.
+				PackFramebufferAsync_(nvfb, x, y, w, h);
+			} else {
+				PackFramebufferSync_(nvfb, x, y, w, h);
+			}
 
 			textureCache_->ForgetLastTexture();
 			RebindFramebuffer();
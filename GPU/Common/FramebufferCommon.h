@@ -26,6 +26,7 @@
 #include "GPU/GPU.h"
 #include "GPU/ge_constants.h"
 #include "GPU/GPUInterface.h"
+#include "GPU/Common/PostShader.h"
 #include "thin3d/thin3d.h"
 
 enum {
@@ -64,6 +65,10 @@ struct PostShaderUniforms {
 };
 
 struct VirtualFramebuffer {
+	// Pooled, since some games create and destroy these every frame.
+	static void *operator new(size_t size);
+	static void operator delete(void *ptr);
+
 	int last_frame_used;
 	int last_frame_attached;
 	int last_frame_render;
@@ -116,6 +121,19 @@ struct VirtualFramebuffer {
 
 	bool dirtyAfterDisplay;
 	bool reallyDirtyAfterDisplay;  // takes frame skipping into account
+	// Bumped whenever the contents may have changed, so copies made from it know when they're stale.
+	u32 generation;
+
+	// Bounds (in PSP pixels) of what the GPU may have changed since RAM was last updated from it.
+	// Outside of these, RAM already matches, so downloads can skip it. Empty when dirtyX2 <= dirtyX1.
+	u16 dirtyX1;
+	u16 dirtyY1;
+	u16 dirtyX2;
+	u16 dirtyY2;
+
+	// Set by a whole buffer clear with nothing drawn since, so RAM can be filled with clearColor instead of read back.
+	bool clearPending;
+	u32 clearColor;
 };
 
 struct FramebufferHeuristicParams {
@@ -169,6 +187,9 @@ enum class TempFBO {
 	COPY,
 	// Used to copy stencil data, means we need a stencil backing.
 	STENCIL,
+	// Post shader pass targets, alternating so a pass never samples its own target.
+	POSTSHADER_EVEN,
+	POSTSHADER_ODD,
 };
 
 inline Draw::DataFormat GEFormatToThin3D(int geFormat) {
@@ -234,6 +255,8 @@ class FramebufferManagerCommon {
 	void NotifyVideoUpload(u32 addr, int size, int width, GEBufferFormat fmt);
 	void UpdateFromMemory(u32 addr, int size, bool safe);
 	void ApplyClearToMemory(int x1, int y1, int x2, int y2, u32 clearColor);
+	// Remembers the clear for the current flush, so later downloads can skip the readback.
+	void DeferClearToMemory(int x1, int y1, int x2, int y2, u32 clearColor);
 	virtual bool NotifyStencilUpload(u32 addr, int size, bool skipZero = false) = 0;
 	// Returns true if it's sure this is a direct FBO->FBO transfer and it has already handle it.
 	// In that case we hardly need to actually copy the bytes in VRAM, they will be wrong anyway (unless
@@ -303,11 +326,18 @@ class FramebufferManagerCommon {
 			SetColorUpdated(currentRenderVfb_, skipDrawReason);
 		}
 	}
+	// For draws, which can't touch anything outside the scissor.
+	void SetColorUpdatedInScissor(int skipDrawReason);
 	void SetRenderSize(VirtualFramebuffer *vfb);
 	void SetSafeSize(u16 w, u16 h);
 
 	virtual void Resized();
 
+	// Fraction of the configured render resolution in use, below 1 while dynamic resolution has scaled down.
+	float GetDynamicResolutionScale() const {
+		return dynamicResScale_;
+	}
+
 	Draw::Framebuffer *GetTempFBO(TempFBO reason, u16 w, u16 h, Draw::FBColorDepth colorDepth = Draw::FBO_8888);
 
 	// Debug features
@@ -318,21 +348,29 @@ class FramebufferManagerCommon {
 
 protected:
 	virtual void PackFramebufferSync_(VirtualFramebuffer *vfb, int x, int y, int w, int h);
+	// Falls back to PackFramebufferSync_ where the backend can't do it.
+	void PackFramebufferAsync_(VirtualFramebuffer *vfb, int x, int y, int w, int h);
 	virtual void SetViewport2D(int x, int y, int w, int h);
 	void CalculatePostShaderUniforms(int bufferWidth, int bufferHeight, int renderWidth, int renderHeight, PostShaderUniforms *uniforms);
 	virtual void MakePixelTexture(const u8 *srcPixels, GEBufferFormat srcPixelFormat, int srcStride, int width, int height, float &u1, float &v1) = 0;
 	virtual void DrawActiveTexture(float x, float y, float w, float h, float destW, float destH, float u0, float v0, float u1, float v1, int uvRotation, int flags) = 0;
 	virtual void Bind2DShader() = 0;
-	virtual void BindPostShader(const PostShaderUniforms &uniforms) = 0;
+	// pass indexes postShaderChain_.
+	virtual void BindPostShader(const PostShaderUniforms &uniforms, int pass) = 0;
 
 	// Cardboard Settings Calculator
 	void GetCardboardSettings(CardboardSettings *cardboardSettings);
 
 	bool UpdateSize();
-	void SetNumExtraFBOs(int num);
+	// Steps the render scale towards what the measured GPU time allows. Called between frames.
+	void UpdateDynamicResolution();
+	void SetDynamicResolutionScale(float scale);
+	// Fills postShaderChain_ from the configured shader. Backends compile one program per entry.
+	void LoadPostShaderChain();
 
 	void FlushBeforeCopy();
 	virtual void DecimateFBOs();  // keeping it virtual to let D3D do a little extra
+	void ReportMemoryUsage();
 
 	// Used by ReadFramebufferToMemory and later framebuffer block copies
 	virtual void BlitFramebuffer(VirtualFramebuffer *dst, int dstX, int dstY, VirtualFramebuffer *src, int srcX, int srcY, int w, int h, int bpp) = 0;
@@ -362,14 +400,24 @@ class FramebufferManagerCommon {
 	void OptimizeDownloadRange(VirtualFramebuffer *vfb, int &x, int &y, int &w, int &h);
 
 	void UpdateFramebufUsage(VirtualFramebuffer *vfb);
+	static void AddDirtyRect(VirtualFramebuffer *vfb, int x1, int y1, int x2, int y2);
+	// Narrows a download to what the GPU has changed. Returns false if there's nothing to download.
+	bool ClipDownloadToDirty(VirtualFramebuffer *vfb, int &x, int &y, int &w, int &h);
 
 	void SetColorUpdated(VirtualFramebuffer *dstBuffer, int skipDrawReason) {
+		SetColorUpdated(dstBuffer, skipDrawReason, 0, 0, dstBuffer->bufferWidth, dstBuffer->bufferHeight);
+	}
+	// x2/y2 are exclusive. Pass an empty rect when the change came from RAM (uploads.)
+	void SetColorUpdated(VirtualFramebuffer *dstBuffer, int skipDrawReason, int x1, int y1, int x2, int y2) {
+		AddDirtyRect(dstBuffer, x1, y1, x2, y2);
+		dstBuffer->clearPending = false;
 		dstBuffer->memoryUpdated = false;
 		dstBuffer->clutUpdatedBytes = 0;
 		dstBuffer->dirtyAfterDisplay = true;
 		dstBuffer->drawnWidth = dstBuffer->width;
 		dstBuffer->drawnHeight = dstBuffer->height;
 		dstBuffer->drawnFormat = dstBuffer->format;
+		dstBuffer->generation++;
 		if ((skipDrawReason & SKIPDRAW_SKIPFRAME) == 0)
 			dstBuffer->reallyDirtyAfterDisplay = true;
 	}
@@ -405,6 +453,10 @@ class FramebufferManagerCommon {
 
 	bool gameUsesSequentialCopies_ = false;
 
+	// From DeferClearToMemory, applied to the framebuffer once the flush completes.
+	bool flushClearPending_ = false;
+	u32 flushClearColor_ = 0;
+
 	// Sampled in BeginFrame for safety.
 	float renderWidth_ = 0.0f;
 	float renderHeight_ = 0.0f;
@@ -412,8 +464,15 @@ class FramebufferManagerCommon {
 	int pixelHeight_;
 	int bloomHack_ = 0;
 
-	// Used by post-processing shaders
-	std::vector<Draw::Framebuffer *> extraFBOs_;
+	// Dynamic resolution, multiplies the configured render size.
+	float dynamicResScale_ = 1.0f;
+	int dynamicResOverBudget_ = 0;
+	int dynamicResUnderBudget_ = 0;
+	int dynamicResCooldown_ = 0;
+	bool dynamicResProfiling_ = false;
+
+	// Used by post-processing shaders, targets come from the temp FBO pool.
+	std::vector<ShaderInfo> postShaderChain_;
 
 	bool needGLESRebinds_ = false;
 
@@ -431,6 +490,14 @@ class FramebufferManagerCommon {
 		FBO_OLD_AGE = 5,
 		FBO_OLD_USAGE_FLAG = 15,
 	};
+
+	// Frames in a row over (or comfortably under) budget before stepping, and frames to wait after.
+	// Stepping up needs much longer, so that a scene on the edge doesn't flip back and forth.
+	enum {
+		DYNRES_DOWN_FRAMES = 10,
+		DYNRES_UP_FRAMES = 120,
+		DYNRES_COOLDOWN_FRAMES = 30,
+	};
 };
 
 void CenterDisplayOutputRect(float *x, float *y, float *w, float *h, float origW, float origH, float frameW, float frameH, int rotation);
@@ -16,10 +16,23 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <cstring>
+
+#include "ppsspp_config.h"
 #include "IndexGenerator.h"
 
 #include "Common/Common.h"
 
+#if defined(_M_SSE)
+#include <emmintrin.h>
+#endif
+#if PPSSPP_ARCH(ARM_NEON)
+#if defined(_MSC_VER) && PPSSPP_ARCH(ARM64)
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+#endif
+
 // Points don't need indexing...
 const u8 IndexGenerator::indexedPrimitiveType[7] = {
 	GE_PRIM_POINTS,
@@ -31,6 +44,57 @@ const u8 IndexGenerator::indexedPrimitiveType[7] = {
 	GE_PRIM_RECTANGLES,
 };
 
+enum {
+	// Strips, fans and lists repeat with a period of 2 or 1 triangles, so 8 triangles fill three vectors.
+	INDEX_GROUP_TRIS = 8,
+	INDEX_GROUP_SIZE = INDEX_GROUP_TRIS * 3,
+};
+
+// Writes groups of INDEX_GROUP_SIZE indices. Each group is the previous one plus inc, lane by lane.
+// Wraps around exactly like the scalar u16 math does.
+static u16 *GenerateIndexGroups(u16 *outInds, const u16 pattern[INDEX_GROUP_SIZE], const u16 inc[INDEX_GROUP_SIZE], int groups) {
+#if defined(_M_SSE)
+	__m128i p0 = _mm_loadu_si128((const __m128i *)pattern);
+	__m128i p1 = _mm_loadu_si128((const __m128i *)(pattern + 8));
+	__m128i p2 = _mm_loadu_si128((const __m128i *)(pattern + 16));
+	const __m128i i0 = _mm_loadu_si128((const __m128i *)inc);
+	const __m128i i1 = _mm_loadu_si128((const __m128i *)(inc + 8));
+	const __m128i i2 = _mm_loadu_si128((const __m128i *)(inc + 16));
+	for (int g = 0; g < groups; g++) {
+		_mm_storeu_si128((__m128i *)outInds, p0);
+		_mm_storeu_si128((__m128i *)(outInds + 8), p1);
+		_mm_storeu_si128((__m128i *)(outInds + 16), p2);
+		p0 = _mm_add_epi16(p0, i0);
+		p1 = _mm_add_epi16(p1, i1);
+		p2 = _mm_add_epi16(p2, i2);
+		outInds += INDEX_GROUP_SIZE;
+	}
+#elif PPSSPP_ARCH(ARM_NEON)
+	uint16x8_t p0 = vld1q_u16(pattern);
+	uint16x8_t p1 = vld1q_u16(pattern + 8);
+	uint16x8_t p2 = vld1q_u16(pattern + 16);
+	const uint16x8_t i0 = vld1q_u16(inc);
+	const uint16x8_t i1 = vld1q_u16(inc + 8);
+	const uint16x8_t i2 = vld1q_u16(inc + 16);
+	for (int g = 0; g < groups; g++) {
+		vst1q_u16(outInds, p0);
+		vst1q_u16(outInds + 8, p1);
+		vst1q_u16(outInds + 16, p2);
+		p0 = vaddq_u16(p0, i0);
+		p1 = vaddq_u16(p1, i1);
+		p2 = vaddq_u16(p2, i2);
+		outInds += INDEX_GROUP_SIZE;
+	}
+#else
+	for (int g = 0; g < groups; g++) {
+		for (int i = 0; i < INDEX_GROUP_SIZE; i++) {
+			*outInds++ = pattern[i] + g * inc[i];
+		}
+	}
+#endif
+	return outInds;
+}
+
 void IndexGenerator::Setup(u16 *inds) {
 	this->indsBase_ = inds;
 	Reset();
@@ -66,7 +130,23 @@ void IndexGenerator::AddList(int numVerts, bool clockwise) {
 	const int startIndex = index_;
 	const int v1 = clockwise ? 1 : 2;
 	const int v2 = clockwise ? 2 : 1;
-	for (int i = 0; i < numVerts; i += 3) {
+	int i = 0;
+	const int groups = numVerts / INDEX_GROUP_SIZE;
+	if (groups > 0) {
+		u16 pattern[INDEX_GROUP_SIZE];
+		u16 inc[INDEX_GROUP_SIZE];
+		for (int t = 0; t < INDEX_GROUP_TRIS; t++) {
+			pattern[t * 3 + 0] = startIndex + t * 3;
+			pattern[t * 3 + 1] = startIndex + t * 3 + v1;
+			pattern[t * 3 + 2] = startIndex + t * 3 + v2;
+		}
+		for (int j = 0; j < INDEX_GROUP_SIZE; j++) {
+			inc[j] = INDEX_GROUP_SIZE;
+		}
+		outInds = GenerateIndexGroups(outInds, pattern, inc, groups);
+		i = groups * INDEX_GROUP_SIZE;
+	}
+	for (; i < numVerts; i += 3) {
 		*outInds++ = startIndex + i;
 		*outInds++ = startIndex + i + v1;
 		*outInds++ = startIndex + i + v2;
@@ -88,7 +168,27 @@ void IndexGenerator::AddStrip(int numVerts, bool clockwise) {
 	const int numTris = numVerts - 2;
 	u16 *outInds = inds_;
 	int ibase = index_;
-	for (int i = 0; i < numTris; i++) {
+	int i = 0;
+	const int groups = numTris / INDEX_GROUP_TRIS;
+	if (groups > 0) {
+		// The winding alternates, so a group of an even number of triangles ends where it started.
+		u16 pattern[INDEX_GROUP_SIZE];
+		u16 inc[INDEX_GROUP_SIZE];
+		int w = wind;
+		for (int t = 0; t < INDEX_GROUP_TRIS; t++) {
+			pattern[t * 3 + 0] = ibase + t;
+			pattern[t * 3 + 1] = ibase + t + w;
+			w ^= 3;
+			pattern[t * 3 + 2] = ibase + t + w;
+		}
+		for (int j = 0; j < INDEX_GROUP_SIZE; j++) {
+			inc[j] = INDEX_GROUP_TRIS;
+		}
+		outInds = GenerateIndexGroups(outInds, pattern, inc, groups);
+		i = groups * INDEX_GROUP_TRIS;
+		ibase += i;
+	}
+	for (; i < numTris; i++) {
 		*outInds++ = ibase;
 		*outInds++ = ibase + wind;
 		wind ^= 3;  // toggle between 1 and 2
@@ -117,7 +217,24 @@ void IndexGenerator::AddFan(int numVerts, bool clockwise) {
 	const int startIndex = index_;
 	const int v1 = clockwise ? 1 : 2;
 	const int v2 = clockwise ? 2 : 1;
-	for (int i = 0; i < numTris; i++) {
+	int i = 0;
+	const int groups = numTris / INDEX_GROUP_TRIS;
+	if (groups > 0) {
+		// The center vertex stays put, only the outer two move along.
+		u16 pattern[INDEX_GROUP_SIZE];
+		u16 inc[INDEX_GROUP_SIZE];
+		for (int t = 0; t < INDEX_GROUP_TRIS; t++) {
+			pattern[t * 3 + 0] = startIndex;
+			pattern[t * 3 + 1] = startIndex + t + v1;
+			pattern[t * 3 + 2] = startIndex + t + v2;
+			inc[t * 3 + 0] = 0;
+			inc[t * 3 + 1] = INDEX_GROUP_TRIS;
+			inc[t * 3 + 2] = INDEX_GROUP_TRIS;
+		}
+		outInds = GenerateIndexGroups(outInds, pattern, inc, groups);
+		i = groups * INDEX_GROUP_TRIS;
+	}
+	for (; i < numTris; i++) {
 		*outInds++ = startIndex;
 		*outInds++ = startIndex + i + v1;
 		*outInds++ = startIndex + i + v2;
@@ -44,6 +44,8 @@ void LoadPostShaderInfo(std::vector<std::string> directories) {
 	off.isUpscalingFilter = false;
 	off.SSAAFilterLevel = 0;
 	off.requires60fps = false;
+	off.scale = 1.0f;
+	off.colorDepth = Draw::FBO_8888;
 	shaderInfo.push_back(off);
 
 	for (size_t d = 0; d < directories.size(); d++) {
@@ -90,6 +92,19 @@ void LoadPostShaderInfo(std::vector<std::string> directories) {
 					section.Get("Upscaling", &info.isUpscalingFilter, false);
 					section.Get("SSAA", &info.SSAAFilterLevel, 0);
 					section.Get("60fps", &info.requires60fps, false);
+					section.Get("Scale", &info.scale, 1.0f);
+					if (info.scale <= 0.0f || info.scale > 4.0f)
+						info.scale = 1.0f;
+					section.Get("Format", &temp, "8888");
+					if (temp == "565")
+						info.colorDepth = Draw::FBO_565;
+					else if (temp == "5551")
+						info.colorDepth = Draw::FBO_5551;
+					else if (temp == "4444")
+						info.colorDepth = Draw::FBO_4444;
+					else
+						info.colorDepth = Draw::FBO_8888;
+					section.Get("Next", &info.next, "");
 
 					// Let's ignore shaders we can't support. TODO: Not a very good check
 					if (gl_extensions.IsGLES && !gl_extensions.GLES3) {
@@ -126,6 +141,18 @@ const ShaderInfo *GetPostShaderInfo(std::string name) {
 	return nullptr;
 }
 
+std::vector<const ShaderInfo *> GetPostShaderChain(const std::string &name) {
+	std::vector<const ShaderInfo *> chain;
+	const ShaderInfo *info = GetPostShaderInfo(name);
+	while (info && chain.size() < MAX_POST_SHADER_PASSES) {
+		if (std::find(chain.begin(), chain.end(), info) != chain.end())
+			break;
+		chain.push_back(info);
+		info = info->next.empty() ? nullptr : GetPostShaderInfo(info->next);
+	}
+	return chain;
+}
+
 const std::vector<ShaderInfo> &GetAllPostShaderInfo() {
 	return shaderInfo;
 }
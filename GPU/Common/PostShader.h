@@ -16,6 +16,8 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 
+#pragma once
+
 // Postprocessing shader manager
 // For FXAA, "Natural", bloom, B&W, cross processing and whatnot.
 
@@ -23,6 +25,10 @@
 #include <vector>
 
 #include "file/ini_file.h"
+#include "thin3d/thin3d.h"
+
+// Longest chain of shaders we'll follow through Next.
+enum { MAX_POST_SHADER_PASSES = 8 };
 
 struct ShaderInfo {
 	std::string iniFile;  // which ini file was this definition in? So we can write settings back later
@@ -40,9 +46,15 @@ struct ShaderInfo {
 	int SSAAFilterLevel;
 	// Force constant/max refresh for animated filters
 	bool requires60fps;
+	// Size of this pass' target relative to the render resolution, e.g. 0.5 for a bloom pass.
+	float scale;
+	// Color depth of this pass' target. Lower precision is cheaper when it's enough.
+	Draw::FBColorDepth colorDepth;
+	// Section of the shader to run on our output, if any.
+	std::string next;
 
 	// TODO: Add support for all kinds of fun options like mapping the depth buffer,
-	// SRGB texture reads, multiple shaders chained, etc.
+	// SRGB texture reads, etc.
 
 	bool operator == (const std::string &other) {
 		return name == other;
@@ -55,4 +67,6 @@ struct ShaderInfo {
 void ReloadAllPostShaderInfo();
 
 const ShaderInfo *GetPostShaderInfo(std::string name);
+// Follows Next from the named shader. Empty if it doesn't exist.
+std::vector<const ShaderInfo *> GetPostShaderChain(const std::string &name);
 const std::vector<ShaderInfo> &GetAllPostShaderInfo();
@@ -0,0 +1,478 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+
+#include "Common/Log.h"
+#include "GPU/Common/ScalingShaderCommon.h"
+#include "GPU/Common/TextureScalerCommon.h"
+
+// The functions below are written in GLSL, and these make them valid HLSL.
+static const char *hlslPrelude = R"(
+#define vec2 float2
+#define vec3 float3
+#define vec4 float4
+#define ivec2 int2
+#define ivec4 int4
+#define uvec2 uint2
+#define uvec4 uint4
+#define mix lerp
+#define fract frac
+)";
+
+static const char *readClampedCode = R"(
+ivec2 srcSize() {
+	return ivec2(params.width / params.scale, params.height / params.scale);
+}
+
+vec4 readClampedi(ivec2 p) {
+	ivec2 size = srcSize();
+	return readColorf(uvec2(uint(clamp(p.x, 0, size.x - 1)), uint(clamp(p.y, 0, size.y - 1))));
+}
+
+// Coordinates may have wrapped around below zero.
+vec4 readClamped(uvec2 p) {
+	return readClampedi(ivec2(int(p.x), int(p.y)));
+}
+)";
+
+// 4xBRZ shader - Copyright (C) 2014-2016 DeSmuME team (GPL2+)
+// Hyllian's xBR-vertex code and texel mapping
+// Copyright (C) 2011/2016 Hyllian - sergiogdb@gmail.com
+// TODO: Handles alpha badly for PSP.
+static const char *xbrzCode = R"(
+vec4 premultiply_alpha(vec4 c) { float a = clamp(c.a, 0.0, 1.0); return vec4(c.rgb * a, a); }
+vec4 postdivide_alpha(vec4 c) { return c.a < 0.001? vec4(0.0,0.0,0.0,0.0) : vec4(c.rgb / c.a, c.a); }
+
+#define BLEND_ALPHA 1
+#define BLEND_NONE 0
+#define BLEND_NORMAL 1
+#define BLEND_DOMINANT 2
+#define LUMINANCE_WEIGHT 1.0
+#define EQUAL_COLOR_TOLERANCE 30.0/255.0
+#define STEEP_DIRECTION_THRESHOLD 2.2
+#define DOMINANT_DIRECTION_THRESHOLD 3.6
+
+float reduce(vec4 color) {
+	return dot(color.rgb, vec3(65536.0, 256.0, 1.0));
+}
+
+float DistYCbCr(vec4 pixA, vec4 pixB) {
+	const vec3 w = vec3(0.2627, 0.6780, 0.0593);
+	const float scaleB = 0.5 / (1.0 - w.b);
+	const float scaleR = 0.5 / (1.0 - w.r);
+	vec4 diff = pixA - pixB;
+	float Y = dot(diff.rgb, w);
+	float Cb = scaleB * (diff.b - Y);
+	float Cr = scaleR * (diff.r - Y);
+
+	return sqrt( ((LUMINANCE_WEIGHT * Y) * (LUMINANCE_WEIGHT * Y)) + (Cb * Cb) + (Cr * Cr) + (diff.a * diff.a));
+}
+
+bool IsPixEqual(vec4 pixA, vec4 pixB) {
+	return (DistYCbCr(pixA, pixB) < EQUAL_COLOR_TOLERANCE);
+}
+
+bool IsBlendingNeeded(ivec4 blend) {
+	ivec4 diff = blend - ivec4(BLEND_NONE, BLEND_NONE, BLEND_NONE, BLEND_NONE);
+	return diff.x != 0 || diff.y != 0 || diff.z != 0 || diff.w != 0;
+}
+
+vec4 scaleXBRZ(uvec2 origxy, uvec2 xy) {
+	//    A1 B1 C1
+	// A0 A  B  C C4
+	// D0 D  E  F F4
+	// G0 G  H  I I4
+	//    G5 H5 I5
+
+	uvec4 t1 = uvec4(origxy.x - 1, origxy.x, origxy.x + 1, origxy.y - 2); // A1 B1 C1
+	uvec4 t2 = uvec4(origxy.x - 1, origxy.x, origxy.x + 1, origxy.y - 1); // A B C
+	uvec4 t3 = uvec4(origxy.x - 1, origxy.x, origxy.x + 1, origxy.y + 0); // D E F
+	uvec4 t4 = uvec4(origxy.x - 1, origxy.x, origxy.x + 1, origxy.y + 1); // G H I
+	uvec4 t5 = uvec4(origxy.x - 1, origxy.x, origxy.x + 1, origxy.y + 2); // G5 H5 I5
+	uvec4 t6 = uvec4(origxy.x - 2, origxy.y - 1, origxy.y, origxy.y + 1); // A0 D0 G0
+	uvec4 t7 = uvec4(origxy.x + 2, origxy.y - 1, origxy.y, origxy.y + 1); // C4 F4 I4
+
+	vec2 f = fract(vec2(float(xy.x) / float(params.scale), float(xy.y) / float(params.scale)));
+
+	//---------------------------------------
+	// Input Pixel Mapping:    |21|22|23|
+	//                       19|06|07|08|09
+	//                       18|05|00|01|10
+	//                       17|04|03|02|11
+	//                         |15|14|13|
+
+	vec4 src[25];
+
+	src[21] = premultiply_alpha(readClamped(t1.xw));
+	src[22] = premultiply_alpha(readClamped(t1.yw));
+	src[23] = premultiply_alpha(readClamped(t1.zw));
+	src[ 6] = premultiply_alpha(readClamped(t2.xw));
+	src[ 7] = premultiply_alpha(readClamped(t2.yw));
+	src[ 8] = premultiply_alpha(readClamped(t2.zw));
+	src[ 5] = premultiply_alpha(readClamped(t3.xw));
+	src[ 0] = premultiply_alpha(readClamped(t3.yw));
+	src[ 1] = premultiply_alpha(readClamped(t3.zw));
+	src[ 4] = premultiply_alpha(readClamped(t4.xw));
+	src[ 3] = premultiply_alpha(readClamped(t4.yw));
+	src[ 2] = premultiply_alpha(readClamped(t4.zw));
+	src[15] = premultiply_alpha(readClamped(t5.xw));
+	src[14] = premultiply_alpha(readClamped(t5.yw));
+	src[13] = premultiply_alpha(readClamped(t5.zw));
+	src[19] = premultiply_alpha(readClamped(t6.xy));
+	src[18] = premultiply_alpha(readClamped(t6.xz));
+	src[17] = premultiply_alpha(readClamped(t6.xw));
+	src[ 9] = premultiply_alpha(readClamped(t7.xy));
+	src[10] = premultiply_alpha(readClamped(t7.xz));
+	src[11] = premultiply_alpha(readClamped(t7.xw));
+
+	float v[9];
+	v[0] = reduce(src[0]);
+	v[1] = reduce(src[1]);
+	v[2] = reduce(src[2]);
+	v[3] = reduce(src[3]);
+	v[4] = reduce(src[4]);
+	v[5] = reduce(src[5]);
+	v[6] = reduce(src[6]);
+	v[7] = reduce(src[7]);
+	v[8] = reduce(src[8]);
+
+	ivec4 blendResult = ivec4(BLEND_NONE, BLEND_NONE, BLEND_NONE, BLEND_NONE);
+
+	// Preprocess corners
+	// Pixel Tap Mapping: --|--|--|--|--
+	//                    --|--|07|08|--
+	//                    --|05|00|01|10
+	//                    --|04|03|02|11
+	//                    --|--|14|13|--
+	// Corner (1, 1)
+	if ( ((v[0] == v[1] && v[3] == v[2]) || (v[0] == v[3] && v[1] == v[2])) == false) {
+		float dist_03_01 = DistYCbCr(src[ 4], src[ 0]) + DistYCbCr(src[ 0], src[ 8]) + DistYCbCr(src[14], src[ 2]) + DistYCbCr(src[ 2], src[10]) + (4.0 * DistYCbCr(src[ 3], src[ 1]));
+		float dist_00_02 = DistYCbCr(src[ 5], src[ 3]) + DistYCbCr(src[ 3], src[13]) + DistYCbCr(src[ 7], src[ 1]) + DistYCbCr(src[ 1], src[11]) + (4.0 * DistYCbCr(src[ 0], src[ 2]));
+		bool dominantGradient = (DOMINANT_DIRECTION_THRESHOLD * dist_03_01) < dist_00_02;
+		blendResult[2] = ((dist_03_01 < dist_00_02) && (v[0] != v[1]) && (v[0] != v[3])) ? ((dominantGradient) ? BLEND_DOMINANT : BLEND_NORMAL) : BLEND_NONE;
+	}
+
+	// Pixel Tap Mapping: --|--|--|--|--
+	//                    --|06|07|--|--
+	//                    18|05|00|01|--
+	//                    17|04|03|02|--
+	//                    --|15|14|--|--
+	// Corner (0, 1)
+	if ( ((v[5] == v[0] && v[4] == v[3]) || (v[5] == v[4] && v[0] == v[3])) == false) {
+		float dist_04_00 = DistYCbCr(src[17], src[ 5]) + DistYCbCr(src[ 5], src[ 7]) + DistYCbCr(src[15], src[ 3]) + DistYCbCr(src[ 3], src[ 1]) + (4.0 * DistYCbCr(src[ 4], src[ 0]));
+		float dist_05_03 = DistYCbCr(src[18], src[ 4]) + DistYCbCr(src[ 4], src[14]) + DistYCbCr(src[ 6], src[ 0]) + DistYCbCr(src[ 0], src[ 2]) + (4.0 * DistYCbCr(src[ 5], src[ 3]));
+		bool dominantGradient = (DOMINANT_DIRECTION_THRESHOLD * dist_05_03) < dist_04_00;
+		blendResult[3] = ((dist_04_00 > dist_05_03) && (v[0] != v[5]) && (v[0] != v[3])) ? ((dominantGradient) ? BLEND_DOMINANT : BLEND_NORMAL) : BLEND_NONE;
+	}
+
+	// Pixel Tap Mapping: --|--|22|23|--
+	//                    --|06|07|08|09
+	//                    --|05|00|01|10
+	//                    --|--|03|02|--
+	//                    --|--|--|--|--
+	// Corner (1, 0)
+	if ( ((v[7] == v[8] && v[0] == v[1]) || (v[7] == v[0] && v[8] == v[1])) == false) {
+		float dist_00_08 = DistYCbCr(src[ 5], src[ 7]) + DistYCbCr(src[ 7], src[23]) + DistYCbCr(src[ 3], src[ 1]) + DistYCbCr(src[ 1], src[ 9]) + (4.0 * DistYCbCr(src[ 0], src[ 8]));
+		float dist_07_01 = DistYCbCr(src[ 6], src[ 0]) + DistYCbCr(src[ 0], src[ 2]) + DistYCbCr(src[22], src[ 8]) + DistYCbCr(src[ 8], src[10]) + (4.0 * DistYCbCr(src[ 7], src[ 1]));
+		bool dominantGradient = (DOMINANT_DIRECTION_THRESHOLD * dist_07_01) < dist_00_08;
+		blendResult[1] = ((dist_00_08 > dist_07_01) && (v[0] != v[7]) && (v[0] != v[1])) ? ((dominantGradient) ? BLEND_DOMINANT : BLEND_NORMAL) : BLEND_NONE;
+	}
+
+	// Pixel Tap Mapping: --|21|22|--|--
+	//                    19|06|07|08|--
+	//                    18|05|00|01|--
+	//                    --|04|03|--|--
+	//                    --|--|--|--|--
+	// Corner (0, 0)
+	if ( ((v[6] == v[7] && v[5] == v[0]) || (v[6] == v[5] && v[7] == v[0])) == false) {
+		float dist_05_07 = DistYCbCr(src[18], src[ 6]) + DistYCbCr(src[ 6], src[22]) + DistYCbCr(src[ 4], src[ 0]) + DistYCbCr(src[ 0], src[ 8]) + (4.0 * DistYCbCr(src[ 5], src[ 7]));
+		float dist_06_00 = DistYCbCr(src[19], src[ 5]) + DistYCbCr(src[ 5], src[ 3]) + DistYCbCr(src[21], src[ 7]) + DistYCbCr(src[ 7], src[ 1]) + (4.0 * DistYCbCr(src[ 6], src[ 0]));
+		bool dominantGradient = (DOMINANT_DIRECTION_THRESHOLD * dist_05_07) < dist_06_00;
+		blendResult[0] = ((dist_05_07 < dist_06_00) && (v[0] != v[5]) && (v[0] != v[7])) ? ((dominantGradient) ? BLEND_DOMINANT : BLEND_NORMAL) : BLEND_NONE;
+	}
+
+	vec4 dst[16];
+	dst[ 0] = src[0];
+	dst[ 1] = src[0];
+	dst[ 2] = src[0];
+	dst[ 3] = src[0];
+	dst[ 4] = src[0];
+	dst[ 5] = src[0];
+	dst[ 6] = src[0];
+	dst[ 7] = src[0];
+	dst[ 8] = src[0];
+	dst[ 9] = src[0];
+	dst[10] = src[0];
+	dst[11] = src[0];
+	dst[12] = src[0];
+	dst[13] = src[0];
+	dst[14] = src[0];
+	dst[15] = src[0];
+
+	// Scale pixel
+	if (IsBlendingNeeded(blendResult) == true) {
+		float dist_01_04 = DistYCbCr(src[1], src[4]);
+		float dist_03_08 = DistYCbCr(src[3], src[8]);
+		bool haveShallowLine = (STEEP_DIRECTION_THRESHOLD * dist_01_04 <= dist_03_08) && (v[0] != v[4]) && (v[5] != v[4]);
+		bool haveSteepLine   = (STEEP_DIRECTION_THRESHOLD * dist_03_08 <= dist_01_04) && (v[0] != v[8]) && (v[7] != v[8]);
+		bool needBlend = (blendResult[2] != BLEND_NONE);
+		bool doLineBlend = (  blendResult[2] >= BLEND_DOMINANT ||
+			((blendResult[1] != BLEND_NONE && !IsPixEqual(src[0], src[4])) ||
+			(blendResult[3] != BLEND_NONE && !IsPixEqual(src[0], src[8])) ||
+			(IsPixEqual(src[4], src[3]) && IsPixEqual(src[3], src[2]) && IsPixEqual(src[2], src[1]) && IsPixEqual(src[1], src[8]) && IsPixEqual(src[0], src[2]) == false) ) == false );
+
+		vec4 blendPix = ( DistYCbCr(src[0], src[1]) <= DistYCbCr(src[0], src[3]) ) ? src[1] : src[3];
+		dst[ 2] = mix(dst[ 2], blendPix, (needBlend && doLineBlend) ? ((haveShallowLine) ? ((haveSteepLine) ? 1.0/3.0 : 0.25) : ((haveSteepLine) ? 0.25 : 0.00)) : 0.00);
+		dst[ 9] = mix(dst[ 9], blendPix, (needBlend && doLineBlend && haveSteepLine) ? 0.25 : 0.00);
+		dst[10] = mix(dst[10], blendPix, (needBlend && doLineBlend && haveSteepLine) ? 0.75 : 0.00);
+		dst[11] = mix(dst[11], blendPix, (needBlend) ? ((doLineBlend) ? ((haveSteepLine) ? 1.00 : ((haveShallowLine) ? 0.75 : 0.50)) : 0.08677704501) : 0.00);
+		dst[12] = mix(dst[12], blendPix, (needBlend) ? ((doLineBlend) ? 1.00 : 0.6848532563) : 0.00);
+		dst[13] = mix(dst[13], blendPix, (needBlend) ? ((doLineBlend) ? ((haveShallowLine) ? 1.00 : ((haveSteepLine) ? 0.75 : 0.50)) : 0.08677704501) : 0.00);
+		dst[14] = mix(dst[14], blendPix, (needBlend && doLineBlend && haveShallowLine) ? 0.75 : 0.00);
+		dst[15] = mix(dst[15], blendPix, (needBlend && doLineBlend && haveShallowLine) ? 0.25 : 0.00);
+
+		dist_01_04 = DistYCbCr(src[7], src[2]);
+		dist_03_08 = DistYCbCr(src[1], src[6]);
+		haveShallowLine = (STEEP_DIRECTION_THRESHOLD * dist_01_04 <= dist_03_08) && (v[0] != v[2]) && (v[3] != v[2]);
+		haveSteepLine   = (STEEP_DIRECTION_THRESHOLD * dist_03_08 <= dist_01_04) && (v[0] != v[6]) && (v[5] != v[6]);
+		needBlend = (blendResult[1] != BLEND_NONE);
+		doLineBlend = (  blendResult[1] >= BLEND_DOMINANT ||
+			!((blendResult[0] != BLEND_NONE && !IsPixEqual(src[0], src[2])) ||
+			(blendResult[2] != BLEND_NONE && !IsPixEqual(src[0], src[6])) ||
+			(IsPixEqual(src[2], src[1]) && IsPixEqual(src[1], src[8]) && IsPixEqual(src[8], src[7]) && IsPixEqual(src[7], src[6]) && !IsPixEqual(src[0], src[8])) ) );
+
+		blendPix = ( DistYCbCr(src[0], src[7]) <= DistYCbCr(src[0], src[1]) ) ? src[7] : src[1];
+		dst[ 1] = mix(dst[ 1], blendPix, (needBlend && doLineBlend) ? ((haveShallowLine) ? ((haveSteepLine) ? 1.0/3.0 : 0.25) : ((haveSteepLine) ? 0.25 : 0.00)) : 0.00);
+		dst[ 6] = mix(dst[ 6], blendPix, (needBlend && doLineBlend && haveSteepLine) ? 0.25 : 0.00);
+		dst[ 7] = mix(dst[ 7], blendPix, (needBlend && doLineBlend && haveSteepLine) ? 0.75 : 0.00);
+		dst[ 8] = mix(dst[ 8], blendPix, (needBlend) ? ((doLineBlend) ? ((haveSteepLine) ? 1.00 : ((haveShallowLine) ? 0.75 : 0.50)) : 0.08677704501) : 0.00);
+		dst[ 9] = mix(dst[ 9], blendPix, (needBlend) ? ((doLineBlend) ? 1.00 : 0.6848532563) : 0.00);
+		dst[10] = mix(dst[10], blendPix, (needBlend) ? ((doLineBlend) ? ((haveShallowLine) ? 1.00 : ((haveSteepLine) ? 0.75 : 0.50)) : 0.08677704501) : 0.00);
+		dst[11] = mix(dst[11], blendPix, (needBlend && doLineBlend && haveShallowLine) ? 0.75 : 0.00);
+		dst[12] = mix(dst[12], blendPix, (needBlend && doLineBlend && haveShallowLine) ? 0.25 : 0.00);
+
+		dist_01_04 = DistYCbCr(src[5], src[8]);
+		dist_03_08 = DistYCbCr(src[7], src[4]);
+		haveShallowLine = (STEEP_DIRECTION_THRESHOLD * dist_01_04 <= dist_03_08) && (v[0] != v[8]) && (v[1] != v[8]);
+		haveSteepLine   = (STEEP_DIRECTION_THRESHOLD * dist_03_08 <= dist_01_04) && (v[0] != v[4]) && (v[3] != v[4]);
+		needBlend = (blendResult[0] != BLEND_NONE);
+		doLineBlend = (  blendResult[0] >= BLEND_DOMINANT ||
+			!((blendResult[3] != BLEND_NONE && !IsPixEqual(src[0], src[8])) ||
+			(blendResult[1] != BLEND_NONE && !IsPixEqual(src[0], src[4])) ||
+			(IsPixEqual(src[8], src[7]) && IsPixEqual(src[7], src[6]) && IsPixEqual(src[6], src[5]) && IsPixEqual(src[5], src[4]) && !IsPixEqual(src[0], src[6])) ) );
+
+		blendPix = ( DistYCbCr(src[0], src[5]) <= DistYCbCr(src[0], src[7]) ) ? src[5] : src[7];
+		dst[ 0] = mix(dst[ 0], blendPix, (needBlend && doLineBlend) ? ((haveShallowLine) ? ((haveSteepLine) ? 1.0/3.0 : 0.25) : ((haveSteepLine) ? 0.25 : 0.00)) : 0.00);
+		dst[15] = mix(dst[15], blendPix, (needBlend && doLineBlend && haveSteepLine) ? 0.25 : 0.00);
+		dst[ 4] = mix(dst[ 4], blendPix, (needBlend && doLineBlend && haveSteepLine) ? 0.75 : 0.00);
+		dst[ 5] = mix(dst[ 5], blendPix, (needBlend) ? ((doLineBlend) ? ((haveSteepLine) ? 1.00 : ((haveShallowLine) ? 0.75 : 0.50)) : 0.08677704501) : 0.00);
+		dst[ 6] = mix(dst[ 6], blendPix, (needBlend) ? ((doLineBlend) ? 1.00 : 0.6848532563) : 0.00);
+		dst[ 7] = mix(dst[ 7], blendPix, (needBlend) ? ((doLineBlend) ? ((haveShallowLine) ? 1.00 : ((haveSteepLine) ? 0.75 : 0.50)) : 0.08677704501) : 0.00);
+		dst[ 8] = mix(dst[ 8], blendPix, (needBlend && doLineBlend && haveShallowLine) ? 0.75 : 0.00);
+		dst[ 9] = mix(dst[ 9], blendPix, (needBlend && doLineBlend && haveShallowLine) ? 0.25 : 0.00);
+
+		dist_01_04 = DistYCbCr(src[3], src[6]);
+		dist_03_08 = DistYCbCr(src[5], src[2]);
+		haveShallowLine = (STEEP_DIRECTION_THRESHOLD * dist_01_04 <= dist_03_08) && (v[0] != v[6]) && (v[7] != v[6]);
+		haveSteepLine   = (STEEP_DIRECTION_THRESHOLD * dist_03_08 <= dist_01_04) && (v[0] != v[2]) && (v[1] != v[2]);
+		needBlend = (blendResult[3] != BLEND_NONE);
+		doLineBlend = (  blendResult[3] >= BLEND_DOMINANT ||
+			!((blendResult[2] != BLEND_NONE && !IsPixEqual(src[0], src[6])) ||
+			(blendResult[0] != BLEND_NONE && !IsPixEqual(src[0], src[2])) ||
+			(IsPixEqual(src[6], src[5]) && IsPixEqual(src[5], src[4]) && IsPixEqual(src[4], src[3]) && IsPixEqual(src[3], src[2]) && !IsPixEqual(src[0], src[4])) ) );
+
+		blendPix = ( DistYCbCr(src[0], src[3]) <= DistYCbCr(src[0], src[5]) ) ? src[3] : src[5];
+		dst[ 3] = mix(dst[ 3], blendPix, (needBlend && doLineBlend) ? ((haveShallowLine) ? ((haveSteepLine) ? 1.0/3.0 : 0.25) : ((haveSteepLine) ? 0.25 : 0.00)) : 0.00);
+		dst[12] = mix(dst[12], blendPix, (needBlend && doLineBlend && haveSteepLine) ? 0.25 : 0.00);
+		dst[13] = mix(dst[13], blendPix, (needBlend && doLineBlend && haveSteepLine) ? 0.75 : 0.00);
+		dst[14] = mix(dst[14], blendPix, (needBlend) ? ((doLineBlend) ? ((haveSteepLine) ? 1.00 : ((haveShallowLine) ? 0.75 : 0.50)) : 0.08677704501) : 0.00);
+		dst[15] = mix(dst[15], blendPix, (needBlend) ? ((doLineBlend) ? 1.00 : 0.6848532563) : 0.00);
+		dst[ 4] = mix(dst[ 4], blendPix, (needBlend) ? ((doLineBlend) ? ((haveShallowLine) ? 1.00 : ((haveSteepLine) ? 0.75 : 0.50)) : 0.08677704501) : 0.00);
+		dst[ 5] = mix(dst[ 5], blendPix, (needBlend && doLineBlend && haveShallowLine) ? 0.75 : 0.00);
+		dst[ 6] = mix(dst[ 6], blendPix, (needBlend && doLineBlend && haveShallowLine) ? 0.25 : 0.00);
+	}
+
+	// select output pixel
+	vec4 res = mix(mix(mix(mix(dst[ 6], dst[ 7], step(0.25, f.x)),
+					mix(dst[ 8], dst[ 9], step(0.75, f.x)),
+					step(0.50, f.x)),
+				mix(mix(dst[ 5], dst[ 0], step(0.25, f.x)),
+					mix(dst[ 1], dst[10], step(0.75, f.x)),
+					step(0.50, f.x)),
+				step(0.25, f.y)),
+		mix(mix(mix(dst[ 4], dst[ 3], step(0.25, f.x)),
+					mix(dst[ 2], dst[11], step(0.75, f.x)),
+					step(0.50, f.x)),
+				mix(mix(dst[15], dst[14], step(0.25, f.x)),
+					mix(dst[13], dst[12], step(0.75, f.x)),
+					step(0.50, f.x)),
+				step(0.75, f.y)),
+		step(0.50, f.y));
+
+	return postdivide_alpha(res);
+}
+)";
+
+// Like scaleBicubicT(): a radial Mitchell-Netravali filter over the 5x5 nearest texels.
+static const char *bicubicCode = R"(
+float mitchell(float x, float B, float C) {
+	float ax = abs(x);
+	if (ax >= 2.0)
+		return 0.0;
+	if (ax >= 1.0)
+		return ((-B - 6.0 * C) * (x * x * x) + (6.0 * B + 30.0 * C) * (x * x) + (-12.0 * B - 48.0 * C) * x + (8.0 * B + 24.0 * C)) / 6.0;
+	return ((12.0 - 9.0 * B - 6.0 * C) * (x * x * x) + (-18.0 + 12.0 * B + 6.0 * C) * (x * x) + (6.0 - 2.0 * B)) / 6.0;
+}
+
+vec4 scaleBicubic(uvec2 xy, float B, float C) {
+	int s = params.scale;
+	ivec2 c = ivec2(int(xy.x) / s, int(xy.y) / s);
+	vec2 sub = (vec2(float(int(xy.x) - c.x * s), float(int(xy.y) - c.y * s)) + 0.5) / float(s);
+	vec4 sum = vec4(0.0, 0.0, 0.0, 0.0);
+	float weights = 0.0;
+	for (int sy = -2; sy <= 2; ++sy) {
+		for (int sx = -2; sx <= 2; ++sx) {
+			float w = mitchell(length(sub - (vec2(float(sx), float(sy)) + 0.5)), B, C);
+			sum += w * readClampedi(c + ivec2(sx, sy));
+			weights += w;
+		}
+	}
+	return clamp(sum / weights, 0.0, 1.0);
+}
+)";
+
+// Like ScaleHybrid(): blends a smooth scale with xBRZ, using xBRZ where the source has sharp features.
+static const char *hybridCode = R"(
+// Same as generateDistanceMask(), including the fixed penalties at the edges.
+float distanceMask(ivec2 p) {
+	ivec2 size = srcSize();
+	vec4 center = readClampedi(p);
+	float dist = 0.0;
+	for (int yoff = -1; yoff <= 1; ++yoff) {
+		int yy = p.y + yoff;
+		if (yy < 0 || yy >= size.y) {
+			dist += 1200.0;
+			continue;
+		}
+		for (int xoff = -1; xoff <= 1; ++xoff) {
+			int xx = p.x + xoff;
+			if (yoff == 0 && xoff == 0)
+				continue;
+			if (xx < 0 || xx >= size.x) {
+				dist += 400.0;
+				continue;
+			}
+			vec4 d = abs(readClampedi(ivec2(xx, yy)) - center);
+			dist += (d.r + d.g + d.b + d.a) * 255.0;
+		}
+	}
+	return dist;
+}
+
+vec2 bilinearPos(uvec2 xy, out ivec2 base) {
+	vec2 pos = (vec2(float(xy.x), float(xy.y)) + 0.5) / float(params.scale) - 0.5;
+	vec2 fl = floor(pos);
+	base = ivec2(int(fl.x), int(fl.y));
+	return pos - fl;
+}
+
+vec4 scaleBilinear(uvec2 xy) {
+	ivec2 base;
+	vec2 t = bilinearPos(xy, base);
+	vec4 top = mix(readClampedi(base), readClampedi(base + ivec2(1, 0)), t.x);
+	vec4 bottom = mix(readClampedi(base + ivec2(0, 1)), readClampedi(base + ivec2(1, 1)), t.x);
+	return mix(top, bottom, t.y);
+}
+
+// The distance mask, summed over 3x3 texels and bilinearly upscaled.
+float hybridMask(uvec2 xy) {
+	ivec2 base;
+	vec2 t = bilinearPos(xy, base);
+	ivec2 size = srcSize();
+	float m[16];
+	for (int j = 0; j < 4; ++j) {
+		for (int i = 0; i < 4; ++i) {
+			ivec2 p = base + ivec2(i - 1, j - 1);
+			m[j * 4 + i] = distanceMask(ivec2(clamp(p.x, 0, size.x - 1), clamp(p.y, 0, size.y - 1)));
+		}
+	}
+	float splat[4];
+	for (int k = 0; k < 4; ++k) {
+		int kx = 1 + k % 2;
+		int ky = 1 + k / 2;
+		float sum = 0.0;
+		for (int oy = -1; oy <= 1; ++oy) {
+			for (int ox = -1; ox <= 1; ++ox) {
+				sum += m[(ky + oy) * 4 + kx + ox];
+			}
+		}
+		splat[k] = sum;
+	}
+	return mix(mix(splat[0], splat[1], t.x), mix(splat[2], splat[3], t.x), t.y);
+}
+
+vec4 scaleHybrid(uvec2 origxy, uvec2 xy, vec4 soft) {
+	vec4 sharp = scaleXBRZ(origxy, xy);
+	// The factor 8192 is the same as the CPU scaler uses.
+	vec4 res = mix(soft, sharp, min(hybridMask(xy), 8192.0) / 8192.0);
+	// xBRZ always does a better job with hard alpha.
+	if (sharp.a == 0.0)
+		res.a = 0.0;
+	return res;
+}
+)";
+
+std::string GenerateScalingShaderFunctions(int scalingType, ShaderLanguage language) {
+	std::string code;
+	if (language == HLSL_D3D11) {
+		code += hlslPrelude;
+	}
+	code += readClampedCode;
+
+	switch (scalingType) {
+	case TextureScalerCommon::HYBRID:
+	case TextureScalerCommon::HYBRID_BICUBIC:
+		code += xbrzCode;
+		if (scalingType == TextureScalerCommon::HYBRID_BICUBIC) {
+			code += bicubicCode;
+		}
+		code += hybridCode;
+		code += "vec4 applyScalingf(uvec2 origxy, uvec2 xy) {\n";
+		if (scalingType == TextureScalerCommon::HYBRID_BICUBIC) {
+			// The CPU scaler uses a B-spline for this one.
+			code += "\treturn scaleHybrid(origxy, xy, scaleBicubic(xy, 1.0, 0.0));\n";
+		} else {
+			code += "\treturn scaleHybrid(origxy, xy, scaleBilinear(xy));\n";
+		}
+		code += "}\n";
+		break;
+
+	case TextureScalerCommon::BICUBIC:
+		code += bicubicCode;
+		code += "vec4 applyScalingf(uvec2 origxy, uvec2 xy) {\n\treturn scaleBicubic(xy, 0.334, 0.334);\n}\n";
+		break;
+
+	default:
+		ERROR_LOG(G3D, "Unknown scaling type: %d", scalingType);
+		// Fall through to xBRZ.
+	case TextureScalerCommon::XBRZ:
+		code += xbrzCode;
+		code += "vec4 applyScalingf(uvec2 origxy, uvec2 xy) {\n\treturn scaleXBRZ(origxy, xy);\n}\n";
+		break;
+	}
+	return code;
+}
@@ -0,0 +1,29 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+
+#pragma once
+
+#include <string>
+
+#include "GPU/Common/ShaderCommon.h"
+
+// Generates "vec4 applyScalingf(uvec2 origxy, uvec2 xy)" (float4/uint2 in HLSL) for compute shaders
+// that upscale textures, matching the TextureScalerCommon scaling types as closely as we can.
+// The surrounding shader must provide params.width, params.height (of the output) and params.scale,
+// and "vec4 readColorf(uvec2 p)" reading an unscaled texel.
+std::string GenerateScalingShaderFunctions(int scalingType, ShaderLanguage language);
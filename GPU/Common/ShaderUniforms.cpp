@@ -10,6 +10,7 @@
 #include "GPU/GPUState.h"
 #include "GPU/Common/FramebufferCommon.h"
 #include "GPU/Common/GPUStateUtils.h"
+#include "GPU/Common/ShaderId.h"
 #include "GPU/Math3D.h"
 #include "Core/Reporting.h"
 #include "Core/Config.h"
@@ -325,3 +326,11 @@ void BoneUpdateUniforms(UB_VS_Bones *ub, uint64_t dirtyUniforms) {
 		}
 	}
 }
+
+bool VertexShaderUsesLights(const VShaderID &id) {
+	return id.Bit(VS_BIT_LIGHTING_ENABLE);
+}
+
+int VertexShaderNumBones(const VShaderID &id) {
+	return id.Bit(VS_BIT_ENABLE_BONES) ? id.Bits(VS_BIT_BONES, 3) + 1 : 0;
+}
@@ -31,7 +31,7 @@ struct UB_VS_FS_Base {
 	float fogCoef[2];	float stencil; float pad0;
 	float matAmbient[4];
 	uint32_t spline_counts; uint32_t depal_mask_shift_off_fmt;  // 4 params packed into one.
-	int pad2; int pad3;
+	uint32_t uberFragmentID[2];  // FShaderID bits, only read by the Vulkan uber fragment shader.
 	float cullRangeMin[4];
 	float cullRangeMax[4];
 	// Fragment data
@@ -58,8 +58,8 @@ R"(  mat4 proj_mtx;
   vec4 matambientalpha;
   uint spline_counts;
   uint depal_mask_shift_off_fmt;
-  int pad2;
-  int pad3;
+  uint uberfsid0;
+  uint uberfsid1;
   vec4 cullRangeMin;
   vec4 cullRangeMax;
   vec3 fogcolor;
@@ -181,9 +181,16 @@ static const char *cb_vs_bonesStr =
 R"(	float4x3 u_bone[8];
 )";
 
+struct VShaderID;
+
 void CalcCullRange(float minValues[4], float maxValues[4], bool flipViewport, bool hasNegZ);
 
 void BaseUpdateUniforms(UB_VS_FS_Base *ub, uint64_t dirtyUniforms, bool flipViewport);
 void LightUpdateUniforms(UB_VS_Lights *ub, uint64_t dirtyUniforms);
 void BoneUpdateUniforms(UB_VS_Bones *ub, uint64_t dirtyUniforms);
 
+// What a vertex shader reads from the light and bone blocks. Changes to the rest can wait until a
+// shader needs them, and only this many bones need to be copied.
+bool VertexShaderUsesLights(const VShaderID &id);
+int VertexShaderNumBones(const VShaderID &id);
+
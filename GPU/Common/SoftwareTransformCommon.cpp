@@ -29,6 +29,17 @@
 #include "GPU/Common/TextureCacheCommon.h"
 #include "GPU/Common/VertexDecoderCommon.h"
 
+#if defined(_M_SSE)
+#include <emmintrin.h>
+#endif
+#if PPSSPP_ARCH(ARM_NEON)
+#if defined(_MSC_VER) && PPSSPP_ARCH(ARM64)
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+#endif
+
 // This is the software transform pipeline, which is necessary for supporting RECT
 // primitives correctly without geometry shaders, and may be easier to use for
 // debugging than the hardware transform pipeline.
@@ -153,6 +164,89 @@ static int ColorIndexOffset(int prim, GEShadeMode shadeMode, bool clearMode) {
 	return 0;
 }
 
+enum {
+	// Must be a power of two, and a multiple of 4.
+	TRANSFORM_BATCH_SIZE = 64,
+};
+
+// Positions for a run of vertices, in SoA form so they can be transformed four at a time.
+struct TransformBatch {
+	alignas(16) float x[TRANSFORM_BATCH_SIZE];
+	alignas(16) float y[TRANSFORM_BATCH_SIZE];
+	alignas(16) float z[TRANSFORM_BATCH_SIZE];
+	alignas(16) float worldX[TRANSFORM_BATCH_SIZE];
+	alignas(16) float worldY[TRANSFORM_BATCH_SIZE];
+	alignas(16) float worldZ[TRANSFORM_BATCH_SIZE];
+	alignas(16) float viewX[TRANSFORM_BATCH_SIZE];
+	alignas(16) float viewY[TRANSFORM_BATCH_SIZE];
+	alignas(16) float viewZ[TRANSFORM_BATCH_SIZE];
+};
+
+// Same operation order as Vec3ByMatrix43, so the results match the per vertex path exactly.
+// count must be a multiple of 4.
+static void Vec3ByMatrix43Batch(float *outX, float *outY, float *outZ, const float *x, const float *y, const float *z, int count, const float m[12]) {
+#if defined(_M_SSE)
+	for (int c = 0; c < 3; c++) {
+		const __m128 m0 = _mm_set1_ps(m[c]);
+		const __m128 m1 = _mm_set1_ps(m[c + 3]);
+		const __m128 m2 = _mm_set1_ps(m[c + 6]);
+		const __m128 m3 = _mm_set1_ps(m[c + 9]);
+		float *out = c == 0 ? outX : (c == 1 ? outY : outZ);
+		for (int i = 0; i < count; i += 4) {
+			__m128 sum = _mm_add_ps(_mm_mul_ps(_mm_load_ps(x + i), m0), _mm_mul_ps(_mm_load_ps(y + i), m1));
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(z + i), m2));
+			_mm_store_ps(out + i, _mm_add_ps(sum, m3));
+		}
+	}
+#elif PPSSPP_ARCH(ARM_NEON)
+	for (int c = 0; c < 3; c++) {
+		const float32x4_t m0 = vdupq_n_f32(m[c]);
+		const float32x4_t m1 = vdupq_n_f32(m[c + 3]);
+		const float32x4_t m2 = vdupq_n_f32(m[c + 6]);
+		const float32x4_t m3 = vdupq_n_f32(m[c + 9]);
+		float *out = c == 0 ? outX : (c == 1 ? outY : outZ);
+		for (int i = 0; i < count; i += 4) {
+			// Avoiding vmlaq so this can't turn into a fused multiply-add.
+			float32x4_t sum = vaddq_f32(vmulq_f32(vld1q_f32(x + i), m0), vmulq_f32(vld1q_f32(y + i), m1));
+			sum = vaddq_f32(sum, vmulq_f32(vld1q_f32(z + i), m2));
+			vst1q_f32(out + i, vaddq_f32(sum, m3));
+		}
+	}
+#else
+	for (int i = 0; i < count; i++) {
+		const float v[3] = { x[i], y[i], z[i] };
+		float o[3];
+		Vec3ByMatrix43(o, v, m);
+		outX[i] = o[0];
+		outY[i] = o[1];
+		outZ[i] = o[2];
+	}
+#endif
+}
+
+// Reads and transforms positions by the world and view matrices, for unskinned vertices.
+static void TransformPositionBatch(VertexReader &reader, int start, int end, TransformBatch &batch) {
+	const int count = end - start;
+	for (int i = 0; i < count; i++) {
+		float pos[3];
+		reader.Goto(start + i);
+		reader.ReadPos(pos);
+		batch.x[i] = pos[0];
+		batch.y[i] = pos[1];
+		batch.z[i] = pos[2];
+	}
+	// Pad so the SIMD loops don't need a tail.
+	const int padded = (count + 3) & ~3;
+	for (int i = count; i < padded; i++) {
+		batch.x[i] = 0.0f;
+		batch.y[i] = 0.0f;
+		batch.z[i] = 0.0f;
+	}
+
+	Vec3ByMatrix43Batch(batch.worldX, batch.worldY, batch.worldZ, batch.x, batch.y, batch.z, padded, gstate.worldMatrix);
+	Vec3ByMatrix43Batch(batch.viewX, batch.viewY, batch.viewZ, batch.worldX, batch.worldY, batch.worldZ, padded, gstate.viewMatrix);
+}
+
 void SoftwareTransform(
 	int prim, int vertexCount, u32 vertType, u16 *&inds, int indexType,
 	const DecVtxFormat &decVtxFormat, int &maxIndex, TransformedVertex *&drawBuffer, int &numTrans, bool &drawIndexed, const SoftwareTransformParams *params, SoftwareTransformResult *result) {
@@ -232,7 +326,13 @@ void SoftwareTransform(
 		}
 	} else {
 		// Okay, need to actually perform the full transform.
+		// Without skinning, positions go through the matrices in batches up front.
+		TransformBatch batch;
 		for (int index = 0; index < maxIndex; index++) {
+			const int batchIndex = index & (TRANSFORM_BATCH_SIZE - 1);
+			if (batchIndex == 0 && !skinningEnabled) {
+				TransformPositionBatch(reader, index, std::min(index + (int)TRANSFORM_BATCH_SIZE, maxIndex), batch);
+			}
 			reader.Goto(index);
 
 			float v[3] = {0, 0, 0};
@@ -245,7 +345,13 @@ void SoftwareTransform(
 			float pos[3];
 			Vec3f normal(0, 0, 1);
 			Vec3f worldnormal(0, 0, 1);
-			reader.ReadPos(pos);
+			if (!skinningEnabled) {
+				pos[0] = batch.x[batchIndex];
+				pos[1] = batch.y[batchIndex];
+				pos[2] = batch.z[batchIndex];
+			} else {
+				reader.ReadPos(pos);
+			}
 
 			float ruv[2] = { 0.0f, 0.0f };
 			if (reader.hasUV())
@@ -263,7 +369,9 @@ void SoftwareTransform(
 				reader.ReadNrm(normal.AsArray());
 
 			if (!skinningEnabled) {
-				Vec3ByMatrix43(out, pos, gstate.worldMatrix);
+				out[0] = batch.worldX[batchIndex];
+				out[1] = batch.worldY[batchIndex];
+				out[2] = batch.worldZ[batchIndex];
 				if (reader.hasNormal()) {
 					if (gstate.areNormalsReversed()) {
 						normal = -normal;
@@ -424,7 +532,13 @@ void SoftwareTransform(
 			uv[1] = uv[1] * heightFactor;
 
 			// Transform the coord by the view matrix.
-			Vec3ByMatrix43(v, out, gstate.viewMatrix);
+			if (!skinningEnabled) {
+				v[0] = batch.viewX[batchIndex];
+				v[1] = batch.viewY[batchIndex];
+				v[2] = batch.viewZ[batchIndex];
+			} else {
+				Vec3ByMatrix43(v, out, gstate.viewMatrix);
+			}
 			fogCoef = (v[2] + fog_end) * fog_slope;
 
 			// TODO: Write to a flexible buffer, we don't always need all four components.
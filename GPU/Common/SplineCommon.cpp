@@ -17,14 +17,18 @@
 
 #include <string.h>
 #include <algorithm>
+#include <type_traits>
+#include <vector>
 
 #include "profiler/profiler.h"
 
 #include "Common/CPUDetect.h"
+#include "Common/ThreadPools.h"
 
 #include "GPU/Common/GPUStateUtils.h"
 #include "GPU/Common/SplineCommon.h"
 #include "GPU/Common/DrawEngineCommon.h"
+#include "GPU/Common/TextureDecoder.h"  // for ReliableHash
 #include "GPU/ge_constants.h"
 #include "GPU/GPUState.h"  // only needed for UVScale stuff
 
@@ -35,26 +39,6 @@ bool CanUseHardwareTessellation(GEPatchPrimType prim) {
 	return false;
 }
 
-class SimpleBufferManager {
-private:
-	u8 *buf_;
-	size_t totalSize, maxSize_;
-public:
-	SimpleBufferManager(u8 *buf, size_t maxSize)
-		: buf_(buf), totalSize(0), maxSize_(maxSize) {}
-
-	u8 *Allocate(size_t size) {
-		size = (size + 15) & ~15; // Align for 16 bytes
-
-		if ((totalSize + size) > maxSize_)
-			return nullptr; // No more memory
-
-		size_t tmp = totalSize;
-		totalSize += size;
-		return buf_ + tmp;
-	}
-};
-
 namespace Spline {
 
 static void CopyQuadIndex(u16 *&indices, GEPatchPrimType type, const int idx0, const int idx1, const int idx2, const int idx3) {
@@ -324,10 +308,10 @@ class Tessellator {
 	}
 };
 
-ControlPoints::ControlPoints(const SimpleVertex *const *points, int size, SimpleBufferManager &managedBuf) {
-	pos = (Vec3f *)managedBuf.Allocate(sizeof(Vec3f) * size);
-	tex = (Vec2f *)managedBuf.Allocate(sizeof(Vec2f) * size);
-	col = (Vec4f *)managedBuf.Allocate(sizeof(Vec4f) * size);
+ControlPoints::ControlPoints(const SimpleVertex *const *points, int size, FrameArena &arena) {
+	pos = (Vec3f *)arena.Allocate(sizeof(Vec3f) * size);
+	tex = (Vec2f *)arena.Allocate(sizeof(Vec2f) * size);
+	col = (Vec4f *)arena.Allocate(sizeof(Vec4f) * size);
 	Convert(points, size);
 }
 
@@ -340,6 +324,94 @@ void ControlPoints::Convert(const SimpleVertex *const *points, int size) {
 	defcolor = points[0]->color_32;
 }
 
+enum {
+	// Below this, handing patches to other threads costs more than it saves.
+	PARALLEL_TESS_MIN_VERTS = 4096,
+	// Smaller curves are cheap enough to redo.
+	TESS_CACHE_MIN_VERTS = 256,
+	TESS_CACHE_MAX_ENTRIES = 16,
+	TESS_CACHE_MAX_BYTES = 8 * 1024 * 1024,
+};
+
+// Keeps the output of recent software tessellations, so static curved surfaces aren't redone every frame.
+class TessellationCache {
+public:
+	struct Key {
+		u32 hash;
+		int tess_u, tess_v;
+		int num_points_u, num_points_v;
+		int type_u, type_v;
+		int primType;
+		int flags;
+
+		bool operator ==(const Key &other) const {
+			return hash == other.hash && tess_u == other.tess_u && tess_v == other.tess_v &&
+				num_points_u == other.num_points_u && num_points_v == other.num_points_v &&
+				type_u == other.type_u && type_v == other.type_v && primType == other.primType && flags == other.flags;
+		}
+	};
+
+	bool Lookup(const Key &key, OutputBuffers &output) {
+		for (size_t i = 0; i < entries_.size(); ++i) {
+			if (entries_[i].key == key) {
+				// Most recently used goes first.
+				std::rotate(entries_.begin(), entries_.begin() + i, entries_.begin() + i + 1);
+				const Entry &entry = entries_[0];
+				memcpy(output.vertices, entry.vertices.data(), entry.vertices.size() * sizeof(SimpleVertex));
+				memcpy(output.indices, entry.indices.data(), entry.indices.size() * sizeof(u16));
+				output.count = (int)entry.indices.size();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void Store(const Key &key, const OutputBuffers &output, int numVerts) {
+		Entry entry;
+		entry.key = key;
+		entry.vertices.assign(output.vertices, output.vertices + numVerts);
+		entry.indices.assign(output.indices, output.indices + output.count);
+		bytes_ += entry.Bytes();
+		entries_.insert(entries_.begin(), std::move(entry));
+
+		while (entries_.size() > 1 && (entries_.size() > TESS_CACHE_MAX_ENTRIES || bytes_ > TESS_CACHE_MAX_BYTES)) {
+			bytes_ -= entries_.back().Bytes();
+			entries_.pop_back();
+		}
+	}
+
+	void Clear() {
+		entries_.clear();
+		bytes_ = 0;
+	}
+
+private:
+	struct Entry {
+		Key key;
+		std::vector<SimpleVertex> vertices;
+		std::vector<u16> indices;
+
+		size_t Bytes() const {
+			return vertices.size() * sizeof(SimpleVertex) + indices.size() * sizeof(u16);
+		}
+	};
+
+	std::vector<Entry> entries_;
+	size_t bytes_ = 0;
+};
+
+static TessellationCache tessCache;
+
+static u32 HashControlPoints(const ControlPoints &points, int size) {
+	u32 hash = DoReliableHash32(points.col, sizeof(Vec4f) * size, points.defcolor);
+	for (int i = 0; i < size; ++i) {
+		// Vec3f and Vec2f may be padded out to a full SSE vector, so only hash the real components.
+		const float data[5] = { points.pos[i].x, points.pos[i].y, points.pos[i].z, points.tex[i].x, points.tex[i].y };
+		hash = DoReliableHash32(data, sizeof(data), hash);
+	}
+	return hash;
+}
+
 template<class Surface>
 class SubdivisionSurface {
 public:
@@ -348,9 +420,12 @@ class SubdivisionSurface {
 		const float inv_u = 1.0f / (float)surface.tess_u;
 		const float inv_v = 1.0f / (float)surface.tess_v;
 
-		for (int patch_u = 0; patch_u < surface.num_patches_u; ++patch_u) {
-			const int start_u = surface.GetTessStart(patch_u);
-			for (int patch_v = 0; patch_v < surface.num_patches_v; ++patch_v) {
+		// Every patch writes its own vertices, so they can be spread over threads.
+		auto tessPatches = [&](int lower, int upper) {
+			for (int patch = lower; patch < upper; ++patch) {
+				const int patch_u = patch / surface.num_patches_v;
+				const int patch_v = patch % surface.num_patches_v;
+				const int start_u = surface.GetTessStart(patch_u);
 				const int start_v = surface.GetTessStart(patch_v);
 
 				// Prepare 4x4 control points to tessellate
@@ -408,6 +483,13 @@ class SubdivisionSurface {
 					}
 				}
 			}
+		};
+
+		const int numPatches = surface.num_patches_u * surface.num_patches_v;
+		if (surface.NumVertices() >= PARALLEL_TESS_MIN_VERTS) {
+			GlobalThreadPool::Loop(tessPatches, 0, numPatches);
+		} else {
+			tessPatches(0, numPatches);
 		}
 
 		surface.BuildIndex(output.indices, output.count);
@@ -438,7 +520,30 @@ void SoftwareTessellation(OutputBuffers &output, const Surface &surface, u32 ori
 	u32 key_v = WeightType::ToKey(surface.tess_v, surface.num_points_v, surface.type_v);
 	Weight2D weights(WeightType::weightsCache, key_u, key_v);
 
+	const int numVerts = surface.NumVertices();
+	TessellationCache::Key cacheKey;
+	if (numVerts >= TESS_CACHE_MIN_VERTS) {
+		const int numPoints = surface.num_points_u * surface.num_points_v;
+		cacheKey.hash = HashControlPoints(points, numPoints);
+		cacheKey.tess_u = surface.tess_u;
+		cacheKey.tess_v = surface.tess_v;
+		cacheKey.num_points_u = surface.num_points_u;
+		cacheKey.num_points_v = surface.num_points_v;
+		cacheKey.type_u = surface.type_u;
+		cacheKey.type_v = surface.type_v;
+		cacheKey.primType = surface.primType;
+		// Everything else that changes the output. The weight type tells bezier and spline apart.
+		cacheKey.flags = (origVertType & (GE_VTYPE_NRM_MASK | GE_VTYPE_COL_MASK | GE_VTYPE_TC_MASK)) |
+			(gstate.isLightingEnabled() ? 0x80000000 : 0) | (surface.patchFacing ? 0x40000000 : 0) |
+			(std::is_same<WeightType, Spline3DWeight>::value ? 0x20000000 : 0);
+		if (tessCache.Lookup(cacheKey, output))
+			return;
+	}
+
 	SubdivisionSurface<Surface>::Tessellate(output, surface, points, weights, origVertType);
+
+	if (numVerts >= TESS_CACHE_MIN_VERTS)
+		tessCache.Store(cacheKey, output, numVerts);
 }
 
 template<class Surface>
@@ -487,6 +592,7 @@ using namespace Spline;
 void DrawEngineCommon::ClearSplineBezierWeights() {
 	Bezier3DWeight::weightsCache.Clear();
 	Spline3DWeight::weightsCache.Clear();
+	tessCache.Clear();
 }
 
 // Specialize to make instance (to avoid link error).
@@ -503,7 +609,13 @@ void DrawEngineCommon::SubmitCurve(const void *control_points, const void *indic
 	if (surface.num_points_u < 4 || surface.num_points_v < 4)
 		return;
 
-	SimpleBufferManager managedBuf(decoded, DECODED_VERTEX_BUFFER_SIZE / 2);
+	// Everything below is dead once the curve is submitted, so give the space back when we're done.
+	struct ArenaScope {
+		ArenaScope(FrameArena &arena) : arena_(arena), mark_(arena.Mark()) {}
+		~ArenaScope() { arena_.Rewind(mark_); }
+		FrameArena &arena_;
+		size_t mark_;
+	} arenaScope(frameArena_);
 
 	int num_points = surface.num_points_u * surface.num_points_v;
 	u16 index_lower_bound = 0;
@@ -516,14 +628,13 @@ void DrawEngineCommon::SubmitCurve(const void *control_points, const void *indic
 	*bytesRead = num_points * origVDecoder->VertexSize();
 
 	// Simplify away bones and morph before proceeding
-	// There are normally not a lot of control points so just splitting decoded should be reasonably safe, although not great.
-	SimpleVertex *simplified_control_points = (SimpleVertex *)managedBuf.Allocate(sizeof(SimpleVertex) * (index_upper_bound + 1));
+	SimpleVertex *simplified_control_points = (SimpleVertex *)frameArena_.Allocate(sizeof(SimpleVertex) * (index_upper_bound + 1));
 	if (!simplified_control_points) {
 		ERROR_LOG(G3D, "Failed to allocate space for simplified control points, skipping curve draw");
 		return;
 	}
 
-	u8 *temp_buffer = managedBuf.Allocate(sizeof(SimpleVertex) * num_points);
+	u8 *temp_buffer = frameArena_.Allocate(sizeof(SimpleVertex) * num_points);
 	if (!temp_buffer) {
 		ERROR_LOG(G3D, "Failed to allocate space for temp buffer, skipping curve draw");
 		return;
@@ -540,7 +651,7 @@ void DrawEngineCommon::SubmitCurve(const void *control_points, const void *indic
 	}
 
 	// Make an array of pointers to the control points, to get rid of indices.
-	const SimpleVertex **points = (const SimpleVertex **)managedBuf.Allocate(sizeof(SimpleVertex *) * num_points);
+	const SimpleVertex **points = (const SimpleVertex **)frameArena_.Allocate(sizeof(SimpleVertex *) * num_points);
 	if (!points) {
 		ERROR_LOG(G3D, "Failed to allocate space for control point pointers, skipping curve draw");
 		return;
@@ -558,7 +669,7 @@ void DrawEngineCommon::SubmitCurve(const void *control_points, const void *indic
 	if (CanUseHardwareTessellation(surface.primType)) {
 		HardwareTessellation(output, surface, origVertType, points, tessDataTransfer);
 	} else {
-		ControlPoints cpoints(points, num_points, managedBuf);
+		ControlPoints cpoints(points, num_points, frameArena_);
 		SoftwareTessellation(output, surface, origVertType, cpoints);
 	}
 
@@ -17,11 +17,16 @@
 
 #include <algorithm>
 #include "ppsspp_config.h"
+#include "base/timeutil.h"
 #include "profiler/profiler.h"
+#include "thread/threadutil.h"
 #include "Common/ColorConv.h"
+#include "Common/MemoryUsage.h"
 #include "Common/MemoryUtil.h"
+#include "Common/SlabPool.h"
 #include "Core/Config.h"
 #include "Core/Reporting.h"
+#include "Core/ELF/ParamSFO.h"
 #include "Core/System.h"
 #include "GPU/Common/FramebufferCommon.h"
 #include "GPU/Common/TextureCacheCommon.h"
@@ -59,9 +64,31 @@
 // Try to be prime to other decimation intervals.
 #define TEXCACHE_DECIMATION_INTERVAL 13
 
+// Each one is a render target the size of the framebuffer, so keep it small.
+#define TEXCACHE_MAX_DEPAL_RESULTS 8
+#define DEPAL_RESULT_KILL_AGE 60
+
 #define TEXCACHE_MIN_PRESSURE 16 * 1024 * 1024  // Total in VRAM
 #define TEXCACHE_SECOND_MIN_PRESSURE 4 * 1024 * 1024
 
+// Used when TexCacheBudgetMB is 0.  A quarter of the budget is for unscaled textures, the rest for upscaled ones.
+#ifdef MOBILE_DEVICE
+#define TEXCACHE_DEFAULT_BUDGET_MB 128
+#else
+#define TEXCACHE_DEFAULT_BUDGET_MB 512
+#endif
+
+// Only touched from the GPU thread.
+static SlabPool<sizeof(TexCacheEntry), 256> texCacheEntryPool;
+
+void *TexCacheEntry::operator new(size_t size) {
+	return texCacheEntryPool.Allocate(size);
+}
+
+void TexCacheEntry::operator delete(void *ptr) {
+	texCacheEntryPool.Free(ptr);
+}
+
 // Just for reference
 
 // PSP Color formats:
@@ -92,6 +119,7 @@ TextureCacheCommon::TextureCacheCommon(Draw::DrawContext *draw)
 		clearCacheNextFrame_(false),
 		lowMemoryMode_(false),
 		texelsScaledThisFrame_(0),
+		cacheIndex_(1024),
 		cacheSizeEstimate_(0),
 		secondCacheSizeEstimate_(0),
 		nextTexture_(nullptr),
@@ -121,6 +149,7 @@ TextureCacheCommon::TextureCacheCommon(Draw::DrawContext *draw)
 }
 
 TextureCacheCommon::~TextureCacheCommon() {
+	StopAsyncScaling();
 	FreeAlignedMemory(clutBufConverted_);
 	FreeAlignedMemory(clutBufRaw_);
 }
@@ -359,8 +388,8 @@ void TextureCacheCommon::SetTexture(bool force) {
 
 	u32 texhash = MiniHash((const u32 *)Memory::GetPointerUnchecked(texaddr));
 
-	TexCache::iterator iter = cache_.find(cachekey);
-	TexCacheEntry *entry = nullptr;
+	TexCacheEntry *entry = cacheIndex_.Get(cachekey);
+	TexCacheStats_Lookup();
 
 	// Note: It's necessary to reset needshadertexclamp, for otherwise DIRTY_TEXCLAMP won't get set later.
 	// Should probably revisit how this works..
@@ -371,11 +400,10 @@ void TextureCacheCommon::SetTexture(bool force) {
 	}
 	gstate_c.bgraTexture = isBgraBackend_;
 
-	if (iter != cache_.end()) {
-		entry = iter->second.get();
+	if (entry) {
 		// Validate the texture still matches the cache entry.
 		bool match = entry->Matches(dim, format, maxLevel);
-		const char *reason = "different params";
+		TexChangeReason reason = TexChangeReason::PARAMS;
 
 		// Check for FBO - slow!
 		if (entry->framebuffer) {
@@ -385,15 +413,26 @@ void TextureCacheCommon::SetTexture(bool force) {
 				}
 
 				SetTextureFramebuffer(entry, entry->framebuffer);
+				TexCacheStats_Hit();
 				return;
 			} else {
 				// Make sure we re-evaluate framebuffers.
 				DetachFramebuffer(entry, texaddr, entry->framebuffer);
-				reason = "detached framebuf";
+				reason = TexChangeReason::DETACHED_FRAMEBUFFER;
 				match = false;
 			}
 		}
 
+		// A new video frame was written here since we built this, so skip the hash checks (and the
+		// secondary cache, video frames won't come back) and go straight to rebuilding.
+		if (match && !videos_.empty()) {
+			auto video = videos_.find(texaddr & 0x3FFFFFFF);
+			if (video != videos_.end() && video->second.uploads != entry->videoUpload) {
+				match = false;
+				reason = TexChangeReason::VIDEO_FRAME;
+			}
+		}
+
 		bool rehash = entry->GetHashStatus() == TexCacheEntry::STATUS_UNRELIABLE;
 
 		// First let's see if another texture with the same address had a hashfail.
@@ -442,10 +481,16 @@ void TextureCacheCommon::SetTexture(bool force) {
 			if ((entry->status & TexCacheEntry::STATUS_CHANGE_FREQUENT) == 0) {
 				// INFO_LOG(G3D, "Reloading texture to do the scaling we skipped..");
 				match = false;
-				reason = "scaling";
+				reason = TexChangeReason::SCALING;
 			}
 		}
 
+		if (match && (entry->status & TexCacheEntry::STATUS_TO_REPLACE)) {
+			entry->status &= ~TexCacheEntry::STATUS_TO_REPLACE;
+			match = false;
+			reason = TexChangeReason::REPLACING;
+		}
+
 		if (match) {
 			// TODO: Mark the entry reliable if it's been safe for long enough?
 			//got one!
@@ -464,6 +509,7 @@ void TextureCacheCommon::SetTexture(bool force) {
 			// Might need a rebuild if the hash fails, but that will be set later.
 			nextNeedsRebuild_ = false;
 			VERBOSE_LOG(G3D, "Texture at %08x Found in Cache, applying", texaddr);
+			TexCacheStats_Hit();
 			return; //Done!
 		} else {
 			// Wasn't a match, we will rebuild.
@@ -472,8 +518,10 @@ void TextureCacheCommon::SetTexture(bool force) {
 		}
 	} else {
 		VERBOSE_LOG(G3D, "No texture in cache, decoding...");
+		TexCacheStats_NewEntry();
 		TexCacheEntry *entryNew = new TexCacheEntry{};
 		cache_[cachekey].reset(entryNew);
+		cacheIndex_.Insert(cachekey, entryNew);
 
 		if (hasClut && clutRenderAddress_ != 0xFFFFFFFF) {
 			WARN_LOG_REPORT_ONCE(clutUseRender, G3D, "Using texture with rendered CLUT: texfmt=%d, clutfmt=%d", gstate.getTextureFormat(), gstate.getClutPaletteFormat());
@@ -521,6 +569,9 @@ void TextureCacheCommon::SetTexture(bool force) {
 
 	entry->cluthash = cluthash;
 
+	auto video = videos_.find(texaddr & 0x3FFFFFFF);
+	entry->videoUpload = video != videos_.end() ? video->second.uploads : 0;
+
 	gstate_c.curTextureWidth = w;
 	gstate_c.curTextureHeight = h;
 
@@ -545,6 +596,11 @@ void TextureCacheCommon::SetTexture(bool force) {
 
 // Removes old textures.
 void TextureCacheCommon::Decimate(bool forcePressure) {
+	// Called every frame, so a good time to report our size.
+	MemoryUsage::Set(MemoryUsage::Category::TEXTURES, (s64)cacheSizeEstimate_ + secondCacheSizeEstimate_);
+	MemoryUsage::Set(MemoryUsage::Category::REPLACEMENT_TEXTURES, replacedSizeEstimate_);
+	MemoryUsage::Set(MemoryUsage::Category::SCALED_TEXTURES, scaledSizeEstimate_);
+
 	if (--decimationCounter_ <= 0) {
 		decimationCounter_ = TEXCACHE_DECIMATION_INTERVAL;
 	} else {
@@ -569,6 +625,8 @@ void TextureCacheCommon::Decimate(bool forcePressure) {
 		VERBOSE_LOG(G3D, "Decimated texture cache, saved %d estimated bytes - now %d bytes", had - cacheSizeEstimate_, cacheSizeEstimate_);
 	}
 
+	DecimateToBudget();
+
 	// If enabled, we also need to clear the secondary cache.
 	if (g_Config.bTextureSecondaryCache && (forcePressure || secondCacheSizeEstimate_ >= TEXCACHE_SECOND_MIN_PRESSURE)) {
 		const u32 had = secondCacheSizeEstimate_;
@@ -577,6 +635,8 @@ void TextureCacheCommon::Decimate(bool forcePressure) {
 			// In low memory mode, we kill them all since secondary cache is disabled.
 			if (lowMemoryMode_ || iter->second->lastFrame + TEXTURE_SECOND_KILL_AGE < gpuStats.numFlips) {
 				ReleaseTexture(iter->second.get(), true);
+				SetReplacedSize(iter->second.get(), 0);
+				SetScaledSize(iter->second.get(), 1);
 				secondCacheSizeEstimate_ -= EstimateTexMemoryUsage(iter->second.get());
 				secondCache_.erase(iter++);
 			} else {
@@ -588,12 +648,53 @@ void TextureCacheCommon::Decimate(bool forcePressure) {
 	}
 
 	DecimateVideos();
+	DecimateDepalResults(false);
+}
+
+void TextureCacheCommon::DecimateToBudget() {
+	s64 budget = (s64)(g_Config.iTexCacheBudgetMB > 0 ? g_Config.iTexCacheBudgetMB : TEXCACHE_DEFAULT_BUDGET_MB) * 1024 * 1024;
+	if (lowMemoryMode_) {
+		budget /= 2;
+	}
+	gpuStats.textureCacheBudget = budget;
+
+	const s64 unscaledBudget = budget / 4;
+	const s64 scaledBudget = budget - unscaledBudget;
+	if ((s64)cacheSizeEstimate_ <= unscaledBudget && scaledSizeEstimate_ <= scaledBudget) {
+		return;
+	}
+
+	// Evict least recently used first.  Anything used this or last frame may still be in flight, so keep it.
+	std::vector<std::pair<int, u64>> lru;
+	lru.reserve(cache_.size());
+	for (const auto &it : cache_) {
+		if (it.second->lastFrame + 1 < gpuStats.numFlips) {
+			lru.push_back(std::make_pair(it.second->lastFrame, it.first));
+		}
+	}
+	std::sort(lru.begin(), lru.end());
+
+	ForgetLastTexture();
+	for (const auto &item : lru) {
+		const bool overUnscaled = (s64)cacheSizeEstimate_ > unscaledBudget;
+		if (!overUnscaled && scaledSizeEstimate_ <= scaledBudget) {
+			break;
+		}
+
+		TexCache::iterator iter = cache_.find(item.second);
+		// If only the scaled pool is full, unscaled textures can stay.
+		if (!overUnscaled && iter->second->scaledBytes == 0) {
+			continue;
+		}
+		DeleteTexture(iter);
+		gpuStats.numTextureEvictions++;
+	}
 }
 
 void TextureCacheCommon::DecimateVideos() {
 	if (!videos_.empty()) {
 		for (auto iter = videos_.begin(); iter != videos_.end(); ) {
-			if (iter->second + VIDEO_DECIMATE_AGE < gpuStats.numFlips) {
+			if (iter->second.flips + VIDEO_DECIMATE_AGE < gpuStats.numFlips) {
 				videos_.erase(iter++);
 			} else {
 				++iter;
@@ -602,11 +703,96 @@ void TextureCacheCommon::DecimateVideos() {
 	}
 }
 
-void TextureCacheCommon::HandleTextureChange(TexCacheEntry *const entry, const char *reason, bool initialMatch, bool doDelete) {
+Draw::Framebuffer *TextureCacheCommon::GetDepalResult(VirtualFramebuffer *framebuffer, bool *valid) {
+	DepalResult key{};
+	key.framebuffer = framebuffer;
+	key.generation = framebuffer->generation;
+	key.clutHash = clutHash_;
+	key.clutMode = gstate.clutformat & 0xFFFFFF;
+	key.format = framebuffer->drawnFormat;
+	key.w = framebuffer->renderWidth;
+	key.h = framebuffer->renderHeight;
+	// Only the drawn region is depalettized, see ApplyBounds.
+	if (gstate_c.vertBounds.minV < gstate_c.vertBounds.maxV) {
+		key.bounds[0] = gstate_c.vertBounds.minU + gstate_c.curTextureXOffset;
+		key.bounds[1] = gstate_c.vertBounds.minV + gstate_c.curTextureYOffset;
+		key.bounds[2] = gstate_c.vertBounds.maxU + gstate_c.curTextureXOffset;
+		key.bounds[3] = gstate_c.vertBounds.maxV + gstate_c.curTextureYOffset;
+		// We need to reapply the texture next time since we cropped UV.
+		gstate_c.Dirty(DIRTY_TEXTURE_PARAMS);
+	}
+	auto matches = [&](const DepalResult &result) {
+		return result.framebuffer == key.framebuffer && result.generation == key.generation && result.clutHash == key.clutHash &&
+			result.clutMode == key.clutMode && result.format == key.format && result.w == key.w && result.h == key.h &&
+			memcmp(result.bounds, key.bounds, sizeof(key.bounds)) == 0;
+	};
+
+	// While it's being rendered to, every draw may change it.
+	bool canReuse = framebufferManager_->GetCurrentRenderVFB() != framebuffer;
+	DepalResult *slot = nullptr;
+	for (DepalResult &result : depalResults_) {
+		if (canReuse && matches(result)) {
+			result.lastFrame = gpuStats.numFlips;
+			*valid = true;
+			return result.fbo;
+		}
+		// Prefer overwriting a stale copy of the same framebuffer, to avoid creating render targets every frame.
+		if (!slot && result.framebuffer == framebuffer && result.w == key.w && result.h == key.h && result.lastFrame != gpuStats.numFlips)
+			slot = &result;
+	}
+
+	*valid = false;
+	if (!slot && depalResults_.size() < TEXCACHE_MAX_DEPAL_RESULTS) {
+		depalResults_.push_back(DepalResult{});
+		slot = &depalResults_.back();
+	} else if (!slot) {
+		slot = &depalResults_[0];
+		for (DepalResult &result : depalResults_) {
+			if (result.lastFrame < slot->lastFrame)
+				slot = &result;
+		}
+	}
+
+	Draw::Framebuffer *fbo = slot->fbo;
+	if (fbo && (slot->w != key.w || slot->h != key.h)) {
+		fbo->Release();
+		fbo = nullptr;
+	}
+	if (!fbo) {
+		ForgetLastTexture();
+		fbo = draw_->CreateFramebuffer({ key.w, key.h, 1, 1, false, Draw::FBO_8888 });
+	}
+	*slot = key;
+	slot->fbo = fbo;
+	slot->lastFrame = gpuStats.numFlips;
+	if (!canReuse)
+		slot->framebuffer = nullptr;
+	if (!fbo) {
+		// Fall back to the shared one, which won't be reused.
+		slot->framebuffer = nullptr;
+		return framebufferManager_->GetTempFBO(TempFBO::DEPAL, key.w, key.h, Draw::FBO_8888);
+	}
+	return fbo;
+}
+
+void TextureCacheCommon::DecimateDepalResults(bool all) {
+	for (auto it = depalResults_.begin(); it != depalResults_.end(); ) {
+		if (all || !it->framebuffer || it->lastFrame + DEPAL_RESULT_KILL_AGE < gpuStats.numFlips) {
+			if (it->fbo)
+				it->fbo->Release();
+			it = depalResults_.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void TextureCacheCommon::HandleTextureChange(TexCacheEntry *const entry, TexChangeReason reason, bool initialMatch, bool doDelete) {
 	cacheSizeEstimate_ -= EstimateTexMemoryUsage(entry);
 	entry->numInvalidated++;
 	gpuStats.numTextureInvalidations++;
-	DEBUG_LOG(G3D, "Texture different or overwritten, reloading at %08x: %s", entry->addr, reason);
+	TexCacheStats_Change(reason);
+	DEBUG_LOG(G3D, "Texture different or overwritten, reloading at %08x: %s", entry->addr, TexChangeReasonName(reason));
 	if (doDelete) {
 		InvalidateLastTexture();
 		ReleaseTexture(entry, true);
@@ -676,6 +862,11 @@ void TextureCacheCommon::NotifyFramebuffer(u32 address, VirtualFramebuffer *fram
 
 	case NOTIFY_FB_DESTROYED:
 		fbCache_.erase(std::remove(fbCache_.begin(), fbCache_.end(), framebuffer), fbCache_.end());
+		// The pointer may be reused by a new framebuffer, so these can't stay around.
+		for (DepalResult &result : depalResults_) {
+			if (result.framebuffer == framebuffer)
+				result.framebuffer = nullptr;
+		}
 
 		// We may have an offset texture attached.  So we use fbTexInfo as a guide.
 		// We're not likely to have many attached framebuffers.
@@ -684,7 +875,7 @@ void TextureCacheCommon::NotifyFramebuffer(u32 address, VirtualFramebuffer *fram
 			// We might erase, so move to the next one already (which won't become invalid.)
 			++it;
 
-			DetachFramebuffer(cache_[cachekey].get(), addr, framebuffer);
+			DetachFramebuffer(cacheIndex_.Get(cachekey), addr, framebuffer);
 		}
 		break;
 	}
@@ -909,6 +1100,14 @@ void TextureCacheCommon::SetTextureFramebuffer(TexCacheEntry *entry, VirtualFram
 	nextNeedsRebuild_ = false;
 }
 
+bool TextureCacheCommon::HasTextureAt(u32 addr) const {
+	// All entries at an address share the upper half of the cache key.
+	const u64 cachekeyMin = (u64)(addr & 0x3FFFFFFF) << 32;
+	const u64 cachekeyMax = cachekeyMin + (1ULL << 32);
+	auto it = cache_.lower_bound(cachekeyMin);
+	return it != cache_.end() && it->first < cachekeyMax;
+}
+
 bool TextureCacheCommon::SetOffsetTexture(u32 offset) {
 	if (g_Config.iRenderingMode != FB_BUFFERED_MODE) {
 		return false;
@@ -920,11 +1119,10 @@ bool TextureCacheCommon::SetOffsetTexture(u32 offset) {
 
 	const u16 dim = gstate.getTextureDimension(0);
 	u64 cachekey = TexCacheEntry::CacheKey(texaddr, gstate.getTextureFormat(), dim, 0);
-	TexCache::iterator iter = cache_.find(cachekey);
-	if (iter == cache_.end()) {
+	TexCacheEntry *entry = cacheIndex_.Get(cachekey);
+	if (!entry) {
 		return false;
 	}
-	TexCacheEntry *entry = iter->second.get();
 
 	bool success = false;
 	for (size_t i = 0, n = fbCache_.size(); i < n; ++i) {
@@ -978,11 +1176,18 @@ void TextureCacheCommon::NotifyConfigChanged() {
 	standardScaleFactor_ = scaleFactor;
 
 	replacer_.NotifyConfigChanged();
+	if (g_Config.bTexScalingDiskCache) {
+		scaledCache_.Init(g_paramSFO.GetDiscID());
+	} else {
+		scaledCache_.Shutdown();
+	}
 }
 
 void TextureCacheCommon::NotifyVideoUpload(u32 addr, int size, int width, GEBufferFormat fmt) {
 	addr &= 0x3FFFFFFF;
-	videos_[addr] = gpuStats.numFlips;
+	VideoInfo &info = videos_[addr];
+	info.flips = gpuStats.numFlips;
+	info.uploads++;
 }
 
 void TextureCacheCommon::LoadClut(u32 clutAddr, u32 loadBytes) {
@@ -1187,6 +1392,7 @@ static inline void ConvertFormatToRGBA8888(GEPaletteFormat format, u32 *dst, con
 }
 
 void TextureCacheCommon::DecodeTextureLevel(u8 *out, int outPitch, GETextureFormat format, GEPaletteFormat clutformat, uint32_t texaddr, int level, int bufw, bool reverseColors, bool useBGRA, bool expandTo32bit) {
+	const double decodeStart = real_time_now();
 	bool swizzled = gstate.isTextureSwizzled();
 	if ((texaddr & 0x00600000) != 0 && Memory::IsVRAMAddress(texaddr)) {
 		// This means it's in a mirror, possibly a swizzled mirror.  Let's report.
@@ -1207,6 +1413,8 @@ void TextureCacheCommon::DecodeTextureLevel(u8 *out, int outPitch, GETextureForm
 	{
 		const bool mipmapShareClut = gstate.isClutSharedForMipmaps();
 		const int clutSharingOffset = mipmapShareClut ? 0 : level * 16;
+		// The row kernels take a byte pitch, so they need an even bufw.
+		const bool simpleIndex = gstate.isClutIndexSimple() && (bufw & 1) == 0;
 
 		if (swizzled) {
 			tmpTexBuf32_.resize(bufw * ((h + 7) & ~7));
@@ -1235,9 +1443,15 @@ void TextureCacheCommon::DecodeTextureLevel(u8 *out, int outPitch, GETextureForm
 				if (expandTo32bit && !reverseColors) {
 					// We simply expand the CLUT to 32-bit, then we deindex as usual. Probably the fastest way.
 					ConvertFormatToRGBA8888(clutformat, expandClut_, clut, 16);
-					for (int y = 0; y < h; ++y) {
-						DeIndexTexture4((u32 *)(out + outPitch * y), texptr + (bufw * y) / 2, w, expandClut_);
+					if (simpleIndex) {
+						DeIndexTexture4Rows((u32 *)out, outPitch, texptr, bufw / 2, w, h, expandClut_);
+					} else {
+						for (int y = 0; y < h; ++y) {
+							DeIndexTexture4((u32 *)(out + outPitch * y), texptr + (bufw * y) / 2, w, expandClut_);
+						}
 					}
+				} else if (simpleIndex) {
+					DeIndexTexture4Rows((u16 *)out, outPitch, texptr, bufw / 2, w, h, clut);
 				} else {
 					for (int y = 0; y < h; ++y) {
 						DeIndexTexture4((u16 *)(out + outPitch * y), texptr + (bufw * y) / 2, w, clut);
@@ -1250,8 +1464,12 @@ void TextureCacheCommon::DecodeTextureLevel(u8 *out, int outPitch, GETextureForm
 		case GE_CMODE_32BIT_ABGR8888:
 		{
 			const u32 *clut = GetCurrentClut<u32>() + clutSharingOffset;
-			for (int y = 0; y < h; ++y) {
-				DeIndexTexture4((u32 *)(out + outPitch * y), texptr + (bufw * y) / 2, w, clut);
+			if (simpleIndex) {
+				DeIndexTexture4Rows((u32 *)out, outPitch, texptr, bufw / 2, w, h, clut);
+			} else {
+				for (int y = 0; y < h; ++y) {
+					DeIndexTexture4((u32 *)(out + outPitch * y), texptr + (bufw * y) / 2, w, clut);
+				}
 			}
 		}
 		break;
@@ -1425,6 +1643,8 @@ void TextureCacheCommon::DecodeTextureLevel(u8 *out, int outPitch, GETextureForm
 		ERROR_LOG_REPORT(G3D, "Unknown Texture Format %d!!!", format);
 		break;
 	}
+
+	TexCacheStats_Decode(format, real_time_now() - decodeStart);
 }
 
 void TextureCacheCommon::ReadIndexedTex(u8 *out, int outPitch, int level, const u8 *texptr, int bytesPerIndex, int bufw, bool expandTo32Bit) {
@@ -1527,7 +1747,7 @@ void TextureCacheCommon::ApplyTexture() {
 			// Update the hash on the texture.
 			int w = gstate.getTextureWidth(0);
 			int h = gstate.getTextureHeight(0);
-			entry->fullhash = QuickTexHash(replacer_, entry->addr, entry->bufw, w, h, GETextureFormat(entry->format), entry);
+			entry->fullhash = StripedTexHash(entry, w, h, false);
 
 			// TODO: Here we could check the secondary cache; maybe the texture is in there?
 			// We would need to abort the build if so.
@@ -1541,7 +1761,7 @@ void TextureCacheCommon::ApplyTexture() {
 		// Okay, this matched and didn't change - but let's check the hash.  Maybe it will change.
 		bool doDelete = true;
 		if (!CheckFullHash(entry, doDelete)) {
-			HandleTextureChange(entry, "hash fail", true, doDelete);
+			HandleTextureChange(entry, TexChangeReason::HASH_FAIL, true, doDelete);
 			nextNeedsRebuild_ = true;
 		} else if (nextTexture_ != nullptr) {
 			// The secondary cache may choose an entry from its storage by setting nextTexture_.
@@ -1579,31 +1799,164 @@ void TextureCacheCommon::Clear(bool delete_them) {
 	if (cache_.size() + secondCache_.size()) {
 		INFO_LOG(G3D, "Texture cached cleared from %i textures", (int)(cache_.size() + secondCache_.size()));
 		cache_.clear();
+		cacheIndex_.Clear();
 		secondCache_.clear();
 		cacheSizeEstimate_ = 0;
 		secondCacheSizeEstimate_ = 0;
 	}
+	replacedSizeEstimate_ = 0;
+	scaledSizeEstimate_ = 0;
+	MemoryUsage::Set(MemoryUsage::Category::TEXTURES, 0);
+	MemoryUsage::Set(MemoryUsage::Category::SCALED_TEXTURES, 0);
+	MemoryUsage::Set(MemoryUsage::Category::REPLACEMENT_TEXTURES, 0);
 	fbTexInfo_.clear();
 	videos_.clear();
+	DecimateDepalResults(true);
+
+	// Anything still being scaled was for a texture that's gone now.
+	std::lock_guard<std::mutex> guard(asyncScaleLock_);
+	asyncScaleGeneration_++;
+	for (AsyncScaleTask &task : asyncScaleDone_) {
+		FreeAlignedMemory(task.pixels);
+	}
+	asyncScaleDone_.clear();
+}
+
+void TextureCacheCommon::TrimForLowMemory() {
+	// This also limits upscaling and disables the secondary cache from now on.
+	lowMemoryMode_ = true;
+
+	ForgetLastTexture();
+	// Replacements are usually the largest textures. They'll be loaded again if still used.
+	for (TexCache::iterator iter = cache_.begin(); iter != cache_.end(); ) {
+		if (iter->second->replacedBytes != 0) {
+			DeleteTexture(iter++);
+		} else {
+			++iter;
+		}
+	}
+
+	decimationCounter_ = 0;
+	Decimate(true);
+}
+
+void TextureCacheCommon::SetReplacedSize(TexCacheEntry *entry, u32 bytes) {
+	replacedSizeEstimate_ += (s64)bytes - entry->replacedBytes;
+	entry->replacedBytes = bytes;
+}
+
+void TextureCacheCommon::SetScaledSize(TexCacheEntry *entry, int scaleFactor) {
+	u32 bytes = 0;
+	if (scaleFactor > 1) {
+		// Scaled textures are always 8888.
+		const u8 dimW = (entry->dim >> 0) & 0xf;
+		const u8 dimH = (entry->dim >> 8) & 0xf;
+		bytes = (4 << (dimW + dimH)) * scaleFactor * scaleFactor;
+	}
+	scaledSizeEstimate_ += (s64)bytes - entry->scaledBytes;
+	entry->scaledBytes = bytes;
 }
 
 void TextureCacheCommon::DeleteTexture(TexCache::iterator it) {
 	ReleaseTexture(it->second.get(), true);
+	SetReplacedSize(it->second.get(), 0);
+	SetScaledSize(it->second.get(), 1);
 	auto fbInfo = fbTexInfo_.find(it->first);
 	if (fbInfo != fbTexInfo_.end()) {
 		fbTexInfo_.erase(fbInfo);
 	}
 	cacheSizeEstimate_ -= EstimateTexMemoryUsage(it->second.get());
+	cacheIndex_.Remove(it->first);
+	cacheIndex_.Maintain();
 	cache_.erase(it);
 }
 
+// Hashes level 0 of the entry.  Large textures are hashed as stripes that are combined, so that
+// if allowPartial is set, only the stripes marked dirty by Invalidate() need to be read again.
+u32 TextureCacheCommon::StripedTexHash(TexCacheEntry *entry, int w, int h, bool allowPartial) {
+	const GETextureFormat format = GETextureFormat(entry->format);
+	const double hashStart = real_time_now();
+	if (replacer_.Enabled()) {
+		// The replacer's hash has to stay compatible with saved textures.
+		entry->stripedHashSize = 0;
+		u32 hash = QuickTexHash(replacer_, entry->addr, entry->bufw, w, h, format, entry);
+		TexCacheStats_Hash(entry->sizeInRAM, real_time_now() - hashStart);
+		return hash;
+	}
+
+	if (h == 512 && entry->maxSeenV < 512 && entry->maxSeenV != 0) {
+		h = (int)entry->maxSeenV;
+	}
+
+	const u32 sizeInRAM = (textureBitsPerPixel[format] * entry->bufw * h) / 8;
+	if (!Memory::IsValidAddress(entry->addr + sizeInRAM)) {
+		entry->stripedHashSize = 0;
+		return 0;
+	}
+	const u8 *checkp = Memory::GetPointer(entry->addr);
+
+	// Keep every stripe on the fast path of DoQuickTexHash (16-byte aligned, multiple of 64 bytes.)
+	const u32 stripeSize = (sizeInRAM / TexCacheEntry::HASH_STRIPES) & ~63;
+	if (sizeInRAM < TEXCACHE_MIN_STRIPED_HASH_SIZE || (entry->addr & 0xF) != 0 || stripeSize * TexCacheEntry::HASH_STRIPES != sizeInRAM) {
+		entry->stripedHashSize = 0;
+		u32 hash = DoQuickTexHash(checkp, sizeInRAM);
+		TexCacheStats_Hash(sizeInRAM, real_time_now() - hashStart);
+		return hash;
+	}
+
+	u32 dirty = 0xFFFF;
+	if (allowPartial && entry->stripedHashSize == sizeInRAM && entry->dirtyStripes != 0 && entry->dirtyStripes != 0xFFFF && entry->partialHashes < TEXCACHE_MAX_PARTIAL_HASHES) {
+		dirty = entry->dirtyStripes;
+		entry->partialHashes++;
+	} else {
+		entry->partialHashes = 0;
+	}
+
+	u32 fullhash = 0;
+	u32 hashedBytes = 0;
+	for (int i = 0; i < TexCacheEntry::HASH_STRIPES; ++i) {
+		if (dirty & (1 << i)) {
+			entry->stripeHashes[i] = DoQuickTexHash(checkp + i * stripeSize, stripeSize);
+			hashedBytes += stripeSize;
+		}
+		fullhash = ((fullhash << 5) | (fullhash >> 27)) ^ entry->stripeHashes[i];
+	}
+
+	entry->stripedHashSize = sizeInRAM;
+	entry->dirtyStripes = 0;
+	TexCacheStats_Hash(hashedBytes, real_time_now() - hashStart);
+	return fullhash;
+}
+
+void TextureCacheCommon::MarkDirtyStripes(TexCacheEntry *entry, u32 addr, u32 addr_end) {
+	if (entry->stripedHashSize == 0) {
+		return;
+	}
+
+	const u32 texAddr = entry->addr & 0x3FFFFFFF;
+	const u32 texEnd = texAddr + entry->stripedHashSize;
+	if (addr >= texEnd || addr_end <= texAddr) {
+		return;
+	}
+
+	const u32 stripeSize = entry->stripedHashSize / TexCacheEntry::HASH_STRIPES;
+	const u32 first = addr <= texAddr ? 0 : (addr - texAddr) / stripeSize;
+	const u32 last = addr_end >= texEnd ? TexCacheEntry::HASH_STRIPES - 1 : (addr_end - 1 - texAddr) / stripeSize;
+	for (u32 i = first; i <= last; ++i) {
+		entry->dirtyStripes |= 1 << i;
+	}
+}
+
 bool TextureCacheCommon::CheckFullHash(TexCacheEntry *entry, bool &doDelete) {
 	int w = gstate.getTextureWidth(0);
 	int h = gstate.getTextureHeight(0);
 	u32 fullhash;
 	{
 		PROFILE_THIS_SCOPE("texhash");
-		fullhash = QuickTexHash(replacer_, entry->addr, entry->bufw, w, h, GETextureFormat(entry->format), entry);
+		// Textures that keep changing are usually rewritten in place, often only partially.
+		// Only rehash what we were told about, with a full hash every so often as a safety net.
+		bool allowPartial = (entry->status & TexCacheEntry::STATUS_CHANGE_FREQUENT) != 0;
+		fullhash = StripedTexHash(entry, w, h, allowPartial);
 	}
 
 	if (fullhash == entry->fullhash) {
@@ -1654,6 +2007,8 @@ bool TextureCacheCommon::CheckFullHash(TexCacheEntry *entry, bool &doDelete) {
 				auto oldIter = secondCache_.find(secondKey);
 				if (oldIter != secondCache_.end()) {
 					ReleaseTexture(oldIter->second.get(), true);
+					SetReplacedSize(oldIter->second.get(), 0);
+					SetScaledSize(oldIter->second.get(), 1);
 				}
 
 				// Archive the entire texture entry as is, since we'll use its params if it is seen again.
@@ -1662,6 +2017,8 @@ bool TextureCacheCommon::CheckFullHash(TexCacheEntry *entry, bool &doDelete) {
 
 				// Make sure we don't delete the texture we just archived.
 				entry->texturePtr = nullptr;
+				entry->replacedBytes = 0;
+				entry->scaledBytes = 0;
 				doDelete = false;
 			}
 		}
@@ -1721,6 +2078,7 @@ void TextureCacheCommon::Invalidate(u32 addr, int size, GPUInvalidationType type
 					}
 				}
 				iter->second->framesUntilNextFullHash = 0;
+				MarkDirtyStripes(iter->second.get(), addr, addr_end);
 			} else if (!iter->second->framebuffer) {
 				iter->second->invalidHint++;
 			}
@@ -1746,7 +2104,157 @@ void TextureCacheCommon::InvalidateAll(GPUInvalidationType /*unused*/) {
 		if (!iter->second->framebuffer) {
 			iter->second->invalidHint++;
 		}
+		// We don't know what was written, so the next check can't skip any stripes.
+		iter->second->dirtyStripes = 0xFFFF;
+	}
+}
+
+bool TextureCacheCommon::CanScaleAsync() {
+	if (!asyncScaler_ || !g_Config.bTexScalingAsync || PSP_CoreParameter().compat.flags().SyncTextureScaling)
+		return false;
+	// The replacer wants to see the scaled texture as it's decoded.
+	return !replacer_.Enabled() && !IsFakeMipmapChange();
+}
+
+void TextureCacheCommon::QueueAsyncScale(const TexCacheEntry &entry, const void *pixels, size_t bytes, int w, int h, u32 fmt, int scaleFactor) {
+	AsyncScaleTask task;
+	task.cachekey = entry.CacheKey();
+	task.fullhash = entry.fullhash;
+	task.texturePtr = entry.texturePtr;
+	task.pixels = (u32 *)AllocateAlignedMemory(bytes, 16);
+	memcpy(task.pixels, pixels, bytes);
+	task.fmt = fmt;
+	task.w = w;
+	task.h = h;
+	task.scaleFactor = scaleFactor;
+
+	std::lock_guard<std::mutex> guard(asyncScaleLock_);
+	task.generation = asyncScaleGeneration_;
+	asyncScaleQueue_.push_back(task);
+	if (!asyncScaleThread_.joinable()) {
+		asyncScaleExit_ = false;
+		asyncScaleThread_ = std::thread([this] { AsyncScaleLoop(); });
+	}
+	asyncScaleCond_.notify_one();
+}
+
+void TextureCacheCommon::AsyncScaleLoop() {
+	setCurrentThreadName("TexScale");
+	setCurrentThreadRole(ThreadRole::BACKGROUND);
+
+	std::unique_lock<std::mutex> guard(asyncScaleLock_);
+	while (!asyncScaleExit_) {
+		if (asyncScaleQueue_.empty()) {
+			asyncScaleCond_.wait(guard);
+			continue;
+		}
+
+		AsyncScaleTask task = asyncScaleQueue_.front();
+		asyncScaleQueue_.erase(asyncScaleQueue_.begin());
+		if (task.generation != asyncScaleGeneration_) {
+			FreeAlignedMemory(task.pixels);
+			continue;
+		}
+
+		guard.unlock();
+		u32 *scaled = (u32 *)AllocateAlignedMemory(task.w * task.scaleFactor * task.h * task.scaleFactor * 4, 16);
+		ScaleCached(*asyncScaler_, task.cachekey, task.fullhash, 0, scaled, task.pixels, task.fmt, task.w, task.h, task.scaleFactor);
+		FreeAlignedMemory(task.pixels);
+		task.pixels = scaled;
+		guard.lock();
+
+		asyncScaleDone_.push_back(task);
+	}
+}
+
+void TextureCacheCommon::ScaleCached(TextureScalerCommon &scaler, u64 cachekey, u32 fullhash, int level, u32 *out, u32 *src, u32 &dstFmt, int &width, int &height, int factor) {
+	const double scaleStart = real_time_now();
+	const int texels = width * height;
+	if (!g_Config.bTexScalingDiskCache) {
+		scaler.ScaleAlways(out, src, dstFmt, width, height, factor);
+		TexCacheStats_Scale(texels, real_time_now() - scaleStart);
+		return;
+	}
+
+	ScaledTextureKey key{};
+	key.cachekey = cachekey;
+	key.fullhash = fullhash;
+	key.fmt = dstFmt;
+	key.w = (u16)width;
+	key.h = (u16)height;
+	key.level = (u8)level;
+	key.scaleFactor = (u8)factor;
+	key.scalingType = (u8)g_Config.iTexScalingType;
+	key.deposterize = g_Config.bTexDeposterize ? 1 : 0;
+
+	size_t bytes = width * factor * height * factor * sizeof(u32);
+	u32 cachedFmt;
+	if (scaledCache_.Lookup(key, out, bytes, &cachedFmt)) {
+		dstFmt = cachedFmt;
+		width *= factor;
+		height *= factor;
+		TexCacheStats_Scale(texels, real_time_now() - scaleStart);
+		return;
+	}
+
+	scaler.ScaleAlways(out, src, dstFmt, width, height, factor);
+	scaledCache_.Store(key, out, bytes, dstFmt);
+	TexCacheStats_Scale(texels, real_time_now() - scaleStart);
+}
+
+void TextureCacheCommon::UpdateReplacements() {
+	if (!replacer_.Enabled())
+		return;
+
+	std::vector<ReplacementCacheKey> loaded;
+	replacer_.GetLoadedReplacements(loaded);
+	for (const ReplacementCacheKey &key : loaded) {
+		TexCacheEntry *entry = cacheIndex_.Get(key.cachekey);
+		// The hash might have changed while it was loading, then it's not the same texture.
+		if (entry && entry->fullhash == key.hash) {
+			entry->status |= TexCacheEntry::STATUS_TO_REPLACE;
+		}
+	}
+}
+
+void TextureCacheCommon::UploadAsyncScaled() {
+	std::vector<AsyncScaleTask> done;
+	{
+		std::lock_guard<std::mutex> guard(asyncScaleLock_);
+		if (asyncScaleDone_.empty())
+			return;
+		done.swap(asyncScaleDone_);
+	}
+
+	// Upload everything that finished together, at the start of the frame.
+	for (AsyncScaleTask &task : done) {
+		TexCacheEntry *entry = cacheIndex_.Get(task.cachekey);
+		// Skip it if the texture was rebuilt with different contents or released meanwhile.
+		if (task.generation == asyncScaleGeneration_ && entry && entry->texturePtr == task.texturePtr && entry->fullhash == task.fullhash) {
+			UploadScaledTexture(entry, task);
+		}
+		FreeAlignedMemory(task.pixels);
+	}
+}
+
+void TextureCacheCommon::StopAsyncScaling() {
+	if (!asyncScaleThread_.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> guard(asyncScaleLock_);
+		asyncScaleExit_ = true;
+		asyncScaleCond_.notify_one();
+	}
+	asyncScaleThread_.join();
+
+	for (AsyncScaleTask &task : asyncScaleQueue_) {
+		FreeAlignedMemory(task.pixels);
+	}
+	for (AsyncScaleTask &task : asyncScaleDone_) {
+		FreeAlignedMemory(task.pixels);
 	}
+	asyncScaleQueue_.clear();
+	asyncScaleDone_.clear();
 }
 
 void TextureCacheCommon::ClearNextFrame() {
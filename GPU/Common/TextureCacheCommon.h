@@ -17,16 +17,23 @@
 
 #pragma once
 
+#include <condition_variable>
 #include <map>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 #include "Common/CommonTypes.h"
+#include "Common/Hashmaps.h"
 #include "Common/MemoryUtil.h"
+#include "Core/ScaledTextureCache.h"
 #include "Core/TextureReplacer.h"
 #include "Core/System.h"
 #include "GPU/Common/GPUDebugInterface.h"
+#include "GPU/Common/TextureCacheStats.h"
 #include "GPU/Common/TextureDecoder.h"
+#include "GPU/Common/TextureScalerCommon.h"
 
 enum TextureFiltering {
 	TEX_FILTER_AUTO = 1,
@@ -48,10 +55,16 @@ enum FramebufferNotification {
 
 #define TEXCACHE_MAX_TEXELS_SCALED (256*256)  // Per frame
 
+// Textures at least this large are hashed in stripes, so that writes we're told about only rehash what they touched.
+#define TEXCACHE_MIN_STRIPED_HASH_SIZE (64 * 1024)
+// After this many partial rehashes in a row, the whole texture is hashed again to catch unreported writes.
+#define TEXCACHE_MAX_PARTIAL_HASHES 8
+
 struct VirtualFramebuffer;
 
 namespace Draw {
 class DrawContext;
+class Framebuffer;
 }
 
 // Used by D3D11 and Vulkan, could be used by modern GL
@@ -94,8 +107,14 @@ struct TexCacheEntry {
 		if (texturePtr || textureName || vkTex)
 			Crash();
 	}
+	// Entries come and go constantly in some games, so they're pooled.
+	static void *operator new(size_t size);
+	static void operator delete(void *ptr);
+
 	// After marking STATUS_UNRELIABLE, if it stays the same this many frames we'll trust it again.
 	const static int FRAMES_REGAIN_TRUST = 1000;
+	// Number of separately hashed parts of large textures.
+	const static int HASH_STRIPES = 16;
 
 	enum TexStatus {
 		STATUS_HASHING = 0x00,
@@ -119,6 +138,7 @@ struct TexCacheEntry {
 		STATUS_FREE_CHANGE = 0x200,    // Allow one change before marking "frequent".
 
 		STATUS_BAD_MIPS = 0x400,       // Has bad or unusable mipmap levels.
+		STATUS_TO_REPLACE = 0x800,     // Replacement finished loading, rebuild to use it.
 	};
 
 	// Status, but int so we can zero initialize.
@@ -146,7 +166,14 @@ struct TexCacheEntry {
 	u32 framesUntilNextFullHash;
 	u32 fullhash;
 	u32 cluthash;
+	u32 videoUpload;  // Which video upload at addr this was built from, if any.
+	u32 replacedBytes;  // Size of the replacement texture currently loaded, if any.
+	u32 scaledBytes;  // Size of the upscaled texture currently loaded, if any.
 	u16 maxSeenV;
+	u16 dirtyStripes;  // Stripes written to since they were last hashed.
+	u32 stripedHashSize;  // Bytes covered by stripeHashes, or 0 if the last hash wasn't striped.
+	u32 partialHashes;  // Partial rehashes since the last full one.
+	u32 stripeHashes[HASH_STRIPES];
 
 	TexStatus GetHashStatus() {
 		return TexStatus(status & STATUS_MASK);
@@ -172,9 +199,25 @@ struct TexCacheEntry {
 	static u64 CacheKey(u32 addr, u8 format, u16 dim, u32 cluthash);
 };
 
+// A depalettized copy of a framebuffer, reused until the framebuffer or the CLUT changes.
+struct DepalResult {
+	Draw::Framebuffer *fbo;
+	VirtualFramebuffer *framebuffer;
+	u32 generation;
+	u32 clutHash;
+	u32 clutMode;
+	GEBufferFormat format;
+	u16 w;
+	u16 h;
+	// The region that was depalettized, or all zero for the whole framebuffer.
+	int bounds[4];
+	int lastFrame;
+};
+
 class FramebufferManagerCommon;
 // Can't be unordered_map, we use lower_bound ... although for some reason that compiles on MSVC.
 // Would really like to replace this with DenseHashMap but can't as long as we need lower_bound.
+// So exact lookups go through a DenseHashMap index instead, see cacheIndex_.
 typedef std::map<u64, std::unique_ptr<TexCacheEntry>> TexCache;
 
 class TextureCacheCommon {
@@ -188,6 +231,7 @@ class TextureCacheCommon {
 	void SetTexture(bool force = false);
 	void ApplyTexture();
 	bool SetOffsetTexture(u32 offset);
+	bool HasTextureAt(u32 addr) const;
 	void Invalidate(u32 addr, int size, GPUInvalidationType type);
 	void InvalidateAll(GPUInvalidationType type);
 	void ClearNextFrame();
@@ -195,6 +239,8 @@ class TextureCacheCommon {
 	virtual void ForgetLastTexture() = 0;
 	virtual void InvalidateLastTexture(TexCacheEntry *entry = nullptr) = 0;
 	virtual void Clear(bool delete_them);
+	// The OS is low on memory. Drops what we can and switches to low memory mode for good.
+	virtual void TrimForLowMemory();
 
 	// FramebufferManager keeps TextureCache updated about what regions of memory are being rendered to.
 	void NotifyFramebuffer(u32 address, VirtualFramebuffer *framebuffer, FramebufferNotification msg);
@@ -220,10 +266,13 @@ class TextureCacheCommon {
 	virtual void Unbind() = 0;
 	virtual void ReleaseTexture(TexCacheEntry *entry, bool delete_them) = 0;
 	void DeleteTexture(TexCache::iterator it);
+	// Replacement textures are usually much larger than the original, so they're counted separately.
+	void SetReplacedSize(TexCacheEntry *entry, u32 bytes);
+	void SetScaledSize(TexCacheEntry *entry, int scaleFactor);
 	void Decimate(bool forcePressure = false);
 
 	virtual void ApplyTextureFramebuffer(TexCacheEntry *entry, VirtualFramebuffer *framebuffer) = 0;
-	void HandleTextureChange(TexCacheEntry *const entry, const char *reason, bool initialMatch, bool doDelete);
+	void HandleTextureChange(TexCacheEntry *const entry, TexChangeReason reason, bool initialMatch, bool doDelete);
 	virtual void BuildTexture(TexCacheEntry *const entry) = 0;
 	virtual void UpdateCurrentClut(GEPaletteFormat clutFormat, u32 clutBase, bool clutIndexIsSimple) = 0;
 	bool CheckFullHash(TexCacheEntry *entry, bool &doDelete);
@@ -234,6 +283,11 @@ class TextureCacheCommon {
 		u32 yOffset;
 	};
 
+	struct VideoInfo {
+		int flips;
+		u32 uploads;
+	};
+
 	void DecodeTextureLevel(u8 *out, int outPitch, GETextureFormat format, GEPaletteFormat clutformat, uint32_t texaddr, int level, int bufw, bool reverseColors, bool useBGRA, bool expandTo32Bit);
 	void UnswizzleFromMem(u32 *dest, u32 destPitch, const u8 *texptr, u32 bufw, u32 height, u32 bytesPerPixel);
 	void ReadIndexedTex(u8 *out, int outPitch, int level, const u8 *texptr, int bytesPerIndex, int bufw, bool expandTo32Bit);
@@ -256,6 +310,11 @@ class TextureCacheCommon {
 	void SetTextureFramebuffer(TexCacheEntry *entry, VirtualFramebuffer *framebuffer);
 
 	void DecimateVideos();
+	void DecimateToBudget();
+
+	// Returns where to depalettize the framebuffer to.  If valid is set, it already holds the result.
+	Draw::Framebuffer *GetDepalResult(VirtualFramebuffer *framebuffer, bool *valid);
+	void DecimateDepalResults(bool all);
 
 	inline u32 QuickTexHash(TextureReplacer &replacer, u32 addr, int bufw, int w, int h, GETextureFormat format, TexCacheEntry *entry) const {
 		if (replacer.Enabled()) {
@@ -276,12 +335,50 @@ class TextureCacheCommon {
 		}
 	}
 
+	// Upscaling done on a worker thread.  The backend uploads the unscaled texture right away,
+	// and UploadScaledTexture() replaces it once the scaled one is ready.
+	struct AsyncScaleTask {
+		u64 cachekey;
+		u32 fullhash;
+		void *texturePtr;
+		int generation;
+		u32 *pixels;  // Unscaled input, then the scaled output.  Owned by the task unless cleared.
+		u32 fmt;
+		int w;
+		int h;
+		int scaleFactor;
+	};
+
+	bool CanScaleAsync();
+	void QueueAsyncScale(const TexCacheEntry &entry, const void *pixels, size_t bytes, int w, int h, u32 fmt, int scaleFactor);
+	void UploadAsyncScaled();
+	void UpdateReplacements();
+	void StopAsyncScaling();
+	void AsyncScaleLoop();
+	virtual void UploadScaledTexture(TexCacheEntry *entry, AsyncScaleTask &task) {}
+	// Same as scaler.ScaleAlways(), but reuses scaled results from earlier runs when possible.
+	void ScaleCached(TextureScalerCommon &scaler, u64 cachekey, u32 fullhash, int level, u32 *out, u32 *src, u32 &dstFmt, int &width, int &height, int factor);
+
+	u32 StripedTexHash(TexCacheEntry *entry, int w, int h, bool allowPartial);
+	void MarkDirtyStripes(TexCacheEntry *entry, u32 addr, u32 addr_end);
+
 	static inline u32 MiniHash(const u32 *ptr) {
 		return ptr[0];
 	}
 
 	Draw::DrawContext *draw_;
+
+	// Set by backends that implement UploadScaledTexture().  Only used on asyncScaleThread_.
+	std::unique_ptr<TextureScalerCommon> asyncScaler_;
+	std::thread asyncScaleThread_;
+	std::mutex asyncScaleLock_;
+	std::condition_variable asyncScaleCond_;
+	std::vector<AsyncScaleTask> asyncScaleQueue_;
+	std::vector<AsyncScaleTask> asyncScaleDone_;
+	int asyncScaleGeneration_ = 0;
+	bool asyncScaleExit_ = false;
 	TextureReplacer replacer_;
+	ScaledTextureCache scaledCache_;
 	FramebufferManagerCommon *framebufferManager_;
 
 	bool clearCacheNextFrame_;
@@ -292,15 +389,20 @@ class TextureCacheCommon {
 	int timesInvalidatedAllThisFrame_;
 
 	TexCache cache_;
+	// Same entries as cache_, for fast exact lookups in SetTexture. Keep in sync with cache_.
+	DenseHashMap<u64, TexCacheEntry *, nullptr> cacheIndex_;
 	u32 cacheSizeEstimate_;
 
 	TexCache secondCache_;
 	u32 secondCacheSizeEstimate_;
+	s64 replacedSizeEstimate_ = 0;
+	s64 scaledSizeEstimate_ = 0;
 
 	std::vector<VirtualFramebuffer *> fbCache_;
 	std::map<u64, AttachedFramebufferInfo> fbTexInfo_;
 
-	std::map<u32, int> videos_;
+	std::map<u32, VideoInfo> videos_;
+	std::vector<DepalResult> depalResults_;
 
 	SimpleBuf<u32> tmpTexBuf32_;
 	SimpleBuf<u16> tmpTexBuf16_;
@@ -326,7 +428,7 @@ class TextureCacheCommon {
 
 	int standardScaleFactor_;
 
-	const char *nextChangeReason_;
+	TexChangeReason nextChangeReason_;
 	bool nextNeedsRehash_;
 	bool nextNeedsChange_;
 	bool nextNeedsRebuild_;
@@ -0,0 +1,158 @@
+// Copyright (c) 2020- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+#include "GPU/Common/TextureCacheStats.h"
+
+// Only touched by the emu thread, so no locking until the frame ends.
+static TexCacheFrameStats current;
+// Except for scaling, which the async scaler does on its own thread.
+static std::atomic<int> currentScales{ 0 };
+static std::atomic<int64_t> currentTexelsScaled{ 0 };
+static std::atomic<int64_t> currentScaleMicros{ 0 };
+
+static std::mutex historyLock;
+static TexCacheFrameStats history[TEXCACHE_STATS_HISTORY];
+static int historyCount = 0;
+static int historyNext = 0;
+
+const char *TexChangeReasonName(TexChangeReason reason) {
+	switch (reason) {
+	case TexChangeReason::PARAMS: return "different params";
+	case TexChangeReason::DETACHED_FRAMEBUFFER: return "detached framebuf";
+	case TexChangeReason::VIDEO_FRAME: return "video frame";
+	case TexChangeReason::SCALING: return "scaling";
+	case TexChangeReason::REPLACING: return "replacing";
+	case TexChangeReason::HASH_FAIL: return "hash fail";
+	default: return "N/A";
+	}
+}
+
+const char *TexCacheFormatName(int format) {
+	static const char *const names[] = {
+		"5650", "5551", "4444", "8888", "CLUT4", "CLUT8", "CLUT16", "CLUT32", "DXT1", "DXT3", "DXT5",
+	};
+	if (format < 0 || format >= (int)(sizeof(names) / sizeof(names[0])))
+		return "N/A";
+	return names[format];
+}
+
+void TexCacheStats_Lookup() {
+	current.lookups++;
+}
+
+void TexCacheStats_Hit() {
+	current.hits++;
+}
+
+void TexCacheStats_NewEntry() {
+	current.newEntries++;
+}
+
+void TexCacheStats_Change(TexChangeReason reason) {
+	current.changes[(int)reason]++;
+}
+
+void TexCacheStats_Hash(uint32_t bytes, double seconds) {
+	current.hashes++;
+	current.bytesHashed += bytes;
+	current.hashMs += seconds * 1000.0;
+}
+
+void TexCacheStats_Decode(GETextureFormat format, double seconds) {
+	int index = (int)format & (TEXCACHE_STATS_FORMATS - 1);
+	current.decodes[index]++;
+	current.decodeMs[index] += seconds * 1000.0;
+}
+
+void TexCacheStats_Scale(int texels, double seconds) {
+	currentScales++;
+	currentTexelsScaled += texels;
+	currentScaleMicros += (int64_t)(seconds * 1000000.0);
+}
+
+void TexCacheStats_EndFrame() {
+	current.scales = currentScales.exchange(0);
+	current.texelsScaled = currentTexelsScaled.exchange(0);
+	current.scaleMs = currentScaleMicros.exchange(0) / 1000.0;
+
+	{
+		std::lock_guard<std::mutex> guard(historyLock);
+		history[historyNext] = current;
+		historyNext = (historyNext + 1) % TEXCACHE_STATS_HISTORY;
+		if (historyCount < TEXCACHE_STATS_HISTORY)
+			historyCount++;
+	}
+	memset(&current, 0, sizeof(current));
+}
+
+double TexCacheStats_FrameMs(const TexCacheFrameStats &frame) {
+	double ms = frame.hashMs + frame.scaleMs;
+	for (int i = 0; i < TEXCACHE_STATS_FORMATS; ++i)
+		ms += frame.decodeMs[i];
+	return ms;
+}
+
+static void AddFrameStats(TexCacheFrameStats &sum, const TexCacheFrameStats &frame) {
+	sum.lookups += frame.lookups;
+	sum.hits += frame.hits;
+	sum.newEntries += frame.newEntries;
+	for (int i = 0; i < (int)TexChangeReason::COUNT; ++i)
+		sum.changes[i] += frame.changes[i];
+	sum.hashes += frame.hashes;
+	sum.bytesHashed += frame.bytesHashed;
+	sum.hashMs += frame.hashMs;
+	for (int i = 0; i < TEXCACHE_STATS_FORMATS; ++i) {
+		sum.decodes[i] += frame.decodes[i];
+		sum.decodeMs[i] += frame.decodeMs[i];
+	}
+	sum.scales += frame.scales;
+	sum.texelsScaled += frame.texelsScaled;
+	sum.scaleMs += frame.scaleMs;
+}
+
+TextureCacheStats TexCacheStats_Get() {
+	TextureCacheStats stats;
+	memset(&stats, 0, sizeof(stats));
+
+	std::lock_guard<std::mutex> guard(historyLock);
+	stats.frames = historyCount;
+	if (historyCount == 0)
+		return stats;
+
+	stats.last = history[(historyNext + TEXCACHE_STATS_HISTORY - 1) % TEXCACHE_STATS_HISTORY];
+	for (int i = 0; i < historyCount; ++i) {
+		const TexCacheFrameStats &frame = history[i];
+		AddFrameStats(stats.sum, frame);
+
+		double ms = TexCacheStats_FrameMs(frame);
+		int bucket = 0;
+		for (double limit = 0.25; bucket < TEXCACHE_STATS_BUCKETS - 1 && ms >= limit; limit *= 2.0)
+			bucket++;
+		stats.msHistogram[bucket]++;
+	}
+	return stats;
+}
+
+void TexCacheStats_Reset() {
+	std::lock_guard<std::mutex> guard(historyLock);
+	historyCount = 0;
+	historyNext = 0;
+}
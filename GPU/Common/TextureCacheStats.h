@@ -0,0 +1,89 @@
+// Copyright (c) 2020- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <cstdint>
+
+#include "GPU/ge_constants.h"
+
+// Counts what the texture cache does each frame and keeps a short history, to see which games
+// thrash it and why.
+
+// Why an existing entry had to be rebuilt (see TextureCacheCommon::HandleTextureChange.)
+enum class TexChangeReason {
+	PARAMS,
+	DETACHED_FRAMEBUFFER,
+	VIDEO_FRAME,
+	SCALING,
+	REPLACING,
+	HASH_FAIL,
+	COUNT,
+};
+
+const char *TexChangeReasonName(TexChangeReason reason);
+const char *TexCacheFormatName(int format);
+
+enum {
+	TEXCACHE_STATS_FORMATS = 16,
+	TEXCACHE_STATS_HISTORY = 120,
+	TEXCACHE_STATS_BUCKETS = 8,
+};
+
+struct TexCacheFrameStats {
+	int lookups;
+	int hits;
+	int newEntries;
+	int changes[(int)TexChangeReason::COUNT];
+
+	int hashes;
+	int64_t bytesHashed;
+	double hashMs;
+
+	int decodes[TEXCACHE_STATS_FORMATS];
+	double decodeMs[TEXCACHE_STATS_FORMATS];
+
+	int scales;
+	int64_t texelsScaled;
+	double scaleMs;
+};
+
+struct TextureCacheStats {
+	// How many frames sum and histogram cover, up to TEXCACHE_STATS_HISTORY.
+	int frames;
+	TexCacheFrameStats last;
+	TexCacheFrameStats sum;
+	// Frames by time spent hashing, decoding and scaling, in buckets doubling from 0.25ms.
+	// The last bucket is everything over 16ms.
+	int msHistogram[TEXCACHE_STATS_BUCKETS];
+};
+
+// Emu thread.
+void TexCacheStats_Lookup();
+void TexCacheStats_Hit();
+void TexCacheStats_NewEntry();
+void TexCacheStats_Change(TexChangeReason reason);
+void TexCacheStats_Hash(uint32_t bytes, double seconds);
+void TexCacheStats_Decode(GETextureFormat format, double seconds);
+// Any thread, scaling can happen in the background.
+void TexCacheStats_Scale(int texels, double seconds);
+// Emu thread, at the start of each frame.
+void TexCacheStats_EndFrame();
+
+double TexCacheStats_FrameMs(const TexCacheFrameStats &frame);
+TextureCacheStats TexCacheStats_Get();
+void TexCacheStats_Reset();
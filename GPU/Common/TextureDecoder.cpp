@@ -29,6 +29,9 @@
 
 #ifdef _M_SSE
 #include <emmintrin.h>
+#if _M_SSE >= 0x301
+#include <tmmintrin.h>
+#endif
 #if _M_SSE >= 0x401
 #include <smmintrin.h>
 #endif
@@ -330,6 +333,132 @@ void SetupTextureDecoder() {
 #endif
 }
 
+#if _M_SSE >= 0x301
+// Splits the 16 CLUT entries into byte planes, so each plane is one shuffle lookup.
+template <typename ClutT>
+static void LoadClutPlanesSSSE3(__m128i *planes, const ClutT *clut) {
+	alignas(16) u8 bytes[sizeof(ClutT)][16];
+	for (int i = 0; i < 16; ++i) {
+		for (int b = 0; b < (int)sizeof(ClutT); ++b)
+			bytes[b][i] = (u8)(clut[i] >> (b * 8));
+	}
+	for (int b = 0; b < (int)sizeof(ClutT); ++b)
+		planes[b] = _mm_load_si128((const __m128i *)bytes[b]);
+}
+
+static void DeIndexTexture4SSSE3(u16 *dest, const u8 *indexed, int length, const __m128i *planes, const u16 *clut) {
+	const __m128i mask = _mm_set1_epi8(0x0F);
+	int i = 0;
+	for (; i + 32 <= length; i += 32) {
+		const __m128i packed = _mm_loadu_si128((const __m128i *)(indexed + i / 2));
+		const __m128i lo = _mm_and_si128(packed, mask);
+		const __m128i hi = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+		// Low nibble is the first pixel.
+		const __m128i idx[2] = { _mm_unpacklo_epi8(lo, hi), _mm_unpackhi_epi8(lo, hi) };
+		for (int j = 0; j < 2; ++j) {
+			const __m128i b0 = _mm_shuffle_epi8(planes[0], idx[j]);
+			const __m128i b1 = _mm_shuffle_epi8(planes[1], idx[j]);
+			_mm_storeu_si128((__m128i *)(dest + i + j * 16), _mm_unpacklo_epi8(b0, b1));
+			_mm_storeu_si128((__m128i *)(dest + i + j * 16 + 8), _mm_unpackhi_epi8(b0, b1));
+		}
+	}
+	for (; i < length; ++i)
+		dest[i] = clut[(indexed[i / 2] >> ((i & 1) * 4)) & 0xF];
+}
+
+static void DeIndexTexture4SSSE3(u32 *dest, const u8 *indexed, int length, const __m128i *planes, const u32 *clut) {
+	const __m128i mask = _mm_set1_epi8(0x0F);
+	int i = 0;
+	for (; i + 32 <= length; i += 32) {
+		const __m128i packed = _mm_loadu_si128((const __m128i *)(indexed + i / 2));
+		const __m128i lo = _mm_and_si128(packed, mask);
+		const __m128i hi = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+		const __m128i idx[2] = { _mm_unpacklo_epi8(lo, hi), _mm_unpackhi_epi8(lo, hi) };
+		for (int j = 0; j < 2; ++j) {
+			const __m128i b0 = _mm_shuffle_epi8(planes[0], idx[j]);
+			const __m128i b1 = _mm_shuffle_epi8(planes[1], idx[j]);
+			const __m128i b2 = _mm_shuffle_epi8(planes[2], idx[j]);
+			const __m128i b3 = _mm_shuffle_epi8(planes[3], idx[j]);
+			const __m128i b01lo = _mm_unpacklo_epi8(b0, b1);
+			const __m128i b01hi = _mm_unpackhi_epi8(b0, b1);
+			const __m128i b23lo = _mm_unpacklo_epi8(b2, b3);
+			const __m128i b23hi = _mm_unpackhi_epi8(b2, b3);
+			__m128i *out = (__m128i *)(dest + i + j * 16);
+			_mm_storeu_si128(out + 0, _mm_unpacklo_epi16(b01lo, b23lo));
+			_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(b01lo, b23lo));
+			_mm_storeu_si128(out + 2, _mm_unpacklo_epi16(b01hi, b23hi));
+			_mm_storeu_si128(out + 3, _mm_unpackhi_epi16(b01hi, b23hi));
+		}
+	}
+	for (; i < length; ++i)
+		dest[i] = clut[(indexed[i / 2] >> ((i & 1) * 4)) & 0xF];
+}
+#endif
+
+template <typename ClutT, typename PairT>
+static void DeIndexTexture4Pairs(ClutT *dest, int destPitch, const u8 *indexed, int indexPitch, int w, int h, const ClutT *clut) {
+	// Each index byte is two pixels, so look both up at once.
+	PairT pairs[256];
+	for (int i = 0; i < 256; ++i)
+		pairs[i] = (PairT)clut[i & 0xF] | ((PairT)clut[i >> 4] << (sizeof(ClutT) * 8));
+
+	for (int y = 0; y < h; ++y) {
+		const u8 *src = indexed + indexPitch * y;
+		ClutT *row = (ClutT *)((u8 *)dest + destPitch * y);
+		for (int x = 0; x < w / 2; ++x)
+			memcpy(row + x * 2, &pairs[src[x]], sizeof(PairT));
+		if (w & 1)
+			row[w - 1] = clut[src[w / 2] & 0xF];
+	}
+}
+
+template <typename ClutT>
+static void DeIndexTexture4Row(ClutT *dest, const u8 *indexed, int length, const ClutT *clut) {
+	for (int i = 0; i + 1 < length; i += 2) {
+		const u8 index = indexed[i / 2];
+		dest[i + 0] = clut[index & 0xF];
+		dest[i + 1] = clut[index >> 4];
+	}
+	if (length & 1)
+		dest[length - 1] = clut[indexed[length / 2] & 0xF];
+}
+
+template <typename ClutT, typename PairT>
+static void DeIndexTexture4RowsImpl(ClutT *dest, int destPitch, const u8 *indexed, int indexPitch, int w, int h, const ClutT *clut) {
+#if PPSSPP_ARCH(ARM64)
+	for (int y = 0; y < h; ++y)
+		DeIndexTexture4NEON((ClutT *)((u8 *)dest + destPitch * y), indexed + indexPitch * y, w, clut);
+#elif _M_SSE >= 0x301
+	__m128i planes[sizeof(ClutT)];
+	LoadClutPlanesSSSE3(planes, clut);
+	for (int y = 0; y < h; ++y)
+		DeIndexTexture4SSSE3((ClutT *)((u8 *)dest + destPitch * y), indexed + indexPitch * y, w, planes, clut);
+#else
+#if PPSSPP_ARCH(ARM_NEON)
+	if (cpu_info.bNEON) {
+		for (int y = 0; y < h; ++y)
+			DeIndexTexture4NEON((ClutT *)((u8 *)dest + destPitch * y), indexed + indexPitch * y, w, clut);
+		return;
+	}
+#endif
+	// Building the pair table costs about as much as 512 pixels.
+	if (w * h >= 2048) {
+		DeIndexTexture4Pairs<ClutT, PairT>(dest, destPitch, indexed, indexPitch, w, h, clut);
+	} else {
+		for (int y = 0; y < h; ++y)
+			DeIndexTexture4Row((ClutT *)((u8 *)dest + destPitch * y), indexed + indexPitch * y, w, clut);
+	}
+#endif
+}
+
+void DeIndexTexture4Rows(u16 *dest, int destPitch, const u8 *indexed, int indexPitch, int w, int h, const u16 *clut) {
+	DeIndexTexture4RowsImpl<u16, u32>(dest, destPitch, indexed, indexPitch, w, h, clut);
+}
+
+void DeIndexTexture4Rows(u32 *dest, int destPitch, const u8 *indexed, int indexPitch, int w, int h, const u32 *clut) {
+	DeIndexTexture4RowsImpl<u32, u64>(dest, destPitch, indexed, indexPitch, w, h, clut);
+}
+
 // S3TC / DXT Decoder
 class DXTDecoder {
 public:
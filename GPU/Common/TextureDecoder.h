@@ -220,6 +220,11 @@ inline void DeIndexTexture4OptimalRev(u16 *dest, const u8 *indexed, int length,
 	}
 }
 
+// Expands h rows of 4-bit indices through the first 16 CLUT entries. Pitches are in bytes.
+// Only valid when gstate.isClutIndexSimple(), and handles odd widths without writing past the row.
+void DeIndexTexture4Rows(u16 *dest, int destPitch, const u8 *indexed, int indexPitch, int w, int h, const u16 *clut);
+void DeIndexTexture4Rows(u32 *dest, int destPitch, const u8 *indexed, int indexPitch, int w, int h, const u32 *clut);
+
 template <typename ClutT>
 inline void DeIndexTexture4(ClutT *dest, const u32 texaddr, int length, const ClutT *clut) {
 	const u8 *indexed = (const u8 *) Memory::GetPointer(texaddr);
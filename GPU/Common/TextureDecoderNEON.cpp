@@ -162,6 +162,60 @@ void DoUnswizzleTex16NEON(const u8 *texptr, u32 *ydestp, int bxc, int byc, u32 p
 	}
 }
 
+// Looks up 16 nibble indices in a 16 byte table.
+static inline uint8x16_t LookupNibblesNEON(uint8x16_t table, uint8x16_t idx) {
+#if PPSSPP_ARCH(ARM64)
+	return vqtbl1q_u8(table, idx);
+#else
+	uint8x8x2_t t;
+	t.val[0] = vget_low_u8(table);
+	t.val[1] = vget_high_u8(table);
+	return vcombine_u8(vtbl2_u8(t, vget_low_u8(idx)), vtbl2_u8(t, vget_high_u8(idx)));
+#endif
+}
+
+void DeIndexTexture4NEON(u16 *dest, const u8 *indexed, int length, const u16 *clut) {
+	// Deinterleave into a table of low bytes and one of high bytes.
+	const uint8x16x2_t planes = vld2q_u8((const u8 *)clut);
+	const uint8x16_t mask = vdupq_n_u8(0x0F);
+
+	int i = 0;
+	for (; i + 32 <= length; i += 32) {
+		const uint8x16_t packed = vld1q_u8(indexed + i / 2);
+		// Low nibble is the first pixel.
+		const uint8x16x2_t idx = vzipq_u8(vandq_u8(packed, mask), vshrq_n_u8(packed, 4));
+		for (int j = 0; j < 2; ++j) {
+			uint8x16x2_t out;
+			out.val[0] = LookupNibblesNEON(planes.val[0], idx.val[j]);
+			out.val[1] = LookupNibblesNEON(planes.val[1], idx.val[j]);
+			vst2q_u8((u8 *)(dest + i + j * 16), out);
+		}
+	}
+	for (; i < length; ++i)
+		dest[i] = clut[(indexed[i / 2] >> ((i & 1) * 4)) & 0xF];
+}
+
+void DeIndexTexture4NEON(u32 *dest, const u8 *indexed, int length, const u32 *clut) {
+	const uint8x16x4_t planes = vld4q_u8((const u8 *)clut);
+	const uint8x16_t mask = vdupq_n_u8(0x0F);
+
+	int i = 0;
+	for (; i + 32 <= length; i += 32) {
+		const uint8x16_t packed = vld1q_u8(indexed + i / 2);
+		const uint8x16x2_t idx = vzipq_u8(vandq_u8(packed, mask), vshrq_n_u8(packed, 4));
+		for (int j = 0; j < 2; ++j) {
+			uint8x16x4_t out;
+			out.val[0] = LookupNibblesNEON(planes.val[0], idx.val[j]);
+			out.val[1] = LookupNibblesNEON(planes.val[1], idx.val[j]);
+			out.val[2] = LookupNibblesNEON(planes.val[2], idx.val[j]);
+			out.val[3] = LookupNibblesNEON(planes.val[3], idx.val[j]);
+			vst4q_u8((u8 *)(dest + i + j * 16), out);
+		}
+	}
+	for (; i < length; ++i)
+		dest[i] = clut[(indexed[i / 2] >> ((i & 1) * 4)) & 0xF];
+}
+
 // NOTE: This is just a NEON version of xxhash.
 // GCC sucks at making things NEON and can't seem to handle it.
 
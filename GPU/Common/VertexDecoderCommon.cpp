@@ -23,6 +23,9 @@
 
 #include "Common/CPUDetect.h"
 #include "Common/ColorConv.h"
+#include "Common/PerfMap.h"
+#include "Common/StringUtils.h"
+#include "Common/ThreadPools.h"
 #include "Core/Config.h"
 #include "Core/ConfigValues.h"
 #include "Core/MemMap.h"
@@ -1084,6 +1087,7 @@ void VertexDecoder::SetVertexType(u32 fmt, const VertexDecoderOptions &options,
 	}
 
 	bool skinInDecode = weighttype != 0 && g_Config.bSoftwareSkinning;
+	skinInDecode_ = skinInDecode;
 
 	if (weighttype) { // && nweights?
 		weightoff = size;
@@ -1270,6 +1274,8 @@ void VertexDecoder::SetVertexType(u32 fmt, const VertexDecoderOptions &options,
 		jitted_ = jitCache->Compile(*this, &jittedSize_);
 		if (!jitted_) {
 			WARN_LOG(G3D, "Vertex decoder JIT failed! fmt = %08x (%s)", fmt_, GetString(SHADER_STRING_SHORT_DESC).c_str());
+		} else if (PerfMapEnabled()) {
+			PerfMapAddCode((const void *)jitted_, jittedSize_, StringFromFormat("VertexDecoder_%08x", fmt_));
 		}
 	}
 }
@@ -1305,6 +1311,25 @@ void VertexDecoder::DecodeVerts(u8 *decodedptr, const void *verts, int indexLowe
 	}
 }
 
+void VertexDecoder::DecodeVertsParallel(u8 *decodedptr, const void *verts, int indexLowerBound, int indexUpperBound) const {
+	_dbg_assert_msg_(G3D, CanDecodeInParallel(), "Decoder can't run in parallel");
+
+	const int count = indexUpperBound - indexLowerBound + 1;
+	const int stride = decFmt.stride;
+	if (((uintptr_t)verts & (biggest - 1)) != 0) {
+		memset(decodedptr, 0, count * stride);
+		return;
+	}
+
+	// Don't touch decoded_ / ptr_ here, every slice works on its own pointers.
+	const u8 *src = (const u8 *)verts + indexLowerBound * size;
+	const int srcSize = size;
+	JittedVertexDecoder jitted = jitted_;
+	GlobalThreadPool::Loop([=](int lower, int upper) {
+		jitted(src + lower * srcSize, decodedptr + lower * stride, upper - lower);
+	}, 0, count);
+}
+
 static const char *posnames[4] = { "?", "s8", "s16", "f" };
 static const char *nrmnames[4] = { "", "s8", "s16", "f" };
 static const char *tcnames[4] = { "", "u8", "u16", "f" };
@@ -455,6 +455,12 @@ class VertexDecoder {
 
 	void DecodeVerts(u8 *decoded, const void *verts, int indexLowerBound, int indexUpperBound) const;
 
+	// The jitted decoders keep all per-vertex state in registers, except when skinning in software,
+	// where the bones are staged in static buffers. If this returns true, DecodeVertsParallel() is safe.
+	bool CanDecodeInParallel() const { return jitted_ != nullptr && !skinInDecode_; }
+	// Splits the range over the global thread pool. Output layout is the same as DecodeVerts().
+	void DecodeVertsParallel(u8 *decoded, const void *verts, int indexLowerBound, int indexUpperBound) const;
+
 	bool hasColor() const { return col != 0; }
 	bool hasTexcoord() const { return tc != 0; }
 	int VertexSize() const { return size; }  // PSP format size
@@ -585,6 +591,7 @@ class VertexDecoder {
 	u8 nweights;
 
 	u8 biggest;  // in practice, alignment.
+	bool skinInDecode_ = false;
 
 	friend class VertexDecoderJitCache;
 };
@@ -698,6 +705,10 @@ class VertexDecoderJitCache : public FakeGen::FakeXCodeBlock {
 	void Jit_AnyS8Morph(int srcoff, int dstoff);
 	void Jit_AnyS16Morph(int srcoff, int dstoff);
 	void Jit_AnyFloatMorph(int srcoff, int dstoff);
+#if PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
+	void Jit_AddSkinWeight(Gen::X64Reg weight, bool first);
+	void Jit_AddMorphWeight(Gen::X64Reg reg, bool first);
+#endif
 
 	const VertexDecoder *dec_;
 #if PPSSPP_ARCH(ARM64)
@@ -534,29 +534,7 @@ void VertexDecoderJitCache::Jit_WeightsU8Skin() {
 		MULSS(weight, M(&by128));  // rip accessible (x86)
 		SHUFPS(weight, R(weight), _MM_SHUFFLE(0, 0, 0, 0));
 #endif
-		if (j == 0) {
-			MOVAPS(XMM4, MDisp(tempReg2, 0));
-			MOVAPS(XMM5, MDisp(tempReg2, 16));
-			MOVAPS(XMM6, MDisp(tempReg2, 32));
-			MOVAPS(XMM7, MDisp(tempReg2, 48));
-			MULPS(XMM4, R(weight));
-			MULPS(XMM5, R(weight));
-			MULPS(XMM6, R(weight));
-			MULPS(XMM7, R(weight));
-		} else {
-			MOVAPS(XMM2, MDisp(tempReg2, 0));
-			MOVAPS(XMM3, MDisp(tempReg2, 16));
-			MULPS(XMM2, R(weight));
-			MULPS(XMM3, R(weight));
-			ADDPS(XMM4, R(XMM2));
-			ADDPS(XMM5, R(XMM3));
-			MOVAPS(XMM2, MDisp(tempReg2, 32));
-			MOVAPS(XMM3, MDisp(tempReg2, 48));
-			MULPS(XMM2, R(weight));
-			MULPS(XMM3, R(weight));
-			ADDPS(XMM6, R(XMM2));
-			ADDPS(XMM7, R(XMM3));
-		}
+		Jit_AddSkinWeight(weight, j == 0);
 		ADD(PTRBITS, R(tempReg2), Imm8(4 * 16));
 	}
 }
@@ -648,7 +626,20 @@ void VertexDecoderJitCache::Jit_WeightsU16Skin() {
 		MULSS(weight, M(&by32768));  // rip accessible (x86)
 		SHUFPS(weight, R(weight), _MM_SHUFFLE(0, 0, 0, 0));
 #endif
-		if (j == 0) {
+		Jit_AddSkinWeight(weight, j == 0);
+		ADD(PTRBITS, R(tempReg2), Imm8(4 * 16));
+	}
+}
+
+// Adds the bone matrix at tempReg2 times weight (in all lanes) to XMM4-XMM7, or sets them for the first.
+void VertexDecoderJitCache::Jit_AddSkinWeight(X64Reg weight, bool first) {
+	if (first) {
+		if (cpu_info.bAVX) {
+			VMULPS(XMM4, weight, MDisp(tempReg2, 0));
+			VMULPS(XMM5, weight, MDisp(tempReg2, 16));
+			VMULPS(XMM6, weight, MDisp(tempReg2, 32));
+			VMULPS(XMM7, weight, MDisp(tempReg2, 48));
+		} else {
 			MOVAPS(XMM4, MDisp(tempReg2, 0));
 			MOVAPS(XMM5, MDisp(tempReg2, 16));
 			MOVAPS(XMM6, MDisp(tempReg2, 32));
@@ -657,52 +648,39 @@ void VertexDecoderJitCache::Jit_WeightsU16Skin() {
 			MULPS(XMM5, R(weight));
 			MULPS(XMM6, R(weight));
 			MULPS(XMM7, R(weight));
-		} else {
-			MOVAPS(XMM2, MDisp(tempReg2, 0));
-			MOVAPS(XMM3, MDisp(tempReg2, 16));
-			MULPS(XMM2, R(weight));
-			MULPS(XMM3, R(weight));
-			ADDPS(XMM4, R(XMM2));
-			ADDPS(XMM5, R(XMM3));
-			MOVAPS(XMM2, MDisp(tempReg2, 32));
-			MOVAPS(XMM3, MDisp(tempReg2, 48));
-			MULPS(XMM2, R(weight));
-			MULPS(XMM3, R(weight));
-			ADDPS(XMM6, R(XMM2));
-			ADDPS(XMM7, R(XMM3));
 		}
-		ADD(PTRBITS, R(tempReg2), Imm8(4 * 16));
+	} else if (cpu_info.bFMA3) {
+		// Fused, and straight from memory, this is a quarter of the instructions.
+		VFMADD231PS(XMM4, weight, MDisp(tempReg2, 0));
+		VFMADD231PS(XMM5, weight, MDisp(tempReg2, 16));
+		VFMADD231PS(XMM6, weight, MDisp(tempReg2, 32));
+		VFMADD231PS(XMM7, weight, MDisp(tempReg2, 48));
+	} else {
+		MOVAPS(XMM2, MDisp(tempReg2, 0));
+		MOVAPS(XMM3, MDisp(tempReg2, 16));
+		MULPS(XMM2, R(weight));
+		MULPS(XMM3, R(weight));
+		ADDPS(XMM4, R(XMM2));
+		ADDPS(XMM5, R(XMM3));
+		MOVAPS(XMM2, MDisp(tempReg2, 32));
+		MOVAPS(XMM3, MDisp(tempReg2, 48));
+		MULPS(XMM2, R(weight));
+		MULPS(XMM3, R(weight));
+		ADDPS(XMM6, R(XMM2));
+		ADDPS(XMM7, R(XMM3));
 	}
 }
 
 void VertexDecoderJitCache::Jit_WeightsFloatSkin() {
 	MOV(PTRBITS, R(tempReg2), ImmPtr(&bones));
 	for (int j = 0; j < dec_->nweights; j++) {
-		MOVSS(XMM1, MDisp(srcReg, dec_->weightoff + j * 4));
-		SHUFPS(XMM1, R(XMM1), _MM_SHUFFLE(0, 0, 0, 0));
-		if (j == 0) {
-			MOVAPS(XMM4, MDisp(tempReg2, 0));
-			MOVAPS(XMM5, MDisp(tempReg2, 16));
-			MOVAPS(XMM6, MDisp(tempReg2, 32));
-			MOVAPS(XMM7, MDisp(tempReg2, 48));
-			MULPS(XMM4, R(XMM1));
-			MULPS(XMM5, R(XMM1));
-			MULPS(XMM6, R(XMM1));
-			MULPS(XMM7, R(XMM1));
+		if (cpu_info.bAVX) {
+			VBROADCASTSS(XMM1, MDisp(srcReg, dec_->weightoff + j * 4));
 		} else {
-			MOVAPS(XMM2, MDisp(tempReg2, 0));
-			MOVAPS(XMM3, MDisp(tempReg2, 16));
-			MULPS(XMM2, R(XMM1));
-			MULPS(XMM3, R(XMM1));
-			ADDPS(XMM4, R(XMM2));
-			ADDPS(XMM5, R(XMM3));
-			MOVAPS(XMM2, MDisp(tempReg2, 32));
-			MOVAPS(XMM3, MDisp(tempReg2, 48));
-			MULPS(XMM2, R(XMM1));
-			MULPS(XMM3, R(XMM1));
-			ADDPS(XMM6, R(XMM2));
-			ADDPS(XMM7, R(XMM3));
+			MOVSS(XMM1, MDisp(srcReg, dec_->weightoff + j * 4));
+			SHUFPS(XMM1, R(XMM1), _MM_SHUFFLE(0, 0, 0, 0));
 		}
+		Jit_AddSkinWeight(XMM1, j == 0);
 		ADD(PTRBITS, R(tempReg2), Imm8(4 * 16));
 	}
 }
@@ -1515,6 +1493,18 @@ void VertexDecoderJitCache::Jit_AnyU16ToFloat(int srcoff, u32 bits) {
 	}
 }
 
+// Adds reg times the weight in fpScratchReg3 to fpScratchReg, or just scales it there for the first.
+void VertexDecoderJitCache::Jit_AddMorphWeight(X64Reg reg, bool first) {
+	if (first) {
+		MULPS(reg, R(fpScratchReg3));
+	} else if (cpu_info.bFMA3) {
+		VFMADD231PS(fpScratchReg, reg, R(fpScratchReg3));
+	} else {
+		MULPS(reg, R(fpScratchReg3));
+		ADDPS(fpScratchReg, R(reg));
+	}
+}
+
 void VertexDecoderJitCache::Jit_AnyS8Morph(int srcoff, int dstoff) {
 	MOV(PTRBITS, R(tempReg1), ImmPtr(&gstate_c.morphWeights[0]));
 	if (!cpu_info.bSSE4_1) {
@@ -1544,16 +1534,17 @@ void VertexDecoderJitCache::Jit_AnyS8Morph(int srcoff, int dstoff) {
 		CVTDQ2PS(reg, R(reg));
 
 		// Now, It's time to multiply by the weight and 1.0f/128.0f.
-		MOVSS(fpScratchReg3, MDisp(tempReg1, sizeof(float) * n));
-		MULSS(fpScratchReg3, R(XMM5));
-		SHUFPS(fpScratchReg3, R(fpScratchReg3), _MM_SHUFFLE(0, 0, 0, 0));
-
-		MULPS(reg, R(fpScratchReg3));
-		if (!first) {
-			ADDPS(fpScratchReg, R(fpScratchReg2));
+		if (cpu_info.bAVX) {
+			VBROADCASTSS(fpScratchReg3, MDisp(tempReg1, sizeof(float) * n));
+			MULPS(fpScratchReg3, R(XMM5));
 		} else {
-			first = false;
+			MOVSS(fpScratchReg3, MDisp(tempReg1, sizeof(float) * n));
+			MULSS(fpScratchReg3, R(XMM5));
+			SHUFPS(fpScratchReg3, R(fpScratchReg3), _MM_SHUFFLE(0, 0, 0, 0));
 		}
+
+		Jit_AddMorphWeight(reg, first);
+		first = false;
 	}
 
 	MOVUPS(MDisp(dstReg, dstoff), fpScratchReg);
@@ -1587,16 +1578,17 @@ void VertexDecoderJitCache::Jit_AnyS16Morph(int srcoff, int dstoff) {
 		CVTDQ2PS(reg, R(reg));
 
 		// Now, It's time to multiply by the weight and 1.0f/32768.0f.
-		MOVSS(fpScratchReg3, MDisp(tempReg1, sizeof(float) * n));
-		MULSS(fpScratchReg3, R(XMM5));
-		SHUFPS(fpScratchReg3, R(fpScratchReg3), _MM_SHUFFLE(0, 0, 0, 0));
-
-		MULPS(reg, R(fpScratchReg3));
-		if (!first) {
-			ADDPS(fpScratchReg, R(fpScratchReg2));
+		if (cpu_info.bAVX) {
+			VBROADCASTSS(fpScratchReg3, MDisp(tempReg1, sizeof(float) * n));
+			MULPS(fpScratchReg3, R(XMM5));
 		} else {
-			first = false;
+			MOVSS(fpScratchReg3, MDisp(tempReg1, sizeof(float) * n));
+			MULSS(fpScratchReg3, R(XMM5));
+			SHUFPS(fpScratchReg3, R(fpScratchReg3), _MM_SHUFFLE(0, 0, 0, 0));
 		}
+
+		Jit_AddMorphWeight(reg, first);
+		first = false;
 	}
 
 	MOVUPS(MDisp(dstReg, dstoff), fpScratchReg);
@@ -1610,14 +1602,14 @@ void VertexDecoderJitCache::Jit_AnyFloatMorph(int srcoff, int dstoff) {
 	for (int n = 0; n < dec_->morphcount; ++n) {
 		const X64Reg reg = first ? fpScratchReg : fpScratchReg2;
 		MOVUPS(reg, MDisp(srcReg, dec_->onesize_ * n + srcoff));
-		MOVSS(fpScratchReg3, MDisp(tempReg1, sizeof(float) * n));
-		SHUFPS(fpScratchReg3, R(fpScratchReg3), _MM_SHUFFLE(0, 0, 0, 0));
-		MULPS(reg, R(fpScratchReg3));
-		if (!first) {
-			ADDPS(fpScratchReg, R(fpScratchReg2));
+		if (cpu_info.bAVX) {
+			VBROADCASTSS(fpScratchReg3, MDisp(tempReg1, sizeof(float) * n));
 		} else {
-			first = false;
+			MOVSS(fpScratchReg3, MDisp(tempReg1, sizeof(float) * n));
+			SHUFPS(fpScratchReg3, R(fpScratchReg3), _MM_SHUFFLE(0, 0, 0, 0));
 		}
+		Jit_AddMorphWeight(reg, first);
+		first = false;
 	}
 
 	MOVUPS(MDisp(dstReg, dstoff), fpScratchReg);
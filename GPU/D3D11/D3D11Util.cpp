@@ -18,7 +18,7 @@
 
 #include "D3D11Util.h"
 
-static std::vector<uint8_t> CompileShaderToBytecode(const char *code, size_t codeSize, const char *target, UINT flags) {
+std::vector<uint8_t> CompileShaderToBytecodeD3D11(const char *code, size_t codeSize, const char *target, UINT flags) {
 	ID3DBlob *compiledCode = nullptr;
 	ID3DBlob *errorMsgs = nullptr;
 	HRESULT result = ptr_D3DCompile(code, codeSize, nullptr, nullptr, nullptr, "main", target, flags, 0, &compiledCode, &errorMsgs);
@@ -40,7 +40,7 @@ static std::vector<uint8_t> CompileShaderToBytecode(const char *code, size_t cod
 
 ID3D11VertexShader *CreateVertexShaderD3D11(ID3D11Device *device, const char *code, size_t codeSize, std::vector<uint8_t> *byteCodeOut, D3D_FEATURE_LEVEL featureLevel, UINT flags) {
 	const char *profile = featureLevel <= D3D_FEATURE_LEVEL_9_3 ? "vs_4_0_level_9_1" : "vs_4_0";
-	std::vector<uint8_t> byteCode = CompileShaderToBytecode(code, codeSize, profile, flags);
+	std::vector<uint8_t> byteCode = CompileShaderToBytecodeD3D11(code, codeSize, profile, flags);
 	if (byteCode.empty())
 		return nullptr;
 
@@ -53,7 +53,7 @@ ID3D11VertexShader *CreateVertexShaderD3D11(ID3D11Device *device, const char *co
 
 ID3D11PixelShader *CreatePixelShaderD3D11(ID3D11Device *device, const char *code, size_t codeSize, D3D_FEATURE_LEVEL featureLevel, UINT flags) {
 	const char *profile = featureLevel <= D3D_FEATURE_LEVEL_9_3 ? "ps_4_0_level_9_1" : "ps_4_0";
-	std::vector<uint8_t> byteCode = CompileShaderToBytecode(code, codeSize, profile, flags);
+	std::vector<uint8_t> byteCode = CompileShaderToBytecodeD3D11(code, codeSize, profile, flags);
 	if (byteCode.empty())
 		return nullptr;
 
@@ -65,7 +65,9 @@ ID3D11PixelShader *CreatePixelShaderD3D11(ID3D11Device *device, const char *code
 ID3D11ComputeShader *CreateComputeShaderD3D11(ID3D11Device *device, const char *code, size_t codeSize, D3D_FEATURE_LEVEL featureLevel, UINT flags) {
 	if (featureLevel <= D3D_FEATURE_LEVEL_9_3)
 		return nullptr;
-	std::vector<uint8_t> byteCode = CompileShaderToBytecode(code, codeSize, "cs_4_0", flags);
+	// Typed UAV stores need cs_5_0.
+	const char *profile = featureLevel >= D3D_FEATURE_LEVEL_11_0 ? "cs_5_0" : "cs_4_0";
+	std::vector<uint8_t> byteCode = CompileShaderToBytecodeD3D11(code, codeSize, profile, flags);
 	if (byteCode.empty())
 		return nullptr;
 
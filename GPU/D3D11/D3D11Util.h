@@ -38,6 +38,11 @@ class PushBufferD3D11 {
 		return buffer_;
 	}
 
+	// Whether size more bytes fit before the next push would wrap around.
+	bool Fits(size_t size, int align = 16) const {
+		return ((pos_ + align - 1) & ~(align - 1)) + size <= size_;
+	}
+
 	// Should be done each frame
 	void Reset() {
 		pos_ = 0;
@@ -71,6 +76,8 @@ class PushBufferD3D11 {
 	bool nextMapDiscard_ = false;
 };
 
+// Returns an empty vector if compilation failed.
+std::vector<uint8_t> CompileShaderToBytecodeD3D11(const char *code, size_t codeSize, const char *target, UINT flags = 0);
 ID3D11VertexShader *CreateVertexShaderD3D11(ID3D11Device *device, const char *code, size_t codeSize, std::vector<uint8_t> *byteCodeOut, D3D_FEATURE_LEVEL featureLevel, UINT flags = 0);
 ID3D11PixelShader *CreatePixelShaderD3D11(ID3D11Device *device, const char *code, size_t codeSize, D3D_FEATURE_LEVEL featureLevel, UINT flags = 0);
 ID3D11ComputeShader *CreateComputeShaderD3D11(ID3D11Device *device, const char *code, size_t codeSize, D3D_FEATURE_LEVEL featureLevel, UINT flags = 0);
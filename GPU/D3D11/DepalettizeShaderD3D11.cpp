@@ -157,6 +157,14 @@ void DepalShaderCacheD3D11::Decimate() {
 	}
 }
 
+void DepalShaderCacheD3D11::Precompile() {
+	std::vector<std::pair<uint32_t, GEBufferFormat>> variants;
+	GetCommonVariants(variants);
+	for (const auto &variant : variants) {
+		GetDepalettizePixelShader(variant.first, variant.second);
+	}
+}
+
 ID3D11PixelShader *DepalShaderCacheD3D11::GetDepalettizePixelShader(uint32_t clutMode, GEBufferFormat pixelFormat) {
 	u32 id = GenerateShaderID(clutMode, pixelFormat);
 
@@ -167,7 +175,7 @@ ID3D11PixelShader *DepalShaderCacheD3D11::GetDepalettizePixelShader(uint32_t clu
 
 	char *buffer = new char[2048];
 
-	GenerateDepalShader(buffer, pixelFormat, HLSL_D3D11);
+	GenerateDepalShader(buffer, clutMode, pixelFormat, HLSL_D3D11);
 
 	ID3D11PixelShader *pshader = CreatePixelShaderD3D11(device_, buffer, strlen(buffer), featureLevel_);
 
@@ -57,6 +57,8 @@ class DepalShaderCacheD3D11 : public DepalShaderCacheCommon {
 	ID3D11ShaderResourceView *GetClutTexture(GEPaletteFormat clutFormat, const u32 clutHash, u32 *rawClut, bool expandTo32bit);
 	void Clear();
 	void Decimate();
+	// Compiles the common variants up front, so the first use doesn't stutter.
+	void Precompile();
 	std::vector<std::string> DebugGetShaderIDs(DebugShaderType type);
 	std::string DebugGetShaderString(std::string id, DebugShaderType type, DebugShaderStringType stringType);
 
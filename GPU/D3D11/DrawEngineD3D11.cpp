@@ -194,9 +194,7 @@ static void VertexAttribSetup(D3D11_INPUT_ELEMENT_DESC * VertexElement, u8 fmt,
 }
 
 ID3D11InputLayout *DrawEngineD3D11::SetupDecFmtForDraw(D3D11VertexShader *vshader, const DecVtxFormat &decFmt, u32 pspFmt) {
-	// TODO: Instead of one for each vshader, we can reduce it to one for each type of shader
-	// that reads TEXCOORD or not, etc. Not sure if worth it.
-	InputLayoutKey key{ vshader, decFmt.id };
+	InputLayoutKey key{ vshader->InputSignatureHash(), decFmt.id };
 	ID3D11InputLayout *inputLayout = inputLayoutMap_.Get(key);
 	if (inputLayout) {
 		return inputLayout;
@@ -259,6 +257,10 @@ ID3D11InputLayout *DrawEngineD3D11::SetupDecFmtForDraw(D3D11VertexShader *vshade
 
 void DrawEngineD3D11::MarkUnreliable(VertexArrayInfoD3D11 *vai) {
 	vai->status = VertexArrayInfoD3D11::VAI_UNRELIABLE;
+	FreeVertexArray(vai);
+}
+
+void DrawEngineD3D11::FreeVertexArray(VertexArrayInfoD3D11 *vai) {
 	if (vai->vbo) {
 		vai->vbo->Release();
 		vai->vbo = nullptr;
@@ -362,11 +364,7 @@ void DrawEngineD3D11::DoFlush() {
 			case VertexArrayInfoD3D11::VAI_NEW:
 				{
 					// Haven't seen this one before.
-					ReliableHashType dataHash = ComputeHash();
-					vai->hash = dataHash;
-					vai->minihash = ComputeMiniHash();
-					vai->status = VertexArrayInfoD3D11::VAI_HASHING;
-					vai->drawsUntilNextFullHash = 0;
+					BeginVertexArray(vai);
 					DecodeVerts(decoded); // writes to indexGen
 					vai->numVerts = indexGen.VertexCount();
 					vai->prim = indexGen.Prim();
@@ -383,37 +381,14 @@ void DrawEngineD3D11::DoFlush() {
 					if (vai->lastFrame != gpuStats.numFlips) {
 						vai->numFrames++;
 					}
-					if (vai->drawsUntilNextFullHash == 0) {
-						// Let's try to skip a full hash if mini would fail.
-						const u32 newMiniHash = ComputeMiniHash();
-						ReliableHashType newHash = vai->hash;
-						if (newMiniHash == vai->minihash) {
-							newHash = ComputeHash();
-						}
-						if (newMiniHash != vai->minihash || newHash != vai->hash) {
-							MarkUnreliable(vai);
-							DecodeVerts(decoded);
-							goto rotateVBO;
-						}
-						if (vai->numVerts > 64) {
-							// exponential backoff up to 16 draws, then every 24
-							vai->drawsUntilNextFullHash = std::min(24, vai->numFrames);
-						} else {
-							// Lower numbers seem much more likely to change.
-							vai->drawsUntilNextFullHash = 0;
-						}
-						// TODO: tweak
-						//if (vai->numFrames > 1000) {
-						//	vai->status = VertexArrayInfo::VAI_RELIABLE;
-						//}
-					} else {
-						vai->drawsUntilNextFullHash--;
-						u32 newMiniHash = ComputeMiniHash();
-						if (newMiniHash != vai->minihash) {
+					if (!CheckVertexArray(vai)) {
+						if (!ReseedVertexArray(vai)) {
 							MarkUnreliable(vai);
 							DecodeVerts(decoded);
 							goto rotateVBO;
 						}
+						// Replaced through a write we were told about, upload the new contents below.
+						FreeVertexArray(vai);
 					}
 
 					if (vai->vbo == 0) {
@@ -604,9 +579,8 @@ void DrawEngineD3D11::DoFlush() {
 			shaderManager_->UpdateUniforms();
 			shaderManager_->BindUniforms();
 
-			// We really do need a vertex layout for each vertex shader (or at least check its ID bits for what inputs it uses)!
-			// Some vertex shaders ignore one of the inputs, and then the layout created from it will lack it, which will be a problem for others.
-			InputLayoutKey key{ vshader, 0xFFFFFFFF };  // Let's use 0xFFFFFFFF to signify TransformedVertex
+			// Some vertex shaders ignore one of the inputs, so the layout has to match the shader's input signature.
+			InputLayoutKey key{ vshader->InputSignatureHash(), 0xFFFFFFFF };  // Let's use 0xFFFFFFFF to signify TransformedVertex
 			ID3D11InputLayout *layout = inputLayoutMap_.Get(key);
 			if (!layout) {
 				ASSERT_SUCCESS(device_->CreateInputLayout(TransformedVertexElements, ARRAY_SIZE(TransformedVertexElements), vshader->bytecode().data(), vshader->bytecode().size(), &layout));
@@ -657,10 +631,12 @@ void DrawEngineD3D11::DoFlush() {
 			int scissorX2 = gstate.getScissorX2() + 1;
 			int scissorY2 = gstate.getScissorY2() + 1;
 			framebufferManager_->SetSafeSize(scissorX2, scissorY2);
-			if ((gstate_c.featureFlags & GPU_USE_CLEAR_RAM_HACK) && gstate.isClearModeColorMask() && (gstate.isClearModeAlphaMask() || gstate.FrameBufFormat() == GE_FORMAT_565)) {
+			if (gstate.isClearModeColorMask() && (gstate.isClearModeAlphaMask() || gstate.FrameBufFormat() == GE_FORMAT_565)) {
 				int scissorX1 = gstate.getScissorX1();
 				int scissorY1 = gstate.getScissorY1();
-				framebufferManager_->ApplyClearToMemory(scissorX1, scissorY1, scissorX2, scissorY2, clearColor);
+				if (gstate_c.featureFlags & GPU_USE_CLEAR_RAM_HACK)
+					framebufferManager_->ApplyClearToMemory(scissorX1, scissorY1, scissorX2, scissorY2, clearColor);
+				framebufferManager_->DeferClearToMemory(scissorX1, scissorY1, scissorX2, scissorY2, clearColor);
 			}
 		}
 	}
@@ -676,7 +652,7 @@ void DrawEngineD3D11::DoFlush() {
 	dcid_ = 0;
 	prevPrim_ = GE_PRIM_INVALID;
 	gstate_c.vertexFullAlpha = true;
-	framebufferManager_->SetColorUpdated(gstate_c.skipDrawReason);
+	framebufferManager_->SetColorUpdatedInScissor(gstate_c.skipDrawReason);
 
 	// Now seems as good a time as any to reset the min/max coords, which we may examine later.
 	gstate_c.vertBounds.minU = 512;
@@ -56,47 +56,12 @@ enum {
 };
 
 // Try to keep this POD.
-class VertexArrayInfoD3D11 {
+class VertexArrayInfoD3D11 : public VertexArrayInfoCommon {
 public:
-	VertexArrayInfoD3D11() {
-		status = VAI_NEW;
-		vbo = 0;
-		ebo = 0;
-		prim = GE_PRIM_INVALID;
-		numDraws = 0;
-		numFrames = 0;
-		lastFrame = gpuStats.numFlips;
-		numVerts = 0;
-		drawsUntilNextFullHash = 0;
-		flags = 0;
-	}
 	~VertexArrayInfoD3D11();
 
-	enum Status : uint8_t {
-		VAI_NEW,
-		VAI_HASHING,
-		VAI_RELIABLE,  // cache, don't hash
-		VAI_UNRELIABLE,  // never cache
-	};
-
-	ReliableHashType hash;
-	u32 minihash;
-
-	ID3D11Buffer *vbo;
-	ID3D11Buffer *ebo;
-
-	// Precalculated parameter for drawRangeElements
-	u16 numVerts;
-	u16 maxIndex;
-	s8 prim;
-	Status status;
-
-	// ID information
-	int numDraws;
-	int numFrames;
-	int lastFrame;  // So that we can forget.
-	u16 drawsUntilNextFullHash;
-	u8 flags;
+	ID3D11Buffer *vbo = nullptr;
+	ID3D11Buffer *ebo = nullptr;
 };
 
 class TessellationDataTransferD3D11 : public TessellationDataTransfer {
@@ -166,6 +131,7 @@ class DrawEngineD3D11 : public DrawEngineCommon {
 	ID3D11InputLayout *SetupDecFmtForDraw(D3D11VertexShader *vshader, const DecVtxFormat &decFmt, u32 pspFmt);
 
 	void MarkUnreliable(VertexArrayInfoD3D11 *vai);
+	void FreeVertexArray(VertexArrayInfoD3D11 *vai);
 
 	Draw::DrawContext *draw_;  // Used for framebuffer related things exclusively.
 	ID3D11Device *device_;
@@ -175,16 +141,11 @@ class DrawEngineD3D11 : public DrawEngineCommon {
 
 	PrehashMap<VertexArrayInfoD3D11 *, nullptr> vai_;
 
+	// Keyed by the shader's input signature rather than the shader, so shaders that read the
+	// same inputs share layouts. No padding, since the map compares keys with memcmp.
 	struct InputLayoutKey {
-		D3D11VertexShader *vshader;
+		u32 inputSignatureHash;
 		u32 decFmtId;
-		bool operator <(const InputLayoutKey &other) const {
-			if (decFmtId < other.decFmtId)
-				return true;
-			if (decFmtId > other.decFmtId)
-				return false;
-			return vshader < other.vshader;
-		}
 	};
 
 	DenseHashMap<InputLayoutKey, ID3D11InputLayout *, nullptr> inputLayoutMap_;
@@ -231,18 +231,17 @@ void FramebufferManagerD3D11::CompilePostShader() {
 		postInputLayout_ = nullptr;
 	}
 
-	const ShaderInfo *shaderInfo = nullptr;
-	if (g_Config.sPostShaderName == "Off") {
-		usePostShader_ = false;
-		return;
-	}
-
 	usePostShader_ = false;
 
-	ReloadAllPostShaderInfo();
-	shaderInfo = GetPostShaderInfo(g_Config.sPostShaderName);
+	LoadPostShaderChain();
+	if (postShaderChain_.size() > 1) {
+		// Only a single pass is implemented here so far.
+		WARN_LOG(FRAMEBUF, "Post shader chains are not supported on D3D11, using the first pass only");
+		postShaderChain_.resize(1);
+		postShaderAtOutputResolution_ = postShaderChain_[0].outputResolution;
+	}
+	const ShaderInfo *shaderInfo = postShaderChain_.empty() ? nullptr : &postShaderChain_[0];
 	if (shaderInfo) {
-		postShaderAtOutputResolution_ = shaderInfo->outputResolution;
 		size_t sz;
 		char *vs = (char *)VFSReadFile(shaderInfo->vertexShaderFile.c_str(), &sz);
 		if (!vs)
@@ -420,19 +419,16 @@ void FramebufferManagerD3D11::Bind2DShader() {
 	context_->VSSetShader(quadVertexShader_, 0, 0);
 }
 
-void FramebufferManagerD3D11::BindPostShader(const PostShaderUniforms &uniforms) {
+void FramebufferManagerD3D11::BindPostShader(const PostShaderUniforms &uniforms, int pass) {
 	if (!postPixelShader_) {
 		if (usePostShader_) {
 			CompilePostShader();
 		}
 		if (!usePostShader_) {
-			SetNumExtraFBOs(0);
 			context_->IASetInputLayout(quadInputLayout_);
 			context_->PSSetShader(quadPixelShader_, 0, 0);
 			context_->VSSetShader(quadVertexShader_, 0, 0);
 			return;
-		} else {
-			SetNumExtraFBOs(1);
 		}
 	}
 	context_->IASetInputLayout(postInputLayout_);
@@ -716,8 +712,6 @@ void FramebufferManagerD3D11::DestroyAllFBOs() {
 		tempFB.second.fbo->Release();
 	}
 	tempFBOs_.clear();
-
-	SetNumExtraFBOs(0);
 }
 
 void FramebufferManagerD3D11::Resized() {
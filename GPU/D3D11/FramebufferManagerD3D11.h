@@ -69,7 +69,7 @@ class FramebufferManagerD3D11 : public FramebufferManagerCommon {
 
 private:
 	void CompilePostShader();
-	void BindPostShader(const PostShaderUniforms &uniforms) override;
+	void BindPostShader(const PostShaderUniforms &uniforms, int pass) override;
 	void Bind2DShader() override;
 	void MakePixelTexture(const u8 *srcPixels, GEBufferFormat srcPixelFormat, int srcStride, int width, int height, float &u1, float &v1) override;
 	void PackDepthbuffer(VirtualFramebuffer *vfb, int x, int y, int w, int h);
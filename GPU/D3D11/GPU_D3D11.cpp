@@ -35,8 +35,10 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <set>
+#include <thread>
 
 #include "Common/ChunkFile.h"
+#include "Common/FileUtil.h"
 #include "Common/GraphicsContext.h"
 #include "base/NativeApp.h"
 #include "base/logging.h"
@@ -48,6 +50,7 @@
 #include "Core/Config.h"
 #include "Core/Reporting.h"
 #include "Core/System.h"
+#include "Core/ELF/ParamSFO.h"
 
 #include "GPU/GPUState.h"
 #include "GPU/ge_constants.h"
@@ -77,7 +80,8 @@ GPU_D3D11::GPU_D3D11(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 
 	stockD3D11.Create(device_);
 
-	shaderManagerD3D11_ = new ShaderManagerD3D11(draw, device_, context_, featureLevel);
+	ID3D11DeviceContext1 *context1 = (ID3D11DeviceContext1 *)draw->GetNativeObject(Draw::NativeObject::CONTEXT_EX);
+	shaderManagerD3D11_ = new ShaderManagerD3D11(draw, device_, context_, context1, featureLevel);
 	framebufferManagerD3D11_ = new FramebufferManagerD3D11(draw);
 	framebufferManager_ = framebufferManagerD3D11_;
 	textureCacheD3D11_ = new TextureCacheD3D11(draw);
@@ -95,6 +99,8 @@ GPU_D3D11::GPU_D3D11(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 	textureCacheD3D11_->SetFramebufferManager(framebufferManagerD3D11_);
 	textureCacheD3D11_->SetDepalShaderCache(depalShaderCache_);
 	textureCacheD3D11_->SetShaderManager(shaderManagerD3D11_);
+	if (!g_Config.bDisableSlowFramebufEffects)
+		depalShaderCache_->Precompile();
 
 	// Sanity check gstate
 	if ((int *)&gstate.transferstart - (int *)&gstate != 0xEA) {
@@ -111,9 +117,65 @@ GPU_D3D11::GPU_D3D11(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 	// Some of our defaults are different from hw defaults, let's assert them.
 	// We restore each frame anyway, but here is convenient for tests.
 	textureCache_->NotifyConfigChanged();
+
+	LoadVertexDecoderCache();
+
+	// Load shader cache.
+	std::string discID = g_paramSFO.GetDiscID();
+	if (discID.size()) {
+		File::CreateFullPath(GetSysDirectory(DIRECTORY_APP_CACHE));
+		shaderCachePath_ = GetSysDirectory(DIRECTORY_APP_CACHE) + "/" + discID + ".d3d11shadercache";
+		shaderCacheLoaded_ = false;
+
+		std::thread th([&] {
+			LoadCache(shaderCachePath_);
+			shaderCacheLoaded_ = true;
+		});
+		th.detach();
+	} else {
+		shaderCacheLoaded_ = true;
+	}
+}
+
+bool GPU_D3D11::IsReady() {
+	return shaderCacheLoaded_;
+}
+
+void GPU_D3D11::CancelReady() {
+	shaderManagerD3D11_->CancelCache();
+}
+
+void GPU_D3D11::LoadCache(std::string filename) {
+	PSP_SetLoading("Loading shader cache...");
+	FILE *f = File::OpenCFile(filename, "rb");
+	if (!f)
+		return;
+
+	// The device is free threaded, so creating the shaders here is fine.
+	bool result = shaderManagerD3D11_->LoadCache(f);
+	fclose(f);
+	if (!result) {
+		WARN_LOG(G3D, "Bad D3D11 shader cache");
+		File::Delete(filename);
+	} else {
+		INFO_LOG(G3D, "Loaded D3D11 shader cache.");
+	}
+}
+
+void GPU_D3D11::SaveCache(std::string filename) {
+	if (filename.empty())
+		return;
+	FILE *f = File::OpenCFile(filename, "wb");
+	if (!f)
+		return;
+	shaderManagerD3D11_->SaveCache(f);
+	INFO_LOG(G3D, "Saved D3D11 shader cache");
+	fclose(f);
 }
 
 GPU_D3D11::~GPU_D3D11() {
+	SaveCache(shaderCachePath_);
+	SaveVertexDecoderCache();
 	delete depalShaderCache_;
 	framebufferManagerD3D11_->DestroyAllFBOs();
 	delete framebufferManagerD3D11_;
@@ -211,6 +273,13 @@ void GPU_D3D11::DeviceRestore() {
 	// Nothing needed.
 }
 
+void GPU_D3D11::Reinitialize() {
+	GPUCommon::Reinitialize();
+	textureCacheD3D11_->Clear(true);
+	depalShaderCache_->Clear();
+	framebufferManagerD3D11_->DestroyAllFBOs();
+}
+
 void GPU_D3D11::InitClear() {
 	bool useNonBufferedRendering = g_Config.iRenderingMode == FB_NON_BUFFERED_MODE;
 	if (useNonBufferedRendering) {
@@ -251,6 +320,7 @@ void GPU_D3D11::BeginFrame() {
 	// fragmentTestCache_.Decimate();
 
 	shaderManagerD3D11_->DirtyLastShader();
+	shaderManagerD3D11_->BeginFrame();
 
 	framebufferManagerD3D11_->BeginFrame();
 	gstate_c.Dirty(DIRTY_PROJTHROUGHMATRIX);
@@ -314,12 +384,13 @@ void GPU_D3D11::GetStats(char *buffer, size_t bufsize) {
 	float vertexAverageCycles = gpuStats.numVertsSubmitted > 0 ? (float)gpuStats.vertexGPUCycles / (float)gpuStats.numVertsSubmitted : 0.0f;
 	snprintf(buffer, bufsize - 1,
 		"DL processing time: %0.2f ms\n"
-		"Draw calls: %i, flushes %i, clears %i\n"
+		"Draw calls: %i, flushes %i (%i skipped), clears %i\n"
 		"Cached Draw calls: %i\n"
 		"Num Tracked Vertex Arrays: %i\n"
 		"GPU cycles executed: %d (%f per vertex)\n"
 		"Commands per call level: %i %i %i %i\n"
 		"Vertices submitted: %i\n"
+		"Draw temporaries peak: %i KB\n"
 		"Cached, Uncached Vertices Drawn: %i, %i\n"
 		"FBOs active: %i\n"
 		"Textures active: %i, decoded: %i  invalidated: %i\n"
@@ -328,6 +399,7 @@ void GPU_D3D11::GetStats(char *buffer, size_t bufsize) {
 		gpuStats.msProcessingDisplayLists * 1000.0f,
 		gpuStats.numDrawCalls,
 		gpuStats.numFlushes,
+		gpuStats.numFlushesSkipped,
 		gpuStats.numClears,
 		gpuStats.numCachedDrawCalls,
 		gpuStats.numTrackedVertexArrays,
@@ -335,6 +407,7 @@ void GPU_D3D11::GetStats(char *buffer, size_t bufsize) {
 		vertexAverageCycles,
 		gpuStats.gpuCommandsAtCallLevel[0], gpuStats.gpuCommandsAtCallLevel[1], gpuStats.gpuCommandsAtCallLevel[2], gpuStats.gpuCommandsAtCallLevel[3],
 		gpuStats.numVertsSubmitted,
+		gpuStats.frameArenaHighWater / 1024,
 		gpuStats.numCachedVertsDrawn,
 		gpuStats.numUncachedVertsDrawn,
 		(int)framebufferManagerD3D11_->NumVFBs(),
@@ -362,7 +435,7 @@ void GPU_D3D11::DoState(PointerWrap &p) {
 
 	// TODO: Some of these things may not be necessary.
 	// None of these are necessary when saving.
-	if (p.mode == p.MODE_READ && !PSP_CoreParameter().frozen) {
+	if (p.mode == p.MODE_READ && !PSP_CoreParameter().frozen && !PSP_CoreParameter().runAheadFrame) {
 		textureCacheD3D11_->Clear(true);
 		drawEngine_.ClearTrackedVertexArrays();
 
@@ -37,6 +37,8 @@ class GPU_D3D11 : public GPUCommon {
 	~GPU_D3D11();
 
 	void CheckGPUFeatures() override;
+	bool IsReady() override;
+	void CancelReady() override;
 	void PreExecuteOp(u32 op, u32 diff) override;
 	void ExecuteOp(u32 op, u32 diff) override;
 
@@ -68,8 +70,11 @@ class GPU_D3D11 : public GPUCommon {
 	// void ApplyDrawState(int prim);
 	void CheckFlushOp(int cmd, u32 diff);
 	void BuildReportingInfo();
+	void LoadCache(std::string filename);
+	void SaveCache(std::string filename);
 
 	void InitClear() override;
+	void Reinitialize() override;
 	void BeginFrame() override;
 	void CopyDisplayToOutput() override;
 
@@ -83,4 +88,7 @@ class GPU_D3D11 : public GPUCommon {
 	ShaderManagerD3D11 *shaderManagerD3D11_;
 
 	int lastVsync_;
+
+	std::string shaderCachePath_;
+	bool shaderCacheLoaded_ = false;
 };
@@ -28,6 +28,7 @@
 #include "math/dataconv.h"
 #include "thin3d/thin3d.h"
 #include "util/text/utf8.h"
+#include "ext/xxhash.h"
 #include "Common/Common.h"
 #include "Core/Config.h"
 #include "Core/Reporting.h"
@@ -39,11 +40,12 @@
 #include "GPU/D3D11/VertexShaderGeneratorD3D11.h"
 #include "GPU/D3D11/D3D11Util.h"
 
-D3D11FragmentShader::D3D11FragmentShader(ID3D11Device *device, D3D_FEATURE_LEVEL featureLevel, FShaderID id, const char *code, bool useHWTransform)
+D3D11FragmentShader::D3D11FragmentShader(ID3D11Device *device, FShaderID id, const char *code, const std::vector<uint8_t> &bytecode, bool useHWTransform)
 	: device_(device), id_(id), failed_(false), useHWTransform_(useHWTransform), module_(0) {
 	source_ = code;
 
-	module_ = CreatePixelShaderD3D11(device, code, strlen(code), featureLevel);
+	if (bytecode.empty() || FAILED(device->CreatePixelShader(bytecode.data(), bytecode.size(), nullptr, &module_)))
+		module_ = nullptr;
 	if (!module_)
 		failed_ = true;
 }
@@ -64,11 +66,37 @@ std::string D3D11FragmentShader::GetShaderString(DebugShaderStringType type) con
 	}
 }
 
-D3D11VertexShader::D3D11VertexShader(ID3D11Device *device, D3D_FEATURE_LEVEL featureLevel, VShaderID id, const char *code, int vertType, bool useHWTransform)
+// Hashes the ISGN chunk of a DXBC container, which is all CreateInputLayout validates against.
+// If there isn't one, falls back to the whole shader so nothing gets shared that shouldn't be.
+static u32 HashInputSignature(const std::vector<uint8_t> &bytecode) {
+	const u32 seed = 0x1337;
+	const size_t headerSize = 32;
+	if (bytecode.size() < headerSize || memcmp(bytecode.data(), "DXBC", 4) != 0)
+		return XXH32(bytecode.data(), bytecode.size(), seed);
+	u32 chunkCount;
+	memcpy(&chunkCount, &bytecode[28], 4);
+	for (u32 i = 0; i < chunkCount && headerSize + i * 4 + 4 <= bytecode.size(); i++) {
+		u32 offset;
+		memcpy(&offset, &bytecode[headerSize + i * 4], 4);
+		if ((size_t)offset + 8 > bytecode.size())
+			break;
+		u32 size;
+		memcpy(&size, &bytecode[offset + 4], 4);
+		if (memcmp(&bytecode[offset], "ISGN", 4) == 0 && (size_t)offset + 8 + size <= bytecode.size())
+			return XXH32(&bytecode[offset + 8], size, seed);
+	}
+	return XXH32(bytecode.data(), bytecode.size(), seed);
+}
+
+D3D11VertexShader::D3D11VertexShader(ID3D11Device *device, VShaderID id, const char *code, const std::vector<uint8_t> &bytecode, bool useHWTransform)
 	: device_(device), id_(id), failed_(false), useHWTransform_(useHWTransform), module_(nullptr) {
 	source_ = code;
 
-	module_ = CreateVertexShaderD3D11(device, code, strlen(code), &bytecode_, featureLevel);
+	// Kept around for creating input layouts.
+	bytecode_ = bytecode;
+	inputSignatureHash_ = HashInputSignature(bytecode);
+	if (bytecode.empty() || FAILED(device->CreateVertexShader(bytecode.data(), bytecode.size(), nullptr, &module_)))
+		module_ = nullptr;
 	if (!module_)
 		failed_ = true;
 }
@@ -89,8 +117,18 @@ std::string D3D11VertexShader::GetShaderString(DebugShaderStringType type) const
 	}
 }
 
-ShaderManagerD3D11::ShaderManagerD3D11(Draw::DrawContext *draw, ID3D11Device *device, ID3D11DeviceContext *context, D3D_FEATURE_LEVEL featureLevel)
-	: ShaderManagerCommon(draw), device_(device), context_(context), featureLevel_(featureLevel), lastVShader_(nullptr), lastFShader_(nullptr) {
+// Offsets and sizes of constant buffer ranges have to be multiples of 16 constants.
+enum {
+	UNIFORM_RING_SIZE = 256 * 1024,
+	UNIFORM_RING_ALIGN = 256,
+};
+
+static inline size_t RingAlign(size_t size) {
+	return (size + UNIFORM_RING_ALIGN - 1) & ~(size_t)(UNIFORM_RING_ALIGN - 1);
+}
+
+ShaderManagerD3D11::ShaderManagerD3D11(Draw::DrawContext *draw, ID3D11Device *device, ID3D11DeviceContext *context, ID3D11DeviceContext1 *context1, D3D_FEATURE_LEVEL featureLevel)
+	: ShaderManagerCommon(draw), device_(device), context_(context), context1_(context1), featureLevel_(featureLevel), lastVShader_(nullptr), lastFShader_(nullptr) {
 	codeBuffer_ = new char[16384];
 	memset(&ub_base, 0, sizeof(ub_base));
 	memset(&ub_lights, 0, sizeof(ub_lights));
@@ -100,18 +138,32 @@ ShaderManagerD3D11::ShaderManagerD3D11(Draw::DrawContext *draw, ID3D11Device *de
 	static_assert(sizeof(ub_lights) <= 512, "ub_lights grew too big");
 	static_assert(sizeof(ub_bones) <= 384, "ub_bones grew too big");
 
-	D3D11_BUFFER_DESC desc{sizeof(ub_base), D3D11_USAGE_DYNAMIC, D3D11_BIND_CONSTANT_BUFFER, D3D11_CPU_ACCESS_WRITE };
-	ASSERT_SUCCESS(device_->CreateBuffer(&desc, nullptr, &push_base));
-	desc.ByteWidth = sizeof(ub_lights);
-	ASSERT_SUCCESS(device_->CreateBuffer(&desc, nullptr, &push_lights));
-	desc.ByteWidth = sizeof(ub_bones);
-	ASSERT_SUCCESS(device_->CreateBuffer(&desc, nullptr, &push_bones));
+	// Binding at offsets needs the 11.1 runtime, and mapping with NO_OVERWRITE needs the driver to allow it.
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options{};
+	if (context1_ && SUCCEEDED(device_->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options)))) {
+		if (options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer) {
+			uniformRing_ = new PushBufferD3D11(device_, UNIFORM_RING_SIZE, D3D11_BIND_CONSTANT_BUFFER);
+		}
+	}
+
+	if (!uniformRing_) {
+		D3D11_BUFFER_DESC desc{sizeof(ub_base), D3D11_USAGE_DYNAMIC, D3D11_BIND_CONSTANT_BUFFER, D3D11_CPU_ACCESS_WRITE };
+		ASSERT_SUCCESS(device_->CreateBuffer(&desc, nullptr, &push_base));
+		desc.ByteWidth = sizeof(ub_lights);
+		ASSERT_SUCCESS(device_->CreateBuffer(&desc, nullptr, &push_lights));
+		desc.ByteWidth = sizeof(ub_bones);
+		ASSERT_SUCCESS(device_->CreateBuffer(&desc, nullptr, &push_bones));
+	}
 }
 
 ShaderManagerD3D11::~ShaderManagerD3D11() {
-	push_base->Release();
-	push_lights->Release();
-	push_bones->Release();
+	delete uniformRing_;
+	if (push_base)
+		push_base->Release();
+	if (push_lights)
+		push_lights->Release();
+	if (push_bones)
+		push_bones->Release();
 	ClearShaders();
 	delete[] codeBuffer_;
 }
@@ -144,34 +196,103 @@ void ShaderManagerD3D11::DirtyLastShader() {
 	gstate_c.Dirty(DIRTY_VERTEXSHADER_STATE | DIRTY_FRAGMENTSHADER_STATE);
 }
 
+void ShaderManagerD3D11::BeginFrame() {
+	ringReset_ = true;
+}
+
+// Returns the offset in constants. Reserves room for the whole block, since that's the range bound.
+UINT ShaderManagerD3D11::PushUniforms(const void *data, size_t size, size_t reserve) {
+	UINT offset;
+	uint8_t *dest = uniformRing_->BeginPush(context_, &offset, RingAlign(reserve), UNIFORM_RING_ALIGN);
+	memcpy(dest, data, size);
+	uniformRing_->EndPush(context_);
+	return offset / 16;
+}
+
 uint64_t ShaderManagerD3D11::UpdateUniforms() {
 	uint64_t dirty = gstate_c.GetDirtyUniforms();
+	bool uploadBase = (dirty & DIRTY_BASE_UNIFORMS) != 0;
+	if (uniformRing_) {
+		// The next push discards the ring, and the old offsets point into garbage after that.
+		// So if this update might not fit, start over with every block.
+		const size_t maxUpdate = RingAlign(sizeof(ub_base)) + RingAlign(sizeof(ub_lights)) + RingAlign(sizeof(ub_bones));
+		if (ringReset_ || !uniformRing_->Fits(maxUpdate, UNIFORM_RING_ALIGN)) {
+			uniformRing_->Reset();
+			ringReset_ = false;
+			uploadBase = true;
+			lightsDirty_ = true;
+			bonesDirty_ = true;
+			bonesUploaded_ = 0;
+		}
+	}
+
 	if (dirty != 0) {
-		D3D11_MAPPED_SUBRESOURCE map;
 		if (dirty & DIRTY_BASE_UNIFORMS) {
 			BaseUpdateUniforms(&ub_base, dirty, true);
+		}
+		if (dirty & DIRTY_LIGHT_UNIFORMS) {
+			LightUpdateUniforms(&ub_lights, dirty);
+			lightsDirty_ = true;
+		}
+		if (dirty & DIRTY_BONE_UNIFORMS) {
+			BoneUpdateUniforms(&ub_bones, dirty);
+			bonesDirty_ = true;
+		}
+	}
+	gstate_c.CleanUniforms();
+
+	D3D11_MAPPED_SUBRESOURCE map;
+	if (uploadBase) {
+		if (uniformRing_) {
+			baseOffset_ = PushUniforms(&ub_base, sizeof(ub_base), sizeof(ub_base));
+		} else {
 			context_->Map(push_base, 0, D3D11_MAP_WRITE_DISCARD, 0, &map);
 			memcpy(map.pData, &ub_base, sizeof(ub_base));
 			context_->Unmap(push_base, 0);
 		}
-		if (dirty & DIRTY_LIGHT_UNIFORMS) {
-			LightUpdateUniforms(&ub_lights, dirty);
+	}
+
+	// Lights and bones are only uploaded once a shader reads them, and only the bones in use.
+	if (lightsDirty_ && VertexShaderUsesLights(lastVSID_)) {
+		if (uniformRing_) {
+			lightsOffset_ = PushUniforms(&ub_lights, sizeof(ub_lights), sizeof(ub_lights));
+		} else {
 			context_->Map(push_lights, 0, D3D11_MAP_WRITE_DISCARD, 0, &map);
 			memcpy(map.pData, &ub_lights, sizeof(ub_lights));
 			context_->Unmap(push_lights, 0);
 		}
-		if (dirty & DIRTY_BONE_UNIFORMS) {
-			BoneUpdateUniforms(&ub_bones, dirty);
+		lightsDirty_ = false;
+	}
+	int numBones = VertexShaderNumBones(lastVSID_);
+	if ((bonesDirty_ && numBones > 0) || numBones > bonesUploaded_) {
+		if (uniformRing_) {
+			bonesOffset_ = PushUniforms(&ub_bones, numBones * sizeof(ub_bones.bones[0]), sizeof(ub_bones));
+		} else {
 			context_->Map(push_bones, 0, D3D11_MAP_WRITE_DISCARD, 0, &map);
-			memcpy(map.pData, &ub_bones, sizeof(ub_bones));
+			memcpy(map.pData, &ub_bones, numBones * sizeof(ub_bones.bones[0]));
 			context_->Unmap(push_bones, 0);
 		}
+		bonesUploaded_ = numBones;
+		bonesDirty_ = false;
 	}
-	gstate_c.CleanUniforms();
 	return dirty;
 }
 
 void ShaderManagerD3D11::BindUniforms() {
+	if (uniformRing_) {
+		ID3D11Buffer *ring = uniformRing_->Buf();
+		ID3D11Buffer *cbs[3] = { ring, ring, ring };
+		const UINT offsets[3] = { baseOffset_, lightsOffset_, bonesOffset_ };
+		const UINT counts[3] = {
+			(UINT)RingAlign(sizeof(ub_base)) / 16,
+			(UINT)RingAlign(sizeof(ub_lights)) / 16,
+			(UINT)RingAlign(sizeof(ub_bones)) / 16,
+		};
+		context1_->VSSetConstantBuffers1(0, 3, cbs, offsets, counts);
+		context1_->PSSetConstantBuffers1(0, 1, cbs, offsets, counts);
+		return;
+	}
+
 	ID3D11Buffer *vs_cbs[3] = { push_base, push_lights, push_bones };
 	ID3D11Buffer *ps_cbs[1] = { push_base };
 	context_->VSSetConstantBuffers(0, 3, vs_cbs);
@@ -208,8 +329,7 @@ void ShaderManagerD3D11::GetShaders(int prim, u32 vertType, D3D11VertexShader **
 	D3D11VertexShader *vs;
 	if (vsIter == vsCache_.end()) {
 		// Vertex shader not in cache. Let's compile it.
-		GenerateVertexShaderD3D11(VSID, codeBuffer_, featureLevel_ <= D3D_FEATURE_LEVEL_9_3 ? HLSL_D3D11_LEVEL9 : HLSL_D3D11);
-		vs = new D3D11VertexShader(device_, featureLevel_, VSID, codeBuffer_, vertType, useHWTransform);
+		vs = CompileVertexShader(VSID);
 		vsCache_[VSID] = vs;
 	} else {
 		vs = vsIter->second;
@@ -220,8 +340,7 @@ void ShaderManagerD3D11::GetShaders(int prim, u32 vertType, D3D11VertexShader **
 	D3D11FragmentShader *fs;
 	if (fsIter == fsCache_.end()) {
 		// Fragment shader not in cache. Let's compile it.
-		GenerateFragmentShaderD3D11(FSID, codeBuffer_, featureLevel_ <= D3D_FEATURE_LEVEL_9_3 ? HLSL_D3D11_LEVEL9 : HLSL_D3D11);
-		fs = new D3D11FragmentShader(device_, featureLevel_, FSID, codeBuffer_, useHWTransform);
+		fs = CompileFragmentShader(FSID, useHWTransform);
 		fsCache_[FSID] = fs;
 	} else {
 		fs = fsIter->second;
@@ -236,6 +355,136 @@ void ShaderManagerD3D11::GetShaders(int prim, u32 vertType, D3D11VertexShader **
 	*fshader = fs;
 }
 
+D3D11VertexShader *ShaderManagerD3D11::CompileVertexShader(const VShaderID &id) {
+	GenerateVertexShaderD3D11(id, codeBuffer_, featureLevel_ <= D3D_FEATURE_LEVEL_9_3 ? HLSL_D3D11_LEVEL9 : HLSL_D3D11);
+	gpuStats.numShadersCompiled++;
+	return new D3D11VertexShader(device_, id, codeBuffer_, GetBytecode(codeBuffer_, true), id.Bit(VS_BIT_USE_HW_TRANSFORM));
+}
+
+D3D11FragmentShader *ShaderManagerD3D11::CompileFragmentShader(const FShaderID &id, bool useHWTransform) {
+	GenerateFragmentShaderD3D11(id, codeBuffer_, featureLevel_ <= D3D_FEATURE_LEVEL_9_3 ? HLSL_D3D11_LEVEL9 : HLSL_D3D11);
+	gpuStats.numShadersCompiled++;
+	return new D3D11FragmentShader(device_, id, codeBuffer_, GetBytecode(codeBuffer_, false), useHWTransform);
+}
+
+const std::vector<uint8_t> &ShaderManagerD3D11::GetBytecode(const char *code, bool vertex) {
+	const char *profile;
+	if (vertex)
+		profile = featureLevel_ <= D3D_FEATURE_LEVEL_9_3 ? "vs_4_0_level_9_1" : "vs_4_0";
+	else
+		profile = featureLevel_ <= D3D_FEATURE_LEVEL_9_3 ? "ps_4_0_level_9_1" : "ps_4_0";
+
+	size_t codeSize = strlen(code);
+	uint64_t key = XXH64(code, codeSize, XXH64(profile, strlen(profile), 0));
+	auto iter = bytecodeCache_.find(key);
+	if (iter != bytecodeCache_.end())
+		return iter->second;
+
+	std::vector<uint8_t> &bytecode = bytecodeCache_[key];
+	bytecode = CompileShaderToBytecodeD3D11(code, codeSize, profile);
+	return bytecode;
+}
+
+// Holds the shader IDs seen, plus the bytecode of every variant compiled.  Bytecode is keyed by
+// the generated source, so generator changes just miss instead of handing back stale shaders.
+#define CACHE_HEADER_MAGIC 0x44334443  // CD3D
+#define CACHE_VERSION 1
+struct D3D11CacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t featureFlags;
+	uint32_t featureLevel;
+	int numVertexShaders;
+	int numFragmentShaders;
+	int numBytecodes;
+	uint32_t reserved;
+};
+
+bool ShaderManagerD3D11::LoadCache(FILE *f) {
+	D3D11CacheHeader header{};
+	bool success = fread(&header, sizeof(header), 1, f) == 1;
+	if (!success || header.magic != CACHE_HEADER_MAGIC)
+		return false;
+	if (header.version != CACHE_VERSION)
+		return false;
+	if (header.featureFlags != gstate_c.featureFlags || header.featureLevel != (uint32_t)featureLevel_)
+		return false;
+
+	for (int i = 0; i < header.numBytecodes; i++) {
+		uint64_t key;
+		uint32_t size;
+		if (fread(&key, sizeof(key), 1, f) != 1 || fread(&size, sizeof(size), 1, f) != 1) {
+			ERROR_LOG(G3D, "D3D11 shader cache truncated");
+			return false;
+		}
+		std::vector<uint8_t> &bytecode = bytecodeCache_[key];
+		bytecode.resize(size);
+		if (fread(bytecode.data(), 1, size, f) != size) {
+			ERROR_LOG(G3D, "D3D11 shader cache truncated");
+			bytecodeCache_.erase(key);
+			return false;
+		}
+	}
+
+	for (int i = 0; i < header.numVertexShaders && !cancelCache_; i++) {
+		VShaderID id;
+		if (fread(&id, sizeof(id), 1, f) != 1) {
+			ERROR_LOG(G3D, "D3D11 shader cache truncated");
+			break;
+		}
+		if (vsCache_.find(id) == vsCache_.end())
+			vsCache_[id] = CompileVertexShader(id);
+	}
+	for (int i = 0; i < header.numFragmentShaders && !cancelCache_; i++) {
+		FShaderID id;
+		if (fread(&id, sizeof(id), 1, f) != 1) {
+			ERROR_LOG(G3D, "D3D11 shader cache truncated");
+			break;
+		}
+		// Not part of the ID, but fragment shaders don't use it anyway.
+		if (fsCache_.find(id) == fsCache_.end())
+			fsCache_[id] = CompileFragmentShader(id, true);
+	}
+
+	NOTICE_LOG(G3D, "Loaded %d vertex and %d fragment shaders", header.numVertexShaders, header.numFragmentShaders);
+	return true;
+}
+
+void ShaderManagerD3D11::SaveCache(FILE *f) {
+	D3D11CacheHeader header{};
+	header.magic = CACHE_HEADER_MAGIC;
+	header.version = CACHE_VERSION;
+	header.featureFlags = gstate_c.featureFlags;
+	header.featureLevel = (uint32_t)featureLevel_;
+	header.numVertexShaders = (int)vsCache_.size();
+	header.numFragmentShaders = (int)fsCache_.size();
+	for (const auto &iter : bytecodeCache_) {
+		if (!iter.second.empty())
+			header.numBytecodes++;
+	}
+	bool writeFailed = fwrite(&header, sizeof(header), 1, f) != 1;
+	for (const auto &iter : bytecodeCache_) {
+		// Failed compiles aren't kept, a newer compiler might manage next time.
+		if (iter.second.empty())
+			continue;
+		uint32_t size = (uint32_t)iter.second.size();
+		writeFailed = writeFailed || fwrite(&iter.first, sizeof(iter.first), 1, f) != 1;
+		writeFailed = writeFailed || fwrite(&size, sizeof(size), 1, f) != 1;
+		writeFailed = writeFailed || fwrite(iter.second.data(), 1, size, f) != size;
+	}
+	for (const auto &iter : vsCache_) {
+		writeFailed = writeFailed || fwrite(&iter.first, sizeof(iter.first), 1, f) != 1;
+	}
+	for (const auto &iter : fsCache_) {
+		writeFailed = writeFailed || fwrite(&iter.first, sizeof(iter.first), 1, f) != 1;
+	}
+	if (writeFailed) {
+		ERROR_LOG(G3D, "Failed to write D3D11 shader cache, disk full?");
+	} else {
+		NOTICE_LOG(G3D, "Saved %d vertex and %d fragment shaders", header.numVertexShaders, header.numFragmentShaders);
+	}
+}
+
 std::vector<std::string> ShaderManagerD3D11::DebugGetShaderIDs(DebugShaderType type) {
 	std::string id;
 	std::vector<std::string> ids;
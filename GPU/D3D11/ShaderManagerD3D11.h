@@ -17,9 +17,13 @@
 
 #pragma once
 
+#include <cstdio>
 #include <map>
+#include <unordered_map>
+#include <vector>
 
 #include <d3d11.h>
+#include <d3d11_1.h>
 
 #include "base/basictypes.h"
 #include "GPU/Common/ShaderCommon.h"
@@ -31,7 +35,7 @@ class D3D11PushBuffer;
 
 class D3D11FragmentShader {
 public:
-	D3D11FragmentShader(ID3D11Device *device, D3D_FEATURE_LEVEL featureLevel, FShaderID id, const char *code, bool useHWTransform);
+	D3D11FragmentShader(ID3D11Device *device, FShaderID id, const char *code, const std::vector<uint8_t> &bytecode, bool useHWTransform);
 	~D3D11FragmentShader();
 
 	const std::string &source() const { return source_; }
@@ -54,11 +58,13 @@ class D3D11FragmentShader {
 
 class D3D11VertexShader {
 public:
-	D3D11VertexShader(ID3D11Device *device, D3D_FEATURE_LEVEL featureLevel, VShaderID id, const char *code, int vertType, bool useHWTransform);
+	D3D11VertexShader(ID3D11Device *device, VShaderID id, const char *code, const std::vector<uint8_t> &bytecode, bool useHWTransform);
 	~D3D11VertexShader();
 
 	const std::string &source() const { return source_; }
 	const std::vector<uint8_t> &bytecode() const { return bytecode_; }
+	// Shaders with the same inputs can share input layouts.
+	u32 InputSignatureHash() const { return inputSignatureHash_; }
 	bool Failed() const { return failed_; }
 	bool UseHWTransform() const { return useHWTransform_; }
 
@@ -71,22 +77,24 @@ class D3D11VertexShader {
 	ID3D11Device *device_;
 	std::string source_;
 	std::vector<uint8_t> bytecode_;
+	u32 inputSignatureHash_ = 0;
 
 	bool failed_;
 	bool useHWTransform_;
 	VShaderID id_;
 };
 
-class D3D11PushBuffer;
+class PushBufferD3D11;
 
 class ShaderManagerD3D11 : public ShaderManagerCommon {
 public:
-	ShaderManagerD3D11(Draw::DrawContext *draw, ID3D11Device *device, ID3D11DeviceContext *context, D3D_FEATURE_LEVEL featureLevel);
+	ShaderManagerD3D11(Draw::DrawContext *draw, ID3D11Device *device, ID3D11DeviceContext *context, ID3D11DeviceContext1 *context1, D3D_FEATURE_LEVEL featureLevel);
 	~ShaderManagerD3D11();
 
 	void GetShaders(int prim, u32 vertType, D3D11VertexShader **vshader, D3D11FragmentShader **fshader, bool useHWTransform);
 	void ClearShaders();
 	void DirtyLastShader() override;
+	void BeginFrame();
 
 	int GetNumVertexShaders() const { return (int)vsCache_.size(); }
 	int GetNumFragmentShaders() const { return (int)fsCache_.size(); }
@@ -94,6 +102,13 @@ class ShaderManagerD3D11 : public ShaderManagerCommon {
 	std::vector<std::string> DebugGetShaderIDs(DebugShaderType type);
 	std::string DebugGetShaderString(std::string id, DebugShaderType type, DebugShaderStringType stringType);
 
+	// Shader IDs to recreate at boot, and the compiled bytecode so that's quick.
+	bool LoadCache(FILE *f);
+	void SaveCache(FILE *f);
+	void CancelCache() {
+		cancelCache_ = true;
+	}
+
 	uint64_t UpdateUniforms();
 	void BindUniforms();
 
@@ -105,9 +120,14 @@ class ShaderManagerD3D11 : public ShaderManagerCommon {
 
 private:
 	void Clear();
+	D3D11VertexShader *CompileVertexShader(const VShaderID &id);
+	D3D11FragmentShader *CompileFragmentShader(const FShaderID &id, bool useHWTransform);
+	const std::vector<uint8_t> &GetBytecode(const char *code, bool vertex);
+	UINT PushUniforms(const void *data, size_t size, size_t reserve);
 
 	ID3D11Device *device_;
 	ID3D11DeviceContext *context_;
+	ID3D11DeviceContext1 *context1_;
 	D3D_FEATURE_LEVEL featureLevel_;
 
 	typedef std::map<FShaderID, D3D11FragmentShader *> FSCache;
@@ -118,15 +138,32 @@ class ShaderManagerD3D11 : public ShaderManagerCommon {
 
 	char *codeBuffer_;
 
+	// Keyed by a hash of the generated source, since D3DCompile is slow.
+	std::unordered_map<uint64_t, std::vector<uint8_t>> bytecodeCache_;
+	bool cancelCache_ = false;
+
 	// Uniform block scratchpad. These (the relevant ones) are copied to the current pushbuffer at draw time.
 	UB_VS_FS_Base ub_base;
 	UB_VS_Lights ub_lights;
 	UB_VS_Bones ub_bones;
 
-	// Not actual pushbuffers, requires D3D11.1, let's try to live without that first.
-	ID3D11Buffer *push_base;
-	ID3D11Buffer *push_lights;
-	ID3D11Buffer *push_bones;
+	// With D3D11.1, all three blocks live in one ring that's bound at offsets, so an update
+	// doesn't have to discard a whole buffer for itself.
+	PushBufferD3D11 *uniformRing_ = nullptr;
+	bool ringReset_ = true;
+	// In constants (16 bytes), as VSSetConstantBuffers1 takes them.
+	UINT baseOffset_ = 0;
+	UINT lightsOffset_ = 0;
+	UINT bonesOffset_ = 0;
+
+	// Without it, each block is its own buffer, discarded on each update.
+	ID3D11Buffer *push_base = nullptr;
+	ID3D11Buffer *push_lights = nullptr;
+	ID3D11Buffer *push_bones = nullptr;
+	// Pending changes to the scratch blocks, uploaded when a shader needs them.
+	bool lightsDirty_ = true;
+	bool bonesDirty_ = true;
+	int bonesUploaded_ = 0;
 
 	D3D11FragmentShader *lastFShader_;
 	D3D11VertexShader *lastVShader_;
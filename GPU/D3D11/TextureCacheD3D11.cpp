@@ -33,6 +33,7 @@
 #include "GPU/D3D11/DepalettizeShaderD3D11.h"
 #include "GPU/D3D11/D3D11Util.h"
 #include "GPU/Common/FramebufferCommon.h"
+#include "GPU/Common/ScalingShaderCommon.h"
 #include "GPU/Common/TextureDecoder.h"
 #include "Core/Config.h"
 #include "Core/Host.h"
@@ -48,6 +49,36 @@ static const D3D11_INPUT_ELEMENT_DESC g_QuadVertexElements[] = {
 	{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12,},
 };
 
+static const char *scalingShaderHeader = R"(
+struct ParamsT {
+	int width;
+	int height;
+	int scale;
+	int fmt;
+};
+
+Texture2D<float4> srcTex : register(t0);
+RWTexture2D<unorm float4> dstTex : register(u0);
+cbuffer ParamsBuffer : register(b0) {
+	ParamsT params;
+};
+
+float4 readColorf(uint2 p) {
+	return srcTex.Load(int3(p, 0));
+}
+)";
+
+static const char *scalingShaderMain = R"(
+[numthreads(16, 16, 1)]
+void main(uint3 id : SV_DispatchThreadID) {
+	uint2 xy = id.xy;
+	// Threads outside the image (tiny textures) must not write anything.
+	if (xy.x >= (uint)params.width || xy.y >= (uint)params.height)
+		return;
+	dstTex[xy] = applyScalingf(xy / params.scale, xy);
+}
+)";
+
 SamplerCacheD3D11::~SamplerCacheD3D11() {
 	for (auto &iter : cache_) {
 		iter.second->Release();
@@ -118,12 +149,22 @@ TextureCacheD3D11::TextureCacheD3D11(Draw::DrawContext *draw)
 
 	SetupTextureDecoder();
 
+	// BC1-3 are required at every feature level, BC7 needs 11_0.
+	u32 compressedFormats = (1 << (int)ReplacedTextureFormat::F_BC1) | (1 << (int)ReplacedTextureFormat::F_BC2) | (1 << (int)ReplacedTextureFormat::F_BC3);
+	if (device_->GetFeatureLevel() >= D3D_FEATURE_LEVEL_11_0)
+		compressedFormats |= 1 << (int)ReplacedTextureFormat::F_BC7;
+	replacer_.SetCompressedFormats(compressedFormats);
+
 	nextTexture_ = nullptr;
 }
 
 TextureCacheD3D11::~TextureCacheD3D11() {
 	// pFramebufferVertexDecl->Release();
 	Clear(true);
+	if (scalingCS_)
+		scalingCS_->Release();
+	if (scalingParams_)
+		scalingParams_->Release();
 }
 
 void TextureCacheD3D11::SetFramebufferManager(FramebufferManagerD3D11 *fbManager) {
@@ -185,6 +226,7 @@ void TextureCacheD3D11::SetFramebufferSamplingParams(u16 bufferWidth, u16 buffer
 void TextureCacheD3D11::StartFrame() {
 	InvalidateLastTexture();
 	timesInvalidatedAllThisFrame_ = 0;
+	UpdateReplacements();
 
 	if (texelsScaledThisFrame_) {
 		// INFO_LOG(G3D, "Scaled %i texels", texelsScaledThisFrame_);
@@ -388,25 +430,28 @@ void TextureCacheD3D11::ApplyTextureFramebuffer(TexCacheEntry *entry, VirtualFra
 		const GEPaletteFormat clutFormat = gstate.getClutPaletteFormat();
 		ID3D11ShaderResourceView *clutTexture = depalShaderCache_->GetClutTexture(clutFormat, clutHash_, clutBuf_, expand32);
 
-		Draw::Framebuffer *depalFBO = framebufferManagerD3D11_->GetTempFBO(TempFBO::DEPAL, framebuffer->renderWidth, framebuffer->renderHeight, Draw::FBO_8888);
-		shaderManager_->DirtyLastShader();
-		draw_->BindPipeline(nullptr);
+		bool cached = false;
+		Draw::Framebuffer *depalFBO = GetDepalResult(framebuffer, &cached);
+		if (!cached) {
+			shaderManager_->DirtyLastShader();
+			draw_->BindPipeline(nullptr);
 
-		float xoff = -0.5f / framebuffer->renderWidth;
-		float yoff = 0.5f / framebuffer->renderHeight;
+			float xoff = -0.5f / framebuffer->renderWidth;
+			float yoff = 0.5f / framebuffer->renderHeight;
 
-		TextureShaderApplierD3D11 shaderApply(context_, pshader, framebufferManagerD3D11_->GetDynamicQuadBuffer(), framebuffer->bufferWidth, framebuffer->bufferHeight, framebuffer->renderWidth, framebuffer->renderHeight, xoff, yoff);
-		shaderApply.ApplyBounds(gstate_c.vertBounds, gstate_c.curTextureXOffset, gstate_c.curTextureYOffset, xoff, yoff);
-		shaderApply.Use(depalShaderCache_->GetDepalettizeVertexShader(), depalShaderCache_->GetInputLayout());
+			TextureShaderApplierD3D11 shaderApply(context_, pshader, framebufferManagerD3D11_->GetDynamicQuadBuffer(), framebuffer->bufferWidth, framebuffer->bufferHeight, framebuffer->renderWidth, framebuffer->renderHeight, xoff, yoff);
+			shaderApply.ApplyBounds(gstate_c.vertBounds, gstate_c.curTextureXOffset, gstate_c.curTextureYOffset, xoff, yoff);
+			shaderApply.Use(depalShaderCache_->GetDepalettizeVertexShader(), depalShaderCache_->GetInputLayout());
 
-		draw_->BindFramebufferAsRenderTarget(depalFBO, { Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE });
-		context_->PSSetShaderResources(3, 1, &clutTexture);
-		context_->PSSetSamplers(3, 1, &stockD3D11.samplerPoint2DWrap);
-		framebufferManagerD3D11_->BindFramebufferAsColorTexture(0, framebuffer, BINDFBCOLOR_SKIP_COPY | BINDFBCOLOR_FORCE_SELF);
-		context_->PSSetSamplers(0, 1, &stockD3D11.samplerPoint2DWrap);
-		shaderApply.Shade();
+			draw_->BindFramebufferAsRenderTarget(depalFBO, { Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE });
+			context_->PSSetShaderResources(3, 1, &clutTexture);
+			context_->PSSetSamplers(3, 1, &stockD3D11.samplerPoint2DWrap);
+			framebufferManagerD3D11_->BindFramebufferAsColorTexture(0, framebuffer, BINDFBCOLOR_SKIP_COPY | BINDFBCOLOR_FORCE_SELF);
+			context_->PSSetSamplers(0, 1, &stockD3D11.samplerPoint2DWrap);
+			shaderApply.Shade();
 
-		framebufferManagerD3D11_->RebindFramebuffer();
+			framebufferManagerD3D11_->RebindFramebuffer();
+		}
 		draw_->BindFramebufferAsTexture(depalFBO, 0, Draw::FB_COLOR_BIT, 0);
 
 		const u32 bytesPerColor = clutFormat == GE_CMODE_32BIT_ABGR8888 ? sizeof(u32) : sizeof(u16);
@@ -478,6 +523,8 @@ void TextureCacheD3D11::BuildTexture(TexCacheEntry *const entry) {
 				badMipSizes = true;
 		}
 	}
+	// What the game wants to sample, in case we drop the levels below.
+	const int gameMaxLevel = badMipSizes ? 0 : maxLevel;
 
 	int scaleFactor = standardScaleFactor_;
 
@@ -502,14 +549,16 @@ void TextureCacheD3D11::BuildTexture(TexCacheEntry *const entry) {
 	// Don't scale the PPGe texture.
 	if (entry->addr > 0x05000000 && entry->addr < PSP_GetKernelMemoryEnd())
 		scaleFactor = 1;
-	if ((entry->status & TexCacheEntry::STATUS_CHANGE_FREQUENT) != 0 && scaleFactor != 1) {
+	// The GPU scales fast enough to skip the per-frame limits.
+	bool hardwareScaling = !replaced.Valid() && UseHardwareScaling(scaleFactor);
+	if ((entry->status & TexCacheEntry::STATUS_CHANGE_FREQUENT) != 0 && scaleFactor != 1 && !hardwareScaling) {
 		// Remember for later that we /wanted/ to scale this texture.
 		entry->status |= TexCacheEntry::STATUS_TO_SCALE;
 		scaleFactor = 1;
 	}
 
 	if (scaleFactor != 1) {
-		if (texelsScaledThisFrame_ >= TEXCACHE_MAX_TEXELS_SCALED) {
+		if (texelsScaledThisFrame_ >= TEXCACHE_MAX_TEXELS_SCALED && !hardwareScaling) {
 			entry->status |= TexCacheEntry::STATUS_TO_SCALE;
 			scaleFactor = 1;
 		} else {
@@ -526,12 +575,19 @@ void TextureCacheD3D11::BuildTexture(TexCacheEntry *const entry) {
 
 	DXGI_FORMAT dstFmt = GetDestFormat(GETextureFormat(entry->format), gstate.getClutPaletteFormat());
 
+	// Upscaled textures and replacements without mips would otherwise lose the game's mipmapping.
+	// Optionally, have the GPU generate the missing levels from level 0 instead.
+	int genMipLevels = 0;
+	if (g_Config.bTexGPUMipmaps && gameMaxLevel > 0 && maxLevel == 0 && (scaleFactor > 1 || replaced.Valid())) {
+		genMipLevels = gameMaxLevel;
+	}
+
 	if (IsFakeMipmapChange()) {
 		// NOTE: Since the level is not part of the cache key, we assume it never changes.
 		u8 level = std::max(0, gstate.getTexLevelOffset16() / 16);
 		LoadTextureLevel(*entry, replaced, level, maxLevel, scaleFactor, dstFmt);
 	} else {
-		LoadTextureLevel(*entry, replaced, 0, maxLevel, scaleFactor, dstFmt);
+		LoadTextureLevel(*entry, replaced, 0, maxLevel, scaleFactor, dstFmt, genMipLevels);
 	}
 
 	ID3D11ShaderResourceView *textureView = DxView(entry);
@@ -544,6 +600,14 @@ void TextureCacheD3D11::BuildTexture(TexCacheEntry *const entry) {
 		for (int i = 1; i <= maxLevel; i++) {
 			LoadTextureLevel(*entry, replaced, i, maxLevel, scaleFactor, dstFmt);
 		}
+	} else if (genMipLevels > 0) {
+		// The format may not have supported it, in which case we just got one level.
+		D3D11_TEXTURE2D_DESC desc;
+		DxTex(entry)->GetDesc(&desc);
+		if (desc.MiscFlags & D3D11_RESOURCE_MISC_GENERATE_MIPS) {
+			context_->GenerateMips(textureView);
+			maxLevel = desc.MipLevels - 1;
+		}
 	}
 
 	if (maxLevel == 0) {
@@ -551,6 +615,8 @@ void TextureCacheD3D11::BuildTexture(TexCacheEntry *const entry) {
 	} else {
 		entry->status &= ~TexCacheEntry::STATUS_BAD_MIPS;
 	}
+	SetReplacedSize(entry, replaced.Valid() ? (u32)replaced.MemorySize() : 0);
+	SetScaledSize(entry, scaleFactor);
 	if (replaced.Valid()) {
 		entry->SetAlphaStatus(TexCacheEntry::TexStatus(replaced.AlphaStatus()));
 	}
@@ -632,15 +698,85 @@ DXGI_FORMAT ToDXGIFormat(ReplacedTextureFormat fmt) {
 	case ReplacedTextureFormat::F_5650: return DXGI_FORMAT_B5G6R5_UNORM;
 	case ReplacedTextureFormat::F_5551: return DXGI_FORMAT_B5G5R5A1_UNORM;
 	case ReplacedTextureFormat::F_4444: return DXGI_FORMAT_B4G4R4A4_UNORM;
+	case ReplacedTextureFormat::F_BC1: return DXGI_FORMAT_BC1_UNORM;
+	case ReplacedTextureFormat::F_BC2: return DXGI_FORMAT_BC2_UNORM;
+	case ReplacedTextureFormat::F_BC3: return DXGI_FORMAT_BC3_UNORM;
+	case ReplacedTextureFormat::F_BC7: return DXGI_FORMAT_BC7_UNORM;
 	case ReplacedTextureFormat::F_8888: default: return DXGI_FORMAT_B8G8R8A8_UNORM;
 	}
 }
 
-void TextureCacheD3D11::LoadTextureLevel(TexCacheEntry &entry, ReplacedTexture &replaced, int level, int maxLevel, int scaleFactor, DXGI_FORMAT dstFmt) {
+bool TextureCacheD3D11::UseHardwareScaling(int scaleFactor) {
+	// Deposterize only exists in the CPU scaler, and typed UAV stores need feature level 11_0.
+	if (scaleFactor <= 1 || !g_Config.bTexHardwareScaling || g_Config.bTexDeposterize)
+		return false;
+	if (device_->GetFeatureLevel() < D3D_FEATURE_LEVEL_11_0)
+		return false;
+
+	if (scalingShaderType_ != g_Config.iTexScalingType) {
+		if (scalingCS_)
+			scalingCS_->Release();
+		std::string code = scalingShaderHeader;
+		code += GenerateScalingShaderFunctions(g_Config.iTexScalingType, HLSL_D3D11);
+		code += scalingShaderMain;
+		scalingCS_ = CreateComputeShaderD3D11(device_, code.c_str(), code.size(), device_->GetFeatureLevel());
+		scalingShaderType_ = g_Config.iTexScalingType;
+		if (!scalingCS_)
+			ERROR_LOG(G3D, "Failed to compile texture scaling compute shader, falling back to CPU scaling");
+	}
+	if (scalingCS_ && !scalingParams_) {
+		D3D11_BUFFER_DESC desc{ 16, D3D11_USAGE_DEFAULT, D3D11_BIND_CONSTANT_BUFFER };
+		ASSERT_SUCCESS(device_->CreateBuffer(&desc, nullptr, &scalingParams_));
+	}
+	return scalingCS_ != nullptr;
+}
+
+void TextureCacheD3D11::ScaleTextureLevel(ID3D11Texture2D *texture, const u32 *pixelData, int decPitch, DXGI_FORMAT srcFmt, int w, int h, int scaleFactor) {
+	D3D11_TEXTURE2D_DESC desc{};
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.ArraySize = 1;
+	desc.SampleDesc.Count = 1;
+	desc.Width = w;
+	desc.Height = h;
+	desc.Format = srcFmt;
+	desc.MipLevels = 1;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	D3D11_SUBRESOURCE_DATA initData{ pixelData, (UINT)decPitch, 0 };
+
+	ID3D11Texture2D *srcTex;
+	ID3D11ShaderResourceView *srcView;
+	ID3D11UnorderedAccessView *dstView;
+	ASSERT_SUCCESS(device_->CreateTexture2D(&desc, &initData, &srcTex));
+	ASSERT_SUCCESS(device_->CreateShaderResourceView(srcTex, nullptr, &srcView));
+	ASSERT_SUCCESS(device_->CreateUnorderedAccessView(texture, nullptr, &dstView));
+
+	int params[4] = { w * scaleFactor, h * scaleFactor, scaleFactor, 0 };
+	context_->UpdateSubresource(scalingParams_, 0, nullptr, params, 0, 0);
+
+	context_->CSSetShader(scalingCS_, nullptr, 0);
+	context_->CSSetConstantBuffers(0, 1, &scalingParams_);
+	context_->CSSetShaderResources(0, 1, &srcView);
+	context_->CSSetUnorderedAccessViews(0, 1, &dstView, nullptr);
+	context_->Dispatch((w * scaleFactor + 15) / 16, (h * scaleFactor + 15) / 16, 1);
+
+	// Unbind so the texture can be sampled.
+	ID3D11ShaderResourceView *nullView = nullptr;
+	ID3D11UnorderedAccessView *nullUAV = nullptr;
+	context_->CSSetShaderResources(0, 1, &nullView);
+	context_->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
+	context_->CSSetShader(nullptr, nullptr, 0);
+
+	dstView->Release();
+	srcView->Release();
+	srcTex->Release();
+}
+
+void TextureCacheD3D11::LoadTextureLevel(TexCacheEntry &entry, ReplacedTexture &replaced, int level, int maxLevel, int scaleFactor, DXGI_FORMAT dstFmt, int genMipLevels) {
 	int w = gstate.getTextureWidth(level);
 	int h = gstate.getTextureHeight(level);
 
 	ID3D11Texture2D *texture = DxTex(&entry);
+	bool hardwareScaling = !replaced.Valid() && UseHardwareScaling(scaleFactor);
 	if ((level == 0 || IsFakeMipmapChange()) && texture == nullptr) {
 		// Create texture
 		int levels = scaleFactor == 1 ? maxLevel + 1 : 1;
@@ -651,7 +787,10 @@ void TextureCacheD3D11::LoadTextureLevel(TexCacheEntry &entry, ReplacedTexture &
 		} else {
 			tw *= scaleFactor;
 			th *= scaleFactor;
-			if (scaleFactor > 1) {
+			if (hardwareScaling) {
+				// UAVs can't store to BGRA.
+				tfmt = DXGI_FORMAT_R8G8B8A8_UNORM;
+			} else if (scaleFactor > 1) {
 				tfmt = DXGI_FORMAT_B8G8R8A8_UNORM;
 			}
 		}
@@ -667,6 +806,20 @@ void TextureCacheD3D11::LoadTextureLevel(TexCacheEntry &entry, ReplacedTexture &
 		desc.Format = tfmt;
 		desc.MipLevels = IsFakeMipmapChange() ? 1 : levels;
 		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		if (hardwareScaling)
+			desc.BindFlags |= D3D11_BIND_UNORDERED_ACCESS;
+
+		UINT support = 0;
+		if (genMipLevels > 0 && SUCCEEDED(device_->CheckFormatSupport(tfmt, &support)) && (support & D3D11_FORMAT_SUPPORT_MIP_AUTOGEN)) {
+			while (genMipLevels > 0 && ((tw >> genMipLevels) == 0 || (th >> genMipLevels) == 0))
+				genMipLevels--;
+			if (genMipLevels > 0) {
+				// GenerateMips renders the levels, so it needs a render target.
+				desc.MipLevels = genMipLevels + 1;
+				desc.BindFlags |= D3D11_BIND_RENDER_TARGET;
+				desc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+			}
+		}
 
 		ASSERT_SUCCESS(device_->CreateTexture2D(&desc, nullptr, &texture));
 		ID3D11ShaderResourceView *view;
@@ -680,8 +833,9 @@ void TextureCacheD3D11::LoadTextureLevel(TexCacheEntry &entry, ReplacedTexture &
 	u32 *mapData = nullptr;
 	int mapRowPitch = 0;
 	if (replaced.GetSize(level, w, h)) {
-		mapData = (u32 *)AllocateAlignedMemory(w * h * sizeof(u32), 16);
-		mapRowPitch = w * 4;
+		ReplacedTextureFormat fmt = replaced.Format(level);
+		mapRowPitch = ReplacedRowPitch(fmt, w);
+		mapData = (u32 *)AllocateAlignedMemory(mapRowPitch * ReplacedRowCount(fmt, h), 16);
 		replaced.Load(level, mapData, mapRowPitch);
 		dstFmt = ToDXGIFormat(replaced.Format(level));
 	} else {
@@ -692,7 +846,11 @@ void TextureCacheD3D11::LoadTextureLevel(TexCacheEntry &entry, ReplacedTexture &
 		int bpp = dstFmt == DXGI_FORMAT_B8G8R8A8_UNORM ? 4 : 2;
 		u32 *pixelData;
 		int decPitch;
-		if (scaleFactor > 1) {
+		if (hardwareScaling) {
+			tmpTexBufRearrange_.resize(std::max(bufw, w) * h);
+			pixelData = tmpTexBufRearrange_.data();
+			decPitch = w * bpp;
+		} else if (scaleFactor > 1) {
 			tmpTexBufRearrange_.resize(std::max(bufw, w) * h);
 			pixelData = tmpTexBufRearrange_.data();
 			// We want to end up with a neatly packed texture for scaling.
@@ -722,9 +880,11 @@ void TextureCacheD3D11::LoadTextureLevel(TexCacheEntry &entry, ReplacedTexture &
 			entry.SetAlphaStatus(TexCacheEntry::STATUS_ALPHA_UNKNOWN);
 		}
 
-		if (scaleFactor > 1) {
+		if (hardwareScaling) {
+			ScaleTextureLevel(texture, pixelData, decPitch, dstFmt, w, h, scaleFactor);
+		} else if (scaleFactor > 1) {
 			u32 scaleFmt = (u32)dstFmt;
-			scaler.ScaleAlways((u32 *)mapData, pixelData, scaleFmt, w, h, scaleFactor);
+			ScaleCached(scaler, entry.CacheKey(), entry.fullhash, level, (u32 *)mapData, pixelData, scaleFmt, w, h, scaleFactor);
 			pixelData = (u32 *)mapData;
 
 			// We always end up at 8888.  Other parts assume this.
@@ -750,13 +910,19 @@ void TextureCacheD3D11::LoadTextureLevel(TexCacheEntry &entry, ReplacedTexture &
 			replacedInfo.addr = entry.addr;
 			replacedInfo.isVideo = videos_.find(entry.addr & 0x3FFFFFFF) != videos_.end();
 			replacedInfo.isFinal = (entry.status & TexCacheEntry::STATUS_TO_SCALE) == 0;
-			replacedInfo.scaleFactor = scaleFactor;
+			// When scaling on the GPU, this saves the original.
+			replacedInfo.scaleFactor = hardwareScaling ? 1 : scaleFactor;
 			replacedInfo.fmt = FromD3D11Format(dstFmt);
 
 			replacer_.NotifyTextureDecoded(replacedInfo, pixelData, decPitch, level, w, h);
 		}
 	}
 
+	if (hardwareScaling) {
+		// Already written by the compute shader.
+		return;
+	}
+
 	if (IsFakeMipmapChange())
 		context_->UpdateSubresource(texture, 0, nullptr, mapData, mapRowPitch, 0);
 	else
@@ -69,13 +69,15 @@ class TextureCacheD3D11 : public TextureCacheCommon {
 	void ReleaseTexture(TexCacheEntry *entry, bool delete_them) override;
 
 private:
-	void LoadTextureLevel(TexCacheEntry &entry, ReplacedTexture &replaced, int level, int maxLevel, int scaleFactor, DXGI_FORMAT dstFmt);
+	void LoadTextureLevel(TexCacheEntry &entry, ReplacedTexture &replaced, int level, int maxLevel, int scaleFactor, DXGI_FORMAT dstFmt, int genMipLevels = 0);
 	DXGI_FORMAT GetDestFormat(GETextureFormat format, GEPaletteFormat clutFormat) const;
 	TexCacheEntry::TexStatus CheckAlpha(const u32 *pixelData, u32 dstFmt, int stride, int w, int h);
 	void UpdateCurrentClut(GEPaletteFormat clutFormat, u32 clutBase, bool clutIndexIsSimple) override;
 
 	void ApplyTextureFramebuffer(TexCacheEntry *entry, VirtualFramebuffer *framebuffer) override;
 	void BuildTexture(TexCacheEntry *const entry) override;
+	bool UseHardwareScaling(int scaleFactor);
+	void ScaleTextureLevel(ID3D11Texture2D *texture, const u32 *pixelData, int decPitch, DXGI_FORMAT srcFmt, int w, int h, int scaleFactor);
 
 	ID3D11Device *device_;
 	ID3D11DeviceContext *context_;
@@ -100,6 +102,11 @@ class TextureCacheD3D11 : public TextureCacheCommon {
 	FramebufferManagerD3D11 *framebufferManagerD3D11_;
 	DepalShaderCacheD3D11 *depalShaderCache_;
 	ShaderManagerD3D11 *shaderManager_;
+
+	// Compute shader upscaling, created on first use.
+	ID3D11ComputeShader *scalingCS_ = nullptr;
+	ID3D11Buffer *scalingParams_ = nullptr;
+	int scalingShaderType_ = -1;
 };
 
 DXGI_FORMAT GetClutDestFormatD3D11(GEPaletteFormat format);
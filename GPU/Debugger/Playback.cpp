@@ -43,6 +43,9 @@ namespace GPURecord {
 static std::string lastExecFilename;
 static std::vector<Command> lastExecCommands;
 static std::vector<u8> lastExecPushbuf;
+class DumpExecute;
+// Kept between frames while replaying multi-frame dumps.
+static DumpExecute *lastExec = nullptr;
 
 // This class maps pushbuffer (dump data) sections to PSP memory.
 // Dumps can be larger than available PSP memory, because they include generated data too.
@@ -277,7 +280,11 @@ class DumpExecute {
 	}
 	~DumpExecute();
 
+	// Runs until the next frame is displayed, or the end of the dump.
 	bool Run();
+	bool Done() const {
+		return nextCommand_ >= commands_.size();
+	}
 
 private:
 	void SyncStall();
@@ -304,6 +311,7 @@ class DumpExecute {
 	const int LIST_BUF_SIZE = 256 * 1024;
 	std::vector<u32> execListQueue;
 	u16 lastBufw_[8]{};
+	size_t nextCommand_ = 0;
 
 	const std::vector<u8> &pushbuf_;
 	const std::vector<Command> &commands_;
@@ -406,6 +414,11 @@ void DumpExecute::SubmitListEnd() {
 
 	SyncStall();
 	gpu->ListSync(execListID, 0);
+
+	// The list is finished, so the next frame needs a new one.
+	userMemory.Free(execListBuf);
+	execListBuf = 0;
+	execListPos = 0;
 }
 
 void DumpExecute::Init(u32 ptr, u32 sz) {
@@ -560,7 +573,8 @@ DumpExecute::~DumpExecute() {
 }
 
 bool DumpExecute::Run() {
-	for (const Command &cmd : commands_) {
+	while (nextCommand_ < commands_.size()) {
+		const Command &cmd = commands_[nextCommand_++];
 		switch (cmd.type) {
 		case CommandType::INIT:
 			Init(cmd.ptr, cmd.sz);
@@ -622,6 +636,11 @@ bool DumpExecute::Run() {
 
 		case CommandType::DISPLAY:
 			Display(cmd.ptr, cmd.sz);
+			if (!Done()) {
+				// More frames follow, continue on the next vblank.
+				SubmitListEnd();
+				return true;
+			}
 			break;
 
 		default:
@@ -653,7 +672,34 @@ static bool ReadCompressed(u32 fp, void *dest, size_t sz) {
 	return real_size == sz;
 }
 
+static bool ReadChunk(u32 fp, bool *truncated) {
+	u32 sz = 0;
+	if (pspFileSystem.ReadFile(fp, (u8 *)&sz, sizeof(sz)) != sizeof(sz)) {
+		return false;
+	}
+	u32 bufsz = 0;
+	if (pspFileSystem.ReadFile(fp, (u8 *)&bufsz, sizeof(bufsz)) != sizeof(bufsz)) {
+		*truncated = true;
+		return false;
+	}
+
+	size_t commandsPos = lastExecCommands.size();
+	size_t pushbufPos = lastExecPushbuf.size();
+	lastExecCommands.resize(commandsPos + sz);
+	lastExecPushbuf.resize(pushbufPos + bufsz);
+
+	if (!ReadCompressed(fp, lastExecCommands.data() + commandsPos, sizeof(Command) * sz) || !ReadCompressed(fp, lastExecPushbuf.data() + pushbufPos, bufsz)) {
+		lastExecCommands.resize(commandsPos);
+		lastExecPushbuf.resize(pushbufPos);
+		*truncated = true;
+		return false;
+	}
+	return true;
+}
+
 static void ReplayStop() {
+	delete lastExec;
+	lastExec = nullptr;
 	lastExecFilename.clear();
 	lastExecCommands.clear();
 	lastExecPushbuf.clear();
@@ -665,6 +711,12 @@ bool RunMountedReplay(const std::string &filename) {
 	Core_ListenStopRequest(&ReplayStop);
 	if (lastExecFilename != filename) {
 		PROFILE_THIS_SCOPE("ReplayLoad");
+		delete lastExec;
+		lastExec = nullptr;
+		lastExecFilename.clear();
+		lastExecCommands.clear();
+		lastExecPushbuf.clear();
+
 		u32 fp = pspFileSystem.OpenFile(filename, FILEACCESS_READ);
 		u8 header[8]{};
 		int version = 0;
@@ -677,30 +729,42 @@ bool RunMountedReplay(const std::string &filename) {
 			return false;
 		}
 
-		u32 sz = 0;
-		pspFileSystem.ReadFile(fp, (u8 *)&sz, sizeof(sz));
-		u32 bufsz = 0;
-		pspFileSystem.ReadFile(fp, (u8 *)&bufsz, sizeof(bufsz));
-
-		lastExecCommands.resize(sz);
-		lastExecPushbuf.resize(bufsz);
-
 		bool truncated = false;
-		truncated = truncated || !ReadCompressed(fp, lastExecCommands.data(), sizeof(Command) * sz);
-		truncated = truncated || !ReadCompressed(fp, lastExecPushbuf.data(), bufsz);
+		if (version >= 4) {
+			while (ReadChunk(fp, &truncated))
+				continue;
+			if (truncated && !lastExecCommands.empty()) {
+				// Probably still being written or cut off, but the complete chunks are still usable.
+				WARN_LOG(SYSTEM, "Truncated GE dump, ignoring last chunk");
+				truncated = false;
+			}
+		} else {
+			truncated = !ReadChunk(fp, &truncated);
+		}
 
 		pspFileSystem.CloseFile(fp);
 
-		if (truncated) {
+		if (truncated || lastExecCommands.empty()) {
 			ERROR_LOG(SYSTEM, "Truncated GE dump");
+			lastExecCommands.clear();
+			lastExecPushbuf.clear();
 			return false;
 		}
 
 		lastExecFilename = filename;
 	}
 
-	DumpExecute executor(lastExecPushbuf, lastExecCommands);
-	return executor.Run();
+	if (!lastExec) {
+		lastExec = new DumpExecute(lastExecPushbuf, lastExecCommands);
+	}
+
+	bool success = lastExec->Run();
+	if (!success || lastExec->Done()) {
+		// Start over from the beginning next time.
+		delete lastExec;
+		lastExec = nullptr;
+	}
+	return success;
 }
 
 };
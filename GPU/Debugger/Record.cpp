@@ -16,12 +16,20 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
 #include <functional>
+#include <mutex>
 #include <set>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <snappy-c.h>
 #include "base/stringutil.h"
+#include "ext/xxhash.h"
+#include "thread/threadutil.h"
 #include "Common/Common.h"
 #include "Common/FileUtil.h"
 #include "Common/Log.h"
@@ -40,30 +48,99 @@
 
 namespace GPURecord {
 
+// Recorded data is handed to the writer in chunks of about this size, or at the end of each frame.
+static const size_t CHUNK_SIZE = 4 * 1024 * 1024;
+
+struct RecordChunk {
+	std::vector<Command> commands;
+	std::vector<u8> pushbuf;
+};
+
+// Compresses and writes out chunks on a background thread, so recording doesn't stall the game.
+class RecordWriter {
+public:
+	~RecordWriter() {
+		if (thread_.joinable())
+			thread_.join();
+	}
+
+	bool Busy() const {
+		return busy_;
+	}
+
+	bool Begin(const std::string &filename);
+	void Queue(RecordChunk &&chunk);
+	// Called on the writer thread once the file is complete.
+	void End(void (*callback)(const std::string &));
+
+private:
+	void Run();
+	void WriteChunk(const RecordChunk &chunk);
+
+	std::thread thread_;
+	std::mutex lock_;
+	std::condition_variable cond_;
+	std::deque<RecordChunk> queue_;
+	bool ending_ = false;
+	std::atomic<bool> busy_{ false };
+
+	FILE *fp_ = nullptr;
+	std::string filename_;
+	void (*callback_)(const std::string &) = nullptr;
+};
+
 static bool active = false;
 static bool nextFrame = false;
+static int framesRequested = 1;
+static int framesLeft = 0;
 static int flipLastAction = -1;
+// Called from the writer thread, so protected by a lock.
+static std::mutex writeCallbackLock;
 static std::function<void(const std::string &)> writeCallback;
 
+// Only holds what was recorded since the last chunk was handed to the writer.
 static std::vector<u8> pushbuf;
 static std::vector<Command> commands;
+// Offset of pushbuf[0] within the whole recording.
+static u32 pushbufBase = 0;
 static std::vector<u32> lastRegisters;
-static std::vector<u32> lastTextures;
 static std::set<u32> lastRenderTargets;
+// Hash of each block of memory already written (seeded with its size), to its offset.
+static std::unordered_map<u64, u32> writtenBlocks;
+
+static RecordWriter writer;
+
+// Appends to the pushbuf, returning the offset within the recording.
+static u32 PushData(const void *p, u32 sz) {
+	u32 ptr = pushbufBase + (u32)pushbuf.size();
+	pushbuf.resize(pushbuf.size() + sz);
+	memcpy(pushbuf.data() + pushbuf.size() - sz, p, sz);
+	return ptr;
+}
 
 static void FlushRegisters() {
 	if (!lastRegisters.empty()) {
 		Command last{CommandType::REGISTERS};
-		last.ptr = (u32)pushbuf.size();
 		last.sz = (u32)(lastRegisters.size() * sizeof(u32));
-		pushbuf.resize(pushbuf.size() + last.sz);
-		memcpy(pushbuf.data() + last.ptr, lastRegisters.data(), last.sz);
+		last.ptr = PushData(lastRegisters.data(), last.sz);
 		lastRegisters.clear();
 
 		commands.push_back(last);
 	}
 }
 
+static void FlushChunk() {
+	if (commands.empty() && pushbuf.empty()) {
+		return;
+	}
+
+	RecordChunk chunk;
+	chunk.commands.swap(commands);
+	chunk.pushbuf.swap(pushbuf);
+	pushbufBase += (u32)chunk.pushbuf.size();
+	writer.Queue(std::move(chunk));
+}
+
 static std::string GenRecordingFilename() {
 	const std::string dumpDir = GetSysDirectory(DIRECTORY_DUMP);
 	const std::string prefix = dumpDir + g_paramSFO.GetDiscID();
@@ -80,21 +157,6 @@ static std::string GenRecordingFilename() {
 	return StringFromFormat("%s_%04d.ppdmp", prefix.c_str(), 9999);
 }
 
-static void BeginRecording() {
-	active = true;
-	nextFrame = false;
-	lastTextures.clear();
-	lastRenderTargets.clear();
-	flipLastAction = gpuStats.numFlips;
-
-	u32 ptr = (u32)pushbuf.size();
-	u32 sz = 512 * 4;
-	pushbuf.resize(pushbuf.size() + sz);
-	gstate.Save((u32_le *)(pushbuf.data() + ptr));
-
-	commands.push_back({CommandType::INIT, sz, ptr});
-}
-
 static void WriteCompressed(FILE *fp, const void *p, size_t sz) {
 	size_t compressed_size = snappy_max_compressed_length(sz);
 	u8 *compressed = new u8[compressed_size];
@@ -107,28 +169,98 @@ static void WriteCompressed(FILE *fp, const void *p, size_t sz) {
 	delete [] compressed;
 }
 
-static std::string WriteRecording() {
-	FlushRegisters();
-
-	const std::string filename = GenRecordingFilename();
+bool RecordWriter::Begin(const std::string &filename) {
+	if (thread_.joinable())
+		thread_.join();
 
 	NOTICE_LOG(G3D, "Recording filename: %s", filename.c_str());
+	fp_ = File::OpenCFile(filename, "wb");
+	if (!fp_) {
+		ERROR_LOG(G3D, "Unable to open %s for recording", filename.c_str());
+		return false;
+	}
+	fwrite(HEADER, 8, 1, fp_);
+	fwrite(&VERSION, sizeof(VERSION), 1, fp_);
+
+	filename_ = filename;
+	callback_ = nullptr;
+	ending_ = false;
+	busy_ = true;
+	thread_ = std::thread(&RecordWriter::Run, this);
+	return true;
+}
 
-	FILE *fp = File::OpenCFile(filename, "wb");
-	fwrite(HEADER, 8, 1, fp);
-	fwrite(&VERSION, sizeof(VERSION), 1, fp);
+void RecordWriter::Queue(RecordChunk &&chunk) {
+	std::lock_guard<std::mutex> guard(lock_);
+	queue_.push_back(std::move(chunk));
+	cond_.notify_one();
+}
+
+void RecordWriter::End(void (*callback)(const std::string &)) {
+	std::lock_guard<std::mutex> guard(lock_);
+	callback_ = callback;
+	ending_ = true;
+	cond_.notify_one();
+}
+
+void RecordWriter::Run() {
+	setCurrentThreadName("GERecordWriter");
+
+	std::unique_lock<std::mutex> guard(lock_);
+	while (true) {
+		cond_.wait(guard, [this] { return !queue_.empty() || ending_; });
+		if (queue_.empty())
+			break;
 
-	u32 sz = (u32)commands.size();
-	fwrite(&sz, sizeof(sz), 1, fp);
-	u32 bufsz = (u32)pushbuf.size();
-	fwrite(&bufsz, sizeof(bufsz), 1, fp);
+		RecordChunk chunk = std::move(queue_.front());
+		queue_.pop_front();
+		guard.unlock();
+		WriteChunk(chunk);
+		guard.lock();
+	}
+	guard.unlock();
+
+	fclose(fp_);
+	fp_ = nullptr;
+	NOTICE_LOG(SYSTEM, "Recording written");
 
-	WriteCompressed(fp, commands.data(), commands.size() * sizeof(Command));
-	WriteCompressed(fp, pushbuf.data(), bufsz);
+	if (callback_)
+		callback_(filename_);
+	callback_ = nullptr;
+	busy_ = false;
+}
 
-	fclose(fp);
+void RecordWriter::WriteChunk(const RecordChunk &chunk) {
+	u32 sz = (u32)chunk.commands.size();
+	fwrite(&sz, sizeof(sz), 1, fp_);
+	u32 bufsz = (u32)chunk.pushbuf.size();
+	fwrite(&bufsz, sizeof(bufsz), 1, fp_);
 
-	return filename;
+	WriteCompressed(fp_, chunk.commands.data(), chunk.commands.size() * sizeof(Command));
+	WriteCompressed(fp_, chunk.pushbuf.data(), bufsz);
+}
+
+static void BeginRecording() {
+	nextFrame = false;
+	if (!writer.Begin(GenRecordingFilename())) {
+		std::lock_guard<std::mutex> guard(writeCallbackLock);
+		writeCallback = nullptr;
+		return;
+	}
+
+	active = true;
+	framesLeft = framesRequested;
+	lastRenderTargets.clear();
+	writtenBlocks.clear();
+	pushbufBase = 0;
+	flipLastAction = gpuStats.numFlips;
+
+	u32_le regs[512];
+	gstate.Save(regs);
+	u32 sz = (u32)sizeof(regs);
+	u32 ptr = PushData(regs, sz);
+
+	commands.push_back({CommandType::INIT, sz, ptr});
 }
 
 static void GetVertDataSizes(int vcount, const void *indices, u32 &vbytes, u32 &ibytes) {
@@ -184,36 +316,43 @@ static Command EmitCommandWithRAM(CommandType t, const void *p, u32 sz) {
 	Command cmd{t, sz, 0};
 
 	if (sz) {
-		// If at all possible, try to find it already in the buffer.
-		const u8 *prev = nullptr;
-		const size_t NEAR_WINDOW = std::max((int)sz * 2, 1024 * 10);
-		// Let's try nearby first... it will often be nearby.
-		if (pushbuf.size() > NEAR_WINDOW) {
-			prev = mymemmem(pushbuf.data() + pushbuf.size() - NEAR_WINDOW, NEAR_WINDOW, (const u8 *)p, sz);
-		}
-		if (!prev) {
-			prev = mymemmem(pushbuf.data(), pushbuf.size(), (const u8 *)p, sz);
-		}
-
-		if (prev) {
-			cmd.ptr = (u32)(prev - pushbuf.data());
+		// Dumps are huge, and most data is the same as in a previous draw or frame.
+		u64 hash = XXH64(p, sz, sz);
+		auto it = writtenBlocks.find(hash);
+		if (it != writtenBlocks.end()) {
+			cmd.ptr = it->second;
 		} else {
-			cmd.ptr = (u32)pushbuf.size();
-			int pad = 0;
-			if (cmd.ptr & 0xF) {
-				pad = 0x10 - (cmd.ptr & 0xF);
-				cmd.ptr += pad;
+			// It may also be part of something written just before, like a subset of vertices.
+			const size_t NEAR_WINDOW = std::max((int)sz * 2, 1024 * 10);
+			const u8 *prev;
+			if (pushbuf.size() > NEAR_WINDOW) {
+				prev = mymemmem(pushbuf.data() + pushbuf.size() - NEAR_WINDOW, NEAR_WINDOW, (const u8 *)p, sz);
+			} else {
+				prev = mymemmem(pushbuf.data(), pushbuf.size(), (const u8 *)p, sz);
 			}
-			pushbuf.resize(pushbuf.size() + sz + pad);
-			if (pad) {
-				memset(pushbuf.data() + cmd.ptr - pad, 0, pad);
+
+			if (prev) {
+				cmd.ptr = pushbufBase + (u32)(prev - pushbuf.data());
+			} else {
+				size_t pos = pushbuf.size();
+				u32 pad = (0x10 - ((pushbufBase + pos) & 0xF)) & 0xF;
+				pushbuf.resize(pos + pad + sz);
+				if (pad) {
+					memset(pushbuf.data() + pos, 0, pad);
+				}
+				memcpy(pushbuf.data() + pos + pad, p, sz);
+				cmd.ptr = pushbufBase + (u32)(pos + pad);
 			}
-			memcpy(pushbuf.data() + cmd.ptr, p, sz);
+			writtenBlocks[hash] = cmd.ptr;
 		}
 	}
 
 	commands.push_back(cmd);
 
+	if (pushbuf.size() >= CHUNK_SIZE) {
+		FlushChunk();
+	}
+
 	return cmd;
 }
 
@@ -253,24 +392,8 @@ static void EmitTextureData(int level, u32 texaddr) {
 	}
 
 	if (bytes > 0) {
-		FlushRegisters();
-
-		// Dumps are huge - let's try to find this already emitted.
-		for (u32 prevptr : lastTextures) {
-			if (pushbuf.size() < prevptr + bytes) {
-				continue;
-			}
-
-			if (memcmp(pushbuf.data() + prevptr, p, bytes) == 0) {
-				commands.push_back({type, bytes, prevptr});
-				// Okay, that was easy.  Bail out.
-				return;
-			}
-		}
-
-		// Not there, gotta emit anew.
-		Command cmd = EmitCommandWithRAM(type, p, bytes);
-		lastTextures.push_back(cmd.ptr);
+		// This reuses the data if the texture was already emitted.
+		EmitCommandWithRAM(type, p, bytes);
 	}
 }
 
@@ -370,9 +493,11 @@ bool IsActivePending() {
 	return nextFrame || active;
 }
 
-bool Activate() {
-	if (!nextFrame) {
+bool Activate(int frames) {
+	// Wait for the previous recording to finish writing, too.
+	if (!nextFrame && !active && !writer.Busy()) {
 		nextFrame = true;
+		framesRequested = std::max(frames, 1);
 		flipLastAction = gpuStats.numFlips;
 		return true;
 	}
@@ -380,22 +505,38 @@ bool Activate() {
 }
 
 void SetCallback(const std::function<void(const std::string &)> callback) {
+	std::lock_guard<std::mutex> guard(writeCallbackLock);
 	writeCallback = callback;
 }
 
+static void RecordingWritten(const std::string &filename) {
+	std::lock_guard<std::mutex> guard(writeCallbackLock);
+	if (writeCallback)
+		writeCallback(filename);
+	writeCallback = nullptr;
+}
+
 static void FinishRecording() {
-	// We're done - this was just to write the result out.
-	std::string filename = WriteRecording();
-	commands.clear();
-	pushbuf.clear();
+	// We're done - hand off the rest, the writer calls back once it's all on disk.
+	FlushRegisters();
+	FlushChunk();
+	writer.End(&RecordingWritten);
+	writtenBlocks.clear();
 
 	NOTICE_LOG(SYSTEM, "Recording finished");
 	active = false;
 	flipLastAction = gpuStats.numFlips;
+}
 
-	if (writeCallback)
-		writeCallback(filename);
-	writeCallback = nullptr;
+static void FinishRecordedFrame() {
+	if (--framesLeft > 0) {
+		// Keep going, but stream out what we have so far.
+		FlushRegisters();
+		FlushChunk();
+		flipLastAction = gpuStats.numFlips;
+	} else {
+		FinishRecording();
+	}
 }
 
 void NotifyCommand(u32 pc) {
@@ -457,9 +598,7 @@ void NotifyMemcpy(u32 dest, u32 src, u32 sz) {
 	}
 	if (Memory::IsVRAMAddress(dest)) {
 		FlushRegisters();
-		Command cmd{CommandType::MEMCPYDEST, sizeof(dest), (u32)pushbuf.size()};
-		pushbuf.resize(pushbuf.size() + sizeof(dest));
-		memcpy(pushbuf.data() + cmd.ptr, &dest, sizeof(dest));
+		Command cmd{CommandType::MEMCPYDEST, sizeof(dest), PushData(&dest, sizeof(dest))};
 
 		sz = Memory::ValidSize(dest, sz);
 		if (sz != 0) {
@@ -483,9 +622,7 @@ void NotifyMemset(u32 dest, int v, u32 sz) {
 		MemsetCommand data{dest, v, sz};
 
 		FlushRegisters();
-		Command cmd{CommandType::MEMSET, sizeof(data), (u32)pushbuf.size()};
-		pushbuf.resize(pushbuf.size() + sizeof(data));
-		memcpy(pushbuf.data() + cmd.ptr, &data, sizeof(data));
+		Command cmd{CommandType::MEMSET, sizeof(data), PushData(&data, sizeof(data))};
 	}
 }
 
@@ -517,16 +654,14 @@ void NotifyDisplay(u32 framebuf, int stride, int fmt) {
 	DisplayBufData disp{ { framebuf }, stride, fmt };
 
 	FlushRegisters();
-	u32 ptr = (u32)pushbuf.size();
 	u32 sz = (u32)sizeof(disp);
-	pushbuf.resize(pushbuf.size() + sz);
-	memcpy(pushbuf.data() + ptr, &disp, sz);
+	u32 ptr = PushData(&disp, sz);
 
 	commands.push_back({ CommandType::DISPLAY, sz, ptr });
 
 	if (writePending) {
-		NOTICE_LOG(SYSTEM, "Recording complete on display");
-		FinishRecording();
+		NOTICE_LOG(SYSTEM, "Recording frame complete on display");
+		FinishRecordedFrame();
 	}
 }
 
@@ -534,7 +669,7 @@ void NotifyFrame() {
 	const bool noDisplayAction = flipLastAction + 4 < gpuStats.numFlips;
 	// We do this only to catch things that don't call NotifyDisplay.
 	if (active && !commands.empty() && noDisplayAction) {
-		NOTICE_LOG(SYSTEM, "Recording complete on frame");
+		NOTICE_LOG(SYSTEM, "Recording frame complete on frame");
 
 		struct DisplayBufData {
 			PSPPointer<u8> topaddr;
@@ -545,14 +680,12 @@ void NotifyFrame() {
 		__DisplayGetFramebuf(&disp.topaddr, &disp.linesize, &disp.pixelFormat, 0);
 
 		FlushRegisters();
-		u32 ptr = (u32)pushbuf.size();
 		u32 sz = (u32)sizeof(disp);
-		pushbuf.resize(pushbuf.size() + sz);
-		memcpy(pushbuf.data() + ptr, &disp, sz);
+		u32 ptr = PushData(&disp, sz);
 
 		commands.push_back({ CommandType::DISPLAY, sz, ptr });
 
-		FinishRecording();
+		FinishRecordedFrame();
 	}
 	if (nextFrame && (gstate_c.skipDrawReason & SKIPDRAW_SKIPFRAME) == 0 && noDisplayAction) {
 		NOTICE_LOG(SYSTEM, "Recording starting on frame...");
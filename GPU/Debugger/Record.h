@@ -25,8 +25,9 @@ namespace GPURecord {
 
 bool IsActive();
 bool IsActivePending();
-bool Activate();
-// Call only if Activate() returns true.
+// Records the next frames, pass more than one for a multi-frame capture.
+bool Activate(int frames = 1);
+// Call only if Activate() returns true. Called once the file is complete, possibly from another thread.
 void SetCallback(const std::function<void(const std::string &)> callback);
 
 void NotifyCommand(u32 pc);
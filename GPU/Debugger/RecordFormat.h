@@ -25,7 +25,8 @@ static const char *HEADER = "PPSSPPGE";
 // Version 1: Uncompressed
 // Version 2: Uses snappy
 // Version 3: Adds FRAMEBUF0-FRAMEBUF9
-static const int VERSION = 3;
+// Version 4: Streamed in chunks, may contain multiple frames
+static const int VERSION = 4;
 static const int MIN_VERSION = 2;
 
 enum class CommandType : u8 {
@@ -59,6 +60,10 @@ enum class CommandType : u8 {
 	FRAMEBUF7 = 0x1F,
 };
 
+// From version 4, the file is a series of chunks until EOF, each with:
+//   u32 command count, u32 pushbuf size, compressed commands, compressed pushbuf
+// Command ptrs are offsets into all chunks' pushbufs, concatenated.
+
 #pragma pack(push, 1)
 
 struct Command {
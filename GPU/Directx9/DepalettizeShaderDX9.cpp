@@ -143,6 +143,14 @@ void DepalShaderCacheDX9::Decimate() {
 	}
 }
 
+void DepalShaderCacheDX9::Precompile() {
+	std::vector<std::pair<uint32_t, GEBufferFormat>> variants;
+	GetCommonVariants(variants);
+	for (const auto &variant : variants) {
+		GetDepalettizePixelShader(variant.first, variant.second);
+	}
+}
+
 LPDIRECT3DPIXELSHADER9 DepalShaderCacheDX9::GetDepalettizePixelShader(uint32_t clutMode, GEBufferFormat pixelFormat) {
 	u32 id = GenerateShaderID(clutMode, pixelFormat);
 
@@ -153,7 +161,7 @@ LPDIRECT3DPIXELSHADER9 DepalShaderCacheDX9::GetDepalettizePixelShader(uint32_t c
 
 	char *buffer = new char[2048];
 
-	GenerateDepalShader(buffer, pixelFormat, HLSL_DX9);
+	GenerateDepalShader(buffer, clutMode, pixelFormat, HLSL_DX9);
 
 	LPDIRECT3DPIXELSHADER9 pshader;
 	std::string errorMessage;
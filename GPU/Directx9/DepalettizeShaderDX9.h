@@ -49,6 +49,8 @@ class DepalShaderCacheDX9 : public DepalShaderCacheCommon {
 	LPDIRECT3DTEXTURE9 GetClutTexture(GEPaletteFormat clutFormat, u32 clutHash, u32 *rawClut);
 	void Clear();
 	void Decimate();
+	// Compiles the common variants up front, so the first use doesn't stutter.
+	void Precompile();
 	std::vector<std::string> DebugGetShaderIDs(DebugShaderType type);
 	std::string DebugGetShaderString(std::string id, DebugShaderType type, DebugShaderStringType stringType);
 
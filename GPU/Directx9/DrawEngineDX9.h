@@ -54,47 +54,12 @@ enum {
 };
 
 // Try to keep this POD.
-class VertexArrayInfoDX9 {
+class VertexArrayInfoDX9 : public VertexArrayInfoCommon {
 public:
-	VertexArrayInfoDX9() {
-		status = VAI_NEW;
-		vbo = 0;
-		ebo = 0;
-		prim = GE_PRIM_INVALID;
-		numDraws = 0;
-		numFrames = 0;
-		lastFrame = gpuStats.numFlips;
-		numVerts = 0;
-		drawsUntilNextFullHash = 0;
-		flags = 0;
-	}
 	~VertexArrayInfoDX9();
 
-	enum Status : uint8_t {
-		VAI_NEW,
-		VAI_HASHING,
-		VAI_RELIABLE,  // cache, don't hash
-		VAI_UNRELIABLE,  // never cache
-	};
-
-	ReliableHashType hash;
-	u32 minihash;
-
-	LPDIRECT3DVERTEXBUFFER9 vbo;
-	LPDIRECT3DINDEXBUFFER9 ebo;
-
-	// Precalculated parameter for drawRangeElements
-	u16 numVerts;
-	u16 maxIndex;
-	s8 prim;
-	Status status;
-
-	// ID information
-	int numDraws;
-	int numFrames;
-	int lastFrame;  // So that we can forget.
-	u16 drawsUntilNextFullHash;
-	u8 flags;
+	LPDIRECT3DVERTEXBUFFER9 vbo = nullptr;
+	LPDIRECT3DINDEXBUFFER9 ebo = nullptr;
 };
 
 class TessellationDataTransferDX9 : public TessellationDataTransfer {
@@ -150,6 +115,7 @@ class DrawEngineDX9 : public DrawEngineCommon {
 	IDirect3DVertexDeclaration9 *SetupDecFmtForDraw(VSShader *vshader, const DecVtxFormat &decFmt, u32 pspFmt);
 
 	void MarkUnreliable(VertexArrayInfoDX9 *vai);
+	void FreeVertexArray(VertexArrayInfoDX9 *vai);
 
 	LPDIRECT3DDEVICE9 device_ = nullptr;
 
@@ -312,7 +312,7 @@ static const D3DVERTEXELEMENT9 g_FramebufferVertexElements[] = {
 		device_->SetVertexShader(pFramebufferVertexShader);
 	}
 
-	void FramebufferManagerDX9::BindPostShader(const PostShaderUniforms &uniforms) {
+	void FramebufferManagerDX9::BindPostShader(const PostShaderUniforms &uniforms, int pass) {
 		Bind2DShader();
 	}
 
@@ -707,8 +707,6 @@ static const D3DVERTEXELEMENT9 g_FramebufferVertexElements[] = {
 			it.second.surface->Release();
 		}
 		offscreenSurfaces_.clear();
-
-		SetNumExtraFBOs(0);
 	}
 
 	void FramebufferManagerDX9::Resized() {
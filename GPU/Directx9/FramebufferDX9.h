@@ -69,7 +69,7 @@ class FramebufferManagerDX9 : public FramebufferManagerCommon {
 
 protected:
 	void Bind2DShader() override;
-	void BindPostShader(const PostShaderUniforms &uniforms) override;
+	void BindPostShader(const PostShaderUniforms &uniforms, int pass) override;
 	void SetViewport2D(int x, int y, int w, int h) override;
 	void DecimateFBOs() override;
 
@@ -79,6 +79,8 @@ GPU_DX9::GPU_DX9(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 	textureCacheDX9_->SetFramebufferManager(framebufferManagerDX9_);
 	textureCacheDX9_->SetDepalShaderCache(&depalShaderCache_);
 	textureCacheDX9_->SetShaderManager(shaderManagerDX9_);
+	if (!g_Config.bDisableSlowFramebufEffects)
+		depalShaderCache_.Precompile();
 
 	// Sanity check gstate
 	if ((int *)&gstate.transferstart - (int *)&gstate != 0xEA) {
@@ -96,6 +98,7 @@ GPU_DX9::GPU_DX9(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 	// We restore each frame anyway, but here is convenient for tests.
 	dxstate.Restore();
 	textureCache_->NotifyConfigChanged();
+	LoadVertexDecoderCache();
 
 	if (g_Config.bHardwareTessellation) {
 		// Disable hardware tessellation bacause DX9 is still unsupported.
@@ -229,6 +232,7 @@ void GPU_DX9::CheckGPUFeatures() {
 }
 
 GPU_DX9::~GPU_DX9() {
+	SaveVertexDecoderCache();
 	framebufferManagerDX9_->DestroyAllFBOs();
 	delete framebufferManagerDX9_;
 	delete textureCache_;
@@ -257,6 +261,13 @@ void GPU_DX9::DeviceRestore() {
 	// Nothing needed.
 }
 
+void GPU_DX9::Reinitialize() {
+	GPUCommon::Reinitialize();
+	textureCacheDX9_->Clear(true);
+	depalShaderCache_.Clear();
+	framebufferManagerDX9_->DestroyAllFBOs();
+}
+
 void GPU_DX9::InitClear() {
 	bool useNonBufferedRendering = g_Config.iRenderingMode == FB_NON_BUFFERED_MODE;
 	if (useNonBufferedRendering) {
@@ -361,12 +372,13 @@ void GPU_DX9::GetStats(char *buffer, size_t bufsize) {
 	float vertexAverageCycles = gpuStats.numVertsSubmitted > 0 ? (float)gpuStats.vertexGPUCycles / (float)gpuStats.numVertsSubmitted : 0.0f;
 	snprintf(buffer, bufsize - 1,
 		"DL processing time: %0.2f ms\n"
-		"Draw calls: %i, flushes %i, clears %i\n"
+		"Draw calls: %i, flushes %i (%i skipped), clears %i\n"
 		"Cached Draw calls: %i\n"
 		"Num Tracked Vertex Arrays: %i\n"
 		"GPU cycles executed: %d (%f per vertex)\n"
 		"Commands per call level: %i %i %i %i\n"
 		"Vertices submitted: %i\n"
+		"Draw temporaries peak: %i KB\n"
 		"Cached, Uncached Vertices Drawn: %i, %i\n"
 		"FBOs active: %i\n"
 		"Textures active: %i, decoded: %i  invalidated: %i\n"
@@ -375,6 +387,7 @@ void GPU_DX9::GetStats(char *buffer, size_t bufsize) {
 		gpuStats.msProcessingDisplayLists * 1000.0f,
 		gpuStats.numDrawCalls,
 		gpuStats.numFlushes,
+		gpuStats.numFlushesSkipped,
 		gpuStats.numClears,
 		gpuStats.numCachedDrawCalls,
 		gpuStats.numTrackedVertexArrays,
@@ -382,6 +395,7 @@ void GPU_DX9::GetStats(char *buffer, size_t bufsize) {
 		vertexAverageCycles,
 		gpuStats.gpuCommandsAtCallLevel[0], gpuStats.gpuCommandsAtCallLevel[1], gpuStats.gpuCommandsAtCallLevel[2], gpuStats.gpuCommandsAtCallLevel[3],
 		gpuStats.numVertsSubmitted,
+		gpuStats.frameArenaHighWater / 1024,
 		gpuStats.numCachedVertsDrawn,
 		gpuStats.numUncachedVertsDrawn,
 		(int)framebufferManagerDX9_->NumVFBs(),
@@ -408,7 +422,7 @@ void GPU_DX9::DoState(PointerWrap &p) {
 
 	// TODO: Some of these things may not be necessary.
 	// None of these are necessary when saving.
-	if (p.mode == p.MODE_READ && !PSP_CoreParameter().frozen) {
+	if (p.mode == p.MODE_READ && !PSP_CoreParameter().frozen && !PSP_CoreParameter().runAheadFrame) {
 		textureCacheDX9_->Clear(true);
 		drawEngine_.ClearTrackedVertexArrays();
 
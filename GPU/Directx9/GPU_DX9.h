@@ -69,6 +69,7 @@ class GPU_DX9 : public GPUCommon {
 	void BuildReportingInfo();
 
 	void InitClear() override;
+	void Reinitialize() override;
 	void BeginFrame() override;
 	void CopyDisplayToOutput() override;
 
@@ -603,6 +603,7 @@ VSShader *ShaderManagerDX9::ApplyShader(int prim, u32 vertType) {
 		}
 
 		vsCache_[VSID] = vs;
+		gpuStats.numShadersCompiled++;
 	} else {
 		vs = vsIter->second;
 	}
@@ -615,6 +616,7 @@ VSShader *ShaderManagerDX9::ApplyShader(int prim, u32 vertType) {
 		GenerateFragmentShaderHLSL(FSID, codeBuffer_);
 		fs = new PSShader(device_, FSID, codeBuffer_);
 		fsCache_[FSID] = fs;
+		gpuStats.numShadersCompiled++;
 	} else {
 		fs = fsIter->second;
 	}
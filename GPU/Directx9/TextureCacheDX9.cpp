@@ -221,6 +221,7 @@ void TextureCacheDX9::SetFramebufferSamplingParams(u16 bufferWidth, u16 bufferHe
 void TextureCacheDX9::StartFrame() {
 	InvalidateLastTexture();
 	timesInvalidatedAllThisFrame_ = 0;
+	UpdateReplacements();
 
 	if (texelsScaledThisFrame_) {
 		// INFO_LOG(G3D, "Scaled %i texels", texelsScaledThisFrame_);
@@ -426,30 +427,33 @@ void TextureCacheDX9::ApplyTextureFramebuffer(TexCacheEntry *entry, VirtualFrame
 		const GEPaletteFormat clutFormat = gstate.getClutPaletteFormat();
 		LPDIRECT3DTEXTURE9 clutTexture = depalShaderCache_->GetClutTexture(clutFormat, clutHash_, clutBuf_);
 
-		Draw::Framebuffer *depalFBO = framebufferManagerDX9_->GetTempFBO(TempFBO::DEPAL, framebuffer->renderWidth, framebuffer->renderHeight, Draw::FBO_8888);
-		draw_->BindFramebufferAsRenderTarget(depalFBO, { Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE });
-		shaderManager_->DirtyLastShader();
+		bool cached = false;
+		Draw::Framebuffer *depalFBO = GetDepalResult(framebuffer, &cached);
+		if (!cached) {
+			draw_->BindFramebufferAsRenderTarget(depalFBO, { Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE });
+			shaderManager_->DirtyLastShader();
 
-		float xoff = -0.5f / framebuffer->renderWidth;
-		float yoff = 0.5f / framebuffer->renderHeight;
+			float xoff = -0.5f / framebuffer->renderWidth;
+			float yoff = 0.5f / framebuffer->renderHeight;
 
-		TextureShaderApplierDX9 shaderApply(device_, pshader, pFramebufferVertexDecl, framebuffer->bufferWidth, framebuffer->bufferHeight, framebuffer->renderWidth, framebuffer->renderHeight, xoff, yoff);
-		shaderApply.ApplyBounds(gstate_c.vertBounds, gstate_c.curTextureXOffset, gstate_c.curTextureYOffset, xoff, yoff);
-		shaderApply.Use(depalShaderCache_->GetDepalettizeVertexShader());
+			TextureShaderApplierDX9 shaderApply(device_, pshader, pFramebufferVertexDecl, framebuffer->bufferWidth, framebuffer->bufferHeight, framebuffer->renderWidth, framebuffer->renderHeight, xoff, yoff);
+			shaderApply.ApplyBounds(gstate_c.vertBounds, gstate_c.curTextureXOffset, gstate_c.curTextureYOffset, xoff, yoff);
+			shaderApply.Use(depalShaderCache_->GetDepalettizeVertexShader());
 
-		device_->SetTexture(1, clutTexture);
-		device_->SetSamplerState(1, D3DSAMP_MINFILTER, D3DTEXF_POINT);
-		device_->SetSamplerState(1, D3DSAMP_MAGFILTER, D3DTEXF_POINT);
-		device_->SetSamplerState(1, D3DSAMP_MIPFILTER, D3DTEXF_NONE);
+			device_->SetTexture(1, clutTexture);
+			device_->SetSamplerState(1, D3DSAMP_MINFILTER, D3DTEXF_POINT);
+			device_->SetSamplerState(1, D3DSAMP_MAGFILTER, D3DTEXF_POINT);
+			device_->SetSamplerState(1, D3DSAMP_MIPFILTER, D3DTEXF_NONE);
 
-		framebufferManagerDX9_->BindFramebufferAsColorTexture(0, framebuffer, BINDFBCOLOR_SKIP_COPY | BINDFBCOLOR_FORCE_SELF);
-		device_->SetSamplerState(0, D3DSAMP_MINFILTER, D3DTEXF_POINT);
-		device_->SetSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_POINT);
-		device_->SetSamplerState(0, D3DSAMP_MIPFILTER, D3DTEXF_NONE);
-		device_->SetSamplerState(0, D3DSAMP_MIPMAPLODBIAS, 0);
-		device_->SetSamplerState(0, D3DSAMP_MAXMIPLEVEL, 0);
+			framebufferManagerDX9_->BindFramebufferAsColorTexture(0, framebuffer, BINDFBCOLOR_SKIP_COPY | BINDFBCOLOR_FORCE_SELF);
+			device_->SetSamplerState(0, D3DSAMP_MINFILTER, D3DTEXF_POINT);
+			device_->SetSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_POINT);
+			device_->SetSamplerState(0, D3DSAMP_MIPFILTER, D3DTEXF_NONE);
+			device_->SetSamplerState(0, D3DSAMP_MIPMAPLODBIAS, 0);
+			device_->SetSamplerState(0, D3DSAMP_MAXMIPLEVEL, 0);
 
-		shaderApply.Shade();
+			shaderApply.Shade();
+		}
 
 		draw_->BindFramebufferAsTexture(depalFBO, 0, Draw::FB_COLOR_BIT, 0);
 
@@ -591,6 +595,8 @@ void TextureCacheDX9::BuildTexture(TexCacheEntry *const entry) {
 	} else {
 		entry->status &= ~TexCacheEntry::STATUS_BAD_MIPS;
 	}
+	SetReplacedSize(entry, replaced.Valid() ? (u32)replaced.MemorySize() : 0);
+	SetScaledSize(entry, scaleFactor);
 	if (replaced.Valid()) {
 		entry->SetAlphaStatus(TexCacheEntry::TexStatus(replaced.AlphaStatus()));
 	}
@@ -736,7 +742,7 @@ void TextureCacheDX9::LoadTextureLevel(TexCacheEntry &entry, ReplacedTexture &re
 		}
 
 		if (scaleFactor > 1) {
-			scaler.ScaleAlways((u32 *)rect.pBits, pixelData, dstFmt, w, h, scaleFactor);
+			ScaleCached(scaler, entry.CacheKey(), entry.fullhash, level, (u32 *)rect.pBits, pixelData, dstFmt, w, h, scaleFactor);
 			pixelData = (u32 *)rect.pBits;
 
 			// We always end up at 8888.  Other parts assume this.
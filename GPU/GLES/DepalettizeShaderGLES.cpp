@@ -139,6 +139,14 @@ void DepalShaderCacheGLES::Decimate() {
 	}
 }
 
+void DepalShaderCacheGLES::Precompile() {
+	std::vector<std::pair<uint32_t, GEBufferFormat>> variants;
+	GetCommonVariants(variants);
+	for (const auto &variant : variants) {
+		GetDepalettizeShader(variant.first, variant.second);
+	}
+}
+
 DepalShader *DepalShaderCacheGLES::GetDepalettizeShader(uint32_t clutMode, GEBufferFormat pixelFormat) {
 	u32 id = GenerateShaderID(clutMode, pixelFormat);
 
@@ -160,7 +168,7 @@ DepalShader *DepalShaderCacheGLES::GetDepalettizeShader(uint32_t clutMode, GEBuf
 
 	char *buffer = new char[2048];
 
-	GenerateDepalShader(buffer, pixelFormat, useGL3_ ? GLSL_300 : GLSL_140);
+	GenerateDepalShader(buffer, clutMode, pixelFormat, useGL3_ ? GLSL_300 : GLSL_140);
 	
 	std::string src(buffer);
 	GLRShader *fragShader = render_->CreateShader(GL_FRAGMENT_SHADER, src, "depal");
@@ -51,6 +51,8 @@ class DepalShaderCacheGLES : public DepalShaderCacheCommon {
 	GLRTexture *GetClutTexture(GEPaletteFormat clutFormat, const u32 clutHash, u32 *rawClut);
 	void Clear();
 	void Decimate();
+	// Compiles the common variants up front, so the first use doesn't stutter.
+	void Precompile();
 	std::vector<std::string> DebugGetShaderIDs(DebugShaderType type);
 	std::string DebugGetShaderString(std::string id, DebugShaderType type, DebugShaderStringType stringType);
 
@@ -140,6 +140,8 @@ void DrawEngineGLES::DestroyDeviceObjects() {
 	}
 
 	ClearTrackedVertexArrays();
+	if (tessDataTransferGLES)
+		tessDataTransferGLES->DestroyTextures();
 
 	if (softwareInputLayout_)
 		render_->DeleteInputLayout(softwareInputLayout_);
@@ -165,7 +167,6 @@ void DrawEngineGLES::EndFrame() {
 	FrameData &frameData = frameData_[render_->GetCurFrame()];
 	render_->EndPushBuffer(frameData.pushIndex);
 	render_->EndPushBuffer(frameData.pushVertex);
-	tessDataTransferGLES->EndFrame();
 }
 
 struct GlTypeInfo {
@@ -241,14 +242,7 @@ void DrawEngineGLES::DecodeVertsToPushBuffer(GLPushBuffer *push, uint32_t *bindO
 
 void DrawEngineGLES::MarkUnreliable(VertexArrayInfo *vai) {
 	vai->status = VertexArrayInfo::VAI_UNRELIABLE;
-	if (vai->vbo) {
-		render_->DeleteBuffer(vai->vbo);
-		vai->vbo = 0;
-	}
-	if (vai->ebo) {
-		render_->DeleteBuffer(vai->ebo);
-		vai->ebo = 0;
-	}
+	FreeVertexArray(vai);
 }
 
 void DrawEngineGLES::ClearTrackedVertexArrays() {
@@ -350,11 +344,7 @@ void DrawEngineGLES::DoFlush() {
 			case VertexArrayInfo::VAI_NEW:
 				{
 					// Haven't seen this one before.
-					ReliableHashType dataHash = ComputeHash();
-					vai->hash = dataHash;
-					vai->minihash = ComputeMiniHash();
-					vai->status = VertexArrayInfo::VAI_HASHING;
-					vai->drawsUntilNextFullHash = 0;
+					BeginVertexArray(vai);
 					DecodeVerts(decoded); // writes to indexGen
 					vai->numVerts = indexGen.VertexCount();
 					vai->prim = indexGen.Prim();
@@ -372,37 +362,14 @@ void DrawEngineGLES::DoFlush() {
 					if (vai->lastFrame != gpuStats.numFlips) {
 						vai->numFrames++;
 					}
-					if (vai->drawsUntilNextFullHash == 0) {
-						// Let's try to skip a full hash if mini would fail.
-						const u32 newMiniHash = ComputeMiniHash();
-						ReliableHashType newHash = vai->hash;
-						if (newMiniHash == vai->minihash) {
-							newHash = ComputeHash();
-						}
-						if (newMiniHash != vai->minihash || newHash != vai->hash) {
-							MarkUnreliable(vai);
-							DecodeVerts(decoded);
-							goto rotateVBO;
-						}
-						if (vai->numVerts > 64) {
-							// exponential backoff up to 16 draws, then every 32
-							vai->drawsUntilNextFullHash = std::min(32, vai->numFrames);
-						} else {
-							// Lower numbers seem much more likely to change.
-							vai->drawsUntilNextFullHash = 0;
-						}
-						// TODO: tweak
-						//if (vai->numFrames > 1000) {
-						//	vai->status = VertexArrayInfo::VAI_RELIABLE;
-						//}
-					} else {
-						vai->drawsUntilNextFullHash--;
-						u32 newMiniHash = ComputeMiniHash();
-						if (newMiniHash != vai->minihash) {
+					if (!CheckVertexArray(vai)) {
+						if (!ReseedVertexArray(vai)) {
 							MarkUnreliable(vai);
 							DecodeVerts(decoded);
 							goto rotateVBO;
 						}
+						// Replaced through a write we were told about, upload the new contents below.
+						FreeVertexArray(vai);
 					}
 
 					if (vai->vbo == 0) {
@@ -616,10 +583,12 @@ void DrawEngineGLES::DoFlush() {
 			framebufferManager_->SetColorUpdated(gstate_c.skipDrawReason);
 			framebufferManager_->SetSafeSize(scissorX2, scissorY2);
 
-			if ((gstate_c.featureFlags & GPU_USE_CLEAR_RAM_HACK) && colorMask && (alphaMask || gstate.FrameBufFormat() == GE_FORMAT_565)) {
+			if (colorMask && (alphaMask || gstate.FrameBufFormat() == GE_FORMAT_565)) {
 				int scissorX1 = gstate.getScissorX1();
 				int scissorY1 = gstate.getScissorY1();
-				framebufferManager_->ApplyClearToMemory(scissorX1, scissorY1, scissorX2, scissorY2, clearColor);
+				if (gstate_c.featureFlags & GPU_USE_CLEAR_RAM_HACK)
+					framebufferManager_->ApplyClearToMemory(scissorX1, scissorY1, scissorX2, scissorY2, clearColor);
+				framebufferManager_->DeferClearToMemory(scissorX1, scissorY1, scissorX2, scissorY2, clearColor);
 			}
 			gstate_c.Dirty(DIRTY_BLEND_STATE);  // Make sure the color mask gets re-applied.
 		}
@@ -636,7 +605,7 @@ void DrawEngineGLES::DoFlush() {
 	dcid_ = 0;
 	prevPrim_ = GE_PRIM_INVALID;
 	gstate_c.vertexFullAlpha = true;
-	framebufferManager_->SetColorUpdated(gstate_c.skipDrawReason);
+	framebufferManager_->SetColorUpdatedInScissor(gstate_c.skipDrawReason);
 
 	// Now seems as good a time as any to reset the min/max coords, which we may examine later.
 	gstate_c.vertBounds.minU = 512;
@@ -651,6 +620,17 @@ bool DrawEngineGLES::IsCodePtrVertexDecoder(const u8 *ptr) const {
 	return decJitCache_->IsInSpace(ptr);
 }
 
+GLRTexture *TessellationDataTransferGLES::ResizeTexture(int slot, int width, int height) {
+	// Draws earlier in the frame may still use the old texture, so make a new one rather than
+	// reallocating it: texture allocation runs ahead of all the frame's draws.
+	if (data_tex[slot])
+		renderManager_->DeleteTexture(data_tex[slot]);
+	data_tex[slot] = renderManager_->CreateTexture(GL_TEXTURE_2D);
+	renderManager_->TextureImage(data_tex[slot], 0, width, height, Draw::DataFormat::R32G32B32A32_FLOAT, nullptr, GLRAllocType::NONE, false);
+	renderManager_->FinalizeTexture(data_tex[slot], 0, false);
+	return data_tex[slot];
+}
+
 void TessellationDataTransferGLES::SendDataToShader(const SimpleVertex *const *points, int size_u, int size_v, u32 vertType, const Spline::Weight2D &weights) {
 	bool hasColor = (vertType & GE_VTYPE_COL_MASK) != 0;
 	bool hasTexCoord = (vertType & GE_VTYPE_TC_MASK) != 0;
@@ -665,12 +645,9 @@ void TessellationDataTransferGLES::SendDataToShader(const SimpleVertex *const *p
 	// Removed the 1D texture support, it's unlikely to be relevant for performance.
 	// Control Points
 	if (prevSizeU < size_u || prevSizeV < size_v) {
-		prevSizeU = size_u;
-		prevSizeV = size_v;
-		if (!data_tex[0])
-			data_tex[0] = renderManager_->CreateTexture(GL_TEXTURE_2D);
-		renderManager_->TextureImage(data_tex[0], 0, size_u * 3, size_v, Draw::DataFormat::R32G32B32A32_FLOAT, nullptr, GLRAllocType::NONE, false);
-		renderManager_->FinalizeTexture(data_tex[0], 0, false);
+		prevSizeU = std::max(prevSizeU, size_u);
+		prevSizeV = std::max(prevSizeV, size_v);
+		ResizeTexture(0, prevSizeU * 3, prevSizeV);
 	}
 	renderManager_->BindTexture(TEX_SLOT_SPLINE_POINTS, data_tex[0]);
 	// Position
@@ -685,27 +662,29 @@ void TessellationDataTransferGLES::SendDataToShader(const SimpleVertex *const *p
 	// Weight U
 	if (prevSizeWU < weights.size_u) {
 		prevSizeWU = weights.size_u;
-		if (!data_tex[1])
-			data_tex[1] = renderManager_->CreateTexture(GL_TEXTURE_2D);
-		renderManager_->TextureImage(data_tex[1], 0, weights.size_u * 2, 1, Draw::DataFormat::R32G32B32A32_FLOAT, nullptr, GLRAllocType::NONE, false);
-		renderManager_->FinalizeTexture(data_tex[1], 0, false);
+		ResizeTexture(1, weights.size_u * 2, 1);
+		prevWeightsU = nullptr;
 	}
 	renderManager_->BindTexture(TEX_SLOT_SPLINE_WEIGHTS_U, data_tex[1]);
-	renderManager_->TextureSubImage(data_tex[1], 0, 0, 0, weights.size_u * 2, 1, Draw::DataFormat::R32G32B32A32_FLOAT, (u8 *)weights.u, GLRAllocType::NONE);
+	if (prevWeightsU != weights.u) {
+		renderManager_->TextureSubImage(data_tex[1], 0, 0, 0, weights.size_u * 2, 1, Draw::DataFormat::R32G32B32A32_FLOAT, (u8 *)weights.u, GLRAllocType::NONE);
+		prevWeightsU = weights.u;
+	}
 
 	// Weight V
 	if (prevSizeWV < weights.size_v) {
 		prevSizeWV = weights.size_v;
-		if (!data_tex[2])
-			data_tex[2] = renderManager_->CreateTexture(GL_TEXTURE_2D);
-		renderManager_->TextureImage(data_tex[2], 0, weights.size_v * 2, 1, Draw::DataFormat::R32G32B32A32_FLOAT, nullptr, GLRAllocType::NONE, false);
-		renderManager_->FinalizeTexture(data_tex[2], 0, false);
+		ResizeTexture(2, weights.size_v * 2, 1);
+		prevWeightsV = nullptr;
 	}
 	renderManager_->BindTexture(TEX_SLOT_SPLINE_WEIGHTS_V, data_tex[2]);
-	renderManager_->TextureSubImage(data_tex[2], 0, 0, 0, weights.size_v * 2, 1, Draw::DataFormat::R32G32B32A32_FLOAT, (u8 *)weights.v, GLRAllocType::NONE);
+	if (prevWeightsV != weights.v) {
+		renderManager_->TextureSubImage(data_tex[2], 0, 0, 0, weights.size_v * 2, 1, Draw::DataFormat::R32G32B32A32_FLOAT, (u8 *)weights.v, GLRAllocType::NONE);
+		prevWeightsV = weights.v;
+	}
 }
 
-void TessellationDataTransferGLES::EndFrame() {
+void TessellationDataTransferGLES::DestroyTextures() {
 	for (int i = 0; i < 3; i++) {
 		if (data_tex[i]) {
 			renderManager_->DeleteTexture(data_tex[i]);
@@ -713,4 +692,5 @@ void TessellationDataTransferGLES::EndFrame() {
 		}
 	}
 	prevSizeU = prevSizeV = prevSizeWU = prevSizeWV = 0;
+	prevWeightsU = prevWeightsV = nullptr;
 }
@@ -68,46 +68,10 @@ enum {
 };
 
 // Try to keep this POD.
-class VertexArrayInfo {
+class VertexArrayInfo : public VertexArrayInfoCommon {
 public:
-	VertexArrayInfo() {
-		status = VAI_NEW;
-		vbo = nullptr;
-		ebo = nullptr;
-		prim = GE_PRIM_INVALID;
-		numDraws = 0;
-		numFrames = 0;
-		lastFrame = gpuStats.numFlips;
-		numVerts = 0;
-		drawsUntilNextFullHash = 0;
-		flags = 0;
-	}
-
-	enum Status : uint8_t {
-		VAI_NEW,
-		VAI_HASHING,
-		VAI_RELIABLE,  // cache, don't hash
-		VAI_UNRELIABLE,  // never cache
-	};
-
-	ReliableHashType hash;
-	u32 minihash;
-
-	GLRBuffer *vbo;
-	GLRBuffer *ebo;
-
-	// Precalculated parameter for drawRangeElements
-	u16 numVerts;
-	u16 maxIndex;
-	s8 prim;
-	Status status;
-
-	// ID information
-	int numDraws;
-	int numFrames;
-	int lastFrame;  // So that we can forget.
-	u16 drawsUntilNextFullHash;
-	u8 flags;
+	GLRBuffer *vbo = nullptr;
+	GLRBuffer *ebo = nullptr;
 };
 
 class TessellationDataTransferGLES : public TessellationDataTransfer {
@@ -115,16 +79,20 @@ class TessellationDataTransferGLES : public TessellationDataTransfer {
 	GLRTexture *data_tex[3]{};
 	int prevSizeU = 0, prevSizeV = 0;
 	int prevSizeWU = 0, prevSizeWV = 0;
+	// Weights live in the weight cache until shutdown, so the same pointer means the same data.
+	const Spline::Weight *prevWeightsU = nullptr, *prevWeightsV = nullptr;
 	GLRenderManager *renderManager_;
+
+	GLRTexture *ResizeTexture(int slot, int width, int height);
 public:
 	TessellationDataTransferGLES(GLRenderManager *renderManager)
 			: renderManager_(renderManager) { }
 	~TessellationDataTransferGLES() {
-		EndFrame();
+		DestroyTextures();
 	}
 	// Send spline/bezier's control points and weights to vertex shader through floating point texture.
 	void SendDataToShader(const SimpleVertex *const *points, int size_u, int size_v, u32 vertType, const Spline::Weight2D &weights) override;
-	void EndFrame();  // Queues textures for deletion.
+	void DestroyTextures();  // Queues textures for deletion.
 };
 
 // Handles transform, lighting and drawing.
@@ -225,5 +193,5 @@ class DrawEngineGLES : public DrawEngineCommon {
 	int bufferDecimationCounter_ = 0;
 
 	// Hardware tessellation
-	TessellationDataTransferGLES *tessDataTransferGLES;
+	TessellationDataTransferGLES *tessDataTransferGLES = nullptr;
 };
@@ -104,22 +104,20 @@ void FramebufferManagerGLES::CompileDraw2DProgram() {
 }
 
 void FramebufferManagerGLES::CompilePostShader() {
-	SetNumExtraFBOs(0);
-	const ShaderInfo *shaderInfo = 0;
-	if (g_Config.sPostShaderName != "Off") {
-		ReloadAllPostShaderInfo();
-		shaderInfo = GetPostShaderInfo(g_Config.sPostShaderName);
-	}
+	DestroyPostShader();
+	usePostShader_ = false;
 
-	if (shaderInfo) {
-		std::string errorString;
-		postShaderAtOutputResolution_ = shaderInfo->outputResolution;
+	LoadPostShaderChain();
+	if (postShaderChain_.empty())
+		return;
 
+	std::string errorString;
+	for (const ShaderInfo &shaderInfo : postShaderChain_) {
 		size_t sz;
-		char *vs = (char *)VFSReadFile(shaderInfo->vertexShaderFile.c_str(), &sz);
+		char *vs = (char *)VFSReadFile(shaderInfo.vertexShaderFile.c_str(), &sz);
 		if (!vs)
 			return;
-		char *fs = (char *)VFSReadFile(shaderInfo->fragmentShaderFile.c_str(), &sz);
+		char *fs = (char *)VFSReadFile(shaderInfo.fragmentShaderFile.c_str(), &sz);
 		if (!fs) {
 			free(vs);
 			return;
@@ -142,46 +140,66 @@ void FramebufferManagerGLES::CompilePostShader() {
 			vshader = vs;
 			fshader = fs;
 		}
+		free(vs);
+		free(fs);
 
-		if (!translationFailed) {
-			SetNumExtraFBOs(1);
-
-			std::vector<GLRShader *> shaders;
-			shaders.push_back(render_->CreateShader(GL_VERTEX_SHADER, vshader, "postshader"));
-			shaders.push_back(render_->CreateShader(GL_FRAGMENT_SHADER, fshader, "postshader"));
-			std::vector<GLRProgram::UniformLocQuery> queries;
-			queries.push_back({ &u_postShaderTex, "tex" });
-			queries.push_back({ &deltaLoc_, "u_texelDelta" });
-			queries.push_back({ &pixelDeltaLoc_, "u_pixelDelta" });
-			queries.push_back({ &timeLoc_, "u_time" });
-			queries.push_back({ &videoLoc_, "u_video" });
-
-			std::vector<GLRProgram::Initializer> inits;
-			inits.push_back({ &u_postShaderTex, 0, 0 });
-			std::vector<GLRProgram::Semantic> semantics;
-			semantics.push_back({ 0, "a_position" });
-			semantics.push_back({ 1, "a_texcoord0" });
-			postShaderProgram_ = render_->CreateProgram(shaders, semantics, queries, inits, false);
-			postShaderModules_ = shaders;
-		} else {
+		if (translationFailed) {
 			ERROR_LOG(FRAMEBUF, "Failed to translate post shader!");
+			break;
 		}
-		free(vs);
-		free(fs);
 
-		if (!postShaderProgram_) {
+		PostShaderPass &pass = postShaderPasses_[numPostShaderPasses_];
+		pass.texLoc = -1;
+		pass.deltaLoc = -1;
+		pass.pixelDeltaLoc = -1;
+		pass.timeLoc = -1;
+		pass.videoLoc = -1;
+
+		std::vector<GLRShader *> shaders;
+		shaders.push_back(render_->CreateShader(GL_VERTEX_SHADER, vshader, "postshader"));
+		shaders.push_back(render_->CreateShader(GL_FRAGMENT_SHADER, fshader, "postshader"));
+		std::vector<GLRProgram::UniformLocQuery> queries;
+		queries.push_back({ &pass.texLoc, "tex" });
+		queries.push_back({ &pass.deltaLoc, "u_texelDelta" });
+		queries.push_back({ &pass.pixelDeltaLoc, "u_pixelDelta" });
+		queries.push_back({ &pass.timeLoc, "u_time" });
+		queries.push_back({ &pass.videoLoc, "u_video" });
+
+		std::vector<GLRProgram::Initializer> inits;
+		inits.push_back({ &pass.texLoc, 0, 0 });
+		std::vector<GLRProgram::Semantic> semantics;
+		semantics.push_back({ 0, "a_position" });
+		semantics.push_back({ 1, "a_texcoord0" });
+		pass.program = render_->CreateProgram(shaders, semantics, queries, inits, false);
+		postShaderModules_.insert(postShaderModules_.end(), shaders.begin(), shaders.end());
+		if (!pass.program) {
 			// DO NOT turn this into a report, as it will pollute our logs with all kinds of
 			// user shader experiments.
-			ERROR_LOG(FRAMEBUF, "Failed to build post-processing program from %s and %s!\n%s", shaderInfo->vertexShaderFile.c_str(), shaderInfo->fragmentShaderFile.c_str(), errorString.c_str());
-			ShowPostShaderError(errorString);
-			usePostShader_ = false;
-		} else {
-			usePostShader_ = true;
+			ERROR_LOG(FRAMEBUF, "Failed to build post-processing program from %s and %s!\n%s", shaderInfo.vertexShaderFile.c_str(), shaderInfo.fragmentShaderFile.c_str(), errorString.c_str());
+			break;
 		}
+		numPostShaderPasses_++;
+	}
+
+	if (numPostShaderPasses_ == (int)postShaderChain_.size()) {
+		usePostShader_ = true;
 	} else {
-		postShaderProgram_ = nullptr;
-		usePostShader_ = false;
+		ShowPostShaderError(errorString);
+		DestroyPostShader();
+	}
+}
+
+void FramebufferManagerGLES::DestroyPostShader() {
+	for (int i = 0; i < numPostShaderPasses_; ++i) {
+		render_->DeleteProgram(postShaderPasses_[i].program);
+		postShaderPasses_[i].program = nullptr;
+	}
+	numPostShaderPasses_ = 0;
+	// Will usually be clear already.
+	for (auto iter : postShaderModules_) {
+		render_->DeleteShader(iter);
 	}
+	postShaderModules_.clear();
 }
 
 void FramebufferManagerGLES::ShowPostShaderError(const std::string &errorString) {
@@ -218,9 +236,9 @@ void FramebufferManagerGLES::Bind2DShader() {
 	render_->BindProgram(draw2dprogram_);
 }
 
-void FramebufferManagerGLES::BindPostShader(const PostShaderUniforms &uniforms) {
+void FramebufferManagerGLES::BindPostShader(const PostShaderUniforms &uniforms, int pass) {
 	// Make sure we've compiled the shader.
-	if (!postShaderProgram_) {
+	if (numPostShaderPasses_ == 0) {
 		CompileDraw2DProgram();
 	}
 
@@ -247,15 +265,21 @@ void FramebufferManagerGLES::BindPostShader(const PostShaderUniforms &uniforms)
 		usePostShader_ = false;
 	}
 
-	render_->BindProgram(postShaderProgram_);
-	if (deltaLoc_ != -1)
-		render_->SetUniformF(&deltaLoc_, 2, uniforms.texelDelta);
-	if (pixelDeltaLoc_ != -1)
-		render_->SetUniformF(&pixelDeltaLoc_, 2, uniforms.pixelDelta);
-	if (timeLoc_ != -1)
-		render_->SetUniformF(&timeLoc_, 4, uniforms.time);
-	if (videoLoc_ != -1)
-		render_->SetUniformF(&videoLoc_, 1, &uniforms.video);
+	if (pass < 0 || pass >= numPostShaderPasses_) {
+		Bind2DShader();
+		return;
+	}
+
+	PostShaderPass &p = postShaderPasses_[pass];
+	render_->BindProgram(p.program);
+	if (p.deltaLoc != -1)
+		render_->SetUniformF(&p.deltaLoc, 2, uniforms.texelDelta);
+	if (p.pixelDeltaLoc != -1)
+		render_->SetUniformF(&p.pixelDeltaLoc, 2, uniforms.pixelDelta);
+	if (p.timeLoc != -1)
+		render_->SetUniformF(&p.timeLoc, 4, uniforms.time);
+	if (p.videoLoc != -1)
+		render_->SetUniformF(&p.videoLoc, 1, &uniforms.video);
 }
 
 FramebufferManagerGLES::FramebufferManagerGLES(Draw::DrawContext *draw, GLRenderManager *render) :
@@ -309,15 +333,7 @@ void FramebufferManagerGLES::DestroyDeviceObjects() {
 		render_->DeleteProgram(draw2dprogram_);
 		draw2dprogram_ = nullptr;
 	}
-	if (postShaderProgram_) {
-		render_->DeleteProgram(postShaderProgram_);
-		postShaderProgram_ = nullptr;
-	}
-	// Will usually be clear already.
-	for (auto iter : postShaderModules_) {
-		render_->DeleteShader(iter);
-	}
-	postShaderModules_.clear();
+	DestroyPostShader();
 	if (drawPixelsTex_) {
 		render_->DeleteTexture(drawPixelsTex_);
 		drawPixelsTex_ = 0;
@@ -694,8 +710,6 @@ void FramebufferManagerGLES::DestroyAllFBOs() {
 		tempFB.second.fbo->Release();
 	}
 	tempFBOs_.clear();
-
-	SetNumExtraFBOs(0);
 }
 
 void FramebufferManagerGLES::Resized() {
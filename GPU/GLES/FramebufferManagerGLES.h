@@ -78,10 +78,11 @@ class FramebufferManagerGLES : public FramebufferManagerCommon {
 
 	void MakePixelTexture(const u8 *srcPixels, GEBufferFormat srcPixelFormat, int srcStride, int width, int height, float &u1, float &v1) override;
 	void Bind2DShader() override;
-	void BindPostShader(const PostShaderUniforms &uniforms) override;
+	void BindPostShader(const PostShaderUniforms &uniforms, int pass) override;
 	void ShowPostShaderError(const std::string &errorMessage);
 	void CompileDraw2DProgram();
 	void CompilePostShader();
+	void DestroyPostShader();
 
 	void PackDepthbuffer(VirtualFramebuffer *vfb, int x, int y, int w, int h);
 
@@ -96,13 +97,24 @@ class FramebufferManagerGLES : public FramebufferManagerCommon {
 	u8 *convBuf_ = nullptr;
 	u32 convBufSize_ = 0;
 	GLRProgram *draw2dprogram_ = nullptr;
-	GLRProgram *postShaderProgram_ = nullptr;
+	struct PostShaderPass {
+		GLRProgram *program;
+		int texLoc;
+		int deltaLoc;
+		int pixelDeltaLoc;
+		int timeLoc;
+		int videoLoc;
+	};
+	// One per entry in postShaderChain_. Not a vector, the render thread writes the locs through pointers.
+	PostShaderPass postShaderPasses_[MAX_POST_SHADER_PASSES]{};
+	int numPostShaderPasses_ = 0;
 	std::vector<GLRShader *> postShaderModules_;
 
 	GLRProgram *stencilUploadProgram_ = nullptr;
 	int u_stencilUploadTex = -1;
 	int u_stencilValue = -1;
-	int u_postShaderTex = -1;
+	// Writes the whole stencil value from the shader in one pass, see NotifyStencilUpload.
+	bool stencilUploadExport_ = false;
 
 	GLRProgram *depthDownloadProgram_ = nullptr;
 	int u_depthDownloadTex = -1;
@@ -114,10 +126,6 @@ class FramebufferManagerGLES : public FramebufferManagerCommon {
 	int u_draw2d_tex = -1;
 
 	int plainColorLoc_ = -1;
-	int videoLoc_ = -1;
-	int timeLoc_ = -1;
-	int pixelDeltaLoc_ = -1;
-	int deltaLoc_ = -1;
 
 	TextureCacheGLES *textureCacheGL_ = nullptr;
 	ShaderManagerGLES *shaderManagerGL_ = nullptr;
@@ -80,6 +80,8 @@ GPU_GLES::GPU_GLES(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 	textureCacheGL_->SetShaderManager(shaderManagerGL_);
 	textureCacheGL_->SetDrawEngine(&drawEngine_);
 	fragmentTestCache_.SetTextureCache(textureCacheGL_);
+	if (!g_Config.bDisableSlowFramebufEffects)
+		depalShaderCache_.Precompile();
 
 	// Sanity check gstate
 	if ((int *)&gstate.transferstart - (int *)&gstate != 0xEA) {
@@ -96,6 +98,7 @@ GPU_GLES::GPU_GLES(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 	UpdateVsyncInterval(true);
 
 	textureCacheGL_->NotifyConfigChanged();
+	LoadVertexDecoderCache();
 
 	// Load shader cache.
 	std::string discID = g_paramSFO.GetDiscID();
@@ -104,6 +107,10 @@ GPU_GLES::GPU_GLES(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 		shaderCachePath_ = GetSysDirectory(DIRECTORY_APP_CACHE) + "/" + discID + ".glshadercache";
 		// Actually precompiled by IsReady() since we're single-threaded.
 		shaderManagerGL_->Load(shaderCachePath_);
+		// Linked programs too, when the driver can give them to us.
+		programCachePath_ = GetSysDirectory(DIRECTORY_APP_CACHE) + "/" + discID + ".glprogramcache";
+		GLRenderManager *render = (GLRenderManager *)draw_->GetNativeObject(Draw::NativeObject::RENDER_MANAGER);
+		render->LoadProgramBinaries(programCachePath_);
 	}
 
 	if (g_Config.bHardwareTessellation) {
@@ -127,8 +134,11 @@ GPU_GLES::~GPU_GLES() {
 	// If we're here during app shutdown (exiting the Windows app in-game, for example)
 	// everything should already be cleared since DeviceLost has been run.
 
+	SaveVertexDecoderCache();
 	if (!shaderCachePath_.empty() && draw_) {
 		shaderManagerGL_->Save(shaderCachePath_);
+		GLRenderManager *render = (GLRenderManager *)draw_->GetNativeObject(Draw::NativeObject::RENDER_MANAGER);
+		render->SaveProgramBinaries(programCachePath_);
 	}
 
 	framebufferManagerGL_->DestroyAllFBOs();
@@ -339,6 +349,8 @@ void GPU_GLES::DeviceRestore() {
 	drawEngine_.DeviceRestore(draw_);
 	fragmentTestCache_.DeviceRestore(draw_);
 	depalShaderCache_.DeviceRestore(draw_);
+	if (!g_Config.bDisableSlowFramebufEffects)
+		depalShaderCache_.Precompile();
 }
 
 void GPU_GLES::Reinitialize() {
@@ -487,12 +499,13 @@ void GPU_GLES::GetStats(char *buffer, size_t bufsize) {
 	float vertexAverageCycles = gpuStats.numVertsSubmitted > 0 ? (float)gpuStats.vertexGPUCycles / (float)gpuStats.numVertsSubmitted : 0.0f;
 	snprintf(buffer, bufsize - 1,
 		"DL processing time: %0.2f ms\n"
-		"Draw calls: %i, flushes %i, clears %i\n"
+		"Draw calls: %i, flushes %i (%i skipped), clears %i\n"
 		"Cached Draw calls: %i\n"
 		"Num Tracked Vertex Arrays: %i\n"
 		"GPU cycles executed: %d (%f per vertex)\n"
 		"Commands per call level: %i %i %i %i\n"
 		"Vertices submitted: %i\n"
+		"Draw temporaries peak: %i KB\n"
 		"Cached, Uncached Vertices Drawn: %i, %i\n"
 		"FBOs active: %i\n"
 		"Textures active: %i, decoded: %i  invalidated: %i\n"
@@ -501,6 +514,7 @@ void GPU_GLES::GetStats(char *buffer, size_t bufsize) {
 		gpuStats.msProcessingDisplayLists * 1000.0f,
 		gpuStats.numDrawCalls,
 		gpuStats.numFlushes,
+		gpuStats.numFlushesSkipped,
 		gpuStats.numClears,
 		gpuStats.numCachedDrawCalls,
 		gpuStats.numTrackedVertexArrays,
@@ -508,6 +522,7 @@ void GPU_GLES::GetStats(char *buffer, size_t bufsize) {
 		vertexAverageCycles,
 		gpuStats.gpuCommandsAtCallLevel[0], gpuStats.gpuCommandsAtCallLevel[1], gpuStats.gpuCommandsAtCallLevel[2], gpuStats.gpuCommandsAtCallLevel[3],
 		gpuStats.numVertsSubmitted,
+		gpuStats.frameArenaHighWater / 1024,
 		gpuStats.numCachedVertsDrawn,
 		gpuStats.numUncachedVertsDrawn,
 		(int)framebufferManagerGL_->NumVFBs(),
@@ -540,7 +555,7 @@ void GPU_GLES::DoState(PointerWrap &p) {
 	// TODO: Some of these things may not be necessary.
 	// None of these are necessary when saving.
 	// In Freeze-Frame mode, we don't want to do any of this.
-	if (p.mode == p.MODE_READ && !PSP_CoreParameter().frozen) {
+	if (p.mode == p.MODE_READ && !PSP_CoreParameter().frozen && !PSP_CoreParameter().runAheadFrame) {
 		textureCacheGL_->Clear(true);
 		drawEngine_.ClearTrackedVertexArrays();
 
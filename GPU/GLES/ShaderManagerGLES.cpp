@@ -574,7 +574,7 @@ void LinkedShader::UpdateUniforms(u32 vertType, const ShaderID &vsid) {
 }
 
 ShaderManagerGLES::ShaderManagerGLES(Draw::DrawContext *draw)
-		: ShaderManagerCommon(draw), lastShader_(nullptr), shaderSwitchDirtyUniforms_(0), diskCacheDirty_(false), fsCache_(16), vsCache_(16) {
+		: ShaderManagerCommon(draw), linkedShaderCache_(16), lastShader_(nullptr), shaderSwitchDirtyUniforms_(0), diskCacheDirty_(false), fsCache_(16), vsCache_(16) {
 	render_ = (GLRenderManager *)draw->GetNativeObject(Draw::NativeObject::RENDER_MANAGER);
 	codeBuffer_ = new char[16384];
 	lastFSID_.set_invalid();
@@ -587,16 +587,16 @@ ShaderManagerGLES::~ShaderManagerGLES() {
 
 void ShaderManagerGLES::Clear() {
 	DirtyLastShader();
-	for (auto iter = linkedShaderCache_.begin(); iter != linkedShaderCache_.end(); ++iter) {
-		delete iter->ls;
-	}
+	linkedShaderCache_.Iterate([&](const LinkedShaderKey &key, LinkedShader *ls) {
+		delete ls;
+	});
 	fsCache_.Iterate([&](const FShaderID &key, Shader *shader) {
 		delete shader;
 	});
 	vsCache_.Iterate([&](const VShaderID &key, Shader *shader) {
 		delete shader;
 	});
-	linkedShaderCache_.clear();
+	linkedShaderCache_.Clear();
 	fsCache_.Clear();
 	vsCache_.Clear();
 	DirtyShader();
@@ -636,6 +636,7 @@ Shader *ShaderManagerGLES::CompileFragmentShader(FShaderID FSID) {
 		return nullptr;
 	}
 	std::string desc = FragmentShaderDesc(FSID);
+	gpuStats.numShadersCompiled++;
 	return new Shader(render_, codeBuffer_, desc, GL_FRAGMENT_SHADER, false, 0, uniformMask);
 }
 
@@ -645,6 +646,7 @@ Shader *ShaderManagerGLES::CompileVertexShader(VShaderID VSID) {
 	uint64_t uniformMask;
 	GenerateVertexShader(VSID, codeBuffer_, &attrMask, &uniformMask);
 	std::string desc = VertexShaderDesc(VSID);
+	gpuStats.numShadersCompiled++;
 	return new Shader(render_, codeBuffer_, desc, GL_VERTEX_SHADER, useHWTransform, attrMask, uniformMask);
 }
 
@@ -725,19 +727,22 @@ LinkedShader *ShaderManagerGLES::ApplyFragmentShader(VShaderID VSID, Shader *vs,
 		diskCacheDirty_ = true;
 	}
 
-	// Okay, we have both shaders. Let's see if there's a linked one.
-	LinkedShader *ls = nullptr;
-
+	// Deferred dirtying! Instead of touching every program, remember when each uniform was dirtied.
 	u64 switchDirty = shaderSwitchDirtyUniforms_;
-	for (auto iter = linkedShaderCache_.begin(); iter != linkedShaderCache_.end(); ++iter) {
-		// Deferred dirtying! Let's see if we can make this even more clever later.
-		iter->ls->dirtyUniforms |= switchDirty;
-
-		if (iter->vs == vs && iter->fs == fs) {
-			ls = iter->ls;
+	if (switchDirty) {
+		dirtySerial_++;
+		for (int i = 0; i < 64; i++) {
+			if (switchDirty & (1ULL << i))
+				uniformDirtySerial_[i] = dirtySerial_;
 		}
+		shaderSwitchDirtyUniforms_ = 0;
+	}
+
+	// Okay, we have both shaders. Let's see if there's a linked one.
+	LinkedShader *ls = vs->GetLastProgram(fs);
+	if (ls == nullptr) {
+		ls = linkedShaderCache_.Get({ VSID, FSID });
 	}
-	shaderSwitchDirtyUniforms_ = 0;
 
 	if (ls == nullptr) {
 		_dbg_assert_(G3D, FSID.Bit(FS_BIT_LMODE) == VSID.Bit(VS_BIT_LMODE));
@@ -748,17 +753,29 @@ LinkedShader *ShaderManagerGLES::ApplyFragmentShader(VShaderID VSID, Shader *vs,
 		// Check if we can link these.
 		ls = new LinkedShader(render_, VSID, vs, FSID, fs, vs->UseHWTransform());
 		ls->use(VSID);
-		const LinkedShaderCacheEntry entry(vs, fs, ls);
-		linkedShaderCache_.push_back(entry);
+		ls->dirtySerial = dirtySerial_;
+		linkedShaderCache_.Insert({ VSID, FSID }, ls);
 	} else {
+		ApplyDeferredDirty(ls);
 		ls->use(VSID);
 	}
+	vs->SetLastProgram(fs, ls);
 	ls->UpdateUniforms(vertType, VSID);
 
 	lastShader_ = ls;
 	return ls;
 }
 
+void ShaderManagerGLES::ApplyDeferredDirty(LinkedShader *ls) {
+	if (ls->dirtySerial == dirtySerial_)
+		return;
+	for (int i = 0; i < 64; i++) {
+		if (uniformDirtySerial_[i] > ls->dirtySerial)
+			ls->dirtyUniforms |= 1ULL << i;
+	}
+	ls->dirtySerial = dirtySerial_;
+}
+
 std::string Shader::GetShaderString(DebugShaderStringType type, ShaderID id) const {
 	switch (type) {
 	case SHADER_STRING_SOURCE_CODE:
@@ -970,10 +987,11 @@ bool ShaderManagerGLES::ContinuePrecompile(float sliceTime) {
 		const FShaderID &fsid = pending.link[i].second;
 		Shader *vs = vsCache_.Get(vsid);
 		Shader *fs = fsCache_.Get(fsid);
-		if (vs && fs) {
+		// Drawing may have already linked it while we were precompiling.
+		if (vs && fs && !linkedShaderCache_.Get({ vsid, fsid })) {
 			LinkedShader *ls = new LinkedShader(render_, vsid, vs, fsid, fs, vs->UseHWTransform(), true);
-			LinkedShaderCacheEntry entry(vs, fs, ls);
-			linkedShaderCache_.push_back(entry);
+			ls->dirtySerial = dirtySerial_;
+			linkedShaderCache_.Insert({ vsid, fsid }, ls);
 		}
 	}
 
@@ -995,7 +1013,7 @@ void ShaderManagerGLES::Save(const std::string &filename) {
 	if (!diskCacheDirty_) {
 		return;
 	}
-	if (linkedShaderCache_.empty()) {
+	if (linkedShaderCache_.size() == 0) {
 		return;
 	}
 	INFO_LOG(G3D, "Saving the shader cache to '%s'", filename.c_str());
@@ -1020,19 +1038,10 @@ void ShaderManagerGLES::Save(const std::string &filename) {
 	fsCache_.Iterate([&](const ShaderID &id, Shader *shader) {
 		fwrite(&id, 1, sizeof(id), f);
 	});
-	for (auto iter : linkedShaderCache_) {
-		ShaderID vsid, fsid;
-		vsCache_.Iterate([&](const ShaderID &id, Shader *shader) {
-			if (iter.vs == shader)
-				vsid = id;
-		});
-		fsCache_.Iterate([&](const ShaderID &id, Shader *shader) {
-			if (iter.fs == shader)
-				fsid = id;
-		});
-		fwrite(&vsid, 1, sizeof(vsid), f);
-		fwrite(&fsid, 1, sizeof(fsid), f);
-	}
+	linkedShaderCache_.Iterate([&](const LinkedShaderKey &key, LinkedShader *ls) {
+		fwrite(&key.vsid, 1, sizeof(key.vsid), f);
+		fwrite(&key.fsid, 1, sizeof(key.fsid), f);
+	});
 	fclose(f);
 	diskCacheDirty_ = false;
 }
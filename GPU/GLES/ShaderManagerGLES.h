@@ -58,6 +58,8 @@ class LinkedShader {
 	GLRProgram *program;
 	uint64_t availableUniforms;
 	uint64_t dirtyUniforms = 0;
+	// Which uniform switch the deferred dirty bits were last applied up to, see ShaderManagerGLES.
+	uint64_t dirtySerial = 0;
 
 	// Present attributes in the shader.
 	int attrMask;  // 1 << ATTR_ ... or-ed together.
@@ -140,6 +142,13 @@ class Shader {
 	uint32_t GetAttrMask() const { return attrMask_; }
 	uint64_t GetUniformMask() const { return uniformMask_; }
 
+	// Vertex shaders remember the program they were last linked into, which usually saves the lookup.
+	LinkedShader *GetLastProgram(const Shader *fs) const { return lastProgramFS_ == fs ? lastProgram_ : nullptr; }
+	void SetLastProgram(const Shader *fs, LinkedShader *ls) {
+		lastProgramFS_ = fs;
+		lastProgram_ = ls;
+	}
+
 private:
 	GLRenderManager *render_;
 	std::string source_;
@@ -148,6 +157,8 @@ class Shader {
 	bool isFragment_;
 	uint32_t attrMask_; // only used in vertex shaders
 	uint64_t uniformMask_;
+	const Shader *lastProgramFS_ = nullptr;
+	LinkedShader *lastProgram_ = nullptr;
 };
 
 class ShaderManagerGLES : public ShaderManagerCommon {
@@ -185,15 +196,13 @@ class ShaderManagerGLES : public ShaderManagerCommon {
 	Shader *CompileFragmentShader(FShaderID id);
 	Shader *CompileVertexShader(VShaderID id);
 
-	struct LinkedShaderCacheEntry {
-		LinkedShaderCacheEntry(Shader *vs_, Shader *fs_, LinkedShader *ls_)
-			: vs(vs_), fs(fs_), ls(ls_) { }
+	void ApplyDeferredDirty(LinkedShader *ls);
 
-		Shader *vs;
-		Shader *fs;
-		LinkedShader *ls;
+	struct LinkedShaderKey {
+		VShaderID vsid;
+		FShaderID fsid;
 	};
-	typedef std::vector<LinkedShaderCacheEntry> LinkedShaderCache;
+	typedef DenseHashMap<LinkedShaderKey, LinkedShader *, nullptr> LinkedShaderCache;
 
 	GLRenderManager *render_;
 	LinkedShaderCache linkedShaderCache_;
@@ -205,6 +214,9 @@ class ShaderManagerGLES : public ShaderManagerCommon {
 
 	LinkedShader *lastShader_;
 	u64 shaderSwitchDirtyUniforms_;
+	// Bumped on each program switch with pending dirty uniforms, and per uniform bit the last switch that dirtied it.
+	u64 dirtySerial_ = 0;
+	u64 uniformDirtySerial_[64]{};
 	char *codeBuffer_;
 
 	typedef DenseHashMap<FShaderID, Shader *, nullptr> FSCache;
@@ -15,7 +15,9 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include "base/stringutil.h"
 #include "gfx_es2/glsl_program.h"
+#include "gfx_es2/gpu_features.h"
 #include "Core/Config.h"
 #include "Core/ConfigValues.h"
 #include "Core/Reporting.h"
@@ -51,6 +53,19 @@ void main() {
 }
 )";
 
+// Needs GLSL 1.40, so the #version is added at runtime. Writes all the stencil bits in one pass.
+static const char *stencil_fs_export = R"(
+#extension GL_ARB_shader_stencil_export : require
+in vec2 v_texcoord0;
+uniform sampler2D tex;
+out vec4 fragColor0;
+void main() {
+  vec4 index = texture(tex, v_texcoord0);
+  fragColor0 = vec4(index.a);
+  gl_FragStencilRefARB = int(floor(index.a * 255.99));
+}
+)";
+
 static const char *stencil_vs = R"(
 #ifdef GL_ES
 precision highp float;
@@ -132,8 +147,15 @@ bool FramebufferManagerGLES::NotifyStencilUpload(u32 addr, int size, bool skipZe
 	if (!stencilUploadProgram_) {
 		std::string errorString;
 		static std::string vs_code, fs_code;
-		vs_code = ApplyGLSLPrelude(stencil_vs, GL_VERTEX_SHADER);
-		fs_code = ApplyGLSLPrelude(stencil_fs, GL_FRAGMENT_SHADER);
+		stencilUploadExport_ = gl_extensions.ARB_shader_stencil_export && !gl_extensions.IsGLES && gl_extensions.GLSLVersion() >= 140;
+		if (stencilUploadExport_) {
+			std::string version = StringFromFormat("#version %d\n", gl_extensions.GLSLVersion());
+			vs_code = version + stencil_vs;
+			fs_code = version + stencil_fs_export;
+		} else {
+			vs_code = ApplyGLSLPrelude(stencil_vs, GL_VERTEX_SHADER);
+			fs_code = ApplyGLSLPrelude(stencil_fs, GL_FRAGMENT_SHADER);
+		}
 		std::vector<GLRShader *> shaders;
 		shaders.push_back(render_->CreateShader(GL_VERTEX_SHADER, vs_code, "stencil"));
 		shaders.push_back(render_->CreateShader(GL_FRAGMENT_SHADER, fs_code, "stencil"));
@@ -189,22 +211,29 @@ bool FramebufferManagerGLES::NotifyStencilUpload(u32 addr, int size, bool skipZe
 	render_->BindProgram(stencilUploadProgram_);
 	render_->SetNoBlendAndMask(0x8);
 
-	for (int i = 1; i < values; i += i) {
-		if (!(usedBits & i)) {
-			// It's already zero, let's skip it.
-			continue;
-		}
-		if (dstBuffer->format == GE_FORMAT_4444) {
-			render_->SetStencilOp((i << 4) | i, GL_REPLACE, GL_REPLACE, GL_REPLACE);
-			render_->SetUniformF1(&u_stencilValue, i * (16.0f / 255.0f));
-		} else if (dstBuffer->format == GE_FORMAT_5551) {
-			render_->SetStencilOp(0xFF, GL_REPLACE, GL_REPLACE, GL_REPLACE);
-			render_->SetUniformF1(&u_stencilValue, i * (128.0f / 255.0f));
-		} else {
-			render_->SetStencilOp(i, GL_REPLACE, GL_REPLACE, GL_REPLACE);
-			render_->SetUniformF1(&u_stencilValue, i * (1.0f / 255.0f));
-		}
+	if (stencilUploadExport_) {
+		// The unpacked alpha is already the full value the per-bit passes build up: 0 or 255 for 5551,
+		// and the nibble repeated for 4444.
+		render_->SetStencilOp(0xFF, GL_REPLACE, GL_REPLACE, GL_REPLACE);
 		DrawActiveTexture(0, 0, dstBuffer->width, dstBuffer->height, dstBuffer->bufferWidth, dstBuffer->bufferHeight, 0.0f, 0.0f, u1, v1, ROTATION_LOCKED_HORIZONTAL, DRAWTEX_NEAREST | DRAWTEX_KEEP_STENCIL_ALPHA);
+	} else {
+		for (int i = 1; i < values; i += i) {
+			if (!(usedBits & i)) {
+				// It's already zero, let's skip it.
+				continue;
+			}
+			if (dstBuffer->format == GE_FORMAT_4444) {
+				render_->SetStencilOp((i << 4) | i, GL_REPLACE, GL_REPLACE, GL_REPLACE);
+				render_->SetUniformF1(&u_stencilValue, i * (16.0f / 255.0f));
+			} else if (dstBuffer->format == GE_FORMAT_5551) {
+				render_->SetStencilOp(0xFF, GL_REPLACE, GL_REPLACE, GL_REPLACE);
+				render_->SetUniformF1(&u_stencilValue, i * (128.0f / 255.0f));
+			} else {
+				render_->SetStencilOp(i, GL_REPLACE, GL_REPLACE, GL_REPLACE);
+				render_->SetUniformF1(&u_stencilValue, i * (1.0f / 255.0f));
+			}
+			DrawActiveTexture(0, 0, dstBuffer->width, dstBuffer->height, dstBuffer->bufferWidth, dstBuffer->bufferHeight, 0.0f, 0.0f, u1, v1, ROTATION_LOCKED_HORIZONTAL, DRAWTEX_NEAREST | DRAWTEX_KEEP_STENCIL_ALPHA);
+		}
 	}
 
 	if (useBlit) {
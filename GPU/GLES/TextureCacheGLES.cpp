@@ -49,6 +49,7 @@ TextureCacheGLES::TextureCacheGLES(Draw::DrawContext *draw)
 	timesInvalidatedAllThisFrame_ = 0;
 	lastBoundTexture = nullptr;
 	render_ = (GLRenderManager *)draw_->GetNativeObject(Draw::NativeObject::RENDER_MANAGER);
+	asyncScaler_.reset(new TextureScalerGLES());
 
 	SetupTextureDecoder();
 
@@ -213,6 +214,8 @@ static void ConvertColors(void *dstBuf, const void *srcBuf, Draw::DataFormat dst
 void TextureCacheGLES::StartFrame() {
 	InvalidateLastTexture();
 	timesInvalidatedAllThisFrame_ = 0;
+	UpdateReplacements();
+	UploadAsyncScaled();
 
 	GLRenderManager *renderManager = (GLRenderManager *)draw_->GetNativeObject(Draw::NativeObject::RENDER_MANAGER);
 	if (!lowMemoryMode_ && renderManager->SawOutOfMemory()) {
@@ -475,20 +478,23 @@ void TextureCacheGLES::ApplyTextureFramebuffer(TexCacheEntry *entry, VirtualFram
 
 		const GEPaletteFormat clutFormat = gstate.getClutPaletteFormat();
 		GLRTexture *clutTexture = depalShaderCache_->GetClutTexture(clutFormat, clutHash_, clutBuf_);
-		Draw::Framebuffer *depalFBO = framebufferManagerGL_->GetTempFBO(TempFBO::DEPAL, framebuffer->renderWidth, framebuffer->renderHeight, Draw::FBO_8888);
-		draw_->BindFramebufferAsRenderTarget(depalFBO, { Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE });
-
-		render_->SetScissor(GLRect2D{ 0, 0, (int)framebuffer->renderWidth, (int)framebuffer->renderHeight });
-		render_->SetViewport(GLRViewport{ 0.0f, 0.0f, (float)framebuffer->renderWidth, (float)framebuffer->renderHeight, 0.0f, 1.0f });
-		TextureShaderApplier shaderApply(depal, framebuffer->bufferWidth, framebuffer->bufferHeight, framebuffer->renderWidth, framebuffer->renderHeight);
-		shaderApply.ApplyBounds(gstate_c.vertBounds, gstate_c.curTextureXOffset, gstate_c.curTextureYOffset);
-		shaderApply.Use(render_, drawEngine_, shadeInputLayout_);
-
-		framebufferManagerGL_->BindFramebufferAsColorTexture(0, framebuffer, BINDFBCOLOR_SKIP_COPY | BINDFBCOLOR_FORCE_SELF);
-		render_->BindTexture(TEX_SLOT_CLUT, clutTexture);
-		render_->SetTextureSampler(TEX_SLOT_CLUT, GL_REPEAT, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST, 0.0f);
+		bool cached = false;
+		Draw::Framebuffer *depalFBO = GetDepalResult(framebuffer, &cached);
+		if (!cached) {
+			draw_->BindFramebufferAsRenderTarget(depalFBO, { Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE });
+
+			render_->SetScissor(GLRect2D{ 0, 0, (int)framebuffer->renderWidth, (int)framebuffer->renderHeight });
+			render_->SetViewport(GLRViewport{ 0.0f, 0.0f, (float)framebuffer->renderWidth, (float)framebuffer->renderHeight, 0.0f, 1.0f });
+			TextureShaderApplier shaderApply(depal, framebuffer->bufferWidth, framebuffer->bufferHeight, framebuffer->renderWidth, framebuffer->renderHeight);
+			shaderApply.ApplyBounds(gstate_c.vertBounds, gstate_c.curTextureXOffset, gstate_c.curTextureYOffset);
+			shaderApply.Use(render_, drawEngine_, shadeInputLayout_);
+
+			framebufferManagerGL_->BindFramebufferAsColorTexture(0, framebuffer, BINDFBCOLOR_SKIP_COPY | BINDFBCOLOR_FORCE_SELF);
+			render_->BindTexture(TEX_SLOT_CLUT, clutTexture);
+			render_->SetTextureSampler(TEX_SLOT_CLUT, GL_REPEAT, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST, 0.0f);
 
-		shaderApply.Shade(render_);
+			shaderApply.Shade(render_);
+		}
 
 		draw_->BindFramebufferAsTexture(depalFBO, 0, Draw::FB_COLOR_BIT, 0);
 
@@ -590,6 +596,8 @@ void TextureCacheGLES::BuildTexture(TexCacheEntry *const entry) {
 				canAutoGen = true;
 		}
 	}
+	// What the game wants to sample, in case we drop the levels below.
+	const int gameMaxLevel = maxLevel;
 
 	// If GLES3 is available, we can preallocate the storage, which makes texture loading more efficient.
 	Draw::DataFormat dstFmt = GetDestFormat(GETextureFormat(entry->format), gstate.getClutPaletteFormat());
@@ -651,10 +659,23 @@ void TextureCacheGLES::BuildTexture(TexCacheEntry *const entry) {
 	} else
 		LoadTextureLevel(*entry, replaced, 0, scaleFactor, dstFmt);
 
+	// Upscaled textures and replacements without mips would otherwise lose the game's mipmapping.
+	// Optionally, let the driver generate the missing levels from level 0 instead.
+	bool gpuMips = g_Config.bTexGPUMipmaps && gameMaxLevel > 0 && !IsFakeMipmapChange() && gstate_c.Supports(GPU_SUPPORTS_TEXTURE_LOD_CONTROL);
+	if (replaced.Valid()) {
+		gpuMips = gpuMips && maxLevel == 0 && !IsCompressedFormat(replaced.Format(0));
+	} else {
+		gpuMips = gpuMips && scaleFactor > 1;
+	}
+
 	// Mipmapping only enable when texture scaling disable
 	int texMaxLevel = 0;
 	bool genMips = false;
-	if (maxLevel > 0 && scaleFactor == 1) {
+	if (gpuMips) {
+		genMips = true;
+		maxLevel = gameMaxLevel;
+		texMaxLevel = gameMaxLevel;
+	} else if (maxLevel > 0 && scaleFactor == 1) {
 		if (gstate_c.Supports(GPU_SUPPORTS_TEXTURE_LOD_CONTROL)) {
 			if (badMipSizes) {
 				// WARN_LOG(G3D, "Bad mipmap for texture sized %dx%dx%d - autogenerating", w, h, (int)format);
@@ -688,6 +709,8 @@ void TextureCacheGLES::BuildTexture(TexCacheEntry *const entry) {
 	} else {
 		entry->status &= ~TexCacheEntry::STATUS_BAD_MIPS;
 	}
+	SetReplacedSize(entry, replaced.Valid() ? (u32)replaced.MemorySize() : 0);
+	SetScaledSize(entry, scaleFactor);
 	if (replaced.Valid()) {
 		entry->SetAlphaStatus(TexCacheEntry::TexStatus(replaced.AlphaStatus()));
 	}
@@ -700,6 +723,13 @@ void TextureCacheGLES::BuildTexture(TexCacheEntry *const entry) {
 	UpdateSamplingParams(*entry, true);
 }
 
+void TextureCacheGLES::UploadScaledTexture(TexCacheEntry *entry, AsyncScaleTask &task) {
+	render_->TextureImage(entry->textureName, 0, task.w, task.h, (Draw::DataFormat)task.fmt, (uint8_t *)task.pixels, GLRAllocType::ALIGNED);
+	render_->FinalizeTexture(entry->textureName, 0, false);
+	// The render manager owns the pixels now.
+	task.pixels = nullptr;
+}
+
 Draw::DataFormat TextureCacheGLES::GetDestFormat(GETextureFormat format, GEPaletteFormat clutFormat) const {
 	switch (format) {
 	case GE_TFMT_CLUT4:
@@ -783,10 +813,13 @@ void TextureCacheGLES::LoadTextureLevel(TexCacheEntry &entry, ReplacedTexture &r
 			entry.SetAlphaStatus(TexCacheEntry::STATUS_ALPHA_UNKNOWN);
 		}
 
-		if (scaleFactor > 1) {
+		if (scaleFactor > 1 && CanScaleAsync()) {
+			// Show it unscaled until the worker is done with it.
+			QueueAsyncScale(entry, pixelData, decPitch * h, w, h, (u32)dstFmt, scaleFactor);
+		} else if (scaleFactor > 1) {
 			uint8_t *rearrange = (uint8_t *)AllocateAlignedMemory(w * scaleFactor * h * scaleFactor * 4, 16);
 			u32 dFmt = (u32)dstFmt;
-			scaler.ScaleAlways((u32 *)rearrange, (u32 *)pixelData, dFmt, w, h, scaleFactor);
+			ScaleCached(scaler, entry.CacheKey(), entry.fullhash, level, (u32 *)rearrange, (u32 *)pixelData, dFmt, w, h, scaleFactor);
 			dstFmt = (Draw::DataFormat)dFmt;
 			FreeAlignedMemory(pixelData);
 			pixelData = rearrange;
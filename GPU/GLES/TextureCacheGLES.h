@@ -84,6 +84,7 @@ class TextureCacheGLES : public TextureCacheCommon {
 	void ApplyTextureFramebuffer(TexCacheEntry *entry, VirtualFramebuffer *framebuffer) override;
 
 	void BuildTexture(TexCacheEntry *const entry) override;
+	void UploadScaledTexture(TexCacheEntry *entry, AsyncScaleTask &task) override;
 
 	GLRenderManager *render_;
 
@@ -66,10 +66,12 @@ struct GPUStatistics {
 		numTextureSwitches = 0;
 		numShaderSwitches = 0;
 		numFlushes = 0;
+		numFlushesSkipped = 0;
 		numTexturesDecoded = 0;
 		numReadbacks = 0;
 		numUploads = 0;
 		numClears = 0;
+		numShadersCompiled = 0;
 		msProcessingDisplayLists = 0;
 		vertexGPUCycles = 0;
 		otherGPUCycles = 0;
@@ -80,6 +82,7 @@ struct GPUStatistics {
 	int numDrawCalls;
 	int numCachedDrawCalls;
 	int numFlushes;
+	int numFlushesSkipped;
 	int numVertsSubmitted;
 	int numCachedVertsDrawn;
 	int numUncachedVertsDrawn;
@@ -91,11 +94,19 @@ struct GPUStatistics {
 	int numReadbacks;
 	int numUploads;
 	int numClears;
+	int numShadersCompiled;
 	double msProcessingDisplayLists;
 	int vertexGPUCycles;
 	int otherGPUCycles;
 	int gpuCommandsAtCallLevel[4];
 
+	// Set at the start of each frame, for the previous frame.
+	int frameArenaHighWater;
+
+	// Texture cache budget in bytes, and textures evicted to stay within it since the last reset.
+	s64 textureCacheBudget;
+	int numTextureEvictions;
+
 	// Flip count. Doesn't really belong here.
 	int numFlips;
 };
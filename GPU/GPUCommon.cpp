@@ -4,8 +4,11 @@
 
 #include "base/timeutil.h"
 #include "profiler/profiler.h"
+#include "thread/threadutil.h"
 
 #include "Common/ColorConv.h"
+#include "Common/FileUtil.h"
+#include "Common/MemoryUsage.h"
 #include "Core/Reporting.h"
 #include "GPU/GeDisasm.h"
 #include "GPU/GPU.h"
@@ -17,6 +20,8 @@
 #include "Core/MemMap.h"
 #include "Core/Host.h"
 #include "Core/Reporting.h"
+#include "Core/System.h"
+#include "Core/ELF/ParamSFO.h"
 #include "Core/HLE/HLE.h"
 #include "Core/HLE/sceKernelMemory.h"
 #include "Core/HLE/sceKernelInterrupt.h"
@@ -362,6 +367,16 @@ void GPUCommon::Flush() {
 	drawEngineCommon_->DispatchFlush();
 }
 
+void GPUCommon::FlushForTransformChange() {
+	if (!drawEngineCommon_->CanSkipFlushForTransform())
+		Flush();
+}
+
+void GPUCommon::FlushForBoneChange() {
+	if (!drawEngineCommon_->CanSkipFlushForBones())
+		Flush();
+}
+
 GPUCommon::GPUCommon(GraphicsContext *gfxCtx, Draw::DrawContext *draw) :
 	dumpNextFrame_(false),
 	dumpThisFrame_(false),
@@ -411,6 +426,7 @@ GPUCommon::GPUCommon(GraphicsContext *gfxCtx, Draw::DrawContext *draw) :
 }
 
 GPUCommon::~GPUCommon() {
+	StopGEThread();
 }
 
 void GPUCommon::UpdateCmdInfo() {
@@ -443,6 +459,7 @@ void GPUCommon::EndHostFrame() {
 }
 
 void GPUCommon::Reinitialize() {
+	SyncThread();
 	memset(dls, 0, sizeof(dls));
 	for (int i = 0; i < DisplayListMaxCount; ++i) {
 		dls[i].state = PSP_GE_DL_STATE_NONE;
@@ -458,6 +475,14 @@ void GPUCommon::Reinitialize() {
 	interruptsEnabled_ = true;
 }
 
+void GPUCommon::Reboot() {
+	// The backends drop their textures and framebuffers here, they all point into the old game's memory.
+	Reinitialize();
+	gstate.Reset();
+	gstate_c.Dirty(DIRTY_ALL);
+	gpuStats.Reset();
+}
+
 int GPUCommon::EstimatePerVertexCost() {
 	// TODO: This is transform cost, also account for rasterization cost somehow... although it probably
 	// runs in parallel with transform.
@@ -502,6 +527,7 @@ void GPUCommon::PopDLQueue() {
 }
 
 bool GPUCommon::BusyDrawing() {
+	SyncThread();
 	u32 state = DrawSync(1);
 	if (state == PSP_GE_LIST_DRAWING || state == PSP_GE_LIST_STALLING) {
 		if (currentList && currentList->state != PSP_GE_DL_STATE_PAUSED) {
@@ -523,6 +549,7 @@ u32 GPUCommon::DrawSync(int mode) {
 	if (mode < 0 || mode > 1)
 		return SCE_KERNEL_ERROR_INVALID_MODE;
 
+	SyncThread();
 	if (mode == 0) {
 		if (!__KernelIsDispatchEnabled()) {
 			return SCE_KERNEL_ERROR_CAN_NOT_WAIT;
@@ -574,6 +601,7 @@ int GPUCommon::ListSync(int listid, int mode) {
 	if (mode < 0 || mode > 1)
 		return SCE_KERNEL_ERROR_INVALID_MODE;
 
+	SyncThread();
 	DisplayList& dl = dls[listid];
 	if (mode == 1) {
 		switch (dl.state) {
@@ -612,6 +640,7 @@ int GPUCommon::ListSync(int listid, int mode) {
 }
 
 int GPUCommon::GetStack(int index, u32 stackPtr) {
+	SyncThread();
 	if (!currentList) {
 		// Seems like it doesn't return an error code?
 		return 0;
@@ -646,6 +675,7 @@ u32 GPUCommon::EnqueueList(u32 listpc, u32 stall, int subIntrBase, PSPPointer<Ps
 		return SCE_KERNEL_ERROR_INVALID_POINTER;
 	}
 
+	SyncThread();
 	int id = -1;
 	u64 currentTicks = CoreTiming::GetTicks();
 	u32_le stackAddr = args.IsValid() ? args->stackAddr : 0;
@@ -739,13 +769,14 @@ u32 GPUCommon::EnqueueList(u32 listpc, u32 stall, int subIntrBase, PSPPointer<Ps
 		drawCompleteTicks = (u64)-1;
 
 		// TODO save context when starting the list if param is set
-		ProcessDLQueue();
+		RunDLQueue();
 	}
 
 	return id;
 }
 
 u32 GPUCommon::DequeueList(int listid) {
+	SyncThread();
 	if (listid < 0 || listid >= DisplayListMaxCount || dls[listid].state == PSP_GE_DL_STATE_NONE)
 		return SCE_KERNEL_ERROR_INVALID_ID;
 
@@ -769,6 +800,7 @@ u32 GPUCommon::DequeueList(int listid) {
 }
 
 u32 GPUCommon::UpdateStall(int listid, u32 newstall) {
+	SyncThread();
 	if (listid < 0 || listid >= DisplayListMaxCount || dls[listid].state == PSP_GE_DL_STATE_NONE)
 		return SCE_KERNEL_ERROR_INVALID_ID;
 	auto &dl = dls[listid];
@@ -777,12 +809,13 @@ u32 GPUCommon::UpdateStall(int listid, u32 newstall) {
 
 	dl.stall = newstall & 0x0FFFFFFF;
 	
-	ProcessDLQueue();
+	RunDLQueue();
 
 	return 0;
 }
 
 u32 GPUCommon::Continue() {
+	SyncThread();
 	if (!currentList)
 		return 0;
 
@@ -818,7 +851,7 @@ u32 GPUCommon::Continue() {
 		return -1;
 	}
 
-	ProcessDLQueue();
+	RunDLQueue();
 	return 0;
 }
 
@@ -826,6 +859,7 @@ u32 GPUCommon::Break(int mode) {
 	if (mode < 0 || mode > 1)
 		return SCE_KERNEL_ERROR_INVALID_MODE;
 
+	SyncThread();
 	if (!currentList)
 		return SCE_KERNEL_ERROR_ALREADY;
 
@@ -974,7 +1008,8 @@ bool GPUCommon::InterpretList(DisplayList &list) {
 	if (coreCollectDebugStats) {
 		time_update();
 		double total = time_now_d() - start - timeSpentStepping_;
-		hleSetSteppingTime(timeSpentStepping_);
+		const double steppingTime = timeSpentStepping_;
+		ScheduleHLE([=] { hleSetSteppingTime(steppingTime); });
 		timeSpentStepping_ = 0.0;
 		gpuStats.msProcessingDisplayLists += total;
 	}
@@ -985,6 +1020,8 @@ bool GPUCommon::InterpretList(DisplayList &list) {
 void GPUCommon::FastRunLoop(DisplayList &list) {
 	PROFILE_THIS_SCOPE("gpuloop");
 	const CommandInfo *cmdInfo = cmdInfo_;
+	// Plain state writes only dirty things. Collect those and apply them before anything can look.
+	uint64_t pendingDirty = 0;
 	int dc = downcount;
 	for (; dc > 0; --dc) {
 		// We know that display list PCs have the upper nibble == 0 - no need to mask the pointer
@@ -994,6 +1031,8 @@ void GPUCommon::FastRunLoop(DisplayList &list) {
 		const u32 diff = op ^ gstate.cmdmem[cmd];
 		if (diff == 0) {
 			if (info.flags & FLAG_EXECUTE) {
+				gstate_c.Dirty(pendingDirty);
+				pendingDirty = 0;
 				downcount = dc;
 				(this->*info.func)(op, diff);
 				dc = downcount;
@@ -1002,27 +1041,46 @@ void GPUCommon::FastRunLoop(DisplayList &list) {
 			uint64_t flags = info.flags;
 			if (flags & FLAG_FLUSHBEFOREONCHANGE) {
 				if (drawEngineCommon_->GetNumDrawCalls()) {
+					gstate_c.Dirty(pendingDirty);
+					pendingDirty = 0;
 					drawEngineCommon_->DispatchFlush();
 				}
 			}
 			gstate.cmdmem[cmd] = op;
 			if (flags & (FLAG_EXECUTE | FLAG_EXECUTEONCHANGE)) {
+				gstate_c.Dirty(pendingDirty);
+				pendingDirty = 0;
 				downcount = dc;
 				(this->*info.func)(op, diff);
 				dc = downcount;
 			} else {
-				uint64_t dirty = flags >> 8;
-				if (dirty)
-					gstate_c.Dirty(dirty);
+				pendingDirty |= flags >> 8;
 			}
 		}
 		list.pc += 4;
 	}
+	gstate_c.Dirty(pendingDirty);
 	downcount = 0;
 }
 
 void GPUCommon::BeginFrame() {
 	immCount_ = 0;
+	drawEngineCommon_->ResetFrameArena();
+
+	int lowMemoryCount = MemoryUsage::LowMemoryCount();
+	if (lowMemoryCount != lowMemoryCount_) {
+		lowMemoryCount_ = lowMemoryCount;
+		// The software renderer has no texture cache.
+		if (textureCache_) {
+			NOTICE_LOG(G3D, "Low on memory, trimming texture cache");
+			textureCache_->TrimForLowMemory();
+		}
+	}
+
+	if (textureCache_) {
+		TexCacheStats_EndFrame();
+	}
+
 	if (dumpNextFrame_) {
 		NOTICE_LOG(G3D, "DUMPING THIS FRAME");
 		dumpThisFrame_ = true;
@@ -1085,6 +1143,7 @@ void GPUCommon::UpdatePC(u32 currentPC, u32 newPC) {
 }
 
 void GPUCommon::ReapplyGfxState() {
+	SyncThread();
 	// The commands are embedded in the command memory so we can just reexecute the words. Convenient.
 	// To be safe we pass 0xFFFFFFFF as the diff.
 
@@ -1124,8 +1183,8 @@ int GPUCommon::GetNextListIndex() {
 	}
 }
 
-void GPUCommon::ProcessDLQueue() {
-	startingTicks = CoreTiming::GetTicks();
+void GPUCommon::ProcessDLQueue(u64 startTicks) {
+	startingTicks = startTicks;
 	cyclesExecuted = 0;
 
 	// Seems to be correct behaviour to process the list anyway?
@@ -1152,10 +1211,143 @@ void GPUCommon::ProcessDLQueue() {
 
 	drawCompleteTicks = startingTicks + cyclesExecuted;
 	busyTicks = std::max(busyTicks, drawCompleteTicks);
-	__GeTriggerSync(GPU_SYNC_DRAW, 1, drawCompleteTicks);
+	TriggerSync(GPU_SYNC_DRAW, 1, drawCompleteTicks);
 	// Since the event is in CoreTiming, we're in sync.  Just set 0 now.
 }
 
+void GPUCommon::RunDLQueue() {
+	// The debugger and recorder expect to step lists synchronously.
+	bool useThread = g_Config.bSeparateGEThread && SupportsGEThread();
+	if (!useThread || GPUDebug::IsActive() || GPURecord::IsActive()) {
+		CoreTiming::TimeCategoryScope timeScope(CoreTiming::TimeCategory::GPU);
+		ProcessDLQueue(CoreTiming::GetTicks());
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard(geLock_);
+	if (!geThread_.joinable()) {
+		geThreadQuit_ = false;
+		geThread_ = std::thread(&GPUCommon::GEThreadFunc, this);
+		geThreadId_ = geThread_.get_id();
+	}
+	// Callers have synced already, so the thread is idle. Capture the time here for determinism.
+	geWorkTicks_ = CoreTiming::GetTicks();
+	geWorkPending_ = true;
+	geWorkCond_.notify_one();
+}
+
+bool GPUCommon::OnGEThread() const {
+	return geThreadId_ == std::this_thread::get_id();
+}
+
+void GPUCommon::GEThreadFunc() {
+	setCurrentThreadName("GE");
+	setCurrentThreadRole(ThreadRole::EMULATION);
+
+	std::unique_lock<std::mutex> guard(geLock_);
+	while (true) {
+		geWorkCond_.wait(guard, [this] { return geWorkPending_ || geThreadQuit_; });
+		if (geThreadQuit_)
+			break;
+
+		u64 ticks = geWorkTicks_;
+		guard.unlock();
+		ProcessDLQueue(ticks);
+
+		bool hasDeferred;
+		{
+			std::lock_guard<std::mutex> deferredGuard(deferredLock_);
+			hasDeferred = !deferredHLE_.empty();
+		}
+		// Syncs normally drain this, but wake the emu thread in case it doesn't call into us for a while.
+		if (hasDeferred)
+			__GeNotifyDeferredHLE();
+
+		guard.lock();
+		geWorkPending_ = false;
+		geIdleCond_.notify_all();
+	}
+}
+
+void GPUCommon::StopGEThread() {
+	if (!geThread_.joinable())
+		return;
+
+	{
+		std::unique_lock<std::mutex> guard(geLock_);
+		geIdleCond_.wait(guard, [this] { return !geWorkPending_; });
+		geThreadQuit_ = true;
+		geWorkCond_.notify_one();
+	}
+	geThread_.join();
+	geThreadId_ = std::thread::id();
+
+	// The kernel may already be gone, so just drop anything left over.
+	std::lock_guard<std::mutex> guard(deferredLock_);
+	deferredHLE_.clear();
+}
+
+void GPUCommon::LoadVertexDecoderCache() {
+	std::string discID = g_paramSFO.GetDiscID();
+	if (discID.empty())
+		return;
+	File::CreateFullPath(GetSysDirectory(DIRECTORY_APP_CACHE));
+	vertexDecoderCachePath_ = GetSysDirectory(DIRECTORY_APP_CACHE) + "/" + discID + ".vtxcache";
+	if (!drawEngineCommon_->LoadVertexDecoderCache(vertexDecoderCachePath_)) {
+		File::Delete(vertexDecoderCachePath_);
+	}
+}
+
+void GPUCommon::SaveVertexDecoderCache() {
+	if (vertexDecoderCachePath_.empty())
+		return;
+	// The GE thread might still be adding decoders.
+	StopGEThread();
+	drawEngineCommon_->SaveVertexDecoderCache(vertexDecoderCachePath_);
+}
+
+void GPUCommon::SyncThread() {
+	if (OnGEThread())
+		return;
+
+	if (geThread_.joinable()) {
+		std::unique_lock<std::mutex> guard(geLock_);
+		geIdleCond_.wait(guard, [this] { return !geWorkPending_; });
+	}
+	ProcessDeferredHLE();
+}
+
+void GPUCommon::ProcessDeferredHLE() {
+	std::vector<std::function<void()>> work;
+	{
+		std::lock_guard<std::mutex> guard(deferredLock_);
+		if (deferredHLE_.empty())
+			return;
+		work.swap(deferredHLE_);
+	}
+	for (auto &func : work)
+		func();
+}
+
+void GPUCommon::ScheduleHLE(std::function<void()> func) {
+	if (!OnGEThread()) {
+		func();
+		return;
+	}
+	std::lock_guard<std::mutex> guard(deferredLock_);
+	deferredHLE_.push_back(func);
+}
+
+bool GPUCommon::TriggerInterrupt(int listid, u32 pc, u64 atTicks) {
+	// This always succeeds, so we don't need to wait for the result.
+	ScheduleHLE([=] { __GeTriggerInterrupt(listid, pc, atTicks); });
+	return true;
+}
+
+void GPUCommon::TriggerSync(GPUSyncType type, int id, u64 atTicks) {
+	ScheduleHLE([=] { __GeTriggerSync(type, id, atTicks); });
+}
+
 void GPUCommon::PreExecuteOp(u32 op, u32 diff) {
 	// Nothing to do
 }
@@ -1387,7 +1579,7 @@ void GPUCommon::Execute_End(u32 op, u32 diff) {
 			}
 			// TODO: Technically, jump/call/ret should generate an interrupt, but before the pc change maybe?
 			if (currentList->interruptsEnabled && trigger) {
-				if (__GeTriggerInterrupt(currentList->id, currentList->pc, startingTicks + cyclesExecuted)) {
+				if (TriggerInterrupt(currentList->id, currentList->pc, startingTicks + cyclesExecuted)) {
 					currentList->pendingInterrupt = true;
 					UpdateState(GPUSTATE_INTERRUPT);
 				}
@@ -1399,7 +1591,7 @@ void GPUCommon::Execute_End(u32 op, u32 diff) {
 		case PSP_GE_SIGNAL_HANDLER_PAUSE:
 			currentList->state = PSP_GE_DL_STATE_PAUSED;
 			if (currentList->interruptsEnabled) {
-				if (__GeTriggerInterrupt(currentList->id, currentList->pc, startingTicks + cyclesExecuted)) {
+				if (TriggerInterrupt(currentList->id, currentList->pc, startingTicks + cyclesExecuted)) {
 					currentList->pendingInterrupt = true;
 					UpdateState(GPUSTATE_INTERRUPT);
 				}
@@ -1414,13 +1606,13 @@ void GPUCommon::Execute_End(u32 op, u32 diff) {
 		default:
 			currentList->subIntrToken = prev & 0xFFFF;
 			UpdateState(GPUSTATE_DONE);
-			if (currentList->interruptsEnabled && __GeTriggerInterrupt(currentList->id, currentList->pc, startingTicks + cyclesExecuted)) {
+			if (currentList->interruptsEnabled && TriggerInterrupt(currentList->id, currentList->pc, startingTicks + cyclesExecuted)) {
 				currentList->pendingInterrupt = true;
 			} else {
 				currentList->state = PSP_GE_DL_STATE_COMPLETED;
 				currentList->waitTicks = startingTicks + cyclesExecuted;
 				busyTicks = std::max(busyTicks, currentList->waitTicks);
-				__GeTriggerSync(GPU_SYNC_LIST, currentList->id, currentList->waitTicks);
+				TriggerSync(GPU_SYNC_LIST, currentList->id, currentList->waitTicks);
 				if (currentList->started && currentList->context.IsValid()) {
 					gstate.Restore(currentList->context);
 					ReapplyGfxState();
@@ -1707,6 +1899,9 @@ void GPUCommon::Execute_Prim(u32 op, u32 diff) {
 			break;
 
 		default:
+			// Rewriting the same value is a no-op, unless the command always runs.
+			if (data == gstate.cmdmem[data >> 24] && (cmdInfo_[data >> 24].flags & FLAG_EXECUTE) == 0)
+				break;
 			// All other commands might need a flush or something, stop this inner loop.
 			goto bail;
 		}
@@ -1922,7 +2117,7 @@ void GPUCommon::Execute_WorldMtxNum(u32 op, u32 diff) {
 		while ((src[i] >> 24) == GE_CMD_WORLDMATRIXDATA) {
 			const u32 newVal = src[i] << 8;
 			if (dst[i] != newVal) {
-				Flush();
+				FlushForTransformChange();
 				dst[i] = newVal;
 				gstate_c.Dirty(DIRTY_WORLDMATRIX);
 			}
@@ -1945,7 +2140,7 @@ void GPUCommon::Execute_WorldMtxData(u32 op, u32 diff) {
 	int num = gstate.worldmtxnum & 0xF;
 	u32 newVal = op << 8;
 	if (num < 12 && newVal != ((const u32 *)gstate.worldMatrix)[num]) {
-		Flush();
+		FlushForTransformChange();
 		((u32 *)gstate.worldMatrix)[num] = newVal;
 		gstate_c.Dirty(DIRTY_WORLDMATRIX);
 	}
@@ -1969,7 +2164,7 @@ void GPUCommon::Execute_ViewMtxNum(u32 op, u32 diff) {
 		while ((src[i] >> 24) == GE_CMD_VIEWMATRIXDATA) {
 			const u32 newVal = src[i] << 8;
 			if (dst[i] != newVal) {
-				Flush();
+				FlushForTransformChange();
 				dst[i] = newVal;
 				gstate_c.Dirty(DIRTY_VIEWMATRIX);
 			}
@@ -1992,7 +2187,7 @@ void GPUCommon::Execute_ViewMtxData(u32 op, u32 diff) {
 	int num = gstate.viewmtxnum & 0xF;
 	u32 newVal = op << 8;
 	if (num < 12 && newVal != ((const u32 *)gstate.viewMatrix)[num]) {
-		Flush();
+		FlushForTransformChange();
 		((u32 *)gstate.viewMatrix)[num] = newVal;
 		gstate_c.Dirty(DIRTY_VIEWMATRIX);
 	}
@@ -2016,7 +2211,7 @@ void GPUCommon::Execute_ProjMtxNum(u32 op, u32 diff) {
 		while ((src[i] >> 24) == GE_CMD_PROJMATRIXDATA) {
 			const u32 newVal = src[i] << 8;
 			if (dst[i] != newVal) {
-				Flush();
+				FlushForTransformChange();
 				dst[i] = newVal;
 				gstate_c.Dirty(DIRTY_PROJMATRIX);
 			}
@@ -2039,7 +2234,7 @@ void GPUCommon::Execute_ProjMtxData(u32 op, u32 diff) {
 	int num = gstate.projmtxnum & 0x1F;    // NOTE: Changed from 0xF to catch overflows
 	u32 newVal = op << 8;
 	if (num < 0x10 && newVal != ((const u32 *)gstate.projMatrix)[num]) {
-		Flush();
+		FlushForTransformChange();
 		((u32 *)gstate.projMatrix)[num] = newVal;
 		gstate_c.Dirty(DIRTY_PROJMATRIX);
 	}
@@ -2113,7 +2308,7 @@ void GPUCommon::Execute_BoneMtxNum(u32 op, u32 diff) {
 			while ((src[i] >> 24) == GE_CMD_BONEMATRIXDATA) {
 				const u32 newVal = src[i] << 8;
 				if (dst[i] != newVal) {
-					Flush();
+					FlushForBoneChange();
 					dst[i] = newVal;
 				}
 				if (++i >= end) {
@@ -2155,7 +2350,7 @@ void GPUCommon::Execute_BoneMtxData(u32 op, u32 diff) {
 	if (num < 96 && newVal != ((const u32 *)gstate.boneMatrix)[num]) {
 		// Bone matrices should NOT flush when software skinning is enabled!
 		if (!g_Config.bSoftwareSkinning) {
-			Flush();
+			FlushForBoneChange();
 			gstate_c.Dirty(DIRTY_BONEMATRIX0 << (num / 12));
 		} else {
 			gstate_c.deferredVertTypeDirty |= DIRTY_BONEMATRIX0 << (num / 12);
@@ -2306,7 +2501,7 @@ void GPUCommon::FastLoadBoneMatrix(u32 target) {
 	}
 
 	if (!g_Config.bSoftwareSkinning) {
-		Flush();
+		FlushForBoneChange();
 		gstate_c.Dirty(uniformsToDirty);
 	} else {
 		gstate_c.deferredVertTypeDirty |= uniformsToDirty;
@@ -2357,6 +2552,7 @@ struct DisplayList_v2 {
 };
 
 void GPUCommon::DoState(PointerWrap &p) {
+	SyncThread();
 	auto s = p.Section("GPUCommon", 1, 4);
 	if (!s)
 		return;
@@ -2432,9 +2628,11 @@ void GPUCommon::DoState(PointerWrap &p) {
 }
 
 void GPUCommon::InterruptStart(int listid) {
+	SyncThread();
 	interruptRunning = true;
 }
 void GPUCommon::InterruptEnd(int listid) {
+	SyncThread();
 	interruptRunning = false;
 	isbreak = false;
 
@@ -2458,11 +2656,12 @@ void GPUCommon::InterruptEnd(int listid) {
 		}
 	}
 
-	ProcessDLQueue();
+	RunDLQueue();
 }
 
 // TODO: Maybe cleaner to keep this in GE and trigger the clear directly?
 void GPUCommon::SyncEnd(GPUSyncType waitType, int listid, bool wokeThreads) {
+	SyncThread();
 	if (waitType == GPU_SYNC_DRAW && wokeThreads)
 	{
 		for (int i = 0; i < DisplayListMaxCount; ++i) {
@@ -2656,6 +2855,7 @@ void GPUCommon::DoBlockTransfer(u32 skipDrawReason) {
 
 		// Fixes Gran Turismo's funky text issue, since it overwrites the current texture.
 		textureCache_->Invalidate(dstBasePtr + (dstY * dstStride + dstX) * bpp, height * dstStride * bpp, GPU_INVALIDATE_HINT);
+		drawEngineCommon_->NotifyMemoryWrite(dstBasePtr + (dstY * dstStride + dstX) * bpp, height * dstStride * bpp);
 		framebufferManager_->NotifyBlockTransferAfter(dstBasePtr, dstStride, dstX, dstY, srcBasePtr, srcStride, srcX, srcY, width, height, bpp, skipDrawReason);
 	}
 
@@ -2667,6 +2867,7 @@ void GPUCommon::DoBlockTransfer(u32 skipDrawReason) {
 }
 
 bool GPUCommon::PerformMemoryCopy(u32 dest, u32 src, int size) {
+	SyncThread();
 	// Track stray copies of a framebuffer in RAM. MotoGP does this.
 	if (framebufferManager_->MayIntersectFramebuffer(src) || framebufferManager_->MayIntersectFramebuffer(dest)) {
 		if (!framebufferManager_->NotifyFramebufferCopy(src, dest, size, false, gstate_c.skipDrawReason)) {
@@ -2686,6 +2887,7 @@ bool GPUCommon::PerformMemoryCopy(u32 dest, u32 src, int size) {
 }
 
 bool GPUCommon::PerformMemorySet(u32 dest, u8 v, int size) {
+	SyncThread();
 	// This may indicate a memset, usually to 0, of a framebuffer.
 	if (framebufferManager_->MayIntersectFramebuffer(dest)) {
 		Memory::Memset(dest, v, size);
@@ -2721,10 +2923,14 @@ bool GPUCommon::PerformMemoryUpload(u32 dest, int size) {
 }
 
 void GPUCommon::InvalidateCache(u32 addr, int size, GPUInvalidationType type) {
-	if (size > 0)
+	SyncThread();
+	if (size > 0) {
 		textureCache_->Invalidate(addr, size, type);
-	else
+		// Whole-cache writebacks don't say what changed, so the vertex cache keeps hashing for those.
+		drawEngineCommon_->NotifyMemoryWrite(addr, size);
+	} else {
 		textureCache_->InvalidateAll(type);
+	}
 
 	if (type != GPU_INVALIDATE_ALL && framebufferManager_->MayIntersectFramebuffer(addr)) {
 		// Vempire invalidates (with writeback) after drawing, but before blitting.
@@ -2735,6 +2941,7 @@ void GPUCommon::InvalidateCache(u32 addr, int size, GPUInvalidationType type) {
 }
 
 void GPUCommon::NotifyVideoUpload(u32 addr, int size, int width, int format) {
+	SyncThread();
 	if (Memory::IsVRAMAddress(addr)) {
 		framebufferManager_->NotifyVideoUpload(addr, size, width, (GEBufferFormat)format);
 	}
@@ -2743,6 +2950,7 @@ void GPUCommon::NotifyVideoUpload(u32 addr, int size, int width, int format) {
 }
 
 bool GPUCommon::PerformStencilUpload(u32 dest, int size) {
+	SyncThread();
 	if (framebufferManager_->MayIntersectFramebuffer(dest)) {
 		framebufferManager_->NotifyStencilUpload(dest, size);
 		return true;
@@ -2808,6 +3016,7 @@ bool GPUCommon::DescribeCodePtr(const u8 *ptr, std::string &name) {
 }
 
 bool GPUCommon::FramebufferDirty() {
+	SyncThread();
 	VirtualFramebuffer *vfb = framebufferManager_->GetDisplayVFB();
 	if (vfb) {
 		bool dirty = vfb->dirtyAfterDisplay;
@@ -2818,6 +3027,7 @@ bool GPUCommon::FramebufferDirty() {
 }
 
 bool GPUCommon::FramebufferReallyDirty() {
+	SyncThread();
 	VirtualFramebuffer *vfb = framebufferManager_->GetDisplayVFB();
 	if (vfb) {
 		bool dirty = vfb->reallyDirtyAfterDisplay;
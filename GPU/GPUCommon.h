@@ -1,5 +1,11 @@
 #pragma once
 
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "Common/Common.h"
 #include "Common/MemoryUtil.h"
 #include "GPU/GPUInterface.h"
@@ -80,6 +86,7 @@ class GPUCommon : public GPUInterface, public GPUDebugInterface {
 	void CancelReady() override {
 	}
 	void Reinitialize() override;
+	void Reboot() override;
 
 	void BeginHostFrame() override;
 	void EndHostFrame() override;
@@ -98,7 +105,7 @@ class GPUCommon : public GPUInterface, public GPUDebugInterface {
 	void PreExecuteOp(u32 op, u32 diff) override;
 
 	bool InterpretList(DisplayList &list) override;
-	void ProcessDLQueue();
+	void ProcessDLQueue(u64 startTicks);
 	u32  UpdateStall(int listid, u32 newstall) override;
 	u32  EnqueueList(u32 listpc, u32 stall, int subIntrBase, PSPPointer<PspGeListArgs> args, bool head) override;
 	u32  DequeueList(int listid) override;
@@ -107,6 +114,8 @@ class GPUCommon : public GPUInterface, public GPUDebugInterface {
 	int  GetStack(int index, u32 stackPtr) override;
 	void DoState(PointerWrap &p) override;
 	bool BusyDrawing() override;
+	void SyncThread() override;
+	void ProcessDeferredHLE() override;
 	u32  Continue() override;
 	u32  Break(int mode) override;
 	void ReapplyGfxState() override;
@@ -169,6 +178,9 @@ class GPUCommon : public GPUInterface, public GPUDebugInterface {
 
 	// Note: Not virtual!
 	void Flush();
+	// Matrix changes only need to flush if the pending draws actually use that matrix.
+	void FlushForTransformChange();
+	void FlushForBoneChange();
 
 #ifdef USE_CRT_DBG
 #undef new
@@ -232,6 +244,7 @@ class GPUCommon : public GPUInterface, public GPUDebugInterface {
 	}
 
 	DisplayList* getList(int listid) override {
+		SyncThread();
 		return &dls[listid];
 	}
 
@@ -243,6 +256,7 @@ class GPUCommon : public GPUInterface, public GPUDebugInterface {
 	void CleanupBeforeUI() override {}
 
 	s64 GetListTicks(int listid) override {
+		SyncThread();
 		if (listid >= 0 && listid < DisplayListMaxCount) {
 			return dls[listid].waitTicks;
 		}
@@ -293,6 +307,23 @@ class GPUCommon : public GPUInterface, public GPUDebugInterface {
 	void DoBlockTransfer(u32 skipDrawReason);
 	void DoExecuteCall(u32 target);
 
+	// Runs the display list queue, handing it to the GE thread if enabled.
+	void RunDLQueue();
+	// Backends that return true must sync in every override that touches GE state or memory.
+	virtual bool SupportsGEThread() const {
+		return framebufferManager_ && textureCache_;
+	}
+	bool OnGEThread() const;
+	void GEThreadFunc();
+	void StopGEThread();
+	// Precompiles vertex decoders seen in earlier runs of this game, and records them for next time.
+	void LoadVertexDecoderCache();
+	void SaveVertexDecoderCache();
+	// Kernel and CoreTiming state belongs to the emu thread, so list processing goes through these.
+	void ScheduleHLE(std::function<void()> func);
+	bool TriggerInterrupt(int listid, u32 pc, u64 atTicks);
+	void TriggerSync(GPUSyncType type, int id, u64 atTicks);
+
 	void AdvanceVerts(u32 vertType, int count, int bytesRead) {
 		if ((vertType & GE_VTYPE_IDX_MASK) != GE_VTYPE_IDX_NONE) {
 			int indexShift = ((vertType & GE_VTYPE_IDX_MASK) >> GE_VTYPE_IDX_SHIFT) - 1;
@@ -303,9 +334,10 @@ class GPUCommon : public GPUInterface, public GPUDebugInterface {
 	}
 
 	FramebufferManagerCommon *framebufferManager_;
-	TextureCacheCommon *textureCache_;
+	TextureCacheCommon *textureCache_ = nullptr;
 	DrawEngineCommon *drawEngineCommon_;
 	ShaderManagerCommon *shaderManager_;
+	std::string vertexDecoderCachePath_;
 
 	GraphicsContext *gfxCtx_;
 	Draw::DrawContext *draw_;
@@ -352,6 +384,7 @@ class GPUCommon : public GPUInterface, public GPUDebugInterface {
 
 	TransformedVertex immBuffer_[MAX_IMMBUFFER_SIZE];
 	int immCount_ = 0;
+	int lowMemoryCount_ = 0;
 	GEPrimitiveType immPrim_;
 
 	std::string reportingPrimaryInfo_;
@@ -362,6 +395,19 @@ class GPUCommon : public GPUInterface, public GPUDebugInterface {
 	// Debug stats.
 	double timeSteppingStarted_;
 	double timeSpentStepping_;
+
+	// Separate GE thread, see RunDLQueue().
+	std::thread geThread_;
+	std::thread::id geThreadId_;
+	std::mutex geLock_;
+	std::condition_variable geWorkCond_;
+	std::condition_variable geIdleCond_;
+	bool geWorkPending_ = false;
+	bool geThreadQuit_ = false;
+	u64 geWorkTicks_ = 0;
+
+	std::mutex deferredLock_;
+	std::vector<std::function<void()>> deferredHLE_;
 };
 
 struct CommonCommandTableEntry {
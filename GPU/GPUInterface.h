@@ -172,6 +172,8 @@ class GPUInterface {
 	virtual void CancelReady() = 0;
 	virtual void InitClear() = 0;
 	virtual void Reinitialize() = 0;
+	// For a warm reset of the same game: forgets the old guest state, keeps shaders, pipelines and vertex decoders.
+	virtual void Reboot() = 0;
 
 	// Frame managment
 	virtual void BeginHostFrame() = 0;
@@ -235,6 +237,12 @@ class GPUInterface {
 	virtual bool FramebufferReallyDirty() = 0;
 	virtual bool BusyDrawing() = 0;
 
+	// When display lists run on a separate GE thread, waits for it to go idle and then runs
+	// the HLE work (interrupts, sync wakeups) it queued. Must be called from the emu thread.
+	virtual void SyncThread() = 0;
+	// Runs queued HLE work from the GE thread without waiting for it.
+	virtual void ProcessDeferredHLE() = 0;
+
 	// If any jit is being used inside the GPU.
 	virtual bool DescribeCodePtr(const u8 *ptr, std::string &name) = 0;
 
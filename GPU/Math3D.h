@@ -1123,6 +1123,32 @@ inline void Vec4<float>::operator += (const Vec4<float> &other)
 	vec = _mm_add_ps(vec, other.vec);
 }
 
+template<> template<>
+inline Vec4<float> Vec4<int>::Cast<float>() const
+{
+	return Vec4<float>(_mm_cvtepi32_ps(ivec));
+}
+
+// Truncates, like the scalar cast.
+template<> template<>
+inline Vec4<int> Vec4<float>::Cast<int>() const
+{
+	return Vec4<int>(_mm_cvttps_epi32(vec));
+}
+
+// Vec4<int> operation
+template<>
+inline void Vec4<int>::operator += (const Vec4<int> &other)
+{
+	ivec = _mm_add_epi32(ivec, other.ivec);
+}
+
+template<>
+inline Vec4<int> Vec4<int>::operator + (const Vec4 &other) const
+{
+	return Vec4<int>(_mm_add_epi32(ivec, other.ivec));
+}
+
 template<>
 inline Vec4<float> Vec4<float>::operator + (const Vec4 &other) const
 {
@@ -0,0 +1,827 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstdlib>
+#include <mutex>
+#include "base/stringutil.h"
+#include "Common/ColorConv.h"
+#include "Common/PerfMap.h"
+#include "Core/Reporting.h"
+#include "GPU/GPUState.h"
+#include "GPU/Software/DrawPixel.h"
+#include "GPU/Software/Rasterizer.h"
+#include "GPU/Software/SoftGpu.h"
+
+#if defined(_M_SSE)
+#include <emmintrin.h>
+#endif
+
+using namespace Math3D;
+
+namespace Rasterizer {
+
+static std::mutex jitCacheLock;
+static PixelJitCache *jitCache = nullptr;
+
+void Init() {
+	jitCache = new PixelJitCache();
+}
+
+void Shutdown() {
+	delete jitCache;
+	jitCache = nullptr;
+}
+
+bool DescribeCodePtr(const u8 *ptr, std::string &name) {
+	if (!jitCache->IsInSpace(ptr)) {
+		return false;
+	}
+
+	name = jitCache->DescribeCodePtr(ptr);
+	return true;
+}
+
+void ComputePixelFuncID(PixelFuncID *id_out) {
+	PixelFuncID id;
+
+	id.clearMode = gstate.isModeClear();
+	id.fbFormat = gstate.FrameBufFormat();
+	// Depth range test - applied in clear mode, if not through mode.
+	id.applyDepthRange = !gstate.isModeThrough();
+	id.dithering = gstate.isDitherEnabled();
+	id.applyColorWriteMask = gstate.getColorMask() != 0;
+
+	id.alphaTestFunc = GE_COMP_ALWAYS;
+	id.colorTestFunc = GE_COMP_ALWAYS;
+	id.depthTestFunc = GE_COMP_ALWAYS;
+
+	if (id.clearMode) {
+		id.depthWrite = gstate.isClearModeDepthMask();
+	} else {
+		if (gstate.isAlphaTestEnabled())
+			id.alphaTestFunc = gstate.getAlphaTestFunction();
+		if (gstate.isColorTestEnabled())
+			id.colorTestFunc = gstate.getColorTestFunction();
+		if (gstate.isDepthTestEnabled()) {
+			id.depthTestFunc = gstate.getDepthTestFunction();
+			id.depthWrite = gstate.isDepthWriteEnabled();
+		}
+
+		id.applyFog = gstate.isFogEnabled() && !gstate.isModeThrough();
+
+		id.stencilTest = gstate.isStencilTestEnabled();
+		if (id.stencilTest) {
+			id.stencilTestFunc = gstate.getStencilTestFunction();
+			id.sFail = gstate.getStencilOpSFail();
+			id.zFail = gstate.getStencilOpZFail();
+			id.zPass = gstate.getStencilOpZPass();
+		}
+
+		id.alphaBlend = gstate.isAlphaBlendEnabled();
+		if (id.alphaBlend) {
+			id.blendEq = gstate.getBlendEq();
+			id.blendSrc = gstate.getBlendFuncA();
+			id.blendDst = gstate.getBlendFuncB();
+		}
+
+		id.applyLogicOp = gstate.isLogicOpEnabled();
+		if (id.applyLogicOp)
+			id.logicOp = gstate.getLogicOp();
+	}
+
+	*id_out = id;
+}
+
+// NOTE: These likely aren't endian safe
+template <GEBufferFormat fbFormat>
+static inline u32 GetPixelColor(int x, int y) {
+	switch (fbFormat) {
+	case GE_FORMAT_565:
+		return RGB565ToRGBA8888(fb.Get16(x, y, gstate.FrameBufStride()));
+
+	case GE_FORMAT_5551:
+		return RGBA5551ToRGBA8888(fb.Get16(x, y, gstate.FrameBufStride()));
+
+	case GE_FORMAT_4444:
+		return RGBA4444ToRGBA8888(fb.Get16(x, y, gstate.FrameBufStride()));
+
+	case GE_FORMAT_8888:
+		return fb.Get32(x, y, gstate.FrameBufStride());
+
+	case GE_FORMAT_INVALID:
+		_dbg_assert_msg_(G3D, false, "Software: invalid framebuf format.");
+	}
+	return 0;
+}
+
+template <GEBufferFormat fbFormat>
+static inline void SetPixelColor(int x, int y, u32 value) {
+	switch (fbFormat) {
+	case GE_FORMAT_565:
+		fb.Set16(x, y, gstate.FrameBufStride(), RGBA8888ToRGB565(value));
+		break;
+
+	case GE_FORMAT_5551:
+		fb.Set16(x, y, gstate.FrameBufStride(), RGBA8888ToRGBA5551(value));
+		break;
+
+	case GE_FORMAT_4444:
+		fb.Set16(x, y, gstate.FrameBufStride(), RGBA8888ToRGBA4444(value));
+		break;
+
+	case GE_FORMAT_8888:
+		fb.Set32(x, y, gstate.FrameBufStride(), value);
+		break;
+
+	case GE_FORMAT_INVALID:
+		_dbg_assert_msg_(G3D, false, "Software: invalid framebuf format.");
+	}
+}
+
+static inline u16 GetPixelDepth(int x, int y) {
+	return depthbuf.Get16(x, y, gstate.DepthBufStride());
+}
+
+static inline void SetPixelDepth(int x, int y, u16 value) {
+	depthbuf.Set16(x, y, gstate.DepthBufStride(), value);
+}
+
+template <GEBufferFormat fbFormat>
+static inline u8 GetPixelStencil(int x, int y) {
+	if (fbFormat == GE_FORMAT_565) {
+		// Always treated as 0 for comparison purposes.
+		return 0;
+	} else if (fbFormat == GE_FORMAT_5551) {
+		return ((fb.Get16(x, y, gstate.FrameBufStride()) & 0x8000) != 0) ? 0xFF : 0;
+	} else if (fbFormat == GE_FORMAT_4444) {
+		return Convert4To8(fb.Get16(x, y, gstate.FrameBufStride()) >> 12);
+	} else {
+		return fb.Get32(x, y, gstate.FrameBufStride()) >> 24;
+	}
+}
+
+template <GEBufferFormat fbFormat>
+static inline void SetPixelStencil(int x, int y, u8 value) {
+	// TODO: This seems like it maybe respects the alpha mask (at least in some scenarios?)
+
+	if (fbFormat == GE_FORMAT_565) {
+		// Do nothing
+	} else if (fbFormat == GE_FORMAT_5551) {
+		u16 pixel = fb.Get16(x, y, gstate.FrameBufStride()) & ~0x8000;
+		pixel |= value != 0 ? 0x8000 : 0;
+		fb.Set16(x, y, gstate.FrameBufStride(), pixel);
+	} else if (fbFormat == GE_FORMAT_4444) {
+		u16 pixel = fb.Get16(x, y, gstate.FrameBufStride()) & ~0xF000;
+		pixel |= (u16)value << 12;
+		fb.Set16(x, y, gstate.FrameBufStride(), pixel);
+	} else {
+		u32 pixel = fb.Get32(x, y, gstate.FrameBufStride()) & ~0xFF000000;
+		pixel |= (u32)value << 24;
+		fb.Set32(x, y, gstate.FrameBufStride(), pixel);
+	}
+}
+
+static inline bool DepthTestPassed(GEComparison func, int x, int y, u16 z) {
+	u16 reference_z = GetPixelDepth(x, y);
+
+	switch (func) {
+	case GE_COMP_NEVER:
+		return false;
+
+	case GE_COMP_ALWAYS:
+		return true;
+
+	case GE_COMP_EQUAL:
+		return (z == reference_z);
+
+	case GE_COMP_NOTEQUAL:
+		return (z != reference_z);
+
+	case GE_COMP_LESS:
+		return (z < reference_z);
+
+	case GE_COMP_LEQUAL:
+		return (z <= reference_z);
+
+	case GE_COMP_GREATER:
+		return (z > reference_z);
+
+	case GE_COMP_GEQUAL:
+		return (z >= reference_z);
+
+	default:
+		return 0;
+	}
+}
+
+static inline bool StencilTestPassed(const PixelFuncID &pixelID, u8 stencil) {
+	// TODO: Does the masking logic make any sense?
+	stencil &= gstate.getStencilTestMask();
+	u8 ref = gstate.getStencilTestRef() & gstate.getStencilTestMask();
+	switch (GEComparison(pixelID.stencilTestFunc)) {
+	case GE_COMP_NEVER:
+		return false;
+
+	case GE_COMP_ALWAYS:
+		return true;
+
+	case GE_COMP_EQUAL:
+		return ref == stencil;
+
+	case GE_COMP_NOTEQUAL:
+		return ref != stencil;
+
+	case GE_COMP_LESS:
+		return ref < stencil;
+
+	case GE_COMP_LEQUAL:
+		return ref <= stencil;
+
+	case GE_COMP_GREATER:
+		return ref > stencil;
+
+	case GE_COMP_GEQUAL:
+		return ref >= stencil;
+	}
+	return true;
+}
+
+template <GEBufferFormat fbFormat>
+static inline u8 ApplyStencilOp(int op, u8 old_stencil) {
+	// TODO: Apply mask to reference or old stencil?
+	u8 reference_stencil = gstate.getStencilTestRef(); // TODO: Apply mask?
+	const u8 write_mask = gstate.getStencilWriteMask();
+
+	switch (op) {
+	case GE_STENCILOP_KEEP:
+		return old_stencil;
+
+	case GE_STENCILOP_ZERO:
+		return old_stencil & write_mask;
+
+	case GE_STENCILOP_REPLACE:
+		return (reference_stencil & ~write_mask) | (old_stencil & write_mask);
+
+	case GE_STENCILOP_INVERT:
+		return (~old_stencil & ~write_mask) | (old_stencil & write_mask);
+
+	case GE_STENCILOP_INCR:
+		switch (fbFormat) {
+		case GE_FORMAT_8888:
+			if (old_stencil != 0xFF) {
+				return ((old_stencil + 1) & ~write_mask) | (old_stencil & write_mask);
+			}
+			return old_stencil;
+		case GE_FORMAT_5551:
+			return ~write_mask | (old_stencil & write_mask);
+		case GE_FORMAT_4444:
+			if (old_stencil < 0xF0) {
+				return ((old_stencil + 0x10) & ~write_mask) | (old_stencil & write_mask);
+			}
+			return old_stencil;
+		default:
+			return old_stencil;
+		}
+		break;
+
+	case GE_STENCILOP_DECR:
+		switch (fbFormat) {
+		case GE_FORMAT_4444:
+			if (old_stencil >= 0x10)
+				return ((old_stencil - 0x10) & ~write_mask) | (old_stencil & write_mask);
+			break;
+		default:
+			if (old_stencil != 0)
+				return ((old_stencil - 1) & ~write_mask) | (old_stencil & write_mask);
+			return old_stencil;
+		}
+		break;
+	}
+
+	return old_stencil;
+}
+
+static inline u32 ApplyLogicOp(GELogicOp op, u32 old_color, u32 new_color) {
+	// All of the operations here intentionally preserve alpha/stencil.
+	switch (op) {
+	case GE_LOGIC_CLEAR:
+		new_color &= 0xFF000000;
+		break;
+
+	case GE_LOGIC_AND:
+		new_color = new_color & (old_color | 0xFF000000);
+		break;
+
+	case GE_LOGIC_AND_REVERSE:
+		new_color = new_color & (~old_color | 0xFF000000);
+		break;
+
+	case GE_LOGIC_COPY:
+		// No change to new_color.
+		break;
+
+	case GE_LOGIC_AND_INVERTED:
+		new_color = (~new_color & (old_color & 0x00FFFFFF)) | (new_color & 0xFF000000);
+		break;
+
+	case GE_LOGIC_NOOP:
+		new_color = (old_color & 0x00FFFFFF) | (new_color & 0xFF000000);
+		break;
+
+	case GE_LOGIC_XOR:
+		new_color = new_color ^ (old_color & 0x00FFFFFF);
+		break;
+
+	case GE_LOGIC_OR:
+		new_color = new_color | (old_color & 0x00FFFFFF);
+		break;
+
+	case GE_LOGIC_NOR:
+		new_color = (~(new_color | old_color) & 0x00FFFFFF) | (new_color & 0xFF000000);
+		break;
+
+	case GE_LOGIC_EQUIV:
+		new_color = (~(new_color ^ old_color) & 0x00FFFFFF) | (new_color & 0xFF000000);
+		break;
+
+	case GE_LOGIC_INVERTED:
+		new_color = (~old_color & 0x00FFFFFF) | (new_color & 0xFF000000);
+		break;
+
+	case GE_LOGIC_OR_REVERSE:
+		new_color = new_color | (~old_color & 0x00FFFFFF);
+		break;
+
+	case GE_LOGIC_COPY_INVERTED:
+		new_color = (~new_color & 0x00FFFFFF) | (new_color & 0xFF000000);
+		break;
+
+	case GE_LOGIC_OR_INVERTED:
+		new_color = ((~new_color | old_color) & 0x00FFFFFF) | (new_color & 0xFF000000);
+		break;
+
+	case GE_LOGIC_NAND:
+		new_color = (~(new_color & old_color) & 0x00FFFFFF) | (new_color & 0xFF000000);
+		break;
+
+	case GE_LOGIC_SET:
+		new_color |= 0x00FFFFFF;
+		break;
+	}
+
+	return new_color;
+}
+
+static inline bool ColorTestPassed(GEComparison func, const Vec3<int> &color) {
+	const u32 mask = gstate.getColorTestMask();
+	const u32 c = color.ToRGB() & mask;
+	const u32 ref = gstate.getColorTestRef() & mask;
+	switch (func) {
+	case GE_COMP_NEVER:
+		return false;
+
+	case GE_COMP_ALWAYS:
+		return true;
+
+	case GE_COMP_EQUAL:
+		return c == ref;
+
+	case GE_COMP_NOTEQUAL:
+		return c != ref;
+
+	default:
+		ERROR_LOG_REPORT(G3D, "Software: Invalid colortest function: %d", func);
+		break;
+	}
+	return true;
+}
+
+static inline bool AlphaTestPassed(GEComparison func, int alpha) {
+	const u8 mask = gstate.getAlphaTestMask() & 0xFF;
+	const u8 ref = gstate.getAlphaTestRef() & mask;
+	alpha &= mask;
+
+	switch (func) {
+	case GE_COMP_NEVER:
+		return false;
+
+	case GE_COMP_ALWAYS:
+		return true;
+
+	case GE_COMP_EQUAL:
+		return (alpha == ref);
+
+	case GE_COMP_NOTEQUAL:
+		return (alpha != ref);
+
+	case GE_COMP_LESS:
+		return (alpha < ref);
+
+	case GE_COMP_LEQUAL:
+		return (alpha <= ref);
+
+	case GE_COMP_GREATER:
+		return (alpha > ref);
+
+	case GE_COMP_GEQUAL:
+		return (alpha >= ref);
+	}
+	return true;
+}
+
+static inline Vec3<int> GetSourceFactor(GEBlendSrcFactor factor, const Vec4<int> &source, const Vec4<int> &dst) {
+	switch (factor) {
+	case GE_SRCBLEND_DSTCOLOR:
+		return dst.rgb();
+
+	case GE_SRCBLEND_INVDSTCOLOR:
+		return Vec3<int>::AssignToAll(255) - dst.rgb();
+
+	case GE_SRCBLEND_SRCALPHA:
+#if defined(_M_SSE)
+		return Vec3<int>(_mm_shuffle_epi32(source.ivec, _MM_SHUFFLE(3, 3, 3, 3)));
+#else
+		return Vec3<int>::AssignToAll(source.a());
+#endif
+
+	case GE_SRCBLEND_INVSRCALPHA:
+#if defined(_M_SSE)
+		return Vec3<int>(_mm_sub_epi32(_mm_set1_epi32(255), _mm_shuffle_epi32(source.ivec, _MM_SHUFFLE(3, 3, 3, 3))));
+#else
+		return Vec3<int>::AssignToAll(255 - source.a());
+#endif
+
+	case GE_SRCBLEND_DSTALPHA:
+		return Vec3<int>::AssignToAll(dst.a());
+
+	case GE_SRCBLEND_INVDSTALPHA:
+		return Vec3<int>::AssignToAll(255 - dst.a());
+
+	case GE_SRCBLEND_DOUBLESRCALPHA:
+		return Vec3<int>::AssignToAll(2 * source.a());
+
+	case GE_SRCBLEND_DOUBLEINVSRCALPHA:
+		return Vec3<int>::AssignToAll(255 - std::min(2 * source.a(), 255));
+
+	case GE_SRCBLEND_DOUBLEDSTALPHA:
+		return Vec3<int>::AssignToAll(2 * dst.a());
+
+	case GE_SRCBLEND_DOUBLEINVDSTALPHA:
+		return Vec3<int>::AssignToAll(255 - std::min(2 * dst.a(), 255));
+
+	case GE_SRCBLEND_FIXA:
+	default:
+		// All other dest factors (> 10) are treated as FIXA.
+		return Vec3<int>::FromRGB(gstate.getFixA());
+	}
+}
+
+static inline Vec3<int> GetDestFactor(GEBlendDstFactor factor, const Vec4<int> &source, const Vec4<int> &dst) {
+	switch (factor) {
+	case GE_DSTBLEND_SRCCOLOR:
+		return source.rgb();
+
+	case GE_DSTBLEND_INVSRCCOLOR:
+		return Vec3<int>::AssignToAll(255) - source.rgb();
+
+	case GE_DSTBLEND_SRCALPHA:
+#if defined(_M_SSE)
+		return Vec3<int>(_mm_shuffle_epi32(source.ivec, _MM_SHUFFLE(3, 3, 3, 3)));
+#else
+		return Vec3<int>::AssignToAll(source.a());
+#endif
+
+	case GE_DSTBLEND_INVSRCALPHA:
+#if defined(_M_SSE)
+		return Vec3<int>(_mm_sub_epi32(_mm_set1_epi32(255), _mm_shuffle_epi32(source.ivec, _MM_SHUFFLE(3, 3, 3, 3))));
+#else
+		return Vec3<int>::AssignToAll(255 - source.a());
+#endif
+
+	case GE_DSTBLEND_DSTALPHA:
+		return Vec3<int>::AssignToAll(dst.a());
+
+	case GE_DSTBLEND_INVDSTALPHA:
+		return Vec3<int>::AssignToAll(255 - dst.a());
+
+	case GE_DSTBLEND_DOUBLESRCALPHA:
+		return Vec3<int>::AssignToAll(2 * source.a());
+
+	case GE_DSTBLEND_DOUBLEINVSRCALPHA:
+		return Vec3<int>::AssignToAll(255 - std::min(2 * source.a(), 255));
+
+	case GE_DSTBLEND_DOUBLEDSTALPHA:
+		return Vec3<int>::AssignToAll(2 * dst.a());
+
+	case GE_DSTBLEND_DOUBLEINVDSTALPHA:
+		return Vec3<int>::AssignToAll(255 - std::min(2 * dst.a(), 255));
+
+	case GE_DSTBLEND_FIXB:
+	default:
+		// All other dest factors (> 10) are treated as FIXB.
+		return Vec3<int>::FromRGB(gstate.getFixB());
+	}
+}
+
+static Vec3<int> AlphaBlendingResult(const PixelFuncID &pixelID, const Vec4<int> &source, const Vec4<int> &dst) {
+	// Note: These factors cannot go below 0, but they can go above 255 when doubling.
+	Vec3<int> srcfactor = GetSourceFactor(GEBlendSrcFactor(pixelID.blendSrc), source, dst);
+	Vec3<int> dstfactor = GetDestFactor(GEBlendDstFactor(pixelID.blendDst), source, dst);
+
+	switch (GEBlendMode(pixelID.blendEq)) {
+	case GE_BLENDMODE_MUL_AND_ADD:
+	{
+#if defined(_M_SSE)
+		const __m128 s = _mm_mul_ps(_mm_cvtepi32_ps(source.ivec), _mm_cvtepi32_ps(srcfactor.ivec));
+		const __m128 d = _mm_mul_ps(_mm_cvtepi32_ps(dst.ivec), _mm_cvtepi32_ps(dstfactor.ivec));
+		return Vec3<int>(_mm_cvtps_epi32(_mm_mul_ps(_mm_add_ps(s, d), _mm_set_ps1(1.0f / 255.0f))));
+#else
+		return (source.rgb() * srcfactor + dst.rgb() * dstfactor) / 255;
+#endif
+	}
+
+	case GE_BLENDMODE_MUL_AND_SUBTRACT:
+	{
+#if defined(_M_SSE)
+		const __m128 s = _mm_mul_ps(_mm_cvtepi32_ps(source.ivec), _mm_cvtepi32_ps(srcfactor.ivec));
+		const __m128 d = _mm_mul_ps(_mm_cvtepi32_ps(dst.ivec), _mm_cvtepi32_ps(dstfactor.ivec));
+		return Vec3<int>(_mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(s, d), _mm_set_ps1(1.0f / 255.0f))));
+#else
+		return (source.rgb() * srcfactor - dst.rgb() * dstfactor) / 255;
+#endif
+	}
+
+	case GE_BLENDMODE_MUL_AND_SUBTRACT_REVERSE:
+	{
+#if defined(_M_SSE)
+		const __m128 s = _mm_mul_ps(_mm_cvtepi32_ps(source.ivec), _mm_cvtepi32_ps(srcfactor.ivec));
+		const __m128 d = _mm_mul_ps(_mm_cvtepi32_ps(dst.ivec), _mm_cvtepi32_ps(dstfactor.ivec));
+		return Vec3<int>(_mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(d, s), _mm_set_ps1(1.0f / 255.0f))));
+#else
+		return (dst.rgb() * dstfactor - source.rgb() * srcfactor) / 255;
+#endif
+	}
+
+	case GE_BLENDMODE_MIN:
+		return Vec3<int>(std::min(source.r(), dst.r()),
+						std::min(source.g(), dst.g()),
+						std::min(source.b(), dst.b()));
+
+	case GE_BLENDMODE_MAX:
+		return Vec3<int>(std::max(source.r(), dst.r()),
+						std::max(source.g(), dst.g()),
+						std::max(source.b(), dst.b()));
+
+	case GE_BLENDMODE_ABSDIFF:
+		return Vec3<int>(::abs(source.r() - dst.r()),
+						::abs(source.g() - dst.g()),
+						::abs(source.b() - dst.b()));
+
+	default:
+		ERROR_LOG_REPORT(G3D, "Software: Unknown blend function %x", pixelID.blendEq);
+		return Vec3<int>();
+	}
+}
+
+Vec3<int> AlphaBlendingResult(const Vec4<int> &source, const Vec4<int> &dst) {
+	PixelFuncID id;
+	id.blendEq = gstate.getBlendEq();
+	id.blendSrc = gstate.getBlendFuncA();
+	id.blendDst = gstate.getBlendFuncB();
+	return AlphaBlendingResult(id, source, dst);
+}
+
+// The generic version, used when the jit can't handle the state (or isn't available.)
+template <bool clearMode, GEBufferFormat fbFormat>
+static void DrawSinglePixel(int x, int y, int z, int fog, const Vec4<int> &color_in, const PixelFuncID &pixelID) {
+	Vec4<int> prim_color = color_in.Clamp(0, 255);
+	// Depth range test - applied in clear mode, if not through mode.
+	if (pixelID.applyDepthRange)
+		if (z < gstate.getDepthRangeMin() || z > gstate.getDepthRangeMax())
+			return;
+
+	if (pixelID.alphaTestFunc != GE_COMP_ALWAYS && !clearMode)
+		if (!AlphaTestPassed(GEComparison(pixelID.alphaTestFunc), prim_color.a()))
+			return;
+
+	// Fog is applied prior to color test.
+	if (pixelID.applyFog && !clearMode) {
+		Vec3<int> fogColor = Vec3<int>::FromRGB(gstate.fogcolor);
+		fogColor = (prim_color.rgb() * fog + fogColor * (255 - fog)) / 255;
+		prim_color.r() = fogColor.r();
+		prim_color.g() = fogColor.g();
+		prim_color.b() = fogColor.b();
+	}
+
+	if (pixelID.colorTestFunc != GE_COMP_ALWAYS && !clearMode)
+		if (!ColorTestPassed(GEComparison(pixelID.colorTestFunc), prim_color.rgb()))
+			return;
+
+	// In clear mode, it uses the alpha color as stencil.
+	u8 stencil = clearMode ? prim_color.a() : GetPixelStencil<fbFormat>(x, y);
+	if (clearMode) {
+		if (pixelID.depthWrite)
+			SetPixelDepth(x, y, z);
+	} else {
+		if (pixelID.stencilTest && !StencilTestPassed(pixelID, stencil)) {
+			stencil = ApplyStencilOp<fbFormat>(pixelID.sFail, stencil);
+			SetPixelStencil<fbFormat>(x, y, stencil);
+			return;
+		}
+
+		// Also apply depth at the same time.  If disabled, same as passing.
+		if (pixelID.depthTestFunc != GE_COMP_ALWAYS && !DepthTestPassed(GEComparison(pixelID.depthTestFunc), x, y, z)) {
+			if (pixelID.stencilTest) {
+				stencil = ApplyStencilOp<fbFormat>(pixelID.zFail, stencil);
+				SetPixelStencil<fbFormat>(x, y, stencil);
+			}
+			return;
+		} else if (pixelID.stencilTest) {
+			stencil = ApplyStencilOp<fbFormat>(pixelID.zPass, stencil);
+		}
+
+		if (pixelID.depthWrite) {
+			SetPixelDepth(x, y, z);
+		}
+	}
+
+	const u32 old_color = GetPixelColor<fbFormat>(x, y);
+	u32 new_color;
+
+	// Dithering happens before the logic op and regardless of framebuffer format or clear mode.
+	// We do it while alpha blending because it happens before clamping.
+	if (pixelID.alphaBlend && !clearMode) {
+		const Vec4<int> dst = Vec4<int>::FromRGBA(old_color);
+		Vec3<int> blended = AlphaBlendingResult(pixelID, prim_color, dst);
+		if (pixelID.dithering) {
+			blended += Vec3<int>::AssignToAll(gstate.getDitherValue(x, y));
+		}
+
+		// ToRGB() always automatically clamps.
+		new_color = blended.ToRGB();
+		new_color |= stencil << 24;
+	} else {
+		if (pixelID.dithering) {
+			// We'll discard alpha anyway.
+			prim_color += Vec4<int>::AssignToAll(gstate.getDitherValue(x, y));
+		}
+
+#if defined(_M_SSE)
+		new_color = Vec3<int>(prim_color.ivec).ToRGB();
+		new_color |= stencil << 24;
+#else
+		new_color = Vec4<int>(prim_color.r(), prim_color.g(), prim_color.b(), stencil).ToRGBA();
+#endif
+	}
+
+	// Logic ops are applied after blending (if blending is enabled.)
+	if (pixelID.applyLogicOp && !clearMode) {
+		// Logic ops don't affect stencil, which happens inside ApplyLogicOp.
+		new_color = ApplyLogicOp(GELogicOp(pixelID.logicOp), old_color, new_color);
+	}
+
+	if (clearMode) {
+		new_color = (new_color & ~gstate.getClearModeColorMask()) | (old_color & gstate.getClearModeColorMask());
+	}
+	if (pixelID.applyColorWriteMask) {
+		new_color = (new_color & ~gstate.getColorMask()) | (old_color & gstate.getColorMask());
+	}
+
+	SetPixelColor<fbFormat>(x, y, new_color);
+}
+
+template <bool clearMode>
+static SingleFunc GetSingleFallback(GEBufferFormat fbFormat) {
+	switch (fbFormat) {
+	case GE_FORMAT_565:
+		return &DrawSinglePixel<clearMode, GE_FORMAT_565>;
+	case GE_FORMAT_5551:
+		return &DrawSinglePixel<clearMode, GE_FORMAT_5551>;
+	case GE_FORMAT_4444:
+		return &DrawSinglePixel<clearMode, GE_FORMAT_4444>;
+	case GE_FORMAT_8888:
+	default:
+		return &DrawSinglePixel<clearMode, GE_FORMAT_8888>;
+	}
+}
+
+SingleFunc GetSingleFunc(const PixelFuncID &id) {
+	return jitCache->GetSingle(id);
+}
+
+PixelJitCache::PixelJitCache() {
+	// 256k should be plenty of space for plenty of variations.
+	AllocCodeSpace(1024 * 64 * 4);
+
+	// Add some random code to "help" MSVC's buggy disassembler :(
+#if defined(_WIN32) && (defined(_M_IX86) || defined(_M_X64))
+	using namespace Gen;
+	for (int i = 0; i < 100; i++) {
+		MOV(32, R(EAX), R(EBX));
+		RET();
+	}
+#elif defined(ARM)
+	BKPT(0);
+	BKPT(0);
+#endif
+}
+
+void PixelJitCache::Clear() {
+	ClearCodeSpace(0);
+	cache_.clear();
+	addresses_.clear();
+}
+
+std::string PixelJitCache::DescribePixelFuncID(const PixelFuncID &id) {
+	static const char *const comparisons[] = { "NEVER", "ALWAYS", "EQ", "NE", "LT", "LE", "GT", "GE" };
+	static const char *const formats[] = { "565", "5551", "4444", "8888" };
+
+	std::string name = formats[id.fbFormat];
+	if (id.clearMode)
+		name += ":CLEAR";
+	if (id.applyDepthRange)
+		name += ":DEPTHRANGE";
+	if (id.alphaTestFunc != GE_COMP_ALWAYS)
+		name += std::string(":ATEST_") + comparisons[id.alphaTestFunc];
+	if (id.applyFog)
+		name += ":FOG";
+	if (id.colorTestFunc != GE_COMP_ALWAYS)
+		name += std::string(":CTEST_") + comparisons[id.colorTestFunc];
+	if (id.stencilTest)
+		name += std::string(":STENCIL_") + comparisons[id.stencilTestFunc];
+	if (id.depthTestFunc != GE_COMP_ALWAYS)
+		name += std::string(":DTEST_") + comparisons[id.depthTestFunc];
+	if (id.depthWrite)
+		name += ":DEPTHWRITE";
+	if (id.alphaBlend)
+		name += StringFromFormat(":BLEND%d_%d_%d", id.blendEq, id.blendSrc, id.blendDst);
+	if (id.dithering)
+		name += ":DITHER";
+	if (id.applyLogicOp)
+		name += StringFromFormat(":LOGIC%d", id.logicOp);
+	if (id.applyColorWriteMask)
+		name += ":MASK";
+	return name;
+}
+
+std::string PixelJitCache::DescribeCodePtr(const u8 *ptr) {
+	ptrdiff_t dist = 0x7FFFFFFF;
+	PixelFuncID found{};
+	for (const auto &it : addresses_) {
+		ptrdiff_t it_dist = ptr - it.second;
+		if (it_dist >= 0 && it_dist < dist) {
+			found = it.first;
+			dist = it_dist;
+		}
+	}
+
+	return DescribePixelFuncID(found);
+}
+
+SingleFunc PixelJitCache::GetSingle(const PixelFuncID &id) {
+	std::lock_guard<std::mutex> guard(jitCacheLock);
+
+	auto it = cache_.find(id);
+	if (it != cache_.end()) {
+		return it->second;
+	}
+
+	// TODO: What should be the min size?  Can we even hit this?
+	if (GetSpaceLeft() < 16384) {
+		Clear();
+	}
+
+	SingleFunc func = nullptr;
+#ifdef _M_X64
+	const u8 *start = GetCodePointer();
+	func = CompileSingle(id);
+	if (func) {
+		addresses_[id] = start;
+		if (PerfMapEnabled())
+			PerfMapAddCode(start, GetCodePointer() - start, "Pixel " + DescribePixelFuncID(id));
+	}
+#endif
+
+	// Not all states can be jitted, so cache the fallback to skip trying again.
+	if (!func)
+		func = id.clearMode ? GetSingleFallback<true>(GEBufferFormat(id.fbFormat)) : GetSingleFallback<false>(GEBufferFormat(id.fbFormat));
+	cache_[id] = func;
+	return func;
+}
+
+};
@@ -0,0 +1,423 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include "ppsspp_config.h"
+#if PPSSPP_ARCH(AMD64)
+
+#include "Common/x64Emitter.h"
+#include "GPU/GPUState.h"
+#include "GPU/Software/DrawPixel.h"
+#include "GPU/Software/SoftGpu.h"
+#include "GPU/ge_constants.h"
+
+using namespace Gen;
+
+namespace Rasterizer {
+
+// After the prologue, registers are used like this.  All are volatile on both Win64 and POSIX.
+// Drawing coordinates are replaced with buffer pointers once they're computed.
+static const X64Reg xReg = R10;
+static const X64Reg fbPtrReg = R10;
+static const X64Reg yReg = R11;
+static const X64Reg depthPtrReg = R11;
+static const X64Reg zReg = RDX;
+static const X64Reg colorPtrReg = R8;
+static const X64Reg gstateReg = R9;
+static const X64Reg tempReg1 = RAX;
+static const X64Reg tempReg2 = RCX;
+static const X64Reg tempReg3 = R8;
+
+// Only XMM0-XMM5 are volatile on Win64.
+static const X64Reg srcColorReg = XMM0;
+static const X64Reg dstColorReg = XMM1;
+static const X64Reg srcFactorReg = XMM2;
+static const X64Reg dstFactorReg = XMM3;
+static const X64Reg fpScratchReg = XMM4;
+static const X64Reg ditherReg = XMM5;
+
+alignas(16) static const u32 const255[4] = { 255, 255, 255, 255, };
+alignas(16) static const u32 constZero[4] = { 0, 0, 0, 0, };
+alignas(16) static const float by255[4] = { 1.0f / 255.0f, 1.0f / 255.0f, 1.0f / 255.0f, 1.0f / 255.0f, };
+
+static int GStateOffset(const void *field) {
+	return (int)((const u8 *)field - (const u8 *)&gstate);
+}
+
+// The flags to jump on when "a func b" fails, after CMP(a, b).
+static CCFlags FailCondition(GEComparison func) {
+	switch (func) {
+	case GE_COMP_EQUAL: return CC_NE;
+	case GE_COMP_NOTEQUAL: return CC_E;
+	case GE_COMP_LESS: return CC_AE;
+	case GE_COMP_LEQUAL: return CC_A;
+	case GE_COMP_GREATER: return CC_BE;
+	case GE_COMP_GEQUAL: return CC_B;
+	default:
+		_assert_msg_(G3D, false, "Comparison should've been handled already");
+		return CC_NE;
+	}
+}
+
+SingleFunc PixelJitCache::CompileSingle(const PixelFuncID &id) {
+	// Anything not handled here uses the C++ version, which is still specialized somewhat.
+	if (id.fbFormat != GE_FORMAT_8888 || id.applyFog || id.colorTestFunc != GE_COMP_ALWAYS || id.stencilTest || id.applyLogicOp)
+		return nullptr;
+	if (id.alphaBlend && id.blendEq > GE_BLENDMODE_MUL_AND_SUBTRACT_REVERSE)
+		return nullptr;
+
+	BeginWrite();
+	const u8 *start = AlignCode16();
+	discards_.clear();
+
+	// POSIX: x=RDI, y=RSI, z=RDX, fog=RCX, color=R8, id=R9
+	// Win64: x=RCX, y=RDX, z=R8, fog=R9, color=stack+40, id=stack+48
+#ifdef _WIN32
+	MOV(32, R(xReg), R(RCX));
+	MOV(32, R(yReg), R(RDX));
+	MOV(32, R(zReg), R(R8));
+	MOV(64, R(colorPtrReg), MDisp(RSP, 40));
+#else
+	MOV(32, R(xReg), R(RDI));
+	MOV(32, R(yReg), R(RSI));
+#endif
+
+	// Clamp the color to 0-255, leaving it packed in the low 32 bits.
+	MOVDQU(srcColorReg, MatR(colorPtrReg));
+	PACKSSDW(srcColorReg, R(srcColorReg));
+	PACKUSWB(srcColorReg, R(srcColorReg));
+
+	MOV(PTRBITS, R(gstateReg), ImmPtr(&gstate));
+
+	bool success = true;
+	success = success && Jit_DepthRange(id);
+	success = success && Jit_AlphaTest(id);
+	success = success && Jit_Dither(id);
+	success = success && Jit_DepthTest(id);
+	success = success && Jit_AlphaBlend(id);
+	success = success && Jit_WriteColor(id);
+
+	if (!success) {
+		EndWrite();
+		SetCodePtr(const_cast<u8 *>(start));
+		return nullptr;
+	}
+
+	RET();
+
+	if (!discards_.empty()) {
+		for (FixupBranch &fixup : discards_)
+			SetJumpTarget(fixup);
+		RET();
+	}
+	discards_.clear();
+
+	EndWrite();
+	return (SingleFunc)start;
+}
+
+bool PixelJitCache::Jit_DepthRange(const PixelFuncID &id) {
+	if (!id.applyDepthRange)
+		return true;
+
+	MOVZX(32, 16, tempReg1, MDisp(gstateReg, GStateOffset(&gstate.minz)));
+	CMP(32, R(zReg), R(tempReg1));
+	discards_.push_back(J_CC(CC_B, true));
+	MOVZX(32, 16, tempReg1, MDisp(gstateReg, GStateOffset(&gstate.maxz)));
+	CMP(32, R(zReg), R(tempReg1));
+	discards_.push_back(J_CC(CC_A, true));
+	return true;
+}
+
+bool PixelJitCache::Jit_AlphaTest(const PixelFuncID &id) {
+	switch (GEComparison(id.alphaTestFunc)) {
+	case GE_COMP_ALWAYS:
+		return true;
+	case GE_COMP_NEVER:
+		discards_.push_back(J(true));
+		return true;
+	default:
+		break;
+	}
+
+	MOVD_xmm(R(tempReg1), srcColorReg);
+	SHR(32, R(tempReg1), Imm8(24));
+
+	// This leaves ref in the low 8 bits, and the mask above that.
+	MOV(32, R(tempReg2), MDisp(gstateReg, GStateOffset(&gstate.alphatest)));
+	SHR(32, R(tempReg2), Imm8(8));
+	MOV(32, R(tempReg3), R(tempReg2));
+	SHR(32, R(tempReg3), Imm8(8));
+	AND(32, R(tempReg3), Imm32(0xFF));
+
+	AND(32, R(tempReg1), R(tempReg3));
+	AND(32, R(tempReg2), R(tempReg3));
+	CMP(32, R(tempReg1), R(tempReg2));
+	discards_.push_back(J_CC(FailCondition(GEComparison(id.alphaTestFunc)), true));
+	return true;
+}
+
+bool PixelJitCache::Jit_Dither(const PixelFuncID &id) {
+	if (!id.dithering)
+		return true;
+
+	// Grab the row (dithmtx[y & 3]) and shift over to the column ((x & 3) * 4.)
+	MOV(32, R(tempReg1), R(yReg));
+	AND(32, R(tempReg1), Imm8(3));
+	MOV(32, R(tempReg1), MComplex(gstateReg, tempReg1, SCALE_4, GStateOffset(&gstate.dithmtx[0])));
+	MOV(32, R(RCX), R(xReg));
+	AND(32, R(RCX), Imm8(3));
+	SHL(32, R(RCX), Imm8(2));
+	SHR(32, R(tempReg1), R(CL));
+
+	// Now sign extend the low 4 bits, and broadcast to all lanes.
+	SHL(32, R(tempReg1), Imm8(28));
+	SAR(32, R(tempReg1), Imm8(28));
+	MOVD_xmm(ditherReg, R(tempReg1));
+	PSHUFD(ditherReg, R(ditherReg), _MM_SHUFFLE(0, 0, 0, 0));
+	return true;
+}
+
+bool PixelJitCache::Jit_DepthTest(const PixelFuncID &id) {
+	// Now we're done with x and y, so calculate the buffer pointers.
+	const bool useDepth = id.depthTestFunc != GE_COMP_ALWAYS || id.depthWrite;
+
+	MOV(32, R(tempReg1), MDisp(gstateReg, GStateOffset(&gstate.fbwidth)));
+	AND(32, R(tempReg1), Imm32(0x7FC));
+	IMUL(32, tempReg1, R(yReg));
+	ADD(32, R(tempReg1), R(xReg));
+	if (useDepth) {
+		MOV(32, R(tempReg2), MDisp(gstateReg, GStateOffset(&gstate.zbwidth)));
+		AND(32, R(tempReg2), Imm32(0x7FC));
+		IMUL(32, tempReg2, R(yReg));
+		ADD(32, R(tempReg2), R(xReg));
+
+		MOV(PTRBITS, R(depthPtrReg), ImmPtr(&depthbuf.data));
+		MOV(PTRBITS, R(depthPtrReg), MatR(depthPtrReg));
+		LEA(PTRBITS, depthPtrReg, MComplex(depthPtrReg, tempReg2, SCALE_2, 0));
+	}
+	MOV(PTRBITS, R(fbPtrReg), ImmPtr(&fb.data));
+	MOV(PTRBITS, R(fbPtrReg), MatR(fbPtrReg));
+	LEA(PTRBITS, fbPtrReg, MComplex(fbPtrReg, tempReg1, SCALE_4, 0));
+
+	switch (GEComparison(id.depthTestFunc)) {
+	case GE_COMP_ALWAYS:
+		break;
+	case GE_COMP_NEVER:
+		discards_.push_back(J(true));
+		break;
+	default:
+		MOVZX(32, 16, tempReg1, MatR(depthPtrReg));
+		CMP(32, R(zReg), R(tempReg1));
+		discards_.push_back(J_CC(FailCondition(GEComparison(id.depthTestFunc)), true));
+		break;
+	}
+
+	if (id.depthWrite)
+		MOV(16, MatR(depthPtrReg), R(zReg));
+	return true;
+}
+
+bool PixelJitCache::Jit_BlendFactor(X64Reg dest, int factor, bool isSrc) {
+	// The dst factors are the same as the src ones, just with src/dst color swapped.  Alpha isn't swapped.
+	const X64Reg colorReg = isSrc ? dstColorReg : srcColorReg;
+
+	auto doubleAlpha = [&](X64Reg reg, bool invert) {
+		PSHUFD(dest, R(reg), _MM_SHUFFLE(3, 3, 3, 3));
+		PSLLD(dest, 1);
+		if (invert) {
+			// 255 - min(2 * a, 255) is the same as max(255 - 2 * a, 0).
+			MOVDQA(fpScratchReg, R(dest));
+			MOVDQA(dest, M(const255));
+			PSUBD(dest, R(fpScratchReg));
+			MOVDQA(fpScratchReg, R(dest));
+			PCMPGTD(fpScratchReg, M(constZero));
+			PAND(dest, R(fpScratchReg));
+		}
+	};
+
+	switch (factor) {
+	case GE_SRCBLEND_DSTCOLOR:
+		MOVDQA(dest, R(colorReg));
+		break;
+
+	case GE_SRCBLEND_INVDSTCOLOR:
+		MOVDQA(dest, M(const255));
+		PSUBD(dest, R(colorReg));
+		break;
+
+	case GE_SRCBLEND_SRCALPHA:
+		PSHUFD(dest, R(srcColorReg), _MM_SHUFFLE(3, 3, 3, 3));
+		break;
+
+	case GE_SRCBLEND_INVSRCALPHA:
+		PSHUFD(fpScratchReg, R(srcColorReg), _MM_SHUFFLE(3, 3, 3, 3));
+		MOVDQA(dest, M(const255));
+		PSUBD(dest, R(fpScratchReg));
+		break;
+
+	case GE_SRCBLEND_DSTALPHA:
+		PSHUFD(dest, R(dstColorReg), _MM_SHUFFLE(3, 3, 3, 3));
+		break;
+
+	case GE_SRCBLEND_INVDSTALPHA:
+		PSHUFD(fpScratchReg, R(dstColorReg), _MM_SHUFFLE(3, 3, 3, 3));
+		MOVDQA(dest, M(const255));
+		PSUBD(dest, R(fpScratchReg));
+		break;
+
+	case GE_SRCBLEND_DOUBLESRCALPHA:
+		doubleAlpha(srcColorReg, false);
+		break;
+
+	case GE_SRCBLEND_DOUBLEINVSRCALPHA:
+		doubleAlpha(srcColorReg, true);
+		break;
+
+	case GE_SRCBLEND_DOUBLEDSTALPHA:
+		doubleAlpha(dstColorReg, false);
+		break;
+
+	case GE_SRCBLEND_DOUBLEINVDSTALPHA:
+		doubleAlpha(dstColorReg, true);
+		break;
+
+	case GE_SRCBLEND_FIXA:
+	default:
+		// All other factors (> 10) are treated as FIXA/FIXB.  The alpha lane is ignored.
+		MOVD_xmm(dest, MDisp(gstateReg, GStateOffset(isSrc ? &gstate.blendfixa : &gstate.blendfixb)));
+		PUNPCKLBW(dest, M(constZero));
+		PUNPCKLWD(dest, M(constZero));
+		break;
+	}
+	return true;
+}
+
+bool PixelJitCache::Jit_AlphaBlend(const PixelFuncID &id) {
+	if (!id.alphaBlend)
+		return true;
+
+	// Expand both colors to 32 bits per channel, like Vec4<int>::FromRGBA().
+	MOVD_xmm(dstColorReg, MatR(fbPtrReg));
+	PXOR(fpScratchReg, R(fpScratchReg));
+	PUNPCKLBW(dstColorReg, R(fpScratchReg));
+	PUNPCKLWD(dstColorReg, R(fpScratchReg));
+	PUNPCKLBW(srcColorReg, R(fpScratchReg));
+	PUNPCKLWD(srcColorReg, R(fpScratchReg));
+
+	if (!Jit_BlendFactor(srcFactorReg, id.blendSrc, true))
+		return false;
+	if (!Jit_BlendFactor(dstFactorReg, id.blendDst, false))
+		return false;
+
+	// Floats are accurate enough here, and match the C++ version exactly.
+	CVTDQ2PS(srcColorReg, R(srcColorReg));
+	CVTDQ2PS(srcFactorReg, R(srcFactorReg));
+	MULPS(srcColorReg, R(srcFactorReg));
+	CVTDQ2PS(dstColorReg, R(dstColorReg));
+	CVTDQ2PS(dstFactorReg, R(dstFactorReg));
+	MULPS(dstColorReg, R(dstFactorReg));
+
+	switch (GEBlendMode(id.blendEq)) {
+	case GE_BLENDMODE_MUL_AND_ADD:
+		ADDPS(srcColorReg, R(dstColorReg));
+		break;
+
+	case GE_BLENDMODE_MUL_AND_SUBTRACT:
+		SUBPS(srcColorReg, R(dstColorReg));
+		break;
+
+	case GE_BLENDMODE_MUL_AND_SUBTRACT_REVERSE:
+		SUBPS(dstColorReg, R(srcColorReg));
+		MOVAPS(srcColorReg, R(dstColorReg));
+		break;
+
+	default:
+		return false;
+	}
+
+	MULPS(srcColorReg, M(by255));
+	CVTPS2DQ(srcColorReg, R(srcColorReg));
+
+	// Dithering happens before clamping.
+	if (id.dithering)
+		PADDD(srcColorReg, R(ditherReg));
+
+	PACKSSDW(srcColorReg, R(srcColorReg));
+	PACKUSWB(srcColorReg, R(srcColorReg));
+	return true;
+}
+
+bool PixelJitCache::Jit_WriteColor(const PixelFuncID &id) {
+	// In clear mode, the alpha is used as stencil, and it's taken before dithering.
+	if (id.clearMode)
+		MOVD_xmm(R(tempReg3), srcColorReg);
+
+	if (id.dithering && !id.alphaBlend) {
+		MOVDQA(fpScratchReg, R(ditherReg));
+		PACKSSDW(fpScratchReg, R(fpScratchReg));
+		PXOR(dstColorReg, R(dstColorReg));
+		PUNPCKLBW(srcColorReg, R(dstColorReg));
+		PADDSW(srcColorReg, R(fpScratchReg));
+		PACKUSWB(srcColorReg, R(srcColorReg));
+	}
+
+	MOVD_xmm(R(tempReg2), srcColorReg);
+	if (id.clearMode) {
+		AND(32, R(tempReg2), Imm32(0x00FFFFFF));
+		AND(32, R(tempReg3), Imm32(0xFF000000));
+		OR(32, R(tempReg2), R(tempReg3));
+	}
+
+	// Now figure out which bits to keep from the old color.
+	XOR(32, R(tempReg1), R(tempReg1));
+	if (!id.clearMode) {
+		// Without a stencil test, stencil stays as it was.
+		OR(32, R(tempReg1), Imm32(0xFF000000));
+	} else {
+		TEST(32, MDisp(gstateReg, GStateOffset(&gstate.clearmode)), Imm32(0x100));
+		FixupBranch skipColor = J_CC(CC_NZ);
+		OR(32, R(tempReg1), Imm32(0x00FFFFFF));
+		SetJumpTarget(skipColor);
+		TEST(32, MDisp(gstateReg, GStateOffset(&gstate.clearmode)), Imm32(0x200));
+		FixupBranch skipAlpha = J_CC(CC_NZ);
+		OR(32, R(tempReg1), Imm32(0xFF000000));
+		SetJumpTarget(skipAlpha);
+	}
+
+	if (id.applyColorWriteMask) {
+		// We're done with depth, so we can reuse its pointer reg.
+		MOV(32, R(depthPtrReg), MDisp(gstateReg, GStateOffset(&gstate.pmskc)));
+		AND(32, R(depthPtrReg), Imm32(0x00FFFFFF));
+		OR(32, R(tempReg1), R(depthPtrReg));
+		MOV(32, R(depthPtrReg), MDisp(gstateReg, GStateOffset(&gstate.pmska)));
+		SHL(32, R(depthPtrReg), Imm8(24));
+		OR(32, R(tempReg1), R(depthPtrReg));
+	}
+
+	// result = old ^ ((new ^ old) & ~keep)
+	MOV(32, R(tempReg3), MatR(fbPtrReg));
+	XOR(32, R(tempReg2), R(tempReg3));
+	NOT(32, R(tempReg1));
+	AND(32, R(tempReg2), R(tempReg1));
+	XOR(32, R(tempReg2), R(tempReg3));
+	MOV(32, MatR(fbPtrReg), R(tempReg2));
+	return true;
+}
+
+};
+
+#endif
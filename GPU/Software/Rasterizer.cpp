@@ -17,6 +17,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <vector>
 
 #include "base/basictypes.h"
 #include "profiler/profiler.h"
@@ -30,9 +31,11 @@
 
 #include "GPU/Common/TextureCacheCommon.h"
 #include "GPU/Common/TextureDecoder.h"
+#include "GPU/Software/DrawPixel.h"
 #include "GPU/Software/SoftGpu.h"
 #include "GPU/Software/Rasterizer.h"
 #include "GPU/Software/Sampler.h"
+#include "GPU/Software/TexelCache.h"
 
 #if defined(_M_SSE)
 #include <emmintrin.h>
@@ -40,47 +43,6 @@
 
 namespace Rasterizer {
 
-// Only OK on x64 where our stack is aligned
-#if defined(_M_SSE) && !defined(_M_IX86)
-static inline __m128 Interpolate(const __m128 &c0, const __m128 &c1, const __m128 &c2, int w0, int w1, int w2, float wsum) {
-	__m128 v = _mm_mul_ps(c0, _mm_cvtepi32_ps(_mm_set1_epi32(w0)));
-	v = _mm_add_ps(v, _mm_mul_ps(c1, _mm_cvtepi32_ps(_mm_set1_epi32(w1))));
-	v = _mm_add_ps(v, _mm_mul_ps(c2, _mm_cvtepi32_ps(_mm_set1_epi32(w2))));
-	return _mm_mul_ps(v, _mm_set_ps1(wsum));
-}
-
-static inline __m128i Interpolate(const __m128i &c0, const __m128i &c1, const __m128i &c2, int w0, int w1, int w2, float wsum) {
-	return _mm_cvtps_epi32(Interpolate(_mm_cvtepi32_ps(c0), _mm_cvtepi32_ps(c1), _mm_cvtepi32_ps(c2), w0, w1, w2, wsum));
-}
-#endif
-
-// NOTE: When not casting color0 and color1 to float vectors, this code suffers from severe overflow issues.
-// Not sure if that should be regarded as a bug or if casting to float is a valid fix.
-
-static inline Vec4<int> Interpolate(const Vec4<int> &c0, const Vec4<int> &c1, const Vec4<int> &c2, int w0, int w1, int w2, float wsum) {
-#if defined(_M_SSE) && !defined(_M_IX86)
-	return Vec4<int>(Interpolate(c0.ivec, c1.ivec, c2.ivec, w0, w1, w2, wsum));
-#else
-	return ((c0.Cast<float>() * w0 + c1.Cast<float>() * w1 + c2.Cast<float>() * w2) * wsum).Cast<int>();
-#endif
-}
-
-static inline Vec3<int> Interpolate(const Vec3<int> &c0, const Vec3<int> &c1, const Vec3<int> &c2, int w0, int w1, int w2, float wsum) {
-#if defined(_M_SSE) && !defined(_M_IX86)
-	return Vec3<int>(Interpolate(c0.ivec, c1.ivec, c2.ivec, w0, w1, w2, wsum));
-#else
-	return ((c0.Cast<float>() * w0 + c1.Cast<float>() * w1 + c2.Cast<float>() * w2) * wsum).Cast<int>();
-#endif
-}
-
-static inline Vec2<float> Interpolate(const Vec2<float> &c0, const Vec2<float> &c1, const Vec2<float> &c2, int w0, int w1, int w2, float wsum) {
-#if defined(_M_SSE) && !defined(_M_IX86)
-	return Vec2<float>(Interpolate(c0.vec, c1.vec, c2.vec, w0, w1, w2, wsum));
-#else
-	return (c0 * w0 + c1 * w1 + c2 * w2) * wsum;
-#endif
-}
-
 static inline Vec4<float> Interpolate(const float &c0, const float &c1, const float &c2, const Vec4<float> &w0, const Vec4<float> &w1, const Vec4<float> &w2, const Vec4<float> &wsum_recip) {
 #if defined(_M_SSE) && !defined(_M_IX86)
 	__m128 v = _mm_mul_ps(w0.vec, _mm_set1_ps(c0));
@@ -92,8 +54,26 @@ static inline Vec4<float> Interpolate(const float &c0, const float &c1, const fl
 #endif
 }
 
-static inline Vec4<float> Interpolate(const float &c0, const float &c1, const float &c2, const Vec4<int> &w0, const Vec4<int> &w1, const Vec4<int> &w2, const Vec4<float> &wsum_recip) {
-	return Interpolate(c0, c1, c2, w0.Cast<float>(), w1.Cast<float>(), w2.Cast<float>(), wsum_recip);
+// Interpolates a vector for each pixel of a quad.  The colors are converted to float once per triangle.
+// NOTE: When not casting the colors to float vectors, this suffers from severe overflow issues.
+static inline void InterpolateQuad(Vec4<int> out[4], const Vec4<float> &c0, const Vec4<float> &c1, const Vec4<float> &c2, const Vec4<float> &w0, const Vec4<float> &w1, const Vec4<float> &w2, const Vec4<float> &wsum_recip) {
+#if defined(_M_SSE) && !defined(_M_IX86)
+#define INTERPOLATE_LANE(i) { \
+		__m128 v = _mm_mul_ps(c0.vec, _mm_shuffle_ps(w0.vec, w0.vec, _MM_SHUFFLE(i, i, i, i))); \
+		v = _mm_add_ps(v, _mm_mul_ps(c1.vec, _mm_shuffle_ps(w1.vec, w1.vec, _MM_SHUFFLE(i, i, i, i)))); \
+		v = _mm_add_ps(v, _mm_mul_ps(c2.vec, _mm_shuffle_ps(w2.vec, w2.vec, _MM_SHUFFLE(i, i, i, i)))); \
+		out[i].ivec = _mm_cvtps_epi32(_mm_mul_ps(v, _mm_shuffle_ps(wsum_recip.vec, wsum_recip.vec, _MM_SHUFFLE(i, i, i, i)))); \
+	}
+	INTERPOLATE_LANE(0);
+	INTERPOLATE_LANE(1);
+	INTERPOLATE_LANE(2);
+	INTERPOLATE_LANE(3);
+#undef INTERPOLATE_LANE
+#else
+	for (int i = 0; i < 4; ++i) {
+		out[i] = ((c0 * w0[i] + c1 * w1[i] + c2 * w2[i]) * wsum_recip[i]).Cast<int>();
+	}
+#endif
 }
 
 static inline u8 ClampFogDepth(float fogdepth) {
@@ -221,7 +201,8 @@ static inline void GetTextureCoordinates(const VertexData& v0, const VertexData&
 	}
 }
 
-static inline void GetTextureCoordinates(const VertexData& v0, const VertexData& v1, const VertexData& v2, const Vec4<int> &w0, const Vec4<int> &w1, const Vec4<int> &w2, const Vec4<float> &wsum_recip, Vec4<float> &s, Vec4<float> &t)
+// q0-q2 are 1 / clippos.w for each vertex, which only needs to be computed once per triangle.
+static inline void GetTextureCoordinates(const VertexData& v0, const VertexData& v1, const VertexData& v2, const Vec4<float> &w0, const Vec4<float> &w1, const Vec4<float> &w2, float q0, float q1, float q2, Vec4<float> &s, Vec4<float> &t)
 {
 	switch (gstate.getUVGenMode()) {
 	case GE_TEXMAP_TEXTURE_COORDS:
@@ -231,12 +212,9 @@ static inline void GetTextureCoordinates(const VertexData& v0, const VertexData&
 		{
 			// TODO: What happens if vertex has no texture coordinates?
 			// Note that for environment mapping, texture coordinates have been calculated during lighting
-			float q0 = 1.f / v0.clippos.w;
-			float q1 = 1.f / v1.clippos.w;
-			float q2 = 1.f / v2.clippos.w;
-			Vec4<float> wq0 = w0.Cast<float>() * q0;
-			Vec4<float> wq1 = w1.Cast<float>() * q1;
-			Vec4<float> wq2 = w2.Cast<float>() * q2;
+			Vec4<float> wq0 = w0 * q0;
+			Vec4<float> wq1 = w1 * q1;
+			Vec4<float> wq2 = w2 * q2;
 
 			Vec4<float> q_recip = (wq0 + wq1 + wq2).Reciprocal();
 			s = Interpolate(v0.texturecoords.s(), v1.texturecoords.s(), v2.texturecoords.s(), wq0, wq1, wq2, q_recip);
@@ -251,57 +229,6 @@ static inline void GetTextureCoordinates(const VertexData& v0, const VertexData&
 	}
 }
 
-// NOTE: These likely aren't endian safe
-static inline u32 GetPixelColor(int x, int y)
-{
-	switch (gstate.FrameBufFormat()) {
-	case GE_FORMAT_565:
-		return RGB565ToRGBA8888(fb.Get16(x, y, gstate.FrameBufStride()));
-
-	case GE_FORMAT_5551:
-		return RGBA5551ToRGBA8888(fb.Get16(x, y, gstate.FrameBufStride()));
-
-	case GE_FORMAT_4444:
-		return RGBA4444ToRGBA8888(fb.Get16(x, y, gstate.FrameBufStride()));
-
-	case GE_FORMAT_8888:
-		return fb.Get32(x, y, gstate.FrameBufStride());
-
-	case GE_FORMAT_INVALID:
-		_dbg_assert_msg_(G3D, false, "Software: invalid framebuf format.");
-	}
-	return 0;
-}
-
-static inline void SetPixelColor(int x, int y, u32 value)
-{
-	switch (gstate.FrameBufFormat()) {
-	case GE_FORMAT_565:
-		fb.Set16(x, y, gstate.FrameBufStride(), RGBA8888ToRGB565(value));
-		break;
-
-	case GE_FORMAT_5551:
-		fb.Set16(x, y, gstate.FrameBufStride(), RGBA8888ToRGBA5551(value));
-		break;
-
-	case GE_FORMAT_4444:
-		fb.Set16(x, y, gstate.FrameBufStride(), RGBA8888ToRGBA4444(value));
-		break;
-
-	case GE_FORMAT_8888:
-		fb.Set32(x, y, gstate.FrameBufStride(), value);
-		break;
-
-	case GE_FORMAT_INVALID:
-		_dbg_assert_msg_(G3D, false, "Software: invalid framebuf format.");
-	}
-}
-
-static inline u16 GetPixelDepth(int x, int y)
-{
-	return depthbuf.Get16(x, y, gstate.DepthBufStride());
-}
-
 static inline void SetPixelDepth(int x, int y, u16 value)
 {
 	depthbuf.Set16(x, y, gstate.DepthBufStride(), value);
@@ -321,61 +248,6 @@ static inline u8 GetPixelStencil(int x, int y)
 	}
 }
 
-static inline void SetPixelStencil(int x, int y, u8 value)
-{
-	// TODO: This seems like it maybe respects the alpha mask (at least in some scenarios?)
-
-	if (gstate.FrameBufFormat() == GE_FORMAT_565) {
-		// Do nothing
-	} else if (gstate.FrameBufFormat() == GE_FORMAT_5551) {
-		u16 pixel = fb.Get16(x, y, gstate.FrameBufStride()) & ~0x8000;
-		pixel |= value != 0 ? 0x8000 : 0;
-		fb.Set16(x, y, gstate.FrameBufStride(), pixel);
-	} else if (gstate.FrameBufFormat() == GE_FORMAT_4444) {
-		u16 pixel = fb.Get16(x, y, gstate.FrameBufStride()) & ~0xF000;
-		pixel |= (u16)value << 12;
-		fb.Set16(x, y, gstate.FrameBufStride(), pixel);
-	} else {
-		u32 pixel = fb.Get32(x, y, gstate.FrameBufStride()) & ~0xFF000000;
-		pixel |= (u32)value << 24;
-		fb.Set32(x, y, gstate.FrameBufStride(), pixel);
-	}
-}
-
-static inline bool DepthTestPassed(int x, int y, u16 z)
-{
-	u16 reference_z = GetPixelDepth(x, y);
-
-	switch (gstate.getDepthTestFunction()) {
-	case GE_COMP_NEVER:
-		return false;
-
-	case GE_COMP_ALWAYS:
-		return true;
-
-	case GE_COMP_EQUAL:
-		return (z == reference_z);
-
-	case GE_COMP_NOTEQUAL:
-		return (z != reference_z);
-
-	case GE_COMP_LESS:
-		return (z < reference_z);
-
-	case GE_COMP_LEQUAL:
-		return (z <= reference_z);
-
-	case GE_COMP_GREATER:
-		return (z > reference_z);
-
-	case GE_COMP_GEQUAL:
-		return (z >= reference_z);
-
-	default:
-		return 0;
-	}
-}
-
 static inline bool IsRightSideOrFlatBottomLine(const Vec2<int>& vertex, const Vec2<int>& line1, const Vec2<int>& line2)
 {
 	if (line1.y == line2.y) {
@@ -387,164 +259,6 @@ static inline bool IsRightSideOrFlatBottomLine(const Vec2<int>& vertex, const Ve
 	}
 }
 
-static inline bool StencilTestPassed(u8 stencil)
-{
-	// TODO: Does the masking logic make any sense?
-	stencil &= gstate.getStencilTestMask();
-	u8 ref = gstate.getStencilTestRef() & gstate.getStencilTestMask();
-	switch (gstate.getStencilTestFunction()) {
-		case GE_COMP_NEVER:
-			return false;
-
-		case GE_COMP_ALWAYS:
-			return true;
-
-		case GE_COMP_EQUAL:
-			return ref == stencil;
-
-		case GE_COMP_NOTEQUAL:
-			return ref != stencil;
-
-		case GE_COMP_LESS:
-			return ref < stencil;
-
-		case GE_COMP_LEQUAL:
-			return ref <= stencil;
-
-		case GE_COMP_GREATER:
-			return ref > stencil;
-
-		case GE_COMP_GEQUAL:
-			return ref >= stencil;
-	}
-	return true;
-}
-
-static inline u8 ApplyStencilOp(int op, u8 old_stencil) {
-	// TODO: Apply mask to reference or old stencil?
-	u8 reference_stencil = gstate.getStencilTestRef(); // TODO: Apply mask?
-	const u8 write_mask = gstate.getStencilWriteMask();
-
-	switch (op) {
-		case GE_STENCILOP_KEEP:
-			return old_stencil;
-
-		case GE_STENCILOP_ZERO:
-			return old_stencil & write_mask;
-
-		case GE_STENCILOP_REPLACE:
-			return (reference_stencil & ~write_mask) | (old_stencil & write_mask);
-
-		case GE_STENCILOP_INVERT:
-			return (~old_stencil & ~write_mask) | (old_stencil & write_mask);
-
-		case GE_STENCILOP_INCR:
-			switch (gstate.FrameBufFormat()) {
-			case GE_FORMAT_8888:
-				if (old_stencil != 0xFF) {
-					return ((old_stencil + 1) & ~write_mask) | (old_stencil & write_mask);
-				}
-				return old_stencil;
-			case GE_FORMAT_5551:
-				return ~write_mask | (old_stencil & write_mask);
-			case GE_FORMAT_4444:
-				if (old_stencil < 0xF0) {
-					return ((old_stencil + 0x10) & ~write_mask) | (old_stencil & write_mask);
-				}
-				return old_stencil;
-			default:
-				return old_stencil;
-			}
-			break;
-
-		case GE_STENCILOP_DECR:
-			switch (gstate.FrameBufFormat()) {
-			case GE_FORMAT_4444:
-				if (old_stencil >= 0x10)
-					return ((old_stencil - 0x10) & ~write_mask) | (old_stencil & write_mask);
-				break;
-			default:
-				if (old_stencil != 0)
-					return ((old_stencil - 1) & ~write_mask) | (old_stencil & write_mask);
-				return old_stencil;
-			}
-			break;
-	}
-
-	return old_stencil;
-}
-
-static inline u32 ApplyLogicOp(GELogicOp op, u32 old_color, u32 new_color) {
-	// All of the operations here intentionally preserve alpha/stencil.
-	switch (op) {
-	case GE_LOGIC_CLEAR:
-		new_color &= 0xFF000000;
-		break;
-
-	case GE_LOGIC_AND:
-		new_color = new_color & (old_color | 0xFF000000);
-		break;
-
-	case GE_LOGIC_AND_REVERSE:
-		new_color = new_color & (~old_color | 0xFF000000);
-		break;
-
-	case GE_LOGIC_COPY:
-		// No change to new_color.
-		break;
-
-	case GE_LOGIC_AND_INVERTED:
-		new_color = (~new_color & (old_color & 0x00FFFFFF)) | (new_color & 0xFF000000);
-		break;
-
-	case GE_LOGIC_NOOP:
-		new_color = (old_color & 0x00FFFFFF) | (new_color & 0xFF000000);
-		break;
-
-	case GE_LOGIC_XOR:
-		new_color = new_color ^ (old_color & 0x00FFFFFF);
-		break;
-
-	case GE_LOGIC_OR:
-		new_color = new_color | (old_color & 0x00FFFFFF);
-		break;
-
-	case GE_LOGIC_NOR:
-		new_color = (~(new_color | old_color) & 0x00FFFFFF) | (new_color & 0xFF000000);
-		break;
-
-	case GE_LOGIC_EQUIV:
-		new_color = (~(new_color ^ old_color) & 0x00FFFFFF) | (new_color & 0xFF000000);
-		break;
-
-	case GE_LOGIC_INVERTED:
-		new_color = (~old_color & 0x00FFFFFF) | (new_color & 0xFF000000);
-		break;
-
-	case GE_LOGIC_OR_REVERSE:
-		new_color = new_color | (~old_color & 0x00FFFFFF);
-		break;
-
-	case GE_LOGIC_COPY_INVERTED:
-		new_color = (~new_color & 0x00FFFFFF) | (new_color & 0xFF000000);
-		break;
-
-	case GE_LOGIC_OR_INVERTED:
-		new_color = ((~new_color | old_color) & 0x00FFFFFF) | (new_color & 0xFF000000);
-		break;
-
-	case GE_LOGIC_NAND:
-		new_color = (~(new_color & old_color) & 0x00FFFFFF) | (new_color & 0xFF000000);
-		break;
-
-	case GE_LOGIC_SET:
-		new_color |= 0x00FFFFFF;
-		break;
-	}
-
-	return new_color;
-}
-
 Vec4<int> GetTextureFunctionOutput(const Vec4<int>& prim_color, const Vec4<int>& texcolor)
 {
 	Vec3<int> out_rgb;
@@ -624,332 +338,17 @@ Vec4<int> GetTextureFunctionOutput(const Vec4<int>& prim_color, const Vec4<int>&
 	return Vec4<int>(out_rgb.r(), out_rgb.g(), out_rgb.b(), out_a);
 }
 
-static inline bool ColorTestPassed(const Vec3<int> &color)
-{
-	const u32 mask = gstate.getColorTestMask();
-	const u32 c = color.ToRGB() & mask;
-	const u32 ref = gstate.getColorTestRef() & mask;
-	switch (gstate.getColorTestFunction()) {
-		case GE_COMP_NEVER:
-			return false;
-
-		case GE_COMP_ALWAYS:
-			return true;
-
-		case GE_COMP_EQUAL:
-			return c == ref;
-
-		case GE_COMP_NOTEQUAL:
-			return c != ref;
-
-		default:
-			ERROR_LOG_REPORT(G3D, "Software: Invalid colortest function: %d", gstate.getColorTestFunction());
-			break;
-	}
-	return true;
-}
-
-static inline bool AlphaTestPassed(int alpha)
-{
-	const u8 mask = gstate.getAlphaTestMask() & 0xFF;
-	const u8 ref = gstate.getAlphaTestRef() & mask;
-	alpha &= mask;
-
-	switch (gstate.getAlphaTestFunction()) {
-		case GE_COMP_NEVER:
-			return false;
-
-		case GE_COMP_ALWAYS:
-			return true;
-
-		case GE_COMP_EQUAL:
-			return (alpha == ref);
-
-		case GE_COMP_NOTEQUAL:
-			return (alpha != ref);
-
-		case GE_COMP_LESS:
-			return (alpha < ref);
-
-		case GE_COMP_LEQUAL:
-			return (alpha <= ref);
-
-		case GE_COMP_GREATER:
-			return (alpha > ref);
-
-		case GE_COMP_GEQUAL:
-			return (alpha >= ref);
-	}
-	return true;
-}
-
-static inline Vec3<int> GetSourceFactor(const Vec4<int>& source, const Vec4<int>& dst)
-{
-	switch (gstate.getBlendFuncA()) {
-	case GE_SRCBLEND_DSTCOLOR:
-		return dst.rgb();
-
-	case GE_SRCBLEND_INVDSTCOLOR:
-		return Vec3<int>::AssignToAll(255) - dst.rgb();
-
-	case GE_SRCBLEND_SRCALPHA:
-#if defined(_M_SSE)
-		return Vec3<int>(_mm_shuffle_epi32(source.ivec, _MM_SHUFFLE(3, 3, 3, 3)));
-#else
-		return Vec3<int>::AssignToAll(source.a());
-#endif
-
-	case GE_SRCBLEND_INVSRCALPHA:
-#if defined(_M_SSE)
-		return Vec3<int>(_mm_sub_epi32(_mm_set1_epi32(255), _mm_shuffle_epi32(source.ivec, _MM_SHUFFLE(3, 3, 3, 3))));
-#else
-		return Vec3<int>::AssignToAll(255 - source.a());
-#endif
-
-	case GE_SRCBLEND_DSTALPHA:
-		return Vec3<int>::AssignToAll(dst.a());
-
-	case GE_SRCBLEND_INVDSTALPHA:
-		return Vec3<int>::AssignToAll(255 - dst.a());
-
-	case GE_SRCBLEND_DOUBLESRCALPHA:
-		return Vec3<int>::AssignToAll(2 * source.a());
-
-	case GE_SRCBLEND_DOUBLEINVSRCALPHA:
-		return Vec3<int>::AssignToAll(255 - std::min(2 * source.a(), 255));
-
-	case GE_SRCBLEND_DOUBLEDSTALPHA:
-		return Vec3<int>::AssignToAll(2 * dst.a());
-
-	case GE_SRCBLEND_DOUBLEINVDSTALPHA:
-		return Vec3<int>::AssignToAll(255 - std::min(2 * dst.a(), 255));
-
-	case GE_SRCBLEND_FIXA:
-	default:
-		// All other dest factors (> 10) are treated as FIXA.
-		return Vec3<int>::FromRGB(gstate.getFixA());
-	}
-}
-
-static inline Vec3<int> GetDestFactor(const Vec4<int>& source, const Vec4<int>& dst)
-{
-	switch (gstate.getBlendFuncB()) {
-	case GE_DSTBLEND_SRCCOLOR:
-		return source.rgb();
-
-	case GE_DSTBLEND_INVSRCCOLOR:
-		return Vec3<int>::AssignToAll(255) - source.rgb();
-
-	case GE_DSTBLEND_SRCALPHA:
-#if defined(_M_SSE)
-		return Vec3<int>(_mm_shuffle_epi32(source.ivec, _MM_SHUFFLE(3, 3, 3, 3)));
-#else
-		return Vec3<int>::AssignToAll(source.a());
-#endif
-
-	case GE_DSTBLEND_INVSRCALPHA:
-#if defined(_M_SSE)
-		return Vec3<int>(_mm_sub_epi32(_mm_set1_epi32(255), _mm_shuffle_epi32(source.ivec, _MM_SHUFFLE(3, 3, 3, 3))));
-#else
-		return Vec3<int>::AssignToAll(255 - source.a());
-#endif
-
-	case GE_DSTBLEND_DSTALPHA:
-		return Vec3<int>::AssignToAll(dst.a());
-
-	case GE_DSTBLEND_INVDSTALPHA:
-		return Vec3<int>::AssignToAll(255 - dst.a());
-
-	case GE_DSTBLEND_DOUBLESRCALPHA:
-		return Vec3<int>::AssignToAll(2 * source.a());
-
-	case GE_DSTBLEND_DOUBLEINVSRCALPHA:
-		return Vec3<int>::AssignToAll(255 - std::min(2 * source.a(), 255));
-
-	case GE_DSTBLEND_DOUBLEDSTALPHA:
-		return Vec3<int>::AssignToAll(2 * dst.a());
-
-	case GE_DSTBLEND_DOUBLEINVDSTALPHA:
-		return Vec3<int>::AssignToAll(255 - std::min(2 * dst.a(), 255));
-
-	case GE_DSTBLEND_FIXB:
-	default:
-		// All other dest factors (> 10) are treated as FIXB.
-		return Vec3<int>::FromRGB(gstate.getFixB());
-	}
-}
-
-// Removed inline here - it was never chosen to be inlined by the compiler anyway, too complex.
-Vec3<int> AlphaBlendingResult(const Vec4<int> &source, const Vec4<int> &dst)
-{
-	// Note: These factors cannot go below 0, but they can go above 255 when doubling.
-	Vec3<int> srcfactor = GetSourceFactor(source, dst);
-	Vec3<int> dstfactor = GetDestFactor(source, dst);
-
-	switch (gstate.getBlendEq()) {
-	case GE_BLENDMODE_MUL_AND_ADD:
-	{
-#if defined(_M_SSE)
-		const __m128 s = _mm_mul_ps(_mm_cvtepi32_ps(source.ivec), _mm_cvtepi32_ps(srcfactor.ivec));
-		const __m128 d = _mm_mul_ps(_mm_cvtepi32_ps(dst.ivec), _mm_cvtepi32_ps(dstfactor.ivec));
-		return Vec3<int>(_mm_cvtps_epi32(_mm_mul_ps(_mm_add_ps(s, d), _mm_set_ps1(1.0f / 255.0f))));
-#else
-		return (source.rgb() * srcfactor + dst.rgb() * dstfactor) / 255;
-#endif
-	}
-
-	case GE_BLENDMODE_MUL_AND_SUBTRACT:
-	{
-#if defined(_M_SSE)
-		const __m128 s = _mm_mul_ps(_mm_cvtepi32_ps(source.ivec), _mm_cvtepi32_ps(srcfactor.ivec));
-		const __m128 d = _mm_mul_ps(_mm_cvtepi32_ps(dst.ivec), _mm_cvtepi32_ps(dstfactor.ivec));
-		return Vec3<int>(_mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(s, d), _mm_set_ps1(1.0f / 255.0f))));
-#else
-		return (source.rgb() * srcfactor - dst.rgb() * dstfactor) / 255;
-#endif
-	}
-
-	case GE_BLENDMODE_MUL_AND_SUBTRACT_REVERSE:
-	{
-#if defined(_M_SSE)
-		const __m128 s = _mm_mul_ps(_mm_cvtepi32_ps(source.ivec), _mm_cvtepi32_ps(srcfactor.ivec));
-		const __m128 d = _mm_mul_ps(_mm_cvtepi32_ps(dst.ivec), _mm_cvtepi32_ps(dstfactor.ivec));
-		return Vec3<int>(_mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(d, s), _mm_set_ps1(1.0f / 255.0f))));
-#else
-		return (dst.rgb() * dstfactor - source.rgb() * srcfactor) / 255;
-#endif
-	}
-
-	case GE_BLENDMODE_MIN:
-		return Vec3<int>(std::min(source.r(), dst.r()),
-						std::min(source.g(), dst.g()),
-						std::min(source.b(), dst.b()));
-
-	case GE_BLENDMODE_MAX:
-		return Vec3<int>(std::max(source.r(), dst.r()),
-						std::max(source.g(), dst.g()),
-						std::max(source.b(), dst.b()));
-
-	case GE_BLENDMODE_ABSDIFF:
-		return Vec3<int>(::abs(source.r() - dst.r()),
-						::abs(source.g() - dst.g()),
-						::abs(source.b() - dst.b()));
-
-	default:
-		ERROR_LOG_REPORT(G3D, "Software: Unknown blend function %x", gstate.getBlendEq());
-		return Vec3<int>();
-	}
-}
-
-template <bool clearMode>
-inline void DrawSinglePixel(const DrawingCoords &p, u16 z, u8 fog, const Vec4<int> &color_in) {
-	Vec4<int> prim_color = color_in.Clamp(0, 255);
-	// Depth range test - applied in clear mode, if not through mode.
-	if (!gstate.isModeThrough())
-		if (z < gstate.getDepthRangeMin() || z > gstate.getDepthRangeMax())
-			return;
-
-	if (gstate.isAlphaTestEnabled() && !clearMode)
-		if (!AlphaTestPassed(prim_color.a()))
-			return;
-
-	// Fog is applied prior to color test.
-	if (gstate.isFogEnabled() && !gstate.isModeThrough() && !clearMode) {
-		Vec3<int> fogColor = Vec3<int>::FromRGB(gstate.fogcolor);
-		fogColor = (prim_color.rgb() * (int)fog + fogColor * (255 - (int)fog)) / 255;
-		prim_color.r() = fogColor.r();
-		prim_color.g() = fogColor.g();
-		prim_color.b() = fogColor.b();
-	}
-
-	if (gstate.isColorTestEnabled() && !clearMode)
-		if (!ColorTestPassed(prim_color.rgb()))
-			return;
-
-	// In clear mode, it uses the alpha color as stencil.
-	u8 stencil = clearMode ? prim_color.a() : GetPixelStencil(p.x, p.y);
-	if (!clearMode && (gstate.isStencilTestEnabled() || gstate.isDepthTestEnabled())) {
-		if (gstate.isStencilTestEnabled() && !StencilTestPassed(stencil)) {
-			stencil = ApplyStencilOp(gstate.getStencilOpSFail(), stencil);
-			SetPixelStencil(p.x, p.y, stencil);
-			return;
-		}
-
-		// Also apply depth at the same time.  If disabled, same as passing.
-		if (gstate.isDepthTestEnabled() && !DepthTestPassed(p.x, p.y, z)) {
-			if (gstate.isStencilTestEnabled()) {
-				stencil = ApplyStencilOp(gstate.getStencilOpZFail(), stencil);
-				SetPixelStencil(p.x, p.y, stencil);
-			}
-			return;
-		} else if (gstate.isStencilTestEnabled()) {
-			stencil = ApplyStencilOp(gstate.getStencilOpZPass(), stencil);
-		}
-
-		if (gstate.isDepthTestEnabled() && gstate.isDepthWriteEnabled()) {
-			SetPixelDepth(p.x, p.y, z);
-		}
-	} else if (clearMode && gstate.isClearModeDepthMask()) {
-		SetPixelDepth(p.x, p.y, z);
-	}
-
-	const u32 old_color = GetPixelColor(p.x, p.y);
-	u32 new_color;
-
-	// Dithering happens before the logic op and regardless of framebuffer format or clear mode.
-	// We do it while alpha blending because it happens before clamping.
-	if (gstate.isAlphaBlendEnabled() && !clearMode) {
-		const Vec4<int> dst = Vec4<int>::FromRGBA(old_color);
-		Vec3<int> blended = AlphaBlendingResult(prim_color, dst);
-		if (gstate.isDitherEnabled()) {
-			blended += Vec3<int>::AssignToAll(gstate.getDitherValue(p.x, p.y));
-		}
-
-		// ToRGB() always automatically clamps.
-		new_color = blended.ToRGB();
-		new_color |= stencil << 24;
-	} else {
-		if (gstate.isDitherEnabled()) {
-			// We'll discard alpha anyway.
-			prim_color += Vec4<int>::AssignToAll(gstate.getDitherValue(p.x, p.y));
-		}
-
-#if defined(_M_SSE)
-		new_color = Vec3<int>(prim_color.ivec).ToRGB();
-		new_color |= stencil << 24;
-#else
-		new_color = Vec4<int>(prim_color.r(), prim_color.g(), prim_color.b(), stencil).ToRGBA();
-#endif
-	}
-
-	// Logic ops are applied after blending (if blending is enabled.)
-	if (gstate.isLogicOpEnabled() && !clearMode) {
-		// Logic ops don't affect stencil, which happens inside ApplyLogicOp.
-		new_color = ApplyLogicOp(gstate.getLogicOp(), old_color, new_color);
-	}
-
-	if (clearMode) {
-		new_color = (new_color & ~gstate.getClearModeColorMask()) | (old_color & gstate.getClearModeColorMask());
-	}
-	new_color = (new_color & ~gstate.getColorMask()) | (old_color & gstate.getColorMask());
-
-	SetPixelColor(p.x, p.y, new_color);
-}
-
-void DrawSinglePixelNonClear(const DrawingCoords &p, u16 z, u8 fog, const Vec4<int> &color_in) {
-	DrawSinglePixel<false>(p, z, fog, color_in);
-}
-
-static inline void ApplyTexturing(Sampler::Funcs sampler, Vec4<int> &prim_color, float s, float t, int texlevel, int frac_texlevel, bool bilinear, u8 *texptr[], int texbufw[]) {
+static inline void ApplyTexturing(const Sampler::BoundTexture &tex, Vec4<int> &prim_color, float s, float t, int texlevel, int frac_texlevel, bool bilinear) {
 	int u[8] = {0}, v[8] = {0};   // 1.23.8 fixed point
 	int frac_u[2], frac_v[2];
 
-	Vec4<int> texcolor0;
-	Vec4<int> texcolor1;
-	const u8 *tptr0 = texptr[texlevel];
-	int bufw0 = texbufw[texlevel];
-	const u8 *tptr1 = texptr[texlevel + 1];
-	int bufw1 = texbufw[texlevel + 1];
+	u32 texcolor0;
+	u32 texcolor1;
+	const Sampler::Funcs &sampler = tex.funcs;
+	const u8 *tptr0 = tex.texptr[texlevel];
+	int bufw0 = tex.texbufw[texlevel];
+	const u8 *tptr1 = tex.texptr[texlevel + 1];
+	int bufw1 = tex.texbufw[texlevel + 1];
 
 	if (!bilinear) {
 		// Nearest filtering only.  Round texcoords.
@@ -958,9 +357,9 @@ static inline void ApplyTexturing(Sampler::Funcs sampler, Vec4<int> &prim_color,
 			GetTexelCoordinates(texlevel + 1, s, t, u[1], v[1]);
 		}
 
-		texcolor0 = Vec4<int>::FromRGBA(sampler.nearest(u[0], v[0], tptr0, bufw0, texlevel));
+		texcolor0 = sampler.nearest(u[0], v[0], tptr0, bufw0, texlevel);
 		if (frac_texlevel) {
-			texcolor1 = Vec4<int>::FromRGBA(sampler.nearest(u[1], v[1], tptr1, bufw1, texlevel + 1));
+			texcolor1 = sampler.nearest(u[1], v[1], tptr1, bufw1, texlevel + 1);
 		}
 	} else {
 		GetTexelCoordinatesQuad(texlevel, s, t, u, v, frac_u[0], frac_v[0]);
@@ -968,16 +367,16 @@ static inline void ApplyTexturing(Sampler::Funcs sampler, Vec4<int> &prim_color,
 			GetTexelCoordinatesQuad(texlevel + 1, s, t, u + 4, v + 4, frac_u[1], frac_v[1]);
 		}
 
-		texcolor0 = Vec4<int>::FromRGBA(sampler.linear(u, v, frac_u[0], frac_v[0], tptr0, bufw0, texlevel));
+		texcolor0 = sampler.linear(u, v, frac_u[0], frac_v[0], tptr0, bufw0, texlevel);
 		if (frac_texlevel) {
-			texcolor1 = Vec4<int>::FromRGBA(sampler.linear(u + 4, v + 4, frac_u[1], frac_v[1], tptr1, bufw1, texlevel + 1));
+			texcolor1 = sampler.linear(u + 4, v + 4, frac_u[1], frac_v[1], tptr1, bufw1, texlevel + 1);
 		}
 	}
 
 	if (frac_texlevel) {
-		texcolor0 = (texcolor1 * frac_texlevel + texcolor0 * (256 - frac_texlevel)) / 256;
+		texcolor0 = Sampler::BlendMipLevels(texcolor0, texcolor1, frac_texlevel);
 	}
-	prim_color = GetTextureFunctionOutput(prim_color, texcolor0);
+	prim_color = GetTextureFunctionOutput(prim_color, Vec4<int>::FromRGBA(texcolor0));
 }
 
 // Produces a signed 1.23.8 value.
@@ -1043,17 +442,17 @@ static inline void CalculateSamplingParams(const float ds, const float dt, const
 	}
 }
 
-static inline void ApplyTexturing(Sampler::Funcs sampler, Vec4<int> *prim_color, const Vec4<float> &s, const Vec4<float> &t, int maxTexLevel, u8 *texptr[], int texbufw[]) {
+static inline void ApplyTexturing(const Sampler::BoundTexture &tex, Vec4<int> *prim_color, const Vec4<float> &s, const Vec4<float> &t) {
 	float ds = s[1] - s[0];
 	float dt = t[2] - t[0];
 
 	int level;
 	int levelFrac;
 	bool bilinear;
-	CalculateSamplingParams(ds, dt, maxTexLevel, level, levelFrac, bilinear);
+	CalculateSamplingParams(ds, dt, tex.maxLevel, level, levelFrac, bilinear);
 
 	for (int i = 0; i < 4; ++i) {
-		ApplyTexturing(sampler, prim_color[i], s[i], t[i], level, levelFrac, bilinear, texptr, texbufw);
+		ApplyTexturing(tex, prim_color[i], s[i], t[i], level, levelFrac, bilinear);
 	}
 }
 
@@ -1132,50 +531,20 @@ static inline Vec4<float> EdgeRecip(const Vec4<int> &w0, const Vec4<int> &w1, co
 #endif
 }
 
+// Draws the part of the triangle within minX-maxX and minY-maxY, inclusive.
 template <bool clearMode>
 void DrawTriangleSlice(
 	const VertexData& v0, const VertexData& v1, const VertexData& v2,
-	int minX, int minY, int maxX, int maxY,
-	bool byY, int h1, int h2)
+	int minX, int minY, int maxX, int maxY, const PixelFuncID &pixelID, SingleFunc drawPixel, const Sampler::BoundTexture &tex)
 {
 	Vec4<int> bias0 = Vec4<int>::AssignToAll(IsRightSideOrFlatBottomLine(v0.screenpos.xy(), v1.screenpos.xy(), v2.screenpos.xy()) ? -1 : 0);
 	Vec4<int> bias1 = Vec4<int>::AssignToAll(IsRightSideOrFlatBottomLine(v1.screenpos.xy(), v2.screenpos.xy(), v0.screenpos.xy()) ? -1 : 0);
 	Vec4<int> bias2 = Vec4<int>::AssignToAll(IsRightSideOrFlatBottomLine(v2.screenpos.xy(), v0.screenpos.xy(), v1.screenpos.xy()) ? -1 : 0);
 
-	int texbufw[8] = {0};
-
-	int maxTexLevel = gstate.getTextureMaxLevel();
-	u8 *texptr[8] = {NULL};
-
-	if (!gstate.isMipmapEnabled()) {
-		// No mipmapping enabled
-		maxTexLevel = 0;
-	}
-
-	if (gstate.isTextureMapEnabled() && !clearMode) {
-		GETextureFormat texfmt = gstate.getTextureFormat();
-		for (int i = 0; i <= maxTexLevel; i++) {
-			u32 texaddr = gstate.getTextureAddress(i);
-			texbufw[i] = GetTextureBufw(i, texaddr, texfmt);
-			if (Memory::IsValidAddress(texaddr))
-				texptr[i] = Memory::GetPointerUnchecked(texaddr);
-			else
-				texptr[i] = 0;
-		}
-	}
-
 	TriangleEdge e0;
 	TriangleEdge e1;
 	TriangleEdge e2;
 
-	if (byY) {
-		maxY = std::min(maxY, minY + h2 * 16 * 2);
-		minY += h1 * 16 * 2;
-	} else {
-		maxX = std::min(maxX, minX + h2 * 16 * 2);
-		minX += h1 * 16 * 2;
-	}
-
 	ScreenCoords pprime(minX, minY, 0);
 	Vec4<int> w0_base = e0.Start(v1.screenpos, v2.screenpos, pprime);
 	Vec4<int> w1_base = e1.Start(v2.screenpos, v0.screenpos, pprime);
@@ -1184,10 +553,34 @@ void DrawTriangleSlice(
 	// All the z values are the same, no interpolation required.
 	// This is common, and when we interpolate, we lose accuracy.
 	const bool flatZ = v0.screenpos.z == v1.screenpos.z && v0.screenpos.z == v2.screenpos.z;
+	const float z0 = v0.screenpos.z, z1 = v1.screenpos.z, z2 = v2.screenpos.z;
+
+	// Everything that's the same for the whole triangle is set up here, so each quad only interpolates.
+	const bool smoothColor = gstate.getShadeMode() == GE_SHADE_GOURAUD && !clearMode;
+	const bool applyTexture = gstate.isTextureMapEnabled() && !clearMode;
+	const bool applyFog = gstate.isFogEnabled() && !clearMode;
+	const bool throughMode = gstate.isModeThrough();
+
+	// Secondary color has zero alpha, so it can be added as is.
+	const Vec4<float> prim0 = v0.color0.Cast<float>(), prim1 = v1.color0.Cast<float>(), prim2 = v2.color0.Cast<float>();
+	const Vec4<float> sec0(v0.color1.Cast<float>(), 0.0f), sec1(v1.color1.Cast<float>(), 0.0f), sec2(v2.color1.Cast<float>(), 0.0f);
+	const Vec4<int> flatSec(v2.color1, 0);
+
+	float q0 = 0.0f, q1 = 0.0f, q2 = 0.0f;
+	float texScaleS = 1.0f, texScaleT = 1.0f;
+	if (applyTexture) {
+		if (throughMode) {
+			// For levels > 0, mipmapping is always based on level 0.  Simpler to scale first.
+			texScaleS = 1.0f / (float)gstate.getTextureWidth(0);
+			texScaleT = 1.0f / (float)gstate.getTextureHeight(0);
+		} else {
+			q0 = 1.0f / v0.clippos.w;
+			q1 = 1.0f / v1.clippos.w;
+			q2 = 1.0f / v2.clippos.w;
+		}
+	}
 
-	Sampler::Funcs sampler = Sampler::GetFuncs();
-
-	for (pprime.y = minY; pprime.y < maxY; pprime.y += 32,
+	for (pprime.y = minY; pprime.y <= maxY; pprime.y += 32,
 										w0_base = e0.StepY(w0_base),
 										w1_base = e1.StepY(w1_base),
 										w2_base = e2.StepY(w2_base)) {
@@ -1214,55 +607,45 @@ void DrawTriangleSlice(
 			Vec4<int> mask = MakeMask(w0, w1, w2, bias0, bias1, bias2, scissor_mask);
 			if (AnyMask(mask)) {
 				Vec4<float> wsum_recip = EdgeRecip(w0, w1, w2);
+				const Vec4<float> w0f = w0.Cast<float>();
+				const Vec4<float> w1f = w1.Cast<float>();
+				const Vec4<float> w2f = w2.Cast<float>();
 
 				Vec4<int> prim_color[4];
-				Vec3<int> sec_color[4];
-				if (gstate.getShadeMode() == GE_SHADE_GOURAUD && !clearMode) {
+				Vec4<int> sec_color[4];
+				if (smoothColor) {
 					// Does the PSP do perspective-correct color interpolation? The GC doesn't.
-					for (int i = 0; i < 4; ++i) {
-						prim_color[i] = Interpolate(v0.color0, v1.color0, v2.color0, w0[i], w1[i], w2[i], wsum_recip[i]);
-						sec_color[i] = Interpolate(v0.color1, v1.color1, v2.color1, w0[i], w1[i], w2[i], wsum_recip[i]);
-					}
+					InterpolateQuad(prim_color, prim0, prim1, prim2, w0f, w1f, w2f, wsum_recip);
+					InterpolateQuad(sec_color, sec0, sec1, sec2, w0f, w1f, w2f, wsum_recip);
 				} else {
 					for (int i = 0; i < 4; ++i) {
 						prim_color[i] = v2.color0;
-						sec_color[i] = v2.color1;
+						sec_color[i] = flatSec;
 					}
 				}
 
-				if (gstate.isTextureMapEnabled() && !clearMode) {
+				if (applyTexture) {
 					Vec4<float> s, t;
-					if (gstate.isModeThrough()) {
-						s = Interpolate(v0.texturecoords.s(), v1.texturecoords.s(), v2.texturecoords.s(), w0, w1, w2, wsum_recip);
-						t = Interpolate(v0.texturecoords.t(), v1.texturecoords.t(), v2.texturecoords.t(), w0, w1, w2, wsum_recip);
-
-						// For levels > 0, mipmapping is always based on level 0.  Simpler to scale first.
-						s *= 1.0f / (float)gstate.getTextureWidth(0);
-						t *= 1.0f / (float)gstate.getTextureHeight(0);
+					if (throughMode) {
+						s = Interpolate(v0.texturecoords.s(), v1.texturecoords.s(), v2.texturecoords.s(), w0f, w1f, w2f, wsum_recip) * texScaleS;
+						t = Interpolate(v0.texturecoords.t(), v1.texturecoords.t(), v2.texturecoords.t(), w0f, w1f, w2f, wsum_recip) * texScaleT;
 					} else {
 						// Texture coordinate interpolation must definitely be perspective-correct.
-						GetTextureCoordinates(v0, v1, v2, w0, w1, w2, wsum_recip, s, t);
+						GetTextureCoordinates(v0, v1, v2, w0f, w1f, w2f, q0, q1, q2, s, t);
 					}
 
-					ApplyTexturing(sampler, prim_color, s, t, maxTexLevel, texptr, texbufw);
+					ApplyTexturing(tex, prim_color, s, t);
 				}
 
 				if (!clearMode) {
 					for (int i = 0; i < 4; ++i) {
-#if defined(_M_SSE)
-						// TODO: Tried making Vec4 do this, but things got slower.
-						const __m128i sec = _mm_and_si128(sec_color[i].ivec, _mm_set_epi32(0, -1, -1, -1));
-						prim_color[i].ivec = _mm_add_epi32(prim_color[i].ivec, sec);
-#else
-						prim_color[i] += Vec4<int>(sec_color[i], 0);
-#endif
+						prim_color[i] += sec_color[i];
 					}
 				}
 
 				Vec4<int> fog = Vec4<int>::AssignToAll(255);
-				if (gstate.isFogEnabled() && !clearMode) {
-					Vec4<float> fogdepths = w0.Cast<float>() * v0.fogdepth + w1.Cast<float>() * v1.fogdepth + w2.Cast<float>() * v2.fogdepth;
-					fogdepths = fogdepths * wsum_recip;
+				if (applyFog) {
+					Vec4<float> fogdepths = Interpolate(v0.fogdepth, v1.fogdepth, v2.fogdepth, w0f, w1f, w2f, wsum_recip);
 					for (int i = 0; i < 4; ++i) {
 						fog[i] = ClampFogDepth(fogdepths[i]);
 					}
@@ -1273,8 +656,7 @@ void DrawTriangleSlice(
 					z = Vec4<int>::AssignToAll(v2.screenpos.z);
 				} else {
 					// TODO: Is that the correct way to interpolate?
-					Vec4<float> zfloats = w0.Cast<float>() * v0.screenpos.z + w1.Cast<float>() * v1.screenpos.z + w2.Cast<float>() * v2.screenpos.z;
-					z = (zfloats * wsum_recip).Cast<int>();
+					z = Interpolate(z0, z1, z2, w0f, w1f, w2f, wsum_recip).Cast<int>();
 				}
 
 				DrawingCoords subp = p;
@@ -1285,18 +667,131 @@ void DrawTriangleSlice(
 					subp.x = p.x + (i & 1);
 					subp.y = p.y + (i / 2);
 
-					DrawSinglePixel<clearMode>(subp, (u16)z[i], fog[i], prim_color[i]);
+					drawPixel(subp.x, subp.y, z[i], fog[i], prim_color[i], pixelID);
 				}
 			}
 		}
 	}
 }
 
+struct BinnedTriangle {
+	VertexData v0, v1, v2;
+	// Screen coordinates, inclusive.
+	int minX, minY, maxX, maxY;
+};
+
+// Triangles are collected for the whole primitive, and then drawn by tile.
+// Each tile belongs to a single thread, so all triangles are still drawn in order per pixel.
+static std::vector<BinnedTriangle> binnedTriangles;
+static std::vector<std::vector<int>> tileBins;
+
+enum {
+	// In screen coordinates, so this is 32x32 pixels.  Must be a multiple of 32 (two pixels.)
+	TILE_SIZE = 32 * 16,
+	// Just to keep the memory used in check, we draw once we have this many.
+	MAX_BINNED_TRIANGLES = 4096,
+};
+
+template <bool clearMode>
+static void DrawTileBins(int minX, int minY, int tileCols, int tileStart, int tileEnd, const PixelFuncID &pixelID, SingleFunc drawPixel, const Sampler::BoundTexture &tex) {
+	for (int tile = tileStart; tile < tileEnd; ++tile) {
+		const int tileX = minX + (tile % tileCols) * TILE_SIZE;
+		const int tileY = minY + (tile / tileCols) * TILE_SIZE;
+
+		for (int index : tileBins[tile]) {
+			const BinnedTriangle &tri = binnedTriangles[index];
+			int x1 = std::max(tri.minX, tileX);
+			int y1 = std::max(tri.minY, tileY);
+			int x2 = std::min(tri.maxX, tileX + TILE_SIZE - 16);
+			int y2 = std::min(tri.maxY, tileY + TILE_SIZE - 16);
+			DrawTriangleSlice<clearMode>(tri.v0, tri.v1, tri.v2, x1, y1, x2, y2, pixelID, drawPixel, tex);
+		}
+	}
+}
+
+void FlushTriangles() {
+	if (binnedTriangles.empty()) {
+		return;
+	}
+
+	PROFILE_THIS_SCOPE("draw_tri");
+
+	const bool clearMode = gstate.isModeClear();
+	PixelFuncID pixelID;
+	ComputePixelFuncID(&pixelID);
+	SingleFunc drawPixel = GetSingleFunc(pixelID);
+
+	// Set up once here, since the worker threads can't decode and cache it.
+	Sampler::BoundTexture tex{};
+	if (gstate.isTextureMapEnabled() && !clearMode)
+		Sampler::GetBoundTexture(&tex);
+
+	int minX = binnedTriangles[0].minX;
+	int minY = binnedTriangles[0].minY;
+	int maxX = binnedTriangles[0].maxX;
+	int maxY = binnedTriangles[0].maxY;
+	for (const BinnedTriangle &tri : binnedTriangles) {
+		minX = std::min(minX, tri.minX);
+		minY = std::min(minY, tri.minY);
+		maxX = std::max(maxX, tri.maxX);
+		maxY = std::max(maxY, tri.maxY);
+	}
+
+	const int tileCols = (maxX - minX) / TILE_SIZE + 1;
+	const int tileRows = (maxY - minY) / TILE_SIZE + 1;
+	const int tileCount = tileCols * tileRows;
+
+	if (tileCount == 1) {
+		// Not worth waking up any threads for.
+		for (const BinnedTriangle &tri : binnedTriangles) {
+			if (clearMode) {
+				DrawTriangleSlice<true>(tri.v0, tri.v1, tri.v2, tri.minX, tri.minY, tri.maxX, tri.maxY, pixelID, drawPixel, tex);
+			} else {
+				DrawTriangleSlice<false>(tri.v0, tri.v1, tri.v2, tri.minX, tri.minY, tri.maxX, tri.maxY, pixelID, drawPixel, tex);
+			}
+		}
+		binnedTriangles.clear();
+		return;
+	}
+
+	if ((int)tileBins.size() < tileCount) {
+		tileBins.resize(tileCount);
+	}
+	for (int tile = 0; tile < tileCount; ++tile) {
+		tileBins[tile].clear();
+	}
+
+	for (int i = 0; i < (int)binnedTriangles.size(); ++i) {
+		const BinnedTriangle &tri = binnedTriangles[i];
+		const int col1 = (tri.minX - minX) / TILE_SIZE;
+		const int col2 = (tri.maxX - minX) / TILE_SIZE;
+		const int row1 = (tri.minY - minY) / TILE_SIZE;
+		const int row2 = (tri.maxY - minY) / TILE_SIZE;
+		for (int row = row1; row <= row2; ++row) {
+			for (int col = col1; col <= col2; ++col) {
+				tileBins[row * tileCols + col].push_back(i);
+			}
+		}
+	}
+
+	if (clearMode) {
+		auto bound = [&](int a, int b) -> void {
+			DrawTileBins<true>(minX, minY, tileCols, a, b, pixelID, drawPixel, tex);
+		};
+		GlobalThreadPool::Loop(bound, 0, tileCount);
+	} else {
+		auto bound = [&](int a, int b) -> void {
+			DrawTileBins<false>(minX, minY, tileCols, a, b, pixelID, drawPixel, tex);
+		};
+		GlobalThreadPool::Loop(bound, 0, tileCount);
+	}
+
+	binnedTriangles.clear();
+}
+
 // Draws triangle, vertices specified in counter-clockwise direction
 void DrawTriangle(const VertexData& v0, const VertexData& v1, const VertexData& v2)
 {
-	PROFILE_THIS_SCOPE("draw_tri");
-
 	Vec2<int> d01((int)v0.screenpos.x - (int)v1.screenpos.x, (int)v0.screenpos.y - (int)v1.screenpos.y);
 	Vec2<int> d02((int)v0.screenpos.x - (int)v2.screenpos.x, (int)v0.screenpos.y - (int)v2.screenpos.y);
 	Vec2<int> d12((int)v1.screenpos.x - (int)v2.screenpos.x, (int)v1.screenpos.y - (int)v2.screenpos.y);
@@ -1316,45 +811,18 @@ void DrawTriangle(const VertexData& v0, const VertexData& v1, const VertexData&
 	maxX = std::min(maxX, (int)TransformUnit::DrawingToScreen(scissorBR).x);
 	minY = std::max(minY, (int)TransformUnit::DrawingToScreen(scissorTL).y);
 	maxY = std::min(maxY, (int)TransformUnit::DrawingToScreen(scissorBR).y);
+	if (minX > maxX || minY > maxY)
+		return;
 
-	// 32 because we do two pixels at once, and we don't want overlap.
-	int rangeY = (maxY - minY) / 32 + 1;
-	int rangeX = (maxX - minX) / 32 + 1;
-	if (rangeY >= 12 && rangeX >= rangeY * 4) {
-		if (gstate.isModeClear()) {
-			auto bound = [&](int a, int b) -> void {
-				DrawTriangleSlice<true>(v0, v1, v2, minX, minY, maxX, maxY, false, a, b);
-			};
-			GlobalThreadPool::Loop(bound, 0, rangeX);
-		} else {
-			auto bound = [&](int a, int b) -> void {
-				DrawTriangleSlice<false>(v0, v1, v2, minX, minY, maxX, maxY, false, a, b);
-			};
-			GlobalThreadPool::Loop(bound, 0, rangeX);
-		}
-	} else if (rangeY >= 12 && rangeX >= 12) {
-		if (gstate.isModeClear()) {
-			auto bound = [&](int a, int b) -> void {
-				DrawTriangleSlice<true>(v0, v1, v2, minX, minY, maxX, maxY, true, a, b);
-			};
-			GlobalThreadPool::Loop(bound, 0, rangeY);
-		} else {
-			auto bound = [&](int a, int b) -> void {
-				DrawTriangleSlice<false>(v0, v1, v2, minX, minY, maxX, maxY, true, a, b);
-			};
-			GlobalThreadPool::Loop(bound, 0, rangeY);
-		}
-	} else {
-		if (gstate.isModeClear()) {
-			DrawTriangleSlice<true>(v0, v1, v2, minX, minY, maxX, maxY, true, 0, rangeY);
-		} else {
-			DrawTriangleSlice<false>(v0, v1, v2, minX, minY, maxX, maxY, true, 0, rangeY);
-		}
-	}
+	if (binnedTriangles.size() >= MAX_BINNED_TRIANGLES)
+		FlushTriangles();
+	binnedTriangles.push_back({ v0, v1, v2, minX, minY, maxX, maxY });
 }
 
 void DrawPoint(const VertexData &v0)
 {
+	FlushTriangles();
+
 	ScreenCoords pos = v0.screenpos;
 	Vec4<int> prim_color = v0.color0;
 	Vec3<int> sec_color = v0.color1;
@@ -1367,30 +835,9 @@ void DrawPoint(const VertexData &v0)
 
 	bool clearMode = gstate.isModeClear();
 
-	Sampler::Funcs sampler = Sampler::GetFuncs();
-
 	if (gstate.isTextureMapEnabled() && !clearMode) {
-		int texbufw[8] = {0};
-
-		int maxTexLevel = gstate.getTextureMaxLevel();
-		u8 *texptr[8] = {NULL};
-
-		if (!gstate.isMipmapEnabled()) {
-			// No mipmapping enabled
-			maxTexLevel = 0;
-		}
-
-		if (gstate.isTextureMapEnabled() && !clearMode) {
-			GETextureFormat texfmt = gstate.getTextureFormat();
-			for (int i = 0; i <= maxTexLevel; i++) {
-				u32 texaddr = gstate.getTextureAddress(i);
-				texbufw[i] = GetTextureBufw(i, texaddr, texfmt);
-				if (Memory::IsValidAddress(texaddr))
-					texptr[i] = Memory::GetPointerUnchecked(texaddr);
-				else
-					texptr[i] = 0;
-			}
-		}
+		Sampler::BoundTexture tex;
+		Sampler::GetBoundTexture(&tex);
 
 		float s = v0.texturecoords.s();
 		float t = v0.texturecoords.t();
@@ -1405,8 +852,8 @@ void DrawPoint(const VertexData &v0)
 		int texLevel;
 		int texLevelFrac;
 		bool bilinear;
-		CalculateSamplingParams(0.0f, 0.0f, maxTexLevel, texLevel, texLevelFrac, bilinear);
-		ApplyTexturing(sampler, prim_color, s, t, texLevel, texLevelFrac, bilinear, texptr, texbufw);
+		CalculateSamplingParams(0.0f, 0.0f, tex.maxLevel, texLevel, texLevelFrac, bilinear);
+		ApplyTexturing(tex, prim_color, s, t, texLevel, texLevelFrac, bilinear);
 	}
 
 	if (!clearMode)
@@ -1422,15 +869,16 @@ void DrawPoint(const VertexData &v0)
 		fog = ClampFogDepth(v0.fogdepth);
 	}
 
-	if (clearMode) {
-		DrawSinglePixel<true>(p, z, fog, prim_color);
-	} else {
-		DrawSinglePixel<false>(p, z, fog, prim_color);
-	}
+	PixelFuncID pixelID;
+	ComputePixelFuncID(&pixelID);
+	SingleFunc drawPixel = GetSingleFunc(pixelID);
+	drawPixel(p.x, p.y, z, fog, prim_color, pixelID);
 }
 
 void ClearRectangle(const VertexData &v0, const VertexData &v1)
 {
+	FlushTriangles();
+
 	int minX = std::min(v0.screenpos.x, v1.screenpos.x) & ~0xF;
 	int minY = std::min(v0.screenpos.y, v1.screenpos.y) & ~0xF;
 	int maxX = (std::max(v0.screenpos.x, v1.screenpos.x) + 0xF) & ~0xF;
@@ -1559,6 +1007,8 @@ void ClearRectangle(const VertexData &v0, const VertexData &v1)
 
 void DrawLine(const VertexData &v0, const VertexData &v1)
 {
+	FlushTriangles();
+
 	// TODO: Use a proper line drawing algorithm that handles fractional endpoints correctly.
 	Vec3<int> a(v0.screenpos.x, v0.screenpos.y, v0.screenpos.z);
 	Vec3<int> b(v1.screenpos.x, v1.screenpos.y, v0.screenpos.z);
@@ -1581,26 +1031,13 @@ void DrawLine(const VertexData &v0, const VertexData &v1)
 	ScreenCoords scissorBR(TransformUnit::DrawingToScreen(DrawingCoords(gstate.getScissorX2(), gstate.getScissorY2(), 0)));
 	bool clearMode = gstate.isModeClear();
 
-	int texbufw[8] = {0};
+	PixelFuncID pixelID;
+	ComputePixelFuncID(&pixelID);
+	SingleFunc drawPixel = GetSingleFunc(pixelID);
 
-	int maxTexLevel = gstate.getTextureMaxLevel();
-	u8 *texptr[8] = {NULL};
-
-	if (!gstate.isMipmapEnabled()) {
-		// No mipmapping enabled
-		maxTexLevel = 0;
-	}
-
-	if (gstate.isTextureMapEnabled() && !clearMode) {
-		GETextureFormat texfmt = gstate.getTextureFormat();
-		for (int i = 0; i <= maxTexLevel; i++) {
-			u32 texaddr = gstate.getTextureAddress(i);
-			texbufw[i] = GetTextureBufw(i, texaddr, texfmt);
-			texptr[i] = Memory::GetPointer(texaddr);
-		}
-	}
-
-	Sampler::Funcs sampler = Sampler::GetFuncs();
+	Sampler::BoundTexture tex{};
+	if (gstate.isTextureMapEnabled() && !clearMode)
+		Sampler::GetBoundTexture(&tex);
 
 	float x = a.x > b.x ? a.x - 1 : a.x;
 	float y = a.y > b.y ? a.y - 1 : a.y;
@@ -1654,7 +1091,7 @@ void DrawLine(const VertexData &v0, const VertexData &v1)
 				int texLevel;
 				int texLevelFrac;
 				bool texBilinear;
-				CalculateSamplingParams(ds, dt, maxTexLevel, texLevel, texLevelFrac, texBilinear);
+				CalculateSamplingParams(ds, dt, tex.maxLevel, texLevel, texLevelFrac, texBilinear);
 
 				if (gstate.isAntiAliasEnabled()) {
 					// TODO: This is a niave and wrong implementation.
@@ -1666,7 +1103,7 @@ void DrawLine(const VertexData &v0, const VertexData &v1)
 					texBilinear = true;
 				}
 
-				ApplyTexturing(sampler, prim_color, s, t, texLevel, texLevelFrac, texBilinear, texptr, texbufw);
+				ApplyTexturing(tex, prim_color, s, t, texLevel, texLevelFrac, texBilinear);
 			}
 
 			if (!clearMode)
@@ -1675,11 +1112,7 @@ void DrawLine(const VertexData &v0, const VertexData &v1)
 			ScreenCoords pprime = ScreenCoords((int)x, (int)y, (int)z);
 
 			DrawingCoords p = TransformUnit::ScreenToDrawing(pprime);
-			if (clearMode) {
-				DrawSinglePixel<true>(p, z, fog, prim_color);
-			} else {
-				DrawSinglePixel<false>(p, z, fog, prim_color);
-			}
+			drawPixel(p.x, p.y, z, fog, prim_color, pixelID);
 		}
 
 		x += xinc;
@@ -16,6 +16,7 @@
 
 #include "Rasterizer.h"
 #include "GPU/Common/TextureCacheCommon.h"
+#include "GPU/Software/DrawPixel.h"
 #include "GPU/Software/SoftGpu.h"
 #include "GPU/Software/Rasterizer.h"
 #include "GPU/Software/Sampler.h"
@@ -77,6 +78,118 @@ static inline Vec4<int> ModulateRGBA(const Vec4<int>& prim_color, const Vec4<int
 
 }
 
+// The usual 2D sprite: 8888, no depth or stencil, and at most an alpha > 0 test and SRCALPHA/INVSRCALPHA blending.
+static bool IsSimpleSprite8888(const PixelFuncID &pixelID) {
+	if (pixelID.clearMode || pixelID.fbFormat != GE_FORMAT_8888)
+		return false;
+	if (pixelID.applyDepthRange || pixelID.depthTestFunc != GE_COMP_ALWAYS || pixelID.depthWrite || pixelID.stencilTest)
+		return false;
+	if (pixelID.applyFog || pixelID.colorTestFunc != GE_COMP_ALWAYS || pixelID.applyLogicOp || pixelID.dithering || pixelID.applyColorWriteMask)
+		return false;
+	if (pixelID.alphaTestFunc != GE_COMP_ALWAYS) {
+		if (pixelID.alphaTestFunc != GE_COMP_GREATER || gstate.getAlphaTestRef() != 0 || gstate.getAlphaTestMask() != 0xFF)
+			return false;
+	}
+	if (pixelID.alphaBlend) {
+		if (pixelID.blendEq != GE_BLENDMODE_MUL_AND_ADD || pixelID.blendSrc != GE_SRCBLEND_SRCALPHA || pixelID.blendDst != GE_DSTBLEND_INVSRCALPHA)
+			return false;
+	}
+	return true;
+}
+
+// Matches AlphaBlendingResult() for SRCALPHA/INVSRCALPHA exactly.  Keeps the dst alpha, which is stencil.
+static inline u32 BlendSrcAlpha8888(u32 src, u32 dst) {
+#if defined(_M_SSE)
+	const __m128i z = _mm_setzero_si128();
+	const __m128i s = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(src), z), z);
+	const __m128i d = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(dst), z), z);
+	const __m128i a = _mm_shuffle_epi32(s, _MM_SHUFFLE(3, 3, 3, 3));
+	const __m128i inva = _mm_sub_epi32(_mm_set1_epi32(255), a);
+	const __m128 sf = _mm_mul_ps(_mm_cvtepi32_ps(s), _mm_cvtepi32_ps(a));
+	const __m128 df = _mm_mul_ps(_mm_cvtepi32_ps(d), _mm_cvtepi32_ps(inva));
+	__m128i c = _mm_cvtps_epi32(_mm_mul_ps(_mm_add_ps(sf, df), _mm_set_ps1(1.0f / 255.0f)));
+	c = _mm_packs_epi32(c, c);
+	const u32 blended = _mm_cvtsi128_si32(_mm_packus_epi16(c, c));
+#else
+	const Vec4<int> s = Vec4<int>::FromRGBA(src);
+	const Vec4<int> d = Vec4<int>::FromRGBA(dst);
+	const u32 blended = ((s.rgb() * s.a() + d.rgb() * (255 - s.a())) / 255).ToRGB();
+#endif
+	return (blended & 0x00FFFFFF) | (dst & 0xFF000000);
+}
+
+static inline void DrawSpritePixel8888(u32 *pixel, u32 color, bool alphaBlend, bool skipTransparent) {
+	const u32 alpha = color >> 24;
+	if (alpha == 0 && skipTransparent) {
+		// Either fails the alpha test, or blends to exactly the dst color.
+		return;
+	}
+	if (alphaBlend && alpha != 255) {
+		*pixel = BlendSrcAlpha8888(color, *pixel);
+	} else {
+		*pixel = (color & 0x00FFFFFF) | (*pixel & 0xFF000000);
+	}
+}
+
+// Draws a 1:1 textured sprite for IsSimpleSprite8888() state, a row at a time.
+static void DrawSpriteRows8888(const DrawingCoords &pos0, const DrawingCoords &pos1, int s_start, int t_start, int ds, int dt, Sampler::NearestFunc nearestFunc, const u8 *texptr, int texbufw, const Vec4<int> &prim_color, bool alphaBlend, bool skipTransparent) {
+	// Replace, or modulating by white (without doubling), gives the texel back, so we can skip that math.
+	const bool alphaUsed = gstate.isTextureAlphaUsed();
+	const bool isWhite = prim_color == Vec4<int>(255, 255, 255, 255);
+	const bool rawTexel = (gstate.getTextureFunction() == GE_TEXFUNC_REPLACE && alphaUsed) ||
+		(gstate.getTextureFunction() == GE_TEXFUNC_MODULATE && isWhite && !gstate.isColorDoublingEnabled());
+	const u32 forceAlpha = rawTexel && !alphaUsed ? 0xFF000000 : 0;
+
+	int t = t_start;
+	for (int y = pos0.y; y < pos1.y; y++) {
+		int s = s_start;
+		u32 *pixel = fb.Get32Ptr(pos0.x, y, gstate.FrameBufStride());
+		int x = pos0.x;
+
+#if defined(_M_SSE)
+		// Most sprite texels are fully opaque or fully transparent, so handle those four at a time.
+		for (; x + 4 <= pos1.x; x += 4, pixel += 4) {
+			alignas(16) u32 colors[4];
+			for (int i = 0; i < 4; ++i, s += ds) {
+				u32 texel = nearestFunc(s, t, texptr, texbufw, 0);
+				colors[i] = rawTexel ? (texel | forceAlpha) : GetTextureFunctionOutput(prim_color, Vec4<int>::FromRGBA(texel)).ToRGBA();
+			}
+
+			const __m128i c = _mm_load_si128((const __m128i *)colors);
+			const __m128i alphaMask = _mm_set1_epi32(0xFF000000);
+			const __m128i alpha = _mm_and_si128(c, alphaMask);
+			const int opaqueBits = _mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alphaMask));
+			const int transparentBits = _mm_movemask_epi8(_mm_cmpeq_epi32(alpha, _mm_setzero_si128()));
+			if (transparentBits == 0xFFFF && skipTransparent)
+				continue;
+			if (opaqueBits == 0xFFFF || !alphaBlend) {
+				__m128i dst = _mm_loadu_si128((const __m128i *)pixel);
+				__m128i keep = _mm_and_si128(dst, alphaMask);
+				__m128i src = _mm_andnot_si128(alphaMask, c);
+				if (transparentBits != 0 && skipTransparent) {
+					// Some failed the alpha test, keep those pixels entirely.
+					const __m128i fail = _mm_cmpeq_epi32(alpha, _mm_setzero_si128());
+					src = _mm_andnot_si128(fail, src);
+					keep = _mm_or_si128(keep, _mm_and_si128(fail, dst));
+				}
+				_mm_storeu_si128((__m128i *)pixel, _mm_or_si128(src, keep));
+				continue;
+			}
+
+			for (int i = 0; i < 4; ++i)
+				DrawSpritePixel8888(pixel + i, colors[i], alphaBlend, skipTransparent);
+		}
+#endif
+
+		for (; x < pos1.x; x++, pixel++, s += ds) {
+			u32 texel = nearestFunc(s, t, texptr, texbufw, 0);
+			u32 color = rawTexel ? (texel | forceAlpha) : GetTextureFunctionOutput(prim_color, Vec4<int>::FromRGBA(texel)).ToRGBA();
+			DrawSpritePixel8888(pixel, color, alphaBlend, skipTransparent);
+		}
+		t += dt;
+	}
+}
+
 void DrawSprite(const VertexData& v0, const VertexData& v1) {
 	const u8 *texptr = nullptr;
 
@@ -96,7 +209,11 @@ void DrawSprite(const VertexData& v0, const VertexData& v1) {
 	DrawingCoords scissorBR(gstate.getScissorX2(), gstate.getScissorY2(), 0);
 
 	int z = pos0.z;
-	float fog = 1.0f;
+	int fog = 1;
+
+	PixelFuncID pixelID;
+	ComputePixelFuncID(&pixelID);
+	SingleFunc drawPixel = GetSingleFunc(pixelID);
 
 	bool isWhite = v0.color0 == Vec4<int>(255, 255, 255, 255);
 
@@ -167,6 +284,9 @@ void DrawSprite(const VertexData& v0, const VertexData& v1) {
 				}
 				t += dt;
 			}
+		} else if (IsSimpleSprite8888(pixelID)) {
+			const bool skipTransparent = pixelID.alphaBlend || pixelID.alphaTestFunc != GE_COMP_ALWAYS;
+			DrawSpriteRows8888(pos0, pos1, s_start, t_start, ds, dt, nearestFunc, texptr, texbufw, v0.color0, pixelID.alphaBlend, skipTransparent);
 		} else {
 			int t = t_start;
 			for (int y = pos0.y; y < pos1.y; y++) {
@@ -176,8 +296,7 @@ void DrawSprite(const VertexData& v0, const VertexData& v1) {
 					Vec4<int> prim_color = v0.color0;
 					Vec4<int> tex_color = Vec4<int>::FromRGBA(nearestFunc(s, t, texptr, texbufw, 0));
 					prim_color = GetTextureFunctionOutput(prim_color, tex_color);
-					DrawingCoords pos(x, y, z);
-					DrawSinglePixelNonClear(pos, (u16)z, 1.0f, prim_color);
+					drawPixel(x, y, z, fog, prim_color, pixelID);
 					s += ds;
 				}
 				t += dt;
@@ -216,8 +335,7 @@ void DrawSprite(const VertexData& v0, const VertexData& v1) {
 			for (int y = pos0.y; y < pos1.y; y++) {
 				for (int x = pos0.x; x < pos1.x; x++) {
 					Vec4<int> prim_color = v0.color0;
-					DrawingCoords pos(x, y, z);
-					DrawSinglePixelNonClear(pos, (u16)z, fog, prim_color);
+					drawPixel(x, y, z, fog, prim_color, pixelID);
 				}
 			}
 		}
@@ -228,6 +346,9 @@ bool needsClear = false;
 
 // Returns true if the normal path should be skipped.
 bool RectangleFastPath(const VertexData &v0, const VertexData &v1) {
+	// This draws directly, and may even change state.
+	FlushTriangles();
+
 	g_DarkStalkerStretch = false;
 	// Check for 1:1 texture mapping. In that case we can call DrawSprite.
 	int xdiff = v1.screenpos.x - v0.screenpos.x;
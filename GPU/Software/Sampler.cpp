@@ -18,6 +18,7 @@
 #include <unordered_map>
 #include <mutex>
 #include "Common/ColorConv.h"
+#include "Common/PerfMap.h"
 #include "Core/Reporting.h"
 #include "GPU/Common/TextureDecoder.h"
 #include "GPU/GPUState.h"
@@ -26,6 +27,13 @@
 #if defined(_M_SSE)
 #include <emmintrin.h>
 #endif
+#if PPSSPP_ARCH(ARM_NEON)
+#if defined(_MSC_VER) && PPSSPP_ARCH(ARM64)
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+#endif
 
 using namespace Math3D;
 
@@ -35,6 +43,8 @@ namespace Sampler {
 
 static u32 SampleNearest(int u, int v, const u8 *tptr, int bufw, int level);
 static u32 SampleLinear(int u[4], int v[4], int frac_u, int frac_v, const u8 *tptr, int bufw, int level);
+static u32 SampleNearestDecoded(int u, int v, const u8 *tptr, int bufw, int level);
+static u32 SampleLinearDecoded(int u[4], int v[4], int frac_u, int frac_v, const u8 *tptr, int bufw, int level);
 
 std::mutex jitCacheLock;
 SamplerJitCache *jitCache = nullptr;
@@ -79,6 +89,22 @@ LinearFunc GetLinearFunc() {
 	return &SampleLinear;
 }
 
+Funcs GetDecodedFuncs() {
+	SamplerID id;
+	id.texfmt = GE_TFMT_8888;
+
+	Funcs f;
+	f.nearest = jitCache->GetNearest(id);
+	if (!f.nearest)
+		f.nearest = &SampleNearestDecoded;
+
+	id.linear = true;
+	f.linear = jitCache->GetLinear(id);
+	if (!f.linear)
+		f.linear = &SampleLinearDecoded;
+	return f;
+}
+
 SamplerJitCache::SamplerJitCache()
 #if PPSSPP_ARCH(ARM64)
  : fp(this)
@@ -219,6 +245,8 @@ NearestFunc SamplerJitCache::GetNearest(const SamplerID &id) {
 	addresses_[id] = GetCodePointer();
 	NearestFunc func = Compile(id);
 	cache_[id] = func;
+	if (PerfMapEnabled())
+		PerfMapAddCode(addresses_[id], GetCodePointer() - addresses_[id], "Sampler " + DescribeSamplerID(id));
 	return func;
 #else
 	return nullptr;
@@ -243,6 +271,8 @@ LinearFunc SamplerJitCache::GetLinear(const SamplerID &id) {
 	addresses_[id] = GetCodePointer();
 	LinearFunc func = CompileLinear(id);
 	cache_[id] = (NearestFunc)func;
+	if (PerfMapEnabled())
+		PerfMapAddCode(addresses_[id], GetCodePointer() - addresses_[id], "SamplerLinear " + DescribeSamplerID(id));
 	return func;
 #else
 	return nullptr;
@@ -415,9 +445,40 @@ static u32 SampleNearest(int u, int v, const u8 *tptr, int bufw, int level) {
 	return SampleNearest<1>(&u, &v, tptr, bufw, level);
 }
 
-static u32 SampleLinear(int u[4], int v[4], int frac_u, int frac_v, const u8 *tptr, int bufw, int texlevel) {
-	Nearest4 c = SampleNearest<4>(u, v, tptr, bufw, texlevel);
-
+// Exact integer math, so it matches the scalar path (all sums fit in 16 bits before the frac_v step.)
+static inline u32 LinearBlend(const Nearest4 &c, int frac_u, int frac_v) {
+#if defined(_M_SSE)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i texels = _mm_load_si128((const __m128i *)c.v);
+	// Left texels in the low half, right texels in the high half.
+	const __m128i fu = _mm_set_epi16(frac_u, frac_u, frac_u, frac_u, 0x100 - frac_u, 0x100 - frac_u, 0x100 - frac_u, 0x100 - frac_u);
+	__m128i top = _mm_mullo_epi16(_mm_unpacklo_epi8(texels, zero), fu);
+	__m128i bottom = _mm_mullo_epi16(_mm_unpackhi_epi8(texels, zero), fu);
+	top = _mm_add_epi16(top, _mm_srli_si128(top, 8));
+	bottom = _mm_add_epi16(bottom, _mm_srli_si128(bottom, 8));
+
+	// Now 24 bit products, so build them from unsigned low and high halves.
+	const __m128i fvTop = _mm_set1_epi16(0x100 - frac_v);
+	const __m128i fvBottom = _mm_set1_epi16(frac_v);
+	__m128i sum = _mm_unpacklo_epi16(_mm_mullo_epi16(top, fvTop), _mm_mulhi_epu16(top, fvTop));
+	sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(_mm_mullo_epi16(bottom, fvBottom), _mm_mulhi_epu16(bottom, fvBottom)));
+	sum = _mm_srli_epi32(sum, 16);
+	sum = _mm_packs_epi32(sum, sum);
+	return _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+#elif PPSSPP_ARCH(ARM_NEON)
+	const uint8x16_t texels = vld1q_u8((const uint8_t *)c.v);
+	const uint16x8_t topTexels = vmovl_u8(vget_low_u8(texels));
+	const uint16x8_t bottomTexels = vmovl_u8(vget_high_u8(texels));
+	uint16x4_t top = vmul_n_u16(vget_low_u16(topTexels), 0x100 - frac_u);
+	top = vmla_n_u16(top, vget_high_u16(topTexels), frac_u);
+	uint16x4_t bottom = vmul_n_u16(vget_low_u16(bottomTexels), 0x100 - frac_u);
+	bottom = vmla_n_u16(bottom, vget_high_u16(bottomTexels), frac_u);
+
+	uint32x4_t sum = vmull_n_u16(top, 0x100 - frac_v);
+	sum = vmlal_n_u16(sum, bottom, frac_v);
+	const uint16x4_t res = vshrn_n_u32(sum, 16);
+	return vget_lane_u32(vreinterpret_u32_u8(vmovn_u16(vcombine_u16(res, res))), 0);
+#else
 	Vec4<int> texcolor_tl = Vec4<int>::FromRGBA(c.v[0]);
 	Vec4<int> texcolor_tr = Vec4<int>::FromRGBA(c.v[1]);
 	Vec4<int> texcolor_bl = Vec4<int>::FromRGBA(c.v[2]);
@@ -425,6 +486,48 @@ static u32 SampleLinear(int u[4], int v[4], int frac_u, int frac_v, const u8 *tp
 	Vec4<int> t = texcolor_tl * (0x100 - frac_u) + texcolor_tr * frac_u;
 	Vec4<int> b = texcolor_bl * (0x100 - frac_u) + texcolor_br * frac_u;
 	return ((t * (0x100 - frac_v) + b * frac_v) / (256 * 256)).ToRGBA();
+#endif
+}
+
+u32 BlendMipLevels(u32 c0, u32 c1, int frac) {
+#if defined(_M_SSE)
+	const __m128i zero = _mm_setzero_si128();
+	// c0 in the low half, c1 in the high half.
+	const __m128i texels = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(c0), _mm_cvtsi32_si128(c1)), zero);
+	const __m128i weights = _mm_set_epi16(frac, frac, frac, frac, 0x100 - frac, 0x100 - frac, 0x100 - frac, 0x100 - frac);
+	__m128i sum = _mm_mullo_epi16(texels, weights);
+	sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_srli_si128(sum, 8)), 8);
+	return _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+#elif PPSSPP_ARCH(ARM_NEON)
+	const uint16x4_t texels0 = vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(c0))));
+	const uint16x4_t texels1 = vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(c1))));
+	uint16x4_t sum = vmul_n_u16(texels0, 0x100 - frac);
+	sum = vmla_n_u16(sum, texels1, frac);
+	const uint8x8_t res = vshrn_n_u16(vcombine_u16(sum, sum), 8);
+	return vget_lane_u32(vreinterpret_u32_u8(res), 0);
+#else
+	Vec4<int> texcolor0 = Vec4<int>::FromRGBA(c0);
+	Vec4<int> texcolor1 = Vec4<int>::FromRGBA(c1);
+	return ((texcolor1 * frac + texcolor0 * (256 - frac)) / 256).ToRGBA();
+#endif
+}
+
+static u32 SampleLinear(int u[4], int v[4], int frac_u, int frac_v, const u8 *tptr, int bufw, int texlevel) {
+	Nearest4 c = SampleNearest<4>(u, v, tptr, bufw, texlevel);
+	return LinearBlend(c, frac_u, frac_v);
+}
+
+static u32 SampleNearestDecoded(int u, int v, const u8 *tptr, int bufw, int level) {
+	return ((const u32 *)tptr)[v * bufw + u];
+}
+
+static u32 SampleLinearDecoded(int u[4], int v[4], int frac_u, int frac_v, const u8 *tptr, int bufw, int level) {
+	const u32 *src = (const u32 *)tptr;
+	Nearest4 c;
+	for (int i = 0; i < 4; ++i) {
+		c.v[i] = src[v[i] * bufw + u[i]];
+	}
+	return LinearBlend(c, frac_u, frac_v);
 }
 
 };
@@ -19,6 +19,7 @@
 
 #include "ppsspp_config.h"
 
+#include <string>
 #include <unordered_map>
 #if PPSSPP_ARCH(ARM)
 #include "Common/ArmEmitter.h"
@@ -88,6 +89,12 @@ static inline Funcs GetFuncs() {
 	return f;
 }
 
+// Samplers for already decoded, unswizzled RGBA8888 texels, which don't depend on the texture state.
+Funcs GetDecodedFuncs();
+
+// Blends samples from two mip levels, frac is 0-256 towards c1.
+u32 BlendMipLevels(u32 c0, u32 c1, int frac);
+
 void Init();
 void Shutdown();
 
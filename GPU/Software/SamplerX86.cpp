@@ -238,7 +238,7 @@ LinearFunc SamplerJitCache::CompileLinear(const SamplerID &id) {
 	MOVD_xmm(fpScratchReg5, MDisp(RSP, 32));
 	CVTDQ2PS(fpScratchReg5, R(fpScratchReg5));
 	SHUFPS(fpScratchReg5, R(fpScratchReg5), _MM_SHUFFLE(0, 0, 0, 0));
-	if (RipAccessible(ones)) {
+	if (RipAccessible(by256)) {
 		MULPS(fpScratchReg5, M(by256));
 	} else {
 		MOV(PTRBITS, R(tempReg1), ImmPtr(by256));
@@ -34,9 +34,11 @@
 #include "profiler/profiler.h"
 #include "thin3d/thin3d.h"
 
+#include "GPU/Software/DrawPixel.h"
 #include "GPU/Software/Rasterizer.h"
 #include "GPU/Software/Sampler.h"
 #include "GPU/Software/SoftGpu.h"
+#include "GPU/Software/TexelCache.h"
 #include "GPU/Software/TransformUnit.h"
 #include "GPU/Common/DrawEngineCommon.h"
 #include "GPU/Common/FramebufferCommon.h"
@@ -113,6 +115,7 @@ SoftGPU::SoftGPU(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 	displayFormat_ = GE_FORMAT_8888;
 
 	Sampler::Init();
+	Rasterizer::Init();
 	drawEngine_ = new SoftwareDrawEngine();
 	drawEngineCommon_ = drawEngine_;
 }
@@ -126,6 +129,9 @@ void SoftGPU::DeviceRestore() {
 }
 
 SoftGPU::~SoftGPU() {
+	// The rasterizer is shut down below, so the list must not still be drawing.
+	StopGEThread();
+
 	texColor->Release();
 	texColor = nullptr;
 	texColorRBSwizzle->Release();
@@ -144,10 +150,13 @@ SoftGPU::~SoftGPU() {
 	samplerLinear->Release();
 	samplerLinear = nullptr;
 
+	Sampler::ClearTexelCache();
 	Sampler::Shutdown();
+	Rasterizer::Shutdown();
 }
 
 void SoftGPU::SetDisplayFramebuffer(u32 framebuf, u32 stride, GEBufferFormat format) {
+	SyncThread();
 	// Seems like this can point into RAM, but should be VRAM if not in RAM.
 	displayFramebuf_ = (framebuf & 0xFF000000) == 0 ? 0x44000000 | framebuf : framebuf;
 	displayStride_ = stride;
@@ -159,7 +168,7 @@ void SoftGPU::SetDisplayFramebuffer(u32 framebuf, u32 stride, GEBufferFormat for
 bool g_DarkStalkerStretch;
 
 void SoftGPU::ConvertTextureDescFrom16(Draw::TextureDesc &desc, int srcwidth, int srcheight) {
-	// TODO: This should probably be converted in a shader instead..
+	// Only used when the backend can't sample the 16-bit format directly.
 	fbTexBuffer_.resize(srcwidth * srcheight);
 	FormatBuffer displayBuffer;
 	displayBuffer.data = Memory::GetPointer(displayFramebuf_);
@@ -190,6 +199,41 @@ void SoftGPU::ConvertTextureDescFrom16(Draw::TextureDesc &desc, int srcwidth, in
 	desc.initData.push_back((uint8_t *)fbTexBuffer_.data());
 }
 
+// Picks a texture format that can take the 16-bit display data as is, so it's only swizzled when drawn.
+bool SoftGPU::Select16BitFormat(GEBufferFormat format, Draw::DataFormat *dataFormat, bool *swapRB) {
+	// The PSP formats have red in the lowest bits.  Matching formats with red on top need a RB swap.
+	Draw::DataFormat exact = Draw::DataFormat::UNDEFINED;
+	Draw::DataFormat swapped = Draw::DataFormat::UNDEFINED;
+	switch (format) {
+	case GE_FORMAT_565:
+		exact = Draw::DataFormat::B5G6R5_UNORM_PACK16;
+		swapped = Draw::DataFormat::R5G6B5_UNORM_PACK16;
+		break;
+	case GE_FORMAT_5551:
+		exact = Draw::DataFormat::A1B5G5R5_UNORM_PACK16;
+		swapped = Draw::DataFormat::A1R5G5B5_UNORM_PACK16;
+		break;
+	case GE_FORMAT_4444:
+		// There's no A4B4G4R4 format in thin3d.
+		swapped = Draw::DataFormat::A4R4G4B4_UNORM_PACK16;
+		break;
+	default:
+		return false;
+	}
+
+	if (exact != Draw::DataFormat::UNDEFINED && (draw_->GetDataFormatSupport(exact) & Draw::FMT_TEXTURE)) {
+		*dataFormat = exact;
+		*swapRB = false;
+		return true;
+	}
+	if (draw_->GetDataFormatSupport(swapped) & Draw::FMT_TEXTURE) {
+		*dataFormat = swapped;
+		*swapRB = true;
+		return true;
+	}
+	return false;
+}
+
 // Copies RGBA8 data from RAM to the currently bound render target.
 void SoftGPU::CopyToCurrentFboFromDisplayRam(int srcwidth, int srcheight) {
 	if (!draw_)
@@ -223,22 +267,15 @@ void SoftGPU::CopyToCurrentFboFromDisplayRam(int srcwidth, int srcheight) {
 	Draw::Pipeline *pipeline = texColor;
 	if (PSP_CoreParameter().compat.flags().DarkStalkersPresentHack && displayFormat_ == GE_FORMAT_5551 && g_DarkStalkerStretch) {
 		u8 *data = Memory::GetPointer(0x04088000);
-		bool fillDesc = true;
-		if (draw_->GetDataFormatSupport(Draw::DataFormat::A1B5G5R5_UNORM_PACK16) & Draw::FMT_TEXTURE) {
-			// The perfect one.
-			desc.format = Draw::DataFormat::A1B5G5R5_UNORM_PACK16;
-		} else if (draw_->GetDataFormatSupport(Draw::DataFormat::A1R5G5B5_UNORM_PACK16) & Draw::FMT_TEXTURE) {
-			// RB swapped, compensate with a shader.
-			desc.format = Draw::DataFormat::A1R5G5B5_UNORM_PACK16;
-			pipeline = texColorRBSwizzle;
-		} else {
-			ConvertTextureDescFrom16(desc, srcwidth, srcheight);
-			fillDesc = false;
-		}
-		if (fillDesc) {
+		bool swapRB = false;
+		if (Select16BitFormat(displayFormat_, &desc.format, &swapRB)) {
 			desc.width = displayStride_ == 0 ? srcwidth : displayStride_;
 			desc.height = srcheight;
 			desc.initData.push_back(data);
+			if (swapRB)
+				pipeline = texColorRBSwizzle;
+		} else {
+			ConvertTextureDescFrom16(desc, srcwidth, srcheight);
 		}
 		u0 = 64.5f / 512.0f;
 		u1 = 447.5f / 512.0f;
@@ -253,29 +290,21 @@ void SoftGPU::CopyToCurrentFboFromDisplayRam(int srcwidth, int srcheight) {
 		desc.height = srcheight;
 		desc.initData.push_back(data);
 		desc.format = Draw::DataFormat::R8G8B8A8_UNORM;
-	} else if (displayFormat_ == GE_FORMAT_5551) {
+	} else {
+		// Upload the 16-bit data directly where possible, and let the shader fix up the channel order.
 		u8 *data = Memory::GetPointer(displayFramebuf_);
-		bool fillDesc = true;
-		desc.format = Draw::DataFormat::A1R5G5B5_UNORM_PACK16;
-		if (draw_->GetDataFormatSupport(Draw::DataFormat::A1B5G5R5_UNORM_PACK16) & Draw::FMT_TEXTURE) {
-			// The perfect one.
-			desc.format = Draw::DataFormat::A1B5G5R5_UNORM_PACK16;
-		} else if (draw_->GetDataFormatSupport(Draw::DataFormat::A1R5G5B5_UNORM_PACK16) & Draw::FMT_TEXTURE) {
-			// RB swapped, compensate with a shader.
-			desc.format = Draw::DataFormat::A1R5G5B5_UNORM_PACK16;
-			pipeline = texColorRBSwizzle;
-		} else {
-			ConvertTextureDescFrom16(desc, srcwidth, srcheight);
-			fillDesc = false;
-		}
-		if (fillDesc) {
+		bool swapRB = false;
+		if (Select16BitFormat(displayFormat_, &desc.format, &swapRB)) {
 			desc.width = displayStride_ == 0 ? srcwidth : displayStride_;
 			desc.height = srcheight;
 			desc.initData.push_back(data);
+			if (swapRB)
+				pipeline = texColorRBSwizzle;
+		} else {
+			// Converted tightly packed, without the stride.
+			ConvertTextureDescFrom16(desc, srcwidth, srcheight);
+			u1 = 1.0f;
 		}
-	} else {
-		ConvertTextureDescFrom16(desc, srcwidth, srcheight);
-		u1 = 1.0f;
 	}
 	if (!hasImage) {
 		draw_->BindFramebufferAsRenderTarget(nullptr, { Draw::RPAction::CLEAR, Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE });
@@ -354,9 +383,16 @@ void SoftGPU::CopyToCurrentFboFromDisplayRam(int srcwidth, int srcheight) {
 }
 
 void SoftGPU::CopyDisplayToOutput() {
+	// Anything still drawing on the GE thread needs to land before we show it.
+	SyncThread();
 	// The display always shows 480x272.
 	CopyToCurrentFboFromDisplayRam(FB_WIDTH, FB_HEIGHT);
 	framebufferDirty_ = false;
+	if (clearTexelCacheNextFrame_) {
+		Sampler::ClearTexelCache();
+		clearTexelCacheNextFrame_ = false;
+	}
+	Sampler::NotifyTexelCacheFrame();
 
 	// Force the render params to 480x272 so other things work.
 	if (g_Config.IsPortrait()) {
@@ -720,6 +756,7 @@ void SoftGPU::ExecuteOp(u32 op, u32 diff) {
 
 			CBreakPoints::ExecMemCheck(srcBasePtr + (srcY * srcStride + srcX) * bpp, false, height * srcStride * bpp, currentMIPS->pc);
 			CBreakPoints::ExecMemCheck(dstBasePtr + (srcY * dstStride + srcX) * bpp, true, height * dstStride * bpp, currentMIPS->pc);
+			InvalidateCache(dstBasePtr + (dstY * dstStride + dstX) * bpp, height * dstStride * bpp, GPU_INVALIDATE_HINT);
 
 			// TODO: Correct timing appears to be 1.9, but erring a bit low since some of our other timing is inaccurate.
 			cyclesExecuted += ((height * width * bpp) * 16) / 10;
@@ -943,7 +980,14 @@ void SoftGPU::GetStats(char *buffer, size_t bufsize) {
 
 void SoftGPU::InvalidateCache(u32 addr, int size, GPUInvalidationType type)
 {
-	// Nothing to invalidate.
+	SyncThread();
+	// Only decoded textures are cached, the framebuffers always live in memory.
+	Sampler::InvalidateTexelCache(addr, size, type == GPU_INVALIDATE_ALL);
+}
+
+void SoftGPU::ClearCacheNextFrame()
+{
+	clearTexelCacheNextFrame_ = true;
 }
 
 void SoftGPU::NotifyVideoUpload(u32 addr, int size, int width, int format)
@@ -953,6 +997,8 @@ void SoftGPU::NotifyVideoUpload(u32 addr, int size, int width, int format)
 
 bool SoftGPU::PerformMemoryCopy(u32 dest, u32 src, int size)
 {
+	// The source may be a framebuffer the GE thread is still drawing to.
+	SyncThread();
 	// Nothing to update.
 	InvalidateCache(dest, size, GPU_INVALIDATE_HINT);
 	GPURecord::NotifyMemcpy(dest, src, size);
@@ -963,6 +1009,7 @@ bool SoftGPU::PerformMemoryCopy(u32 dest, u32 src, int size)
 
 bool SoftGPU::PerformMemorySet(u32 dest, u8 v, int size)
 {
+	SyncThread();
 	// Nothing to update.
 	InvalidateCache(dest, size, GPU_INVALIDATE_HINT);
 	GPURecord::NotifyMemset(dest, v, size);
@@ -973,6 +1020,7 @@ bool SoftGPU::PerformMemorySet(u32 dest, u8 v, int size)
 
 bool SoftGPU::PerformMemoryDownload(u32 dest, int size)
 {
+	SyncThread();
 	// Nothing to update.
 	InvalidateCache(dest, size, GPU_INVALIDATE_HINT);
 	return false;
@@ -980,6 +1028,7 @@ bool SoftGPU::PerformMemoryDownload(u32 dest, int size)
 
 bool SoftGPU::PerformMemoryUpload(u32 dest, int size)
 {
+	SyncThread();
 	// Nothing to update.
 	InvalidateCache(dest, size, GPU_INVALIDATE_HINT);
 	GPURecord::NotifyUpload(dest, size);
@@ -992,6 +1041,7 @@ bool SoftGPU::PerformStencilUpload(u32 dest, int size)
 }
 
 bool SoftGPU::FramebufferDirty() {
+	SyncThread();
 	if (g_Config.iFrameSkip != 0) {
 		bool dirty = framebufferDirty_;
 		framebufferDirty_ = false;
@@ -1001,6 +1051,7 @@ bool SoftGPU::FramebufferDirty() {
 }
 
 bool SoftGPU::GetCurrentFramebuffer(GPUDebugBuffer &buffer, GPUDebugFramebufferType type, int maxRes) {
+	SyncThread();
 	int x1 = gstate.getRegionX1();
 	int y1 = gstate.getRegionY1();
 	int x2 = gstate.getRegionX2() + 1;
@@ -1037,6 +1088,7 @@ bool SoftGPU::GetOutputFramebuffer(GPUDebugBuffer &buffer) {
 
 bool SoftGPU::GetCurrentDepthbuffer(GPUDebugBuffer &buffer)
 {
+	SyncThread();
 	const int w = gstate.getRegionX2() - gstate.getRegionX1() + 1;
 	const int h = gstate.getRegionY2() - gstate.getRegionY1() + 1;
 	buffer.Allocate(w, h, GPU_DBG_FORMAT_16BIT);
@@ -1054,16 +1106,19 @@ bool SoftGPU::GetCurrentDepthbuffer(GPUDebugBuffer &buffer)
 
 bool SoftGPU::GetCurrentStencilbuffer(GPUDebugBuffer &buffer)
 {
+	SyncThread();
 	return Rasterizer::GetCurrentStencilbuffer(buffer);
 }
 
 bool SoftGPU::GetCurrentTexture(GPUDebugBuffer &buffer, int level)
 {
+	SyncThread();
 	return Rasterizer::GetCurrentTexture(buffer, level);
 }
 
 bool SoftGPU::GetCurrentClut(GPUDebugBuffer &buffer)
 {
+	SyncThread();
 	const u32 bpp = gstate.getClutPaletteFormat() == GE_CMODE_32BIT_ABGR8888 ? 4 : 2;
 	const u32 pixels = 1024 / bpp;
 
@@ -1074,6 +1129,7 @@ bool SoftGPU::GetCurrentClut(GPUDebugBuffer &buffer)
 
 bool SoftGPU::GetCurrentSimpleVertices(int count, std::vector<GPUDebugVertex> &vertices, std::vector<u16> &indices)
 {
+	SyncThread();
 	return drawEngine_->transformUnit.GetCurrentSimpleVertices(count, vertices, indices);
 }
 
@@ -1083,5 +1139,9 @@ bool SoftGPU::DescribeCodePtr(const u8 *ptr, std::string &name) {
 		name = "SamplerJit:" + subname;
 		return true;
 	}
+	if (Rasterizer::DescribeCodePtr(ptr, subname)) {
+		name = "PixelJit:" + subname;
+		return true;
+	}
 	return false;
 }
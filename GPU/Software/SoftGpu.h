@@ -48,6 +48,10 @@ struct FormatBuffer {
 	inline u16 *Get16Ptr(int x, int y, int stride) {
 		return &as16[x + y * stride];
 	}
+
+	inline u32 *Get32Ptr(int x, int y, int stride) {
+		return &as32[x + y * stride];
+	}
 };
 
 class SoftwareDrawEngine;
@@ -71,7 +75,7 @@ class SoftGPU : public GPUCommon {
 	bool PerformMemoryDownload(u32 dest, int size) override;
 	bool PerformMemoryUpload(u32 dest, int size) override;
 	bool PerformStencilUpload(u32 dest, int size) override;
-	void ClearCacheNextFrame() override {}
+	void ClearCacheNextFrame() override;
 
 	void DeviceLost() override;
 	void DeviceRestore() override;
@@ -100,11 +104,18 @@ class SoftGPU : public GPUCommon {
 
 protected:
 	void FastRunLoop(DisplayList &list) override;
+	// Rasterizing on the GE thread lets the CPU keep running while a list draws.
+	bool SupportsGEThread() const override {
+		return true;
+	}
 	void CopyToCurrentFboFromDisplayRam(int srcwidth, int srcheight);
 	void ConvertTextureDescFrom16(Draw::TextureDesc &desc, int srcwidth, int srcheight);
+	bool Select16BitFormat(GEBufferFormat format, Draw::DataFormat *dataFormat, bool *swapRB);
 
 private:
 	bool framebufferDirty_;
+	// Decoded textures may be in use by a draw, so they're only dropped between frames.
+	bool clearTexelCacheNextFrame_ = false;
 	u32 displayFramebuf_;
 	u32 displayStride_;
 	GEBufferFormat displayFormat_;
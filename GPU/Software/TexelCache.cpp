@@ -0,0 +1,284 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "Core/Config.h"
+#include "Core/MemMap.h"
+#include "GPU/GPUState.h"
+#include "GPU/Common/TextureDecoder.h"
+#include "GPU/Software/TexelCache.h"
+
+extern u32 clut[4096];
+
+namespace Sampler {
+
+enum {
+	// Decoded textures unused for this many frames are freed.
+	TEXEL_CACHE_KILL_AGE = 60,
+	// Once over this, the least recently used textures are freed first.
+	TEXEL_CACHE_MAX_BYTES = 32 * 1024 * 1024,
+	// The PSP can't sample anything larger anyway.
+	TEXEL_CACHE_MAX_DIM = 512,
+};
+
+// Everything apart from the texture data itself that changes the decoded texels.
+struct TexelCacheParams {
+	u32 addr[8];
+	u16 width[8];
+	u16 height[8];
+	u16 bufw[8];
+	u32 clutformat;
+	u32 clutHash;
+	u8 texfmt;
+	u8 maxLevel;
+	bool swizzle;
+	bool sharedClut;
+};
+
+struct TexelCacheEntry {
+	TexelCacheParams params;
+	std::vector<u32> data;
+	u32 offset[8];
+	u32 srcBytes[8];
+	u32 dataHash;
+	u32 minAddr;
+	u32 maxAddr;
+	int lastValidatedFrame;
+	int lastUsedFrame;
+	// Set when the source memory may have changed, forcing a rehash on next use.
+	bool invalid;
+};
+
+static std::mutex texelCacheLock;
+static std::unordered_map<u64, TexelCacheEntry> texelCache;
+static size_t texelCacheBytes = 0;
+static int texelCacheFrame = 0;
+
+static bool IsWorthCaching(GETextureFormat texfmt, bool swizzle) {
+	switch (texfmt) {
+	case GE_TFMT_5650:
+	case GE_TFMT_5551:
+	case GE_TFMT_4444:
+	case GE_TFMT_8888:
+		// Linear direct color textures are about as cheap to sample as the decoded copy.
+		return swizzle;
+	default:
+		return true;
+	}
+}
+
+static bool ComputeParams(TexelCacheParams *params, u32 srcBytes[8], const BoundTexture &tex) {
+	memset(params, 0, sizeof(*params));
+	params->texfmt = gstate.getTextureFormat();
+	params->maxLevel = tex.maxLevel;
+	params->swizzle = gstate.isTextureSwizzled();
+
+	const bool isDXT = params->texfmt >= GE_TFMT_DXT1 && params->texfmt <= GE_TFMT_DXT5;
+	for (int i = 0; i <= tex.maxLevel; ++i) {
+		u32 texaddr = gstate.getTextureAddress(i);
+		int w = gstate.getTextureWidth(i);
+		int h = gstate.getTextureHeight(i);
+		// Anything in VRAM might be a render target, and drawing doesn't invalidate.
+		if (!tex.texptr[i] || Memory::IsVRAMAddress(texaddr))
+			return false;
+		if (w > TEXEL_CACHE_MAX_DIM || h > TEXEL_CACHE_MAX_DIM)
+			return false;
+
+		// Swizzled and DXT textures read whole blocks of rows.
+		int rows = params->swizzle ? (h + 7) & ~7 : (isDXT ? (h + 3) & ~3 : h);
+		srcBytes[i] = (textureBitsPerPixel[params->texfmt] * tex.texbufw[i] * rows) / 8;
+		if (!Memory::IsValidRange(texaddr, srcBytes[i]))
+			return false;
+
+		params->addr[i] = texaddr;
+		params->width[i] = w;
+		params->height[i] = h;
+		params->bufw[i] = tex.texbufw[i];
+	}
+
+	if (gstate.isTextureFormatIndexed()) {
+		params->clutformat = gstate.clutformat & 0x00FFFFFF;
+		// Only CLUT4 can use separate CLUTs per mipmap.
+		params->sharedClut = params->texfmt != GE_TFMT_CLUT4 || tex.maxLevel == 0 || gstate.isClutSharedForMipmaps();
+
+		// Only hash the entries that can actually be indexed.
+		const bool clut32 = gstate.getClutPaletteFormat() == GE_CMODE_32BIT_ABGR8888;
+		u32 entries = (gstate.getClutIndexMask() | (gstate.getClutIndexStartPos() & (clut32 ? 0xFF : 0x1FF))) + 1;
+		if (!params->sharedClut)
+			entries += tex.maxLevel * 16;
+		params->clutHash = DoReliableHash32(clut, entries * (clut32 ? 4 : 2), 0);
+	}
+
+	return true;
+}
+
+static u32 HashSource(const TexelCacheEntry &entry) {
+	u32 hash = 0;
+	for (int i = 0; i <= entry.params.maxLevel; ++i) {
+		hash = DoReliableHash32(Memory::GetPointerUnchecked(entry.params.addr[i]), entry.srcBytes[i], hash);
+	}
+	return hash;
+}
+
+static void DecodeLevels(TexelCacheEntry *entry, const BoundTexture &tex) {
+	const TexelCacheParams &params = entry->params;
+	for (int i = 0; i <= params.maxLevel; ++i) {
+		const int w = params.width[i];
+		const int h = params.height[i];
+		u32 *dst = entry->data.data() + entry->offset[i];
+		for (int y = 0; y < h; ++y) {
+			for (int x = 0; x < w; ++x) {
+				dst[y * w + x] = tex.funcs.nearest(x, y, tex.texptr[i], tex.texbufw[i], i);
+			}
+		}
+	}
+}
+
+static void EvictForSpace(size_t bytes) {
+	while (!texelCache.empty() && texelCacheBytes + bytes > TEXEL_CACHE_MAX_BYTES) {
+		auto oldest = texelCache.begin();
+		for (auto it = texelCache.begin(); it != texelCache.end(); ++it) {
+			if (it->second.lastUsedFrame < oldest->second.lastUsedFrame)
+				oldest = it;
+		}
+		texelCacheBytes -= oldest->second.data.size() * sizeof(u32);
+		texelCache.erase(oldest);
+	}
+}
+
+static TexelCacheEntry *CreateEntry(u64 key, const TexelCacheParams &params, const u32 srcBytes[8]) {
+	u32 texels = 0;
+	u32 offset[8]{};
+	for (int i = 0; i <= params.maxLevel; ++i) {
+		offset[i] = texels;
+		texels += params.width[i] * params.height[i];
+	}
+	EvictForSpace(texels * sizeof(u32));
+
+	TexelCacheEntry &entry = texelCache[key];
+	entry.params = params;
+	entry.data.resize(texels);
+	memcpy(entry.offset, offset, sizeof(offset));
+	memcpy(entry.srcBytes, srcBytes, sizeof(entry.srcBytes));
+	entry.minAddr = 0xFFFFFFFF;
+	entry.maxAddr = 0;
+	for (int i = 0; i <= params.maxLevel; ++i) {
+		entry.minAddr = std::min(entry.minAddr, params.addr[i]);
+		entry.maxAddr = std::max(entry.maxAddr, params.addr[i] + srcBytes[i]);
+	}
+	texelCacheBytes += texels * sizeof(u32);
+	return &entry;
+}
+
+void GetBoundTexture(BoundTexture *tex) {
+	tex->maxLevel = gstate.isMipmapEnabled() ? gstate.getTextureMaxLevel() : 0;
+	GETextureFormat texfmt = gstate.getTextureFormat();
+	for (int i = 0; i < 8; ++i) {
+		tex->texptr[i] = nullptr;
+		tex->texbufw[i] = 0;
+	}
+	for (int i = 0; i <= tex->maxLevel; ++i) {
+		u32 texaddr = gstate.getTextureAddress(i);
+		tex->texbufw[i] = GetTextureBufw(i, texaddr, texfmt);
+		if (Memory::IsValidAddress(texaddr))
+			tex->texptr[i] = Memory::GetPointerUnchecked(texaddr);
+	}
+	tex->funcs = GetFuncs();
+
+	if (!g_Config.bSoftwareTexelCache || !IsWorthCaching(texfmt, gstate.isTextureSwizzled()))
+		return;
+
+	TexelCacheParams params;
+	u32 srcBytes[8]{};
+	if (!ComputeParams(&params, srcBytes, *tex))
+		return;
+
+	// The address keeps different textures apart, the rest mostly separates palettes.
+	u64 key = ((u64)params.addr[0] << 32) | DoReliableHash32(&params, sizeof(params), 0);
+
+	std::lock_guard<std::mutex> guard(texelCacheLock);
+	TexelCacheEntry *entry = nullptr;
+	auto it = texelCache.find(key);
+	if (it != texelCache.end()) {
+		if (memcmp(&it->second.params, &params, sizeof(params)) == 0) {
+			entry = &it->second;
+		} else {
+			texelCacheBytes -= it->second.data.size() * sizeof(u32);
+			texelCache.erase(it);
+		}
+	}
+
+	if (!entry) {
+		entry = CreateEntry(key, params, srcBytes);
+		entry->dataHash = HashSource(*entry);
+		DecodeLevels(entry, *tex);
+		entry->lastValidatedFrame = texelCacheFrame;
+		entry->invalid = false;
+	} else if (entry->invalid || entry->lastValidatedFrame != texelCacheFrame) {
+		u32 hash = HashSource(*entry);
+		if (hash != entry->dataHash) {
+			entry->dataHash = hash;
+			DecodeLevels(entry, *tex);
+		}
+		entry->lastValidatedFrame = texelCacheFrame;
+		entry->invalid = false;
+	}
+	entry->lastUsedFrame = texelCacheFrame;
+
+	for (int i = 0; i <= tex->maxLevel; ++i) {
+		tex->texptr[i] = (u8 *)(entry->data.data() + entry->offset[i]);
+		tex->texbufw[i] = params.width[i];
+	}
+	tex->funcs = GetDecodedFuncs();
+}
+
+void InvalidateTexelCache(u32 addr, int size, bool all) {
+	// Only marked here, the draw might be using the texels, and the hash may still match.
+	addr &= 0x3FFFFFFF;
+
+	std::lock_guard<std::mutex> guard(texelCacheLock);
+	for (auto &it : texelCache) {
+		TexelCacheEntry &entry = it.second;
+		if (all || (addr < entry.maxAddr && addr + size > entry.minAddr))
+			entry.invalid = true;
+	}
+}
+
+void NotifyTexelCacheFrame() {
+	std::lock_guard<std::mutex> guard(texelCacheLock);
+	texelCacheFrame++;
+	for (auto it = texelCache.begin(); it != texelCache.end(); ) {
+		if (it->second.lastUsedFrame + TEXEL_CACHE_KILL_AGE < texelCacheFrame) {
+			texelCacheBytes -= it->second.data.size() * sizeof(u32);
+			it = texelCache.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void ClearTexelCache() {
+	std::lock_guard<std::mutex> guard(texelCacheLock);
+	texelCache.clear();
+	texelCacheBytes = 0;
+}
+
+};
@@ -0,0 +1,45 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include "Common/CommonTypes.h"
+#include "GPU/Software/Sampler.h"
+
+namespace Sampler {
+
+// Everything needed to sample the current texture, set up once per draw.
+struct BoundTexture {
+	Funcs funcs;
+	int maxLevel;
+	u8 *texptr[8];
+	int texbufw[8];
+};
+
+// Reads the texture state.  If the texel cache is enabled and the texture is expensive to decode,
+// texptr points at decoded RGBA8888 texels (with bufw == width) and funcs are the decoded samplers.
+// Decoded data is only valid until the next call, so the draw must finish before then.
+// Note that u/v must stay within the texture size, which is not true of 1:1 sprites.
+void GetBoundTexture(BoundTexture *tex);
+
+// Marks decoded textures overlapping the range as needing a recheck of their source data.
+void InvalidateTexelCache(u32 addr, int size, bool all);
+// Each texture is rehashed at most once a frame, and unused ones are freed.
+void NotifyTexelCacheFrame();
+void ClearTexelCache();
+
+};
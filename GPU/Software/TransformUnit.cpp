@@ -15,7 +15,10 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <new>
 #include "math/math_util.h"
 #include "Common/MemoryUtil.h"
 #include "Core/Config.h"
@@ -27,6 +30,7 @@
 #include "GPU/Software/TransformUnit.h"
 #include "GPU/Software/Clipper.h"
 #include "GPU/Software/Lighting.h"
+#include "GPU/Software/Rasterizer.h"
 #include "GPU/Software/RasterizerRectangle.h"
 
 #define TRANSFORM_BUF_SIZE (65536 * 48)
@@ -37,6 +41,9 @@ TransformUnit::TransformUnit() {
 
 TransformUnit::~TransformUnit() {
 	FreeMemoryPages(buf, DECODED_VERTEX_BUFFER_SIZE);
+	if (vertexCache_)
+		FreeAlignedMemory(vertexCache_);
+	delete [] vertexOutside_;
 }
 
 SoftwareDrawEngine::SoftwareDrawEngine() {
@@ -152,10 +159,10 @@ ScreenCoords TransformUnit::DrawingToScreen(const DrawingCoords& coords)
 	return ret;
 }
 
-VertexData TransformUnit::ReadVertex(VertexReader& vreader)
+// Reads the attributes and applies skinning, leaving the model position in vertex.modelpos.
+// In through mode, the vertex is complete after this.
+void TransformUnit::DecodeVertex(VertexReader &vreader, VertexData &vertex)
 {
-	VertexData vertex;
-
 	float pos[3];
 	// VertexDecoder normally scales z, but we want it unscaled.
 	vreader.ReadPosThroughZ16(pos);
@@ -214,78 +221,191 @@ VertexData TransformUnit::ReadVertex(VertexReader& vreader)
 
 	if (!gstate.isModeThrough()) {
 		vertex.modelpos = ModelCoords(pos[0], pos[1], pos[2]);
+	} else {
+		vertex.screenpos.x = (int)(pos[0] * 16) + gstate.getOffsetX16();
+		vertex.screenpos.y = (int)(pos[1] * 16) + gstate.getOffsetY16();
+		vertex.screenpos.z = pos[2];
+		vertex.clippos.w = 1.f;
+		vertex.fogdepth = 1.f;
+	}
+}
+
+// Transforms modelpos to worldpos and clippos for count vertices, also returning the view space z.
+// Vertices are done four at a time with SSE, in the same order of operations as the scalar functions.
+void TransformUnit::TransformPositions(VertexData *vertices, float *viewz, int count)
+{
+	int i = 0;
+#if defined(_M_SSE)
+	const float *w = gstate.worldMatrix;
+	const float *v = gstate.viewMatrix;
+	const float *p = gstate.projMatrix;
+
+	// Multiplies the first three rows of mat (column major) by x, y, z then adds the translation.
+	auto transform3 = [](const float *mat, int row, __m128 x, __m128 y, __m128 z) {
+		__m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(mat[row]), x), _mm_mul_ps(_mm_set1_ps(mat[row + 3]), y));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(mat[row + 6]), z));
+		return _mm_add_ps(r, _mm_set1_ps(mat[row + 9]));
+	};
+	auto project = [](const float *mat, int row, __m128 x, __m128 y, __m128 z) {
+		__m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(mat[row]), x), _mm_mul_ps(_mm_set1_ps(mat[row + 4]), y));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(mat[row + 8]), z));
+		return _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(mat[row + 12]), _mm_set1_ps(1.0f)));
+	};
+
+	for (; i + 4 <= count; i += 4) {
+		VertexData *vd = vertices + i;
+		const __m128 mx = _mm_setr_ps(vd[0].modelpos.x, vd[1].modelpos.x, vd[2].modelpos.x, vd[3].modelpos.x);
+		const __m128 my = _mm_setr_ps(vd[0].modelpos.y, vd[1].modelpos.y, vd[2].modelpos.y, vd[3].modelpos.y);
+		const __m128 mz = _mm_setr_ps(vd[0].modelpos.z, vd[1].modelpos.z, vd[2].modelpos.z, vd[3].modelpos.z);
+
+		const __m128 wx = transform3(w, 0, mx, my, mz);
+		const __m128 wy = transform3(w, 1, mx, my, mz);
+		const __m128 wz = transform3(w, 2, mx, my, mz);
+		const __m128 vx = transform3(v, 0, wx, wy, wz);
+		const __m128 vy = transform3(v, 1, wx, wy, wz);
+		const __m128 vz = transform3(v, 2, wx, wy, wz);
+
+		alignas(16) float out[8][4];
+		_mm_store_ps(out[0], wx);
+		_mm_store_ps(out[1], wy);
+		_mm_store_ps(out[2], wz);
+		_mm_store_ps(out[3], project(p, 0, vx, vy, vz));
+		_mm_store_ps(out[4], project(p, 1, vx, vy, vz));
+		_mm_store_ps(out[5], project(p, 2, vx, vy, vz));
+		_mm_store_ps(out[6], project(p, 3, vx, vy, vz));
+		_mm_storeu_ps(viewz + i, vz);
+
+		for (int j = 0; j < 4; ++j) {
+			vd[j].worldpos = WorldCoords(out[0][j], out[1][j], out[2][j]);
+			vd[j].clippos = ClipCoords(out[3][j], out[4][j], out[5][j], out[6][j]);
+		}
+	}
+#endif
+
+	for (; i < count; ++i) {
+		VertexData &vertex = vertices[i];
 		vertex.worldpos = WorldCoords(TransformUnit::ModelToWorld(vertex.modelpos));
 		ModelCoords viewpos = TransformUnit::WorldToView(vertex.worldpos);
 		vertex.clippos = ClipCoords(TransformUnit::ViewToClip(viewpos));
-		if (gstate.isFogEnabled()) {
-			float fog_end = getFloat24(gstate.fog1);
-			float fog_slope = getFloat24(gstate.fog2);
-			// Same fixup as in ShaderManagerGLES.cpp
-			if (my_isnanorinf(fog_end)) {
-				// Not really sure what a sensible value might be, but let's try 64k.
-				fog_end = std::signbit(fog_end) ? -65535.0f : 65535.0f;
-			}
-			if (my_isnanorinf(fog_slope)) {
-				fog_slope = std::signbit(fog_slope) ? -65535.0f : 65535.0f;
-			}
-			vertex.fogdepth = (viewpos.z + fog_end) * fog_slope;
-		} else {
-			vertex.fogdepth = 1.0f;
-		}
-		vertex.screenpos = ClipToScreenInternal(vertex.clippos, &outside_range_flag);
+		viewz[i] = viewpos.z;
+	}
+}
 
-		if (vreader.hasNormal()) {
-			vertex.worldnormal = TransformUnit::ModelToWorldNormal(vertex.normal);
-			vertex.worldnormal /= vertex.worldnormal.Length();
-		} else {
-			vertex.worldnormal = Vec3<float>(0.0f, 0.0f, 1.0f);
+// Everything after the position transform: fog, screen coordinates, texgen and lighting.
+void TransformUnit::FinishVertex(VertexReader &vreader, VertexData &vertex, float viewz)
+{
+	if (gstate.isFogEnabled()) {
+		float fog_end = getFloat24(gstate.fog1);
+		float fog_slope = getFloat24(gstate.fog2);
+		// Same fixup as in ShaderManagerGLES.cpp
+		if (my_isnanorinf(fog_end)) {
+			// Not really sure what a sensible value might be, but let's try 64k.
+			fog_end = std::signbit(fog_end) ? -65535.0f : 65535.0f;
 		}
+		if (my_isnanorinf(fog_slope)) {
+			fog_slope = std::signbit(fog_slope) ? -65535.0f : 65535.0f;
+		}
+		vertex.fogdepth = (viewz + fog_end) * fog_slope;
+	} else {
+		vertex.fogdepth = 1.0f;
+	}
+	vertex.screenpos = ClipToScreenInternal(vertex.clippos, &outside_range_flag);
 
-		// Time to generate some texture coords.  Lighting will handle shade mapping.
-		if (gstate.getUVGenMode() == GE_TEXMAP_TEXTURE_MATRIX) {
-			Vec3f source;
-			switch (gstate.getUVProjMode()) {
-			case GE_PROJMAP_POSITION:
-				source = vertex.modelpos;
-				break;
+	if (vreader.hasNormal()) {
+		vertex.worldnormal = TransformUnit::ModelToWorldNormal(vertex.normal);
+		vertex.worldnormal /= vertex.worldnormal.Length();
+	} else {
+		vertex.worldnormal = Vec3<float>(0.0f, 0.0f, 1.0f);
+	}
 
-			case GE_PROJMAP_UV:
-				source = Vec3f(vertex.texturecoords, 0.0f);
-				break;
+	// Time to generate some texture coords.  Lighting will handle shade mapping.
+	if (gstate.getUVGenMode() == GE_TEXMAP_TEXTURE_MATRIX) {
+		Vec3f source;
+		switch (gstate.getUVProjMode()) {
+		case GE_PROJMAP_POSITION:
+			source = vertex.modelpos;
+			break;
 
-			case GE_PROJMAP_NORMALIZED_NORMAL:
-				source = vertex.normal.Normalized();
-				break;
+		case GE_PROJMAP_UV:
+			source = Vec3f(vertex.texturecoords, 0.0f);
+			break;
 
-			case GE_PROJMAP_NORMAL:
-				source = vertex.normal;
-				break;
+		case GE_PROJMAP_NORMALIZED_NORMAL:
+			source = vertex.normal.Normalized();
+			break;
 
-			default:
-				source = Vec3f::AssignToAll(0.0f);
-				ERROR_LOG_REPORT(G3D, "Software: Unsupported UV projection mode %x", gstate.getUVProjMode());
-				break;
-			}
+		case GE_PROJMAP_NORMAL:
+			source = vertex.normal;
+			break;
 
-			// TODO: What about uv scale and offset?
-			Mat3x3<float> tgen(gstate.tgenMatrix);
-			Vec3<float> stq = tgen * source + Vec3<float>(gstate.tgenMatrix[9], gstate.tgenMatrix[10], gstate.tgenMatrix[11]);
-			float z_recip = 1.0f / stq.z;
-			vertex.texturecoords = Vec2f(stq.x * z_recip, stq.y * z_recip);
+		default:
+			source = Vec3f::AssignToAll(0.0f);
+			ERROR_LOG_REPORT(G3D, "Software: Unsupported UV projection mode %x", gstate.getUVProjMode());
+			break;
 		}
 
-		Lighting::Process(vertex, vreader.hasColor0());
-	} else {
-		vertex.screenpos.x = (int)(pos[0] * 16) + gstate.getOffsetX16();
-		vertex.screenpos.y = (int)(pos[1] * 16) + gstate.getOffsetY16();
-		vertex.screenpos.z = pos[2];
-		vertex.clippos.w = 1.f;
-		vertex.fogdepth = 1.f;
+		// TODO: What about uv scale and offset?
+		Mat3x3<float> tgen(gstate.tgenMatrix);
+		Vec3<float> stq = tgen * source + Vec3<float>(gstate.tgenMatrix[9], gstate.tgenMatrix[10], gstate.tgenMatrix[11]);
+		float z_recip = 1.0f / stq.z;
+		vertex.texturecoords = Vec2f(stq.x * z_recip, stq.y * z_recip);
 	}
 
+	Lighting::Process(vertex, vreader.hasColor0());
+}
+
+VertexData TransformUnit::ReadVertex(VertexReader& vreader)
+{
+	VertexData vertex;
+	DecodeVertex(vreader, vertex);
+	if (!gstate.isModeThrough()) {
+		float viewz;
+		TransformPositions(&vertex, &viewz, 1);
+		FinishVertex(vreader, vertex, viewz);
+	}
 	return vertex;
 }
 
+void TransformUnit::ReadVertices(VertexReader &vreader, int count)
+{
+	if (count > vertexCacheSize_) {
+		if (vertexCache_)
+			FreeAlignedMemory(vertexCache_);
+		delete [] vertexOutside_;
+		vertexCacheSize_ = std::max(count, 1024);
+		vertexCache_ = (VertexData *)AllocateAlignedMemory(sizeof(VertexData) * vertexCacheSize_, 16);
+		vertexOutside_ = new bool[vertexCacheSize_];
+	}
+
+	for (int i = 0; i < count; ++i) {
+		vreader.Goto(i);
+		new (&vertexCache_[i]) VertexData();
+		DecodeVertex(vreader, vertexCache_[i]);
+	}
+
+	if (gstate.isModeThrough()) {
+		memset(vertexOutside_, 0, sizeof(bool) * count);
+		return;
+	}
+
+	// The flag may be pending from an incomplete prim in a previous draw.
+	const bool pendingOutside = outside_range_flag;
+
+	// Batches keep the view z values on the stack.
+	enum { BATCH_SIZE = 64 };
+	float viewz[BATCH_SIZE];
+	for (int start = 0; start < count; start += BATCH_SIZE) {
+		const int batch = std::min(count - start, (int)BATCH_SIZE);
+		TransformPositions(vertexCache_ + start, viewz, batch);
+		for (int i = 0; i < batch; ++i) {
+			outside_range_flag = false;
+			FinishVertex(vreader, vertexCache_[start + i], viewz[i]);
+			vertexOutside_[start + i] = outside_range_flag;
+		}
+	}
+	outside_range_flag = pendingOutside;
+}
+
 #define START_OPEN_U 1
 #define END_OPEN_U 2
 #define START_OPEN_V 4
@@ -341,8 +461,16 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 	default: vtcs_per_prim = 0; break;
 	}
 
-	// TODO: Do this in two passes - first process the vertices (before indexing/stripping),
-	// then resolve the indices. This lets us avoid transforming shared vertices twice.
+	// Process the vertices first (before indexing/stripping), then resolve the indices.
+	// This lets us avoid transforming shared vertices twice, and transform in batches.
+	ReadVertices(vreader, vertex_count == 0 ? 0 : index_upper_bound - index_lower_bound + 1);
+	auto readVertex = [&](int vtx) -> const VertexData & {
+		const int index = indices ? ConvertIndex(vtx) - index_lower_bound : vtx;
+		// Like ReadVertex(), this only sets the flag so it accumulates over a prim's vertices.
+		if (vertexOutside_[index])
+			outside_range_flag = true;
+		return vertexCache_[index];
+	};
 
 	switch (prim_type) {
 	case GE_PRIM_POINTS:
@@ -351,13 +479,7 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 	case GE_PRIM_RECTANGLES:
 		{
 			for (int vtx = 0; vtx < vertex_count; ++vtx) {
-				if (indices) {
-					vreader.Goto(ConvertIndex(vtx) - index_lower_bound);
-				} else {
-					vreader.Goto(vtx);
-				}
-
-				data[data_index++] = ReadVertex(vreader);
+				data[data_index++] = readVertex(vtx);
 				if (data_index < vtcs_per_prim) {
 					// Keep reading.  Note: an incomplete prim will stay read for GE_PRIM_KEEP_PREVIOUS.
 					continue;
@@ -410,13 +532,7 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 			// If data_index is 1 or 2, etc., it means we're continuing a line strip.
 			int skip_count = data_index == 0 ? 1 : 0;
 			for (int vtx = 0; vtx < vertex_count; ++vtx) {
-				if (indices) {
-					vreader.Goto(ConvertIndex(vtx) - index_lower_bound);
-				} else {
-					vreader.Goto(vtx);
-				}
-
-				data[(data_index++) & 1] = ReadVertex(vreader);
+				data[(data_index++) & 1] = readVertex(vtx);
 				if (outside_range_flag) {
 					// Drop all primitives containing the current vertex
 					skip_count = 2;
@@ -443,13 +559,7 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 			// This is for Darkstalkers (and should speed up many 2D games).
 			if (vertex_count == 4 && gstate.isModeThrough()) {
 				for (int vtx = 0; vtx < 4; ++vtx) {
-					if (indices) {
-						vreader.Goto(ConvertIndex(vtx) - index_lower_bound);
-					}
-					else {
-						vreader.Goto(vtx);
-					}
-					data[vtx] = ReadVertex(vreader);
+					data[vtx] = readVertex(vtx);
 				}
 
 				// If a strip is effectively a rectangle, draw it as such!
@@ -460,14 +570,8 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 			}
 
 			for (int vtx = 0; vtx < vertex_count; ++vtx) {
-				if (indices) {
-					vreader.Goto(ConvertIndex(vtx) - index_lower_bound);
-				} else {
-					vreader.Goto(vtx);
-				}
-
 				int provoking_index = (data_index++) % 3;
-				data[provoking_index] = ReadVertex(vreader);
+				data[provoking_index] = readVertex(vtx);
 				if (outside_range_flag) {
 					// Drop all primitives containing the current vertex
 					skip_count = 2;
@@ -503,25 +607,14 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 
 			// Only read the central vertex if we're not continuing.
 			if (data_index == 0) {
-				if (indices) {
-					vreader.Goto(ConvertIndex(0) - index_lower_bound);
-				} else {
-					vreader.Goto(0);
-				}
-				data[0] = ReadVertex(vreader);
+				data[0] = readVertex(0);
 				data_index++;
 				start_vtx = 1;
 			}
 
 			for (int vtx = start_vtx; vtx < vertex_count; ++vtx) {
-				if (indices) {
-					vreader.Goto(ConvertIndex(vtx) - index_lower_bound);
-				} else {
-					vreader.Goto(vtx);
-				}
-
 				int provoking_index = 2 - ((data_index++) % 2);
-				data[provoking_index] = ReadVertex(vreader);
+				data[provoking_index] = readVertex(vtx);
 				if (outside_range_flag) {
 					// Drop all primitives containing the current vertex
 					skip_count = 2;
@@ -553,6 +646,9 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 		break;
 	}
 
+	// All triangles use the same state, so they can be drawn together now.
+	Rasterizer::FlushTriangles();
+
 	GPUDebug::NotifyDraw();
 }
 
@@ -136,6 +136,17 @@ class TransformUnit {
 
 	bool outside_range_flag = false;
 	u8 *buf;
+
+private:
+	void DecodeVertex(VertexReader &vreader, VertexData &vertex);
+	void TransformPositions(VertexData *vertices, float *viewz, int count);
+	void FinishVertex(VertexReader &vreader, VertexData &vertex, float viewz);
+	// Reads and transforms all count vertices of a draw into vertexCache_, so shared vertices are only done once.
+	void ReadVertices(VertexReader &vreader, int count);
+
+	VertexData *vertexCache_ = nullptr;
+	bool *vertexOutside_ = nullptr;
+	int vertexCacheSize_ = 0;
 };
 
 class SoftwareDrawEngine : public DrawEngineCommon {
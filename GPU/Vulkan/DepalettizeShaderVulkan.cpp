@@ -97,7 +97,7 @@ DepalShaderVulkan *DepalShaderCacheVulkan::GetDepalettizeShader(uint32_t clutMod
 	VkRenderPass rp = (VkRenderPass)draw_->GetNativeObject(Draw::NativeObject::FRAMEBUFFER_RENDERPASS);
 
 	char *buffer = new char[2048];
-	GenerateDepalShader(buffer, pixelFormat, GLSL_VULKAN);
+	GenerateDepalShader(buffer, clutMode, pixelFormat, GLSL_VULKAN);
 
 	std::string error;
 	VkShaderModule fshader = CompileShaderModule(vulkan_, VK_SHADER_STAGE_FRAGMENT_BIT, buffer, &error);
@@ -181,3 +181,14 @@ void DepalShaderCacheVulkan::Decimate() {
 		}
 	}
 }
+
+void DepalShaderCacheVulkan::Precompile() {
+	// Needs the Vulkan2D helper for the pipelines.
+	if (!vulkan2D_ || vshader_ == VK_NULL_HANDLE)
+		return;
+	std::vector<std::pair<uint32_t, GEBufferFormat>> variants;
+	GetCommonVariants(variants);
+	for (const auto &variant : variants) {
+		GetDepalettizeShader(variant.first, variant.second);
+	}
+}
@@ -60,6 +60,8 @@ class DepalShaderCacheVulkan : public DepalShaderCacheCommon {
 	VulkanTexture *GetClutTexture(GEPaletteFormat clutFormat, const u32 clutHash, u32 *rawClut);
 	void Clear();
 	void Decimate();
+	// Compiles the common variants up front, so the first use doesn't stutter.
+	void Precompile();
 
 	void SetVulkan2D(Vulkan2D *vk2d) { vulkan2D_ = vk2d; }
 	void SetPushBuffer(VulkanPushBuffer *push) { push_ = push; }
@@ -50,6 +50,7 @@
 #include "GPU/Vulkan/PipelineManagerVulkan.h"
 #include "GPU/Vulkan/FramebufferVulkan.h"
 #include "GPU/Vulkan/GPU_Vulkan.h"
+#include "GPU/Vulkan/VertexDecoderComputeVulkan.h"
 
 
 enum {
@@ -57,7 +58,8 @@ enum {
 };
 
 #define VERTEXCACHE_DECIMATION_INTERVAL 17
-#define DESCRIPTORSET_DECIMATION_INTERVAL 1  // Temporarily cut to 1. Handle reuse breaks this when textures get deleted.
+// Counted in uses of each frame slot. Sets are also dropped early if handles may have been reused, see below.
+#define DESCRIPTORSET_DECIMATION_INTERVAL 60
 
 enum { VAI_KILL_AGE = 120, VAI_UNRELIABLE_KILL_AGE = 240, VAI_UNRELIABLE_KILL_MAX = 4 };
 
@@ -71,12 +73,16 @@ enum {
 	DRAW_BINDING_TESS_STORAGE_BUF = 6,
 	DRAW_BINDING_TESS_STORAGE_BUF_WU = 7,
 	DRAW_BINDING_TESS_STORAGE_BUF_WV = 8,
+	DRAW_BINDING_INPUT_ATTACHMENT = 9,
 };
 
 enum {
 	TRANSFORMED_VERTEX_BUFFER_SIZE = VERTEX_BUFFER_MAX * sizeof(TransformedVertex)
 };
 
+// Below this, the copy and dispatch cost more than the CPU decoder.
+enum { COMPUTE_DECODE_MIN_VERTS = 2048 };
+
 DrawEngineVulkan::DrawEngineVulkan(VulkanContext *vulkan, Draw::DrawContext *draw)
 	:	vulkan_(vulkan),
 		draw_(draw),
@@ -97,7 +103,7 @@ DrawEngineVulkan::DrawEngineVulkan(VulkanContext *vulkan, Draw::DrawContext *dra
 
 void DrawEngineVulkan::InitDeviceObjects() {
 	// All resources we need for PSP drawing. Usually only bindings 0 and 2-4 are populated.
-	VkDescriptorSetLayoutBinding bindings[9]{};
+	VkDescriptorSetLayoutBinding bindings[10]{};
 	bindings[0].descriptorCount = 1;
 	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -135,6 +141,11 @@ void DrawEngineVulkan::InitDeviceObjects() {
 	bindings[8].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 	bindings[8].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 	bindings[8].binding = DRAW_BINDING_TESS_STORAGE_BUF_WV;
+	// Used only for shader blending with framebuffer fetch.
+	bindings[9].descriptorCount = 1;
+	bindings[9].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+	bindings[9].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	bindings[9].binding = DRAW_BINDING_INPUT_ATTACHMENT;
 
 	VkDevice device = vulkan_->GetDevice();
 
@@ -144,16 +155,17 @@ void DrawEngineVulkan::InitDeviceObjects() {
 	VkResult res = vkCreateDescriptorSetLayout(device, &dsl, nullptr, &descriptorSetLayout_);
 	assert(VK_SUCCESS == res);
 
-	// We are going to use one-shot descriptors in the initial implementation. Might look into caching them
-	// if creating and updating them turns out to be expensive.
+	// These are rings covering all in-flight frames, so they're sized for MAX_INFLIGHT_FRAMES worth of data.
+	// Note that pushUBO is also used for tessellation data (search for SetPushBuffer), and to upload
+	// the null texture. This should be cleaned up...
+	const size_t frames = VulkanContext::MAX_INFLIGHT_FRAMES;
+	pushUBO_ = new VulkanPushBuffer(vulkan_, frames * 8 * 1024 * 1024, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	// Storage is for compute vertex decoding.
+	pushVertex_ = new VulkanPushBuffer(vulkan_, frames * 2 * 1024 * 1024, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	pushIndex_ = new VulkanPushBuffer(vulkan_, frames * 1 * 1024 * 1024, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
 	for (int i = 0; i < VulkanContext::MAX_INFLIGHT_FRAMES; i++) {
 		// We now create descriptor pools on demand, so removed from here.
-		// Note that pushUBO is also used for tessellation data (search for SetPushBuffer), and to upload
-		// the null texture. This should be cleaned up...
-		frame_[i].pushUBO = new VulkanPushBuffer(vulkan_, 8 * 1024 * 1024, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-		frame_[i].pushVertex = new VulkanPushBuffer(vulkan_, 2 * 1024 * 1024, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-		frame_[i].pushIndex = new VulkanPushBuffer(vulkan_, 1 * 1024 * 1024, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
-
 		frame_[i].pushLocal = new VulkanPushBuffer(vulkan_, 1 * 1024 * 1024, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 	}
 
@@ -178,7 +190,7 @@ void DrawEngineVulkan::InitDeviceObjects() {
 	res = vkCreateSampler(device, &samp, nullptr, &nullSampler_);
 	assert(VK_SUCCESS == res);
 
-	vertexCache_ = new VulkanPushBuffer(vulkan_, VERTEX_CACHE_SIZE, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+	vertexCache_ = new VulkanPushBuffer(vulkan_, VERTEX_CACHE_SIZE, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
 
 	tessDataTransferVulkan = new TessellationDataTransferVulkan(vulkan_);
 	tessDataTransfer = tessDataTransferVulkan;
@@ -196,21 +208,6 @@ void DrawEngineVulkan::FrameData::Destroy(VulkanContext *vulkan) {
 		vulkan->Delete().QueueDeleteDescriptorPool(descPool);
 	}
 
-	if (pushUBO) {
-		pushUBO->Destroy(vulkan);
-		delete pushUBO;
-		pushUBO = nullptr;
-	}
-	if (pushVertex) {
-		pushVertex->Destroy(vulkan);
-		delete pushVertex;
-		pushVertex = nullptr;
-	}
-	if (pushIndex) {
-		pushIndex->Destroy(vulkan);
-		delete pushIndex;
-		pushIndex = nullptr;
-	}
 	if (pushLocal) {
 		pushLocal->Destroy(vulkan);
 		delete pushLocal;
@@ -222,10 +219,19 @@ void DrawEngineVulkan::DestroyDeviceObjects() {
 	delete tessDataTransferVulkan;
 	tessDataTransfer = nullptr;
 	tessDataTransferVulkan = nullptr;
+	delete computeDecoder_;
+	computeDecoder_ = nullptr;
 
 	for (int i = 0; i < VulkanContext::MAX_INFLIGHT_FRAMES; i++) {
 		frame_[i].Destroy(vulkan_);
 	}
+	for (VulkanPushBuffer **push : { &pushUBO_, &pushVertex_, &pushIndex_ }) {
+		if (*push) {
+			(*push)->Destroy(vulkan_);
+			delete *push;
+			*push = nullptr;
+		}
+	}
 	if (samplerSecondary_ != VK_NULL_HANDLE)
 		vulkan_->Delete().QueueDeleteSampler(samplerSecondary_);
 	if (nullSampler_ != VK_NULL_HANDLE)
@@ -264,22 +270,21 @@ void DrawEngineVulkan::BeginFrame() {
 	int curFrame = vulkan_->GetCurFrame();
 	FrameData *frame = &frame_[curFrame];
 
-	// First reset all buffers, then begin. This is so that Reset can free memory and Begin can allocate it,
-	// if growing the buffer is needed. Doing it this way will reduce fragmentation if more than one buffer
-	// needs to grow in the same frame. The state where many buffers are reset can also be used to 
-	// defragment memory.
-	frame->pushUBO->Reset();
-	frame->pushVertex->Reset();
-	frame->pushIndex->Reset();
 	frame->pushLocal->Reset();
-
-	frame->pushUBO->Begin(vulkan_);
-	frame->pushVertex->Begin(vulkan_);
-	frame->pushIndex->Begin(vulkan_);
 	frame->pushLocal->Begin(vulkan_);
 
+	// The render manager has waited for this frame's fence, so the rings can reclaim what it used.
+	pushUBO_->BeginRingFrame(curFrame);
+	pushVertex_->BeginRingFrame(curFrame);
+	pushIndex_->BeginRingFrame(curFrame);
+
 	// TODO: How can we make this nicer...
-	tessDataTransferVulkan->SetPushBuffer(frame->pushUBO);
+	tessDataTransferVulkan->SetPushBuffer(pushUBO_);
+
+	if (g_Config.bVertexDecoderCompute && !computeDecoder_)
+		computeDecoder_ = new VertexDecoderComputeVulkan(vulkan_);
+	if (computeDecoder_)
+		computeDecoder_->BeginFrame();
 
 	DirtyAllUBOs();
 
@@ -287,18 +292,23 @@ void DrawEngineVulkan::BeginFrame() {
 	if (vertexCache_->GetTotalSize() > VERTEX_CACHE_SIZE) {
 		vertexCache_->Destroy(vulkan_);
 		delete vertexCache_;  // orphans the buffers, they'll get deleted once no longer used by an in-flight frame.
-		vertexCache_ = new VulkanPushBuffer(vulkan_, VERTEX_CACHE_SIZE, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+		vertexCache_ = new VulkanPushBuffer(vulkan_, VERTEX_CACHE_SIZE, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
 		vai_.Clear();
 	}
 
 	vertexCache_->BeginNoReset();
 
-	if (--descDecimationCounter_ <= 0) {
+	// Descriptor sets are kept across frames, since the same textures and buffers tend to be used every frame.
+	// Once an image view, sampler or buffer has been destroyed, a new one could get the same handle and match
+	// a stale set, so then we have to start over.
+	uint32_t descGeneration = vulkan_->GetDescriptorResourceGeneration();
+	if (--frame->descDecimationCounter <= 0 || frame->descGeneration != descGeneration) {
 		if (frame->descPool != VK_NULL_HANDLE)
 			vkResetDescriptorPool(vulkan_->GetDevice(), frame->descPool, 0);
 		frame->descSets.Clear();
 		frame->descCount = 0;
-		descDecimationCounter_ = DESCRIPTORSET_DECIMATION_INTERVAL;
+		frame->descDecimationCounter = DESCRIPTORSET_DECIMATION_INTERVAL;
+		frame->descGeneration = descGeneration;
 	}
 
 	if (--decimationCounter_ <= 0) {
@@ -327,12 +337,13 @@ void DrawEngineVulkan::BeginFrame() {
 
 void DrawEngineVulkan::EndFrame() {
 	FrameData *frame = &frame_[vulkan_->GetCurFrame()];
-	stats_.pushUBOSpaceUsed = (int)frame->pushUBO->GetOffset();
-	stats_.pushVertexSpaceUsed = (int)frame->pushVertex->GetOffset();
-	stats_.pushIndexSpaceUsed = (int)frame->pushIndex->GetOffset();
-	frame->pushUBO->End();
-	frame->pushVertex->End();
-	frame->pushIndex->End();
+	pushUBO_->EndRingFrame();
+	pushVertex_->EndRingFrame();
+	pushIndex_->EndRingFrame();
+	stats_.pushUBOSpaceUsed = (int)pushUBO_->GetRingFrameUsage();
+	stats_.pushVertexSpaceUsed = (int)pushVertex_->GetRingFrameUsage();
+	stats_.pushIndexSpaceUsed = (int)pushIndex_->GetRingFrameUsage();
+	stats_.pushBufferGrowCount = pushUBO_->GetRingGrowCount() + pushVertex_->GetRingGrowCount() + pushIndex_->GetRingGrowCount();
 	frame->pushLocal->End();
 	vertexCache_->End();
 }
@@ -344,8 +355,33 @@ void DrawEngineVulkan::DecodeVertsToPushBuffer(VulkanPushBuffer *push, uint32_t
 	if (push) {
 		int vertsToDecode = ComputeNumVertsToDecode();
 		dest = (u8 *)push->Push(vertsToDecode * dec_->GetDecVtxFmt().stride, bindOffset, vkbuf);
+		if (computeDecoder_ && g_Config.bVertexDecoderCompute && VertexDecoderComputeVulkan::CanDecode(dec_)) {
+			computeDecodeBase_ = dest;
+			computeDecodeBuf_ = *vkbuf;
+			computeDecodeOffset_ = *bindOffset;
+		}
 	}
 	DecodeVerts(dest);
+	computeDecodeBase_ = nullptr;
+}
+
+void DrawEngineVulkan::DecodeVertRange(u8 *dest, const void *verts, int indexLowerBound, int indexUpperBound) {
+	if (computeDecodeBase_ && indexUpperBound - indexLowerBound + 1 >= COMPUTE_DECODE_MIN_VERTS) {
+		VkCommandBuffer cmdInit = (VkCommandBuffer)draw_->GetNativeObject(Draw::NativeObject::INIT_COMMANDBUFFER);
+		// The decoder only prescales UVs for these modes, otherwise it just converts to float.
+		UVScale uv = gstate_c.uv;
+		if (gstate.getUVGenMode() != GE_TEXMAP_TEXTURE_COORDS && gstate.getUVGenMode() != GE_TEXMAP_UNKNOWN)
+			uv = UVScale{ 1.0f, 1.0f, 0.0f, 0.0f };
+		uint32_t offset = computeDecodeOffset_ + (uint32_t)(dest - computeDecodeBase_);
+		if (computeDecoder_->Decode(cmdInit, pushUBO_, dec_, uv, verts, indexLowerBound, indexUpperBound, computeDecodeBuf_, offset)) {
+			// We don't read the colors back, so we can't know if alpha was full.
+			u32 col = lastVType_ & GE_VTYPE_COL_MASK;
+			if (col != GE_VTYPE_COL_NONE && col != GE_VTYPE_COL_565)
+				gstate_c.vertexFullAlpha = false;
+			return;
+		}
+	}
+	DrawEngineCommon::DecodeVertRange(dest, verts, indexLowerBound, indexUpperBound);
 }
 
 void DrawEngineVulkan::SetLineWidth(float lineWidth) {
@@ -363,13 +399,15 @@ VkResult DrawEngineVulkan::RecreateDescriptorPool(FrameData &frame, int newSize)
 	}
 	frame.descPoolSize = newSize;
 
-	VkDescriptorPoolSize dpTypes[3];
+	VkDescriptorPoolSize dpTypes[4];
 	dpTypes[0].descriptorCount = frame.descPoolSize * 3;
 	dpTypes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	dpTypes[1].descriptorCount = frame.descPoolSize * 3;  // Don't use these for tess anymore, need max three per set.
 	dpTypes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	dpTypes[2].descriptorCount = frame.descPoolSize * 3;  // TODO: Use a separate layout when no spline stuff is needed to reduce the need for these.
 	dpTypes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	dpTypes[3].descriptorCount = frame.descPoolSize;
+	dpTypes[3].type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
 
 	VkDescriptorPoolCreateInfo dp{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
 	dp.flags = 0;   // Don't want to mess around with individually freeing these.
@@ -388,6 +426,7 @@ VkDescriptorSet DrawEngineVulkan::GetOrCreateDescriptorSet(VkImageView imageView
 	key.sampler_ = sampler;
 	key.secondaryImageView_ = boundSecondary_;
 	key.depalImageView_ = boundDepal_;
+	key.inputImageView_ = boundInput_;
 	key.base_ = base;
 	key.light_ = light;
 	key.bone_ = bone;
@@ -409,7 +448,7 @@ VkDescriptorSet DrawEngineVulkan::GetOrCreateDescriptorSet(VkImageView imageView
 	}
 
 	// Didn't find one in the frame descriptor set cache, let's make a new one.
-	// We wipe the cache on every frame.
+	// The cache is wiped periodically, see BeginFrame.
 
 	VkDescriptorSet desc;
 	VkDescriptorSetAllocateInfo descAlloc{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
@@ -433,10 +472,10 @@ VkDescriptorSet DrawEngineVulkan::GetOrCreateDescriptorSet(VkImageView imageView
 	_assert_msg_(G3D, result == VK_SUCCESS, "Ran out of descriptor space in pool. sz=%d res=%d", (int)frame.descSets.size(), (int)result);
 
 	// We just don't write to the slots we don't care about, which is fine.
-	VkWriteDescriptorSet writes[7]{};
+	VkWriteDescriptorSet writes[8]{};
 	// Main texture
 	int n = 0;
-	VkDescriptorImageInfo tex[3]{};
+	VkDescriptorImageInfo tex[4]{};
 	if (imageView) {
 #ifdef VULKAN_USE_GENERAL_LAYOUT_FOR_COLOR
 		tex[0].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
@@ -491,6 +530,20 @@ VkDescriptorSet DrawEngineVulkan::GetOrCreateDescriptorSet(VkImageView imageView
 		n++;
 	}
 
+	if (boundInput_) {
+		// The render pass keeps it in the general layout, since it's also the color attachment.
+		tex[3].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		tex[3].imageView = boundInput_;
+		writes[n].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[n].pNext = nullptr;
+		writes[n].dstBinding = DRAW_BINDING_INPUT_ATTACHMENT;
+		writes[n].pImageInfo = &tex[3];
+		writes[n].descriptorCount = 1;
+		writes[n].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+		writes[n].dstSet = desc;
+		n++;
+	}
+
 	// Tessellation data buffer.
 	if (tess) {
 		const VkDescriptorBufferInfo *bufInfo = tessDataTransferVulkan->GetBufferInfo();
@@ -565,12 +618,19 @@ void DrawEngineVulkan::DirtyAllUBOs() {
 	baseBuf = VK_NULL_HANDLE;
 	lightBuf = VK_NULL_HANDLE;
 	boneBuf = VK_NULL_HANDLE;
+	boneUBOCount_ = 0;
 	dirtyUniforms_ = DIRTY_BASE_UNIFORMS | DIRTY_LIGHT_UNIFORMS | DIRTY_BONE_UNIFORMS;
 	imageView = VK_NULL_HANDLE;
 	sampler = VK_NULL_HANDLE;
 	gstate_c.Dirty(DIRTY_TEXTURE_IMAGE);
 }
 
+static void FreeVertexArray(VertexArrayInfoVulkan *vai) {
+	// The data stays in the vertex cache pushbuffer until it's reset, we just forget about it.
+	vai->vb = VK_NULL_HANDLE;
+	vai->ib = VK_NULL_HANDLE;
+}
+
 void MarkUnreliable(VertexArrayInfoVulkan *vai) {
 	vai->status = VertexArrayInfoVulkan::VAI_UNRELIABLE;
 	// TODO: If we change to a real allocator, free the data here.
@@ -645,12 +705,8 @@ void DrawEngineVulkan::DoFlush() {
 			case VertexArrayInfoVulkan::VAI_NEW:
 			{
 				// Haven't seen this one before. We don't actually upload the vertex data yet.
-				ReliableHashType dataHash = ComputeHash();
-				vai->hash = dataHash;
-				vai->minihash = ComputeMiniHash();
-				vai->status = VertexArrayInfoVulkan::VAI_HASHING;
-				vai->drawsUntilNextFullHash = 0;
-				DecodeVertsToPushBuffer(frame->pushVertex, &vbOffset, &vbuf);  // writes to indexGen
+				BeginVertexArray(vai);
+				DecodeVertsToPushBuffer(pushVertex_, &vbOffset, &vbuf);  // writes to indexGen
 				vai->numVerts = indexGen.VertexCount();
 				vai->prim = indexGen.Prim();
 				vai->maxIndex = indexGen.MaxIndex();
@@ -667,37 +723,14 @@ void DrawEngineVulkan::DoFlush() {
 				if (vai->lastFrame != gpuStats.numFlips) {
 					vai->numFrames++;
 				}
-				if (vai->drawsUntilNextFullHash == 0) {
-					// Let's try to skip a full hash if mini would fail.
-					const u32 newMiniHash = ComputeMiniHash();
-					ReliableHashType newHash = vai->hash;
-					if (newMiniHash == vai->minihash) {
-						newHash = ComputeHash();
-					}
-					if (newMiniHash != vai->minihash || newHash != vai->hash) {
-						MarkUnreliable(vai);
-						DecodeVertsToPushBuffer(frame->pushVertex, &vbOffset, &vbuf);
-						goto rotateVBO;
-					}
-					if (vai->numVerts > 64) {
-						// exponential backoff up to 16 draws, then every 24
-						vai->drawsUntilNextFullHash = std::min(24, vai->numFrames);
-					} else {
-						// Lower numbers seem much more likely to change.
-						vai->drawsUntilNextFullHash = 0;
-					}
-					// TODO: tweak
-					//if (vai->numFrames > 1000) {
-					//	vai->status = VertexArrayInfo::VAI_RELIABLE;
-					//}
-				} else {
-					vai->drawsUntilNextFullHash--;
-					u32 newMiniHash = ComputeMiniHash();
-					if (newMiniHash != vai->minihash) {
+				if (!CheckVertexArray(vai)) {
+					if (!ReseedVertexArray(vai)) {
 						MarkUnreliable(vai);
-						DecodeVertsToPushBuffer(frame->pushVertex, &vbOffset, &vbuf);
+						DecodeVertsToPushBuffer(pushVertex_, &vbOffset, &vbuf);
 						goto rotateVBO;
 					}
+					// Replaced through a write we were told about, upload the new contents below.
+					FreeVertexArray(vai);
 				}
 
 				if (!vai->vb) {
@@ -763,7 +796,7 @@ void DrawEngineVulkan::DoFlush() {
 				if (vai->lastFrame != gpuStats.numFlips) {
 					vai->numFrames++;
 				}
-				DecodeVertsToPushBuffer(frame->pushVertex, &vbOffset, &vbuf);
+				DecodeVertsToPushBuffer(pushVertex_, &vbOffset, &vbuf);
 				goto rotateVBO;
 			}
 			default:
@@ -773,11 +806,11 @@ void DrawEngineVulkan::DoFlush() {
 			if (g_Config.bSoftwareSkinning && (lastVType_ & GE_VTYPE_WEIGHT_MASK)) {
 				// If software skinning, we've already predecoded into "decoded". So push that content.
 				VkDeviceSize size = decodedVerts_ * dec_->GetDecVtxFmt().stride;
-				u8 *dest = (u8 *)frame->pushVertex->Push(size, &vbOffset, &vbuf);
+				u8 *dest = (u8 *)pushVertex_->Push(size, &vbOffset, &vbuf);
 				memcpy(dest, decoded, size);
 			} else {
 				// Decode directly into the pushbuffer
-				DecodeVertsToPushBuffer(frame->pushVertex, &vbOffset, &vbuf);
+				DecodeVertsToPushBuffer(pushVertex_, &vbOffset, &vbuf);
 			}
 
 	rotateVBO:
@@ -807,7 +840,7 @@ void DrawEngineVulkan::DoFlush() {
 				sampler = nullSampler_;
 		}
 
-		if (!lastPipeline_ || gstate_c.IsDirty(DIRTY_BLEND_STATE | DIRTY_VIEWPORTSCISSOR_STATE | DIRTY_RASTER_STATE | DIRTY_DEPTHSTENCIL_STATE | DIRTY_VERTEXSHADER_STATE | DIRTY_FRAGMENTSHADER_STATE) || prim != lastPrim_) {
+		if (!lastPipeline_ || usingUberPipeline_ || gstate_c.IsDirty(DIRTY_BLEND_STATE | DIRTY_VIEWPORTSCISSOR_STATE | DIRTY_RASTER_STATE | DIRTY_DEPTHSTENCIL_STATE | DIRTY_VERTEXSHADER_STATE | DIRTY_FRAGMENTSHADER_STATE) || prim != lastPrim_) {
 			shaderManager_->GetShaders(prim, lastVType_, &vshader, &fshader, true);  // usehwtransform
 			_dbg_assert_msg_(G3D, vshader->UseHWTransform(), "Bad vshader");
 
@@ -816,12 +849,13 @@ void DrawEngineVulkan::DoFlush() {
 			}
 			Draw::NativeObject object = g_Config.iRenderingMode != FB_NON_BUFFERED_MODE ? Draw::NativeObject::FRAMEBUFFER_RENDERPASS : Draw::NativeObject::BACKBUFFER_RENDERPASS;
 			VkRenderPass renderPass = (VkRenderPass)draw_->GetNativeObject(object);
-			VulkanPipeline *pipeline = pipelineManager_->GetOrCreatePipeline(pipelineLayout_, renderPass, pipelineKey_, &dec_->decFmt, vshader, fshader, true);
+			VulkanPipeline *pipeline = GetPipeline(renderPass, vshader, fshader, true);
 			if (!pipeline || !pipeline->pipeline) {
-				// Already logged, let's bail out.
+				// Failed (already logged) or still being created. Drop the draw and try again next time.
+				ResetAfterDraw();
 				return;
 			}
-			BindShaderBlendTex();  // This might cause copies so important to do before BindPipeline.
+			BindShaderBlendTex(fshader);  // This might cause copies so important to do before BindPipeline.
 			renderManager->BindPipeline(pipeline->pipeline);
 			if (pipeline != lastPipeline_) {
 				if (lastPipeline_ && !(lastPipeline_->UsesBlendConstant() && pipeline->UsesBlendConstant())) {
@@ -852,9 +886,11 @@ void DrawEngineVulkan::DoFlush() {
 
 		int stride = dec_->GetDecVtxFmt().stride;
 
+		if (boundInput_)
+			renderManager->SelfDependencyBarrier();
 		if (useElements) {
 			if (!ibuf)
-				ibOffset = (uint32_t)frame->pushIndex->Push(decIndex, sizeof(uint16_t) * indexGen.VertexCount(), &ibuf);
+				ibOffset = (uint32_t)pushIndex_->Push(decIndex, sizeof(uint16_t) * indexGen.VertexCount(), &ibuf);
 			renderManager->DrawIndexed(pipelineLayout_, ds, ARRAY_SIZE(dynamicUBOOffsets), dynamicUBOOffsets, vbuf, vbOffset, ibuf, ibOffset, vertexCount, 1, VK_INDEX_TYPE_UINT16);
 		} else {
 			renderManager->Draw(pipelineLayout_, ds, ARRAY_SIZE(dynamicUBOOffsets), dynamicUBOOffsets, vbuf, vbOffset, vertexCount);
@@ -912,7 +948,7 @@ void DrawEngineVulkan::DoFlush() {
 				if (sampler == VK_NULL_HANDLE)
 					sampler = nullSampler_;
 			}
-			if (!lastPipeline_ || gstate_c.IsDirty(DIRTY_BLEND_STATE | DIRTY_VIEWPORTSCISSOR_STATE | DIRTY_RASTER_STATE | DIRTY_DEPTHSTENCIL_STATE | DIRTY_VERTEXSHADER_STATE | DIRTY_FRAGMENTSHADER_STATE) || prim != lastPrim_) {
+			if (!lastPipeline_ || usingUberPipeline_ || gstate_c.IsDirty(DIRTY_BLEND_STATE | DIRTY_VIEWPORTSCISSOR_STATE | DIRTY_RASTER_STATE | DIRTY_DEPTHSTENCIL_STATE | DIRTY_VERTEXSHADER_STATE | DIRTY_FRAGMENTSHADER_STATE) || prim != lastPrim_) {
 				shaderManager_->GetShaders(prim, lastVType_, &vshader, &fshader, false);  // usehwtransform
 				_dbg_assert_msg_(G3D, !vshader->UseHWTransform(), "Bad vshader");
 				if (prim != lastPrim_ || gstate_c.IsDirty(DIRTY_BLEND_STATE | DIRTY_VIEWPORTSCISSOR_STATE | DIRTY_RASTER_STATE | DIRTY_DEPTHSTENCIL_STATE)) {
@@ -920,12 +956,13 @@ void DrawEngineVulkan::DoFlush() {
 				}
 				Draw::NativeObject object = g_Config.iRenderingMode != FB_NON_BUFFERED_MODE ? Draw::NativeObject::FRAMEBUFFER_RENDERPASS : Draw::NativeObject::BACKBUFFER_RENDERPASS;
 				VkRenderPass renderPass = (VkRenderPass)draw_->GetNativeObject(object);
-				VulkanPipeline *pipeline = pipelineManager_->GetOrCreatePipeline(pipelineLayout_, renderPass, pipelineKey_, &dec_->decFmt, vshader, fshader, false);
+				VulkanPipeline *pipeline = GetPipeline(renderPass, vshader, fshader, false);
 				if (!pipeline || !pipeline->pipeline) {
-					// Already logged, let's bail out.
+					// Failed (already logged) or still being created. Drop the draw and try again next time.
+					ResetAfterDraw();
 					return;
 				}
-				BindShaderBlendTex();  // This might cause copies so super important to do before BindPipeline.
+				BindShaderBlendTex(fshader);  // This might cause copies so super important to do before BindPipeline.
 				renderManager->BindPipeline(pipeline->pipeline);
 				if (pipeline != lastPipeline_) {
 					if (lastPipeline_ && !lastPipeline_->UsesBlendConstant() && pipeline->UsesBlendConstant()) {
@@ -955,15 +992,17 @@ void DrawEngineVulkan::DoFlush() {
 
 			PROFILE_THIS_SCOPE("renderman_q");
 
+			if (boundInput_)
+				renderManager->SelfDependencyBarrier();
 			if (drawIndexed) {
 				VkBuffer vbuf, ibuf;
-				vbOffset = (uint32_t)frame->pushVertex->Push(drawBuffer, maxIndex * sizeof(TransformedVertex), &vbuf);
-				ibOffset = (uint32_t)frame->pushIndex->Push(inds, sizeof(short) * numTrans, &ibuf);
+				vbOffset = (uint32_t)pushVertex_->Push(drawBuffer, maxIndex * sizeof(TransformedVertex), &vbuf);
+				ibOffset = (uint32_t)pushIndex_->Push(inds, sizeof(short) * numTrans, &ibuf);
 				VkDeviceSize offsets[1] = { vbOffset };
 				renderManager->DrawIndexed(pipelineLayout_, ds, ARRAY_SIZE(dynamicUBOOffsets), dynamicUBOOffsets, vbuf, vbOffset, ibuf, ibOffset, numTrans, 1, VK_INDEX_TYPE_UINT16);
 			} else {
 				VkBuffer vbuf;
-				vbOffset = (uint32_t)frame->pushVertex->Push(drawBuffer, numTrans * sizeof(TransformedVertex), &vbuf);
+				vbOffset = (uint32_t)pushVertex_->Push(drawBuffer, numTrans * sizeof(TransformedVertex), &vbuf);
 				VkDeviceSize offsets[1] = { vbOffset };
 				renderManager->Draw(pipelineLayout_, ds, ARRAY_SIZE(dynamicUBOOffsets), dynamicUBOOffsets, vbuf, vbOffset, numTrans);
 			}
@@ -980,12 +1019,43 @@ void DrawEngineVulkan::DoFlush() {
 			int scissorY2 = gstate.getScissorY2() + 1;
 			framebufferManager_->SetSafeSize(scissorX2, scissorY2);
 
-			if (gstate_c.Supports(GPU_USE_CLEAR_RAM_HACK) && gstate.isClearModeColorMask() && (gstate.isClearModeAlphaMask() || gstate.FrameBufFormat() == GE_FORMAT_565)) {
-				framebufferManager_->ApplyClearToMemory(scissorX1, scissorY1, scissorX2, scissorY2, result.color);
+			if (gstate.isClearModeColorMask() && (gstate.isClearModeAlphaMask() || gstate.FrameBufFormat() == GE_FORMAT_565)) {
+				if (gstate_c.Supports(GPU_USE_CLEAR_RAM_HACK))
+					framebufferManager_->ApplyClearToMemory(scissorX1, scissorY1, scissorX2, scissorY2, result.color);
+				framebufferManager_->DeferClearToMemory(scissorX1, scissorY1, scissorX2, scissorY2, result.color);
 			}
 		}
 	}
 
+	ResetAfterDraw();
+
+	GPUDebug::NotifyDraw();
+}
+
+VulkanPipeline *DrawEngineVulkan::GetPipeline(VkRenderPass renderPass, VulkanVertexShader *vshader, VulkanFragmentShader *fshader, bool useHWTransform) {
+	usingUberPipeline_ = false;
+	VulkanPipeline *pipeline = pipelineManager_->GetOrCreatePipeline(pipelineLayout_, renderPass, pipelineKey_, &dec_->decFmt, vshader, fshader, useHWTransform);
+	if (pipeline && pipeline->pipeline)
+		return pipeline;
+
+	// The real pipeline is still being built on the worker (or failed). Rather than skip the draw,
+	// use the uber fragment shader if it can handle this ID.
+	if (!PSP_CoreParameter().compat.flags().AsyncPipelineCreation || !FragmentShaderCanUseUber(fshader->GetID()))
+		return pipeline;
+	VulkanFragmentShader *uberFShader = shaderManager_->GetUberFragmentShader();
+	if (!uberFShader)
+		return pipeline;
+	VulkanPipeline *uberPipeline = pipelineManager_->GetOrCreatePipeline(pipelineLayout_, renderPass, pipelineKey_, &dec_->decFmt, vshader, uberFShader, useHWTransform);
+	if (!uberPipeline || !uberPipeline->pipeline)
+		return pipeline;
+
+	if (shaderManager_->SetUberFragmentID(fshader->GetID()))
+		dirtyUniforms_ |= DIRTY_BASE_UNIFORMS;
+	usingUberPipeline_ = true;
+	return uberPipeline;
+}
+
+void DrawEngineVulkan::ResetAfterDraw() {
 	gpuStats.numDrawCalls += numDrawCalls;
 	gpuStats.numVertsSubmitted += vertexCountInDrawCalls_;
 
@@ -997,28 +1067,32 @@ void DrawEngineVulkan::DoFlush() {
 	dcid_ = 0;
 	prevPrim_ = GE_PRIM_INVALID;
 	gstate_c.vertexFullAlpha = true;
-	framebufferManager_->SetColorUpdated(gstate_c.skipDrawReason);
+	framebufferManager_->SetColorUpdatedInScissor(gstate_c.skipDrawReason);
 
 	// Now seems as good a time as any to reset the min/max coords, which we may examine later.
 	gstate_c.vertBounds.minU = 512;
 	gstate_c.vertBounds.minV = 512;
 	gstate_c.vertBounds.maxU = 0;
 	gstate_c.vertBounds.maxV = 0;
-
-	GPUDebug::NotifyDraw();
 }
 
 void DrawEngineVulkan::UpdateUBOs(FrameData *frame) {
 	if ((dirtyUniforms_ & DIRTY_BASE_UNIFORMS) || baseBuf == VK_NULL_HANDLE) {
-		baseUBOOffset = shaderManager_->PushBaseBuffer(frame->pushUBO, &baseBuf);
+		baseUBOOffset = shaderManager_->PushBaseBuffer(pushUBO_, &baseBuf);
 		dirtyUniforms_ &= ~DIRTY_BASE_UNIFORMS;
 	}
-	if ((dirtyUniforms_ & DIRTY_LIGHT_UNIFORMS) || lightBuf == VK_NULL_HANDLE) {
-		lightUBOOffset = shaderManager_->PushLightBuffer(frame->pushUBO, &lightBuf);
+
+	// Lights and bones stay dirty until a shader actually reads them, so unlit or unskinned draws
+	// don't keep pushing them. Only the bones in use are copied.
+	const VShaderID &vsid = shaderManager_->GetLastVSID();
+	if (((dirtyUniforms_ & DIRTY_LIGHT_UNIFORMS) && VertexShaderUsesLights(vsid)) || lightBuf == VK_NULL_HANDLE) {
+		lightUBOOffset = shaderManager_->PushLightBuffer(pushUBO_, &lightBuf);
 		dirtyUniforms_ &= ~DIRTY_LIGHT_UNIFORMS;
 	}
-	if ((dirtyUniforms_ & DIRTY_BONE_UNIFORMS) || boneBuf == VK_NULL_HANDLE) {
-		boneUBOOffset = shaderManager_->PushBoneBuffer(frame->pushUBO, &boneBuf);
+	int numBones = VertexShaderNumBones(vsid);
+	if (((dirtyUniforms_ & DIRTY_BONE_UNIFORMS) && numBones > 0) || numBones > boneUBOCount_ || boneBuf == VK_NULL_HANDLE) {
+		boneUBOOffset = shaderManager_->PushBoneBuffer(pushUBO_, &boneBuf, numBones);
+		boneUBOCount_ = numBones;
 		dirtyUniforms_ &= ~DIRTY_BONE_UNIFORMS;
 	}
 }
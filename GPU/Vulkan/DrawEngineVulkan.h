@@ -64,12 +64,16 @@ typedef u32 ReliableHashType;
 
 class VulkanContext;
 class VulkanPushBuffer;
+class VertexDecoderComputeVulkan;
 struct VulkanPipeline;
+class VulkanVertexShader;
+class VulkanFragmentShader;
 
 struct DrawEngineVulkanStats {
 	int pushUBOSpaceUsed;
 	int pushVertexSpaceUsed;
 	int pushIndexSpaceUsed;
+	int pushBufferGrowCount;
 };
 
 enum {
@@ -77,42 +81,16 @@ enum {
 };
 
 // Try to keep this POD.
-class VertexArrayInfoVulkan {
+class VertexArrayInfoVulkan : public VertexArrayInfoCommon {
 public:
-	VertexArrayInfoVulkan() {
-		lastFrame = gpuStats.numFlips;
-	}
 	// No destructor needed - we always fully wipe.
 
-	enum VAIStatus : uint8_t {
-		VAI_NEW,
-		VAI_HASHING,
-		VAI_RELIABLE,  // cache, don't hash
-		VAI_UNRELIABLE,  // never cache
-	};
-
-	ReliableHashType hash;
-	u32 minihash;
-
 	// These will probably always be the same, but whatever.
 	VkBuffer vb = VK_NULL_HANDLE;
 	VkBuffer ib = VK_NULL_HANDLE;
 	// Offsets into the cache buffer.
 	uint32_t vbOffset = 0;
 	uint32_t ibOffset = 0;
-
-	// Precalculated parameter for vkDrawIndexed
-	u16 numVerts = 0;
-	u16 maxIndex = 0;
-	s8 prim = GE_PRIM_INVALID;
-	VAIStatus status = VAI_NEW;
-
-	// ID information
-	int numDraws = 0;
-	int numFrames = 0;
-	int lastFrame;  // So that we can forget.
-	u16 drawsUntilNextFullHash = 0;
-	u8 flags = 0;
 };
 
 class VulkanRenderManager;
@@ -185,7 +163,7 @@ class DrawEngineVulkan : public DrawEngineCommon {
 	}
 
 	VulkanPushBuffer *GetPushBufferForTextureData() {
-		return frame_[vulkan_->GetCurFrame()].pushUBO;
+		return pushUBO_;
 	}
 
 	// Only use Allocate on this one.
@@ -209,16 +187,19 @@ class DrawEngineVulkan : public DrawEngineCommon {
 	struct FrameData;
 	void ApplyDrawStateLate(VulkanRenderManager *renderManager, bool applyStencilRef, uint8_t stencilRef, bool useBlendConstant);
 	void ConvertStateToVulkanKey(FramebufferManagerVulkan &fbManager, ShaderManagerVulkan *shaderManager, int prim, VulkanPipelineRasterStateKey &key, VulkanDynamicState &dynState);
-	void BindShaderBlendTex();
+	void BindShaderBlendTex(VulkanFragmentShader *fshader);
 	void ResetShaderBlending();
 
 	void InitDeviceObjects();
 	void DestroyDeviceObjects();
 
 	void DecodeVertsToPushBuffer(VulkanPushBuffer *push, uint32_t *bindOffset, VkBuffer *vkbuf);
+	void DecodeVertRange(u8 *dest, const void *verts, int indexLowerBound, int indexUpperBound) override;
 	VkResult RecreateDescriptorPool(FrameData &frame, int newSize);
 
 	void DoFlush();
+	void ResetAfterDraw();
+	VulkanPipeline *GetPipeline(VkRenderPass renderPass, VulkanVertexShader *vshader, VulkanFragmentShader *fshader, bool useHWTransform);
 	void UpdateUBOs(FrameData *frame);
 
 	VkDescriptorSet GetOrCreateDescriptorSet(VkImageView imageView, VkSampler sampler, VkBuffer base, VkBuffer light, VkBuffer bone, bool tess);
@@ -230,22 +211,31 @@ class DrawEngineVulkan : public DrawEngineCommon {
 	VkDescriptorSetLayout descriptorSetLayout_;
 	VkPipelineLayout pipelineLayout_;
 	VulkanPipeline *lastPipeline_;
+	// Set while drawing with the uber shader stand-in, so we keep checking for the real pipeline.
+	bool usingUberPipeline_ = false;
 	VkDescriptorSet lastDs_ = VK_NULL_HANDLE;
 
 	// Secondary texture for shader blending
 	VkImageView boundSecondary_ = VK_NULL_HANDLE;
 	VkImageView boundDepal_ = VK_NULL_HANDLE;
+	// The render target as input attachment, when the fragment shader reads it directly.
+	VkImageView boundInput_ = VK_NULL_HANDLE;
 	VkSampler samplerSecondary_ = VK_NULL_HANDLE;  // This one is actually never used since we use fetch.
 
 	PrehashMap<VertexArrayInfoVulkan *, nullptr> vai_;
 	VulkanPushBuffer *vertexCache_;
+
+	// Ring buffers shared by all in-flight frames.
+	VulkanPushBuffer *pushUBO_ = nullptr;
+	VulkanPushBuffer *pushVertex_ = nullptr;
+	VulkanPushBuffer *pushIndex_ = nullptr;
 	int decimationCounter_ = 0;
-	int descDecimationCounter_ = 0;
 
 	struct DescriptorSetKey {
 		VkImageView imageView_;
 		VkImageView secondaryImageView_;
 		VkImageView depalImageView_;
+		VkImageView inputImageView_;
 		VkSampler sampler_;
 		VkBuffer base_, light_, bone_;  // All three UBO slots will be set to this. This will usually be identical
 		// for all draws in a frame, except when the buffer has to grow.
@@ -258,15 +248,13 @@ class DrawEngineVulkan : public DrawEngineCommon {
 		VkDescriptorPool descPool = VK_NULL_HANDLE;
 		int descCount = 0;
 		int descPoolSize = 256;  // We double this before we allocate so we initialize this to half the size we want.
-
-		VulkanPushBuffer *pushUBO = nullptr;
-		VulkanPushBuffer *pushVertex = nullptr;
-		VulkanPushBuffer *pushIndex = nullptr;
+		int descDecimationCounter = 0;
+		uint32_t descGeneration = 0;
 
 		// Special push buffer in GPU local memory, for texture data conversion and similar tasks.
 		VulkanPushBuffer *pushLocal;
 
-		// We do rolling allocation and reset instead of caching across frames. That we might do later.
+		// Kept across frames until the pool is reset, see BeginFrame.
 		DenseHashMap<DescriptorSetKey, VkDescriptorSet, (VkDescriptorSet)VK_NULL_HANDLE> descSets;
 
 		void Destroy(VulkanContext *vulkan);
@@ -286,6 +274,8 @@ class DrawEngineVulkan : public DrawEngineCommon {
 	uint32_t baseUBOOffset;
 	uint32_t lightUBOOffset;
 	uint32_t boneUBOOffset;
+	// Number of bones copied into the last pushed bone block.
+	int boneUBOCount_ = 0;
 	VkBuffer baseBuf, lightBuf, boneBuf;
 	VkImageView imageView = VK_NULL_HANDLE;
 	VkSampler sampler = VK_NULL_HANDLE;
@@ -302,4 +292,11 @@ class DrawEngineVulkan : public DrawEngineCommon {
 
 	// Hardware tessellation
 	TessellationDataTransferVulkan *tessDataTransferVulkan;
+
+	// Optional compute shader vertex decoding, see bVertexDecoderCompute.
+	VertexDecoderComputeVulkan *computeDecoder_ = nullptr;
+	// While decoding into a push buffer, where it's mapped and which buffer it is.
+	u8 *computeDecodeBase_ = nullptr;
+	VkBuffer computeDecodeBuf_ = VK_NULL_HANDLE;
+	uint32_t computeDecodeOffset_ = 0;
 };
@@ -97,9 +97,15 @@ bool GenerateVulkanGLSLFragmentShader(const FShaderID &id, char *buffer, uint32_
 		WRITE(p, "layout (binding = 0) uniform sampler2D tex;\n");
 	}
 
+	// With framebuffer fetch, the render target itself is bound as input attachment 0, see DrawEngineVulkan.
+	const bool readFramebuffer = gstate_c.Supports(GPU_SUPPORTS_ANY_FRAMEBUFFER_FETCH);
 	if (!isModeClear && replaceBlend > REPLACE_BLEND_STANDARD) {
 		if (replaceBlend == REPLACE_BLEND_COPY_FBO) {
-			WRITE(p, "layout (binding = 1) uniform sampler2D fbotex;\n");
+			if (readFramebuffer) {
+				WRITE(p, "layout (input_attachment_index = 0, binding = 9) uniform subpassInput inputColor;\n");
+			} else {
+				WRITE(p, "layout (binding = 1) uniform sampler2D fbotex;\n");
+			}
 		}
 	}
 
@@ -436,7 +442,11 @@ bool GenerateVulkanGLSLFragmentShader(const FShaderID &id, char *buffer, uint32_
 		}
 
 		if (replaceBlend == REPLACE_BLEND_COPY_FBO) {
-			WRITE(p, "  lowp vec4 destColor = texelFetch(fbotex, ivec2(gl_FragCoord.x, gl_FragCoord.y), 0);\n");
+			if (readFramebuffer) {
+				WRITE(p, "  lowp vec4 destColor = subpassLoad(inputColor);\n");
+			} else {
+				WRITE(p, "  lowp vec4 destColor = texelFetch(fbotex, ivec2(gl_FragCoord.x, gl_FragCoord.y), 0);\n");
+			}
 
 			const char *srcFactor = "vec3(1.0)";
 			const char *dstFactor = "vec3(0.0)";
@@ -594,3 +604,188 @@ bool GenerateVulkanGLSLFragmentShader(const FShaderID &id, char *buffer, uint32_
 
 	return true;
 }
+
+bool FragmentShaderReadsDestColor(const FShaderID &id) {
+	return !id.Bit(FS_BIT_CLEARMODE) && id.Bits(FS_BIT_REPLACE_BLEND, 3) == REPLACE_BLEND_COPY_FBO;
+}
+
+bool FragmentShaderCanUseUber(const FShaderID &id) {
+	// These need different bindings, outputs or interpolation, so they can't be switched by uniforms.
+	if (id.Bit(FS_BIT_FLATSHADE) || id.Bit(FS_BIT_SHADER_DEPAL))
+		return false;
+	if (id.Bits(FS_BIT_REPLACE_BLEND, 3) == REPLACE_BLEND_COPY_FBO)
+		return false;
+	if (id.Bits(FS_BIT_STENCIL_TO_ALPHA, 2) == REPLACE_ALPHA_DUALSOURCE)
+		return false;
+	return true;
+}
+
+// Generic fragment shader that reads the FShaderID bits from the base uniform buffer instead of
+// baking them in. Slow, but can be used right away while the specialized pipeline is built.
+bool GenerateVulkanGLSLUberFragmentShader(char *buffer, uint32_t vulkanVendorId) {
+	char *p = buffer;
+
+	WRITE(p, "%s", vulkan_glsl_preamble);
+
+	bool roundDepth = gstate_c.Supports(GPU_ROUND_FRAGMENT_DEPTH_TO_16BIT);
+	bool allowTexClamp = !(gl_extensions.bugs & BUG_PVR_SHADER_PRECISION_TERRIBLE);
+	const char *modulo = (gl_extensions.bugs & BUG_PVR_SHADER_PRECISION_BAD) ? "mymod" : "mod";
+
+	if (!roundDepth) {
+		WRITE(p, "layout (depth_unchanged) out float gl_FragDepth;\n");
+	}
+
+	WRITE(p, "layout (std140, set = 0, binding = 3) uniform baseUBO {\n%s} base;\n", ub_baseStr);
+	WRITE(p, "layout (binding = 0) uniform sampler2D tex;\n");
+
+	// The vertex shader only writes the inputs the bits below say we read.
+	WRITE(p, "layout (location = 1) in vec4 v_color0;\n");
+	WRITE(p, "layout (location = 2) in vec3 v_color1;\n");
+	WRITE(p, "layout (location = 3) in float v_fogdepth;\n");
+	WRITE(p, "layout (location = 0) in vec3 v_texcoord;\n");
+	WRITE(p, "layout (location = 0, index = 0) out vec4 fragColor0;\n");
+
+	WRITE(p, "uint fsbits(uint bit, uint count) {\n");
+	WRITE(p, "  uint w = bit < 32u ? (base.uberfsid0 >> bit) : (base.uberfsid1 >> (bit - 32u));\n");
+	WRITE(p, "  return w & ((1u << count) - 1u);\n");
+	WRITE(p, "}\n");
+	WRITE(p, "bool fsbit(uint bit) { return fsbits(bit, 1u) != 0u; }\n");
+	WRITE(p, "int roundAndScaleTo255i(in float x) { return int(floor(x * 255.0 + 0.5)); }\n");
+	WRITE(p, "ivec3 roundAndScaleTo255iv(in vec3 x) { return ivec3(floor(x * 255.0 + 0.5)); }\n");
+	if (gl_extensions.bugs & BUG_PVR_SHADER_PRECISION_BAD) {
+		WRITE(p, "float mymod(float a, float b) { return a - b * floor(a / b); }\n");
+	}
+
+	WRITE(p, "void main() {\n");
+	WRITE(p, "  vec4 v;\n");
+	WRITE(p, "  bool testToZero = fsbit(%du);\n", FS_BIT_TEST_DISCARD_TO_ZERO);
+	WRITE(p, "  if (fsbit(%du)) {\n", FS_BIT_CLEARMODE);
+	WRITE(p, "    v = v_color0;\n");
+	WRITE(p, "  } else {\n");
+	WRITE(p, "    vec4 s = fsbit(%du) ? vec4(v_color1, 0.0) : vec4(0.0);\n", FS_BIT_LMODE);
+	WRITE(p, "    if (fsbit(%du)) {\n", FS_BIT_DO_TEXTURE);
+	WRITE(p, "      vec2 uv = fsbit(%du) ? v_texcoord.xy / v_texcoord.z : v_texcoord.xy;\n", FS_BIT_DO_TEXTURE_PROJ);
+	if (allowTexClamp) {
+		WRITE(p, "      if (fsbit(%du)) {\n", FS_BIT_SHADER_TEX_CLAMP);
+		WRITE(p, "        uv.x = fsbit(%du) ? clamp(uv.x, base.texclamp.z, base.texclamp.x - base.texclamp.z) : %s(uv.x, base.texclamp.x);\n", FS_BIT_CLAMP_S, modulo);
+		WRITE(p, "        uv.y = fsbit(%du) ? clamp(uv.y, base.texclamp.w, base.texclamp.y - base.texclamp.w) : %s(uv.y, base.texclamp.y);\n", FS_BIT_CLAMP_T, modulo);
+		WRITE(p, "        if (fsbit(%du))\n", FS_BIT_TEXTURE_AT_OFFSET);
+		WRITE(p, "          uv += base.texclampoff.xy;\n");
+		WRITE(p, "      }\n");
+	}
+	WRITE(p, "      vec4 t = texture(tex, uv);\n");
+	WRITE(p, "      vec4 p = v_color0;\n");
+	WRITE(p, "      bool texAlpha = fsbit(%du);\n", FS_BIT_TEXALPHA);
+	WRITE(p, "      uint texFunc = fsbits(%du, 3u);\n", FS_BIT_TEXFUNC);
+	WRITE(p, "      if (texFunc == %du) {\n", GE_TEXFUNC_MODULATE);
+	WRITE(p, "        v = texAlpha ? p * t : vec4(t.rgb * p.rgb, p.a);\n");
+	WRITE(p, "      } else if (texFunc == %du) {\n", GE_TEXFUNC_DECAL);
+	WRITE(p, "        v = texAlpha ? vec4(mix(p.rgb, t.rgb, t.a), p.a) : vec4(t.rgb, p.a);\n");
+	WRITE(p, "      } else if (texFunc == %du) {\n", GE_TEXFUNC_BLEND);
+	WRITE(p, "        v = vec4(mix(p.rgb, base.texenv.rgb, t.rgb), texAlpha ? p.a * t.a : p.a);\n");
+	WRITE(p, "      } else if (texFunc == %du) {\n", GE_TEXFUNC_REPLACE);
+	WRITE(p, "        v = texAlpha ? t : vec4(t.rgb, p.a);\n");
+	WRITE(p, "      } else {\n");
+	WRITE(p, "        v = vec4(p.rgb + t.rgb, texAlpha ? p.a * t.a : p.a);\n");
+	WRITE(p, "      }\n");
+	WRITE(p, "      v += s;\n");
+	WRITE(p, "      if (fsbit(%du))\n", FS_BIT_COLOR_DOUBLE);
+	WRITE(p, "        v.rgb = clamp(v.rgb * 2.0, 0.0, 1.0);\n");
+	WRITE(p, "    } else {\n");
+	WRITE(p, "      v = v_color0 + s;\n");
+	WRITE(p, "    }\n");
+
+	// Same comparisons as the specialized generator, where the listed operator means "fail".
+	WRITE(p, "    if (fsbit(%du)) {\n", FS_BIT_ALPHA_TEST);
+	WRITE(p, "      uint func = fsbits(%du, 3u);\n", FS_BIT_ALPHA_TEST_FUNC);
+	WRITE(p, "      bool fail;\n");
+	WRITE(p, "      if (fsbit(%du)) {\n", FS_BIT_ALPHA_AGAINST_ZERO);
+	WRITE(p, "        if (func == %du || func == %du) fail = v.a < 0.002;\n", GE_COMP_NOTEQUAL, GE_COMP_GREATER);
+	WRITE(p, "        else if (func != %du) fail = v.a > 0.002;\n", GE_COMP_NEVER);
+	WRITE(p, "        else fail = true;\n");
+	WRITE(p, "      } else {\n");
+	WRITE(p, "        int a = roundAndScaleTo255i(v.a) & base.alphacolormask.a;\n");
+	WRITE(p, "        int ref = base.alphacolorref.a;\n");
+	WRITE(p, "        fail = func < %du || (func == %du && a != ref) || (func == %du && a == ref) ||\n", GE_COMP_EQUAL, GE_COMP_EQUAL, GE_COMP_NOTEQUAL);
+	WRITE(p, "          (func == %du && a >= ref) || (func == %du && a > ref) || (func == %du && a <= ref) || (func == %du && a < ref);\n", GE_COMP_LESS, GE_COMP_LEQUAL, GE_COMP_GREATER, GE_COMP_GEQUAL);
+	WRITE(p, "      }\n");
+	WRITE(p, "      if (fail) { if (testToZero) v.a = 0.0; else discard; }\n");
+	WRITE(p, "    }\n");
+
+	WRITE(p, "    if (fsbit(%du)) {\n", FS_BIT_ENABLE_FOG);
+	WRITE(p, "      float fogCoef = clamp(v_fogdepth, 0.0, 1.0);\n");
+	WRITE(p, "      v = mix(vec4(base.fogcolor, v.a), v, fogCoef);\n");
+	WRITE(p, "    }\n");
+
+	WRITE(p, "    if (fsbit(%du)) {\n", FS_BIT_COLOR_TEST);
+	WRITE(p, "      uint func = fsbits(%du, 2u);\n", FS_BIT_COLOR_TEST_FUNC);
+	WRITE(p, "      bool fail;\n");
+	WRITE(p, "      if (fsbit(%du)) {\n", FS_BIT_COLOR_AGAINST_ZERO);
+	WRITE(p, "        if (func == %du) fail = v.r + v.g + v.b < 0.002;\n", GE_COMP_NOTEQUAL);
+	WRITE(p, "        else if (func != %du) fail = v.r + v.g + v.b > 0.002;\n", GE_COMP_NEVER);
+	WRITE(p, "        else fail = true;\n");
+	WRITE(p, "      } else {\n");
+	WRITE(p, "        ivec3 v_scaled = roundAndScaleTo255iv(v.rgb) & base.alphacolormask.rgb;\n");
+	WRITE(p, "        ivec3 ref = base.alphacolorref.rgb & base.alphacolormask.rgb;\n");
+	WRITE(p, "        fail = func < %du || (func == %du && v_scaled != ref) || (func == %du && v_scaled == ref);\n", GE_COMP_EQUAL, GE_COMP_EQUAL, GE_COMP_NOTEQUAL);
+	WRITE(p, "      }\n");
+	WRITE(p, "      if (fail) { if (testToZero) v.a = 0.0; else discard; }\n");
+	WRITE(p, "    }\n");
+
+	WRITE(p, "    uint replaceBlend = fsbits(%du, 3u);\n", FS_BIT_REPLACE_BLEND);
+	WRITE(p, "    if (replaceBlend == %du)\n", REPLACE_BLEND_2X_SRC);
+	WRITE(p, "      v.rgb = v.rgb * 2.0;\n");
+	WRITE(p, "    if (replaceBlend == %du || replaceBlend == %du) {\n", REPLACE_BLEND_PRE_SRC, REPLACE_BLEND_PRE_SRC_2X_ALPHA);
+	WRITE(p, "      uint funcA = fsbits(%du, 4u);\n", FS_BIT_BLENDFUNC_A);
+	WRITE(p, "      vec3 srcFactor = vec3(1.0);\n");
+	WRITE(p, "      if (funcA == %du) srcFactor = vec3(v.a);\n", GE_SRCBLEND_SRCALPHA);
+	WRITE(p, "      else if (funcA == %du) srcFactor = vec3(1.0 - v.a);\n", GE_SRCBLEND_INVSRCALPHA);
+	WRITE(p, "      else if (funcA == %du) srcFactor = vec3(v.a * 2.0);\n", GE_SRCBLEND_DOUBLESRCALPHA);
+	WRITE(p, "      else if (funcA == %du) srcFactor = vec3(1.0 - v.a * 2.0);\n", GE_SRCBLEND_DOUBLEINVSRCALPHA);
+	WRITE(p, "      else if (funcA == %du) srcFactor = base.blendFixA;\n", GE_SRCBLEND_FIXA);
+	WRITE(p, "      v.rgb = v.rgb * srcFactor;\n");
+	WRITE(p, "    }\n");
+	WRITE(p, "    if (replaceBlend == %du || replaceBlend == %du)\n", REPLACE_BLEND_2X_ALPHA, REPLACE_BLEND_PRE_SRC_2X_ALPHA);
+	WRITE(p, "      v.a = v.a * 2.0;\n");
+	WRITE(p, "  }\n");
+
+	WRITE(p, "  if (fsbits(%du, 2u) != %du) {\n", FS_BIT_STENCIL_TO_ALPHA, REPLACE_ALPHA_NO);
+	WRITE(p, "    uint stencilType = fsbits(%du, 4u);\n", FS_BIT_REPLACE_ALPHA_WITH_STENCIL_TYPE);
+	WRITE(p, "    float a = 0.0;\n");
+	WRITE(p, "    if (stencilType == %du) a = base.stencilReplace;\n", STENCIL_VALUE_UNIFORM);
+	WRITE(p, "    else if (stencilType == %du || stencilType == %du) a = 1.0;\n", STENCIL_VALUE_ONE, STENCIL_VALUE_INVERT);
+	WRITE(p, "    else if (stencilType == %du || stencilType == %du) a = %f;\n", STENCIL_VALUE_INCR_4, STENCIL_VALUE_DECR_4, 1.0 / 15.0);
+	WRITE(p, "    else if (stencilType == %du || stencilType == %du) a = %f;\n", STENCIL_VALUE_INCR_8, STENCIL_VALUE_DECR_8, 1.0 / 255.0);
+	WRITE(p, "    v.a = a;\n");
+	WRITE(p, "  }\n");
+	WRITE(p, "  fragColor0 = v;\n");
+
+	WRITE(p, "  uint logicOpType = fsbits(%du, 2u);\n", FS_BIT_REPLACE_LOGIC_OP_TYPE);
+	WRITE(p, "  if (logicOpType == %du)\n", LOGICOPTYPE_ONE);
+	WRITE(p, "    fragColor0.rgb = vec3(1.0, 1.0, 1.0);\n");
+	WRITE(p, "  else if (logicOpType == %du)\n", LOGICOPTYPE_INVERT);
+	WRITE(p, "    fragColor0.rgb = vec3(1.0, 1.0, 1.0) - fragColor0.rgb;\n");
+
+	if (roundDepth) {
+		const double scale = DepthSliceFactor() * 65535.0;
+
+		WRITE(p, "  highp float z = gl_FragCoord.z;\n");
+		if (gstate_c.Supports(GPU_SUPPORTS_ACCURATE_DEPTH)) {
+			if (((int)(DepthSliceFactor() - 1.0f) & 1) == 1) {
+				WRITE(p, "  z = (floor((z * %f) - (1.0 / 2.0)) + (1.0 / 2.0)) * (1.0 / %f);\n", scale, scale);
+			} else {
+				WRITE(p, "  z = floor(z * %f) * (1.0 / %f);\n", scale, scale);
+			}
+		} else {
+			WRITE(p, "  z = (1.0/65535.0) * floor(z * 65535.0);\n");
+		}
+		WRITE(p, "  gl_FragDepth = z;\n");
+	} else {
+		// We can discard, so always write depth to avoid the Adreno early test issue above.
+		WRITE(p, "  gl_FragDepth = gl_FragCoord.z;\n");
+	}
+
+	WRITE(p, "}\n");
+
+	return true;
+}
@@ -21,3 +21,9 @@
 struct FShaderID;
 
 bool GenerateVulkanGLSLFragmentShader(const FShaderID &id, char *buffer, uint32_t vulkanVendorId);
+// True if the shader blends against the destination color, from a copy or (with framebuffer fetch) the input attachment.
+bool FragmentShaderReadsDestColor(const FShaderID &id);
+
+// The uber shader takes the ID from the base uniforms. Only usable for IDs that pass FragmentShaderCanUseUber.
+bool FragmentShaderCanUseUber(const FShaderID &id);
+bool GenerateVulkanGLSLUberFragmentShader(char *buffer, uint32_t vulkanVendorId);
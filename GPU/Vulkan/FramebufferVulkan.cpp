@@ -159,15 +159,22 @@ void FramebufferManagerVulkan::DestroyDeviceObjects() {
 	if (nearestSampler_ != VK_NULL_HANDLE)
 		vulkan_->Delete().QueueDeleteSampler(nearestSampler_);
 
-	if (postVs_) {
-		vulkan2D_->PurgeVertexShader(postVs_);
-		vulkan_->Delete().QueueDeleteShaderModule(postVs_);
+	DestroyPostShader();
+}
+
+void FramebufferManagerVulkan::DestroyPostShader() {
+	// The pipelines themselves get destroyed by vulkan2d.
+	for (VkShaderModule vs : postVs_) {
+		vulkan2D_->PurgeVertexShader(vs);
+		vulkan_->Delete().QueueDeleteShaderModule(vs);
 	}
-	if (postFs_) {
-		vulkan2D_->PurgeFragmentShader(postFs_);
-		vulkan_->Delete().QueueDeleteShaderModule(postFs_);
+	for (VkShaderModule fs : postFs_) {
+		vulkan2D_->PurgeFragmentShader(fs);
+		vulkan_->Delete().QueueDeleteShaderModule(fs);
 	}
-	pipelinePostShader_ = VK_NULL_HANDLE;  // actual pipeline should get destroyed by vulkan2d.
+	postVs_.clear();
+	postFs_.clear();
+	cur2DIsPostShader_ = false;
 }
 
 void FramebufferManagerVulkan::NotifyClear(bool clearColor, bool clearAlpha, bool clearDepth, uint32_t color, float depth) {
@@ -338,7 +345,7 @@ void FramebufferManagerVulkan::DrawActiveTexture(float x, float y, float w, floa
 	VkBuffer vbuffer;
 	VkDeviceSize offset = push_->Push(vtx, sizeof(vtx), &vbuffer);
 	renderManager->BindPipeline(cur2DPipeline_);
-	if (cur2DPipeline_ == pipelinePostShader_) {
+	if (cur2DIsPostShader_) {
 		renderManager->PushConstants(vulkan2D_->GetPipelineLayout(), VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_VERTEX_BIT, 0, (int)sizeof(postShaderUniforms_), &postShaderUniforms_);
 	}
 	renderManager->Draw(vulkan2D_->GetPipelineLayout(), descSet, 0, nullptr, vbuffer, offset, 4);
@@ -347,24 +354,23 @@ void FramebufferManagerVulkan::DrawActiveTexture(float x, float y, float w, floa
 void FramebufferManagerVulkan::Bind2DShader() {
 	VkRenderPass rp = (VkRenderPass)draw_->GetNativeObject(Draw::NativeObject::COMPATIBLE_RENDERPASS);
 	cur2DPipeline_ = vulkan2D_->GetPipeline(rp, vsBasicTex_, fsBasicTex_);
+	cur2DIsPostShader_ = false;
 }
 
-void FramebufferManagerVulkan::BindPostShader(const PostShaderUniforms &uniforms) {
-	if (!pipelinePostShader_) {
-		if (usePostShader_) {
-			CompilePostShader();
-		}
-		if (!usePostShader_) {
-			SetNumExtraFBOs(0);
-			Bind2DShader();
-			return;
-		} else {
-			SetNumExtraFBOs(1);
-		}
+void FramebufferManagerVulkan::BindPostShader(const PostShaderUniforms &uniforms, int pass) {
+	if (postFs_.empty() && usePostShader_) {
+		CompilePostShader();
+	}
+	if (!usePostShader_ || pass < 0 || pass >= (int)postFs_.size()) {
+		Bind2DShader();
+		return;
 	}
 
+	// Passes render to pooled targets of various formats, so get the pipeline for the current pass.
+	VkRenderPass rp = (VkRenderPass)draw_->GetNativeObject(Draw::NativeObject::COMPATIBLE_RENDERPASS);
 	postShaderUniforms_ = uniforms;
-	cur2DPipeline_ = pipelinePostShader_;
+	cur2DPipeline_ = vulkan2D_->GetPipeline(rp, postVs_[pass], postFs_[pass], true, Vulkan2D::VK2DDepthStencilMode::NONE);
+	cur2DIsPostShader_ = true;
 
 	gstate_c.Dirty(DIRTY_VERTEXSHADER_STATE);
 }
@@ -581,8 +587,6 @@ void FramebufferManagerVulkan::DestroyAllFBOs() {
 		tempFB.second.fbo->Release();
 	}
 	tempFBOs_.clear();
-
-	SetNumExtraFBOs(0);
 }
 
 void FramebufferManagerVulkan::Resized() {
@@ -597,35 +601,20 @@ void FramebufferManagerVulkan::Resized() {
 }
 
 void FramebufferManagerVulkan::CompilePostShader() {
-	if (postVs_) {
-		vulkan2D_->PurgeVertexShader(postVs_);
-		vulkan_->Delete().QueueDeleteShaderModule(postVs_);
-	}
-	if (postFs_) {
-		vulkan2D_->PurgeFragmentShader(postFs_);
-		vulkan_->Delete().QueueDeleteShaderModule(postFs_);
-	}
+	DestroyPostShader();
+	usePostShader_ = false;
 
-	const ShaderInfo *shaderInfo = nullptr;
-	if (g_Config.sPostShaderName == "Off") {
-		usePostShader_ = false;
+	LoadPostShaderChain();
+	if (postShaderChain_.empty())
 		return;
-	}
-
-	usePostShader_ = false;
 
-	ReloadAllPostShaderInfo();
-	shaderInfo = GetPostShaderInfo(g_Config.sPostShaderName);
-	std::string errorVSX, errorFSX;
-	std::string vsSource;
-	std::string fsSource;
-	if (shaderInfo) {
-		postShaderAtOutputResolution_ = shaderInfo->outputResolution;
+	std::string errorString;
+	for (const ShaderInfo &shaderInfo : postShaderChain_) {
 		size_t sz;
-		char *vs = (char *)VFSReadFile(shaderInfo->vertexShaderFile.c_str(), &sz);
+		char *vs = (char *)VFSReadFile(shaderInfo.vertexShaderFile.c_str(), &sz);
 		if (!vs)
 			return;
-		char *fs = (char *)VFSReadFile(shaderInfo->fragmentShaderFile.c_str(), &sz);
+		char *fs = (char *)VFSReadFile(shaderInfo.fragmentShaderFile.c_str(), &sz);
 		if (!fs) {
 			free(vs);
 			return;
@@ -634,34 +623,39 @@ void FramebufferManagerVulkan::CompilePostShader() {
 		std::string fsSourceGLSL = fs;
 		free(vs);
 		free(fs);
+
+		std::string vsSource;
+		std::string fsSource;
+		std::string errorVSX, errorFSX;
 		TranslatedShaderMetadata metaVS, metaFS;
 		if (!TranslateShader(&vsSource, GLSL_VULKAN, &metaVS, vsSourceGLSL, GLSL_140, Draw::ShaderStage::VERTEX, &errorVSX))
 			return;
 		if (!TranslateShader(&fsSource, GLSL_VULKAN, &metaFS, fsSourceGLSL, GLSL_140, Draw::ShaderStage::FRAGMENT, &errorFSX))
 			return;
-	} else {
-		return;
-	}
-
-	// TODO: Delete the old pipeline?
 
-	std::string errorVS;
-	std::string errorFS;
-	postVs_ = CompileShaderModule(vulkan_, VK_SHADER_STAGE_VERTEX_BIT, vsSource.c_str(), &errorVS);
-	postFs_ = CompileShaderModule(vulkan_, VK_SHADER_STAGE_FRAGMENT_BIT, fsSource.c_str(), &errorFS);
-
-	VkRenderPass backbufferRP = (VkRenderPass)draw_->GetNativeObject(Draw::NativeObject::BACKBUFFER_RENDERPASS);
+		std::string errorVS;
+		std::string errorFS;
+		VkShaderModule postVs = CompileShaderModule(vulkan_, VK_SHADER_STAGE_VERTEX_BIT, vsSource.c_str(), &errorVS);
+		VkShaderModule postFs = CompileShaderModule(vulkan_, VK_SHADER_STAGE_FRAGMENT_BIT, fsSource.c_str(), &errorFS);
+		if (!postVs || !postFs) {
+			if (postVs)
+				vulkan_->Delete().QueueDeleteShaderModule(postVs);
+			if (postFs)
+				vulkan_->Delete().QueueDeleteShaderModule(postFs);
+			errorString = errorVS + "\n" + errorFS;
+			break;
+		}
+		postVs_.push_back(postVs);
+		postFs_.push_back(postFs);
+	}
 
-	if (postVs_ && postFs_) {
-		pipelinePostShader_ = vulkan2D_->GetPipeline(backbufferRP, postVs_, postFs_, true, Vulkan2D::VK2DDepthStencilMode::NONE);
+	if (postFs_.size() == postShaderChain_.size()) {
 		usePostShader_ = true;
 	} else {
 		ELOG("Failed to compile.");
-		pipelinePostShader_ = VK_NULL_HANDLE;
-		usePostShader_ = false;
+		DestroyPostShader();
 
 		std::string firstLine;
-		std::string errorString = errorVS + "\n" + errorFS;
 		size_t start = 0;
 		for (size_t i = 0; i < errorString.size(); i++) {
 			if (errorString[i] == '\n' && i == start) {
@@ -70,8 +70,9 @@ class FramebufferManagerVulkan : public FramebufferManagerCommon {
 
 protected:
 	void CompilePostShader();
+	void DestroyPostShader();
 	void Bind2DShader() override;
-	void BindPostShader(const PostShaderUniforms &uniforms) override;
+	void BindPostShader(const PostShaderUniforms &uniforms, int pass) override;
 	void SetViewport2D(int x, int y, int w, int h) override;
 
 	// Used by ReadFramebufferToMemory and later framebuffer block copies
@@ -120,10 +121,10 @@ class FramebufferManagerVulkan : public FramebufferManagerCommon {
 
 	VkPipeline cur2DPipeline_ = VK_NULL_HANDLE;
 
-	// Postprocessing
-	VkShaderModule postVs_ = VK_NULL_HANDLE;
-	VkShaderModule postFs_ = VK_NULL_HANDLE;
-	VkPipeline pipelinePostShader_ = VK_NULL_HANDLE;
+	// Postprocessing, one pair of modules per pass in postShaderChain_.
+	std::vector<VkShaderModule> postVs_;
+	std::vector<VkShaderModule> postFs_;
+	bool cur2DIsPostShader_ = false;
 	PostShaderUniforms postShaderUniforms_;
 
 	VkSampler linearSampler_;
@@ -16,6 +16,7 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
 #include <thread>
 
 #include "base/logging.h"
@@ -83,6 +84,8 @@ GPU_Vulkan::GPU_Vulkan(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 	textureCacheVulkan_->SetShaderManager(shaderManagerVulkan_);
 	textureCacheVulkan_->SetDrawEngine(&drawEngine_);
 	textureCacheVulkan_->SetVulkan2D(&vulkan2D_);
+	if (!g_Config.bDisableSlowFramebufEffects)
+		depalShaderCache_.Precompile();
 
 	InitDeviceObjects();
 
@@ -100,6 +103,8 @@ GPU_Vulkan::GPU_Vulkan(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 		drawEngine_.SetLineWidth(PSP_CoreParameter().renderWidth / 480.0f);
 	}
 
+	LoadVertexDecoderCache();
+
 	// Load shader cache.
 	std::string discID = g_paramSFO.GetDiscID();
 	if (discID.size()) {
@@ -169,6 +174,7 @@ void GPU_Vulkan::SaveCache(std::string filename) {
 
 GPU_Vulkan::~GPU_Vulkan() {
 	SaveCache(shaderCachePath_);
+	SaveVertexDecoderCache();
 	// Note: We save the cache in DeviceLost
 	DestroyDeviceObjects();
 	framebufferManagerVulkan_->DestroyAllFBOs();
@@ -252,6 +258,12 @@ void GPU_Vulkan::CheckGPUFeatures() {
 	if (vulkan_->GetDeviceFeatures().enabled.samplerAnisotropy) {
 		features |= GPU_SUPPORTS_ANISOTROPY;
 	}
+	// Shader blending can read the render target as an input attachment instead of a copy.
+	// Only framebuffer render passes have it, not the backbuffer one.
+	VulkanRenderManager *renderManager = (VulkanRenderManager *)draw_->GetNativeObject(Draw::NativeObject::RENDER_MANAGER);
+	if (renderManager->UsesColorInputAttachment() && g_Config.iRenderingMode != FB_NON_BUFFERED_MODE) {
+		features |= GPU_SUPPORTS_ANY_FRAMEBUFFER_FETCH;
+	}
 
 	if (PSP_CoreParameter().compat.flags().ClearToRAM) {
 		features |= GPU_USE_CLEAR_RAM_HACK;
@@ -276,7 +288,13 @@ void GPU_Vulkan::BeginHostFrame() {
 	UpdateCmdInfo();
 
 	if (resized_) {
+		bool usedFramebufferFetch = gstate_c.Supports(GPU_SUPPORTS_ANY_FRAMEBUFFER_FETCH);
 		CheckGPUFeatures();
+		if (usedFramebufferFetch != gstate_c.Supports(GPU_SUPPORTS_ANY_FRAMEBUFFER_FETCH)) {
+			// The rendering mode changed, and shaders that blend read the destination differently now.
+			pipelineManager_->Clear();
+			shaderManagerVulkan_->ClearShaders();
+		}
 		// In case the GPU changed.
 		BuildReportingInfo();
 		framebufferManager_->Resized();
@@ -492,6 +510,14 @@ void GPU_Vulkan::InitDeviceObjects() {
 	if (hacks) {
 		rm->GetQueueRunner()->EnableHacks(hacks);
 	}
+
+	// Leave a core each for the emu and render threads, and don't go overboard.
+	int recordThreads = 0;
+	if (g_Config.bVulkanParallelRecording) {
+		recordThreads = (int)std::thread::hardware_concurrency() - 2;
+		recordThreads = std::max(1, std::min(recordThreads, 4));
+	}
+	rm->GetQueueRunner()->SetParallelRecording(recordThreads);
 }
 
 void GPU_Vulkan::DestroyDeviceObjects() {
@@ -507,8 +533,10 @@ void GPU_Vulkan::DestroyDeviceObjects() {
 	// Need to turn off hacks when shutting down the GPU. Don't want them running in the menu.
 	if (draw_) {
 		VulkanRenderManager *rm = (VulkanRenderManager *)draw_->GetNativeObject(Draw::NativeObject::RENDER_MANAGER);
-		if (rm)
+		if (rm) {
 			rm->GetQueueRunner()->EnableHacks(0);
+			rm->GetQueueRunner()->SetParallelRecording(0);
+		}
 	}
 }
 
@@ -547,6 +575,8 @@ void GPU_Vulkan::DeviceRestore() {
 	textureCacheVulkan_->DeviceRestore(vulkan_, draw_);
 	shaderManagerVulkan_->DeviceRestore(vulkan_, draw_);
 	depalShaderCache_.DeviceRestore(draw_, vulkan_);
+	if (!g_Config.bDisableSlowFramebufEffects)
+		depalShaderCache_.Precompile();
 }
 
 void GPU_Vulkan::GetStats(char *buffer, size_t bufsize) {
@@ -556,22 +586,24 @@ void GPU_Vulkan::GetStats(char *buffer, size_t bufsize) {
 	float vertexAverageCycles = gpuStats.numVertsSubmitted > 0 ? (float)gpuStats.vertexGPUCycles / (float)gpuStats.numVertsSubmitted : 0.0f;
 	snprintf(buffer, bufsize - 1,
 		"DL processing time: %0.2f ms\n"
-		"Draw calls: %i, flushes %i, clears %i\n"
+		"Draw calls: %i, flushes %i (%i skipped), clears %i\n"
 		"Cached Draw calls: %i\n"
 		"Num Tracked Vertex Arrays: %i\n"
 		"GPU cycles executed: %d (%f per vertex)\n"
 		"Commands per call level: %i %i %i %i\n"
 		"Vertices submitted: %i\n"
+		"Draw temporaries peak: %i KB\n"
 		"Cached, Uncached Vertices Drawn: %i, %i\n"
 		"FBOs active: %i\n"
 		"Textures active: %i, decoded: %i  invalidated: %i\n"
 		"Readbacks: %d, uploads: %d\n"
 		"Vertex, Fragment, Pipelines loaded: %i, %i, %i\n"
-		"Pushbuffer space used: UBO %d, Vtx %d, Idx %d\n"
+		"Pushbuffer space used: UBO %d, Vtx %d, Idx %d (grown %d times)\n"
 		"%s\n",
 		gpuStats.msProcessingDisplayLists * 1000.0f,
 		gpuStats.numDrawCalls,
 		gpuStats.numFlushes,
+		gpuStats.numFlushesSkipped,
 		gpuStats.numClears,
 		gpuStats.numCachedDrawCalls,
 		gpuStats.numTrackedVertexArrays,
@@ -579,6 +611,7 @@ void GPU_Vulkan::GetStats(char *buffer, size_t bufsize) {
 		vertexAverageCycles,
 		gpuStats.gpuCommandsAtCallLevel[0], gpuStats.gpuCommandsAtCallLevel[1], gpuStats.gpuCommandsAtCallLevel[2], gpuStats.gpuCommandsAtCallLevel[3],
 		gpuStats.numVertsSubmitted,
+		gpuStats.frameArenaHighWater / 1024,
 		gpuStats.numCachedVertsDrawn,
 		gpuStats.numUncachedVertsDrawn,
 		(int)framebufferManager_->NumVFBs(),
@@ -593,6 +626,7 @@ void GPU_Vulkan::GetStats(char *buffer, size_t bufsize) {
 		drawStats.pushUBOSpaceUsed,
 		drawStats.pushVertexSpaceUsed,
 		drawStats.pushIndexSpaceUsed,
+		drawStats.pushBufferGrowCount,
 		texStats
 	);
 }
@@ -611,12 +645,14 @@ void GPU_Vulkan::DoState(PointerWrap &p) {
 	// TODO: Some of these things may not be necessary.
 	// None of these are necessary when saving.
 	// In Freeze-Frame mode, we don't want to do any of this.
-	if (p.mode == p.MODE_READ && !PSP_CoreParameter().frozen) {
+	if (p.mode == p.MODE_READ && !PSP_CoreParameter().frozen && !PSP_CoreParameter().runAheadFrame) {
 		textureCacheVulkan_->Clear(true);
 		depalShaderCache_.Clear();
 
 		gstate_c.Dirty(DIRTY_TEXTURE_IMAGE);
 		framebufferManagerVulkan_->DestroyAllFBOs();
+		// Pending readbacks would overwrite the freshly loaded RAM.
+		draw_->DiscardAsyncCopies();
 	}
 }
 
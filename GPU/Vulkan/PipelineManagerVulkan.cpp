@@ -1,12 +1,17 @@
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <memory>
 #include <set>
 
 #include "profiler/profiler.h"
+#include "thread/threadutil.h"
 
 #include "Common/Log.h"
 #include "Common/StringUtils.h"
 #include "Common/Vulkan/VulkanContext.h"
+#include "Core/Core.h"
+#include "Core/System.h"
 #include "GPU/Vulkan/VulkanUtil.h"
 #include "GPU/Vulkan/PipelineManagerVulkan.h"
 #include "GPU/Vulkan/ShaderManagerVulkan.h"
@@ -21,6 +26,14 @@ PipelineManagerVulkan::PipelineManagerVulkan(VulkanContext *vulkan) : vulkan_(vu
 
 PipelineManagerVulkan::~PipelineManagerVulkan() {
 	Clear();
+	if (asyncThread_.joinable()) {
+		{
+			std::lock_guard<std::mutex> guard(asyncLock_);
+			asyncStop_ = true;
+			asyncCond_.notify_all();
+		}
+		asyncThread_.join();
+	}
 	if (pipelineCache_ != VK_NULL_HANDLE)
 		vulkan_->Delete().QueueDeletePipelineCache(pipelineCache_);
 }
@@ -30,6 +43,9 @@ void PipelineManagerVulkan::Clear() {
 	// This could also be an opportunity to store the whole cache to disk. Will need to also
 	// store the keys.
 
+	// Pending placeholders are about to be deleted, so let the worker finish with them first.
+	WaitForAsyncPipelines();
+
 	pipelines_.Iterate([&](const VulkanPipelineKey &key, VulkanPipeline *value) {
 		if (value->pipeline)
 			vulkan_->Delete().QueueDeletePipeline(value->pipeline);
@@ -344,10 +360,33 @@ VulkanPipeline *PipelineManagerVulkan::GetOrCreatePipeline(VkPipelineLayout layo
 	key.fShader = fs->GetModule();
 	key.vtxFmtId = useHwTransform ? decFmt->id : 0;
 
+	if (asyncPending_)
+		ApplyAsyncPipelines();
+
 	auto iter = pipelines_.Get(key);
 	if (iter)
 		return iter;
 
+	if (PSP_CoreParameter().compat.flags().AsyncPipelineCreation) {
+		// Insert an empty placeholder and skip draws using it until the worker has filled it in.
+		VulkanPipeline *placeholder = new VulkanPipeline();
+		placeholder->pipeline = VK_NULL_HANDLE;
+		placeholder->flags = 0;
+		pipelines_.Insert(key, placeholder);
+
+		PipelineJob job{ key, layout, renderPass, rasterKey, {}, vs, fs, useHwTransform, lineWidth_, placeholder, nullptr };
+		if (decFmt)
+			job.decFmt = *decFmt;
+
+		std::lock_guard<std::mutex> guard(asyncLock_);
+		if (!asyncThread_.joinable())
+			asyncThread_ = std::thread([this] { AsyncWorker(); });
+		asyncQueue_.push_back(job);
+		asyncPending_++;
+		asyncCond_.notify_all();
+		return nullptr;
+	}
+
 	VulkanPipeline *pipeline = CreateVulkanPipeline(
 		vulkan_->GetDevice(), pipelineCache_, layout, renderPass, 
 		rasterKey, decFmt, vs, fs, useHwTransform, lineWidth_);
@@ -361,6 +400,85 @@ VulkanPipeline *PipelineManagerVulkan::GetOrCreatePipeline(VkPipelineLayout layo
 	}
 }
 
+VulkanPipeline *PipelineManagerVulkan::CreatePipelineFromJob(const PipelineJob &job) {
+	return CreateVulkanPipeline(
+		vulkan_->GetDevice(), pipelineCache_, job.layout, job.renderPass,
+		job.rasterKey, job.useHwTransform ? &job.decFmt : nullptr, job.vs, job.fs, job.useHwTransform, job.lineWidth);
+}
+
+void PipelineManagerVulkan::CreatePipelinesParallel(std::vector<PipelineJob> &jobs) {
+	// vkCreateGraphicsPipelines and the pipeline cache are internally synchronized, so we can
+	// simply spread the jobs over a few threads.
+	int numThreads = std::max(1, std::min((int)std::thread::hardware_concurrency(), 4));
+	numThreads = std::min(numThreads, (int)jobs.size());
+
+	std::atomic<size_t> next(0);
+	auto work = [&] {
+		size_t i;
+		while (!cancelCache_ && (i = next++) < jobs.size()) {
+			jobs[i].result = CreatePipelineFromJob(jobs[i]);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < numThreads; i++) {
+		threads.push_back(std::thread([&] {
+			setCurrentThreadName("VkPipelineLoad");
+			work();
+		}));
+	}
+	work();
+	for (auto &th : threads) {
+		th.join();
+	}
+}
+
+void PipelineManagerVulkan::AsyncWorker() {
+	setCurrentThreadName("VkPipeline");
+
+	std::unique_lock<std::mutex> guard(asyncLock_);
+	while (!asyncStop_) {
+		if (asyncQueue_.empty()) {
+			asyncCond_.wait(guard);
+			continue;
+		}
+
+		PipelineJob job = asyncQueue_.front();
+		asyncQueue_.pop_front();
+		asyncBusy_ = true;
+		guard.unlock();
+
+		job.result = CreatePipelineFromJob(job);
+
+		guard.lock();
+		asyncBusy_ = false;
+		asyncDone_.push_back(job);
+		asyncCond_.notify_all();
+	}
+}
+
+void PipelineManagerVulkan::ApplyAsyncPipelines() {
+	std::lock_guard<std::mutex> guard(asyncLock_);
+	for (PipelineJob &job : asyncDone_) {
+		// The placeholder pointer is what callers hold, so copy the result into it.
+		job.target->pipeline = job.result->pipeline;
+		job.target->flags = job.result->flags;
+		delete job.result;
+		asyncPending_--;
+	}
+	asyncDone_.clear();
+}
+
+void PipelineManagerVulkan::WaitForAsyncPipelines() {
+	if (!asyncPending_)
+		return;
+	{
+		std::unique_lock<std::mutex> guard(asyncLock_);
+		asyncCond_.wait(guard, [&] { return asyncQueue_.empty() && !asyncBusy_; });
+	}
+	ApplyAsyncPipelines();
+}
+
 std::vector<std::string> PipelineManagerVulkan::DebugGetObjectIDs(DebugShaderType type) {
 	std::vector<std::string> ids;
 	switch (type) {
@@ -547,6 +665,8 @@ void PipelineManagerVulkan::SetLineWidth(float lineWidth) {
 		return;
 	lineWidth_ = lineWidth;
 
+	WaitForAsyncPipelines();
+
 	// Wipe all line-drawing pipelines.
 	pipelines_.Iterate([&](const VulkanPipelineKey &key, VulkanPipeline *value) {
 		if (value->UsesLines()) {
@@ -620,6 +740,9 @@ void PipelineManagerVulkan::SaveCache(FILE *file, bool saveRawPipelineCache, Sha
 	pipelines_.Iterate([&](const VulkanPipelineKey &pkey, VulkanPipeline *value) {
 		if (failed)
 			return;
+		// Uber shader pipelines are only stand-ins, no point recreating them at boot.
+		if (shaderManager->IsUberFragmentShader(pkey.fShader))
+			return;
 		VulkanVertexShader *vshader = shaderManager->GetVertexShaderFromModule(pkey.vShader);
 		VulkanFragmentShader *fshader = shaderManager->GetFragmentShaderFromModule(pkey.fShader);
 		if (!vshader || !fshader) {
@@ -726,6 +849,9 @@ bool PipelineManagerVulkan::LoadCache(FILE *file, bool loadRawPipelineCache, Sha
 	bool failed = fread(&size, sizeof(size), 1, file) != 1;
 
 	NOTICE_LOG(G3D, "Creating %d pipelines...", size);
+	// Resolve everything up front on this thread, then create the pipelines in parallel.
+	std::vector<PipelineJob> jobs;
+	jobs.reserve(failed ? 0 : size);
 	for (uint32_t i = 0; i < size; i++) {
 		if (failed || cancelCache_) {
 			break;
@@ -751,13 +877,45 @@ bool PipelineManagerVulkan::LoadCache(FILE *file, bool loadRawPipelineCache, Sha
 			rp = queueRunner->GetRenderPass(key.renderPassKey);
 		}
 
-		DecVtxFormat fmt;
-		fmt.InitializeFromID(key.vtxFmtId);
-		GetOrCreatePipeline(layout, rp, key.raster,
-			key.useHWTransform ? &fmt : 0,
-			vs, fs, key.useHWTransform);
+		PipelineJob job{};
+		job.key.raster = key.raster;
+		job.key.renderPass = rp;
+		job.key.useHWTransform = key.useHWTransform;
+		job.key.vShader = vs->GetModule();
+		job.key.fShader = fs->GetModule();
+		job.key.vtxFmtId = key.useHWTransform ? key.vtxFmtId : 0;
+		if (pipelines_.Get(job.key))
+			continue;
+
+		job.layout = layout;
+		job.renderPass = rp;
+		job.rasterKey = key.raster;
+		if (key.useHWTransform)
+			job.decFmt.InitializeFromID(key.vtxFmtId);
+		job.vs = vs;
+		job.fs = fs;
+		job.useHwTransform = key.useHWTransform;
+		job.lineWidth = lineWidth_;
+		jobs.push_back(job);
+	}
+
+	CreatePipelinesParallel(jobs);
+
+	int created = 0;
+	for (PipelineJob &job : jobs) {
+		if (!job.result)
+			continue;
+		if (pipelines_.Get(job.key)) {
+			// Duplicate entry in the file.
+			if (job.result->pipeline)
+				vulkan_->Delete().QueueDeletePipeline(job.result->pipeline);
+			delete job.result;
+			continue;
+		}
+		pipelines_.Insert(job.key, job.result);
+		created++;
 	}
-	NOTICE_LOG(G3D, "Recreated Vulkan pipeline cache (%d pipelines).", (int)size);
+	NOTICE_LOG(G3D, "Recreated Vulkan pipeline cache (%d pipelines).", created);
 	return true;
 }
 
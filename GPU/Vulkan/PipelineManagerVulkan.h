@@ -17,7 +17,13 @@
 
 #pragma once
 
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "Common/Hashmaps.h"
 
 #include "GPU/Common/VertexDecoderCommon.h"
@@ -101,9 +107,43 @@ class PipelineManagerVulkan {
 	void CancelCache();
 
 private:
+	// Everything needed to create a pipeline away from the emu thread.
+	struct PipelineJob {
+		VulkanPipelineKey key;
+		VkPipelineLayout layout;
+		VkRenderPass renderPass;
+		VulkanPipelineRasterStateKey rasterKey;
+		DecVtxFormat decFmt;
+		VulkanVertexShader *vs;
+		VulkanFragmentShader *fs;
+		bool useHwTransform;
+		float lineWidth;
+		// For async jobs, this is the placeholder in pipelines_ that receives the result.
+		VulkanPipeline *target;
+		VulkanPipeline *result;
+	};
+
+	VulkanPipeline *CreatePipelineFromJob(const PipelineJob &job);
+	void CreatePipelinesParallel(std::vector<PipelineJob> &jobs);
+
+	void AsyncWorker();
+	void ApplyAsyncPipelines();
+	void WaitForAsyncPipelines();
+
 	DenseHashMap<VulkanPipelineKey, VulkanPipeline *, nullptr> pipelines_;
 	VkPipelineCache pipelineCache_ = VK_NULL_HANDLE;
 	VulkanContext *vulkan_;
 	float lineWidth_ = 1.0f;
 	bool cancelCache_ = false;
+
+	// Runtime async creation, only used when the game's compat flags allow skipping draws.
+	std::thread asyncThread_;
+	std::mutex asyncLock_;
+	std::condition_variable asyncCond_;
+	std::deque<PipelineJob> asyncQueue_;
+	std::vector<PipelineJob> asyncDone_;
+	bool asyncBusy_ = false;
+	bool asyncStop_ = false;
+	// Only touched on the emu thread.
+	int asyncPending_ = 0;
 };
@@ -190,6 +190,8 @@ void ShaderManagerVulkan::Clear() {
 	});
 	fsCache_.Clear();
 	vsCache_.Clear();
+	delete uberFShader_;
+	uberFShader_ = nullptr;
 	lastFSID_.set_invalid();
 	lastVSID_.set_invalid();
 	gstate_c.Dirty(DIRTY_VERTEXSHADER_STATE | DIRTY_FRAGMENTSHADER_STATE);
@@ -265,6 +267,7 @@ void ShaderManagerVulkan::GetShaders(int prim, u32 vertType, VulkanVertexShader
 		GenerateVulkanGLSLVertexShader(VSID, codeBuffer_);
 		vs = new VulkanVertexShader(vulkan_, VSID, codeBuffer_, useHWTransform);
 		vsCache_.Insert(VSID, vs);
+		gpuStats.numShadersCompiled++;
 	}
 	lastVSID_ = VSID;
 
@@ -275,6 +278,7 @@ void ShaderManagerVulkan::GetShaders(int prim, u32 vertType, VulkanVertexShader
 		GenerateVulkanGLSLFragmentShader(FSID, codeBuffer_, vendorID);
 		fs = new VulkanFragmentShader(vulkan_, FSID, codeBuffer_);
 		fsCache_.Insert(FSID, fs);
+		gpuStats.numShadersCompiled++;
 	}
 
 	lastFSID_ = FSID;
@@ -352,6 +356,25 @@ VulkanFragmentShader *ShaderManagerVulkan::GetFragmentShaderFromModule(VkShaderM
 	return fs;
 }
 
+VulkanFragmentShader *ShaderManagerVulkan::GetUberFragmentShader() {
+	if (!uberFShader_) {
+		uint32_t vendorID = vulkan_->GetPhysicalDeviceProperties().properties.vendorID;
+		GenerateVulkanGLSLUberFragmentShader(codeBuffer_, vendorID);
+		FShaderID id;
+		id.set_invalid();
+		uberFShader_ = new VulkanFragmentShader(vulkan_, id, codeBuffer_);
+	}
+	return uberFShader_->Failed() ? nullptr : uberFShader_;
+}
+
+bool ShaderManagerVulkan::SetUberFragmentID(const FShaderID &id) {
+	if (ub_base.uberFragmentID[0] == id.d[0] && ub_base.uberFragmentID[1] == id.d[1])
+		return false;
+	ub_base.uberFragmentID[0] = id.d[0];
+	ub_base.uberFragmentID[1] = id.d[1];
+	return true;
+}
+
 // Shader cache.
 //
 // We simply store the IDs of the shaders used during gameplay. On next startup of
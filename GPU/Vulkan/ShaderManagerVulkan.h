@@ -102,6 +102,12 @@ class ShaderManagerVulkan : public ShaderManagerCommon {
 	VulkanVertexShader *GetVertexShaderFromModule(VkShaderModule module);
 	VulkanFragmentShader *GetFragmentShaderFromModule(VkShaderModule module);
 
+	// Compiled on first use. Returns nullptr if it failed to compile.
+	VulkanFragmentShader *GetUberFragmentShader();
+	bool IsUberFragmentShader(VkShaderModule module) const { return uberFShader_ && uberFShader_->GetModule() == module; }
+	// Returns true if the ID changed, and the base uniforms need to be pushed again.
+	bool SetUberFragmentID(const FShaderID &id);
+
 	std::vector<std::string> DebugGetShaderIDs(DebugShaderType type);
 	std::string DebugGetShaderString(std::string id, DebugShaderType type, DebugShaderStringType stringType);
 
@@ -119,11 +125,16 @@ class ShaderManagerVulkan : public ShaderManagerCommon {
 	uint32_t PushLightBuffer(VulkanPushBuffer *dest, VkBuffer *buf) {
 		return dest->PushAligned(&ub_lights, sizeof(ub_lights), uboAlignment_, buf);
 	}
-	// TODO: Only push half the bone buffer if we only have four bones.
-	uint32_t PushBoneBuffer(VulkanPushBuffer *dest, VkBuffer *buf) {
-		return dest->PushAligned(&ub_bones, sizeof(ub_bones), uboAlignment_, buf);
+	// The whole block is allocated so the descriptor range stays valid, but only the used bones are copied.
+	uint32_t PushBoneBuffer(VulkanPushBuffer *dest, VkBuffer *buf, int numBones) {
+		uint32_t offset;
+		void *ptr = dest->PushAligned(sizeof(ub_bones), &offset, buf, (int)uboAlignment_);
+		memcpy(ptr, &ub_bones, numBones * sizeof(ub_bones.bones[0]));
+		return offset;
 	}
 
+	const VShaderID &GetLastVSID() const { return lastVSID_; }
+
 	bool LoadCache(FILE *f);
 	void SaveCache(FILE *f);
 
@@ -148,6 +159,7 @@ class ShaderManagerVulkan : public ShaderManagerCommon {
 
 	VulkanFragmentShader *lastFShader_;
 	VulkanVertexShader *lastVShader_;
+	VulkanFragmentShader *uberFShader_ = nullptr;
 
 	FShaderID lastFSID_;
 	VShaderID lastVSID_;
@@ -27,6 +27,7 @@
 #include "Core/Config.h"
 #include "Core/Reporting.h"
 #include "GPU/Vulkan/GPU_Vulkan.h"
+#include "GPU/Vulkan/FragmentShaderGeneratorVulkan.h"
 #include "GPU/Vulkan/PipelineManagerVulkan.h"
 #include "GPU/Vulkan/TextureCacheVulkan.h"
 #include "GPU/Vulkan/FramebufferVulkan.h"
@@ -387,7 +388,15 @@ void DrawEngineVulkan::ConvertStateToVulkanKey(FramebufferManagerVulkan &fbManag
 	}
 }
 
-void DrawEngineVulkan::BindShaderBlendTex() {
+void DrawEngineVulkan::BindShaderBlendTex(VulkanFragmentShader *fshader) {
+	// With framebuffer fetch, the shader reads the render target itself, so there's nothing to copy.
+	boundInput_ = VK_NULL_HANDLE;
+	if (gstate_c.Supports(GPU_SUPPORTS_ANY_FRAMEBUFFER_FETCH) && FragmentShaderReadsDestColor(fshader->GetID())) {
+		VulkanRenderManager *renderManager = (VulkanRenderManager *)draw_->GetNativeObject(Draw::NativeObject::RENDER_MANAGER);
+		boundInput_ = renderManager->GetColorInputView();
+		_dbg_assert_msg_(G3D, boundInput_ != VK_NULL_HANDLE, "Framebuffer fetch without a framebuffer");
+	}
+
 	// At this point, we know if the vertices are full alpha or not.
 	// TODO: Set the nearest/linear here (since we correctly know if alpha/color tests are needed)?
 	if (!gstate.isModeClear()) {
@@ -79,6 +79,22 @@ void main() {
 }
 )";
 
+// With VK_EXT_shader_stencil_export, the shader writes the whole stencil value at once, so one pass
+// replaces the per-bit passes above. No discard, so early fragment tests aren't a concern here.
+static const char *stencil_fs_export = R"(#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+#extension GL_ARB_shader_stencil_export : enable
+layout (binding = 0) uniform sampler2D tex;
+layout (location = 0) in vec2 v_texcoord0;
+layout (location = 0) out vec4 fragColor0;
+
+void main() {
+	vec4 index = texture(tex, v_texcoord0);
+	gl_FragStencilRefARB = int(floor(index.a * 255.99)) & 0xFF;
+	fragColor0 = index.aaaa;
+}
+)";
 
 static const char stencil_vs[] = R"(#version 450
 #extension GL_ARB_separate_shader_objects : enable
@@ -142,12 +158,19 @@ bool FramebufferManagerVulkan::NotifyStencilUpload(u32 addr, int size, bool skip
 		break;
 	}
 
+	// The unpacked alpha of each format is already the full stencil value: 0 or 255 for 5551, and
+	// the nibble repeated for 4444, which is what the per-bit passes build up.
+	const bool useExport = vulkan_->DeviceExtensions().EXT_shader_stencil_export;
+
 	std::string error;
 	if (!stencilVs_) {
 		const char *stencil_fs_source = stencil_fs;
-		// See comment above the stencil_fs_adreno definition.
-		if (vulkan_->GetPhysicalDeviceProperties().properties.vendorID == VULKAN_VENDOR_QUALCOMM)
+		if (useExport) {
+			stencil_fs_source = stencil_fs_export;
+		} else if (vulkan_->GetPhysicalDeviceProperties().properties.vendorID == VULKAN_VENDOR_QUALCOMM) {
+			// See comment above the stencil_fs_adreno definition.
 			stencil_fs_source = stencil_fs_adreno;
+		}
 
 		stencilVs_ = CompileShaderModule(vulkan_, VK_SHADER_STAGE_VERTEX_BIT, stencil_vs, &error);
 		stencilFs_ = CompileShaderModule(vulkan_, VK_SHADER_STAGE_FRAGMENT_BIT, stencil_fs_source, &error);
@@ -178,6 +201,16 @@ bool FramebufferManagerVulkan::NotifyStencilUpload(u32 addr, int size, bool skip
 
 	VkDescriptorSet descSet = vulkan2D_->GetDescriptorSet(overrideImageView_, nearestSampler_, VK_NULL_HANDLE, VK_NULL_HANDLE);
 
+	if (useExport) {
+		// Every pixel gets written, so no clear pass either.
+		renderManager->SetStencilParams(0xFF, 0xFF, 0xFF);
+		renderManager->Draw(vulkan2D_->GetPipelineLayout(), descSet, 0, nullptr, VK_NULL_HANDLE, 0, 3);  // full screen triangle
+
+		overrideImageView_ = VK_NULL_HANDLE;
+		RebindFramebuffer();
+		return true;
+	}
+
 	// Note: Even with skipZero, we don't necessarily start framebuffers at 0 in Vulkan.  Clear anyway.
 	// Not an actual clear, because we need to draw to alpha only as well.
 	uint32_t value = 0;
@@ -44,6 +44,7 @@
 #include "GPU/Vulkan/DepalettizeShaderVulkan.h"
 #include "GPU/Vulkan/ShaderManagerVulkan.h"
 #include "GPU/Vulkan/DrawEngineVulkan.h"
+#include "GPU/Common/ScalingShaderCommon.h"
 #include "GPU/Common/TextureDecoder.h"
 
 #ifdef _M_SSE
@@ -67,291 +68,6 @@ static const VkComponentMapping VULKAN_1555_SWIZZLE = { VK_COMPONENT_SWIZZLE_B,
 static const VkComponentMapping VULKAN_565_SWIZZLE = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
 static const VkComponentMapping VULKAN_8888_SWIZZLE = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
 
-// 4xBRZ shader - Copyright (C) 2014-2016 DeSmuME team (GPL2+)
-// Hyllian's xBR-vertex code and texel mapping
-// Copyright (C) 2011/2016 Hyllian - sergiogdb@gmail.com
-// TODO: Handles alpha badly for PSP.
-const char *shader4xbrz = R"(
-vec4 premultiply_alpha(vec4 c) { float a = clamp(c.a, 0.0, 1.0); return vec4(c.rgb * a, a); }
-vec4 postdivide_alpha(vec4 c) { return c.a < 0.001? vec4(0.0,0.0,0.0,0.0) : vec4(c.rgb / c.a, c.a); }
-
-#define BLEND_ALPHA 1
-#define BLEND_NONE 0
-#define BLEND_NORMAL 1
-#define BLEND_DOMINANT 2
-#define LUMINANCE_WEIGHT 1.0
-#define EQUAL_COLOR_TOLERANCE 30.0/255.0
-#define STEEP_DIRECTION_THRESHOLD 2.2
-#define DOMINANT_DIRECTION_THRESHOLD 3.6
-
-float reduce(vec4 color) {
-	return dot(color.rgb, vec3(65536.0, 256.0, 1.0));
-}
-
-float DistYCbCr(vec4 pixA, vec4 pixB) {
-	const vec3 w = vec3(0.2627, 0.6780, 0.0593);
-	const float scaleB = 0.5 / (1.0 - w.b);
-	const float scaleR = 0.5 / (1.0 - w.r);
-	vec4 diff = pixA - pixB;
-	float Y = dot(diff.rgb, w);
-	float Cb = scaleB * (diff.b - Y);
-	float Cr = scaleR * (diff.r - Y);
-
-	return sqrt( ((LUMINANCE_WEIGHT * Y) * (LUMINANCE_WEIGHT * Y)) + (Cb * Cb) + (Cr * Cr) + (diff.a * diff.a));
-}
-
-bool IsPixEqual(const vec4 pixA, const vec4 pixB) {
-	return (DistYCbCr(pixA, pixB) < EQUAL_COLOR_TOLERANCE);
-}
-
-bool IsBlendingNeeded(const ivec4 blend) {
-	ivec4 diff = blend - ivec4(BLEND_NONE);
-	return diff.x != 0 || diff.y != 0 || diff.z != 0 || diff.w != 0;
-}
-
-vec4 applyScalingf(uvec2 origxy, uvec2 xy) {
-	float dx = 1.0 / params.width;
-	float dy = 1.0 / params.height;
-
-	//    A1 B1 C1
-	// A0 A  B  C C4
-	// D0 D  E  F F4
-	// G0 G  H  I I4
-	//    G5 H5 I5
-
-	uvec4 t1 = uvec4(origxy.x - 1, origxy.x, origxy.x + 1, origxy.y - 2); // A1 B1 C1
-	uvec4 t2 = uvec4(origxy.x - 1, origxy.x, origxy.x + 1, origxy.y - 1); // A B C
-	uvec4 t3 = uvec4(origxy.x - 1, origxy.x, origxy.x + 1, origxy.y + 0); // D E F
-	uvec4 t4 = uvec4(origxy.x - 1, origxy.x, origxy.x + 1, origxy.y + 1); // G H I
-	uvec4 t5 = uvec4(origxy.x - 1, origxy.x, origxy.x + 1, origxy.y + 2); // G5 H5 I5
-	uvec4 t6 = uvec4(origxy.x - 2, origxy.y - 1, origxy.y, origxy.y + 1); // A0 D0 G0
-	uvec4 t7 = uvec4(origxy.x + 2, origxy.y - 1, origxy.y, origxy.y + 1); // C4 F4 I4
-
-	vec2 f = fract(vec2(float(xy.x) / float(params.scale), float(xy.y) / float(params.scale)));
-
-	//---------------------------------------
-	// Input Pixel Mapping:    |21|22|23|
-	//                       19|06|07|08|09
-	//                       18|05|00|01|10
-	//                       17|04|03|02|11
-	//                         |15|14|13|
-
-	vec4 src[25];
-
-	src[21] = premultiply_alpha(readColorf(t1.xw));
-	src[22] = premultiply_alpha(readColorf(t1.yw));
-	src[23] = premultiply_alpha(readColorf(t1.zw));
-	src[ 6] = premultiply_alpha(readColorf(t2.xw));
-	src[ 7] = premultiply_alpha(readColorf(t2.yw));
-	src[ 8] = premultiply_alpha(readColorf(t2.zw));
-	src[ 5] = premultiply_alpha(readColorf(t3.xw));
-	src[ 0] = premultiply_alpha(readColorf(t3.yw));
-	src[ 1] = premultiply_alpha(readColorf(t3.zw));
-	src[ 4] = premultiply_alpha(readColorf(t4.xw));
-	src[ 3] = premultiply_alpha(readColorf(t4.yw));
-	src[ 2] = premultiply_alpha(readColorf(t4.zw));
-	src[15] = premultiply_alpha(readColorf(t5.xw));
-	src[14] = premultiply_alpha(readColorf(t5.yw));
-	src[13] = premultiply_alpha(readColorf(t5.zw));
-	src[19] = premultiply_alpha(readColorf(t6.xy));
-	src[18] = premultiply_alpha(readColorf(t6.xz));
-	src[17] = premultiply_alpha(readColorf(t6.xw));
-	src[ 9] = premultiply_alpha(readColorf(t7.xy));
-	src[10] = premultiply_alpha(readColorf(t7.xz));
-	src[11] = premultiply_alpha(readColorf(t7.xw));
-
-	float v[9];
-	v[0] = reduce(src[0]);
-	v[1] = reduce(src[1]);
-	v[2] = reduce(src[2]);
-	v[3] = reduce(src[3]);
-	v[4] = reduce(src[4]);
-	v[5] = reduce(src[5]);
-	v[6] = reduce(src[6]);
-	v[7] = reduce(src[7]);
-	v[8] = reduce(src[8]);
-
-	ivec4 blendResult = ivec4(BLEND_NONE);
-
-	// Preprocess corners
-	// Pixel Tap Mapping: --|--|--|--|--
-	//                    --|--|07|08|--
-	//                    --|05|00|01|10
-	//                    --|04|03|02|11
-	//                    --|--|14|13|--
-	// Corner (1, 1)
-	if ( ((v[0] == v[1] && v[3] == v[2]) || (v[0] == v[3] && v[1] == v[2])) == false) {
-		float dist_03_01 = DistYCbCr(src[ 4], src[ 0]) + DistYCbCr(src[ 0], src[ 8]) + DistYCbCr(src[14], src[ 2]) + DistYCbCr(src[ 2], src[10]) + (4.0 * DistYCbCr(src[ 3], src[ 1]));
-		float dist_00_02 = DistYCbCr(src[ 5], src[ 3]) + DistYCbCr(src[ 3], src[13]) + DistYCbCr(src[ 7], src[ 1]) + DistYCbCr(src[ 1], src[11]) + (4.0 * DistYCbCr(src[ 0], src[ 2]));
-		bool dominantGradient = (DOMINANT_DIRECTION_THRESHOLD * dist_03_01) < dist_00_02;
-		blendResult[2] = ((dist_03_01 < dist_00_02) && (v[0] != v[1]) && (v[0] != v[3])) ? ((dominantGradient) ? BLEND_DOMINANT : BLEND_NORMAL) : BLEND_NONE;
-	}
-
-	// Pixel Tap Mapping: --|--|--|--|--
-	//                    --|06|07|--|--
-	//                    18|05|00|01|--
-	//                    17|04|03|02|--
-	//                    --|15|14|--|--
-	// Corner (0, 1)
-	if ( ((v[5] == v[0] && v[4] == v[3]) || (v[5] == v[4] && v[0] == v[3])) == false) {
-		float dist_04_00 = DistYCbCr(src[17], src[ 5]) + DistYCbCr(src[ 5], src[ 7]) + DistYCbCr(src[15], src[ 3]) + DistYCbCr(src[ 3], src[ 1]) + (4.0 * DistYCbCr(src[ 4], src[ 0]));
-		float dist_05_03 = DistYCbCr(src[18], src[ 4]) + DistYCbCr(src[ 4], src[14]) + DistYCbCr(src[ 6], src[ 0]) + DistYCbCr(src[ 0], src[ 2]) + (4.0 * DistYCbCr(src[ 5], src[ 3]));
-		bool dominantGradient = (DOMINANT_DIRECTION_THRESHOLD * dist_05_03) < dist_04_00;
-		blendResult[3] = ((dist_04_00 > dist_05_03) && (v[0] != v[5]) && (v[0] != v[3])) ? ((dominantGradient) ? BLEND_DOMINANT : BLEND_NORMAL) : BLEND_NONE;
-	}
-
-	// Pixel Tap Mapping: --|--|22|23|--
-	//                    --|06|07|08|09
-	//                    --|05|00|01|10
-	//                    --|--|03|02|--
-	//                    --|--|--|--|--
-	// Corner (1, 0)
-	if ( ((v[7] == v[8] && v[0] == v[1]) || (v[7] == v[0] && v[8] == v[1])) == false) {
-		float dist_00_08 = DistYCbCr(src[ 5], src[ 7]) + DistYCbCr(src[ 7], src[23]) + DistYCbCr(src[ 3], src[ 1]) + DistYCbCr(src[ 1], src[ 9]) + (4.0 * DistYCbCr(src[ 0], src[ 8]));
-		float dist_07_01 = DistYCbCr(src[ 6], src[ 0]) + DistYCbCr(src[ 0], src[ 2]) + DistYCbCr(src[22], src[ 8]) + DistYCbCr(src[ 8], src[10]) + (4.0 * DistYCbCr(src[ 7], src[ 1]));
-		bool dominantGradient = (DOMINANT_DIRECTION_THRESHOLD * dist_07_01) < dist_00_08;
-		blendResult[1] = ((dist_00_08 > dist_07_01) && (v[0] != v[7]) && (v[0] != v[1])) ? ((dominantGradient) ? BLEND_DOMINANT : BLEND_NORMAL) : BLEND_NONE;
-	}
-
-	// Pixel Tap Mapping: --|21|22|--|--
-	//                    19|06|07|08|--
-	//                    18|05|00|01|--
-	//                    --|04|03|--|--
-	//                    --|--|--|--|--
-	// Corner (0, 0)
-	if ( ((v[6] == v[7] && v[5] == v[0]) || (v[6] == v[5] && v[7] == v[0])) == false) {
-		float dist_05_07 = DistYCbCr(src[18], src[ 6]) + DistYCbCr(src[ 6], src[22]) + DistYCbCr(src[ 4], src[ 0]) + DistYCbCr(src[ 0], src[ 8]) + (4.0 * DistYCbCr(src[ 5], src[ 7]));
-		float dist_06_00 = DistYCbCr(src[19], src[ 5]) + DistYCbCr(src[ 5], src[ 3]) + DistYCbCr(src[21], src[ 7]) + DistYCbCr(src[ 7], src[ 1]) + (4.0 * DistYCbCr(src[ 6], src[ 0]));
-		bool dominantGradient = (DOMINANT_DIRECTION_THRESHOLD * dist_05_07) < dist_06_00;
-		blendResult[0] = ((dist_05_07 < dist_06_00) && (v[0] != v[5]) && (v[0] != v[7])) ? ((dominantGradient) ? BLEND_DOMINANT : BLEND_NORMAL) : BLEND_NONE;
-	}
-
-	vec4 dst[16];
-	dst[ 0] = src[0];
-	dst[ 1] = src[0];
-	dst[ 2] = src[0];
-	dst[ 3] = src[0];
-	dst[ 4] = src[0];
-	dst[ 5] = src[0];
-	dst[ 6] = src[0];
-	dst[ 7] = src[0];
-	dst[ 8] = src[0];
-	dst[ 9] = src[0];
-	dst[10] = src[0];
-	dst[11] = src[0];
-	dst[12] = src[0];
-	dst[13] = src[0];
-	dst[14] = src[0];
-	dst[15] = src[0];
-
-	// Scale pixel
-	if (IsBlendingNeeded(blendResult) == true) {
-		float dist_01_04 = DistYCbCr(src[1], src[4]);
-		float dist_03_08 = DistYCbCr(src[3], src[8]);
-		bool haveShallowLine = (STEEP_DIRECTION_THRESHOLD * dist_01_04 <= dist_03_08) && (v[0] != v[4]) && (v[5] != v[4]);
-		bool haveSteepLine   = (STEEP_DIRECTION_THRESHOLD * dist_03_08 <= dist_01_04) && (v[0] != v[8]) && (v[7] != v[8]);
-		bool needBlend = (blendResult[2] != BLEND_NONE);
-		bool doLineBlend = (  blendResult[2] >= BLEND_DOMINANT ||
-			((blendResult[1] != BLEND_NONE && !IsPixEqual(src[0], src[4])) ||
-			(blendResult[3] != BLEND_NONE && !IsPixEqual(src[0], src[8])) ||
-			(IsPixEqual(src[4], src[3]) && IsPixEqual(src[3], src[2]) && IsPixEqual(src[2], src[1]) && IsPixEqual(src[1], src[8]) && IsPixEqual(src[0], src[2]) == false) ) == false );
-
-		vec4 blendPix = ( DistYCbCr(src[0], src[1]) <= DistYCbCr(src[0], src[3]) ) ? src[1] : src[3];
-		dst[ 2] = mix(dst[ 2], blendPix, (needBlend && doLineBlend) ? ((haveShallowLine) ? ((haveSteepLine) ? 1.0/3.0 : 0.25) : ((haveSteepLine) ? 0.25 : 0.00)) : 0.00);
-		dst[ 9] = mix(dst[ 9], blendPix, (needBlend && doLineBlend && haveSteepLine) ? 0.25 : 0.00);
-		dst[10] = mix(dst[10], blendPix, (needBlend && doLineBlend && haveSteepLine) ? 0.75 : 0.00);
-		dst[11] = mix(dst[11], blendPix, (needBlend) ? ((doLineBlend) ? ((haveSteepLine) ? 1.00 : ((haveShallowLine) ? 0.75 : 0.50)) : 0.08677704501) : 0.00);
-		dst[12] = mix(dst[12], blendPix, (needBlend) ? ((doLineBlend) ? 1.00 : 0.6848532563) : 0.00);
-		dst[13] = mix(dst[13], blendPix, (needBlend) ? ((doLineBlend) ? ((haveShallowLine) ? 1.00 : ((haveSteepLine) ? 0.75 : 0.50)) : 0.08677704501) : 0.00);
-		dst[14] = mix(dst[14], blendPix, (needBlend && doLineBlend && haveShallowLine) ? 0.75 : 0.00);
-		dst[15] = mix(dst[15], blendPix, (needBlend && doLineBlend && haveShallowLine) ? 0.25 : 0.00);
-
-		dist_01_04 = DistYCbCr(src[7], src[2]);
-		dist_03_08 = DistYCbCr(src[1], src[6]);
-		haveShallowLine = (STEEP_DIRECTION_THRESHOLD * dist_01_04 <= dist_03_08) && (v[0] != v[2]) && (v[3] != v[2]);
-		haveSteepLine   = (STEEP_DIRECTION_THRESHOLD * dist_03_08 <= dist_01_04) && (v[0] != v[6]) && (v[5] != v[6]);
-		needBlend = (blendResult[1] != BLEND_NONE);
-		doLineBlend = (  blendResult[1] >= BLEND_DOMINANT ||
-			!((blendResult[0] != BLEND_NONE && !IsPixEqual(src[0], src[2])) ||
-			(blendResult[2] != BLEND_NONE && !IsPixEqual(src[0], src[6])) ||
-			(IsPixEqual(src[2], src[1]) && IsPixEqual(src[1], src[8]) && IsPixEqual(src[8], src[7]) && IsPixEqual(src[7], src[6]) && !IsPixEqual(src[0], src[8])) ) );
-
-		blendPix = ( DistYCbCr(src[0], src[7]) <= DistYCbCr(src[0], src[1]) ) ? src[7] : src[1];
-		dst[ 1] = mix(dst[ 1], blendPix, (needBlend && doLineBlend) ? ((haveShallowLine) ? ((haveSteepLine) ? 1.0/3.0 : 0.25) : ((haveSteepLine) ? 0.25 : 0.00)) : 0.00);
-		dst[ 6] = mix(dst[ 6], blendPix, (needBlend && doLineBlend && haveSteepLine) ? 0.25 : 0.00);
-		dst[ 7] = mix(dst[ 7], blendPix, (needBlend && doLineBlend && haveSteepLine) ? 0.75 : 0.00);
-		dst[ 8] = mix(dst[ 8], blendPix, (needBlend) ? ((doLineBlend) ? ((haveSteepLine) ? 1.00 : ((haveShallowLine) ? 0.75 : 0.50)) : 0.08677704501) : 0.00);
-		dst[ 9] = mix(dst[ 9], blendPix, (needBlend) ? ((doLineBlend) ? 1.00 : 0.6848532563) : 0.00);
-		dst[10] = mix(dst[10], blendPix, (needBlend) ? ((doLineBlend) ? ((haveShallowLine) ? 1.00 : ((haveSteepLine) ? 0.75 : 0.50)) : 0.08677704501) : 0.00);
-		dst[11] = mix(dst[11], blendPix, (needBlend && doLineBlend && haveShallowLine) ? 0.75 : 0.00);
-		dst[12] = mix(dst[12], blendPix, (needBlend && doLineBlend && haveShallowLine) ? 0.25 : 0.00);
-
-		dist_01_04 = DistYCbCr(src[5], src[8]);
-		dist_03_08 = DistYCbCr(src[7], src[4]);
-		haveShallowLine = (STEEP_DIRECTION_THRESHOLD * dist_01_04 <= dist_03_08) && (v[0] != v[8]) && (v[1] != v[8]);
-		haveSteepLine   = (STEEP_DIRECTION_THRESHOLD * dist_03_08 <= dist_01_04) && (v[0] != v[4]) && (v[3] != v[4]);
-		needBlend = (blendResult[0] != BLEND_NONE);
-		doLineBlend = (  blendResult[0] >= BLEND_DOMINANT ||
-			!((blendResult[3] != BLEND_NONE && !IsPixEqual(src[0], src[8])) ||
-			(blendResult[1] != BLEND_NONE && !IsPixEqual(src[0], src[4])) ||
-			(IsPixEqual(src[8], src[7]) && IsPixEqual(src[7], src[6]) && IsPixEqual(src[6], src[5]) && IsPixEqual(src[5], src[4]) && !IsPixEqual(src[0], src[6])) ) );
-
-		blendPix = ( DistYCbCr(src[0], src[5]) <= DistYCbCr(src[0], src[7]) ) ? src[5] : src[7];
-		dst[ 0] = mix(dst[ 0], blendPix, (needBlend && doLineBlend) ? ((haveShallowLine) ? ((haveSteepLine) ? 1.0/3.0 : 0.25) : ((haveSteepLine) ? 0.25 : 0.00)) : 0.00);
-		dst[15] = mix(dst[15], blendPix, (needBlend && doLineBlend && haveSteepLine) ? 0.25 : 0.00);
-		dst[ 4] = mix(dst[ 4], blendPix, (needBlend && doLineBlend && haveSteepLine) ? 0.75 : 0.00);
-		dst[ 5] = mix(dst[ 5], blendPix, (needBlend) ? ((doLineBlend) ? ((haveSteepLine) ? 1.00 : ((haveShallowLine) ? 0.75 : 0.50)) : 0.08677704501) : 0.00);
-		dst[ 6] = mix(dst[ 6], blendPix, (needBlend) ? ((doLineBlend) ? 1.00 : 0.6848532563) : 0.00);
-		dst[ 7] = mix(dst[ 7], blendPix, (needBlend) ? ((doLineBlend) ? ((haveShallowLine) ? 1.00 : ((haveSteepLine) ? 0.75 : 0.50)) : 0.08677704501) : 0.00);
-		dst[ 8] = mix(dst[ 8], blendPix, (needBlend && doLineBlend && haveShallowLine) ? 0.75 : 0.00);
-		dst[ 9] = mix(dst[ 9], blendPix, (needBlend && doLineBlend && haveShallowLine) ? 0.25 : 0.00);
-
-		dist_01_04 = DistYCbCr(src[3], src[6]);
-		dist_03_08 = DistYCbCr(src[5], src[2]);
-		haveShallowLine = (STEEP_DIRECTION_THRESHOLD * dist_01_04 <= dist_03_08) && (v[0] != v[6]) && (v[7] != v[6]);
-		haveSteepLine   = (STEEP_DIRECTION_THRESHOLD * dist_03_08 <= dist_01_04) && (v[0] != v[2]) && (v[1] != v[2]);
-		needBlend = (blendResult[3] != BLEND_NONE);
-		doLineBlend = (  blendResult[3] >= BLEND_DOMINANT ||
-			!((blendResult[2] != BLEND_NONE && !IsPixEqual(src[0], src[6])) ||
-			(blendResult[0] != BLEND_NONE && !IsPixEqual(src[0], src[2])) ||
-			(IsPixEqual(src[6], src[5]) && IsPixEqual(src[5], src[4]) && IsPixEqual(src[4], src[3]) && IsPixEqual(src[3], src[2]) && !IsPixEqual(src[0], src[4])) ) );
-
-		blendPix = ( DistYCbCr(src[0], src[3]) <= DistYCbCr(src[0], src[5]) ) ? src[3] : src[5];
-		dst[ 3] = mix(dst[ 3], blendPix, (needBlend && doLineBlend) ? ((haveShallowLine) ? ((haveSteepLine) ? 1.0/3.0 : 0.25) : ((haveSteepLine) ? 0.25 : 0.00)) : 0.00);
-		dst[12] = mix(dst[12], blendPix, (needBlend && doLineBlend && haveSteepLine) ? 0.25 : 0.00);
-		dst[13] = mix(dst[13], blendPix, (needBlend && doLineBlend && haveSteepLine) ? 0.75 : 0.00);
-		dst[14] = mix(dst[14], blendPix, (needBlend) ? ((doLineBlend) ? ((haveSteepLine) ? 1.00 : ((haveShallowLine) ? 0.75 : 0.50)) : 0.08677704501) : 0.00);
-		dst[15] = mix(dst[15], blendPix, (needBlend) ? ((doLineBlend) ? 1.00 : 0.6848532563) : 0.00);
-		dst[ 4] = mix(dst[ 4], blendPix, (needBlend) ? ((doLineBlend) ? ((haveShallowLine) ? 1.00 : ((haveSteepLine) ? 0.75 : 0.50)) : 0.08677704501) : 0.00);
-		dst[ 5] = mix(dst[ 5], blendPix, (needBlend && doLineBlend && haveShallowLine) ? 0.75 : 0.00);
-		dst[ 6] = mix(dst[ 6], blendPix, (needBlend && doLineBlend && haveShallowLine) ? 0.25 : 0.00);
-	}
-
-	// select output pixel
-	vec4 res = mix(mix(mix(mix(dst[ 6], dst[ 7], step(0.25, f.x)),
-					mix(dst[ 8], dst[ 9], step(0.75, f.x)),
-					step(0.50, f.x)),
-				mix(mix(dst[ 5], dst[ 0], step(0.25, f.x)),
-					mix(dst[ 1], dst[10], step(0.75, f.x)),
-					step(0.50, f.x)),
-				step(0.25, f.y)),
-		mix(mix(mix(dst[ 4], dst[ 3], step(0.25, f.x)),
-					mix(dst[ 2], dst[11], step(0.75, f.x)),
-					step(0.50, f.x)),
-				mix(mix(dst[15], dst[14], step(0.25, f.x)),
-					mix(dst[13], dst[12], step(0.75, f.x)),
-					step(0.50, f.x)),
-				step(0.75, f.y)),
-		step(0.50, f.y));
-
-	return postdivide_alpha(res);
-}
-
-uint applyScalingu(uvec2 origxy, uvec2 xy) {
-	return packUnorm4x8(applyScalingf(origxy, xy));
-}
-)";
-
 const char *copyShader = R"(
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
@@ -414,6 +130,10 @@ vec4 readColorf(uvec2 p) {
 
 %s
 
+uint applyScalingu(uvec2 origxy, uvec2 xy) {
+	return packUnorm4x8(applyScalingf(origxy, xy));
+}
+
 void main() {
 	uvec2 xy = gl_GlobalInvocationID.xy;
 	// Kill off any out-of-image threads to avoid stray writes.
@@ -642,8 +362,20 @@ void TextureCacheVulkan::DeviceRestore(VulkanContext *vulkan, Draw::DrawContext
 	assert(!allocator_);
 
 	allocator_ = new VulkanDeviceAllocator(vulkan_, TEXCACHE_MIN_SLAB_SIZE, TEXCACHE_MAX_SLAB_SIZE);
+	if (lowMemoryMode_)
+		allocator_->SetLowMemory();
 	samplerCache_.DeviceRestore(vulkan);
 
+	const VkPhysicalDeviceFeatures &features = vulkan_->GetDeviceFeatures().enabled;
+	u32 compressedFormats = 0;
+	if (features.textureCompressionBC)
+		compressedFormats |= (1 << (int)ReplacedTextureFormat::F_BC1) | (1 << (int)ReplacedTextureFormat::F_BC2) | (1 << (int)ReplacedTextureFormat::F_BC3) | (1 << (int)ReplacedTextureFormat::F_BC7);
+	if (features.textureCompressionETC2)
+		compressedFormats |= (1 << (int)ReplacedTextureFormat::F_ETC2_RGB) | (1 << (int)ReplacedTextureFormat::F_ETC2_RGBA);
+	if (features.textureCompressionASTC_LDR)
+		compressedFormats |= 1 << (int)ReplacedTextureFormat::F_ASTC_4x4;
+	replacer_.SetCompressedFormats(compressedFormats);
+
 	VkSamplerCreateInfo samp{ VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
 	samp.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
 	samp.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
@@ -653,20 +385,32 @@ void TextureCacheVulkan::DeviceRestore(VulkanContext *vulkan, Draw::DrawContext
 	samp.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
 	vkCreateSampler(vulkan_->GetDevice(), &samp, nullptr, &samplerNearest_);
 
-	std::string error;
-	std::string fullUploadShader = StringFromFormat(uploadShader, shader4xbrz);
-	std::string fullCopyShader = StringFromFormat(copyShader, shader4xbrz);
-
+	scalingShaderType_ = -1;
 	if (g_Config.bTexHardwareScaling) {
-		uploadCS_ = CompileShaderModule(vulkan_, VK_SHADER_STAGE_COMPUTE_BIT, fullUploadShader.c_str(), &error);
-		_dbg_assert_msg_(G3D, uploadCS_ != VK_NULL_HANDLE, "failed to compile upload shader");
-		copyCS_ = CompileShaderModule(vulkan_, VK_SHADER_STAGE_COMPUTE_BIT, fullCopyShader.c_str(), &error);
-		_dbg_assert_msg_(G3D, copyCS_!= VK_NULL_HANDLE, "failed to compile copy shader");
+		CompileScalingShaders(g_Config.iTexScalingType);
 	}
 
 	computeShaderManager_.DeviceRestore(vulkan);
 }
 
+void TextureCacheVulkan::CompileScalingShaders(int scalingType) {
+	if (uploadCS_ != VK_NULL_HANDLE)
+		vulkan_->Delete().QueueDeleteShaderModule(uploadCS_);
+	if (copyCS_ != VK_NULL_HANDLE)
+		vulkan_->Delete().QueueDeleteShaderModule(copyCS_);
+
+	std::string error;
+	std::string scalingFunctions = GenerateScalingShaderFunctions(scalingType, GLSL_VULKAN);
+	std::string fullUploadShader = StringFromFormat(uploadShader, scalingFunctions.c_str());
+	std::string fullCopyShader = StringFromFormat(copyShader, scalingFunctions.c_str());
+
+	uploadCS_ = CompileShaderModule(vulkan_, VK_SHADER_STAGE_COMPUTE_BIT, fullUploadShader.c_str(), &error);
+	_dbg_assert_msg_(G3D, uploadCS_ != VK_NULL_HANDLE, "failed to compile upload shader");
+	copyCS_ = CompileShaderModule(vulkan_, VK_SHADER_STAGE_COMPUTE_BIT, fullCopyShader.c_str(), &error);
+	_dbg_assert_msg_(G3D, copyCS_!= VK_NULL_HANDLE, "failed to compile copy shader");
+	scalingShaderType_ = scalingType;
+}
+
 void TextureCacheVulkan::ReleaseTexture(TexCacheEntry *entry, bool delete_them) {
 	DEBUG_LOG(G3D, "Deleting texture %p", entry->vkTex);
 	delete entry->vkTex;
@@ -717,11 +461,18 @@ void TextureCacheVulkan::SetFramebufferSamplingParams(u16 bufferWidth, u16 buffe
 	}
 }
 
+void TextureCacheVulkan::TrimForLowMemory() {
+	TextureCacheCommon::TrimForLowMemory();
+	// Let empty slabs go as soon as the pending frees reach them.
+	allocator_->SetLowMemory();
+}
+
 void TextureCacheVulkan::StartFrame() {
 	InvalidateLastTexture();
 	depalShaderCache_->Decimate();
 
 	timesInvalidatedAllThisFrame_ = 0;
+	UpdateReplacements();
 	texelsScaledThisFrame_ = 0;
 
 	if (clearCacheNextFrame_) {
@@ -846,74 +597,77 @@ void TextureCacheVulkan::ApplyTextureFramebuffer(TexCacheEntry *entry, VirtualFr
 		const GEPaletteFormat clutFormat = gstate.getClutPaletteFormat();
 		VulkanTexture *clutTexture = depalShaderCache_->GetClutTexture(clutFormat, clutHash_, clutBuf_);
 
-		Draw::Framebuffer *depalFBO = framebufferManager_->GetTempFBO(TempFBO::DEPAL, framebuffer->renderWidth, framebuffer->renderHeight, Draw::FBO_8888);
-		draw_->BindFramebufferAsRenderTarget(depalFBO, { Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE });
-
-		Vulkan2D::Vertex verts[4] = {
-			{ -1, -1, 0.0f, 0, 0 },
-			{  1, -1, 0.0f, 1, 0 },
-			{ -1,  1, 0.0f, 0, 1 },
-			{  1,  1, 0.0f, 1, 1 },
-		};
-
-		// If min is not < max, then we don't have values (wasn't set during decode.)
-		if (gstate_c.vertBounds.minV < gstate_c.vertBounds.maxV) {
-			const float invWidth = 1.0f / (float)framebuffer->bufferWidth;
-			const float invHeight = 1.0f / (float)framebuffer->bufferHeight;
-			// Inverse of half = double.
-			const float invHalfWidth = invWidth * 2.0f;
-			const float invHalfHeight = invHeight * 2.0f;
-
-			const int u1 = gstate_c.vertBounds.minU + gstate_c.curTextureXOffset;
-			const int v1 = gstate_c.vertBounds.minV + gstate_c.curTextureYOffset;
-			const int u2 = gstate_c.vertBounds.maxU + gstate_c.curTextureXOffset;
-			const int v2 = gstate_c.vertBounds.maxV + gstate_c.curTextureYOffset;
-
-			const float left = u1 * invHalfWidth - 1.0f;
-			const float right = u2 * invHalfWidth - 1.0f;
-			const float top = v1 * invHalfHeight - 1.0f;
-			const float bottom = v2 * invHalfHeight - 1.0f;
-			// Points are: BL, BR, TR, TL.
-			verts[0].x = left;
-			verts[0].y = bottom;
-			verts[1].x = right;
-			verts[1].y = bottom;
-			verts[2].x = left;
-			verts[2].y = top;
-			verts[3].x = right;
-			verts[3].y = top;
-
-			// And also the UVs, same order.
-			const float uvleft = u1 * invWidth;
-			const float uvright = u2 * invWidth;
-			const float uvtop = v1 * invHeight;
-			const float uvbottom = v2 * invHeight;
-			verts[0].u = uvleft;
-			verts[0].v = uvbottom;
-			verts[1].u = uvright;
-			verts[1].v = uvbottom;
-			verts[2].u = uvleft;
-			verts[2].v = uvtop;
-			verts[3].u = uvright;
-			verts[3].v = uvtop;
-
-			// We need to reapply the texture next time since we cropped UV.
-			gstate_c.Dirty(DIRTY_TEXTURE_PARAMS);
-		}
+		bool cached = false;
+		Draw::Framebuffer *depalFBO = GetDepalResult(framebuffer, &cached);
+		if (!cached) {
+			draw_->BindFramebufferAsRenderTarget(depalFBO, { Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE, Draw::RPAction::DONT_CARE });
+
+			Vulkan2D::Vertex verts[4] = {
+				{ -1, -1, 0.0f, 0, 0 },
+				{  1, -1, 0.0f, 1, 0 },
+				{ -1,  1, 0.0f, 0, 1 },
+				{  1,  1, 0.0f, 1, 1 },
+			};
+
+			// If min is not < max, then we don't have values (wasn't set during decode.)
+			if (gstate_c.vertBounds.minV < gstate_c.vertBounds.maxV) {
+				const float invWidth = 1.0f / (float)framebuffer->bufferWidth;
+				const float invHeight = 1.0f / (float)framebuffer->bufferHeight;
+				// Inverse of half = double.
+				const float invHalfWidth = invWidth * 2.0f;
+				const float invHalfHeight = invHeight * 2.0f;
+
+				const int u1 = gstate_c.vertBounds.minU + gstate_c.curTextureXOffset;
+				const int v1 = gstate_c.vertBounds.minV + gstate_c.curTextureYOffset;
+				const int u2 = gstate_c.vertBounds.maxU + gstate_c.curTextureXOffset;
+				const int v2 = gstate_c.vertBounds.maxV + gstate_c.curTextureYOffset;
+
+				const float left = u1 * invHalfWidth - 1.0f;
+				const float right = u2 * invHalfWidth - 1.0f;
+				const float top = v1 * invHalfHeight - 1.0f;
+				const float bottom = v2 * invHalfHeight - 1.0f;
+				// Points are: BL, BR, TR, TL.
+				verts[0].x = left;
+				verts[0].y = bottom;
+				verts[1].x = right;
+				verts[1].y = bottom;
+				verts[2].x = left;
+				verts[2].y = top;
+				verts[3].x = right;
+				verts[3].y = top;
+
+				// And also the UVs, same order.
+				const float uvleft = u1 * invWidth;
+				const float uvright = u2 * invWidth;
+				const float uvtop = v1 * invHeight;
+				const float uvbottom = v2 * invHeight;
+				verts[0].u = uvleft;
+				verts[0].v = uvbottom;
+				verts[1].u = uvright;
+				verts[1].v = uvbottom;
+				verts[2].u = uvleft;
+				verts[2].v = uvtop;
+				verts[3].u = uvright;
+				verts[3].v = uvtop;
+
+				// We need to reapply the texture next time since we cropped UV.
+				gstate_c.Dirty(DIRTY_TEXTURE_PARAMS);
+			}
 
-		VkBuffer pushed;
-		uint32_t offset = push_->PushAligned(verts, sizeof(verts), 4, &pushed);
+			VkBuffer pushed;
+			uint32_t offset = push_->PushAligned(verts, sizeof(verts), 4, &pushed);
 
-		draw_->BindFramebufferAsTexture(framebuffer->fbo, 0, Draw::FB_COLOR_BIT, 0);
-		VkImageView fbo = (VkImageView)draw_->GetNativeObject(Draw::NativeObject::BOUND_TEXTURE0_IMAGEVIEW);
+			draw_->BindFramebufferAsTexture(framebuffer->fbo, 0, Draw::FB_COLOR_BIT, 0);
+			VkImageView fbo = (VkImageView)draw_->GetNativeObject(Draw::NativeObject::BOUND_TEXTURE0_IMAGEVIEW);
 
-		VkDescriptorSet descSet = vulkan2D_->GetDescriptorSet(fbo, samplerNearest_, clutTexture->GetImageView(), samplerNearest_);
-		VulkanRenderManager *renderManager = (VulkanRenderManager *)draw_->GetNativeObject(Draw::NativeObject::RENDER_MANAGER);
-		renderManager->BindPipeline(depalShader->pipeline);
-		renderManager->SetScissor(VkRect2D{ {0, 0}, { framebuffer->renderWidth, framebuffer->renderHeight} });
-		renderManager->SetViewport(VkViewport{ 0.f, 0.f, (float)framebuffer->renderWidth, (float)framebuffer->renderHeight, 0.f, 1.f });
-		renderManager->Draw(vulkan2D_->GetPipelineLayout(), descSet, 0, nullptr, pushed, offset, 4);
-		shaderManagerVulkan_->DirtyLastShader();
+			VkDescriptorSet descSet = vulkan2D_->GetDescriptorSet(fbo, samplerNearest_, clutTexture->GetImageView(), samplerNearest_);
+			VulkanRenderManager *renderManager = (VulkanRenderManager *)draw_->GetNativeObject(Draw::NativeObject::RENDER_MANAGER);
+			renderManager->BindPipeline(depalShader->pipeline);
+			renderManager->SetScissor(VkRect2D{ {0, 0}, { framebuffer->renderWidth, framebuffer->renderHeight} });
+			renderManager->SetViewport(VkViewport{ 0.f, 0.f, (float)framebuffer->renderWidth, (float)framebuffer->renderHeight, 0.f, 1.f });
+			renderManager->Draw(vulkan2D_->GetPipelineLayout(), descSet, 0, nullptr, pushed, offset, 4);
+			shaderManagerVulkan_->DirtyLastShader();
+		}
 
 		const u32 bytesPerColor = clutFormat == GE_CMODE_32BIT_ABGR8888 ? sizeof(u32) : sizeof(u16);
 		const u32 clutTotalColors = clutMaxBytes_ / bytesPerColor;
@@ -957,10 +711,25 @@ VkFormat ToVulkanFormat(ReplacedTextureFormat fmt) {
 	case ReplacedTextureFormat::F_5650: return VULKAN_565_FORMAT;
 	case ReplacedTextureFormat::F_5551: return VULKAN_1555_FORMAT;
 	case ReplacedTextureFormat::F_4444: return VULKAN_4444_FORMAT;
+	case ReplacedTextureFormat::F_BC1: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+	case ReplacedTextureFormat::F_BC2: return VK_FORMAT_BC2_UNORM_BLOCK;
+	case ReplacedTextureFormat::F_BC3: return VK_FORMAT_BC3_UNORM_BLOCK;
+	case ReplacedTextureFormat::F_BC7: return VK_FORMAT_BC7_UNORM_BLOCK;
+	case ReplacedTextureFormat::F_ETC2_RGB: return VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK;
+	case ReplacedTextureFormat::F_ETC2_RGBA: return VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK;
+	case ReplacedTextureFormat::F_ASTC_4x4: return VK_FORMAT_ASTC_4x4_UNORM_BLOCK;
 	case ReplacedTextureFormat::F_8888: default: return VULKAN_8888_FORMAT;
 	}
 }
 
+// Mips are generated with linear blits, which not every format supports.
+static bool CanBlitMips(VulkanContext *vulkan, VkFormat format) {
+	const VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	VkFormatProperties props;
+	vkGetPhysicalDeviceFormatProperties(vulkan->GetPhysicalDevice(), format, &props);
+	return (props.optimalTilingFeatures & needed) == needed;
+}
+
 void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 	entry->status &= ~TexCacheEntry::STATUS_ALPHA_MASK;
 
@@ -1010,6 +779,8 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 	if (badMipSizes) {
 		maxLevel = 0;
 	}
+	// What the game wants to sample, in case we drop the levels below.
+	const int gameMaxLevel = maxLevel;
 
 	// If GLES3 is available, we can preallocate the storage, which makes texture loading more efficient.
 	VkFormat dstFmt = GetDestFormat(GETextureFormat(entry->format), gstate.getClutPaletteFormat());
@@ -1037,14 +808,20 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 	// Don't scale the PPGe texture.
 	if (entry->addr > 0x05000000 && entry->addr < PSP_GetKernelMemoryEnd())
 		scaleFactor = 1;
-	if ((entry->status & TexCacheEntry::STATUS_CHANGE_FREQUENT) != 0 && scaleFactor != 1 && !g_Config.bTexHardwareScaling) {
+	// Deposterize only exists in the CPU scaler, so use that when it's on.
+	bool hardwareScaling = g_Config.bTexHardwareScaling && !g_Config.bTexDeposterize;
+	if (hardwareScaling && scaleFactor != 1 && scalingShaderType_ != g_Config.iTexScalingType) {
+		CompileScalingShaders(g_Config.iTexScalingType);
+	}
+
+	if ((entry->status & TexCacheEntry::STATUS_CHANGE_FREQUENT) != 0 && scaleFactor != 1 && !hardwareScaling) {
 		// Remember for later that we /wanted/ to scale this texture.
 		entry->status |= TexCacheEntry::STATUS_TO_SCALE;
 		scaleFactor = 1;
 	}
 
 	if (scaleFactor != 1) {
-		if (texelsScaledThisFrame_ >= TEXCACHE_MAX_TEXELS_SCALED && !g_Config.bTexHardwareScaling) {
+		if (texelsScaledThisFrame_ >= TEXCACHE_MAX_TEXELS_SCALED && !hardwareScaling) {
 			entry->status |= TexCacheEntry::STATUS_TO_SCALE;
 			scaleFactor = 1;
 		} else {
@@ -1067,6 +844,18 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 	bool computeUpload = false;
 	bool computeCopy = false;
 
+	// Upscaled textures and replacements without mips would otherwise lose the game's mipmapping.
+	// Optionally, blit the missing levels down from level 0 instead.
+	bool genMips = false;
+	if (g_Config.bTexGPUMipmaps && gameMaxLevel > 0 && maxLevel == 0 && !IsFakeMipmapChange()) {
+		if (CanBlitMips(vulkan_, actualFmt)) {
+			maxLevel = gameMaxLevel;
+			while (maxLevel > 0 && (((w * scaleFactor) >> maxLevel) == 0 || ((h * scaleFactor) >> maxLevel) == 0))
+				maxLevel--;
+			genMips = maxLevel > 0;
+		}
+	}
+
 	{
 		delete entry->vkTex;
 		entry->vkTex = new VulkanTexture(vulkan_);
@@ -1095,8 +884,12 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 		VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 		// If we want to use the GE debugger, we should add VK_IMAGE_USAGE_TRANSFER_SRC_BIT too...
 
-		// Compute experiment
-		if (actualFmt == VULKAN_8888_FORMAT && scaleFactor > 1 && g_Config.bTexHardwareScaling) {
+		if (genMips) {
+			usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		}
+
+		// Compute experiment. The compute upload writes in the GENERAL layout, so it can't be combined with blitting mips.
+		if (actualFmt == VULKAN_8888_FORMAT && scaleFactor > 1 && hardwareScaling && !genMips) {
 			// Enable the experiment you want.
 			if (uploadCS_ != VK_NULL_HANDLE)
 				computeUpload = true;
@@ -1117,6 +910,7 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 		if (!allocSuccess && !lowMemoryMode_) {
 			WARN_LOG_REPORT(G3D, "Texture cache ran out of GPU memory; switching to low memory mode");
 			lowMemoryMode_ = true;
+			allocator_->SetLowMemory();
 			decimationCounter_ = 0;
 			Decimate();
 			// TODO: We should stall the GPU here and wipe things out of memory.
@@ -1132,6 +926,11 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 			scaleFactor = 1;
 			actualFmt = dstFmt;
 
+			// Levels generated from the bigger size may not fit anymore.
+			if (genMips) {
+				genMips = false;
+				maxLevel = 0;
+			}
 			allocSuccess = image->CreateDirect(cmdInit, allocator_, w * scaleFactor, h * scaleFactor, maxLevel + 1, actualFmt, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, mapping);
 		}
 
@@ -1159,7 +958,8 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 		u8 level = std::max(0, gstate.getTexLevelOffset16() / 16);
 		bool fakeMipmap = IsFakeMipmapChange() && level > 0;
 		// Upload the texture data.
-		for (int i = 0; i <= maxLevel; i++) {
+		const int uploadMaxLevel = genMips ? 0 : maxLevel;
+		for (int i = 0; i <= uploadMaxLevel; i++) {
 			int mipWidth = gstate.getTextureWidth(i) * scaleFactor;
 			int mipHeight = gstate.getTextureHeight(i) * scaleFactor;
 			if (replaced.Valid()) {
@@ -1177,7 +977,15 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 			int pushAlignment = std::max(16, (int)vulkan_->GetPhysicalDeviceProperties().properties.limits.optimalBufferCopyOffsetAlignment);
 			void *data;
 			bool dataScaled = true;
-			if (replaced.Valid()) {
+			if (replaced.Valid() && IsCompressedFormat(replaced.Format(i))) {
+				// Block rows are tightly packed, and the row length is in texels.
+				ReplacedTextureFormat fmt = replaced.Format(i);
+				stride = ReplacedRowPitch(fmt, mipWidth);
+				size = stride * ReplacedRowCount(fmt, mipHeight);
+				data = drawEngine_->GetPushBufferForTextureData()->PushAligned(size, &bufferOffset, &texBuf, pushAlignment);
+				replaced.Load(i, data, stride);
+				entry->vkTex->UploadMip(cmdInit, i, mipWidth, mipHeight, texBuf, bufferOffset, (mipWidth + 3) & ~3);
+			} else if (replaced.Valid()) {
 				data = drawEngine_->GetPushBufferForTextureData()->PushAligned(size, &bufferOffset, &texBuf, pushAlignment);
 				replaced.Load(i, data, stride);
 				entry->vkTex->UploadMip(cmdInit, i, mipWidth, mipHeight, texBuf, bufferOffset, stride / bpp);
@@ -1256,15 +1064,23 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 			}
 		}
 
+		for (int i = 1; genMips && i <= maxLevel; i++) {
+			entry->vkTex->GenerateMip(cmdInit, i);
+		}
+
 		if (maxLevel == 0) {
 			entry->status |= TexCacheEntry::STATUS_BAD_MIPS;
 		} else {
 			entry->status &= ~TexCacheEntry::STATUS_BAD_MIPS;
 		}
+		SetReplacedSize(entry, replaced.Valid() ? (u32)replaced.MemorySize() : 0);
+		SetScaledSize(entry, scaleFactor);
 		if (replaced.Valid()) {
 			entry->SetAlphaStatus(TexCacheEntry::TexStatus(replaced.AlphaStatus()));
 		}
-		entry->vkTex->EndCreate(cmdInit, false, computeUpload ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		// Nothing in the init command buffer samples it, so the transitions of all textures built this frame go out together.
+		VulkanRenderManager *renderManager = (VulkanRenderManager *)draw_->GetNativeObject(Draw::NativeObject::RENDER_MANAGER);
+		entry->vkTex->EndCreate(renderManager->GetInitBarriers(), false, computeUpload ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 	}
 
 	gstate_c.SetTextureFullAlpha(entry->GetAlphaStatus() == TexCacheEntry::STATUS_ALPHA_FULL);
@@ -1351,7 +1167,7 @@ void TextureCacheVulkan::LoadTextureLevel(TexCacheEntry &entry, uint8_t *writePt
 
 		if (scaleFactor > 1) {
 			u32 fmt = dstFmt;
-			scaler.ScaleAlways((u32 *)writePtr, pixelData, fmt, w, h, scaleFactor);
+			ScaleCached(scaler, entry.CacheKey(), entry.fullhash, level, (u32 *)writePtr, pixelData, fmt, w, h, scaleFactor);
 			pixelData = (u32 *)writePtr;
 			dstFmt = (VkFormat)fmt;
 
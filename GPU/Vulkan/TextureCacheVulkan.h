@@ -64,6 +64,7 @@ class TextureCacheVulkan : public TextureCacheCommon {
 
 	void StartFrame();
 	void EndFrame();
+	void TrimForLowMemory() override;
 
 	void DeviceLost();
 	void DeviceRestore(VulkanContext *vulkan, Draw::DrawContext *draw);
@@ -122,6 +123,7 @@ class TextureCacheVulkan : public TextureCacheCommon {
 
 	void ApplyTextureFramebuffer(TexCacheEntry *entry, VirtualFramebuffer *framebuffer) override;
 	void BuildTexture(TexCacheEntry *const entry) override;
+	void CompileScalingShaders(int scalingType);
 
 	VulkanContext *vulkan_ = nullptr;
 	VulkanDeviceAllocator *allocator_ = nullptr;
@@ -147,6 +149,7 @@ class TextureCacheVulkan : public TextureCacheCommon {
 
 	VkShaderModule uploadCS_ = VK_NULL_HANDLE;
 	VkShaderModule copyCS_ = VK_NULL_HANDLE;
+	int scalingShaderType_ = -1;
 
 	// Bound state to emulate an API similar to the others
 	VkImageView imageView_ = VK_NULL_HANDLE;
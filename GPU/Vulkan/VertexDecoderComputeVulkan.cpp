@@ -0,0 +1,251 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+
+#include <cstring>
+
+#include "base/logging.h"
+#include "base/stringutil.h"
+
+#include "Common/Vulkan/VulkanMemory.h"
+#include "Core/HDRemaster.h"
+#include "GPU/ge_constants.h"
+#include "GPU/Common/VertexDecoderCommon.h"
+#include "GPU/Vulkan/VertexDecoderComputeVulkan.h"
+
+enum {
+	DECODE_WORKGROUP_SIZE = 64,
+	// The uv scale and offset are stored in front of the raw vertices.
+	DECODE_HEADER_SIZE = 16,
+};
+
+static const char *decodeShaderHeader = R"(
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+layout(std430, binding = 1) readonly buffer Src {
+	uint data[];
+} src;
+
+layout(std430, binding = 2) writeonly buffer Dst {
+	uint data[];
+} dst;
+
+layout(push_constant) uniform Params {
+	uint count;
+	uint dstOffset;  // in words
+} params;
+
+uint readU8(uint off) { return (src.data[off >> 2] >> ((off & 3) * 8)) & 0xFF; }
+uint readU16(uint off) { return (src.data[off >> 2] >> ((off & 2) * 8)) & 0xFFFF; }
+uint readU32(uint off) { return src.data[off >> 2]; }
+int readS8(uint off) { return int(readU8(off) << 24) >> 24; }
+int readS16(uint off) { return int(readU16(off) << 16) >> 16; }
+
+// Same bit replication as Convert4To8 and friends.
+uint expand4(uint v) { return (v << 4) | v; }
+uint expand5(uint v) { return (v << 3) | (v >> 2); }
+uint expand6(uint v) { return (v << 2) | (v >> 4); }
+
+void main() {
+	uint v = gl_GlobalInvocationID.x;
+	if (v >= params.count)
+		return;
+)";
+
+VertexDecoderComputeVulkan::VertexDecoderComputeVulkan(VulkanContext *vulkan)
+	: vulkan_(vulkan), computeShaderManager_(vulkan), shaders_(16) {
+	computeShaderManager_.DeviceRestore(vulkan);
+}
+
+VertexDecoderComputeVulkan::~VertexDecoderComputeVulkan() {
+	shaders_.Iterate([&](u32 vtype, VkShaderModule shader) {
+		vulkan_->Delete().QueueDeleteShaderModule(shader);
+	});
+	shaders_.Clear();
+	computeShaderManager_.DeviceLost();
+}
+
+void VertexDecoderComputeVulkan::BeginFrame() {
+	computeShaderManager_.BeginFrame();
+}
+
+bool VertexDecoderComputeVulkan::CanDecode(const VertexDecoder *dec) {
+	// Skinning and morphing need the bone and morph state, through mode tracks UV bounds on the CPU.
+	if (dec->throughmode || dec->weighttype != 0 || dec->morphcount != 1)
+		return false;
+	if (g_DoubleTextureCoordinates)
+		return false;
+	// Color formats 1-3 are invalid.
+	if (dec->col != 0 && dec->col < (GE_VTYPE_COL_565 >> GE_VTYPE_COL_SHIFT))
+		return false;
+	const DecVtxFormat &fmt = dec->decFmt;
+	if (dec->tc && fmt.uvfmt != DEC_FLOAT_2)
+		return false;
+	if (dec->nrm == (GE_VTYPE_NRM_8BIT >> GE_VTYPE_NRM_SHIFT) && fmt.nrmfmt != DEC_S8_3)
+		return false;
+	return fmt.posfmt == DEC_FLOAT_3 && (fmt.stride & 3) == 0;
+}
+
+std::string VertexDecoderComputeVulkan::GenerateShader(const VertexDecoder *dec) {
+	const DecVtxFormat &fmt = dec->decFmt;
+	std::string code = decodeShaderHeader;
+	code += StringFromFormat("\tuint s = %d + v * %d;\n", DECODE_HEADER_SIZE, dec->VertexSize());
+	code += StringFromFormat("\tuint d = params.dstOffset + v * %d;\n", fmt.stride / 4);
+
+	if (dec->tc) {
+		// Without prescale, the uv scale and offset passed in are just 1 and 0.
+		const char *norm[4] = { "", " * (1.0 / 128.0)", " * (1.0 / 32768.0)", "" };
+		const char *read[4] = { "", "readU8", "readU16", "readU32" };
+		const int size = dec->tc == (GE_VTYPE_TC_8BIT >> GE_VTYPE_TC_SHIFT) ? 1 : (dec->tc == (GE_VTYPE_TC_16BIT >> GE_VTYPE_TC_SHIFT) ? 2 : 4);
+		const char *conv = dec->tc == (GE_VTYPE_TC_FLOAT >> GE_VTYPE_TC_SHIFT) ? "uintBitsToFloat" : "float";
+		code += "\tvec4 uvScaleOff = uintBitsToFloat(uvec4(src.data[0], src.data[1], src.data[2], src.data[3]));\n";
+		code += StringFromFormat("\tprecise float u = %s(%s(s + %d))%s * uvScaleOff.x + uvScaleOff.z;\n", conv, read[dec->tc], dec->tcoff, norm[dec->tc]);
+		code += StringFromFormat("\tprecise float t = %s(%s(s + %d))%s * uvScaleOff.y + uvScaleOff.w;\n", conv, read[dec->tc], dec->tcoff + size, norm[dec->tc]);
+		code += StringFromFormat("\tdst.data[d + %d] = floatBitsToUint(u);\n", fmt.uvoff / 4);
+		code += StringFromFormat("\tdst.data[d + %d] = floatBitsToUint(t);\n", fmt.uvoff / 4 + 1);
+	}
+
+	if (dec->col) {
+		const int c0 = fmt.c0off / 4;
+		switch (dec->col << GE_VTYPE_COL_SHIFT) {
+		case GE_VTYPE_COL_565:
+			code += StringFromFormat("\tuint c = readU16(s + %d);\n", dec->coloff);
+			code += StringFromFormat("\tdst.data[d + %d] = expand5(c & 0x1F) | (expand6((c >> 5) & 0x3F) << 8) | (expand5((c >> 11) & 0x1F) << 16) | 0xFF000000u;\n", c0);
+			break;
+		case GE_VTYPE_COL_5551:
+			code += StringFromFormat("\tuint c = readU16(s + %d);\n", dec->coloff);
+			code += StringFromFormat("\tdst.data[d + %d] = expand5(c & 0x1F) | (expand5((c >> 5) & 0x1F) << 8) | (expand5((c >> 10) & 0x1F) << 16) | ((c >> 15) != 0 ? 0xFF000000u : 0u);\n", c0);
+			break;
+		case GE_VTYPE_COL_4444:
+			code += StringFromFormat("\tuint c = readU16(s + %d);\n", dec->coloff);
+			code += StringFromFormat("\tdst.data[d + %d] = expand4(c & 0xF) | (expand4((c >> 4) & 0xF) << 8) | (expand4((c >> 8) & 0xF) << 16) | (expand4(c >> 12) << 24);\n", c0);
+			break;
+		case GE_VTYPE_COL_8888:
+			code += StringFromFormat("\tdst.data[d + %d] = readU32(s + %d);\n", c0, dec->coloff);
+			break;
+		}
+	}
+
+	if (dec->nrm) {
+		const int n0 = fmt.nrmoff / 4;
+		const int off = dec->nrmoff;
+		switch (dec->nrm << GE_VTYPE_NRM_SHIFT) {
+		case GE_VTYPE_NRM_8BIT:
+			code += StringFromFormat("\tdst.data[d + %d] = readU8(s + %d) | (readU8(s + %d) << 8) | (readU8(s + %d) << 16);\n", n0, off, off + 1, off + 2);
+			break;
+		case GE_VTYPE_NRM_16BIT:
+			code += StringFromFormat("\tdst.data[d + %d] = readU16(s + %d) | (readU16(s + %d) << 16);\n", n0, off, off + 2);
+			code += StringFromFormat("\tdst.data[d + %d] = readU16(s + %d);\n", n0 + 1, off + 4);
+			break;
+		case GE_VTYPE_NRM_FLOAT:
+			for (int i = 0; i < 3; i++)
+				code += StringFromFormat("\tdst.data[d + %d] = readU32(s + %d);\n", n0 + i, off + i * 4);
+			break;
+		}
+	}
+
+	const int p0 = fmt.posoff / 4;
+	const int off = dec->posoff;
+	switch (dec->pos << GE_VTYPE_POS_SHIFT) {
+	case GE_VTYPE_POS_8BIT:
+		for (int i = 0; i < 3; i++)
+			code += StringFromFormat("\tdst.data[d + %d] = floatBitsToUint(float(readS8(s + %d)) * (1.0 / 128.0));\n", p0 + i, off + i);
+		break;
+	case GE_VTYPE_POS_16BIT:
+		for (int i = 0; i < 3; i++)
+			code += StringFromFormat("\tdst.data[d + %d] = floatBitsToUint(float(readS16(s + %d)) * (1.0 / 32768.0));\n", p0 + i, off + i * 2);
+		break;
+	case GE_VTYPE_POS_FLOAT:
+		for (int i = 0; i < 3; i++)
+			code += StringFromFormat("\tdst.data[d + %d] = readU32(s + %d);\n", p0 + i, off + i * 4);
+		break;
+	}
+
+	code += "}\n";
+	return code;
+}
+
+VkShaderModule VertexDecoderComputeVulkan::GetShader(const VertexDecoder *dec) {
+	const u32 vtype = dec->VertexType();
+	VkShaderModule shader = shaders_.Get(vtype);
+	if (shader != VK_NULL_HANDLE || failed_.count(vtype))
+		return shader;
+
+	std::string error;
+	std::string code = GenerateShader(dec);
+	shader = CompileShaderModule(vulkan_, VK_SHADER_STAGE_COMPUTE_BIT, code.c_str(), &error);
+	if (shader == VK_NULL_HANDLE) {
+		ERROR_LOG(G3D, "Failed to compile vertex decode shader for %08x: %s", vtype, error.c_str());
+		failed_.insert(vtype);
+		return VK_NULL_HANDLE;
+	}
+	shaders_.Insert(vtype, shader);
+	return shader;
+}
+
+bool VertexDecoderComputeVulkan::Decode(VkCommandBuffer cmd, VulkanPushBuffer *upload, const VertexDecoder *dec, const UVScale &uv, const void *verts, int indexLowerBound, int indexUpperBound, VkBuffer dstBuf, uint32_t dstOffset) {
+	// Misaligned vertices are zeroed by the CPU decoder, leave those to it.
+	if ((dstOffset & 3) != 0 || ((uintptr_t)verts & (dec->biggest - 1)) != 0)
+		return false;
+	VkShaderModule shader = GetShader(dec);
+	if (shader == VK_NULL_HANDLE)
+		return false;
+
+	const int count = indexUpperBound - indexLowerBound + 1;
+	const uint32_t rawSize = count * dec->VertexSize();
+	const uint32_t srcSize = (DECODE_HEADER_SIZE + rawSize + 3) & ~3;
+	const uint32_t align = (uint32_t)vulkan_->GetPhysicalDeviceProperties().properties.limits.minStorageBufferOffsetAlignment;
+
+	uint32_t srcOffset;
+	VkBuffer srcBuf;
+	u8 *data = (u8 *)upload->PushAligned(srcSize, &srcOffset, &srcBuf, align);
+	memcpy(data, &uv, DECODE_HEADER_SIZE);
+	memcpy(data + DECODE_HEADER_SIZE, (const u8 *)verts + indexLowerBound * dec->VertexSize(), rawSize);
+	memset(data + DECODE_HEADER_SIZE + rawSize, 0, srcSize - DECODE_HEADER_SIZE - rawSize);
+
+	// Storage buffer bindings have to be aligned too, so bind from below and offset in the shader.
+	const uint32_t dstBase = dstOffset & ~(align - 1);
+	const uint32_t dstSize = dstOffset - dstBase + count * dec->decFmt.stride;
+	VkDescriptorSet descSet = computeShaderManager_.GetDescriptorSet(VK_NULL_HANDLE, srcBuf, srcOffset, srcSize, dstBuf, dstBase, dstSize);
+
+	struct Params {
+		uint32_t count;
+		uint32_t dstOffset;
+	};
+	Params params{ (uint32_t)count, (dstOffset - dstBase) / 4 };
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, computeShaderManager_.GetPipeline(shader));
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, computeShaderManager_.GetPipelineLayout(), 0, 1, &descSet, 0, nullptr);
+	vkCmdPushConstants(cmd, computeShaderManager_.GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+	vkCmdDispatch(cmd, (count + DECODE_WORKGROUP_SIZE - 1) / DECODE_WORKGROUP_SIZE, 1, 1);
+
+	// The vertices are read by draws in the frame's main command buffer, which is submitted after this one.
+	VkBufferMemoryBarrier barrier{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	barrier.buffer = dstBuf;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.offset = dstOffset;
+	barrier.size = count * dec->decFmt.stride;
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		0, 0, nullptr, 1, &barrier, 0, nullptr);
+	return true;
+}
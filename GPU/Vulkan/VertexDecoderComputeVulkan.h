@@ -0,0 +1,58 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+
+#pragma once
+
+#include <set>
+#include <string>
+
+#include "Common/CommonTypes.h"
+#include "Common/Hashmaps.h"
+#include "Common/Vulkan/VulkanContext.h"
+#include "GPU/GPUState.h"
+#include "GPU/Vulkan/VulkanUtil.h"
+
+class VertexDecoder;
+class VulkanPushBuffer;
+
+// Expands raw PSP vertices into the DecVtxFormat layout with a compute shader, generated per vertex type.
+// Only handles the plain formats: no weights, no morph, no through mode. Everything else stays on the CPU.
+class VertexDecoderComputeVulkan {
+public:
+	VertexDecoderComputeVulkan(VulkanContext *vulkan);
+	~VertexDecoderComputeVulkan();
+
+	void BeginFrame();
+
+	static bool CanDecode(const VertexDecoder *dec);
+
+	// Copies the raw vertices into upload, and records a dispatch on cmd that writes them to dstBuf at dstOffset.
+	// Returns false if nothing was recorded, in which case the caller must decode on the CPU.
+	bool Decode(VkCommandBuffer cmd, VulkanPushBuffer *upload, const VertexDecoder *dec, const UVScale &uv, const void *verts, int indexLowerBound, int indexUpperBound, VkBuffer dstBuf, uint32_t dstOffset);
+
+	static std::string GenerateShader(const VertexDecoder *dec);
+
+private:
+	VkShaderModule GetShader(const VertexDecoder *dec);
+
+	VulkanContext *vulkan_;
+	VulkanComputeShaderManager computeShaderManager_;
+	DenseHashMap<u32, VkShaderModule, (VkShaderModule)VK_NULL_HANDLE> shaders_;
+	// Vertex types whose shader failed to compile, so we don't retry every draw.
+	std::set<u32> failed_;
+};
@@ -272,6 +272,7 @@ static int mainInternal(QApplication &a) {
 
 void MainUI::EmuThreadFunc() {
 	setCurrentThreadName("Emu");
+	setCurrentThreadRole(ThreadRole::EMULATION);
 
 	// There's no real requirement that NativeInit happen on this thread, though it can't hurt...
 	// We just call the update/render loop here. NativeInitGraphics should be here though.
@@ -458,7 +459,7 @@ bool MainUI::event(QEvent *e) {
 
 	default:
 		if (e->type() == browseFileEvent) {
-			QString fileName = QFileDialog::getOpenFileName(nullptr, "Load ROM", g_Config.currentDirectory.c_str(), "PSP ROMs (*.iso *.cso *.pbp *.elf *.zip *.ppdmp)");
+			QString fileName = QFileDialog::getOpenFileName(nullptr, "Load ROM", g_Config.currentDirectory.c_str(), "PSP ROMs (*.iso *.cso *.zso *.pbp *.elf *.zip *.ppdmp)");
 			if (QFile::exists(fileName)) {
 				QDir newPath;
 				g_Config.currentDirectory = newPath.filePath(fileName).toStdString();
@@ -387,6 +387,7 @@ static std::atomic<int> emuThreadState((int)EmuThreadState::DISABLED);
 
 static void EmuThreadFunc(GraphicsContext *graphicsContext) {
 	setCurrentThreadName("Emu");
+	setCurrentThreadRole(ThreadRole::EMULATION);
 
 	// There's no real requirement that NativeInit happen on this thread.
 	// We just call the update/render loop here.
@@ -18,6 +18,7 @@
 #include <algorithm>
 
 #include "base/display.h"
+#include "base/timeutil.h"
 #include "gfx_es2/gpu_features.h"
 #include "i18n/i18n.h"
 #include "ui/ui_context.h"
@@ -25,25 +26,36 @@
 #include "ui/viewgroup.h"
 #include "ui/ui.h"
 #include "profiler/profiler.h"
+#include "thread/profiledmutex.h"
 
 #include "Common/LogManager.h"
+#include "Common/MemoryUsage.h"
 #include "Common/CPUDetect.h"
+#include "Common/FileUtil.h"
+#include "Common/StringUtils.h"
 
 #include "Core/MemMap.h"
 #include "Core/Config.h"
 #include "Core/ConfigValues.h"
 #include "Core/System.h"
 #include "Core/CoreParameter.h"
+#include "Core/ELF/ParamSFO.h"
+#include "Core/HLE/HLE.h"
+#include "Core/HLE/sceKernelTime.h"
+#include "Core/Util/InputLatency.h"
 #include "Core/MIPS/MIPSTables.h"
 #include "Core/MIPS/JitCommon/JitBlockCache.h"
+#include "Core/MIPS/JitCommon/JitBlockCorpus.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
 #include "Core/MIPS/JitCommon/JitState.h"
 #include "GPU/GPUInterface.h"
 #include "GPU/GPUState.h"
+#include "GPU/Common/TextureCacheStats.h"
 #include "UI/MiscScreens.h"
 #include "UI/DevScreens.h"
 #include "UI/ControlMappingScreen.h"
 #include "UI/GameSettingsScreen.h"
+#include "UI/OnScreenDisplay.h"
 
 #ifdef _WIN32
 #include "Common/CommonWindows.h"
@@ -81,13 +93,18 @@ void DevMenu::CreatePopupContents(UI::ViewGroup *parent) {
 	items->Add(new Choice(dev->T("Shader Viewer")))->OnClick.Handle(this, &DevMenu::OnShaderView);
 	if (g_Config.iGPUBackend == (int)GPUBackend::VULKAN) {
 		items->Add(new CheckBox(&g_Config.bShowAllocatorDebug, dev->T("Allocator Viewer")));
-		items->Add(new CheckBox(&g_Config.bShowGpuProfile, dev->T("GPU Profile")));
 	}
+	items->Add(new CheckBox(&g_Config.bShowGpuProfile, dev->T("GPU Profile")));
 	items->Add(new Choice(dev->T("Toggle Freeze")))->OnClick.Handle(this, &DevMenu::OnFreezeFrame);
 	items->Add(new Choice(dev->T("Dump Frame GPU Commands")))->OnClick.Handle(this, &DevMenu::OnDumpFrame);
 	items->Add(new Choice(dev->T("Toggle Audio Debug")))->OnClick.Handle(this, &DevMenu::OnToggleAudioDebug);
+	items->Add(new Choice(dev->T("HLE Syscall Profile")))->OnClick.Handle(this, &DevMenu::OnHLEProfile);
+	items->Add(new Choice(dev->T("Input Latency")))->OnClick.Handle(this, &DevMenu::OnInputLatency);
+	items->Add(new Choice(dev->T("Texture Cache Stats")))->OnClick.Handle(this, &DevMenu::OnTextureCacheStats);
 #ifdef USE_PROFILER
 	items->Add(new CheckBox(&g_Config.bShowFrameProfiler, dev->T("Frame Profiler"), ""));
+	items->Add(new Choice(Profiler_IsCapturing() ? dev->T("Save Profiler Capture") : dev->T("Start Profiler Capture")))->OnClick.Handle(this, &DevMenu::OnProfilerCapture);
+	items->Add(new Choice(dev->T("Lock Contention")))->OnClick.Handle(this, &DevMenu::OnLockProfile);
 #endif
 
 	scroll->Add(items);
@@ -129,6 +146,30 @@ UI::EventReturn DevMenu::OnJitCompare(UI::EventParams &e) {
 	return UI::EVENT_DONE;
 }
 
+UI::EventReturn DevMenu::OnHLEProfile(UI::EventParams &e) {
+	UpdateUIState(UISTATE_PAUSEMENU);
+	screenManager()->push(new HLEProfileScreen());
+	return UI::EVENT_DONE;
+}
+
+UI::EventReturn DevMenu::OnInputLatency(UI::EventParams &e) {
+	UpdateUIState(UISTATE_PAUSEMENU);
+	screenManager()->push(new InputLatencyScreen());
+	return UI::EVENT_DONE;
+}
+
+UI::EventReturn DevMenu::OnLockProfile(UI::EventParams &e) {
+	UpdateUIState(UISTATE_PAUSEMENU);
+	screenManager()->push(new LockProfileScreen());
+	return UI::EVENT_DONE;
+}
+
+UI::EventReturn DevMenu::OnTextureCacheStats(UI::EventParams &e) {
+	UpdateUIState(UISTATE_PAUSEMENU);
+	screenManager()->push(new TextureCacheStatsScreen());
+	return UI::EVENT_DONE;
+}
+
 UI::EventReturn DevMenu::OnShaderView(UI::EventParams &e) {
 	UpdateUIState(UISTATE_PAUSEMENU);
 	if (gpu)  // Avoid crashing if chosen while the game is being loaded.
@@ -150,6 +191,27 @@ UI::EventReturn DevMenu::OnDumpFrame(UI::EventParams &e) {
 	return UI::EVENT_DONE;
 }
 
+UI::EventReturn DevMenu::OnProfilerCapture(UI::EventParams &e) {
+#ifdef USE_PROFILER
+	if (!Profiler_IsCapturing()) {
+		Profiler_StartCapture();
+	} else {
+		// Keeps capturing, so it can be saved again after the next hitch.
+		std::string path = GetSysDirectory(DIRECTORY_DUMP);
+		if (!File::Exists(path))
+			File::CreateDir(path);
+		path += StringFromFormat("profile_%s.json", KernelTimeNowFormatted().c_str());
+		if (Profiler_SaveCapture(path.c_str())) {
+			osm.Show(path);
+		} else {
+			ERROR_LOG(SYSTEM, "Failed to save profiler capture to %s", path.c_str());
+		}
+	}
+	RecreateViews();
+#endif
+	return UI::EVENT_DONE;
+}
+
 void DevMenu::dialogFinished(const Screen *dialog, DialogResult result) {
 	UpdateUIState(UISTATE_INGAME);
 	// Close when a subscreen got closed.
@@ -220,6 +282,239 @@ UI::EventReturn LogScreen::OnSubmit(UI::EventParams &e) {
 	return UI::EVENT_DONE;
 }
 
+static bool hleProfileTiming = false;
+static const int MAX_HLE_PROFILE_ROWS = 50;
+
+void HLEProfileScreen::UpdateProfile() {
+	using namespace UI;
+	vert_->Clear();
+	vert_->Add(new TextView("calls/frame   ms/frame    calls    total ms   function", FLAG_DYNAMIC_ASCII, true));
+
+	std::vector<HLESyscallProfile> funcs = hleGetSyscallProfile();
+	if (funcs.size() > (size_t)MAX_HLE_PROFILE_ROWS)
+		funcs.resize(MAX_HLE_PROFILE_ROWS);
+	for (const HLESyscallProfile &func : funcs) {
+		std::string line = StringFromFormat("%11u %10.3f %8llu %11.3f   %s::%s", func.frameCalls, func.frameSeconds * 1000.0, (unsigned long long)func.totalCalls, func.totalSeconds * 1000.0, func.module, func.name);
+		vert_->Add(new TextView(line, FLAG_DYNAMIC_ASCII, true));
+	}
+}
+
+void HLEProfileScreen::update() {
+	UIDialogScreenWithBackground::update();
+	if (vert_ && time_now_d() - lastUpdate_ >= 0.5) {
+		lastUpdate_ = time_now_d();
+		UpdateProfile();
+	}
+}
+
+void HLEProfileScreen::CreateViews() {
+	using namespace UI;
+	I18NCategory *di = GetI18NCategory("Dialog");
+	I18NCategory *dev = GetI18NCategory("Developer");
+
+	LinearLayout *outer = new LinearLayout(ORIENT_VERTICAL, new LinearLayoutParams(FILL_PARENT, FILL_PARENT));
+	root_ = outer;
+
+	LinearLayout *top = outer->Add(new LinearLayout(ORIENT_HORIZONTAL, new LayoutParams(FILL_PARENT, WRAP_CONTENT)));
+	top->Add(new Button(di->T("Back")))->OnClick.Handle<UIScreen>(this, &UIScreen::OnBack);
+	top->Add(new CheckBox(&hleProfileTiming, dev->T("Time syscalls"), "", new LinearLayoutParams(1.0f)))->OnClick.Handle(this, &HLEProfileScreen::OnToggleTiming);
+	top->Add(new Button(di->T("Reset")))->OnClick.Handle(this, &HLEProfileScreen::OnReset);
+
+	ScrollView *scroll = outer->Add(new ScrollView(ORIENT_VERTICAL, new LinearLayoutParams(1.0f)));
+	vert_ = scroll->Add(new LinearLayout(ORIENT_VERTICAL, new LinearLayoutParams(FILL_PARENT, WRAP_CONTENT)));
+	vert_->SetSpacing(0);
+
+	UpdateProfile();
+	lastUpdate_ = time_now_d();
+}
+
+UI::EventReturn HLEProfileScreen::OnToggleTiming(UI::EventParams &e) {
+	// The checkbox already flipped it.
+	Core_ForceDebugStats(hleProfileTiming);
+	return UI::EVENT_DONE;
+}
+
+UI::EventReturn HLEProfileScreen::OnReset(UI::EventParams &e) {
+	hleResetSyscallProfile();
+	UpdateProfile();
+	return UI::EVENT_DONE;
+}
+
+void InputLatencyScreen::UpdateStats() {
+	using namespace UI;
+	vert_->Clear();
+
+	InputLatencyStats stats = InputLatency_GetStats();
+	if (stats.count == 0) {
+		vert_->Add(new TextView("No inputs measured yet.  Only GL and Vulkan report presents.", FLAG_DYNAMIC_ASCII, true));
+		return;
+	}
+
+	vert_->Add(new TextView(StringFromFormat("Last %d inputs, in milliseconds:", stats.count), FLAG_DYNAMIC_ASCII, true));
+	vert_->Add(new TextView("                     min      avg      p50      p95      max", FLAG_DYNAMIC_ASCII, true));
+	auto addRow = [&](const char *title, const InputLatencyDistribution &dist) {
+		std::string line = StringFromFormat("%-16s %8.2f %8.2f %8.2f %8.2f %8.2f", title, dist.minMs, dist.avgMs, dist.p50Ms, dist.p95Ms, dist.maxMs);
+		vert_->Add(new TextView(line, FLAG_DYNAMIC_ASCII, true));
+	};
+	addRow("Input to sample", stats.toSample);
+	addRow("Input to present", stats.toPresent);
+}
+
+void InputLatencyScreen::update() {
+	UIDialogScreenWithBackground::update();
+	if (vert_ && time_now_d() - lastUpdate_ >= 0.5) {
+		lastUpdate_ = time_now_d();
+		UpdateStats();
+	}
+}
+
+void InputLatencyScreen::CreateViews() {
+	using namespace UI;
+	I18NCategory *di = GetI18NCategory("Dialog");
+
+	LinearLayout *outer = new LinearLayout(ORIENT_VERTICAL, new LinearLayoutParams(FILL_PARENT, FILL_PARENT));
+	root_ = outer;
+
+	LinearLayout *top = outer->Add(new LinearLayout(ORIENT_HORIZONTAL, new LayoutParams(FILL_PARENT, WRAP_CONTENT)));
+	top->Add(new Button(di->T("Back")))->OnClick.Handle<UIScreen>(this, &UIScreen::OnBack);
+	top->Add(new Spacer(new LinearLayoutParams(1.0f)));
+	top->Add(new Button(di->T("Reset")))->OnClick.Handle(this, &InputLatencyScreen::OnReset);
+
+	vert_ = outer->Add(new LinearLayout(ORIENT_VERTICAL, new LinearLayoutParams(FILL_PARENT, WRAP_CONTENT, 1.0f)));
+	vert_->SetSpacing(0);
+
+	UpdateStats();
+	lastUpdate_ = time_now_d();
+}
+
+UI::EventReturn InputLatencyScreen::OnReset(UI::EventParams &e) {
+	InputLatency_Reset();
+	UpdateStats();
+	return UI::EVENT_DONE;
+}
+
+void LockProfileScreen::UpdateProfile() {
+	using namespace UI;
+	vert_->Clear();
+	vert_->Add(new TextView("     locks  contended   wait ms    max ms   lock", FLAG_DYNAMIC_ASCII, true));
+
+	for (const LockProfileStats &lock : LockProfile_GetStats()) {
+		std::string line = StringFromFormat("%10llu %10llu %9.3f %9.3f   %s", (unsigned long long)lock.locks, (unsigned long long)lock.contended, lock.waitSeconds * 1000.0, lock.maxWaitSeconds * 1000.0, lock.name.c_str());
+		vert_->Add(new TextView(line, FLAG_DYNAMIC_ASCII, true));
+	}
+}
+
+void LockProfileScreen::update() {
+	UIDialogScreenWithBackground::update();
+	if (vert_ && time_now_d() - lastUpdate_ >= 0.5) {
+		lastUpdate_ = time_now_d();
+		UpdateProfile();
+	}
+}
+
+void LockProfileScreen::CreateViews() {
+	using namespace UI;
+	I18NCategory *di = GetI18NCategory("Dialog");
+
+	LinearLayout *outer = new LinearLayout(ORIENT_VERTICAL, new LinearLayoutParams(FILL_PARENT, FILL_PARENT));
+	root_ = outer;
+
+	LinearLayout *top = outer->Add(new LinearLayout(ORIENT_HORIZONTAL, new LayoutParams(FILL_PARENT, WRAP_CONTENT)));
+	top->Add(new Button(di->T("Back")))->OnClick.Handle<UIScreen>(this, &UIScreen::OnBack);
+	top->Add(new Spacer(new LinearLayoutParams(1.0f)));
+	top->Add(new Button(di->T("Reset")))->OnClick.Handle(this, &LockProfileScreen::OnReset);
+
+	ScrollView *scroll = outer->Add(new ScrollView(ORIENT_VERTICAL, new LinearLayoutParams(1.0f)));
+	vert_ = scroll->Add(new LinearLayout(ORIENT_VERTICAL, new LinearLayoutParams(FILL_PARENT, WRAP_CONTENT)));
+	vert_->SetSpacing(0);
+
+	UpdateProfile();
+	lastUpdate_ = time_now_d();
+}
+
+UI::EventReturn LockProfileScreen::OnReset(UI::EventParams &e) {
+	LockProfile_Reset();
+	UpdateProfile();
+	return UI::EVENT_DONE;
+}
+
+void TextureCacheStatsScreen::UpdateStats() {
+	using namespace UI;
+	vert_->Clear();
+
+	TextureCacheStats stats = TexCacheStats_Get();
+	if (stats.frames == 0) {
+		vert_->Add(new TextView("No frames measured yet.", FLAG_DYNAMIC_ASCII, true));
+		return;
+	}
+
+	const TexCacheFrameStats &sum = stats.sum;
+	auto addLine = [&](const std::string &line) {
+		vert_->Add(new TextView(line, FLAG_DYNAMIC_ASCII, true));
+	};
+	const double perFrame = 1.0 / stats.frames;
+	addLine(StringFromFormat("Last %d frames, per frame:", stats.frames));
+	addLine(StringFromFormat("Lookups %8.1f   hits %8.1f (%0.1f%%)   new %6.1f", sum.lookups * perFrame, sum.hits * perFrame, sum.lookups ? sum.hits * 100.0 / sum.lookups : 0.0, sum.newEntries * perFrame));
+	addLine(StringFromFormat("Hashes  %8.1f   %8.1f KB   %7.3f ms", sum.hashes * perFrame, sum.bytesHashed * perFrame / 1024.0, sum.hashMs * perFrame));
+	addLine(StringFromFormat("Scales  %8.1f   %8.1f Kt   %7.3f ms", sum.scales * perFrame, sum.texelsScaled * perFrame / 1000.0, sum.scaleMs * perFrame));
+
+	addLine("");
+	addLine("Rebuilds      total   per frame");
+	for (int i = 0; i < (int)TexChangeReason::COUNT; ++i) {
+		if (sum.changes[i] != 0)
+			addLine(StringFromFormat("%-17s %5d %11.2f", TexChangeReasonName((TexChangeReason)i), sum.changes[i], sum.changes[i] * perFrame));
+	}
+
+	addLine("");
+	addLine("Decodes       total     avg ms  ms/frame");
+	for (int i = 0; i < TEXCACHE_STATS_FORMATS; ++i) {
+		if (sum.decodes[i] != 0)
+			addLine(StringFromFormat("%-8s %10d %10.3f %9.3f", TexCacheFormatName(i), sum.decodes[i], sum.decodeMs[i] / sum.decodes[i], sum.decodeMs[i] * perFrame));
+	}
+
+	addLine("");
+	addLine(StringFromFormat("Texture time per frame (last frame %0.3f ms):", TexCacheStats_FrameMs(stats.last)));
+	static const char *const bucketNames[TEXCACHE_STATS_BUCKETS] = { "< 0.25", "< 0.5", "< 1", "< 2", "< 4", "< 8", "< 16", ">= 16" };
+	for (int i = 0; i < TEXCACHE_STATS_BUCKETS; ++i) {
+		int bar = stats.msHistogram[i] * 40 / stats.frames;
+		addLine(StringFromFormat("%6s ms %4d %s", bucketNames[i], stats.msHistogram[i], std::string(bar, '#').c_str()));
+	}
+}
+
+void TextureCacheStatsScreen::update() {
+	UIDialogScreenWithBackground::update();
+	if (vert_ && time_now_d() - lastUpdate_ >= 0.5) {
+		lastUpdate_ = time_now_d();
+		UpdateStats();
+	}
+}
+
+void TextureCacheStatsScreen::CreateViews() {
+	using namespace UI;
+	I18NCategory *di = GetI18NCategory("Dialog");
+
+	LinearLayout *outer = new LinearLayout(ORIENT_VERTICAL, new LinearLayoutParams(FILL_PARENT, FILL_PARENT));
+	root_ = outer;
+
+	LinearLayout *top = outer->Add(new LinearLayout(ORIENT_HORIZONTAL, new LayoutParams(FILL_PARENT, WRAP_CONTENT)));
+	top->Add(new Button(di->T("Back")))->OnClick.Handle<UIScreen>(this, &UIScreen::OnBack);
+	top->Add(new Spacer(new LinearLayoutParams(1.0f)));
+	top->Add(new Button(di->T("Reset")))->OnClick.Handle(this, &TextureCacheStatsScreen::OnReset);
+
+	ScrollView *scroll = outer->Add(new ScrollView(ORIENT_VERTICAL, new LinearLayoutParams(1.0f)));
+	vert_ = scroll->Add(new LinearLayout(ORIENT_VERTICAL, new LinearLayoutParams(FILL_PARENT, WRAP_CONTENT)));
+	vert_->SetSpacing(0);
+
+	UpdateStats();
+	lastUpdate_ = time_now_d();
+}
+
+UI::EventReturn TextureCacheStatsScreen::OnReset(UI::EventParams &e) {
+	TexCacheStats_Reset();
+	UpdateStats();
+	return UI::EVENT_DONE;
+}
+
 void LogConfigScreen::CreateViews() {
 	using namespace UI;
 
@@ -352,6 +647,8 @@ static const JitDisableFlag jitDisableFlags[] = {
 	{ MIPSComp::JitDisable::LSU_UNALIGNED, "LSU_UNALIGNED" },
 	{ MIPSComp::JitDisable::LSU_FPU, "LSU_FPU" },
 	{ MIPSComp::JitDisable::LSU_VFPU, "LSU_VFPU" },
+	{ MIPSComp::JitDisable::FUNCTION_CONSTANTS, "Function constants" },
+	{ MIPSComp::JitDisable::SYSCALL_CONTINUE, "Syscall continue" },
 	{ MIPSComp::JitDisable::SIMD, "SIMD" },
 	{ MIPSComp::JitDisable::BLOCKLINK, "Block Linking" },
 	{ MIPSComp::JitDisable::POINTERIFY, "Pointerify" },
@@ -597,6 +894,24 @@ void SystemInfoScreen::CreateViews() {
 		buildConfig->Add(new InfoItem("GOLD", ""));
 	}
 
+	ViewGroup *memoryScroll = new ScrollView(ORIENT_VERTICAL, new LinearLayoutParams(FILL_PARENT, FILL_PARENT));
+	memoryScroll->SetTag("DevSystemInfoMemory");
+	LinearLayout *memory = new LinearLayout(ORIENT_VERTICAL);
+	memory->SetSpacing(0);
+	memoryScroll->Add(memory);
+	tabHolder->AddTab(si->T("Memory"), memoryScroll);
+
+	memory->Add(new ItemHeader(si->T("Memory usage (current / peak)")));
+	for (int i = 0; i < (int)MemoryUsage::Category::COUNT; ++i) {
+		MemoryUsage::Category cat = (MemoryUsage::Category)i;
+		memory->Add(new InfoItem(MemoryUsage::Name(cat), StringFromFormat("%0.1f MB / %0.1f MB", MemoryUsage::Current(cat) / 1048576.0, MemoryUsage::Peak(cat) / 1048576.0)));
+	}
+	memory->Add(new InfoItem(si->T("Total"), StringFromFormat("%0.1f MB", MemoryUsage::TotalCurrent() / 1048576.0)));
+
+	memory->Add(new ItemHeader(si->T("Texture cache")));
+	memory->Add(new InfoItem(si->T("Budget"), StringFromFormat("%0.1f MB", gpuStats.textureCacheBudget / 1048576.0)));
+	memory->Add(new InfoItem(si->T("Evicted textures"), StringFromFormat("%d", gpuStats.numTextureEvictions)));
+
 	ViewGroup *cpuExtensionsScroll = new ScrollView(ORIENT_VERTICAL, new LinearLayoutParams(FILL_PARENT, FILL_PARENT));
 	cpuExtensionsScroll->SetTag("DevSystemInfoCPUExt");
 	LinearLayout *cpuExtensions = new LinearLayout(ORIENT_VERTICAL);
@@ -791,6 +1106,7 @@ void JitCompareScreen::CreateViews() {
 	leftColumn->Add(new Choice(dev->T("FPU")))->OnClick.Handle(this, &JitCompareScreen::OnRandomFPUBlock);
 	leftColumn->Add(new Choice(dev->T("VFPU")))->OnClick.Handle(this, &JitCompareScreen::OnRandomVFPUBlock);
 	leftColumn->Add(new Choice(dev->T("Stats")))->OnClick.Handle(this, &JitCompareScreen::OnShowStats);
+	leftColumn->Add(new Choice(dev->T("Dump blocks")))->OnClick.Handle(this, &JitCompareScreen::OnDumpCorpus);
 	leftColumn->Add(new Choice(di->T("Back")))->OnClick.Handle<UIScreen>(this, &UIScreen::OnBack);
 	blockName_ = leftColumn->Add(new TextView(dev->T("No block")));
 	blockAddr_ = leftColumn->Add(new TextEdit("", "", new LayoutParams(FILL_PARENT, WRAP_CONTENT)));
@@ -896,6 +1212,20 @@ UI::EventReturn JitCompareScreen::OnShowStats(UI::EventParams &e) {
 	return UI::EVENT_DONE;
 }
 
+UI::EventReturn JitCompareScreen::OnDumpCorpus(UI::EventParams &e) {
+	if (!MIPSComp::jit) {
+		return UI::EVENT_DONE;
+	}
+
+	// Replayed by the JitCorpus unit test.
+	const std::string dumpDir = GetSysDirectory(DIRECTORY_DUMP);
+	File::CreateFullPath(dumpDir);
+	const std::string filename = dumpDir + g_paramSFO.GetDiscID() + "_jit_blocks.bin";
+	if (MIPSComp::SaveJitBlockCorpus(filename, MIPSComp::jit->GetBlockCacheDebugInterface())) {
+		blockStats_->SetText(filename);
+	}
+	return UI::EVENT_DONE;
+}
 
 UI::EventReturn JitCompareScreen::OnSelectBlock(UI::EventParams &e) {
 	I18NCategory *dev = GetI18NCategory("Developer");
@@ -45,6 +45,11 @@ class DevMenu : public PopupScreen {
 	UI::EventReturn OnDumpFrame(UI::EventParams &e);
 	UI::EventReturn OnDeveloperTools(UI::EventParams &e);
 	UI::EventReturn OnToggleAudioDebug(UI::EventParams &e);
+	UI::EventReturn OnProfilerCapture(UI::EventParams &e);
+	UI::EventReturn OnHLEProfile(UI::EventParams &e);
+	UI::EventReturn OnInputLatency(UI::EventParams &e);
+	UI::EventReturn OnLockProfile(UI::EventParams &e);
+	UI::EventReturn OnTextureCacheStats(UI::EventParams &e);
 };
 
 class JitDebugScreen : public UIDialogScreenWithBackground {
@@ -100,6 +105,67 @@ class SystemInfoScreen : public UIDialogScreenWithBackground {
 	void CreateViews() override;
 };
 
+// Shows where HLE time goes, per syscall.  Timing stays on after closing, until unchecked.
+class HLEProfileScreen : public UIDialogScreenWithBackground {
+public:
+	HLEProfileScreen() {}
+	void CreateViews() override;
+	void update() override;
+
+private:
+	void UpdateProfile();
+	UI::EventReturn OnToggleTiming(UI::EventParams &e);
+	UI::EventReturn OnReset(UI::EventParams &e);
+
+	UI::LinearLayout *vert_ = nullptr;
+	double lastUpdate_ = 0.0;
+};
+
+// Time from input changing, to the game sampling it, to that frame being presented.
+class InputLatencyScreen : public UIDialogScreenWithBackground {
+public:
+	InputLatencyScreen() {}
+	void CreateViews() override;
+	void update() override;
+
+private:
+	void UpdateStats();
+	UI::EventReturn OnReset(UI::EventParams &e);
+
+	UI::LinearLayout *vert_ = nullptr;
+	double lastUpdate_ = 0.0;
+};
+
+// Contention on ProfiledMutex locks, only counted when built with USE_PROFILER.
+class LockProfileScreen : public UIDialogScreenWithBackground {
+public:
+	LockProfileScreen() {}
+	void CreateViews() override;
+	void update() override;
+
+private:
+	void UpdateProfile();
+	UI::EventReturn OnReset(UI::EventParams &e);
+
+	UI::LinearLayout *vert_ = nullptr;
+	double lastUpdate_ = 0.0;
+};
+
+// What the texture cache did over the last few seconds: hit rate, rebuild reasons, time spent.
+class TextureCacheStatsScreen : public UIDialogScreenWithBackground {
+public:
+	TextureCacheStatsScreen() {}
+	void CreateViews() override;
+	void update() override;
+
+private:
+	void UpdateStats();
+	UI::EventReturn OnReset(UI::EventParams &e);
+
+	UI::LinearLayout *vert_ = nullptr;
+	double lastUpdate_ = 0.0;
+};
+
 class AddressPromptScreen : public PopupScreen {
 public:
 	AddressPromptScreen(const std::string &title) : PopupScreen(title, "OK", "Cancel"), addrView_(NULL), addr_(0) {
@@ -145,6 +211,7 @@ class JitCompareScreen : public UIDialogScreenWithBackground {
 	UI::EventReturn OnBlockAddress(UI::EventParams &e);
 	UI::EventReturn OnAddressChange(UI::EventParams &e);
 	UI::EventReturn OnShowStats(UI::EventParams &e);
+	UI::EventReturn OnDumpCorpus(UI::EventParams &e);
 
 	int currentBlock_;
 
@@ -48,6 +48,7 @@
 #include "Core/Host.h"
 #include "Core/Reporting.h"
 #include "Core/System.h"
+#include "Core/Util/InputLatency.h"
 #include "GPU/GPUState.h"
 #include "GPU/GPUInterface.h"
 #include "GPU/Common/FramebufferCommon.h"
@@ -390,13 +391,13 @@ void EmuScreen::sendMessage(const char *message, const char *value) {
 		invalid_ = true;
 		host->UpdateDisassembly();
 	} else if (!strcmp(message, "reset")) {
-		PSP_Shutdown();
 		bootPending_ = true;
 		invalid_ = true;
-		host->UpdateDisassembly();
 
 		std::string resetError;
-		if (!PSP_InitStart(PSP_CoreParameter(), &resetError)) {
+		bool success = PSP_Reboot(&resetError);
+		host->UpdateDisassembly();
+		if (!success) {
 			ELOG("Error resetting: %s", resetError.c_str());
 			stopRender_ = true;
 			screenManager()->switchScreen(new MainScreen());
@@ -1224,6 +1225,7 @@ void EmuScreen::postRender() {
 		return;
 	if (stopRender_)
 		draw->WipeQueue();
+	InputLatency_EndFrame(draw->GetFrameSerial());
 	draw->EndFrame();
 }
 
@@ -1262,7 +1264,12 @@ void EmuScreen::render() {
 
 	PSP_BeginHostFrame();
 
-	PSP_RunLoopWhileState();
+	// Run-ahead would also run the network ahead, and makes no sense while frozen.
+	if (g_Config.iRunAheadFrames > 0 && !g_Config.bEnableWlan && !PSP_CoreParameter().frozen) {
+		PSP_RunAheadLoopWhileState(g_Config.iRunAheadFrames);
+	} else {
+		PSP_RunLoopWhileState();
+	}
 
 	// Hopefully coreState is now CORE_NEXTFRAME
 	if (coreState == CORE_NEXTFRAME) {
@@ -1368,12 +1375,12 @@ void EmuScreen::renderUI() {
 		DrawAllocatorVis(ctx, gpu);
 	}
 
-	if (g_Config.iGPUBackend == (int)GPUBackend::VULKAN && g_Config.bShowGpuProfile) {
-		DrawProfilerVis(ctx, gpu);
-	}
-
 #endif
 
+	if (g_Config.bShowGpuProfile && !invalid_) {
+		DrawGPUProfilerVis(*ctx);
+	}
+
 #ifdef USE_PROFILER
 	if (g_Config.bShowFrameProfiler && !invalid_) {
 		DrawProfile(*ctx);
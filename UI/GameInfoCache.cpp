@@ -21,6 +21,8 @@
 #include <map>
 #include <memory>
 #include <algorithm>
+#include <cstring>
+#include <ctime>
 
 #include "base/logging.h"
 #include "base/timeutil.h"
@@ -214,6 +216,16 @@ bool GameInfo::LoadFromPath(const std::string &gamePath) {
 	return true;
 }
 
+void GameInfo::SetPath(const std::string &gamePath) {
+	std::lock_guard<std::mutex> guard(lock);
+	if (filePath_ != gamePath) {
+		// The file loader is created on demand, if something needs it after all.
+		fileLoader.reset();
+		filePath_ = gamePath;
+		title = File::GetFilename(filePath_);
+	}
+}
+
 std::shared_ptr<FileLoader> GameInfo::GetFileLoader() {
 	if (filePath_.empty()) {
 		// Happens when workqueue tries to figure out priorities in PrioritizedWorkQueue::Pop(),
@@ -333,17 +345,218 @@ static bool ReadVFSToString(const char *filename, std::string *contents, std::mu
 }
 
 
+static void WriteStoreU32(std::string &out, u32 value) {
+	out.append((const char *)&value, sizeof(value));
+}
+
+static void WriteStoreU64(std::string &out, u64 value) {
+	out.append((const char *)&value, sizeof(value));
+}
+
+static void WriteStoreString(std::string &out, const std::string &value) {
+	WriteStoreU32(out, (u32)value.size());
+	out.append(value);
+}
+
+// Reads back what the functions above wrote, failing (for good) at the first truncated value.
+class StoreReader {
+public:
+	StoreReader(const std::string &data) : data_(data) {}
+
+	bool U32(u32 *value) {
+		return Bytes(value, sizeof(*value));
+	}
+	bool U64(u64 *value) {
+		return Bytes(value, sizeof(*value));
+	}
+	bool Int(int *value) {
+		u32 v;
+		if (!U32(&v))
+			return false;
+		*value = (int)v;
+		return true;
+	}
+	bool String(std::string *value) {
+		u32 size;
+		if (!U32(&size) || data_.size() - pos_ < size) {
+			ok_ = false;
+			return false;
+		}
+		value->assign(data_, pos_, size);
+		pos_ += size;
+		return true;
+	}
+	bool AtEnd() const {
+		return pos_ >= data_.size();
+	}
+
+private:
+	bool Bytes(void *dest, size_t size) {
+		if (!ok_ || data_.size() - pos_ < size) {
+			ok_ = false;
+			return false;
+		}
+		memcpy(dest, data_.data() + pos_, size);
+		pos_ += size;
+		return true;
+	}
+
+	const std::string &data_;
+	size_t pos_ = 0;
+	bool ok_ = true;
+};
+
+static const char *const STORE_MAGIC = "ppssppGI";
+
+std::string GameInfoStore::StorePath() {
+	return GetSysDirectory(DIRECTORY_CACHE) + "gameinfo.db";
+}
+
+void GameInfoStore::LoadIfNeeded() {
+	if (loaded_)
+		return;
+	loaded_ = true;
+
+	std::string data;
+	if (!readFileToString(false, StorePath().c_str(), data))
+		return;
+
+	StoreReader reader(data);
+	std::string magic;
+	u32 version;
+	if (!reader.String(&magic) || magic != STORE_MAGIC || !reader.U32(&version) || version != VERSION) {
+		WARN_LOG(LOADER, "Ignoring game info store from another version");
+		return;
+	}
+
+	while (!reader.AtEnd()) {
+		std::string path;
+		Entry entry;
+		u32 fileType, paramSFOLoaded;
+		bool valid = reader.String(&path) && reader.U64(&entry.size) && reader.U64(&entry.mtime) && reader.U64(&entry.lastUsed);
+		valid = valid && reader.U32(&fileType) && reader.String(&entry.title) && reader.String(&entry.id) && reader.String(&entry.id_version);
+		valid = valid && reader.Int(&entry.disc_total) && reader.Int(&entry.disc_number) && reader.Int(&entry.region);
+		valid = valid && reader.U32(&paramSFOLoaded) && reader.String(&entry.paramSFO) && reader.String(&entry.icon);
+		if (!valid) {
+			ERROR_LOG(LOADER, "Game info store truncated after %d entries", (int)entries_.size());
+			break;
+		}
+		entry.fileType = (IdentifiedFileType)fileType;
+		entry.paramSFOLoaded = paramSFOLoaded != 0;
+		entries_[path] = std::move(entry);
+	}
+	INFO_LOG(LOADER, "Loaded %d entries from the game info store", (int)entries_.size());
+}
+
+bool GameInfoStore::Lookup(const std::string &path, const File::FileDetails &details, Entry *entry) {
+	std::lock_guard<std::mutex> guard(lock_);
+	LoadIfNeeded();
+
+	auto it = entries_.find(path);
+	if (it == entries_.end())
+		return false;
+	if (it->second.size != details.size || it->second.mtime != details.mtime) {
+		entries_.erase(it);
+		dirty_ = true;
+		return false;
+	}
+
+	// Not worth rewriting the whole store for every launch.
+	const u64 now = (u64)time(nullptr);
+	if (now - it->second.lastUsed > 24 * 60 * 60) {
+		it->second.lastUsed = now;
+		dirty_ = true;
+	}
+	*entry = it->second;
+	return true;
+}
+
+void GameInfoStore::Store(const std::string &path, const File::FileDetails &details, Entry &&entry) {
+	std::lock_guard<std::mutex> guard(lock_);
+	LoadIfNeeded();
+
+	entry.size = details.size;
+	entry.mtime = details.mtime;
+	entry.lastUsed = (u64)time(nullptr);
+	entries_[path] = std::move(entry);
+	dirty_ = true;
+}
+
+void GameInfoStore::Save() {
+	std::lock_guard<std::mutex> guard(lock_);
+	if (!dirty_)
+		return;
+
+	// Keep the most recently seen games within the limits.
+	std::vector<std::pair<u64, const std::string *>> byAge;
+	for (const auto &it : entries_) {
+		byAge.push_back(std::make_pair(it.second.lastUsed, &it.first));
+	}
+	std::sort(byAge.begin(), byAge.end(), [](const std::pair<u64, const std::string *> &a, const std::pair<u64, const std::string *> &b) {
+		return a.first > b.first;
+	});
+
+	std::string data;
+	WriteStoreString(data, STORE_MAGIC);
+	WriteStoreU32(data, VERSION);
+	for (size_t i = 0; i < byAge.size() && i < MAX_ENTRIES && data.size() < MAX_BYTES; ++i) {
+		const std::string &path = *byAge[i].second;
+		const Entry &entry = entries_[path];
+		WriteStoreString(data, path);
+		WriteStoreU64(data, entry.size);
+		WriteStoreU64(data, entry.mtime);
+		WriteStoreU64(data, entry.lastUsed);
+		WriteStoreU32(data, (u32)entry.fileType);
+		WriteStoreString(data, entry.title);
+		WriteStoreString(data, entry.id);
+		WriteStoreString(data, entry.id_version);
+		WriteStoreU32(data, (u32)entry.disc_total);
+		WriteStoreU32(data, (u32)entry.disc_number);
+		WriteStoreU32(data, (u32)entry.region);
+		WriteStoreU32(data, entry.paramSFOLoaded ? 1 : 0);
+		WriteStoreString(data, entry.paramSFO);
+		WriteStoreString(data, entry.icon);
+	}
+
+	// Write it all out first, so a crash midway doesn't lose the old one.
+	const std::string path = StorePath();
+	const std::string tempPath = path + ".tmp";
+	if (!writeDataToFile(false, data.data(), (unsigned int)data.size(), tempPath.c_str())) {
+		ERROR_LOG(LOADER, "Failed to write game info store");
+		return;
+	}
+	if (File::Exists(path))
+		File::Delete(path);
+	if (File::Rename(tempPath, path))
+		dirty_ = false;
+}
+
 class GameInfoWorkItem : public PrioritizedWorkQueueItem {
 public:
-	GameInfoWorkItem(const std::string &gamePath, std::shared_ptr<GameInfo> &info)
-		: gamePath_(gamePath), info_(info) {
+	GameInfoWorkItem(const std::string &gamePath, std::shared_ptr<GameInfo> &info, GameInfoStore *store)
+		: gamePath_(gamePath), info_(info), store_(store) {
+		// Worked out here, since priority() can be called while another thread is loading this game.
+		remote_ = startsWith(gamePath, "http://") || startsWith(gamePath, "https://");
 	}
 
 	~GameInfoWorkItem() override {
+		std::lock_guard<std::mutex> guard(info_->loadLock);
 		info_->DisposeFileLoader();
 	}
 
 	void run() override {
+		// Another thread may still be loading this game for an earlier request.
+		std::lock_guard<std::mutex> guard(info_->loadLock);
+
+		// Checked before loading, so if the file changes meanwhile, the entry just won't match next time.
+		File::FileDetails details;
+		const bool storable = !remote_ && File::GetFileDetails(gamePath_, &details);
+		// The store only has the basics and the icon, which is all the game browser wants.
+		const int unstoredFlags = GAMEINFO_WANTBG | GAMEINFO_WANTSIZE | GAMEINFO_WANTSND;
+		if (storable && (info_->wantFlags & unstoredFlags) == 0 && LoadFromStore(details)) {
+			return;
+		}
+
 		if (!info_->LoadFromPath(gamePath_)) {
 			info_->pending = false;
 			return;
@@ -631,14 +844,17 @@ class GameInfoWorkItem : public PrioritizedWorkQueueItem {
 			info_->installDataSize = info_->GetInstallDataSizeInBytes();
 		}
 
+		if (storable) {
+			SaveToStore(details);
+		}
+
 		info_->pending = false;
 		info_->working = false;
 		// ILOG("Completed writing info for %s", info_->GetTitle().c_str());
 	}
 
 	float priority() override {
-		auto fl = info_->GetFileLoader();
-		if (fl && fl->IsRemote()) {
+		if (remote_) {
 			// Increase the value so remote info loads after non-remote.
 			return info_->lastAccessedTime + 1000.0f;
 		}
@@ -646,8 +862,72 @@ class GameInfoWorkItem : public PrioritizedWorkQueueItem {
 	}
 
 private:
+	bool LoadFromStore(const File::FileDetails &details) {
+		GameInfoStore::Entry entry;
+		if (!store_->Lookup(gamePath_, details, &entry))
+			return false;
+
+		info_->SetPath(gamePath_);
+		{
+			std::lock_guard<std::mutex> lock(info_->lock);
+			info_->fileType = entry.fileType;
+			if (!entry.paramSFO.empty())
+				info_->paramSFO.ReadSFO((const u8 *)entry.paramSFO.data(), entry.paramSFO.size());
+			info_->id = entry.id;
+			info_->id_version = entry.id_version;
+			info_->disc_total = entry.disc_total;
+			info_->disc_number = entry.disc_number;
+			info_->region = entry.region;
+			info_->paramSFOLoaded = entry.paramSFOLoaded;
+			info_->icon.data = std::move(entry.icon);
+		}
+		if (!entry.title.empty())
+			info_->SetTitle(entry.title);
+		info_->icon.dataLoaded = true;
+		info_->hasConfig = g_Config.hasGameConfig(info_->id);
+		info_->inStore = true;
+		info_->pending = false;
+		return true;
+	}
+
+	void SaveToStore(const File::FileDetails &details) {
+		switch (info_->fileType) {
+		case IdentifiedFileType::PSP_SAVEDATA_DIRECTORY:
+		case IdentifiedFileType::PPSSPP_SAVESTATE:
+			// These get rewritten in place, so size and mtime can't be trusted to change.
+			return;
+		default:
+			break;
+		}
+
+		GameInfoStore::Entry entry;
+		entry.title = info_->GetTitle();
+		{
+			std::lock_guard<std::mutex> lock(info_->lock);
+			entry.fileType = info_->fileType;
+			entry.id = info_->id;
+			entry.id_version = info_->id_version;
+			entry.disc_total = info_->disc_total;
+			entry.disc_number = info_->disc_number;
+			entry.region = info_->region;
+			entry.paramSFOLoaded = info_->paramSFOLoaded;
+			if (info_->icon.dataLoaded)
+				entry.icon = info_->icon.data;
+
+			u8 *sfoData = nullptr;
+			size_t sfoSize = 0;
+			if (info_->paramSFO.WriteSFO(&sfoData, &sfoSize))
+				entry.paramSFO.assign((const char *)sfoData, sfoSize);
+			delete [] sfoData;
+		}
+		store_->Store(gamePath_, details, std::move(entry));
+		info_->inStore = true;
+	}
+
 	std::string gamePath_;
 	std::shared_ptr<GameInfo> info_;
+	GameInfoStore *store_;
+	bool remote_;
 	DISALLOW_COPY_AND_ASSIGN(GameInfoWorkItem);
 };
 
@@ -662,11 +942,13 @@ GameInfoCache::~GameInfoCache() {
 
 void GameInfoCache::Init() {
 	gameInfoWQ_ = new PrioritizedWorkQueue();
-	ProcessWorkQueueOnThreadWhile(gameInfoWQ_);
+	// Mostly waiting on storage, so a few threads help even with few cores.
+	ProcessWorkQueueOnThreadWhile(gameInfoWQ_, MAX_WORK_THREADS);
 }
 
 void GameInfoCache::Shutdown() {
 	CancelAll();
+	store_.Save();
 
 	if (gameInfoWQ_) {
 		StopProcessingWorkQueue(gameInfoWQ_);
@@ -683,6 +965,7 @@ void GameInfoCache::Clear() {
 		gameInfoWQ_->WaitUntilDone();
 	}
 	info_.clear();
+	store_.Save();
 }
 
 void GameInfoCache::CancelAll() {
@@ -707,6 +990,19 @@ void GameInfoCache::FlushBGs() {
 	}
 }
 
+void GameInfoCache::PurgeIdle(double idleSeconds) {
+	const double cutoff = time_now_d() - idleSeconds;
+	for (auto iter = info_.begin(); iter != info_.end(); ) {
+		const std::shared_ptr<GameInfo> &info = iter->second;
+		// If anyone else still holds it, it's in use (possibly by a work item.)
+		if (info.use_count() == 1 && info->inStore && !info->pending && info->lastAccessedTime < cutoff) {
+			iter = info_.erase(iter);
+		} else {
+			++iter;
+		}
+	}
+}
+
 void GameInfoCache::PurgeType(IdentifiedFileType fileType) {
 	if (gameInfoWQ_)
 		gameInfoWQ_->Flush();
@@ -775,7 +1071,7 @@ std::shared_ptr<GameInfo> GameInfoCache::GetInfo(Draw::DrawContext *draw, const
 		info->pending = true;
 	}
 
-	GameInfoWorkItem *item = new GameInfoWorkItem(gamePath, info);
+	GameInfoWorkItem *item = new GameInfoWorkItem(gamePath, info, &store_);
 	gameInfoWQ_->Add(item);
 
 	// Don't re-insert if we already have it.
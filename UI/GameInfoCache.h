@@ -59,6 +59,9 @@ enum GameInfoWantFlags {
 
 class FileLoader;
 enum class IdentifiedFileType;
+namespace File {
+	struct FileDetails;
+}
 
 struct GameInfoTex {
 	std::string data;
@@ -85,6 +88,8 @@ class GameInfo {
 	bool Delete();  // Better be sure what you're doing when calling this.
 	bool DeleteAllSaveData();
 	bool LoadFromPath(const std::string &gamePath);
+	// Like LoadFromPath, but without opening the file.
+	void SetPath(const std::string &gamePath);
 
 	std::shared_ptr<FileLoader> GetFileLoader();
 	void DisposeFileLoader();
@@ -105,6 +110,8 @@ class GameInfo {
 	// and obviously also not when creating it and holding the only pointer
 	// to it.
 	std::mutex lock;
+	// Held by the work item loading this, so two queued loads of the same game don't overlap.
+	std::mutex loadLock;
 
 	std::string id;
 	std::string id_version;
@@ -133,6 +140,8 @@ class GameInfo {
 	u64 installDataSize = 0;
 	std::atomic<bool> pending{};
 	std::atomic<bool> working{};
+	// Loaded from or saved to the GameInfoStore, so it's cheap to load again if dropped.
+	std::atomic<bool> inStore{};
 
 protected:
 	// Note: this can change while loading, use GetTitle().
@@ -146,6 +155,51 @@ class GameInfo {
 	DISALLOW_COPY_AND_ASSIGN(GameInfo);
 };
 
+// Remembers the basics and icon of every game seen, keyed by path and checked against size and mtime,
+// so the game browser doesn't have to open every file again each launch.  Thread safe.
+class GameInfoStore {
+public:
+	struct Entry {
+		u64 size = 0;
+		u64 mtime = 0;
+		// Lets entries for games not seen in a long time get dropped.
+		u64 lastUsed = 0;
+		IdentifiedFileType fileType;
+		std::string title;
+		std::string id;
+		std::string id_version;
+		int disc_total = 0;
+		int disc_number = 0;
+		int region = -1;
+		bool paramSFOLoaded = false;
+		// Serialized as is, to be read back with ReadSFO.
+		std::string paramSFO;
+		// ICON0 (or fallback), as the original compressed png/jpg.
+		std::string icon;
+	};
+
+	// Returns false if there's no entry, or the file has changed since.
+	bool Lookup(const std::string &path, const File::FileDetails &details, Entry *entry);
+	void Store(const std::string &path, const File::FileDetails &details, Entry &&entry);
+	// Writes the store back to disk, if anything changed.
+	void Save();
+
+private:
+	enum {
+		VERSION = 1,
+		MAX_ENTRIES = 4096,
+		MAX_BYTES = 64 * 1024 * 1024,
+	};
+
+	void LoadIfNeeded();
+	static std::string StorePath();
+
+	std::mutex lock_;
+	std::map<std::string, Entry> entries_;
+	bool loaded_ = false;
+	bool dirty_ = false;
+};
+
 class GameInfoCache {
 public:
 	GameInfoCache();
@@ -161,6 +215,9 @@ class GameInfoCache {
 	// because they're big. bgTextures and sound may be discarded over time as well.
 	std::shared_ptr<GameInfo> GetInfo(Draw::DrawContext *draw, const std::string &gamePath, int wantFlags);
 	void FlushBGs();  // Gets rid of all BG textures. Also gets rid of bg sounds.
+	// Drops games (and their textures) that haven't been asked for in a while, if they're in the store.
+	// Keeps memory bounded while scrolling through big game lists.
+	void PurgeIdle(double idleSeconds);
 
 	PrioritizedWorkQueue *WorkQueue() { return gameInfoWQ_; }
 
@@ -168,6 +225,10 @@ class GameInfoCache {
 	void WaitUntilDone(std::shared_ptr<GameInfo> &info);
 
 private:
+	enum {
+		MAX_WORK_THREADS = 4,
+	};
+
 	void Init();
 	void Shutdown();
 	void SetupTexture(std::shared_ptr<GameInfo> &info, Draw::DrawContext *draw, GameInfoTex &tex);
@@ -178,6 +239,7 @@ class GameInfoCache {
 
 	// Work queue and management
 	PrioritizedWorkQueue *gameInfoWQ_;
+	GameInfoStore store_;
 };
 
 // This one can be global, no good reason not to.
@@ -25,9 +25,12 @@
 #include "ui/view.h"
 #include "ui/viewgroup.h"
 #include "Common/FileUtil.h"
+#include "Common/StringUtils.h"
 #include "Core/Host.h"
+#include "Core/Loaders.h"
 #include "Core/Config.h"
 #include "Core/System.h"
+#include "Core/Util/GameManager.h"
 #include "UI/CwCheatScreen.h"
 #include "UI/EmuScreen.h"
 #include "UI/GameScreen.h"
@@ -87,12 +90,15 @@ void GameScreen::CreateViews() {
 		tvInstallDataSize_->SetVisibility(V_GONE);
 		tvRegion_ = infoLayout->Add(new TextView("", ALIGN_LEFT, true, new LinearLayoutParams(FILL_PARENT, WRAP_CONTENT)));
 		tvRegion_->SetShadow(true);
+		tvCompressStatus_ = infoLayout->Add(new TextView("", ALIGN_LEFT, true, new LinearLayoutParams(FILL_PARENT, WRAP_CONTENT)));
+		tvCompressStatus_->SetShadow(true);
 	} else {
 		tvTitle_ = nullptr;
 		tvGameSize_ = nullptr;
 		tvSaveDataSize_ = nullptr;
 		tvInstallDataSize_ = nullptr;
 		tvRegion_ = nullptr;
+		tvCompressStatus_ = nullptr;
 	}
 
 	ViewGroup *rightColumn = new ScrollView(ORIENT_VERTICAL, new LinearLayoutParams(300, FILL_PARENT, actionMenuMargins));
@@ -140,6 +146,10 @@ void GameScreen::CreateViews() {
 	btnSetBackground_ = rightColumnItems->Add(new Choice(ga->T("Use UI background")));
 	btnSetBackground_->OnClick.Handle(this, &GameScreen::OnSetBackground);
 	btnSetBackground_->SetVisibility(V_GONE);
+
+	btnCompressISO_ = rightColumnItems->Add(new Choice(ga->T("Compress to ZSO")));
+	btnCompressISO_->OnClick.Handle(this, &GameScreen::OnCompressISO);
+	btnCompressISO_->SetVisibility(V_GONE);
 }
 
 UI::Choice *GameScreen::AddOtherChoice(UI::Choice *choice) {
@@ -237,6 +247,25 @@ void GameScreen::render() {
 		}
 	}
 
+	if (!info->pending) {
+		// Already compressed images could still be converted, but there's nothing to gain.
+		bool canCompress = info->fileType == IdentifiedFileType::PSP_ISO && !endsWithNoCase(gamePath_, ".zso");
+		btnCompressISO_->SetVisibility(canCompress ? UI::V_VISIBLE : UI::V_GONE);
+		btnCompressISO_->SetEnabled(g_GameManager.GetState() == GameManagerState::IDLE);
+	}
+
+	if (compressing_ && tvCompressStatus_) {
+		char temp[256];
+		if (g_GameManager.GetState() != GameManagerState::IDLE) {
+			snprintf(temp, sizeof(temp), "%s: %d%%", ga->T("Compressing"), (int)(g_GameManager.GetCurrentInstallProgressPercentage() * 100.0f));
+			tvCompressStatus_->SetText(temp);
+		} else {
+			std::string err = g_GameManager.GetInstallError();
+			tvCompressStatus_->SetText(err.empty() ? ga->T("Compressed to ZSO") : err);
+			compressing_ = false;
+		}
+	}
+
 	if (!info->pending) {
 		// At this point, the above buttons won't become visible.  We can show these now.
 		for (UI::Choice *choice : otherChoices_) {
@@ -245,6 +274,23 @@ void GameScreen::render() {
 	}
 }
 
+UI::EventReturn GameScreen::OnCompressISO(UI::EventParams &e) {
+	I18NCategory *ga = GetI18NCategory("Game");
+	size_t extPos = gamePath_.rfind('.');
+	std::string zsoPath = (extPos != std::string::npos && extPos > gamePath_.rfind('/') ? gamePath_.substr(0, extPos) : gamePath_) + ".zso";
+	if (File::Exists(zsoPath)) {
+		if (tvCompressStatus_)
+			tvCompressStatus_->SetText(ga->T("ZSO file already exists"));
+		return UI::EVENT_DONE;
+	}
+
+	if (g_GameManager.CompressISOOnThread(gamePath_, zsoPath)) {
+		compressing_ = true;
+		btnCompressISO_->SetEnabled(false);
+	}
+	return UI::EVENT_DONE;
+}
+
 UI::EventReturn GameScreen::OnShowInFolder(UI::EventParams &e) {
 	OpenDirectory(gamePath_.c_str());
 	return UI::EVENT_DONE;
@@ -60,6 +60,7 @@ class GameScreen : public UIDialogScreenWithGameBackground {
 	UI::EventReturn OnDeleteConfig(UI::EventParams &e);
 	UI::EventReturn OnCwCheat(UI::EventParams &e);
 	UI::EventReturn OnSetBackground(UI::EventParams &e);
+	UI::EventReturn OnCompressISO(UI::EventParams &e);
 
 	// As we load metadata in the background, we need to be able to update these after the fact.
 	UI::TextView *tvTitle_;
@@ -67,12 +68,15 @@ class GameScreen : public UIDialogScreenWithGameBackground {
 	UI::TextView *tvSaveDataSize_;
 	UI::TextView *tvInstallDataSize_;
 	UI::TextView *tvRegion_;
+	UI::TextView *tvCompressStatus_;
 
 	UI::Choice *btnGameSettings_;
 	UI::Choice *btnCreateGameConfig_;
 	UI::Choice *btnDeleteGameConfig_;
 	UI::Choice *btnDeleteSaveData_;
 	UI::Choice *btnSetBackground_;
+	UI::Choice *btnCompressISO_;
 	std::vector<UI::Choice *> otherChoices_;
 	std::vector<std::string> saveDirs;
+	bool compressing_ = false;
 };
@@ -28,6 +28,7 @@
 #include "gfx_es2/draw_buffer.h"
 #include "i18n/i18n.h"
 #include "util/text/utf8.h"
+#include "thread/threadutil.h"
 #include "ui/view.h"
 #include "ui/viewgroup.h"
 #include "ui/ui_context.h"
@@ -269,6 +270,10 @@ void GameSettingsScreen::CreateViews() {
 	graphicsSettings->Add(new PopupMultiChoice(&g_Config.iFrameSkipType, gr->T("Frame Skipping Type"), frameSkipType, 0, ARRAY_SIZE(frameSkipType), gr->GetName(), screenManager()));
 	frameSkipAuto_ = graphicsSettings->Add(new CheckBox(&g_Config.bAutoFrameSkip, gr->T("Auto FrameSkip")));
 	frameSkipAuto_->OnClick.Handle(this, &GameSettingsScreen::OnAutoFrameskip);
+	static const char *runAhead[] = {"Off", "1", "2", "3", "4"};
+	graphicsSettings->Add(new PopupMultiChoice(&g_Config.iRunAheadFrames, gr->T("Run-ahead frames"), runAhead, 0, ARRAY_SIZE(runAhead), gr->GetName(), screenManager()));
+	static const char *inflightFrames[] = {"Off", "Up to 1", "Up to 2"};
+	graphicsSettings->Add(new PopupMultiChoice(&g_Config.iInflightFrames, gr->T("Buffer graphics commands", "Buffer graphics commands (faster, input lag, restart req.)"), inflightFrames, 1, ARRAY_SIZE(inflightFrames), gr->GetName(), screenManager()));
 
 	PopupSliderChoice *altSpeed1 = graphicsSettings->Add(new PopupSliderChoice(&iAlternateSpeedPercent1_, 0, 1000, gr->T("Alternative Speed", "Alternative speed"), 5, screenManager(), gr->T("%, 0:unlimited")));
 	altSpeed1->SetFormat("%i%%");
@@ -320,6 +325,8 @@ void GameSettingsScreen::CreateViews() {
 	resolutionChoice_->OnChoice.Handle(this, &GameSettingsScreen::OnResolutionChange);
 	resolutionEnable_ = !g_Config.bSoftwareRendering && (g_Config.iRenderingMode != FB_NON_BUFFERED_MODE);
 	resolutionChoice_->SetEnabledPtr(&resolutionEnable_);
+	CheckBox *dynamicResolution = graphicsSettings->Add(new CheckBox(&g_Config.bDynamicResolution, gr->T("Dynamic resolution", "Dynamic resolution (lower it when the GPU is too slow)")));
+	dynamicResolution->SetEnabledPtr(&resolutionEnable_);
 
 #ifdef __ANDROID__
 	if (System_GetPropertyInt(SYSPROP_DEVICE_TYPE) != DEVICE_TYPE_TV) {
@@ -429,6 +436,23 @@ void GameSettingsScreen::CreateViews() {
 	});
 	deposterize->SetDisabledPtr(&g_Config.bSoftwareRendering);
 
+	CheckBox *scalingDiskCache = graphicsSettings->Add(new CheckBox(&g_Config.bTexScalingDiskCache, gr->T("Cache upscaled textures on disk")));
+	scalingDiskCache->SetDisabledPtr(&g_Config.bSoftwareRendering);
+
+	if (GetGPUBackend() == GPUBackend::VULKAN || GetGPUBackend() == GPUBackend::DIRECT3D11) {
+		CheckBox *hwScaling = graphicsSettings->Add(new CheckBox(&g_Config.bTexHardwareScaling, gr->T("Upscale on the GPU")));
+		hwScaling->SetDisabledPtr(&g_Config.bSoftwareRendering);
+	}
+
+	if (GetGPUBackend() != GPUBackend::DIRECT3D9) {
+		CheckBox *gpuMipmaps = graphicsSettings->Add(new CheckBox(&g_Config.bTexGPUMipmaps, gr->T("Generate mipmaps on the GPU")));
+		gpuMipmaps->OnClick.Add([=](EventParams &e) {
+			settingInfo_->Show(gr->T("GPU Mipmaps Tip", "Keeps mipmapping on upscaled and replaced textures"), e.v);
+			return UI::EVENT_CONTINUE;
+		});
+		gpuMipmaps->SetDisabledPtr(&g_Config.bSoftwareRendering);
+	}
+
 	graphicsSettings->Add(new ItemHeader(gr->T("Texture Filtering")));
 	static const char *anisoLevels[] = { "Off", "2x", "4x", "8x", "16x" };
 	PopupMultiChoice *anisoFiltering = graphicsSettings->Add(new PopupMultiChoice(&g_Config.iAnisotropyLevel, gr->T("Anisotropic Filtering"), anisoLevels, 0, ARRAY_SIZE(anisoLevels), gr->GetName(), screenManager()));
@@ -497,6 +521,9 @@ void GameSettingsScreen::CreateViews() {
 		static const char *backend[] = { "Auto", "DSound (compatible)", "WASAPI (fast)" };
 		PopupMultiChoice *audioBackend = audioSettings->Add(new PopupMultiChoice(&g_Config.iAudioBackend, a->T("Audio backend", "Audio backend (restart req.)"), backend, 0, ARRAY_SIZE(backend), a->GetName(), screenManager()));
 		audioBackend->SetEnabledPtr(&g_Config.bEnableSound);
+		static const char *wasapiMode[] = { "Shared", "Low latency shared", "Exclusive" };
+		PopupMultiChoice *wasapiModeChoice = audioSettings->Add(new PopupMultiChoice(&g_Config.iWASAPIMode, a->T("WASAPI mode", "WASAPI mode (restart req.)"), wasapiMode, 0, ARRAY_SIZE(wasapiMode), a->GetName(), screenManager()));
+		wasapiModeChoice->SetEnabledPtr(&g_Config.bEnableSound);
 	}
 #endif
 
@@ -1393,6 +1420,16 @@ void DeveloperToolsScreen::CreateViews() {
 		createTextureIni->SetEnabled(false);
 	}
 #endif
+	// Mostly useful on mobile, where scanning large texture folders is slow.
+	Choice *buildTexturePack = list->Add(new Choice(dev->T("Build texture pack for current game")));
+	buildTexturePack->OnClick.Handle(this, &DeveloperToolsScreen::OnBuildTexturePack);
+	canBuildPack_ = PSP_IsInited() && !buildingPack_;
+	buildTexturePack->SetEnabledPtr(&canBuildPack_);
+}
+
+DeveloperToolsScreen::~DeveloperToolsScreen() {
+	if (packBuilder_.joinable())
+		packBuilder_.join();
 }
 
 void DeveloperToolsScreen::onFinish(DialogResult result) {
@@ -1455,6 +1492,30 @@ UI::EventReturn DeveloperToolsScreen::OnOpenTexturesIniFile(UI::EventParams &e)
 	return UI::EVENT_DONE;
 }
 
+UI::EventReturn DeveloperToolsScreen::OnBuildTexturePack(UI::EventParams &e) {
+	if (buildingPack_)
+		return UI::EVENT_DONE;
+	if (packBuilder_.joinable())
+		packBuilder_.join();
+
+	I18NCategory *dev = GetI18NCategory("Developer");
+	host->NotifyUserMessage(dev->T("Building texture pack..."), 2.0f);
+	buildingPack_ = true;
+	std::string gameID = g_paramSFO.GetDiscID();
+	packBuilder_ = std::thread([this, gameID] {
+		setCurrentThreadName("TexPackBuild");
+		I18NCategory *dev = GetI18NCategory("Developer");
+		std::string error;
+		if (TextureReplacer::BuildPack(gameID, &error)) {
+			host->NotifyUserMessage(dev->T("Texture pack built, it will be used the next time the game starts"), 3.0f);
+		} else {
+			host->NotifyUserMessage(std::string(dev->T("Unable to build texture pack")) + ": " + error, 5.0f, 0x0000FFFF);
+		}
+		buildingPack_ = false;
+	});
+	return UI::EVENT_DONE;
+}
+
 UI::EventReturn DeveloperToolsScreen::OnLogConfig(UI::EventParams &e) {
 	screenManager()->push(new LogConfigScreen());
 	return UI::EVENT_DONE;
@@ -1495,6 +1556,7 @@ void DeveloperToolsScreen::update() {
 	UIDialogScreenWithBackground::update();
 	allowDebugger_ = !WebServerStopped(WebServerFlags::DEBUGGER);
 	canAllowDebugger_ = !WebServerStopping(WebServerFlags::DEBUGGER);
+	canBuildPack_ = PSP_IsInited() && !buildingPack_;
 }
 
 void HostnameSelectScreen::CreatePopupContents(UI::ViewGroup *parent) {
@@ -18,6 +18,7 @@
 #pragma once
 
 #include "ppsspp_config.h"
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <thread>
@@ -157,6 +158,7 @@ class SettingInfoMessage : public UI::LinearLayout {
 class DeveloperToolsScreen : public UIDialogScreenWithBackground {
 public:
 	DeveloperToolsScreen() {}
+	~DeveloperToolsScreen();
 	void update() override;
 	void onFinish(DialogResult result) override;
 
@@ -169,6 +171,7 @@ class DeveloperToolsScreen : public UIDialogScreenWithBackground {
 	UI::EventReturn OnLoadLanguageIni(UI::EventParams &e);
 	UI::EventReturn OnSaveLanguageIni(UI::EventParams &e);
 	UI::EventReturn OnOpenTexturesIniFile(UI::EventParams &e);
+	UI::EventReturn OnBuildTexturePack(UI::EventParams &e);
 	UI::EventReturn OnLogConfig(UI::EventParams &e);
 	UI::EventReturn OnJitAffectingSetting(UI::EventParams &e);
 	UI::EventReturn OnJitDebugTools(UI::EventParams &e);
@@ -178,6 +181,9 @@ class DeveloperToolsScreen : public UIDialogScreenWithBackground {
 
 	bool allowDebugger_ = false;
 	bool canAllowDebugger_ = true;
+	std::thread packBuilder_;
+	std::atomic<bool> buildingPack_{ false };
+	bool canBuildPack_ = true;
 };
 
 class HostnameSelectScreen : public PopupScreen {
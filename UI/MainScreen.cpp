@@ -509,11 +509,27 @@ void GameBrowser::Update() {
 	}
 }
 
+void GameBrowser::Draw(UIContext &dc) {
+	// Only the visible buttons ask for their info (and textures) when drawn.  Ask for the ones
+	// about a screen away too, so they're usually ready before they scroll into view.
+	const Bounds visible = dc.GetScissorBounds();
+	const float margin = visible.h;
+	for (GameButton *button : gameButtons_) {
+		const Bounds bounds = dc.TransformBounds(button->GetBounds());
+		if (bounds.y2() >= visible.y - margin && bounds.y <= visible.y2() + margin && !visible.Intersects(bounds)) {
+			g_gameInfoCache->GetInfo(nullptr, button->GamePath(), 0);
+		}
+	}
+
+	LinearLayout::Draw(dc);
+}
+
 void GameBrowser::Refresh() {
 	using namespace UI;
 
 	homebrewStoreButton_ = nullptr;
 	// Kill all the contents
+	gameButtons_.clear();
 	Clear();
 
 	Add(new Spacer(1.0f));
@@ -564,7 +580,7 @@ void GameBrowser::Refresh() {
 		}
 	} else if (!listingPending_) {
 		std::vector<FileInfo> fileInfo;
-		path_.GetListing(fileInfo, "iso:cso:pbp:elf:prx:ppdmp:");
+		path_.GetListing(fileInfo, "iso:cso:zso:pbp:elf:prx:ppdmp:");
 		for (size_t i = 0; i < fileInfo.size(); i++) {
 			bool isGame = !fileInfo[i].isDirectory;
 			bool isSaveData = false;
@@ -625,6 +641,7 @@ void GameBrowser::Refresh() {
 		gameList_->Add(dirButtons[i])->OnClick.Handle(this, &GameBrowser::NavigateClick);
 	}
 
+	gameButtons_ = gameButtons;
 	for (size_t i = 0; i < gameButtons.size(); i++) {
 		GameButton *b = gameList_->Add(gameButtons[i]);
 		b->OnClick.Handle(this, &GameBrowser::GameButtonClick);
@@ -1019,6 +1036,8 @@ void MainScreen::sendMessage(const char *message, const char *value) {
 
 void MainScreen::update() {
 	UIScreen::update();
+	// Whatever scrolled out of view (and out of the prefetch margin) a while ago goes.
+	g_gameInfoCache->PurgeIdle(10.0);
 	UpdateUIState(UISTATE_MENU);
 	bool vertical = UseVerticalLayout();
 	if (vertical != lastVertical_) {
@@ -45,6 +45,8 @@ static inline bool operator &(const BrowseFlags &lhs, const BrowseFlags &rhs) {
 	return ((int)lhs & (int)rhs) != 0;
 }
 
+class GameButton;
+
 class GameBrowser : public UI::LinearLayout {
 public:
 	GameBrowser(std::string path, BrowseFlags browseFlags, bool *gridStyle, std::string lastText, std::string lastLink, UI::LayoutParams *layoutParams = nullptr);
@@ -59,6 +61,7 @@ class GameBrowser : public UI::LinearLayout {
 	void SetPath(const std::string &path);
 
 	void Update() override;
+	void Draw(UIContext &dc) override;
 
 protected:
 	virtual bool DisplayTopBar();
@@ -81,6 +84,8 @@ class GameBrowser : public UI::LinearLayout {
 	UI::EventReturn PinToggleClick(UI::EventParams &e);
 
 	UI::ViewGroup *gameList_ = nullptr;
+	// Owned by gameList_.
+	std::vector<GameButton *> gameButtons_;
 	PathBrowser path_;
 	bool *gridStyle_;
 	BrowseFlags browseFlags_;
@@ -66,6 +66,7 @@
 #include "Common/FileUtil.h"
 #include "Common/LogManager.h"
 #include "Common/MemArena.h"
+#include "Common/MemoryUsage.h"
 #include "Common/GraphicsContext.h"
 #include "Core/Config.h"
 #include "Core/ConfigValues.h"
@@ -82,6 +83,8 @@
 #include "Core/HLE/sceUsbGps.h"
 #include "Core/Util/GameManager.h"
 #include "Core/Util/AudioFormat.h"
+#include "Core/Util/StartupTrace.h"
+#include "Core/Util/InputLatency.h"
 #include "Core/WebServer.h"
 #include "GPU/GPUInterface.h"
 
@@ -147,6 +150,8 @@ static bool restarting = false;
 
 static bool askedForStoragePermission = false;
 static int renderCounter = 0;
+// Set until the first update, since nothing needs the Discord connection to get the menu up.
+static bool discordMenuPending = false;
 
 struct PendingMessage {
 	std::string msg;
@@ -425,12 +430,13 @@ static void ClearFailedGPUBackends() {
 }
 
 void NativeInit(int argc, const char *argv[], const char *savegame_dir, const char *external_dir, const char *cache_dir) {
+	g_menuStartup.Begin();
 	net::Init();  // This needs to happen before we load the config. So on Windows we also run it in Main. It's fine to call multiple times.
 
 	InitFastMath(cpu_info.bNEON);
 	SetupAudioFormats();
 
-	g_Discord.SetPresenceMenu();
+	discordMenuPending = true;
 
 	// Make sure UI state is MENU.
 	ResetUIState();
@@ -521,6 +527,7 @@ void NativeInit(int argc, const char *argv[], const char *savegame_dir, const ch
 	// fail and it will be set to the default. Later, we load again when we get permission.
 	g_Config.Load();
 #endif
+	g_menuStartup.Mark("config");
 	LogManager *logman = LogManager::GetInstance();
 
 #ifdef __ANDROID__
@@ -691,6 +698,8 @@ void NativeInit(int argc, const char *argv[], const char *savegame_dir, const ch
 	}
 #endif
 
+	g_menuStartup.Mark("fonts");
+
 	if (!boot_filename.empty() && stateToLoad != NULL) {
 		SaveState::Load(stateToLoad, [](SaveState::Status status, const std::string &message, void *) {
 			if (!message.empty() && (!g_Config.bDumpFrames || !g_Config.bDumpVideoOutput)) {
@@ -735,6 +744,7 @@ void NativeInit(int argc, const char *argv[], const char *savegame_dir, const ch
 
 	// Must be done restarting by now.
 	restarting = false;
+	g_menuStartup.Mark("init");
 }
 
 static UI::Style MakeStyle(uint32_t fg, uint32_t bg) {
@@ -792,6 +802,7 @@ bool NativeInitGraphics(GraphicsContext *graphicsContext) {
 	g_draw = graphicsContext->GetDrawContext();
 	_assert_msg_(G3D, g_draw, "No draw context available!");
 	_assert_msg_(G3D, g_draw->GetVshaderPreset(VS_COLOR_2D) != nullptr, "Failed to compile presets");
+	g_draw->SetPresentCallback(&InputLatency_Present);
 
 	ui_draw2d.SetAtlas(&ui_atlas);
 	ui_draw2d_front.SetAtlas(&ui_atlas);
@@ -861,6 +872,7 @@ bool NativeInitGraphics(GraphicsContext *graphicsContext) {
 		gpu->DeviceRestore();
 
 	g_graphicsInited = true;
+	g_menuStartup.Mark("graphics");
 	ILOG("NativeInitGraphics completed");
 	return true;
 }
@@ -903,6 +915,9 @@ void NativeShutdownGraphics() {
 	ILOG("NativeShutdownGraphics done");
 }
 
+static std::string lastScreenshotGameID;
+static int lastScreenshotIndex = -1;
+
 void TakeScreenshot() {
 	g_TakeScreenshot = false;
 
@@ -914,11 +929,11 @@ void TakeScreenshot() {
 		File::CreateDir(path);
 	}
 
-	// First, find a free filename.
-	int i = 0;
-
 	std::string gameId = g_paramSFO.GetDiscID();
 
+	// First, find a free filename.
+	int i = gameId == lastScreenshotGameID ? lastScreenshotIndex + 1 : 0;
+
 	char filename[2048];
 	while (i < 10000){
 		if (g_Config.bScreenshotsAsPNG)
@@ -931,12 +946,19 @@ void TakeScreenshot() {
 		i++;
 	}
 
-	bool success = TakeGameScreenshot(filename, g_Config.bScreenshotsAsPNG ? ScreenshotFormat::PNG : ScreenshotFormat::JPG, SCREENSHOT_OUTPUT);
-	if (success) {
-		osm.Show(filename);
-	} else {
-		I18NCategory *err = GetI18NCategory("Error");
-		osm.Show(err->T("Could not save screenshot file"));
+	// The previous one may not be written yet, so don't pick the same name again.
+	lastScreenshotGameID = gameId;
+	lastScreenshotIndex = i;
+
+	// Encoding is slow, especially PNG, so don't make the game wait for it.
+	I18NCategory *err = GetI18NCategory("Error");
+	std::string savedFilename = filename;
+	std::string failedMessage = err->T("Could not save screenshot file");
+	bool success = TakeGameScreenshotAsync(filename, g_Config.bScreenshotsAsPNG ? ScreenshotFormat::PNG : ScreenshotFormat::JPG, SCREENSHOT_OUTPUT, [=](bool written) {
+		osm.Show(written ? savedFilename : failedMessage);
+	});
+	if (!success) {
+		osm.Show(failedMessage);
 	}
 }
 
@@ -1052,6 +1074,10 @@ void NativeRender(GraphicsContext *graphicsContext) {
 	ui_draw2d.PopDrawMatrix();
 	ui_draw2d_front.PopDrawMatrix();
 
+	if (g_menuStartup.Active()) {
+		g_menuStartup.End("first frame");
+	}
+
 	if (renderCounter < 10 && ++renderCounter == 10) {
 		// We're rendering fine, clear out failure info.
 		ClearFailedGPUBackends();
@@ -1107,6 +1133,10 @@ void HandleGlobalMessage(const std::string &msg, const std::string &value) {
 		}
 		Core_SetPowerSaving(value != "false");
 	}
+	if (msg == "core_lowMemory") {
+		// The caches trim themselves when they next see this.
+		MemoryUsage::NotifyLowMemory();
+	}
 	if (msg == "permission_granted" && value == "storage") {
 #ifdef __ANDROID__
 		CreateDirectoriesAndroid();
@@ -1143,6 +1173,10 @@ void NativeUpdate() {
 	g_DownloadManager.Update();
 	screenManager->update();
 
+	if (discordMenuPending) {
+		discordMenuPending = false;
+		g_Discord.SetPresenceMenu();
+	}
 	g_Discord.Update();
 }
 
@@ -22,6 +22,7 @@
 #include "ui/ui_context.h"
 #include "ui/view.h"
 #include "profiler/profiler.h"
+#include "thin3d/thin3d.h"
 
 static const uint32_t nice_colors[] = {
 	0xFF8040,
@@ -201,3 +202,18 @@ void DrawProfile(UIContext &ui) {
 	lastMaxVal = lastMaxVal * 0.95f + maxVal * 0.05f;
 #endif
 }
+
+void DrawGPUProfilerVis(UIContext &ui) {
+	Draw::GPUProfile profile;
+	std::string text;
+	if (ui.GetDrawContext()->GetGPUProfile(&profile))
+		text = Draw::GPUProfileToString(profile);
+	else
+		text = "(no GPU profile data collected)";
+
+	ui.Begin();
+	ui.SetFontScale(0.4f, 0.4f);
+	ui.DrawTextShadow(text.c_str(), 10, 50, 0xFFFFFFFF, FLAG_DYNAMIC_ASCII);
+	ui.SetFontScale(1.0f, 1.0f);
+	ui.Flush();
+}
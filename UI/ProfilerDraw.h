@@ -2,6 +2,9 @@
 
 class UIContext;
 
+// Per step GPU timings from the draw context, on any backend that supports timestamps.
+void DrawGPUProfilerVis(UIContext &ui);
+
 #ifdef USE_PROFILER
 
 void DrawProfile(UIContext &ui);
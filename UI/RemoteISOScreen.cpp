@@ -150,7 +150,7 @@ static bool FindServer(std::string &resultHost, int &resultPort) {
 static bool LoadGameList(const std::string &url, std::vector<std::string> &games) {
 	PathBrowser browser(url);
 	std::vector<FileInfo> files;
-	browser.GetListing(files, "iso:cso:pbp:elf:prx:ppdmp:", &scanCancelled);
+	browser.GetListing(files, "iso:cso:zso:pbp:elf:prx:ppdmp:", &scanCancelled);
 	if (scanCancelled) {
 		return false;
 	}
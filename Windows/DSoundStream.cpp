@@ -114,6 +114,7 @@ int DSoundAudioBackend::RunThread() {
 	totalRenderedBytes_ = -bufferSize_;
 
 	setCurrentThreadName("DSound");
+	setCurrentThreadRole(ThreadRole::AUDIO);
 	currentPos_ = 0;
 	lastPos_ = 0;
 
@@ -69,6 +69,7 @@ bool MainThread_Ready() {
 
 static void EmuThreadFunc(GraphicsContext *graphicsContext) {
 	setCurrentThreadName("Emu");
+	setCurrentThreadRole(ThreadRole::EMULATION);
 
 	// There's no real requirement that NativeInit happen on this thread.
 	// We just call the update/render loop here.
@@ -111,9 +112,11 @@ void MainThreadFunc() {
 	if (useEmuThread) {
 		// We'll start up a separate thread we'll call Emu
 		setCurrentThreadName("Render");
+		setCurrentThreadRole(ThreadRole::RENDER);
 	} else {
 		// This is both Emu and Render.
 		setCurrentThreadName("Emu");
+		setCurrentThreadRole(ThreadRole::EMULATION);
 	}
 
 	host = new WindowsHost(MainWindow::GetHInstance(), MainWindow::GetHWND(), MainWindow::GetDisplayHWND());
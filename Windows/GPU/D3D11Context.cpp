@@ -209,6 +209,13 @@ bool D3D11Context::Init(HINSTANCE hInst, HWND wnd, std::string *error_message) {
 		dxgiDevice->Release();
 	}
 
+	// DXGI's equivalent of frames in flight: how many presents may be queued before Present() blocks.
+	IDXGIDevice1 *dxgiDevice1 = nullptr;
+	if (SUCCEEDED(device_->QueryInterface(__uuidof(IDXGIDevice1), reinterpret_cast<void**>(&dxgiDevice1)))) {
+		dxgiDevice1->SetMaximumFrameLatency(g_Config.iInflightFrames);
+		dxgiDevice1->Release();
+	}
+
 	// DirectX 11.0 systems
 	DXGI_SWAP_CHAIN_DESC sd;
 	ZeroMemory(&sd, sizeof(sd));
@@ -184,8 +184,8 @@ bool D3D9Context::Init(HINSTANCE hInst, HWND wnd, std::string *error_message) {
 	DX9::pD3DdeviceEx = deviceEx_;
 
 	if (deviceEx_ && IsWin7OrLater()) {
-		// TODO: This makes it slower?
-		//deviceEx->SetMaximumFrameLatency(1);
+		// Lower values make it slower, so only when asked for less lag.
+		deviceEx_->SetMaximumFrameLatency(g_Config.iInflightFrames);
 	}
 	draw_ = Draw::T3DCreateDX9Context(d3d_, d3dEx_, adapterId_, device_, deviceEx_);
 	SetGPUBackend(GPUBackend::DIRECT3D9);
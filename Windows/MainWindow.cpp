@@ -104,9 +104,11 @@ extern ScreenManager *screenManager;
 #define TIMER_CURSORUPDATE 1
 #define TIMER_CURSORMOVEUPDATE 2
 #define TIMER_WHEELRELEASE 3
+#define TIMER_MEMORYCHECK 4
 #define CURSORUPDATE_INTERVAL_MS 1000
 #define CURSORUPDATE_MOVE_TIMESPAN_MS 500
 #define WHEELRELEASE_DELAY_MS 16
+#define MEMORYCHECK_INTERVAL_MS 5000
 
 namespace MainWindow
 {
@@ -123,6 +125,8 @@ namespace MainWindow
 
 	static bool mouseButtonDown = false;
 	static bool hideCursor = false;
+	static HANDLE lowMemoryNotification = nullptr;
+	static BOOL wasLowMemory = FALSE;
 	static int g_WindowState;
 	static bool g_IgnoreWM_SIZE = false;
 	static bool inFullscreenResize = false;
@@ -515,6 +519,10 @@ namespace MainWindow
 		hideCursor = true;
 		SetTimer(hwndMain, TIMER_CURSORUPDATE, CURSORUPDATE_INTERVAL_MS, 0);
 
+		lowMemoryNotification = CreateMemoryResourceNotification(LowMemoryResourceNotification);
+		if (lowMemoryNotification)
+			SetTimer(hwndMain, TIMER_MEMORYCHECK, MEMORYCHECK_INTERVAL_MS, 0);
+
 		ToggleFullscreen(hwndMain, g_Config.bFullScreen);
 
 		W32Util::MakeTopMost(hwndMain, g_Config.bTopMost);
@@ -819,6 +827,16 @@ namespace MainWindow
 				ReleaseMouseWheel();
 				KillTimer(hWnd, TIMER_WHEELRELEASE);
 				return 0;
+
+			case TIMER_MEMORYCHECK:
+				{
+					// Only notify once each time we go low, the caches trim themselves right away.
+					BOOL lowMemory = FALSE;
+					if (QueryMemoryResourceNotification(lowMemoryNotification, &lowMemory) && lowMemory && !wasLowMemory)
+						NativeMessageReceived("core_lowMemory", "");
+					wasLowMemory = lowMemory;
+				}
+				return 0;
 			}
 			break;
 
@@ -908,6 +926,11 @@ namespace MainWindow
 			KillTimer(hWnd, TIMER_CURSORUPDATE);
 			KillTimer(hWnd, TIMER_CURSORMOVEUPDATE);
 			KillTimer(hWnd, TIMER_WHEELRELEASE);
+			KillTimer(hWnd, TIMER_MEMORYCHECK);
+			if (lowMemoryNotification) {
+				CloseHandle(lowMemoryNotification);
+				lowMemoryNotification = nullptr;
+			}
 			PostQuitMessage(0);
 			break;
 
@@ -12,11 +12,13 @@
 #include <MMDeviceAPI.h>
 #include <AudioClient.h>
 #include <AudioPolicy.h>
+#include <avrt.h>
 #include "Functiondiscoverykeys_devpkey.h"
 
 // Includes some code from https://msdn.microsoft.com/en-us/library/dd370810%28VS.85%29.aspx?f=255&MSPPError=-2147217396
 
 #pragma comment(lib, "ole32.lib")
+#pragma comment(lib, "avrt.lib")
 
 const CLSID CLSID_MMDeviceEnumerator = __uuidof(MMDeviceEnumerator);
 const IID IID_IMMDeviceEnumerator = __uuidof(IMMDeviceEnumerator);
@@ -141,6 +143,8 @@ class CMMNotificationClient : public IMMNotificationClient {
 // 200 times/sec = 5ms, pretty good :) Wonder if all computers can handle it though.
 #define REFTIMES_PER_SEC  (10000000/200)
 #define REFTIMES_PER_MILLISEC  (REFTIMES_PER_SEC / 1000)
+// Actual REFERENCE_TIME units, for device periods.
+#define HNS_PER_SEC  10000000
 
 WASAPIAudioBackend::WASAPIAudioBackend() : threadData_(0) {
 }
@@ -178,8 +182,8 @@ bool WASAPIAudioBackend::Init(HWND window, StreamCallback callback, int sampleRa
 // This to be run only on the thread.
 class WASAPIAudioThread {
 public:
-	WASAPIAudioThread(std::atomic<int> &threadData, int &sampleRate, StreamCallback &callback)
-		: threadData_(threadData), sampleRate_(sampleRate), callback_(callback) {
+	WASAPIAudioThread(std::atomic<int> &threadData, int &sampleRate, StreamCallback &callback, int mode)
+		: threadData_(threadData), sampleRate_(sampleRate), callback_(callback), mode_(mode) {
 	}
 	~WASAPIAudioThread();
 
@@ -187,13 +191,18 @@ class WASAPIAudioThread {
 
 private:
 	bool ActivateDefaultDevice();
+	bool ReactivateClient();
 	bool InitAudioDevice();
+	bool InitExclusive();
+	bool InitLowLatencyShared();
+	void ReportLatency();
 	void ShutdownAudioDevice();
 	bool DetectFormat();
 
 	std::atomic<int> &threadData_;
 	int &sampleRate_;
 	StreamCallback &callback_;
+	int mode_;
 
 	IMMDeviceEnumerator *deviceEnumerator_ = nullptr;
 	IMMDevice *device_ = nullptr;
@@ -212,12 +221,24 @@ class WASAPIAudioThread {
 	uint32_t numBufferFrames = 0;
 	Format format_ = Format::UNKNOWN;
 	REFERENCE_TIME actualDuration_{};
+
+	// Set in the exclusive and low latency modes, where WASAPI wakes us when it wants data.
+	bool eventDriven_ = false;
+	bool exclusive_ = false;
+	HANDLE bufferEvent_ = nullptr;
+	HANDLE mmcssTask_ = nullptr;
 };
 
 WASAPIAudioThread::~WASAPIAudioThread() {
 	delete [] shortBuf_;
 	shortBuf_ = nullptr;
 	ShutdownAudioDevice();
+	if (bufferEvent_)
+		CloseHandle(bufferEvent_);
+	bufferEvent_ = nullptr;
+	if (mmcssTask_)
+		AvRevertMmThreadCharacteristics(mmcssTask_);
+	mmcssTask_ = nullptr;
 	if (notificationClient_ && deviceEnumerator_)
 		deviceEnumerator_->UnregisterEndpointNotificationCallback(notificationClient_);
 	delete notificationClient_;
@@ -237,10 +258,47 @@ bool WASAPIAudioThread::ActivateDefaultDevice() {
 	return true;
 }
 
+// An IAudioClient can't be initialized again after a failed attempt, so get a fresh one.
+bool WASAPIAudioThread::ReactivateClient() {
+	SAFE_RELEASE(audioInterface_);
+	HRESULT hresult = device_->Activate(IID_IAudioClient, CLSCTX_ALL, NULL, (void **)&audioInterface_);
+	return SUCCEEDED(hresult);
+}
+
 bool WASAPIAudioThread::InitAudioDevice() {
 	REFERENCE_TIME hnsBufferDuration = REFTIMES_PER_SEC;
 	HRESULT hresult = audioInterface_->GetMixFormat((WAVEFORMATEX **)&deviceFormat_);
-	hresult = audioInterface_->Initialize(AUDCLNT_SHAREMODE_SHARED, 0, hnsBufferDuration, 0, &deviceFormat_->Format, nullptr);
+	if (FAILED(hresult))
+		return false;
+
+	eventDriven_ = false;
+	exclusive_ = false;
+	bool initialized = false;
+	if (mode_ == WASAPI_EXCLUSIVE) {
+		initialized = InitExclusive();
+	} else if (mode_ == WASAPI_LOW_LATENCY_SHARED) {
+		initialized = InitLowLatencyShared();
+	}
+
+	if (!initialized) {
+		if (mode_ != WASAPI_SHARED) {
+			WARN_LOG(SCEAUDIO, "WASAPI: Low latency mode unavailable, using a regular shared stream");
+			if (!audioInterface_ && !ReactivateClient())
+				return false;
+		}
+		hresult = audioInterface_->Initialize(AUDCLNT_SHAREMODE_SHARED, 0, hnsBufferDuration, 0, &deviceFormat_->Format, nullptr);
+		if (FAILED(hresult))
+			return false;
+	}
+
+	if (eventDriven_) {
+		if (!bufferEvent_)
+			bufferEvent_ = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		hresult = audioInterface_->SetEventHandle(bufferEvent_);
+		if (FAILED(hresult))
+			return false;
+	}
+
 	hresult = audioInterface_->GetService(IID_IAudioRenderClient, (void **)&renderClient_);
 	if (FAILED(hresult))
 		return false;
@@ -250,10 +308,106 @@ bool WASAPIAudioThread::InitAudioDevice() {
 		return false;
 
 	sampleRate_ = deviceFormat_->Format.nSamplesPerSec;
+	ReportLatency();
+
+	return true;
+}
+
+bool WASAPIAudioThread::InitExclusive() {
+	HRESULT hresult = audioInterface_->IsFormatSupported(AUDCLNT_SHAREMODE_EXCLUSIVE, &deviceFormat_->Format, nullptr);
+	if (hresult != S_OK) {
+		// The mix format is usually float, which drivers rarely take directly. Try plain 16-bit stereo at the same rate.
+		WAVEFORMATEXTENSIBLE *pcm = (WAVEFORMATEXTENSIBLE *)CoTaskMemAlloc(sizeof(WAVEFORMATEXTENSIBLE));
+		memset(pcm, 0, sizeof(WAVEFORMATEXTENSIBLE));
+		pcm->Format.wFormatTag = WAVE_FORMAT_EXTENSIBLE;
+		pcm->Format.nChannels = 2;
+		pcm->Format.nSamplesPerSec = deviceFormat_->Format.nSamplesPerSec;
+		pcm->Format.wBitsPerSample = 16;
+		pcm->Format.nBlockAlign = 2 * sizeof(int16_t);
+		pcm->Format.nAvgBytesPerSec = pcm->Format.nSamplesPerSec * pcm->Format.nBlockAlign;
+		pcm->Format.cbSize = sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX);
+		pcm->Samples.wValidBitsPerSample = 16;
+		pcm->dwChannelMask = SPEAKER_FRONT_LEFT | SPEAKER_FRONT_RIGHT;
+		pcm->SubFormat = KSDATAFORMAT_SUBTYPE_PCM;
+
+		hresult = audioInterface_->IsFormatSupported(AUDCLNT_SHAREMODE_EXCLUSIVE, &pcm->Format, nullptr);
+		if (hresult != S_OK) {
+			CoTaskMemFree(pcm);
+			return false;
+		}
+		CoTaskMemFree(deviceFormat_);
+		deviceFormat_ = pcm;
+	}
+
+	REFERENCE_TIME defaultPeriod = 0, minPeriod = 0;
+	hresult = audioInterface_->GetDevicePeriod(&defaultPeriod, &minPeriod);
+	if (FAILED(hresult))
+		return false;
+
+	// In exclusive event mode, the buffer is one period and we refill all of it on each event.
+	REFERENCE_TIME period = minPeriod;
+	hresult = audioInterface_->Initialize(AUDCLNT_SHAREMODE_EXCLUSIVE, AUDCLNT_STREAMFLAGS_EVENTCALLBACK, period, period, &deviceFormat_->Format, nullptr);
+	if (hresult == AUDCLNT_E_BUFFER_SIZE_NOT_ALIGNED) {
+		// Retry with the period rounded to what the device can actually do.
+		UINT32 alignedFrames = 0;
+		audioInterface_->GetBufferSize(&alignedFrames);
+		period = (REFERENCE_TIME)((double)HNS_PER_SEC * alignedFrames / deviceFormat_->Format.nSamplesPerSec + 0.5);
+		if (!ReactivateClient())
+			return false;
+		hresult = audioInterface_->Initialize(AUDCLNT_SHAREMODE_EXCLUSIVE, AUDCLNT_STREAMFLAGS_EVENTCALLBACK, period, period, &deviceFormat_->Format, nullptr);
+	}
+	if (FAILED(hresult)) {
+		// Probably in use by another exclusive app.
+		ERROR_LOG(SCEAUDIO, "WASAPI: Could not open exclusive stream: %08x", (uint32_t)hresult);
+		ReactivateClient();
+		return false;
+	}
+
+	eventDriven_ = true;
+	exclusive_ = true;
+	return true;
+}
+
+bool WASAPIAudioThread::InitLowLatencyShared() {
+	// IAudioClient3 (Windows 10) can run the shared engine with smaller periods than the default 10ms.
+	IAudioClient3 *client3 = nullptr;
+	HRESULT hresult = audioInterface_->QueryInterface(__uuidof(IAudioClient3), (void **)&client3);
+	if (SUCCEEDED(hresult)) {
+		UINT32 defaultFrames = 0, fundamentalFrames = 0, minFrames = 0, maxFrames = 0;
+		hresult = client3->GetSharedModeEnginePeriod(&deviceFormat_->Format, &defaultFrames, &fundamentalFrames, &minFrames, &maxFrames);
+		if (SUCCEEDED(hresult))
+			hresult = client3->InitializeSharedAudioStream(AUDCLNT_STREAMFLAGS_EVENTCALLBACK, minFrames, &deviceFormat_->Format, nullptr);
+		client3->Release();
+		if (SUCCEEDED(hresult)) {
+			eventDriven_ = true;
+			return true;
+		}
+		if (!ReactivateClient())
+			return false;
+	}
 
+	// Otherwise, an event driven shared stream with the smallest buffer the engine allows is still better.
+	hresult = audioInterface_->Initialize(AUDCLNT_SHAREMODE_SHARED, AUDCLNT_STREAMFLAGS_EVENTCALLBACK, 0, 0, &deviceFormat_->Format, nullptr);
+	if (FAILED(hresult)) {
+		ReactivateClient();
+		return false;
+	}
+	eventDriven_ = true;
 	return true;
 }
 
+void WASAPIAudioThread::ReportLatency() {
+	REFERENCE_TIME streamLatency = 0, defaultPeriod = 0, minPeriod = 0;
+	audioInterface_->GetStreamLatency(&streamLatency);
+	audioInterface_->GetDevicePeriod(&defaultPeriod, &minPeriod);
+	const double bufferMs = 1000.0 * numBufferFrames / deviceFormat_->Format.nSamplesPerSec;
+	static const char *const modeNames[] = { "shared", "low latency shared", "exclusive" };
+	const char *modeName = exclusive_ ? modeNames[2] : (eventDriven_ ? modeNames[1] : modeNames[0]);
+	INFO_LOG(SCEAUDIO, "WASAPI: %s stream at %d Hz, buffer %d frames (%0.2f ms), stream latency %0.2f ms, device period %0.2f ms (min %0.2f ms)",
+		modeName, (int)deviceFormat_->Format.nSamplesPerSec, (int)numBufferFrames, bufferMs,
+		streamLatency * 1000.0 / HNS_PER_SEC, defaultPeriod * 1000.0 / HNS_PER_SEC, minPeriod * 1000.0 / HNS_PER_SEC);
+}
+
 void WASAPIAudioThread::ShutdownAudioDevice() {
 	SAFE_RELEASE(renderClient_);
 	CoTaskMemFree(deviceFormat_);
@@ -270,6 +424,9 @@ bool WASAPIAudioThread::DetectFormat() {
 	if (deviceFormat_->Format.wFormatTag == WAVE_FORMAT_EXTENSIBLE) {
 		if (!memcmp(&deviceFormat_->SubFormat, &KSDATAFORMAT_SUBTYPE_IEEE_FLOAT, sizeof(deviceFormat_->SubFormat))) {
 			format_ = Format::IEEE_FLOAT;
+		} else if (exclusive_ && !memcmp(&deviceFormat_->SubFormat, &KSDATAFORMAT_SUBTYPE_PCM, sizeof(deviceFormat_->SubFormat))) {
+			// Our own format from InitExclusive.
+			format_ = Format::PCM16;
 		} else {
 			ERROR_LOG_REPORT_ONCE(unexpectedformat, SCEAUDIO, "Got unexpected WASAPI 0xFFFE stream format, expected float!");
 			if (deviceFormat_->Format.wBitsPerSample == 16 && deviceFormat_->Format.nChannels == 2) {
@@ -320,6 +477,14 @@ void WASAPIAudioThread::Run() {
 		return;
 	}
 
+	if (mode_ != WASAPI_SHARED) {
+		// Event driven refills need to wake up promptly, so ask MMCSS to schedule us like pro audio.
+		DWORD taskIndex = 0;
+		mmcssTask_ = AvSetMmThreadCharacteristicsW(L"Pro Audio", &taskIndex);
+		if (!mmcssTask_)
+			WARN_LOG(SCEAUDIO, "WASAPI: Could not register with MMCSS: %d", (int)GetLastError());
+	}
+
 	notificationClient_ = new CMMNotificationClient();
 	notificationClient_->SetCurrentDevice(device_);
 	hresult = deviceEnumerator_->RegisterEndpointNotificationCallback(notificationClient_);
@@ -342,13 +507,24 @@ void WASAPIAudioThread::Run() {
 
 	DWORD flags = 0;
 	while (flags != AUDCLNT_BUFFERFLAGS_SILENT) {
-		Sleep((DWORD)(actualDuration_ / REFTIMES_PER_MILLISEC / 2));
+		bool signaled = false;
+		if (eventDriven_) {
+			// Times out so we still notice shutdown and device changes if the device stops ticking.
+			signaled = WaitForSingleObject(bufferEvent_, 200) == WAIT_OBJECT_0;
+		} else {
+			Sleep((DWORD)(actualDuration_ / REFTIMES_PER_MILLISEC / 2));
+		}
 
-		uint32_t pNumPaddingFrames;
-		hresult = audioInterface_->GetCurrentPadding(&pNumPaddingFrames);
-		if (FAILED(hresult)) {
-			// What to do?
-			pNumPaddingFrames = 0;
+		uint32_t pNumPaddingFrames = 0;
+		if (exclusive_) {
+			// Each event hands us the whole (one period) buffer.
+			pNumPaddingFrames = signaled ? 0 : numBufferFrames;
+		} else {
+			hresult = audioInterface_->GetCurrentPadding(&pNumPaddingFrames);
+			if (FAILED(hresult)) {
+				// What to do?
+				pNumPaddingFrames = 0;
+			}
 		}
 		uint32_t pNumAvFrames = numBufferFrames - pNumPaddingFrames;
 
@@ -356,6 +532,7 @@ void WASAPIAudioThread::Run() {
 		hresult = renderClient_->GetBuffer(pNumAvFrames, &pData);
 		if (FAILED(hresult)) {
 			// What to do?
+			pNumAvFrames = 0;
 		} else if (pNumAvFrames) {
 			switch (format_) {
 			case Format::IEEE_FLOAT:
@@ -419,10 +596,11 @@ void WASAPIAudioThread::Run() {
 int WASAPIAudioBackend::RunThread() {
 	CoInitializeEx(nullptr, COINIT_MULTITHREADED);
 	setCurrentThreadName("WASAPI_audio");
+	setCurrentThreadRole(ThreadRole::AUDIO);
 
 	if (threadData_ == 0) {
 		// This will free everything once it's done.
-		WASAPIAudioThread renderer(threadData_, sampleRate_, callback_);
+		WASAPIAudioThread renderer(threadData_, sampleRate_, callback_, g_Config.iWASAPIMode);
 		renderer.Run();
 	}
 
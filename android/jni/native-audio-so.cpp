@@ -1,8 +1,9 @@
-// Minimal audio streaming using OpenSL.
+// Minimal audio streaming using OpenSL, or AAudio where available.
 //
 // Loosely based on the Android NDK sample code.
 
 #include <assert.h>
+#include <dlfcn.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -199,3 +200,220 @@ OpenSLContext::~OpenSLContext() {
 	ILOG("OpenSLWrap_Shutdown - finished");
 }	
 
+
+// AAudio is only in libaaudio.so on Android 8.0+, and we build against an older platform,
+// so declare the little we use and look the functions up at runtime. Values are from AAudio.h.
+
+typedef struct AAudioStreamStruct AAudioStream;
+typedef struct AAudioStreamBuilderStruct AAudioStreamBuilder;
+typedef int32_t aaudio_result_t;
+typedef int32_t (*AAudioDataCallback)(AAudioStream *stream, void *userData, void *audioData, int32_t numFrames);
+typedef void (*AAudioErrorCallback)(AAudioStream *stream, void *userData, aaudio_result_t error);
+
+enum {
+	AAUDIO_OK = 0,
+	AAUDIO_ERROR_DISCONNECTED = -899,
+	AAUDIO_FORMAT_PCM_I16 = 1,
+	AAUDIO_SHARING_MODE_EXCLUSIVE = 0,
+	AAUDIO_PERFORMANCE_MODE_LOW_LATENCY = 12,
+	AAUDIO_CALLBACK_RESULT_CONTINUE = 0,
+};
+
+static struct {
+	bool loaded;
+	aaudio_result_t (*createStreamBuilder)(AAudioStreamBuilder **builder);
+	void (*builderSetPerformanceMode)(AAudioStreamBuilder *builder, int32_t mode);
+	void (*builderSetSharingMode)(AAudioStreamBuilder *builder, int32_t mode);
+	void (*builderSetFormat)(AAudioStreamBuilder *builder, int32_t format);
+	void (*builderSetChannelCount)(AAudioStreamBuilder *builder, int32_t channelCount);
+	void (*builderSetSampleRate)(AAudioStreamBuilder *builder, int32_t sampleRate);
+	void (*builderSetDataCallback)(AAudioStreamBuilder *builder, AAudioDataCallback callback, void *userData);
+	void (*builderSetErrorCallback)(AAudioStreamBuilder *builder, AAudioErrorCallback callback, void *userData);
+	aaudio_result_t (*builderOpenStream)(AAudioStreamBuilder *builder, AAudioStream **stream);
+	aaudio_result_t (*builderDelete)(AAudioStreamBuilder *builder);
+	aaudio_result_t (*streamRequestStart)(AAudioStream *stream);
+	aaudio_result_t (*streamRequestStop)(AAudioStream *stream);
+	aaudio_result_t (*streamClose)(AAudioStream *stream);
+	int32_t (*streamGetXRunCount)(AAudioStream *stream);
+	int32_t (*streamGetBufferSizeInFrames)(AAudioStream *stream);
+	aaudio_result_t (*streamSetBufferSizeInFrames)(AAudioStream *stream, int32_t numFrames);
+	int32_t (*streamGetBufferCapacityInFrames)(AAudioStream *stream);
+	int32_t (*streamGetFramesPerBurst)(AAudioStream *stream);
+	int32_t (*streamGetSampleRate)(AAudioStream *stream);
+	int32_t (*streamGetSharingMode)(AAudioStream *stream);
+	int32_t (*streamGetPerformanceMode)(AAudioStream *stream);
+} aaudio;
+
+static bool LoadAAudio() {
+	if (aaudio.loaded)
+		return true;
+	void *lib = dlopen("libaaudio.so", RTLD_NOW);
+	if (!lib) {
+		ILOG("AAudio: Not available on this device");
+		return false;
+	}
+
+	bool success = true;
+#define LOAD_AAUDIO(field, name) \
+	*(void **)&aaudio.field = dlsym(lib, name); \
+	success = success && aaudio.field != nullptr;
+
+	LOAD_AAUDIO(createStreamBuilder, "AAudio_createStreamBuilder");
+	LOAD_AAUDIO(builderSetPerformanceMode, "AAudioStreamBuilder_setPerformanceMode");
+	LOAD_AAUDIO(builderSetSharingMode, "AAudioStreamBuilder_setSharingMode");
+	LOAD_AAUDIO(builderSetFormat, "AAudioStreamBuilder_setFormat");
+	LOAD_AAUDIO(builderSetChannelCount, "AAudioStreamBuilder_setChannelCount");
+	LOAD_AAUDIO(builderSetSampleRate, "AAudioStreamBuilder_setSampleRate");
+	LOAD_AAUDIO(builderSetDataCallback, "AAudioStreamBuilder_setDataCallback");
+	LOAD_AAUDIO(builderSetErrorCallback, "AAudioStreamBuilder_setErrorCallback");
+	LOAD_AAUDIO(builderOpenStream, "AAudioStreamBuilder_openStream");
+	LOAD_AAUDIO(builderDelete, "AAudioStreamBuilder_delete");
+	LOAD_AAUDIO(streamRequestStart, "AAudioStream_requestStart");
+	LOAD_AAUDIO(streamRequestStop, "AAudioStream_requestStop");
+	LOAD_AAUDIO(streamClose, "AAudioStream_close");
+	LOAD_AAUDIO(streamGetXRunCount, "AAudioStream_getXRunCount");
+	LOAD_AAUDIO(streamGetBufferSizeInFrames, "AAudioStream_getBufferSizeInFrames");
+	LOAD_AAUDIO(streamSetBufferSizeInFrames, "AAudioStream_setBufferSizeInFrames");
+	LOAD_AAUDIO(streamGetBufferCapacityInFrames, "AAudioStream_getBufferCapacityInFrames");
+	LOAD_AAUDIO(streamGetFramesPerBurst, "AAudioStream_getFramesPerBurst");
+	LOAD_AAUDIO(streamGetSampleRate, "AAudioStream_getSampleRate");
+	LOAD_AAUDIO(streamGetSharingMode, "AAudioStream_getSharingMode");
+	LOAD_AAUDIO(streamGetPerformanceMode, "AAudioStream_getPerformanceMode");
+#undef LOAD_AAUDIO
+
+	if (!success) {
+		ELOG("AAudio: Missing functions in libaaudio.so");
+		dlclose(lib);
+		return false;
+	}
+	// Never unloaded, it's tiny.
+	aaudio.loaded = true;
+	return true;
+}
+
+AAudioContext::AAudioContext(AndroidAudioCallback cb, int _FramesPerBuffer, int _SampleRate)
+	: AudioContext(cb, _FramesPerBuffer, _SampleRate) {}
+
+bool AAudioContext::Init() {
+	if (!LoadAAudio())
+		return false;
+	std::lock_guard<std::mutex> guard(streamLock_);
+	return OpenStream();
+}
+
+bool AAudioContext::OpenStream() {
+	AAudioStreamBuilder *builder = nullptr;
+	aaudio_result_t result = aaudio.createStreamBuilder(&builder);
+	if (result != AAUDIO_OK) {
+		ELOG("AAudio: Failed to create stream builder: %d", (int)result);
+		return false;
+	}
+
+	aaudio.builderSetPerformanceMode(builder, AAUDIO_PERFORMANCE_MODE_LOW_LATENCY);
+	// Only a request, we get a shared stream if the device can't do it.
+	aaudio.builderSetSharingMode(builder, AAUDIO_SHARING_MODE_EXCLUSIVE);
+	aaudio.builderSetFormat(builder, AAUDIO_FORMAT_PCM_I16);
+	aaudio.builderSetChannelCount(builder, 2);
+	aaudio.builderSetSampleRate(builder, sampleRate);
+	aaudio.builderSetDataCallback(builder, &DataCallbackWrap, this);
+	aaudio.builderSetErrorCallback(builder, &ErrorCallbackWrap, this);
+
+	result = aaudio.builderOpenStream(builder, &stream_);
+	aaudio.builderDelete(builder);
+	if (result != AAUDIO_OK) {
+		ELOG("AAudio: Failed to open stream: %d", (int)result);
+		stream_ = nullptr;
+		return false;
+	}
+
+	if (aaudio.streamGetSampleRate(stream_) != sampleRate) {
+		// The mixer was set up for our rate, so we'd play at the wrong speed.
+		ELOG("AAudio: Got sample rate %d instead of %d", (int)aaudio.streamGetSampleRate(stream_), sampleRate);
+		CloseStream();
+		return false;
+	}
+
+	// Start as small as allowed (two bursts - one playing, one being filled) and grow on underruns.
+	framesPerBurst_ = aaudio.streamGetFramesPerBurst(stream_);
+	bufferCapacity_ = aaudio.streamGetBufferCapacityInFrames(stream_);
+	lastXRunCount_ = 0;
+	if (framesPerBurst_ > 0)
+		aaudio.streamSetBufferSizeInFrames(stream_, framesPerBurst_ * 2);
+
+	ILOG("AAudio: Opened stream, sr: %d burst: %d buffer: %d capacity: %d exclusive: %d lowlatency: %d", sampleRate, (int)framesPerBurst_,
+		(int)aaudio.streamGetBufferSizeInFrames(stream_), (int)bufferCapacity_,
+		aaudio.streamGetSharingMode(stream_) == AAUDIO_SHARING_MODE_EXCLUSIVE, aaudio.streamGetPerformanceMode(stream_) == AAUDIO_PERFORMANCE_MODE_LOW_LATENCY);
+
+	result = aaudio.streamRequestStart(stream_);
+	if (result != AAUDIO_OK) {
+		ELOG("AAudio: Failed to start stream: %d", (int)result);
+		CloseStream();
+		return false;
+	}
+	return true;
+}
+
+void AAudioContext::CloseStream() {
+	if (!stream_)
+		return;
+	aaudio.streamRequestStop(stream_);
+	// No more callbacks after this returns.
+	aaudio.streamClose(stream_);
+	stream_ = nullptr;
+}
+
+int32_t AAudioContext::DataCallbackWrap(AAudioStreamStruct *stream, void *userData, void *audioData, int32_t numFrames) {
+	AAudioContext *ctx = (AAudioContext *)userData;
+	return ctx->DataCallback(audioData, numFrames);
+}
+
+int32_t AAudioContext::DataCallback(void *audioData, int32_t numFrames) {
+	short *buffer = (short *)audioData;
+	int renderedFrames = audioCallback(buffer, numFrames);
+	if (renderedFrames < numFrames) {
+		memset(buffer + renderedFrames * 2, 0, (numFrames - renderedFrames) * 2 * sizeof(short));
+	}
+
+	TuneBufferSize();
+	return AAUDIO_CALLBACK_RESULT_CONTINUE;
+}
+
+void AAudioContext::TuneBufferSize() {
+	// Called on the callback thread, where the stream is valid.
+	int32_t xruns = aaudio.streamGetXRunCount(stream_);
+	if (xruns <= lastXRunCount_)
+		return;
+	lastXRunCount_ = xruns;
+
+	int32_t size = aaudio.streamGetBufferSizeInFrames(stream_);
+	if (framesPerBurst_ <= 0 || size + framesPerBurst_ > bufferCapacity_)
+		return;
+	aaudio.streamSetBufferSizeInFrames(stream_, size + framesPerBurst_);
+	ILOG("AAudio: Underrun, buffer now %d frames", (int)aaudio.streamGetBufferSizeInFrames(stream_));
+}
+
+void AAudioContext::ErrorCallbackWrap(AAudioStreamStruct *stream, void *userData, int32_t error) {
+	AAudioContext *ctx = (AAudioContext *)userData;
+	ELOG("AAudio: Stream error %d", (int)error);
+	// Mainly the output device changing (e.g. headphones.)  The stream can't be reopened from the callback.
+	if (error != AAUDIO_ERROR_DISCONNECTED || ctx->restarting_.exchange(true))
+		return;
+
+	if (ctx->restartThread_.joinable())
+		ctx->restartThread_.join();
+	ctx->restartThread_ = std::thread([ctx] {
+		std::lock_guard<std::mutex> guard(ctx->streamLock_);
+		ctx->CloseStream();
+		if (!ctx->OpenStream())
+			ELOG("AAudio: Failed to reopen stream after disconnect");
+		ctx->restarting_ = false;
+	});
+}
+
+AAudioContext::~AAudioContext() {
+	if (restartThread_.joinable())
+		restartThread_.join();
+	std::lock_guard<std::mutex> guard(streamLock_);
+	CloseStream();
+	ILOG("AAudio: Closed stream");
+}
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
 #include <SLES/OpenSLES.h>
 #include <SLES/OpenSLES_Android.h>
 
@@ -49,3 +54,34 @@ class OpenSLContext : public AudioContext {
 	static void bqPlayerCallbackWrap(SLAndroidSimpleBufferQueueItf bq, void *context);
 	void BqPlayerCallback(SLAndroidSimpleBufferQueueItf bq);
 };
+
+struct AAudioStreamStruct;
+
+// Android 8.0+. Loaded at runtime, so Init() just fails on older devices and OpenSL can be used instead.
+// Asks for a low latency (and if possible exclusive) stream, and grows the buffer a burst at a time on underruns.
+class AAudioContext : public AudioContext {
+public:
+	AAudioContext(AndroidAudioCallback cb, int framesPerBuffer, int sampleRate);
+
+	bool Init() override;
+	~AAudioContext();
+
+private:
+	bool OpenStream();
+	void CloseStream();
+
+	static int32_t DataCallbackWrap(AAudioStreamStruct *stream, void *userData, void *audioData, int32_t numFrames);
+	static void ErrorCallbackWrap(AAudioStreamStruct *stream, void *userData, int32_t error);
+	int32_t DataCallback(void *audioData, int32_t numFrames);
+	void TuneBufferSize();
+
+	// Protects stream_ while it's reopened, e.g. when headphones are plugged in.
+	std::mutex streamLock_;
+	AAudioStreamStruct *stream_ = nullptr;
+	std::thread restartThread_;
+	std::atomic<bool> restarting_{ false };
+
+	int32_t framesPerBurst_ = 0;
+	int32_t bufferCapacity_ = 0;
+	int32_t lastXRunCount_ = 0;
+};
@@ -23,6 +23,14 @@ bool AndroidAudio_Resume(AndroidAudioState *state) {
 		return false;
 	}
 	if (!state->ctx) {
+		// AAudio has much lower latency where it exists (Android 8.0+), otherwise fall back to OpenSL.
+		state->ctx = new AAudioContext(state->callback, state->frames_per_buffer, state->sample_rate);
+		if (state->ctx->Init()) {
+			ILOG("Using AAudio");
+			return true;
+		}
+		delete state->ctx;
+
 		ILOG("Calling OpenSLWrap_Init_T...");
 		state->ctx = new OpenSLContext(state->callback, state->frames_per_buffer, state->sample_rate);
 		ILOG("Returned from OpenSLWrap_Init_T");
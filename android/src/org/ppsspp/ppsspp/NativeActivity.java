@@ -787,6 +787,23 @@ protected void onPause() {
 		Log.i(TAG, "onPause completed");
 	}
 
+	@Override
+	public void onTrimMemory(int level) {
+		super.onTrimMemory(level);
+		// UI_HIDDEN just means we went to the background, that's not pressure by itself.
+		if (level == TRIM_MEMORY_RUNNING_LOW || level == TRIM_MEMORY_RUNNING_CRITICAL || level >= TRIM_MEMORY_MODERATE) {
+			Log.i(TAG, "onTrimMemory: " + level);
+			NativeApp.sendMessage("core_lowMemory", Integer.toString(level));
+		}
+	}
+
+	@Override
+	public void onLowMemory() {
+		super.onLowMemory();
+		Log.i(TAG, "onLowMemory");
+		NativeApp.sendMessage("core_lowMemory", "");
+	}
+
 	private boolean detectOpenGLES20() {
 		ActivityManager am = (ActivityManager) getSystemService(Context.ACTIVITY_SERVICE);
 		ConfigurationInfo info = am.getDeviceConfigurationInfo();
@@ -68,6 +68,12 @@ private static Point measure(String string, double textSize) {
 		return total;
 	}
 
+	// How far the pen moves, for composing strings from single glyphs.
+	public static float measureAdvance(String string, double textSize) {
+		p.setTextSize((float) textSize);
+		return p.measureText(string);
+	}
+
 	public static int measureText(String string, double textSize) {
 		Point s = measure(string, textSize);
 		return (s.x << 16) | s.y;
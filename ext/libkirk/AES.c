@@ -32,6 +32,26 @@
 
 #include "AES.h"
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define AES_HW_X86 1
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define AES_HW_TARGET __attribute__((target("aes,ssse3")))
+#else
+#define AES_HW_TARGET
+#endif
+#elif defined(_M_ARM64) || (defined(__aarch64__) && defined(__ARM_FEATURE_CRYPTO))
+#define AES_HW_ARM64 1
+#if defined(_MSC_VER)
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+#define AES_HW_TARGET
+#endif
+
 #undef FULL_UNROLL
 
 
@@ -865,6 +885,76 @@ rijndaelKeySetupDec(u32 rk[/*4*(Nr + 1)*/], const u8 cipherKey[], int keyBits)
 	return Nr;
 }
 
+/*
+ * AES-NI / ARMv8 Crypto Extensions versions of the block functions.
+ * They use the same key schedules as the C code: each word is stored with
+ * its first byte in the high bits, so the words just need byte swapping.
+ * The decrypt schedule already has InvMixColumns applied, as aesdec wants.
+ */
+static int aes_hw_accel = 0;
+
+void AES_set_hw_accel(int enable)
+{
+#if defined(AES_HW_X86) || defined(AES_HW_ARM64)
+	aes_hw_accel = enable;
+#else
+	aes_hw_accel = 0;
+#endif
+}
+
+#if defined(AES_HW_X86)
+static AES_HW_TARGET __m128i aes_hw_round_key(const u32 *rk)
+{
+	const __m128i bswap32 = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+	return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)rk), bswap32);
+}
+
+static AES_HW_TARGET void aes_hw_encrypt(const u32 *rk, int Nr, const u8 *in, u8 *out)
+{
+	__m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in), aes_hw_round_key(rk));
+	int r;
+	for (r = 1; r < Nr; ++r)
+		s = _mm_aesenc_si128(s, aes_hw_round_key(rk + 4 * r));
+	s = _mm_aesenclast_si128(s, aes_hw_round_key(rk + 4 * Nr));
+	_mm_storeu_si128((__m128i *)out, s);
+}
+
+static AES_HW_TARGET void aes_hw_decrypt(const u32 *rk, int Nr, const u8 *in, u8 *out)
+{
+	__m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in), aes_hw_round_key(rk));
+	int r;
+	for (r = 1; r < Nr; ++r)
+		s = _mm_aesdec_si128(s, aes_hw_round_key(rk + 4 * r));
+	s = _mm_aesdeclast_si128(s, aes_hw_round_key(rk + 4 * Nr));
+	_mm_storeu_si128((__m128i *)out, s);
+}
+#elif defined(AES_HW_ARM64)
+static uint8x16_t aes_hw_round_key(const u32 *rk)
+{
+	return vrev32q_u8(vld1q_u8((const uint8_t *)rk));
+}
+
+static void aes_hw_encrypt(const u32 *rk, int Nr, const u8 *in, u8 *out)
+{
+	uint8x16_t s = vld1q_u8(in);
+	int r;
+	for (r = 0; r < Nr - 1; ++r)
+		s = vaesmcq_u8(vaeseq_u8(s, aes_hw_round_key(rk + 4 * r)));
+	s = vaeseq_u8(s, aes_hw_round_key(rk + 4 * (Nr - 1)));
+	vst1q_u8(out, veorq_u8(s, aes_hw_round_key(rk + 4 * Nr)));
+}
+
+static void aes_hw_decrypt(const u32 *rk, int Nr, const u8 *in, u8 *out)
+{
+	uint8x16_t s = vld1q_u8(in);
+	int r;
+	for (r = 0; r < Nr - 1; ++r)
+		s = vaesimcq_u8(vaesdq_u8(s, aes_hw_round_key(rk + 4 * r)));
+	s = vaesdq_u8(s, aes_hw_round_key(rk + 4 * (Nr - 1)));
+	vst1q_u8(out, veorq_u8(s, aes_hw_round_key(rk + 4 * Nr)));
+}
+#endif
+
 void
 rijndaelEncrypt(const u32 rk[/*4*(Nr + 1)*/], int Nr, const u8 pt[16],
     u8 ct[16])
@@ -874,6 +964,13 @@ rijndaelEncrypt(const u32 rk[/*4*(Nr + 1)*/], int Nr, const u8 pt[16],
     int r;
 #endif /* ?FULL_UNROLL */
 
+#if defined(AES_HW_X86) || defined(AES_HW_ARM64)
+	if (aes_hw_accel) {
+		aes_hw_encrypt(rk, Nr, pt, ct);
+		return;
+	}
+#endif
+
     /*
 	 * map byte array block to cipher state
 	 * and add initial round key:
@@ -1058,6 +1155,13 @@ rijndaelDecrypt(const u32 rk[/*4*(Nr + 1)*/], int Nr, const u8 ct[16],
     int r;
 #endif /* ?FULL_UNROLL */
 
+#if defined(AES_HW_X86) || defined(AES_HW_ARM64)
+	if (aes_hw_accel) {
+		aes_hw_decrypt(rk, Nr, ct, pt);
+		return;
+	}
+#endif
+
     /*
 	 * map byte array block to cipher state
 	 * and add initial round key:
@@ -43,6 +43,8 @@ void AES_decrypt(AES_ctx *ctx, const u8 *src, u8 *dst);
 void AES_cbc_encrypt(AES_ctx *ctx, u8 *src, u8 *dst, int size);
 void AES_cbc_decrypt(AES_ctx *ctx, u8 *src, u8 *dst, int size);
 void AES_CMAC(AES_ctx *ctx, unsigned char *input, int length, unsigned char *mac);
+// Use AES-NI / ARMv8 crypto instructions, if built in. Only enable if the CPU has them.
+void AES_set_hw_accel(int enable);
 
 int	rijndaelKeySetupEnc(unsigned int [], const unsigned char [], int);
 int	rijndaelKeySetupDec(unsigned int [], const unsigned char [], int);
@@ -40,6 +40,24 @@ effort (for example the reengineering of a great many Capstone chips).
 #include <stdio.h>
 #include <string.h>
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SHA_HW_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define SHA_HW_TARGET __attribute__((target("sha,sse2")))
+#else
+#define SHA_HW_TARGET
+#endif
+#elif defined(_M_ARM64) || (defined(__aarch64__) && defined(__ARM_FEATURE_CRYPTO))
+#define SHA_HW_ARM64 1
+#if defined(_MSC_VER)
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+#endif
+
 static void SHAtoByte(BYTE *output, UINT4 *input, unsigned int len);
 
 /* The SHS block size and message digest sizes, in bytes */
@@ -138,12 +156,98 @@ void SHAInit(SHA_CTX *shsInfo)
 
    Note that this corrupts the shsInfo->data area */
 
+/* SHA extensions / ARMv8 Crypto Extensions version of SHSTransform.  Each
+   step does 4 rounds, and the schedule computes W[ i..i+3 ] from
+   W[ i-16 ], W[ i-12 ], W[ i-8 ] and W[ i-4 ]. */
+
+static int sha_hw_accel = 0;
+
+void SHASetHWAccel(int enable)
+{
+#if defined(SHA_HW_X86) || defined(SHA_HW_ARM64)
+    sha_hw_accel = enable;
+#else
+    sha_hw_accel = 0;
+#endif
+}
+
+#if defined(SHA_HW_X86)
+static SHA_HW_TARGET void SHSTransformHW(UINT4 *digest, UINT4 *data)
+{
+    /* The instructions want A (and W[ 0 ]) in the top lane. */
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)digest), 0x1B);
+    __m128i e = _mm_set_epi32((int)digest[4], 0, 0, 0);
+    __m128i abcdSave = abcd, eSave = e, abcdPrev = abcd, w[4];
+    int i;
+
+    for (i = 0; i < 4; ++i)
+        w[i] = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(data + i * 4)), 0x1B);
+
+    for (i = 0; i < 20; ++i) {
+        __m128i ew;
+        if (i >= 4)
+            w[i & 3] = _mm_sha1msg2_epu32(_mm_xor_si128(_mm_sha1msg1_epu32(w[i & 3], w[(i + 1) & 3]), w[(i + 2) & 3]), w[(i + 3) & 3]);
+        ew = i == 0 ? _mm_add_epi32(e, w[0]) : _mm_sha1nexte_epu32(abcdPrev, w[i & 3]);
+        abcdPrev = abcd;
+        switch (i / 5) {
+        case 0: abcd = _mm_sha1rnds4_epu32(abcd, ew, 0); break;
+        case 1: abcd = _mm_sha1rnds4_epu32(abcd, ew, 1); break;
+        case 2: abcd = _mm_sha1rnds4_epu32(abcd, ew, 2); break;
+        default: abcd = _mm_sha1rnds4_epu32(abcd, ew, 3); break;
+        }
+    }
+
+    e = _mm_sha1nexte_epu32(abcdPrev, eSave);
+    abcd = _mm_add_epi32(abcd, abcdSave);
+    _mm_storeu_si128((__m128i *)digest, _mm_shuffle_epi32(abcd, 0x1B));
+    digest[4] = (UINT4)_mm_cvtsi128_si32(_mm_srli_si128(e, 12));
+}
+#elif defined(SHA_HW_ARM64)
+static void SHSTransformHW(UINT4 *digest, UINT4 *data)
+{
+    static const UINT4 k[4] = { K1, K2, K3, K4 };
+    uint32x4_t abcd = vld1q_u32(digest);
+    uint32x4_t abcdSave = abcd, w[4];
+    uint32_t e = digest[4];
+    int i;
+
+    for (i = 0; i < 4; ++i)
+        w[i] = vld1q_u32(data + i * 4);
+
+    for (i = 0; i < 20; ++i) {
+        uint32x4_t wk;
+        uint32_t eNext;
+        if (i >= 4)
+            w[i & 3] = vsha1su1q_u32(vsha1su0q_u32(w[i & 3], w[(i + 1) & 3], w[(i + 2) & 3]), w[(i + 3) & 3]);
+        wk = vaddq_u32(w[i & 3], vdupq_n_u32(k[i / 5]));
+        eNext = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        switch (i / 5) {
+        case 0: abcd = vsha1cq_u32(abcd, e, wk); break;
+        case 2: abcd = vsha1mq_u32(abcd, e, wk); break;
+        default: abcd = vsha1pq_u32(abcd, e, wk); break;
+        }
+        e = eNext;
+    }
+
+    vst1q_u32(digest, vaddq_u32(abcd, abcdSave));
+    digest[4] += e;
+}
+#endif
+
 static void SHSTransform( digest, data )
      UINT4 *digest, *data ;
     {
     UINT4 A, B, C, D, E;     /* Local vars */
     UINT4 eData[ 16 ];       /* Expanded data */
 
+#if defined(SHA_HW_X86) || defined(SHA_HW_ARM64)
+    if (sha_hw_accel)
+        {
+        SHSTransformHW(digest, data);
+        return;
+        }
+#endif
+
     /* Set up first buffer and local data buffer */
     A = digest[ 0 ];
     B = digest[ 1 ];
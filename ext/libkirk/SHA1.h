@@ -39,6 +39,9 @@ typedef struct
 void SHAInit(SHA_CTX *);
 void SHAUpdate(SHA_CTX *, BYTE *buffer, int count);
 void SHAFinal(BYTE *output, SHA_CTX *);
+/* Use SHA extensions / ARMv8 crypto instructions, if built in.  Only enable
+   if the CPU has them. */
+void SHASetHWAccel(int enable);
 
 #endif /* end _SHA_H_ */
 
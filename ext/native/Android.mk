@@ -71,6 +71,7 @@ LOCAL_SRC_FILES :=\
     thread/threadutil.cpp \
     thread/prioritizedworkqueue.cpp \
     thread/threadpool.cpp \
+    thread/profiledmutex.cpp \
     gfx_es2/glsl_program.cpp \
     gfx_es2/gpu_features.cpp \
     gfx_es2/gl3stub.c \
@@ -239,6 +239,16 @@ int Buffer::Read(int fd, size_t sz) {
 	return (int)received;
 }
 
+int Buffer::ReadSome(int fd, size_t sz) {
+	char buf[4096];
+	int retval = recv(fd, buf, (int)std::min(sz, sizeof(buf)), 0);
+	if (retval > 0) {
+		char *p = Append((size_t)retval);
+		memcpy(p, buf, retval);
+	}
+	return retval;
+}
+
 void Buffer::PeekAll(std::string *dest) {
 	dest->resize(data_.size());
 	memcpy(&(*dest)[0], &data_[0], data_.size());
@@ -72,6 +72,9 @@ class Buffer {
 	// < 0: error
 	// >= 0: number of bytes read
   int Read(int fd, size_t sz);
+	// Like Read, but returns after a single recv, with whatever was available.
+	// < 0: error, 0: closed
+  int ReadSome(int fd, size_t sz);
 
   // Utilities. Try to avoid checking for size.
   size_t size() const { return data_.size(); }
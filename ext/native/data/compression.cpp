@@ -2,6 +2,7 @@
 // Taken from http://panthema.net/2007/0328-ZLibString.html
 
 
+#include <algorithm>
 #include <string>
 #include <stdexcept>
 #include <iostream>
@@ -12,6 +13,7 @@
 #include <zlib.h>
 
 #include "base/logging.h"
+#include "data/compression.h"
 
 /** Compress a STL string using zlib with given compression level and return
 * the binary data. */
@@ -103,3 +105,150 @@ bool decompress_string(const std::string& str, std::string *dest) {
 	*dest = outstring;
 	return true;
 }
+
+// A simple greedy LZ4 encoder.  Not as tight as the reference one, but the output is standard.
+static uint8_t *lz4_write_length(uint8_t *op, size_t len) {
+	while (len >= 255) {
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = (uint8_t)len;
+	return op;
+}
+
+static uint8_t *lz4_write_sequence(uint8_t *op, const uint8_t *oend, const uint8_t *literals, size_t literalLen, size_t matchLen, size_t offset) {
+	// Worst case: token, literal length bytes, literals, offset, match length bytes.
+	if ((size_t)(oend - op) < 1 + literalLen / 255 + 1 + literalLen + 2 + matchLen / 255 + 1)
+		return nullptr;
+
+	uint8_t *token = op++;
+	*token = (uint8_t)(std::min(literalLen, (size_t)15) << 4);
+	if (literalLen >= 15)
+		op = lz4_write_length(op, literalLen - 15);
+	memcpy(op, literals, literalLen);
+	op += literalLen;
+
+	// The last sequence is literals only.
+	if (offset != 0) {
+		*op++ = (uint8_t)(offset & 0xFF);
+		*op++ = (uint8_t)(offset >> 8);
+		*token |= (uint8_t)std::min(matchLen, (size_t)15);
+		if (matchLen >= 15)
+			op = lz4_write_length(op, matchLen - 15);
+	}
+	return op;
+}
+
+int lz4_compress_block(const uint8_t *src, int srcSize, uint8_t *dst, int dstCapacity) {
+	enum {
+		HASH_BITS = 12,
+		MIN_MATCH = 4,
+		// The format requires the last 5 bytes to be literals, and the last match to start 12 bytes before the end.
+		LAST_LITERALS = 5,
+		MF_LIMIT = 12,
+		MAX_OFFSET = 65535,
+	};
+
+	int table[1 << HASH_BITS];
+	for (int i = 0; i < (1 << HASH_BITS); ++i)
+		table[i] = -1;
+
+	const uint8_t *ip = src;
+	const uint8_t *anchor = src;
+	const uint8_t *iend = src + srcSize;
+	const uint8_t *mflimit = srcSize > MF_LIMIT ? iend - MF_LIMIT : src;
+	const uint8_t *matchlimit = iend - LAST_LITERALS;
+	uint8_t *op = dst;
+	const uint8_t *oend = dst + dstCapacity;
+
+	while (ip < mflimit) {
+		uint32_t seq;
+		memcpy(&seq, ip, 4);
+		const uint32_t h = (seq * 2654435761U) >> (32 - HASH_BITS);
+		const int ref = table[h];
+		const int pos = (int)(ip - src);
+		table[h] = pos;
+		if (ref < 0 || pos - ref > MAX_OFFSET || memcmp(src + ref, ip, MIN_MATCH) != 0) {
+			++ip;
+			continue;
+		}
+
+		const uint8_t *match = src + ref + MIN_MATCH;
+		const uint8_t *matchEnd = ip + MIN_MATCH;
+		while (matchEnd < matchlimit && *matchEnd == *match) {
+			++matchEnd;
+			++match;
+		}
+
+		op = lz4_write_sequence(op, oend, anchor, ip - anchor, matchEnd - ip - MIN_MATCH, pos - ref);
+		if (!op)
+			return 0;
+		ip = matchEnd;
+		anchor = ip;
+	}
+
+	op = lz4_write_sequence(op, oend, anchor, iend - anchor, 0, 0);
+	if (!op)
+		return 0;
+	return (int)(op - dst);
+}
+
+static bool lz4_read_length(const uint8_t *&ip, const uint8_t *iend, size_t *len) {
+	uint8_t b;
+	do {
+		if (ip >= iend)
+			return false;
+		b = *ip++;
+		*len += b;
+	} while (b == 255);
+	return true;
+}
+
+int lz4_decompress_block(const uint8_t *src, int srcSize, uint8_t *dst, int dstSize) {
+	const uint8_t *ip = src;
+	const uint8_t *iend = src + srcSize;
+	uint8_t *op = dst;
+	uint8_t *oend = dst + dstSize;
+
+	while (ip < iend && op < oend) {
+		const uint8_t token = *ip++;
+		size_t literalLen = token >> 4;
+		if (literalLen == 15 && !lz4_read_length(ip, iend, &literalLen))
+			return -1;
+		if (literalLen > (size_t)(iend - ip) || literalLen > (size_t)(oend - op))
+			return -1;
+		memcpy(op, ip, literalLen);
+		ip += literalLen;
+		op += literalLen;
+
+		// Either the real end of the block, or all we wanted.
+		if (ip >= iend || op == oend)
+			break;
+
+		if (iend - ip < 2)
+			return -1;
+		const size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (size_t)(op - dst))
+			return -1;
+
+		size_t matchLen = token & 15;
+		if (matchLen == 15 && !lz4_read_length(ip, iend, &matchLen))
+			return -1;
+		matchLen += 4;
+		if (matchLen > (size_t)(oend - op))
+			return -1;
+
+		const uint8_t *match = op - offset;
+		if (offset >= matchLen) {
+			memcpy(op, match, matchLen);
+		} else {
+			// Overlapping, this repeats the last offset bytes.
+			for (size_t i = 0; i < matchLen; ++i)
+				op[i] = match[i];
+		}
+		op += matchLen;
+	}
+
+	return (int)(op - dst);
+}
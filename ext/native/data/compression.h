@@ -1,10 +1,17 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 bool compress_string(const std::string& str, std::string *dest, int compressionlevel = 9);
 bool decompress_string(const std::string& str, std::string *dest);
 
+// Raw LZ4 blocks (no frame header), as used by ZSO disc images.
+// Returns the compressed size, or 0 if it would not fit in dstCapacity.
+int lz4_compress_block(const uint8_t *src, int srcSize, uint8_t *dst, int dstCapacity);
+// Stops once dstSize bytes are produced, so trailing padding is ignored.  Returns the decompressed size, or -1 on corrupt data.
+int lz4_decompress_block(const uint8_t *src, int srcSize, uint8_t *dst, int dstSize);
+
 
 // Delta encoding/decoding - many formats benefit from a pass of this before zlibbing.
 // WARNING : Do not use these with floating point data, especially not float16...
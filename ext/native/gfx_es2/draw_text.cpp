@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 #include "base/display.h"
 #include "base/logging.h"
 #include "base/stringutil.h"
@@ -11,11 +15,12 @@
 #include "gfx_es2/draw_text_qt.h"
 #include "gfx_es2/draw_text_android.h"
 
-TextDrawer::TextDrawer(Draw::DrawContext *draw) : draw_(draw) {
+TextDrawer::TextDrawer(Draw::DrawContext *draw) : draw_(draw), frameCount_(0) {
 	// These probably shouldn't be state.
 	dpiScale_ = CalculateDPIScale();
 }
 TextDrawer::~TextDrawer() {
+	ClearGlyphAtlas();
 }
 
 float TextDrawerWordWrapper::MeasureWidth(const char *str, size_t bytes) {
@@ -59,3 +64,312 @@ TextDrawer *TextDrawer::Create(Draw::DrawContext *draw) {
 	}
 	return drawer;
 }
+
+static bool IsUnshapedCodepoint(uint32_t c) {
+	// Scripts where glyphs can simply be placed side by side, without any shaping or combining marks.
+	if (c >= 0x20 && c < 0x7F)
+		return true;
+	if (c >= 0xA0 && c < 0x300)
+		return true;
+	// Greek, Cyrillic.
+	if (c >= 0x370 && c < 0x483)
+		return true;
+	if (c >= 0x48A && c < 0x530)
+		return true;
+	// General punctuation (without the invisible formatting controls), currency, letterlike and arrows.
+	if (c >= 0x2010 && c < 0x2028)
+		return true;
+	if (c >= 0x2030 && c < 0x205F)
+		return true;
+	if (c >= 0x20A0 && c < 0x2200)
+		return true;
+	// CJK punctuation and kana, CJK ideographs, Hangul syllables, fullwidth forms.
+	if (c >= 0x3000 && c < 0x3100)
+		return true;
+	if (c >= 0x4E00 && c < 0xA000)
+		return true;
+	if (c >= 0xAC00 && c < 0xD7A4)
+		return true;
+	if (c >= 0xFF01 && c < 0xFF61)
+		return true;
+	return false;
+}
+
+bool TextDrawer::CanUseGlyphAtlas(const char *str, size_t len) const {
+	if (len == 0)
+		return false;
+	// Needs to be terminated for UTF8.
+	std::string text(str, len);
+	UTF8 utf(text.c_str());
+	while (!utf.end()) {
+		uint32_t c = utf.next();
+		// Ampersands are prefix markers on some platforms, leave those to the string path.
+		if (c == '\n')
+			continue;
+		if (c == '&' || !IsUnshapedCodepoint(c))
+			return false;
+	}
+	return true;
+}
+
+bool TextDrawer::AllocateGlyph(int width, int height, GlyphEntry *entry) {
+	// One pixel of space around each glyph, so filtering doesn't bleed in neighbours.
+	const int w = width + 1;
+	const int h = height + 1;
+	if (w > GLYPH_PAGE_SIZE || h > GLYPH_PAGE_SIZE)
+		return false;
+
+	auto fits = [&](GlyphPage &page) {
+		if (page.shelfX + w <= GLYPH_PAGE_SIZE && h <= page.shelfHeight)
+			return true;
+		if (page.shelfX + w <= GLYPH_PAGE_SIZE && page.shelfY + h <= GLYPH_PAGE_SIZE) {
+			// Taller than the shelf so far, but it's the last one, so it can grow.
+			page.shelfHeight = h;
+			return true;
+		}
+		const int nextY = page.shelfY + page.shelfHeight;
+		if (nextY + h > GLYPH_PAGE_SIZE)
+			return false;
+		page.shelfX = 0;
+		page.shelfY = nextY;
+		page.shelfHeight = h;
+		return true;
+	};
+
+	int pageIndex = -1;
+	for (size_t i = 0; i < glyphPages_.size(); ++i) {
+		if (fits(glyphPages_[i])) {
+			pageIndex = (int)i;
+			break;
+		}
+	}
+
+	if (pageIndex < 0 && glyphPages_.size() < MAX_GLYPH_PAGES) {
+		glyphPages_.push_back(GlyphPage());
+		glyphPages_.back().alpha.resize(GLYPH_PAGE_SIZE * GLYPH_PAGE_SIZE);
+		pageIndex = (int)glyphPages_.size() - 1;
+		fits(glyphPages_[pageIndex]);
+	}
+
+	if (pageIndex < 0) {
+		// Full, so start over on the page that was used the longest ago.  Not one used this frame, though,
+		// since strings being drawn may still point to its glyphs.
+		int oldest = -1;
+		for (size_t i = 0; i < glyphPages_.size(); ++i) {
+			if (glyphPages_[i].lastUsedFrame != frameCount_ && (oldest < 0 || glyphPages_[i].lastUsedFrame < glyphPages_[oldest].lastUsedFrame))
+				oldest = (int)i;
+		}
+		if (oldest < 0)
+			return false;
+
+		for (auto iter = glyphs_.begin(); iter != glyphs_.end(); ) {
+			if (iter->second.page == oldest)
+				glyphs_.erase(iter++);
+			else
+				++iter;
+		}
+		GlyphPage &page = glyphPages_[oldest];
+		memset(&page.alpha[0], 0, page.alpha.size());
+		page.shelfX = 0;
+		page.shelfY = 0;
+		page.shelfHeight = 0;
+		pageIndex = oldest;
+		fits(page);
+	}
+
+	GlyphPage &page = glyphPages_[pageIndex];
+	entry->page = pageIndex;
+	entry->x = page.shelfX;
+	entry->y = page.shelfY;
+	entry->width = width;
+	entry->height = height;
+	page.shelfX += w;
+	return true;
+}
+
+const TextDrawer::GlyphEntry *TextDrawer::GetGlyph(uint32_t fontHash, uint32_t codepoint) {
+	GlyphKey key{ fontHash, codepoint };
+	auto iter = glyphs_.find(key);
+	if (iter == glyphs_.end()) {
+		GlyphBitmap bitmap{};
+		if (!RasterizeGlyph(codepoint, &bitmap) || bitmap.width <= 0 || bitmap.height <= 0)
+			return nullptr;
+		if ((int)bitmap.alpha.size() < bitmap.width * bitmap.height)
+			return nullptr;
+
+		GlyphEntry entry;
+		if (!AllocateGlyph(bitmap.width, bitmap.height, &entry))
+			return nullptr;
+		entry.originX = bitmap.originX;
+		entry.advance = bitmap.advance;
+
+		GlyphPage &page = glyphPages_[entry.page];
+		for (int y = 0; y < bitmap.height; ++y) {
+			memcpy(&page.alpha[(entry.y + y) * GLYPH_PAGE_SIZE + entry.x], &bitmap.alpha[y * bitmap.width], bitmap.width);
+		}
+		page.dirty = true;
+		iter = glyphs_.insert(std::make_pair(key, entry)).first;
+	}
+
+	glyphPages_[iter->second.page].lastUsedFrame = frameCount_;
+	return &iter->second;
+}
+
+void TextDrawer::UploadGlyphPage(GlyphPage &page) {
+	using namespace Draw;
+
+	DataFormat texFormat;
+	// For our purposes these are equivalent, so just choose the supported one.
+	if (draw_->GetDataFormatSupport(DataFormat::A4R4G4B4_UNORM_PACK16) & FMT_TEXTURE)
+		texFormat = DataFormat::A4R4G4B4_UNORM_PACK16;
+	else if (draw_->GetDataFormatSupport(DataFormat::R4G4B4A4_UNORM_PACK16) & FMT_TEXTURE)
+		texFormat = DataFormat::R4G4B4A4_UNORM_PACK16;
+	else if (draw_->GetDataFormatSupport(DataFormat::B4G4R4A4_UNORM_PACK16) & FMT_TEXTURE)
+		texFormat = DataFormat::B4G4R4A4_UNORM_PACK16;
+	else
+		texFormat = DataFormat::R8G8B8A8_UNORM;
+
+	const int pixels = GLYPH_PAGE_SIZE * GLYPH_PAGE_SIZE;
+	std::vector<uint8_t> data;
+	if (texFormat == DataFormat::R8G8B8A8_UNORM) {
+		data.resize(pixels * 4);
+		uint32_t *dst = (uint32_t *)&data[0];
+		for (int i = 0; i < pixels; ++i)
+			dst[i] = (page.alpha[i] << 24) | 0x00FFFFFF;
+	} else {
+		data.resize(pixels * 2);
+		uint16_t *dst = (uint16_t *)&data[0];
+		const bool alphaHigh = texFormat == DataFormat::A4R4G4B4_UNORM_PACK16;
+		for (int i = 0; i < pixels; ++i) {
+			uint16_t a = page.alpha[i] >> 4;
+			dst[i] = alphaHigh ? ((a << 12) | 0x0FFF) : (a | 0xFFF0);
+		}
+	}
+
+	TextureDesc desc{};
+	desc.type = TextureType::LINEAR2D;
+	desc.format = texFormat;
+	desc.width = GLYPH_PAGE_SIZE;
+	desc.height = GLYPH_PAGE_SIZE;
+	desc.depth = 1;
+	desc.mipLevels = 1;
+	desc.generateMips = false;
+	desc.tag = "TextDrawerGlyphs";
+	desc.initData.push_back(&data[0]);
+
+	// No partial updates in thin3d, so new glyphs mean a new texture.  That stops once the glyphs in use are cached.
+	if (page.texture)
+		page.texture->Release();
+	page.texture = draw_->CreateTexture(desc);
+	page.dirty = false;
+}
+
+bool TextDrawer::LayoutGlyphString(uint32_t fontHash, const std::string &str, std::vector<PlacedGlyph> &placed, std::vector<float> &lineWidths, float *lineHeight) {
+	std::vector<std::string> lines;
+	SplitString(str, '\n', lines);
+
+	*lineHeight = 0.0f;
+	for (size_t i = 0; i < lines.size(); ++i) {
+		float pen = 0.0f;
+		UTF8 utf(lines[i].c_str());
+		while (!utf.end()) {
+			const GlyphEntry *glyph = GetGlyph(fontHash, utf.next());
+			if (!glyph)
+				return false;
+			placed.push_back(PlacedGlyph{ glyph, (int)i, floorf(pen + 0.5f) });
+			pen += glyph->advance;
+			*lineHeight = std::max(*lineHeight, (float)glyph->height);
+		}
+		lineWidths.push_back(pen);
+	}
+
+	if (*lineHeight == 0.0f) {
+		// Only empty lines, use a space to get the height.
+		const GlyphEntry *glyph = GetGlyph(fontHash, ' ');
+		if (!glyph)
+			return false;
+		*lineHeight = (float)glyph->height;
+	}
+	return true;
+}
+
+bool TextDrawer::MeasureGlyphString(uint32_t fontHash, const char *str, size_t len, float *w, float *h) {
+	std::vector<PlacedGlyph> placed;
+	std::vector<float> lineWidths;
+	float lineHeight;
+	if (!LayoutGlyphString(fontHash, std::string(str, len), placed, lineWidths, &lineHeight))
+		return false;
+
+	float maxWidth = 0.0f;
+	for (float lineWidth : lineWidths)
+		maxWidth = std::max(maxWidth, lineWidth);
+	*w = ceilf(maxWidth) * fontScaleX_ * dpiScale_;
+	*h = lineHeight * lineWidths.size() * fontScaleY_ * dpiScale_;
+	return true;
+}
+
+bool TextDrawer::DrawGlyphString(DrawBuffer &target, uint32_t fontHash, const char *str, float x, float y, uint32_t color, int align) {
+	std::vector<PlacedGlyph> placed;
+	std::vector<float> lineWidths;
+	float lineHeight;
+	if (!LayoutGlyphString(fontHash, str, placed, lineWidths, &lineHeight))
+		return false;
+
+	float maxWidth = 0.0f;
+	for (float lineWidth : lineWidths)
+		maxWidth = std::max(maxWidth, lineWidth);
+
+	const float scaleX = fontScaleX_ * dpiScale_;
+	const float scaleY = fontScaleY_ * dpiScale_;
+	float w = ceilf(maxWidth) * scaleX;
+	float h = lineHeight * lineWidths.size() * scaleY;
+	DrawBuffer::DoAlign(align, &x, &y, &w, &h);
+
+	target.Flush(true);
+	// Usually just the one page, so draw page by page to keep binds down.
+	for (size_t p = 0; p < glyphPages_.size(); ++p) {
+		GlyphPage &page = glyphPages_[p];
+		if (page.lastUsedFrame != frameCount_)
+			continue;
+
+		bool bound = false;
+		for (const PlacedGlyph &g : placed) {
+			const GlyphEntry &glyph = *g.glyph;
+			if (glyph.page != (int)p)
+				continue;
+			if (!bound) {
+				if (page.dirty)
+					UploadGlyphPage(page);
+				if (!page.texture)
+					break;
+				draw_->BindTexture(0, page.texture);
+				bound = true;
+			}
+
+			float lineX = 0.0f;
+			if (align & ALIGN_HCENTER)
+				lineX = floorf((maxWidth - lineWidths[g.line]) * 0.5f);
+			else if (align & ALIGN_RIGHT)
+				lineX = floorf(maxWidth - lineWidths[g.line]);
+			const float gx = x + (lineX + g.x - glyph.originX) * scaleX;
+			const float gy = y + g.line * lineHeight * scaleY;
+			const float u1 = glyph.x / (float)GLYPH_PAGE_SIZE;
+			const float v1 = glyph.y / (float)GLYPH_PAGE_SIZE;
+			const float u2 = (glyph.x + glyph.width) / (float)GLYPH_PAGE_SIZE;
+			const float v2 = (glyph.y + glyph.height) / (float)GLYPH_PAGE_SIZE;
+			target.DrawTexRect(gx, gy, gx + glyph.width * scaleX, gy + glyph.height * scaleY, u1, v1, u2, v2, color);
+		}
+		if (bound)
+			target.Flush(true);
+	}
+	return true;
+}
+
+void TextDrawer::ClearGlyphAtlas() {
+	for (GlyphPage &page : glyphPages_) {
+		if (page.texture)
+			page.texture->Release();
+	}
+	glyphPages_.clear();
+	glyphs_.clear();
+}
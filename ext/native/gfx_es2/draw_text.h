@@ -3,8 +3,9 @@
 // Uses system fonts to draw text. 
 // Platform support will be added over time, initially just Win32.
 
-// Caches strings in individual textures. Might later combine them into a big one
-// with dynamically allocated space but too much trouble for now.
+// Caches strings in individual textures.  Where the platform can rasterize single glyphs,
+// strings that don't need shaping are instead composed from a shared atlas of cached glyphs,
+// so that changing text (timers, counters, scrolling lists) doesn't create a texture per string.
 
 #pragma once
 
@@ -12,6 +13,7 @@
 
 #include <map>
 #include <memory>
+#include <vector>
 
 #include "base/basictypes.h"
 #include "gfx_es2/draw_buffer.h"
@@ -86,10 +88,81 @@ class TextDrawer {
 		uint32_t fontHash;
 	};
 
+	// A single glyph, as the platform rasterized it.  The bitmap is a full line high, with the
+	// top of the line at the top.
+	struct GlyphBitmap {
+		int width;
+		int height;
+		// Where the pen position is within the bitmap, to leave room for overhangs.
+		int originX;
+		float advance;
+		std::vector<uint8_t> alpha;
+	};
+
+	// Platforms that can rasterize one glyph at a time (with the current font) implement this,
+	// and route strings that pass CanUseGlyphAtlas through the glyph functions below.
+	// The glyph functions return false if a glyph couldn't be had, then the string path should be used.
+	virtual bool RasterizeGlyph(uint32_t codepoint, GlyphBitmap *bitmap) { return false; }
+	bool CanUseGlyphAtlas(const char *str, size_t len) const;
+	bool MeasureGlyphString(uint32_t fontHash, const char *str, size_t len, float *w, float *h);
+	bool DrawGlyphString(DrawBuffer &target, uint32_t fontHash, const char *str, float x, float y, uint32_t color, int align);
+	void ClearGlyphAtlas();
+
 	int frameCount_;
 	float fontScaleX_;
 	float fontScaleY_;
 	float dpiScale_;
+
+private:
+	enum {
+		GLYPH_PAGE_SIZE = 512,
+		MAX_GLYPH_PAGES = 4,
+	};
+
+	struct GlyphKey {
+		bool operator < (const GlyphKey &other) const {
+			if (fontHash != other.fontHash)
+				return fontHash < other.fontHash;
+			return codepoint < other.codepoint;
+		}
+		uint32_t fontHash;
+		uint32_t codepoint;
+	};
+
+	struct GlyphEntry {
+		int page;
+		int x;
+		int y;
+		int width;
+		int height;
+		int originX;
+		float advance;
+	};
+
+	struct GlyphPage {
+		std::vector<uint8_t> alpha;
+		Draw::Texture *texture = nullptr;
+		bool dirty = false;
+		// Glyphs are packed into rows ("shelves") left to right, rows top to bottom.
+		int shelfX = 0;
+		int shelfY = 0;
+		int shelfHeight = 0;
+		int lastUsedFrame = 0;
+	};
+
+	struct PlacedGlyph {
+		const GlyphEntry *glyph;
+		int line;
+		float x;
+	};
+
+	const GlyphEntry *GetGlyph(uint32_t fontHash, uint32_t codepoint);
+	bool AllocateGlyph(int width, int height, GlyphEntry *entry);
+	void UploadGlyphPage(GlyphPage &page);
+	bool LayoutGlyphString(uint32_t fontHash, const std::string &str, std::vector<PlacedGlyph> &placed, std::vector<float> &lineWidths, float *lineHeight);
+
+	std::map<GlyphKey, GlyphEntry> glyphs_;
+	std::vector<GlyphPage> glyphPages_;
 };
 
 
@@ -23,6 +23,7 @@ TextDrawerAndroid::TextDrawerAndroid(Draw::DrawContext *draw) : TextDrawer(draw)
 	if (cls_textRenderer) {
 		method_measureText = env_->GetStaticMethodID(cls_textRenderer, "measureText", "(Ljava/lang/String;D)I");
 		method_renderText = env_->GetStaticMethodID(cls_textRenderer, "renderText", "(Ljava/lang/String;D)[I");
+		method_measureAdvance = env_->GetStaticMethodID(cls_textRenderer, "measureAdvance", "(Ljava/lang/String;D)F");
 	} else {
 		ELOG("Failed to find class: '%s'", textRendererClassName);
 	}
@@ -77,6 +78,9 @@ std::string TextDrawerAndroid::NormalizeString(std::string str) {
 }
 
 void TextDrawerAndroid::MeasureString(const char *str, size_t len, float *w, float *h) {
+	if (CanUseGlyphAtlas(str, len) && MeasureGlyphString(fontHash_, str, len, w, h))
+		return;
+
 	CacheKey key{ std::string(str, len), fontHash_ };
 	TextMeasureEntry *entry;
 	auto iter = sizeCache_.find(key);
@@ -120,6 +124,9 @@ void TextDrawerAndroid::MeasureStringRect(const char *str, size_t len, const Bou
 		WrapString(toMeasure, toMeasure.c_str(), rotated ? bounds.h : bounds.w);
 	}
 
+	if (CanUseGlyphAtlas(toMeasure.c_str(), toMeasure.size()) && MeasureGlyphString(fontHash_, toMeasure.c_str(), toMeasure.size(), w, h))
+		return;
+
 	std::vector<std::string> lines;
 	SplitString(toMeasure, '\n', lines);
 	float total_w = 0.0f;
@@ -160,6 +167,9 @@ void TextDrawerAndroid::DrawString(DrawBuffer &target, const char *str, float x,
 	if (text.empty())
 		return;
 
+	if (CanUseGlyphAtlas(text.c_str(), text.size()) && DrawGlyphString(target, fontHash_, text.c_str(), x, y, color, align))
+		return;
+
 	CacheKey key{ std::string(str), fontHash_ };
 	target.Flush(true);
 
@@ -245,6 +255,52 @@ void TextDrawerAndroid::ClearCache() {
 	}
 	cache_.clear();
 	sizeCache_.clear();
+	ClearGlyphAtlas();
+}
+
+bool TextDrawerAndroid::RasterizeGlyph(uint32_t codepoint, GlyphBitmap *bitmap) {
+	if (!method_measureAdvance)
+		return false;
+
+	double size = 0.0;
+	auto iter = fontMap_.find(fontHash_);
+	if (iter != fontMap_.end()) {
+		size = iter->second.size;
+	} else {
+		ELOG("Missing font");
+		return false;
+	}
+
+	char utf8[5]{};
+	UTF8::encode(utf8, codepoint);
+	jstring jstr = env_->NewStringUTF(utf8);
+	uint32_t textSize = env_->CallStaticIntMethod(cls_textRenderer, method_measureText, jstr, size);
+	float advance = env_->CallStaticFloatMethod(cls_textRenderer, method_measureAdvance, jstr, size);
+	jintArray imageData = (jintArray)env_->CallStaticObjectMethod(cls_textRenderer, method_renderText, jstr, size);
+	env_->DeleteLocalRef(jstr);
+
+	int imageWidth = (short)(textSize >> 16);
+	int imageHeight = (short)(textSize & 0xFFFF);
+	if (!imageData || env_->GetArrayLength(imageData) != imageWidth * imageHeight) {
+		if (imageData)
+			env_->DeleteLocalRef(imageData);
+		return false;
+	}
+
+	// TextRenderer draws at x = 1, with some padding on the right.
+	bitmap->width = imageWidth;
+	bitmap->height = imageHeight;
+	bitmap->originX = 1;
+	bitmap->advance = advance;
+	bitmap->alpha.resize(imageWidth * imageHeight);
+	jint *jimage = env_->GetIntArrayElements(imageData, nullptr);
+	for (int i = 0; i < imageWidth * imageHeight; i++) {
+		// Just grab the green channel, it's white on black.
+		bitmap->alpha[i] = (uint8_t)(jimage[i] >> 8);
+	}
+	env_->ReleaseIntArrayElements(imageData, jimage, 0);
+	env_->DeleteLocalRef(imageData);
+	return true;
 }
 
 void TextDrawerAndroid::DrawStringRect(DrawBuffer &target, const char *str, const Bounds &bounds, uint32_t color, int align) {
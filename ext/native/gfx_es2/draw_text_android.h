@@ -30,6 +30,7 @@ class TextDrawerAndroid : public TextDrawer {
 
 protected:
 	void ClearCache() override;
+	bool RasterizeGlyph(uint32_t codepoint, GlyphBitmap *bitmap) override;
 
 private:
 	std::string NormalizeString(std::string str);
@@ -39,6 +40,7 @@ class TextDrawerAndroid : public TextDrawer {
 	jclass cls_textRenderer;
 	jmethodID method_measureText;
 	jmethodID method_renderText;
+	jmethodID method_measureAdvance;
 
 	uint32_t fontHash_;
 
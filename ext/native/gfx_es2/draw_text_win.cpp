@@ -119,6 +119,9 @@ void TextDrawerWin32::SetFont(uint32_t fontHandle) {
 }
 
 void TextDrawerWin32::MeasureString(const char *str, size_t len, float *w, float *h) {
+	if (CanUseGlyphAtlas(str, len) && MeasureGlyphString(fontHash_, str, len, w, h))
+		return;
+
 	CacheKey key{ std::string(str, len), fontHash_ };
 	
 	TextMeasureEntry *entry;
@@ -158,6 +161,9 @@ void TextDrawerWin32::MeasureStringRect(const char *str, size_t len, const Bound
 		WrapString(toMeasure, toMeasure.c_str(), rotated ? bounds.h : bounds.w);
 	}
 
+	if (CanUseGlyphAtlas(toMeasure.c_str(), toMeasure.size()) && MeasureGlyphString(fontHash_, toMeasure.c_str(), toMeasure.size(), w, h))
+		return;
+
 	std::vector<std::string> lines;
 	SplitString(toMeasure, '\n', lines);
 	float total_w = 0.0f;
@@ -195,6 +201,9 @@ void TextDrawerWin32::DrawString(DrawBuffer &target, const char *str, float x, f
 	if (!strlen(str))
 		return;
 
+	if (CanUseGlyphAtlas(str, strlen(str)) && DrawGlyphString(target, fontHash_, str, x, y, color, align))
+		return;
+
 	CacheKey key{ std::string(str), fontHash_ };
 
 	target.Flush(true);
@@ -324,6 +333,48 @@ void TextDrawerWin32::DrawString(DrawBuffer &target, const char *str, float x, f
 	target.Flush(true);
 }
 
+bool TextDrawerWin32::RasterizeGlyph(uint32_t codepoint, GlyphBitmap *bitmap) {
+	// Only BMP codepoints get here, see CanUseGlyphAtlas.
+	if (codepoint >= 0x10000)
+		return false;
+
+	auto iter = fontMap_.find(fontHash_);
+	if (iter != fontMap_.end()) {
+		SelectObject(ctx_->hDC, iter->second->hFont);
+	}
+
+	WCHAR wch = (WCHAR)codepoint;
+	SIZE size;
+	if (!GetTextExtentPoint32W(ctx_->hDC, &wch, 1, &size))
+		return false;
+
+	// Some room on the sides for italics and the like that reach beyond the advance.
+	const int pad = 2;
+	bitmap->width = size.cx + pad * 2;
+	bitmap->height = size.cy;
+	bitmap->originX = pad;
+	bitmap->advance = (float)size.cx;
+	if (bitmap->width > MAX_TEXT_WIDTH || bitmap->height > MAX_TEXT_HEIGHT)
+		return false;
+
+	SetTextColor(ctx_->hDC, 0xFFFFFF);
+	SetBkColor(ctx_->hDC, 0);
+	SetTextAlign(ctx_->hDC, TA_TOP | TA_LEFT);
+
+	RECT rc = { 0, 0, bitmap->width, bitmap->height };
+	FillRect(ctx_->hDC, &rc, (HBRUSH)GetStockObject(BLACK_BRUSH));
+	ExtTextOutW(ctx_->hDC, pad, 0, 0, nullptr, &wch, 1, nullptr);
+	GdiFlush();
+
+	bitmap->alpha.resize(bitmap->width * bitmap->height);
+	for (int y = 0; y < bitmap->height; y++) {
+		for (int x = 0; x < bitmap->width; x++) {
+			bitmap->alpha[bitmap->width * y + x] = (uint8_t)(ctx_->pBitmapBits[MAX_TEXT_WIDTH * y + x] & 0xff);
+		}
+	}
+	return true;
+}
+
 void TextDrawerWin32::RecreateFonts() {
 	for (auto &iter : fontMap_) {
 		iter.second->dpiScale = dpiScale_;
@@ -338,6 +389,7 @@ void TextDrawerWin32::ClearCache() {
 	}
 	cache_.clear();
 	sizeCache_.clear();
+	ClearGlyphAtlas();
 }
 
 void TextDrawerWin32::DrawStringRect(DrawBuffer &target, const char *str, const Bounds &bounds, uint32_t color, int align) {
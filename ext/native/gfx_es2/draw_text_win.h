@@ -30,6 +30,7 @@ class TextDrawerWin32 : public TextDrawer {
 
 protected:
 	void ClearCache() override;
+	bool RasterizeGlyph(uint32_t codepoint, GlyphBitmap *bitmap) override;
 	void RecreateFonts();  // On DPI change
 
 	TextDrawerContext *ctx_;
@@ -139,6 +139,12 @@ GLboolean gl3stubInit() {
     FIND_PROC(glBufferStorageEXT);
 #endif
 
+#ifdef GL_EXT_disjoint_timer_query
+    /* EXT_disjoint_timer_query */
+    FIND_PROC(glQueryCounterEXT);
+    FIND_PROC(glGetQueryObjectui64vEXT);
+#endif
+
     /* OES_copy_image, etc. */
     FIND_PROC(glCopyImageSubDataOES);
 
@@ -372,6 +378,12 @@ GL_APICALL GLint          (* GL_APIENTRY glGetFragDataIndexEXT) (GLuint program,
 GL_APICALL void           (* GL_APIENTRY glBufferStorageEXT) (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
 #endif
 
+#ifdef GL_EXT_disjoint_timer_query
+/* EXT_disjoint_timer_query */
+GL_APICALL void           (* GL_APIENTRY glQueryCounterEXT) (GLuint id, GLenum target);
+GL_APICALL void           (* GL_APIENTRY glGetQueryObjectui64vEXT) (GLuint id, GLenum pname, GLuint64 *params);
+#endif
+
 /* OES_copy_image, etc. */
 GL_APICALL void           (* GL_APIENTRY glCopyImageSubDataOES) (GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ, GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ, GLsizei width, GLsizei height, GLsizei depth);
 
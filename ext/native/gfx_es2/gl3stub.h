@@ -511,6 +511,12 @@ extern GL_APICALL GLint          (* GL_APIENTRY glGetFragDataIndexEXT) (GLuint p
 extern GL_APICALL void           (* GL_APIENTRY glBufferStorageEXT) (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
 #endif
 
+#ifdef GL_EXT_disjoint_timer_query
+/* EXT_disjoint_timer_query */
+extern GL_APICALL void           (* GL_APIENTRY glQueryCounterEXT) (GLuint id, GLenum target);
+extern GL_APICALL void           (* GL_APIENTRY glGetQueryObjectui64vEXT) (GLuint id, GLenum pname, GLuint64 *params);
+#endif
+
 /* OES_copy_image, etc. */
 extern GL_APICALL void           (* GL_APIENTRY glCopyImageSubDataOES) (GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ, GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ, GLsizei width, GLsizei height, GLsizei depth);
 
@@ -65,6 +65,9 @@ struct GLExtensions {
 	bool ARB_draw_instanced;
 	bool ARB_buffer_storage;
 	bool ARB_cull_distance;
+	bool ARB_get_program_binary;
+	bool ARB_timer_query;
+	bool ARB_shader_stencil_export;
 
 	// EXT
 	bool EXT_swap_control_tear;
@@ -81,6 +84,7 @@ struct GLExtensions {
 	bool EXT_draw_instanced;
 	bool EXT_buffer_storage;
 	bool EXT_clip_cull_distance;
+	bool EXT_disjoint_timer_query;
 
 	// NV
 	bool NV_shader_framebuffer_fetch;
@@ -14,6 +14,7 @@
 #include <io.h>
 #endif
 
+#include <algorithm>
 #include <cmath>
 #include <stdio.h>
 #include <stdlib.h>
@@ -297,7 +298,7 @@ int Client::SendRequestWithData(const char *method, const char *resource, const
 		"%s %s HTTP/%s\r\n"
 		"Host: %s\r\n"
 		"User-Agent: %s\r\n"
-		"Connection: close\r\n"
+		"Connection: %s\r\n"
 		"%s"
 		"\r\n";
 
@@ -305,6 +306,7 @@ int Client::SendRequestWithData(const char *method, const char *resource, const
 		method, resource, httpVersion_,
 		host_.c_str(),
 		userAgent_,
+		keepAlive_ ? "keep-alive" : "close",
 		otherHeaders ? otherHeaders : "");
 	buffer.Append(data);
 	bool flushed = buffer.FlushSocket(sock(), dataTimeout_);
@@ -314,21 +316,43 @@ int Client::SendRequestWithData(const char *method, const char *resource, const
 	return 0;
 }
 
-int Client::ReadResponseHeaders(Buffer *readbuf, std::vector<std::string> &responseHeaders, float *progress) {
-	// Snarf all the data we can into RAM. A little unsafe but hey.
-	if (dataTimeout_ >= 0.0 && !fd_util::WaitUntilReady(sock(), dataTimeout_, false)) {
-		ELOG("HTTP headers timed out");
-		return -1;
-	}
-	if (readbuf->Read(sock(), 4096) < 0) {
-		ELOG("Failed to read HTTP headers :(");
-		return -1;
+// Reads until there's a full line in readbuf, since with keep-alive we can't wait for the server to close.
+static int ReadLineCRLF(uintptr_t sock, double timeout, Buffer *readbuf, std::string *line) {
+	while (true) {
+		int sz = readbuf->TakeLineCRLF(line);
+		if (sz >= 0)
+			return sz;
+		if (timeout >= 0.0 && !fd_util::WaitUntilReady(sock, timeout, false)) {
+			ELOG("HTTP headers timed out");
+			return -1;
+		}
+		if (readbuf->ReadSome(sock, 4096) <= 0) {
+			ELOG("Failed to read HTTP headers :(");
+			return -1;
+		}
 	}
+}
 
-	// Grab the first header line that contains the http code.
-
+int Client::ReadResponseHeaders(Buffer *readbuf, std::vector<std::string> &responseHeaders, float *progress) {
 	std::string line;
-	readbuf->TakeLineCRLF(&line);
+	if (keepAlive_) {
+		// readbuf may already hold this response, and the next one may follow it.
+		if (ReadLineCRLF(sock(), dataTimeout_, readbuf, &line) < 0)
+			return -1;
+	} else {
+		// Snarf all the data we can into RAM. A little unsafe but hey.
+		if (dataTimeout_ >= 0.0 && !fd_util::WaitUntilReady(sock(), dataTimeout_, false)) {
+			ELOG("HTTP headers timed out");
+			return -1;
+		}
+		if (readbuf->Read(sock(), 4096) < 0) {
+			ELOG("Failed to read HTTP headers :(");
+			return -1;
+		}
+
+		// Grab the first header line that contains the http code.
+		readbuf->TakeLineCRLF(&line);
+	}
 
 	int code;
 	size_t code_pos = line.find(' ');
@@ -342,10 +366,24 @@ int Client::ReadResponseHeaders(Buffer *readbuf, std::vector<std::string> &respo
 		return -1;
 	}
 
+	// HTTP/1.0 servers close unless they say otherwise, HTTP/1.1 servers only when they say so.
+	bool http10 = startsWith(line, "HTTP/1.0");
+	serverClosing_ = http10;
 	while (true) {
-		int sz = readbuf->TakeLineCRLF(&line);
+		int sz = keepAlive_ ? ReadLineCRLF(sock(), dataTimeout_, readbuf, &line) : readbuf->TakeLineCRLF(&line);
+		if (sz < 0 && keepAlive_)
+			return -1;
 		if (!sz)
 			break;
+		if (startsWithNoCase(line, "Connection:")) {
+			std::string value = line.substr(strlen("Connection:"));
+			std::transform(value.begin(), value.end(), value.begin(), tolower);
+			if (value.find("close") != value.npos) {
+				serverClosing_ = true;
+			} else if (http10 && value.find("keep-alive") != value.npos) {
+				serverClosing_ = false;
+			}
+		}
 		responseHeaders.push_back(line);
 	}
 
@@ -389,7 +427,17 @@ int Client::ReadResponseEntity(Buffer *readbuf, const std::vector<std::string> &
 		*progress = 0.1f;
 	}
 
-	if (!contentLength || !progress) {
+	if (keepAlive_) {
+		// The connection stays open, so we can only go by Content-Length.
+		if (chunked) {
+			ELOG("Chunked responses aren't supported with keep-alive");
+			return -1;
+		}
+		if (readbuf->size() < (size_t)contentLength && readbuf->Read(sock(), contentLength - readbuf->size()) != 0) {
+			ELOG("Connection closed before the end of the response");
+			return -1;
+		}
+	} else if (!contentLength || !progress) {
 		// No way to know how far along we are. Let's just not update the progress counter.
 		if (!readbuf->ReadAll(sock(), contentLength))
 			return -1;
@@ -400,7 +448,12 @@ int Client::ReadResponseEntity(Buffer *readbuf, const std::vector<std::string> &
 	}
 
 	// output now contains the rest of the reply. Dechunk it.
-	if (chunked) {
+	if (keepAlive_) {
+		// Anything after is the next response.
+		std::string entity;
+		readbuf->Take(contentLength, &entity);
+		output->Append(entity);
+	} else if (chunked) {
 		DeChunk(readbuf, output, contentLength, progress);
 	} else {
 		output->Append(*readbuf);
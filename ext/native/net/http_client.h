@@ -81,10 +81,22 @@ class Client : public net::Connection {
 		dataTimeout_ = t;
 	}
 
+	// Keeps the connection open between requests, so several can be sent before reading the responses.
+	// Responses are then read only up to their Content-Length, so keep readbuf around between them.
+	void SetKeepAlive(bool keepAlive) {
+		keepAlive_ = keepAlive;
+	}
+	// After ReadResponseHeaders, whether the server will close the connection after this response.
+	bool ServerClosing() const {
+		return serverClosing_;
+	}
+
 protected:
 	const char *userAgent_;
 	const char *httpVersion_;
 	double dataTimeout_ = -1.0;
+	bool keepAlive_ = false;
+	bool serverClosing_ = true;
 };
 
 // Not particularly efficient, but hey - it's a background download, that's pretty cool :P
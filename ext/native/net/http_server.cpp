@@ -19,6 +19,11 @@
 #include <netinet/in.h>       /*  struct sockaddr_in        */
 #include <arpa/inet.h>        /*  inet (3) funtions         */
 #include <unistd.h>           /*  misc. UNIX functions      */
+#include <errno.h>
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
 
 #define closesocket close
 
@@ -107,6 +112,40 @@ void Request::WriteHttpResponseHeader(const char *ver, int status, int64_t size,
 	buffer->Push("\r\n");
 }
 
+int64_t Request::SendFileRange(FILE *fp, int64_t offset, int64_t length) const {
+#if defined(__linux__)
+	// Older Android API levels only have a 32-bit off_t on 32-bit.
+	if (sizeof(off_t) < 8 && offset + length > 0x7FFFFFFF)
+		return -1;
+	if (!out_->Flush())
+		return 0;
+
+	int fileFd = fileno(fp);
+	off_t pos = (off_t)offset;
+	int64_t sent = 0;
+	while (sent < length) {
+		size_t chunk = (size_t)std::min(length - sent, (int64_t)0x40000000);
+		ssize_t result = sendfile(fd_, fileFd, &pos, chunk);
+		if (result < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN && fd_util::WaitUntilReady(fd_, 5.0, true))
+				continue;
+			// Some filesystems can't do this, so let the caller copy instead.
+			if (sent == 0 && (errno == EINVAL || errno == ENOSYS))
+				return -1;
+			break;
+		}
+		if (result == 0)
+			break;
+		sent += result;
+	}
+	return sent;
+#else
+	return -1;
+#endif
+}
+
 void Request::WritePartial() const {
   CHECK(fd_);
   out_->Flush();
@@ -1,6 +1,8 @@
 #ifndef _HTTP_SERVER_H
 #define _HTTP_SERVER_H
 
+#include <cstdint>
+#include <cstdio>
 #include <functional>
 #include <map>
 
@@ -52,6 +54,10 @@ class Request {
   // If size is negative, no Content-Length: line is written.
   void WriteHttpResponseHeader(const char *ver, int status, int64_t size = -1, const char *mimeType = nullptr, const char *otherHeaders = nullptr) const;
 
+  // Flushes Out(), then sends length bytes of fp from offset straight from the file, without copying them through us.
+  // Returns how many bytes were sent, or -1 if that's not supported and nothing was sent.
+  int64_t SendFileRange(FILE *fp, int64_t offset, int64_t length) const;
+
 private:
 	net::InputSink *in_;
 	net::OutputSink *out_;
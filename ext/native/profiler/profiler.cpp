@@ -1,6 +1,7 @@
 // Ultra-lightweight category profiler with history.
 
 #include <algorithm>
+#include <atomic>
 #include <mutex>
 #include <map>
 #include <string>
@@ -10,6 +11,7 @@
 
 #include "base/logging.h"
 #include "base/timeutil.h"
+#include "file/file_util.h"
 #include "gfx_es2/draw_buffer.h"
 #include "ppsspp_config.h"
 #include "profiler/profiler.h"
@@ -23,6 +25,7 @@
 #define MAX_THREADS 4     // Can be any number, represents concurrent threads calling the profiler.
 #endif
 #define HISTORY_SIZE 128 // Must be power of 2
+#define CAPTURE_SIZE 65536 // Events kept per thread while capturing, must be power of 2
 
 #ifndef _DEBUG
 // If the compiler can collapse identical strings, we don't even need the strcmp.
@@ -56,6 +59,29 @@ static std::mutex categoriesLock;
 static int threadIdAfterLast = 0;
 static std::mutex threadsLock;
 static CategoryFrame *history;
+
+enum class CaptureEventType : uint8_t {
+	ENTER,
+	LEAVE,
+	FRAME,
+};
+
+struct CaptureEvent {
+	double time;
+	int16_t category;
+	CaptureEventType type;
+};
+
+struct CaptureRing {
+	CaptureEvent events[CAPTURE_SIZE];
+	// Total written, wraps around events.  Atomic since threads past MAX_THREADS share the last ring.
+	std::atomic<uint32_t> count;
+};
+
+static std::atomic<bool> capturing{ false };
+static CaptureRing *captureRings;
+static double captureStart;
+static std::mutex captureLock;
 #if MAX_THREADS > 1
 thread_local int profilerThreadId = -1;
 #else
@@ -118,6 +144,15 @@ int internal_profiler_find_cat(const char *category_name, bool create_missing) {
 	return -1;
 }
 
+static void internal_profiler_capture(int thread_id, int category, CaptureEventType type, double now) {
+	CaptureRing &ring = captureRings[thread_id];
+	uint32_t pos = ring.count++;
+	CaptureEvent &ev = ring.events[pos & (CAPTURE_SIZE - 1)];
+	ev.time = now;
+	ev.category = (int16_t)category;
+	ev.type = type;
+}
+
 // Suspend, also used to prepare for leaving.
 static void internal_profiler_suspend(int thread_id, int category, double now) {
 	double diff = now - profiler.eventStart[thread_id][category];
@@ -149,6 +184,9 @@ int internal_profiler_enter(const char *category_name, int *out_thread_id) {
 	} else {
 		DLOG("profiler: recursive enter (%i - %s)", category, category_name);
 	}
+	if (capturing) {
+		internal_profiler_capture(thread_id, category, CaptureEventType::ENTER, real_time_now());
+	}
 
 	depth++;
 	profiler.parentCategory[thread_id][depth] = category;
@@ -170,6 +208,9 @@ void internal_profiler_leave(int thread_id, int category) {
 	}
 
 	double now = real_time_now();
+	if (capturing) {
+		internal_profiler_capture(thread_id, category, CaptureEventType::LEAVE, now);
+	}
 
 	depth--;
 	if (depth < 0) {
@@ -196,6 +237,9 @@ void internal_profiler_end_frame() {
 		FLOG("Can't be inside a profiler scope at end of frame!");
 	}
 	profiler.curFrameStart = real_time_now();
+	if (capturing) {
+		internal_profiler_capture(thread_id, -1, CaptureEventType::FRAME, profiler.curFrameStart);
+	}
 	profiler.historyPos++;
 	profiler.historyPos &= (HISTORY_SIZE - 1);
 	memset(&history[MAX_THREADS * profiler.historyPos], 0, sizeof(CategoryFrame) * MAX_THREADS);
@@ -268,3 +312,72 @@ void Profiler_GetHistory(int category, int thread, float *data, int count) {
 		data[i] = history[MAX_THREADS * x + thread].time_taken[category];
 	}
 }
+
+void Profiler_StartCapture() {
+	std::lock_guard<std::mutex> guard(captureLock);
+	if (!captureRings) {
+		captureRings = new CaptureRing[MAX_THREADS];
+	}
+	for (int i = 0; i < MAX_THREADS; i++) {
+		captureRings[i].count = 0;
+	}
+	captureStart = real_time_now();
+	capturing = true;
+}
+
+void Profiler_StopCapture() {
+	capturing = false;
+}
+
+bool Profiler_IsCapturing() {
+	return capturing;
+}
+
+bool Profiler_SaveCapture(const char *filename) {
+	std::lock_guard<std::mutex> guard(captureLock);
+	if (!captureRings)
+		return false;
+
+	FILE *fp = openCFile(filename, "wb");
+	if (!fp)
+		return false;
+
+	// Pause while reading, so the rings hold still.  Scopes left meanwhile are dropped below.
+	bool wasCapturing = capturing.exchange(false);
+
+	fprintf(fp, "{\"traceEvents\":[\n");
+	bool first = true;
+	int numThreads = std::min(threadIdAfterLast, MAX_THREADS);
+	for (int t = 0; t < numThreads; t++) {
+		fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Profiler thread %d\"}}", first ? "" : ",\n", t, t);
+		first = false;
+
+		const CaptureRing &ring = captureRings[t];
+		uint32_t count = ring.count;
+		uint32_t start = count > CAPTURE_SIZE ? count - CAPTURE_SIZE : 0;
+		// The oldest leaves may belong to enters that were overwritten, so skip unmatched ones.
+		int depth = 0;
+		for (uint32_t i = start; i < count; i++) {
+			const CaptureEvent &ev = ring.events[i & (CAPTURE_SIZE - 1)];
+			double ts = (ev.time - captureStart) * 1000000.0;
+			if (ev.type == CaptureEventType::FRAME) {
+				fprintf(fp, ",\n{\"name\":\"Frame\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%.1f}", t, ts);
+				continue;
+			}
+			if (ev.type == CaptureEventType::LEAVE) {
+				if (depth == 0)
+					continue;
+				depth--;
+			} else {
+				depth++;
+			}
+			fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%.1f}", Profiler_GetCategoryName(ev.category), ev.type == CaptureEventType::ENTER ? "B" : "E", t, ts);
+		}
+	}
+	fprintf(fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	bool success = ferror(fp) == 0;
+	fclose(fp);
+
+	capturing = wasCapturing;
+	return success;
+}
@@ -22,6 +22,14 @@ void Profiler_GetSlowestThreads(int *data, int count);
 void Profiler_GetSlowestHistory(int category, int *slowestThreads, float *data, int count);
 void Profiler_GetHistory(int category, int thread, float *data, int count);
 
+// Capture mode keeps every scope enter and leave, so nesting, threads and single slow frames can be seen.
+// Only the most recent events are kept, so a capture can be left running and saved right after a hitch.
+void Profiler_StartCapture();
+void Profiler_StopCapture();
+bool Profiler_IsCapturing();
+// Writes what's been captured as Chrome trace JSON, for chrome://tracing or ui.perfetto.dev.
+bool Profiler_SaveCapture(const char *filename);
+
 class ProfileThis {
 public:
 	ProfileThis(const char *category) {
@@ -1,4 +1,6 @@
 #include <algorithm>
+#include "ext/xxhash.h"
+#include "Common/FileUtil.h"
 #include "Common/MemoryUtil.h"
 #include "Core/Reporting.h"
 #include "GLQueueRunner.h"
@@ -6,6 +8,7 @@
 #include "DataFormatGL.h"
 #include "base/logging.h"
 #include "base/stringutil.h"
+#include "base/timeutil.h"
 #include "gfx/gl_common.h"
 #include "gfx/gl_debug_log.h"
 #include "gfx_es2/gpu_features.h"
@@ -199,7 +202,14 @@ void GLQueueRunner::RunInitSteps(const std::vector<GLRInitStep> &steps, bool ski
 				glBindFragDataLocationIndexedEXT(program->program, 0, 1, "fragColor1");
 			}
 #endif
-			glLinkProgram(program->program);
+			// A binary from an earlier run skips the link, which is where many drivers do the real compile.
+			uint64_t binaryKey = ProgramBinaryKey(step);
+			bool fromBinary = binaryKey != 0 && LinkProgramFromBinary(program->program, binaryKey);
+			if (!fromBinary) {
+				if (binaryKey != 0)
+					glProgramParameteri(program->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+				glLinkProgram(program->program);
+			}
 
 			GLint linkStatus = GL_FALSE;
 			glGetProgramiv(program->program, GL_LINK_STATUS, &linkStatus);
@@ -233,6 +243,9 @@ void GLQueueRunner::RunInitSteps(const std::vector<GLRInitStep> &steps, bool ski
 				break;
 			}
 
+			if (binaryKey != 0 && !fromBinary)
+				StoreProgramBinary(program->program, binaryKey);
+
 			glUseProgram(program->program);
 
 			// Query all the uniforms.
@@ -381,6 +394,151 @@ void GLQueueRunner::RunInitSteps(const std::vector<GLRInitStep> &steps, bool ski
 	}
 }
 
+static const uint32_t PROGRAM_BINARY_MAGIC = 0x42504C47;  // GLPB
+static const uint32_t PROGRAM_BINARY_VERSION = 1;
+
+struct ProgramBinaryHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t driverLength;
+	uint32_t count;
+};
+
+struct ProgramBinaryEntryHeader {
+	uint64_t key;
+	uint32_t format;
+	uint32_t size;
+};
+
+void GLQueueRunner::LoadProgramBinaries(const std::string &filename) {
+	std::lock_guard<std::mutex> guard(programBinaryLock_);
+	programBinariesEnabled_ = true;
+	programBinariesChecked_ = false;
+
+	FILE *f = File::OpenCFile(filename, "rb");
+	if (!f)
+		return;
+	ProgramBinaryHeader header;
+	bool valid = fread(&header, sizeof(header), 1, f) == 1 && header.magic == PROGRAM_BINARY_MAGIC && header.version == PROGRAM_BINARY_VERSION;
+	std::string driver(valid ? header.driverLength : 0, '\0');
+	valid = valid && fread(&driver[0], 1, driver.size(), f) == driver.size();
+	for (uint32_t i = 0; valid && i < header.count; ++i) {
+		ProgramBinaryEntryHeader entry;
+		if (fread(&entry, sizeof(entry), 1, f) != 1) {
+			valid = false;
+			break;
+		}
+		ProgramBinary &binary = programBinaries_[entry.key];
+		binary.format = entry.format;
+		binary.data.resize(entry.size);
+		valid = fread(binary.data.data(), 1, entry.size, f) == entry.size;
+	}
+	fclose(f);
+
+	if (!valid) {
+		WARN_LOG(G3D, "Program binary cache '%s' is damaged, ignoring", filename.c_str());
+		programBinaries_.clear();
+		return;
+	}
+	// Checked against the running driver on the GL thread, before the first use.
+	programBinaryDriver_ = driver;
+	INFO_LOG(G3D, "Loaded %d program binaries from '%s'", (int)programBinaries_.size(), filename.c_str());
+}
+
+void GLQueueRunner::SaveProgramBinaries(const std::string &filename) {
+	std::lock_guard<std::mutex> guard(programBinaryLock_);
+	if (!programBinariesDirty_ || programBinaryDriver_.empty())
+		return;
+
+	FILE *f = File::OpenCFile(filename, "wb");
+	if (!f)
+		return;
+	ProgramBinaryHeader header{ PROGRAM_BINARY_MAGIC, PROGRAM_BINARY_VERSION, (uint32_t)programBinaryDriver_.size(), (uint32_t)programBinaries_.size() };
+	fwrite(&header, sizeof(header), 1, f);
+	fwrite(programBinaryDriver_.data(), 1, programBinaryDriver_.size(), f);
+	for (const auto &iter : programBinaries_) {
+		ProgramBinaryEntryHeader entry{ iter.first, (uint32_t)iter.second.format, (uint32_t)iter.second.data.size() };
+		fwrite(&entry, sizeof(entry), 1, f);
+		fwrite(iter.second.data.data(), 1, iter.second.data.size(), f);
+	}
+	fclose(f);
+	programBinariesDirty_ = false;
+}
+
+uint64_t GLQueueRunner::ProgramBinaryKey(const GLRInitStep &step) {
+	std::lock_guard<std::mutex> guard(programBinaryLock_);
+	if (!programBinariesEnabled_)
+		return 0;
+
+	if (!programBinariesChecked_) {
+		programBinariesChecked_ = true;
+		GLint numFormats = 0;
+		if (gl_extensions.GLES3 || gl_extensions.ARB_get_program_binary)
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+		if (numFormats <= 0) {
+			programBinariesEnabled_ = false;
+			programBinaries_.clear();
+			return 0;
+		}
+
+		// Any driver update invalidates them, so the version string has to match exactly.
+		std::string driver = GetGLString(GL_VENDOR) + "|" + GetGLString(GL_RENDERER) + "|" + GetGLString(GL_VERSION);
+		if (driver != programBinaryDriver_) {
+			programBinaries_.clear();
+			programBinariesDirty_ = true;
+			programBinaryDriver_ = driver;
+		}
+	}
+
+	uint64_t key = step.create_program.support_dual_source ? 1 : 0;
+	for (int i = 0; i < step.create_program.num_shaders; i++) {
+		const std::string &code = step.create_program.shaders[i]->code;
+		key = XXH64(code.data(), code.size(), key);
+	}
+	for (auto iter : step.create_program.program->semantics_) {
+		key = XXH64(iter.attrib, strlen(iter.attrib), key ^ iter.location);
+	}
+	// Zero means no binary, so just nudge it.
+	return key == 0 ? 1 : key;
+}
+
+bool GLQueueRunner::LinkProgramFromBinary(GLuint program, uint64_t key) {
+	std::lock_guard<std::mutex> guard(programBinaryLock_);
+	auto iter = programBinaries_.find(key);
+	if (iter == programBinaries_.end())
+		return false;
+
+	glProgramBinary(program, iter->second.format, iter->second.data.data(), (GLsizei)iter->second.data.size());
+	GLint linkStatus = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+	if (linkStatus != GL_TRUE) {
+		// The driver rejected it, so link normally and store a fresh one.
+		programBinaries_.erase(iter);
+		programBinariesDirty_ = true;
+		return false;
+	}
+	return true;
+}
+
+void GLQueueRunner::StoreProgramBinary(GLuint program, uint64_t key) {
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	ProgramBinary binary;
+	binary.data.resize(length);
+	GLsizei written = 0;
+	glGetProgramBinary(program, length, &written, &binary.format, binary.data.data());
+	if (written <= 0)
+		return;
+	binary.data.resize(written);
+
+	std::lock_guard<std::mutex> guard(programBinaryLock_);
+	programBinaries_[key] = std::move(binary);
+	programBinariesDirty_ = true;
+}
+
 void GLQueueRunner::InitCreateFramebuffer(const GLRInitStep &step) {
 	GLRFramebuffer *fbo = step.create_framebuffer.framebuffer;
 
@@ -551,7 +709,7 @@ void GLQueueRunner::InitCreateFramebuffer(const GLRInitStep &step) {
 	currentReadHandle_ = fbo->handle;
 }
 
-void GLQueueRunner::RunSteps(const std::vector<GLRStep *> &steps, bool skipGLCalls) {
+void GLQueueRunner::RunSteps(const std::vector<GLRStep *> &steps, bool skipGLCalls, GLQueueProfileContext *profile) {
 	if (skipGLCalls) {
 		// Dry run
 		for (size_t i = 0; i < steps.size(); i++) {
@@ -601,8 +759,14 @@ void GLQueueRunner::RunSteps(const std::vector<GLRStep *> &steps, bool skipGLCal
 			Crash();
 			break;
 		}
+		if (profile && profile->timestampDescriptions.size() < MAX_GL_TIMESTAMP_QUERIES) {
+			WriteTimestamp(profile->queries[profile->timestampDescriptions.size()]);
+			profile->timestampDescriptions.push_back(StepToString(step));
+		}
 		delete steps[i];
 	}
+	if (profile)
+		profile->cpuEndTime = real_time_now();
 	CHECK_GL_ERROR_IF_DEBUG();
 }
 
@@ -610,6 +774,104 @@ void GLQueueRunner::LogSteps(const std::vector<GLRStep *> &steps) {
 
 }
 
+std::string GLQueueRunner::StepToString(const GLRStep &step) const {
+	char buffer[256];
+	switch (step.stepType) {
+	case GLRStepType::RENDER:
+	{
+		int w = step.render.framebuffer ? step.render.framebuffer->width : targetWidth_;
+		int h = step.render.framebuffer ? step.render.framebuffer->height : targetHeight_;
+		snprintf(buffer, sizeof(buffer), "RenderPass (draws: %d, %dx%d, fb: %p)", step.render.numDraws, w, h, step.render.framebuffer);
+		break;
+	}
+	case GLRStepType::COPY:
+		snprintf(buffer, sizeof(buffer), "Copy (%dx%d)", step.copy.srcRect.w, step.copy.srcRect.h);
+		break;
+	case GLRStepType::BLIT:
+		snprintf(buffer, sizeof(buffer), "Blit (%dx%d->%dx%d)", step.blit.srcRect.w, step.blit.srcRect.h, step.blit.dstRect.w, step.blit.dstRect.h);
+		break;
+	case GLRStepType::READBACK:
+		snprintf(buffer, sizeof(buffer), "Readback (%dx%d, fb: %p)", step.readback.srcRect.w, step.readback.srcRect.h, step.readback.src);
+		break;
+	case GLRStepType::READBACK_IMAGE:
+		snprintf(buffer, sizeof(buffer), "ReadbackImage (%dx%d)", step.readback_image.srcRect.w, step.readback_image.srcRect.h);
+		break;
+	default:
+		buffer[0] = 0;
+		break;
+	}
+	return std::string(buffer);
+}
+
+bool GLQueueRunner::SupportsTimestamps() const {
+#if !defined(USING_GLES2)
+	return gl_extensions.ARB_timer_query;
+#elif defined(GL_EXT_disjoint_timer_query) && !defined(IOS)
+	return gl_extensions.GLES3 && gl_extensions.EXT_disjoint_timer_query;
+#else
+	return false;
+#endif
+}
+
+void GLQueueRunner::WriteTimestamp(GLuint query) {
+#if !defined(USING_GLES2)
+	glQueryCounter(query, GL_TIMESTAMP);
+#elif defined(GL_EXT_disjoint_timer_query) && !defined(IOS)
+	glQueryCounterEXT(query, GL_TIMESTAMP_EXT);
+#endif
+}
+
+bool GLQueueRunner::BeginProfile(GLQueueProfileContext *profile, Draw::GPUProfile *results) {
+	bool gotResults = false;
+	int numQueries = (int)profile->timestampDescriptions.size();
+	if (profile->queries[0] == 0) {
+		glGenQueries(MAX_GL_TIMESTAMP_QUERIES, profile->queries);
+	} else if (numQueries > 1) {
+		GLuint available = 0;
+		glGetQueryObjectuiv(profile->queries[numQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		GLint disjoint = 0;
+#if defined(USING_GLES2) && defined(GL_EXT_disjoint_timer_query) && !defined(IOS)
+		// Also resets the flag. If anything happened to the clock meanwhile, the numbers are garbage.
+		glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+#endif
+		// If the GPU is still behind, just skip this one rather than wait on it.
+		if (available && !disjoint) {
+			uint64_t timestamps[MAX_GL_TIMESTAMP_QUERIES];
+			for (int i = 0; i < numQueries; i++) {
+#if !defined(USING_GLES2)
+				glGetQueryObjectui64v(profile->queries[i], GL_QUERY_RESULT, (GLuint64 *)&timestamps[i]);
+#elif defined(GL_EXT_disjoint_timer_query) && !defined(IOS)
+				glGetQueryObjectui64vEXT(profile->queries[i], GL_QUERY_RESULT, (GLuint64 *)&timestamps[i]);
+#endif
+			}
+			// Timestamps are in nanoseconds.
+			results->gpuMilliseconds = (double)(timestamps[numQueries - 1] - timestamps[0]) * 1e-6;
+			results->cpuMilliseconds = (profile->cpuEndTime - profile->cpuStartTime) * 1000.0;
+			results->steps.clear();
+			for (int i = 1; i < numQueries; i++) {
+				results->steps.push_back({ profile->timestampDescriptions[i], (double)(timestamps[i] - timestamps[i - 1]) * 1e-6 });
+			}
+			gotResults = true;
+		}
+	}
+
+	profile->timestampDescriptions.clear();
+	profile->cpuStartTime = real_time_now();
+	profile->cpuEndTime = profile->cpuStartTime;
+	WriteTimestamp(profile->queries[0]);
+	profile->timestampDescriptions.push_back("Begin");
+	CHECK_GL_ERROR_IF_DEBUG();
+	return gotResults;
+}
+
+void GLQueueRunner::DestroyProfile(GLQueueProfileContext *profile) {
+	if (profile->queries[0] != 0) {
+		glDeleteQueries(MAX_GL_TIMESTAMP_QUERIES, profile->queries);
+		std::fill(profile->queries, profile->queries + MAX_GL_TIMESTAMP_QUERIES, 0);
+	}
+	profile->timestampDescriptions.clear();
+}
+
 
 void GLQueueRunner::PerformBlit(const GLRStep &step) {
 	CHECK_GL_ERROR_IF_DEBUG();
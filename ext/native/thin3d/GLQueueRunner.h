@@ -1,11 +1,14 @@
 #pragma once
 
 #include <cstdint>
+#include <mutex>
+#include <string>
 #include <vector>
 #include <unordered_map>
 
 #include "gfx/gl_common.h"
 #include "thin3d/DataFormat.h"
+#include "thin3d/thin3d.h"
 
 struct GLRViewport {
 	float x, y, w, h, minZ, maxZ;
@@ -329,15 +332,35 @@ struct GLRStep {
 	};
 };
 
+enum {
+	MAX_GL_TIMESTAMP_QUERIES = 128,
+};
+
+// Timestamp queries for one frame slot. Read back when the slot comes around again, so we never wait on the GPU.
+struct GLQueueProfileContext {
+	GLuint queries[MAX_GL_TIMESTAMP_QUERIES]{};
+	std::vector<std::string> timestampDescriptions;
+	double cpuStartTime;
+	double cpuEndTime;
+};
+
 class GLQueueRunner {
 public:
 	GLQueueRunner() {}
 
 	void RunInitSteps(const std::vector<GLRInitStep> &steps, bool skipGLCalls);
 
-	void RunSteps(const std::vector<GLRStep *> &steps, bool skipGLCalls);
+	void RunSteps(const std::vector<GLRStep *> &steps, bool skipGLCalls, GLQueueProfileContext *profile);
 	void LogSteps(const std::vector<GLRStep *> &steps);
 
+	std::string StepToString(const GLRStep &step) const;
+
+	// Timestamp queries need GL 3.3 / ARB_timer_query, or ES 3.0 with EXT_disjoint_timer_query.
+	bool SupportsTimestamps() const;
+	// Collects the previous results of the slot, if the GPU has them ready, and writes the start timestamp.
+	bool BeginProfile(GLQueueProfileContext *profile, Draw::GPUProfile *results);
+	void DestroyProfile(GLQueueProfileContext *profile);
+
 	void CreateDeviceObjects();
 	void DestroyDeviceObjects();
 
@@ -361,6 +384,11 @@ class GLQueueRunner {
 		return it != glStrings_.end() ? it->second : "";
 	}
 
+	// Linked program binaries, so programs can skip linking next run.  Can be called from any thread.
+	// Loading also turns on capturing the binaries of newly linked programs.
+	void LoadProgramBinaries(const std::string &filename);
+	void SaveProgramBinaries(const std::string &filename);
+
 private:
 	void InitCreateFramebuffer(const GLRInitStep &step);
 
@@ -379,6 +407,12 @@ class GLQueueRunner {
 
 	void ResizeReadbackBuffer(size_t requiredSize);
 
+	void WriteTimestamp(GLuint query);
+
+	uint64_t ProgramBinaryKey(const GLRInitStep &step);
+	bool LinkProgramFromBinary(GLuint program, uint64_t key);
+	void StoreProgramBinary(GLuint program, uint64_t key);
+
 	void fbo_ext_create(const GLRInitStep &step);
 	void fbo_bind_fb_target(bool read, GLuint name);
 	GLenum fbo_get_fb_target(bool read, GLuint **cached);
@@ -413,4 +447,16 @@ class GLQueueRunner {
 	std::unordered_map<int, std::string> glStrings_;
 
 	bool sawOutOfMemory_ = false;
+
+	struct ProgramBinary {
+		GLenum format;
+		std::vector<uint8_t> data;
+	};
+	std::mutex programBinaryLock_;
+	std::unordered_map<uint64_t, ProgramBinary> programBinaries_;
+	// The driver the loaded binaries came from.  They're useless with any other.
+	std::string programBinaryDriver_;
+	bool programBinariesEnabled_ = false;
+	bool programBinariesChecked_ = false;
+	bool programBinariesDirty_ = false;
 };
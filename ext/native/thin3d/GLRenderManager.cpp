@@ -6,6 +6,7 @@
 #include "thread/threadutil.h"
 #include "base/logging.h"
 #include "GPU/GPUState.h"
+#include "Common/MemoryUsage.h"
 #include "Common/MemoryUtil.h"
 
 #if 0 // def _DEBUG
@@ -94,6 +95,7 @@ void GLRenderManager::ThreadStart(Draw::DrawContext *draw) {
 	queueRunner_.CreateDeviceObjects();
 	threadFrame_ = threadInitFrame_;
 	renderThreadId = std::this_thread::get_id();
+	timestampsSupported_ = queueRunner_.SupportsTimestamps();
 
 	// Don't save draw, we don't want any thread safety confusion.
 	bool mapBuffers = draw->GetBugs().Has(Draw::Bugs::ANY_MAP_BUFFER_RANGE_SLOW);
@@ -106,7 +108,16 @@ void GLRenderManager::ThreadStart(Draw::DrawContext *draw) {
 	// Notes on buffer mapping:
 	// NVIDIA GTX 9xx / 2017-10 drivers - mapping improves speed, basic unmap seems best.
 	// PowerVR GX6xxx / iOS 10.3 - mapping has little improvement, explicit flush is slower.
-	if (mapBuffers) {
+	// With buffer storage, we can skip both the copies and the per-frame map/unmap entirely.
+	// Not on Qualcomm, though, see the note about task switching below.
+#ifndef IOS
+	bool persistent = hasBufferStorage && gl_extensions.gpuVendor != GPU_VENDOR_QUALCOMM;
+#else
+	bool persistent = false;
+#endif
+	if (persistent) {
+		bufferStrategy_ = GLBufferStrategy::PERSISTENT_COHERENT;
+	} else if (mapBuffers) {
 		switch (gl_extensions.gpuVendor) {
 		case GPU_VENDOR_NVIDIA:
 			bufferStrategy_ = GLBufferStrategy::FRAME_UNMAP;
@@ -134,11 +145,14 @@ void GLRenderManager::ThreadEnd() {
 
 	// Wait for any shutdown to complete in StopThread().
 	std::unique_lock<std::mutex> lock(mutex_);
+	ReleasePendingFrame();
 	queueRunner_.DestroyDeviceObjects();
 	VLOG("PULL: Quitting");
 
 	// Good point to run all the deleters to get rid of leftover objects.
 	for (int i = 0; i < MAX_INFLIGHT_FRAMES; i++) {
+		if (!skipGLCalls_)
+			queueRunner_.DestroyProfile(&frameData_[i].profile);
 		// Since we're in shutdown, we should skip the GL calls on Android.
 		frameData_[i].deleter.Perform(this, skipGLCalls_);
 		frameData_[i].deleter_prev.Perform(this, skipGLCalls_);
@@ -159,25 +173,29 @@ void GLRenderManager::ThreadEnd() {
 
 bool GLRenderManager::ThreadFrame() {
 	std::unique_lock<std::mutex> lock(mutex_);
-	if (!run_)
+	if (!run_) {
+		// Don't leave StopThread() waiting on a held back frame.
+		ReleasePendingFrame();
 		return false;
+	}
 
 	// In case of syncs or other partial completion, we keep going until we complete a frame.
 	do {
 		if (nextFrame) {
 			threadFrame_++;
-			if (threadFrame_ >= MAX_INFLIGHT_FRAMES)
+			if (threadFrame_ >= inflightFrames_)
 				threadFrame_ = 0;
 		}
 		FrameData &frameData = frameData_[threadFrame_];
 		{
-			std::unique_lock<std::mutex> lock(frameData.pull_mutex);
+			std::unique_lock<ProfiledMutex> lock(frameData.pull_mutex);
 			while (!frameData.readyForRun && run_) {
 				VLOG("PULL: Waiting for frame[%d].readyForRun", threadFrame_);
 				frameData.pull_condVar.wait(lock);
 			}
 			if (!frameData.readyForRun && !run_) {
 				// This means we're out of frames to render and run_ is false, so bail.
+				ReleasePendingFrame();
 				return false;
 			}
 			VLOG("PULL: Setting frame[%d].readyForRun = false", threadFrame_);
@@ -210,11 +228,11 @@ void GLRenderManager::StopThread() {
 		for (int i = 0; i < MAX_INFLIGHT_FRAMES; i++) {
 			auto &frameData = frameData_[i];
 			{
-				std::unique_lock<std::mutex> lock(frameData.push_mutex);
+				std::unique_lock<ProfiledMutex> lock(frameData.push_mutex);
 				frameData.push_condVar.notify_all();
 			}
 			{
-				std::unique_lock<std::mutex> lock(frameData.pull_mutex);
+				std::unique_lock<ProfiledMutex> lock(frameData.pull_mutex);
 				frameData.pull_condVar.notify_all();
 			}
 		}
@@ -232,7 +250,7 @@ void GLRenderManager::StopThread() {
 		// when we restart...
 		for (int i = 0; i < MAX_INFLIGHT_FRAMES; i++) {
 			auto &frameData = frameData_[i];
-			std::unique_lock<std::mutex> lock(frameData.push_mutex);
+			std::unique_lock<ProfiledMutex> lock(frameData.push_mutex);
 			if (frameData.readyForRun || frameData.steps.size() != 0) {
 				Crash();
 			}
@@ -392,7 +410,7 @@ void GLRenderManager::CopyImageToMemorySync(GLRTexture *texture, int mipLevel, i
 	queueRunner_.CopyReadbackBuffer(w, h, Draw::DataFormat::R8G8B8A8_UNORM, destFormat, pixelStride, pixels);
 }
 
-void GLRenderManager::BeginFrame() {
+void GLRenderManager::BeginFrame(bool enableProfiling) {
 	VLOG("BeginFrame");
 
 #ifdef _DEBUG
@@ -404,7 +422,7 @@ void GLRenderManager::BeginFrame() {
 
 	// Make sure the very last command buffer from the frame before the previous has been fully executed.
 	{
-		std::unique_lock<std::mutex> lock(frameData.push_mutex);
+		std::unique_lock<ProfiledMutex> lock(frameData.push_mutex);
 		while (!frameData.readyForFence) {
 			VLOG("PUSH: Waiting for frame[%d].readyForFence = 1", curFrame);
 			frameData.push_condVar.wait(lock);
@@ -412,6 +430,7 @@ void GLRenderManager::BeginFrame() {
 		frameData.readyForFence = false;
 		frameData.readyForSubmit = true;
 	}
+	frameData.profilingEnabled_ = enableProfiling && timestampsSupported_;
 
 	VLOG("PUSH: Fencing %d", curFrame);
 
@@ -434,7 +453,7 @@ void GLRenderManager::Finish() {
 	int curFrame = GetCurFrame();
 	FrameData &frameData = frameData_[curFrame];
 	{
-		std::unique_lock<std::mutex> lock(frameData.pull_mutex);
+		std::unique_lock<ProfiledMutex> lock(frameData.pull_mutex);
 		VLOG("PUSH: Frame[%d].readyForRun = true, notifying pull", curFrame);
 		frameData.steps = std::move(steps_);
 		steps_.clear();
@@ -442,6 +461,7 @@ void GLRenderManager::Finish() {
 		initSteps_.clear();
 		frameData.readyForRun = true;
 		frameData.type = GLRRunType::END;
+		frameData.serial = frameSerial_++;
 		frameData_[curFrame_].deleter.Take(deleter_);
 	}
 
@@ -449,7 +469,7 @@ void GLRenderManager::Finish() {
 	frameData.pull_condVar.notify_all();
 
 	curFrame_++;
-	if (curFrame_ >= MAX_INFLIGHT_FRAMES)
+	if (curFrame_ >= inflightFrames_)
 		curFrame_ = 0;
 
 	insideFrame_ = false;
@@ -459,6 +479,15 @@ void GLRenderManager::BeginSubmitFrame(int frame) {
 	FrameData &frameData = frameData_[frame];
 	if (!frameData.hasBegun) {
 		frameData.hasBegun = true;
+
+		if (frameData.profilingEnabled_ && !skipGLCalls_) {
+			Draw::GPUProfile results;
+			if (queueRunner_.BeginProfile(&frameData.profile, &results)) {
+				std::lock_guard<std::mutex> guard(profileMutex_);
+				lastProfile_ = std::move(results);
+				hasProfile_ = true;
+			}
+		}
 	}
 }
 
@@ -471,9 +500,17 @@ void GLRenderManager::Submit(int frame, bool triggerFence) {
 	// When !triggerFence, we notify after syncing with Vulkan.
 
 	if (triggerFence) {
+		// The previous frame has had a whole frame's worth of time to finish on the GPU.
+		ReleasePendingFrame();
+		if (frameData.fence) {
+			// Its push buffers are still mapped and may be read, so hold it back until the next frame.
+			pendingFrame_ = frame;
+			return;
+		}
+
 		VLOG("PULL: Frame %d.readyForFence = true", frame);
 
-		std::unique_lock<std::mutex> lock(frameData.push_mutex);
+		std::unique_lock<ProfiledMutex> lock(frameData.push_mutex);
 		assert(frameData.readyForSubmit);
 		frameData.readyForFence = true;
 		frameData.readyForSubmit = false;
@@ -481,6 +518,34 @@ void GLRenderManager::Submit(int frame, bool triggerFence) {
 	}
 }
 
+// Render thread
+void GLRenderManager::ReleasePendingFrame() {
+	if (pendingFrame_ < 0)
+		return;
+
+	FrameData &frameData = frameData_[pendingFrame_];
+	if (frameData.fence) {
+		if (!skipGLCalls_) {
+			// Normally this has long passed, so the timeout (one second) is just a safety net.
+			GLenum res = glClientWaitSync(frameData.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ULL);
+			if (res == GL_TIMEOUT_EXPIRED) {
+				WLOG("Timed out waiting for frame %d", pendingFrame_);
+			}
+			glDeleteSync(frameData.fence);
+		}
+		frameData.fence = nullptr;
+	}
+
+	VLOG("PULL: Frame %d.readyForFence = true (released)", pendingFrame_);
+	pendingFrame_ = -1;
+
+	std::unique_lock<ProfiledMutex> lock(frameData.push_mutex);
+	assert(frameData.readyForSubmit);
+	frameData.readyForFence = true;
+	frameData.readyForSubmit = false;
+	frameData.push_condVar.notify_all();
+}
+
 // Render thread
 void GLRenderManager::EndSubmitFrame(int frame) {
 	FrameData &frameData = frameData_[frame];
@@ -488,6 +553,7 @@ void GLRenderManager::EndSubmitFrame(int frame) {
 
 	Submit(frame, true);
 
+	bool presented = !frameData.skipSwap;
 	if (!frameData.skipSwap) {
 		if (swapIntervalChanged_) {
 			swapIntervalChanged_ = false;
@@ -501,6 +567,9 @@ void GLRenderManager::EndSubmitFrame(int frame) {
 	} else {
 		frameData.skipSwap = false;
 	}
+
+	if (presentCallback_)
+		presentCallback_(frameData.serial, presented);
 }
 
 // Render thread
@@ -523,9 +592,14 @@ void GLRenderManager::Run(int frame) {
 		}
 	}
 
-	queueRunner_.RunSteps(stepsOnThread, skipGLCalls_);
+	queueRunner_.RunSteps(stepsOnThread, skipGLCalls_, frameData.profilingEnabled_ ? &frameData.profile : nullptr);
 	stepsOnThread.clear();
 
+	// The emu thread will write to this frame's mapped buffers again once it's released.
+	if (!skipGLCalls_ && frameData.type == GLRRunType::END && bufferStrategy_ == GLBufferStrategy::PERSISTENT_COHERENT) {
+		frameData.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
 	if (!skipGLCalls_) {
 		for (auto iter : frameData.activePushBuffers) {
 			iter->MapDevice(bufferStrategy_);
@@ -553,7 +627,7 @@ void GLRenderManager::FlushSync() {
 	int curFrame = curFrame_;
 	FrameData &frameData = frameData_[curFrame];
 	{
-		std::unique_lock<std::mutex> lock(frameData.pull_mutex);
+		std::unique_lock<ProfiledMutex> lock(frameData.pull_mutex);
 		VLOG("PUSH: Frame[%d].readyForRun = true (sync)", curFrame);
 		frameData.initSteps = std::move(initSteps_);
 		initSteps_.clear();
@@ -565,7 +639,7 @@ void GLRenderManager::FlushSync() {
 		frameData.pull_condVar.notify_all();
 	}
 	{
-		std::unique_lock<std::mutex> lock(frameData.push_mutex);
+		std::unique_lock<ProfiledMutex> lock(frameData.push_mutex);
 		// Wait for the flush to be hit, since we're syncing.
 		while (!frameData.readyForFence) {
 			VLOG("PUSH: Waiting for frame[%d].readyForFence = 1 (sync)", curFrame);
@@ -590,7 +664,7 @@ void GLRenderManager::EndSyncFrame(int frame) {
 	// No need to switch to the next frame number.
 
 	{
-		std::unique_lock<std::mutex> lock(frameData.push_mutex);
+		std::unique_lock<ProfiledMutex> lock(frameData.push_mutex);
 		frameData.readyForFence = true;
 		frameData.readyForSubmit = true;
 		frameData.push_condVar.notify_all();
@@ -610,7 +684,7 @@ void GLRenderManager::WaitUntilQueueIdle() {
 	for (int i = 0; i < MAX_INFLIGHT_FRAMES; i++) {
 		FrameData &frameData = frameData_[i];
 
-		std::unique_lock<std::mutex> lock(frameData.push_mutex);
+		std::unique_lock<ProfiledMutex> lock(frameData.push_mutex);
 		// Ignore unsubmitted frames.
 		while (!frameData.readyForFence && frameData.readyForRun) {
 			VLOG("PUSH: Waiting for frame[%d].readyForFence = 1 (wait idle)", i);
@@ -694,6 +768,8 @@ bool GLPushBuffer::AddBuffer() {
 	if (!info.localMemory)
 		return false;
 	info.buffer = render_->CreateBuffer(target_, size_, GL_DYNAMIC_DRAW);
+	info.size = size_;
+	MemoryUsage::Add(MemoryUsage::Category::PUSH_BUFFERS, info.size);
 	buf_ = buffers_.size();
 	buffers_.push_back(info);
 	return true;
@@ -712,6 +788,7 @@ void GLPushBuffer::Destroy(bool onRenderThread) {
 		}
 
 		FreeAlignedMemory(info.localMemory);
+		MemoryUsage::Sub(MemoryUsage::Category::PUSH_BUFFERS, info.size);
 	}
 	buffers_.clear();
 	buf_ = -1;
@@ -809,6 +886,9 @@ void GLPushBuffer::MapDevice(GLBufferStrategy strategy) {
 
 void GLPushBuffer::UnmapDevice() {
 	_dbg_assert_msg_(G3D, OnRenderThread(), "UnmapDevice must run on render thread");
+	// Persistent mappings are fine to draw from, and stay until the buffer is deleted.
+	if ((strategy_ & GLBufferStrategy::MASK_PERSISTENT) != 0)
+		return;
 
 	for (auto &info : buffers_) {
 		if (info.deviceMemory) {
@@ -829,6 +909,13 @@ void *GLRBuffer::Map(GLBufferStrategy strategy) {
 	if ((strategy & GLBufferStrategy::MASK_INVALIDATE) != 0) {
 		access |= GL_MAP_INVALIDATE_BUFFER_BIT;
 	}
+	if ((strategy & GLBufferStrategy::MASK_PERSISTENT) != 0) {
+#ifdef USING_GLES2
+		access |= GL_MAP_PERSISTENT_BIT_EXT | GL_MAP_COHERENT_BIT_EXT;
+#else
+		access |= GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+#endif
+	}
 
 	void *p = nullptr;
 	bool allowNativeBuffer = strategy != GLBufferStrategy::SUBDATA;
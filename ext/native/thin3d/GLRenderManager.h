@@ -13,6 +13,7 @@
 #include "base/logging.h"
 #include "gfx/gl_common.h"
 #include "math/dataconv.h"
+#include "thread/profiledmutex.h"
 #include "Common/Log.h"
 #include "GLQueueRunner.h"
 
@@ -144,6 +145,7 @@ enum class GLBufferStrategy {
 
 	MASK_FLUSH = 0x10,
 	MASK_INVALIDATE = 0x20,
+	MASK_PERSISTENT = 0x40,
 
 	// Map/unmap the buffer each frame.
 	FRAME_UNMAP = 1,
@@ -153,6 +155,8 @@ enum class GLBufferStrategy {
 	FLUSH_UNMAP = MASK_FLUSH,
 	// Map/unmap, invalidate on map, and explicit flush.
 	FLUSH_INVALIDATE_UNMAP = MASK_FLUSH | MASK_INVALIDATE,
+	// Map once with coherent buffer storage and never unmap. Reuse is guarded by fences.
+	PERSISTENT_COHERENT = MASK_PERSISTENT,
 };
 
 static inline int operator &(const GLBufferStrategy &lhs, const GLBufferStrategy &rhs) {
@@ -189,8 +193,8 @@ class GLRenderManager;
 // Similar to VulkanPushBuffer but is currently less efficient - it collects all the data in
 // RAM then does a big memcpy/buffer upload at the end of the frame. This is at least a lot
 // faster than the hundreds of buffer uploads or memory array buffers we used before.
-// On modern GL we could avoid the copy using glBufferStorage but not sure it's worth the
-// trouble.
+// With buffer storage (GLBufferStrategy::PERSISTENT_COHERENT), we write directly into
+// persistently mapped memory instead, and the render manager fences each frame's reuse.
 // We need to manage the lifetime of this together with the other resources so its destructor
 // runs on the render thread.
 class GLPushBuffer {
@@ -202,6 +206,7 @@ class GLPushBuffer {
 		uint8_t *localMemory = nullptr;
 		uint8_t *deviceMemory = nullptr;
 		size_t flushOffset = 0;
+		size_t size = 0;
 	};
 
 	GLPushBuffer(GLRenderManager *render, GLuint target, size_t size);
@@ -378,7 +383,7 @@ class GLRenderManager {
 	bool ThreadFrame();  // Returns false to request exiting the loop.
 
 	// Makes sure that the GPU has caught up enough that we can start writing buffers of this frame again.
-	void BeginFrame();
+	void BeginFrame(bool enableProfiling);
 	// Can run on a different thread!
 	void Finish();
 	void Run(int frame);
@@ -389,6 +394,16 @@ class GLRenderManager {
 	// Wait until no frames are pending.  Use during shutdown before freeing pointers.
 	void WaitUntilQueueIdle();
 
+	// Returns false if there's nothing new since the last call. Can be called from any thread.
+	bool TakeGpuProfile(Draw::GPUProfile *profile) {
+		std::lock_guard<std::mutex> guard(profileMutex_);
+		if (!hasProfile_)
+			return false;
+		*profile = std::move(lastProfile_);
+		hasProfile_ = false;
+		return true;
+	}
+
 	// Creation commands. These were not needed in Vulkan since there we can do that on the main thread.
 	GLRTexture *CreateTexture(GLenum target) {
 		GLRInitStep step{ GLRInitStepType::CREATE_TEXTURE };
@@ -866,6 +881,15 @@ class GLRenderManager {
 		return curFrame_;
 	}
 
+	// Fewer frames in flight means less input lag, but less overlap between CPU and GPU.
+	// Only call before the render thread starts.
+	void SetInflightFrames(int count) {
+		inflightFrames_ = count < 1 ? 1 : (count > MAX_INFLIGHT_FRAMES ? MAX_INFLIGHT_FRAMES : count);
+	}
+	int GetInflightFrames() const {
+		return inflightFrames_;
+	}
+
 	void Resize(int width, int height) {
 		targetWidth_ = width;
 		targetHeight_ = height;
@@ -892,6 +916,15 @@ class GLRenderManager {
 		swapIntervalFunction_ = swapIntervalFunction;
 	}
 
+	// Called on the render thread after each finished frame is presented (or skipped its swap), in order.
+	// The serial is what GetFrameSerial() returned while that frame was being recorded.
+	void SetPresentCallback(std::function<void(uint64_t serial, bool presented)> callback) {
+		presentCallback_ = callback;
+	}
+	uint64_t GetFrameSerial() const {
+		return frameSerial_;
+	}
+
 	void SwapInterval(int interval) {
 		if (interval != swapInterval_) {
 			swapInterval_ = interval;
@@ -910,6 +943,13 @@ class GLRenderManager {
 		return queueRunner_.GetGLString(name);
 	}
 
+	void LoadProgramBinaries(const std::string &filename) {
+		queueRunner_.LoadProgramBinaries(filename);
+	}
+	void SaveProgramBinaries(const std::string &filename) {
+		queueRunner_.SaveProgramBinaries(filename);
+	}
+
 	// Used during Android-style ugly shutdown. No need to have a way to set it back because we'll be
 	// destroyed.
 	void SetSkipGLCalls() {
@@ -920,6 +960,7 @@ class GLRenderManager {
 	void BeginSubmitFrame(int frame);
 	void EndSubmitFrame(int frame);
 	void Submit(int frame, bool triggerFence);
+	void ReleasePendingFrame();
 
 	// Bad for performance but sometimes necessary for synchronous CPU readbacks (screenshots and whatnot).
 	void FlushSync();
@@ -933,19 +974,22 @@ class GLRenderManager {
 
 	// Per-frame data, round-robin so we can overlap submission with execution of the previous frame.
 	struct FrameData {
-		std::mutex push_mutex;
-		std::condition_variable push_condVar;
+		// Profiled, since the emu and render threads hand frames back and forth with these.
+		ProfiledMutex push_mutex{ "GLRender push" };
+		std::condition_variable_any push_condVar;
 
-		std::mutex pull_mutex;
-		std::condition_variable pull_condVar;
+		ProfiledMutex pull_mutex{ "GLRender pull" };
+		std::condition_variable_any pull_condVar;
 
 		bool readyForFence = true;
 		bool readyForRun = false;
 		bool readyForSubmit = false;
 		bool skipSwap = false;
 		GLRRunType type = GLRRunType::END;
+		uint64_t serial = 0;
 
-		// GLuint fence; For future AZDO stuff?
+		// Only used with persistently mapped push buffers, see ReleasePendingFrame().
+		GLsync fence = nullptr;
 		std::vector<GLRStep *> steps;
 		std::vector<GLRInitStep> initSteps;
 
@@ -956,6 +1000,9 @@ class GLRenderManager {
 		GLDeleter deleter;
 		GLDeleter deleter_prev;
 		std::set<GLPushBuffer *> activePushBuffers;
+
+		bool profilingEnabled_ = false;
+		GLQueueProfileContext profile;
 	};
 
 	FrameData frameData_[MAX_INFLIGHT_FRAMES];
@@ -973,6 +1020,11 @@ class GLRenderManager {
 	int threadInitFrame_ = 0;
 	GLQueueRunner queueRunner_;
 
+	bool timestampsSupported_ = false;
+	std::mutex profileMutex_;
+	Draw::GPUProfile lastProfile_;
+	bool hasProfile_ = false;
+
 	// Thread state
 	int threadFrame_ = -1;
 
@@ -983,10 +1035,15 @@ class GLRenderManager {
 	bool skipGLCalls_ = false;
 
 	int curFrame_ = 0;
+	int inflightFrames_ = MAX_INFLIGHT_FRAMES;
 
 	std::function<void()> swapFunction_;
 	std::function<void(int)> swapIntervalFunction_;
+	std::function<void(uint64_t, bool)> presentCallback_;
+	uint64_t frameSerial_ = 0;
 	GLBufferStrategy bufferStrategy_ = GLBufferStrategy::SUBDATA;
+	// Frame that's done on the CPU, but may still be read by the GPU.
+	int pendingFrame_ = -1;
 
 	int swapInterval_ = 0;
 	bool swapIntervalChanged_ = true;
@@ -1,16 +1,32 @@
 #include <map>
 
 #include "base/timeutil.h"
+#include "thread/threadutil.h"
 #include "DataFormat.h"
 #include "VulkanQueueRunner.h"
 #include "VulkanRenderManager.h"
 
 // Debug help: adb logcat -s DEBUG PPSSPPNativeActivity PPSSPP NativeGLView NativeRenderer NativeSurfaceView PowerSaveModeReceiver InputDeviceState
 
+// Render passes with fewer commands than this are cheaper to record inline than to hand off.
+static const size_t PARALLEL_RECORD_MIN_COMMANDS = 256;
+
 void VulkanQueueRunner::CreateDeviceObjects() {
 	ILOG("VulkanQueueRunner::CreateDeviceObjects");
 	InitBackbufferRenderPass();
 
+	// Reading the attachment in the shader stays on chip on tilers, where a copy of the target is the most expensive.
+	switch (vulkan_->GetPhysicalDeviceProperties().properties.vendorID) {
+	case VULKAN_VENDOR_ARM:
+	case VULKAN_VENDOR_QUALCOMM:
+	case VULKAN_VENDOR_IMGTEC:
+		useColorInputAttachment_ = true;
+		break;
+	default:
+		useColorInputAttachment_ = false;
+		break;
+	}
+
 	framebufferRenderPass_ = GetRenderPass(VKRRenderPassAction::CLEAR, VKRRenderPassAction::CLEAR, VKRRenderPassAction::CLEAR,
 		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 
@@ -41,17 +57,22 @@ void VulkanQueueRunner::ResizeReadbackBuffer(VkDeviceSize requiredSize) {
 	}
 
 	readbackBufferSize_ = requiredSize;
+	if (!AllocateReadbackBuffer(readbackBufferSize_, &readbackBuffer_, &readbackMemory_, &readbackBufferIsCoherent_)) {
+		readbackBufferSize_ = 0;
+	}
+}
 
+bool VulkanQueueRunner::AllocateReadbackBuffer(VkDeviceSize size, VkBuffer *buffer, VkDeviceMemory *memory, bool *coherent) {
 	VkDevice device = vulkan_->GetDevice();
 
 	VkBufferCreateInfo buf{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-	buf.size = readbackBufferSize_;
+	buf.size = size;
 	buf.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 
-	vkCreateBuffer(device, &buf, nullptr, &readbackBuffer_);
+	vkCreateBuffer(device, &buf, nullptr, buffer);
 
 	VkMemoryRequirements reqs{};
-	vkGetBufferMemoryRequirements(device, readbackBuffer_, &reqs);
+	vkGetBufferMemoryRequirements(device, *buffer, &reqs);
 
 	VkMemoryAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
 	allocInfo.allocationSize = reqs.size;
@@ -72,21 +93,24 @@ void VulkanQueueRunner::ResizeReadbackBuffer(VkDeviceSize requiredSize) {
 		}
 	}
 	_assert_(successTypeReqs != 0);
-	readbackBufferIsCoherent_ = (successTypeReqs & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+	*coherent = (successTypeReqs & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
 
-	VkResult res = vkAllocateMemory(device, &allocInfo, nullptr, &readbackMemory_);
+	VkResult res = vkAllocateMemory(device, &allocInfo, nullptr, memory);
 	if (res != VK_SUCCESS) {
-		readbackMemory_ = VK_NULL_HANDLE;
-		vkDestroyBuffer(device, readbackBuffer_, nullptr);
-		readbackBuffer_ = VK_NULL_HANDLE;
-		return;
+		*memory = VK_NULL_HANDLE;
+		vkDestroyBuffer(device, *buffer, nullptr);
+		*buffer = VK_NULL_HANDLE;
+		return false;
 	}
 	uint32_t offset = 0;
-	vkBindBufferMemory(device, readbackBuffer_, readbackMemory_, offset);
+	vkBindBufferMemory(device, *buffer, *memory, offset);
+	return true;
 }
 
 void VulkanQueueRunner::DestroyDeviceObjects() {
 	ILOG("VulkanQueueRunner::DestroyDeviceObjects");
+	StopRecordThreads();
+
 	vulkan_->Delete().QueueDeleteDeviceMemory(readbackMemory_);
 	vulkan_->Delete().QueueDeleteBuffer(readbackBuffer_);
 	readbackBufferSize_ = 0;
@@ -250,11 +274,19 @@ VkRenderPass VulkanQueueRunner::GetRenderPass(const RPKey &key) {
 	depth_reference.attachment = 1;
 	depth_reference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
+	// An attachment used for both input and output must be in the general layout during the subpass.
+	VkAttachmentReference input_reference{};
+	input_reference.attachment = 0;
+	input_reference.layout = VK_IMAGE_LAYOUT_GENERAL;
+	if (useColorInputAttachment_) {
+		color_reference.layout = VK_IMAGE_LAYOUT_GENERAL;
+	}
+
 	VkSubpassDescription subpass{};
 	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 	subpass.flags = 0;
-	subpass.inputAttachmentCount = 0;
-	subpass.pInputAttachments = nullptr;
+	subpass.inputAttachmentCount = useColorInputAttachment_ ? 1 : 0;
+	subpass.pInputAttachments = useColorInputAttachment_ ? &input_reference : nullptr;
 	subpass.colorAttachmentCount = 1;
 	subpass.pColorAttachments = &color_reference;
 	subpass.pResolveAttachments = nullptr;
@@ -262,7 +294,7 @@ VkRenderPass VulkanQueueRunner::GetRenderPass(const RPKey &key) {
 	subpass.preserveAttachmentCount = 0;
 	subpass.pPreserveAttachments = nullptr;
 
-	VkSubpassDependency deps[2]{};
+	VkSubpassDependency deps[3]{};
 	int numDeps = 0;
 	switch (key.prevColorLayout) {
 	case VK_IMAGE_LAYOUT_UNDEFINED:
@@ -359,6 +391,18 @@ VkRenderPass VulkanQueueRunner::GetRenderPass(const RPKey &key) {
 		numDeps++;
 	}
 
+	if (useColorInputAttachment_) {
+		// Lets SELF_DEPENDENCY_BARRIER make earlier color writes visible to input attachment reads.
+		deps[numDeps].srcSubpass = 0;
+		deps[numDeps].dstSubpass = 0;
+		deps[numDeps].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+		deps[numDeps].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		deps[numDeps].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		deps[numDeps].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		deps[numDeps].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+		numDeps++;
+	}
+
 	VkRenderPassCreateInfo rp{ VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
 	rp.attachmentCount = 2;
 	rp.pAttachments = attachments;
@@ -377,7 +421,7 @@ VkRenderPass VulkanQueueRunner::GetRenderPass(const RPKey &key) {
 	return pass;
 }
 
-void VulkanQueueRunner::RunSteps(VkCommandBuffer cmd, std::vector<VKRStep *> &steps, QueueProfileContext *profile) {
+void VulkanQueueRunner::RunSteps(VkCommandBuffer cmd, std::vector<VKRStep *> &steps, int frame, QueueProfileContext *profile) {
 	if (profile)
 		profile->cpuStartTime = real_time_now();
 	// Optimizes renderpasses, then sequences them.
@@ -447,11 +491,20 @@ void VulkanQueueRunner::RunSteps(VkCommandBuffer cmd, std::vector<VKRStep *> &st
 		}
 	}
 
+	ApplyLoadOpFolding(steps);
+
+	// Now that the steps are final, large render passes can be recorded on other threads.
+	bool parallel = PrepareParallelRecording(steps, frame);
+
 	for (size_t i = 0; i < steps.size(); i++) {
 		const VKRStep &step = *steps[i];
 		switch (step.stepType) {
 		case VKRStepType::RENDER:
-			PerformRenderPass(step, cmd);
+			if (parallel) {
+				PerformRenderPass(step, cmd, secondaryCmds_[i], &inheritedState_[i]);
+			} else {
+				PerformRenderPass(step, cmd, VK_NULL_HANDLE, nullptr);
+			}
 			break;
 		case VKRStepType::COPY:
 			PerformCopy(step, cmd);
@@ -777,7 +830,27 @@ void VulkanQueueRunner::ApplyRenderPassMerge(std::vector<VKRStep *> &steps) {
 						// and kill the step.
 						// Also slurp up any pretransitions.
 						steps[i]->preTransitions.insert(steps[i]->preTransitions.end(), steps[j]->preTransitions.begin(), steps[j]->preTransitions.end());
+						// Its clears can't be load ops anymore, so they become clear commands (which are always full size.)
+						int clearMask = 0;
+						if (steps[j]->render.color == VKRRenderPassAction::CLEAR)
+							clearMask |= VK_IMAGE_ASPECT_COLOR_BIT;
+						if (steps[j]->render.depth == VKRRenderPassAction::CLEAR)
+							clearMask |= VK_IMAGE_ASPECT_DEPTH_BIT;
+						if (steps[j]->render.stencil == VKRRenderPassAction::CLEAR)
+							clearMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+						if (clearMask) {
+							VkRenderData data{ VKRRenderCommand::CLEAR };
+							data.clear.clearColor = steps[j]->render.clearColor;
+							data.clear.clearZ = steps[j]->render.clearDepth;
+							data.clear.clearStencil = steps[j]->render.clearStencil;
+							data.clear.clearMask = clearMask;
+							steps[i]->commands.push_back(data);
+						}
 						steps[i]->commands.insert(steps[i]->commands.end(), steps[j]->commands.begin(), steps[j]->commands.end());
+						steps[i]->render.numDraws += steps[j]->render.numDraws;
+						steps[i]->render.numReads += steps[j]->render.numReads;
+						// Nothing in between touched fb, so the layout it needs afterward is the one of the last pass.
+						steps[i]->render.finalColorLayout = steps[j]->render.finalColorLayout;
 						steps[j]->stepType = VKRStepType::RENDER_SKIP;
 					}
 					// Remember the framebuffer this wrote to. We can't merge with later passes that depend on these.
@@ -798,8 +871,8 @@ void VulkanQueueRunner::ApplyRenderPassMerge(std::vector<VKRStep *> &steps) {
 					touchedFramebuffers.insert(steps[j]->blit.dst);
 					break;
 				case VKRStepType::READBACK:
-					// Not sure this has much effect, when executed READBACK is always the last step
-					// since we stall the GPU and wait immediately after.
+					// Not sure this has much effect, when executed a sync READBACK is always the last step
+					// since we stall the GPU and wait immediately after. Async ones can be anywhere.
 					if (steps[j]->readback.src == fb) {
 						goto done_fb;
 					}
@@ -812,6 +885,36 @@ void VulkanQueueRunner::ApplyRenderPassMerge(std::vector<VKRStep *> &steps) {
 	}
 }
 
+// Clears at the start of a pass, before any draws, can be done by the load ops instead of vkCmdClearAttachments.
+// That saves loading the old contents at all, which matters a lot on tilers.
+void VulkanQueueRunner::ApplyLoadOpFolding(std::vector<VKRStep *> &steps) {
+	for (VKRStep *step : steps) {
+		if (step->stepType != VKRStepType::RENDER || !step->render.framebuffer)
+			continue;
+
+		for (VkRenderData &c : step->commands) {
+			if (c.cmd == VKRRenderCommand::DRAW || c.cmd == VKRRenderCommand::DRAW_INDEXED)
+				break;
+			if (c.cmd != VKRRenderCommand::CLEAR)
+				continue;
+
+			if (c.clear.clearMask & VK_IMAGE_ASPECT_COLOR_BIT) {
+				step->render.color = VKRRenderPassAction::CLEAR;
+				step->render.clearColor = c.clear.clearColor;
+			}
+			if (c.clear.clearMask & VK_IMAGE_ASPECT_DEPTH_BIT) {
+				step->render.depth = VKRRenderPassAction::CLEAR;
+				step->render.clearDepth = c.clear.clearZ;
+			}
+			if (c.clear.clearMask & VK_IMAGE_ASPECT_STENCIL_BIT) {
+				step->render.stencil = VKRRenderPassAction::CLEAR;
+				step->render.clearStencil = c.clear.clearStencil;
+			}
+			c.cmd = VKRRenderCommand::REMOVED;
+		}
+	}
+}
+
 void VulkanQueueRunner::LogSteps(const std::vector<VKRStep *> &steps) {
 	ILOG("=======================================");
 	for (size_t i = 0; i < steps.size(); i++) {
@@ -876,6 +979,9 @@ void VulkanQueueRunner::LogRenderPass(const VKRStep &pass) {
 		case VKRRenderCommand::PUSH_CONSTANTS:
 			ILOG("  PushConstants(%d)", cmd.push.size);
 			break;
+		case VKRRenderCommand::SELF_DEPENDENCY_BARRIER:
+			ILOG("  SelfBarrier()");
+			break;
 
 		case VKRRenderCommand::NUM_RENDER_COMMANDS:
 			break;
@@ -900,7 +1006,7 @@ void VulkanQueueRunner::LogReadbackImage(const VKRStep &step) {
 	ILOG("%s", StepToString(step).c_str());
 }
 
-void VulkanQueueRunner::PerformRenderPass(const VKRStep &step, VkCommandBuffer cmd) {
+void VulkanQueueRunner::PerformRenderPass(const VKRStep &step, VkCommandBuffer cmd, VkCommandBuffer secondary, const InheritedState *inherited) {
 	// TODO: If there are multiple, we can transition them together.
 	for (const auto &iter : step.preTransitions) {
 		if (iter.fb->color.layout != iter.targetLayout) {
@@ -975,8 +1081,27 @@ void VulkanQueueRunner::PerformRenderPass(const VKRStep &step, VkCommandBuffer c
 	}
 
 	// This is supposed to bind a vulkan render pass to the command buffer.
-	PerformBindFramebufferAsRenderTarget(step, cmd);
+	PerformBindFramebufferAsRenderTarget(step, cmd, secondary ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
 
+	if (secondary) {
+		vkCmdExecuteCommands(cmd, 1, &secondary);
+	} else {
+		if (inherited) {
+			RecordRenderCommands(step, inherited->cmds, inherited->count, cmd);
+		}
+		RecordRenderCommands(step, step.commands.data(), step.commands.size(), cmd);
+	}
+	vkCmdEndRenderPass(cmd);
+
+	// The renderpass handles the layout transition.
+	if (step.render.framebuffer) {
+		step.render.framebuffer->color.layout = step.render.finalColorLayout;
+		step.render.framebuffer->contentsDefined = true;
+	}
+}
+
+// Only depends on the step itself, so this may run on any thread.
+void VulkanQueueRunner::RecordRenderCommands(const VKRStep &step, const VkRenderData *commands, size_t count, VkCommandBuffer cmd) {
 	int curWidth = step.render.framebuffer ? step.render.framebuffer->width : vulkan_->GetBackbufferWidth();
 	int curHeight = step.render.framebuffer ? step.render.framebuffer->height : vulkan_->GetBackbufferHeight();
 
@@ -984,15 +1109,14 @@ void VulkanQueueRunner::PerformRenderPass(const VKRStep &step, VkCommandBuffer c
 
 	VkPipeline lastPipeline = VK_NULL_HANDLE;
 
-	auto &commands = step.commands;
-
 	// We can do a little bit of state tracking here to eliminate some calls into the driver.
 	// The stencil ones are very commonly mostly redundant so let's eliminate them where possible.
 	int lastStencilWriteMask = -1;
 	int lastStencilCompareMask = -1;
 	int lastStencilReference = -1;
 
-	for (const auto &c : commands) {
+	for (size_t i = 0; i < count; i++) {
+		const VkRenderData &c = commands[i];
 		switch (c.cmd) {
 		case VKRRenderCommand::REMOVED:
 			break;
@@ -1055,6 +1179,24 @@ void VulkanQueueRunner::PerformRenderPass(const VKRStep &step, VkCommandBuffer c
 			vkCmdPushConstants(cmd, c.push.pipelineLayout, c.push.stages, c.push.offset, c.push.size, c.push.data);
 			break;
 
+		case VKRRenderCommand::SELF_DEPENDENCY_BARRIER:
+			if (fb != nullptr) {
+				// Must match the subpass self-dependency, see GetRenderPass.
+				VkImageMemoryBarrier barrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+				barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+				barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+				barrier.image = fb->color.image;
+				barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+				barrier.dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+				barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				barrier.subresourceRange.levelCount = 1;
+				barrier.subresourceRange.layerCount = 1;
+				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 1, &barrier);
+			}
+			break;
+
 		case VKRRenderCommand::STENCIL:
 			if (lastStencilWriteMask != c.stencil.stencilWriteMask) {
 				lastStencilWriteMask = (int)c.stencil.stencilWriteMask;
@@ -1123,15 +1265,188 @@ void VulkanQueueRunner::PerformRenderPass(const VKRStep &step, VkCommandBuffer c
 			;
 		}
 	}
-	vkCmdEndRenderPass(cmd);
+}
 
-	// The renderpass handles the layout transition.
-	if (fb) {
-		fb->color.layout = step.render.finalColorLayout;
+bool VulkanQueueRunner::PrepareParallelRecording(const std::vector<VKRStep *> &steps, int frame) {
+	if (parallelRecordThreads_ <= 0)
+		return false;
+
+	// Backbuffer passes use a different render pass, and are small anyway.
+	recordJobs_.clear();
+	for (size_t i = 0; i < steps.size(); i++) {
+		const VKRStep &step = *steps[i];
+		if (step.stepType == VKRStepType::RENDER && step.render.framebuffer && step.commands.size() >= PARALLEL_RECORD_MIN_COMMANDS)
+			recordJobs_.push_back((int)i);
+	}
+	// With a single big pass, there's nothing to do in parallel.
+	if (recordJobs_.size() < 2)
+		return false;
+
+	if (recordThreads_.empty())
+		StartRecordThreads(parallelRecordThreads_);
+
+	inheritedState_.resize(steps.size());
+	secondaryCmds_.assign(steps.size(), VK_NULL_HANDLE);
+
+	VkRenderData last[ARRAY_SIZE(InheritedState::cmds)];
+	bool has[ARRAY_SIZE(InheritedState::cmds)]{};
+	for (size_t i = 0; i < steps.size(); i++) {
+		const VKRStep &step = *steps[i];
+		if (step.stepType != VKRStepType::RENDER)
+			continue;
+
+		InheritedState &state = inheritedState_[i];
+		state.count = 0;
+		for (size_t j = 0; j < ARRAY_SIZE(last); j++) {
+			if (has[j])
+				state.cmds[state.count++] = last[j];
+		}
+
+		for (const VkRenderData &c : step.commands) {
+			int slot;
+			switch (c.cmd) {
+			case VKRRenderCommand::VIEWPORT: slot = 0; break;
+			case VKRRenderCommand::SCISSOR: slot = 1; break;
+			case VKRRenderCommand::STENCIL: slot = 2; break;
+			case VKRRenderCommand::BLEND: slot = 3; break;
+			case VKRRenderCommand::PUSH_CONSTANTS: slot = 4; break;
+			default: continue;
+			}
+			last[slot] = c;
+			has[slot] = true;
+		}
+	}
+
+	recordSteps_ = &steps;
+	recordFrame_ = frame;
+	recordNext_ = 0;
+	{
+		std::lock_guard<std::mutex> guard(recordMutex_);
+		recordBusy_ = (int)recordThreads_.size();
+		recordGeneration_++;
+	}
+	recordCond_.notify_all();
+
+	// Help out, then wait for the others to finish.
+	RecordSecondaryJobs((int)recordContexts_.size() - 1);
+	std::unique_lock<std::mutex> lock(recordMutex_);
+	recordDoneCond_.wait(lock, [&] { return recordBusy_ == 0; });
+	return true;
+}
+
+void VulkanQueueRunner::RecordSecondaryJobs(int contextIndex) {
+	RecordContext &ctx = recordContexts_[contextIndex];
+	VkDevice device = vulkan_->GetDevice();
+	const int frame = recordFrame_;
+
+	// This frame's fence has been waited on (or the device idled, after a sync), so these are free to reuse.
+	vkResetCommandPool(device, ctx.pools[frame], 0);
+	ctx.used = 0;
+
+	while (true) {
+		int job = recordNext_++;
+		if (job >= (int)recordJobs_.size())
+			break;
+		int stepIndex = recordJobs_[job];
+		const VKRStep &step = *(*recordSteps_)[stepIndex];
+
+		std::vector<VkCommandBuffer> &buffers = ctx.buffers[frame];
+		if (ctx.used == buffers.size()) {
+			VkCommandBufferAllocateInfo alloc{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+			alloc.commandPool = ctx.pools[frame];
+			alloc.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			alloc.commandBufferCount = 1;
+			VkCommandBuffer newCmd;
+			VkResult res = vkAllocateCommandBuffers(device, &alloc, &newCmd);
+			_assert_(res == VK_SUCCESS);
+			buffers.push_back(newCmd);
+		}
+		VkCommandBuffer cmd = buffers[ctx.used++];
+
+		// Any render pass compatible with the framebuffer will do, so use the precached one.
+		VkCommandBufferInheritanceInfo inherit{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+		inherit.renderPass = framebufferRenderPass_;
+		inherit.subpass = 0;
+		inherit.framebuffer = step.render.framebuffer->framebuf;
+		VkCommandBufferBeginInfo begin{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+		begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		begin.pInheritanceInfo = &inherit;
+		VkResult res = vkBeginCommandBuffer(cmd, &begin);
+		_assert_(res == VK_SUCCESS);
+
+		const InheritedState &state = inheritedState_[stepIndex];
+		RecordRenderCommands(step, state.cmds, state.count, cmd);
+		RecordRenderCommands(step, step.commands.data(), step.commands.size(), cmd);
+		vkEndCommandBuffer(cmd);
+
+		secondaryCmds_[stepIndex] = cmd;
+	}
+}
+
+void VulkanQueueRunner::RecordThreadFunc(int contextIndex) {
+	setCurrentThreadName("VKRecord");
+
+	uint32_t generation = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(recordMutex_);
+			recordCond_.wait(lock, [&] { return recordStop_ || recordGeneration_ != generation; });
+			if (recordStop_)
+				return;
+			generation = recordGeneration_;
+		}
+
+		RecordSecondaryJobs(contextIndex);
+
+		std::lock_guard<std::mutex> guard(recordMutex_);
+		if (--recordBusy_ == 0)
+			recordDoneCond_.notify_one();
 	}
 }
 
-void VulkanQueueRunner::PerformBindFramebufferAsRenderTarget(const VKRStep &step, VkCommandBuffer cmd) {
+void VulkanQueueRunner::StartRecordThreads(int count) {
+	ILOG("VulkanQueueRunner: Recording large render passes on %d extra threads", count);
+	// One context for each thread, plus the render thread.
+	recordContexts_.resize(count + 1);
+	for (RecordContext &ctx : recordContexts_) {
+		for (int i = 0; i < VulkanContext::MAX_INFLIGHT_FRAMES; i++) {
+			VkCommandPoolCreateInfo cmd_pool_info{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+			cmd_pool_info.queueFamilyIndex = vulkan_->GetGraphicsQueueFamilyIndex();
+			cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			VkResult res = vkCreateCommandPool(vulkan_->GetDevice(), &cmd_pool_info, nullptr, &ctx.pools[i]);
+			_assert_(res == VK_SUCCESS);
+		}
+	}
+
+	recordStop_ = false;
+	recordGeneration_ = 0;
+	for (int i = 0; i < count; i++) {
+		recordThreads_.push_back(std::thread(&VulkanQueueRunner::RecordThreadFunc, this, i));
+	}
+}
+
+// Only call when the GPU is done with the secondary command buffers.
+void VulkanQueueRunner::StopRecordThreads() {
+	{
+		std::lock_guard<std::mutex> guard(recordMutex_);
+		recordStop_ = true;
+	}
+	recordCond_.notify_all();
+	for (std::thread &thread : recordThreads_) {
+		thread.join();
+	}
+	recordThreads_.clear();
+
+	for (RecordContext &ctx : recordContexts_) {
+		for (int i = 0; i < VulkanContext::MAX_INFLIGHT_FRAMES; i++) {
+			// This also frees the command buffers.
+			vkDestroyCommandPool(vulkan_->GetDevice(), ctx.pools[i], nullptr);
+		}
+	}
+	recordContexts_.clear();
+}
+
+void VulkanQueueRunner::PerformBindFramebufferAsRenderTarget(const VKRStep &step, VkCommandBuffer cmd, VkSubpassContents contents) {
 	VkRenderPass renderPass;
 	int numClearVals = 0;
 	VkClearValue clearVal[2]{};
@@ -1162,9 +1477,20 @@ void VulkanQueueRunner::PerformBindFramebufferAsRenderTarget(const VKRStep &step
 			fb->color.layout = VK_IMAGE_LAYOUT_GENERAL;
 		}
 
-		renderPass = GetRenderPass(
-			step.render.color, step.render.depth, step.render.stencil,
-			fb->color.layout, fb->depth.layout, step.render.finalColorLayout);
+		// If nothing has been written to the framebuffer since it was created, there's nothing worth loading.
+		VKRRenderPassAction color = step.render.color;
+		VKRRenderPassAction depth = step.render.depth;
+		VKRRenderPassAction stencil = step.render.stencil;
+		if (!fb->contentsDefined) {
+			if (color == VKRRenderPassAction::KEEP)
+				color = VKRRenderPassAction::DONT_CARE;
+			if (depth == VKRRenderPassAction::KEEP)
+				depth = VKRRenderPassAction::DONT_CARE;
+			if (stencil == VKRRenderPassAction::KEEP)
+				stencil = VKRRenderPassAction::DONT_CARE;
+		}
+
+		renderPass = GetRenderPass(color, depth, stencil, fb->color.layout, fb->depth.layout, step.render.finalColorLayout);
 
 		// We now do any layout pretransitions as part of the render pass.
 		fb->color.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
@@ -1199,7 +1525,7 @@ void VulkanQueueRunner::PerformBindFramebufferAsRenderTarget(const VKRStep &step
 	rp_begin.renderArea.extent.height = h;
 	rp_begin.clearValueCount = numClearVals;
 	rp_begin.pClearValues = numClearVals ? clearVal : nullptr;
-	vkCmdBeginRenderPass(cmd, &rp_begin, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(cmd, &rp_begin, contents);
 }
 
 void VulkanQueueRunner::PerformCopy(const VKRStep &step, VkCommandBuffer cmd) {
@@ -1273,6 +1599,7 @@ void VulkanQueueRunner::PerformCopy(const VKRStep &step, VkCommandBuffer cmd) {
 		}
 		vkCmdCopyImage(cmd, src->depth.image, src->depth.layout, dst->depth.image, dst->depth.layout, 1, &copy);
 	}
+	dst->contentsDefined = true;
 }
 
 void VulkanQueueRunner::PerformBlit(const VKRStep &step, VkCommandBuffer cmd) {
@@ -1356,6 +1683,7 @@ void VulkanQueueRunner::PerformBlit(const VKRStep &step, VkCommandBuffer cmd) {
 		}
 		vkCmdBlitImage(cmd, src->depth.image, src->depth.layout, dst->depth.image, dst->depth.layout, 1, &blit, step.blit.filter);
 	}
+	dst->contentsDefined = true;
 }
 
 void VulkanQueueRunner::SetupTransitionToTransferSrc(VKRImage &img, VkImageMemoryBarrier &barrier, VkPipelineStageFlags &stage, VkImageAspectFlags aspect) {
@@ -1477,7 +1805,19 @@ void VulkanQueueRunner::SetupTransitionToTransferDst(VKRImage &img, VkImageMemor
 }
 
 void VulkanQueueRunner::PerformReadback(const VKRStep &step, VkCommandBuffer cmd) {
-	ResizeReadbackBuffer(sizeof(uint32_t) * step.readback.srcRect.extent.width * step.readback.srcRect.extent.height);
+	const VkDeviceSize size = sizeof(uint32_t) * step.readback.srcRect.extent.width * step.readback.srcRect.extent.height;
+	VkBuffer dstBuffer;
+	if (step.readback.async) {
+		VKRAsyncReadback *async = step.readback.async;
+		if (!AllocateReadbackBuffer(size, &async->buffer, &async->memory, &async->coherent)) {
+			ELOG("PerformReadback: Failed to allocate async readback buffer");
+			return;
+		}
+		dstBuffer = async->buffer;
+	} else {
+		ResizeReadbackBuffer(size);
+		dstBuffer = readbackBuffer_;
+	}
 
 	VkBufferImageCopy region{};
 	region.imageOffset = { step.readback.srcRect.offset.x, step.readback.srcRect.offset.y, 0 };
@@ -1521,7 +1861,7 @@ void VulkanQueueRunner::PerformReadback(const VKRStep &step, VkCommandBuffer cmd
 		copyLayout = srcImage->layout;
 	}
 
-	vkCmdCopyImageToBuffer(cmd, image, copyLayout, readbackBuffer_, 1, &region);
+	vkCmdCopyImageToBuffer(cmd, image, copyLayout, dstBuffer, 1, &region);
 
 	// NOTE: Can't read the buffer using the CPU here - need to sync first.
 
@@ -1572,18 +1912,33 @@ void VulkanQueueRunner::PerformReadbackImage(const VKRStep &step, VkCommandBuffe
 	// Doing that will also act like a heavyweight barrier ensuring that device writes are visible on the host.
 }
 
+void VulkanQueueRunner::CopyAsyncReadback(VKRAsyncReadback *readback) {
+	if (readback->memory && readback->pixels) {
+		CopyReadbackMemory(readback->memory, readback->coherent, readback->width, readback->height, readback->srcFormat, readback->destFormat, readback->pixelStride, readback->pixels);
+	}
+	if (readback->memory)
+		vulkan_->Delete().QueueDeleteDeviceMemory(readback->memory);
+	if (readback->buffer)
+		vulkan_->Delete().QueueDeleteBuffer(readback->buffer);
+	delete readback;
+}
+
 void VulkanQueueRunner::CopyReadbackBuffer(int width, int height, Draw::DataFormat srcFormat, Draw::DataFormat destFormat, int pixelStride, uint8_t *pixels) {
 	if (!readbackMemory_)
 		return;  // Something has gone really wrong.
 
+	CopyReadbackMemory(readbackMemory_, readbackBufferIsCoherent_, width, height, srcFormat, destFormat, pixelStride, pixels);
+}
+
+void VulkanQueueRunner::CopyReadbackMemory(VkDeviceMemory memory, bool coherent, int width, int height, Draw::DataFormat srcFormat, Draw::DataFormat destFormat, int pixelStride, uint8_t *pixels) {
 	// Read back to the requested address in ram from buffer.
 	void *mappedData;
 	const size_t srcPixelSize = DataFormatSizeInBytes(srcFormat);
 
-	VkResult res = vkMapMemory(vulkan_->GetDevice(), readbackMemory_, 0, width * height * srcPixelSize, 0, &mappedData);
-	if (!readbackBufferIsCoherent_) {
+	VkResult res = vkMapMemory(vulkan_->GetDevice(), memory, 0, width * height * srcPixelSize, 0, &mappedData);
+	if (!coherent) {
 		VkMappedMemoryRange range{};
-		range.memory = readbackMemory_;
+		range.memory = memory;
 		range.offset = 0;
 		range.size = width * height * srcPixelSize;
 		vkInvalidateMappedMemoryRanges(vulkan_->GetDevice(), 1, &range);
@@ -1614,5 +1969,5 @@ void VulkanQueueRunner::CopyReadbackBuffer(int width, int height, Draw::DataForm
 		ELOG("CopyReadbackBuffer: Unknown format");
 		assert(false);
 	}
-	vkUnmapMemory(vulkan_->GetDevice(), readbackMemory_);
+	vkUnmapMemory(vulkan_->GetDevice(), memory);
 }
@@ -1,11 +1,17 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "Common/Hashmaps.h"
 #include "Common/Vulkan/VulkanContext.h"
 #include "math/dataconv.h"
 #include "thin3d/DataFormat.h"
+#include "thin3d/thin3d.h"
 
 class VKRFramebuffer;
 struct VKRImage;
@@ -92,6 +98,7 @@ enum class VKRRenderCommand : uint8_t {
 	DRAW,
 	DRAW_INDEXED,
 	PUSH_CONSTANTS,
+	SELF_DEPENDENCY_BARRIER,
 	NUM_RENDER_COMMANDS,
 };
 
@@ -179,6 +186,24 @@ struct QueueProfileContext {
 	std::string profileSummary;
 	double cpuStartTime;
 	double cpuEndTime;
+	// Filled in along with profileSummary, cleared once taken.
+	Draw::GPUProfile results;
+	bool hasResults = false;
+};
+
+// Staging for a readback that doesn't stall. The copy lands in pixels once the GPU is known to be
+// done with the frame that recorded it, later on the emu thread.
+struct VKRAsyncReadback {
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	bool coherent = false;
+	int width;
+	int height;
+	Draw::DataFormat srcFormat;
+	Draw::DataFormat destFormat;
+	int pixelStride;
+	// Cleared if the destination goes away before the copy has landed.
+	uint8_t *pixels;
 };
 
 struct VKRStep {
@@ -222,6 +247,7 @@ struct VKRStep {
 			int aspectMask;
 			VKRFramebuffer *src;
 			VkRect2D srcRect;
+			VKRAsyncReadback *async;  // nullptr for synchronous readbacks into readbackBuffer_.
 		} readback;
 		struct {
 			VkImage image;
@@ -240,7 +266,7 @@ class VulkanQueueRunner {
 	}
 
 	// RunSteps can modify steps but will leave it in a valid state.
-	void RunSteps(VkCommandBuffer cmd, std::vector<VKRStep *> &steps, QueueProfileContext *profile);
+	void RunSteps(VkCommandBuffer cmd, std::vector<VKRStep *> &steps, int frame, QueueProfileContext *profile);
 	void LogSteps(const std::vector<VKRStep *> &steps);
 
 	std::string StepToString(const VKRStep &step) const;
@@ -258,11 +284,19 @@ class VulkanQueueRunner {
 		return framebufferRenderPass_;
 	}
 
+	// If set, framebuffer render passes also bind the color attachment as input attachment 0,
+	// so shaders can read the destination color without a copy.
+	bool UsesColorInputAttachment() const {
+		return useColorInputAttachment_;
+	}
+
 	inline int RPIndex(VKRRenderPassAction color, VKRRenderPassAction depth) {
 		return (int)depth * 3 + (int)color;
 	}
 
 	void CopyReadbackBuffer(int width, int height, Draw::DataFormat srcFormat, Draw::DataFormat destFormat, int pixelStride, uint8_t *pixels);
+	// Only call once the frame that performed the readback has completed. Frees the staging buffer.
+	void CopyAsyncReadback(VKRAsyncReadback *readback);
 
 	struct RPKey {
 		VKRRenderPassAction colorLoadAction;
@@ -299,11 +333,32 @@ class VulkanQueueRunner {
 		hacksEnabled_ = hacks;
 	}
 
+	// Records large render passes into secondary command buffers on this many extra threads, 0 to disable.
+	// The threads are started on first use and kept until DestroyDeviceObjects.
+	void SetParallelRecording(int threads) {
+		parallelRecordThreads_ = threads;
+	}
+
 private:
 	void InitBackbufferRenderPass();
 
-	void PerformBindFramebufferAsRenderTarget(const VKRStep &pass, VkCommandBuffer cmd);
-	void PerformRenderPass(const VKRStep &pass, VkCommandBuffer cmd);
+	// Dynamic state set by earlier passes. Secondary command buffers don't inherit it, and executing one
+	// leaves it undefined, so when recording in parallel, each pass starts by setting it again.
+	struct InheritedState {
+		VkRenderData cmds[5];
+		int count;
+	};
+
+	// A render pass recorded into a secondary command buffer, with its own pool per thread and frame.
+	struct RecordContext {
+		VkCommandPool pools[VulkanContext::MAX_INFLIGHT_FRAMES]{};
+		std::vector<VkCommandBuffer> buffers[VulkanContext::MAX_INFLIGHT_FRAMES];
+		size_t used = 0;
+	};
+
+	void PerformBindFramebufferAsRenderTarget(const VKRStep &pass, VkCommandBuffer cmd, VkSubpassContents contents);
+	void PerformRenderPass(const VKRStep &pass, VkCommandBuffer cmd, VkCommandBuffer secondary, const InheritedState *inherited);
+	void RecordRenderCommands(const VKRStep &pass, const VkRenderData *commands, size_t count, VkCommandBuffer cmd);
 	void PerformCopy(const VKRStep &pass, VkCommandBuffer cmd);
 	void PerformBlit(const VKRStep &pass, VkCommandBuffer cmd);
 	void PerformReadback(const VKRStep &pass, VkCommandBuffer cmd);
@@ -316,10 +371,19 @@ class VulkanQueueRunner {
 	void LogReadbackImage(const VKRStep &pass);
 
 	void ResizeReadbackBuffer(VkDeviceSize requiredSize);
+	bool AllocateReadbackBuffer(VkDeviceSize size, VkBuffer *buffer, VkDeviceMemory *memory, bool *coherent);
+	void CopyReadbackMemory(VkDeviceMemory memory, bool coherent, int width, int height, Draw::DataFormat srcFormat, Draw::DataFormat destFormat, int pixelStride, uint8_t *pixels);
+
+	bool PrepareParallelRecording(const std::vector<VKRStep *> &steps, int frame);
+	void RecordSecondaryJobs(int contextIndex);
+	void RecordThreadFunc(int contextIndex);
+	void StartRecordThreads(int count);
+	void StopRecordThreads();
 
 	void ApplyMGSHack(std::vector<VKRStep *> &steps);
 	void ApplySonicHack(std::vector<VKRStep *> &steps);
 	void ApplyRenderPassMerge(std::vector<VKRStep *> &steps);
+	void ApplyLoadOpFolding(std::vector<VKRStep *> &steps);
 
 	static void SetupTransitionToTransferSrc(VKRImage &img, VkImageMemoryBarrier &barrier, VkPipelineStageFlags &stage, VkImageAspectFlags aspect);
 	static void SetupTransitionToTransferDst(VKRImage &img, VkImageMemoryBarrier &barrier, VkPipelineStageFlags &stage, VkImageAspectFlags aspect);
@@ -331,12 +395,13 @@ class VulkanQueueRunner {
 
 	VkRenderPass backbufferRenderPass_ = VK_NULL_HANDLE;
 	VkRenderPass framebufferRenderPass_ = VK_NULL_HANDLE;
+	bool useColorInputAttachment_ = false;
 
 	// Renderpasses, all combinations of preserving or clearing or dont-care-ing fb contents.
 	// TODO: Create these on demand.
 	DenseHashMap<RPKey, VkRenderPass, (VkRenderPass)VK_NULL_HANDLE> renderPasses_;
 
-	// Readback buffer. Currently we only support synchronous readback, so we only really need one.
+	// Readback buffer for synchronous readbacks, so we only really need one. Async ones bring their own.
 	// We size it generously.
 	VkDeviceMemory readbackMemory_ = VK_NULL_HANDLE;
 	VkBuffer readbackBuffer_ = VK_NULL_HANDLE;
@@ -345,4 +410,22 @@ class VulkanQueueRunner {
 
 	// TODO: Enable based on compat.ini.
 	uint32_t hacksEnabled_ = 0;
+
+	// Parallel recording. Only the render thread touches these outside of a recording round.
+	int parallelRecordThreads_ = 0;
+	std::vector<std::thread> recordThreads_;
+	std::vector<RecordContext> recordContexts_;  // The last one is for the render thread itself.
+	std::vector<InheritedState> inheritedState_;
+	std::vector<VkCommandBuffer> secondaryCmds_;
+	std::vector<int> recordJobs_;
+	const std::vector<VKRStep *> *recordSteps_ = nullptr;
+	int recordFrame_ = 0;
+	std::atomic<int> recordNext_{};
+
+	std::mutex recordMutex_;
+	std::condition_variable recordCond_;
+	std::condition_variable recordDoneCond_;
+	uint32_t recordGeneration_ = 0;
+	int recordBusy_ = 0;
+	bool recordStop_ = false;
 };
@@ -36,7 +36,8 @@ void CreateImage(VulkanContext *vulkan, VkCommandBuffer cmd, VKRImage &img, int
 	// Strictly speaking we don't yet need VK_IMAGE_USAGE_SAMPLED_BIT for depth buffers since we do not yet sample depth buffers.
 	ici.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 	if (color) {
-		ici.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		// Input attachment too, for shader blending. See VulkanQueueRunner::UsesColorInputAttachment.
+		ici.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
 	} else {
 		ici.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
 	}
@@ -219,11 +220,11 @@ void VulkanRenderManager::StopThread() {
 		for (int i = 0; i < vulkan_->GetInflightFrames(); i++) {
 			auto &frameData = frameData_[i];
 			{
-				std::unique_lock<std::mutex> lock(frameData.push_mutex);
+				std::unique_lock<ProfiledMutex> lock(frameData.push_mutex);
 				frameData.push_condVar.notify_all();
 			}
 			{
-				std::unique_lock<std::mutex> lock(frameData.pull_mutex);
+				std::unique_lock<ProfiledMutex> lock(frameData.pull_mutex);
 				frameData.pull_condVar.notify_all();
 			}
 			// Zero the queries so we don't try to pull them later.
@@ -244,6 +245,7 @@ void VulkanRenderManager::StopThread() {
 			_assert_(frameData.steps.empty());
 			if (frameData.hasInitCommands) {
 				// Clear 'em out.  This can happen on restart sometimes.
+				frameData.initBarriers.Clear();
 				vkEndCommandBuffer(frameData.initCmd);
 				frameData.hasInitCommands = false;
 			}
@@ -253,7 +255,7 @@ void VulkanRenderManager::StopThread() {
 			}
 			frameData.steps.clear();
 
-			std::unique_lock<std::mutex> lock(frameData.push_mutex);
+			std::unique_lock<ProfiledMutex> lock(frameData.push_mutex);
 			while (!frameData.readyForFence) {
 				VLOG("PUSH: Waiting for frame[%d].readyForFence = 1 (stop)", i);
 				frameData.push_condVar.wait(lock);
@@ -289,6 +291,12 @@ VulkanRenderManager::~VulkanRenderManager() {
 	StopThread();
 	vulkan_->WaitUntilQueueIdle();
 
+	// The destinations can't be trusted anymore, just free the staging buffers.
+	DiscardAsyncReadbacks();
+	for (int i = 0; i < vulkan_->GetInflightFrames(); i++) {
+		ResolveAsyncReadbacks(i);
+	}
+
 	VkDevice device = vulkan_->GetDevice();
 	vkDestroySemaphore(device, acquireSemaphore_, nullptr);
 	vkDestroySemaphore(device, renderingCompleteSemaphore_, nullptr);
@@ -316,7 +324,7 @@ void VulkanRenderManager::ThreadFunc() {
 					threadFrame = 0;
 			}
 			FrameData &frameData = frameData_[threadFrame];
-			std::unique_lock<std::mutex> lock(frameData.pull_mutex);
+			std::unique_lock<ProfiledMutex> lock(frameData.pull_mutex);
 			while (!frameData.readyForRun && run_) {
 				VLOG("PULL: Waiting for frame[%d].readyForRun", threadFrame);
 				frameData.pull_condVar.wait(lock);
@@ -359,7 +367,7 @@ void VulkanRenderManager::BeginFrame(bool enableProfiling) {
 
 	// Make sure the very last command buffer from the frame before the previous has been fully executed.
 	if (useThread_) {
-		std::unique_lock<std::mutex> lock(frameData.push_mutex);
+		std::unique_lock<ProfiledMutex> lock(frameData.push_mutex);
 		while (!frameData.readyForFence) {
 			VLOG("PUSH: Waiting for frame[%d].readyForFence = 1", curFrame);
 			frameData.push_condVar.wait(lock);
@@ -371,6 +379,9 @@ void VulkanRenderManager::BeginFrame(bool enableProfiling) {
 	vkWaitForFences(device, 1, &frameData.fence, true, UINT64_MAX);
 	vkResetFences(device, 1, &frameData.fence);
 
+	// Anything this frame read back last time around is now done.
+	ResolveAsyncReadbacks(curFrame);
+
 	uint64_t queryResults[MAX_TIMESTAMP_QUERIES];
 
 	if (frameData.profilingEnabled_) {
@@ -385,20 +396,17 @@ void VulkanRenderManager::BeginFrame(bool enableProfiling) {
 				double timestampConversionFactor = (double)vulkan_->GetPhysicalDeviceProperties().properties.limits.timestampPeriod * (1.0 / 1000000.0);
 				int validBits = vulkan_->GetQueueFamilyProperties(vulkan_->GetGraphicsQueueFamilyIndex()).timestampValidBits;
 				uint64_t timestampDiffMask = validBits == 64 ? 0xFFFFFFFFFFFFFFFFULL : ((1ULL << validBits) - 1);
-				std::stringstream str;
 
-				char line[256];
-				snprintf(line, sizeof(line), "Total GPU time: %0.3f ms\n", ((double)((queryResults[numQueries - 1] - queryResults[0]) & timestampDiffMask) * timestampConversionFactor));
-				str << line;
-				snprintf(line, sizeof(line), "Render CPU time: %0.3f ms\n", (frameData.profile.cpuEndTime - frameData.profile.cpuStartTime) * 1000.0);
-				str << line;
+				Draw::GPUProfile &results = frameData.profile.results;
+				results.gpuMilliseconds = (double)((queryResults[numQueries - 1] - queryResults[0]) & timestampDiffMask) * timestampConversionFactor;
+				results.cpuMilliseconds = (frameData.profile.cpuEndTime - frameData.profile.cpuStartTime) * 1000.0;
+				results.steps.clear();
 				for (int i = 0; i < numQueries - 1; i++) {
 					uint64_t diff = (queryResults[i + 1] - queryResults[i]) & timestampDiffMask;
-					double milliseconds = (double)diff * timestampConversionFactor;
-					snprintf(line, sizeof(line), "%s: %0.3f ms\n", frameData.profile.timestampDescriptions[i + 1].c_str(), milliseconds);
-					str << line;
+					results.steps.push_back({ frameData.profile.timestampDescriptions[i + 1], (double)diff * timestampConversionFactor });
 				}
-				frameData.profile.profileSummary = str.str();
+				frameData.profile.hasResults = true;
+				frameData.profile.profileSummary = Draw::GPUProfileToString(results);
 			} else {
 				frameData.profile.profileSummary = "(error getting GPU profile - not ready?)";
 			}
@@ -506,6 +514,7 @@ bool VulkanRenderManager::CopyFramebufferToMemorySync(VKRFramebuffer *src, int a
 	step->readback.src = src;
 	step->readback.srcRect.offset = { x, y };
 	step->readback.srcRect.extent = { (uint32_t)w, (uint32_t)h };
+	step->readback.async = nullptr;
 	steps_.push_back(step);
 
 	curRenderStep_ = nullptr;
@@ -552,6 +561,55 @@ bool VulkanRenderManager::CopyFramebufferToMemorySync(VKRFramebuffer *src, int a
 	return true;
 }
 
+bool VulkanRenderManager::CopyFramebufferToMemoryAsync(VKRFramebuffer *src, int aspectBits, int x, int y, int w, int h, Draw::DataFormat destFormat, uint8_t *pixels, int pixelStride) {
+	// Depth and stencil readbacks are rare and need format juggling, leave those to the sync path.
+	if (!src || aspectBits != VK_IMAGE_ASPECT_COLOR_BIT || src->color.format != VK_FORMAT_R8G8B8A8_UNORM)
+		return false;
+
+	for (int i = (int)steps_.size() - 1; i >= 0; i--) {
+		if (steps_[i]->stepType == VKRStepType::RENDER && steps_[i]->render.framebuffer == src) {
+			steps_[i]->render.numReads++;
+			break;
+		}
+	}
+
+	VKRAsyncReadback *readback = new VKRAsyncReadback();
+	readback->width = w;
+	readback->height = h;
+	readback->srcFormat = Draw::DataFormat::R8G8B8A8_UNORM;
+	readback->destFormat = destFormat;
+	readback->pixelStride = pixelStride;
+	readback->pixels = pixels;
+	frameData_[vulkan_->GetCurFrame()].asyncReadbacks.push_back(readback);
+
+	VKRStep *step = new VKRStep{ VKRStepType::READBACK };
+	step->readback.aspectMask = aspectBits;
+	step->readback.src = src;
+	step->readback.srcRect.offset = { x, y };
+	step->readback.srcRect.extent = { (uint32_t)w, (uint32_t)h };
+	step->readback.async = readback;
+	steps_.push_back(step);
+
+	curRenderStep_ = nullptr;
+	return true;
+}
+
+void VulkanRenderManager::ResolveAsyncReadbacks(int frame) {
+	FrameData &frameData = frameData_[frame];
+	for (VKRAsyncReadback *readback : frameData.asyncReadbacks) {
+		queueRunner_.CopyAsyncReadback(readback);
+	}
+	frameData.asyncReadbacks.clear();
+}
+
+void VulkanRenderManager::DiscardAsyncReadbacks() {
+	for (int i = 0; i < vulkan_->GetInflightFrames(); i++) {
+		for (VKRAsyncReadback *readback : frameData_[i].asyncReadbacks) {
+			readback->pixels = nullptr;
+		}
+	}
+}
+
 void VulkanRenderManager::CopyImageToMemorySync(VkImage image, int mipLevel, int x, int y, int w, int h, Draw::DataFormat destFormat, uint8_t *pixels, int pixelStride) {
 	VKRStep *step = new VKRStep{ VKRStepType::READBACK_IMAGE };
 	step->readback_image.image = image;
@@ -899,13 +957,14 @@ void VulkanRenderManager::Finish() {
 
 	int curFrame = vulkan_->GetCurFrame();
 	FrameData &frameData = frameData_[curFrame];
+	frameData.serial = frameSerial_++;
 	if (!useThread_) {
 		frameData.steps = std::move(steps_);
 		steps_.clear();
 		frameData.type = VKRRunType::END;
 		Run(curFrame);
 	} else {
-		std::unique_lock<std::mutex> lock(frameData.pull_mutex);
+		std::unique_lock<ProfiledMutex> lock(frameData.pull_mutex);
 		VLOG("PUSH: Frame[%d].readyForRun = true", curFrame);
 		frameData.steps = std::move(steps_);
 		steps_.clear();
@@ -959,6 +1018,7 @@ void VulkanRenderManager::BeginSubmitFrame(int frame) {
 void VulkanRenderManager::Submit(int frame, bool triggerFence) {
 	FrameData &frameData = frameData_[frame];
 	if (frameData.hasInitCommands) {
+		frameData.initBarriers.Flush(frameData.initCmd);
 		if (frameData.profilingEnabled_ && triggerFence) {
 			// Pre-allocated query ID 1.
 			vkCmdWriteTimestamp(frameData.initCmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frameData.profile.queryPool, 1);
@@ -1022,7 +1082,7 @@ void VulkanRenderManager::Submit(int frame, bool triggerFence) {
 	// When !triggerFence, we notify after syncing with Vulkan.
 	if (useThread_ && triggerFence) {
 		VLOG("PULL: Frame %d.readyForFence = true", frame);
-		std::unique_lock<std::mutex> lock(frameData.push_mutex);
+		std::unique_lock<ProfiledMutex> lock(frameData.push_mutex);
 		frameData.readyForFence = true;
 		frameData.push_condVar.notify_all();
 	}
@@ -1050,8 +1110,12 @@ void VulkanRenderManager::EndSubmitFrame(int frame) {
 		} else {
 			_assert_msg_(G3D, res == VK_SUCCESS, "vkQueuePresentKHR failed! result=%s", VulkanResultToString(res));
 		}
+		if (presentCallback_)
+			presentCallback_(frameData.serial, true);
 	} else {
 		frameData.skipSwap = false;
+		if (presentCallback_)
+			presentCallback_(frameData.serial, false);
 	}
 }
 
@@ -1062,7 +1126,7 @@ void VulkanRenderManager::Run(int frame) {
 	auto &stepsOnThread = frameData_[frame].steps;
 	VkCommandBuffer cmd = frameData.mainCmd;
 	// queueRunner_.LogSteps(stepsOnThread);
-	queueRunner_.RunSteps(cmd, stepsOnThread, frameData.profilingEnabled_ ? &frameData.profile : nullptr);
+	queueRunner_.RunSteps(cmd, stepsOnThread, frame, frameData.profilingEnabled_ ? &frameData.profile : nullptr);
 	stepsOnThread.clear();
 
 	switch (frameData.type) {
@@ -1101,7 +1165,7 @@ void VulkanRenderManager::EndSyncFrame(int frame) {
 	_assert_(res == VK_SUCCESS);
 
 	if (useThread_) {
-		std::unique_lock<std::mutex> lock(frameData.push_mutex);
+		std::unique_lock<ProfiledMutex> lock(frameData.push_mutex);
 		frameData.readyForFence = true;
 		frameData.push_condVar.notify_all();
 	}
@@ -1117,7 +1181,7 @@ void VulkanRenderManager::FlushSync() {
 		frameData.type = VKRRunType::SYNC;
 		Run(curFrame);
 	} else {
-		std::unique_lock<std::mutex> lock(frameData.pull_mutex);
+		std::unique_lock<ProfiledMutex> lock(frameData.pull_mutex);
 		VLOG("PUSH: Frame[%d].readyForRun = true (sync)", curFrame);
 		frameData.steps = std::move(steps_);
 		steps_.clear();
@@ -1128,7 +1192,7 @@ void VulkanRenderManager::FlushSync() {
 	}
 
 	if (useThread_) {
-		std::unique_lock<std::mutex> lock(frameData.push_mutex);
+		std::unique_lock<ProfiledMutex> lock(frameData.push_mutex);
 		// Wait for the flush to be hit, since we're syncing.
 		while (!frameData.readyForFence) {
 			VLOG("PUSH: Waiting for frame[%d].readyForFence = 1 (sync)", curFrame);
@@ -1136,4 +1200,10 @@ void VulkanRenderManager::FlushSync() {
 		}
 		frameData.readyForFence = false;
 	}
+
+	// The device is idle now, so every pending async readback has landed. Oldest first.
+	int inflightFrames = vulkan_->GetInflightFrames();
+	for (int i = 1; i <= inflightFrames; i++) {
+		ResolveAsyncReadbacks((curFrame + i) % inflightFrames);
+	}
 }
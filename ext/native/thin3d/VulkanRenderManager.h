@@ -16,6 +16,7 @@
 #include "math/math_util.h"
 #include "thin3d/DataFormat.h"
 #include "thin3d/VulkanQueueRunner.h"
+#include "thread/profiledmutex.h"
 
 // Simple independent framebuffer image. Gets its own allocation, we don't have that many framebuffers so it's fine
 // to let them have individual non-pooled allocations. Until it's not fine. We'll see.
@@ -76,6 +77,8 @@ class VKRFramebuffer {
 	VKRImage depth{};
 	int width = 0;
 	int height = 0;
+	// Only used by the queue runner. Until something has been written, there's nothing to load.
+	bool contentsDefined = false;
 
 	VulkanContext *vulkan_;
 };
@@ -109,6 +112,11 @@ class VulkanRenderManager {
 	VkImageView BindFramebufferAsTexture(VKRFramebuffer *fb, int binding, int aspectBit, int attachment);
 	bool CopyFramebufferToMemorySync(VKRFramebuffer *src, int aspectBits, int x, int y, int w, int h, Draw::DataFormat destFormat, uint8_t *pixels, int pixelStride);
 	void CopyImageToMemorySync(VkImage image, int mipLevel, int x, int y, int w, int h, Draw::DataFormat destFormat, uint8_t *pixels, int pixelStride);
+	// Doesn't stall. pixels is written when this frame's slot comes around again, or at the next sync.
+	// Only color readbacks from framebuffers are supported, returns false otherwise.
+	bool CopyFramebufferToMemoryAsync(VKRFramebuffer *src, int aspectBits, int x, int y, int w, int h, Draw::DataFormat destFormat, uint8_t *pixels, int pixelStride);
+	// Call when the memory pending async readbacks point to is about to go away.
+	void DiscardAsyncReadbacks();
 
 	void CopyFramebuffer(VKRFramebuffer *src, VkRect2D srcRect, VKRFramebuffer *dst, VkOffset2D dstPos, int aspectMask);
 	void BlitFramebuffer(VKRFramebuffer *src, VkRect2D srcRect, VKRFramebuffer *dst, VkRect2D dstRect, int aspectMask, VkFilter filter);
@@ -177,6 +185,20 @@ class VulkanRenderManager {
 
 	void Clear(uint32_t clearColor, float clearZ, int clearStencil, int clearMask);
 
+	// Needed before each draw that reads the color input attachment, since earlier draws in the pass may have written it.
+	void SelfDependencyBarrier() {
+		_dbg_assert_(G3D, curRenderStep_ && curRenderStep_->stepType == VKRStepType::RENDER);
+		VkRenderData data{ VKRRenderCommand::SELF_DEPENDENCY_BARRIER };
+		curRenderStep_->commands.push_back(data);
+	}
+
+	// The view to bind as the color input attachment, or VK_NULL_HANDLE when drawing to the backbuffer.
+	VkImageView GetColorInputView() const {
+		if (!curRenderStep_ || !curRenderStep_->render.framebuffer)
+			return VK_NULL_HANDLE;
+		return curRenderStep_->render.framebuffer->color.imageView;
+	}
+
 	void Draw(VkPipelineLayout layout, VkDescriptorSet descSet, int numUboOffsets, const uint32_t *uboOffsets, VkBuffer vbuffer, int voffset, int count) {
 		_dbg_assert_(G3D, curRenderStep_ && curRenderStep_->stepType == VKRStepType::RENDER);
 		VkRenderData data{ VKRRenderCommand::DRAW };
@@ -214,6 +236,8 @@ class VulkanRenderManager {
 	}
 
 	VkCommandBuffer GetInitCmd();
+	// Transitions queued here are recorded at the end of the init command buffer, in one barrier.
+	VulkanBarrier &GetInitBarriers() { return frameData_[vulkan_->GetCurFrame()].initBarriers; }
 
 	VkRenderPass GetBackbufferRenderPass() {
 		return queueRunner_.GetBackbufferRenderPass();
@@ -221,6 +245,9 @@ class VulkanRenderManager {
 	VkRenderPass GetFramebufferRenderPass() {
 		return queueRunner_.GetFramebufferRenderPass();
 	}
+	bool UsesColorInputAttachment() const {
+		return queueRunner_.UsesColorInputAttachment();
+	}
 	VkRenderPass GetCompatibleRenderPass() {
 		if (curRenderStep_ && curRenderStep_->render.framebuffer != nullptr) {
 			return queueRunner_.GetFramebufferRenderPass();
@@ -252,6 +279,24 @@ class VulkanRenderManager {
 	std::string GetGpuProfileString() const {
 		return frameData_[vulkan_->GetCurFrame()].profile.profileSummary;
 	}
+	// Called on the render thread after each finished frame is presented (or skipped its swap), in order.
+	// The serial is what GetFrameSerial() returned while that frame was being recorded.
+	void SetPresentCallback(std::function<void(uint64_t serial, bool presented)> callback) {
+		presentCallback_ = callback;
+	}
+	uint64_t GetFrameSerial() const {
+		return frameSerial_;
+	}
+
+	// Returns false if there's nothing new since the last call.
+	bool TakeGpuProfile(Draw::GPUProfile *profile) {
+		QueueProfileContext &ctx = frameData_[vulkan_->GetCurFrame()].profile;
+		if (!ctx.hasResults)
+			return false;
+		*profile = std::move(ctx.results);
+		ctx.hasResults = false;
+		return true;
+	}
 
 private:
 	bool InitBackbufferFramebuffers(int width, int height);
@@ -263,6 +308,7 @@ class VulkanRenderManager {
 	// Bad for performance but sometimes necessary for synchronous CPU readbacks (screenshots and whatnot).
 	void FlushSync();
 	void EndSyncFrame(int frame);
+	void ResolveAsyncReadbacks(int frame);
 
 	void StopThread();
 
@@ -272,16 +318,18 @@ class VulkanRenderManager {
 
 	// Per-frame data, round-robin so we can overlap submission with execution of the previous frame.
 	struct FrameData {
-		std::mutex push_mutex;
-		std::condition_variable push_condVar;
+		// Profiled, since the emu and render threads hand frames back and forth with these.
+		ProfiledMutex push_mutex{ "VulkanRender push" };
+		std::condition_variable_any push_condVar;
 
-		std::mutex pull_mutex;
-		std::condition_variable pull_condVar;
+		ProfiledMutex pull_mutex{ "VulkanRender pull" };
+		std::condition_variable_any pull_condVar;
 
 		bool readyForFence = true;
 		bool readyForRun = false;
 		bool skipSwap = false;
 		VKRRunType type = VKRRunType::END;
+		uint64_t serial = 0;
 
 		VkFence fence;
 		// These are on different threads so need separate pools.
@@ -290,7 +338,11 @@ class VulkanRenderManager {
 		VkCommandBuffer initCmd;
 		VkCommandBuffer mainCmd;
 		bool hasInitCommands = false;
+		// Flushed into initCmd right before it's ended.
+		VulkanBarrier initBarriers;
 		std::vector<VKRStep *> steps;
+		// Only touched on the emu thread.
+		std::vector<VKRAsyncReadback *> asyncReadbacks;
 
 		// Swapchain.
 		bool hasBegun = false;
@@ -337,4 +389,7 @@ class VulkanRenderManager {
 
 	// This works great - except see issue #10097. WTF?
 	bool useThread_ = true;
+
+	std::function<void(uint64_t, bool)> presentCallback_;
+	uint64_t frameSerial_ = 0;
 };
@@ -1,6 +1,7 @@
 #include <cassert>
 #include <cstring>
 #include <cstdint>
+#include <sstream>
 
 #include "base/logging.h"
 #include "base/display.h"
@@ -535,5 +536,34 @@ void ConvertToD32F(uint8_t *dst, const uint8_t *src, uint32_t dstStride, uint32_
 	}
 }
 
+bool DrawContext::GetGPUProfile(GPUProfile *profile) {
+	std::lock_guard<std::mutex> guard(profileLock_);
+	if (!hasProfile_)
+		return false;
+	*profile = profile_;
+	return true;
+}
+
+void DrawContext::PublishGPUProfile(GPUProfile &&profile) {
+	std::lock_guard<std::mutex> guard(profileLock_);
+	profile_ = std::move(profile);
+	hasProfile_ = true;
+}
+
+std::string GPUProfileToString(const GPUProfile &profile) {
+	std::stringstream str;
+	char line[256];
+	snprintf(line, sizeof(line), "Total GPU time: %0.3f ms\n", profile.gpuMilliseconds);
+	str << line;
+	if (profile.cpuMilliseconds > 0.0) {
+		snprintf(line, sizeof(line), "Render CPU time: %0.3f ms\n", profile.cpuMilliseconds);
+		str << line;
+	}
+	for (const GPUProfileStep &step : profile.steps) {
+		snprintf(line, sizeof(line), "%s: %0.3f ms\n", step.name.c_str(), step.milliseconds);
+		str << line;
+	}
+	return str.str();
+}
 
 }  // namespace Draw
@@ -6,8 +6,11 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <cstddef>
+#include <functional>
+#include <mutex>
 #include <vector>
 #include <string>
 
@@ -545,6 +548,21 @@ struct RenderPassInfo {
 	uint8_t clearStencil;
 };
 
+struct GPUProfileStep {
+	std::string name;
+	double milliseconds;
+};
+
+// Timestamp query results from a recent frame. Steps are render passes, copies and so on, in submission order.
+struct GPUProfile {
+	double gpuMilliseconds = 0.0;
+	// Time the render thread spent issuing the steps, or 0 if not measured.
+	double cpuMilliseconds = 0.0;
+	std::vector<GPUProfileStep> steps;
+};
+
+std::string GPUProfileToString(const GPUProfile &profile);
+
 class DrawContext {
 public:
 	virtual ~DrawContext();
@@ -591,6 +609,12 @@ class DrawContext {
 	virtual bool CopyFramebufferToMemorySync(Framebuffer *src, int channelBits, int x, int y, int w, int h, Draw::DataFormat format, void *pixels, int pixelStride) {
 		return false;
 	}
+	// Like the above, but pixels is only written once the GPU gets to it, a frame or more later. Returns false if not supported.
+	virtual bool CopyFramebufferToMemoryAsync(Framebuffer *src, int channelBits, int x, int y, int w, int h, Draw::DataFormat format, void *pixels, int pixelStride) {
+		return false;
+	}
+	// Drops the destinations of pending async copies, use before that memory goes away.
+	virtual void DiscardAsyncCopies() {}
 	virtual DataFormat PreferredFramebufferReadbackFormat(Framebuffer *src) {
 		return DataFormat::R8G8B8A8_UNORM;
 	}
@@ -663,7 +687,25 @@ class DrawContext {
 	// Flush state like scissors etc so the caller can do its own custom drawing.
 	virtual void FlushState() {}
 
+	// Returns false if nothing has been measured, e.g. when unsupported or profiling is off. Safe from any thread.
+	bool GetGPUProfile(GPUProfile *profile);
+	// Keeps timestamp profiling on even when the profile isn't shown.  Counted, so calls must be paired.
+	void RequestGPUProfiling(bool request) {
+		profilingRequests_ += request ? 1 : -1;
+	}
+
+	// Counts frames as they're recorded, so they can be matched up with presents.  Only GL and Vulkan report presents.
+	virtual uint64_t GetFrameSerial() const { return 0; }
+	// Set before the first frame.  Called (maybe on another thread) after each frame is presented or skipped its swap.
+	virtual void SetPresentCallback(std::function<void(uint64_t serial, bool presented)> callback) {}
+
 protected:
+	// Backends call this as results come in.
+	void PublishGPUProfile(GPUProfile &&profile);
+	bool GPUProfilingRequested() const {
+		return profilingRequests_ > 0;
+	}
+
 	ShaderModule *vsPresets_[VS_MAX_PRESET];
 	ShaderModule *fsPresets_[FS_MAX_PRESET];
 
@@ -671,6 +713,12 @@ class DrawContext {
 	int targetHeight_;
 
 	Bugs bugs_;
+
+private:
+	std::mutex profileLock_;
+	GPUProfile profile_;
+	bool hasProfile_ = false;
+	std::atomic<int> profilingRequests_{ 0 };
 };
 
 extern const UniformBufferDesc UBPresetDesc;
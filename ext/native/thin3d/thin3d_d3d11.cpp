@@ -7,10 +7,12 @@
 #include "thin3d/d3d11_loader.h"
 #endif
 #include "base/display.h"
+#include "base/timeutil.h"
 #include "math/dataconv.h"
 #include "util/text/utf8.h"
 
 #include "Common/ColorConv.h"
+#include "Core/Config.h"
 
 #include <cassert>
 #include <cfloat>
@@ -106,6 +108,7 @@ class D3D11DrawContext : public DrawContext {
 	void Clear(int mask, uint32_t colorval, float depthVal, int stencilVal);
 
 	void BeginFrame() override;
+	void EndFrame() override;
 
 	std::string GetInfoString(InfoField info) const override {
 		switch (info) {
@@ -161,6 +164,26 @@ class D3D11DrawContext : public DrawContext {
 private:
 	void ApplyCurrentState();
 
+	enum {
+		PROFILE_FRAMES = 3,
+		MAX_PROFILE_TIMESTAMPS = 64,
+	};
+
+	// Timestamp queries for one frame. Read back PROFILE_FRAMES later, without flushing or waiting.
+	struct ProfileFrame {
+		ID3D11Query *disjoint = nullptr;
+		ID3D11Query *timestamps[MAX_PROFILE_TIMESTAMPS]{};
+		std::vector<std::string> descriptions;
+		double cpuStartTime = 0.0;
+		double cpuEndTime = 0.0;
+		bool pending = false;
+	};
+
+	bool CreateProfileQueries(ProfileFrame &frame);
+	void CollectProfile(ProfileFrame &frame);
+	// Marks the end of the work done on the current render target.
+	void WriteProfileTimestamp();
+
 	HWND hWnd_;
 	ID3D11Device *device_;
 	ID3D11DeviceContext *context_;
@@ -209,6 +232,10 @@ class D3D11DrawContext : public DrawContext {
 	// Temporaries
 	ID3D11Texture2D *packTexture_ = nullptr;
 
+	ProfileFrame profileFrames_[PROFILE_FRAMES];
+	int curProfileFrame_ = 0;
+	bool profiling_ = false;
+
 	// System info
 	D3D_FEATURE_LEVEL featureLevel_;
 	std::string adapterDesc_;
@@ -287,6 +314,16 @@ D3D11DrawContext::D3D11DrawContext(ID3D11Device *device, ID3D11DeviceContext *de
 D3D11DrawContext::~D3D11DrawContext() {
 	packTexture_->Release();
 
+	for (int i = 0; i < PROFILE_FRAMES; i++) {
+		ProfileFrame &frame = profileFrames_[i];
+		if (frame.disjoint)
+			frame.disjoint->Release();
+		for (int j = 0; j < MAX_PROFILE_TIMESTAMPS; j++) {
+			if (frame.timestamps[j])
+				frame.timestamps[j]->Release();
+		}
+	}
+
 	// Release references.
 	ID3D11RenderTargetView *view = nullptr;
 	context_->OMSetRenderTargets(1, &view, nullptr);
@@ -1236,7 +1273,76 @@ void D3D11DrawContext::Clear(int mask, uint32_t colorval, float depthVal, int st
 	}
 }
 
+bool D3D11DrawContext::CreateProfileQueries(ProfileFrame &frame) {
+	if (frame.disjoint)
+		return true;
+	D3D11_QUERY_DESC desc{};
+	desc.Query = D3D11_QUERY_TIMESTAMP;
+	for (int i = 0; i < MAX_PROFILE_TIMESTAMPS; i++) {
+		if (!frame.timestamps[i] && FAILED(device_->CreateQuery(&desc, &frame.timestamps[i])))
+			return false;
+	}
+	// Created last, so it marks the whole set as ready.
+	desc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+	return SUCCEEDED(device_->CreateQuery(&desc, &frame.disjoint));
+}
+
+void D3D11DrawContext::CollectProfile(ProfileFrame &frame) {
+	frame.pending = false;
+	int numTimestamps = (int)frame.descriptions.size();
+	if (numTimestamps < 2)
+		return;
+
+	// If the GPU hasn't gotten there yet, just drop this frame rather than stall.
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+	if (context_->GetData(frame.disjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK || disjoint.Disjoint)
+		return;
+	UINT64 timestamps[MAX_PROFILE_TIMESTAMPS];
+	for (int i = 0; i < numTimestamps; i++) {
+		if (context_->GetData(frame.timestamps[i], &timestamps[i], sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			return;
+	}
+
+	double toMilliseconds = 1000.0 / (double)disjoint.Frequency;
+	GPUProfile profile;
+	profile.gpuMilliseconds = (double)(timestamps[numTimestamps - 1] - timestamps[0]) * toMilliseconds;
+	profile.cpuMilliseconds = (frame.cpuEndTime - frame.cpuStartTime) * 1000.0;
+	for (int i = 1; i < numTimestamps; i++) {
+		profile.steps.push_back({ frame.descriptions[i], (double)(timestamps[i] - timestamps[i - 1]) * toMilliseconds });
+	}
+	PublishGPUProfile(std::move(profile));
+}
+
+void D3D11DrawContext::WriteProfileTimestamp() {
+	ProfileFrame &frame = profileFrames_[curProfileFrame_];
+	if (frame.descriptions.size() >= MAX_PROFILE_TIMESTAMPS)
+		return;
+	char buffer[64];
+	if (curRenderTargetView_ == bbRenderTargetView_)
+		snprintf(buffer, sizeof(buffer), "RenderPass (backbuffer, %dx%d)", curRTWidth_, curRTHeight_);
+	else
+		snprintf(buffer, sizeof(buffer), "RenderPass (%dx%d)", curRTWidth_, curRTHeight_);
+	context_->End(frame.timestamps[frame.descriptions.size()]);
+	frame.descriptions.push_back(buffer);
+}
+
 void D3D11DrawContext::BeginFrame() {
+	profiling_ = false;
+	if (g_Config.bShowGpuProfile || GPUProfilingRequested()) {
+		curProfileFrame_ = (curProfileFrame_ + 1) % PROFILE_FRAMES;
+		ProfileFrame &frame = profileFrames_[curProfileFrame_];
+		if (frame.pending)
+			CollectProfile(frame);
+		if (CreateProfileQueries(frame)) {
+			profiling_ = true;
+			frame.descriptions.clear();
+			frame.cpuStartTime = real_time_now();
+			context_->Begin(frame.disjoint);
+			context_->End(frame.timestamps[0]);
+			frame.descriptions.push_back("Begin");
+		}
+	}
+
 	context_->OMSetRenderTargets(1, &curRenderTargetView_, curDepthStencilView_);
 
 	if (curBlend_) {
@@ -1438,8 +1544,21 @@ bool D3D11DrawContext::CopyFramebufferToMemorySync(Framebuffer *src, int channel
 	return true;
 }
 
+void D3D11DrawContext::EndFrame() {
+	if (!profiling_)
+		return;
+	ProfileFrame &frame = profileFrames_[curProfileFrame_];
+	WriteProfileTimestamp();
+	context_->End(frame.disjoint);
+	frame.cpuEndTime = real_time_now();
+	frame.pending = true;
+	profiling_ = false;
+}
+
 void D3D11DrawContext::BindFramebufferAsRenderTarget(Framebuffer *fbo, const RenderPassInfo &rp) {
 	// TODO: deviceContext1 can actually discard. Useful on Windows Mobile.
+	if (profiling_ && curRenderTargetView_)
+		WriteProfileTimestamp();
 	if (fbo) {
 		D3D11Framebuffer *fb = (D3D11Framebuffer *)fbo;
 		if (curRenderTargetView_ == fb->colorRTView && curDepthStencilView_ == fb->depthStencilRTView) {
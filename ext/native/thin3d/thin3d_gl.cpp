@@ -6,6 +6,7 @@
 #include <cassert>
 
 #include "base/logging.h"
+#include "Core/Config.h"
 #include "math/dataconv.h"
 #include "math/math_util.h"
 #include "math/lin/matrix4x4.h"
@@ -475,6 +476,13 @@ class OpenGLContext : public DrawContext {
 		}
 	}
 
+	uint64_t GetFrameSerial() const override {
+		return renderManager_.GetFrameSerial();
+	}
+	void SetPresentCallback(std::function<void(uint64_t serial, bool presented)> callback) override {
+		renderManager_.SetPresentCallback(callback);
+	}
+
 	void HandleEvent(Event ev, int width, int height, void *param1, void *param2) override {}
 
 private:
@@ -525,6 +533,8 @@ static bool HasIntelDualSrcBug(int versions[4]) {
 }
 
 OpenGLContext::OpenGLContext() {
+	renderManager_.SetInflightFrames(g_Config.iInflightFrames);
+
 	// TODO: Detect more caps
 	if (gl_extensions.IsGLES) {
 		if (gl_extensions.OES_packed_depth_stencil || gl_extensions.OES_depth24) {
@@ -598,7 +608,10 @@ OpenGLContext::~OpenGLContext() {
 }
 
 void OpenGLContext::BeginFrame() {
-	renderManager_.BeginFrame();
+	renderManager_.BeginFrame(g_Config.bShowGpuProfile || GPUProfilingRequested());
+	Draw::GPUProfile profile;
+	if (renderManager_.TakeGpuProfile(&profile))
+		PublishGPUProfile(std::move(profile));
 	FrameData &frameData = frameData_[renderManager_.GetCurFrame()];
 	renderManager_.BeginPushBuffer(frameData.push);
 }
@@ -378,6 +378,10 @@ class VKContext : public DrawContext {
 	void CopyFramebufferImage(Framebuffer *src, int level, int x, int y, int z, Framebuffer *dst, int dstLevel, int dstX, int dstY, int dstZ, int width, int height, int depth, int channelBits) override;
 	bool BlitFramebuffer(Framebuffer *src, int srcX1, int srcY1, int srcX2, int srcY2, Framebuffer *dst, int dstX1, int dstY1, int dstX2, int dstY2, int channelBits, FBBlitFilter filter) override;
 	bool CopyFramebufferToMemorySync(Framebuffer *src, int channelBits, int x, int y, int w, int h, Draw::DataFormat format, void *pixels, int pixelStride) override;
+	bool CopyFramebufferToMemoryAsync(Framebuffer *src, int channelBits, int x, int y, int w, int h, Draw::DataFormat format, void *pixels, int pixelStride) override;
+	void DiscardAsyncCopies() override {
+		renderManager_.DiscardAsyncReadbacks();
+	}
 	DataFormat PreferredFramebufferReadbackFormat(Framebuffer *src) override;
 
 	// These functions should be self explanatory.
@@ -476,6 +480,13 @@ class VKContext : public DrawContext {
 		}
 	}
 
+	uint64_t GetFrameSerial() const override {
+		return renderManager_.GetFrameSerial();
+	}
+	void SetPresentCallback(std::function<void(uint64_t serial, bool presented)> callback) override {
+		renderManager_.SetPresentCallback(callback);
+	}
+
 	void HandleEvent(Event ev, int width, int height, void *param1, void *param2) override;
 
 private:
@@ -856,7 +867,10 @@ VKContext::~VKContext() {
 }
 
 void VKContext::BeginFrame() {
-	renderManager_.BeginFrame(g_Config.bShowGpuProfile);
+	renderManager_.BeginFrame(g_Config.bShowGpuProfile || GPUProfilingRequested());
+	Draw::GPUProfile profile;
+	if (renderManager_.TakeGpuProfile(&profile))
+		PublishGPUProfile(std::move(profile));
 
 	FrameData &frame = frame_[vulkan_->GetCurFrame()];
 	push_ = frame.pushBuffer;
@@ -1281,6 +1295,8 @@ void VKContext::Clear(int clearMask, uint32_t colorval, float depthVal, int sten
 }
 
 DrawContext *T3DCreateVulkanContext(VulkanContext *vulkan, bool split) {
+	// Must be set before the render manager allocates its per-frame resources.
+	vulkan->SetInflightFrames(g_Config.iInflightFrames);
 	return new VKContext(vulkan, split);
 }
 
@@ -1445,6 +1461,14 @@ bool VKContext::CopyFramebufferToMemorySync(Framebuffer *srcfb, int channelBits,
 	return renderManager_.CopyFramebufferToMemorySync(src ? src->GetFB() : nullptr, aspectMask, x, y, w, h, format, (uint8_t *)pixels, pixelStride);
 }
 
+bool VKContext::CopyFramebufferToMemoryAsync(Framebuffer *srcfb, int channelBits, int x, int y, int w, int h, Draw::DataFormat format, void *pixels, int pixelStride) {
+	VKFramebuffer *src = (VKFramebuffer *)srcfb;
+	// Only color is supported, see VulkanRenderManager::CopyFramebufferToMemoryAsync.
+	if (channelBits != FBChannel::FB_COLOR_BIT || !src)
+		return false;
+	return renderManager_.CopyFramebufferToMemoryAsync(src->GetFB(), VK_IMAGE_ASPECT_COLOR_BIT, x, y, w, h, format, (uint8_t *)pixels, pixelStride);
+}
+
 DataFormat VKContext::PreferredFramebufferReadbackFormat(Framebuffer *src) {
 	if (src) {
 		return DrawContext::PreferredFramebufferReadbackFormat(src);
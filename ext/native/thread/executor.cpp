@@ -1,4 +1,5 @@
 #include "thread/executor.h"
+#include "thread/threadutil.h"
 
 #include <functional>
 #include <thread>
@@ -13,4 +14,49 @@ void NewThreadExecutor::Run(std::function<void()> func) {
 	std::thread(func).detach();
 }
 
+BoundedThreadExecutor::BoundedThreadExecutor(int maxThreads, const char *threadName)
+	: maxThreads_(maxThreads < 1 ? 1 : maxThreads), threadName_(threadName) {
+}
+
+BoundedThreadExecutor::~BoundedThreadExecutor() {
+	{
+		std::lock_guard<std::mutex> guard(mutex_);
+		done_ = true;
+	}
+	wake_.notify_all();
+	for (std::thread &t : threads_) {
+		t.join();
+	}
+}
+
+void BoundedThreadExecutor::Run(std::function<void()> func) {
+	std::lock_guard<std::mutex> guard(mutex_);
+	queue_.push_back(std::move(func));
+	// Only start another thread if the idle ones can't take everything queued.
+	if ((int)queue_.size() > idle_ && (int)threads_.size() < maxThreads_) {
+		threads_.push_back(std::thread(&BoundedThreadExecutor::WorkFunc, this));
+	} else {
+		wake_.notify_one();
+	}
+}
+
+void BoundedThreadExecutor::WorkFunc() {
+	setCurrentThreadName(threadName_);
+
+	std::unique_lock<std::mutex> guard(mutex_);
+	while (true) {
+		idle_++;
+		wake_.wait(guard, [&] { return !queue_.empty() || done_; });
+		idle_--;
+		if (queue_.empty())
+			break;
+
+		std::function<void()> func = std::move(queue_.front());
+		queue_.pop_front();
+		guard.unlock();
+		func();
+		guard.lock();
+	}
+}
+
 }  // namespace threading
@@ -1,12 +1,18 @@
 #pragma once
 
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace threading {
 
 // Stuff that can execute other stuff, like threadpools, should inherit from this.
 class Executor {
 public:
+	virtual ~Executor() {}
 	virtual void Run(std::function<void()> func) = 0;
 };
 
@@ -20,4 +26,28 @@ class NewThreadExecutor : public Executor {
 	void Run(std::function<void()> func) override;
 };
 
+// Runs things on up to maxThreads threads, which stick around to be reused.
+// When they're all busy, the rest wait their turn in order.
+class BoundedThreadExecutor : public Executor {
+public:
+	BoundedThreadExecutor(int maxThreads, const char *threadName);
+	// Finishes everything already queued first.
+	~BoundedThreadExecutor();
+
+	void Run(std::function<void()> func) override;
+
+private:
+	void WorkFunc();
+
+	int maxThreads_;
+	const char *threadName_;
+
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::deque<std::function<void()>> queue_;
+	std::vector<std::thread> threads_;
+	int idle_ = 0;
+	bool done_ = false;
+};
+
 }  // namespace threading
@@ -1,9 +1,11 @@
 #include <functional>
 #include <thread>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/timeutil.h"
 #include "thread/prioritizedworkqueue.h"
+#include "thread/threadutil.h"
 
 PrioritizedWorkQueue::~PrioritizedWorkQueue() {
 	if (!done_) {
@@ -20,7 +22,7 @@ void PrioritizedWorkQueue::Add(PrioritizedWorkQueueItem *item) {
 void PrioritizedWorkQueue::Stop() {
 	std::lock_guard<std::mutex> guard(mutex_);
 	done_ = true;
-	notEmpty_.notify_one();
+	notEmpty_.notify_all();
 }
 
 void PrioritizedWorkQueue::Flush() {
@@ -56,24 +58,26 @@ bool PrioritizedWorkQueue::WaitUntilDone(bool all) {
 
 void PrioritizedWorkQueue::NotifyDrain() {
 	std::lock_guard<std::mutex> guard(drainMutex_);
-	drain_.notify_one();
+	drain_.notify_all();
 }
 
 bool PrioritizedWorkQueue::AllItemsDone() {
 	std::lock_guard<std::mutex> guard(mutex_);
-	return queue_.empty() && !working_;
+	return queue_.empty() && working_ == 0;
 }
 
-// The worker should simply call this in a loop. Will block when appropriate.
-PrioritizedWorkQueueItem *PrioritizedWorkQueue::Pop() {
+void PrioritizedWorkQueue::ItemDone() {
 	{
 		std::lock_guard<std::mutex> guard(mutex_);
-		working_ = false;  // The thread only calls Pop if it's done.
+		working_--;
 	}
 
 	// Important: make sure mutex_ is not locked while draining.
 	NotifyDrain();
+}
 
+// The workers should simply call this in a loop. Will block when appropriate.
+PrioritizedWorkQueueItem *PrioritizedWorkQueue::Pop() {
 	std::unique_lock<std::mutex> guard(mutex_);
 	if (done_) {
 		return 0;
@@ -99,7 +103,7 @@ PrioritizedWorkQueueItem *PrioritizedWorkQueue::Pop() {
 	if (best != queue_.end()) {
 		PrioritizedWorkQueueItem *poppedItem = *best;
 		queue_.erase(best);
-		working_ = true;  // This will be worked on.
+		working_++;  // This will be worked on.
 		return poppedItem;
 	} else {
 		// Not really sure how this can happen, but let's be safe.
@@ -109,10 +113,11 @@ PrioritizedWorkQueueItem *PrioritizedWorkQueue::Pop() {
 
 // TODO: This feels ugly. Revisit later.
 
-static std::thread *workThread;
+static std::vector<std::thread> workThreads;
 
 static void threadfunc(PrioritizedWorkQueue *wq) {
 	setCurrentThreadName("PrioQueue");
+	setCurrentThreadRole(ThreadRole::BACKGROUND);
 	while (true) {
 		PrioritizedWorkQueueItem *item = wq->Pop();
 		if (!item) {
@@ -121,19 +126,21 @@ static void threadfunc(PrioritizedWorkQueue *wq) {
 		} else {
 			item->run();
 			delete item;
+			wq->ItemDone();
 		}
 	}
 }
 
-void ProcessWorkQueueOnThreadWhile(PrioritizedWorkQueue *wq) {
-	workThread = new std::thread([=](){threadfunc(wq);});
+void ProcessWorkQueueOnThreadWhile(PrioritizedWorkQueue *wq, int numThreads) {
+	for (int i = 0; i < numThreads; ++i) {
+		workThreads.push_back(std::thread([=](){threadfunc(wq);}));
+	}
 }
 
 void StopProcessingWorkQueue(PrioritizedWorkQueue *wq) {
 	wq->Stop();
-	if (workThread) {
-		workThread->join();
-		delete workThread;
+	for (std::thread &workThread : workThreads) {
+		workThread.join();
 	}
-	workThread = nullptr;
+	workThreads.clear();
 }
@@ -24,13 +24,15 @@ class PrioritizedWorkQueueItem {
 
 class PrioritizedWorkQueue {
 public:
-	PrioritizedWorkQueue() : done_(false), working_(false) {}
+	PrioritizedWorkQueue() : done_(false), working_(0) {}
 	~PrioritizedWorkQueue();
 	// Takes ownership.
 	void Add(PrioritizedWorkQueueItem *item);
 
-	// The worker should simply call this in a loop. Will block when appropriate.
+	// The workers should simply call this in a loop. Will block when appropriate.
 	PrioritizedWorkQueueItem *Pop();
+	// Call after running (and deleting) each item returned by Pop.
+	void ItemDone();
 
 	void Flush();
 	bool Done() { return done_; }
@@ -38,7 +40,8 @@ class PrioritizedWorkQueue {
 	bool WaitUntilDone(bool all = true);
 
 	bool IsWorking() {
-		return working_;
+		std::lock_guard<std::mutex> guard(mutex_);
+		return working_ != 0;
 	}
 
 private:
@@ -46,7 +49,8 @@ class PrioritizedWorkQueue {
 	bool AllItemsDone();
 
 	bool done_;
-	bool working_;
+	// How many items are being run right now.
+	int working_;
 	std::mutex mutex_;
 	std::mutex drainMutex_;
 	std::condition_variable notEmpty_;
@@ -58,7 +62,7 @@ class PrioritizedWorkQueue {
 };
 
 
-// Starts up a thread that keeps trying to run this workqueue.
+// Starts up threads that keep trying to run this workqueue, so that slow items (e.g. remote files) don't hold up the rest.
 // TODO: This feels ugly. Revisit later.
-void ProcessWorkQueueOnThreadWhile(PrioritizedWorkQueue *wq);
+void ProcessWorkQueueOnThreadWhile(PrioritizedWorkQueue *wq, int numThreads = 1);
 void StopProcessingWorkQueue(PrioritizedWorkQueue *wq);
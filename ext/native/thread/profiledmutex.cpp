@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+#include "thread/profiledmutex.h"
+
+#ifdef USE_PROFILER
+
+static std::mutex countersLock;
+static std::vector<std::unique_ptr<LockProfileCounters>> allCounters;
+
+LockProfileCounters *LockProfile_Counters(const char *name) {
+	std::lock_guard<std::mutex> guard(countersLock);
+	for (auto &counters : allCounters) {
+		if (!strcmp(counters->name, name))
+			return counters.get();
+	}
+
+	LockProfileCounters *counters = new LockProfileCounters();
+	counters->name = name;
+	counters->locks = 0;
+	counters->contended = 0;
+	counters->waitMicros = 0;
+	counters->maxWaitMicros = 0;
+	// Never freed, locks may live in statics that outlast anything we could clean up in.
+	allCounters.push_back(std::unique_ptr<LockProfileCounters>(counters));
+	return counters;
+}
+
+void LockProfile_RecordWait(LockProfileCounters *counters, double seconds) {
+	uint64_t micros = (uint64_t)(seconds * 1000000.0);
+	counters->contended++;
+	counters->waitMicros += micros;
+	uint64_t prevMax = counters->maxWaitMicros;
+	while (micros > prevMax && !counters->maxWaitMicros.compare_exchange_weak(prevMax, micros)) {
+		continue;
+	}
+}
+
+std::vector<LockProfileStats> LockProfile_GetStats() {
+	std::vector<LockProfileStats> stats;
+	{
+		std::lock_guard<std::mutex> guard(countersLock);
+		stats.reserve(allCounters.size());
+		for (const auto &counters : allCounters) {
+			LockProfileStats s;
+			s.name = counters->name;
+			s.locks = counters->locks;
+			s.contended = counters->contended;
+			s.waitSeconds = counters->waitMicros / 1000000.0;
+			s.maxWaitSeconds = counters->maxWaitMicros / 1000000.0;
+			stats.push_back(s);
+		}
+	}
+
+	std::sort(stats.begin(), stats.end(), [](const LockProfileStats &a, const LockProfileStats &b) {
+		return a.waitSeconds > b.waitSeconds;
+	});
+	return stats;
+}
+
+void LockProfile_Reset() {
+	std::lock_guard<std::mutex> guard(countersLock);
+	for (auto &counters : allCounters) {
+		counters->locks = 0;
+		counters->contended = 0;
+		counters->waitMicros = 0;
+		counters->maxWaitMicros = 0;
+	}
+}
+
+#else
+
+std::vector<LockProfileStats> LockProfile_GetStats() {
+	return std::vector<LockProfileStats>();
+}
+
+void LockProfile_Reset() {
+}
+
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "profiler/profiler.h"
+
+#ifdef USE_PROFILER
+#include "base/timeutil.h"
+#endif
+
+// Shared by every lock created with the same name.
+struct LockProfileCounters {
+	const char *name;
+	std::atomic<uint64_t> locks;
+	std::atomic<uint64_t> contended;
+	std::atomic<uint64_t> waitMicros;
+	std::atomic<uint64_t> maxWaitMicros;
+};
+
+struct LockProfileStats {
+	std::string name;
+	uint64_t locks;
+	// Times lock() had to wait for another thread.
+	uint64_t contended;
+	double waitSeconds;
+	double maxWaitSeconds;
+};
+
+#ifdef USE_PROFILER
+LockProfileCounters *LockProfile_Counters(const char *name);
+void LockProfile_RecordWait(LockProfileCounters *counters, double seconds);
+#endif
+
+// Sorted by total wait, longest first.  Empty unless built with USE_PROFILER.
+std::vector<LockProfileStats> LockProfile_GetStats();
+void LockProfile_Reset();
+
+// A mutex that, when built with USE_PROFILER, counts how often lockers had to wait and for how long.
+// Otherwise it's just the plain mutex.  Use std::condition_variable_any to wait on it.
+template <typename M>
+class BasicProfiledMutex {
+public:
+	// The name should be a literal, locks with the same name are counted together.
+	explicit BasicProfiledMutex(const char *name) {
+#ifdef USE_PROFILER
+		counters_ = LockProfile_Counters(name);
+#endif
+	}
+
+	void lock() {
+#ifdef USE_PROFILER
+		counters_->locks++;
+		if (!mutex_.try_lock()) {
+			double start = real_time_now();
+			mutex_.lock();
+			LockProfile_RecordWait(counters_, real_time_now() - start);
+		}
+#else
+		mutex_.lock();
+#endif
+	}
+
+	bool try_lock() {
+		if (!mutex_.try_lock())
+			return false;
+#ifdef USE_PROFILER
+		counters_->locks++;
+#endif
+		return true;
+	}
+
+	void unlock() {
+		mutex_.unlock();
+	}
+
+private:
+	M mutex_;
+#ifdef USE_PROFILER
+	LockProfileCounters *counters_;
+#endif
+
+	BasicProfiledMutex(const BasicProfiledMutex &other) = delete;
+	void operator =(const BasicProfiledMutex &other) = delete;
+};
+
+typedef BasicProfiledMutex<std::mutex> ProfiledMutex;
+typedef BasicProfiledMutex<std::recursive_mutex> ProfiledRecursiveMutex;
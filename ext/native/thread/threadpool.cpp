@@ -3,131 +3,239 @@
 #include "thread/threadutil.h"
 #include "Common/MakeUnique.h"
 
-///////////////////////////// WorkerThread
+///////////////////////////// ThreadPool
+
+ThreadPool::ThreadPool(int numThreads) {
+	if (numThreads <= 0) {
+		numThreads_ = 1;
+		ILOG("ThreadPool: Bad number of threads %i", numThreads);
+	} else if (numThreads > 8) {
+		ILOG("ThreadPool: Capping number of threads to 8 (was %i)", numThreads);
+		numThreads_ = 8;
+	} else {
+		numThreads_ = numThreads;
+	}
+}
 
-WorkerThread::~WorkerThread() {
+ThreadPool::~ThreadPool() {
 	{
-		std::lock_guard<std::mutex> guard(mutex);
-		active = false;
-		signal.notify_one();
+		std::lock_guard<std::mutex> guard(wakeMutex_);
+		active_ = false;
 	}
-	if (thread.joinable()) {
-		thread.join();
+	wake_.notify_all();
+	for (std::thread &worker : workers_) {
+		worker.join();
 	}
 }
 
-void WorkerThread::StartUp() {
-	thread = std::thread(std::bind(&WorkerThread::WorkFunc, this));
+void ThreadPool::StartWorkers() {
+	if (workersStarted_)
+		return;
+
+	std::lock_guard<std::mutex> guard(startMutex_);
+	if (!workersStarted_) {
+		// create one less worker thread as the thread waiting on the work will also do work
+		queues_.reserve(numThreads_ - 1);
+		for (int i = 0; i < numThreads_ - 1; ++i) {
+			queues_.push_back(make_unique<TaskQueue>());
+		}
+		workers_.reserve(numThreads_ - 1);
+		for (int i = 0; i < numThreads_ - 1; ++i) {
+			workers_.push_back(std::thread(std::bind(&ThreadPool::WorkFunc, this, i)));
+		}
+		workersStarted_ = true;
+	}
 }
 
-void WorkerThread::Process(std::function<void()> work) {
-	std::lock_guard<std::mutex> guard(mutex);
-	work_ = std::move(work);
-	jobsTarget = jobsDone + 1;
-	signal.notify_one();
+void ThreadPool::SetMaxThreads(int maxThreads) {
+	maxThreads_ = maxThreads;
 }
 
-void WorkerThread::WaitForCompletion() {
-	std::unique_lock<std::mutex> guard(doneMutex);
-	while (jobsDone < jobsTarget) {
-		done.wait(guard);
+int ThreadPool::CurrentWorker() const {
+	if (!workersStarted_)
+		return -1;
+
+	// At most 7, so this is cheaper than thread local storage, which isn't everywhere.
+	const std::thread::id self = std::this_thread::get_id();
+	for (size_t i = 0; i < workers_.size(); ++i) {
+		if (workers_[i].get_id() == self)
+			return (int)i;
 	}
+	return -1;
 }
 
-void WorkerThread::WorkFunc() {
-	setCurrentThreadName("Worker");
-	std::unique_lock<std::mutex> guard(mutex);
-	while (active) {
-		// 'active == false' is one of the conditions for signaling,
-		// do not "optimize" it
-		while (active && jobsTarget <= jobsDone) {
-			signal.wait(guard);
-		}
-		if (active) {
-			work_();
+void ThreadPool::Submit(std::function<void()> task, TaskGroup *group, TaskPriority priority, TaskGroup *after) {
+	StartWorkers();
 
-			std::lock_guard<std::mutex> doneGuard(doneMutex);
-			jobsDone++;
-			done.notify_one();
+	if (group)
+		group->pending_++;
+
+	Task t{ std::move(task), group, priority };
+	if (after) {
+		std::lock_guard<std::mutex> guard(after->mutex_);
+		if (after->pending_ != 0) {
+			after->continuations_.push_back(std::move(t));
+			return;
 		}
 	}
+
+	Enqueue(std::move(t));
 }
 
-void LoopWorkerThread::Process(std::function<void(int, int)> work, int start, int end) {
-	std::lock_guard<std::mutex> guard(mutex);
-	work_ = std::move(work);
-	start_ = start;
-	end_ = end;
-	jobsTarget = jobsDone + 1;
-	signal.notify_one();
+void ThreadPool::Enqueue(Task &&task) {
+	if (queues_.empty()) {
+		// Only one thread, so it's just us.
+		RunTask(task);
+		return;
+	}
+
+	// Our own tasks go at the back of our queue, since those are likely still in cache.
+	int self = CurrentWorker();
+	TaskQueue &queue = self >= 0 ? *queues_[self] : sharedQueue_;
+	{
+		std::lock_guard<std::mutex> guard(queue.mutex);
+		queue.tasks[(int)task.priority].push_back(std::move(task));
+	}
+
+	queued_++;
+	{
+		// Make sure no one misses this between checking queued_ and waiting.
+		std::lock_guard<std::mutex> guard(wakeMutex_);
+	}
+	wake_.notify_one();
 }
 
-void LoopWorkerThread::WorkFunc() {
-	setCurrentThreadName("LoopWorker");
-	std::unique_lock<std::mutex> guard(mutex);
-	while (active) {
-		// 'active == false' is one of the conditions for signaling,
-		// do not "optimize" it
-		while (active && jobsTarget <= jobsDone) {
-			signal.wait(guard);
+bool ThreadPool::FindTask(int self, Task &task) {
+	if (queued_ == 0)
+		return false;
+
+	for (int p = 0; p < PRIORITY_COUNT; ++p) {
+		if (self >= 0) {
+			TaskQueue &own = *queues_[self];
+			std::lock_guard<std::mutex> guard(own.mutex);
+			if (!own.tasks[p].empty()) {
+				task = std::move(own.tasks[p].back());
+				own.tasks[p].pop_back();
+				queued_--;
+				return true;
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(sharedQueue_.mutex);
+			if (!sharedQueue_.tasks[p].empty()) {
+				task = std::move(sharedQueue_.tasks[p].front());
+				sharedQueue_.tasks[p].pop_front();
+				queued_--;
+				return true;
+			}
 		}
-		if (active) {
-			work_(start_, end_);
 
-			std::lock_guard<std::mutex> doneGuard(doneMutex);
-			jobsDone++;
-			done.notify_one();
+		// Steal the oldest work from someone else, which is probably the biggest piece.
+		const int count = (int)queues_.size();
+		for (int i = 1; i <= count; ++i) {
+			const int victim = (self + i + count) % count;
+			if (victim == self)
+				continue;
+			TaskQueue &other = *queues_[victim];
+			std::lock_guard<std::mutex> guard(other.mutex);
+			if (!other.tasks[p].empty()) {
+				task = std::move(other.tasks[p].front());
+				other.tasks[p].pop_front();
+				queued_--;
+				return true;
+			}
 		}
 	}
+
+	return false;
 }
 
-///////////////////////////// ThreadPool
+void ThreadPool::RunTask(Task &task) {
+	task.func();
 
-ThreadPool::ThreadPool(int numThreads) {
-	if (numThreads <= 0) {
-		numThreads_ = 1;
-		ILOG("ThreadPool: Bad number of threads %i", numThreads);
-	} else if (numThreads > 8) {
-		ILOG("ThreadPool: Capping number of threads to 8 (was %i)", numThreads);
-		numThreads_ = 8;
-	} else {
-		numThreads_ = numThreads;
+	TaskGroup *group = task.group;
+	if (!group)
+		return;
+
+	std::vector<Task> continuations;
+	{
+		std::lock_guard<std::mutex> guard(group->mutex_);
+		if (--group->pending_ != 0)
+			return;
+		continuations.swap(group->continuations_);
+	}
+	// Can't touch group after this, it may be gone as soon as someone sees it's done.
+
+	for (Task &next : continuations) {
+		Enqueue(std::move(next));
 	}
+
+	{
+		std::lock_guard<std::mutex> guard(wakeMutex_);
+	}
+	wake_.notify_all();
 }
 
-void ThreadPool::StartWorkers() {
-	if (!workersStarted) {
-		workers.reserve(numThreads_ - 1);
-		for(int i = 0; i < numThreads_ - 1; ++i) { // create one less worker thread as the thread calling ParallelLoop will also do work
-			auto workerPtr = make_unique<LoopWorkerThread>();
-			workerPtr->StartUp();
-			workers.push_back(std::move(workerPtr));
+void ThreadPool::WorkFunc(int index) {
+	setCurrentThreadName("PoolWorker");
+	setCurrentThreadRole(ThreadRole::WORKER);
+
+	Task task;
+	while (true) {
+		if (FindTask(index, task)) {
+			RunTask(task);
+			task.func = nullptr;
+			continue;
 		}
-		workersStarted = true;
+
+		std::unique_lock<std::mutex> guard(wakeMutex_);
+		// 'active_ == false' is one of the conditions for signaling,
+		// do not "optimize" it
+		wake_.wait(guard, [&] { return queued_ != 0 || !active_; });
+		if (!active_)
+			break;
 	}
 }
 
-void ThreadPool::ParallelLoop(const std::function<void(int,int)> &loop, int lower, int upper) {
-	int range = upper - lower;
-	if (range >= numThreads_ * 2) { // don't parallelize tiny loops (this could be better, maybe add optional parameter that estimates work per iteration)
-		std::lock_guard<std::mutex> guard(mutex);
-		StartWorkers();
+void ThreadPool::Wait(TaskGroup &group) {
+	const int self = CurrentWorker();
+	Task task;
+	while (group.pending_ != 0) {
+		if (FindTask(self, task)) {
+			RunTask(task);
+			task.func = nullptr;
+			continue;
+		}
 
-		// could do slightly better load balancing for the generic case, 
+		std::unique_lock<std::mutex> guard(wakeMutex_);
+		wake_.wait(guard, [&] { return group.pending_ == 0 || queued_ != 0; });
+	}
+
+	// The last task may still be finishing up with the group, so sync with it.
+	std::lock_guard<std::mutex> guard(group.mutex_);
+}
+
+void ThreadPool::ParallelLoop(const std::function<void(int,int)> &loop, int lower, int upper, TaskPriority priority) {
+	int range = upper - lower;
+	int maxThreads = maxThreads_;
+	int numThreads = maxThreads > 0 && maxThreads < numThreads_ ? maxThreads : numThreads_;
+	if (numThreads > 1 && range >= numThreads * 2) { // don't parallelize tiny loops (this could be better, maybe add optional parameter that estimates work per iteration)
+		// could do slightly better load balancing for the generic case,
 		// but doesn't matter since all our loops are power of 2
-		int chunk = range / numThreads_;
+		int chunk = range / numThreads;
 		int s = lower;
-		for (auto& worker : workers) {
-			worker->Process(loop, s, s+chunk);
-			s+=chunk;
+		TaskGroup group;
+		for (int i = 0; i < numThreads - 1; ++i) {
+			Submit([&loop, s, chunk] {
+				loop(s, s + chunk);
+			}, &group, priority);
+			s += chunk;
 		}
 		// This is the final chunk.
 		loop(s, upper);
-		for (auto& worker : workers) {
-			worker->WaitForCompletion();
-		}
+		Wait(group);
 	} else {
 		loop(lower, upper);
 	}
 }
-
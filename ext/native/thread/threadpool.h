@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <vector>
@@ -7,71 +9,96 @@
 #include <mutex>
 #include <condition_variable>
 
-// This is the simplest possible worker implementation I can think of
-// but entirely sufficient for the given purpose.
-// Only handles a single item of work at a time.
-class WorkerThread {
-public:
-	WorkerThread() = default;
-	virtual ~WorkerThread();
-
-	void StartUp();
-
-	// submit a new work item
-	void Process(std::function<void()> work);
-	// wait for a submitted work item to be completed
-	void WaitForCompletion();
-
-protected:
-	std::thread thread; // the worker thread
-	std::condition_variable signal; // used to signal new work
-	std::condition_variable done; // used to signal work completion
-	std::mutex mutex, doneMutex; // associated with each respective condition variable
-	bool active = true;
-	int jobsDone = 0;
-	int jobsTarget = 0;
-private:
-	virtual void WorkFunc();
-
-	std::function<void()> work_; // the work to be done by this thread
-
-	WorkerThread(const WorkerThread& other) = delete; // prevent copies
-	void operator =(const WorkerThread &other) = delete;
+enum class TaskPriority {
+	HIGH = 0,
+	NORMAL = 1,
 };
 
-class LoopWorkerThread final : public WorkerThread {
+class ThreadPool;
+
+// Counts tasks submitted with it, so they can be waited on together or other tasks can depend on them.
+// Must be waited on (ThreadPool::Wait) before it's destroyed.
+class TaskGroup {
 public:
-	LoopWorkerThread() = default;
-	void Process(std::function<void(int, int)> work, int start, int end);
+	TaskGroup() = default;
+
+	bool Done() const { return pending_ == 0; }
 
 private:
-	virtual void WorkFunc() override;
+	struct Task {
+		std::function<void()> func;
+		TaskGroup *group;
+		TaskPriority priority;
+	};
+
+	std::atomic<int> pending_{ 0 };
+	// Protects continuations_, and pending_ reaching zero.
+	std::mutex mutex_;
+	// Submitted with this group as a dependency, queued once it's done.
+	std::vector<Task> continuations_;
+
+	TaskGroup(const TaskGroup &other) = delete;
+	void operator =(const TaskGroup &other) = delete;
 
-	int start_;
-	int end_;
-	std::function<void(int, int)> work_; // the work to be done by this thread
+	friend class ThreadPool;
 };
 
-// A thread pool manages a set of worker threads, and allows the execution of parallel loops on them
-// individual parallel loops are fully sequentialized to simplify synchronization, which should not 
-// be a problem as they should each use the entire system
+// A thread pool manages a set of worker threads, which run tasks and slices of parallel loops.
+// Each worker has its own queues (newest first for itself, oldest first for others to steal), so
+// several subsystems can run parallel work at the same time, and loops can be nested inside tasks.
+// Waiting runs other queued tasks meanwhile, so nested waits don't deadlock.
 class ThreadPool {
 public:
 	ThreadPool(int numThreads);
-	// don't need a destructor, "workers" is cleared on delete, 
-	// leading to the stopping and joining of all worker threads (RAII and all that)
+	~ThreadPool();
+
+	void ParallelLoop(const std::function<void(int,int)> &loop, int lower, int upper, TaskPriority priority = TaskPriority::NORMAL);
+
+	// Runs the task on some thread.  If after is specified, not until everything in it is done.
+	void Submit(std::function<void()> task, TaskGroup *group = nullptr, TaskPriority priority = TaskPriority::NORMAL, TaskGroup *after = nullptr);
+	// Helps run tasks until everything in group is done.
+	void Wait(TaskGroup &group);
 
-	void ParallelLoop(const std::function<void(int,int)> &loop, int lower, int upper);
+	int GetNumThreads() const { return numThreads_; }
+	// Limits how many of the threads loops are split over, mainly for benchmarking.  0 means all.
+	void SetMaxThreads(int maxThreads);
 
 private:
-	int numThreads_;
-	std::vector<std::unique_ptr<LoopWorkerThread>> workers;
-	std::mutex mutex; // used to sequentialize loop execution
+	typedef TaskGroup::Task Task;
+
+	enum {
+		PRIORITY_COUNT = 2,
+	};
+
+	struct TaskQueue {
+		std::mutex mutex;
+		std::deque<Task> tasks[PRIORITY_COUNT];
+	};
 
-	bool workersStarted = false;
 	void StartWorkers();
-	
+	void WorkFunc(int index);
+	// Which worker the calling thread is, or -1 if it's not one.
+	int CurrentWorker() const;
+	void Enqueue(Task &&task);
+	bool FindTask(int self, Task &task);
+	void RunTask(Task &task);
+
+	int numThreads_;
+	std::atomic<int> maxThreads_{ 0 };
+
+	// Tasks from threads outside the pool go here.
+	TaskQueue sharedQueue_;
+	std::vector<std::unique_ptr<TaskQueue>> queues_;
+	std::vector<std::thread> workers_;
+	std::mutex startMutex_;
+	std::atomic<bool> workersStarted_{ false };
+
+	// Tasks sitting in any queue, not yet running.
+	std::atomic<int> queued_{ 0 };
+	std::mutex wakeMutex_;
+	std::condition_variable wake_;
+	bool active_ = true;
+
 	ThreadPool(const ThreadPool& other) = delete; // prevent copies
 	void operator =(const ThreadPool &other) = delete;
 };
-
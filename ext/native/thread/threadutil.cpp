@@ -16,6 +16,21 @@
 #include <pthread.h>
 #endif
 
+#if defined(__ANDROID__) || (defined(__linux__) && defined(_GNU_SOURCE))
+#define AFFINITY_SUPPORTED
+#include <cstdio>
+#include <mutex>
+#include <vector>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#elif defined(__APPLE__)
+#include <pthread/qos.h>
+#endif
+
+#include <atomic>
+
 #ifdef TLS_SUPPORTED
 static __THREAD const char *curThreadName;
 #endif
@@ -119,3 +134,139 @@ void AssertCurrentThreadName(const char *threadName) {
 	}
 #endif
 }
+
+static std::atomic<int> threadPlacement{ (int)ThreadPlacement::OFF };
+
+void SetThreadPlacement(ThreadPlacement placement) {
+	threadPlacement = (int)placement;
+}
+
+#ifdef AFFINITY_SUPPORTED
+struct CoreClusters {
+	cpu_set_t all;
+	cpu_set_t fast;
+	cpu_set_t slow;
+	bool heterogeneous;
+};
+
+static int ReadCpuValue(int cpu, const char *file) {
+	char path[256];
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/%s", cpu, file);
+	FILE *f = fopen(path, "r");
+	if (!f)
+		return -1;
+	int value = -1;
+	if (fscanf(f, "%d", &value) != 1)
+		value = -1;
+	fclose(f);
+	return value;
+}
+
+static const CoreClusters &GetCoreClusters() {
+	static CoreClusters clusters;
+	static std::once_flag detected;
+	std::call_once(detected, [] {
+		CPU_ZERO(&clusters.all);
+		CPU_ZERO(&clusters.fast);
+		CPU_ZERO(&clusters.slow);
+		clusters.heterogeneous = false;
+
+		int cores = (int)sysconf(_SC_NPROCESSORS_CONF);
+		if (cores > CPU_SETSIZE)
+			cores = CPU_SETSIZE;
+
+		// cpu_capacity is what the kernel scheduler itself goes by.  Max frequency is the next best guess.
+		static const char *const sources[] = { "cpu_capacity", "cpufreq/cpuinfo_max_freq" };
+		std::vector<int> speed;
+		int best = 0;
+		for (const char *source : sources) {
+			speed.resize(cores > 0 ? cores : 0);
+			best = 0;
+			for (int i = 0; i < cores; ++i) {
+				speed[i] = ReadCpuValue(i, source);
+				if (speed[i] > best)
+					best = speed[i];
+			}
+			if (best > 0)
+				break;
+		}
+		if (best <= 0) {
+			ILOG("Thread placement: Unable to tell cores apart, leaving it to the OS");
+			return;
+		}
+
+		for (int i = 0; i < cores; ++i) {
+			// Unknown cores (offline, usually) simply aren't used for placement.
+			if (speed[i] <= 0)
+				continue;
+			CPU_SET(i, &clusters.all);
+			// Prime and big cores are usually within a few percent, little cores are well under.
+			if ((int64_t)speed[i] * 4 >= (int64_t)best * 3)
+				CPU_SET(i, &clusters.fast);
+			else
+				CPU_SET(i, &clusters.slow);
+		}
+		clusters.heterogeneous = CPU_COUNT(&clusters.slow) != 0;
+		ILOG("Thread placement: %d fast and %d slow cores", CPU_COUNT(&clusters.fast), CPU_COUNT(&clusters.slow));
+	});
+	return clusters;
+}
+#endif
+
+void setCurrentThreadRole(ThreadRole role) {
+	if (threadPlacement == (int)ThreadPlacement::OFF)
+		return;
+
+#if defined(AFFINITY_SUPPORTED)
+	const CoreClusters &clusters = GetCoreClusters();
+	// New threads inherit both of these from whoever started them, so every role sets both.
+	const cpu_set_t *cores = &clusters.all;
+	int nice = 0;
+	switch (role) {
+	case ThreadRole::EMULATION:
+	case ThreadRole::RENDER:
+		cores = &clusters.fast;
+		nice = -4;
+		break;
+	case ThreadRole::AUDIO:
+		cores = &clusters.fast;
+		nice = -16;
+		break;
+	case ThreadRole::WORKER:
+		break;
+	case ThreadRole::BACKGROUND:
+		cores = &clusters.slow;
+		nice = 10;
+		break;
+	}
+
+	if (clusters.heterogeneous && sched_setaffinity(0, sizeof(cpu_set_t), cores) != 0) {
+		WLOG("Thread placement: Failed to set affinity");
+	}
+	// Raising priority can fail without privileges outside Android, which is fine.
+	setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), nice);
+#elif defined(__APPLE__)
+	// No affinity here, but QoS classes steer threads between performance and efficiency cores.
+	qos_class_t qos = QOS_CLASS_DEFAULT;
+	switch (role) {
+	case ThreadRole::EMULATION:
+	case ThreadRole::RENDER:
+	case ThreadRole::AUDIO:
+		qos = QOS_CLASS_USER_INTERACTIVE;
+		break;
+	case ThreadRole::WORKER:
+		qos = QOS_CLASS_USER_INITIATED;
+		break;
+	case ThreadRole::BACKGROUND:
+		// QOS_CLASS_BACKGROUND throttles I/O far too much for prefetching.
+		qos = QOS_CLASS_UTILITY;
+		break;
+	}
+	pthread_set_qos_class_self_np(qos, 0);
+#elif defined(_WIN32)
+	// Audio threads already raise their own priority.
+	if (role == ThreadRole::BACKGROUND) {
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+	}
+#endif
+}
@@ -3,4 +3,29 @@
 // Note that name must be a global string that lives until the end of the process,
 // for assertThreadName to work.
 void setCurrentThreadName(const char *threadName);
-void AssertCurrentThreadName(const char *threadName);
\ No newline at end of file
+void AssertCurrentThreadName(const char *threadName);
+
+// What a thread does, so it can be placed on a suitable core.  Matters most on big.LITTLE style
+// devices, where a latency critical thread stuck on a slow core costs frames.
+enum class ThreadRole {
+	// Runs the emulated CPU or GE, the frame waits on these.
+	EMULATION,
+	RENDER,
+	AUDIO,
+	// Parallel work that some other thread is waiting on.
+	WORKER,
+	// Prefetching, compression, caching and the like, which nothing waits on right away.
+	BACKGROUND,
+};
+
+enum class ThreadPlacement {
+	// Leave it all to the OS scheduler.
+	OFF = 0,
+	// Latency critical roles on the fastest cores, background roles on the slower ones.
+	AUTO = 1,
+};
+
+// Only affects threads that set their role afterward.
+void SetThreadPlacement(ThreadPlacement placement);
+// Applies the current placement policy for role to the calling thread.
+void setCurrentThreadRole(ThreadRole role);
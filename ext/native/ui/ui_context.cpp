@@ -81,19 +81,33 @@ void UIContext::SetCurZ(float curZ) {
 	ui_draw2d_front.SetCurZ(curZ);
 }
 
+static bool SameBounds(const Bounds &a, const Bounds &b) {
+	return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+}
+
 // TODO: Support transformed bounds using stencil instead.
 void UIContext::PushScissor(const Bounds &bounds) {
-	Flush();
 	Bounds clipped = TransformBounds(bounds);
 	if (scissorStack_.size())
 		clipped.Clip(scissorStack_.back());
 	else
 		clipped.Clip(bounds_);
+	// Nested views often clip to the same rect, no need to break the batch for those.
+	if (!scissorStack_.empty() && SameBounds(clipped, scissorStack_.back())) {
+		scissorStack_.push_back(clipped);
+		return;
+	}
+	Flush();
 	scissorStack_.push_back(clipped);
 	ActivateTopScissor();
 }
 
 void UIContext::PopScissor() {
+	size_t size = scissorStack_.size();
+	if (size >= 2 && SameBounds(scissorStack_[size - 1], scissorStack_[size - 2])) {
+		scissorStack_.pop_back();
+		return;
+	}
 	Flush();
 	scissorStack_.pop_back();
 	ActivateTopScissor();
@@ -2,11 +2,13 @@
 // See headless.txt.
 // To build on non-windows systems, just run CMake in the SDL directory, it will build both a normal ppsspp and the headless version.
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <limits>
 
 #include "file/zip_read.h"
+#include "json/json_writer.h"
 #include "profiler/profiler.h"
 #include "Common/FileUtil.h"
 #include "Common/GraphicsContext.h"
@@ -17,12 +19,16 @@
 #include "Core/System.h"
 #include "Core/HLE/sceUtility.h"
 #include "Core/Host.h"
+#include "Core/MIPS/JitCommon/JitBlockCache.h"
+#include "Core/MIPS/JitCommon/JitCommon.h"
 #include "Core/SaveState.h"
 #include "GPU/Common/FramebufferCommon.h"
+#include "GPU/GPU.h"
 #include "Log.h"
 #include "LogManager.h"
 #include "base/NativeApp.h"
 #include "base/timeutil.h"
+#include "thin3d/thin3d.h"
 
 #include "Compare.h"
 #include "StubHost.h"
@@ -102,6 +108,10 @@ int printUsage(const char *progname, const char *reason)
 	}
 #endif
 	fprintf(stderr, "  --timeout=SECONDS     abort test it if takes longer than SECONDS\n");
+	fprintf(stderr, "  --bench=FRAMES        replay a GE dump for FRAMES frames, print timings as JSON\n");
+	fprintf(stderr, "  --cpubench=FRAMES     run a game for FRAMES emulated frames uncapped, print cpu stats as JSON\n");
+	fprintf(stderr, "  --timing              with --cpubench, also break down time by cpu/hle/gpu and event\n");
+	fprintf(stderr, "  --state=FILE          load a savestate before running\n");
 
 	fprintf(stderr, "  -v, --verbose         show the full passed/failed result\n");
 	fprintf(stderr, "  -i                    use the interpreter\n");
@@ -205,6 +215,279 @@ bool RunAutoTest(HeadlessHost *headlessHost, CoreParameter &coreParameter, bool
 	return passed;
 }
 
+struct BenchFrame {
+	double cpuMilliseconds;
+	// Negative when the backend has no timestamps. Lags behind by a few frames.
+	double gpuMilliseconds;
+	int drawCalls;
+	int textureUploads;
+	int framebufferUploads;
+	int shaderCompiles;
+};
+
+// Replays a GE dump as fast as possible, and writes a dict with per frame stats to json.
+static bool RunReplayBenchmark(HeadlessHost *headlessHost, CoreParameter &coreParameter, int frames, double timeout, json::JsonWriter &json) {
+	std::string error_string;
+	if (!PSP_Init(coreParameter, &error_string)) {
+		fprintf(stderr, "Failed to start %s. Error: %s\n", coreParameter.fileToStart.c_str(), error_string.c_str());
+		return false;
+	}
+
+	host->BootDone();
+
+	Draw::DrawContext *draw = coreParameter.graphicsContext ? coreParameter.graphicsContext->GetDrawContext() : nullptr;
+	g_Config.bShowGpuProfile = draw != nullptr;
+
+	std::vector<BenchFrame> results;
+	results.reserve(frames);
+
+	time_update();
+	double deadline = time_now_d() + timeout;
+
+	Core_UpdateDebugStats(true);
+
+	PSP_BeginHostFrame();
+	if (draw)
+		draw->BeginFrame();
+	double frameStart = real_time_now();
+
+	coreState = CORE_RUNNING;
+	while (coreState == CORE_RUNNING && (int)results.size() < frames) {
+		int blockTicks = usToCycles(1000000 / 10);
+		PSP_RunLoopFor(blockTicks);
+
+		if (coreState == CORE_NEXTFRAME) {
+			coreState = CORE_RUNNING;
+			PSP_EndHostFrame();
+			if (draw)
+				draw->EndFrame();
+			headlessHost->SwapBuffers();
+
+			BenchFrame frame;
+			frame.cpuMilliseconds = (real_time_now() - frameStart) * 1000.0;
+			Draw::GPUProfile profile;
+			frame.gpuMilliseconds = draw && draw->GetGPUProfile(&profile) ? profile.gpuMilliseconds : -1.0;
+			frame.drawCalls = gpuStats.numDrawCalls;
+			frame.textureUploads = gpuStats.numTexturesDecoded;
+			frame.framebufferUploads = gpuStats.numUploads;
+			frame.shaderCompiles = gpuStats.numShadersCompiled;
+			results.push_back(frame);
+
+			// Also resets the per frame stats.
+			Core_UpdateDebugStats(true);
+			PSP_BeginHostFrame();
+			if (draw)
+				draw->BeginFrame();
+			frameStart = real_time_now();
+		}
+
+		time_update();
+		if (time_now_d() > deadline) {
+			fprintf(stderr, "Benchmark of %s timed out\n", coreParameter.fileToStart.c_str());
+			Core_Stop();
+		}
+	}
+	PSP_EndHostFrame();
+	if (draw)
+		draw->EndFrame();
+
+	PSP_Shutdown();
+	headlessHost->FlushDebugOutput();
+
+	double totalCpu = 0.0, maxCpu = 0.0, totalGpu = 0.0;
+	int gpuCount = 0;
+	json.pushDict();
+	json.writeString("file", coreParameter.fileToStart);
+	json.writeString("backend", draw ? draw->GetInfoString(Draw::APINAME) : "none");
+	json.pushArray("frames");
+	for (const BenchFrame &frame : results) {
+		json.pushDict();
+		json.writeFloat("cpuMilliseconds", frame.cpuMilliseconds);
+		if (frame.gpuMilliseconds >= 0.0)
+			json.writeFloat("gpuMilliseconds", frame.gpuMilliseconds);
+		else
+			json.writeNull("gpuMilliseconds");
+		json.writeInt("drawCalls", frame.drawCalls);
+		json.writeInt("textureUploads", frame.textureUploads);
+		json.writeInt("framebufferUploads", frame.framebufferUploads);
+		json.writeInt("shaderCompiles", frame.shaderCompiles);
+		json.pop();
+
+		totalCpu += frame.cpuMilliseconds;
+		maxCpu = std::max(maxCpu, frame.cpuMilliseconds);
+		if (frame.gpuMilliseconds >= 0.0) {
+			totalGpu += frame.gpuMilliseconds;
+			gpuCount++;
+		}
+	}
+	json.pop();
+	json.pushDict("summary");
+	json.writeInt("frames", (int)results.size());
+	json.writeFloat("avgCpuMilliseconds", results.empty() ? 0.0 : totalCpu / results.size());
+	json.writeFloat("maxCpuMilliseconds", maxCpu);
+	if (gpuCount != 0)
+		json.writeFloat("avgGpuMilliseconds", totalGpu / gpuCount);
+	else
+		json.writeNull("avgGpuMilliseconds");
+	json.pop();
+	json.pop();
+
+	return (int)results.size() == frames;
+}
+
+// Runs a game (from --state if given) uncapped for a number of emulated frames, and writes a dict
+// with emulated cpu speed and jit stats to json.  Meant for tracking cpu side speed across commits.
+// With timing, it also breaks the time down by cpu/hle/gpu and CoreTiming event, which costs a bit of speed.
+static bool RunCpuBenchmark(HeadlessHost *headlessHost, CoreParameter &coreParameter, int frames, const char *stateToLoad, double timeout, bool timing, json::JsonWriter &json) {
+	std::string error_string;
+	if (!PSP_Init(coreParameter, &error_string)) {
+		fprintf(stderr, "Failed to start %s. Error: %s\n", coreParameter.fileToStart.c_str(), error_string.c_str());
+		return false;
+	}
+
+	host->BootDone();
+
+	bool stateLoaded = true;
+	if (stateToLoad) {
+		SaveState::Load(stateToLoad, [&](SaveState::Status status, const std::string &message, void *) {
+			stateLoaded = status != SaveState::Status::FAILURE;
+			if (!stateLoaded)
+				fprintf(stderr, "Failed to load state %s: %s\n", stateToLoad, message.c_str());
+		});
+		// Do it now, so loading isn't part of the timing.
+		SaveState::Process();
+	}
+
+	Draw::DrawContext *draw = coreParameter.graphicsContext ? coreParameter.graphicsContext->GetDrawContext() : nullptr;
+
+	if (timing) {
+		// This clears the jit cache, so do it before the compile stats are reset.
+		Core_ForceDebugStats(true);
+		Core_UpdateDebugStats(true);
+		CoreTiming::ResetEventProfile();
+	}
+
+	MIPSComp::ResetJitCompileStats();
+	MIPSComp::SetJitCompileStatsEnabled(true);
+
+	time_update();
+	double deadline = time_now_d() + timeout;
+	int framesRun = 0;
+
+	PSP_BeginHostFrame();
+	if (draw)
+		draw->BeginFrame();
+	const u64 startTicks = CoreTiming::GetTicks();
+	const double startTime = real_time_now();
+
+	coreState = stateLoaded ? CORE_RUNNING : CORE_ERROR;
+	while (coreState == CORE_RUNNING && framesRun < frames) {
+		int blockTicks = usToCycles(1000000 / 10);
+		PSP_RunLoopFor(blockTicks);
+
+		if (coreState == CORE_NEXTFRAME) {
+			coreState = CORE_RUNNING;
+			PSP_EndHostFrame();
+			if (draw)
+				draw->EndFrame();
+			headlessHost->SwapBuffers();
+			framesRun++;
+			if (timing)
+				Core_UpdateDebugStats(true);
+
+			PSP_BeginHostFrame();
+			if (draw)
+				draw->BeginFrame();
+		}
+
+		time_update();
+		if (time_now_d() > deadline) {
+			fprintf(stderr, "Benchmark of %s timed out\n", coreParameter.fileToStart.c_str());
+			Core_Stop();
+		}
+	}
+
+	const double seconds = real_time_now() - startTime;
+	const u64 ticks = CoreTiming::GetTicks() - startTicks;
+	PSP_EndHostFrame();
+	if (draw)
+		draw->EndFrame();
+
+	MIPSComp::SetJitCompileStatsEnabled(false);
+	const MIPSComp::JitCompileStats compileStats = MIPSComp::GetJitCompileStats();
+
+	CoreTiming::TimeBreakdown timeBreakdown{};
+	std::vector<CoreTiming::EventProfile> events;
+	if (timing) {
+		CoreTiming::GetTimeBreakdown(nullptr, &timeBreakdown);
+		events = CoreTiming::GetEventProfile();
+		Core_ForceDebugStats(false);
+	}
+
+	// Grab these before shutdown destroys the jit.
+	BlockCacheStats bcStats{};
+	bool haveBlockStats = false;
+	if (MIPSComp::jit) {
+		JitBlockCacheDebugInterface *blockCache = MIPSComp::jit->GetBlockCacheDebugInterface();
+		if (blockCache) {
+			blockCache->ComputeStats(bcStats);
+			haveBlockStats = true;
+		}
+	}
+
+	PSP_Shutdown();
+	headlessHost->FlushDebugOutput();
+
+	static const char *cpuCoreNames[] = { "interpreter", "jit", "irjit" };
+	const int cpuCore = (int)coreParameter.cpuCore;
+
+	json.pushDict();
+	json.writeString("file", coreParameter.fileToStart);
+	if (stateToLoad)
+		json.writeString("state", stateToLoad);
+	json.writeString("cpuCore", cpuCore >= 0 && cpuCore < (int)ARRAY_SIZE(cpuCoreNames) ? cpuCoreNames[cpuCore] : "unknown");
+	json.writeString("backend", draw ? draw->GetInfoString(Draw::APINAME) : "none");
+	json.writeInt("frames", framesRun);
+	json.writeFloat("seconds", seconds);
+	json.writeFloat("framesPerSecond", seconds > 0.0 ? framesRun / seconds : 0.0);
+	json.writeFloat("emulatedMHz", seconds > 0.0 ? (double)ticks / seconds / 1000000.0 : 0.0);
+	json.writeFloat("speedPercent", seconds > 0.0 ? (double)ticks / seconds / CPU_HZ * 100.0 : 0.0);
+	json.pushDict("jit");
+	json.writeInt("compiles", (int)compileStats.compiles);
+	json.writeFloat("compileMilliseconds", compileStats.seconds * 1000.0);
+	if (haveBlockStats) {
+		json.writeInt("blocks", bcStats.numBlocks);
+		json.writeFloat("avgBloat", bcStats.avgBloat);
+		json.writeFloat("minBloat", bcStats.minBloat);
+		json.writeFloat("maxBloat", bcStats.maxBloat);
+	} else {
+		json.writeNull("blocks");
+	}
+	json.pop();
+	if (timing) {
+		// Milliseconds in each category, not counting nested ones (an event's hle calls count as hle.)
+		json.pushDict("timeBreakdown");
+		for (int i = 0; i < (int)CoreTiming::TimeCategory::COUNT; ++i)
+			json.writeFloat(CoreTiming::TimeCategoryName((CoreTiming::TimeCategory)i), timeBreakdown.seconds[i] * 1000.0);
+		json.pop();
+		// These include everything the callback did.
+		json.pushArray("events");
+		for (const CoreTiming::EventProfile &evt : events) {
+			if (evt.totalFires == 0)
+				continue;
+			json.pushDict();
+			json.writeString("name", evt.name);
+			json.writeInt("fires", (int)evt.totalFires);
+			json.writeFloat("milliseconds", evt.totalSeconds * 1000.0);
+			json.pop();
+		}
+		json.pop();
+	}
+	json.pop();
+
+	return stateLoaded && framesRun == frames;
+}
+
 int main(int argc, const char* argv[])
 {
 	PROFILE_INIT();
@@ -231,6 +514,9 @@ int main(int argc, const char* argv[])
 	const char *mountRoot = 0;
 	const char *screenshotFilename = 0;
 	float timeout = std::numeric_limits<float>::infinity();
+	int benchFrames = 0;
+	int cpuBenchFrames = 0;
+	bool cpuBenchTiming = false;
 
 	for (int i = 1; i < argc; i++)
 	{
@@ -287,6 +573,12 @@ int main(int argc, const char* argv[])
 			screenshotFilename = argv[i] + strlen("--screenshot=");
 		else if (!strncmp(argv[i], "--timeout=", strlen("--timeout=")) && strlen(argv[i]) > strlen("--timeout="))
 			timeout = strtod(argv[i] + strlen("--timeout="), NULL);
+		else if (!strncmp(argv[i], "--bench=", strlen("--bench=")) && strlen(argv[i]) > strlen("--bench="))
+			benchFrames = atoi(argv[i] + strlen("--bench="));
+		else if (!strncmp(argv[i], "--cpubench=", strlen("--cpubench=")) && strlen(argv[i]) > strlen("--cpubench="))
+			cpuBenchFrames = atoi(argv[i] + strlen("--cpubench="));
+		else if (!strcmp(argv[i], "--timing"))
+			cpuBenchTiming = true;
 		else if (!strcmp(argv[i], "--teamcity"))
 			teamCityMode = true;
 		else if (!strncmp(argv[i], "--state=", strlen("--state=")) && strlen(argv[i]) > strlen("--state="))
@@ -315,11 +607,16 @@ int main(int argc, const char* argv[])
 	headlessHost->SetGraphicsCore(gpuCore);
 	host = headlessHost;
 
+	// Benchmarks shouldn't wait for the display.
+	const bool benchmarking = benchFrames > 0 || cpuBenchFrames > 0;
+	g_Config.bVSync = !benchmarking;
+
 	std::string error_string;
 	GraphicsContext *graphicsContext = nullptr;
 	bool glWorking = host->InitGraphics(&error_string, &graphicsContext);
 
-	LogManager::Init();
+	// Keep log output in step with the test output.
+	LogManager::Init(false);
 	LogManager *logman = LogManager::GetInstance();
 	
 	PrintfLogger *printfLogger = new PrintfLogger();
@@ -339,7 +636,7 @@ int main(int argc, const char* argv[])
 	coreParameter.mountIso = mountIso ? mountIso : "";
 	coreParameter.mountRoot = mountRoot ? mountRoot : "";
 	coreParameter.startBreak = false;
-	coreParameter.printfEmuLog = !autoCompare;
+	coreParameter.printfEmuLog = !autoCompare && !benchmarking;
 	coreParameter.headLess = true;
 	coreParameter.renderWidth = 480;
 	coreParameter.renderHeight = 272;
@@ -409,38 +706,62 @@ int main(int argc, const char* argv[])
 	}
 #endif
 
-	if (stateToLoad != NULL)
+	// The cpu benchmark loads it itself, after boot.
+	if (stateToLoad != NULL && cpuBenchFrames <= 0)
 		SaveState::Load(stateToLoad);
 
-	std::vector<std::string> failedTests;
-	std::vector<std::string> passedTests;
-	for (size_t i = 0; i < testFilenames.size(); ++i)
-	{
-		coreParameter.fileToStart = testFilenames[i];
-		if (autoCompare)
-			printf("%s:\n", coreParameter.fileToStart.c_str());
-		bool passed = RunAutoTest(headlessHost, coreParameter, autoCompare, verbose, timeout);
-		if (autoCompare)
+	int exitCode = 0;
+	if (cpuBenchFrames > 0) {
+		json::JsonWriter json(json::JsonWriter::PRETTY);
+		json.beginArray();
+		for (size_t i = 0; i < testFilenames.size(); ++i) {
+			coreParameter.fileToStart = testFilenames[i];
+			if (!RunCpuBenchmark(headlessHost, coreParameter, cpuBenchFrames, stateToLoad, timeout, cpuBenchTiming, json))
+				exitCode = 1;
+		}
+		json.end();
+		printf("%s\n", json.str().c_str());
+	} else if (benchFrames > 0) {
+		json::JsonWriter json(json::JsonWriter::PRETTY);
+		json.beginArray();
+		for (size_t i = 0; i < testFilenames.size(); ++i) {
+			coreParameter.fileToStart = testFilenames[i];
+			if (!RunReplayBenchmark(headlessHost, coreParameter, benchFrames, timeout, json))
+				exitCode = 1;
+		}
+		json.end();
+		printf("%s\n", json.str().c_str());
+	} else {
+		std::vector<std::string> failedTests;
+		std::vector<std::string> passedTests;
+		for (size_t i = 0; i < testFilenames.size(); ++i)
 		{
-			std::string testName = GetTestName(coreParameter.fileToStart);
-			if (passed)
+			coreParameter.fileToStart = testFilenames[i];
+			if (autoCompare)
+				printf("%s:\n", coreParameter.fileToStart.c_str());
+			bool passed = RunAutoTest(headlessHost, coreParameter, autoCompare, verbose, timeout);
+			if (autoCompare)
 			{
-				passedTests.push_back(testName);
-				printf("  %s - passed!\n", testName.c_str());
+				std::string testName = GetTestName(coreParameter.fileToStart);
+				if (passed)
+				{
+					passedTests.push_back(testName);
+					printf("  %s - passed!\n", testName.c_str());
+				}
+				else
+					failedTests.push_back(testName);
 			}
-			else
-				failedTests.push_back(testName);
 		}
-	}
 
-	if (autoCompare)
-	{
-		printf("%d tests passed, %d tests failed.\n", (int)passedTests.size(), (int)failedTests.size());
-		if (!failedTests.empty())
+		if (autoCompare)
 		{
-			printf("Failed tests:\n");
-			for (size_t i = 0; i < failedTests.size(); ++i) {
-				printf("  %s\n", failedTests[i].c_str());
+			printf("%d tests passed, %d tests failed.\n", (int)passedTests.size(), (int)failedTests.size());
+			if (!failedTests.empty())
+			{
+				printf("Failed tests:\n");
+				for (size_t i = 0; i < failedTests.size(); ++i) {
+					printf("  %s\n", failedTests[i].c_str());
+				}
 			}
 		}
 	}
@@ -458,5 +779,5 @@ int main(int argc, const char* argv[])
 	moncleanup();
 #endif
 
-	return 0;
+	return exitCode;
 }
@@ -26,6 +26,7 @@
 #include "Common/FileUtil.h"
 #include "Common/GraphicsContext.h"
 
+#include "Core/Config.h"
 #include "Core/CoreParameter.h"
 #include "Core/ConfigValues.h"
 #include "Core/System.h"
@@ -124,7 +125,7 @@ bool GLDummyGraphicsContext::InitFromRenderThread(std::string *errorMessage) {
 	glContext_ = SDL_GL_CreateContext(screen_);
 
 	// Ensure that the swap interval is set after context creation (needed for kmsdrm)
-	SDL_GL_SetSwapInterval(1);
+	SDL_GL_SetSwapInterval(g_Config.bVSync ? 1 : 0);
 
 #ifndef USING_GLES2
 	// Some core profile drivers elide certain extensions from GL_EXTENSIONS/etc.
@@ -406,6 +406,7 @@ static void EmuFrame() {
 
 static void EmuThreadFunc() {
 	setCurrentThreadName("Emu");
+	setCurrentThreadRole(ThreadRole::EMULATION);
 
 	while (true) {
 		switch ((EmuThreadState)emuThreadState) {
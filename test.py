@@ -3,9 +3,11 @@
 
 import sys
 import os
+import re
 import subprocess
 import threading
 import glob
+import multiprocessing
 
 
 PPSSPP_EXECUTABLES = [
@@ -28,27 +30,32 @@ PPSSPP_EXE = None
 TEST_ROOT = "pspautotests/tests/"
 teamcity_mode = False
 TIMEOUT = 5
+# Each job is a headless process running its share of the tests back to back.
+JOBS = multiprocessing.cpu_count()
 
 class Command(object):
-  def __init__(self, cmd, data = None):
+  def __init__(self, cmd, data = None, capture = False):
     self.cmd = cmd
     self.data = data
+    self.capture = capture
     self.process = None
     self.output = None
     self.timeout = False
 
   def run(self, timeout):
     def target():
-      self.process = subprocess.Popen(self.cmd, bufsize=1, stdin=subprocess.PIPE, stdout=sys.stdout, stderr=subprocess.STDOUT)
-      self.process.stdin.write(self.data.encode('utf-8'))
-      self.process.stdin.close()
-      self.process.communicate()
+      stdout = subprocess.PIPE if self.capture else sys.stdout
+      bufsize = -1 if self.capture else 1
+      self.process = subprocess.Popen(self.cmd, bufsize=bufsize, stdin=subprocess.PIPE, stdout=stdout, stderr=subprocess.STDOUT)
+      self.output = self.process.communicate(self.data.encode('utf-8'))[0]
+      if self.output is not None:
+        self.output = self.output.decode('utf-8', 'replace')
 
     thread = threading.Thread(target=target)
     thread.start()
 
     thread.join(timeout)
-    if thread.isAlive():
+    if thread.is_alive():
       self.timeout = True
       if sys.version_info < (2, 6):
         os.kill(self.process.pid, signal.SIGKILL)
@@ -375,10 +382,7 @@ def tcprint(arg):
     print(arg)
 
 def run_tests(test_list, args):
-  global PPSSPP_EXE, TIMEOUT
-  tests_passed = []
-  tests_failed = []
-
+  global PPSSPP_EXE, TIMEOUT, JOBS
   test_filenames = []
   for test in test_list:
     # Try prx first
@@ -389,19 +393,61 @@ def run_tests(test_list, args):
 
     test_filenames.append(elf_filename)
 
-  if len(test_filenames):
-    # TODO: Maybe --compare should detect --graphics?
-    cmdline = [PPSSPP_EXE, '--root', TEST_ROOT + '../', '--compare', '--timeout=' + str(TIMEOUT), '@-']
-    cmdline.extend([i for i in args if i not in ['-g', '-m']])
+  if not len(test_filenames):
+    return
+
+  # TODO: Maybe --compare should detect --graphics?
+  cmdline = [PPSSPP_EXE, '--root', TEST_ROOT + '../', '--compare', '--timeout=' + str(TIMEOUT), '@-']
+  cmdline.extend([i for i in args if i not in ['-g', '-m']])
 
+  # TeamCity wants its messages in order, so keep that to one process.
+  jobs = 1 if teamcity_mode else max(1, min(JOBS, len(test_filenames)))
+  if jobs == 1:
     c = Command(cmdline, '\n'.join(test_filenames))
     c.run(TIMEOUT * len(test_filenames))
+  else:
+    run_sharded(cmdline, test_filenames, jobs)
+
+  print("Ran " + ' '.join(cmdline))
 
-    print("Ran " + ' '.join(cmdline))
+def run_sharded(cmdline, test_filenames, jobs):
+  # Interleave the list, so slow test directories are spread out between jobs.
+  shards = [test_filenames[i::jobs] for i in range(jobs)]
+  commands = [Command(cmdline, '\n'.join(shard), capture = True) for shard in shards]
+  threads = [threading.Thread(target = c.run, args = (TIMEOUT * len(shard),)) for c, shard in zip(commands, shards)]
+  for t in threads:
+    t.start()
+  for t in threads:
+    t.join()
+
+  passed = 0
+  failed = []
+  for c, shard in zip(commands, shards):
+    output = c.output or ''
+    summary = re.search(r'^(\d+) tests passed, (\d+) tests failed\.$', output, re.MULTILINE)
+    if c.timeout or not summary:
+      # Didn't finish, so we don't know which ones failed.  Show everything it printed.
+      sys.stdout.write(output)
+      print("Job running %d tests did not finish" % len(shard))
+      failed.extend(os.path.splitext(os.path.relpath(f, TEST_ROOT))[0] for f in shard)
+      continue
+
+    # Print everything up to the summary, which is combined below.
+    sys.stdout.write(output[:summary.start()])
+    passed += int(summary.group(1))
+    failed_list = output[summary.end():].split('Failed tests:', 1)
+    if len(failed_list) > 1:
+      failed.extend(line.strip() for line in failed_list[1].splitlines() if line.strip())
+
+  print("%d tests passed, %d tests failed." % (passed, len(failed)))
+  if failed:
+    print("Failed tests:")
+    for test in failed:
+      print("  " + test)
 
 
 def main():
-  global teamcity_mode
+  global teamcity_mode, JOBS
   init()
   tests = []
   args = []
@@ -409,6 +455,8 @@ def main():
     if arg == '--teamcity':
       teamcity_mode = True
       args.append(arg)
+    elif arg.startswith('--jobs='):
+      JOBS = int(arg[len('--jobs='):])
     elif arg[0] == '-':
       args.append(arg)
     else:
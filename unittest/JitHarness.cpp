@@ -16,12 +16,18 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
 
 #include "base/timeutil.h"
 #include "base/NativeApp.h"
+#include "ext/xxhash.h"
 #include "Core/ConfigValues.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
 #include "Core/MIPS/JitCommon/JitBlockCache.h"
+#include "Core/MIPS/JitCommon/JitBlockCorpus.h"
+#include "Core/MIPS/MIPSAnalyst.h"
 #include "Core/MIPS/MIPSCodeUtils.h"
 #include "Core/MIPS/MIPSDebugInterface.h"
 #include "Core/MIPS/MIPSAsm.h"
@@ -195,3 +201,231 @@ bool TestJit() {
 
 	return jit_speed >= interp_speed;
 }
+
+// Blocks get registers pointing in here, so their loads and stores hit valid memory.
+static const u32 CORPUS_SCRATCH_START = 0x09E00000;
+static const u32 CORPUS_SCRATCH_SIZE = 0x00100000;
+static const u32 CORPUS_SCRATCH_REGS = 0x09E80000;
+static const int CORPUS_ITERATIONS = 200;
+
+static const CPUCore corpusCores[] = { CPUCore::INTERPRETER, CPUCore::IR_JIT, CPUCore::JIT };
+static const char *corpusCoreNames[] = { "interp", "irjit", "jit" };
+
+struct CorpusState {
+	u32 r[32];
+	u32 f[32];
+	u32 v[128];
+	u32 vfpuCtrl[16];
+	u32 pc, hi, lo, fcr31, fpcond;
+	u32 scratchHash;
+};
+
+struct CorpusResult {
+	double nsPerOp[ARRAY_SIZE(corpusCores)];
+	bool mismatch[ARRAY_SIZE(corpusCores)];
+	int irInstructions;
+	int nativeBytes;
+};
+
+static u32 corpusInitialVfpuCtrl[16];
+static int corpusStopEvent = -1;
+
+static void CorpusStop(u64 userdata, int cyclesLate) {
+	coreState = CORE_POWERDOWN;
+}
+
+static bool IsCorpusBlockRunnable(const MIPSComp::JitCorpusBlock &block) {
+	const u32 size = (u32)block.ops.size() * 4;
+	if (!Memory::IsValidRange(block.address, size))
+		return false;
+	if (block.address < CORPUS_SCRATCH_START + CORPUS_SCRATCH_SIZE && block.address + size > CORPUS_SCRATCH_START)
+		return false;
+
+	for (u32 encoding : block.ops) {
+		MIPSOpcode op(encoding);
+		// Syscalls need the game's modules, and the rest would stop us early.
+		if (MIPS_IS_EMUHACK(op) || MIPSAnalyst::IsSyscall(op) || (encoding & 0xFC00003F) == MIPS_MAKE_BREAK(0))
+			return false;
+		if (MIPSGetInfo(op) & BAD_INSTRUCTION)
+			return false;
+	}
+	return true;
+}
+
+static void ResetCorpusState(u32 pc) {
+	MIPSState *mips = currentMIPS;
+	for (int i = 0; i < 32; ++i) {
+		mips->r[i] = CORPUS_SCRATCH_REGS + i * 0x1000;
+		mips->f[i] = (float)i * 1.25f;
+	}
+	mips->r[MIPS_REG_ZERO] = 0;
+	for (int i = 0; i < 128; ++i) {
+		mips->v[i] = (float)(i - 64) * 0.5f;
+	}
+	memcpy(mips->vfpuCtrl, corpusInitialVfpuCtrl, sizeof(mips->vfpuCtrl));
+	mips->hi = 0x1234;
+	mips->lo = 0x5678;
+	mips->fcr31 = 0;
+	mips->fpcond = 0;
+	mips->inDelaySlot = false;
+	mips->pc = pc;
+
+	// Zero is a nop, in case something jumps into it.
+	memset(Memory::GetPointer(CORPUS_SCRATCH_START), 0, CORPUS_SCRATCH_SIZE);
+}
+
+static void SaveCorpusState(CorpusState &state) {
+	MIPSState *mips = currentMIPS;
+	memcpy(state.r, mips->r, sizeof(state.r));
+	memcpy(state.f, mips->f, sizeof(state.f));
+	memcpy(state.v, mips->v, sizeof(state.v));
+	memcpy(state.vfpuCtrl, mips->vfpuCtrl, sizeof(state.vfpuCtrl));
+	state.pc = mips->pc;
+	state.hi = mips->hi;
+	state.lo = mips->lo;
+	state.fcr31 = mips->fcr31;
+	state.fpcond = mips->fpcond;
+	state.scratchHash = XXH32(Memory::GetPointer(CORPUS_SCRATCH_START), CORPUS_SCRATCH_SIZE, 0);
+}
+
+static void PrintCorpusStateDiff(const CorpusState &expected, const CorpusState &actual) {
+	for (int i = 0; i < 32; ++i) {
+		if (expected.r[i] != actual.r[i])
+			printf("    r%d: %08x != %08x\n", i, actual.r[i], expected.r[i]);
+		if (expected.f[i] != actual.f[i])
+			printf("    f%d: %08x != %08x\n", i, actual.f[i], expected.f[i]);
+	}
+	for (int i = 0; i < 128; ++i) {
+		if (expected.v[i] != actual.v[i])
+			printf("    v%d: %08x != %08x\n", i, actual.v[i], expected.v[i]);
+	}
+	for (int i = 0; i < 16; ++i) {
+		if (expected.vfpuCtrl[i] != actual.vfpuCtrl[i])
+			printf("    vfpuCtrl%d: %08x != %08x\n", i, actual.vfpuCtrl[i], expected.vfpuCtrl[i]);
+	}
+	if (expected.pc != actual.pc)
+		printf("    pc: %08x != %08x\n", actual.pc, expected.pc);
+	if (expected.hi != actual.hi || expected.lo != actual.lo)
+		printf("    hi/lo: %08x/%08x != %08x/%08x\n", actual.hi, actual.lo, expected.hi, expected.lo);
+	if (expected.fcr31 != actual.fcr31 || expected.fpcond != actual.fpcond)
+		printf("    fcr31: %08x != %08x\n", actual.fcr31, expected.fcr31);
+	if (expected.scratchHash != actual.scratchHash)
+		printf("    memory differs\n");
+}
+
+static void RunCorpusBlock(u32 pc, int cycles) {
+	ResetCorpusState(pc);
+	// Stop as soon as the block's own cycles run out, which is right at its exit.
+	CoreTiming::ScheduleEvent(cycles - 1, corpusStopEvent);
+	coreState = CORE_RUNNING;
+	while (coreState == CORE_RUNNING) {
+		mipsr4k.RunLoopUntil(1000000);
+	}
+}
+
+// Replays blocks captured with "Dump blocks" on the jit compare screen through each cpu core.
+// Set PPSSPP_JIT_CORPUS to the file, otherwise jit_blocks.bin in the working directory is used.
+bool TestJitCorpus() {
+	const char *filename = getenv("PPSSPP_JIT_CORPUS");
+	if (!filename)
+		filename = "jit_blocks.bin";
+
+	std::vector<MIPSComp::JitCorpusBlock> allBlocks;
+	if (!MIPSComp::LoadJitBlockCorpus(filename, allBlocks)) {
+		printf("No jit block corpus at %s, skipping.\n", filename);
+		return true;
+	}
+	std::vector<MIPSComp::JitCorpusBlock> blocks;
+	for (const auto &block : allBlocks) {
+		if (IsCorpusBlockRunnable(block))
+			blocks.push_back(block);
+	}
+	printf("Running %d of %d blocks from %s\n", (int)blocks.size(), (int)allBlocks.size(), filename);
+
+	SetupJitHarness();
+	corpusStopEvent = CoreTiming::RegisterEvent("JitCorpusStop", &CorpusStop);
+	memcpy(corpusInitialVfpuCtrl, currentMIPS->vfpuCtrl, sizeof(corpusInitialVfpuCtrl));
+
+	std::vector<CorpusResult> results(blocks.size());
+	std::vector<CorpusState> expected(blocks.size());
+	for (size_t c = 0; c < ARRAY_SIZE(corpusCores); ++c) {
+		mipsr4k.UpdateCore(corpusCores[c]);
+
+		for (size_t i = 0; i < blocks.size(); ++i) {
+			const MIPSComp::JitCorpusBlock &block = blocks[i];
+			CorpusResult &result = results[i];
+
+			// Clearing first restores any emuhacks, so we don't write over them.
+			if (MIPSComp::jit)
+				MIPSComp::jit->ClearCache();
+			int cycles = 0;
+			for (size_t j = 0; j < block.ops.size(); ++j) {
+				Memory::Write_U32(block.ops[j], block.address + (u32)j * 4);
+				cycles += MIPSGetInstructionCycleEstimate(MIPSOpcode(block.ops[j]));
+			}
+			cycles = std::max(cycles, 2);
+
+			// The first run also compiles, so it's not timed.
+			RunCorpusBlock(block.address, cycles);
+			CorpusState state;
+			SaveCorpusState(state);
+			if (c == 0) {
+				expected[i] = state;
+				result.mismatch[c] = false;
+			} else {
+				result.mismatch[c] = memcmp(&state, &expected[i], sizeof(state)) != 0;
+				if (result.mismatch[c]) {
+					printf("%08x: %s differs from interp\n", block.address, corpusCoreNames[c]);
+					PrintCorpusStateDiff(expected[i], state);
+				}
+			}
+
+			double elapsed = 0.0;
+			for (int n = 0; n < CORPUS_ITERATIONS; ++n) {
+				double st = real_time_now();
+				RunCorpusBlock(block.address, cycles);
+				elapsed += real_time_now() - st;
+			}
+			result.nsPerOp[c] = elapsed * 1000000000.0 / (CORPUS_ITERATIONS * block.ops.size());
+
+			if (corpusCores[c] == CPUCore::IR_JIT) {
+				JitBlockCacheDebugInterface *blockCache = MIPSComp::jit->GetBlockCacheDebugInterface();
+				int num = blockCache->GetBlockNumberFromStartAddress(block.address);
+				result.irInstructions = num >= 0 ? (int)blockCache->GetBlockDebugInfo(num).irDisasm.size() : 0;
+			} else if (corpusCores[c] == CPUCore::JIT) {
+				JitBlockCache *blockCache = MIPSComp::jit->GetBlockCache();
+				int num = blockCache->GetBlockNumberFromStartAddress(block.address);
+				result.nativeBytes = num >= 0 ? blockCache->GetBlock(num)->codeSize : 0;
+			}
+		}
+	}
+
+	printf("\n    block   ops   interp ns/op   irjit ns/op     jit ns/op   ir ops   jit bytes   bloat\n");
+	double totals[ARRAY_SIZE(corpusCores)]{};
+	size_t totalOps = 0;
+	int mismatches = 0;
+	for (size_t i = 0; i < blocks.size(); ++i) {
+		const CorpusResult &result = results[i];
+		const size_t ops = blocks[i].ops.size();
+		printf("%08x %5d %14.2f %13.2f %13.2f %8d %11d %6.2fx%s\n", blocks[i].address, (int)ops,
+			result.nsPerOp[0], result.nsPerOp[1], result.nsPerOp[2], result.irInstructions, result.nativeBytes,
+			(double)result.nativeBytes / (ops * 4), result.mismatch[1] || result.mismatch[2] ? "  MISMATCH" : "");
+
+		for (size_t c = 0; c < ARRAY_SIZE(corpusCores); ++c) {
+			totals[c] += result.nsPerOp[c] * ops;
+			if (result.mismatch[c])
+				mismatches++;
+		}
+		totalOps += ops;
+	}
+
+	if (totalOps != 0) {
+		printf("\nAverage ns/op: interp %.2f, irjit %.2f, jit %.2f\n", totals[0] / totalOps, totals[1] / totalOps, totals[2] / totalOps);
+	}
+	printf("%d mismatches.\n\n", mismatches);
+
+	mipsr4k.UpdateCore(CPUCore::INTERPRETER);
+	DestroyJitHarness();
+
+	return mismatches == 0;
+}
@@ -0,0 +1,298 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "base/timeutil.h"
+#include "Common/ThreadPools.h"
+#include "Core/Config.h"
+#include "Core/MemMap.h"
+#include "GPU/ge_constants.h"
+#include "GPU/GPUState.h"
+#include "GPU/Software/Clipper.h"
+#include "GPU/Software/DrawPixel.h"
+#include "GPU/Software/Rasterizer.h"
+#include "GPU/Software/Sampler.h"
+#include "GPU/Software/SoftGpu.h"
+#include "unittest/TestSoftRasterizer.h"
+#include "unittest/UnitTest.h"
+
+// Synthetic scenes for timing the software rasterizer, sampler and clipper.
+// Frame dumps can already be timed with PPSSPPHeadless and --graphics=software.
+
+static const u32 FB_ADDR = 0x04000000;
+static const u32 DEPTH_ADDR = 0x04088000;
+static const u32 TEX8888_ADDR = 0x08800000;
+static const u32 TEXCLUT8_ADDR = 0x08840000;
+
+static const int SCREEN_W = 480;
+static const int SCREEN_H = 272;
+
+struct SoftRasterizerScene {
+	const char *name;
+	void (*setup)();
+	// Returns the number of pixels covered, before any tests.
+	int (*draw)(int *triangles);
+};
+
+static void SetCmd(GECommand cmd, u32 value) {
+	gstate.cmdmem[cmd] = (cmd << 24) | (value & 0x00FFFFFF);
+}
+
+static void SetTexture(u32 addr, int w, int h, GETextureFormat fmt) {
+	int logw = 0, logh = 0;
+	while ((1 << logw) < w)
+		++logw;
+	while ((1 << logh) < h)
+		++logh;
+	SetCmd(GE_CMD_TEXADDR0, addr & 0xFFFFF0);
+	SetCmd(GE_CMD_TEXBUFWIDTH0, w | ((addr >> 8) & 0x0F0000));
+	SetCmd(GE_CMD_TEXSIZE0, logw | (logh << 8));
+	SetCmd(GE_CMD_TEXFORMAT, fmt);
+	SetCmd(GE_CMD_TEXMODE, 0);
+	SetCmd(GE_CMD_TEXFUNC, GE_TEXFUNC_MODULATE | 0x100);
+	SetCmd(GE_CMD_TEXTUREMAPENABLE, 1);
+}
+
+static void ResetState() {
+	for (int i = 0; i < 256; ++i) {
+		gstate.cmdmem[i] = i << 24;
+	}
+
+	SetCmd(GE_CMD_VERTEXTYPE, GE_VTYPE_THROUGH);
+	SetCmd(GE_CMD_FRAMEBUFPTR, FB_ADDR & 0xFFFFFF);
+	SetCmd(GE_CMD_FRAMEBUFWIDTH, 512);
+	SetCmd(GE_CMD_FRAMEBUFPIXFORMAT, GE_FORMAT_8888);
+	SetCmd(GE_CMD_ZBUFPTR, DEPTH_ADDR & 0xFFFFFF);
+	SetCmd(GE_CMD_ZBUFWIDTH, 512);
+	SetCmd(GE_CMD_SCISSOR1, 0);
+	SetCmd(GE_CMD_SCISSOR2, (SCREEN_W - 1) | ((SCREEN_H - 1) << 10));
+	SetCmd(GE_CMD_MINZ, 0);
+	SetCmd(GE_CMD_MAXZ, 0xFFFF);
+	SetCmd(GE_CMD_SHADEMODE, GE_SHADE_GOURAUD);
+	SetCmd(GE_CMD_MASKRGB, 0);
+	SetCmd(GE_CMD_MASKALPHA, 0);
+
+	fb.data = Memory::GetPointer(FB_ADDR);
+	depthbuf.data = Memory::GetPointer(DEPTH_ADDR);
+}
+
+static VertexData MakeVertex(int x, int y, u16 z, float s, float t, u32 color) {
+	VertexData v{};
+	// Through mode screen coordinates are 12.4 fixed point.
+	v.screenpos = ScreenCoords(x * 16, y * 16, z);
+	v.clippos.w = 1.0f;
+	v.texturecoords = Vec2<float>(s, t);
+	v.color0 = Vec4<int>::FromRGBA(color);
+	v.color1 = Vec3<int>(0, 0, 0);
+	v.fogdepth = 1.0f;
+	return v;
+}
+
+// Draws a quad as two triangles, with texture coordinates mapped over [0, texw] x [0, texh].
+static void DrawQuad(int x, int y, int w, int h, u16 z, int texw, int texh, u32 c0, u32 c1) {
+	VertexData tl = MakeVertex(x, y, z, 0.0f, 0.0f, c0);
+	VertexData tr = MakeVertex(x + w, y, z, (float)texw, 0.0f, c1);
+	VertexData bl = MakeVertex(x, y + h, z, 0.0f, (float)texh, c1);
+	VertexData br = MakeVertex(x + w, y + h, z, (float)texw, (float)texh, c0);
+	Clipper::ProcessTriangle(tl, tr, bl, bl);
+	Clipper::ProcessTriangle(tr, br, bl, bl);
+}
+
+static void SetupSmallTriangles() {
+	SetCmd(GE_CMD_TEXTUREMAPENABLE, 0);
+}
+
+static int DrawSmallTriangles(int *triangles) {
+	int pixels = 0;
+	for (int y = 0; y < SCREEN_H; y += 8) {
+		for (int x = 0; x < SCREEN_W; x += 8) {
+			DrawQuad(x, y, 8, 8, 0, 0, 0, 0xFF00FF00 ^ (x * y), 0xFF0000FF ^ (x + y));
+			*triangles += 2;
+			pixels += 8 * 8;
+		}
+	}
+	Rasterizer::FlushTriangles();
+	return pixels;
+}
+
+static void SetupFullscreenBlend() {
+	SetCmd(GE_CMD_TEXTUREMAPENABLE, 0);
+	SetCmd(GE_CMD_ALPHABLENDENABLE, 1);
+	SetCmd(GE_CMD_BLENDMODE, GE_SRCBLEND_SRCALPHA | (GE_DSTBLEND_INVSRCALPHA << 4) | (GE_BLENDMODE_MUL_AND_ADD << 8));
+}
+
+static int DrawFullscreenBlend(int *triangles) {
+	for (int i = 0; i < 8; ++i) {
+		DrawQuad(0, 0, SCREEN_W, SCREEN_H, 0, 0, 0, 0x80FF8040 + i, 0x402080FF + i);
+		*triangles += 2;
+	}
+	Rasterizer::FlushTriangles();
+	return 8 * SCREEN_W * SCREEN_H;
+}
+
+static void SetupTexturedTriangles() {
+	u32 *tex = (u32 *)Memory::GetPointer(TEX8888_ADDR);
+	for (int y = 0; y < 256; ++y) {
+		for (int x = 0; x < 256; ++x) {
+			tex[y * 256 + x] = 0xFF000000 | (x << 16) | (y << 8) | ((x ^ y) & 0xFF);
+		}
+	}
+	SetTexture(TEX8888_ADDR, 256, 256, GE_TFMT_8888);
+	// Bilinear, so the texture is stretched rather than 1:1.
+	SetCmd(GE_CMD_TEXFILTER, 1 | (1 << 8));
+}
+
+static int DrawTexturedTriangles(int *triangles) {
+	int pixels = 0;
+	for (int y = 0; y < SCREEN_H; y += 34) {
+		for (int x = 0; x < SCREEN_W; x += 40) {
+			DrawQuad(x, y, 40, 34, 0, 256, 256, 0xFFFFFFFF, 0xFFC0C0C0);
+			*triangles += 2;
+			pixels += 40 * 34;
+		}
+	}
+	Rasterizer::FlushTriangles();
+	return pixels;
+}
+
+static void SetupClutSprites() {
+	u8 *tex = Memory::GetPointer(TEXCLUT8_ADDR);
+	for (int y = 0; y < 32; ++y) {
+		for (int x = 0; x < 32; ++x) {
+			tex[y * 32 + x] = (u8)(x * 8 + y);
+		}
+	}
+	for (int i = 0; i < 256; ++i) {
+		// Some fully transparent entries, like most sprites have.
+		clut[i] = (i & 7) == 0 ? 0 : 0xFF000000 | (i * 0x010203);
+	}
+	SetTexture(TEXCLUT8_ADDR, 32, 32, GE_TFMT_CLUT8);
+	SetCmd(GE_CMD_CLUTFORMAT, GE_CMODE_32BIT_ABGR8888 | (0xFF << 8));
+	SetCmd(GE_CMD_ALPHABLENDENABLE, 1);
+	SetCmd(GE_CMD_BLENDMODE, GE_SRCBLEND_SRCALPHA | (GE_DSTBLEND_INVSRCALPHA << 4) | (GE_BLENDMODE_MUL_AND_ADD << 8));
+}
+
+static int DrawClutSprites(int *triangles) {
+	int pixels = 0;
+	for (int i = 0; i < 1024; ++i) {
+		int x = (i * 37) % (SCREEN_W - 32);
+		int y = (i * 53) % (SCREEN_H - 32);
+		// Sprites are rectangles, which draw 1:1 without going through triangles.
+		VertexData v0 = MakeVertex(x, y, 0, 0.0f, 0.0f, 0xFFFFFFFF);
+		VertexData v1 = MakeVertex(x + 32, y + 32, 0, 32.0f, 32.0f, 0xFFFFFFFF);
+		Clipper::ProcessRect(v0, v1);
+		*triangles += 2;
+		pixels += 32 * 32;
+	}
+	Rasterizer::FlushTriangles();
+	return pixels;
+}
+
+static void SetupDepthHeavy() {
+	SetCmd(GE_CMD_TEXTUREMAPENABLE, 0);
+	SetCmd(GE_CMD_ZTESTENABLE, 1);
+	SetCmd(GE_CMD_ZTEST, GE_COMP_GEQUAL);
+	SetCmd(GE_CMD_ZWRITEDISABLE, 0);
+}
+
+static int DrawDepthHeavy(int *triangles) {
+	memset(depthbuf.data, 0, 512 * SCREEN_H * 2);
+	int pixels = 0;
+	for (int layer = 0; layer < 16; ++layer) {
+		// About half the layers land behind what's already drawn.
+		u16 z = (u16)(((layer * 7) % 16) * 4000);
+		for (int y = 0; y < SCREEN_H; y += 68) {
+			for (int x = 0; x < SCREEN_W; x += 60) {
+				DrawQuad(x, y, 60, 68, z, 0, 0, 0xFF102030 * layer, 0xFF302010 * layer);
+				*triangles += 2;
+				pixels += 60 * 68;
+			}
+		}
+	}
+	Rasterizer::FlushTriangles();
+	return pixels;
+}
+
+static const SoftRasterizerScene scenes[] = {
+	{ "small triangles", &SetupSmallTriangles, &DrawSmallTriangles },
+	{ "fullscreen blend", &SetupFullscreenBlend, &DrawFullscreenBlend },
+	{ "bilinear triangles", &SetupTexturedTriangles, &DrawTexturedTriangles },
+	{ "clut sprites", &SetupClutSprites, &DrawClutSprites },
+	{ "depth heavy", &SetupDepthHeavy, &DrawDepthHeavy },
+};
+
+static bool FramebufferWasDrawn() {
+	const u32 *pixels = (const u32 *)fb.data;
+	for (int y = 0; y < SCREEN_H; ++y) {
+		for (int x = 0; x < SCREEN_W; ++x) {
+			if (pixels[y * 512 + x] != 0)
+				return true;
+		}
+	}
+	return false;
+}
+
+bool TestSoftRasterizer() {
+	Memory::g_MemorySize = Memory::RAM_NORMAL_SIZE;
+	Memory::Init();
+	Sampler::Init();
+	Rasterizer::Init();
+
+	if (g_Config.iNumWorkerThreads <= 0)
+		g_Config.iNumWorkerThreads = std::thread::hardware_concurrency();
+	const int maxThreads = GlobalThreadPool::GetNumThreads();
+	std::vector<int> threadCounts;
+	for (int n = 1; n < maxThreads; n *= 2)
+		threadCounts.push_back(n);
+	threadCounts.push_back(maxThreads);
+
+	bool success = true;
+	for (const SoftRasterizerScene &scene : scenes) {
+		ResetState();
+		memset(fb.data, 0, 512 * SCREEN_H * 4);
+		scene.setup();
+
+		for (int threads : threadCounts) {
+			GlobalThreadPool::SetMaxThreads(threads);
+
+			int triangles = 0;
+			double pixels = 0.0;
+			double st = real_time_now();
+			do {
+				pixels += scene.draw(&triangles);
+			} while (real_time_now() - st < 0.25);
+			double elapsed = real_time_now() - st;
+
+			printf("%-20s %d threads: %8.2f Mpixels/s, %10.0f triangles/s\n", scene.name, threads, pixels / elapsed / 1000000.0, triangles / elapsed);
+		}
+
+		if (!FramebufferWasDrawn()) {
+			printf("%s: Nothing was drawn\n", scene.name);
+			success = false;
+		}
+	}
+
+	GlobalThreadPool::SetMaxThreads(0);
+	Rasterizer::Shutdown();
+	Sampler::Shutdown();
+	Memory::Shutdown();
+	return success;
+}
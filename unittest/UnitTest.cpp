@@ -30,9 +30,11 @@
 #include <cmath>
 #include <string>
 #include <sstream>
+#include <vector>
 
 #include "base/NativeApp.h"
 #include "base/logging.h"
+#include "base/timeutil.h"
 #include "input/input_state.h"
 #include "ext/disarm.h"
 #include "math/math_util.h"
@@ -40,14 +42,18 @@
 
 #include "Common/ArmEmitter.h"
 #include "Common/BitScan.h"
+#include "Common/ColorConv.h"
 #include "Common/CPUDetect.h"
+#include "Common/TLSFAllocator.h"
 #include "Core/Config.h"
 #include "Core/FileSystems/ISOFileSystem.h"
 #include "Core/MemMap.h"
 #include "Core/MIPS/MIPSVFPUUtils.h"
+#include "GPU/Common/IndexGenerator.h"
 #include "GPU/Common/TextureDecoder.h"
 
 #include "unittest/JitHarness.h"
+#include "unittest/TestSoftRasterizer.h"
 #include "unittest/TestVertexJit.h"
 #include "unittest/UnitTest.h"
 
@@ -484,6 +490,184 @@ bool TestCLZ() {
 	return true;
 }
 
+static bool TestIndexGenerator() {
+	static u16 inds[4096];
+	IndexGenerator gen;
+	gen.Setup(inds);
+
+	// Long enough to hit the vector paths and their tails, plus a base that wraps around.
+	static const int bases[] = { 0, 65530 };
+	for (int base : bases) {
+		for (int numVerts = 3; numVerts < 100; ++numVerts) {
+			for (int cw = 0; cw < 2; ++cw) {
+				gen.Reset();
+				gen.SetIndex(base);
+				gen.AddPrim(GE_PRIM_TRIANGLE_STRIP, numVerts, cw != 0);
+				int wind = cw ? 1 : 2;
+				for (int i = 0; i < numVerts - 2; ++i) {
+					EXPECT_EQ_INT(inds[i * 3 + 0], (u16)(base + i));
+					EXPECT_EQ_INT(inds[i * 3 + 1], (u16)(base + i + wind));
+					wind ^= 3;
+					EXPECT_EQ_INT(inds[i * 3 + 2], (u16)(base + i + wind));
+				}
+
+				const int v1 = cw ? 1 : 2;
+				const int v2 = cw ? 2 : 1;
+				gen.Reset();
+				gen.SetIndex(base);
+				gen.AddPrim(GE_PRIM_TRIANGLE_FAN, numVerts, cw != 0);
+				for (int i = 0; i < numVerts - 2; ++i) {
+					EXPECT_EQ_INT(inds[i * 3 + 0], (u16)base);
+					EXPECT_EQ_INT(inds[i * 3 + 1], (u16)(base + i + v1));
+					EXPECT_EQ_INT(inds[i * 3 + 2], (u16)(base + i + v2));
+				}
+
+				gen.Reset();
+				gen.SetIndex(base);
+				gen.AddPrim(GE_PRIM_TRIANGLES, numVerts, cw != 0);
+				for (int i = 0; i + 2 < numVerts; i += 3) {
+					EXPECT_EQ_INT(inds[i + 0], (u16)(base + i));
+					EXPECT_EQ_INT(inds[i + 1], (u16)(base + i + v1));
+					EXPECT_EQ_INT(inds[i + 2], (u16)(base + i + v2));
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+template <typename ClutT>
+static bool CheckDeIndexTexture4(const ClutT *clut) {
+	static u8 indexed[256 * 40];
+	static ClutT out[(512 + 2) * 40];
+	for (int i = 0; i < (int)sizeof(indexed); ++i)
+		indexed[i] = (u8)(i * 37 + (i >> 3));
+
+	// Odd and unaligned widths hit the tails, large ones the pair table.
+	static const int widths[] = { 1, 2, 16, 31, 32, 48, 100, 512 };
+	for (int w : widths) {
+		const int h = w >= 100 ? 40 : 3;
+		const int indexPitch = w > 64 ? (w + 1) / 2 : 32;
+		const int outPitch = w + 2;
+		memset(out, 0xCD, sizeof(out));
+		DeIndexTexture4Rows(out, outPitch * (int)sizeof(ClutT), indexed, indexPitch, w, h, clut);
+		for (int y = 0; y < h; ++y) {
+			for (int x = 0; x < w; ++x) {
+				const u8 index = (indexed[indexPitch * y + x / 2] >> ((x & 1) * 4)) & 0xF;
+				EXPECT_EQ_HEX(out[outPitch * y + x], clut[index]);
+			}
+			// Must not write past the row.
+			EXPECT_EQ_HEX(((const u8 *)&out[outPitch * y + w])[0], 0xCD);
+		}
+	}
+	return true;
+}
+
+static bool TestDeIndexTexture4() {
+	u16 clut16[16];
+	u32 clut32[16];
+	for (int i = 0; i < 16; ++i) {
+		clut16[i] = (u16)(0xF00F ^ (i * 0x1234));
+		clut32[i] = 0xFF00FF00 ^ (i * 0x12345679);
+	}
+	if (!CheckDeIndexTexture4(clut16) || !CheckDeIndexTexture4(clut32))
+		return false;
+
+	// Rough timing for a 512x512 CLUT4 texture, for comparing kernels.
+	const int size = 512;
+	std::vector<u8> indexed(size * size / 2);
+	std::vector<u32> out(size * size);
+	for (size_t i = 0; i < indexed.size(); ++i)
+		indexed[i] = (u8)(i * 7);
+	int runs = 0;
+	double st = real_time_now();
+	do {
+		DeIndexTexture4Rows((u16 *)out.data(), size * 2, indexed.data(), size / 2, size, size, clut16);
+		DeIndexTexture4Rows(out.data(), size * 4, indexed.data(), size / 2, size, size, clut32);
+		runs++;
+	} while (real_time_now() - st < 0.25);
+	printf("DeIndexTexture4Rows: %0.3f ms per 512x512 16+32-bit pair\n", (real_time_now() - st) * 1000.0 / runs);
+	return true;
+}
+
+template <typename D, typename S>
+static bool CheckColorConv(const char *name, void (*func)(D *, const S *, u32), D (*ref)(S)) {
+	// Odd sizes and offsets, to cover the SIMD loops, their remainders, and unaligned pointers.
+	static const u32 sizes[] = { 1, 7, 8, 15, 16, 17, 31, 33, 100 };
+	std::vector<S> src(128);
+	std::vector<D> dst(128);
+	for (size_t i = 0; i < src.size(); ++i)
+		src[i] = (S)(0x9E3779B9U * (u32)(i + 1));
+	for (int offset = 0; offset < 3; ++offset) {
+		for (u32 size : sizes) {
+			std::fill(dst.begin(), dst.end(), (D)0xCDCDCDCD);
+			func(&dst[offset], &src[offset], size);
+			for (u32 i = 0; i < size; ++i) {
+				if (dst[offset + i] != ref(src[offset + i])) {
+					printf("%s: pixel %d of %d at offset %d: %08x vs %08x\n", name, i, size, offset, (u32)dst[offset + i], (u32)ref(src[offset + i]));
+					return false;
+				}
+			}
+			EXPECT_EQ_HEX((u32)dst[offset + size], (u32)(D)0xCDCDCDCD);
+		}
+	}
+	return true;
+}
+
+static u32 SwapRB(u32 c) {
+	return (c & 0xFF00FF00) | ((c >> 16) & 0xFF) | ((c & 0xFF) << 16);
+}
+
+static u16 BGRA8888ToRGB565(u32 c) {
+	return RGBA8888ToRGB565(SwapRB(c));
+}
+
+static u16 BGRA8888ToRGBA5551(u32 c) {
+	return RGBA8888ToRGBA5551(SwapRB(c));
+}
+
+static u16 BGRA8888ToRGBA4444(u32 c) {
+	return RGBA8888ToRGBA4444(SwapRB(c));
+}
+
+template <typename D, typename S>
+static void TimeColorConv(const char *name, void (*func)(D *, const S *, u32)) {
+	const u32 size = 512 * 512;
+	std::vector<S> src(size, (S)0x12345678);
+	std::vector<D> dst(size);
+	int runs = 0;
+	double st = real_time_now();
+	do {
+		func(dst.data(), src.data(), size);
+		runs++;
+	} while (real_time_now() - st < 0.1);
+	printf("%s: %0.3f ms per 512x512\n", name, (real_time_now() - st) * 1000.0 / runs);
+}
+
+static bool TestColorConv() {
+#define CHECK_COLOR_CONV(func, ref) if (!CheckColorConv(#func, &func, &ref)) return false
+	CHECK_COLOR_CONV(ConvertBGRA8888ToRGBA8888, SwapRB);
+	CHECK_COLOR_CONV(ConvertRGBA8888ToRGB565, RGBA8888ToRGB565);
+	CHECK_COLOR_CONV(ConvertRGBA8888ToRGBA5551, RGBA8888ToRGBA5551);
+	CHECK_COLOR_CONV(ConvertRGBA8888ToRGBA4444, RGBA8888ToRGBA4444);
+	CHECK_COLOR_CONV(ConvertBGRA8888ToRGB565, BGRA8888ToRGB565);
+	CHECK_COLOR_CONV(ConvertBGRA8888ToRGBA5551, BGRA8888ToRGBA5551);
+	CHECK_COLOR_CONV(ConvertBGRA8888ToRGBA4444, BGRA8888ToRGBA4444);
+	CHECK_COLOR_CONV(ConvertRGBA565ToRGBA8888, RGB565ToRGBA8888);
+	CHECK_COLOR_CONV(ConvertRGBA5551ToRGBA8888, RGBA5551ToRGBA8888);
+	CHECK_COLOR_CONV(ConvertRGBA4444ToRGBA8888, RGBA4444ToRGBA8888);
+#undef CHECK_COLOR_CONV
+
+	// Rough timings, for comparing kernels.
+	TimeColorConv("ConvertBGRA8888ToRGBA8888", &ConvertBGRA8888ToRGBA8888);
+	TimeColorConv("ConvertRGBA8888ToRGB565", &ConvertRGBA8888ToRGB565);
+	TimeColorConv("ConvertRGBA8888ToRGBA5551", &ConvertRGBA8888ToRGBA5551);
+	TimeColorConv("ConvertRGBA565ToRGBA8888", &ConvertRGBA565ToRGBA8888);
+	TimeColorConv("ConvertRGBA4444ToRGBA8888", &ConvertRGBA4444ToRGBA8888);
+	return true;
+}
+
 static bool TestMemMap() {
 	Memory::g_MemorySize = Memory::RAM_DOUBLE_SIZE;
 
@@ -531,6 +715,59 @@ static bool TestMemMap() {
 	return true;
 }
 
+static bool TestTLSFAllocator() {
+	TLSFAllocator alloc(1024);
+	EXPECT_EQ_INT(alloc.FreeUnits(), 1024);
+
+	uint32_t a = alloc.Allocate(100);
+	uint32_t b = alloc.Allocate(200, 64);
+	uint32_t c = alloc.Allocate(300);
+	EXPECT_FALSE(a == TLSFAllocator::INVALID || b == TLSFAllocator::INVALID || c == TLSFAllocator::INVALID);
+	EXPECT_EQ_INT(b & 63, 0);
+	EXPECT_EQ_INT(alloc.SizeOf(b), 200);
+	EXPECT_EQ_INT(alloc.FreeUnits(), 1024 - 600);
+	EXPECT_TRUE(alloc.Allocate(1024) == TLSFAllocator::INVALID);
+
+	// Freeing everything should merge back into one range.
+	alloc.Free(b);
+	alloc.Free(a);
+	alloc.Free(c);
+	EXPECT_EQ_INT(alloc.FreeUnits(), 1024);
+	EXPECT_EQ_INT(alloc.Allocate(1024), 0);
+	alloc.Free(0);
+
+	// Churn, checking that nothing ever overlaps.
+	std::vector<uint32_t> owner(1024, TLSFAllocator::INVALID);
+	std::vector<uint32_t> live;
+	for (int i = 0; i < 10000; ++i) {
+		if (!live.empty() && (i * 7) % 3 == 0) {
+			size_t which = (i * 13) % live.size();
+			uint32_t start = live[which];
+			for (uint32_t j = 0; j < alloc.SizeOf(start); ++j)
+				owner[start + j] = TLSFAllocator::INVALID;
+			alloc.Free(start);
+			live[which] = live.back();
+			live.pop_back();
+		} else {
+			uint32_t count = 1 + (i * 31) % 97;
+			uint32_t start = alloc.Allocate(count, 1 << (i % 4));
+			if (start == TLSFAllocator::INVALID)
+				continue;
+			EXPECT_EQ_INT(start & ((1 << (i % 4)) - 1), 0);
+			for (uint32_t j = 0; j < count; ++j) {
+				EXPECT_TRUE(owner[start + j] == TLSFAllocator::INVALID);
+				owner[start + j] = start;
+			}
+			live.push_back(start);
+		}
+	}
+	for (uint32_t start : live)
+		alloc.Free(start);
+	EXPECT_EQ_INT(alloc.FreeUnits(), 1024);
+	EXPECT_EQ_INT(alloc.Allocate(1024), 0);
+	return true;
+}
+
 typedef bool (*TestFunc)();
 struct TestItem {
 	const char *name;
@@ -560,11 +797,17 @@ TestItem availableTests[] = {
 	TEST_ITEM(MathUtil),
 	TEST_ITEM(Parsers),
 	TEST_ITEM(Jit),
+	TEST_ITEM(JitCorpus),
 	TEST_ITEM(MatrixTranspose),
 	TEST_ITEM(ParseLBN),
 	TEST_ITEM(QuickTexHash),
 	TEST_ITEM(CLZ),
 	TEST_ITEM(MemMap),
+	TEST_ITEM(IndexGenerator),
+	TEST_ITEM(DeIndexTexture4),
+	TEST_ITEM(TLSFAllocator),
+	TEST_ITEM(ColorConv),
+	TEST_ITEM(SoftRasterizer),
 };
 
 int main(int argc, const char *argv[]) {